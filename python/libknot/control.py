@@ -74,6 +74,14 @@ class KnotCtlData(object):
 
         self.data[index] = ctypes.c_char_p(value.encode()) if value else ctypes.c_char_p()
 
+    def copy(self) -> "KnotCtlData":
+        """Returns a copy independent of the control receive buffer."""
+
+        out = KnotCtlData()
+        for idx in KnotCtlDataIdx:
+            out[idx] = self[idx]
+        return out
+
 
 class KnotCtlError(Exception):
     """Libknot server control error."""
@@ -98,6 +106,9 @@ class KnotCtl(object):
     SEND = None
     RECEIVE = None
 
+    BATCH_BLOCK_SIZE = 256
+    BATCH_DEPTH = 4
+
     def __init__(self) -> None:
         """Initializes a control interface instance."""
 
@@ -173,11 +184,11 @@ class KnotCtl(object):
             raise KnotCtlError(err if isinstance(err, str) else err.decode())
         return KnotCtlType(data_type.value)
 
-    def send_block(self, cmd: str, section: str = None, item: str = None,
-                   identifier: str = None, zone: str = None, owner: str = None,
-                   ttl: str = None, rtype: str = None, data: str = None,
-                   flags: str = None, filters: str = None) -> None:
-        """Sends a control query block."""
+    @staticmethod
+    def _query(cmd: str, section: str = None, item: str = None,
+               identifier: str = None, zone: str = None, owner: str = None,
+               ttl: str = None, rtype: str = None, data: str = None,
+               flags: str = None, filters: str = None) -> KnotCtlData:
 
         query = KnotCtlData()
         query[KnotCtlDataIdx.COMMAND] = cmd
@@ -191,10 +202,120 @@ class KnotCtl(object):
         query[KnotCtlDataIdx.DATA] = data
         query[KnotCtlDataIdx.FLAGS] = flags
         query[KnotCtlDataIdx.FILTER] = filters
+        return query
+
+    def send_block(self, cmd: str, section: str = None, item: str = None,
+                   identifier: str = None, zone: str = None, owner: str = None,
+                   ttl: str = None, rtype: str = None, data: str = None,
+                   flags: str = None, filters: str = None) -> None:
+        """Sends a control query block."""
+
+        query = self._query(cmd, section, item, identifier, zone, owner,
+                            ttl, rtype, data, flags, filters)
 
         self.send(KnotCtlType.DATA, query)
         self.send(KnotCtlType.BLOCK)
 
+    def send_batch(self, cmd: str, units, flags: str = None,
+                   block_size: int = BATCH_BLOCK_SIZE,
+                   depth: int = BATCH_DEPTH) -> list:
+        """Sends the command for each of the units and receives the answers.
+
+        Each unit is a dictionary of the send_block() parameters except for
+        'cmd' and 'flags', e.g. {"zone": "example.com", "owner": "www",
+        "ttl": "3600", "rtype": "A", "data": "192.0.2.1"}. The units are merged
+        into command blocks, which the server processes without a round trip
+        per unit, and up to 'depth' blocks are sent before their answers are
+        received.
+
+        Like the knotc batch mode, it's intended for zone commands without
+        output (e.g. zone-set, zone-unset, zone-reload) and each unit must
+        specify the zone. Returns the list of KnotCtlError of the failed units.
+        """
+
+        errors = list()
+        pending = 0
+        units_in_block = 0
+
+        for unit in units:
+            self.send(KnotCtlType.DATA, self._query(cmd, flags=flags, **unit))
+            units_in_block += 1
+            if units_in_block < block_size:
+                continue
+
+            self.send(KnotCtlType.BLOCK)
+            units_in_block = 0
+            pending += 1
+            if pending >= depth:
+                self._receive_errors(errors)
+                pending -= 1
+
+        if units_in_block > 0:
+            self.send(KnotCtlType.BLOCK)
+            pending += 1
+
+        while pending > 0:
+            self._receive_errors(errors)
+            pending -= 1
+
+        return errors
+
+    def _receive_errors(self, errors: list) -> None:
+
+        reply = KnotCtlData()
+        while self.receive(reply) in [KnotCtlType.DATA, KnotCtlType.EXTRA]:
+            if reply[KnotCtlDataIdx.ERROR]:
+                errors.append(KnotCtlError(reply[KnotCtlDataIdx.ERROR], reply.copy()))
+
+    def receive_stream(self):
+        """Yields the data units of a control answer as they are received.
+
+        The yielded data unit is valid only until the next one is received,
+        copy() it to keep it. If the answer contains an error, KnotCtlError
+        is raised after the whole answer is received.
+        """
+
+        reply = KnotCtlData()
+        err_reply = None
+
+        while True:
+            reply_type = self.receive(reply)
+
+            # Stop if not data type.
+            if reply_type not in [KnotCtlType.DATA, KnotCtlType.EXTRA]:
+                break
+
+            # Check for an error.
+            if reply[KnotCtlDataIdx.ERROR]:
+                err_reply = reply.copy()
+                continue
+
+            yield reply
+
+        if err_reply:
+            raise KnotCtlError(err_reply[KnotCtlDataIdx.ERROR], err_reply)
+
+    def receive_zone_stream(self):
+        """Yields the records of a zone data answer (zone-read, zone-get, ...)
+           as (zone, owner, ttl, type, data) tuples.
+        """
+
+        for reply in self.receive_stream():
+            if reply[KnotCtlDataIdx.OWNER]:
+                yield (reply[KnotCtlDataIdx.ZONE], reply[KnotCtlDataIdx.OWNER],
+                       reply[KnotCtlDataIdx.TTL], reply[KnotCtlDataIdx.TYPE],
+                       reply[KnotCtlDataIdx.DATA])
+
+    def receive_stats_stream(self):
+        """Yields the counters of a statistics answer as
+           (zone, section, item, index, value) tuples.
+        """
+
+        for reply in self.receive_stream():
+            yield (reply[KnotCtlDataIdx.ZONE], reply[KnotCtlDataIdx.SECTION],
+                   reply[KnotCtlDataIdx.ITEM], reply[KnotCtlDataIdx.ID],
+                   int(reply[KnotCtlDataIdx.DATA]))
+
     def _receive_conf(self, out, reply):
 
         section = reply[KnotCtlDataIdx.SECTION]
@@ -298,47 +419,18 @@ class KnotCtl(object):
         """Receives statistics answer and returns it as a structured dictionary."""
 
         out = dict()
-        err_reply = None
-
-        while True:
-            reply = KnotCtlData()
-            reply_type = self.receive(reply)
-
-            # Stop if not data type.
-            if reply_type not in [KnotCtlType.DATA, KnotCtlType.EXTRA]:
-                break
-
-            # Check for an error.
-            if reply[KnotCtlDataIdx.ERROR]:
-                err_reply = reply
-                continue
 
+        for reply in self.receive_stream():
             self._receive_stats(out, reply)
 
-        if err_reply:
-            raise KnotCtlError(err_reply[KnotCtlDataIdx.ERROR], err_reply)
-
         return out
 
     def receive_block(self) -> dict:
         """Receives a control answer and returns it as a structured dictionary."""
 
         out = dict()
-        err_reply = None
-
-        while True:
-            reply = KnotCtlData()
-            reply_type = self.receive(reply)
-
-            # Stop if not data type.
-            if reply_type not in [KnotCtlType.DATA, KnotCtlType.EXTRA]:
-                break
-
-            # Check for an error.
-            if reply[KnotCtlDataIdx.ERROR]:
-                err_reply = reply
-                continue
 
+        for reply in self.receive_stream():
             # Check for config data.
             if reply[KnotCtlDataIdx.SECTION]:
                 self._receive_conf(out, reply)
@@ -348,10 +440,5 @@ class KnotCtl(object):
                     self._receive_zone(out, reply)
                 else:
                     self._receive_zone_status(out, reply)
-            else:
-                continue
-
-        if err_reply:
-            raise KnotCtlError(err_reply[KnotCtlDataIdx.ERROR], err_reply)
 
         return out
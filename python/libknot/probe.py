@@ -7,6 +7,36 @@ import socket
 import libknot
 
 
+def _dtype(struct: type, byteorder: str, bits: list) -> dict:
+    """Describes a ctypes structure as a NumPy compatible dtype specification.
+
+    The bit-fields are not representable, each group of them sharing one byte
+    is described as a raw byte with the corresponding name from 'bits'.
+    """
+
+    names, formats, offsets = list(), list(), list()
+    bits = iter(bits)
+    last_bits = -1
+    for field in struct._fields_:
+        name, ctype = field[0], field[1]
+        offset = getattr(struct, name).offset
+        if len(field) > 2:
+            if offset == last_bits:
+                continue
+            name, last_bits = next(bits), offset
+        if hasattr(ctype, '_dtype_'):
+            fmt = ctype._dtype_()
+        elif hasattr(ctype, '_length_'):
+            fmt = ("%su%u" % (byteorder, ctypes.sizeof(ctype._type_)), ctype._length_)
+        else:
+            fmt = "%su%u" % (byteorder, ctypes.sizeof(ctype))
+        names.append(name)
+        formats.append(fmt)
+        offsets.append(offset)
+    return {'names': names, 'formats': formats, 'offsets': offsets,
+            'itemsize': ctypes.sizeof(struct)}
+
+
 class KnotProbeDataProto(enum.IntEnum):
     """Libknot probe transport protocol types."""
 
@@ -36,6 +66,10 @@ class KnotProbeDataDNSHdr(ctypes.BigEndianStructure):
                 ('authorities', ctypes.c_ushort),
                 ('additionals', ctypes.c_ushort)]
 
+    @classmethod
+    def _dtype_(cls) -> dict:
+        return _dtype(cls, ">", ['byte3', 'byte4'])
+
 
 class KnotProbeData(ctypes.Structure):
     """Libknot probe data unit."""
@@ -69,6 +103,16 @@ class KnotProbeData(ctypes.Structure):
                 ('query_name_len', ctypes.c_ubyte),
                 ('query_name', ctypes.c_ubyte * (QNAME_MAX_SIZE))]
 
+    @classmethod
+    def dtype(cls) -> dict:
+        """Returns a NumPy dtype specification of the data unit.
+
+        The EDNS presence and DO flag bits are in the 'edns_flags' byte,
+        the header flags in the 'byte3' and 'byte4' bytes of the headers.
+        """
+
+        return _dtype(cls, "=", ['edns_flags'])
+
     def addr_str(self, addr: ctypes.c_ubyte * ADDR_MAX_SIZE) -> str:
         """Converts IPv4 or IPv6 address from binary to text form."""
 
@@ -172,12 +216,18 @@ class KnotProbeData(ctypes.Structure):
 
 
 class KnotProbeDataArray(object):
-    """Libknot probe data unit array."""
+    """Libknot probe data unit array.
+
+    The array is contiguous, view() exposes the received data units without
+    copying, e.g. numpy.frombuffer(data.view(), numpy.dtype(KnotProbeData.dtype())).
+    """
+
+    SIZE_MAX = 2**31 - 1
 
     def __init__(self, size: int = 1) -> None:
         """Creates a data array of a given size."""
 
-        if size < 1 or size > 255:
+        if size < 1 or size > KnotProbeDataArray.SIZE_MAX:
             raise ValueError
         data_array = KnotProbeData * size
         self.data = data_array()
@@ -213,6 +263,12 @@ class KnotProbeDataArray(object):
             self.pos += 1
             return data
 
+    def view(self) -> memoryview:
+        """Returns a byte view of the currently used part of the array."""
+
+        item_size = ctypes.sizeof(KnotProbeData)
+        return memoryview(self.data).cast('B')[:self.used * item_size]
+
 
 class KnotProbe(object):
     """Libknot probe consumer interface."""
@@ -234,10 +290,10 @@ class KnotProbe(object):
             KnotProbe.FREE = libknot.Knot.LIBKNOT.knot_probe_free
             KnotProbe.FREE.argtypes = [ctypes.c_void_p]
 
-            KnotProbe.CONSUME = libknot.Knot.LIBKNOT.knot_probe_consume
+            KnotProbe.CONSUME = libknot.Knot.LIBKNOT.knot_probe_consume_bulk
             KnotProbe.CONSUME.restype = ctypes.c_int
             KnotProbe.CONSUME.argtypes = [ctypes.c_void_p, ctypes.c_void_p, \
-                                          ctypes.c_ubyte, ctypes.c_int]
+                                          ctypes.c_uint, ctypes.c_int]
 
             KnotProbe.SET_CONSUMER = libknot.Knot.LIBKNOT.knot_probe_set_consumer
             KnotProbe.SET_CONSUMER.restype = ctypes.c_int
@@ -258,6 +314,8 @@ class KnotProbe(object):
 
     def consume(self, data: KnotProbeDataArray, timeout: int = 1000) -> int:
         '''Consumes data units from a channel and stores them in data array.
+           Waits only for the first data unit, the rest of the array is filled
+           with the already available ones.
            Returns the number of consumed data units.
         '''
 
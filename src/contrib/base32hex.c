@@ -19,6 +19,8 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
 /*! \brief Maximal length of binary input to Base32hex encoding. */
 #define MAX_BIN_DATA_LEN	((INT32_MAX / 8) * 5)
@@ -80,6 +82,210 @@ static const uint8_t base32hex_dec[256] = {
 	[ 42] = KO, ['U'] = 30, [128] = KO, [171] = KO, [214] = KO,
 };
 
+/*
+ * Vectorized loops over the complete blocks in the middle of the data, two
+ * 5-byte groups per step, that suits the length of the NSEC3 hashes. Each
+ * returns the length of the input it processed, the rest including any
+ * invalid or padding characters is left to the scalar code so that the results
+ * and errors are exactly the same.
+ */
+typedef size_t (*blocks_f)(const uint8_t *in, size_t in_len, uint8_t *out);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define HAVE_BLOCKS
+
+__attribute__((target("ssse3")))
+static size_t enc_ssse3(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	// Big-endian 16-bit words holding the 5-bit values at the top.
+	const __m128i shuf0 = _mm_setr_epi8(1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, 5, 4);
+	const __m128i shuf1 = _mm_setr_epi8(6, 5, 6, 5, 7, 6, 7, 6, 8, 7, 9, 8, 9, 8, 10, 9);
+	// Right shifts 11, 6, 9, 4, 7, 10, 5, 8 as multiplications.
+	const __m128i mul = _mm_setr_epi16(32, 1024, 128, 4096, 512, 64, 2048, 256);
+	const __m128i mask_1f = _mm_set1_epi16(0x1F);
+	size_t done = 0;
+
+	// 10 bytes are encoded into 16 characters.
+	while (in_len - done >= 10) {
+		uint16_t tail;
+		memcpy(&tail, in + done + 8, sizeof(tail));
+		__m128i v = _mm_loadl_epi64((const __m128i *)(in + done));
+		v = _mm_insert_epi16(v, tail, 4);
+		__m128i i0 = _mm_and_si128(_mm_mulhi_epu16(_mm_shuffle_epi8(v, shuf0), mul), mask_1f);
+		__m128i i1 = _mm_and_si128(_mm_mulhi_epu16(_mm_shuffle_epi8(v, shuf1), mul), mask_1f);
+		v = _mm_packus_epi16(i0, i1);
+		// Translate 5-bit values into the alphabet.
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)), _mm_set1_epi8(39));
+		v = _mm_add_epi8(_mm_add_epi8(v, _mm_set1_epi8('0')), alpha);
+		_mm_storeu_si128((__m128i *)out, v);
+		out += 16;
+		done += 10;
+	}
+
+	return done;
+}
+
+__attribute__((target("ssse3")))
+static size_t dec_ssse3(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	const __m128i shuf = _mm_setr_epi8(4, 3, 2, 1, 0, 12, 11, 10, 9, 8,
+	                                   -1, -1, -1, -1, -1, -1);
+	size_t done = 0;
+
+	// 16 characters are decoded into 10 bytes.
+	while (in_len - done >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + done));
+		__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+		                              _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		__m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+		                              _mm_cmplt_epi8(lower, _mm_set1_epi8('v' + 1)));
+		if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xFFFF) {
+			break;
+		}
+		v = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+		                 _mm_andnot_si128(digit, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+		// Merge the 5-bit values into 10, 20, and 40-bit groups.
+		v = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0120));
+		v = _mm_madd_epi16(v, _mm_set1_epi32(0x00010400));
+		v = _mm_or_si128(_mm_slli_epi64(_mm_and_si128(v, _mm_set1_epi64x(0xFFFFFFFF)), 20),
+		                 _mm_srli_epi64(v, 32));
+		v = _mm_shuffle_epi8(v, shuf);
+		uint16_t tail = _mm_extract_epi16(v, 4);
+		_mm_storel_epi64((__m128i *)out, v);
+		memcpy(out + 8, &tail, sizeof(tail));
+		out += 10;
+		done += 16;
+	}
+
+	return done;
+}
+
+static void blocks_select(blocks_f *enc, blocks_f *dec)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3")) {
+		*enc = enc_ssse3;
+		*dec = dec_ssse3;
+	}
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON) && \
+      __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+
+#define HAVE_BLOCKS
+
+static const uint8_t enc_shuf[16] = { 1, 0, 1, 0, 2, 1, 2, 1, 3, 2, 4, 3, 4, 3, 5, 4 };
+static const int16_t enc_shift[8] = { -11, -6, -9, -4, -7, -10, -5, -8 };
+static const uint8_t dec_shuf[16] = { 4, 3, 2, 1, 0, 12, 11, 10, 9, 8,
+                                      255, 255, 255, 255, 255, 255 };
+
+static size_t enc_neon(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	const uint8x16_t shuf0 = vld1q_u8(enc_shuf);
+	const uint8x16_t shuf1 = vaddq_u8(shuf0, vdupq_n_u8(5));
+	const int16x8_t shift = vld1q_s16(enc_shift);
+	const uint16x8_t mask_1f = vdupq_n_u16(0x1F);
+	size_t done = 0;
+
+	// 10 bytes are encoded into 16 characters.
+	while (in_len - done >= 10) {
+		uint16_t tail;
+		memcpy(&tail, in + done + 8, sizeof(tail));
+		uint8x16_t v = vcombine_u8(vld1_u8(in + done),
+		                           vreinterpret_u8_u16(vdup_n_u16(tail)));
+		uint16x8_t w0 = vreinterpretq_u16_u8(vqtbl1q_u8(v, shuf0));
+		uint16x8_t w1 = vreinterpretq_u16_u8(vqtbl1q_u8(v, shuf1));
+		w0 = vandq_u16(vshlq_u16(w0, shift), mask_1f);
+		w1 = vandq_u16(vshlq_u16(w1, shift), mask_1f);
+		v = vcombine_u8(vmovn_u16(w0), vmovn_u16(w1));
+		// Translate 5-bit values into the alphabet.
+		uint8x16_t alpha = vandq_u8(vcgtq_u8(v, vdupq_n_u8(9)), vdupq_n_u8(39));
+		v = vaddq_u8(vaddq_u8(v, vdupq_n_u8('0')), alpha);
+		vst1q_u8(out, v);
+		out += 16;
+		done += 10;
+	}
+
+	return done;
+}
+
+static size_t dec_neon(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	const uint8x16_t shuf = vld1q_u8(dec_shuf);
+	size_t done = 0;
+
+	// 16 characters are decoded into 10 bytes.
+	while (in_len - done >= 16) {
+		uint8x16_t v = vld1q_u8(in + done);
+		uint8x16_t lower = vorrq_u8(v, vdupq_n_u8(0x20));
+		uint8x16_t digit = vcleq_u8(vsubq_u8(v, vdupq_n_u8('0')), vdupq_n_u8(9));
+		uint8x16_t alpha = vcleq_u8(vsubq_u8(lower, vdupq_n_u8('a')), vdupq_n_u8('v' - 'a'));
+		if (vminvq_u8(vorrq_u8(digit, alpha)) == 0) {
+			break;
+		}
+		v = vbslq_u8(digit, vsubq_u8(v, vdupq_n_u8('0')),
+		             vsubq_u8(lower, vdupq_n_u8('a' - 10)));
+		// Merge the 5-bit values into 10, 20, and 40-bit groups.
+		uint16x8_t w = vreinterpretq_u16_u8(v);
+		w = vorrq_u16(vshlq_n_u16(vandq_u16(w, vdupq_n_u16(0xFF)), 5), vshrq_n_u16(w, 8));
+		uint32x4_t d = vreinterpretq_u32_u16(w);
+		d = vorrq_u32(vshlq_n_u32(vandq_u32(d, vdupq_n_u32(0xFFFF)), 10), vshrq_n_u32(d, 16));
+		uint64x2_t q = vreinterpretq_u64_u32(d);
+		q = vorrq_u64(vshlq_n_u64(vandq_u64(q, vdupq_n_u64(0xFFFFFFFF)), 20), vshrq_n_u64(q, 32));
+		v = vqtbl1q_u8(vreinterpretq_u8_u64(q), shuf);
+		vst1_u8(out, vget_low_u8(v));
+		vst1q_lane_u16((uint16_t *)(out + 8), vreinterpretq_u16_u8(v), 4);
+		out += 10;
+		done += 16;
+	}
+
+	return done;
+}
+
+static void blocks_select(blocks_f *enc, blocks_f *dec)
+{
+	*enc = enc_neon;
+	*dec = dec_neon;
+}
+#endif
+
+#ifdef HAVE_BLOCKS
+static size_t no_blocks(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	return 0;
+}
+
+static size_t enc_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out);
+static size_t dec_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out);
+
+static blocks_f enc_blocks = enc_blocks_init;
+static blocks_f dec_blocks = dec_blocks_init;
+
+static void blocks_init(void)
+{
+	blocks_f enc = no_blocks, dec = no_blocks;
+	blocks_select(&enc, &dec);
+	__atomic_store_n(&enc_blocks, enc, __ATOMIC_RELAXED);
+	__atomic_store_n(&dec_blocks, dec, __ATOMIC_RELAXED);
+}
+
+static size_t enc_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	blocks_init();
+	return enc_blocks(in, in_len, out);
+}
+
+static size_t dec_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out)
+{
+	blocks_init();
+	return dec_blocks(in, in_len, out);
+}
+#endif
+
 int32_t knot_base32hex_encode(const uint8_t  *in,
                               const uint32_t in_len,
                               uint8_t        *out,
@@ -97,6 +303,13 @@ int32_t knot_base32hex_encode(const uint8_t  *in,
 	const uint8_t	*stop = in + in_len - rest_len;
 	uint8_t		*text = out;
 
+#ifdef HAVE_BLOCKS
+	blocks_f blocks = __atomic_load_n(&enc_blocks, __ATOMIC_RELAXED);
+	size_t done = blocks(in, stop - in, text);
+	in += done;
+	text += (done / 5) * 8;
+#endif
+
 	// Encoding loop takes 5 bytes and creates 8 characters.
 	while (in < stop) {
 		text[0] = base32hex_enc[in[0] >> 3];
@@ -214,6 +427,13 @@ int32_t knot_base32hex_decode(const uint8_t  *in,
 	uint8_t		pad_len = 0;
 	uint8_t		c1, c2, c3, c4, c5, c6, c7, c8;
 
+#ifdef HAVE_BLOCKS
+	blocks_f blocks = __atomic_load_n(&dec_blocks, __ATOMIC_RELAXED);
+	size_t done = blocks(in, in_len, bin);
+	in += done;
+	bin += (done / 8) * 5;
+#endif
+
 	// Decoding loop takes 8 characters and creates 5 bytes.
 	while (in < stop) {
 		// Filling and transforming 8 Base32hex chars.
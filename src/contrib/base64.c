@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
 
 /*! \brief Maximal length of binary input to Base64 encoding. */
 #define MAX_BIN_DATA_LEN	((INT32_MAX / 4) * 3)
@@ -81,6 +82,291 @@ static const uint8_t base64_dec[256] = {
 	[ 42] = KO, ['U'] = 20, [128] = KO, [171] = KO, [214] = KO,
 };
 
+/*
+ * Vectorized loops over the complete blocks in the middle of the data.
+ * Each returns the length of the input it processed, the rest including
+ * any invalid or padding characters is left to the scalar code so that
+ * the results and errors are exactly the same.
+ */
+typedef size_t (*blocks_f)(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define HAVE_BLOCKS
+
+#define ENC_SHUF	10, 11,  9, 10,  7,  8,  6,  7,  4,  5,  3,  4,  1,  2,  0,  1
+#define ENC_LUT		 0,  0,-16,-19, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, 71, 65
+#define DEC_LUT_LO	0x1A, 0x1B, 0x1B, 0x1B, 0x1A, 0x13, 0x11, 0x11, \
+			0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x15
+#define DEC_LUT_HI	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, \
+			0x08, 0x04, 0x08, 0x04, 0x02, 0x01, 0x10, 0x10
+#define DEC_LUT_ROLL	  0,   0,   0,   0,   0,   0,   0,   0, \
+			-71, -71, -65, -65,   4,  19,  16,   0
+#define DEC_SHUF	 -1, -1, -1, -1, 12, 13, 14,  8,  9, 10,  4,  5,  6,  0,  1,  2
+
+// Inlined into the AVX2 variants so that the tail isn't processed by legacy
+// SSE code with dirty upper halves of the registers (expensive transition).
+__attribute__((target("ssse3"), always_inline))
+static inline size_t enc_ssse3(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	const __m128i shuf = _mm_set_epi8(ENC_SHUF);
+	const __m128i lut = _mm_set_epi8(ENC_LUT);
+	size_t done = 0;
+
+	// 16 bytes are loaded, 12 of them are encoded into 16 characters.
+	while (in_len - done >= 16) {
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(in + done)), shuf);
+		__m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0FC0FC00)),
+		                             _mm_set1_epi32(0x04000040));
+		__m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003F03F0)),
+		                             _mm_set1_epi32(0x01000010));
+		v = _mm_or_si128(t0, t1);
+		// Translate 6-bit values into the alphabet.
+		__m128i idx = _mm_subs_epu8(v, _mm_set1_epi8(51));
+		idx = _mm_sub_epi8(idx, _mm_cmpgt_epi8(v, _mm_set1_epi8(25)));
+		v = _mm_add_epi8(v, _mm_shuffle_epi8(lut, idx));
+		_mm_storeu_si128((__m128i *)out, v);
+		out += 16;
+		done += 12;
+	}
+
+	return done;
+}
+
+__attribute__((target("avx2")))
+static size_t enc_avx2(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	const __m256i shuf = _mm256_set_epi8(ENC_SHUF, ENC_SHUF);
+	const __m256i lut = _mm256_set_epi8(ENC_LUT, ENC_LUT);
+	size_t done = 0;
+
+	// Each lane encodes 12 of the 16 bytes loaded into it.
+	while (in_len - done >= 28) {
+		__m256i v = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + done))),
+			_mm_loadu_si128((const __m128i *)(in + done + 12)), 1);
+		v = _mm256_shuffle_epi8(v, shuf);
+		__m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0FC0FC00)),
+		                                _mm256_set1_epi32(0x04000040));
+		__m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003F03F0)),
+		                                _mm256_set1_epi32(0x01000010));
+		v = _mm256_or_si256(t0, t1);
+		__m256i idx = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+		idx = _mm256_sub_epi8(idx, _mm256_cmpgt_epi8(v, _mm256_set1_epi8(25)));
+		v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut, idx));
+		_mm256_storeu_si256((__m256i *)out, v);
+		out += 32;
+		done += 24;
+	}
+
+	return done + enc_ssse3(in + done, in_len - done, out, out_len);
+}
+
+__attribute__((target("ssse3"), always_inline))
+static inline size_t dec_ssse3(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	const __m128i lut_lo = _mm_set_epi8(DEC_LUT_LO);
+	const __m128i lut_hi = _mm_set_epi8(DEC_LUT_HI);
+	const __m128i lut_roll = _mm_set_epi8(DEC_LUT_ROLL);
+	const __m128i mask_2f = _mm_set1_epi8(0x2F);
+	const __m128i shuf = _mm_set_epi8(DEC_SHUF);
+	size_t done = 0;
+
+	// 16 characters are decoded into 12 bytes, 16 bytes are stored.
+	while (in_len - done >= 16 && out_len >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(in + done));
+		__m128i hi_nib = _mm_and_si128(_mm_srli_epi32(v, 4), mask_2f);
+		__m128i lo_nib = _mm_and_si128(v, mask_2f);
+		__m128i bad = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo_nib),
+		                            _mm_shuffle_epi8(lut_hi, hi_nib));
+		if (_mm_movemask_epi8(_mm_cmpgt_epi8(bad, _mm_setzero_si128())) != 0) {
+			break;
+		}
+		__m128i eq_2f = _mm_cmpeq_epi8(v, mask_2f);
+		v = _mm_add_epi8(v, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nib)));
+		// Merge 6-bit values into 24-bit groups.
+		v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+		v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+		_mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(v, shuf));
+		out += 12;
+		out_len -= 12;
+		done += 16;
+	}
+
+	return done;
+}
+
+__attribute__((target("avx2")))
+static size_t dec_avx2(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	const __m256i lut_lo = _mm256_set_epi8(DEC_LUT_LO, DEC_LUT_LO);
+	const __m256i lut_hi = _mm256_set_epi8(DEC_LUT_HI, DEC_LUT_HI);
+	const __m256i lut_roll = _mm256_set_epi8(DEC_LUT_ROLL, DEC_LUT_ROLL);
+	const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+	const __m256i shuf = _mm256_set_epi8(DEC_SHUF, DEC_SHUF);
+	const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+	size_t done = 0;
+
+	while (in_len - done >= 32 && out_len >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(in + done));
+		__m256i hi_nib = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_2f);
+		__m256i lo_nib = _mm256_and_si256(v, mask_2f);
+		__m256i bad = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo_nib),
+		                               _mm256_shuffle_epi8(lut_hi, hi_nib));
+		if (!_mm256_testz_si256(bad, bad)) {
+			break;
+		}
+		__m256i eq_2f = _mm256_cmpeq_epi8(v, mask_2f);
+		v = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nib)));
+		v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+		v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+		// Join the 12-byte results of the lanes.
+		v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuf), perm);
+		_mm256_storeu_si256((__m256i *)out, v);
+		out += 24;
+		out_len -= 24;
+		done += 32;
+	}
+
+	return done + dec_ssse3(in + done, in_len - done, out, out_len);
+}
+
+static void blocks_select(blocks_f *enc, blocks_f *dec)
+{
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		*enc = enc_avx2;
+		*dec = dec_avx2;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		*enc = enc_ssse3;
+		*dec = dec_ssse3;
+	}
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+
+#define HAVE_BLOCKS
+
+static const uint8_t dec_lut_lo[16] = {
+	0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+};
+static const uint8_t dec_lut_hi[16] = {
+	0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+};
+static const int8_t dec_lut_roll[16] = {
+	0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static size_t enc_neon(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	const uint8x16x4_t lut = { {
+		vld1q_u8(base64_enc), vld1q_u8(base64_enc + 16),
+		vld1q_u8(base64_enc + 32), vld1q_u8(base64_enc + 48)
+	} };
+	const uint8x16_t mask_3f = vdupq_n_u8(0x3F);
+	size_t done = 0;
+
+	// 48 bytes are deinterleaved and encoded into 64 characters.
+	while (in_len - done >= 48) {
+		uint8x16x3_t s = vld3q_u8(in + done);
+		uint8x16x4_t t;
+		t.val[0] = vshrq_n_u8(s.val[0], 2);
+		t.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(s.val[0], 4), vshrq_n_u8(s.val[1], 4)), mask_3f);
+		t.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(s.val[1], 2), vshrq_n_u8(s.val[2], 6)), mask_3f);
+		t.val[3] = vandq_u8(s.val[2], mask_3f);
+		for (int i = 0; i < 4; i++) {
+			t.val[i] = vqtbl4q_u8(lut, t.val[i]);
+		}
+		vst4q_u8(out, t);
+		out += 64;
+		done += 48;
+	}
+
+	return done;
+}
+
+static inline uint8x16_t dec_translate(uint8x16_t v, uint8x16_t *bad)
+{
+	uint8x16_t hi_nib = vshrq_n_u8(v, 4);
+	uint8x16_t lo_nib = vandq_u8(v, vdupq_n_u8(0x0F));
+	*bad = vorrq_u8(*bad, vandq_u8(vqtbl1q_u8(vld1q_u8(dec_lut_lo), lo_nib),
+	                               vqtbl1q_u8(vld1q_u8(dec_lut_hi), hi_nib)));
+	uint8x16_t eq_2f = vceqq_u8(v, vdupq_n_u8(0x2F));
+	uint8x16_t roll = vqtbl1q_u8(vreinterpretq_u8_s8(vld1q_s8(dec_lut_roll)),
+	                             vaddq_u8(eq_2f, hi_nib));
+	return vaddq_u8(v, roll);
+}
+
+static size_t dec_neon(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	size_t done = 0;
+
+	// 64 characters are deinterleaved and decoded into 48 bytes.
+	while (in_len - done >= 64) {
+		uint8x16x4_t s = vld4q_u8(in + done);
+		uint8x16_t bad = vdupq_n_u8(0);
+		for (int i = 0; i < 4; i++) {
+			s.val[i] = dec_translate(s.val[i], &bad);
+		}
+		if (vmaxvq_u8(bad) != 0) {
+			break;
+		}
+		uint8x16x3_t t;
+		t.val[0] = vorrq_u8(vshlq_n_u8(s.val[0], 2), vshrq_n_u8(s.val[1], 4));
+		t.val[1] = vorrq_u8(vshlq_n_u8(s.val[1], 4), vshrq_n_u8(s.val[2], 2));
+		t.val[2] = vorrq_u8(vshlq_n_u8(s.val[2], 6), s.val[3]);
+		vst3q_u8(out, t);
+		out += 48;
+		done += 64;
+	}
+
+	return done;
+}
+
+static void blocks_select(blocks_f *enc, blocks_f *dec)
+{
+	*enc = enc_neon;
+	*dec = dec_neon;
+}
+#endif
+
+#ifdef HAVE_BLOCKS
+static size_t no_blocks(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	return 0;
+}
+
+static size_t enc_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len);
+static size_t dec_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len);
+
+static blocks_f enc_blocks = enc_blocks_init;
+static blocks_f dec_blocks = dec_blocks_init;
+
+static void blocks_init(void)
+{
+	blocks_f enc = no_blocks, dec = no_blocks;
+	blocks_select(&enc, &dec);
+	__atomic_store_n(&enc_blocks, enc, __ATOMIC_RELAXED);
+	__atomic_store_n(&dec_blocks, dec, __ATOMIC_RELAXED);
+}
+
+static size_t enc_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	blocks_init();
+	return enc_blocks(in, in_len, out, out_len);
+}
+
+static size_t dec_blocks_init(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_len)
+{
+	blocks_init();
+	return dec_blocks(in, in_len, out, out_len);
+}
+#endif
+
 int32_t knot_base64_encode(const uint8_t  *in,
                            const uint32_t in_len,
                            uint8_t        *out,
@@ -98,6 +384,13 @@ int32_t knot_base64_encode(const uint8_t  *in,
 	const uint8_t	*stop = in + in_len - rest_len;
 	uint8_t		*text = out;
 
+#ifdef HAVE_BLOCKS
+	blocks_f blocks = __atomic_load_n(&enc_blocks, __ATOMIC_RELAXED);
+	size_t done = blocks(in, stop - in, text, out_len);
+	in += done;
+	text += (done / 3) * 4;
+#endif
+
 	// Encoding loop takes 3 bytes and creates 4 characters.
 	while (in < stop) {
 		text[0] = base64_enc[in[0] >> 2];
@@ -181,6 +474,13 @@ int32_t knot_base64_decode(const uint8_t  *in,
 	uint8_t		pad_len = 0;
 	uint8_t		c1, c2, c3, c4;
 
+#ifdef HAVE_BLOCKS
+	blocks_f blocks = __atomic_load_n(&dec_blocks, __ATOMIC_RELAXED);
+	size_t done = blocks(in, in_len, bin, out_len);
+	in += done;
+	bin += (done / 4) * 3;
+#endif
+
 	// Decoding loop takes 4 characters and creates 3 bytes.
 	while (in < stop) {
 		// Filling and transforming 4 Base64 chars.
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/bufpool.h"
+
+static const size_t class_size[BP_CLASSES] = { 512, 4096, BP_MAX_SIZE };
+
+static int size_class(size_t size)
+{
+	for (int i = 0; i < BP_CLASSES; i++) {
+		if (size <= class_size[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+size_t buf_pool_size(size_t size)
+{
+	int cls = size_class(size);
+	return (cls < 0) ? 0 : class_size[cls];
+}
+
+void buf_pool_init(buf_pool_t *pool, unsigned max_free)
+{
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->mx, NULL);
+	pool->max_free = max_free;
+}
+
+void buf_pool_deinit(buf_pool_t *pool)
+{
+	for (int i = 0; i < BP_CLASSES; i++) {
+		void *buf = pool->free[i];
+		while (buf != NULL) {
+			void *next = *(void **)buf;
+			free(buf);
+			buf = next;
+		}
+		pool->free[i] = NULL;
+		pool->count[i] = 0;
+	}
+	pthread_mutex_destroy(&pool->mx);
+}
+
+void *buf_pool_get(buf_pool_t *pool, size_t size)
+{
+	int cls = size_class(size);
+	if (cls < 0) {
+		return NULL;
+	}
+
+	void *buf = NULL;
+	if (pool != NULL) {
+		pthread_mutex_lock(&pool->mx);
+		buf = pool->free[cls];
+		if (buf != NULL) {
+			pool->free[cls] = *(void **)buf;
+			pool->count[cls]--;
+		}
+		pthread_mutex_unlock(&pool->mx);
+	}
+
+	return (buf != NULL) ? buf : malloc(class_size[cls]);
+}
+
+void buf_pool_put(buf_pool_t *pool, void *buf, size_t size)
+{
+	if (buf == NULL) {
+		return;
+	}
+
+	int cls = size_class(size);
+	if (pool != NULL && cls >= 0) {
+		pthread_mutex_lock(&pool->mx);
+		if (pool->count[cls] < pool->max_free) {
+			*(void **)buf = pool->free[cls];
+			pool->free[cls] = buf;
+			pool->count[cls]++;
+			buf = NULL;
+		}
+		pthread_mutex_unlock(&pool->mx);
+	}
+
+	free(buf);
+}
@@ -0,0 +1,80 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Shared pool of size-classed I/O buffers.
+ *
+ * Buffers are handed out in a few size classes so that a small message
+ * doesn't occupy a maximal buffer. Returned buffers are kept for reuse up
+ * to a limit per class, the rest is freed, so the memory follows the number
+ * of buffers in use rather than the highest number ever used. The pool is
+ * thread-safe.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#define BP_CLASSES	3
+#define BP_MAX_SIZE	65536
+
+typedef struct {
+	pthread_mutex_t mx;
+	void *free[BP_CLASSES];      /*!< Free lists of the size classes. */
+	unsigned count[BP_CLASSES];  /*!< Lengths of the free lists. */
+	unsigned max_free;           /*!< Limit of the free list length. */
+} buf_pool_t;
+
+/*!
+ * \brief Returns the buffer size of the class the size fits in.
+ *
+ * \return Buffer size, 0 if bigger than BP_MAX_SIZE.
+ */
+size_t buf_pool_size(size_t size);
+
+/*!
+ * \brief Initializes an empty pool.
+ *
+ * \param pool      Pool to initialize.
+ * \param max_free  Number of returned buffers kept per class.
+ */
+void buf_pool_init(buf_pool_t *pool, unsigned max_free);
+
+/*!
+ * \brief Frees the kept buffers, the ones in use must be returned before.
+ */
+void buf_pool_deinit(buf_pool_t *pool);
+
+/*!
+ * \brief Gets a buffer of at least 'size' bytes.
+ *
+ * \param pool  Pool (NULL for plain allocation).
+ * \param size  Requested size (up to BP_MAX_SIZE).
+ *
+ * \return Buffer of buf_pool_size(size) bytes, NULL on error.
+ */
+void *buf_pool_get(buf_pool_t *pool, size_t size);
+
+/*!
+ * \brief Returns a buffer to the pool (no-op for NULL).
+ *
+ * \param pool  Pool the buffer was taken from.
+ * \param buf   Buffer.
+ * \param size  Size requested when getting the buffer.
+ */
+void buf_pool_put(buf_pool_t *pool, void *buf, size_t size);
@@ -14,9 +14,14 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
+#include <netinet/in.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "contrib/dnstap/convert.h"
 #include "contrib/dnstap/dnstap.h"
 #include "contrib/dnstap/dnstap.pb-c.h"
 
@@ -39,3 +44,177 @@ uint8_t* dt_pack(const Dnstap__Dnstap *d, uint8_t **buf, size_t *sz)
 	*buf = sbuf.data;
 	return *buf;
 }
+
+/* Protocol Buffers wire types. */
+#define PB_VARINT       0
+#define PB_BYTES        2
+#define PB_FIXED32      5
+
+/*!
+ * \brief Output cursor, only the length is counted if no buffer.
+ */
+typedef struct {
+	uint8_t *out;
+	size_t len;
+} pb_writer_t;
+
+static size_t pb_varint_size(uint64_t value)
+{
+	size_t size = 1;
+	while (value >= 0x80) {
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+static void pb_raw(pb_writer_t *w, const void *data, size_t len)
+{
+	if (w->out != NULL) {
+		memcpy(w->out + w->len, data, len);
+	}
+	w->len += len;
+}
+
+static void pb_varint(pb_writer_t *w, uint64_t value)
+{
+	uint8_t buf[10];
+	size_t len = 0;
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buf[len++] = value;
+	pb_raw(w, buf, len);
+}
+
+static void pb_tag(pb_writer_t *w, unsigned field, unsigned type)
+{
+	pb_varint(w, (field << 3) | type);
+}
+
+static void pb_uint(pb_writer_t *w, unsigned field, uint64_t value)
+{
+	pb_tag(w, field, PB_VARINT);
+	pb_varint(w, value);
+}
+
+static void pb_fixed32(pb_writer_t *w, unsigned field, uint32_t value)
+{
+	uint8_t buf[] = { value, value >> 8, value >> 16, value >> 24 };
+	pb_tag(w, field, PB_FIXED32);
+	pb_raw(w, buf, sizeof(buf));
+}
+
+static void pb_bytes(pb_writer_t *w, unsigned field, const void *data, size_t len)
+{
+	pb_tag(w, field, PB_BYTES);
+	pb_varint(w, len);
+	pb_raw(w, data, len);
+}
+
+static void pb_address(pb_writer_t *w, unsigned field, const struct sockaddr *sa,
+                       uint32_t *port)
+{
+	if (sa->sa_family == AF_INET) {
+		const struct sockaddr_in *sai = (const struct sockaddr_in *)sa;
+		pb_bytes(w, field, &sai->sin_addr.s_addr, sizeof(sai->sin_addr));
+		*port = ntohs(sai->sin_port);
+	} else if (sa->sa_family == AF_INET6) {
+		const struct sockaddr_in6 *sai6 = (const struct sockaddr_in6 *)sa;
+		pb_bytes(w, field, &sai6->sin6_addr.s6_addr, sizeof(sai6->sin6_addr));
+		*port = ntohs(sai6->sin6_port);
+	} else {
+		pb_bytes(w, field, NULL, 0);
+		*port = 0;
+	}
+}
+
+/*! \brief Writes the Message fields in the field number order, as protobuf-c does. */
+static void encode_message(pb_writer_t *w, const dt_msg_t *msg)
+{
+	bool query = dt_message_type_is_query(msg->type);
+	bool response = dt_message_type_is_response(msg->type);
+
+	pb_uint(w, 1, msg->type);
+
+	const struct sockaddr *source = msg->query_sa ? msg->query_sa : msg->response_sa;
+	int family = (source != NULL) ? dt_family_encode(source->sa_family) : 0;
+	if (family != 0) {
+		pb_uint(w, 2, family);
+	}
+	int protocol = dt_protocol_encode(msg->protocol);
+	if (protocol != 0) {
+		pb_uint(w, 3, protocol);
+	}
+
+	uint32_t query_port = 0, response_port = 0;
+	if (msg->query_sa != NULL) {
+		pb_address(w, 4, msg->query_sa, &query_port);
+	}
+	if (msg->response_sa != NULL) {
+		pb_address(w, 5, msg->response_sa, &response_port);
+	}
+	if (msg->query_sa != NULL) {
+		pb_uint(w, 6, query_port);
+	}
+	if (msg->response_sa != NULL) {
+		pb_uint(w, 7, response_port);
+	}
+
+	if (query && msg->mtime != NULL) {
+		pb_uint(w, 8, msg->mtime->tv_sec);
+		pb_fixed32(w, 9, msg->mtime->tv_nsec);
+	}
+	if (msg->query_wire != NULL && (query || response)) {
+		pb_bytes(w, 10, msg->query_wire, msg->query_len);
+	}
+	if (response && msg->mtime != NULL) {
+		pb_uint(w, 12, msg->mtime->tv_sec);
+		pb_fixed32(w, 13, msg->mtime->tv_nsec);
+	}
+	if (response && msg->response_wire != NULL) {
+		pb_bytes(w, 14, msg->response_wire, msg->response_len);
+	}
+}
+
+size_t dt_encode(const dt_msg_t *msg, uint8_t *buf, size_t size)
+{
+	if (msg == NULL) {
+		return 0;
+	}
+
+	pb_writer_t sizer = { .out = NULL };
+	encode_message(&sizer, msg);
+	size_t msg_len = sizer.len;
+
+	size_t total = 0;
+	if (msg->identity_len > 0) {
+		total += 1 + pb_varint_size(msg->identity_len) + msg->identity_len;
+	}
+	if (msg->version_len > 0) {
+		total += 1 + pb_varint_size(msg->version_len) + msg->version_len;
+	}
+	total += 1 + pb_varint_size(msg_len) + msg_len; // Dnstap.message
+	total += 2;                                       // Dnstap.type
+	if (buf == NULL) {
+		return total;
+	} else if (total > size) {
+		return 0;
+	}
+
+	pb_writer_t w = { .out = buf };
+	if (msg->identity_len > 0) {
+		pb_bytes(&w, 1, msg->identity, msg->identity_len);
+	}
+	if (msg->version_len > 0) {
+		pb_bytes(&w, 2, msg->version, msg->version_len);
+	}
+	pb_tag(&w, 14, PB_BYTES);
+	pb_varint(&w, msg_len);
+	encode_message(&w, msg);
+	pb_uint(&w, 15, DNSTAP__DNSTAP__TYPE__MESSAGE);
+	assert(w.len == total);
+
+	return w.len;
+}
@@ -24,6 +24,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/socket.h>
+#include <time.h>
 
 #include "contrib/dnstap/dnstap.pb-c.h"
 
@@ -45,3 +47,37 @@
  * \retval NULL         if error.
  */
 uint8_t* dt_pack(const Dnstap__Dnstap *d, uint8_t **buf, size_t *sz);
+
+/*!
+ * \brief Dnstap message to be encoded without the protobuf-c structures.
+ */
+typedef struct {
+	const uint8_t *identity;
+	size_t identity_len;
+	const uint8_t *version;
+	size_t version_len;
+	Dnstap__Message__Type type;
+	const struct sockaddr *query_sa;
+	const struct sockaddr *response_sa;
+	int protocol;
+	const uint8_t *query_wire;       //!< Query message (optional for responses).
+	size_t query_len;
+	const uint8_t *response_wire;    //!< Response message (responses only).
+	size_t response_len;
+	const struct timespec *mtime;    //!< Query or response time (optional).
+} dt_msg_t;
+
+/*!
+ * \brief Serializes a dnstap message directly into the given buffer.
+ *
+ * The output is equal to dt_pack() of the corresponding protobuf struct
+ * filled by dt_message_fill(), but no allocation is done.
+ *
+ * \param msg     Message to be serialized.
+ * \param buf     Output buffer (NULL to compute the frame size only).
+ * \param size    Size of the output buffer.
+ *
+ * \return        Size of the serialized frame.
+ * \retval 0      if the buffer is too small.
+ */
+size_t dt_encode(const dt_msg_t *msg, uint8_t *buf, size_t size);
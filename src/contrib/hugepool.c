@@ -0,0 +1,338 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#include "contrib/hugepool.h"
+#include "libknot/errcode.h"
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+#define HP_MAP_HUGETLB (MAP_HUGETLB | (21 << MAP_HUGE_SHIFT))
+#elif defined(MAP_HUGETLB)
+#define HP_MAP_HUGETLB MAP_HUGETLB
+#endif
+
+struct hp_chunk {
+	hp_pool_t *pool;
+	hp_chunk_t *next;
+	size_t size;            // Length of the mapping.
+	size_t offset;          // Offset in the backing file.
+	unsigned runs;          // Number of runs already assigned to a class.
+	bool large;             // The chunk holds one big block.
+	bool hugetlb;           // Backed by reserved huge pages.
+	uint8_t cls[HP_RUNS];   // Size class of each run.
+};
+
+#define HDR_SIZE	((sizeof(hp_chunk_t) + HP_ALIGN - 1) & ~(size_t)(HP_ALIGN - 1))
+#define CHUNK_OF(ptr)	((hp_chunk_t *)((uintptr_t)(ptr) & ~(uintptr_t)(HP_CHUNK_SIZE - 1)))
+
+static void interleave(void *mem, size_t len)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	// The kernel restricts the mask to the nodes with memory.
+	unsigned long nodes = ~0UL;
+	(void)syscall(SYS_mbind, mem, len, MPOL_INTERLEAVE, &nodes, 8 * sizeof(nodes), 0);
+#endif
+}
+
+static hp_chunk_t *map_chunk(hp_pool_t *pool, size_t len)
+{
+	uint8_t *mem = MAP_FAILED;
+	bool hugetlb = false;
+
+#ifdef HP_MAP_HUGETLB
+	if (!pool->no_hugetlb && !pool->cold) {
+		mem = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		           MAP_PRIVATE | MAP_ANONYMOUS | HP_MAP_HUGETLB, -1, 0);
+		if (mem == MAP_FAILED) {
+			pool->no_hugetlb = true; // Don't try again.
+		} else {
+			hugetlb = true;
+		}
+	}
+#endif
+	if (mem == MAP_FAILED) {
+		// Over-allocate to get the alignment transparent huge pages need.
+		size_t raw_len = len + HP_CHUNK_SIZE;
+		uint8_t *raw = mmap(NULL, raw_len, PROT_READ | PROT_WRITE,
+		                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (raw == MAP_FAILED) {
+			return NULL;
+		}
+		mem = (uint8_t *)CHUNK_OF(raw + HP_CHUNK_SIZE - 1);
+		if (mem > raw) {
+			(void)munmap(raw, mem - raw);
+		}
+		size_t tail = (raw + raw_len) - (mem + len);
+		if (tail > 0) {
+			(void)munmap(mem + len, tail);
+		}
+		if (pool->cold && pool->fd >= 0) {
+			// Replace the aligned reservation with the file mapping.
+			if (ftruncate(pool->fd, pool->file_size + len) != 0 ||
+			    mmap(mem, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+			         pool->fd, pool->file_size) == MAP_FAILED) {
+				(void)munmap(mem, len);
+				return NULL;
+			}
+		} else if (pool->cold) {
+#ifdef MADV_NOHUGEPAGE
+			(void)madvise(mem, len, MADV_NOHUGEPAGE);
+#endif
+		} else {
+#ifdef MADV_HUGEPAGE
+			(void)madvise(mem, len, MADV_HUGEPAGE);
+#endif
+		}
+	}
+
+	// Must precede the first touch of the memory.
+	if (pool->policy == HP_POLICY_INTERLEAVE) {
+		interleave(mem, len);
+	}
+
+	hp_chunk_t *chunk = (hp_chunk_t *)mem;
+	memset(chunk, 0, sizeof(*chunk));
+	chunk->pool = pool;
+	chunk->size = len;
+	chunk->hugetlb = hugetlb;
+	if (pool->cold && pool->fd >= 0) {
+		chunk->offset = pool->file_size;
+		pool->file_size += len;
+	}
+
+	pool->mapped += len;
+	if (hugetlb) {
+		pool->hugetlb += len;
+	}
+
+	return chunk;
+}
+
+static void unmap_chunk(hp_pool_t *pool, hp_chunk_t *chunk)
+{
+	pool->mapped -= chunk->size;
+	if (chunk->hugetlb) {
+		pool->hugetlb -= chunk->size;
+	}
+#ifdef MADV_REMOVE
+	// Release the file space, the offset isn't reused.
+	if (pool->cold && pool->fd >= 0) {
+		(void)madvise(chunk, chunk->size, MADV_REMOVE);
+	}
+#endif
+	(void)munmap(chunk, chunk->size);
+}
+
+static bool new_run(hp_pool_t *pool, unsigned cls)
+{
+	hp_chunk_t *chunk = pool->chunks;
+	if (chunk == NULL || chunk->large || chunk->runs == HP_RUNS) {
+		chunk = map_chunk(pool, HP_CHUNK_SIZE);
+		if (chunk == NULL) {
+			return false;
+		}
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+	}
+
+	unsigned run = chunk->runs++;
+	chunk->cls[run] = cls;
+
+	uint8_t *start = (uint8_t *)chunk + run * HP_RUN_SIZE;
+	uint8_t *end = start + HP_RUN_SIZE;
+	if (run == 0) {
+		start += HDR_SIZE;
+	}
+
+	// Push in reverse order so that the blocks are handed out ascending.
+	size_t block = (cls + 1) * HP_ALIGN;
+	size_t count = (end - start) / block;
+	for (size_t i = count; i > 0; i--) {
+		void **b = (void **)(start + (i - 1) * block);
+		*b = pool->free[cls];
+		pool->free[cls] = b;
+	}
+
+	return true;
+}
+
+static void *alloc_large(hp_pool_t *pool, size_t size)
+{
+	size_t len = (HDR_SIZE + size + HP_CHUNK_SIZE - 1) & ~(size_t)(HP_CHUNK_SIZE - 1);
+
+	pthread_mutex_lock(&pool->mx);
+	hp_chunk_t *chunk = map_chunk(pool, len);
+	if (chunk == NULL) {
+		pthread_mutex_unlock(&pool->mx);
+		return NULL;
+	}
+	chunk->large = true;
+	// Keep the chunk being filled first.
+	if (pool->chunks != NULL) {
+		chunk->next = pool->chunks->next;
+		pool->chunks->next = chunk;
+	} else {
+		pool->chunks = chunk;
+	}
+	pthread_mutex_unlock(&pool->mx);
+
+	return (uint8_t *)chunk + HDR_SIZE;
+}
+
+void hp_pool_init(hp_pool_t *pool, hp_policy_t policy)
+{
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->mx, NULL);
+	pool->policy = policy;
+}
+
+static int open_file(const char *dir)
+{
+	int fd = -1;
+#ifdef O_TMPFILE
+	fd = open(dir, O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+	if (fd >= 0) {
+		return fd;
+	}
+#endif
+	char path[4096];
+	int len = snprintf(path, sizeof(path), "%s/cold.XXXXXX", dir);
+	if (len < 0 || (size_t)len >= sizeof(path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	fd = mkstemp(path);
+	if (fd >= 0) {
+		(void)unlink(path);
+		(void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+	return fd;
+}
+
+int hp_pool_init_cold(hp_pool_t *pool, const char *dir)
+{
+	hp_pool_init(pool, HP_POLICY_LOCAL);
+	pool->cold = 1;
+	pool->fd = -1;
+
+	if (dir != NULL) {
+		pool->fd = open_file(dir);
+		if (pool->fd < 0) {
+			int ret = knot_map_errno();
+			pthread_mutex_destroy(&pool->mx);
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+void hp_pool_deinit(hp_pool_t *pool)
+{
+	hp_chunk_t *chunk = pool->chunks;
+	while (chunk != NULL) {
+		hp_chunk_t *next = chunk->next;
+		unmap_chunk(pool, chunk);
+		chunk = next;
+	}
+	pool->chunks = NULL;
+	memset(pool->free, 0, sizeof(pool->free));
+	if (pool->cold && pool->fd >= 0) {
+		close(pool->fd);
+		pool->fd = -1;
+	}
+	pthread_mutex_destroy(&pool->mx);
+}
+
+void *hp_alloc(hp_pool_t *pool, size_t size)
+{
+	if (size > HP_MAX_BLOCK) {
+		return alloc_large(pool, size);
+	}
+	unsigned cls = (size > 0) ? (size - 1) / HP_ALIGN : 0;
+
+	pthread_mutex_lock(&pool->mx);
+	void **b = pool->free[cls];
+	if (b == NULL && new_run(pool, cls)) {
+		b = pool->free[cls];
+	}
+	if (b != NULL) {
+		pool->free[cls] = *b;
+	}
+	pthread_mutex_unlock(&pool->mx);
+
+	return b;
+}
+
+void hp_free(void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	hp_chunk_t *chunk = CHUNK_OF(ptr);
+	hp_pool_t *pool = chunk->pool;
+
+	pthread_mutex_lock(&pool->mx);
+	if (chunk->large) {
+		hp_chunk_t **it = &pool->chunks;
+		while (*it != chunk) {
+			it = &(*it)->next;
+		}
+		*it = chunk->next;
+		unmap_chunk(pool, chunk);
+	} else {
+		unsigned cls = chunk->cls[((uint8_t *)ptr - (uint8_t *)chunk) / HP_RUN_SIZE];
+		*(void **)ptr = pool->free[cls];
+		pool->free[cls] = ptr;
+	}
+	pthread_mutex_unlock(&pool->mx);
+}
+
+void hp_pool_advise_cold(hp_pool_t *pool)
+{
+#ifdef MADV_COLD
+	pthread_mutex_lock(&pool->mx);
+	for (hp_chunk_t *chunk = pool->chunks; chunk != NULL; chunk = chunk->next) {
+		(void)madvise(chunk, chunk->size, MADV_COLD);
+	}
+	pthread_mutex_unlock(&pool->mx);
+#endif
+}
+
+void mm_ctx_hugepool(knot_mm_t *mm, hp_pool_t *pool)
+{
+	mm->ctx = pool;
+	mm->alloc = (knot_mm_alloc_t)hp_alloc;
+	mm->free = hp_free;
+}
@@ -0,0 +1,110 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Small-block allocator backed by 2 MiB (huge) pages.
+ *
+ * Memory is mapped in 2 MiB aligned chunks, reserved huge pages are used
+ * if available, otherwise transparent huge pages are requested. Each chunk
+ * is divided into runs of blocks of the same size class. Freed blocks are
+ * reused by later allocations of the same class, the chunks are released
+ * only by hp_pool_deinit().
+ *
+ * Unlike the mempool, blocks can be freed individually and the free function
+ * doesn't need the pool, so the pool can back a knot_mm_t of structures
+ * (e.g. qp-trie) that free their memory one by one. The pool is thread-safe.
+ *
+ * A cold pool is meant for rarely accessed data instead. It doesn't use huge
+ * pages, so that the kernel can reclaim its memory page by page, and it can
+ * be backed by a file, so that it can be paged out even without swap.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "libknot/mm_ctx.h"
+
+#define HP_CHUNK_SIZE	(2 * 1024 * 1024)
+#define HP_RUN_SIZE	(64 * 1024)
+#define HP_RUNS		(HP_CHUNK_SIZE / HP_RUN_SIZE)
+#define HP_ALIGN	16
+#define HP_MAX_BLOCK	4096
+#define HP_CLASSES	(HP_MAX_BLOCK / HP_ALIGN)
+
+/*! \brief NUMA placement of the pool memory. */
+typedef enum {
+	HP_POLICY_LOCAL = 0,      /*!< Pages placed on the node of the first toucher. */
+	HP_POLICY_INTERLEAVE = 1, /*!< Pages interleaved over all memory nodes. */
+} hp_policy_t;
+
+typedef struct hp_chunk hp_chunk_t;
+
+typedef struct {
+	pthread_mutex_t mx;
+	hp_policy_t policy;
+	void *free[HP_CLASSES];  /*!< Free lists of the size classes. */
+	hp_chunk_t *chunks;      /*!< Mapped chunks, the one being filled first. */
+	size_t mapped;           /*!< Total size of the mapped chunks. */
+	size_t hugetlb;          /*!< Part of 'mapped' backed by reserved huge pages. */
+	int no_hugetlb;          /*!< Reserved huge pages aren't available. */
+	int cold;                /*!< Cold pool, see hp_pool_init_cold(). */
+	int fd;                  /*!< Backing file of the cold pool, -1 if anonymous. */
+	size_t file_size;        /*!< Used length of the backing file. */
+} hp_pool_t;
+
+/*!
+ * \brief Initializes an empty pool.
+ */
+void hp_pool_init(hp_pool_t *pool, hp_policy_t policy);
+
+/*!
+ * \brief Initializes an empty cold pool.
+ *
+ * \param pool  Pool to initialize.
+ * \param dir   Directory for an unnamed backing file, NULL for anonymous memory.
+ *
+ * \return KNOT_E*
+ */
+int hp_pool_init_cold(hp_pool_t *pool, const char *dir);
+
+/*!
+ * \brief Unmaps all the pool memory, all allocated blocks become invalid.
+ */
+void hp_pool_deinit(hp_pool_t *pool);
+
+/*!
+ * \brief Allocates a block of at least 'size' bytes aligned to HP_ALIGN.
+ *
+ * Blocks bigger than HP_MAX_BLOCK get a chunk of their own.
+ */
+void *hp_alloc(hp_pool_t *pool, size_t size);
+
+/*!
+ * \brief Returns the block to its pool (no-op for NULL).
+ */
+void hp_free(void *ptr);
+
+/*!
+ * \brief Hints the kernel to reclaim the pool memory before other memory.
+ */
+void hp_pool_advise_cold(hp_pool_t *pool);
+
+/*!
+ * \brief Sets up memory context using the pool.
+ */
+void mm_ctx_hugepool(knot_mm_t *mm, hp_pool_t *pool);
@@ -0,0 +1,217 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/ipset.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+#define ADDR_MAX_LEN	16
+
+typedef struct {
+	uint8_t min[ADDR_MAX_LEN];
+	uint8_t max[ADDR_MAX_LEN];
+} ip_range_t;
+
+typedef struct {
+	ip_range_t *ranges;
+	size_t count;
+	size_t avail;
+	size_t addr_len;
+} ip_ranges_t;
+
+struct ipset {
+	ip_ranges_t ipv4;
+	ip_ranges_t ipv6;
+};
+
+static ip_ranges_t *family_ranges(const ipset_t *set, int family)
+{
+	switch (family) {
+	case AF_INET:  return (ip_ranges_t *)&set->ipv4;
+	case AF_INET6: return (ip_ranges_t *)&set->ipv6;
+	default:       return NULL;
+	}
+}
+
+static int ranges_add(ip_ranges_t *ranges, const uint8_t *min, const uint8_t *max)
+{
+	if (ranges->count == ranges->avail) {
+		size_t avail = (ranges->avail == 0) ? 8 : 2 * ranges->avail;
+		ip_range_t *tmp = realloc(ranges->ranges, avail * sizeof(*tmp));
+		if (tmp == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ranges->ranges = tmp;
+		ranges->avail = avail;
+	}
+
+	// The unused bytes are zeroed so that the ranges compare the same in any family.
+	ip_range_t *range = &ranges->ranges[ranges->count++];
+	memset(range, 0, sizeof(*range));
+	memcpy(range->min, min, ranges->addr_len);
+	memcpy(range->max, max, ranges->addr_len);
+
+	return KNOT_EOK;
+}
+
+ipset_t *ipset_new(void)
+{
+	ipset_t *set = calloc(1, sizeof(*set));
+	if (set == NULL) {
+		return NULL;
+	}
+	set->ipv4.addr_len = sizeof(struct in_addr);
+	set->ipv6.addr_len = sizeof(struct in6_addr);
+
+	return set;
+}
+
+int ipset_add_prefix(ipset_t *set, const struct sockaddr_storage *addr, int prefix)
+{
+	if (set == NULL || addr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	ip_ranges_t *ranges = family_ranges(set, addr->ss_family);
+	if (ranges == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(addr, &len);
+	if (prefix < 0 || prefix > (int)(len * 8)) {
+		prefix = len * 8;
+	}
+
+	uint8_t min[ADDR_MAX_LEN], max[ADDR_MAX_LEN];
+	for (size_t i = 0; i < len; i++) {
+		int bits = prefix - (int)i * 8;
+		uint8_t mask = (bits >= 8) ? 0xFF : (bits <= 0) ? 0x00 : (0xFF << (8 - bits));
+		min[i] = raw[i] & mask;
+		max[i] = raw[i] | ~mask;
+	}
+
+	return ranges_add(ranges, min, max);
+}
+
+int ipset_add_range(ipset_t *set, const struct sockaddr_storage *min,
+                    const struct sockaddr_storage *max)
+{
+	if (set == NULL || min == NULL || max == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	ip_ranges_t *ranges = family_ranges(set, min->ss_family);
+	if (ranges == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (min->ss_family != max->ss_family) {
+		return KNOT_EOK; // Never matches.
+	}
+
+	size_t len = 0;
+	const uint8_t *raw_min = sockaddr_raw(min, &len);
+	const uint8_t *raw_max = sockaddr_raw(max, &len);
+	if (memcmp(raw_min, raw_max, len) > 0) {
+		return KNOT_EOK; // Never matches.
+	}
+
+	return ranges_add(ranges, raw_min, raw_max);
+}
+
+static int range_cmp(const void *a, const void *b)
+{
+	const ip_range_t *ra = a, *rb = b;
+	return memcmp(ra->min, rb->min, ADDR_MAX_LEN);
+}
+
+static void ranges_merge(ip_ranges_t *ranges)
+{
+	if (ranges->count == 0) {
+		return;
+	}
+
+	qsort(ranges->ranges, ranges->count, sizeof(ip_range_t), range_cmp);
+
+	// Join the overlapping ranges.
+	size_t len = ranges->addr_len;
+	size_t last = 0;
+	for (size_t i = 1; i < ranges->count; i++) {
+		ip_range_t *cur = &ranges->ranges[last];
+		ip_range_t *next = &ranges->ranges[i];
+		if (memcmp(next->min, cur->max, len) <= 0) {
+			if (memcmp(next->max, cur->max, len) > 0) {
+				memcpy(cur->max, next->max, len);
+			}
+		} else {
+			ranges->ranges[++last] = *next;
+		}
+	}
+	ranges->count = last + 1;
+}
+
+void ipset_finalize(ipset_t *set)
+{
+	if (set == NULL) {
+		return;
+	}
+
+	ranges_merge(&set->ipv4);
+	ranges_merge(&set->ipv6);
+}
+
+bool ipset_match(const ipset_t *set, const struct sockaddr_storage *addr)
+{
+	if (set == NULL || addr == NULL) {
+		return false;
+	}
+
+	const ip_ranges_t *ranges = family_ranges(set, addr->ss_family);
+	if (ranges == NULL || ranges->count == 0) {
+		return false;
+	}
+
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(addr, &len);
+
+	// Find the last range starting at or below the address.
+	size_t l = 0, r = ranges->count;
+	while (l < r) {
+		size_t m = (l + r) / 2;
+		if (memcmp(ranges->ranges[m].min, raw, len) <= 0) {
+			l = m + 1;
+		} else {
+			r = m;
+		}
+	}
+
+	return l > 0 && memcmp(raw, ranges->ranges[l - 1].max, len) <= 0;
+}
+
+void ipset_free(ipset_t *set)
+{
+	if (set == NULL) {
+		return;
+	}
+
+	free(set->ipv4.ranges);
+	free(set->ipv6.ranges);
+	free(set);
+}
@@ -0,0 +1,72 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Immutable set of IP address ranges for fast matching.
+ *
+ * The configured prefixes and ranges are merged into disjoint ranges sorted
+ * per address family, so a lookup is a binary search regardless of the
+ * number of configured items.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+typedef struct ipset ipset_t;
+
+/*!
+ * \brief Create an empty address set.
+ */
+ipset_t *ipset_new(void);
+
+/*!
+ * \brief Add a network prefix to the set.
+ *
+ * \param set     Address set (not finalized).
+ * \param addr    Network address.
+ * \param prefix  Prefix length (negative for the full address length).
+ *
+ * \return KNOT_E*
+ */
+int ipset_add_prefix(ipset_t *set, const struct sockaddr_storage *addr, int prefix);
+
+/*!
+ * \brief Add an address range (inclusive) to the set.
+ *
+ * \note The range is ignored if its bounds differ in the address family or
+ *       the minimum is greater than the maximum.
+ *
+ * \return KNOT_E*
+ */
+int ipset_add_range(ipset_t *set, const struct sockaddr_storage *min,
+                    const struct sockaddr_storage *max);
+
+/*!
+ * \brief Merge the added items, no more items can be added afterwards.
+ */
+void ipset_finalize(ipset_t *set);
+
+/*!
+ * \brief Check if the finalized set contains the address.
+ */
+bool ipset_match(const ipset_t *set, const struct sockaddr_storage *addr);
+
+/*!
+ * \brief Free the set.
+ */
+void ipset_free(ipset_t *set);
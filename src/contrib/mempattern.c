@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "contrib/mempattern.h"
@@ -31,6 +32,39 @@ static void *mm_malloc(void *ctx, size_t n)
 	return malloc(n);
 }
 
+typedef union {
+	struct {
+		mm_account_t *account;
+		size_t size;
+	};
+	max_align_t align;
+} mm_accounted_hdr_t;
+
+static void *mm_accounted_alloc(void *ctx, size_t n)
+{
+	mm_accounted_hdr_t *hdr = malloc(sizeof(*hdr) + n);
+	if (hdr == NULL) {
+		return NULL;
+	}
+	hdr->account = ctx;
+	hdr->size = n;
+	__atomic_add_fetch(&hdr->account->bytes, n, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&hdr->account->blocks, 1, __ATOMIC_RELAXED);
+
+	return hdr + 1;
+}
+
+static void mm_accounted_free(void *p)
+{
+	if (p == NULL) {
+		return;
+	}
+	mm_accounted_hdr_t *hdr = (mm_accounted_hdr_t *)p - 1;
+	__atomic_sub_fetch(&hdr->account->bytes, hdr->size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&hdr->account->blocks, 1, __ATOMIC_RELAXED);
+	free(hdr);
+}
+
 void *mm_alloc(knot_mm_t *mm, size_t size)
 {
 	if (mm) {
@@ -120,3 +154,10 @@ void mm_ctx_mempool(knot_mm_t *mm, size_t chunk_size)
 	mm->alloc = (knot_mm_alloc_t)mp_alloc;
 	mm->free = mm_nofree;
 }
+
+void mm_ctx_accounted(knot_mm_t *mm, mm_account_t *account)
+{
+	mm->ctx = account;
+	mm->alloc = mm_accounted_alloc;
+	mm->free = mm_accounted_free;
+}
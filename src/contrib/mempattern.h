@@ -20,11 +20,19 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include "libknot/mm_ctx.h"
 
 /*! \brief Default memory block size. */
 #define MM_DEFAULT_BLKSIZE 4096
 
+/*! \brief Usage counters of accounted memory contexts. */
+typedef struct {
+	uint64_t bytes;  /*!< Allocated bytes, without the accounting overhead. */
+	uint64_t blocks; /*!< Allocated blocks. */
+} mm_account_t;
+
 /*! \brief Allocs using 'mm' if any, uses system malloc() otherwise. */
 void *mm_alloc(knot_mm_t *mm, size_t size);
 
@@ -45,3 +53,11 @@ void mm_ctx_init(knot_mm_t *mm);
 
 /*! \brief Memory pool context. */
 void mm_ctx_mempool(knot_mm_t *mm, size_t chunk_size);
+
+/*!
+ * \brief System malloc() context counting the allocated memory into 'account'.
+ *
+ * Each block carries a small header, so the blocks can be freed without
+ * the context. The counters may be shared by several contexts and threads.
+ */
+void mm_ctx_accounted(knot_mm_t *mm, mm_account_t *account);
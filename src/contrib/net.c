@@ -22,9 +22,13 @@
 #include <netinet/in.h>
 #include <poll.h>
 #include <stdbool.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
 
 #include "libknot/errcode.h"
 #include "contrib/macros.h"
@@ -32,6 +36,10 @@
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
 
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define ENABLE_ZEROCOPY
+#endif
+
 /*!
  * \brief Enable socket option.
  */
@@ -314,6 +322,18 @@ int net_bound_tfo(int sock, int backlog)
 	return KNOT_ENOTSUP;
 }
 
+int net_bound_defer_accept(int sock, int timeout)
+{
+#if defined(TCP_DEFER_ACCEPT)
+	if (setsockopt(sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, &timeout, sizeof(timeout)) != 0) {
+		return knot_map_errno();
+	}
+
+	return KNOT_EOK;
+#endif
+	return KNOT_ENOTSUP;
+}
+
 bool net_is_connected(int sock)
 {
 	struct sockaddr_storage addr;
@@ -659,6 +679,20 @@ ssize_t net_stream_send(int sock, const uint8_t *buffer, size_t size, int timeou
 	return net_base_send(sock, buffer, size, NULL, timeout_ms);
 }
 
+ssize_t net_stream_sendv(int sock, struct iovec *iov, int iovcnt, int timeout_ms)
+{
+	if (sock < 0 || iov == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = iovcnt
+	};
+
+	return send_data(sock, &msg, &timeout_ms, false);
+}
+
 ssize_t net_stream_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms)
 {
 	return net_base_recv(sock, buffer, size, NULL, timeout_ms);
@@ -729,3 +763,134 @@ ssize_t net_dns_tcp_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms)
 
 	return recv_data(sock, &msg, false, &timeout_ms);
 }
+
+bool net_dns_tcp_ready(int sock)
+{
+	uint16_t pktsize = 0;
+	if (recv(sock, &pktsize, sizeof(pktsize), MSG_PEEK | MSG_DONTWAIT) != sizeof(pktsize)) {
+		return false;
+	}
+
+	int avail = 0;
+	if (ioctl(sock, FIONREAD, &avail) != 0) {
+		return false;
+	}
+
+	return avail >= sizeof(pktsize) + ntohs(pktsize);
+}
+
+/* -- zero-copy stream output ---------------------------------------------- */
+
+int net_zerocopy_enable(int sock)
+{
+#ifdef ENABLE_ZEROCOPY
+	return sockopt_enable(sock, SOL_SOCKET, SO_ZEROCOPY);
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+#ifdef ENABLE_ZEROCOPY
+static ssize_t send_process_zc(int fd, struct msghdr *msg, int timeout_ms)
+{
+	return sendmsg(fd, msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+}
+#endif
+
+ssize_t net_zerocopy_sendv(int sock, struct iovec *iov, int iovcnt, int timeout_ms,
+                           unsigned *sends)
+{
+#ifdef ENABLE_ZEROCOPY
+	static const struct io SEND_IO_ZC = {
+		.process = send_process_zc,
+		.wait = send_wait
+	};
+
+	if (sock < 0 || iov == NULL || sends == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = iovcnt
+	};
+
+	/* Each successful sendmsg() call is reported as one completion. */
+	size_t total = msg_iov_len(&msg);
+	size_t done = 0;
+	while (done < total) {
+		ssize_t ret = io_exec(&SEND_IO_ZC, sock, &msg, true, &timeout_ms);
+		if (ret < 0) {
+			return ret;
+		}
+		(*sends)++;
+		done += ret;
+		msg_iov_shift(&msg, ret);
+	}
+
+	return done;
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
+
+int net_zerocopy_wait(int sock, unsigned *done, unsigned target, int timeout_ms)
+{
+#ifdef ENABLE_ZEROCOPY
+	if (sock < 0 || done == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int *timeout_ptr = &timeout_ms;
+	bool signalled = false;
+	for (;;) {
+		uint8_t control[CMSG_SPACE(sizeof(struct sock_extended_err) +
+		                           sizeof(struct sockaddr_storage))];
+		struct msghdr msg = {
+			.msg_control = control,
+			.msg_controllen = sizeof(control)
+		};
+
+		if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) >= 0) {
+			for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+			     cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+				if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+				    !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+					continue;
+				}
+				struct sock_extended_err *ee = (void *)CMSG_DATA(cmsg);
+				if (ee->ee_errno == 0 && ee->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+					// Range of completed sends, counted from zero per socket.
+					*done += ee->ee_data - ee->ee_info + 1;
+				}
+			}
+			signalled = false;
+			continue;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			return knot_map_errno();
+		}
+
+		if ((int)(*done - target) >= 0) {
+			return KNOT_EOK;
+		} else if (signalled) {
+			/* Signalled without a completion, the connection failed. */
+			return KNOT_ECONN;
+		}
+
+		/* The completions are signalled as a socket error. */
+		TIMEOUT_CTX_INIT
+		int ret = poll_one(sock, 0, *timeout_ptr);
+		if (ret == 0) {
+			return KNOT_ETIMEOUT;
+		} else if (ret == -1 && !wait_should_retry(errno)) {
+			return KNOT_ECONN;
+		}
+		signalled = (ret == 1);
+		TIMEOUT_CTX_UPDATE
+	}
+#else
+	return KNOT_ENOTSUP;
+#endif
+}
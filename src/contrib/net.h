@@ -19,6 +19,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 // 1280 (IPv6 minimum link MTU) - 40 (IPv6 fixed header) - 20 (TCP fixed header)
 #define KNOT_TCP_MSS	1220
@@ -80,6 +81,16 @@ int net_connected_socket(int type, const struct sockaddr_storage *dst_addr,
  */
 int net_bound_tfo(int sock, int backlog);
 
+/*!
+ * \brief Delays accepting of a connection until the first data arrive.
+ *
+ * \param sock     Listening socket.
+ * \param timeout  Maximal delay in seconds.
+ *
+ * \return KNOT_EOK or error code
+ */
+int net_bound_defer_accept(int sock, int timeout);
+
 /*!
  * \brief Return true if the socket is fully connected.
  *
@@ -168,6 +179,15 @@ ssize_t net_dgram_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms);
  */
 ssize_t net_stream_send(int sock, const uint8_t *buffer, size_t size, int timeout_ms);
 
+/*!
+ * \brief Send data from several buffers on a SOCK_STREAM socket at once.
+ *
+ * \note The I/O vector is modified.
+ *
+ * \see net_base_send
+ */
+ssize_t net_stream_sendv(int sock, struct iovec *iov, int iovcnt, int timeout_ms);
+
 /*!
  * \brief Receive a message from a SOCK_STREAM socket.
  *
@@ -199,3 +219,53 @@ ssize_t net_dns_tcp_send(int sock, const uint8_t *buffer, size_t size, int timeo
  * \see net_base_recv
  */
 ssize_t net_dns_tcp_recv(int sock, uint8_t *buffer, size_t size, int timeout_ms);
+
+/*!
+ * \brief Check if a complete DNS message can be received from a TCP socket
+ *        without blocking.
+ */
+bool net_dns_tcp_ready(int sock);
+
+/* -- zero-copy stream output ---------------------------------------------- */
+
+/*!
+ * \brief Enable zero-copy sending on a stream socket (Linux SO_ZEROCOPY).
+ *
+ * \return KNOT_EOK, KNOT_ENOTSUP if not available, or error code.
+ */
+int net_zerocopy_enable(int sock);
+
+/*!
+ * \brief Send data on a stream socket without copying it to the kernel.
+ *
+ * The buffers are referenced by the kernel until the completion of the send
+ * is reported, they must not be modified until then, see net_zerocopy_wait().
+ * Each partial write counts as one send.
+ *
+ * \note The I/O vector is modified.
+ *
+ * \param[in]     sock        Socket with zero-copy enabled.
+ * \param[in]     iov         Data to be sent.
+ * \param[in]     iovcnt      Number of the I/O vector items.
+ * \param[in]     timeout_ms  Write timeout in milliseconds (-1 for infinity).
+ * \param[in,out] sends       Counter of the sends on the socket, incremented.
+ *
+ * \return Number of bytes sent or negative error code.
+ */
+ssize_t net_zerocopy_sendv(int sock, struct iovec *iov, int iovcnt, int timeout_ms,
+                           unsigned *sends);
+
+/*!
+ * \brief Collect the completions of zero-copy sends.
+ *
+ * Reads all the reported completions and waits for more until the given
+ * number of sends is completed.
+ *
+ * \param[in]     sock        Socket.
+ * \param[in,out] done        Counter of the completed sends, incremented.
+ * \param[in]     target      Number of sends to wait for.
+ * \param[in]     timeout_ms  Timeout in milliseconds (-1 for infinity).
+ *
+ * \return KNOT_EOK, KNOT_ETIMEOUT, or error code.
+ */
+int net_zerocopy_wait(int sock, unsigned *done, unsigned target, int timeout_ms);
@@ -83,10 +83,34 @@ typedef struct node {
 	void *p;
 } node_t;
 
+/*! \brief Number of cached twig array sizes (2 to 17 twigs). */
+#define TPOOL_TWIGS 16
+/*! \brief Number of cached key sizes, in TPOOL_KEY_ALIGN steps. */
+#define TPOOL_KEYS 16
+/*! \brief Key allocation granularity. */
+#define TPOOL_KEY_ALIGN 8
+/*! \brief Maximum number of cached blocks of one size. */
+#define TPOOL_DEPTH 32
+
+/*! \brief Freed twig arrays and keys kept for reuse.
+ *
+ * Each COW transaction allocates a new twig array for every modified
+ * branch and frees the replaced ones on commit (or the new ones on
+ * rollback). The cache is handed over from the old trie to the new one,
+ * so the memory freed by one update is reused by the next one without
+ * going through the allocator. The cached blocks are ordinary mm blocks
+ * of the exact class size, linked through their first word.
+ */
+typedef struct {
+	void *list[TPOOL_TWIGS + TPOOL_KEYS];
+	uint8_t count[TPOOL_TWIGS + TPOOL_KEYS];
+} tpool_t;
+
 struct trie {
 	node_t root; // undefined when weight == 0, see empty_root()
 	size_t weight;
 	knot_mm_t mm;
+	tpool_t pool;
 };
 
 /*! \brief size (in bits) of nibble (half-byte) indexes into keys
@@ -157,12 +181,83 @@ typedef char static_assert_bmp_fits
 /*! \brief bitmap entry for NOBYTE */
 #define BMP_NOBYTE (BIG1 << TSHIFT_BMP)
 
+/*! \brief Take a block of the given class from the cache or allocate a new one. */
+static void *tpool_alloc(trie_t *tbl, uint cls, size_t size)
+{
+	if (cls < TPOOL_TWIGS + TPOOL_KEYS && tbl->pool.list[cls] != NULL) {
+		void **block = tbl->pool.list[cls];
+		tbl->pool.list[cls] = *block;
+		tbl->pool.count[cls]--;
+		return block;
+	}
+	return mm_alloc(&tbl->mm, size);
+}
+
+/*! \brief Return a block of the given class to the cache if not full. */
+static void tpool_free(trie_t *tbl, uint cls, void *ptr)
+{
+	if (cls < TPOOL_TWIGS + TPOOL_KEYS && tbl->pool.count[cls] < TPOOL_DEPTH) {
+		*(void **)ptr = tbl->pool.list[cls];
+		tbl->pool.list[cls] = ptr;
+		tbl->pool.count[cls]++;
+	} else {
+		mm_free(&tbl->mm, ptr);
+	}
+}
+
+/*! \brief Release all the cached blocks. */
+static void tpool_clear(trie_t *tbl)
+{
+	for (uint cls = 0; cls < TPOOL_TWIGS + TPOOL_KEYS; ++cls) {
+		while (tbl->pool.list[cls] != NULL) {
+			void **block = tbl->pool.list[cls];
+			tbl->pool.list[cls] = *block;
+			mm_free(&tbl->mm, block);
+		}
+		tbl->pool.count[cls] = 0;
+	}
+}
+
+static uint twigs_class(uint cc)
+{
+	assert(cc >= 2);
+	return cc - 2;
+}
+
+static node_t *twigs_alloc(trie_t *tbl, uint cc)
+{
+	return tpool_alloc(tbl, twigs_class(cc), sizeof(node_t) * cc);
+}
+
+/*! \brief Free twig array; for an oversized array pass the current count. */
+static void twigs_free(trie_t *tbl, node_t *twigs, uint cc)
+{
+	tpool_free(tbl, twigs_class(cc), twigs);
+}
+
+/*! \brief Allocation size of a key, rounded up to the key class size. */
+static size_t tkey_size(uint32_t len)
+{
+	return (sizeof(tkey_t) + len + TPOOL_KEY_ALIGN - 1) & ~(size_t)(TPOOL_KEY_ALIGN - 1);
+}
+
+static uint tkey_class(uint32_t len)
+{
+	size_t units = tkey_size(len) / TPOOL_KEY_ALIGN;
+	return units > TPOOL_KEYS ? UINT_MAX : TPOOL_TWIGS + units - 1;
+}
+
+static void tkey_free(trie_t *tbl, tkey_t *lkey)
+{
+	tpool_free(tbl, tkey_class(lkey->len), lkey);
+}
+
 /*! \brief Initialize a new leaf, copying the key, and returning failure code. */
-static int mkleaf(node_t *leaf, const trie_key_t *key, uint32_t len, knot_mm_t *mm)
+static int mkleaf(node_t *leaf, const trie_key_t *key, uint32_t len, trie_t *tbl)
 {
 	if (unlikely((word)len > (BIG1 << KEYLENBITS)))
 		return KNOT_ENOMEM;
-	tkey_t *lkey = mm_alloc(mm, sizeof(tkey_t) + len);
+	tkey_t *lkey = tpool_alloc(tbl, tkey_class(len), tkey_size(len));
 	if (unlikely(!lkey))
 		return KNOT_ENOMEM;
 	lkey->cow = 0;
@@ -259,8 +354,9 @@ static bitmap_t keybit(index_t ni, const trie_key_t *key, uint32_t len)
 	if (bytei >= len)
 		return BMP_NOBYTE;
 
+	// high nibble for even indices, low nibble for odd ones (branch-free)
 	uint8_t ki = (uint8_t)key[bytei];
-	uint nibble = (ni & 1) ? (ki & 0xf) : (ki >> 4);
+	uint nibble = (ki >> ((~ni & 1) << 2)) & 0xf;
 
 	// skip one for NOBYTE nibbles after the end of the key
 	return BIG1 << (nibble + 1 + TSHIFT_BMP);
@@ -330,6 +426,7 @@ trie_t* trie_create(knot_mm_t *mm)
 	if (trie != NULL) {
 		trie->root = empty_root();
 		trie->weight = 0;
+		memset(&trie->pool, 0, sizeof(trie->pool));
 		if (mm != NULL)
 			trie->mm = *mm;
 		else
@@ -357,6 +454,7 @@ void trie_free(trie_t *tbl)
 		return;
 	if (tbl->weight)
 		clear_trie(&tbl->root, &tbl->mm);
+	tpool_clear(tbl);
 	mm_free(&tbl->mm, tbl);
 }
 
@@ -370,7 +468,8 @@ void trie_clear(trie_t *tbl)
 	tbl->weight = 0;
 }
 
-static bool dup_trie(node_t *copy, const node_t *orig, trie_dup_cb dup_cb, knot_mm_t *mm)
+static bool dup_trie(node_t *copy, const node_t *orig, trie_dup_cb dup_cb, knot_mm_t *mm,
+                     trie_t *tbl)
 {
 	if (isbranch(orig)) {
 		uint n = branch_weight(orig);
@@ -380,7 +479,7 @@ static bool dup_trie(node_t *copy, const node_t *orig, trie_dup_cb dup_cb, knot_
 		}
 		const node_t *ortw = twigs((node_t *)orig);
 		for (uint i = 0; i < n; ++i) {
-			if (!dup_trie(cotw + i, ortw + i, dup_cb, mm)) {
+			if (!dup_trie(cotw + i, ortw + i, dup_cb, mm, tbl)) {
 				while (i-- > 0) {
 					clear_trie(cotw + i, mm);
 				}
@@ -391,7 +490,7 @@ static bool dup_trie(node_t *copy, const node_t *orig, trie_dup_cb dup_cb, knot_
 		*copy = mkbranch(branch_index(orig), branch_bmp(orig), cotw);
 	} else {
 		tkey_t *key = tkey(orig);
-		if (mkleaf(copy, key->chars, key->len, mm) != KNOT_EOK) {
+		if (mkleaf(copy, key->chars, key->len, tbl) != KNOT_EOK) {
 			return false;
 		}
 		if ((copy->p = dup_cb(orig->p, mm)) == NULL) {
@@ -412,13 +511,14 @@ trie_t* trie_dup(const trie_t *orig, trie_dup_cb dup_cb, knot_mm_t *mm)
 		return NULL;
 	}
 	copy->weight = orig->weight;
+	memset(&copy->pool, 0, sizeof(copy->pool));
 	if (mm != NULL) {
 		copy->mm = *mm;
 	} else {
 		mm_ctx_init(&copy->mm);
 	}
 	if (copy->weight) {
-		if (!dup_trie(&copy->root, &orig->root, dup_cb, mm)) {
+		if (!dup_trie(&copy->root, &orig->root, dup_cb, mm, copy)) {
 			mm_free(mm, copy);
 			return NULL;
 		}
@@ -432,6 +532,80 @@ size_t trie_weight(const trie_t *tbl)
 	return tbl->weight;
 }
 
+static size_t mem_size(node_t *t)
+{
+	if (!isbranch(t))
+		return tkey_size(tkey(t)->len);
+	uint n = branch_weight(t);
+	size_t size = n * sizeof(node_t);
+	for (uint i = 0; i < n; ++i)
+		size += mem_size(twig(t, i));
+	return size;
+}
+
+size_t trie_mem_size(const trie_t *tbl)
+{
+	assert(tbl);
+	size_t size = sizeof(*tbl);
+	if (tbl->weight)
+		size += mem_size((node_t *)&tbl->root);
+	// Cached blocks, see twigs_class() and tkey_class().
+	for (uint cls = 0; cls < TPOOL_TWIGS; ++cls)
+		size += tbl->pool.count[cls] * sizeof(node_t) * (cls + 2);
+	for (uint cls = 0; cls < TPOOL_KEYS; ++cls)
+		size += tbl->pool.count[TPOOL_TWIGS + cls] * TPOOL_KEY_ALIGN * (cls + 1);
+	return size;
+}
+
+size_t trie_split_keys(trie_t *tbl, size_t parts, trie_key_t **keys, uint32_t *lens)
+{
+	assert(tbl && keys && lens);
+	if (parts < 2 || tbl->weight < parts)
+		return 0;
+
+	// Expand the frontier of subtrees until it's fine enough. Without
+	// subtree weights, the balance relies on the number of subtrees.
+	size_t want = parts * 16, cap = want * 17;
+	node_t **buf = malloc(2 * cap * sizeof(node_t *));
+	if (buf == NULL)
+		return 0;
+	node_t **front = buf, **next = buf + cap;
+	size_t count = 1;
+	front[0] = &tbl->root;
+	for (bool more = true; more && count < want; ) {
+		more = false;
+		size_t ncount = 0;
+		for (size_t i = 0; i < count; i++) {
+			node_t *t = front[i];
+			if (!isbranch(t) || ncount + branch_weight(t) + count - i > cap) {
+				next[ncount++] = t;
+				continue;
+			}
+			for (uint j = 0; j < branch_weight(t); j++)
+				next[ncount++] = twig(t, j);
+			more = true;
+		}
+		node_t **tmp = front;
+		front = next;
+		next = tmp;
+		count = ncount;
+	}
+
+	// The first key of every part but the first one.
+	size_t nkeys = 0;
+	for (size_t j = 1; j < parts && count >= parts; j++) {
+		node_t *t = front[j * count / parts];
+		while (isbranch(t))
+			t = twig(t, 0);
+		keys[nkeys] = tkey(t)->chars;
+		lens[nkeys] = tkey(t)->len;
+		nkeys++;
+	}
+
+	free(buf);
+	return nkeys;
+}
+
 trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len)
 {
 	assert(tbl);
@@ -490,12 +664,51 @@ trie_val_t* trie_get_try_wildcard(trie_t *tbl, const trie_key_t *key, uint32_t l
 	return trie_get_try(tbl, wild_key, wild_len);
 }
 
+trie_val_t* trie_get_prefix(trie_t *tbl, const trie_key_t *key, uint32_t len)
+{
+	assert(tbl);
+	if (!tbl->weight)
+		return NULL;
+	// Find leaf sharing the longest common prefix; see ns_find_branch() for explanation.
+	node_t *t = &tbl->root;
+	while (isbranch(t)) {
+		__builtin_prefetch(twigs(t));
+		bitmap_t b = twigbit(t, key, len);
+		uint i = hastwig(t, b) ? twigoff(t, b) : 0;
+		t = twig(t, i);
+	}
+	const tkey_t *lcp_key = tkey(t);
+	uint32_t lcp = 0;
+	while (lcp < len && lcp < lcp_key->len && key[lcp] == lcp_key->chars[lcp])
+		++lcp;
+	if (lcp == lcp_key->len)
+		return tvalp(t);
+
+	// Shorter keys end in the NOBYTE twigs along the path. All keys below
+	// a branch share the bytes before its index, so such a key is a prefix
+	// of the searched one iff it isn't longer than the common prefix.
+	node_t *best = NULL;
+	t = &tbl->root;
+	while (isbranch(t) && (branch_index(t) >> 1) <= lcp) {
+		if (hastwig(t, BMP_NOBYTE)) {
+			node_t *nobyte = twig(t, 0);
+			if (!isbranch(nobyte) && tkey(nobyte)->len <= lcp)
+				best = nobyte;
+		}
+		bitmap_t b = twigbit(t, key, len);
+		if (!hastwig(t, b))
+			break;
+		t = twig(t, twigoff(t, b));
+	}
+	return best != NULL ? tvalp(best) : NULL;
+}
+
 /*! \brief Delete leaf t with parent p; b is the bit for t under p.
  * Optionally return the deleted value via val.  The function can't fail. */
 static void del_found(trie_t *tbl, node_t *t, node_t *p, bitmap_t b, trie_val_t *val)
 {
 	assert(!tkey(t)->cow);
-	mm_free(&tbl->mm, tkey(t));
+	tkey_free(tbl, tkey(t));
 	if (val != NULL)
 		*val = *tvalp(t); // we return trie_val_t directly when deleting
 	--tbl->weight;
@@ -512,7 +725,7 @@ static void del_found(trie_t *tbl, node_t *t, node_t *p, bitmap_t b, trie_val_t
 	if (cc == 2) {
 		// collapse binary node p: move the other child to the parent
 		*p = tp[1 - ci];
-		mm_free(&tbl->mm, tp);
+		twigs_free(tbl, tp, cc);
 		return;
 	}
 	memmove(tp + ci, tp + ci + 1, sizeof(node_t) * (cc - ci - 1));
@@ -739,6 +952,26 @@ static int ns_first_leaf(nstack_t *ns)
 	} while (true);
 }
 
+/*!
+ * \brief Advance the node stack to the first leaf after the subtree of the current node.
+ *
+ * \return KNOT_EOK on success, KNOT_ENOENT on not-found, or possibly KNOT_ENOMEM.
+ */
+static int ns_next_tree(nstack_t *ns)
+{
+	assert(ns && ns->len > 0);
+	for (; ns->len >= 2; --ns->len) {
+		node_t *t = ns->stack[ns->len - 1];
+		node_t *p = ns->stack[ns->len - 2];
+		uint ci = twig_number(t, p);
+		if (ci + 1 == branch_weight(p))
+			continue;
+		ns->stack[ns->len - 1] = twig(p, ci + 1);
+		return ns_first_leaf(ns);
+	}
+	return KNOT_ENOENT;
+}
+
 /*!
  * \brief Advance the node stack to the leaf that is previous to the current node.
  *
@@ -917,6 +1150,44 @@ int trie_it_get_leq(trie_it_t *it, const trie_key_t *key, uint32_t len)
 	return ret;
 }
 
+int trie_it_get_geq(trie_it_t *it, const trie_key_t *key, uint32_t len)
+{
+	int ret = trie_it_get_leq(it, key, len);
+	if (ret == 1) {
+		trie_it_next(it);
+		ret = trie_it_finished(it) ? KNOT_ENOENT : KNOT_EOK;
+	} else if (ret == KNOT_ENOENT && ns_gettrie(it)->weight > 0) {
+		// All the keys are greater.
+		it->len = 1;
+		ret = ns_first_leaf(it);
+		if (ret != KNOT_EOK)
+			it->len = 0;
+	}
+	return ret;
+}
+
+bool trie_it_skip_shared(trie_it_t *it1, trie_it_t *it2)
+{
+	assert(it1 && it2);
+	if (it1->len < 2 || it2->len < 2)
+		return false;
+	uint32_t i1 = it1->len - 1, i2 = it2->len - 1;
+	if (it1->stack[i1] != it2->stack[i2])
+		return false;
+	// Climb to the highest common node, the roots themselves differ.
+	while (i1 > 1 && i2 > 1 && it1->stack[i1 - 1] == it2->stack[i2 - 1]) {
+		i1--;
+		i2--;
+	}
+	it1->len = i1 + 1;
+	it2->len = i2 + 1;
+	if (ns_next_tree(it1) != KNOT_EOK)
+		it1->len = 0;
+	if (ns_next_tree(it2) != KNOT_EOK)
+		it2->len = 0;
+	return true;
+}
+
 /* see below */
 static int cow_pushdown(trie_cow_t *cow, nstack_t *ns);
 
@@ -927,7 +1198,7 @@ static trie_val_t* cow_get_ins(trie_cow_t *cow, trie_t *tbl,
 	assert(tbl);
 	// First leaf in an empty tbl?
 	if (unlikely(!tbl->weight)) {
-		if (unlikely(mkleaf(&tbl->root, key, len, &tbl->mm)))
+		if (unlikely(mkleaf(&tbl->root, key, len, tbl)))
 			return NULL;
 		++tbl->weight;
 		return tvalp(&tbl->root);
@@ -948,7 +1219,7 @@ static trie_val_t* cow_get_ins(trie_cow_t *cow, trie_t *tbl,
 	if (idiff == TMAX_INDEX) // the same key was already present
 		return tvalp(t);
 	node_t leaf, *leafp;
-	if (unlikely(mkleaf(&leaf, key, len, &tbl->mm)))
+	if (unlikely(mkleaf(&leaf, key, len, tbl)))
 		return NULL;
 
 	if (isbranch(t) && branch_index(t) == idiff) {
@@ -973,7 +1244,7 @@ static trie_val_t* cow_get_ins(trie_cow_t *cow, trie_t *tbl,
 				assert(hastwig(pt, twigbit(pt, key, len)));
 			}
 		#endif
-		node_t *nt = mm_alloc(&tbl->mm, sizeof(node_t) * 2);
+		node_t *nt = twigs_alloc(tbl, 2);
 		if (unlikely(!nt))
 			goto err_leaf;
 		node_t t2 = *t; // Save before overwriting t.
@@ -985,7 +1256,7 @@ static trie_val_t* cow_get_ins(trie_cow_t *cow, trie_t *tbl,
 	++tbl->weight;
 	return tvalp(leafp);
 err_leaf:
-	mm_free(&tbl->mm, tkey(&leaf));
+	tkey_free(tbl, tkey(&leaf));
 	return NULL;
 	}
 }
@@ -1297,7 +1568,7 @@ static void mark_cow(trie_cow_t *cow, node_t *t)
 static int cow_pushdown_one(trie_cow_t *cow, node_t *t)
 {
 	uint cc = branch_weight(t);
-	node_t *nt = mm_alloc(&cow->new->mm, sizeof(node_t) * cc);
+	node_t *nt = twigs_alloc(cow->new, cc);
 	if (nt == NULL)
 		return KNOT_ENOMEM;
 	/* mark all the children */
@@ -1333,7 +1604,7 @@ static int cow_pushdown(trie_cow_t *cow, nstack_t *ns)
 				node_t oleaf = *ns->stack[i];
 				tkey_t *okey = tkey(&oleaf);
 				if(mkleaf(ns->stack[i], okey->chars, okey->len,
-					  &cow->new->mm))
+					  cow->new))
 					return KNOT_ENOMEM;
 				ns->stack[i]->p = oleaf.p;
 				okey->cow = 0;
@@ -1356,6 +1627,9 @@ trie_cow_t* trie_cow(trie_t *old, trie_cb *mark_shared, void *d)
 	new->mm = old->mm;
 	new->root = old->root;
 	new->weight = old->weight;
+	// the cache follows the trie being modified
+	new->pool = old->pool;
+	memset(&old->pool, 0, sizeof(old->pool));
 	cow->old = old;
 	cow->new = new;
 	cow->mark_shared = mark_shared;
@@ -1412,7 +1686,7 @@ static void cow_cleanup(trie_cow_t *cow, node_t *t, trie_cb *cb, void *d)
 		uint cc = branch_weight(t);
 		for (uint ci = 0; ci < cc; ++ci)
 			cow_cleanup(cow, twig(t, ci), cb, d);
-		mm_free(&cow->new->mm, twigs(t));
+		twigs_free(cow->new, twigs(t), cc);
 		return;
 	} else {
 		// application must decide how to clean up its values
@@ -1425,7 +1699,7 @@ static void cow_cleanup(trie_cow_t *cow, node_t *t, trie_cb *cb, void *d)
 		if (lkey->cow)
 			lkey->cow = 0;
 		else
-			mm_free(&cow->new->mm, lkey);
+			tkey_free(cow->new, lkey);
 		return;
 	}
 }
@@ -1445,7 +1719,76 @@ trie_t* trie_cow_rollback(trie_cow_t *cow, trie_cb *cb, void *d)
 	trie_t *ret = cow->old;
 	if (cow->new->weight)
 		cow_cleanup(cow, &cow->new->root, cb, d);
+	ret->pool = cow->new->pool;
 	mm_free(&ret->mm, cow->new);
 	mm_free(&ret->mm, cow);
 	return ret;
 }
+
+/*! \brief Blocks replaced by the compaction, freed when it's finished. */
+typedef struct {
+	void **blocks;
+	size_t count;
+	size_t capacity;
+} compact_t;
+
+static int compact_replaced(compact_t *c, void *block)
+{
+	if (c->count == c->capacity) {
+		size_t capacity = MAX(2 * c->capacity, 1024);
+		void **blocks = realloc(c->blocks, capacity * sizeof(*blocks));
+		if (blocks == NULL)
+			return KNOT_ENOMEM;
+		c->blocks = blocks;
+		c->capacity = capacity;
+	}
+	c->blocks[c->count++] = block;
+	return KNOT_EOK;
+}
+
+/*! \brief Reallocate the exclusively owned objects of a subtrie in DFS order. */
+static int compact_node(trie_t *tbl, node_t *t, compact_t *c)
+{
+	if (!isbranch(t)) {
+		tkey_t *lkey = tkey(t);
+		if (lkey->cow)
+			return KNOT_EOK;
+		size_t size = tkey_size(lkey->len);
+		tkey_t *nkey = mm_alloc(&tbl->mm, size);
+		if (unlikely(!nkey || compact_replaced(c, lkey) != KNOT_EOK)) {
+			mm_free(&tbl->mm, nkey);
+			return KNOT_ENOMEM;
+		}
+		memcpy(nkey, lkey, sizeof(tkey_t) + lkey->len);
+		// keep the COW mark of a twig array stored in its first leaf
+		t->i = (t->i & ~TMASK_LEAF) | (uintptr_t)nkey;
+		return KNOT_EOK;
+	}
+	if (cow_marked(t))
+		return KNOT_EOK; // shared region, not ours to move
+	uint cc = branch_weight(t);
+	node_t *nt = mm_alloc(&tbl->mm, sizeof(node_t) * cc);
+	if (unlikely(!nt || compact_replaced(c, twigs(t)) != KNOT_EOK)) {
+		mm_free(&tbl->mm, nt);
+		return KNOT_ENOMEM;
+	}
+	t->p = memcpy(nt, twigs(t), sizeof(node_t) * cc);
+	for (uint ci = 0; ci < cc; ++ci)
+		ERR_RETURN(compact_node(tbl, twig(t, ci), c));
+	return KNOT_EOK;
+}
+
+int trie_compact(trie_t *tbl)
+{
+	assert(tbl);
+	if (!tbl->weight)
+		return KNOT_EOK;
+	// The replaced blocks are kept until the end so that the allocator
+	// can't give them back scattered to the relocated nodes.
+	compact_t c = { 0 };
+	int ret = compact_node(tbl, &tbl->root, &c);
+	for (size_t i = 0; i < c.count; ++i)
+		mm_free(&tbl->mm, c.blocks[i]);
+	free(c.blocks);
+	return ret;
+}
@@ -74,6 +74,44 @@ trie_t* trie_dup(const trie_t *orig, trie_dup_cb dup_cb, knot_mm_t *mm);
 /*! \brief Return the number of keys in the trie. */
 size_t trie_weight(const trie_t *tbl);
 
+/*!
+ * \brief Return the memory allocated by the trie, excluding the values.
+ *
+ * Nodes shared with a COW copy are counted in both tries.
+ */
+size_t trie_mem_size(const trie_t *tbl);
+
+/*!
+ * \brief Reallocate the trie nodes and keys in the order of iteration.
+ *
+ * After a bulk load, the nodes are scattered across the heap in the order
+ * of insertion. The compaction allocates them anew in depth-first order,
+ * so that lookups and iteration follow the memory order.
+ *
+ * Nodes shared with a COW copy (during a COW transaction) are left in place.
+ *
+ * \note The trie mustn't be accessed concurrently, the original nodes are
+ *       freed. The values aren't moved, pointers to them remain valid,
+ *       but the pointers returned by lookups (trie_val_t *) do not.
+ *
+ * \return KNOT_EOK, KNOT_ENOMEM (the trie remains valid, partly compacted).
+ */
+int trie_compact(trie_t *tbl);
+
+/*!
+ * \brief Find keys splitting the trie into parts of roughly similar size.
+ *
+ * The split is estimated from the shape of the trie, not by counting.
+ *
+ * \param parts  Requested number of parts.
+ * \param keys   Output: the first key of every part but the first one
+ *               (at least parts - 1 items, valid until the trie is modified).
+ * \param lens   Output: lengths of the keys.
+ *
+ * \return Number of the keys found, ascending (zero if not worth splitting).
+ */
+size_t trie_split_keys(trie_t *tbl, size_t parts, trie_key_t **keys, uint32_t *lens);
+
 /*! \brief Search the trie, returning NULL on failure. */
 trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
@@ -85,6 +123,14 @@ trie_val_t* trie_get_try(trie_t *tbl, const trie_key_t *key, uint32_t len);
  */
 trie_val_t* trie_get_try_wildcard(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
+/*! \brief Search the trie for the longest key which is a prefix of the given one,
+ * returning NULL on failure.
+ *
+ * \note The lookup is done in one descent (and a partial second one if the
+ *   found leaf isn't a prefix itself).
+ */
+trie_val_t* trie_get_prefix(trie_t *tbl, const trie_key_t *key, uint32_t len);
+
 /*! \brief Search the trie, inserting NULL trie_val_t on failure. */
 trie_val_t* trie_get_ins(trie_t *tbl, const trie_key_t *key, uint32_t len);
 
@@ -181,6 +227,24 @@ void trie_it_parent(trie_it_t *it);
 /*! \brief trie_get_leq() but with an iterator. */
 int trie_it_get_leq(trie_it_t *it, const trie_key_t *key, uint32_t len);
 
+/*!
+ * \brief Point the iterator to the first element greater than or equal to the key.
+ *
+ * \return KNOT_EOK, or KNOT_ENOENT if there is no such element (finished iterator).
+ */
+int trie_it_get_geq(trie_it_t *it, const trie_key_t *key, uint32_t len);
+
+/*!
+ * \brief Skip the rest of the subtree shared by two tries (see trie_cow()).
+ *
+ * If both iterators point to the same leaf (not just an equal key), they are
+ * advanced behind the largest subtree the tries share around it. The skipped
+ * elements are identical in both tries.
+ *
+ * \return True if the iterators have been advanced.
+ */
+bool trie_it_skip_shared(trie_it_t *it1, trie_it_t *it2);
+
 /*! \brief Remove the current element.  The iterator will get trie_it_finished() */
 void trie_it_del(trie_it_t *it);
 
@@ -0,0 +1,123 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "contrib/sipbatch.h"
+#include "contrib/string.h"
+#include "libknot/endian.h"
+
+#define L SIPBATCH_LANES
+
+#define ROTL(x, b)	(uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+typedef struct {
+	uint64_t v0[L], v1[L], v2[L], v3[L];
+} lanes_t;
+
+static inline void rounds(lanes_t *s, int count)
+{
+	while (count-- > 0) {
+		for (int l = 0; l < L; l++) {
+			s->v0[l] += s->v1[l]; s->v1[l] = ROTL(s->v1[l], 13); s->v1[l] ^= s->v0[l];
+			s->v0[l] = ROTL(s->v0[l], 32);
+			s->v2[l] += s->v3[l]; s->v3[l] = ROTL(s->v3[l], 16); s->v3[l] ^= s->v2[l];
+			s->v0[l] += s->v3[l]; s->v3[l] = ROTL(s->v3[l], 21); s->v3[l] ^= s->v0[l];
+			s->v2[l] += s->v1[l]; s->v1[l] = ROTL(s->v1[l], 17); s->v1[l] ^= s->v2[l];
+			s->v2[l] = ROTL(s->v2[l], 32);
+		}
+	}
+}
+
+static inline void compress(lanes_t *s, const uint64_t *m)
+{
+	for (int l = 0; l < L; l++) {
+		s->v3[l] ^= m[l];
+	}
+	rounds(s, 2);
+	for (int l = 0; l < L; l++) {
+		s->v0[l] ^= m[l];
+	}
+}
+
+static void hash_lanes(const SIPHASH_KEY *key, const uint8_t *const *src,
+                       size_t len, uint64_t *out)
+{
+	uint64_t k0 = le64toh(key->k0);
+	uint64_t k1 = le64toh(key->k1);
+
+	lanes_t s;
+	for (int l = 0; l < L; l++) {
+		s.v0[l] = 0x736f6d6570736575ULL ^ k0;
+		s.v1[l] = 0x646f72616e646f6dULL ^ k1;
+		s.v2[l] = 0x6c7967656e657261ULL ^ k0;
+		s.v3[l] = 0x7465646279746573ULL ^ k1;
+	}
+
+	uint64_t m[L];
+	size_t off = 0;
+	for (; off + sizeof(uint64_t) <= len; off += sizeof(uint64_t)) {
+		for (int l = 0; l < L; l++) {
+			memcpy(&m[l], src[l] + off, sizeof(m[l]));
+			m[l] = le64toh(m[l]);
+		}
+		compress(&s, m);
+	}
+
+	// The last block is padded with zeros and ends with the length.
+	for (int l = 0; l < L; l++) {
+		uint8_t buf[sizeof(uint64_t)] = { 0 };
+		memcpy(buf, src[l] + off, len - off);
+		buf[7] = len;
+		memcpy(&m[l], buf, sizeof(m[l]));
+		m[l] = le64toh(m[l]);
+	}
+	compress(&s, m);
+
+	for (int l = 0; l < L; l++) {
+		s.v2[l] ^= 0xff;
+	}
+	rounds(&s, 4);
+
+	for (int l = 0; l < L; l++) {
+		out[l] = htole64((s.v0[l] ^ s.v1[l]) ^ (s.v2[l] ^ s.v3[l]));
+	}
+	memzero(&s, sizeof(s));
+}
+
+void siphash24_batch(const SIPHASH_KEY *key, const uint8_t *const *src,
+                     const size_t *len, size_t count, uint64_t *out)
+{
+	size_t i = 0;
+	for (; i + L <= count; i += L) {
+		bool same = true;
+		for (int l = 1; l < L; l++) {
+			same &= (len[i + l] == len[i]);
+		}
+		if (same) {
+			hash_lanes(key, src + i, len[i], out + i);
+		} else {
+			for (int l = 0; l < L; l++) {
+				out[i + l] = SipHash24(key, src[i + l], len[i + l]);
+			}
+		}
+	}
+
+	for (; i < count; i++) {
+		out[i] = SipHash24(key, src[i], len[i]);
+	}
+}
@@ -0,0 +1,47 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief SipHash-2-4 of several short messages at once.
+ *
+ * The messages are hashed in groups of SIPBATCH_LANES. Every round is computed
+ * for the whole group together, so the compiler can use vector registers and
+ * the latency of the dependent round operations is hidden. Groups of messages
+ * of different lengths are hashed one by one.
+ *
+ * The results are equal to SipHash24() of the individual messages.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "contrib/openbsd/siphash.h"
+
+#define SIPBATCH_LANES	4
+
+/*!
+ * \brief Computes SipHash-2-4 of 'count' messages with the same key.
+ *
+ * \param key    Hash key.
+ * \param src    Messages.
+ * \param len    Lengths of the messages.
+ * \param count  Number of the messages.
+ * \param out    Output hashes (as returned by SipHash24()).
+ */
+void siphash24_batch(const SIPHASH_KEY *key, const uint8_t *const *src,
+                     const size_t *len, size_t count, uint64_t *out);
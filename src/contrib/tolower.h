@@ -50,3 +50,27 @@ static inline uint8_t knot_tolower(uint8_t c) {
 
 	return tolower_table[c];
 }
+
+/*!
+ * \brief Converts eight binary characters packed in a word to lowercase.
+ *
+ * Equivalent of knot_tolower() applied to each byte, without branches and
+ * table lookups.
+ *
+ * \param w  Word of characters.
+ *
+ * \return \a w with ASCII uppercase letters converted to lowercase.
+ */
+static inline uint64_t knot_tolower_u64(uint64_t w) {
+	const uint64_t ones = 0x0101010101010101ULL;
+	const uint64_t high = 0x8080808080808080ULL;
+
+	/* The high bit of each byte in the sums indicates the comparison. */
+	uint64_t low7 = w & ~high;
+	uint64_t ge_a = low7 + (0x80 - 'A') * ones;
+	uint64_t gt_z = low7 + (0x80 - 'Z' - 1) * ones;
+	uint64_t upper = ge_a & ~gt_z & ~w & high;
+
+	/* Set the 0x20 bit of uppercase letters. */
+	return w | (upper >> 2);
+}
@@ -214,6 +214,7 @@ mp_flush(struct mempool *pool)
 	pool->state.last[1] = NULL;
 	pool->state.free[1] = 0;
 	pool->last_big = &pool->last_big;
+	pool->allocs = 0;
 }
 
 static void
@@ -248,6 +249,12 @@ mp_total_size(struct mempool *pool)
 	return stats.total_size;
 }
 
+unsigned
+mp_alloc_count(struct mempool *pool)
+{
+	return pool->allocs;
+}
+
 static void *
 mp_alloc_internal(struct mempool *pool, unsigned size)
 {
@@ -288,6 +295,7 @@ mp_alloc_internal(struct mempool *pool, unsigned size)
 void *
 mp_alloc(struct mempool *pool, unsigned size)
 {
+	pool->allocs++;
 	unsigned avail = pool->state.free[0] & ~(CPU_STRUCT_ALIGN - 1);
 	void *ptr = NULL;
 	if (size <= avail) {
@@ -303,6 +311,7 @@ mp_alloc(struct mempool *pool, unsigned size)
 void *
 mp_alloc_noalign(struct mempool *pool, unsigned size)
 {
+	pool->allocs++;
 	void *ptr = NULL;
 	if (size <= pool->state.free[0]) {
 		ptr = (uint8_t*)pool->state.last[0] - pool->state.free[0];
@@ -39,6 +39,7 @@ struct mempool {
 	struct mempool_state state;
 	void *unused, *last_big;
 	unsigned chunk_size, threshold, idx;
+	unsigned allocs;
 };
 
 struct mempool_stats {			/** Mempool statistics. See mp_stats(). **/
@@ -94,6 +95,7 @@ void mp_flush(struct mempool *pool);
  **/
 void mp_stats(struct mempool *pool, struct mempool_stats *stats);
 uint64_t mp_total_size(struct mempool *pool);	/** How many bytes were allocated by the pool. **/
+unsigned mp_alloc_count(struct mempool *pool);	/** How many allocations were made since the last flush. **/
 
 /***
  * [[alloc]]
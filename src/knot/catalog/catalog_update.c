@@ -280,7 +280,8 @@ static int rem_conf_conflict(const knot_dname_t *mem, const knot_dname_t *ow,
 	return KNOT_EOK;
 }
 
-void catalog_update_finalize(catalog_update_t *u, catalog_t *cat, conf_t *conf)
+void catalog_update_finalize(catalog_update_t *u, catalog_t *cat, conf_t *conf,
+                             bool conf_changed)
 {
 	catalog_it_t *it = catalog_it_begin(u);
 	while (!catalog_it_finished(it)) {
@@ -294,7 +295,7 @@ void catalog_update_finalize(catalog_update_t *u, catalog_t *cat, conf_t *conf)
 
 	// This checks if the configuration file has not changed in the way
 	// it conflicts with existing member zone and let config take precedence.
-	if (cat->ro_txn != NULL) {
+	if (conf_changed && cat->ro_txn != NULL) {
 		rem_conflict_ctx_t rcctx = { conf, u };
 		(void)catalog_apply(cat, NULL, rem_conf_conflict, &rcctx, false);
 	}
@@ -129,11 +129,13 @@ inline static bool catalog_it_finished(catalog_it_t *it)
 /*!
  * \brief Check Catalog update for conflicts with conf or other catalogs.
  *
- * \param u      Catalog update to be aligned in-place.
- * \param cat    Catalog DB to check against.
- * \param conf   Relevant configuration.
+ * \param u             Catalog update to be aligned in-place.
+ * \param cat           Catalog DB to check against.
+ * \param conf          Relevant configuration.
+ * \param conf_changed  Check also all existing members against the configuration.
  */
-void catalog_update_finalize(catalog_update_t *u, catalog_t *cat, conf_t *conf);
+void catalog_update_finalize(catalog_update_t *u, catalog_t *cat, conf_t *conf,
+                             bool conf_changed);
 
 /*!
  * \brief Put changes from Catalog Update into persistent Catalog database.
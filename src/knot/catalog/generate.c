@@ -73,85 +73,97 @@ static bool same_group(zone_t *old_z, zone_t *new_z)
 	}
 }
 
+static void generate_member(zone_t *catz, zone_t *zone, const knot_dname_t *cg,
+                            catalog_upd_type_t type, const char *group)
+{
+	if (catz == NULL || (type != CAT_UPD_ADD && catz->contents == NULL)) {
+		// A catalog not loaded yet is generated with all its members at once.
+		return;
+	}
+	assert(catz->cat_members != NULL); // if this failed to allocate, catz wasn't added to zonedb
+
+	knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
+	if (owner == NULL) {
+		catz->cat_members->error = KNOT_ENOENT;
+		return;
+	}
+	size_t group_size = group == NULL ? 0 : strlen(group);
+	int ret = catalog_update_add(catz->cat_members, zone->name, owner,
+	                             cg, type, group, group_size, NULL);
+	free(owner);
+	if (ret != KNOT_EOK) {
+		catz->cat_members->error = ret;
+	} else {
+		zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
+	}
+}
+
+static void generate_removed(zone_t *zone, struct knot_zonedb *db_new)
+{
+	knot_dname_t *cg = zone->catalog_gen;
+	if (cg == NULL || knot_zonedb_find(db_new, zone->name) != NULL) {
+		return;
+	}
+
+	generate_member(knot_zonedb_find(db_new, cg), zone, cg, CAT_UPD_REM, NULL);
+}
+
+static void generate_current(struct knot_zonedb *db_new, struct knot_zonedb *db_old,
+                             zone_t *zone)
+{
+	knot_dname_t *cg = zone->catalog_gen;
+	zone_t *old = knot_zonedb_find(db_old, zone->name);
+	knot_dname_t *old_cg = old == NULL ? NULL : old->catalog_gen;
+
+	// Only the members changed since the last generation produce a change,
+	// unchanged ones are skipped without computing their records.
+	if (old_cg != NULL && !knot_dname_is_equal(old_cg, cg)) {
+		generate_member(knot_zonedb_find(db_new, old_cg), old, old_cg, CAT_UPD_REM, NULL);
+	}
+	if (cg == NULL) {
+		return;
+	}
+
+	zone_t *catz = knot_zonedb_find(db_new, cg);
+	if (catz == NULL) {
+		log_zone_warning(zone->name, "member zone belongs to non-existing catalog zone");
+	} else if (catz->contents == NULL || old_cg == NULL || !knot_dname_is_equal(old_cg, cg)) {
+		generate_member(catz, zone, cg, CAT_UPD_ADD, zone->catalog_group);
+	} else if (!same_group(zone, old)) {
+		generate_member(catz, zone, cg, CAT_UPD_PROP, zone->catalog_group);
+	}
+}
+
 void catalogs_generate(struct knot_zonedb *db_new, struct knot_zonedb *db_old)
 {
 	// general comment: catz->contents!=NULL means incremental update of catalog
 
 	if (db_old != NULL) {
-		knot_zonedb_iter_t *it = knot_zonedb_iter_begin(db_old);
-		while (!knot_zonedb_iter_finished(it)) {
-			zone_t *zone = knot_zonedb_iter_val(it);
-			knot_dname_t *cg = zone->catalog_gen;
-			if (cg != NULL && knot_zonedb_find(db_new, zone->name) == NULL) {
-				zone_t *catz = knot_zonedb_find(db_new, cg);
-				if (catz != NULL && catz->contents != NULL) {
-					assert(catz->cat_members != NULL); // if this failed to allocate, catz wasn't added to zonedb
-					knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
-					if (owner == NULL) {
-						catz->cat_members->error = KNOT_ENOENT;
-						knot_zonedb_iter_next(it);
-						continue;
-					}
-					int ret = catalog_update_add(catz->cat_members, zone->name, owner,
-					                             cg, CAT_UPD_REM, NULL, 0, NULL);
-					free(owner);
-					if (ret != KNOT_EOK) {
-						catz->cat_members->error = ret;
-					} else {
-						zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
-					}
-				}
-			}
-			knot_zonedb_iter_next(it);
-		}
-		knot_zonedb_iter_free(it);
+		knot_zonedb_foreach(db_old, generate_removed, db_new);
 	}
 
 	knot_zonedb_iter_t *it = knot_zonedb_iter_begin(db_new);
 	while (!knot_zonedb_iter_finished(it)) {
-		zone_t *zone = knot_zonedb_iter_val(it);
-		knot_dname_t *cg = zone->catalog_gen;
-		if (cg == NULL) {
-			knot_zonedb_iter_next(it);
-			continue;
-		}
-		zone_t *catz = knot_zonedb_find(db_new, cg);
-		zone_t *old = knot_zonedb_find(db_old, zone->name);
-		knot_dname_t *owner = catalog_member_owner(zone->name, cg, zone->timers.catalog_member);
-		size_t cgroup_size = zone->catalog_group == NULL ? 0 : strlen(zone->catalog_group);
-		if (catz == NULL) {
-			log_zone_warning(zone->name, "member zone belongs to non-existing catalog zone");
-		} else if (catz->contents == NULL || old == NULL) {
-			assert(catz->cat_members != NULL);
-			if (owner == NULL) {
-				catz->cat_members->error = KNOT_ENOENT;
-				knot_zonedb_iter_next(it);
-				continue;
-			}
-			int ret = catalog_update_add(catz->cat_members, zone->name, owner,
-			                             cg, CAT_UPD_ADD, zone->catalog_group,
-			                             cgroup_size, NULL);
-			if (ret != KNOT_EOK) {
-				catz->cat_members->error = ret;
-			} else {
-				zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
-			}
-		} else if (!same_group(zone, old)) {
-			int ret = catalog_update_add(catz->cat_members, zone->name, owner,
-			                             cg, CAT_UPD_PROP, zone->catalog_group,
-			                             cgroup_size, NULL);
-			if (ret != KNOT_EOK) {
-				catz->cat_members->error = ret;
-			} else {
-				zone_events_schedule_now(catz, ZONE_EVENT_LOAD);
-			}
-		}
-		free(owner);
+		generate_current(db_new, db_old, knot_zonedb_iter_val(it));
 		knot_zonedb_iter_next(it);
 	}
 	knot_zonedb_iter_free(it);
 }
 
+void catalogs_generate_zone(struct knot_zonedb *db_new, struct knot_zonedb *db_old,
+                            const knot_dname_t *zone_name)
+{
+	zone_t *old = knot_zonedb_find(db_old, zone_name);
+	if (old != NULL) {
+		generate_removed(old, db_new);
+	}
+
+	zone_t *zone = knot_zonedb_find(db_new, zone_name);
+	if (zone != NULL) {
+		generate_current(db_new, db_old, zone);
+	}
+}
+
 static void set_rdata(knot_rrset_t *rrset, uint8_t *data, uint16_t len)
 {
 	knot_rdata_init(rrset->rrs.rdata, len, data);
@@ -278,6 +290,7 @@ struct zone_contents *catalog_update_to_zone(catalog_update_t *u, const knot_dna
 	while (!catalog_it_finished(it)) {
 		catalog_upd_val_t *val = catalog_it_val(it);
 		if (val->add_owner == NULL) {
+			catalog_it_next(it);
 			continue;
 		}
 		rrset.owner = val->add_owner;
@@ -29,6 +29,12 @@ struct knot_zonedb;
  */
 void catalogs_generate(struct knot_zonedb *db_new, struct knot_zonedb *db_old);
 
+/*!
+ * \brief Create incremental catalog upd for a single added, changed, or removed zone.
+ */
+void catalogs_generate_zone(struct knot_zonedb *db_new, struct knot_zonedb *db_old,
+                            const knot_dname_t *zone_name);
+
 struct zone_contents;
 
 /*!
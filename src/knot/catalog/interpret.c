@@ -225,32 +225,42 @@ static int rr_count(const zone_node_t *node, uint16_t type)
 	return rd == NULL ? 0 : rd->count;
 }
 
+static const zone_node_t *complete_node(const zone_node_t *node, cat_upd_ctx_t *ctx)
+{
+	// The changed node must be checked in its resulting form.
+	return ctx->zone_diff ? zone_contents_find_node(ctx->complete_conts, node->owner) : node;
+}
+
 static int member_verify(zone_node_t *node, cat_upd_ctx_t *ctx)
 {
-	return rr_count(node, KNOT_RRTYPE_PTR) > 1 ? KNOT_EISRECORD : KNOT_EOK;
+	return rr_count(complete_node(node, ctx), KNOT_RRTYPE_PTR) > 1 ? KNOT_EISRECORD : KNOT_EOK;
 }
 
 static int prop_verify(zone_node_t *node, cat_upd_ctx_t *ctx)
 {
 	if (label_eq(node->owner, CATALOG_GROUP_LABEL) &&
-	    rr_count(node, KNOT_RRTYPE_TXT) > 1) {
+	    rr_count(complete_node(node, ctx), KNOT_RRTYPE_TXT) > 1) {
 		return KNOT_EISRECORD;
 	}
 
 	return KNOT_EOK;
 }
 
-int catalog_zone_verify(const struct zone_contents *zone)
+int catalog_zone_verify(const struct zone_contents *zone, const zone_diff_t *changes)
 {
 	cat_upd_ctx_t ctx = { NULL, zone, knot_dname_labels(zone->apex->owner, NULL),
-	                      false, false, NULL, member_verify, prop_verify };
+	                      false, changes != NULL, NULL, member_verify, prop_verify };
 
 	if (!check_zone_version(zone)) {
 		return KNOT_EZONEINVAL;
 	}
 
 	zone_diff_t zdiff;
-	zone_diff_from_zone(&zdiff, zone);
+	if (changes != NULL) {
+		zdiff = *changes;
+	} else {
+		zone_diff_from_zone(&zdiff, zone);
+	}
 
 	return interpret_zone(&zdiff, &ctx);
 }
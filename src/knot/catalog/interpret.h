@@ -24,13 +24,15 @@ struct zone_diff;
 /*!
  * \brief Validate if given zone is valid catalog.
  *
- * \param zone   Catalog zone in question.
+ * \param zone     Catalog zone in question.
+ * \param changes  Optional: check just the member nodes changed by this diff.
  *
  * \retval KNOT_EZONEINVAL   Invalid version record.
  * \retval KNOT_EISRECORD    Some of single-record RRSets has multiple RRs.
  * \return KNOT_EOK          All OK.
  */
-int catalog_zone_verify(const struct zone_contents *zone);
+int catalog_zone_verify(const struct zone_contents *zone,
+                        const struct zone_diff *changes);
 
 /*!
  * \brief Iterate over PTR records in given zone contents and add members to catalog update.
@@ -23,40 +23,96 @@
 #include "libknot/libknot.h"
 #include "knot/server/dthreads.h"
 #include "knot/common/evsched.h"
+#include "contrib/macros.h"
+#include "contrib/time.h"
 
-/*! \brief Some implementations of timercmp >= are broken, this is for compat.*/
-static inline int timercmp_ge(struct timeval *a, struct timeval *b) {
-	return timercmp(a, b, >) || timercmp(a, b, ==);
+#define TICK_MS   1000
+#define SLOT_MASK (EVSCHED_WHEEL_SIZE - 1)
+
+/*! \brief Get milliseconds elapsed since the scheduler base time. */
+static uint64_t elapsed_ms(evsched_t *sched)
+{
+	struct timespec now = time_now();
+	struct timespec diff = time_diff(&sched->base, &now);
+
+	return diff.tv_sec * 1000 + diff.tv_nsec / 1000000;
 }
 
-static int compare_event_heap_nodes(void *e1, void *e2)
+/*! \brief Get wheel slot for the event according to its expiration tick. */
+static list_t *wheel_slot(evsched_t *sched, uint64_t expires)
 {
-	if (timercmp(&((event_t *)e1)->tv, &((event_t *)e2)->tv, <)) return -1;
-	if (timercmp(&((event_t *)e1)->tv, &((event_t *)e2)->tv, >)) return 1;
-	return 0;
+	assert(expires >= sched->current);
+
+	uint64_t delta = expires - sched->current;
+	for (int level = 0; level < EVSCHED_WHEEL_LEVELS; level++) {
+		unsigned shift = level * EVSCHED_WHEEL_BITS;
+		if (delta < (1ULL << (shift + EVSCHED_WHEEL_BITS)) ||
+		    level == EVSCHED_WHEEL_LEVELS - 1) {
+			return &sched->wheel[level][(expires >> shift) & SLOT_MASK];
+		}
+	}
+
+	assert(0);
+	return NULL;
 }
 
-/*!
- * \brief Get time T (now) + dt milliseconds.
- */
-static struct timeval timeval_in(uint32_t dt)
+static void wheel_insert(evsched_t *sched, event_t *ev)
 {
-	struct timeval tv = { 0 };
-	gettimeofday(&tv, NULL);
+	/* Events beyond the wheel range are re-cascaded from the top level. */
+	uint64_t max = sched->current +
+	               (1ULL << (EVSCHED_WHEEL_LEVELS * EVSCHED_WHEEL_BITS)) - 1;
+	add_tail(wheel_slot(sched, MIN(ev->expires, max)), &ev->n);
+	ev->scheduled = true;
+}
 
-	/* Add number of seconds. */
-	tv.tv_sec += dt / 1000;
+static void wheel_remove(evsched_t *sched, event_t *ev)
+{
+	if (ev->scheduled) {
+		rem_node(&ev->n);
+		ev->scheduled = false;
+		sched->count--;
+	}
+}
 
-	/* Add the number of microseconds. */
-	tv.tv_usec += (dt % 1000) * 1000;
+/*! \brief Move events from a higher level slot to lower levels. */
+static void cascade(evsched_t *sched, int level)
+{
+	unsigned shift = level * EVSCHED_WHEEL_BITS;
+	list_t *slot = &sched->wheel[level][(sched->current >> shift) & SLOT_MASK];
 
-	/* Check for overflow. */
-	while (tv.tv_usec > 999999) {
-		tv.tv_sec += 1;
-		tv.tv_usec -= 1 * 1000 * 1000;
+	event_t *ev;
+	WALK_LIST_FIRST(ev, *slot) {
+		rem_node(&ev->n);
+		wheel_insert(sched, ev);
 	}
+}
 
-	return tv;
+/*! \brief Dispatch all events from the list. */
+static void dispatch(evsched_t *sched, list_t *list)
+{
+	event_t *ev;
+	WALK_LIST_FIRST(ev, *list) {
+		wheel_remove(sched, ev);
+		ev->cb(ev);
+	}
+}
+
+/*! \brief Process the current tick and advance the wheel. */
+static void process_tick(evsched_t *sched)
+{
+	/* At the start of a slot of a higher level, cascade it (higher levels first). */
+	int level = 1;
+	while (level < EVSCHED_WHEEL_LEVELS &&
+	       (sched->current & ((1ULL << (level * EVSCHED_WHEEL_BITS)) - 1)) == 0) {
+		level++;
+	}
+	while (--level > 0) {
+		cascade(sched, level);
+	}
+
+	/* Dispatch the batch of events expiring in this tick. */
+	dispatch(sched, &sched->wheel[0][sched->current & SLOT_MASK]);
+	sched->current++;
 }
 
 /*! \brief Event scheduler loop. */
@@ -68,33 +124,39 @@ static int evsched_run(dthread_t *thread)
 	}
 
 	/* Run event loop. */
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->lock);
 	while (!dt_is_cancelled(thread)) {
-		if (!!EMPTY_HEAP(&sched->heap) || sched->paused) {
-			pthread_cond_wait(&sched->notify, &sched->heap_lock);
+		if (sched->paused || (sched->count == 0 && EMPTY_LIST(sched->due))) {
+			pthread_cond_wait(&sched->notify, &sched->lock);
 			continue;
 		}
 
-		/* Get current time. */
-		struct timeval dt;
-		gettimeofday(&dt, 0);
-
-		/* Get next event. */
-		event_t *ev = *((event_t**)HHEAD(&sched->heap));
-		assert(ev != NULL);
+		if (!EMPTY_LIST(sched->due)) {
+			dispatch(sched, &sched->due);
+			continue;
+		}
 
-		if (timercmp_ge(&dt, &ev->tv)) {
-			heap_delmin(&sched->heap);
-			ev->cb(ev);
+		uint64_t now = elapsed_ms(sched);
+		uint64_t next = sched->current * TICK_MS;
+		if (now >= next) {
+			process_tick(sched);
 		} else {
-			/* Wait for next event or interrupt. Unlock calendar. */
-			struct timespec ts;
-			ts.tv_sec = ev->tv.tv_sec;
-			ts.tv_nsec = ev->tv.tv_usec * 1000L;
-			pthread_cond_timedwait(&sched->notify, &sched->heap_lock, &ts);
+			/* Wait for next tick or interrupt. Unlock calendar. */
+			uint64_t wait = next - now;
+			struct timeval tv;
+			gettimeofday(&tv, NULL);
+			struct timespec ts = {
+				.tv_sec = tv.tv_sec + wait / 1000,
+				.tv_nsec = tv.tv_usec * 1000L + (wait % 1000) * 1000000L
+			};
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec += 1;
+				ts.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&sched->notify, &sched->lock, &ts);
 		}
 	}
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->lock);
 
 	return KNOT_EOK;
 }
@@ -103,11 +165,17 @@ int evsched_init(evsched_t *sched, void *ctx)
 {
 	memset(sched, 0, sizeof(evsched_t));
 	sched->ctx = ctx;
+	sched->base = time_now();
 
 	/* Initialize event calendar. */
-	pthread_mutex_init(&sched->heap_lock, 0);
+	pthread_mutex_init(&sched->lock, 0);
 	pthread_cond_init(&sched->notify, 0);
-	heap_init(&sched->heap, compare_event_heap_nodes, 0);
+	init_list(&sched->due);
+	for (int level = 0; level < EVSCHED_WHEEL_LEVELS; level++) {
+		for (int i = 0; i < EVSCHED_WHEEL_SIZE; i++) {
+			init_list(&sched->wheel[level][i]);
+		}
+	}
 
 	sched->thread = dt_create(1, evsched_run, NULL, sched);
 
@@ -119,6 +187,15 @@ int evsched_init(evsched_t *sched, void *ctx)
 	return KNOT_EOK;
 }
 
+static void free_list(list_t *list)
+{
+	event_t *ev;
+	WALK_LIST_FIRST(ev, *list) {
+		rem_node(&ev->n);
+		evsched_event_free(ev);
+	}
+}
+
 void evsched_deinit(evsched_t *sched)
 {
 	if (sched == NULL) {
@@ -126,17 +203,18 @@ void evsched_deinit(evsched_t *sched)
 	}
 
 	/* Deinitialize event calendar. */
-	pthread_mutex_destroy(&sched->heap_lock);
+	pthread_mutex_destroy(&sched->lock);
 	pthread_cond_destroy(&sched->notify);
 
-	while (!EMPTY_HEAP(&sched->heap)) {
-		event_t *e = (event_t *)*HHEAD(&sched->heap);
-		heap_delmin(&sched->heap);
-		evsched_event_free(e);
+	if (sched->due.head.next != NULL) {
+		free_list(&sched->due);
+		for (int level = 0; level < EVSCHED_WHEEL_LEVELS; level++) {
+			for (int i = 0; i < EVSCHED_WHEEL_SIZE; i++) {
+				free_list(&sched->wheel[level][i]);
+			}
+		}
 	}
 
-	heap_deinit(&sched->heap);
-
 	if (sched->thread != NULL) {
 		dt_delete(&sched->thread);
 	}
@@ -163,7 +241,6 @@ event_t *evsched_event_create(evsched_t *sched, event_cb_t cb, void *data)
 	e->sched = sched;
 	e->cb = cb;
 	e->data = data;
-	e->hpos.pos=0;
 
 	return e;
 }
@@ -183,26 +260,38 @@ int evsched_schedule(event_t *ev, uint32_t dt)
 		return KNOT_EINVAL;
 	}
 
-	struct timeval new_time = timeval_in(dt);
-
 	evsched_t *sched = ev->sched;
 
 	/* Lock calendar. */
-	pthread_mutex_lock(&sched->heap_lock);
-
-	ev->tv = new_time;
+	pthread_mutex_lock(&sched->lock);
 
 	/* Make sure it's not already enqueued. */
-	int found = heap_find(&sched->heap, (heap_val_t *)ev);
-	if (found > 0) {
-		heap_replace(&sched->heap, found, (heap_val_t *)ev);
+	wheel_remove(sched, ev);
+
+	uint64_t now = elapsed_ms(sched);
+	bool notify = false;
+	if (dt == 0) {
+		add_tail(&sched->due, &ev->n);
+		ev->scheduled = true;
+		ev->expires = 0;
+		notify = true;
 	} else {
-		heap_insert(&sched->heap, (heap_val_t *)ev);
+		/* Skip the ticks of the empty wheel without processing them. */
+		if (sched->count == 0) {
+			sched->current = MAX(sched->current, now / TICK_MS);
+			notify = true;
+		}
+		/* Round up to the tick, never dispatch earlier than requested. */
+		ev->expires = MAX((now + dt + TICK_MS - 1) / TICK_MS, sched->current);
+		wheel_insert(sched, ev);
 	}
+	sched->count++;
 
 	/* Unlock calendar. */
-	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	if (notify) {
+		pthread_cond_signal(&sched->notify);
+	}
+	pthread_mutex_unlock(&sched->lock);
 
 	return KNOT_EOK;
 }
@@ -216,19 +305,15 @@ int evsched_cancel(event_t *ev)
 	evsched_t *sched = ev->sched;
 
 	/* Lock calendar. */
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->lock);
 
-	int found = heap_find(&sched->heap, (heap_val_t *)ev);
-	if (found > 0) {
-		heap_delete(&sched->heap, found);
-	}
+	wheel_remove(sched, ev);
 
 	/* Unlock calendar. */
-	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->lock);
 
 	/* Reset event timer. */
-	memset(&ev->tv, 0, sizeof(struct timeval));
+	ev->expires = 0;
 
 	return KNOT_EOK;
 }
@@ -240,10 +325,10 @@ void evsched_start(evsched_t *sched)
 
 void evsched_stop(evsched_t *sched)
 {
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->lock);
 	dt_stop(sched->thread);
 	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->lock);
 }
 
 void evsched_join(evsched_t *sched)
@@ -253,15 +338,15 @@ void evsched_join(evsched_t *sched)
 
 void evsched_pause(evsched_t *sched)
 {
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->lock);
 	sched->paused = true;
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->lock);
 }
 
 void evsched_resume(evsched_t *sched)
 {
-	pthread_mutex_lock(&sched->heap_lock);
+	pthread_mutex_lock(&sched->lock);
 	sched->paused = false;
 	pthread_cond_signal(&sched->notify);
-	pthread_mutex_unlock(&sched->heap_lock);
+	pthread_mutex_unlock(&sched->lock);
 }
@@ -16,6 +16,11 @@
 
 /*!
  * \brief Event scheduler.
+ *
+ * The scheduler is a hierarchical timing wheel with a one second tick,
+ * so scheduling and canceling of an event takes constant time. Events due
+ * within the same second are dispatched together in one batch, events with
+ * zero delay are dispatched immediately.
  */
 
 #pragma once
@@ -23,10 +28,13 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <sys/time.h>
 
 #include "knot/server/dthreads.h"
-#include "contrib/ucw/heap.h"
+#include "contrib/ucw/lists.h"
+
+#define EVSCHED_WHEEL_BITS   8
+#define EVSCHED_WHEEL_SIZE   (1 << EVSCHED_WHEEL_BITS)
+#define EVSCHED_WHEEL_LEVELS 3
 
 /* Forward decls. */
 struct evsched;
@@ -51,8 +59,9 @@ typedef void (*event_cb_t)(struct event *);
  * \brief Event structure.
  */
 typedef struct event {
-	struct heap_val hpos;
-	struct timeval tv; /*!< Event scheduled time. */
+	node_t n;          /*!< Node in a wheel slot. */
+	bool scheduled;    /*!< Is the event in a wheel slot? */
+	uint64_t expires;  /*!< Event scheduled tick. */
 	void *data;        /*!< Usable data ptr. */
 	event_cb_t cb;     /*!< Event callback. */
 	struct evsched *sched; /*!< Scheduler for this event. */
@@ -63,9 +72,13 @@ typedef struct event {
  */
 typedef struct evsched {
 	volatile bool paused;      /*!< Temporarily stop processing events. */
-	pthread_mutex_t heap_lock; /*!< Event heap locking. */
-	pthread_cond_t notify;     /*!< Event heap notification. */
-	struct heap heap;          /*!< Event heap. */
+	pthread_mutex_t lock;      /*!< Timing wheel locking. */
+	pthread_cond_t notify;     /*!< Timing wheel notification. */
+	struct timespec base;      /*!< Monotonic time of tick zero. */
+	uint64_t current;          /*!< Next tick to be processed. */
+	size_t count;              /*!< Number of events in the wheel. */
+	list_t due;                /*!< Events to be dispatched immediately. */
+	list_t wheel[EVSCHED_WHEEL_LEVELS][EVSCHED_WHEEL_SIZE]; /*!< Wheel slots. */
 	void *ctx;                 /*!< Scheduler context. */
 	dt_unit_t *thread;
 } evsched_t;
@@ -114,6 +127,8 @@ void evsched_event_free(event_t *ev);
  *       then it replaces this timer with the newer value.
  *       Running events are not canceled or waited for.
  *
+ * \note Non-zero delays are rounded up to whole seconds.
+ *
  * \param ev Prepared event.
  * \param dt Time difference in milliseconds from now (dt is relative).
  *
@@ -36,6 +36,8 @@ static int fdset_resize(fdset_t *set, const unsigned size)
 
 	MEM_RESIZE(set->ctx, size);
 	MEM_RESIZE(set->timeout, size);
+	MEM_RESIZE(set->wd_next, size);
+	MEM_RESIZE(set->wd_prev, size);
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
 	MEM_RESIZE(set->ev, size);
 #else
@@ -52,6 +54,9 @@ int fdset_init(fdset_t *set, const unsigned size)
 	}
 
 	memset(set, 0, sizeof(*set));
+	for (unsigned i = 0; i < FDSET_WHEEL_SIZE; i++) {
+		set->wheel[i] = FDSET_WHEEL_NONE;
+	}
 
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
 #ifdef HAVE_EPOLL
@@ -80,6 +85,8 @@ void fdset_clear(fdset_t *set)
 
 	free(set->ctx);
 	free(set->timeout);
+	free(set->wd_next);
+	free(set->wd_prev);
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
 	free(set->ev);
 	free(set->recv_ev);
@@ -90,6 +97,56 @@ void fdset_clear(fdset_t *set)
 	memset(set, 0, sizeof(*set));
 }
 
+static unsigned *wd_slot(fdset_t *set, time_t timeout)
+{
+	return &set->wheel[timeout % FDSET_WHEEL_SIZE];
+}
+
+static void wd_link(fdset_t *set, const unsigned idx)
+{
+	unsigned *head = wd_slot(set, set->timeout[idx]);
+	set->wd_prev[idx] = FDSET_WHEEL_NONE;
+	set->wd_next[idx] = *head;
+	if (*head != FDSET_WHEEL_NONE) {
+		set->wd_prev[*head] = idx;
+	}
+	*head = idx;
+}
+
+/*! \brief Points the neighbours of the fd in its slot to its index. */
+static void wd_relink(fdset_t *set, const unsigned idx)
+{
+	const unsigned prev = set->wd_prev[idx];
+	const unsigned next = set->wd_next[idx];
+	if (prev == FDSET_WHEEL_NONE) {
+		*wd_slot(set, set->timeout[idx]) = idx;
+	} else {
+		set->wd_next[prev] = idx;
+	}
+	if (next != FDSET_WHEEL_NONE) {
+		set->wd_prev[next] = idx;
+	}
+}
+
+static void wd_unlink(fdset_t *set, const unsigned idx)
+{
+	if (set->timeout[idx] == 0) {
+		return;
+	}
+
+	const unsigned prev = set->wd_prev[idx];
+	const unsigned next = set->wd_next[idx];
+	if (prev == FDSET_WHEEL_NONE) {
+		*wd_slot(set, set->timeout[idx]) = next;
+	} else {
+		set->wd_next[prev] = next;
+	}
+	if (next != FDSET_WHEEL_NONE) {
+		set->wd_prev[next] = prev;
+	}
+	set->timeout[idx] = 0;
+}
+
 int fdset_add(fdset_t *set, const int fd, const fdset_event_t events, void *ctx)
 {
 	if (set == NULL || fd < 0) {
@@ -158,12 +215,18 @@ int fdset_remove(fdset_t *set, const unsigned idx)
 	}
 #endif
 	close(fd);
+	wd_unlink(set, idx);
 
 	const unsigned last = --set->n;
 	/* Nothing else if it is the last one. Move last -> i if some remain. */
 	if (idx < last) {
 		set->ctx[idx] = set->ctx[last];
 		set->timeout[idx] = set->timeout[last];
+		if (set->timeout[idx] != 0) {
+			set->wd_next[idx] = set->wd_next[last];
+			set->wd_prev[idx] = set->wd_prev[last];
+			wd_relink(set, idx);
+		}
 #if defined(HAVE_EPOLL) || defined (HAVE_KQUEUE)
 		set->ev[idx] = set->ev[last];
 #ifdef HAVE_EPOLL
@@ -301,14 +364,15 @@ int fdset_set_watchdog(fdset_t *set, const unsigned idx, const int interval)
 	}
 
 	/* Lift watchdog if interval is negative. */
+	wd_unlink(set, idx);
 	if (interval < 0) {
-		set->timeout[idx] = 0;
 		return KNOT_EOK;
 	}
 
 	/* Update clock. */
 	const struct timespec now = time_now();
 	set->timeout[idx] = now.tv_sec + interval; /* Only seconds precision. */
+	wd_link(set, idx);
 
 	return KNOT_EOK;
 }
@@ -321,16 +385,26 @@ void fdset_sweep(fdset_t *set, const fdset_sweep_cb_t cb, void *data)
 
 	/* Get time threshold. */
 	const struct timespec now = time_now();
-	unsigned idx = 0;
-	while (idx < set->n) {
-		/* Check sweep state, remove if requested. */
-		if (set->timeout[idx] > 0 && set->timeout[idx] <= now.tv_sec) {
-			const int fd = fdset_get_fd(set, idx);
-			if (cb(set, fd, data) == FDSET_SWEEP) {
+
+	/* The last swept slot is checked again for the timeouts set later
+	 * within the same second. */
+	time_t from = MAX(set->swept, now.tv_sec - FDSET_WHEEL_SIZE + 1);
+	for (time_t t = from; t <= now.tv_sec; t++) {
+		unsigned idx = *wd_slot(set, t);
+		while (idx != FDSET_WHEEL_NONE) {
+			unsigned next = set->wd_next[idx];
+			/* Check sweep state, remove if requested. */
+			if (set->timeout[idx] <= now.tv_sec &&
+			    cb(set, idx, data) == FDSET_SWEEP) {
+				const unsigned last = set->n - 1;
 				(void)fdset_remove(set, idx);
-				continue;
+				/* The last fd is moved to the removed index. */
+				if (next == last && set->n == last) {
+					next = idx;
+				}
 			}
+			idx = next;
 		}
-		++idx;
 	}
+	set->swept = now.tv_sec;
 }
@@ -36,6 +36,8 @@
 #include "libknot/errcode.h"
 
 #define FDSET_RESIZE_STEP	256
+#define FDSET_WHEEL_SIZE	64	/*!< Watchdog wheel slots (one second each). */
+#define FDSET_WHEEL_NONE	~0U
 #ifdef HAVE_EPOLL
 #define FDSET_REMOVE_FLAG	~0U
 #endif
@@ -46,6 +48,10 @@ typedef struct {
 	unsigned size;                /*!< Array size (allocated). */
 	void **ctx;                   /*!< Context for each fd. */
 	time_t *timeout;              /*!< Timeout for each fd (seconds precision). */
+	unsigned *wd_next;            /*!< Next fd in the same watchdog wheel slot. */
+	unsigned *wd_prev;            /*!< Previous fd in the same watchdog wheel slot. */
+	unsigned wheel[FDSET_WHEEL_SIZE]; /*!< First fd in each watchdog wheel slot. */
+	time_t swept;                 /*!< Time of the last sweep. */
 #if defined(HAVE_EPOLL) || defined(HAVE_KQUEUE)
 #ifdef HAVE_EPOLL
 	struct epoll_event *ev;       /*!< Epoll event storage for each fd. */
@@ -96,7 +102,7 @@ typedef enum {
 } fdset_sweep_state_t;
 
 /*! \brief Sweep callback (set, index, data) */
-typedef fdset_sweep_state_t (*fdset_sweep_cb_t)(fdset_t *, int, void *);
+typedef fdset_sweep_state_t (*fdset_sweep_cb_t)(fdset_t *, unsigned, void *);
 
 /*!
  * \brief Initialize fdset to given size.
@@ -161,6 +167,9 @@ int fdset_poll(fdset_t *set, fdset_it_t *it, const unsigned offset, const int ti
  * of N seconds between socket activity. If socket is not active within
  * <now, now + interval>, it is sweeped and closed.
  *
+ * The watched fds are kept in a wheel of per-second slots by their timeouts,
+ * so a sweep visits only the slots passed since the previous one.
+ *
  * \param set       Target set.
  * \param idx       Index of the file descriptor.
  * \param interval  Allowed interval without activity (seconds).
@@ -173,6 +182,10 @@ int fdset_set_watchdog(fdset_t *set, const unsigned idx, const int interval);
 /*!
  * \brief Sweep file descriptors with exceeding inactivity period.
  *
+ * Only the fds in the watchdog wheel slots passed since the last sweep
+ * are checked. If the callback keeps an expired fd, it's checked again
+ * one wheel revolution later.
+ *
  * \param set   Target set.
  * \param cb    Callback for sweeped descriptors.
  * \param data  Pointer to extra data.
@@ -201,6 +214,21 @@ inline static int fdset_get_fd(const fdset_t *set, const unsigned idx)
 #endif
 }
 
+/*!
+ * \brief Returns context of the file descriptor based on index.
+ *
+ * \param set  Target set.
+ * \param idx  Index of the file descriptor.
+ *
+ * \retval Context passed to fdset_add().
+ */
+inline static void *fdset_get_ctx(const fdset_t *set, const unsigned idx)
+{
+	assert(set && idx < set->n);
+
+	return set->ctx[idx];
+}
+
 /*!
  * \brief Returns number of file descriptors stored in set.
  *
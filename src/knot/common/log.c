@@ -14,6 +14,9 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,12 +34,18 @@
 
 #include "knot/common/log.h"
 #include "libknot/libknot.h"
+#include "contrib/openbsd/strlcpy.h"
 #include "contrib/ucw/lists.h"
 
 /*! Single log message buffer length (one line). */
 #define LOG_BUFLEN	512
 #define NULL_ZONE_STR	"?"
 
+/*! Messages waiting for the asynchronous targets per thread. */
+#define LOG_RING_SIZE	256
+/*! [ms] Writer thread sleep if not woken up. */
+#define LOG_WRITER_IDLE	1000
+
 #ifdef ENABLE_SYSTEMD
 int use_journal = 0;
 #endif
@@ -48,11 +57,55 @@ typedef struct {
 	size_t file_count;   /*!< Open files count. */
 	FILE **file;         /*!< Open files. */
 	log_flag_t flags;    /*!< Formatting flags. */
+	bool *async;         /*!< Targets written by the writer thread. */
+	bool async_any;      /*!< Some target is asynchronous. */
 } log_t;
 
 /*! Log singleton. */
 log_t *s_log = NULL;
 
+/*! Message waiting for the asynchronous targets. */
+typedef struct {
+	struct timeval tv;
+	int level;
+	log_source_t src;
+	uint16_t zone_off;     /*!< Position of the zone name in the message. */
+	uint16_t zone_len;     /*!< Length of the zone name (0 if none). */
+	char param[32];        /*!< Journal parameter (empty if none). */
+	char msg[LOG_BUFLEN];
+} log_entry_t;
+
+/*! Message ring of one thread, written by the thread, read by the writer. */
+typedef struct log_ring {
+	struct log_ring *next;
+	uint32_t head;         /*!< Next slot to be written. */
+	uint32_t tail;         /*!< Next slot to be read. */
+	uint64_t dropped;      /*!< Messages lost due to the full ring. */
+	bool orphan;           /*!< The thread has exited, freed when drained. */
+	log_entry_t slot[LOG_RING_SIZE];
+} log_ring_t;
+
+/*! Writer thread of the asynchronous targets. */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_once_t once;
+	pthread_key_t key;     /*!< Marks the ring of an exiting thread. */
+	pthread_t thread;
+	log_ring_t *rings;     /*!< Rings of all the logging threads. */
+	uint64_t dropped;      /*!< Lost messages in the freed rings. */
+	uint64_t reported;     /*!< Lost messages already logged. */
+	bool running;
+	bool terminate;
+	bool sleeping;
+} s_async = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.once = PTHREAD_ONCE_INIT,
+};
+
+static __thread log_ring_t *s_ring = NULL;
+
 static bool log_isopen(void)
 {
 	return s_log != NULL;
@@ -70,6 +123,7 @@ static void sink_free(log_t *log)
 	}
 	free(log->target);
 	free(log->file);
+	free(log->async);
 	free(log);
 }
 
@@ -95,10 +149,18 @@ static log_t *sink_setup(size_t file_count)
 	}
 	memset(log->target, 0, LOG_SOURCE_ANY * sizeof(int) * log->target_count);
 
+	log->async = calloc(log->target_count, sizeof(bool));
+	if (log->async == NULL) {
+		free(log->target);
+		free(log);
+		return NULL;
+	}
+
 	// Reserve space for log files.
 	if (file_count > 0) {
 		log->file = malloc(sizeof(FILE *) * file_count);
 		if (!log->file) {
+			free(log->async);
 			free(log->target);
 			free(log);
 			return NULL;
@@ -149,6 +211,308 @@ static void sink_levels_add(log_t *log, log_target_t target, log_source_t src, i
 	}
 }
 
+static bool is_async(log_t *log, int target)
+{
+	return log->async[target] && __atomic_load_n(&s_async.running, __ATOMIC_ACQUIRE);
+}
+
+/*!
+ * \brief Writes the message to the targets.
+ *
+ * \param async  Write to the asynchronous targets only, or to the other ones.
+ * \param tv     Time of the message (NULL for now).
+ */
+static void emit_log_msg(log_t *log, int level, log_source_t src, const char *zone,
+                         size_t zone_len, const char *msg, const char *param,
+                         bool async, const struct timeval *tv)
+{
+	// Syslog target.
+	if (*src_levels(log, LOG_TARGET_SYSLOG, src) & LOG_MASK(level) &&
+	    is_async(log, LOG_TARGET_SYSLOG) == async) {
+#ifdef ENABLE_SYSTEMD
+		if (use_journal) {
+			char *zone_fmt = zone ? "ZONE=%.*s." : NULL;
+			sd_journal_send("PRIORITY=%d", level,
+			                "MESSAGE=%s", msg,
+			                zone_fmt, zone_len, zone,
+			                param, NULL);
+		} else
+#endif
+		{
+			syslog(level, "%s", msg);
+		}
+	}
+
+	// Prefix date and time.
+	char tstr[LOG_BUFLEN] = { 0 };
+	if (!(log->flags & LOG_FLAG_NOTIMESTAMP)) {
+		struct tm lt;
+		struct timeval now;
+		if (tv == NULL) {
+			gettimeofday(&now, NULL);
+			tv = &now;
+		}
+		time_t sec = tv->tv_sec;
+		if (localtime_r(&sec, &lt) != NULL) {
+			strftime(tstr, sizeof(tstr), KNOT_LOG_TIME_FORMAT " ", &lt);
+		}
+	}
+
+	// Other log targets.
+	for (int i = LOG_TARGET_STDERR; i < LOG_TARGET_FILE + log->file_count; ++i) {
+		if (*src_levels(log, i, src) & LOG_MASK(level) && is_async(log, i) == async) {
+			FILE *stream;
+			switch (i) {
+			case LOG_TARGET_STDERR: stream = stderr; break;
+			case LOG_TARGET_STDOUT: stream = stdout; break;
+			default: stream = log->file[i - LOG_TARGET_FILE]; break;
+			}
+
+			// Print the message.
+			fprintf(stream, "%s%s\n", tstr, msg);
+			if (stream == stdout) {
+				fflush(stream);
+			}
+		}
+	}
+}
+
+static bool want_async(log_t *log, int level, log_source_t src)
+{
+	if (!log->async_any || !__atomic_load_n(&s_async.running, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+
+	for (int i = LOG_TARGET_SYSLOG; i < LOG_TARGET_FILE + log->file_count; ++i) {
+		if (log->async[i] && *src_levels(log, i, src) & LOG_MASK(level)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void ring_exit(void *ptr)
+{
+	// Freed by the writer thread once drained.
+	log_ring_t *ring = ptr;
+	__atomic_store_n(&ring->orphan, true, __ATOMIC_RELEASE);
+}
+
+static void ring_key_init(void)
+{
+	(void)pthread_key_create(&s_async.key, ring_exit);
+}
+
+static log_ring_t *ring_get(void)
+{
+	if (s_ring != NULL) {
+		return s_ring;
+	}
+
+	log_ring_t *ring = calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		return NULL;
+	}
+
+	(void)pthread_once(&s_async.once, ring_key_init);
+	(void)pthread_setspecific(s_async.key, ring);
+
+	pthread_mutex_lock(&s_async.lock);
+	ring->next = s_async.rings;
+	s_async.rings = ring;
+	pthread_mutex_unlock(&s_async.lock);
+
+	s_ring = ring;
+	return ring;
+}
+
+/*! \brief Passes the message to the writer thread, dropped if it lags behind. */
+static void enqueue_log_msg(int level, log_source_t src, size_t zone_off,
+                            size_t zone_len, const char *msg, const char *param)
+{
+	log_ring_t *ring = ring_get();
+	if (ring == NULL) {
+		return;
+	}
+
+	uint32_t head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE) {
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	log_entry_t *entry = &ring->slot[head % LOG_RING_SIZE];
+	gettimeofday(&entry->tv, NULL);
+	entry->level = level;
+	entry->src = src;
+	entry->zone_off = zone_off;
+	entry->zone_len = zone_len;
+	strlcpy(entry->param, (param != NULL) ? param : "", sizeof(entry->param));
+	strlcpy(entry->msg, msg, sizeof(entry->msg));
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	if (__atomic_load_n(&s_async.sleeping, __ATOMIC_SEQ_CST)) {
+		pthread_cond_signal(&s_async.wake);
+	}
+}
+
+static unsigned ring_drain(log_ring_t *ring)
+{
+	uint32_t tail = ring->tail;
+	uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	unsigned count = head - tail;
+
+	for (; tail != head; tail++) {
+		log_entry_t *entry = &ring->slot[tail % LOG_RING_SIZE];
+		const char *zone = (entry->zone_len > 0) ? entry->msg + entry->zone_off : NULL;
+		const char *param = (entry->param[0] != '\0') ? entry->param : NULL;
+
+		rcu_read_lock();
+		log_t *log = s_log;
+		if (log != NULL) {
+			emit_log_msg(log, entry->level, entry->src, zone, entry->zone_len,
+			             entry->msg, param, true, &entry->tv);
+		}
+		rcu_read_unlock();
+
+		__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	return count;
+}
+
+static void report_dropped(uint64_t dropped)
+{
+	char msg[LOG_BUFLEN];
+	(void)snprintf(msg, sizeof(msg), "warning: logging, dropped %"PRIu64" messages",
+	               dropped - s_async.reported);
+	s_async.reported = dropped;
+
+	rcu_read_lock();
+	log_t *log = s_log;
+	if (log != NULL) {
+		emit_log_msg(log, LOG_WARNING, LOG_SOURCE_SERVER, NULL, 0, msg, NULL,
+		             true, NULL);
+	}
+	rcu_read_unlock();
+}
+
+static bool rings_pending(void)
+{
+	for (log_ring_t *ring = s_async.rings; ring != NULL; ring = ring->next) {
+		if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != ring->tail) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*! \brief Frees the drained rings of the exited threads, must be locked. */
+static uint64_t rings_collect(void)
+{
+	uint64_t dropped = s_async.dropped;
+	log_ring_t **it = &s_async.rings;
+	while (*it != NULL) {
+		log_ring_t *ring = *it;
+		uint64_t ring_dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+		if (__atomic_load_n(&ring->orphan, __ATOMIC_ACQUIRE) &&
+		    __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail) {
+			s_async.dropped += ring_dropped;
+			*it = ring->next;
+			free(ring);
+		} else {
+			it = &ring->next;
+		}
+		dropped += ring_dropped;
+	}
+	return dropped;
+}
+
+static void *log_writer(_unused_ void *arg)
+{
+	rcu_register_thread();
+
+	while (true) {
+		pthread_mutex_lock(&s_async.lock);
+		bool terminate = s_async.terminate;
+		// New rings are only prepended, so the list can be walked unlocked.
+		log_ring_t *rings = s_async.rings;
+		pthread_mutex_unlock(&s_async.lock);
+
+		unsigned count = 0;
+		for (log_ring_t *ring = rings; ring != NULL; ring = ring->next) {
+			count += ring_drain(ring);
+		}
+
+		pthread_mutex_lock(&s_async.lock);
+		uint64_t dropped = rings_collect();
+		pthread_mutex_unlock(&s_async.lock);
+		if (dropped > s_async.reported) {
+			report_dropped(dropped);
+		}
+
+		pthread_mutex_lock(&s_async.lock);
+		if (count == 0 && terminate) {
+			pthread_mutex_unlock(&s_async.lock);
+			break;
+		}
+		if (count == 0 && !s_async.terminate) {
+			__atomic_store_n(&s_async.sleeping, true, __ATOMIC_SEQ_CST);
+			if (!rings_pending()) {
+				struct timespec ts;
+				clock_gettime(CLOCK_REALTIME, &ts);
+				ts.tv_sec += LOG_WRITER_IDLE / 1000;
+				(void)pthread_cond_timedwait(&s_async.wake, &s_async.lock, &ts);
+			}
+			__atomic_store_n(&s_async.sleeping, false, __ATOMIC_SEQ_CST);
+		}
+		pthread_mutex_unlock(&s_async.lock);
+	}
+
+	rcu_unregister_thread();
+	return NULL;
+}
+
+static void log_writer_start(void)
+{
+	pthread_mutex_lock(&s_async.lock);
+	if (!s_async.running) {
+		/* The writer mustn't receive the server signals. */
+		sigset_t all, orig;
+		sigfillset(&all);
+		pthread_sigmask(SIG_SETMASK, &all, &orig);
+
+		bool running = (pthread_create(&s_async.thread, NULL, log_writer, NULL) == 0);
+		__atomic_store_n(&s_async.running, running, __ATOMIC_RELEASE);
+
+		pthread_sigmask(SIG_SETMASK, &orig, NULL);
+	}
+	pthread_mutex_unlock(&s_async.lock);
+}
+
+static void log_writer_stop(void)
+{
+	pthread_mutex_lock(&s_async.lock);
+	if (!s_async.running) {
+		pthread_mutex_unlock(&s_async.lock);
+		return;
+	}
+	s_async.terminate = true;
+	pthread_cond_signal(&s_async.wake);
+	pthread_mutex_unlock(&s_async.lock);
+
+	// The remaining messages are written before the thread exits.
+	pthread_join(s_async.thread, NULL);
+
+	pthread_mutex_lock(&s_async.lock);
+	__atomic_store_n(&s_async.running, false, __ATOMIC_RELEASE);
+	s_async.terminate = false;
+	(void)rings_collect();
+	pthread_mutex_unlock(&s_async.lock);
+}
+
 void log_init(void)
 {
 	// Setup initial state.
@@ -178,6 +542,7 @@ void log_init(void)
 
 void log_close(void)
 {
+	log_writer_stop();
 	sink_publish(NULL);
 
 	fflush(stdout);
@@ -207,58 +572,6 @@ void log_levels_add(log_target_t target, log_source_t src, int levels)
 	}
 }
 
-static void emit_log_msg(int level, log_source_t src, const char *zone,
-                         size_t zone_len, const char *msg, const char *param)
-{
-	log_t *log = s_log;
-
-	// Syslog target.
-	if (*src_levels(log, LOG_TARGET_SYSLOG, src) & LOG_MASK(level)) {
-#ifdef ENABLE_SYSTEMD
-		if (use_journal) {
-			char *zone_fmt = zone ? "ZONE=%.*s." : NULL;
-			sd_journal_send("PRIORITY=%d", level,
-			                "MESSAGE=%s", msg,
-			                zone_fmt, zone_len, zone,
-			                param, NULL);
-		} else
-#endif
-		{
-			syslog(level, "%s", msg);
-		}
-	}
-
-	// Prefix date and time.
-	char tstr[LOG_BUFLEN] = { 0 };
-	if (!(s_log->flags & LOG_FLAG_NOTIMESTAMP)) {
-		struct tm lt;
-		struct timeval tv;
-		gettimeofday(&tv, NULL);
-		time_t sec = tv.tv_sec;
-		if (localtime_r(&sec, &lt) != NULL) {
-			strftime(tstr, sizeof(tstr), KNOT_LOG_TIME_FORMAT " ", &lt);
-		}
-	}
-
-	// Other log targets.
-	for (int i = LOG_TARGET_STDERR; i < LOG_TARGET_FILE + log->file_count; ++i) {
-		if (*src_levels(log, i, src) & LOG_MASK(level)) {
-			FILE *stream;
-			switch (i) {
-			case LOG_TARGET_STDERR: stream = stderr; break;
-			case LOG_TARGET_STDOUT: stream = stdout; break;
-			default: stream = log->file[i - LOG_TARGET_FILE]; break;
-			}
-
-			// Print the message.
-			fprintf(stream, "%s%s\n", tstr, msg);
-			if (stream == stdout) {
-				fflush(stream);
-			}
-		}
-	}
-}
-
 static const char *level_prefix(int level)
 {
 	switch (level) {
@@ -315,6 +628,7 @@ static void log_msg_text(int level, log_source_t src, const char *zone,
 
 	// Prefix zone name.
 	size_t zone_len = 0;
+	size_t zone_off = write - buff + 1;
 	if (zone != NULL) {
 		zone_len = strlen(zone);
 		if (zone_len > 0 && zone[zone_len - 1] == '.') {
@@ -332,7 +646,10 @@ static void log_msg_text(int level, log_source_t src, const char *zone,
 	int ret = vsnprintf(write, capacity, fmt, args);
 	if (ret >= 0) {
 		// Send to logging targets.
-		emit_log_msg(level, src, zone, zone_len, buff, param);
+		emit_log_msg(s_log, level, src, zone, zone_len, buff, param, false, NULL);
+		if (want_async(s_log, level, src)) {
+			enqueue_log_msg(level, src, zone_off, zone_len, buff, param);
+		}
 	}
 
 	rcu_read_unlock();
@@ -466,6 +783,13 @@ void log_reconfigure(conf_t *conf)
 		conf_val_t levels_val;
 		unsigned levels;
 
+		// Set asynchronous writing.
+		conf_val_t async_val = conf_id_get(conf, C_LOG, C_ASYNC, &id);
+		if (conf_bool(&async_val)) {
+			log->async[target] = true;
+			log->async_any = true;
+		}
+
 		// Set SERVER logging.
 		levels_val = conf_id_get(conf, C_LOG, C_SERVER, &id);
 		levels = conf_opt(&levels_val);
@@ -487,5 +811,10 @@ void log_reconfigure(conf_t *conf)
 		sink_levels_add(log, target, LOG_SOURCE_ANY, levels);
 	}
 
+	bool async = log->async_any;
 	sink_publish(log);
+
+	if (async) {
+		log_writer_start();
+	}
 }
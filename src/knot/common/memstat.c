@@ -0,0 +1,125 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <urcu.h>
+
+#include "knot/common/memstat.h"
+#include "knot/journal/knot_lmdb.h"
+#include "knot/zone/measure.h"
+
+static mm_account_t accounts[MEMSTAT_TAGS];
+static knot_mm_t arenas[MEMSTAT_TAGS];
+static pthread_once_t arenas_once = PTHREAD_ONCE_INIT;
+
+// Serializes the updates of the cached zone measurements.
+static pthread_mutex_t zone_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void arenas_init(void)
+{
+	for (memstat_tag_t tag = 0; tag < MEMSTAT_TAGS; tag++) {
+		mm_ctx_accounted(&arenas[tag], &accounts[tag]);
+	}
+}
+
+knot_mm_t *memstat_mm(memstat_tag_t tag)
+{
+	pthread_once(&arenas_once, arenas_init);
+	return &arenas[tag];
+}
+
+uint64_t memstat_get(memstat_tag_t tag)
+{
+	return __atomic_load_n(&accounts[tag].bytes, __ATOMIC_RELAXED);
+}
+
+void memstat_pool_update(memstat_tag_t tag, size_t *accounted, size_t size)
+{
+	if (size > *accounted) {
+		__atomic_add_fetch(&accounts[tag].bytes, size - *accounted, __ATOMIC_RELAXED);
+	} else if (size < *accounted) {
+		__atomic_sub_fetch(&accounts[tag].bytes, *accounted - size, __ATOMIC_RELAXED);
+	}
+	*accounted = size;
+}
+
+void memstat_zone(zone_t *zone, zone_memory_t *mem)
+{
+	rcu_read_lock();
+	zone_contents_t *contents = rcu_dereference(zone->contents);
+	if (contents == NULL) {
+		rcu_read_unlock();
+		memset(mem, 0, sizeof(*mem));
+		return;
+	}
+	uint32_t serial = zone_contents_serial(contents);
+
+	pthread_mutex_lock(&zone_lock);
+	// The serial guards against reuse of the address by new contents.
+	if (zone->memory.contents != contents || zone->memory.serial != serial) {
+		knot_measure_memory(contents, &zone->memory.mem);
+		zone->memory.contents = contents;
+		zone->memory.serial = serial;
+	}
+	*mem = zone->memory.mem;
+	pthread_mutex_unlock(&zone_lock);
+	rcu_read_unlock();
+}
+
+static void add_zone(zone_t *zone, zone_memory_t *total)
+{
+	zone_memory_t mem;
+	memstat_zone(zone, &mem);
+
+	total->trees += mem.trees;
+	total->nodes += mem.nodes;
+	total->rdata += mem.rdata;
+	total->additionals += mem.additionals;
+}
+
+void memstat_zones(server_t *server, zone_memory_t *mem)
+{
+	memset(mem, 0, sizeof(*mem));
+	knot_zonedb_foreach(server->zone_db, add_zone, mem);
+}
+
+uint64_t memstat_journal(server_t *server)
+{
+	uint64_t total = 0;
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		total += knot_lmdb_resident(&server->journaldb[i]);
+	}
+	return total;
+}
+
+uint64_t memstat_rss(void)
+{
+	uint64_t rss = 0;
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f != NULL) {
+		unsigned long size, resident;
+		if (fscanf(f, "%lu %lu", &size, &resident) == 2) {
+			rss = (uint64_t)resident * sysconf(_SC_PAGESIZE);
+		}
+		fclose(f);
+	}
+#endif
+	return rss;
+}
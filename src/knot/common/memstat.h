@@ -0,0 +1,76 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Memory accounting of the zones and server subsystems.
+ */
+
+#pragma once
+
+#include "contrib/mempattern.h"
+#include "knot/server/server.h"
+
+/*! \brief Subsystems with tagged (accounted) memory. */
+typedef enum {
+	MEMSTAT_MODULES = 0,  /*!< Tables of the query modules. */
+	MEMSTAT_THREAD_POOLS, /*!< Memory pools of the answering threads. */
+	MEMSTAT_TAGS
+} memstat_tag_t;
+
+/*!
+ * \brief Returns the allocation arena of the subsystem.
+ *
+ * The returned context is valid for the whole run of the program.
+ */
+knot_mm_t *memstat_mm(memstat_tag_t tag);
+
+/*!
+ * \brief Returns the memory currently allocated by the subsystem.
+ */
+uint64_t memstat_get(memstat_tag_t tag);
+
+/*!
+ * \brief Updates the contribution of a memory pool to the subsystem.
+ *
+ * \param tag         Subsystem.
+ * \param accounted   Previously accounted size of the pool, updated.
+ * \param size        Current size of the pool (0 when it is deleted).
+ */
+void memstat_pool_update(memstat_tag_t tag, size_t *accounted, size_t size);
+
+/*!
+ * \brief Returns the memory used by the zone contents.
+ *
+ * The result is cached until the contents change.
+ */
+void memstat_zone(zone_t *zone, zone_memory_t *mem);
+
+/*!
+ * \brief Returns the memory used by the contents of all the zones.
+ *
+ * \note Must be called within RCU read section (zone database).
+ */
+void memstat_zones(server_t *server, zone_memory_t *mem);
+
+/*!
+ * \brief Returns the resident size of the journal databases memory maps.
+ */
+uint64_t memstat_journal(server_t *server);
+
+/*!
+ * \brief Returns the resident set size of the process.
+ */
+uint64_t memstat_rss(void);
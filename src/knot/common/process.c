@@ -103,17 +103,19 @@ static int pid_write(const char *filename, pid_t pid)
 	return ret;
 }
 
-unsigned long pid_check_and_create(void)
+unsigned long pid_check_and_create(pid_t predecessor)
 {
 	struct stat st;
 	char *pidfile = pid_filename();
 	pid_t pid = pid_read(pidfile);
 
 	/* Check PID for existence and liveness. */
-	if (pid > 0 && pid_running(pid)) {
+	if (pid > 0 && pid != predecessor && pid_running(pid)) {
 		log_fatal("server PID found, already running");
 		free(pidfile);
 		return 0;
+	} else if (pid > 0 && pid == predecessor) {
+		pid_cleanup(); /* Replaced by the successor. */
 	} else if (stat(pidfile, &st) == 0) {
 		log_warning("removing stale PID file '%s'", pidfile);
 		pid_cleanup();
@@ -26,10 +26,12 @@
 /*!
  * \brief Check if PID file exists and create it if possible.
  *
+ * \param predecessor  PID of the server being taken over (hot restart), or 0.
+ *
  * \retval 0 if failed.
  * \retval Current PID.
  */
-unsigned long pid_check_and_create(void);
+unsigned long pid_check_and_create(pid_t predecessor);
 
 /*!
  * \brief Remove PID file.
@@ -0,0 +1,167 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <urcu.h>
+
+#include "knot/common/reclaim.h"
+#include "libknot/attribute.h"
+
+typedef struct reclaim_item {
+	struct reclaim_item *next;
+	void *ptr;
+	reclaim_free_t free_cb;
+	size_t size;
+} reclaim_item_t;
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+	reclaim_item_t *queue;  // Objects waiting for the next grace period.
+	uint64_t queued;        // Number of objects ever queued.
+	uint64_t freed;         // Number of objects ever freed by the thread.
+	uint64_t pending;       // Size of the objects not freed yet.
+	pthread_t thread;
+	bool running;
+	bool terminate;
+} rc = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+};
+
+static void *reclaim_main(_unused_ void *arg)
+{
+	pthread_mutex_lock(&rc.lock);
+	while (true) {
+		while (!rc.terminate && rc.queue == NULL) {
+			pthread_cond_wait(&rc.wake, &rc.lock);
+		}
+		if (rc.queue == NULL) {
+			break; // Terminating and nothing left.
+		}
+
+		reclaim_item_t *batch = rc.queue;
+		rc.queue = NULL;
+		uint64_t queued = rc.queued;
+		pthread_mutex_unlock(&rc.lock);
+
+		// One grace period for the whole batch.
+		synchronize_rcu();
+
+		size_t size = 0;
+		while (batch != NULL) {
+			reclaim_item_t *next = batch->next;
+			batch->free_cb(batch->ptr);
+			size += batch->size;
+			free(batch);
+			batch = next;
+		}
+		__atomic_sub_fetch(&rc.pending, size, __ATOMIC_RELAXED);
+
+		pthread_mutex_lock(&rc.lock);
+		rc.freed = queued;
+		pthread_cond_broadcast(&rc.done);
+	}
+	pthread_mutex_unlock(&rc.lock);
+
+	return NULL;
+}
+
+/*! \brief Starts the helper thread if not running, must be locked. */
+static void reclaim_start(void)
+{
+	if (rc.running || rc.terminate) {
+		return;
+	}
+
+	/* The helper mustn't receive the server signals. */
+	sigset_t all, orig;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &orig);
+
+	rc.running = (pthread_create(&rc.thread, NULL, reclaim_main, NULL) == 0);
+
+	pthread_sigmask(SIG_SETMASK, &orig, NULL);
+}
+
+void reclaim_defer(void *ptr, reclaim_free_t free_cb, size_t size)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	reclaim_item_t *item = malloc(sizeof(*item));
+
+	pthread_mutex_lock(&rc.lock);
+	if (item != NULL) {
+		reclaim_start();
+	}
+	if (item == NULL || !rc.running || rc.terminate) {
+		pthread_mutex_unlock(&rc.lock);
+		free(item);
+		synchronize_rcu();
+		free_cb(ptr);
+		return;
+	}
+
+	item->ptr = ptr;
+	item->free_cb = free_cb;
+	item->size = size;
+	item->next = rc.queue;
+	rc.queue = item;
+	rc.queued++;
+	__atomic_add_fetch(&rc.pending, size, __ATOMIC_RELAXED);
+	pthread_cond_signal(&rc.wake);
+	pthread_mutex_unlock(&rc.lock);
+}
+
+void reclaim_barrier(void)
+{
+	pthread_mutex_lock(&rc.lock);
+	uint64_t target = rc.queued;
+	while (rc.running && rc.freed < target) {
+		pthread_cond_wait(&rc.done, &rc.lock);
+	}
+	pthread_mutex_unlock(&rc.lock);
+}
+
+void reclaim_deinit(void)
+{
+	pthread_mutex_lock(&rc.lock);
+	bool running = rc.running;
+	rc.terminate = true;
+	pthread_cond_signal(&rc.wake);
+	pthread_mutex_unlock(&rc.lock);
+
+	if (running) {
+		pthread_join(rc.thread, NULL);
+	}
+
+	pthread_mutex_lock(&rc.lock);
+	rc.running = false;
+	rc.terminate = false;
+	pthread_mutex_unlock(&rc.lock);
+}
+
+uint64_t reclaim_pending(void)
+{
+	return __atomic_load_n(&rc.pending, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,61 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Deferred release of memory still visible to RCU readers.
+ *
+ * Instead of waiting for the RCU grace period, the caller hands the replaced
+ * object over to a helper thread. The helper thread waits for one grace period
+ * for all the objects queued meanwhile and frees them afterwards. The thread
+ * is created on demand; if it isn't available, the object is freed
+ * synchronously.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \brief Callback freeing the deferred object.
+ */
+typedef void (*reclaim_free_t)(void *ptr);
+
+/*!
+ * \brief Frees the object after the current RCU readers finish.
+ *
+ * \note Must not be called within RCU read-side critical section.
+ *
+ * \param ptr      Object to be freed (NULL is ignored).
+ * \param free_cb  Callback freeing the object.
+ * \param size     Approximate size of the object for the statistics.
+ */
+void reclaim_defer(void *ptr, reclaim_free_t free_cb, size_t size);
+
+/*!
+ * \brief Waits until all the objects deferred so far are freed.
+ */
+void reclaim_barrier(void);
+
+/*!
+ * \brief Frees all the deferred objects and joins the helper thread.
+ */
+void reclaim_deinit(void);
+
+/*!
+ * \brief Returns the total size of the objects waiting to be freed.
+ */
+uint64_t reclaim_pending(void);
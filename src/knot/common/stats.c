@@ -14,22 +14,40 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
 #include <inttypes.h>
+#include <stdlib.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 #include <urcu.h>
 
+#include "contrib/ctype.h"
 #include "contrib/files.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
 #include "knot/common/stats.h"
 #include "knot/common/log.h"
+#include "knot/common/memstat.h"
+#include "knot/common/reclaim.h"
+#include "knot/dnssec/sign-pool.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/zone/cold-rdata.h"
+#include "knot/zone/mapped-rdata.h"
+#include "knot/zone/shared-rdata.h"
+#include "libknot/xdp.h"
 
 struct {
 	bool active_dumper;
 	pthread_t dumper;
 	uint32_t timer;
 	server_t *server;
+	bool active_exporter;
+	pthread_t exporter;
+	int exporter_fd;
+	struct sockaddr_storage exporter_addr;
+	uint32_t zone_limit;
 } stats = { 0 };
 
 typedef struct {
@@ -51,24 +69,399 @@ uint64_t server_zone_count(server_t *server)
 	return knot_zonedb_size(server->zone_db);
 }
 
+uint64_t server_udp_gso_msgs(server_t *server)
+{
+	return ATOMIC_GET(server->stats.udp_gso_msgs);
+}
+
+uint64_t server_udp_gso_segs(server_t *server)
+{
+	return ATOMIC_GET(server->stats.udp_gso_segs);
+}
+
+uint64_t server_refresh_suppressed(server_t *server)
+{
+	return ATOMIC_GET(server->stats.refresh_suppressed);
+}
+
+uint64_t server_reclaim_pending(_unused_ server_t *server)
+{
+	return reclaim_pending();
+}
+
+uint64_t server_dnssec_signatures(_unused_ server_t *server)
+{
+	return sign_pool_signatures();
+}
+
+uint64_t server_dnssec_signing_rate(_unused_ server_t *server)
+{
+	return sign_pool_rate();
+}
+
+uint64_t server_memory_rss(_unused_ server_t *server)
+{
+	return memstat_rss();
+}
+
+#define MEMORY_ZONE_ITEM(name) \
+	static uint64_t server_memory_zone_##name(server_t *server) { \
+		zone_memory_t mem; \
+		memstat_zones(server, &mem); \
+		return mem.name; \
+	}
+
+MEMORY_ZONE_ITEM(trees)
+MEMORY_ZONE_ITEM(nodes)
+MEMORY_ZONE_ITEM(rdata)
+MEMORY_ZONE_ITEM(additionals)
+
+uint64_t server_memory_journal(server_t *server)
+{
+	return memstat_journal(server);
+}
+
+uint64_t server_memory_modules(_unused_ server_t *server)
+{
+	return memstat_get(MEMSTAT_MODULES);
+}
+
+uint64_t server_memory_thread_pools(_unused_ server_t *server)
+{
+	return memstat_get(MEMSTAT_THREAD_POOLS);
+}
+
+#define RDATA_SHARED_ITEM(name) \
+	static uint64_t server_rdata_shared_##name(_unused_ server_t *server) { \
+		shared_rdata_stats_t st; \
+		shared_rdata_stats(&st); \
+		return st.name; \
+	}
+
+RDATA_SHARED_ITEM(sets)
+RDATA_SHARED_ITEM(refs)
+RDATA_SHARED_ITEM(bytes)
+RDATA_SHARED_ITEM(saved)
+
+#define COLD_RRSIG_ITEM(name) \
+	static uint64_t server_cold_rrsig_##name(_unused_ server_t *server) { \
+		cold_rdata_stats_t st; \
+		cold_rdata_stats(&st); \
+		return st.name; \
+	}
+
+COLD_RRSIG_ITEM(bytes)
+COLD_RRSIG_ITEM(mapped)
+
+#define SNAPSHOT_RDATA_ITEM(name) \
+	static uint64_t server_snapshot_rdata_##name(_unused_ server_t *server) { \
+		mapped_rdata_stats_t st; \
+		mapped_rdata_stats(&st); \
+		return st.name; \
+	}
+
+SNAPSHOT_RDATA_ITEM(bytes)
+SNAPSHOT_RDATA_ITEM(mapped)
+
+#ifdef ENABLE_XDP
+static struct knot_xdp_rrl xdp_rrl_get(server_t *server)
+{
+	struct knot_xdp_rrl res = { 0 };
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		struct knot_xdp_rrl rrl;
+		if (iface->fd_xdp_count > 0 &&
+		    knot_xdp_rrl_get(iface->xdp_sockets[0], &rrl) == KNOT_EOK) {
+			res.dropped += rrl.dropped;
+			res.slipped += rrl.slipped;
+		}
+	}
+	return res;
+}
+#endif
+
+uint64_t server_xdp_rrl_dropped(server_t *server)
+{
+#ifdef ENABLE_XDP
+	return xdp_rrl_get(server).dropped;
+#else
+	return 0;
+#endif
+}
+
+uint64_t server_xdp_rrl_slipped(server_t *server)
+{
+#ifdef ENABLE_XDP
+	return xdp_rrl_get(server).slipped;
+#else
+	return 0;
+#endif
+}
+
+uint64_t server_xdp_answered(_unused_ server_t *server)
+{
+	uint64_t res = 0;
+#ifdef ENABLE_XDP
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		struct knot_xdp_answer_conf conf;
+		if (iface->fd_xdp_count > 0 &&
+		    knot_xdp_answer_get(iface->xdp_sockets[0], &conf) == KNOT_EOK) {
+			res += conf.answered;
+		}
+	}
+#endif
+	return res;
+}
+
+uint64_t stats_xdp_acl_dropped(_unused_ server_t *server,
+                               _unused_ const struct knot_xdp_acl_key *key)
+{
+	uint64_t res = 0;
+#ifdef ENABLE_XDP
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		if (iface->fd_xdp_count == 0) {
+			continue;
+		}
+		if (key != NULL) {
+			uint64_t dropped;
+			if (knot_xdp_acl_dropped(iface->xdp_sockets[0], key, &dropped) == KNOT_EOK) {
+				res += dropped;
+			}
+		} else {
+			struct knot_xdp_acl_conf conf;
+			if (knot_xdp_acl_get(iface->xdp_sockets[0], &conf) == KNOT_EOK) {
+				res += conf.dropped;
+			}
+		}
+	}
+#endif
+	return res;
+}
+
+uint64_t server_xdp_acl_dropped(server_t *server)
+{
+	uint64_t res = stats_xdp_acl_dropped(server, NULL);
+#ifdef ENABLE_XDP
+	for (size_t i = 0; i < server->xdp_acl_count; i++) {
+		res += stats_xdp_acl_dropped(server, &server->xdp_acl[i].key);
+	}
+#endif
+	return res;
+}
+
+static uint64_t xdp_pass_get(_unused_ server_t *server, _unused_ int reason)
+{
+	uint64_t res = 0;
+#ifdef ENABLE_XDP
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		uint64_t pass[KNOT_XDP_PASS_REASONS];
+		if (iface->fd_xdp_count > 0 &&
+		    knot_xdp_pass_get(iface->xdp_sockets[0], pass) == KNOT_EOK) {
+			res += pass[reason];
+		}
+	}
+#endif
+	return res;
+}
+
+#define XDP_PASS_ITEM(name, reason) \
+	static uint64_t server_xdp_pass_##name(server_t *server) { \
+		return xdp_pass_get(server, reason); \
+	}
+
+XDP_PASS_ITEM(not_ip,   KNOT_XDP_PASS_NOT_IP)
+XDP_PASS_ITEM(headers,  KNOT_XDP_PASS_HEADERS)
+XDP_PASS_ITEM(proto,    KNOT_XDP_PASS_PROTO)
+XDP_PASS_ITEM(port,     KNOT_XDP_PASS_PORT)
+XDP_PASS_ITEM(route,    KNOT_XDP_PASS_ROUTE)
+XDP_PASS_ITEM(no_neigh, KNOT_XDP_PASS_NO_NEIGH)
+
 const stats_item_t server_stats[] = {
 	{ "zone-count", server_zone_count },
+	{ "udp-gso-messages", server_udp_gso_msgs },
+	{ "udp-gso-segments", server_udp_gso_segs },
+	{ "refresh-suppressed", server_refresh_suppressed },
+	{ "reclaim-pending", server_reclaim_pending },
+	{ "dnssec-signatures", server_dnssec_signatures },
+	{ "dnssec-signing-rate", server_dnssec_signing_rate },
+	{ "memory-rss", server_memory_rss },
+	{ "memory-zone-trees", server_memory_zone_trees },
+	{ "memory-zone-nodes", server_memory_zone_nodes },
+	{ "memory-zone-rdata", server_memory_zone_rdata },
+	{ "memory-zone-additionals", server_memory_zone_additionals },
+	{ "memory-journal-resident", server_memory_journal },
+	{ "memory-modules", server_memory_modules },
+	{ "memory-thread-pools", server_memory_thread_pools },
+	{ "rdata-shared-sets", server_rdata_shared_sets },
+	{ "rdata-shared-refs", server_rdata_shared_refs },
+	{ "rdata-shared-bytes", server_rdata_shared_bytes },
+	{ "rdata-shared-saved", server_rdata_shared_saved },
+	{ "cold-rrsig-bytes", server_cold_rrsig_bytes },
+	{ "cold-rrsig-mapped", server_cold_rrsig_mapped },
+	{ "snapshot-rdata-bytes", server_snapshot_rdata_bytes },
+	{ "snapshot-rdata-mapped", server_snapshot_rdata_mapped },
+	{ "xdp-rrl-dropped", server_xdp_rrl_dropped },
+	{ "xdp-rrl-slipped", server_xdp_rrl_slipped },
+	{ "xdp-answered", server_xdp_answered },
+	{ "xdp-acl-dropped", server_xdp_acl_dropped },
+	{ "xdp-pass-not-ip", server_xdp_pass_not_ip },
+	{ "xdp-pass-headers", server_xdp_pass_headers },
+	{ "xdp-pass-proto", server_xdp_pass_proto },
+	{ "xdp-pass-port", server_xdp_pass_port },
+	{ "xdp-pass-route", server_xdp_pass_route },
+	{ "xdp-pass-no-neigh", server_xdp_pass_no_neigh },
+	{ 0 }
+};
+
+#define EVENT_ITEM(field) \
+	static uint64_t event_##field(const zone_event_usage_t *usage) { \
+		return usage->field; \
+	}
+
+EVENT_ITEM(count)
+EVENT_ITEM(wall)
+EVENT_ITEM(cpu)
+EVENT_ITEM(wait)
+EVENT_ITEM(max_wall)
+
+const stats_event_item_t event_stats[] = {
+	{ "count", event_count },
+	{ "wall-usec", event_wall },
+	{ "cpu-usec", event_cpu },
+	{ "wait-usec", event_wait },
+	{ "max-wall-usec", event_max_wall },
 	{ 0 }
 };
 
-uint64_t stats_get_counter(uint64_t **stats_vals, uint32_t offset, unsigned threads)
+uint64_t stats_get_counter(knotd_mod_t *mod, uint32_t offset, unsigned threads)
 {
 	uint64_t res = 0;
+
+	// Compact counters are allocated on first use.
+	uint64_t *shared = ATOMIC_ACQ(mod->stats_shared);
+	if (shared != NULL) {
+		res += ATOMIC_GET(shared[offset]);
+	}
+
+	mod_stats_block_t **stats_vals = ATOMIC_ACQ(mod->stats_vals);
+	if (stats_vals == NULL) {
+		return res;
+	}
 	for (unsigned i = 0; i < threads; i++) {
-		res += ATOMIC_GET(stats_vals[i][offset]);
+		mod_stats_block_t *block = ATOMIC_ACQ(stats_vals[i]);
+		if (block != NULL) {
+			res += ATOMIC_GET(block->vals[offset]);
+		}
 	}
 	return res;
 }
 
-static void dump_counters(FILE *fd, int level, mod_ctr_t *ctr, uint64_t **stats_vals, unsigned threads)
+/*! \brief Number of attempts to read a consistent block before giving up. */
+#define SNAPSHOT_RETRIES 100
+
+static void snapshot_add(uint64_t *out, uint64_t *tmp, const mod_stats_block_t *block,
+                         size_t count)
+{
+	for (int retry = 0; retry < SNAPSHOT_RETRIES; retry++) {
+		uint64_t seq = ATOMIC_ACQ(block->seq);
+		if (seq & 1) {
+			continue; // Being updated.
+		}
+		for (size_t i = 0; i < count; i++) {
+			tmp[i] = ATOMIC_GET(block->vals[i]);
+		}
+		ATOMIC_FENCE_ACQ();
+		if (ATOMIC_GET(block->seq) == seq) {
+			break;
+		}
+	}
+
+	// The last attempt is used even if inconsistent, the writer never waits.
+	for (size_t i = 0; i < count; i++) {
+		out[i] += tmp[i];
+	}
+}
+
+uint64_t *stats_get_snapshot(knotd_mod_t *mod, unsigned threads)
+{
+	const mod_ctr_t *last = &mod->stats_info[mod->stats_count - 1];
+	size_t count = last->offset + last->count;
+
+	uint64_t *out = calloc(2 * count, sizeof(uint64_t));
+	if (out == NULL) {
+		return NULL;
+	}
+	uint64_t *tmp = out + count;
+
+	uint64_t *shared = ATOMIC_ACQ(mod->stats_shared);
+	if (shared != NULL) {
+		for (size_t i = 0; i < count; i++) {
+			out[i] += ATOMIC_GET(shared[i]);
+		}
+	}
+
+	mod_stats_block_t **stats_vals = ATOMIC_ACQ(mod->stats_vals);
+	for (unsigned i = 0; stats_vals != NULL && i < threads; i++) {
+		mod_stats_block_t *block = ATOMIC_ACQ(stats_vals[i]);
+		if (block != NULL) {
+			snapshot_add(out, tmp, block, count);
+		}
+	}
+
+	return out;
+}
+
+uint64_t *stats_get_read(knotd_mod_t *mod, uint32_t ctr_id, char ***names)
+{
+	const mod_ctr_t *ctr = &mod->stats_info[ctr_id];
+	assert(ctr->read != NULL);
+
+	uint64_t *vals = calloc(ctr->count, sizeof(*vals));
+	*names = calloc(ctr->count, sizeof(**names));
+	if (vals == NULL || *names == NULL) {
+		free(vals);
+		free(*names);
+		return NULL;
+	}
+
+	ctr->read(mod, ctr_id, vals, *names);
+
+	return vals;
+}
+
+void stats_free_read(knotd_mod_t *mod, uint32_t ctr_id, uint64_t *vals, char **names)
+{
+	for (uint32_t i = 0; i < mod->stats_info[ctr_id].count; i++) {
+		free(names[i]);
+	}
+	free(names);
+	free(vals);
+}
+
+static void dump_read_counters(FILE *fd, int level, knotd_mod_t *mod, uint32_t ctr_id)
+{
+	char **names;
+	uint64_t *vals = stats_get_read(mod, ctr_id, &names);
+	if (vals == NULL) {
+		return;
+	}
+
+	for (uint32_t j = 0; j < mod->stats_info[ctr_id].count; j++) {
+		if (vals[j] != 0 && names[j] != NULL) {
+			DUMP_CTR(fd, level, "%s", names[j], vals[j]);
+		}
+	}
+
+	stats_free_read(mod, ctr_id, vals, names);
+}
+
+static void dump_counters(FILE *fd, int level, mod_ctr_t *ctr, const uint64_t *snapshot)
 {
 	for (uint32_t j = 0; j < ctr->count; j++) {
-		uint64_t counter = stats_get_counter(stats_vals, ctr->offset + j, threads);
+		uint64_t counter = snapshot[ctr->offset + j];
 
 		// Skip empty counters.
 		if (counter == 0) {
@@ -115,7 +508,10 @@ static void dump_modules(dump_ctx_t *ctx)
 			level = 0;
 		}
 
-		unsigned threads = knotd_mod_threads(mod);
+		uint64_t *snapshot = stats_get_snapshot(mod, knotd_mod_threads(mod));
+		if (snapshot == NULL) {
+			continue;
+		}
 
 		// Dump module counters.
 		DUMP_STR(ctx->fd, level, "%s", mod->id->name + 1, "");
@@ -125,17 +521,22 @@ static void dump_modules(dump_ctx_t *ctx)
 				// Empty counter.
 				continue;
 			}
-			if (ctr->count == 1) {
+			if (ctr->read != NULL) {
+				// Counters provided by the module.
+				DUMP_STR(ctx->fd, level + 1, "%s", ctr->name, "");
+				dump_read_counters(ctx->fd, level + 2, mod, i);
+			} else if (ctr->count == 1) {
 				// Simple counter.
-				uint64_t counter = stats_get_counter(mod->stats_vals,
-				                                     ctr->offset, threads);
+				uint64_t counter = snapshot[ctr->offset];
 				DUMP_CTR(ctx->fd, level + 1, "%s", ctr->name, counter);
 			} else {
 				// Array of counters.
 				DUMP_STR(ctx->fd, level + 1, "%s", ctr->name, "");
-				dump_counters(ctx->fd, level + 2, ctr, mod->stats_vals, threads);
+				dump_counters(ctx->fd, level + 2, ctr, snapshot);
 			}
 		}
+
+		free(snapshot);
 	}
 }
 
@@ -181,6 +582,30 @@ static void dump_to_file(FILE *fd, server_t *server)
 		DUMP_CTR(fd, 1, "%s", item->name, item->val(server));
 	}
 
+	// Dump zone events statistics.
+	DUMP_STR(fd, 0, "events", "");
+	for (const stats_event_item_t *item = event_stats; item->name != NULL; item++) {
+		DUMP_STR(fd, 1, "%s", item->name, "");
+		for (zone_event_type_t type = 0; type < ZONE_EVENT_COUNT; type++) {
+			zone_event_usage_t usage;
+			zone_events_total_usage(type, &usage);
+			if (usage.count > 0) {
+				DUMP_CTR(fd, 2, "\"%s\"", zone_events_get_name(type),
+				         item->val(&usage));
+			}
+		}
+	}
+	zone_event_slow_t slowest[ZONE_EVENT_SLOWEST];
+	size_t slow_count = zone_events_slowest(slowest, ZONE_EVENT_SLOWEST);
+	DUMP_STR(fd, 1, "slowest-wall-usec", "");
+	for (size_t i = 0; i < slow_count; i++) {
+		knot_dname_txt_storage_t name;
+		if (knot_dname_to_str(name, slowest[i].zone, sizeof(name)) != NULL) {
+			DUMP_CTR(fd, 2, "\"%s %s\"", name,
+			         zone_events_get_name(slowest[i].type), slowest[i].wall);
+		}
+	}
+
 	dump_ctx_t ctx = {
 		.fd = fd,
 		.query_modules = conf()->query_modules,
@@ -265,6 +690,404 @@ static void *dumper(void *data)
 	return NULL;
 }
 
+typedef struct {
+	const knot_dname_t *zone;
+	knotd_mod_t *mod;
+} export_mod_t;
+
+typedef struct {
+	export_mod_t *mods;
+	size_t count;
+	size_t max;
+	uint32_t zones;
+	uint64_t zones_omitted;
+} export_ctx_t;
+
+static void export_add_mods(export_ctx_t *ctx, const list_t *query_modules,
+                            const knot_dname_t *zone)
+{
+	knotd_mod_t *mod;
+	WALK_LIST(mod, *query_modules) {
+		// Skip modules without statistics.
+		if (mod->stats_count == 0) {
+			continue;
+		}
+
+		if (ctx->count == ctx->max) {
+			size_t max = MAX(16, 2 * ctx->max);
+			export_mod_t *mods = realloc(ctx->mods, max * sizeof(*mods));
+			if (mods == NULL) {
+				return;
+			}
+			ctx->mods = mods;
+			ctx->max = max;
+		}
+		ctx->mods[ctx->count++] = (export_mod_t){ zone, mod };
+	}
+}
+
+static void export_add_zone(zone_t *zone, export_ctx_t *ctx)
+{
+	if (EMPTY_LIST(zone->query_modules)) {
+		return;
+	}
+
+	// Limit the cardinality of the per-zone metrics.
+	if (ctx->zones >= stats.zone_limit) {
+		ctx->zones_omitted++;
+		return;
+	}
+	ctx->zones++;
+
+	export_add_mods(ctx, &zone->query_modules, zone->name);
+}
+
+static int export_mod_cmp(const void *a, const void *b)
+{
+	const export_mod_t *ma = a, *mb = b;
+
+	// Keep the zone order for the same modules (the sort is not stable).
+	int ret = strcmp(ma->mod->id->name + 1, mb->mod->id->name + 1);
+	if (ret == 0) {
+		ret = (ma < mb) ? -1 : (ma > mb);
+	}
+	return ret;
+}
+
+/*! \brief Prints a metric name in the OpenMetrics charset. */
+static void export_name(FILE *fd, const char *name)
+{
+	for (; *name != '\0'; name++) {
+		fputc(is_alnum(*name) ? *name : '_', fd);
+	}
+}
+
+static void export_label(FILE *fd, const char *label, const char *value, size_t len)
+{
+	fprintf(fd, "%s=\"", label);
+	for (size_t i = 0; i < len && value[i] != '\0'; i++) {
+		switch (value[i]) {
+		case '"':  fputs("\\\"", fd); break;
+		case '\\': fputs("\\\\", fd); break;
+		case '\n': fputs("\\n", fd); break;
+		default:   fputc(value[i], fd); break;
+		}
+	}
+	fputc('"', fd);
+}
+
+static void export_sample(FILE *fd, const char *family, const char *ctr_name,
+                          export_mod_t *em, const char *type, uint64_t value)
+{
+	export_name(fd, family);
+	fputc('_', fd);
+	export_name(fd, ctr_name);
+	fputs("_total{", fd);
+	export_label(fd, "id", (const char *)em->mod->id->data, em->mod->id->len);
+	if (em->zone != NULL) {
+		knot_dname_txt_storage_t name;
+		if (knot_dname_to_str(name, em->zone, sizeof(name)) != NULL) {
+			fputc(',', fd);
+			export_label(fd, "zone", name, sizeof(name));
+		}
+	}
+	if (type != NULL) {
+		fputc(',', fd);
+		export_label(fd, "type", type, strlen(type));
+	}
+	fprintf(fd, "} %"PRIu64"\n", value);
+}
+
+/*! \brief Exports one counter of all the modules with the same name. */
+static void export_counter(FILE *fd, export_mod_t *mods, size_t count, uint32_t idx)
+{
+	const char *family = mods[0].mod->id->name + 1;
+	const char *ctr_name = NULL;
+
+	for (size_t i = 0; i < count; i++) {
+		knotd_mod_t *mod = mods[i].mod;
+		if (idx >= mod->stats_count) {
+			continue;
+		}
+		mod_ctr_t *ctr = mod->stats_info + idx;
+		if (ctr->name == NULL) {
+			// Empty counter.
+			continue;
+		} else if (ctr_name == NULL) {
+			ctr_name = ctr->name;
+			fprintf(fd, "# TYPE knot_");
+			export_name(fd, family);
+			fputc('_', fd);
+			export_name(fd, ctr_name);
+			fprintf(fd, " counter\n");
+		} else if (strcmp(ctr_name, ctr->name) != 0) {
+			continue;
+		}
+
+		if (ctr->read != NULL) {
+			char **names;
+			uint64_t *vals = stats_get_read(mod, idx, &names);
+			for (uint32_t j = 0; vals != NULL && j < ctr->count; j++) {
+				if (vals[j] != 0 && names[j] != NULL) {
+					fputs("knot_", fd);
+					export_sample(fd, family, ctr_name, &mods[i], names[j], vals[j]);
+				}
+			}
+			if (vals != NULL) {
+				stats_free_read(mod, idx, vals, names);
+			}
+			continue;
+		}
+
+		unsigned threads = knotd_mod_threads(mod);
+		if (ctr->count == 1) {
+			uint64_t counter = stats_get_counter(mod, ctr->offset, threads);
+			fputs("knot_", fd);
+			export_sample(fd, family, ctr_name, &mods[i], NULL, counter);
+			continue;
+		}
+		for (uint32_t j = 0; j < ctr->count; j++) {
+			uint64_t counter = stats_get_counter(mod, ctr->offset + j, threads);
+			// Skip empty counters.
+			if (counter == 0) {
+				continue;
+			}
+
+			char buf[16];
+			char *str = NULL;
+			if (ctr->idx_to_str != NULL) {
+				str = ctr->idx_to_str(j, ctr->count);
+			} else if (snprintf(buf, sizeof(buf), "%u", j) > 0) {
+				str = strdup(buf);
+			}
+			if (str != NULL) {
+				fputs("knot_", fd);
+				export_sample(fd, family, ctr_name, &mods[i], str, counter);
+				free(str);
+			}
+		}
+	}
+}
+
+typedef struct {
+	FILE *fd;
+	uint32_t zones;
+} export_mem_ctx_t;
+
+static void export_zone_memory(zone_t *zone, export_mem_ctx_t *ctx)
+{
+	if (ctx->zones >= stats.zone_limit) {
+		return;
+	}
+	ctx->zones++;
+
+	knot_dname_txt_storage_t name;
+	if (knot_dname_to_str(name, zone->name, sizeof(name)) == NULL) {
+		return;
+	}
+
+	zone_memory_t mem;
+	memstat_zone(zone, &mem);
+
+	const struct {
+		const char *type;
+		size_t value;
+	} items[] = {
+		{ "trees", mem.trees },
+		{ "nodes", mem.nodes },
+		{ "rdata", mem.rdata },
+		{ "additionals", mem.additionals },
+	};
+	for (size_t i = 0; i < sizeof(items) / sizeof(items[0]); i++) {
+		fputs("knot_zone_memory_bytes{", ctx->fd);
+		export_label(ctx->fd, "zone", name, sizeof(name));
+		fputc(',', ctx->fd);
+		export_label(ctx->fd, "type", items[i].type, strlen(items[i].type));
+		fprintf(ctx->fd, "} %zu\n", items[i].value);
+	}
+}
+
+static void export_metrics(FILE *fd, server_t *server)
+{
+	// Export server statistics.
+	for (const stats_item_t *item = server_stats; item->name != NULL; item++) {
+		fputs("# TYPE knot_server_", fd);
+		export_name(fd, item->name);
+		fputs(" gauge\nknot_server_", fd);
+		export_name(fd, item->name);
+		fprintf(fd, " %"PRIu64"\n", item->val(server));
+	}
+
+	// Export zone events statistics.
+	for (const stats_event_item_t *item = event_stats; item->name != NULL; item++) {
+		fputs("# TYPE knot_zone_events_", fd);
+		export_name(fd, item->name);
+		fputs(" gauge\n", fd);
+		for (zone_event_type_t type = 0; type < ZONE_EVENT_COUNT; type++) {
+			zone_event_usage_t usage;
+			zone_events_total_usage(type, &usage);
+			const char *name = zone_events_get_name(type);
+			fputs("knot_zone_events_", fd);
+			export_name(fd, item->name);
+			fputc('{', fd);
+			export_label(fd, "type", name, strlen(name));
+			fprintf(fd, "} %"PRIu64"\n", item->val(&usage));
+		}
+	}
+
+	// Export memory of the zones.
+	export_mem_ctx_t mem_ctx = { fd };
+	fputs("# TYPE knot_zone_memory_bytes gauge\n", fd);
+	knot_zonedb_foreach(server->zone_db, export_zone_memory, &mem_ctx);
+
+	export_ctx_t ctx = { 0 };
+	export_add_mods(&ctx, conf()->query_modules, NULL);
+	knot_zonedb_foreach(server->zone_db, export_add_zone, &ctx);
+
+	fprintf(fd, "# TYPE knot_server_zones_omitted gauge\n"
+	            "knot_server_zones_omitted %"PRIu64"\n", ctx.zones_omitted);
+
+	// Each metric family must be exported at once.
+	qsort(ctx.mods, ctx.count, sizeof(*ctx.mods), export_mod_cmp);
+	for (size_t i = 0; i < ctx.count; ) {
+		size_t count = 1;
+		uint32_t max_ctrs = ctx.mods[i].mod->stats_count;
+		while (i + count < ctx.count &&
+		       strcmp(ctx.mods[i].mod->id->name + 1,
+		              ctx.mods[i + count].mod->id->name + 1) == 0) {
+			max_ctrs = MAX(max_ctrs, ctx.mods[i + count].mod->stats_count);
+			count++;
+		}
+		for (uint32_t idx = 0; idx < max_ctrs; idx++) {
+			export_counter(fd, ctx.mods + i, count, idx);
+		}
+		i += count;
+	}
+	free(ctx.mods);
+
+	fputs("# EOF\n", fd);
+}
+
+static void export_serve(int conn)
+{
+	struct timeval tv = { .tv_sec = 2 };
+	(void)setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	(void)setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	// Only the request line is needed, the rest of the request is ignored.
+	char req[512];
+	ssize_t len = recv(conn, req, sizeof(req) - 1, 0);
+	if (len <= 0) {
+		close(conn);
+		return;
+	}
+	req[len] = '\0';
+
+	FILE *fd = fdopen(conn, "w");
+	if (fd == NULL) {
+		close(conn);
+		return;
+	}
+
+	const char *path = "GET /metrics";
+	if (strncmp(req, path, strlen(path)) != 0 ||
+	    (req[strlen(path)] != ' ' && req[strlen(path)] != '?')) {
+		fprintf(fd, "HTTP/1.1 404 Not Found\r\n"
+		            "Content-Length: 0\r\n"
+		            "Connection: close\r\n\r\n");
+		fclose(fd);
+		return;
+	}
+
+	// The output is streamed, the end is indicated by closing the connection.
+	fprintf(fd, "HTTP/1.1 200 OK\r\n"
+	            "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+	            "Connection: close\r\n\r\n");
+
+	rcu_read_lock();
+	export_metrics(fd, stats.server);
+	rcu_read_unlock();
+
+	fclose(fd);
+}
+
+static void *exporter(void *data)
+{
+	while (true) {
+		int conn = accept(stats.exporter_fd, NULL, NULL);
+		if (conn < 0) {
+			// Back off if out of file descriptors.
+			if (errno == EMFILE || errno == ENFILE) {
+				sleep(1);
+			}
+			continue;
+		}
+
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+		export_serve(conn);
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+	}
+
+	return NULL;
+}
+
+static void exporter_stop(void)
+{
+	if (stats.active_exporter) {
+		pthread_cancel(stats.exporter);
+		pthread_join(stats.exporter, NULL);
+		close(stats.exporter_fd);
+		stats.active_exporter = false;
+	}
+}
+
+static void exporter_reconfigure(conf_t *conf)
+{
+	conf_val_t val = conf_get(conf, C_STATS, C_METRICS_ZONE_LIMIT);
+	stats.zone_limit = conf_int(&val);
+
+	val = conf_get(conf, C_STATS, C_METRICS_LISTEN);
+	if (val.code != KNOT_EOK) {
+		exporter_stop();
+		return;
+	}
+
+	struct sockaddr_storage addr = conf_addr(&val, NULL);
+	if (stats.active_exporter && sockaddr_cmp(&addr, &stats.exporter_addr, false) == 0) {
+		return;
+	}
+	exporter_stop();
+
+	char addr_str[SOCKADDR_STRLEN];
+	sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
+
+	int fd = net_bound_socket(SOCK_STREAM, &addr, 0);
+	if (fd < 0) {
+		log_error("stats, failed to bind metrics address %s (%s)",
+		          addr_str, knot_strerror(fd));
+		return;
+	}
+	if (listen(fd, 16) != 0) {
+		log_error("stats, failed to listen on metrics address %s (%s)",
+		          addr_str, knot_strerror(knot_map_errno()));
+		close(fd);
+		return;
+	}
+
+	stats.exporter_fd = fd;
+	int ret = pthread_create(&stats.exporter, NULL, exporter, NULL);
+	if (ret != 0) {
+		log_error("stats, failed to launch metrics exporter (%s)",
+		          knot_strerror(knot_map_errno_code(ret)));
+		close(fd);
+		return;
+	}
+	memcpy(&stats.exporter_addr, &addr, sizeof(addr));
+	stats.active_exporter = true;
+
+	log_info("stats, exporting metrics on %s", addr_str);
+}
+
 void stats_reconfigure(conf_t *conf, server_t *server)
 {
 	if (conf == NULL || server == NULL) {
@@ -274,6 +1097,8 @@ void stats_reconfigure(conf_t *conf, server_t *server)
 	// Update server context.
 	stats.server = server;
 
+	exporter_reconfigure(conf);
+
 	conf_val_t val = conf_get(conf, C_STATS, C_TIMER);
 	stats.timer = conf_int(&val);
 	if (stats.timer > 0) {
@@ -299,6 +1124,8 @@ void stats_reconfigure(conf_t *conf, server_t *server)
 
 void stats_deinit(void)
 {
+	exporter_stop();
+
 	if (stats.active_dumper) {
 		pthread_cancel(stats.dumper);
 		pthread_join(stats.dumper, NULL);
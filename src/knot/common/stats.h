@@ -20,8 +20,11 @@
 
 #pragma once
 
+#include "knot/events/events.h"
 #include "knot/server/server.h"
 
+struct knot_xdp_acl_key;
+
 typedef uint64_t (*stats_val_f)(server_t *server);
 
 /*!
@@ -37,10 +40,64 @@ typedef struct {
  */
 extern const stats_item_t server_stats[];
 
+typedef uint64_t (*stats_event_val_f)(const zone_event_usage_t *usage);
+
+/*!
+ * \brief Zone events metrics item.
+ */
+typedef struct {
+	const char *name;       /*!< Metrics name. */
+	stats_event_val_f val;  /*!< Metrics value getter. */
+} stats_event_item_t;
+
+/*!
+ * \brief Zone events metrics, per event type summed across the zones.
+ */
+extern const stats_event_item_t event_stats[];
+
+/*!
+ * \brief Read out the number of packets dropped by the XDP access control.
+ *
+ * \param server  Server.
+ * \param key     Source prefix of a configured rule, NULL for the packets not
+ *                matching any prefix.
+ *
+ * \return Number of dropped packets summed across the interfaces.
+ */
+uint64_t stats_xdp_acl_dropped(server_t *server, const struct knot_xdp_acl_key *key);
+
 /*!
  * \brief Read out value of single counter summed across threads.
  */
-uint64_t stats_get_counter(uint64_t **stats_vals, uint32_t offset, unsigned threads);
+uint64_t stats_get_counter(knotd_mod_t *mod, uint32_t offset, unsigned threads);
+
+/*!
+ * \brief Read out all counters of the module summed across threads.
+ *
+ * The counters of each thread are read consistently, i.e. not in the middle
+ * of an update.
+ *
+ * \return Array of the counters indexed by the counter offsets (to be freed
+ *         by the caller), NULL if no memory.
+ */
+uint64_t *stats_get_snapshot(knotd_mod_t *mod, unsigned threads);
+
+/*!
+ * \brief Read out a counter provided by the module on read.
+ *
+ * \param mod     Module.
+ * \param ctr_id  Counter id.
+ * \param names   Output array of the subcounter names (NULL if unused).
+ *
+ * \return Array of the subcounter values (to be freed with stats_free_read()),
+ *         NULL if no memory.
+ */
+uint64_t *stats_get_read(knotd_mod_t *mod, uint32_t ctr_id, char ***names);
+
+/*!
+ * \brief Frees the counter values and names from stats_get_read().
+ */
+void stats_free_read(knotd_mod_t *mod, uint32_t ctr_id, uint64_t *vals, char **names);
 
 /*!
  * \brief Reconfigures the statistics facility.
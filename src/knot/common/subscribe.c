@@ -0,0 +1,218 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "knot/common/subscribe.h"
+#include "contrib/openbsd/strlcpy.h"
+
+/*! \brief Queue length of one subscriber (power of two). */
+#define QUEUE_SIZE	4096
+
+struct subscriber {
+	unsigned kinds;
+	knot_dname_t **zones;  // Sorted, NULL for all zones.
+	size_t zone_count;
+	pthread_cond_t cond;
+	size_t head;           // Next message to be read.
+	size_t count;          // Number of the queued messages.
+	uint64_t lost;         // Number of the dropped messages.
+	subscribe_msg_t queue[QUEUE_SIZE];
+};
+
+static struct {
+	pthread_mutex_t lock;
+	subscriber_t *subs[SUBSCRIBE_MAX];
+	unsigned count;        // Also read without the lock.
+	bool shutdown;
+} bus = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static int cmp_zone(const void *a, const void *b)
+{
+	return knot_dname_cmp(*(const knot_dname_t **)a, *(const knot_dname_t **)b);
+}
+
+static bool match(const subscriber_t *sub, subscribe_kind_t kind,
+                  const knot_dname_t *zone)
+{
+	if (!(sub->kinds & kind)) {
+		return false;
+	}
+	if (sub->zones == NULL) {
+		return true;
+	}
+
+	return bsearch(&zone, sub->zones, sub->zone_count, sizeof(*sub->zones),
+	               cmp_zone) != NULL;
+}
+
+void subscribe_emit(subscribe_kind_t kind, const knot_dname_t *zone,
+                    const char *type, const char *value, ...)
+{
+	if (__atomic_load_n(&bus.count, __ATOMIC_RELAXED) == 0 || zone == NULL) {
+		return;
+	}
+
+	subscribe_msg_t msg = { .kind = kind };
+	knot_dname_copy_lower(msg.zone, zone);
+	strlcpy(msg.type, type, sizeof(msg.type));
+	va_list args;
+	va_start(args, value);
+	(void)vsnprintf(msg.value, sizeof(msg.value), value, args);
+	va_end(args);
+
+	pthread_mutex_lock(&bus.lock);
+	for (unsigned i = 0; i < bus.count; i++) {
+		subscriber_t *sub = bus.subs[i];
+		if (!match(sub, kind, msg.zone)) {
+			continue;
+		}
+		if (sub->count == QUEUE_SIZE) {
+			sub->lost++;
+			continue;
+		}
+		subscribe_msg_t *slot = &sub->queue[(sub->head + sub->count) % QUEUE_SIZE];
+		*slot = msg;
+		slot->lost = sub->lost;
+		sub->lost = 0;
+		sub->count++;
+		pthread_cond_signal(&sub->cond);
+	}
+	pthread_mutex_unlock(&bus.lock);
+}
+
+static void free_zones(knot_dname_t **zones, size_t zone_count)
+{
+	for (size_t i = 0; i < zone_count; i++) {
+		knot_dname_free(zones[i], NULL);
+	}
+	free(zones);
+}
+
+int subscribe_new(unsigned kinds, knot_dname_t **zones, size_t zone_count,
+                  subscriber_t **out)
+{
+	if ((zones == NULL && zone_count > 0) || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	subscriber_t *sub = calloc(1, sizeof(*sub));
+	if (sub == NULL) {
+		free_zones(zones, zone_count);
+		return KNOT_ENOMEM;
+	}
+	sub->kinds = kinds;
+	if (zone_count > 0) {
+		sub->zones = zones;
+		sub->zone_count = zone_count;
+		qsort(zones, zone_count, sizeof(*zones), cmp_zone);
+	} else {
+		free(zones);
+	}
+	pthread_cond_init(&sub->cond, NULL);
+
+	pthread_mutex_lock(&bus.lock);
+	if (bus.count == SUBSCRIBE_MAX || bus.shutdown) {
+		int ret = bus.shutdown ? KNOT_EOF : KNOT_ELIMIT;
+		pthread_mutex_unlock(&bus.lock);
+		pthread_cond_destroy(&sub->cond);
+		free_zones(sub->zones, sub->zone_count);
+		free(sub);
+		return ret;
+	}
+	bus.subs[bus.count] = sub;
+	__atomic_store_n(&bus.count, bus.count + 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&bus.lock);
+
+	*out = sub;
+
+	return KNOT_EOK;
+}
+
+void subscribe_free(subscriber_t *sub)
+{
+	if (sub == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&bus.lock);
+	for (unsigned i = 0; i < bus.count; i++) {
+		if (bus.subs[i] == sub) {
+			bus.subs[i] = bus.subs[bus.count - 1];
+			__atomic_store_n(&bus.count, bus.count - 1, __ATOMIC_RELAXED);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&bus.lock);
+
+	pthread_cond_destroy(&sub->cond);
+	free_zones(sub->zones, sub->zone_count);
+	free(sub);
+}
+
+int subscribe_wait(subscriber_t *sub, int timeout_ms, subscribe_msg_t *msg)
+{
+	if (sub == NULL || msg == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	int ret = KNOT_EOK;
+
+	pthread_mutex_lock(&bus.lock);
+	while (sub->count == 0 && !bus.shutdown) {
+		if (pthread_cond_timedwait(&sub->cond, &bus.lock, &deadline) != 0) {
+			break;
+		}
+	}
+	if (bus.shutdown) {
+		ret = KNOT_EOF;
+	} else if (sub->count == 0) {
+		ret = KNOT_ETIMEOUT;
+	} else {
+		*msg = sub->queue[sub->head];
+		sub->head = (sub->head + 1) % QUEUE_SIZE;
+		sub->count--;
+	}
+	pthread_mutex_unlock(&bus.lock);
+
+	return ret;
+}
+
+void subscribe_shutdown(void)
+{
+	pthread_mutex_lock(&bus.lock);
+	bus.shutdown = true;
+	for (unsigned i = 0; i < bus.count; i++) {
+		pthread_cond_signal(&bus.subs[i]->cond);
+	}
+	pthread_mutex_unlock(&bus.lock);
+}
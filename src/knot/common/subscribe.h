@@ -0,0 +1,101 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Zone event notifications for the control subscribers.
+ *
+ * Events are queued to each matching subscriber, a slow subscriber loses
+ * the events exceeding its queue instead of delaying the emitting thread.
+ */
+
+#pragma once
+
+#include "libknot/libknot.h"
+
+/*! \brief Maximum number of concurrent subscribers. */
+#define SUBSCRIBE_MAX	3
+
+/*! \brief Subscription kinds (bit flags). */
+typedef enum {
+	SUBSCRIBE_SERIAL  = 1 << 0, /*!< Zone contents updated. */
+	SUBSCRIBE_EVENT   = 1 << 1, /*!< Zone event finished. */
+	SUBSCRIBE_REFRESH = 1 << 2, /*!< Zone refresh finished. */
+	SUBSCRIBE_ALL     = SUBSCRIBE_SERIAL | SUBSCRIBE_EVENT | SUBSCRIBE_REFRESH,
+} subscribe_kind_t;
+
+/*! \brief Notification. */
+typedef struct {
+	subscribe_kind_t kind;
+	knot_dname_storage_t zone;
+	char type[32];
+	char value[96];
+	uint64_t lost;  /*!< Number of the notifications lost before this one. */
+} subscribe_msg_t;
+
+typedef struct subscriber subscriber_t;
+
+/*!
+ * \brief Emits a notification to the matching subscribers.
+ *
+ * \note This is a no-op (just an atomic load) if there is no subscriber.
+ *
+ * \param kind   Notification kind.
+ * \param zone   Zone name.
+ * \param type   Notification type (e.g. event name).
+ * \param value  Notification value (printf-like format).
+ */
+void subscribe_emit(subscribe_kind_t kind, const knot_dname_t *zone,
+                    const char *type, const char *value, ...);
+
+/*!
+ * \brief Registers a new subscriber.
+ *
+ * \note The subscriber takes ownership of the zone names (even if error).
+ *
+ * \param kinds       Subscribed kinds (subscribe_kind_t flags).
+ * \param zones       Subscribed zones (NULL for all zones).
+ * \param zone_count  Number of the subscribed zones.
+ * \param out         Output subscriber.
+ *
+ * \retval KNOT_ELIMIT  If too many subscribers.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int subscribe_new(unsigned kinds, knot_dname_t **zones, size_t zone_count,
+                  subscriber_t **out);
+
+/*!
+ * \brief Unregisters and frees the subscriber (incl. the zone names).
+ */
+void subscribe_free(subscriber_t *sub);
+
+/*!
+ * \brief Waits for the next notification.
+ *
+ * \param sub         Subscriber.
+ * \param timeout_ms  Wait timeout in milliseconds.
+ * \param msg         Output notification.
+ *
+ * \retval KNOT_EOK       If a notification was received.
+ * \retval KNOT_ETIMEOUT  If no notification in the given time.
+ * \retval KNOT_EOF       If the server is shutting down.
+ */
+int subscribe_wait(subscriber_t *sub, int timeout_ms, subscribe_msg_t *msg);
+
+/*!
+ * \brief Wakes up and finishes all waiting subscribers (server shutdown).
+ */
+void subscribe_shutdown(void);
@@ -58,10 +58,13 @@ void systemd_zone_load_timeout_notify(void)
 #endif
 }
 
-void systemd_tasks_status_notify(int tasks)
+void systemd_tasks_status_notify(int tasks, int total)
 {
 #ifdef ENABLE_SYSTEMD
-	if (tasks > 0) {
+	if (tasks > 0 && total >= tasks) {
+		sd_notifyf(0, "STATUS=Waiting for %d tasks to finish, %d%% done...",
+		           tasks, (int)(100LL * (total - tasks) / total));
+	} else if (tasks > 0) {
 		sd_notifyf(0, "STATUS=Waiting for %d tasks to finish...", tasks);
 	} else {
 		sd_notify(0, "STATUS=");
@@ -41,8 +41,9 @@ void systemd_zone_load_timeout_notify(void);
  *        of scheduled tasks.
  *
  * \param tasks  Number of tasks to be done.
+ * \param total  Number of tasks at the beginning (progress not shown if lower).
  */
-void systemd_tasks_status_notify(int tasks);
+void systemd_tasks_status_notify(int tasks, int total);
 
 /*!
  * \brief Notify systemd about service is ready.
@@ -0,0 +1,52 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Static tracepoints (USDT) for bpftrace or SystemTap.
+ *
+ * The probes are compiled in only if configured with --enable-usdt.
+ * An inactive probe is a single NOP instruction, the probe arguments
+ * mustn't have side effects as they aren't evaluated otherwise.
+ *
+ * Probes of the 'knot' provider:
+ *
+ * query_recv(proto, qname, qtype, size)
+ * query_send(proto, qname, rcode, size)
+ *   Query processing start and end. The protocol is a string ("udp", "tcp",
+ *   "xdp-udp", or "xdp-tcp"), the qname is in the wire format (NULL if
+ *   malformed), the size is the query size or the last response size
+ *   (0 if no response).
+ *
+ * module_hook_start(stage, module)
+ * module_hook_end(stage, module, state)
+ *   Query module hook execution. The stage is knotd_stage_t, the module
+ *   is the module name string, the state is the resulting state.
+ *
+ * zone_event_start(zone, event)
+ * zone_event_end(zone, event, ret, duration)
+ *   Zone event execution. The zone and event names are strings, the return
+ *   code is KNOT_E*, the duration is in milliseconds.
+ */
+
+#pragma once
+
+#ifdef ENABLE_USDT
+#include <sys/sdt.h>
+
+#define KNOT_PROBE(name, ...)	STAP_PROBEV(knot, name, ##__VA_ARGS__)
+#else
+#define KNOT_PROBE(name, ...)
+#endif
@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <signal.h>
 #include <string.h>
 #include <urcu.h>
 
@@ -23,12 +25,15 @@
 #include "knot/conf/tools.h"
 #include "knot/common/log.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/updates/acl.h"
 #include "libknot/libknot.h"
 #include "libknot/yparser/ypformat.h"
 #include "libknot/yparser/yptrafo.h"
 #include "contrib/files.h"
+#include "contrib/macros.h"
 #include "contrib/sockaddr.h"
 #include "contrib/string.h"
+#include "contrib/ucw/lists.h"
 
 // The active configuration.
 conf_t *s_conf;
@@ -37,6 +42,9 @@ conf_t* conf(void) {
 	return s_conf;
 }
 
+/*! Source of the configuration instance numbers. */
+static uint64_t conf_serial = 0;
+
 static int init_and_check(
 	conf_t *conf,
 	conf_flag_t flags)
@@ -117,29 +125,46 @@ static void init_cache(
 	bool reinit_cache)
 {
 	/*
-	 * For UDP, TCP, XDP, and background workers, cache the number of running
-	 * workers. Cache the setting of TCP reuseport too. These values
-	 * can't change in runtime, while config data can.
+	 * For UDP, TCP, XDP, zone transfer, and background workers, cache the number of running
+	 * workers. Cache the setting of TCP reuseport, of the CPU placement, of the UDP
+	 * I/O API, and of the UDP and XDP answer cache and batch sizes too. These values can't change
+	 * in runtime, while config data can.
 	 */
 
 	static bool   first_init = true;
 	static bool   running_tcp_reuseport;
 	static bool   running_socket_affinity;
+	static bool   running_socket_steering;
+	static bool   running_cpu_placement;
+	static bool   running_udp_io_uring;
+	static size_t running_udp_answer_cache;
 	static bool   running_xdp_tcp;
 	static bool   running_route_check;
+	static size_t running_xdp_answer_cache;
+	static size_t running_udp_batch_size;
+	static size_t running_xdp_batch_size;
 	static size_t running_udp_threads;
 	static size_t running_tcp_threads;
 	static size_t running_xdp_threads;
+	static size_t running_xfr_threads;
 	static size_t running_bg_threads;
 
 	if (first_init || reinit_cache) {
 		running_tcp_reuseport = conf_get_bool(conf, C_SRV, C_TCP_REUSEPORT);
 		running_socket_affinity = conf_get_bool(conf, C_SRV, C_SOCKET_AFFINITY);
+		running_socket_steering = conf_get_bool(conf, C_SRV, C_SOCKET_STEERING);
+		running_cpu_placement = conf_get_bool(conf, C_SRV, C_CPU_PLACEMENT);
+		running_udp_io_uring = conf_get_bool(conf, C_SRV, C_UDP_IO_URING);
+		running_udp_answer_cache = conf_get_int(conf, C_SRV, C_UDP_ANSWER_CACHE);
 		running_xdp_tcp = conf_get_bool(conf, C_XDP, C_TCP);
 		running_route_check = conf_get_bool(conf, C_XDP, C_ROUTE_CHECK);
+		running_xdp_answer_cache = conf_get_int(conf, C_XDP, C_ANSWER_CACHE);
+		running_udp_batch_size = conf_get_int(conf, C_SRV, C_UDP_BATCH_SIZE);
+		running_xdp_batch_size = conf_get_int(conf, C_XDP, C_BATCH_SIZE);
 		running_udp_threads = conf_udp_threads(conf);
 		running_tcp_threads = conf_tcp_threads(conf);
 		running_xdp_threads = conf_xdp_threads(conf);
+		running_xfr_threads = conf_xfr_threads(conf);
 		running_bg_threads = conf_bg_threads(conf);
 
 		first_init = false;
@@ -169,10 +194,26 @@ static void init_cache(
 	val = conf_get(conf, C_SRV, C_TCP_FASTOPEN);
 	conf->cache.srv_tcp_fastopen = conf_bool(&val);
 
+	val = conf_get(conf, C_SRV, C_TCP_ZEROCOPY);
+	conf->cache.srv_tcp_zerocopy = conf_bool(&val);
+
 	conf->cache.srv_tcp_reuseport = running_tcp_reuseport;
 
 	conf->cache.srv_socket_affinity = running_socket_affinity;
 
+	conf->cache.srv_socket_steering = running_socket_steering;
+
+	conf->cache.srv_cpu_placement = running_cpu_placement;
+
+	val = conf_get(conf, C_SRV, C_UDP_GSO);
+	conf->cache.srv_udp_gso = conf_bool(&val);
+
+	conf->cache.srv_udp_io_uring = running_udp_io_uring;
+
+	conf->cache.srv_udp_answer_cache = running_udp_answer_cache;
+
+	conf->cache.srv_udp_batch_size = running_udp_batch_size;
+
 	val = conf_get(conf, C_SRV, C_DBUS_EVENT);
 	while (val.code == KNOT_EOK) {
 		conf->cache.srv_dbus_event |= conf_opt(&val);
@@ -185,10 +226,18 @@ static void init_cache(
 
 	conf->cache.srv_xdp_threads = running_xdp_threads;
 
+	conf->cache.srv_xfr_threads = running_xfr_threads;
+
 	conf->cache.srv_bg_threads = running_bg_threads;
 
 	conf->cache.srv_tcp_max_clients = conf_tcp_max_clients(conf);
 
+	val = conf_get(conf, C_SRV, C_XFR_REMOTE_LIMIT);
+	conf->cache.srv_xfr_remote_limit = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_XFR_RATE_LIMIT);
+	conf->cache.srv_xfr_rate_limit = conf_int(&val);
+
 	val = conf_get(conf, C_XDP, C_TCP_MAX_CLIENTS);
 	conf->cache.xdp_tcp_max_clients = conf_int(&val);
 
@@ -201,10 +250,17 @@ static void init_cache(
 	val = conf_get(conf, C_XDP, C_TCP_IDLE_RESET);
 	conf->cache.xdp_tcp_idle_reset = conf_int(&val);
 
+	val = conf_get(conf, C_XDP, C_TCP_RESEND);
+	conf->cache.xdp_tcp_resend = conf_int(&val);
+
 	conf->cache.xdp_tcp = running_xdp_tcp;
 
 	conf->cache.xdp_route_check = running_route_check;
 
+	conf->cache.xdp_answer_cache = running_xdp_answer_cache;
+
+	conf->cache.xdp_batch_size = running_xdp_batch_size;
+
 	val = conf_get(conf, C_CTL, C_TIMEOUT);
 	conf->cache.ctl_timeout = conf_int(&val) * 1000;
 	/* infinite_adjust() call isn't needed, 0 is adjusted later anyway. */
@@ -227,6 +283,16 @@ static void init_cache(
 
 	val = conf_get(conf, C_SRV, C_ANS_ROTATION);
 	conf->cache.srv_ans_rotate = conf_bool(&val);
+
+	val = conf_get(conf, C_SRV, C_REFERRAL_CACHE);
+	conf->cache.srv_referral_cache = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_TSIG_SIGN_INTERVAL);
+	conf->cache.srv_tsig_sign_interval = conf_int(&val);
+
+	/* If the compilation fails, the ACLs are evaluated from the confdb. */
+	acl_table_free(conf->cache.acl_table);
+	conf->cache.acl_table = acl_table_new(conf);
 }
 
 int conf_new(
@@ -245,6 +311,7 @@ int conf_new(
 		return KNOT_ENOMEM;
 	}
 	memset(out, 0, sizeof(conf_t));
+	out->serial = __atomic_add_fetch(&conf_serial, 1, __ATOMIC_RELAXED);
 
 	// Initialize config schema.
 	int ret = yp_schema_copy(&out->schema, schema);
@@ -364,6 +431,7 @@ int conf_clone(
 		return KNOT_ENOMEM;
 	}
 	memset(out, 0, sizeof(conf_t));
+	out->serial = __atomic_add_fetch(&conf_serial, 1, __ATOMIC_RELAXED);
 
 	// Initialize config schema.
 	int ret = yp_schema_copy(&out->schema, s_conf->schema);
@@ -470,6 +538,7 @@ void conf_free(
 	yp_schema_free(conf->schema);
 	free(conf->filename);
 	free(conf->hostname);
+	acl_table_free(conf->cache.acl_table);
 	if (conf->api != NULL) {
 		conf->api->txn_abort(&conf->read_txn);
 	}
@@ -501,48 +570,72 @@ void conf_free(
 	         (file != NULL ? "', " : ""), line, ##__VA_ARGS__); \
 	} while (0)
 
-static void log_parser_err(
+/*! Position of a parsed item used for error reporting. */
+typedef struct {
+	const char *file;
+	size_t line;
+	yp_event_t event;
+	const char *key;
+	const char *value;
+	size_t value_len;
+} parse_pos_t;
+
+static void parser_pos(
 	yp_parser_t *parser,
+	parse_pos_t *pos)
+{
+	*pos = (parse_pos_t) {
+		.file = parser->file.name,
+		.line = parser->line_count,
+		.event = parser->event,
+		.key = parser->key,
+		.value = parser->data,
+		.value_len = parser->data_len
+	};
+}
+
+static void log_parser_err(
+	const parse_pos_t *pos,
 	int ret)
 {
-	if (parser->event == YP_ENULL) {
-		CONF_LOG_LINE(parser->file.name, parser->line_count,
+	if (pos->event == YP_ENULL) {
+		CONF_LOG_LINE(pos->file, pos->line,
 		              " (%s)", knot_strerror(ret));
 	} else {
-		CONF_LOG_LINE(parser->file.name, parser->line_count,
-		              ", item '%s'%s%.*s%s (%s)", parser->key,
-		              (parser->data_len > 0) ? ", value '"  : "",
-		              (int)parser->data_len,
-		              (parser->data_len > 0) ? parser->data : "",
-		              (parser->data_len > 0) ? "'"          : "",
+		CONF_LOG_LINE(pos->file, pos->line,
+		              ", item '%s'%s%.*s%s (%s)", pos->key,
+		              (pos->value_len > 0) ? ", value '"  : "",
+		              (int)pos->value_len,
+		              (pos->value_len > 0) ? pos->value : "",
+		              (pos->value_len > 0) ? "'"        : "",
 		              knot_strerror(ret));
 	}
 }
 
 static void log_parser_schema_err(
-	yp_parser_t *parser,
+	const parse_pos_t *pos,
 	int ret)
 {
 	// Emit better message for 'unknown module' error.
-	if (ret == KNOT_YP_EINVAL_ITEM && parser->event == YP_EKEY0 &&
-	    strncmp(parser->key, KNOTD_MOD_NAME_PREFIX, strlen(KNOTD_MOD_NAME_PREFIX)) == 0) {
-		CONF_LOG_LINE(parser->file.name, parser->line_count,
-		              ", unknown module '%s'", parser->key);
+	if (ret == KNOT_YP_EINVAL_ITEM && pos->event == YP_EKEY0 &&
+	    strncmp(pos->key, KNOTD_MOD_NAME_PREFIX, strlen(KNOTD_MOD_NAME_PREFIX)) == 0) {
+		CONF_LOG_LINE(pos->file, pos->line,
+		              ", unknown module '%s'", pos->key);
 	} else {
-		log_parser_err(parser, ret);
+		log_parser_err(pos, ret);
 	}
 }
 
 static void log_call_err(
-	yp_parser_t *parser,
+	const parse_pos_t *pos,
 	knotd_conf_check_args_t *args,
 	int ret)
 {
 	CONF_LOG_LINE(args->extra->file_name, args->extra->line,
 	              ", item '%s'%s%s%s (%s)", args->item->name + 1,
-	              (parser->data_len > 0) ? ", value '"  : "",
-	              (parser->data_len > 0) ? parser->data : "",
-	              (parser->data_len > 0) ? "'"          : "",
+	              (pos->value_len > 0) ? ", value '"  : "",
+	              (pos->value_len > 0) ? pos->value : "",
+	              (pos->value_len > 0) ? "'"        : "",
 	              (args->err_str != NULL) ? args->err_str : knot_strerror(ret));
 }
 
@@ -569,77 +662,388 @@ static void log_prev_err(
 	              args->err_str != NULL ? args->err_str : knot_strerror(ret));
 }
 
-static int finalize_previous_section(
-	conf_t *conf,
-	knot_db_txn_t *txn,
-	yp_parser_t *parser,
-	yp_check_ctx_t *ctx)
+/*!
+ * Parsed and checked configuration event passed to the DB writer.
+ *
+ * The payload consists of the DB identifier, the callback identifier,
+ * the binary data, and the textual key and value for error reporting.
+ */
+typedef struct {
+	enum {
+		PARSE_SECTION, /*!< Finalization of the previous section. */
+		PARSE_ITEM,    /*!< Item to be stored. */
+	} op;
+	size_t size;
+	parse_pos_t pos;
+	const yp_item_t *item;
+	const yp_name_t *key0;
+	const yp_name_t *key1;
+	bool check;
+	size_t db_id_len;
+	size_t id_len;
+	size_t data_len;
+	uint8_t payload[];
+} parse_rec_t;
+
+#define rec_db_id(rec) ((rec)->payload)
+#define rec_id(rec)    (rec_db_id(rec) + (rec)->db_id_len)
+#define rec_data(rec)  (rec_id(rec) + (rec)->id_len)
+
+#define PARSE_BATCH_SIZE	(256 * 1024)
+#define PARSE_QUEUE_DEPTH	8
+
+typedef struct {
+	node_t n;
+	size_t len;
+	size_t max;
+	uint8_t buf[];
+} parse_batch_t;
+
+/*!
+ * Configuration parsing pipeline.
+ *
+ * The parser thread parses the input and checks it against the schema while
+ * the calling thread, which owns the DB transaction, stores the items and
+ * executes the callbacks in the original order. Callbacks extending the schema
+ * or parsing another input are barriers for the parser thread.
+ */
+typedef struct {
+	conf_t *conf;
+	knot_db_txn_t *txn;
+	yp_parser_t *parser;
+	yp_check_ctx_t *ctx;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	list_t batches;     // Batches ready for the writer.
+	size_t pending;     // Queued or being stored batches.
+	parse_batch_t *current;
+	bool threaded;      // The writer doesn't run in the parser thread.
+	bool parsed;        // The parser finished.
+	bool stop;          // The writer failed.
+
+	int parse_ret;      // Parser or schema check result.
+	bool parse_schema;  // The parser result comes from the schema check.
+	int write_ret;      // Writer result.
+} parse_ctx_t;
+
+static bool is_barrier(
+	const yp_item_t *item)
 {
-	yp_node_t *node = &ctx->nodes[0];
-
-	// Return if no previous section or include or empty multi-section.
-	if (node->item == NULL || node->item->type != YP_TGRP ||
-	    (node->id_len == 0 && (node->item->flags & YP_FMULTI) != 0)) {
-		return KNOT_EOK;
+	for (size_t i = 0; i < YP_MAX_MISC_COUNT && item->misc[i] != NULL; i++) {
+		if (item->misc[i] == load_module || item->misc[i] == include_file) {
+			return true;
+		}
 	}
 
+	return false;
+}
+
+static int store_rec(
+	parse_ctx_t *pctx,
+	parse_rec_t *rec)
+{
 	knotd_conf_check_extra_t extra = {
-		.conf = conf,
-		.txn = txn,
-		.file_name = parser->file.name,
-		.line = parser->line_count
+		.conf = pctx->conf,
+		.txn = pctx->txn,
+		.file_name = rec->pos.file,
+		.line = rec->pos.line
 	};
 	knotd_conf_check_args_t args = {
-		.item = node->item,
-		.id = node->id,
-		.id_len = node->id_len,
-		.data = node->data,
-		.data_len = node->data_len,
+		.item = rec->item,
+		.id = rec_id(rec),
+		.id_len = rec->id_len,
+		.data = rec_data(rec),
+		.data_len = rec->data_len,
 		.extra = &extra
 	};
 
-	int ret = conf_exec_callbacks(&args);
+	int ret;
+
+	if (rec->op == PARSE_SECTION) {
+		ret = conf_exec_callbacks(&args);
+		if (ret != KNOT_EOK) {
+			log_prev_err(&args, ret);
+		}
+		return ret;
+	}
+
+	ret = conf_db_set(pctx->conf, pctx->txn, rec->key0, rec->key1,
+	                  rec_db_id(rec), rec->db_id_len,
+	                  rec_data(rec), rec->data_len);
 	if (ret != KNOT_EOK) {
-		log_prev_err(&args, ret);
+		log_parser_err(&rec->pos, ret);
+		return ret;
+	}
+
+	// Section callbacks are executed before another section.
+	if (rec->check) {
+		ret = conf_exec_callbacks(&args);
+		if (ret != KNOT_EOK) {
+			log_call_err(&rec->pos, &args, ret);
+		}
 	}
 
 	return ret;
 }
 
-static int finalize_item(
-	conf_t *conf,
-	knot_db_txn_t *txn,
-	yp_parser_t *parser,
-	yp_check_ctx_t *ctx)
+static int store_batch(
+	parse_ctx_t *pctx,
+	parse_batch_t *batch)
 {
-	yp_node_t *node = &ctx->nodes[ctx->current];
+	for (size_t pos = 0; pos < batch->len; ) {
+		parse_rec_t *rec = (parse_rec_t *)(batch->buf + pos);
+		int ret = store_rec(pctx, rec);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		pos += rec->size;
+	}
 
-	// Section callbacks are executed before another section.
-	if (node->item->type == YP_TGRP && node->id_len == 0) {
-		return KNOT_EOK;
+	return KNOT_EOK;
+}
+
+/*! Hands over the current batch to the writer, returns false if the writer failed. */
+static bool pipeline_flush(
+	parse_ctx_t *pctx)
+{
+	parse_batch_t *batch = pctx->current;
+	pctx->current = NULL;
+
+	if (!pctx->threaded) {
+		if (batch != NULL && !pctx->stop) {
+			pctx->write_ret = store_batch(pctx, batch);
+			pctx->stop = (pctx->write_ret != KNOT_EOK);
+		}
+		free(batch);
+		return !pctx->stop;
 	}
 
-	knotd_conf_check_extra_t extra = {
-		.conf = conf,
-		.txn = txn,
-		.file_name = parser->file.name,
-		.line = parser->line_count
-	};
-	knotd_conf_check_args_t args = {
-		.item = (parser->event == YP_EID) ? node->item->var.g.id : node->item,
-		.id = node->id,
+	pthread_mutex_lock(&pctx->lock);
+	while (batch != NULL && pctx->pending >= PARSE_QUEUE_DEPTH && !pctx->stop) {
+		pthread_cond_wait(&pctx->cond, &pctx->lock);
+	}
+	if (batch != NULL) {
+		add_tail(&pctx->batches, &batch->n);
+		pctx->pending++;
+		pthread_cond_broadcast(&pctx->cond);
+	}
+	bool stop = pctx->stop;
+	pthread_mutex_unlock(&pctx->lock);
+
+	return !stop;
+}
+
+/*! Waits until the writer stores all the passed records. */
+static bool pipeline_drain(
+	parse_ctx_t *pctx)
+{
+	if (!pipeline_flush(pctx)) {
+		return false;
+	}
+
+	pthread_mutex_lock(&pctx->lock);
+	while (pctx->pending > 0 && !pctx->stop) {
+		pthread_cond_wait(&pctx->cond, &pctx->lock);
+	}
+	bool stop = pctx->stop;
+	pthread_mutex_unlock(&pctx->lock);
+
+	return !stop;
+}
+
+static int pipeline_add(
+	parse_ctx_t *pctx,
+	int op,
+	const yp_node_t *node,
+	const yp_node_t *db_node,
+	parse_rec_t **out)
+{
+	yp_parser_t *parser = pctx->parser;
+	size_t db_id_len = (db_node != NULL) ? db_node->id_len : 0;
+	size_t key_len = strlen(parser->key);
+
+	size_t size = sizeof(parse_rec_t) + db_id_len + node->id_len +
+	              node->data_len + key_len + 1 + parser->data_len + 1;
+	size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+	if (pctx->current != NULL &&
+	    pctx->current->len + size > pctx->current->max &&
+	    !pipeline_flush(pctx)) {
+		return KNOT_ERROR; // The writer error is reported instead.
+	}
+	if (pctx->current == NULL) {
+		size_t max = MAX(PARSE_BATCH_SIZE, size);
+		pctx->current = malloc(sizeof(parse_batch_t) + max);
+		if (pctx->current == NULL) {
+			return KNOT_ENOMEM;
+		}
+		pctx->current->len = 0;
+		pctx->current->max = max;
+	}
+
+	parse_rec_t *rec = (parse_rec_t *)(pctx->current->buf + pctx->current->len);
+	pctx->current->len += size;
+
+	*rec = (parse_rec_t) {
+		.op = op,
+		.size = size,
+		.item = node->item,
+		.db_id_len = db_id_len,
 		.id_len = node->id_len,
-		.data = node->data,
-		.data_len = node->data_len,
-		.extra = &extra
+		.data_len = node->data_len
 	};
+	if (db_id_len > 0) {
+		memcpy(rec_db_id(rec), db_node->id, db_id_len);
+	}
+	memcpy(rec_id(rec), node->id, node->id_len);
+	memcpy(rec_data(rec), node->data, node->data_len);
 
-	int ret = conf_exec_callbacks(&args);
+	char *key = (char *)rec_data(rec) + rec->data_len;
+	memcpy(key, parser->key, key_len + 1);
+	char *value = key + key_len + 1;
+	memcpy(value, parser->data, parser->data_len);
+	value[parser->data_len] = '\0';
+
+	parser_pos(parser, &rec->pos);
+	rec->pos.key = key;
+	rec->pos.value = value;
+
+	if (out != NULL) {
+		*out = rec;
+	}
+
+	return KNOT_EOK;
+}
+
+static int pipeline_add_section(
+	parse_ctx_t *pctx)
+{
+	yp_node_t *node = &pctx->ctx->nodes[0];
+
+	// Return if no previous section or include or empty multi-section.
+	if (node->item == NULL || node->item->type != YP_TGRP ||
+	    (node->id_len == 0 && (node->item->flags & YP_FMULTI) != 0)) {
+		return KNOT_EOK;
+	}
+
+	int ret = pipeline_add(pctx, PARSE_SECTION, node, NULL, NULL);
 	if (ret != KNOT_EOK) {
-		log_call_err(parser, &args, ret);
+		return ret;
 	}
 
-	return ret;
+	if (is_barrier(node->item) && !pipeline_drain(pctx)) {
+		return KNOT_ERROR;
+	}
+
+	return KNOT_EOK;
+}
+
+static int pipeline_add_item(
+	parse_ctx_t *pctx)
+{
+	yp_check_ctx_t *ctx = pctx->ctx;
+	yp_node_t *node = &ctx->nodes[ctx->current];
+	yp_node_t *parent = node->parent;
+
+	parse_rec_t *rec;
+	int ret = pipeline_add(pctx, PARSE_ITEM, node,
+	                       (parent != NULL) ? parent : node, &rec);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (parent == NULL) {
+		rec->key0 = node->item->name;
+	} else {
+		rec->key0 = parent->item->name;
+		rec->key1 = node->item->name;
+	}
+	if (pctx->parser->event == YP_EID) {
+		rec->item = node->item->var.g.id;
+	}
+	rec->check = (node->item->type != YP_TGRP || node->id_len > 0);
+
+	if (rec->check && is_barrier(rec->item) && !pipeline_drain(pctx)) {
+		return KNOT_ERROR;
+	}
+
+	return KNOT_EOK;
+}
+
+static void *parser_main(
+	void *arg)
+{
+	parse_ctx_t *pctx = arg;
+	yp_parser_t *parser = pctx->parser;
+
+	int ret, check_ret = KNOT_EOK;
+	while ((ret = yp_parse(parser)) == KNOT_EOK) {
+		if (parser->event == YP_EKEY0 || parser->event == YP_EID) {
+			check_ret = pipeline_add_section(pctx);
+			if (check_ret != KNOT_EOK) {
+				break;
+			}
+		}
+
+		check_ret = yp_schema_check_parser(pctx->ctx, parser);
+		if (check_ret != KNOT_EOK) {
+			pctx->parse_schema = true;
+			break;
+		}
+
+		check_ret = pipeline_add_item(pctx);
+		if (check_ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	if (ret == KNOT_EOF) {
+		ret = pipeline_add_section(pctx);
+	} else if (ret == KNOT_EOK) {
+		ret = check_ret;
+	}
+	pctx->parse_ret = ret;
+
+	pipeline_flush(pctx);
+
+	pthread_mutex_lock(&pctx->lock);
+	pctx->parsed = true;
+	pthread_cond_broadcast(&pctx->cond);
+	pthread_mutex_unlock(&pctx->lock);
+
+	return NULL;
+}
+
+static void writer_main(
+	parse_ctx_t *pctx)
+{
+	pthread_mutex_lock(&pctx->lock);
+	while (true) {
+		while (EMPTY_LIST(pctx->batches) && !pctx->parsed) {
+			pthread_cond_wait(&pctx->cond, &pctx->lock);
+		}
+		if (EMPTY_LIST(pctx->batches)) {
+			break;
+		}
+
+		parse_batch_t *batch = HEAD(pctx->batches);
+		rem_node(&batch->n);
+		bool stop = pctx->stop;
+		pthread_mutex_unlock(&pctx->lock);
+
+		int ret = stop ? KNOT_EOK : store_batch(pctx, batch);
+		free(batch);
+
+		pthread_mutex_lock(&pctx->lock);
+		if (ret != KNOT_EOK) {
+			pctx->write_ret = ret;
+			pctx->stop = true;
+		}
+		pctx->pending--;
+		pthread_cond_broadcast(&pctx->cond);
+	}
+	pthread_mutex_unlock(&pctx->lock);
 }
 
 int conf_parse(
@@ -679,53 +1083,49 @@ int conf_parse(
 		goto parse_error;
 	}
 
-	int check_ret = KNOT_EOK;
-
-	// Parse the configuration.
-	while ((ret = yp_parse(parser)) == KNOT_EOK) {
-		if (parser->event == YP_EKEY0 || parser->event == YP_EID) {
-			check_ret = finalize_previous_section(conf, txn, parser, ctx);
-			if (check_ret != KNOT_EOK) {
-				break;
-			}
-		}
-
-		check_ret = yp_schema_check_parser(ctx, parser);
-		if (check_ret != KNOT_EOK) {
-			log_parser_schema_err(parser, check_ret);
-			break;
-		}
-
-		yp_node_t *node = &ctx->nodes[ctx->current];
-		yp_node_t *parent = node->parent;
-
-		if (parent == NULL) {
-			check_ret = conf_db_set(conf, txn, node->item->name,
-			                        NULL, node->id, node->id_len,
-			                        node->data, node->data_len);
+	parse_ctx_t pctx = {
+		.conf = conf,
+		.txn = txn,
+		.parser = parser,
+		.ctx = ctx,
+		.threaded = true
+	};
+	pthread_mutex_init(&pctx.lock, NULL);
+	pthread_cond_init(&pctx.cond, NULL);
+	init_list(&pctx.batches);
+
+	// The parser thread mustn't receive the server signals.
+	pthread_t thread;
+	sigset_t all, orig;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &orig);
+	if (pthread_create(&thread, NULL, parser_main, &pctx) == 0) {
+		pthread_sigmask(SIG_SETMASK, &orig, NULL);
+		writer_main(&pctx);
+		pthread_join(thread, NULL);
+	} else {
+		// Parse and store in the calling thread.
+		pthread_sigmask(SIG_SETMASK, &orig, NULL);
+		pctx.threaded = false;
+		parser_main(&pctx);
+	}
+
+	pthread_cond_destroy(&pctx.cond);
+	pthread_mutex_destroy(&pctx.lock);
+
+	if (pctx.write_ret != KNOT_EOK) {
+		ret = pctx.write_ret;
+	} else if (pctx.parse_ret != KNOT_EOK) {
+		parse_pos_t pos;
+		parser_pos(parser, &pos);
+		if (pctx.parse_schema) {
+			log_parser_schema_err(&pos, pctx.parse_ret);
 		} else {
-			check_ret = conf_db_set(conf, txn, parent->item->name,
-			                        node->item->name, parent->id,
-			                        parent->id_len, node->data,
-			                        node->data_len);
-		}
-		if (check_ret != KNOT_EOK) {
-			log_parser_err(parser, check_ret);
-			break;
-		}
-
-		check_ret = finalize_item(conf, txn, parser, ctx);
-		if (check_ret != KNOT_EOK) {
-			break;
+			log_parser_err(&pos, pctx.parse_ret);
 		}
-	}
-
-	if (ret == KNOT_EOF) {
-		ret = finalize_previous_section(conf, txn, parser, ctx);
-	} else if (ret != KNOT_EOK) {
-		log_parser_err(parser, ret);
+		ret = pctx.parse_ret;
 	} else {
-		ret = check_ret;
+		ret = KNOT_EOK;
 	}
 
 	yp_schema_check_deinit(ctx);
@@ -38,9 +38,14 @@
 #define CONF_MAX_TCP_WORKERS	256
 /*! Maximum number of background workers. */
 #define CONF_MAX_BG_WORKERS	512
+/*! Maximum number of zone transfer workers. */
+#define CONF_MAX_XFR_WORKERS	64
+/*! Maximum CPU number in a CPU list (exclusive). */
+#define CONF_MAX_CPUS		1024
 /*! Maximum number of concurrent DB readers. */
 #define CONF_MAX_DB_READERS	(CONF_MAX_UDP_WORKERS + CONF_MAX_TCP_WORKERS + \
-				 CONF_MAX_BG_WORKERS + 128 /* XDP workers */)
+				 CONF_MAX_BG_WORKERS + CONF_MAX_XFR_WORKERS + \
+				 128 /* XDP workers */)
 
 /*! Configuration specific logging. */
 #define CONF_LOG(severity, msg, ...) do { \
@@ -87,6 +92,8 @@ struct knot_catalog;
 typedef struct {
 	/*! Cloned configuration indicator. */
 	bool is_clone;
+	/*! Unique number of the configuration instance. */
+	uint64_t serial;
 	/*! Currently used namedb api. */
 	const struct knot_db_api *api;
 	/*! Configuration schema. */
@@ -125,24 +132,40 @@ typedef struct {
 		int srv_tcp_remote_io_timeout;
 		bool srv_tcp_reuseport;
 		bool srv_tcp_fastopen;
+		bool srv_tcp_zerocopy;
 		bool srv_socket_affinity;
+		bool srv_socket_steering;
+		bool srv_cpu_placement;
+		bool srv_udp_gso;
+		bool srv_udp_io_uring;
+		size_t srv_udp_answer_cache;
+		size_t srv_udp_batch_size;
 		unsigned srv_dbus_event;
 		size_t srv_udp_threads;
 		size_t srv_tcp_threads;
 		size_t srv_xdp_threads;
+		size_t srv_xfr_threads;
 		size_t srv_bg_threads;
 		size_t srv_tcp_max_clients;
+		unsigned srv_xfr_remote_limit;
+		size_t srv_xfr_rate_limit;
 		size_t xdp_tcp_max_clients;
 		size_t xdp_tcp_inbuf_max_size;
 		uint32_t xdp_tcp_idle_close;
 		uint32_t xdp_tcp_idle_reset;
+		uint32_t xdp_tcp_resend;
 		bool xdp_tcp;
 		bool xdp_route_check;
+		size_t xdp_answer_cache;
+		size_t xdp_batch_size;
 		int ctl_timeout;
 		const uint8_t *srv_nsid_data;
 		size_t srv_nsid_len;
 		bool srv_ecs;
 		bool srv_ans_rotate;
+		size_t srv_referral_cache;
+		size_t srv_tsig_sign_interval;
+		struct acl_table *acl_table;
 	} cache;
 
 	/*! List of dynamically loaded modules. */
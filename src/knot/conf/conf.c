@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <ctype.h>
 #include <grp.h>
 #include <pwd.h>
 #include <stdio.h>
@@ -1232,6 +1233,17 @@ size_t conf_tcp_threads_txn(
 	return workers;
 }
 
+size_t conf_xfr_threads_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn)
+{
+	conf_val_t val = conf_get_txn(conf, txn, C_SRV, C_XFR_WORKERS);
+	int64_t workers = conf_int(&val);
+	assert(workers <= CONF_MAX_XFR_WORKERS);
+
+	return workers;
+}
+
 size_t conf_xdp_threads_txn(
 	conf_t *conf,
 	knot_db_txn_t *txn)
@@ -1405,6 +1417,12 @@ conf_remote_t conf_remote_txn(
 	val = conf_id_get_txn(conf, txn, C_RMT, C_NO_EDNS, id);
 	out.no_edns = conf_bool(&val);
 
+	val = conf_id_get_txn(conf, txn, C_RMT, C_XFR_LIMIT, id);
+	out.xfr_limit = conf_int(&val);
+
+	val = conf_id_get_txn(conf, txn, C_RMT, C_XFR_RATE, id);
+	out.xfr_rate_limit = conf_int(&val);
+
 	return out;
 }
 
@@ -1447,6 +1465,35 @@ int conf_xdp_iface(
 		iface->port = ret;
 	}
 
+	char members[CONF_XDP_MEMBERS_MAX * sizeof(iface->members[0].name)];
+	int ret = knot_eth_bond_members(iface->name, members, sizeof(members));
+	if (ret < 0) {
+		return (ret == KNOT_ESPACE) ? KNOT_ELIMIT : ret;
+	}
+	iface->member_count = 0;
+	iface->queues = 0;
+
+	/* A bond is served by its members, each with its own queues. */
+	char *saveptr = NULL;
+	for (char *name = (ret > 0) ? strtok_r(members, " ", &saveptr) : NULL;
+	     name != NULL; name = strtok_r(NULL, " ", &saveptr)) {
+		if (iface->member_count == CONF_XDP_MEMBERS_MAX) {
+			return KNOT_ELIMIT;
+		}
+		int queues = knot_eth_queues(name);
+		if (queues <= 0) {
+			assert(queues != 0);
+			return queues;
+		}
+		strlcpy(iface->members[iface->member_count].name, name,
+		        sizeof(iface->members[0].name));
+		iface->members[iface->member_count++].queues = queues;
+		iface->queues += queues;
+	}
+	if (iface->member_count > 0) {
+		return KNOT_EOK;
+	}
+
 	int queues = knot_eth_queues(iface->name);
 	if (queues <= 0) {
 		assert(queues != 0);
@@ -1457,3 +1504,63 @@ int conf_xdp_iface(
 	return KNOT_EOK;
 #endif
 }
+
+int conf_cpu_list(
+	const char *str,
+	unsigned **cpus,
+	size_t *count)
+{
+	if (cpus == NULL || count == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	*cpus = NULL;
+	*count = 0;
+	if (str == NULL || *str == '\0') {
+		return KNOT_EOK;
+	}
+
+	bool set[CONF_MAX_CPUS] = { false };
+	size_t total = 0;
+	const char *pos = str;
+	while (true) {
+		char *end;
+		if (!isdigit((unsigned char)*pos)) {
+			return KNOT_EINVAL;
+		}
+		unsigned long first = strtoul(pos, &end, 10), last = first;
+		if (*end == '-') {
+			pos = end + 1;
+			if (!isdigit((unsigned char)*pos)) {
+				return KNOT_EINVAL;
+			}
+			last = strtoul(pos, &end, 10);
+		}
+		if (last < first || last >= CONF_MAX_CPUS) {
+			return KNOT_ERANGE;
+		}
+		for (unsigned long i = first; i <= last; i++) {
+			total += !set[i];
+			set[i] = true;
+		}
+
+		if (*end == '\0') {
+			break;
+		} else if (*end != ',') {
+			return KNOT_EINVAL;
+		}
+		pos = end + 1;
+	}
+
+	*cpus = malloc(total * sizeof(**cpus));
+	if (*cpus == NULL) {
+		return KNOT_ENOMEM;
+	}
+	for (unsigned i = 0; i < CONF_MAX_CPUS; i++) {
+		if (set[i]) {
+			(*cpus)[(*count)++] = i;
+		}
+	}
+
+	return KNOT_EOK;
+}
@@ -33,6 +33,10 @@ typedef struct {
 	bool block_notify_after_xfr;
 	/*! Disable EDNS on XFR queries. */
 	bool no_edns;
+	/*! Limit of concurrent incoming transfers (0 if unlimited). */
+	unsigned xfr_limit;
+	/*! Limit of the incoming transfer rate in bytes per second (0 if unlimited). */
+	size_t xfr_rate_limit;
 } conf_remote_t;
 
 /*! Configuration section iterator. */
@@ -769,6 +773,24 @@ static inline size_t conf_tcp_threads(
 	return conf_tcp_threads_txn(conf, &conf->read_txn);
 }
 
+/*!
+ * Gets the configured number of zone transfer threads.
+ *
+ * \param[in] conf  Configuration.
+ * \param[in] txn   Configuration DB transaction.
+ *
+ * \return Number of threads.
+ */
+size_t conf_xfr_threads_txn(
+	conf_t *conf,
+	knot_db_txn_t *txn
+);
+static inline size_t conf_xfr_threads(
+	conf_t *conf)
+{
+	return conf_xfr_threads_txn(conf, &conf->read_txn);
+}
+
 /*!
  * Gets the number of used XDP threads.
  *
@@ -824,7 +846,8 @@ static inline size_t conf_lmdb_readers(
 		return 126;
 	}
 	return conf_udp_threads(conf) + conf_tcp_threads(conf) +
-	       conf_bg_threads(conf) + conf_xdp_threads(conf);
+	       conf_bg_threads(conf) + conf_xdp_threads(conf) +
+	       conf_xfr_threads(conf);
 }
 
 /*!
@@ -893,19 +916,31 @@ static inline conf_remote_t conf_remote(
 	return conf_remote_txn(conf, &conf->read_txn, id, index);
 }
 
+/*! Maximal number of the member interfaces of a bond used for XDP. */
+#define CONF_XDP_MEMBERS_MAX	8
+
 /*! XDP interface parameters. */
 typedef struct {
 	/*! Interface name. */
 	char name[32];
 	/*! UDP port to listen on. */
 	uint16_t port;
-	/*! Number of active IO queues. */
+	/*! Number of active IO queues (of all the members if a bond). */
 	uint16_t queues;
+	/*! Number of the member interfaces if a bond, 0 otherwise. */
+	uint16_t member_count;
+	/*! Member interfaces of a bond. */
+	struct {
+		char name[32];    /*!< Member interface name. */
+		uint16_t queues;  /*!< Number of active IO queues of the member. */
+	} members[CONF_XDP_MEMBERS_MAX];
 } conf_xdp_iface_t;
 
 /*!
  * Gets the XDP interface parameters for a given configuration value.
  *
+ * \note A bonding interface is resolved to its member interfaces.
+ *
  * \param[in] addr    XDP interface name stored in the configuration.
  * \param[out] iface  Interface parameters.
  *
@@ -915,3 +950,18 @@ int conf_xdp_iface(
 	struct sockaddr_storage *addr,
 	conf_xdp_iface_t *iface
 );
+
+/*!
+ * Parses a CPU list like "0-3,8" into an ascending array of the CPUs.
+ *
+ * \param[in] str     CPU list (NULL or empty for no CPUs).
+ * \param[out] cpus   Allocated array of the CPUs (NULL if none).
+ * \param[out] count  Number of the CPUs.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int conf_cpu_list(
+	const char *str,
+	unsigned **cpus,
+	size_t *count
+);
@@ -17,6 +17,7 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <glob.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <urcu.h>
@@ -343,6 +344,177 @@ void conf_mod_unload_shared(
 	else \
 		log_##level(LOG_ARGS(mod_id, msg), ##__VA_ARGS__);
 
+/*! Module instance shared by the zones referencing it via 'shared-module'. */
+struct shared_inst {
+	struct shared_inst *next;
+	uint64_t conf_serial;     // Configuration the instance was loaded with.
+	knotd_mod_t *mod;
+	struct query_plan *plan;  // Hooks of the instance.
+	unsigned refs;
+};
+
+static struct shared_inst *shared_insts = NULL;
+static pthread_mutex_t shared_insts_mx = PTHREAD_MUTEX_INITIALIZER;
+
+static bool mod_id_eq(const conf_mod_id_t *a, const conf_mod_id_t *b)
+{
+	return a->name[0] == b->name[0] &&
+	       memcmp(a->name + 1, b->name + 1, a->name[0]) == 0 &&
+	       a->len == b->len && (a->len == 0 || memcmp(a->data, b->data, a->len) == 0);
+}
+
+static struct shared_inst *shared_inst_load(conf_t *conf, struct server *server,
+                                            const knot_dname_t *zone_name,
+                                            conf_val_t *val)
+{
+	conf_mod_id_t *mod_id = conf_mod_id(val);
+	if (mod_id == NULL) {
+		return NULL;
+	}
+
+	struct shared_inst *inst = calloc(1, sizeof(*inst));
+	struct query_plan *plan = query_plan_create();
+	knotd_mod_t *mod = NULL;
+	if (inst == NULL || plan == NULL ||
+	    (mod = query_module_open(conf, server, mod_id, plan, NULL)) == NULL) {
+		MOD_ID_LOG(zone_name, error, mod_id, "failed to open");
+		conf_free_mod_id(mod_id);
+		goto failed;
+	}
+
+	// The instance doesn't belong to any zone, like a global module.
+	if ((mod->api->flags & KNOTD_MOD_FLAG_SCOPE_ANY) != KNOTD_MOD_FLAG_SCOPE_ANY) {
+		MOD_ID_LOG(zone_name, error, mod_id, "can't be shared");
+		goto failed;
+	}
+
+	if (mod->api->load == NULL) {
+		MOD_ID_LOG(zone_name, debug, mod_id, "empty module, not loaded");
+		goto failed;
+	}
+
+	int ret = mod->api->load(mod);
+	if (ret != KNOT_EOK) {
+		MOD_ID_LOG(zone_name, error, mod_id, "failed to load (%s)",
+		           knot_strerror(ret));
+		goto failed;
+	}
+	mod->config = NULL; // Invalidate the current config.
+
+	inst->conf_serial = conf->serial;
+	inst->mod = mod;
+	inst->plan = plan;
+
+	return inst;
+failed:
+	query_module_close(mod);
+	query_plan_free(plan);
+	free(inst);
+	return NULL;
+}
+
+/*! \brief Returns a reference to the instance for the configuration, loads it if missing. */
+static struct shared_inst *shared_inst_get(conf_t *conf, struct server *server,
+                                           const knot_dname_t *zone_name,
+                                           conf_val_t *val, const conf_mod_id_t *mod_id)
+{
+	pthread_mutex_lock(&shared_insts_mx);
+
+	struct shared_inst *inst = shared_insts;
+	while (inst != NULL && (inst->conf_serial != conf->serial ||
+	                        !mod_id_eq(inst->mod->id, mod_id))) {
+		inst = inst->next;
+	}
+
+	if (inst == NULL) {
+		inst = shared_inst_load(conf, server, zone_name, val);
+		if (inst != NULL) {
+			inst->next = shared_insts;
+			shared_insts = inst;
+		}
+	}
+
+	if (inst != NULL) {
+		inst->refs++;
+	}
+
+	pthread_mutex_unlock(&shared_insts_mx);
+
+	return inst;
+}
+
+/*! \brief Drops a reference, the plans using the instance must be already unused. */
+static void shared_inst_release(struct shared_inst *inst)
+{
+	pthread_mutex_lock(&shared_insts_mx);
+
+	if (--inst->refs > 0) {
+		pthread_mutex_unlock(&shared_insts_mx);
+		return;
+	}
+
+	struct shared_inst **it = &shared_insts;
+	while (*it != inst) {
+		it = &(*it)->next;
+	}
+	*it = inst->next;
+
+	pthread_mutex_unlock(&shared_insts_mx);
+
+	if (inst->mod->api->unload != NULL) {
+		inst->mod->api->unload(inst->mod);
+	}
+	query_module_close(inst->mod);
+	query_plan_free(inst->plan);
+	free(inst);
+}
+
+static void activate_shared(conf_t *conf, struct server *server,
+                            const knot_dname_t *zone_name, conf_val_t *val,
+                            list_t *query_modules, struct query_plan *query_plan)
+{
+	while (val->code == KNOT_EOK) {
+		conf_mod_id_t *mod_id = conf_mod_id(val);
+		if (mod_id == NULL) {
+			CONF_LOG_ZONE(LOG_ERR, zone_name, "failed to activate modules (%s)",
+			              knot_strerror(KNOT_ENOMEM));
+			return;
+		}
+
+		// The zone only holds a placeholder referencing the instance.
+		knotd_mod_t *ref = query_module_open(conf, server, mod_id, query_plan,
+		                                     zone_name);
+		if (ref == NULL) {
+			MOD_ID_LOG(zone_name, error, mod_id, "failed to open");
+			conf_free_mod_id(mod_id);
+			goto next_module;
+		}
+
+		ref->shared_inst = shared_inst_get(conf, server, zone_name, val, mod_id);
+		if (ref->shared_inst == NULL) {
+			query_module_close(ref);
+			goto next_module;
+		}
+		ref->config = NULL;
+		add_tail(query_modules, &ref->node);
+
+		// Plan the hooks of the instance for this zone.
+		struct query_plan *plan = ref->shared_inst->plan;
+		for (unsigned stage = KNOTD_STAGE_BEGIN; stage < KNOTD_STAGES; stage++) {
+			struct query_step *step;
+			QUERY_PLAN_WALK(step, plan, stage) {
+				if (query_plan_step(query_plan, stage, step->process,
+				                    step->ctx) != KNOT_EOK) {
+					MOD_ID_LOG(zone_name, error, mod_id, "failed to plan");
+					break;
+				}
+			}
+		}
+next_module:
+		conf_val_next(val);
+	}
+}
+
 void conf_activate_modules(
 	conf_t *conf,
 	struct server *server,
@@ -360,8 +532,10 @@ void conf_activate_modules(
 	conf_val_t val;
 
 	// Get list of associated modules.
+	conf_val_t shared = { NULL, .code = KNOT_ENOENT };
 	if (zone_name != NULL) {
 		val = conf_zone_get(conf, C_MODULE, zone_name);
+		shared = conf_zone_get(conf, C_SHARED_MODULE, zone_name);
 	} else {
 		val = conf_default_get(conf, C_GLOBAL_MODULE);
 	}
@@ -371,6 +545,9 @@ void conf_activate_modules(
 		break;
 	case KNOT_ENOENT: // Check if a module is configured at all.
 	case KNOT_YP_EINVAL_ID:
+		if (shared.code == KNOT_EOK) {
+			break;
+		}
 		return;
 	default:
 		ret = val.code;
@@ -387,6 +564,9 @@ void conf_activate_modules(
 	// Initialize query modules list.
 	init_list(query_modules);
 
+	// The shared modules go first.
+	activate_shared(conf, server, zone_name, &shared, query_modules, *query_plan);
+
 	// Open the modules.
 	while (val.code == KNOT_EOK) {
 		conf_mod_id_t *mod_id = conf_mod_id(&val);
@@ -454,7 +634,9 @@ void conf_deactivate_modules(
 	// Free query modules list.
 	knotd_mod_t *mod, *next;
 	WALK_LIST_DELSAFE(mod, next, *query_modules) {
-		if (mod->api->unload != NULL) {
+		if (mod->shared_inst != NULL) {
+			shared_inst_release(mod->shared_inst);
+		} else if (mod->api->unload != NULL) {
 			mod->api->unload(mod);
 		}
 		query_module_close(mod);
@@ -481,16 +663,34 @@ void conf_reset_modules(
 	synchronize_rcu();
 	query_plan_free(old_plan);
 
-	knotd_mod_t *mod;
-	WALK_LIST(mod, *query_modules) {
+	const knot_dname_t *zone_name = NULL;
+	struct server *server = NULL;
+	knotd_mod_t *mod, *next;
+	WALK_LIST_DELSAFE(mod, next, *query_modules) {
+		zone_name = mod->zone;
+		server = mod->server;
+		if (mod->shared_inst != NULL) {
+			// Referenced again below, rebuilt once for a new configuration.
+			shared_inst_release(mod->shared_inst);
+			rem_node(&mod->node);
+			query_module_close(mod);
+			continue;
+		}
 		if (mod->api->unload != NULL) {
 			mod->api->unload(mod);
 		}
 		query_module_reset(conf, mod, new_plan);
 	}
 
-	knotd_mod_t *next;
+	if (zone_name != NULL) {
+		conf_val_t shared = conf_zone_get(conf, C_SHARED_MODULE, zone_name);
+		activate_shared(conf, server, zone_name, &shared, query_modules, new_plan);
+	}
+
 	WALK_LIST_DELSAFE(mod, next, *query_modules) {
+		if (mod->shared_inst != NULL) {
+			continue;
+		}
 		int ret = mod->api->load(mod);
 		if (ret != KNOT_EOK) {
 			MOD_ID_LOG(mod->zone, error, mod->id, "failed to load (%s)",
@@ -147,6 +147,13 @@ static const knot_lookup_t zonefile_load[] = {
 	{ 0, NULL }
 };
 
+static const knot_lookup_t memory_policies[] = {
+	{ MEMORY_POLICY_DEFAULT,    "default" },
+	{ MEMORY_POLICY_HUGEPAGE,   "hugepage" },
+	{ MEMORY_POLICY_INTERLEAVE, "interleave" },
+	{ 0, NULL }
+};
+
 static const knot_lookup_t log_severities[] = {
 	{ LOG_UPTO(LOG_CRIT),    "critical" },
 	{ LOG_UPTO(LOG_ERR),     "error" },
@@ -171,6 +178,20 @@ static const knot_lookup_t catalog_roles[] = {
 	{ 0, NULL }
 };
 
+static const knot_lookup_t xdp_bind_modes[] = {
+	{ XDP_BIND_AUTO,     "auto" },
+	{ XDP_BIND_ZEROCOPY, "on" },
+	{ XDP_BIND_COPY,     "off" },
+	{ 0, NULL }
+};
+
+static const knot_lookup_t bg_priorities[] = {
+	{ BG_PRIORITY_NORMAL, "normal" },
+	{ BG_PRIORITY_LOW,    "low" },
+	{ BG_PRIORITY_IDLE,   "idle" },
+	{ 0, NULL }
+};
+
 static const knot_lookup_t dbus_events[] = {
 	{ DBUS_EVENT_NONE,            "none" },
 	{ DBUS_EVENT_RUNNING,         "running" },
@@ -197,6 +218,12 @@ static const yp_item_t desc_server[] = {
 	{ C_UDP_WORKERS,          YP_TINT,  YP_VINT = { 1, CONF_MAX_UDP_WORKERS, YP_NIL } },
 	{ C_TCP_WORKERS,          YP_TINT,  YP_VINT = { 1, CONF_MAX_TCP_WORKERS, YP_NIL } },
 	{ C_BG_WORKERS,           YP_TINT,  YP_VINT = { 1, CONF_MAX_BG_WORKERS, YP_NIL } },
+	{ C_BG_CPUS,              YP_TSTR,  YP_VNONE },
+	{ C_BG_PRIORITY,          YP_TOPT,  YP_VOPT = { bg_priorities, BG_PRIORITY_NORMAL } },
+	{ C_SIGNING_RATE_LIMIT,   YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
+	{ C_XFR_WORKERS,          YP_TINT,  YP_VINT = { 0, CONF_MAX_XFR_WORKERS, 0 } },
+	{ C_XFR_REMOTE_LIMIT,     YP_TINT,  YP_VINT = { 0, CONF_MAX_XFR_WORKERS, 0 } },
+	{ C_XFR_RATE_LIMIT,       YP_TINT,  YP_VINT = { 0, SSIZE_MAX, 0, YP_SSIZE } },
 	{ C_ASYNC_START,          YP_TBOOL, YP_VNONE },
 	{ C_TCP_IDLE_TIMEOUT,     YP_TINT,  YP_VINT = { 1, INT32_MAX, 10, YP_STIME } },
 	{ C_TCP_IO_TIMEOUT,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 500 } },
@@ -204,10 +231,18 @@ static const yp_item_t desc_server[] = {
 	{ C_TCP_MAX_CLIENTS,      YP_TINT,  YP_VINT = { 0, INT32_MAX, YP_NIL } },
 	{ C_TCP_REUSEPORT,        YP_TBOOL, YP_VNONE },
 	{ C_TCP_FASTOPEN,         YP_TBOOL, YP_VNONE },
+	{ C_TCP_ZEROCOPY,         YP_TBOOL, YP_VNONE },
 	{ C_RMT_POOL_LIMIT,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
 	{ C_RMT_POOL_TIMEOUT,     YP_TINT,  YP_VINT = { 1, INT32_MAX, 5, YP_STIME } },
+	{ C_RMT_POOL_MUX,         YP_TBOOL, YP_VNONE },
 	{ C_RMT_RETRY_DELAY,      YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
 	{ C_SOCKET_AFFINITY,      YP_TBOOL, YP_VNONE },
+	{ C_SOCKET_STEERING,      YP_TBOOL, YP_VNONE },
+	{ C_CPU_PLACEMENT,        YP_TBOOL, YP_VNONE },
+	{ C_UDP_ANSWER_CACHE,     YP_TINT,  YP_VINT = { 0, 65536, 0 } },
+	{ C_UDP_BATCH_SIZE,       YP_TINT,  YP_VINT = { 1, 1024, 64 } },
+	{ C_UDP_GSO,              YP_TBOOL, YP_VNONE },
+	{ C_UDP_IO_URING,         YP_TBOOL, YP_VNONE },
 	{ C_UDP_MAX_PAYLOAD,      YP_TINT,  YP_VINT = { KNOT_EDNS_MIN_DNSSEC_PAYLOAD,
 	                                                KNOT_EDNS_MAX_UDP_PAYLOAD,
 	                                                1232, YP_SSIZE } },
@@ -219,8 +254,14 @@ static const yp_item_t desc_server[] = {
 	                                                1232, YP_SSIZE } },
 	{ C_ECS,                  YP_TBOOL, YP_VNONE },
 	{ C_ANS_ROTATION,         YP_TBOOL, YP_VNONE },
+	{ C_REFERRAL_CACHE,       YP_TINT,  YP_VINT = { 0, 1048576, 0 } },
+	{ C_COLD_STORAGE,         YP_TSTR,  YP_VNONE },
+	{ C_TSIG_SIGN_INTERVAL,   YP_TINT,  YP_VINT = { 1, 100, 1 } },
 	{ C_DBUS_EVENT,           YP_TOPT,  YP_VOPT = { dbus_events, DBUS_EVENT_NONE }, YP_FMULTI },
 	{ C_LISTEN,               YP_TADDR, YP_VADDR = { 53 }, YP_FMULTI, { check_listen } },
+	{ C_LISTEN_TLS,           YP_TADDR, YP_VADDR = { 853 }, YP_FMULTI, { check_listen } },
+	{ C_TLS_CERT,             YP_TSTR,  YP_VNONE },
+	{ C_TLS_KEY,              YP_TSTR,  YP_VNONE },
 	{ C_COMMENT,              YP_TSTR,  YP_VNONE },
 	// Legacy items.
 	{ C_LISTEN_XDP,           YP_TADDR, YP_VADDR = { 53 }, YP_FMULTI, { check_xdp_listen_old } },
@@ -246,7 +287,17 @@ static const yp_item_t desc_xdp[] = {
 	{ C_TCP_INBUF_MAX_SIZE,   YP_TINT,  YP_VINT = { MEGA(1), SSIZE_MAX, MEGA(100), YP_SSIZE } },
 	{ C_TCP_IDLE_CLOSE,       YP_TINT,  YP_VINT = { 1, INT32_MAX, 10, YP_STIME } },
 	{ C_TCP_IDLE_RESET,       YP_TINT,  YP_VINT = { 1, INT32_MAX, 20, YP_STIME } },
+	{ C_TCP_RESEND,           YP_TINT,  YP_VINT = { 10, 60000, 1000 } },
 	{ C_ROUTE_CHECK,          YP_TBOOL, YP_VNONE },
+	{ C_RATE_LIMIT,           YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
+	{ C_RATE_LIMIT_SLIP,      YP_TINT,  YP_VINT = { 0, 100, 2 } },
+	{ C_ANSWER_CACHE,         YP_TINT,  YP_VINT = { 0, 65536, 0 } },
+	{ C_DENY_PREFIX,          YP_TNET,  YP_VNONE, YP_FMULTI },
+	{ C_ALLOW_PREFIX,         YP_TNET,  YP_VNONE, YP_FMULTI },
+	{ C_BATCH_SIZE,           YP_TINT,  YP_VINT = { 1, 1024, 64 } },
+	{ C_ZERO_COPY,            YP_TOPT,  YP_VOPT = { xdp_bind_modes, XDP_BIND_AUTO } },
+	{ C_BUSYPOLL_TIMEOUT,     YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
+	{ C_BUSYPOLL_BUDGET,      YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 } },
 	{ NULL }
 };
 
@@ -263,6 +314,7 @@ static const yp_item_t desc_log[] = {
 	{ C_CTL,     YP_TOPT, YP_VOPT = { log_severities, 0 } },
 	{ C_ZONE,    YP_TOPT, YP_VOPT = { log_severities, 0 } },
 	{ C_ANY,     YP_TOPT, YP_VOPT = { log_severities, 0 } },
+	{ C_ASYNC,   YP_TBOOL, YP_VNONE },
 	{ C_COMMENT, YP_TSTR, YP_VNONE },
 	{ NULL }
 };
@@ -271,6 +323,8 @@ static const yp_item_t desc_stats[] = {
 	{ C_TIMER,   YP_TINT,  YP_VINT = { 1, UINT32_MAX, 0, YP_STIME } },
 	{ C_FILE,    YP_TSTR,  YP_VSTR = { "stats.yaml" } },
 	{ C_APPEND,  YP_TBOOL, YP_VNONE },
+	{ C_METRICS_LISTEN,     YP_TADDR, YP_VADDR = { 9433 } },
+	{ C_METRICS_ZONE_LIMIT, YP_TINT,  YP_VINT = { 0, UINT32_MAX, 1000 } },
 	{ C_COMMENT, YP_TSTR,  YP_VNONE },
 	{ NULL }
 };
@@ -281,6 +335,8 @@ static const yp_item_t desc_database[] = {
 	{ C_JOURNAL_DB_MODE,     YP_TOPT,  YP_VOPT = { journal_modes, JOURNAL_MODE_ROBUST } },
 	{ C_JOURNAL_DB_MAX_SIZE, YP_TINT,  YP_VINT = { MEGA(1), VIRT_MEM_LIMIT(TERA(100)),
 	                                               VIRT_MEM_LIMIT(GIGA(20)), YP_SSIZE } },
+	{ C_JOURNAL_DB_COMMIT_DELAY, YP_TINT, YP_VINT = { 0, 1000, 0 } },
+	{ C_JOURNAL_DB_SHARDS,   YP_TINT,  YP_VINT = { 1, JOURNAL_DB_SHARDS_MAX, 1 } },
 	{ C_KASP_DB,             YP_TSTR,  YP_VSTR = { "keys" } },
 	{ C_KASP_DB_MAX_SIZE,    YP_TINT,  YP_VINT = { MEGA(5), VIRT_MEM_LIMIT(GIGA(100)),
 	                                               MEGA(500), YP_SSIZE } },
@@ -317,6 +373,8 @@ static const yp_item_t desc_remote[] = {
 	{ C_KEY,              YP_TREF,  YP_VREF = { C_KEY }, YP_FNONE, { check_ref } },
 	{ C_BLOCK_NOTIFY_XFR, YP_TBOOL, YP_VNONE },
 	{ C_NO_EDNS,          YP_TBOOL, YP_VNONE },
+	{ C_XFR_LIMIT,        YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
+	{ C_XFR_RATE,         YP_TINT,  YP_VINT = { 0, SSIZE_MAX, 0, YP_SSIZE } },
 	{ C_COMMENT,          YP_TSTR,  YP_VNONE },
 	{ NULL }
 };
@@ -387,6 +445,8 @@ static const yp_item_t desc_policy[] = {
 	                                   CONF_IO_FRLD_ZONES },
 	{ C_RRSIG_PREREFRESH,    YP_TINT,  YP_VINT = { 0, UINT32_MAX, HOURS(1), YP_STIME },
 	                                   CONF_IO_FRLD_ZONES },
+	{ C_RRSIG_JITTER,        YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME },
+	                                   CONF_IO_FRLD_ZONES },
 	{ C_REPRO_SIGNING,       YP_TBOOL, YP_VNONE, CONF_IO_FRLD_ZONES },
 	{ C_NSEC3,               YP_TBOOL, YP_VNONE, CONF_IO_FRLD_ZONES },
 	{ C_NSEC3_ITER,          YP_TINT,  YP_VINT = { 0, UINT16_MAX, 0 }, CONF_IO_FRLD_ZONES },
@@ -413,7 +473,10 @@ static const yp_item_t desc_policy[] = {
 	{ C_STORAGE,             YP_TSTR,  YP_VSTR = { STORAGE_DIR }, FLAGS }, \
 	{ C_FILE,                YP_TSTR,  YP_VNONE, FLAGS }, \
 	{ C_MASTER,              YP_TREF,  YP_VREF = { C_RMT, C_RMTS }, YP_FMULTI, { check_ref } }, \
+	{ C_CLONE_SOURCE,        YP_TDNAME,YP_VNONE, FLAGS }, \
 	{ C_DDNS_MASTER,         YP_TREF,  YP_VREF = { C_RMT }, YP_FNONE, { check_ref } }, \
+	{ C_DDNS_DELAY,          YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } }, \
+	{ C_DDNS_BATCH,          YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0 } }, \
 	{ C_NOTIFY,              YP_TREF,  YP_VREF = { C_RMT, C_RMTS }, YP_FMULTI, { check_ref } }, \
 	{ C_ACL,                 YP_TREF,  YP_VREF = { C_ACL }, YP_FMULTI, { check_ref } }, \
 	{ C_SEM_CHECKS,          YP_TBOOL, YP_VNONE, FLAGS }, \
@@ -422,22 +485,35 @@ static const yp_item_t desc_policy[] = {
 	{ C_JOURNAL_CONTENT,     YP_TOPT,  YP_VOPT = { journal_content, JOURNAL_CONTENT_CHANGES }, FLAGS }, \
 	{ C_JOURNAL_MAX_USAGE,   YP_TINT,  YP_VINT = { KILO(40), SSIZE_MAX, MEGA(100), YP_SSIZE } }, \
 	{ C_JOURNAL_MAX_DEPTH,   YP_TINT,  YP_VINT = { 2, SSIZE_MAX, 20 } }, \
+	{ C_JOURNAL_COMPRESS,    YP_TBOOL, YP_VNONE }, \
 	{ C_ZONE_MAX_SIZE,       YP_TINT,  YP_VINT = { 0, SSIZE_MAX, SSIZE_MAX, YP_SSIZE }, FLAGS }, \
+	{ C_IXFR_APPLY_WINDOW,   YP_TINT,  YP_VINT = { 0, SSIZE_MAX, SSIZE_MAX, YP_SSIZE } }, \
+	{ C_IDLE_UNLOAD,         YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } }, \
 	{ C_ADJUST_THR,          YP_TINT,  YP_VINT = { 1, UINT16_MAX, 1 } }, \
+	{ C_MEMORY_POLICY,       YP_TOPT,  YP_VOPT = { memory_policies, MEMORY_POLICY_DEFAULT } }, \
+	{ C_NUMA_REPLICAS,       YP_TBOOL, YP_VNONE }, \
+	{ C_RDATA_SHARING,       YP_TBOOL, YP_VNONE }, \
+	{ C_COLD_RRSIG,          YP_TBOOL, YP_VNONE }, \
+	{ C_SHARED_SNAPSHOT,     YP_TBOOL, YP_VNONE }, \
 	{ C_DNSSEC_SIGNING,      YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_DNSSEC_VALIDATION,   YP_TBOOL, YP_VNONE, FLAGS }, \
 	{ C_DNSSEC_POLICY,       YP_TREF,  YP_VREF = { C_POLICY }, FLAGS, { check_ref_dflt } }, \
 	{ C_SERIAL_POLICY,       YP_TOPT,  YP_VOPT = { serial_policies, SERIAL_POLICY_INCREMENT } }, \
 	{ C_ZONEMD_GENERATE,     YP_TOPT,  YP_VOPT = { zone_digest, ZONE_DIGEST_NONE }, FLAGS }, \
 	{ C_ZONEMD_VERIFY,       YP_TBOOL, YP_VNONE, FLAGS }, \
+	{ C_ZONEMD_CACHE,        YP_TBOOL, YP_VNONE }, \
 	{ C_REFRESH_MIN_INTERVAL,YP_TINT,  YP_VINT = { 2, UINT32_MAX, 2, YP_STIME } }, \
 	{ C_REFRESH_MAX_INTERVAL,YP_TINT,  YP_VINT = { 2, UINT32_MAX, UINT32_MAX, YP_STIME } }, \
+	{ C_NOTIFY_DEBOUNCE,     YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } }, \
+	{ C_NOTIFY_DEBOUNCE_MAX, YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } }, \
 	{ C_CATALOG_ROLE,        YP_TOPT,  YP_VOPT = { catalog_roles, CATALOG_ROLE_NONE }, FLAGS }, \
 	{ C_CATALOG_TPL,         YP_TREF,  YP_VREF = { C_TPL }, YP_FMULTI | FLAGS, { check_ref } }, \
 	{ C_CATALOG_ZONE,        YP_TDNAME,YP_VNONE, FLAGS | CONF_IO_FRLD_ZONES }, \
 	{ C_CATALOG_GROUP,       YP_TSTR,  YP_VNONE, FLAGS | CONF_IO_FRLD_ZONES, { check_catalog_group } }, \
 	{ C_MODULE,              YP_TDATA, YP_VDATA = { 0, NULL, mod_id_to_bin, mod_id_to_txt }, \
 	                                   YP_FMULTI | FLAGS, { check_modref } }, \
+	{ C_SHARED_MODULE,       YP_TDATA, YP_VDATA = { 0, NULL, mod_id_to_bin, mod_id_to_txt }, \
+	                                   YP_FMULTI | FLAGS, { check_modref } }, \
 	{ C_COMMENT,             YP_TSTR,  YP_VNONE }, \
 	/* Legacy items.*/ \
 	{ C_DISABLE_ANY,         YP_TBOOL, YP_VNONE }, \
@@ -491,7 +567,8 @@ const yp_item_t conf_schema[] = {
 	{ C_ACL,      YP_TGRP, YP_VGRP = { desc_acl }, YP_FMULTI, { check_acl } },
 	{ C_SBM,      YP_TGRP, YP_VGRP = { desc_submission }, YP_FMULTI },
 	{ C_POLICY,   YP_TGRP, YP_VGRP = { desc_policy }, YP_FMULTI, { check_policy } },
-	{ C_TPL,      YP_TGRP, YP_VGRP = { desc_template }, YP_FMULTI, { check_template } },
+	{ C_TPL,      YP_TGRP, YP_VGRP = { desc_template }, YP_FMULTI | CONF_IO_FTPL,
+	                                                    { check_template } },
 	{ C_ZONE,     YP_TGRP, YP_VGRP = { desc_zone }, YP_FMULTI | CONF_IO_FZONE, { check_zone } },
 	{ C_INCL,     YP_TSTR, YP_VNONE, CONF_IO_FDIFF_ZONES | CONF_IO_FRLD_ALL, { include_file } },
 	{ NULL }
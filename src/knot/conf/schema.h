@@ -24,12 +24,20 @@
 #define C_ADDR			"\x07""address"
 #define C_ADJUST_THR		"\x0E""adjust-threads"
 #define C_ALG			"\x09""algorithm"
+#define C_ALLOW_PREFIX		"\x0C""allow-prefix"
 #define C_ANS_ROTATION		"\x0F""answer-rotation"
+#define C_ANSWER_CACHE		"\x0C""answer-cache"
 #define C_ANY			"\x03""any"
 #define C_APPEND		"\x06""append"
+#define C_ASYNC			"\x05""async"
 #define C_ASYNC_START		"\x0B""async-start"
 #define C_BACKEND		"\x07""backend"
+#define C_BATCH_SIZE		"\x0A""batch-size"
+#define C_BG_CPUS		"\x0F""background-cpus"
+#define C_BG_PRIORITY		"\x13""background-priority"
 #define C_BG_WORKERS		"\x12""background-workers"
+#define C_BUSYPOLL_BUDGET	"\x0F""busypoll-budget"
+#define C_BUSYPOLL_TIMEOUT	"\x10""busypoll-timeout"
 #define C_BLOCK_NOTIFY_XFR	"\x1B""block-notify-after-transfer"
 #define C_CATALOG_DB		"\x0A""catalog-db"
 #define C_CATALOG_DB_MAX_SIZE	"\x13""catalog-db-max-size"
@@ -40,13 +48,20 @@
 #define C_CDS_CDNSKEY		"\x13""cds-cdnskey-publish"
 #define C_CDS_DIGESTTYPE	"\x0F""cds-digest-type"
 #define C_CHK_INTERVAL		"\x0E""check-interval"
+#define C_CLONE_SOURCE		"\x0C""clone-source"
+#define C_COLD_RRSIG		"\x0A""cold-rrsig"
+#define C_COLD_STORAGE		"\x0C""cold-storage"
 #define C_COMMENT		"\x07""comment"
 #define C_CONFIG		"\x06""config"
+#define C_CPU_PLACEMENT		"\x0D""cpu-placement"
 #define C_CTL			"\x07""control"
 #define C_DB			"\x08""database"
 #define C_DBUS_EVENT		"\x0A""dbus-event"
+#define C_DDNS_BATCH		"\x0A""ddns-batch"
+#define C_DDNS_DELAY		"\x0A""ddns-delay"
 #define C_DDNS_MASTER		"\x0B""ddns-master"
 #define C_DENY			"\x04""deny"
+#define C_DENY_PREFIX		"\x0B""deny-prefix"
 #define C_DNSKEY_TTL		"\x0A""dnskey-ttl"
 #define C_DNSSEC_POLICY		"\x0D""dnssec-policy"
 #define C_DNSSEC_SIGNING	"\x0E""dnssec-signing"
@@ -58,11 +73,16 @@
 #define C_GLOBAL_MODULE		"\x0D""global-module"
 #define C_ID			"\x02""id"
 #define C_IDENT			"\x08""identity"
+#define C_IDLE_UNLOAD		"\x0B""idle-unload"
 #define C_INCL			"\x07""include"
+#define C_JOURNAL_COMPRESS	"\x13""journal-compression"
 #define C_JOURNAL_CONTENT	"\x0F""journal-content"
 #define C_JOURNAL_DB		"\x0A""journal-db"
+#define C_JOURNAL_DB_COMMIT_DELAY	"\x17""journal-db-commit-delay"
 #define C_JOURNAL_DB_MAX_SIZE	"\x13""journal-db-max-size"
 #define C_JOURNAL_DB_MODE	"\x0F""journal-db-mode"
+#define C_JOURNAL_DB_SHARDS	"\x11""journal-db-shards"
+#define C_IXFR_APPLY_WINDOW	"\x11""ixfr-apply-window"
 #define C_JOURNAL_MAX_DEPTH	"\x11""journal-max-depth"
 #define C_JOURNAL_MAX_USAGE	"\x11""journal-max-usage"
 #define C_KASP_DB		"\x07""kasp-db"
@@ -75,24 +95,32 @@
 #define C_KSK_SHARED		"\x0a""ksk-shared"
 #define C_KSK_SIZE		"\x08""ksk-size"
 #define C_LISTEN		"\x06""listen"
+#define C_LISTEN_TLS		"\x0A""listen-tls"
 #define C_LOG			"\x03""log"
 #define C_MANUAL		"\x06""manual"
 #define C_MASTER		"\x06""master"
+#define C_MEMORY_POLICY		"\x0D""memory-policy"
+#define C_METRICS_LISTEN	"\x0E""metrics-listen"
+#define C_METRICS_ZONE_LIMIT	"\x12""metrics-zone-limit"
 #define C_MODULE		"\x06""module"
 #define C_NO_EDNS		"\x07""no-edns"
 #define C_NOTIFY		"\x06""notify"
+#define C_NOTIFY_DEBOUNCE	"\x0F""notify-debounce"
+#define C_NOTIFY_DEBOUNCE_MAX	"\x13""notify-debounce-max"
 #define C_NSEC3			"\x05""nsec3"
 #define C_NSEC3_ITER		"\x10""nsec3-iterations"
 #define C_NSEC3_OPT_OUT		"\x0D""nsec3-opt-out"
 #define C_NSEC3_SALT_LEN	"\x11""nsec3-salt-length"
 #define C_NSEC3_SALT_LIFETIME	"\x13""nsec3-salt-lifetime"
 #define C_NSID			"\x04""nsid"
+#define C_NUMA_REPLICAS		"\x0D""numa-replicas"
 #define C_OFFLINE_KSK		"\x0B""offline-ksk"
 #define C_PARENT		"\x06""parent"
 #define C_PARENT_DELAY		"\x0C""parent-delay"
 #define C_PIDFILE		"\x07""pidfile"
 #define C_POLICY		"\x06""policy"
 #define C_PROPAG_DELAY		"\x11""propagation-delay"
+#define C_REFERRAL_CACHE	"\x0E""referral-cache"
 #define C_REFRESH_MAX_INTERVAL	"\x14""refresh-max-interval"
 #define C_REFRESH_MIN_INTERVAL	"\x14""refresh-min-interval"
 #define C_REPRO_SIGNING		"\x14""reproducible-signing"
@@ -100,8 +128,13 @@
 #define C_RMTS			"\x07""remotes"
 #define C_RMT_POOL_LIMIT	"\x11""remote-pool-limit"
 #define C_RMT_POOL_TIMEOUT	"\x13""remote-pool-timeout"
+#define C_RMT_POOL_MUX		"\x15""remote-pool-multiplex"
+#define C_RATE_LIMIT		"\x0A""rate-limit"
+#define C_RATE_LIMIT_SLIP	"\x0F""rate-limit-slip"
+#define C_RDATA_SHARING		"\x0D""rdata-sharing"
 #define C_RMT_RETRY_DELAY	"\x12""remote-retry-delay"
 #define C_ROUTE_CHECK		"\x0B""route-check"
+#define C_RRSIG_JITTER		"\x0C""rrsig-jitter"
 #define C_RRSIG_LIFETIME	"\x0E""rrsig-lifetime"
 #define C_RRSIG_PREREFRESH	"\x11""rrsig-pre-refresh"
 #define C_RRSIG_REFRESH		"\x0D""rrsig-refresh"
@@ -111,9 +144,13 @@
 #define C_SEM_CHECKS		"\x0F""semantic-checks"
 #define C_SERIAL_POLICY		"\x0D""serial-policy"
 #define C_SERVER		"\x06""server"
+#define C_SHARED_MODULE		"\x0D""shared-module"
+#define C_SHARED_SNAPSHOT	"\x0F""shared-snapshot"
+#define C_SIGNING_RATE_LIMIT	"\x12""signing-rate-limit"
 #define C_SIGNING_THREADS	"\x0F""signing-threads"
 #define C_SINGLE_TYPE_SIGNING	"\x13""single-type-signing"
 #define C_SOCKET_AFFINITY	"\x0F""socket-affinity"
+#define C_SOCKET_STEERING	"\x0F""socket-steering"
 #define C_SRV			"\x06""server"
 #define C_STATS			"\x0A""statistics"
 #define C_STORAGE		"\x07""storage"
@@ -126,14 +163,23 @@
 #define C_TCP_INBUF_MAX_SIZE	"\x12""tcp-inbuf-max-size"
 #define C_TCP_IO_TIMEOUT	"\x0E""tcp-io-timeout"
 #define C_TCP_MAX_CLIENTS	"\x0F""tcp-max-clients"
+#define C_TCP_RESEND		"\x12""tcp-resend-timeout"
 #define C_TCP_REUSEPORT		"\x0D""tcp-reuseport"
+#define C_TCP_ZEROCOPY		"\x0C""tcp-zerocopy"
 #define C_TCP_RMT_IO_TIMEOUT	"\x15""tcp-remote-io-timeout"
 #define C_TCP_WORKERS		"\x0B""tcp-workers"
 #define C_TIMEOUT		"\x07""timeout"
 #define C_TIMER			"\x05""timer"
 #define C_TIMER_DB		"\x08""timer-db"
 #define C_TIMER_DB_MAX_SIZE	"\x11""timer-db-max-size"
+#define C_TLS_CERT		"\x0F""tls-certificate"
+#define C_TLS_KEY		"\x07""tls-key"
 #define C_TPL			"\x08""template"
+#define C_TSIG_SIGN_INTERVAL	"\x12""tsig-sign-interval"
+#define C_UDP_ANSWER_CACHE	"\x10""udp-answer-cache"
+#define C_UDP_BATCH_SIZE	"\x0E""udp-batch-size"
+#define C_UDP_GSO		"\x07""udp-gso"
+#define C_UDP_IO_URING		"\x0C""udp-io-uring"
 #define C_UDP_MAX_PAYLOAD	"\x0F""udp-max-payload"
 #define C_UDP_MAX_PAYLOAD_IPV4	"\x14""udp-max-payload-ipv4"
 #define C_UDP_MAX_PAYLOAD_IPV6	"\x14""udp-max-payload-ipv6"
@@ -147,9 +193,16 @@
 #define C_VERSION		"\x07""version"
 #define C_VIA			"\x03""via"
 #define C_XDP			"\x03""xdp"
+#define C_XFR_LIMIT		"\x0E""transfer-limit"
+#define C_XFR_RATE		"\x13""transfer-rate-limit"
+#define C_XFR_RATE_LIMIT	"\x0E""xfr-rate-limit"
+#define C_XFR_REMOTE_LIMIT	"\x10""xfr-remote-limit"
+#define C_XFR_WORKERS		"\x0B""xfr-workers"
+#define C_ZERO_COPY		"\x09""zero-copy"
 #define C_ZONE			"\x04""zone"
 #define C_ZONEFILE_LOAD		"\x0D""zonefile-load"
 #define C_ZONEFILE_SYNC		"\x0D""zonefile-sync"
+#define C_ZONEMD_CACHE		"\x0C""zonemd-cache"
 #define C_ZONEMD_GENERATE	"\x0F""zonemd-generate"
 #define C_ZONEMD_VERIFY		"\x0D""zonemd-verify"
 #define C_ZONE_MAX_SIZE		"\x0D""zone-max-size"
@@ -220,6 +273,8 @@ enum {
 	JOURNAL_MODE_ASYNC  = 1, // Asynchronous journal DB disk synchronization.
 };
 
+#define JOURNAL_DB_SHARDS_MAX	64
+
 enum {
 	ZONEFILE_LOAD_NONE  = 0,
 	ZONEFILE_LOAD_DIFF  = 1,
@@ -227,6 +282,12 @@ enum {
 	ZONEFILE_LOAD_DIFSE = 3,
 };
 
+enum {
+	MEMORY_POLICY_DEFAULT    = 0,
+	MEMORY_POLICY_HUGEPAGE   = 1,
+	MEMORY_POLICY_INTERLEAVE = 2,
+};
+
 enum {
 	CATALOG_ROLE_NONE      = 0,
 	CATALOG_ROLE_INTERPRET = 1,
@@ -234,6 +295,18 @@ enum {
 	CATALOG_ROLE_MEMBER    = 3,
 };
 
+enum {
+	XDP_BIND_AUTO     = 0,
+	XDP_BIND_ZEROCOPY = 1,
+	XDP_BIND_COPY     = 2,
+};
+
+enum {
+	BG_PRIORITY_NORMAL = 0,
+	BG_PRIORITY_LOW    = 1,
+	BG_PRIORITY_IDLE   = 2,
+};
+
 enum {
 	DBUS_EVENT_NONE            = 0,
 	DBUS_EVENT_RUNNING         = (1 << 0),
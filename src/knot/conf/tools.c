@@ -497,6 +497,29 @@ int check_server(
 	CHECK_LEGACY_NAME(C_SRV, C_MAX_IPV4_UDP_PAYLOAD, C_UDP_MAX_PAYLOAD_IPV4);
 	CHECK_LEGACY_NAME(C_SRV, C_MAX_IPV6_UDP_PAYLOAD, C_UDP_MAX_PAYLOAD_IPV6);
 
+	conf_val_t listen_tls = conf_get_txn(args->extra->conf, args->extra->txn,
+	                                     C_SRV, C_LISTEN_TLS);
+	if (listen_tls.code == KNOT_EOK) {
+		conf_val_t cert = conf_get_txn(args->extra->conf, args->extra->txn,
+		                               C_SRV, C_TLS_CERT);
+		conf_val_t key = conf_get_txn(args->extra->conf, args->extra->txn,
+		                              C_SRV, C_TLS_KEY);
+		if (cert.code != KNOT_EOK || key.code != KNOT_EOK) {
+			args->err_str = "no TLS certificate or key defined";
+			return KNOT_EINVAL;
+		}
+	}
+
+	conf_val_t bg_cpus = conf_get_txn(args->extra->conf, args->extra->txn,
+	                                  C_SRV, C_BG_CPUS);
+	unsigned *cpus = NULL;
+	size_t count = 0;
+	if (conf_cpu_list(conf_str(&bg_cpus), &cpus, &count) != KNOT_EOK) {
+		args->err_str = "invalid background CPU list";
+		return KNOT_EINVAL;
+	}
+	free(cpus);
+
 	return KNOT_EOK;
 }
 
@@ -516,6 +539,23 @@ int check_xdp(
 		check_mtu(args, &xdp_listen);
 	}
 
+	/* The filter matches only the network prefixes. */
+	const char *prefix_items[] = { C_DENY_PREFIX, C_ALLOW_PREFIX };
+	for (size_t i = 0; i < sizeof(prefix_items) / sizeof(*prefix_items); i++) {
+		conf_val_t val = conf_get_txn(args->extra->conf, args->extra->txn,
+		                              C_XDP, prefix_items[i]);
+		while (val.code == KNOT_EOK) {
+			struct sockaddr_storage max_ss;
+			int prefix_len;
+			(void)conf_addr_range(&val, &max_ss, &prefix_len);
+			if (max_ss.ss_family != AF_UNSPEC) {
+				args->err_str = "address ranges not supported, use network prefixes";
+				return KNOT_EINVAL;
+			}
+			conf_val_next(&val);
+		}
+	}
+
 	return KNOT_EOK;
 }
 
@@ -552,6 +592,8 @@ int check_policy(
 	                                    C_RRSIG_REFRESH, args->id, args->id_len);
 	conf_val_t prerefresh = conf_rawid_get_txn(args->extra->conf, args->extra->txn, C_POLICY,
 	                                    C_RRSIG_PREREFRESH, args->id, args->id_len);
+	conf_val_t jitter = conf_rawid_get_txn(args->extra->conf, args->extra->txn, C_POLICY,
+	                                    C_RRSIG_JITTER, args->id, args->id_len);
 	conf_val_t prop_del = conf_rawid_get_txn(args->extra->conf, args->extra->txn, C_POLICY,
 						 C_PROPAG_DELAY, args->id, args->id_len);
 	conf_val_t zsk_life = conf_rawid_get_txn(args->extra->conf, args->extra->txn, C_POLICY,
@@ -597,6 +639,12 @@ int check_policy(
 		return KNOT_EINVAL;
 	}
 
+	int64_t jitter_val = conf_int(&jitter);
+	if (lifetime_val - jitter_val <= refresh_val + preref_val) {
+		args->err_str = "RRSIG refresh + pre-refresh + jitter has to be lower than RRSIG lifetime";
+		return KNOT_EINVAL;
+	}
+
 	bool sts_val = conf_bool(&sts);
 	int64_t prop_del_val = conf_int(&prop_del);
 	int64_t zsk_life_val = conf_int(&zsk_life);
@@ -17,10 +17,13 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <arpa/inet.h>
 #include <urcu.h>
 
 #include "knot/common/log.h"
+#include "knot/common/memstat.h"
 #include "knot/common/stats.h"
+#include "knot/common/subscribe.h"
 #include "knot/conf/confio.h"
 #include "knot/ctl/commands.h"
 #include "knot/dnssec/key-events.h"
@@ -32,14 +35,17 @@
 #include "knot/zone/backup.h"
 #include "knot/zone/digest.h"
 #include "knot/zone/timers.h"
+#include "knot/zone/zone-load.h"
 #include "knot/zone/zonedb-load.h"
 #include "knot/zone/zonefile.h"
 #include "libknot/libknot.h"
+#include "libknot/xdp.h"
 #include "libknot/yparser/yptrafo.h"
 #include "contrib/files.h"
 #include "contrib/string.h"
 #include "contrib/strtonum.h"
 #include "contrib/ucw/lists.h"
+#include "contrib/openbsd/strlcpy.h"
 #include "libzscanner/scanner.h"
 
 #define MATCH_OR_FILTER(args, code) ((args)->data[KNOT_CTL_IDX_FILTER] == NULL || \
@@ -58,6 +64,9 @@ typedef struct {
 	char ttl[16];
 	char type[32];
 	char rdata[2 * 65536];
+	bool wire_mode; // Records sent in the wire format.
+	uint16_t wire_len;
+	uint8_t wire[UINT16_MAX];
 } send_ctx_t;
 
 static struct {
@@ -67,7 +76,7 @@ static struct {
 	            sizeof(((send_ctx_t *)0)->ttl) +
 	            sizeof(((send_ctx_t *)0)->type) +
 	            sizeof(((send_ctx_t *)0)->rdata)];
-} ctl_globals;
+} ctl_globals[CTL_MAX_CONCURRENT + 1];
 
 /*!
  * Evaluates a filter pair and checks for conflicting filters.
@@ -187,6 +196,8 @@ static int zones_apply(ctl_args_t *args, int (*fcn)(zone_t *, ctl_args_t *))
 		return KNOT_EOK;
 	}
 
+	knot_dname_txt_storage_t last_zone;
+
 	while (true) {
 		zone_t *zone;
 		ret = get_zone(args, &zone);
@@ -198,18 +209,26 @@ static int zones_apply(ctl_args_t *args, int (*fcn)(zone_t *, ctl_args_t *))
 			                       "control, error (%s)", knot_strerror(ret));
 			send_error(args, knot_strerror(ret));
 		}
+		strlcpy(last_zone, args->data[KNOT_CTL_IDX_ZONE], sizeof(last_zone));
 
 		// Get next zone name.
 		ret = knot_ctl_receive(args->ctl, &args->type, &args->data);
 		if (ret != KNOT_EOK || args->type != KNOT_CTL_TYPE_DATA) {
 			break;
 		}
-		strtolower((char *)args->data[KNOT_CTL_IDX_ZONE]);
+		const char *zone_name = args->data[KNOT_CTL_IDX_ZONE];
+		if (zone_name == NULL) {
+			ret = KNOT_EINVAL;
+			break;
+		}
+		strtolower((char *)zone_name);
 
-		// Log the other zones the same way as the first one from process.c.
-		log_ctl_zone_str_info(args->data[KNOT_CTL_IDX_ZONE],
-		                      "control, received command '%s'",
-		                      args->data[KNOT_CTL_IDX_CMD]);
+		// Log the other zones the same way as the first one from process.c,
+		// a batch of commands for the same zone (e.g. zone-set) just once.
+		if (strcmp(zone_name, last_zone) != 0) {
+			log_ctl_zone_str_info(zone_name, "control, received command '%s'",
+			                      args->data[KNOT_CTL_IDX_CMD]);
+		}
 	}
 
 	return ret;
@@ -342,6 +361,40 @@ static int zone_status(zone_t *zone, ctl_args_t *args)
 		}
 	}
 
+	// Not shown by default as it's rather verbose.
+	if (MATCH_AND_FILTER(args, CTL_FILTER_STATUS_USAGE)) {
+		char name_buff[64];
+		for (zone_event_type_t i = 0; i < ZONE_EVENT_COUNT; i++) {
+			zone_event_usage_t usage;
+			zone_events_get_usage(zone, i, &usage);
+			if (usage.count == 0) {
+				continue;
+			}
+
+			ret = snprintf(name_buff, sizeof(name_buff), "%s usage",
+			               zone_events_get_name(i));
+			if (ret < 0 || ret >= sizeof(name_buff)) {
+				return KNOT_ESPACE;
+			}
+			data[KNOT_CTL_IDX_TYPE] = name_buff;
+
+			ret = snprintf(buff, sizeof(buff), "%"PRIu64"x, wall %.3f s, "
+			               "cpu %.3f s, wait %.3f s, max %.3f s", usage.count,
+			               usage.wall / 1e6, usage.cpu / 1e6, usage.wait / 1e6,
+			               usage.max_wall / 1e6);
+			if (ret < 0 || ret >= sizeof(buff)) {
+				return KNOT_ESPACE;
+			}
+			data[KNOT_CTL_IDX_DATA] = buff;
+
+			ret = knot_ctl_send(args->ctl, type, &data);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			type = KNOT_CTL_TYPE_EXTRA;
+		}
+	}
+
 	return KNOT_EOK;
 }
 
@@ -405,6 +458,22 @@ static int zone_flush(zone_t *zone, ctl_args_t *args)
 	return schedule_trigger(zone, args, ZONE_EVENT_FLUSH, true);
 }
 
+static int zone_snapshot(zone_t *zone, _unused_ ctl_args_t *args)
+{
+	if (zone->cat_members != NULL) {
+		args->suppress = true;
+		return KNOT_ENOTSUP;
+	}
+
+	int ret = zone_load_write_snapshot(conf(), zone->name);
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone->name, "failed to write zone snapshot (%s)",
+		                 knot_strerror(ret));
+	}
+
+	return ret;
+}
+
 static int init_backup(ctl_args_t *args, bool restore_mode)
 {
 	if (!MATCH_AND_FILTER(args, CTL_FILTER_BACKUP_OUTDIR)) {
@@ -454,11 +523,16 @@ static int init_backup(ctl_args_t *args, bool restore_mode)
 	// The present timer db size is not up-to-date, use the maximum one.
 	conf_val_t timer_db_size = conf_db_param(conf(), C_TIMER_DB_MAX_SIZE);
 
+	size_t journal_db_size = 0;
+	for (unsigned i = 0; i < args->server->journaldb_shards; i++) {
+		journal_db_size += knot_lmdb_copy_size(&args->server->journaldb[i]);
+	}
+
 	int ret = zone_backup_init(restore_mode, forced,
 	                           args->data[KNOT_CTL_IDX_DATA],
 	                           knot_lmdb_copy_size(&args->server->kaspdb),
 	                           conf_int(&timer_db_size),
-	                           knot_lmdb_copy_size(&args->server->journaldb),
+	                           journal_db_size,
 	                           knot_lmdb_copy_size(&args->server->catalog.db),
 	                           &ctx);
 	if (ret != KNOT_EOK) {
@@ -681,7 +755,7 @@ static int zone_txn_commit(zone_t *zone, _unused_ ctl_args_t *args)
 		return KNOT_TXN_ENOTEXISTS;
 	}
 
-	int ret = zone_update_semcheck(zone->control_update);
+	int ret = zone_update_semcheck(conf(), zone->control_update);
 	if (ret != KNOT_EOK) {
 		return ret; // Recoverable error.
 	}
@@ -767,6 +841,8 @@ static int init_send_ctx(send_ctx_t *ctx, const knot_dname_t *zone_name,
 	ctx->data[KNOT_CTL_IDX_TYPE]  = ctx->type;
 	ctx->data[KNOT_CTL_IDX_DATA]  = ctx->rdata;
 
+	ctx->wire_mode = ctl_has_flag(args->data[KNOT_CTL_IDX_FLAGS], CTL_FLAG_WIRE);
+
 	// Set the ZONE.
 	if (knot_dname_to_str(ctx->zone, zone_name, sizeof(ctx->zone)) == NULL) {
 		return KNOT_EINVAL;
@@ -786,8 +862,60 @@ static int init_send_ctx(send_ctx_t *ctx, const knot_dname_t *zone_name,
 	return KNOT_EOK;
 }
 
+static int send_wire(send_ctx_t *ctx)
+{
+	if (ctx->wire_len == 0) {
+		return KNOT_EOK;
+	}
+
+	knot_ctl_data_t data = {
+		[KNOT_CTL_IDX_ZONE]  = ctx->zone,
+		[KNOT_CTL_IDX_FLAGS] = ctx->data[KNOT_CTL_IDX_FLAGS],
+	};
+
+	int ret = knot_ctl_send_wire(ctx->args->ctl, KNOT_CTL_TYPE_DATA, &data,
+	                             ctx->wire, ctx->wire_len);
+	ctx->wire_len = 0;
+
+	return ret;
+}
+
+static int send_rrset_wire(knot_rrset_t *rrset, send_ctx_t *ctx)
+{
+	// Records are packed into data units as long as they fit.
+	knot_rdata_t *rr = rrset->rrs.rdata;
+	for (uint16_t i = 0; i < rrset->rrs.count; i++) {
+		knot_rrset_t single = *rrset;
+		single.rrs.count = 1;
+		single.rrs.size = knot_rdata_size(rr->len);
+		single.rrs.rdata = rr;
+
+		int ret = knot_rrset_to_wire(&single, ctx->wire + ctx->wire_len,
+		                             sizeof(ctx->wire) - ctx->wire_len, NULL);
+		if (ret == KNOT_ESPACE && ctx->wire_len > 0) {
+			ret = send_wire(ctx);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			ret = knot_rrset_to_wire(&single, ctx->wire, sizeof(ctx->wire), NULL);
+		}
+		if (ret < 0) {
+			return ret;
+		}
+		ctx->wire_len += ret;
+
+		rr = knot_rdataset_next(rr);
+	}
+
+	return KNOT_EOK;
+}
+
 static int send_rrset(knot_rrset_t *rrset, send_ctx_t *ctx)
 {
+	if (ctx->wire_mode) {
+		return send_rrset_wire(rrset, ctx);
+	}
+
 	if (rrset->type != KNOT_RRTYPE_RRSIG) {
 		int ret = snprintf(ctx->ttl, sizeof(ctx->ttl), "%u", rrset->ttl);
 		if (ret <= 0 || ret >= sizeof(ctx->ttl)) {
@@ -891,7 +1019,7 @@ static int get_owner(uint8_t *out, size_t out_len, knot_dname_t *origin,
 
 static int zone_read(zone_t *zone, ctl_args_t *args)
 {
-	send_ctx_t *ctx = &ctl_globals.send_ctx;
+	send_ctx_t *ctx = &ctl_globals[args->thread_idx].send_ctx;
 	int ret = init_send_ctx(ctx, zone->name, args);
 	if (ret != KNOT_EOK) {
 		return ret;
@@ -918,6 +1046,10 @@ static int zone_read(zone_t *zone, ctl_args_t *args)
 		}
 	}
 
+	if (ret == KNOT_EOK) {
+		ret = send_wire(ctx);
+	}
+
 	return ret;
 }
 
@@ -928,7 +1060,7 @@ static int zone_flag_txn_get(zone_t *zone, ctl_args_t *args, const char *flag)
 		return KNOT_TXN_ENOTEXISTS;
 	}
 
-	send_ctx_t *ctx = &ctl_globals.send_ctx;
+	send_ctx_t *ctx = &ctl_globals[args->thread_idx].send_ctx;
 	int ret = init_send_ctx(ctx, zone->name, args);
 	if (ret != KNOT_EOK) {
 		return ret;
@@ -962,6 +1094,10 @@ static int zone_flag_txn_get(zone_t *zone, ctl_args_t *args, const char *flag)
 		zone_tree_it_free(&it);
 	}
 
+	if (ret == KNOT_EOK) {
+		ret = send_wire(ctx);
+	}
+
 	return ret;
 }
 
@@ -1015,7 +1151,8 @@ static int send_changeset_part(changeset_t *ch, send_ctx_t *ctx, bool from)
 	}
 	changeset_iter_clear(&it);
 
-	return KNOT_EOK;
+	// The flag changes with the next part.
+	return send_wire(ctx);
 }
 
 static int send_changeset(changeset_t *ch, send_ctx_t *ctx)
@@ -1042,7 +1179,7 @@ static int zone_txn_diff(zone_t *zone, ctl_args_t *args)
 		return zone_flag_txn_get(zone, args, CTL_FLAG_ADD);
 	}
 
-	send_ctx_t *ctx = &ctl_globals.send_ctx;
+	send_ctx_t *ctx = &ctl_globals[args->thread_idx].send_ctx;
 	int ret = init_send_ctx(ctx, zone->name, args);
 	if (ret != KNOT_EOK) {
 		return ret;
@@ -1090,8 +1227,8 @@ static int create_rrset(knot_rrset_t **rrset, zone_t *zone, ctl_args_t *args,
 	const char *ttl   = need_ttl ? args->data[KNOT_CTL_IDX_TTL] : NULL;
 
 	// Prepare a buffer for a reconstructed record.
-	const size_t buff_len = sizeof(ctl_globals.txt_rr);
-	char *buff = ctl_globals.txt_rr;
+	const size_t buff_len = sizeof(ctl_globals[args->thread_idx].txt_rr);
+	char *buff = ctl_globals[args->thread_idx].txt_rr;
 
 	uint32_t default_ttl = 0;
 	if (ttl == NULL) {
@@ -1113,7 +1250,7 @@ static int create_rrset(knot_rrset_t **rrset, zone_t *zone, ctl_args_t *args,
 	size_t rdata_len = ret;
 
 	// Parse the record.
-	zs_scanner_t *scanner = &ctl_globals.scanner;
+	zs_scanner_t *scanner = &ctl_globals[args->thread_idx].scanner;
 	if (zs_init(scanner, origin, KNOT_CLASS_IN, default_ttl) != 0 ||
 	    zs_set_input_string(scanner, buff, rdata_len) != 0 ||
 	    zs_parse_record(scanner) != 0 ||
@@ -1139,6 +1276,39 @@ parser_failed:
 	return ret;
 }
 
+static int update_wire(zone_t *zone, ctl_args_t *args, bool add)
+{
+	uint16_t wire_len = 0;
+	const uint8_t *wire = knot_ctl_wire(args->ctl, &wire_len);
+	assert(wire != NULL);
+
+	size_t pos = 0;
+	while (pos < wire_len) {
+		knot_rrset_t rrset;
+		int ret = knot_rrset_rr_from_wire(wire, &pos, wire_len, &rrset, NULL, false);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		knot_dname_to_lower(rrset.owner);
+
+		if (rrset.rclass != KNOT_CLASS_IN) {
+			ret = KNOT_EINVAL;
+		} else if (knot_dname_in_bailiwick(rrset.owner, zone->name) < 0) {
+			ret = KNOT_EOUTOFZONE;
+		} else if (add) {
+			ret = zone_update_add(zone->control_update, &rrset);
+		} else {
+			ret = zone_update_remove(zone->control_update, &rrset);
+		}
+		knot_rrset_clear(&rrset, NULL);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 static int zone_txn_set(zone_t *zone, ctl_args_t *args)
 {
 	if (zone->control_update == NULL) {
@@ -1146,6 +1316,11 @@ static int zone_txn_set(zone_t *zone, ctl_args_t *args)
 		return KNOT_TXN_ENOTEXISTS;
 	}
 
+	// Records in the wire format.
+	if (knot_ctl_wire(args->ctl, NULL) != NULL) {
+		return update_wire(zone, args, true);
+	}
+
 	if (args->data[KNOT_CTL_IDX_OWNER] == NULL ||
 	    args->data[KNOT_CTL_IDX_TYPE]  == NULL) {
 		return KNOT_EINVAL;
@@ -1170,6 +1345,11 @@ static int zone_txn_unset(zone_t *zone, ctl_args_t *args)
 		return KNOT_TXN_ENOTEXISTS;
 	}
 
+	// Records in the wire format.
+	if (knot_ctl_wire(args->ctl, NULL) != NULL) {
+		return update_wire(zone, args, false);
+	}
+
 	if (args->data[KNOT_CTL_IDX_OWNER] == NULL) {
 		return KNOT_EINVAL;
 	}
@@ -1236,7 +1416,7 @@ static bool zone_names_distinct(const knot_dname_t *zone, void *data)
 static int drop_journal_if_orphan(const knot_dname_t *for_zone, void *ctx)
 {
 	server_t *server = ctx;
-	zone_journal_t j = { &server->journaldb, for_zone };
+	zone_journal_t j = { server_journaldb(server, for_zone), for_zone };
 	if (!zone_exists(for_zone, server->zone_db)) {
 		return journal_scrape_with_md(j, false);
 	}
@@ -1279,9 +1459,11 @@ static int orphans_purge(ctl_args_t *args)
 
 		// Purge zone journals of unconfigured zones.
 		if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_JOURNAL)) {
-			ret = journals_walk(&args->server->journaldb,
-			                    drop_journal_if_orphan, args->server);
-			log_if_orphans_error(NULL, ret, "journal");
+			for (unsigned i = 0; i < args->server->journaldb_shards; i++) {
+				ret = journals_walk(&args->server->journaldb[i],
+				                    drop_journal_if_orphan, args->server);
+				log_if_orphans_error(NULL, ret, "journal");
+			}
 		}
 
 		// Purge timers of unconfigured zones.
@@ -1316,7 +1498,7 @@ static int orphans_purge(ctl_args_t *args)
 
 				// Purge zone journal.
 				if (only_orphan || MATCH_AND_FILTER(args, CTL_FILTER_PURGE_JOURNAL)) {
-					zone_journal_t j = { &args->server->journaldb, zone_name };
+					zone_journal_t j = { server_journaldb(args->server, zone_name), zone_name };
 					ret = journal_scrape_with_md(j, true);
 					log_if_orphans_error(zone_name, ret, "journal");
 				}
@@ -1405,14 +1587,55 @@ static int zone_purge(zone_t *zone, ctl_args_t *args)
 	return KNOT_EOK;
 }
 
-static int send_stats_ctr(mod_ctr_t *ctr, uint64_t **stats_vals, unsigned threads,
+static int send_stats_read(knotd_mod_t *mod, uint32_t ctr_id,
+                           ctl_args_t *args, knot_ctl_data_t *data)
+{
+	char value[32];
+
+	char **names;
+	uint64_t *vals = stats_get_read(mod, ctr_id, &names);
+	if (vals == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	bool first = true;
+	for (uint32_t i = 0; i < mod->stats_info[ctr_id].count; i++) {
+		// Skip unused counters.
+		if (vals[i] == 0 || names[i] == NULL) {
+			continue;
+		}
+
+		ret = snprintf(value, sizeof(value), "%"PRIu64, vals[i]);
+		if (ret <= 0 || ret >= sizeof(value)) {
+			ret = KNOT_ESPACE;
+			break;
+		}
+
+		(*data)[KNOT_CTL_IDX_ID] = names[i];
+		(*data)[KNOT_CTL_IDX_DATA] = value;
+
+		knot_ctl_type_t type = first ? KNOT_CTL_TYPE_DATA : KNOT_CTL_TYPE_EXTRA;
+		ret = knot_ctl_send(args->ctl, type, data);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		first = false;
+	}
+
+	stats_free_read(mod, ctr_id, vals, names);
+
+	return ret;
+}
+
+static int send_stats_ctr(mod_ctr_t *ctr, const uint64_t *snapshot,
                           ctl_args_t *args, knot_ctl_data_t *data)
 {
 	char index[128];
 	char value[32];
 
 	if (ctr->count == 1) {
-		uint64_t counter = stats_get_counter(stats_vals, ctr->offset, threads);
+		uint64_t counter = snapshot[ctr->offset];
 		int ret = snprintf(value, sizeof(value), "%"PRIu64, counter);
 		if (ret <= 0 || ret >= sizeof(value)) {
 			return KNOT_ESPACE;
@@ -1430,7 +1653,7 @@ static int send_stats_ctr(mod_ctr_t *ctr, uint64_t **stats_vals, unsigned thread
 		                          CTL_FLAG_FORCE);
 
 		for (uint32_t i = 0; i < ctr->count; i++) {
-			uint64_t counter = stats_get_counter(stats_vals, ctr->offset + i, threads);
+			uint64_t counter = snapshot[ctr->offset + i];
 
 			// Skip empty counters.
 			if (counter == 0 && !force) {
@@ -1507,7 +1730,11 @@ static int modules_stats(list_t *query_modules, ctl_args_t *args, knot_dname_t *
 
 		data[KNOT_CTL_IDX_SECTION] = mod->id->name + 1;
 
-		unsigned threads = knotd_mod_threads(mod);
+		// All counters of the module are read at once.
+		uint64_t *snapshot = stats_get_snapshot(mod, knotd_mod_threads(mod));
+		if (snapshot == NULL) {
+			return KNOT_ENOMEM;
+		}
 
 		for (int i = 0; i < mod->stats_count; i++) {
 			mod_ctr_t *ctr = mod->stats_info + i;
@@ -1531,6 +1758,7 @@ static int modules_stats(list_t *query_modules, ctl_args_t *args, knot_dname_t *
 			// Prepare zone name if not already prepared.
 			if (zone != NULL && name[0] == '\0') {
 				if (knot_dname_to_str(name, zone, sizeof(name)) == NULL) {
+					free(snapshot);
 					return KNOT_EINVAL;
 				}
 				data[KNOT_CTL_IDX_ZONE] = name;
@@ -1539,19 +1767,93 @@ static int modules_stats(list_t *query_modules, ctl_args_t *args, knot_dname_t *
 			data[KNOT_CTL_IDX_ITEM] = ctr->name;
 
 			// Send the counters.
-			int ret = send_stats_ctr(ctr, mod->stats_vals, threads, args, &data);
+			int ret = (ctr->read != NULL) ?
+			          send_stats_read(mod, i, args, &data) :
+			          send_stats_ctr(ctr, snapshot, args, &data);
 			if (ret != KNOT_EOK) {
+				free(snapshot);
 				return ret;
 			}
 		}
+
+		free(snapshot);
 	}
 
 	return (section_found && item_found) ? KNOT_EOK : KNOT_ENOENT;
 }
 
+#define MEMORY_SECTION	"memory"
+
+static int zone_memory_stats(zone_t *zone, ctl_args_t *args)
+{
+	const char *item = args->data[KNOT_CTL_IDX_ITEM];
+
+	zone_memory_t mem;
+	memstat_zone(zone, &mem);
+
+	const struct {
+		const char *name;
+		size_t value;
+	} items[] = {
+		{ "trees",       mem.trees },
+		{ "nodes",       mem.nodes },
+		{ "rdata",       mem.rdata },
+		{ "additionals", mem.additionals },
+	};
+
+	knot_dname_txt_storage_t name;
+	if (knot_dname_to_str(name, zone->name, sizeof(name)) == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_ctl_data_t data = {
+		[KNOT_CTL_IDX_ZONE] = name,
+		[KNOT_CTL_IDX_SECTION] = MEMORY_SECTION,
+	};
+
+	bool item_found = false;
+	for (int i = 0; i < sizeof(items) / sizeof(items[0]); i++) {
+		if (item != NULL && strcasecmp(items[i].name, item) != 0) {
+			continue;
+		}
+		item_found = true;
+
+		char value[32];
+		int ret = snprintf(value, sizeof(value), "%zu", items[i].value);
+		if (ret <= 0 || ret >= sizeof(value)) {
+			return KNOT_ESPACE;
+		}
+
+		data[KNOT_CTL_IDX_ITEM] = items[i].name;
+		data[KNOT_CTL_IDX_DATA] = value;
+
+		ret = knot_ctl_send(args->ctl, KNOT_CTL_TYPE_DATA, &data);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return item_found ? KNOT_EOK : KNOT_ENOENT;
+}
+
 static int zone_stats(zone_t *zone, ctl_args_t *args)
 {
-	return modules_stats(&zone->query_modules, args, zone->name);
+	const char *section = args->data[KNOT_CTL_IDX_SECTION];
+	if (section != NULL && strcasecmp(section, MEMORY_SECTION) == 0) {
+		return zone_memory_stats(zone, args);
+	}
+
+	int ret = modules_stats(&zone->query_modules, args, zone->name);
+	if (section != NULL || (ret != KNOT_EOK && ret != KNOT_ENOENT)) {
+		return ret;
+	}
+
+	// The memory usage follows the module counters.
+	int mem_ret = zone_memory_stats(zone, args);
+	if (mem_ret == KNOT_ENOENT && ret == KNOT_EOK) {
+		return KNOT_EOK;
+	}
+	return mem_ret;
 }
 
 static int ctl_zone(ctl_args_t *args, ctl_cmd_t cmd)
@@ -1569,6 +1871,8 @@ static int ctl_zone(ctl_args_t *args, ctl_cmd_t cmd)
 		return zones_apply(args, zone_notify);
 	case CTL_ZONE_FLUSH:
 		return zones_apply(args, zone_flush);
+	case CTL_ZONE_SNAPSHOT:
+		return zones_apply(args, zone_snapshot);
 	case CTL_ZONE_BACKUP:
 		return zones_apply_backup(args, false);
 	case CTL_ZONE_RESTORE:
@@ -1619,6 +1923,15 @@ static int ctl_zone(ctl_args_t *args, ctl_cmd_t cmd)
 	}
 }
 
+static uint64_t avg_wait_ms(const worker_pool_stats_t *stats, worker_prio_t prio)
+{
+	if (stats->executed[prio] == 0) {
+		return 0;
+	}
+
+	return stats->wait_total[prio] / stats->executed[prio] / 1000;
+}
+
 static int server_status(ctl_args_t *args)
 {
 	const char *type = args->data[KNOT_CTL_IDX_TYPE];
@@ -1635,11 +1948,22 @@ static int server_status(ctl_args_t *args)
 	} else if (strcasecmp(type, "workers") == 0) {
 		int running_bkg_wrk, wrk_queue;
 		worker_pool_status(args->server->workers, false, &running_bkg_wrk, &wrk_queue);
+		worker_pool_stats_t st;
+		worker_pool_stats(args->server->workers, &st);
 		ret = snprintf(buff, sizeof(buff), "UDP workers: %zu, TCP workers: %zu, "
-		               "XDP workers: %zu, background workers: %zu (running: %d, pending: %d)",
+		               "XDP workers: %zu, background workers: %zu (running: %d, pending: %d, "
+		               "pending high/normal/low: %zu/%zu/%zu, "
+		               "average wait high/normal/low: %"PRIu64"/%"PRIu64"/%"PRIu64" ms, "
+		               "maximal wait high/normal/low: %"PRIu64"/%"PRIu64"/%"PRIu64" ms)",
 		               conf()->cache.srv_udp_threads, conf()->cache.srv_tcp_threads,
 		               conf()->cache.srv_xdp_threads, conf()->cache.srv_bg_threads,
-		               running_bkg_wrk, wrk_queue);
+		               running_bkg_wrk, wrk_queue,
+		               st.queued[WORKER_PRIO_HIGH], st.queued[WORKER_PRIO_NORMAL],
+		               st.queued[WORKER_PRIO_LOW],
+		               avg_wait_ms(&st, WORKER_PRIO_HIGH), avg_wait_ms(&st, WORKER_PRIO_NORMAL),
+		               avg_wait_ms(&st, WORKER_PRIO_LOW),
+		               st.wait_max[WORKER_PRIO_HIGH] / 1000, st.wait_max[WORKER_PRIO_NORMAL] / 1000,
+		               st.wait_max[WORKER_PRIO_LOW] / 1000);
 	} else if (strcasecmp(type, "configure") == 0) {
 		ret = snprintf(buff, sizeof(buff), "%s", CONFIGURE_SUMMARY);
 	} else {
@@ -1682,6 +2006,131 @@ static int ctl_server(ctl_args_t *args, ctl_cmd_t cmd)
 	return ret;
 }
 
+static int send_events_stats(ctl_args_t *args, const char *item)
+{
+	bool force = ctl_has_flag(args->data[KNOT_CTL_IDX_FLAGS], CTL_FLAG_FORCE);
+	bool found = false;
+
+	char value[32];
+	knot_ctl_data_t data = {
+		[KNOT_CTL_IDX_SECTION] = "events",
+		[KNOT_CTL_IDX_DATA] = value
+	};
+
+	for (const stats_event_item_t *i = event_stats; i->name != NULL; i++) {
+		if (item != NULL && strcmp(i->name, item) != 0) {
+			continue;
+		}
+		found = true;
+
+		data[KNOT_CTL_IDX_ITEM] = i->name;
+		for (zone_event_type_t type = 0; type < ZONE_EVENT_COUNT; type++) {
+			zone_event_usage_t usage;
+			zone_events_total_usage(type, &usage);
+			if (usage.count == 0 && !force) {
+				continue;
+			}
+
+			int ret = snprintf(value, sizeof(value), "%"PRIu64, i->val(&usage));
+			if (ret <= 0 || ret >= sizeof(value)) {
+				return KNOT_ESPACE;
+			}
+			data[KNOT_CTL_IDX_ID] = zone_events_get_name(type);
+
+			ret = knot_ctl_send(args->ctl, KNOT_CTL_TYPE_DATA, &data);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	// The slowest recent events, identified by the zone and the event type.
+	const char *slowest_item = "slowest-wall-usec";
+	if (item == NULL || strcmp(item, slowest_item) == 0) {
+		found = true;
+
+		zone_event_slow_t slowest[ZONE_EVENT_SLOWEST];
+		size_t count = zone_events_slowest(slowest, ZONE_EVENT_SLOWEST);
+
+		data[KNOT_CTL_IDX_ITEM] = slowest_item;
+		for (size_t i = 0; i < count; i++) {
+			char id[KNOT_DNAME_TXT_MAXLEN + 32];
+			knot_dname_txt_storage_t name;
+			if (knot_dname_to_str(name, slowest[i].zone, sizeof(name)) == NULL) {
+				return KNOT_EINVAL;
+			}
+			int ret = snprintf(id, sizeof(id), "%s %s", name,
+			                   zone_events_get_name(slowest[i].type));
+			if (ret <= 0 || ret >= sizeof(id)) {
+				return KNOT_ESPACE;
+			}
+			ret = snprintf(value, sizeof(value), "%"PRIu64, slowest[i].wall);
+			if (ret <= 0 || ret >= sizeof(value)) {
+				return KNOT_ESPACE;
+			}
+			data[KNOT_CTL_IDX_ID] = id;
+
+			ret = knot_ctl_send(args->ctl, KNOT_CTL_TYPE_DATA, &data);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	return found ? KNOT_EOK : KNOT_ENOENT;
+}
+
+static int send_xdp_acl_stats(ctl_args_t *args, const char *item)
+{
+	const char *dropped_item = "dropped";
+	if (item != NULL && strcmp(item, dropped_item) != 0) {
+		return KNOT_ENOENT;
+	}
+
+	bool force = ctl_has_flag(args->data[KNOT_CTL_IDX_FLAGS], CTL_FLAG_FORCE);
+
+	char value[32];
+	knot_ctl_data_t data = {
+		[KNOT_CTL_IDX_SECTION] = "xdp-acl",
+		[KNOT_CTL_IDX_ITEM] = dropped_item,
+		[KNOT_CTL_IDX_DATA] = value
+	};
+
+	// The configured prefixes followed by the sources not matching any.
+	for (size_t i = 0; i <= args->server->xdp_acl_count; i++) {
+		char id[INET6_ADDRSTRLEN + 8] = "default";
+		const struct knot_xdp_acl_key *key = NULL;
+#ifdef ENABLE_XDP
+		if (i < args->server->xdp_acl_count) {
+			key = &args->server->xdp_acl[i].key;
+			char addr[INET6_ADDRSTRLEN];
+			if (inet_ntop((key->family == 4) ? AF_INET : AF_INET6, key->addr,
+			              addr, sizeof(addr)) == NULL) {
+				return KNOT_EINVAL;
+			}
+			(void)snprintf(id, sizeof(id), "%s/%u", addr, key->prefixlen - 8);
+		}
+#endif
+		uint64_t dropped = stats_xdp_acl_dropped(args->server, key);
+		if (dropped == 0 && !force) {
+			continue;
+		}
+
+		int ret = snprintf(value, sizeof(value), "%"PRIu64, dropped);
+		if (ret <= 0 || ret >= sizeof(value)) {
+			return KNOT_ESPACE;
+		}
+		data[KNOT_CTL_IDX_ID] = id;
+
+		ret = knot_ctl_send(args->ctl, KNOT_CTL_TYPE_DATA, &data);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 static int ctl_stats(ctl_args_t *args, ctl_cmd_t cmd)
 {
 	const char *section = args->data[KNOT_CTL_IDX_SECTION];
@@ -1727,6 +2176,28 @@ static int ctl_stats(ctl_args_t *args, ctl_cmd_t cmd)
 		}
 	}
 
+	// Process zone events metrics.
+	if (section == NULL || strcasecmp(section, "events") == 0) {
+		int ret = send_events_stats(args, (section != NULL) ? item : NULL);
+		if (ret != KNOT_EOK) {
+			send_error(args, knot_strerror(ret));
+			return ret;
+		}
+
+		found = true;
+	}
+
+	// Process XDP access control metrics.
+	if (section == NULL || strcasecmp(section, "xdp-acl") == 0) {
+		int ret = send_xdp_acl_stats(args, (section != NULL) ? item : NULL);
+		if (ret != KNOT_EOK) {
+			send_error(args, knot_strerror(ret));
+			return ret;
+		}
+
+		found = true;
+	}
+
 	// Process modules metrics.
 	if (section == NULL || strncasecmp(section, "mod-", strlen("mod-")) == 0) {
 		int ret = modules_stats(conf()->query_modules, args, NULL);
@@ -2061,25 +2532,168 @@ static int ctl_conf_modify(ctl_args_t *args, ctl_cmd_t cmd)
 	return ret;
 }
 
+/*! Interval of checking the subscriber connection if no notification. */
+#define SUBSCRIBE_POLL_MS	1000
+
+static const char *subscribe_kind_str(subscribe_kind_t kind)
+{
+	switch (kind) {
+	case SUBSCRIBE_SERIAL:  return "serial";
+	case SUBSCRIBE_EVENT:   return "event";
+	case SUBSCRIBE_REFRESH: return "refresh";
+	default:                return "";
+	}
+}
+
+static int send_notification(ctl_args_t *args, const subscribe_msg_t *msg)
+{
+	int ret;
+
+	if (msg->lost > 0) {
+		char lost[32];
+		(void)snprintf(lost, sizeof(lost), "%"PRIu64, msg->lost);
+		knot_ctl_data_t data = {
+			[KNOT_CTL_IDX_SECTION] = "lost",
+			[KNOT_CTL_IDX_DATA] = lost,
+		};
+		ret = knot_ctl_send(args->ctl, KNOT_CTL_TYPE_DATA, &data);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	knot_dname_txt_storage_t zone;
+	if (knot_dname_to_str(zone, msg->zone, sizeof(zone)) == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_ctl_data_t data = {
+		[KNOT_CTL_IDX_ZONE] = zone,
+		[KNOT_CTL_IDX_SECTION] = subscribe_kind_str(msg->kind),
+		[KNOT_CTL_IDX_TYPE] = msg->type,
+		[KNOT_CTL_IDX_DATA] = msg->value,
+	};
+	ret = knot_ctl_send(args->ctl, KNOT_CTL_TYPE_DATA, &data);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return knot_ctl_flush(args->ctl);
+}
+
+static int ctl_zone_subscribe(ctl_args_t *args, ctl_cmd_t cmd)
+{
+	// Don't block the control socket accepting in the main thread.
+	if (args->thread_idx == 0) {
+		send_error(args, knot_strerror(KNOT_EBUSY));
+		return KNOT_EBUSY;
+	}
+
+	unsigned kinds = 0;
+	if (MATCH_AND_FILTER(args, CTL_FILTER_SUBSCRIBE_SERIAL)) {
+		kinds |= SUBSCRIBE_SERIAL;
+	}
+	if (MATCH_AND_FILTER(args, CTL_FILTER_SUBSCRIBE_EVENTS)) {
+		kinds |= SUBSCRIBE_EVENT;
+	}
+	if (MATCH_AND_FILTER(args, CTL_FILTER_SUBSCRIBE_REFRESH)) {
+		kinds |= SUBSCRIBE_REFRESH;
+	}
+	if (kinds == 0) {
+		kinds = SUBSCRIBE_ALL;
+	}
+
+	// Collect the zones, all zones if none is specified.
+	knot_dname_t **zones = NULL;
+	size_t zone_count = 0, zone_max = 0;
+	int ret = KNOT_EOK;
+	while (args->data[KNOT_CTL_IDX_ZONE] != NULL) {
+		if (zone_count == zone_max) {
+			zone_max = (zone_max == 0) ? 16 : 2 * zone_max;
+			knot_dname_t **tmp = realloc(zones, zone_max * sizeof(*zones));
+			if (tmp == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			zones = tmp;
+		}
+		zones[zone_count] = knot_dname_from_str_alloc(args->data[KNOT_CTL_IDX_ZONE]);
+		if (zones[zone_count] == NULL) {
+			ret = KNOT_EINVAL;
+			break;
+		}
+		knot_dname_to_lower(zones[zone_count++]);
+
+		// Get next zone name.
+		ret = knot_ctl_receive(args->ctl, &args->type, &args->data);
+		if (ret != KNOT_EOK || args->type != KNOT_CTL_TYPE_DATA) {
+			break;
+		}
+	}
+
+	subscriber_t *sub = NULL;
+	if (ret == KNOT_EOK) {
+		ret = subscribe_new(kinds, zones, zone_count, &sub);
+	} else {
+		for (size_t i = 0; i < zone_count; i++) {
+			knot_dname_free(zones[i], NULL);
+		}
+		free(zones);
+	}
+	if (ret != KNOT_EOK) {
+		send_error(args, knot_strerror(ret));
+		return ret;
+	}
+
+	while (true) {
+		subscribe_msg_t msg;
+		ret = subscribe_wait(sub, SUBSCRIBE_POLL_MS, &msg);
+		if (ret == KNOT_ETIMEOUT) {
+			// Finish if the client disconnected or sent anything.
+			if (knot_ctl_poll(args->ctl, 0) != KNOT_ETIMEOUT) {
+				ret = KNOT_EOK;
+				break;
+			}
+			continue;
+		} else if (ret != KNOT_EOK) {
+			// Server shutdown.
+			ret = KNOT_EOK;
+			break;
+		}
+
+		ret = send_notification(args, &msg);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	subscribe_free(sub);
+
+	return ret;
+}
+
 typedef struct {
 	const char *name;
 	int (*fcn)(ctl_args_t *, ctl_cmd_t);
+	bool concurrent;
+	bool lockless;
 } desc_t;
 
 static const desc_t cmd_table[] = {
 	[CTL_NONE]            = { "" },
 
-	[CTL_STATUS]          = { "status",          ctl_server },
+	[CTL_STATUS]          = { "status",          ctl_server, true },
 	[CTL_STOP]            = { "stop",            ctl_server },
 	[CTL_RELOAD]          = { "reload",          ctl_server },
-	[CTL_STATS]           = { "stats",           ctl_stats },
+	[CTL_STATS]           = { "stats",           ctl_stats, true },
 
-	[CTL_ZONE_STATUS]     = { "zone-status",        ctl_zone },
+	[CTL_ZONE_STATUS]     = { "zone-status",        ctl_zone, true },
 	[CTL_ZONE_RELOAD]     = { "zone-reload",        ctl_zone },
 	[CTL_ZONE_REFRESH]    = { "zone-refresh",       ctl_zone },
 	[CTL_ZONE_RETRANSFER] = { "zone-retransfer",    ctl_zone },
 	[CTL_ZONE_NOTIFY]     = { "zone-notify",        ctl_zone },
 	[CTL_ZONE_FLUSH]      = { "zone-flush",         ctl_zone },
+	[CTL_ZONE_SNAPSHOT]   = { "zone-snapshot",      ctl_zone },
 	[CTL_ZONE_BACKUP]     = { "zone-backup",        ctl_zone },
 	[CTL_ZONE_RESTORE]    = { "zone-restore",       ctl_zone },
 	[CTL_ZONE_SIGN]       = { "zone-sign",          ctl_zone },
@@ -2091,7 +2705,7 @@ static const desc_t cmd_table[] = {
 	[CTL_ZONE_XFR_FREEZE] = { "zone-xfr-freeze",    ctl_zone },
 	[CTL_ZONE_XFR_THAW]   = { "zone-xfr-thaw",      ctl_zone },
 
-	[CTL_ZONE_READ]       = { "zone-read",       ctl_zone },
+	[CTL_ZONE_READ]       = { "zone-read",       ctl_zone, true },
 	[CTL_ZONE_BEGIN]      = { "zone-begin",      ctl_zone },
 	[CTL_ZONE_COMMIT]     = { "zone-commit",     ctl_zone },
 	[CTL_ZONE_ABORT]      = { "zone-abort",      ctl_zone },
@@ -2100,10 +2714,11 @@ static const desc_t cmd_table[] = {
 	[CTL_ZONE_SET]        = { "zone-set",        ctl_zone },
 	[CTL_ZONE_UNSET]      = { "zone-unset",      ctl_zone },
 	[CTL_ZONE_PURGE]      = { "zone-purge",      ctl_zone },
-	[CTL_ZONE_STATS]      = { "zone-stats",	     ctl_zone },
+	[CTL_ZONE_STATS]      = { "zone-stats",	     ctl_zone, true },
+	[CTL_ZONE_SUBSCRIBE]  = { "zone-subscribe",  ctl_zone_subscribe, true, true },
 
-	[CTL_CONF_LIST]       = { "conf-list",       ctl_conf_list },
-	[CTL_CONF_READ]       = { "conf-read",       ctl_conf_read },
+	[CTL_CONF_LIST]       = { "conf-list",       ctl_conf_list, true },
+	[CTL_CONF_READ]       = { "conf-read",       ctl_conf_read, true },
 	[CTL_CONF_BEGIN]      = { "conf-begin",      ctl_conf_txn },
 	[CTL_CONF_COMMIT]     = { "conf-commit",     ctl_conf_txn },
 	[CTL_CONF_ABORT]      = { "conf-abort",      ctl_conf_txn },
@@ -2148,6 +2763,24 @@ int ctl_exec(ctl_cmd_t cmd, ctl_args_t *args)
 	return cmd_table[cmd].fcn(args, cmd);
 }
 
+bool ctl_is_concurrent(ctl_cmd_t cmd)
+{
+	if (cmd <= CTL_NONE || cmd > MAX_CTL_CODE) {
+		return false;
+	}
+
+	return cmd_table[cmd].concurrent;
+}
+
+bool ctl_is_lockless(ctl_cmd_t cmd)
+{
+	if (cmd <= CTL_NONE || cmd > MAX_CTL_CODE) {
+		return false;
+	}
+
+	return cmd_table[cmd].lockless;
+}
+
 bool ctl_has_flag(const char *flags, const char *flag)
 {
 	if (flags == NULL || flag == NULL) {
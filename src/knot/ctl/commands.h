@@ -19,10 +19,14 @@
 #include "libknot/libknot.h"
 #include "knot/server/server.h"
 
+/*! Maximum number of control connections processed concurrently. */
+#define CTL_MAX_CONCURRENT	4
+
 #define CTL_FLAG_FORCE		"F"
 #define CTL_FLAG_BLOCKING	"B"
 #define CTL_FLAG_ADD		"+"
 #define CTL_FLAG_REM		"-"
+#define CTL_FLAG_WIRE		"W"
 
 #define CTL_FLAG_LIST_SCHEMA	"s"
 #define CTL_FLAG_LIST_TXN	"t"
@@ -35,6 +39,7 @@
 #define CTL_FILTER_STATUS_TRANSACTION	't'
 #define CTL_FILTER_STATUS_FREEZE	'f'
 #define CTL_FILTER_STATUS_EVENTS	'e'
+#define CTL_FILTER_STATUS_USAGE		'u'
 
 #define CTL_FILTER_PURGE_EXPIRE		'e'
 #define CTL_FILTER_PURGE_ZONEFILE	'f'
@@ -55,6 +60,10 @@
 #define CTL_FILTER_BACKUP_CATALOG	'c'
 #define CTL_FILTER_BACKUP_NOCATALOG	'C'
 
+#define CTL_FILTER_SUBSCRIBE_SERIAL	's'
+#define CTL_FILTER_SUBSCRIBE_EVENTS	'e'
+#define CTL_FILTER_SUBSCRIBE_REFRESH	'r'
+
 /*! Control commands. */
 typedef enum {
 	CTL_NONE,
@@ -70,6 +79,7 @@ typedef enum {
 	CTL_ZONE_RETRANSFER,
 	CTL_ZONE_NOTIFY,
 	CTL_ZONE_FLUSH,
+	CTL_ZONE_SNAPSHOT,
 	CTL_ZONE_BACKUP,
 	CTL_ZONE_RESTORE,
 	CTL_ZONE_SIGN,
@@ -91,6 +101,7 @@ typedef enum {
 	CTL_ZONE_UNSET,
 	CTL_ZONE_PURGE,
 	CTL_ZONE_STATS,
+	CTL_ZONE_SUBSCRIBE,
 
 	CTL_CONF_LIST,
 	CTL_CONF_READ,
@@ -109,6 +120,7 @@ typedef struct {
 	knot_ctl_type_t type;
 	knot_ctl_data_t data;
 	server_t *server;
+	int thread_idx;	// Processing thread index, 0 for the main thread.
 	bool suppress;	// Suppress error reporting in the "all zones" ctl commands.
 } ctl_args_t;
 
@@ -140,6 +152,26 @@ ctl_cmd_t ctl_str_to_cmd(const char *cmd_str);
  */
 int ctl_exec(ctl_cmd_t cmd, ctl_args_t *args);
 
+/*!
+ * Checks if the command only reads the server state and thus can be executed
+ * concurrently with other such commands.
+ *
+ * \param[in] cmd  Control command.
+ *
+ * \return True if concurrent execution is allowed.
+ */
+bool ctl_is_concurrent(ctl_cmd_t cmd);
+
+/*!
+ * Checks if the command is executed without the execution lock. Such a command
+ * doesn't access the server state and may run for a long time.
+ *
+ * \param[in] cmd  Control command.
+ *
+ * \return True if no locking is needed.
+ */
+bool ctl_is_lockless(ctl_cmd_t cmd);
+
 /*!
  * Checks flag presence in flags.
  *
@@ -14,22 +14,84 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
+#include <pthread.h>
+
 #include "knot/common/log.h"
 #include "knot/ctl/commands.h"
 #include "knot/ctl/process.h"
 #include "libknot/error.h"
 #include "contrib/string.h"
 
-int ctl_process(knot_ctl_t *ctl, server_t *server)
+/*!
+ * Lock of the command execution. Concurrent commands share the lock, other
+ * commands and server reloads hold it exclusively. Waiting exclusive holders
+ * have preference so they aren't starved by frequent concurrent commands.
+ */
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned shared;
+	unsigned waiting;
+	bool exclusive;
+} exec_lock = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER
+};
+
+static void exec_lock_shared(void)
+{
+	pthread_mutex_lock(&exec_lock.mutex);
+	while (exec_lock.exclusive || exec_lock.waiting > 0) {
+		pthread_cond_wait(&exec_lock.cond, &exec_lock.mutex);
+	}
+	exec_lock.shared++;
+	pthread_mutex_unlock(&exec_lock.mutex);
+}
+
+static void exec_unlock_shared(void)
 {
-	if (ctl == NULL || server == NULL) {
+	pthread_mutex_lock(&exec_lock.mutex);
+	assert(exec_lock.shared > 0);
+	if (--exec_lock.shared == 0) {
+		pthread_cond_broadcast(&exec_lock.cond);
+	}
+	pthread_mutex_unlock(&exec_lock.mutex);
+}
+
+void ctl_exclusive_lock(void)
+{
+	pthread_mutex_lock(&exec_lock.mutex);
+	exec_lock.waiting++;
+	while (exec_lock.exclusive || exec_lock.shared > 0) {
+		pthread_cond_wait(&exec_lock.cond, &exec_lock.mutex);
+	}
+	exec_lock.waiting--;
+	exec_lock.exclusive = true;
+	pthread_mutex_unlock(&exec_lock.mutex);
+}
+
+void ctl_exclusive_unlock(void)
+{
+	pthread_mutex_lock(&exec_lock.mutex);
+	assert(exec_lock.exclusive);
+	exec_lock.exclusive = false;
+	pthread_cond_broadcast(&exec_lock.cond);
+	pthread_mutex_unlock(&exec_lock.mutex);
+}
+
+int ctl_process(knot_ctl_t *ctl, server_t *server, int thread_idx)
+{
+	if (ctl == NULL || server == NULL ||
+	    thread_idx < 0 || thread_idx > CTL_MAX_CONCURRENT) {
 		return KNOT_EINVAL;
 	}
 
 	ctl_args_t args = {
 		.ctl = ctl,
 		.type = KNOT_CTL_TYPE_END,
-		.server = server
+		.server = server,
+		.thread_idx = thread_idx
 	};
 
 	// Strip redundant/unprocessed data units in the current block.
@@ -90,8 +152,24 @@ int ctl_process(knot_ctl_t *ctl, server_t *server)
 			continue;
 		}
 
-		// Execute the command.
+		// Execute the command, the lockless ones don't access the server state.
+		bool lockless = ctl_is_lockless(cmd);
+		bool concurrent = ctl_is_concurrent(cmd);
+		if (!lockless) {
+			if (concurrent) {
+				exec_lock_shared();
+			} else {
+				ctl_exclusive_lock();
+			}
+		}
 		int cmd_ret = ctl_exec(cmd, &args);
+		if (!lockless) {
+			if (concurrent) {
+				exec_unlock_shared();
+			} else {
+				ctl_exclusive_unlock();
+			}
+		}
 		switch (cmd_ret) {
 		case KNOT_EOK:
 			strip = false;
@@ -19,12 +19,31 @@
 #include "libknot/libknot.h"
 #include "knot/server/server.h"
 
+/*!
+ * Acquires the exclusive access to the server state, which waits until all
+ * the control commands in progress are finished.
+ *
+ * \note Needed for server operations outside the control processing, which
+ *       can't run concurrently with control commands (e.g. server reload).
+ */
+void ctl_exclusive_lock(void);
+
+/*!
+ * Releases the exclusive access to the server state.
+ */
+void ctl_exclusive_unlock(void);
+
 /*!
  * Processes incoming control commands.
  *
- * \param[in] ctl     Control context.
- * \param[in] server  Server instance.
+ * The concurrent commands (see ctl_is_concurrent()) can be processed in
+ * several threads at once, other commands are processed exclusively.
+ *
+ * \param[in] ctl         Control context.
+ * \param[in] server      Server instance.
+ * \param[in] thread_idx  Processing thread index (0 for the main thread,
+ *                        at most CTL_MAX_CONCURRENT).
  *
  * \return Error code, KNOT_EOK if successful.
  */
-int ctl_process(knot_ctl_t *ctl, server_t *server);
+int ctl_process(knot_ctl_t *ctl, server_t *server, int thread_idx);
@@ -20,6 +20,7 @@
 #include "contrib/time.h"
 #include "libknot/libknot.h"
 #include "knot/dnssec/context.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/dnssec/kasp/keystore.h"
 
 knot_dynarray_define(parent, knot_kasp_parent_t, DYNARRAY_VISIBILITY_NORMAL)
@@ -84,6 +85,9 @@ static void policy_load(knot_kasp_policy_t *policy, conf_t *conf, conf_val_t *id
 	val = conf_id_get(conf, C_POLICY, C_RRSIG_PREREFRESH, id);
 	policy->rrsig_prerefresh = conf_int(&val);
 
+	val = conf_id_get(conf, C_POLICY, C_RRSIG_JITTER, id);
+	policy->rrsig_jitter = conf_int(&val);
+
 	val = conf_id_get(conf, C_POLICY, C_REPRO_SIGNING, id);
 	policy->reproducible_sign = conf_bool(&val);
 
@@ -259,6 +263,14 @@ void kdnssec_ctx_deinit(kdnssec_ctx_t *ctx)
 	}
 	knot_rrset_free(ctx->offline_rrsig, NULL);
 	dnssec_keystore_deinit(ctx->keystore);
+	if (ctx->zone != NULL) {
+		// Keep the loaded private keys for the next context of the zone.
+		for (size_t i = 0; i < ctx->zone->num_keys; i++) {
+			key_cache_put(ctx->zone->dname, ctx->zone->keys[i].id,
+			              ctx->zone->keys[i].key);
+			ctx->zone->keys[i].key = NULL;
+		}
+	}
 	kasp_zone_free(&ctx->zone);
 	free(ctx->kasp_zone_path);
 
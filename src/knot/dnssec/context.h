@@ -23,6 +23,7 @@
 #include "knot/conf/conf.h"
 #include "knot/dnssec/kasp/kasp_zone.h"
 #include "knot/dnssec/kasp/policy.h"
+#include "knot/dnssec/valid-cache.h"
 
 /*!
  * \brief DNSSEC signing context.
@@ -45,6 +46,8 @@ typedef struct {
 	unsigned dbus_event;
 
 	knot_rrset_t *offline_rrsig;
+
+	valid_cache_t *valid_cache; // Optional cache of validated RRSIGs.
 } kdnssec_ctx_t;
 
 /*!
@@ -157,87 +157,143 @@ static const knot_layer_api_t ds_query_api = {
 	.finish = NULL,
 };
 
-static int try_ds(conf_t *conf, const knot_dname_t *zone_name, const conf_remote_t *parent,
-                  zone_key_t *key, size_t timeout, uint32_t *ds_ttl)
-{
-	// TODO: Abstract interface to issue DNS queries. This is almost copy-pasted.
-
-	assert(zone_name);
-	assert(parent);
+typedef struct {
+	knot_kasp_parent_t *parent;
+	size_t next;     /*!< Address to be tried next. */
+	bool finished;   /*!< The parent answered or all its addresses failed. */
+	int ret;
+	uint32_t ttl;
+} ds_parent_t;
 
-	struct ds_query_data data = {
+static knot_request_t *ds_request(conf_t *conf, const knot_dname_t *zone_name,
+                                  const conf_remote_t *parent, zone_key_t *key,
+                                  struct ds_query_data *data)
+{
+	*data = (struct ds_query_data) {
 		.zone_name = zone_name,
 		.remote = (struct sockaddr *)&parent->addr,
 		.key = key,
 		.edns = query_edns_data_init(conf, parent->addr.ss_family,
 		                             QUERY_EDNS_OPT_DO),
-		.ds_ok = false,
-		.result_logged = false,
-		.ttl = 0,
 	};
 
-	knot_requestor_t requestor;
-	knot_requestor_init(&requestor, &ds_query_api, &data, NULL);
-
 	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
-	if (!pkt) {
-		knot_requestor_clear(&requestor);
-		return KNOT_ENOMEM;
+	if (pkt == NULL) {
+		return NULL;
 	}
 
 	const struct sockaddr_storage *dst = &parent->addr;
 	const struct sockaddr_storage *src = &parent->via;
 	knot_request_t *req = knot_request_make(NULL, dst, src, pkt, &parent->key, 0);
-	if (!req) {
-		knot_request_free(req, NULL);
-		knot_requestor_clear(&requestor);
-		return KNOT_ENOMEM;
+	if (req == NULL) {
+		knot_pkt_free(pkt);
 	}
 
-	int ret = knot_requestor_exec(&requestor, req, timeout);
-	knot_request_free(req, NULL);
-	knot_requestor_clear(&requestor);
+	return req;
+}
 
+static int ds_result(const knot_dname_t *zone_name, struct ds_query_data *data,
+                     knot_requestor_t *requestor, int ret)
+{
 	// alternative: we could put answer back through ctx instead of errcode
-	if (ret == KNOT_EOK && !data.ds_ok) {
+	if (ret == KNOT_EOK && !data->ds_ok) {
 		ret = KNOT_ENORECORD;
 	}
 
-	if (ret != KNOT_EOK && !data.result_logged) {
+	if (ret != KNOT_EOK && !data->result_logged) {
 		ns_log(LOG_WARNING, zone_name, LOG_OPERATION_DS_CHECK,
-		       LOG_DIRECTION_OUT, data.remote,
-		       requestor.layer.flags & KNOT_REQUESTOR_REUSED,
+		       LOG_DIRECTION_OUT, data->remote,
+		       requestor->layer.flags & KNOT_REQUESTOR_REUSED,
 		       "failed (%s)", knot_strerror(ret));
 	}
 
-	*ds_ttl = data.ttl;
-
 	return ret;
 }
 
+/*!
+ * \brief Queries the next address of each unfinished parent, all at once.
+ *
+ * \return False if there was nothing to query.
+ */
+static bool ds_round(conf_t *conf, const knot_dname_t *zone_name, zone_key_t *key,
+                     ds_parent_t *parents, size_t count, size_t timeout)
+{
+	knot_requestor_t requestors[count];
+	knot_request_t *reqs[count];
+	struct ds_query_data data[count];
+	ds_parent_t *sent[count];
+	int rets[count];
+
+	size_t pending = 0;
+	for (size_t i = 0; i < count; i++) {
+		ds_parent_t *p = &parents[i];
+		if (p->finished) {
+			continue;
+		}
+		if (p->next >= p->parent->addrs) {
+			p->finished = true;
+			continue;
+		}
+		const conf_remote_t *addr = &p->parent->addr[p->next++];
+
+		reqs[pending] = ds_request(conf, zone_name, addr, key, &data[pending]);
+		if (reqs[pending] == NULL) {
+			p->ret = KNOT_ENOMEM;
+			p->finished = true;
+			continue;
+		}
+		knot_requestor_init(&requestors[pending], &ds_query_api, &data[pending], NULL);
+		sent[pending++] = p;
+	}
+	if (pending == 0) {
+		return false;
+	}
+
+	knot_requestor_exec_multi(requestors, reqs, rets, pending, timeout);
+
+	for (size_t i = 0; i < pending; i++) {
+		ds_parent_t *p = sent[i];
+		p->ret = ds_result(zone_name, &data[i], &requestors[i], rets[i]);
+		p->ttl = data[i].ttl;
+		// parent was queried successfully, even if the answer was negative
+		p->finished = (p->ret == KNOT_EOK || p->ret == KNOT_ENORECORD);
+		knot_request_free(reqs[i], NULL);
+		knot_requestor_clear(&requestors[i]);
+	}
+
+	return true;
+}
+
 static bool parents_have_ds(conf_t *conf, kdnssec_ctx_t *kctx, zone_key_t *key,
                             size_t timeout, uint32_t *max_ds_ttl)
 {
-	bool success = false;
-	knot_dynarray_foreach(parent, knot_kasp_parent_t, i, kctx->policy->parents) {
-		success = false;
-		for (size_t j = 0; j < i->addrs; j++) {
-			uint32_t ds_ttl = 0;
-			int ret = try_ds(conf, kctx->zone->dname, &i->addr[j], key,
-			                 timeout, &ds_ttl);
-			if (ret == KNOT_EOK) {
-				*max_ds_ttl = MAX(*max_ds_ttl, ds_ttl);
-				success = true;
-				break;
-			} else if (ret == KNOT_ENORECORD) {
-				// parent was queried successfully, answer was negative
-				break;
-			}
-		}
+	size_t count = kctx->policy->parents.size;
+	if (count == 0) {
+		return false;
+	}
+
+	ds_parent_t parents[count];
+	knot_kasp_parent_t *parent = parent_dynarray_arr(&kctx->policy->parents);
+	for (size_t i = 0; i < count; i++) {
+		parents[i] = (ds_parent_t) { .parent = &parent[i], .ret = KNOT_ENOENT };
+	}
+
+	// Query all parents concurrently, failed ones at their next address.
+	bool success;
+	do {
 		// Each parent must succeed.
-		if (!success) {
-			return false;
+		success = true;
+		for (size_t i = 0; i < count; i++) {
+			if (parents[i].finished && parents[i].ret != KNOT_EOK) {
+				return false;
+			}
+			success &= parents[i].finished;
 		}
+	} while (!success && ds_round(conf, kctx->zone->dname, key, parents, count, timeout));
+
+	for (size_t i = 0; i < count; i++) {
+		success &= (parents[i].ret == KNOT_EOK);
+		*max_ds_ttl = MAX(*max_ds_ttl, parents[i].ttl);
 	}
 	return success;
 }
@@ -32,6 +32,7 @@ typedef enum {
 	KASPDBKEY_LASTSIGNEDSERIAL = 0x6,
 	KASPDBKEY_OFFLINE_RECORDS = 0x7,
 	KASPDBKEY_SAVED_TTLS = 0x8,
+	KASPDBKEY_RRSIG_VALID = 0x9,
 } keyclass_t;
 
 static const keyclass_t zone_related_classes[] = {
@@ -42,6 +43,7 @@ static const keyclass_t zone_related_classes[] = {
 	KASPDBKEY_LASTSIGNEDSERIAL,
 	KASPDBKEY_OFFLINE_RECORDS,
 	KASPDBKEY_SAVED_TTLS,
+	KASPDBKEY_RRSIG_VALID,
 };
 static const size_t zone_related_classes_size = sizeof(zone_related_classes) / sizeof(*zone_related_classes);
 
@@ -71,6 +73,7 @@ static MDB_val make_key_str(keyclass_t kclass, const knot_dname_t *dname, const
 	case KASPDBKEY_LASTSIGNEDSERIAL:
 	case KASPDBKEY_MASTERSERIAL:
 	case KASPDBKEY_SAVED_TTLS:
+	case KASPDBKEY_RRSIG_VALID:
 		assert(dname != NULL && str == NULL);
 		return knot_lmdb_make_key("BN", (int)kclass, dname);
 	case KASPDBKEY_PARAMS:
@@ -486,18 +489,53 @@ int kasp_db_set_policy_last(knot_lmdb_db_t *db, const char *policy_string, const
 	return txn.ret;
 }
 
-int kasp_db_store_offline_records(knot_lmdb_db_t *db, knot_time_t for_time, const key_records_t *r)
+static void store_offline_records(knot_lmdb_txn_t *txn, knot_time_t for_time,
+                                  const key_records_t *r)
 {
 	MDB_val k = make_key_time(KASPDBKEY_OFFLINE_RECORDS, r->rrsig.owner, for_time);
 	MDB_val v = { key_records_serialized_size(r), NULL };
+	if (knot_lmdb_insert(txn, &k, &v)) {
+		wire_ctx_t wire = wire_ctx_init(v.mv_data, v.mv_size);
+		txn->ret = key_records_serialize(&wire, r);
+	}
+	free(k.mv_data);
+}
+
+static void delete_offline_records(knot_lmdb_txn_t *txn, const knot_dname_t *zone,
+                                   knot_time_t from_time, knot_time_t to_time)
+{
+	MDB_val prefix = make_key_str(KASPDBKEY_OFFLINE_RECORDS, zone, NULL);
+	knot_lmdb_foreach(txn, &prefix) {
+		knot_time_t found;
+		if (unmake_key_time(&txn->cur_key, &found) &&
+		    knot_time_cmp(found, from_time) >= 0 &&
+		    knot_time_cmp(found, to_time) <= 0) {
+			knot_lmdb_del_cur(txn);
+		}
+	}
+	free(prefix.mv_data);
+}
+
+int kasp_db_store_offline_records(knot_lmdb_db_t *db, knot_time_t for_time, const key_records_t *r)
+{
 	knot_lmdb_txn_t txn = { 0 };
 	knot_lmdb_begin(db, &txn, true);
-	if (knot_lmdb_insert(&txn, &k, &v)) {
-		wire_ctx_t wire = wire_ctx_init(v.mv_data, v.mv_size);
-		txn.ret = key_records_serialize(&wire, r);
+	store_offline_records(&txn, for_time, r);
+	knot_lmdb_commit(&txn);
+	return txn.ret;
+}
+
+int kasp_db_replace_offline_records(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                                    knot_time_t from_time, const knot_time_t *for_times,
+                                    const key_records_t *rs, size_t count)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+	delete_offline_records(&txn, zone, from_time, 0);
+	for (size_t i = 0; i < count && txn.ret == KNOT_EOK; i++) {
+		store_offline_records(&txn, for_times[i], &rs[i]);
 	}
 	knot_lmdb_commit(&txn);
-	free(k.mv_data);
 	return txn.ret;
 }
 
@@ -532,19 +570,10 @@ int kasp_db_load_offline_records(knot_lmdb_db_t *db, const knot_dname_t *for_dna
 int kasp_db_delete_offline_records(knot_lmdb_db_t *db, const knot_dname_t *zone,
                                    knot_time_t from_time, knot_time_t to_time)
 {
-	MDB_val prefix = make_key_str(KASPDBKEY_OFFLINE_RECORDS, zone, NULL);
 	knot_lmdb_txn_t txn = { 0 };
 	knot_lmdb_begin(db, &txn, true);
-	knot_lmdb_foreach(&txn, &prefix) {
-		knot_time_t found;
-		if (unmake_key_time(&txn.cur_key, &found) &&
-		    knot_time_cmp(found, from_time) >= 0 &&
-		    knot_time_cmp(found, to_time) <= 0) {
-			knot_lmdb_del_cur(&txn);
-		}
-	}
+	delete_offline_records(&txn, zone, from_time, to_time);
 	knot_lmdb_commit(&txn);
-	free(prefix.mv_data);
 	return txn.ret;
 }
 
@@ -570,6 +599,73 @@ int kasp_db_set_saved_ttls(knot_lmdb_db_t *db, const knot_dname_t *zone,
 	return knot_lmdb_quick_insert(db, key, val);
 }
 
+int kasp_db_load_rrsig_valid(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                              trie_t *digests)
+{
+	MDB_val prefix = make_key_str(KASPDBKEY_RRSIG_VALID, zone, NULL);
+	if (prefix.mv_data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, false);
+	knot_lmdb_foreach(&txn, &prefix) {
+		uint32_t expire = 0;
+		if (txn.cur_key.mv_size <= prefix.mv_size ||
+		    !knot_lmdb_unmake_curval(&txn, "I", &expire)) {
+			continue;
+		}
+		trie_val_t *val = trie_get_ins(digests, txn.cur_key.mv_data + prefix.mv_size,
+		                               txn.cur_key.mv_size - prefix.mv_size);
+		if (val == NULL) {
+			txn.ret = KNOT_ENOMEM;
+			break;
+		}
+		*val = (void *)(uintptr_t)expire;
+	}
+	knot_lmdb_abort(&txn);
+	free(prefix.mv_data);
+	return txn.ret;
+}
+
+int kasp_db_update_rrsig_valid(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                               trie_t *del, trie_t *ins)
+{
+	MDB_val prefix = make_key_str(KASPDBKEY_RRSIG_VALID, zone, NULL);
+	if (prefix.mv_data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+	trie_t *tries[] = { del, ins };
+	for (int i = 0; i < 2 && txn.ret == KNOT_EOK; i++) {
+		if (tries[i] == NULL) {
+			continue;
+		}
+		trie_it_t *it = trie_it_begin(tries[i]);
+		for (; it != NULL && !trie_it_finished(it) && txn.ret == KNOT_EOK; trie_it_next(it)) {
+			size_t len = 0;
+			const trie_key_t *digest = trie_it_key(it, &len);
+			MDB_val key = knot_lmdb_make_key("BND", KASPDBKEY_RRSIG_VALID,
+			                                 zone, digest, len);
+			if (i == 0) {
+				if (knot_lmdb_find(&txn, &key, KNOT_LMDB_EXACT)) {
+					knot_lmdb_del_cur(&txn);
+				}
+			} else {
+				uint32_t expire = (uintptr_t)*trie_it_val(it);
+				MDB_val val = knot_lmdb_make_key("I", expire);
+				(void)knot_lmdb_insert(&txn, &key, &val);
+				free(val.mv_data);
+			}
+			free(key.mv_data);
+		}
+		trie_it_free(it);
+	}
+	knot_lmdb_commit(&txn);
+	free(prefix.mv_data);
+	return txn.ret;
+}
+
 void kasp_db_ensure_init(knot_lmdb_db_t *db, conf_t *conf)
 {
 	if (db->path == NULL) {
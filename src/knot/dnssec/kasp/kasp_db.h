@@ -18,6 +18,7 @@
 
 #include <time.h>
 
+#include "contrib/qp-trie/trie.h"
 #include "contrib/time.h"
 #include "contrib/ucw/lists.h"
 #include "libknot/db/db_lmdb.h"
@@ -222,6 +223,22 @@ int kasp_db_set_policy_last(knot_lmdb_db_t *db, const char *policy_string, const
  */
 int kasp_db_store_offline_records(knot_lmdb_db_t *db, knot_time_t for_time, const key_records_t *r);
 
+/*!
+ * \brief Replace pre-generated records for offline KSK usage in one transaction.
+ *
+ * \param db         KASP db.
+ * \param zone       Zone name.
+ * \param from_time  All the records since this timestamp are deleted first.
+ * \param for_times  Timestamps in which the respective records shall be used.
+ * \param rs         Records to be stored.
+ * \param count      Number of records.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_replace_offline_records(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                                    knot_time_t from_time, const knot_time_t *for_times,
+                                    const key_records_t *rs, size_t count);
+
 /*!
  * \brief Load pregenerated records for offline signing.
  *
@@ -275,6 +292,31 @@ int kasp_db_get_saved_ttls(knot_lmdb_db_t *db, const knot_dname_t *zone,
 int kasp_db_set_saved_ttls(knot_lmdb_db_t *db, const knot_dname_t *zone,
                            uint32_t max_ttl, uint32_t key_ttl);
 
+/*!
+ * \brief Load digests of RRSIGs known to be valid.
+ *
+ * \param db        KASP db.
+ * \param zone      Zone name.
+ * \param digests   Out: trie of digests, values are signature expirations.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_load_rrsig_valid(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                              trie_t *digests);
+
+/*!
+ * \brief Remove and store digests of RRSIGs known to be valid.
+ *
+ * \param db     KASP db.
+ * \param zone   Zone name.
+ * \param del    Optional: digests to be removed.
+ * \param ins    Optional: digests to be stored, values are signature expirations.
+ *
+ * \return KNOT_E*
+ */
+int kasp_db_update_rrsig_valid(knot_lmdb_db_t *db, const knot_dname_t *zone,
+                               trie_t *del, trie_t *ins);
+
 /*!
  * \brief Initialize KASP database according to conf, if not already.
  *
@@ -0,0 +1,161 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/openbsd/siphash.h"
+#include "knot/dnssec/key-cache.h"
+#include "libdnssec/binary.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+
+// Enough for a few keys of every zone in large deployments, collisions just evict.
+#define KEY_CACHE_SIZE	(1 << 16)
+
+typedef struct {
+	knot_dname_t *zone;     // NULL if the entry is empty.
+	char *id;
+	dnssec_key_t *key;
+} key_entry_t;
+
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static key_entry_t *cache = NULL;
+static SIPHASH_KEY cache_key;
+
+static void entry_clear(key_entry_t *entry)
+{
+	knot_dname_free(entry->zone, NULL);
+	free(entry->id);
+	dnssec_key_free(entry->key);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static key_entry_t *entry_get(const knot_dname_t *zone, const char *id)
+{
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache_key);
+	SipHash24_Update(&ctx, zone, knot_dname_size(zone));
+	SipHash24_Update(&ctx, id, strlen(id));
+	uint64_t hash = SipHash24_End(&ctx);
+
+	return &cache[hash & (KEY_CACHE_SIZE - 1)];
+}
+
+static bool entry_match(const key_entry_t *entry, const knot_dname_t *zone, const char *id)
+{
+	return entry->zone != NULL && knot_dname_is_equal(entry->zone, zone) &&
+	       strcmp(entry->id, id) == 0;
+}
+
+void key_cache_init(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	if (cache == NULL &&
+	    dnssec_random_buffer((uint8_t *)&cache_key, sizeof(cache_key)) == DNSSEC_EOK) {
+		cache = calloc(KEY_CACHE_SIZE, sizeof(*cache));
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void key_cache_deinit(void)
+{
+	pthread_mutex_lock(&cache_lock);
+	if (cache != NULL) {
+		for (size_t i = 0; i < KEY_CACHE_SIZE; i++) {
+			entry_clear(&cache[i]);
+		}
+		free(cache);
+		cache = NULL;
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
+
+void key_cache_put(const knot_dname_t *zone, const char *id, dnssec_key_t *key)
+{
+	if (zone == NULL || id == NULL || !dnssec_key_can_sign(key)) {
+		dnssec_key_free(key);
+		return;
+	}
+
+	knot_dname_t *zone_copy = knot_dname_copy(zone, NULL);
+	char *id_copy = strdup(id);
+
+	pthread_mutex_lock(&cache_lock);
+	if (cache == NULL || zone_copy == NULL || id_copy == NULL) {
+		pthread_mutex_unlock(&cache_lock);
+		knot_dname_free(zone_copy, NULL);
+		free(id_copy);
+		dnssec_key_free(key);
+		return;
+	}
+
+	key_entry_t *entry = entry_get(zone, id);
+	entry_clear(entry);
+	entry->zone = zone_copy;
+	entry->id = id_copy;
+	entry->key = key;
+	pthread_mutex_unlock(&cache_lock);
+}
+
+dnssec_key_t *key_cache_take(const knot_dname_t *zone, const char *id,
+                             const dnssec_key_t *pub)
+{
+	if (zone == NULL || id == NULL || pub == NULL) {
+		return NULL;
+	}
+
+	dnssec_key_t *key = NULL;
+
+	pthread_mutex_lock(&cache_lock);
+	if (cache != NULL) {
+		key_entry_t *entry = entry_get(zone, id);
+		if (entry_match(entry, zone, id)) {
+			// Flags or the algorithm might have been changed meanwhile.
+			dnssec_binary_t cached = { 0 }, loaded = { 0 };
+			(void)dnssec_key_get_rdata(entry->key, &cached);
+			(void)dnssec_key_get_rdata(pub, &loaded);
+			if (dnssec_binary_cmp(&cached, &loaded) == 0) {
+				key = entry->key;
+				entry->key = NULL;
+			}
+			entry_clear(entry);
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	return key;
+}
+
+void key_cache_drop(const char *id)
+{
+	if (id == NULL) {
+		return;
+	}
+
+	// The key might be cached for several zones sharing it.
+	pthread_mutex_lock(&cache_lock);
+	if (cache != NULL) {
+		for (size_t i = 0; i < KEY_CACHE_SIZE; i++) {
+			if (cache[i].zone != NULL && strcmp(cache[i].id, id) == 0) {
+				entry_clear(&cache[i]);
+			}
+		}
+	}
+	pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,69 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Process-wide cache of the keys with loaded private keys.
+ *
+ * Loading a private key from the keystore means reading and parsing it,
+ * so the keys of a finished DNSSEC context are kept here and handed over to
+ * the next context of the same zone, as long as the public key in KASP DB
+ * didn't change. A key is always owned either by the cache or by exactly one
+ * context, there is no sharing.
+ */
+
+#pragma once
+
+#include "libdnssec/key.h"
+#include "libknot/dname.h"
+
+/*!
+ * \brief Enables the cache, until then the stored keys are just freed.
+ */
+void key_cache_init(void);
+
+/*!
+ * \brief Frees all the cached keys and disables the cache.
+ */
+void key_cache_deinit(void);
+
+/*!
+ * \brief Takes over a key once its context is done.
+ *
+ * \param zone  Zone name.
+ * \param id    Key ID.
+ * \param key   Key, freed if it has no private key or the cache is disabled.
+ */
+void key_cache_put(const knot_dname_t *zone, const char *id, dnssec_key_t *key);
+
+/*!
+ * \brief Hands over a cached key with the private key loaded.
+ *
+ * \param zone  Zone name.
+ * \param id    Key ID.
+ * \param pub   Key just loaded from KASP DB, the cached one must match its DNSKEY.
+ *
+ * \return Cached key removed from the cache, NULL if not found.
+ */
+dnssec_key_t *key_cache_take(const knot_dname_t *zone, const char *id,
+                             const dnssec_key_t *pub);
+
+/*!
+ * \brief Drops the cached key, e.g. when it's removed from the keystore.
+ *
+ * \param id    Key ID.
+ */
+void key_cache_drop(const char *id);
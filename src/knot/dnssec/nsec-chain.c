@@ -19,6 +19,7 @@
 #include "contrib/base32hex.h"
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/rrset-sign.h"
+#include "knot/dnssec/sign-pool.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/zone/adjust.h"
@@ -104,6 +105,92 @@ static int create_nsec_rrset(knot_rrset_t *rrset, const zone_node_t *from,
 	return ret;
 }
 
+/*!
+ * \brief Create NSEC RR set for a node unless its current NSEC is the same.
+ *
+ * \param rrset  RRSet to be initialized, left empty if the current NSEC is valid.
+ * \param from   Node that should contain the new RRSet.
+ * \param to     Owner the new NSEC should point to.
+ * \param ttl    Record TTL (SOA's minimum TTL).
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+static int create_changed_nsec_rrset(knot_rrset_t *rrset, const zone_node_t *from,
+                                     const knot_dname_t *to, uint32_t ttl)
+{
+	int ret = create_nsec_rrset(rrset, from, to, ttl);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_rrset_t old_nsec = node_rrset(from, KNOT_RRTYPE_NSEC);
+	if (knot_rrset_empty(&old_nsec)) {
+		return KNOT_EOK;
+	}
+
+	/* Convert old NSEC to lowercase, just in case it's not. */
+	knot_rrset_t *old_nsec_lc = knot_rrset_copy(&old_nsec, NULL);
+	ret = knot_rrset_rr_to_canonical(old_nsec_lc);
+	if (ret != KNOT_EOK) {
+		knot_rrset_free(old_nsec_lc, NULL);
+		knot_rdataset_clear(&rrset->rrs, NULL);
+		return ret;
+	}
+
+	bool equal = knot_rrset_equal(rrset, old_nsec_lc, true);
+	knot_rrset_free(old_nsec_lc, NULL);
+
+	if (equal) {
+		// current NSEC is valid, do nothing
+		knot_rdataset_clear(&rrset->rrs, NULL);
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Replace the NSEC of a node with a new one.
+ */
+static int replace_nsec(const zone_node_t *node, knot_rrset_t *new_nsec,
+                        zone_update_t *update)
+{
+	if (node_rrtype_exists(node, KNOT_RRTYPE_NSEC)) {
+		int ret = knot_nsec_changeset_remove(node, update);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	// Add new NSEC to the changeset (no matter if old was removed)
+	return zone_update_add(update, new_nsec);
+}
+
+/*!
+ * \brief Check if the node is left out of the NSEC chain.
+ *
+ * \param node    Node to check.
+ * \param remove  Output: the redundant NSEC of the node shall be removed.
+ */
+static bool nsec_skipped(const zone_node_t *node, bool *remove)
+{
+	*remove = false;
+	if (node->rrset_count == 0 || node->flags & NODE_FLAGS_NONAUTH) {
+		return true;
+	}
+
+	/*!
+	 * If the node has no other RRSets than NSEC (and possibly RRSIGs),
+	 * just remove the NSEC and its RRSIG, they are redundant
+	 */
+	if (node_rrtype_exists(node, KNOT_RRTYPE_NSEC)
+	    && knot_nsec_empty_nsec_and_rrsigs_in_node(node)) {
+		*remove = true;
+		return true;
+	}
+
+	return false;
+}
+
 /*!
  * \brief Connect two nodes by adding a NSEC RR into the first node.
  *
@@ -123,21 +210,13 @@ static int connect_nsec_nodes(zone_node_t *a, zone_node_t *b,
 	assert(b);
 	assert(data);
 
-	if (b->rrset_count == 0 || b->flags & NODE_FLAGS_NONAUTH) {
-		return NSEC_NODE_SKIP;
-	}
-
-	int ret = KNOT_EOK;
-
-	/*!
-	 * If the node has no other RRSets than NSEC (and possibly RRSIGs),
-	 * just remove the NSEC and its RRSIG, they are redundant
-	 */
-	if (node_rrtype_exists(b, KNOT_RRTYPE_NSEC)
-	    && knot_nsec_empty_nsec_and_rrsigs_in_node(b)) {
-		ret = knot_nsec_changeset_remove(b, data->update);
-		if (ret != KNOT_EOK) {
-			return ret;
+	bool remove;
+	if (nsec_skipped(b, &remove)) {
+		if (remove) {
+			int ret = knot_nsec_changeset_remove(b, data->update);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
 		}
 		// Skip the 'b' node
 		return NSEC_NODE_SKIP;
@@ -145,40 +224,12 @@ static int connect_nsec_nodes(zone_node_t *a, zone_node_t *b,
 
 	// create new NSEC
 	knot_rrset_t new_nsec;
-	ret = create_nsec_rrset(&new_nsec, a, b->owner, data->ttl);
-	if (ret != KNOT_EOK) {
+	int ret = create_changed_nsec_rrset(&new_nsec, a, b->owner, data->ttl);
+	if (ret != KNOT_EOK || knot_rrset_empty(&new_nsec)) {
 		return ret;
 	}
 
-	knot_rrset_t old_nsec = node_rrset(a, KNOT_RRTYPE_NSEC);
-
-	if (!knot_rrset_empty(&old_nsec)) {
-		/* Convert old NSEC to lowercase, just in case it's not. */
-		knot_rrset_t *old_nsec_lc = knot_rrset_copy(&old_nsec, NULL);
-		ret = knot_rrset_rr_to_canonical(old_nsec_lc);
-		if (ret != KNOT_EOK) {
-			knot_rrset_free(old_nsec_lc, NULL);
-			return ret;
-		}
-
-		bool equal = knot_rrset_equal(&new_nsec, old_nsec_lc, true);
-		knot_rrset_free(old_nsec_lc, NULL);
-
-		if (equal) {
-			// current NSEC is valid, do nothing
-			knot_rdataset_clear(&new_nsec.rrs, NULL);
-			return KNOT_EOK;
-		}
-
-		ret = knot_nsec_changeset_remove(a, data->update);
-		if (ret != KNOT_EOK) {
-			knot_rdataset_clear(&new_nsec.rrs, NULL);
-			return ret;
-		}
-	}
-
-	// Add new NSEC to the changeset (no matter if old was removed)
-	ret = zone_update_add(data->update, &new_nsec);
+	ret = replace_nsec(a, &new_nsec, data->update);
 	knot_rdataset_clear(&new_nsec.rrs, NULL);
 	return ret;
 }
@@ -712,18 +763,144 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n)
 
 /* - API - Chain creation --------------------------------------------------- */
 
+#define NSEC_BATCH_SIZE 4096
+#define NSEC_CHUNK_SIZE 64
+
+enum {
+	NSEC_IN_CHAIN = 1 << 0,
+	NSEC_REMOVE   = 1 << 1,
+};
+
+/*!
+ * \brief NSEC chain created in parallel.
+ *
+ * The nodes are classified in parallel first. Then the new NSEC records are
+ * created in parallel batch by batch, each one needing just the owner of the
+ * next node in the chain, and the batch is stored into the update sequentially.
+ */
+typedef struct {
+	zone_node_t **nodes;
+	uint8_t *flags;
+	size_t count;
+	uint32_t ttl;
+	knot_rrset_t nsecs[NSEC_BATCH_SIZE]; // Empty if the NSEC is valid.
+	size_t begin;
+	size_t end;
+	size_t next;
+	int ret;
+} nsec_create_t;
+
+static void nsec_classify_thread(void *ctx, _unused_ unsigned index)
+{
+	nsec_create_t *cr = ctx;
+
+	size_t i;
+	while ((i = __atomic_fetch_add(&cr->next, NSEC_BATCH_SIZE, __ATOMIC_RELAXED)) < cr->count) {
+		size_t end = MIN(i + NSEC_BATCH_SIZE, cr->count);
+		for (; i < end; i++) {
+			bool remove;
+			// The first node (apex) is always in the chain.
+			bool skipped = (i > 0) && nsec_skipped(cr->nodes[i], &remove);
+			cr->flags[i] = skipped ? (remove ? NSEC_REMOVE : 0) : NSEC_IN_CHAIN;
+		}
+	}
+}
+
+static void nsec_create_thread(void *ctx, _unused_ unsigned index)
+{
+	nsec_create_t *cr = ctx;
+
+	size_t i;
+	while ((i = cr->begin + __atomic_fetch_add(&cr->next, NSEC_CHUNK_SIZE,
+	                                           __ATOMIC_RELAXED)) < cr->end) {
+		size_t end = MIN(i + NSEC_CHUNK_SIZE, cr->end);
+		for (; i < end; i++) {
+			knot_rrset_t *nsec = &cr->nsecs[i - cr->begin];
+			knot_rrset_init_empty(nsec);
+			if (!(cr->flags[i] & NSEC_IN_CHAIN)) {
+				continue;
+			}
+
+			// The last node in the chain points to the first one.
+			size_t next = i + 1;
+			while (next < cr->count && !(cr->flags[next] & NSEC_IN_CHAIN)) {
+				next++;
+			}
+			next = (next < cr->count) ? next : 0;
+
+			int ret = create_changed_nsec_rrset(nsec, cr->nodes[i],
+			                                    cr->nodes[next]->owner, cr->ttl);
+			if (ret != KNOT_EOK) {
+				knot_rrset_init_empty(nsec);
+				__atomic_store_n(&cr->ret, ret, __ATOMIC_RELAXED);
+			}
+		}
+	}
+}
+
 /*!
  * \brief Create new NSEC chain, add differences from current into a changeset.
  */
-int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl)
+int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl, unsigned threads)
 {
 	assert(update);
 	assert(update->new_cont->nodes);
 
-	nsec_chain_iterate_data_t data = { ttl, update, KNOT_RRTYPE_NSEC };
+	zone_tree_delsafe_it_t it = { 0 };
+	int ret = zone_tree_delsafe_it_begin(update->new_cont->nodes, &it, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
 
-	return knot_nsec_chain_iterate_create(update->new_cont->nodes,
-	                                      connect_nsec_nodes, &data);
+	nsec_create_t *cr = calloc(1, sizeof(*cr));
+	if (cr == NULL) {
+		zone_tree_delsafe_it_free(&it);
+		return KNOT_ENOMEM;
+	}
+	cr->ttl = ttl;
+
+	// The iterator holds the nodes in the canonical order, skip the deleted ones.
+	cr->nodes = it.nodes;
+	for (; !zone_tree_delsafe_it_finished(&it); zone_tree_delsafe_it_next(&it)) {
+		cr->nodes[cr->count++] = zone_tree_delsafe_it_val(&it);
+	}
+	if (cr->count == 0) {
+		ret = KNOT_EINVAL;
+		goto finish;
+	}
+
+	cr->flags = malloc(cr->count * sizeof(*cr->flags));
+	if (cr->flags == NULL) {
+		ret = KNOT_ENOMEM;
+		goto finish;
+	}
+	sign_pool_run(MIN(threads, 1 + cr->count / NSEC_BATCH_SIZE),
+	              nsec_classify_thread, cr);
+
+	for (cr->begin = 0; cr->begin < cr->count && ret == KNOT_EOK; cr->begin = cr->end) {
+		cr->end = MIN(cr->begin + NSEC_BATCH_SIZE, cr->count);
+		cr->next = 0;
+		sign_pool_run(MIN(threads, 1 + (cr->end - cr->begin) / NSEC_CHUNK_SIZE),
+		              nsec_create_thread, cr);
+		ret = cr->ret;
+
+		for (size_t i = cr->begin; i < cr->end; i++) {
+			knot_rrset_t *nsec = &cr->nsecs[i - cr->begin];
+			if (ret == KNOT_EOK && (cr->flags[i] & NSEC_REMOVE)) {
+				ret = knot_nsec_changeset_remove(cr->nodes[i], update);
+			} else if (ret == KNOT_EOK && !knot_rrset_empty(nsec)) {
+				ret = replace_nsec(cr->nodes[i], nsec, update);
+			}
+			knot_rdataset_clear(&nsec->rrs, NULL);
+		}
+	}
+
+finish:
+	free(cr->flags);
+	free(cr);
+	zone_tree_delsafe_it_free(&it);
+
+	return ret;
 }
 
 int knot_nsec_fix_chain(zone_update_t *update, uint32_t ttl)
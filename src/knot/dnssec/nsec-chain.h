@@ -145,10 +145,11 @@ bool knot_nsec_empty_nsec_and_rrsigs_in_node(const zone_node_t *n);
  *
  * \param update     Zone update to create NSEC chain for.
  * \param ttl        TTL for created NSEC records.
+ * \param threads    Number of threads for parallel NSEC creation.
  *
  * \return Error code, KNOT_EOK if successful.
  */
-int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl);
+int knot_nsec_create_chain(zone_update_t *update, uint32_t ttl, unsigned threads);
 
 /*!
  * \brief Fix existing NSEC chain to cover the changes in zone contents.
@@ -16,16 +16,22 @@
 
 #include <assert.h>
 
+#include "libdnssec/error.h"
 #include "libknot/dname.h"
 #include "knot/dnssec/nsec-chain.h"
 #include "knot/dnssec/nsec3-chain.h"
+#include "knot/dnssec/sign-pool.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/adjust.h"
 #include "knot/zone/zone-diff.h"
 #include "contrib/base32hex.h"
+#include "contrib/macros.h"
 #include "contrib/wire_ctx.h"
 
+#define NSEC3_BATCH_SIZE 4096
+#define NSEC3_CHUNK_SIZE 64
+
 static bool nsec3_empty(const zone_node_t *node, const dnssec_nsec3_params_t *params)
 {
 	bool opt_out = (params->flags & KNOT_NSEC3_FLAG_OPT_OUT);
@@ -221,32 +227,80 @@ static zone_node_t *create_nsec3_node(const knot_dname_t *owner,
 	return new_node;
 }
 
+/*!
+ * \brief Get the NSEC3 owner name cached in an adjusted node.
+ *
+ * The cached name is valid only if it was computed with the same NSEC3
+ * parameters and if the NSEC3 node pointers can't be dangling.
+ *
+ * \param node         Node in the zone.
+ * \param zone         Zone contents the node belongs to.
+ * \param params       Required NSEC3 parameters.
+ * \param ptrs_valid   NSEC3 node pointers of the zone are valid.
+ *
+ * \return Cached NSEC3 owner or NULL.
+ */
+static const knot_dname_t *cached_nsec3_owner(const zone_node_t *node,
+                                              const zone_contents_t *zone,
+                                              const dnssec_nsec3_params_t *params,
+                                              bool ptrs_valid)
+{
+	if (!knot_is_nsec3_enabled(zone) ||
+	    !dnssec_nsec3_params_match(&zone->nsec3_params, params)) {
+		return NULL;
+	}
+
+	if (node->flags & NODE_FLAGS_NSEC3_NODE) {
+		return ptrs_valid ? node->nsec3_node->owner : NULL;
+	} else {
+		return node->nsec3_hash;
+	}
+}
+
+/*!
+ * \brief Compute the NSEC3 owner name for a node, reusing the cached one if possible.
+ */
+static int nsec3_owner_for_node(knot_dname_t *out, size_t out_size,
+                                const zone_node_t *node,
+                                const zone_contents_t *zone,
+                                const dnssec_nsec3_params_t *params,
+                                bool ptrs_valid)
+{
+	const knot_dname_t *cached = cached_nsec3_owner(node, zone, params, ptrs_valid);
+	if (cached != NULL) {
+		size_t size = knot_dname_size(cached);
+		if (size > out_size) {
+			return KNOT_ESPACE;
+		}
+		memcpy(out, cached, size);
+		return KNOT_EOK;
+	}
+
+	return knot_create_nsec3_owner(out, out_size, node->owner, zone->apex->owner, params);
+}
+
 /*!
  * \brief Create new NSEC3 node for given regular node.
  *
- * \param node       Node for which the NSEC3 node is created.
- * \param apex       Zone apex node.
- * \param params     NSEC3 hash function parameters.
- * \param ttl        TTL of the new NSEC3 node.
+ * \param node         Node for which the NSEC3 node is created.
+ * \param nsec3_owner  Owner of the new NSEC3 node.
+ * \param apex         Zone apex node.
+ * \param params       NSEC3 hash function parameters.
+ * \param ttl          TTL of the new NSEC3 node.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static zone_node_t *create_nsec3_node_for_node(const zone_node_t *node,
+                                               const knot_dname_t *nsec3_owner,
                                                zone_node_t *apex,
                                                const dnssec_nsec3_params_t *params,
                                                uint32_t ttl)
 {
 	assert(node);
+	assert(nsec3_owner);
 	assert(apex);
 	assert(params);
 
-	knot_dname_storage_t nsec3_owner;
-	int ret = knot_create_nsec3_owner(nsec3_owner, sizeof(nsec3_owner),
-	                                  node->owner, apex->owner, params);
-	if (ret != KNOT_EOK) {
-		return NULL;
-	}
-
 	dnssec_nsec_bitmap_t *rr_types = dnssec_nsec_bitmap_new();
 	if (!rr_types) {
 		return NULL;
@@ -398,13 +452,109 @@ static int reconnect_nsec3_nodes2(zone_node_t *a, zone_node_t *b,
 	return ret;
 }
 
+/*!
+ * \brief Batch of NSEC3 nodes created in parallel.
+ */
+typedef struct {
+	const zone_contents_t *zone;
+	const dnssec_nsec3_params_t *params;
+	uint32_t ttl;
+	bool ptrs_valid;
+	const zone_node_t *nodes[NSEC3_BATCH_SIZE];
+	zone_node_t *nsec3_nodes[NSEC3_BATCH_SIZE];
+	size_t count;
+	size_t next;
+} nsec3_batch_t;
+
+static void nsec3_batch_thread(void *ctx, _unused_ unsigned index)
+{
+	nsec3_batch_t *batch = ctx;
+
+	size_t hash_len = dnssec_nsec3_hash_length(batch->params->algorithm);
+	uint8_t *hashes = malloc(NSEC3_CHUNK_SIZE * hash_len);
+
+	size_t i;
+	while ((i = __atomic_fetch_add(&batch->next, NSEC3_CHUNK_SIZE, __ATOMIC_RELAXED)) < batch->count) {
+		size_t end = MIN(i + NSEC3_CHUNK_SIZE, batch->count);
+
+		// Owners without a cached hash are hashed together.
+		dnssec_binary_t owners[NSEC3_CHUNK_SIZE];
+		size_t hashed[NSEC3_CHUNK_SIZE];
+		size_t count = 0;
+		for (size_t j = i; j < end; j++) {
+			batch->nsec3_nodes[j] = NULL;
+			const knot_dname_t *cached = cached_nsec3_owner(batch->nodes[j], batch->zone,
+			                                                batch->params, batch->ptrs_valid);
+			if (cached != NULL) {
+				batch->nsec3_nodes[j] =
+					create_nsec3_node_for_node(batch->nodes[j], cached,
+					                           batch->zone->apex, batch->params,
+					                           batch->ttl);
+				continue;
+			}
+			owners[count].data = batch->nodes[j]->owner;
+			owners[count].size = knot_dname_size(batch->nodes[j]->owner);
+			hashed[count++] = j;
+		}
+
+		if (count == 0 || hashes == NULL ||
+		    dnssec_nsec3_hash_batch(owners, count, batch->params, hashes) != DNSSEC_EOK) {
+			continue; // NULL nodes left for the missing ones.
+		}
+
+		for (size_t k = 0; k < count; k++) {
+			knot_dname_storage_t nsec3_owner;
+			int ret = knot_nsec3_hash_to_dname(nsec3_owner, sizeof(nsec3_owner),
+			                                   hashes + k * hash_len, hash_len,
+			                                   batch->zone->apex->owner);
+			batch->nsec3_nodes[hashed[k]] = (ret != KNOT_EOK) ? NULL :
+				create_nsec3_node_for_node(batch->nodes[hashed[k]], nsec3_owner,
+				                           batch->zone->apex, batch->params,
+				                           batch->ttl);
+		}
+	}
+
+	free(hashes);
+}
+
+/*!
+ * \brief Create NSEC3 nodes for the batch and insert them into the tree.
+ */
+static int nsec3_batch_flush(nsec3_batch_t *batch, zone_tree_t *nsec3_nodes,
+                             unsigned threads)
+{
+	batch->next = 0;
+	sign_pool_run(MIN(threads, 1 + batch->count / NSEC3_CHUNK_SIZE),
+	              nsec3_batch_thread, batch);
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < batch->count; i++) {
+		zone_node_t *node = batch->nsec3_nodes[i];
+		if (node == NULL) {
+			ret = KNOT_ENOMEM;
+		} else if (ret == KNOT_EOK) {
+			ret = zone_tree_insert(nsec3_nodes, &node);
+			if (ret == KNOT_EOK) {
+				continue;
+			}
+		}
+		if (node != NULL) {
+			node_free_rrsets(node, NULL);
+			node_free(node, NULL);
+		}
+	}
+	batch->count = 0;
+
+	return ret;
+}
+
 /*!
  * \brief Create NSEC3 node for each regular node in the zone.
  *
  * \param zone         Zone.
  * \param params       NSEC3 params.
  * \param ttl          TTL for the created NSEC records.
- * \param cds_in_apex  Hint to guess apex node type bitmap: false=just DNSKEY, true=DNSKEY,CDS,CDNSKEY.
+ * \param threads      Number of threads for parallel hashing.
  * \param nsec3_nodes  Tree whereto new NSEC3 nodes will be added.
  * \param update       Zone update for possible NSEC removals
  *
@@ -413,6 +563,7 @@ static int reconnect_nsec3_nodes2(zone_node_t *a, zone_node_t *b,
 static int create_nsec3_nodes(const zone_contents_t *zone,
                               const dnssec_nsec3_params_t *params,
                               uint32_t ttl,
+                              unsigned threads,
                               zone_tree_t *nsec3_nodes,
                               zone_update_t *update)
 {
@@ -420,11 +571,11 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
 	assert(nsec3_nodes);
 	assert(update);
 
-	zone_tree_delsafe_it_t it = { 0 };
-	int result = zone_tree_delsafe_it_begin(zone->nodes, &it, false); // delsafe - removing nodes that contain only NSEC+RRSIG
+	zone_tree_delsafe_it_t dit = { 0 };
+	int result = zone_tree_delsafe_it_begin(zone->nodes, &dit, false); // delsafe - removing nodes that contain only NSEC+RRSIG
 
-	while (!zone_tree_delsafe_it_finished(&it)) {
-		zone_node_t *node = zone_tree_delsafe_it_val(&it);
+	while (!zone_tree_delsafe_it_finished(&dit)) {
+		zone_node_t *node = zone_tree_delsafe_it_val(&dit);
 
 		/*!
 		 * Remove possible NSEC from the node. (Do not allow both NSEC
@@ -434,28 +585,46 @@ static int create_nsec3_nodes(const zone_contents_t *zone,
 		if (result != KNOT_EOK) {
 			break;
 		}
+
+		zone_tree_delsafe_it_next(&dit);
+	}
+
+	zone_tree_delsafe_it_free(&dit);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	nsec3_batch_t *batch = calloc(1, sizeof(*batch));
+	if (batch == NULL) {
+		return KNOT_ENOMEM;
+	}
+	batch->zone = zone;
+	batch->params = params;
+	batch->ttl = ttl;
+	// Nodes are never freed during an incremental update.
+	batch->ptrs_valid = (update->flags & UPDATE_INCREMENTAL);
+
+	zone_tree_it_t it = { 0 };
+	result = zone_tree_it_begin(zone->nodes, &it);
+	while (result == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		zone_tree_it_next(&it);
+
 		if (node->flags & NODE_FLAGS_NONAUTH || nsec3_empty(node, params) || node->flags & NODE_FLAGS_DELETED) {
-			zone_tree_delsafe_it_next(&it);
 			continue;
 		}
 
-		zone_node_t *nsec3_node;
-		nsec3_node = create_nsec3_node_for_node(node, zone->apex,
-							params, ttl);
-		if (!nsec3_node) {
-			result = KNOT_ENOMEM;
-			break;
+		batch->nodes[batch->count++] = node;
+		if (batch->count == NSEC3_BATCH_SIZE) {
+			result = nsec3_batch_flush(batch, nsec3_nodes, threads);
 		}
-
-		result = zone_tree_insert(nsec3_nodes, &nsec3_node);
-		if (result != KNOT_EOK) {
-			break;
-		}
-
-		zone_tree_delsafe_it_next(&it);
 	}
+	zone_tree_it_free(&it);
 
-	zone_tree_delsafe_it_free(&it);
+	if (result == KNOT_EOK && batch->count > 0) {
+		result = nsec3_batch_flush(batch, nsec3_nodes, threads);
+	}
+	free(batch);
 
 	return result;
 }
@@ -485,9 +654,14 @@ static int fix_nsec3_for_node(zone_update_t *update, const dnssec_nsec3_params_t
 		return KNOT_EOK;
 	}
 
+	// the old zone is adjusted, the new one may use a hash cached in the update
 	knot_dname_storage_t for_node_hashed;
-	int ret = knot_create_nsec3_owner(for_node_hashed, sizeof(for_node_hashed),
-	                                  for_node, update->new_cont->apex->owner, params);
+	int ret = (old_n != NULL) ?
+		nsec3_owner_for_node(for_node_hashed, sizeof(for_node_hashed), old_n,
+		                     update->zone->contents, params, true) :
+		nsec3_owner_for_node(for_node_hashed, sizeof(for_node_hashed), new_n,
+		                     update->new_cont, params,
+		                     (update->flags & UPDATE_INCREMENTAL));
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -515,7 +689,8 @@ static int fix_nsec3_for_node(zone_update_t *update, const dnssec_nsec3_params_t
 
 	// add NSEC3 with correct bitmap
 	if (!shall_no_nsec && ret == KNOT_EOK) {
-		zone_node_t *new_nsec3_n = create_nsec3_node_for_node(new_n, update->new_cont->apex, params, ttl);
+		zone_node_t *new_nsec3_n = create_nsec3_node_for_node(new_n, for_node_hashed,
+		                                                      update->new_cont->apex, params, ttl);
 		if (new_nsec3_n == NULL) {
 			return KNOT_ENOMEM;
 		}
@@ -625,6 +800,7 @@ int delete_nsec3_chain(zone_update_t *up)
 int knot_nsec3_create_chain(const zone_contents_t *zone,
                             const dnssec_nsec3_params_t *params,
                             uint32_t ttl,
+                            unsigned threads,
                             zone_update_t *update)
 {
 	assert(zone);
@@ -635,7 +811,7 @@ int knot_nsec3_create_chain(const zone_contents_t *zone,
 		return KNOT_ENOMEM;
 	}
 
-	int result = create_nsec3_nodes(zone, params, ttl, nsec3_nodes, update);
+	int result = create_nsec3_nodes(zone, params, ttl, threads, nsec3_nodes, update);
 	if (result != KNOT_EOK) {
 		free_nsec3_tree(nsec3_nodes);
 		return result;
@@ -657,7 +833,8 @@ int knot_nsec3_create_chain(const zone_contents_t *zone,
 
 int knot_nsec3_fix_chain(zone_update_t *update,
                          const dnssec_nsec3_params_t *params,
-                         uint32_t ttl)
+                         uint32_t ttl,
+                         unsigned threads)
 {
 	assert(update);
 	assert(params);
@@ -668,7 +845,7 @@ int knot_nsec3_fix_chain(zone_update_t *update,
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		return knot_nsec3_create_chain(update->new_cont, params, ttl, update);
+		return knot_nsec3_create_chain(update->new_cont, params, ttl, threads, update);
 	}
 
 	int ret = fix_nsec3_nodes(update, params, ttl);
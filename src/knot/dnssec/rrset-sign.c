@@ -16,6 +16,7 @@
 
 #include <assert.h>
 
+#include "contrib/openbsd/siphash.h"
 #include "contrib/wire_ctx.h"
 #include "libdnssec/error.h"
 #include "knot/dnssec/rrset-sign.h"
@@ -28,6 +29,32 @@
 
 /*- Creating of RRSIGs -------------------------------------------------------*/
 
+/*!
+ * \brief Get the expiration of a new signature of the RR set.
+ *
+ * With rrsig-jitter, the expiration is shortened by a part of the jitter
+ * determined by the owner and type, so that the signatures created at once
+ * don't expire at once, and the shift stays the same on each re-sign.
+ */
+static uint32_t sig_expiration(const knot_rrset_t *covered, const kdnssec_ctx_t *dnssec_ctx)
+{
+	uint64_t sig_expire = dnssec_ctx->now + dnssec_ctx->policy->rrsig_lifetime;
+
+	uint32_t jitter = dnssec_ctx->policy->rrsig_jitter;
+	if (jitter > 0) {
+		static const SIPHASH_KEY key = { 0 };
+		SIPHASH_CTX ctx;
+		SipHash24_Init(&ctx, &key);
+		SipHash24_Update(&ctx, covered->owner, knot_dname_size(covered->owner));
+		uint8_t type[sizeof(uint16_t)];
+		knot_wire_write_u16(type, covered->type);
+		SipHash24_Update(&ctx, type, sizeof(type));
+		sig_expire -= SipHash24_End(&ctx) % ((uint64_t)jitter + 1);
+	}
+
+	return MIN(sig_expire, UINT32_MAX);
+}
+
 /*!
  * \brief Get size of RRSIG RDATA for a given key without signature.
  */
@@ -272,13 +299,12 @@ int knot_sign_rrset(knot_rrset_t *rrsigs, const knot_rrset_t *covered,
 	}
 
 	uint32_t sig_incept = dnssec_ctx->now - RRSIG_INCEPT_IN_PAST;
-	uint64_t sig_expire = dnssec_ctx->now + dnssec_ctx->policy->rrsig_lifetime;
-	sig_expire = MIN(sig_expire, UINT32_MAX);
+	uint32_t sig_expire = sig_expiration(covered, dnssec_ctx);
 	dnssec_sign_flags_t sign_flags = dnssec_ctx->policy->reproducible_sign ?
 	                                 DNSSEC_SIGN_REPRODUCIBLE : DNSSEC_SIGN_NORMAL;
 
 	int ret = rrsigs_create_rdata(rrsigs, sign_ctx, covered, key, sig_incept,
-	                              (uint32_t)sig_expire, sign_flags, mm);
+	                              sig_expire, sign_flags, mm);
 	if (ret == KNOT_EOK && expires != NULL) {
 		*expires = knot_time_min(*expires, sig_expire);
 	}
@@ -288,25 +314,88 @@ int knot_sign_rrset(knot_rrset_t *rrsigs, const knot_rrset_t *covered,
 int knot_sign_rrset2(knot_rrset_t *rrsigs, const knot_rrset_t *rrset,
                      zone_sign_ctx_t *sign_ctx, knot_mm_t *mm)
 {
-	if (rrsigs == NULL || rrset == NULL || sign_ctx == NULL) {
+	if (rrsigs == NULL || rrset == NULL || sign_ctx == NULL ||
+	    knot_rrset_empty(rrset) || rrsigs->type != KNOT_RRTYPE_RRSIG) {
 		return KNOT_EINVAL;
 	}
 
+	const kdnssec_ctx_t *dnssec_ctx = sign_ctx->dnssec_ctx;
+	uint32_t sig_incept = dnssec_ctx->now - RRSIG_INCEPT_IN_PAST;
+	uint32_t sig_expire = sig_expiration(rrset, dnssec_ctx);
+	dnssec_sign_flags_t sign_flags = dnssec_ctx->policy->reproducible_sign ?
+	                                 DNSSEC_SIGN_REPRODUCIBLE : DNSSEC_SIGN_NORMAL;
+
+	uint8_t owner_labels = knot_dname_labels(rrset->owner, NULL);
+	if (knot_dname_is_wildcard(rrset->owner)) {
+		owner_labels -= 1;
+	}
+
+	// The covered records are converted to wire only once for all the keys.
+	uint8_t *rrwf = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	if (rrwf == NULL) {
+		return KNOT_ENOMEM;
+	}
+	int ret = knot_rrset_to_wire(rrset, rrwf, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (ret < 0) {
+		free(rrwf);
+		return ret;
+	}
+	dnssec_binary_t rrset_wire = { .data = rrwf, .size = ret };
+
+	size_t count = 0;
+	dnssec_sign_ctx_t *ctxs[sign_ctx->count];
+	size_t header_sizes[sign_ctx->count];
+	uint8_t headers[sign_ctx->count][RRSIG_RDATA_SIGNER_OFFSET + KNOT_DNAME_MAXLEN];
 	for (size_t i = 0; i < sign_ctx->count; i++) {
 		zone_key_t *key = &sign_ctx->keys[i];
-
 		if (!knot_zone_sign_use_key(key, rrset)) {
 			continue;
 		}
 
-		int ret = knot_sign_rrset(rrsigs, rrset, key->key, sign_ctx->sign_ctxs[i],
-		                          sign_ctx->dnssec_ctx, mm, NULL);
+		header_sizes[count] = rrsig_rdata_header_size(key->key);
+		ret = rrsig_write_rdata(headers[count], header_sizes[count], key->key,
+		                        rrset->type, owner_labels, rrset->ttl,
+		                        sig_incept, (uint32_t)sig_expire);
+		assert(ret == KNOT_EOK);
+
+		ctxs[count] = sign_ctx->sign_ctxs[i];
+		ret = dnssec_sign_init(ctxs[count]);
+		if (ret == KNOT_EOK) {
+			ret = sign_ctx_add_self(ctxs[count], headers[count]);
+		}
+		if (ret == KNOT_EOK) {
+			ret = dnssec_sign_add(ctxs[count], &rrset_wire);
+		}
 		if (ret != KNOT_EOK) {
+			free(rrwf);
 			return ret;
 		}
+		count++;
+	}
+	free(rrwf);
+
+	if (count == 0) {
+		return KNOT_EOK;
+	}
+
+	dnssec_binary_t signatures[count];
+	ret = dnssec_sign_write_batch(ctxs, count, sign_flags, signatures);
+	if (ret != DNSSEC_EOK) {
+		return ret;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (ret == KNOT_EOK) {
+			size_t rrsig_size = header_sizes[i] + signatures[i].size;
+			uint8_t rrsig[rrsig_size];
+			memcpy(rrsig, headers[i], header_sizes[i]);
+			memcpy(rrsig + header_sizes[i], signatures[i].data, signatures[i].size);
+			ret = knot_rrset_add_rdata(rrsigs, rrsig, rrsig_size, mm);
+		}
+		dnssec_binary_free(&signatures[i]);
 	}
 
-	return KNOT_EOK;
+	return ret;
 }
 
 int knot_synth_rrsig(uint16_t type, const knot_rdataset_t *rrsig_rrs,
@@ -394,6 +483,15 @@ int knot_check_signature(const knot_rrset_t *covered,
 		return KNOT_EINVAL;
 	}
 
+	// check if already validated before
+
+	uint8_t digest[VALID_CACHE_DIGEST_SIZE];
+	bool cacheable = dnssec_ctx->valid_cache != NULL &&
+	                 valid_cache_digest(key, rrsig, covered, digest) == KNOT_EOK;
+	if (cacheable && valid_cache_lookup(dnssec_ctx->valid_cache, digest)) {
+		return KNOT_EOK;
+	}
+
 	// perform the validation
 
 	int result = dnssec_sign_init(sign_ctx);
@@ -410,5 +508,11 @@ int knot_check_signature(const knot_rrset_t *covered,
 				dnssec_ctx->policy->algorithm,
 				dnssec_ctx->policy->reproducible_sign);
 
-	return dnssec_sign_verify(sign_ctx, sign_cmp, &signature);
+	result = dnssec_sign_verify(sign_ctx, sign_cmp, &signature);
+	if (result == KNOT_EOK && cacheable) {
+		valid_cache_insert(dnssec_ctx->valid_cache, digest,
+		                   knot_rrsig_sig_expiration(rrsig));
+	}
+
+	return result;
 }
@@ -0,0 +1,191 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/openbsd/siphash.h"
+#include "knot/dnssec/sig-cache.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+
+#define SHARDS 64
+
+typedef struct {
+	uint64_t hash;
+	uint32_t generation;
+	uint32_t ttl;
+	uint32_t expire;         // Earliest expiration of the signatures.
+	uint16_t type;
+	knot_dname_t *owner;     // NULL if the entry is empty.
+	knot_rdataset_t covered;
+	knot_rdataset_t rrsigs;
+} sig_entry_t;
+
+struct sig_cache {
+	SIPHASH_KEY key;
+	size_t mask;
+	pthread_mutex_t locks[SHARDS];
+	sig_entry_t *entries;
+};
+
+static void entry_clear(sig_entry_t *entry)
+{
+	knot_dname_free(entry->owner, NULL);
+	knot_rdataset_clear(&entry->covered, NULL);
+	knot_rdataset_clear(&entry->rrsigs, NULL);
+	memset(entry, 0, sizeof(*entry));
+}
+
+sig_cache_t *sig_cache_new(size_t size)
+{
+	if (size == 0) {
+		return NULL;
+	}
+
+	size_t count = 1;
+	while (count < size) {
+		count <<= 1;
+	}
+
+	sig_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->entries = calloc(count, sizeof(sig_entry_t));
+	if (cache->entries == NULL ||
+	    dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		free(cache->entries);
+		free(cache);
+		return NULL;
+	}
+	cache->mask = count - 1;
+
+	for (unsigned i = 0; i < SHARDS; i++) {
+		pthread_mutex_init(&cache->locks[i], NULL);
+	}
+
+	return cache;
+}
+
+void sig_cache_free(sig_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i <= cache->mask; i++) {
+		entry_clear(&cache->entries[i]);
+	}
+	for (unsigned i = 0; i < SHARDS; i++) {
+		pthread_mutex_destroy(&cache->locks[i]);
+	}
+	free(cache->entries);
+	free(cache);
+}
+
+static uint64_t rrset_hash(const sig_cache_t *cache, const knot_rrset_t *rrset)
+{
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache->key);
+	SipHash24_Update(&ctx, rrset->owner, knot_dname_size(rrset->owner));
+	SipHash24_Update(&ctx, &rrset->type, sizeof(rrset->type));
+	SipHash24_Update(&ctx, &rrset->ttl, sizeof(rrset->ttl));
+	SipHash24_Update(&ctx, rrset->rrs.rdata, rrset->rrs.size);
+	return SipHash24_End(&ctx);
+}
+
+static bool entry_match(const sig_entry_t *entry, const knot_rrset_t *rrset,
+                        uint64_t hash, uint32_t generation)
+{
+	return entry->owner != NULL &&
+	       entry->hash == hash &&
+	       entry->generation == generation &&
+	       entry->type == rrset->type &&
+	       entry->ttl == rrset->ttl &&
+	       knot_dname_is_equal(entry->owner, rrset->owner) &&
+	       knot_rdataset_eq(&entry->covered, &rrset->rrs);
+}
+
+int sig_cache_get(sig_cache_t *cache, const knot_rrset_t *covered,
+                  uint32_t generation, knot_time_t valid_till,
+                  knot_rrset_t *rrsig, knot_mm_t *mm)
+{
+	if (cache == NULL || covered == NULL || rrsig == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint64_t hash = rrset_hash(cache, covered);
+	size_t idx = hash & cache->mask;
+	sig_entry_t *entry = &cache->entries[idx];
+
+	int ret = KNOT_ENOENT;
+	pthread_mutex_t *lock = &cache->locks[idx % SHARDS];
+	pthread_mutex_lock(lock);
+	if (entry_match(entry, covered, hash, generation) &&
+	    knot_time_cmp(entry->expire, valid_till) > 0) {
+		ret = knot_rdataset_merge(&rrsig->rrs, &entry->rrsigs, mm);
+	}
+	pthread_mutex_unlock(lock);
+
+	return ret;
+}
+
+void sig_cache_put(sig_cache_t *cache, const knot_rrset_t *covered,
+                   uint32_t generation, const knot_rrset_t *rrsig)
+{
+	if (cache == NULL || covered == NULL || knot_rrset_empty(rrsig)) {
+		return;
+	}
+
+	// Prepare the new entry outside of the lock.
+	sig_entry_t new = {
+		.hash = rrset_hash(cache, covered),
+		.generation = generation,
+		.ttl = covered->ttl,
+		.expire = UINT32_MAX,
+		.type = covered->type,
+		.owner = knot_dname_copy(covered->owner, NULL),
+	};
+	if (new.owner == NULL ||
+	    knot_rdataset_copy(&new.covered, &covered->rrs, NULL) != KNOT_EOK ||
+	    knot_rdataset_copy(&new.rrsigs, &rrsig->rrs, NULL) != KNOT_EOK) {
+		entry_clear(&new);
+		return;
+	}
+	knot_rdata_t *rr = new.rrsigs.rdata;
+	for (uint16_t i = 0; i < new.rrsigs.count; i++) {
+		uint32_t expire = knot_rrsig_sig_expiration(rr);
+		if (expire < new.expire) {
+			new.expire = expire;
+		}
+		rr = knot_rdataset_next(rr);
+	}
+
+	size_t idx = new.hash & cache->mask;
+	sig_entry_t old;
+
+	pthread_mutex_t *lock = &cache->locks[idx % SHARDS];
+	pthread_mutex_lock(lock);
+	old = cache->entries[idx];
+	cache->entries[idx] = new;
+	pthread_mutex_unlock(lock);
+
+	entry_clear(&old);
+}
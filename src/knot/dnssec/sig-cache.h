@@ -0,0 +1,76 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Bounded in-memory cache of computed RRSIGs.
+ *
+ * The signatures are identified by the owner, type, TTL and RDATA of the
+ * covered RRSet and by the generation of the signing keys. The cache is
+ * direct-mapped and split into shards with a lock of their own, so it can be
+ * shared by all the answering threads. A colliding entry is just replaced.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "contrib/time.h"
+#include "libknot/rrset.h"
+
+typedef struct sig_cache sig_cache_t;
+
+/*!
+ * \brief Creates a new signature cache.
+ *
+ * \param size  Number of cache entries (rounded up to a power of two).
+ *
+ * \return Signature cache or NULL if error.
+ */
+sig_cache_t *sig_cache_new(size_t size);
+
+/*!
+ * \brief Deallocates the signature cache (NULL is ignored).
+ */
+void sig_cache_free(sig_cache_t *cache);
+
+/*!
+ * \brief Looks up the signatures of an RRSet.
+ *
+ * \param cache       Signature cache.
+ * \param covered     Covered RRSet with the signed owner name.
+ * \param generation  Generation of the signing keys.
+ * \param valid_till  Minimal required expiration of the signatures.
+ * \param rrsig       Output RRSIG RRSet to add the signatures to.
+ * \param mm          Memory context for the output RDATA.
+ *
+ * \retval KNOT_EOK if found.
+ * \retval KNOT_ENOENT if not found or expiring.
+ * \return KNOT_E* on error.
+ */
+int sig_cache_get(sig_cache_t *cache, const knot_rrset_t *covered,
+                  uint32_t generation, knot_time_t valid_till,
+                  knot_rrset_t *rrsig, knot_mm_t *mm);
+
+/*!
+ * \brief Stores the signatures of an RRSet.
+ *
+ * \param cache       Signature cache.
+ * \param covered     Covered RRSet with the signed owner name.
+ * \param generation  Generation of the signing keys.
+ * \param rrsig       Signatures of the RRSet.
+ */
+void sig_cache_put(sig_cache_t *cache, const knot_rrset_t *covered,
+                   uint32_t generation, const knot_rrset_t *rrsig);
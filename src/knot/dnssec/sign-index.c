@@ -0,0 +1,418 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/dnssec/sign-index.h"
+#include "knot/zone/zone.h"
+#include "libknot/libknot.h"
+#include "contrib/qp-trie/trie.h"
+
+#define BUCKET_SECS	3600
+
+// Bucket (4B), tree (1B, NSEC3 or not), owner (LF).
+#define KEY_MAXLEN	(sizeof(uint32_t) + 1 + KNOT_DNAME_MAXLEN)
+#define OWNER_OFFS	sizeof(uint32_t)
+
+struct zone_sign_index {
+	pthread_mutex_t lock;
+	const zone_contents_t *contents; // Contents the index corresponds to.
+	bool rebuild;                    // All nodes of the contents to be indexed.
+	uint8_t *setup;                  // Keys and flags of the last signing of all nodes.
+	size_t setup_len;
+	trie_t *by_time;                 // Bucket + tree + owner -> NULL.
+	trie_t *by_owner;                // Tree + owner -> bucket.
+};
+
+static void index_clear(zone_sign_index_t *index)
+{
+	trie_clear(index->by_time);
+	trie_clear(index->by_owner);
+	free(index->setup);
+	index->setup = NULL;
+	index->setup_len = 0;
+	index->contents = NULL;
+	index->rebuild = false;
+}
+
+static uint8_t *setup_get(const zone_keyset_t *zone_keys, const kdnssec_ctx_t *dnssec_ctx,
+                          size_t *len)
+{
+	*len = 1 + 4 * zone_keys->count;
+	uint8_t *setup = malloc(*len);
+	if (setup == NULL) {
+		return NULL;
+	}
+
+	uint8_t *pos = setup;
+	*pos++ = dnssec_ctx->keytag_conflict | (dnssec_ctx->policy->offline_ksk << 1);
+	for (size_t i = 0; i < zone_keys->count; i++) {
+		const zone_key_t *key = &zone_keys->keys[i];
+		knot_wire_write_u16(pos, dnssec_key_get_keytag(key->key));
+		pos[2] = dnssec_key_get_algorithm(key->key);
+		pos[3] = key->is_ksk | (key->is_zsk << 1) | (key->is_active << 2) |
+		         (key->is_ksk_active_plus << 3) | (key->is_zsk_active_plus << 4);
+		pos += 4;
+	}
+
+	return setup;
+}
+
+static knot_time_t node_expiration(const zone_node_t *node)
+{
+	knot_time_t expire = 0;
+
+	knot_rdataset_t *rrsigs = node_rdataset(node, KNOT_RRTYPE_RRSIG);
+	if (rrsigs != NULL) {
+		knot_rdata_t *rr = rrsigs->rdata;
+		for (uint16_t i = 0; i < rrsigs->count; i++) {
+			uint32_t expiration = knot_rrsig_sig_expiration(rr);
+			expire = knot_time_min(expire, knot_time_from_u32(expiration));
+			rr = knot_rdataset_next(rr);
+		}
+	}
+
+	return expire;
+}
+
+static int index_node(zone_sign_index_t *index, const zone_node_t *node, bool nsec3)
+{
+	uint8_t key[KEY_MAXLEN];
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(node->owner, lf_storage);
+	uint8_t *owner = key + OWNER_OFFS;
+	size_t owner_len = 1 + *lf;
+	owner[0] = nsec3;
+	memcpy(owner + 1, lf + 1, *lf);
+
+	trie_val_t *val = trie_get_try(index->by_owner, owner, owner_len);
+	if (val != NULL) {
+		knot_wire_write_u32(key, (uintptr_t)*val);
+		(void)trie_del(index->by_time, key, OWNER_OFFS + owner_len, NULL);
+	}
+
+	knot_time_t expire = node_expiration(node);
+	if (expire == 0) {
+		if (val != NULL) {
+			(void)trie_del(index->by_owner, owner, owner_len, NULL);
+		}
+		return KNOT_EOK;
+	}
+
+	uint32_t bucket = expire / BUCKET_SECS;
+	knot_wire_write_u32(key, bucket);
+	if (val == NULL) {
+		val = trie_get_ins(index->by_owner, owner, owner_len);
+	}
+	trie_val_t *tval = trie_get_ins(index->by_time, key, OWNER_OFFS + owner_len);
+	if (val == NULL || tval == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*val = (void *)(uintptr_t)bucket;
+	*tval = NULL;
+
+	return KNOT_EOK;
+}
+
+static int index_tree(zone_sign_index_t *index, zone_tree_t *tree, bool nsec3)
+{
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin(tree, &it);
+	while (ret == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		ret = index_node(index, zone_tree_it_val(&it), nsec3);
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+
+	return ret;
+}
+
+static int copy_tree(zone_tree_t *to, zone_tree_t *from)
+{
+	if (zone_tree_is_empty(from)) {
+		return KNOT_EOK;
+	}
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin(from, &it);
+	while (ret == KNOT_EOK && !zone_tree_it_finished(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		ret = zone_tree_insert(to, &node);
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+
+	return ret;
+}
+
+static zone_tree_t *tree_like(const zone_tree_t *tree)
+{
+	zone_tree_t *res = zone_tree_create(true);
+	if (res != NULL) {
+		res->flags = tree->flags;
+	}
+	return res;
+}
+
+static int collect_due(zone_sign_index_t *index, zone_update_t *update, uint32_t until,
+                       zone_tree_t *nodes, zone_tree_t *nsec3_nodes, knot_time_t *next)
+{
+	zone_contents_t *contents = update->new_cont;
+
+	int ret = copy_tree(nodes, update->a_ctx->node_ptrs);
+	if (ret == KNOT_EOK) {
+		ret = copy_tree(nsec3_nodes, update->a_ctx->nsec3_ptrs);
+	}
+	if (ret == KNOT_EOK) {
+		zone_node_t *apex = contents->apex;
+		ret = zone_tree_insert(nodes, &apex);
+	}
+	if (ret != KNOT_EOK || trie_weight(index->by_time) == 0) {
+		return ret;
+	}
+
+	trie_it_t *it = trie_it_begin(index->by_time);
+	if (it == NULL) {
+		return KNOT_ENOMEM;
+	}
+	for (; ret == KNOT_EOK && !trie_it_finished(it); trie_it_next(it)) {
+		size_t len = 0;
+		const uint8_t *key = (const uint8_t *)trie_it_key(it, &len);
+		uint32_t bucket = knot_wire_read_u32(key);
+		if (bucket > until) {
+			*next = (knot_time_t)bucket * BUCKET_SECS;
+			break;
+		}
+
+		// Removed nodes are dropped from the index with the update.
+		bool nsec3 = key[OWNER_OFFS];
+		zone_tree_t *tree = nsec3 ? contents->nsec3_nodes : contents->nodes;
+		trie_val_t *val = zone_tree_is_empty(tree) ? NULL :
+		                  trie_get_try(tree->trie, key + OWNER_OFFS + 1,
+		                               len - OWNER_OFFS - 1);
+		if (val != NULL) {
+			zone_node_t *node = zone_tree_fix_get(*val, tree);
+			ret = zone_tree_insert(nsec3 ? nsec3_nodes : nodes, &node);
+		}
+	}
+	trie_it_free(it);
+
+	return ret;
+}
+
+zone_sign_index_t *zone_sign_index_new(void)
+{
+	zone_sign_index_t *index = calloc(1, sizeof(*index));
+	if (index == NULL) {
+		return NULL;
+	}
+
+	index->by_time = trie_create(NULL);
+	index->by_owner = trie_create(NULL);
+	if (index->by_time == NULL || index->by_owner == NULL) {
+		trie_free(index->by_time);
+		trie_free(index->by_owner);
+		free(index);
+		return NULL;
+	}
+	pthread_mutex_init(&index->lock, NULL);
+
+	return index;
+}
+
+void zone_sign_index_free(zone_sign_index_t *index)
+{
+	if (index == NULL) {
+		return;
+	}
+
+	index_clear(index);
+	trie_free(index->by_time);
+	trie_free(index->by_owner);
+	pthread_mutex_destroy(&index->lock);
+	free(index);
+}
+
+void zone_sign_index_switch(zone_sign_index_t *index, const zone_contents_t *contents)
+{
+	if (index == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&index->lock);
+	if (index->contents != contents) {
+		index_clear(index);
+	}
+	pthread_mutex_unlock(&index->lock);
+}
+
+void zone_sign_index_discard(zone_sign_index_t *index, const zone_contents_t *contents)
+{
+	if (index == NULL || contents == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&index->lock);
+	if (index->contents == contents) {
+		index_clear(index);
+	}
+	pthread_mutex_unlock(&index->lock);
+}
+
+void zone_sign_index_begin(zone_update_t *update)
+{
+	zone_sign_index_t *index = update->zone->sign_index;
+	if (index == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&index->lock);
+	if (index->contents != update->new_cont) {
+		bool follow = (update->flags & UPDATE_INCREMENTAL) && !index->rebuild &&
+		              index->contents != NULL &&
+		              index->contents == update->zone->contents;
+		if (!follow) {
+			index_clear(index);
+			index->rebuild = true;
+		}
+		index->contents = update->new_cont;
+	}
+	pthread_mutex_unlock(&index->lock);
+}
+
+int zone_sign_index_due(zone_update_t *update, const zone_keyset_t *zone_keys,
+                        const kdnssec_ctx_t *dnssec_ctx, zone_tree_t **nodes,
+                        zone_tree_t **nsec3_nodes, knot_time_t *next)
+{
+	zone_sign_index_t *index = update->zone->sign_index;
+	if (index == NULL || !(update->flags & UPDATE_INCREMENTAL)) {
+		return KNOT_ENOENT;
+	}
+
+	size_t setup_len = 0;
+	uint8_t *setup = setup_get(zone_keys, dnssec_ctx, &setup_len);
+	if (setup == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	pthread_mutex_lock(&index->lock);
+	if (index->contents != update->new_cont || index->rebuild ||
+	    index->setup_len != setup_len || memcmp(index->setup, setup, setup_len) != 0) {
+		pthread_mutex_unlock(&index->lock);
+		free(setup);
+		return KNOT_ENOENT;
+	}
+	free(setup);
+
+	zone_contents_t *contents = update->new_cont;
+	*nodes = tree_like(contents->nodes);
+	*nsec3_nodes = tree_like(contents->nsec3_nodes != NULL ? contents->nsec3_nodes :
+	                                                         contents->nodes);
+	*next = 0;
+
+	// The same condition as for the RRSIG refresh in add_missing_rrsigs().
+	knot_timediff_t refresh = (knot_timediff_t)dnssec_ctx->policy->rrsig_refresh_before +
+	                          dnssec_ctx->policy->rrsig_prerefresh;
+	knot_time_t until = knot_time_add(dnssec_ctx->now, refresh);
+	int ret = (*nodes == NULL || *nsec3_nodes == NULL) ? KNOT_ENOMEM :
+	          collect_due(index, update, until / BUCKET_SECS, *nodes, *nsec3_nodes, next);
+	pthread_mutex_unlock(&index->lock);
+
+	if (ret != KNOT_EOK) {
+		zone_tree_free(nodes);
+		zone_tree_free(nsec3_nodes);
+	}
+	return ret;
+}
+
+void zone_sign_index_signed(zone_update_t *update, const zone_keyset_t *zone_keys,
+                            const kdnssec_ctx_t *dnssec_ctx, zone_tree_t *nodes,
+                            zone_tree_t *nsec3_nodes)
+{
+	zone_sign_index_t *index = update->zone->sign_index;
+	if (index == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&index->lock);
+	if (index->contents != update->new_cont) {
+		pthread_mutex_unlock(&index->lock);
+		return;
+	}
+
+	int ret = KNOT_EOK;
+	if (nodes == NULL) {
+		// All nodes signed with these keys, the index can be used further.
+		free(index->setup);
+		index->setup = setup_get(zone_keys, dnssec_ctx, &index->setup_len);
+		if (index->setup == NULL) {
+			index->setup_len = 0;
+		}
+	} else {
+		// The visited nodes without new RRSIGs move to their actual bucket.
+		ret = index_tree(index, nodes, false);
+		if (ret == KNOT_EOK) {
+			ret = index_tree(index, nsec3_nodes, true);
+		}
+	}
+	if (ret != KNOT_EOK) {
+		index_clear(index);
+	}
+	pthread_mutex_unlock(&index->lock);
+}
+
+void zone_sign_index_finish(zone_update_t *update)
+{
+	zone_sign_index_t *index = update->zone->sign_index;
+	if (index == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&index->lock);
+	if (index->contents != update->new_cont) {
+		pthread_mutex_unlock(&index->lock);
+		return;
+	}
+
+	int ret;
+	if (index->rebuild) {
+		ret = index_tree(index, update->new_cont->nodes, false);
+		if (ret == KNOT_EOK) {
+			ret = index_tree(index, update->new_cont->nsec3_nodes, true);
+		}
+		index->rebuild = false;
+	} else {
+		ret = index_tree(index, update->a_ctx->node_ptrs, false);
+		if (ret == KNOT_EOK) {
+			ret = index_tree(index, update->a_ctx->nsec3_ptrs, true);
+		}
+	}
+
+	if (ret != KNOT_EOK) {
+		index_clear(index);
+	} else if ((update->flags & UPDATE_INCREMENTAL) && zone_update_no_change(update)) {
+		// Such an update isn't committed, the contents stay the same.
+		index->contents = update->zone->contents;
+	}
+	pthread_mutex_unlock(&index->lock);
+}
@@ -0,0 +1,102 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Index of the zone nodes by the earliest expiration of their RRSIGs.
+ *
+ * The index allows the periodic re-signing to visit only the nodes with
+ * RRSIGs about to expire, instead of the whole zone. The expirations are
+ * kept in buckets of an hour. Like the ZONEMD cache, the index corresponds to
+ * particular zone contents and it's emptied (and rebuilt by the next signing)
+ * whenever the zone changes without being signed.
+ */
+
+#pragma once
+
+#include "knot/dnssec/context.h"
+#include "knot/dnssec/zone-keys.h"
+#include "knot/updates/zone-update.h"
+
+typedef struct zone_sign_index zone_sign_index_t;
+
+/*!
+ * \brief Allocate an empty index.
+ *
+ * \return Index or NULL if error.
+ */
+zone_sign_index_t *zone_sign_index_new(void);
+
+/*!
+ * \brief Free the index.
+ */
+void zone_sign_index_free(zone_sign_index_t *index);
+
+/*!
+ * \brief Keep the index only if it corresponds to the new zone contents.
+ */
+void zone_sign_index_switch(zone_sign_index_t *index, const zone_contents_t *contents);
+
+/*!
+ * \brief Empty the index if it corresponds to the discarded zone contents.
+ */
+void zone_sign_index_discard(zone_sign_index_t *index, const zone_contents_t *contents);
+
+/*!
+ * \brief Make the index follow the update being signed.
+ *
+ * The index is carried over if the update is incremental and the index
+ * corresponds to the current zone contents, otherwise it's to be rebuilt.
+ */
+void zone_sign_index_begin(zone_update_t *update);
+
+/*!
+ * \brief Get the nodes to be visited by re-signing.
+ *
+ * These are the nodes with RRSIGs expiring sooner than the refresh interval,
+ * the nodes changed by the update, and the apex.
+ *
+ * \param update       Zone update being signed.
+ * \param zone_keys    Signing keys.
+ * \param dnssec_ctx   DNSSEC context.
+ * \param nodes        Out: nodes to be visited (to be freed).
+ * \param nsec3_nodes  Out: NSEC3 nodes to be visited (to be freed).
+ * \param next         Out: Earliest expiration of the other nodes (approximate).
+ *
+ * \retval KNOT_ENOENT  The whole zone must be visited.
+ * \return KNOT_E*
+ */
+int zone_sign_index_due(zone_update_t *update, const zone_keyset_t *zone_keys,
+                        const kdnssec_ctx_t *dnssec_ctx, zone_tree_t **nodes,
+                        zone_tree_t **nsec3_nodes, knot_time_t *next);
+
+/*!
+ * \brief Note the visited nodes after successful signing.
+ *
+ * \param update       Zone update being signed.
+ * \param zone_keys    Signing keys.
+ * \param dnssec_ctx   DNSSEC context.
+ * \param nodes        Nodes from zone_sign_index_due(), NULL if whole zone visited.
+ * \param nsec3_nodes  NSEC3 nodes from zone_sign_index_due().
+ */
+void zone_sign_index_signed(zone_update_t *update, const zone_keyset_t *zone_keys,
+                            const kdnssec_ctx_t *dnssec_ctx, zone_tree_t *nodes,
+                            zone_tree_t *nsec3_nodes);
+
+/*!
+ * \brief Index the nodes changed by successfully signed update.
+ */
+void zone_sign_index_finish(zone_update_t *update);
@@ -0,0 +1,233 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contrib/time.h"
+#include "contrib/ucw/lists.h"
+#include "knot/dnssec/sign-pool.h"
+#include "knot/worker/isolation.h"
+#include "libknot/attribute.h"
+
+/*! \brief Time the signing may run ahead of the rate limit (in microseconds). */
+#define THROTTLE_BURST_USEC	100000
+
+typedef struct {
+	node_t n;
+	sign_pool_job_t job;
+	void *ctx;
+	unsigned next_index;   // Index for the next participant.
+	unsigned pending;      // Number of participants still wanted.
+	unsigned active;       // Number of running participants.
+	pthread_cond_t done;
+} pool_job_t;
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	list_t jobs;           // Jobs wanting more participants.
+	pthread_t *threads;
+	unsigned count;
+	bool init;
+	bool terminate;
+	uint64_t signatures;
+	uint64_t rate;
+	uint64_t rate_limit;   // Signatures per second, 0 if unlimited.
+	uint64_t next_usec;    // Earliest time of the next signature within the limit.
+} pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+};
+
+static void *helper_main(_unused_ void *arg)
+{
+	pthread_mutex_lock(&pool.lock);
+	while (true) {
+		while (!pool.terminate && EMPTY_LIST(pool.jobs)) {
+			pthread_cond_wait(&pool.wake, &pool.lock);
+		}
+		if (pool.terminate) {
+			break;
+		}
+
+		pool_job_t *job = HEAD(pool.jobs);
+		unsigned index = job->next_index++;
+		job->active++;
+		if (--job->pending == 0) {
+			rem_node(&job->n);
+		}
+		pthread_mutex_unlock(&pool.lock);
+
+		worker_isolation_apply();
+		job->job(job->ctx, index);
+
+		pthread_mutex_lock(&pool.lock);
+		if (--job->active == 0) {
+			pthread_cond_signal(&job->done);
+		}
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	return NULL;
+}
+
+/*! \brief Adds helper threads up to the given count, pool must be locked. */
+static void pool_grow(unsigned count)
+{
+	if (!pool.init) {
+		init_list(&pool.jobs);
+		pool.init = true;
+	}
+
+	if (count <= pool.count) {
+		return;
+	}
+
+	pthread_t *threads = realloc(pool.threads, count * sizeof(*threads));
+	if (threads == NULL) {
+		return;
+	}
+	pool.threads = threads;
+
+	/* Helpers mustn't receive the server signals. */
+	sigset_t all, orig;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &orig);
+
+	while (pool.count < count) {
+		if (pthread_create(&pool.threads[pool.count], NULL, helper_main, NULL) != 0) {
+			break; // Use the already running threads.
+		}
+		pool.count++;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &orig, NULL);
+}
+
+void sign_pool_run(unsigned threads, sign_pool_job_t job, void *ctx)
+{
+	if (threads <= 1) {
+		job(ctx, 0);
+		return;
+	}
+
+	pool_job_t pjob = {
+		.job = job,
+		.ctx = ctx,
+		.next_index = 1,
+		.pending = threads - 1,
+		.active = 1,
+	};
+	pthread_cond_init(&pjob.done, NULL);
+
+	pthread_mutex_lock(&pool.lock);
+	pool_grow(threads - 1);
+	add_tail(&pool.jobs, &pjob.n);
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	job(ctx, 0);
+
+	pthread_mutex_lock(&pool.lock);
+	if (pjob.pending > 0) {
+		// No more participants needed, the work is already distributed.
+		rem_node(&pjob.n);
+		pjob.pending = 0;
+	}
+	pjob.active--;
+	while (pjob.active > 0) {
+		pthread_cond_wait(&pjob.done, &pool.lock);
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	pthread_cond_destroy(&pjob.done);
+}
+
+void sign_pool_deinit(void)
+{
+	pthread_mutex_lock(&pool.lock);
+	pool.terminate = true;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (unsigned i = 0; i < pool.count; i++) {
+		pthread_join(pool.threads[i], NULL);
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	free(pool.threads);
+	pool.threads = NULL;
+	pool.count = 0;
+	pool.terminate = false;
+	pthread_mutex_unlock(&pool.lock);
+}
+
+void sign_pool_stats_add(uint64_t count, uint64_t usecs)
+{
+	if (count == 0) {
+		return;
+	}
+
+	__atomic_add_fetch(&pool.signatures, count, __ATOMIC_RELAXED);
+	uint64_t rate = count * 1000000 / (usecs > 0 ? usecs : 1);
+	__atomic_store_n(&pool.rate, rate, __ATOMIC_RELAXED);
+}
+
+uint64_t sign_pool_signatures(void)
+{
+	return __atomic_load_n(&pool.signatures, __ATOMIC_RELAXED);
+}
+
+uint64_t sign_pool_rate(void)
+{
+	return __atomic_load_n(&pool.rate, __ATOMIC_RELAXED);
+}
+
+void sign_pool_set_rate_limit(uint64_t rate)
+{
+	__atomic_store_n(&pool.rate_limit, rate, __ATOMIC_RELAXED);
+}
+
+void sign_pool_throttle(uint64_t signatures)
+{
+	uint64_t limit = __atomic_load_n(&pool.rate_limit, __ATOMIC_RELAXED);
+	if (limit == 0 || signatures == 0) {
+		return;
+	}
+
+	struct timespec ts = time_now();
+	uint64_t now = ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	// The shared schedule of the signatures of all the signing threads.
+	pthread_mutex_lock(&pool.lock);
+	uint64_t start = (pool.next_usec > now) ? pool.next_usec : now;
+	pool.next_usec = start + signatures * 1000000 / limit;
+	uint64_t wait = (pool.next_usec > now + THROTTLE_BURST_USEC) ?
+	                pool.next_usec - now - THROTTLE_BURST_USEC : 0;
+	pthread_mutex_unlock(&pool.lock);
+
+	if (wait > 0) {
+		struct timespec delay = {
+			.tv_sec = wait / 1000000,
+			.tv_nsec = (wait % 1000000) * 1000
+		};
+		(void)nanosleep(&delay, NULL);
+	}
+}
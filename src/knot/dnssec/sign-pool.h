@@ -0,0 +1,84 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Persistent helper threads for parallel zone signing and adjusting.
+ *
+ * The helper threads are created on demand and kept for later signing runs.
+ * The calling thread always participates in its own job, so a job finishes
+ * even if all the helpers are busy with jobs of other zones.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*!
+ * \brief Job callback run by each participating thread.
+ *
+ * \param ctx    Job context.
+ * \param index  Unique participant index, lower than the requested thread count.
+ */
+typedef void (*sign_pool_job_t)(void *ctx, unsigned index);
+
+/*!
+ * \brief Runs the job in up to the given number of threads and waits for it.
+ *
+ * The calling thread runs the job with index 0. Not all indices are
+ * necessarily used, thus the job must distribute the work dynamically.
+ *
+ * \param threads  Maximum number of participating threads (including the caller).
+ * \param job      Job callback.
+ * \param ctx      Job context.
+ */
+void sign_pool_run(unsigned threads, sign_pool_job_t job, void *ctx);
+
+/*!
+ * \brief Stops and joins all the helper threads.
+ */
+void sign_pool_deinit(void);
+
+/*!
+ * \brief Accounts signatures created within one signing run.
+ *
+ * \param count  Number of created signatures.
+ * \param usecs  Duration of the signing run in microseconds.
+ */
+void sign_pool_stats_add(uint64_t count, uint64_t usecs);
+
+/*!
+ * \brief Returns the total number of signatures created by zone signing.
+ */
+uint64_t sign_pool_signatures(void);
+
+/*!
+ * \brief Returns the signing rate (signatures per second) of the last signing run.
+ */
+uint64_t sign_pool_rate(void);
+
+/*!
+ * \brief Sets the limit of the signing rate of all the signing threads.
+ *
+ * \param rate  Signatures per second, 0 for no limit.
+ */
+void sign_pool_set_rate_limit(uint64_t rate);
+
+/*!
+ * \brief Accounts the created signatures and sleeps if the rate limit is exceeded.
+ *
+ * \param signatures  Number of the signatures created since the last call.
+ */
+void sign_pool_throttle(uint64_t signatures);
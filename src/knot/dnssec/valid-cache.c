@@ -0,0 +1,192 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/dnssec/valid-cache.h"
+#include "contrib/qp-trie/trie.h"
+#include "knot/dnssec/kasp/kasp_db.h"
+#include "libdnssec/digest.h"
+#include "libdnssec/error.h"
+#include "libknot/libknot.h"
+
+#define DIGEST_ALG DNSSEC_DIGEST_SHA384
+
+struct valid_cache {
+	knot_lmdb_db_t *db;
+	knot_dname_t *zone;
+	trie_t *known;          // Loaded digests, the value is NULLed once looked up.
+	trie_t *fresh;          // Newly validated digests with expirations.
+	pthread_mutex_t fresh_lock;
+};
+
+valid_cache_t *valid_cache_load(knot_lmdb_db_t *db, const knot_dname_t *zone)
+{
+	if (db == NULL || zone == NULL || knot_lmdb_open(db) != KNOT_EOK) {
+		return NULL;
+	}
+
+	valid_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->db = db;
+	cache->zone = knot_dname_copy(zone, NULL);
+	cache->known = trie_create(NULL);
+	cache->fresh = trie_create(NULL);
+	pthread_mutex_init(&cache->fresh_lock, NULL);
+	if (cache->zone == NULL || cache->known == NULL || cache->fresh == NULL ||
+	    kasp_db_load_rrsig_valid(db, zone, cache->known) != KNOT_EOK) {
+		valid_cache_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+int valid_cache_digest(const dnssec_key_t *key, const knot_rdata_t *rrsig,
+                       const knot_rrset_t *covered, uint8_t *digest)
+{
+	if (key == NULL || rrsig == NULL || knot_rrset_empty(covered) || digest == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t *rrwf = malloc(KNOT_WIRE_MAX_PKTSIZE);
+	if (rrwf == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int written = knot_rrset_to_wire(covered, rrwf, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (written < 0) {
+		free(rrwf);
+		return written;
+	}
+
+	dnssec_binary_t parts[3] = {
+		{ .data = (uint8_t *)rrsig->data, .size = rrsig->len },
+		{ .data = rrwf, .size = written },
+	};
+	int ret = dnssec_key_get_rdata(key, &parts[2]);
+	if (ret != DNSSEC_EOK) {
+		free(rrwf);
+		return knot_error_from_libdnssec(ret);
+	}
+
+	dnssec_digest_ctx_t *ctx = NULL;
+	ret = dnssec_digest_init(DIGEST_ALG, &ctx);
+	for (int i = 0; i < 3 && ret == DNSSEC_EOK; i++) {
+		ret = dnssec_digest(ctx, &parts[i]);
+	}
+	free(rrwf);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	dnssec_binary_t out = { 0 };
+	ret = dnssec_digest_finish(ctx, &out);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+	assert(out.size == VALID_CACHE_DIGEST_SIZE);
+	memcpy(digest, out.data, VALID_CACHE_DIGEST_SIZE);
+	dnssec_binary_free(&out);
+
+	return KNOT_EOK;
+}
+
+bool valid_cache_lookup(valid_cache_t *cache, const uint8_t *digest)
+{
+	if (cache == NULL || digest == NULL) {
+		return false;
+	}
+
+	// The known digests aren't modified until saved, so no locking needed.
+	trie_val_t *val = trie_get_try(cache->known, digest, VALID_CACHE_DIGEST_SIZE);
+	if (val == NULL) {
+		return false;
+	}
+	__atomic_store_n(val, NULL, __ATOMIC_RELAXED);
+
+	return true;
+}
+
+void valid_cache_insert(valid_cache_t *cache, const uint8_t *digest, uint32_t expire)
+{
+	if (cache == NULL || digest == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->fresh_lock);
+	trie_val_t *val = trie_get_ins(cache->fresh, digest, VALID_CACHE_DIGEST_SIZE);
+	if (val != NULL) {
+		*val = (void *)(uintptr_t)expire;
+	}
+	pthread_mutex_unlock(&cache->fresh_lock);
+}
+
+int valid_cache_save(valid_cache_t *cache, bool prune)
+{
+	if (cache == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	trie_t *stale = NULL;
+	if (prune) {
+		stale = trie_create(NULL);
+		if (stale == NULL) {
+			return KNOT_ENOMEM;
+		}
+		trie_it_t *it = trie_it_begin(cache->known);
+		for (; it != NULL && !trie_it_finished(it); trie_it_next(it)) {
+			if (*trie_it_val(it) == NULL) {
+				continue;
+			}
+			size_t len = 0;
+			const trie_key_t *digest = trie_it_key(it, &len);
+			if (trie_get_ins(stale, digest, len) == NULL) {
+				trie_it_free(it);
+				trie_free(stale);
+				return KNOT_ENOMEM;
+			}
+		}
+		trie_it_free(it);
+	}
+
+	int ret = KNOT_EOK;
+	if (trie_weight(cache->fresh) > 0 || (stale != NULL && trie_weight(stale) > 0)) {
+		ret = kasp_db_update_rrsig_valid(cache->db, cache->zone, stale, cache->fresh);
+	}
+	trie_free(stale);
+
+	return ret;
+}
+
+void valid_cache_free(valid_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	trie_free(cache->known);
+	trie_free(cache->fresh);
+	pthread_mutex_destroy(&cache->fresh_lock);
+	knot_dname_free(cache->zone, NULL);
+	free(cache);
+}
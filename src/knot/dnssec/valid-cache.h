@@ -0,0 +1,98 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Persistent cache of successfully validated RRSIGs.
+ *
+ * Each validated signature is identified by a digest of the DNSKEY, the RRSIG
+ * RDATA and the covered RRSet in the canonical wire format, so a cache hit
+ * implies the same verification input. The digests are stored in the KASP DB
+ * and survive zone reloads and server restarts.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libdnssec/key.h"
+#include "knot/journal/knot_lmdb.h"
+#include "libknot/rrset.h"
+
+#define VALID_CACHE_DIGEST_SIZE 48
+
+typedef struct valid_cache valid_cache_t;
+
+/*!
+ * \brief Load the validation cache of the zone.
+ *
+ * \param db    KASP DB.
+ * \param zone  Zone name.
+ *
+ * \return Loaded cache or NULL on error.
+ */
+valid_cache_t *valid_cache_load(knot_lmdb_db_t *db, const knot_dname_t *zone);
+
+/*!
+ * \brief Compute the cache digest of an RRSIG.
+ *
+ * \param key      DNSKEY of the signature.
+ * \param rrsig    RRSIG RDATA.
+ * \param covered  Covered RRSet.
+ * \param digest   Out: digest of VALID_CACHE_DIGEST_SIZE bytes.
+ *
+ * \return KNOT_E*
+ */
+int valid_cache_digest(const dnssec_key_t *key, const knot_rdata_t *rrsig,
+                       const knot_rrset_t *covered, uint8_t *digest);
+
+/*!
+ * \brief Check if the signature has been validated before.
+ *
+ * \note Safe to be called concurrently with other lookups and inserts.
+ *
+ * \param cache   Validation cache.
+ * \param digest  Signature digest.
+ *
+ * \return True if validated.
+ */
+bool valid_cache_lookup(valid_cache_t *cache, const uint8_t *digest);
+
+/*!
+ * \brief Record a successfully validated signature.
+ *
+ * \note Safe to be called concurrently with other lookups and inserts.
+ *
+ * \param cache   Validation cache.
+ * \param digest  Signature digest.
+ * \param expire  Signature expiration.
+ */
+void valid_cache_insert(valid_cache_t *cache, const uint8_t *digest, uint32_t expire);
+
+/*!
+ * \brief Store the recorded signatures into the KASP DB.
+ *
+ * \param cache  Validation cache.
+ * \param prune  Also remove the digests not looked up since the load.
+ *
+ * \return KNOT_E*
+ */
+int valid_cache_save(valid_cache_t *cache, bool prune);
+
+/*!
+ * \brief Free the validation cache.
+ */
+void valid_cache_free(valid_cache_t *cache);
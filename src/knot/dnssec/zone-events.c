@@ -23,6 +23,7 @@
 #include "knot/common/log.h"
 #include "knot/dnssec/key-events.h"
 #include "knot/dnssec/policy.h"
+#include "knot/dnssec/sign-index.h"
 #include "knot/dnssec/zone-events.h"
 #include "knot/dnssec/zone-keys.h"
 #include "knot/dnssec/zone-nsec.h"
@@ -190,6 +191,7 @@ int knot_dnssec_zone_sign(zone_update_t *update,
 	}
 
 	log_zone_info(zone_name, "DNSSEC, signing started");
+	zone_sign_index_begin(update);
 
 	knot_time_t next_resign = 0;
 	result = knot_zone_sign_update_dnskeys(update, &keyset, &ctx, &next_resign);
@@ -259,6 +261,7 @@ int knot_dnssec_zone_sign(zone_update_t *update,
 
 done:
 	if (result == KNOT_EOK) {
+		zone_sign_index_finish(update);
 		reschedule->next_sign = schedule_next(&ctx, &keyset, next_resign, zone_expire);
 	} else {
 		reschedule->next_sign = knot_dnssec_failover_delay(&ctx);
@@ -308,6 +311,7 @@ int knot_dnssec_sign_update(zone_update_t *update, conf_t *conf)
 		               knot_strerror(result));
 		goto done;
 	}
+	zone_sign_index_begin(update);
 
 	if (zone_update_changes_dnskey(update)) {
 		result = knot_zone_sign_update_dnskeys(update, &keyset, &ctx, &expire_at);
@@ -378,6 +382,9 @@ int knot_dnssec_sign_update(zone_update_t *update, conf_t *conf)
 	log_zone_info(zone_name, "DNSSEC, incrementally signed");
 
 done:
+	if (result == KNOT_EOK) {
+		zone_sign_index_finish(update);
+	}
 	if (result == KNOT_EOK && expire_at != 0) {
 		zone_events_schedule_at(update->zone, ZONE_EVENT_DNSSEC, (time_t)expire_at); // this is usually NOOP since signing planned earlier
 	}
@@ -413,7 +420,17 @@ int knot_dnssec_validate_zone(zone_update_t *update, conf_t *conf, knot_time_t n
 		if (incremental) {
 			ret = knot_zone_sign_update(update, NULL, &ctx, &unused);
 		} else {
+			// Skip the verification of RRSIGs validated during previous loads.
+			if (update->zone->server != NULL) {
+				ctx.valid_cache = valid_cache_load(zone_kaspdb(update->zone),
+				                                   update->zone->name);
+			}
 			ret = knot_zone_sign(update, NULL, &ctx, &unused);
+			if (ctx.valid_cache != NULL) {
+				(void)valid_cache_save(ctx.valid_cache, ret == KNOT_EOK);
+				valid_cache_free(ctx.valid_cache);
+				ctx.valid_cache = NULL;
+			}
 		}
 	}
 	kdnssec_ctx_deinit(&ctx);
@@ -20,6 +20,7 @@
 
 #include "libdnssec/error.h"
 #include "knot/common/log.h"
+#include "knot/dnssec/key-cache.h"
 #include "knot/dnssec/zone-keys.h"
 #include "libknot/libknot.h"
 
@@ -229,6 +230,7 @@ int kdnssec_delete_key(kdnssec_ctx_t *ctx, knot_kasp_key_t *key_ptr)
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
+		key_cache_drop(key_ptr->id);
 	}
 
 	dnssec_key_free(key_ptr->key);
@@ -444,17 +446,26 @@ static int walk_algorithms(kdnssec_ctx_t *ctx, zone_keyset_t *keyset)
 /*!
  * \brief Load private keys for active keys.
  */
-static int load_private_keys(dnssec_keystore_t *keystore, zone_keyset_t *keyset)
+static int load_private_keys(kdnssec_ctx_t *ctx, zone_keyset_t *keyset)
 {
-	assert(keystore);
+	assert(ctx);
 	assert(keyset);
+	assert(keyset->count == ctx->zone->num_keys);
 
 	for (size_t i = 0; i < keyset->count; i++) {
 		zone_key_t *key = &keyset->keys[i];
 		if (!key->is_active && !key->is_ksk_active_plus && !key->is_zsk_active_plus) {
 			continue;
 		}
-		int r = dnssec_keystore_get_private(keystore, key->id, key->key);
+		knot_kasp_key_t *kasp_key = &ctx->zone->keys[i];
+		dnssec_key_t *cached = key_cache_take(ctx->zone->dname, kasp_key->id, kasp_key->key);
+		if (cached != NULL) {
+			dnssec_key_free(kasp_key->key);
+			kasp_key->key = cached;
+			key->key = cached;
+			continue;
+		}
+		int r = dnssec_keystore_get_private(ctx->keystore, key->id, key->key);
 		switch (r) {
 		case DNSSEC_EOK:
 		case DNSSEC_KEY_ALREADY_PRESENT:
@@ -554,7 +565,7 @@ int load_zone_keys(kdnssec_ctx_t *ctx, zone_keyset_t *keyset_ptr, bool verbose)
 		return ret;
 	}
 
-	ret = load_private_keys(ctx->keystore, &keyset);
+	ret = load_private_keys(ctx, &keyset);
 	ret = knot_error_from_libdnssec(ret);
 	if (ret != KNOT_EOK) {
 		log_zone_error(ctx->zone->dname, "DNSSEC, failed to load private "
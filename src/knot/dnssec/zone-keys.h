@@ -61,6 +61,7 @@ typedef struct {
 	zone_key_t *keys;                 // keys in keyset
 	dnssec_sign_ctx_t **sign_ctxs;    // signing buffers for keys in keyset
 	const kdnssec_ctx_t *dnssec_ctx;  // dnssec context
+	uint64_t signatures;              // number of created signatures
 } zone_sign_ctx_t;
 
 /*!
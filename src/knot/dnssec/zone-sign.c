@@ -26,9 +26,13 @@
 #include "knot/dnssec/key-events.h"
 #include "knot/dnssec/key_records.h"
 #include "knot/dnssec/rrset-sign.h"
+#include "knot/dnssec/sign-index.h"
+#include "knot/dnssec/sign-pool.h"
 #include "knot/dnssec/zone-sign.h"
 #include "libknot/libknot.h"
 #include "libknot/dynarray.h"
+#include "contrib/macros.h"
+#include "contrib/time.h"
 #include "contrib/wire_ctx.h"
 
 typedef struct {
@@ -254,6 +258,9 @@ static int add_missing_rrsigs(const knot_rrset_t *covered,
 
 		result = knot_sign_rrset(&to_add, covered, key->key, sign_ctx->sign_ctxs[i],
 		                         sign_ctx->dnssec_ctx, NULL, expires_at);
+		if (result == KNOT_EOK) {
+			sign_ctx->signatures++;
+		}
 	}
 
 	if (!knot_rrset_empty(&to_remove) && result == KNOT_EOK) {
@@ -494,55 +501,90 @@ static int sign_node_rrsets(const zone_node_t *node,
 }
 
 /*!
- * \brief Struct to carry data for 'sign_data' callback function.
+ * \brief Per-thread data for zone tree signing.
  */
 typedef struct {
-	zone_tree_t *tree;
 	zone_sign_ctx_t *sign_ctx;
 	changeset_t changeset;
 	knot_time_t expires_at;
-	dnssec_validation_hint_t *hint;
-	size_t num_threads;
-	size_t thread_index;
-	size_t rrset_index;
 	int errcode;
-	int thread_init_errcode;
-	pthread_t thread;
 } node_sign_args_t;
 
 /*!
- * \brief Sign node (callback function).
+ * \brief Shared context of parallel zone tree signing.
  *
- * \param node  Node to be signed.
- * \param data  Callback data, node_sign_args_t.
+ * Signing threads take chunks of nodes from the shared tree iterator, so the
+ * work is distributed according to the actual signing progress.
  */
-static int sign_node(zone_node_t *node, void *data)
-{
-	assert(node);
-	assert(data);
-
-	node_sign_args_t *args = (node_sign_args_t *)data;
+typedef struct {
+	zone_tree_it_t it;
+	pthread_mutex_t it_lock;
+	bool failed;
+	zone_keyset_t *zone_keys;
+	const kdnssec_ctx_t *dnssec_ctx;
+	dnssec_validation_hint_t *hint;
+	node_sign_args_t *args;
+} tree_sign_ctx_t;
 
-	if (node->rrset_count == 0) {
-		return KNOT_EOK;
-	}
+#define SIGN_CHUNK_NODES  32
+#define SIGN_CHUNK_RRSETS 64
 
-	if (args->rrset_index++ % args->num_threads != args->thread_index) {
-		return KNOT_EOK;
+/*!
+ * \brief Get the next chunk of nodes to be signed.
+ *
+ * \return Number of nodes in the chunk, zero if no more work.
+ */
+static size_t next_chunk(tree_sign_ctx_t *ctx, zone_node_t **chunk)
+{
+	size_t count = 0, rrsets = 0;
+
+	pthread_mutex_lock(&ctx->it_lock);
+	while (!ctx->failed && !zone_tree_it_finished(&ctx->it) &&
+	       count < SIGN_CHUNK_NODES && rrsets < SIGN_CHUNK_RRSETS) {
+		zone_node_t *node = zone_tree_it_val(&ctx->it);
+		if (node->rrset_count > 0) {
+			chunk[count++] = node;
+			rrsets += node->rrset_count;
+		}
+		zone_tree_it_next(&ctx->it);
 	}
+	pthread_mutex_unlock(&ctx->it_lock);
 
-	int result = sign_node_rrsets(node, args->sign_ctx,
-	                              &args->changeset, &args->expires_at,
-	                              args->hint);
-
-	return result;
+	return count;
 }
 
-static void *tree_sign_thread(void *_arg)
+static void tree_sign_thread(void *_ctx, unsigned index)
 {
-	node_sign_args_t *arg = _arg;
-	arg->errcode = zone_tree_apply(arg->tree, sign_node, _arg);
-	return NULL;
+	tree_sign_ctx_t *ctx = _ctx;
+	node_sign_args_t *args = &ctx->args[index];
+
+	args->sign_ctx = ctx->dnssec_ctx->validation_mode
+	               ? zone_validation_ctx(ctx->dnssec_ctx)
+	               : zone_sign_ctx(ctx->zone_keys, ctx->dnssec_ctx);
+	if (args->sign_ctx == NULL) {
+		args->errcode = KNOT_ENOMEM;
+	}
+
+	zone_node_t *chunk[SIGN_CHUNK_NODES];
+	while (args->errcode == KNOT_EOK) {
+		size_t count = next_chunk(ctx, chunk);
+		if (count == 0) {
+			break;
+		}
+		uint64_t signatures = args->sign_ctx->signatures;
+		for (size_t i = 0; i < count && args->errcode == KNOT_EOK; i++) {
+			args->errcode = sign_node_rrsets(chunk[i], args->sign_ctx,
+			                                 &args->changeset, &args->expires_at,
+			                                 ctx->hint);
+		}
+		sign_pool_throttle(args->sign_ctx->signatures - signatures);
+	}
+
+	if (args->errcode != KNOT_EOK) {
+		pthread_mutex_lock(&ctx->it_lock);
+		ctx->failed = true;
+		pthread_mutex_unlock(&ctx->it_lock);
+	}
 }
 
 static int set_signed(zone_node_t *node, _unused_ void *data)
@@ -552,9 +594,10 @@ static int set_signed(zone_node_t *node, _unused_ void *data)
 }
 
 /*!
- * \brief Update RRSIGs in a given zone tree by updating changeset.
+ * \brief Update RRSIGs in given zone trees by updating changeset.
  *
  * \param tree        Zone tree to be signed.
+ * \param tree2       Optional second zone tree to be signed.
  * \param num_threads Number of threads to use for parallel signing.
  * \param zone_keys   Zone keys.
  * \param policy      DNSSEC policy.
@@ -564,6 +607,7 @@ static int set_signed(zone_node_t *node, _unused_ void *data)
  * \return Error code, KNOT_EOK if successful.
  */
 static int zone_tree_sign(zone_tree_t *tree,
+                          zone_tree_t *tree2,
                           size_t num_threads,
                           zone_keyset_t *zone_keys,
                           const kdnssec_ctx_t *dnssec_ctx,
@@ -574,76 +618,70 @@ static int zone_tree_sign(zone_tree_t *tree,
 	assert(dnssec_ctx);
 	assert(update || dnssec_ctx->validation_mode);
 
-	int ret = KNOT_EOK;
-	node_sign_args_t args[num_threads];
-	memset(args, 0, sizeof(args));
 	*expires_at = knot_time_plus(dnssec_ctx->now, dnssec_ctx->policy->rrsig_lifetime);
 
-	// init context structures
-	for (size_t i = 0; i < num_threads; i++) {
-		args[i].tree = tree;
-		args[i].sign_ctx = dnssec_ctx->validation_mode
-		                 ? zone_validation_ctx(dnssec_ctx)
-		                 : zone_sign_ctx(zone_keys, dnssec_ctx);
-		if (args[i].sign_ctx == NULL) {
-			ret = KNOT_ENOMEM;
-			break;
-		}
+	if (zone_tree_is_empty(tree)) {
+		tree = tree2;
+		tree2 = NULL;
+	}
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_EOK;
+	}
+	if (zone_tree_is_empty(tree2)) {
+		tree2 = NULL;
+	}
+
+	// don't start more threads than chunks
+	size_t nodes = zone_tree_count(tree) + zone_tree_count(tree2);
+	num_threads = MIN(num_threads, 1 + (nodes - 1) / SIGN_CHUNK_NODES);
+
+	node_sign_args_t args[num_threads];
+	memset(args, 0, sizeof(args));
+	tree_sign_ctx_t ctx = {
+		.zone_keys = zone_keys,
+		.dnssec_ctx = dnssec_ctx,
+		.hint = &update->validation_hint,
+		.args = args,
+	};
+
+	int ret = zone_tree_it_double_begin(tree, tree2, &ctx.it);
+	for (size_t i = 0; i < num_threads && ret == KNOT_EOK; i++) {
 		ret = changeset_init(&args[i].changeset, dnssec_ctx->zone->dname);
-		if (ret != KNOT_EOK) {
-			break;
-		}
-		args[i].expires_at = 0;
-		args[i].hint = &update->validation_hint;
-		args[i].num_threads = num_threads;
-		args[i].thread_index = i;
-		args[i].rrset_index = 0;
-		args[i].errcode = KNOT_EOK;
-		args[i].thread_init_errcode = -1;
 	}
 	if (ret != KNOT_EOK) {
 		for (size_t i = 0; i < num_threads; i++) {
 			changeset_clear(&args[i].changeset);
-			zone_sign_ctx_free(args[i].sign_ctx);
 		}
+		zone_tree_it_free(&ctx.it);
 		return ret;
 	}
+	pthread_mutex_init(&ctx.it_lock, NULL);
 
-	if (num_threads == 1) {
-		args[0].thread_init_errcode = 0;
-		tree_sign_thread(&args[0]);
-	} else {
-		// start working threads
-		for (size_t i = 0; i < num_threads; i++) {
-			args[i].thread_init_errcode =
-				pthread_create(&args[i].thread, NULL, tree_sign_thread, &args[i]);
-		}
-
-		// join those threads that have been really started
-		for (size_t i = 0; i < num_threads; i++) {
-			if (args[i].thread_init_errcode == 0) {
-				args[i].thread_init_errcode = pthread_join(args[i].thread, NULL);
-			}
-		}
-	}
+	struct timespec begin = time_now();
+	sign_pool_run(num_threads, tree_sign_thread, &ctx);
+	struct timespec end = time_now();
 
 	// collect return code and results
+	uint64_t signatures = 0;
 	for (size_t i = 0; i < num_threads; i++) {
 		if (ret == KNOT_EOK) {
-			if (args[i].thread_init_errcode != 0) {
-				ret = knot_map_errno_code(args[i].thread_init_errcode);
-			} else {
-				ret = args[i].errcode;
-				if (ret == KNOT_EOK && !dnssec_ctx->validation_mode) {
-					ret = zone_update_apply_changeset(update, &args[i].changeset); // _fix not needed
-					*expires_at = knot_time_min(*expires_at, args[i].expires_at);
-				}
+			ret = args[i].errcode;
+			if (ret == KNOT_EOK && !dnssec_ctx->validation_mode) {
+				ret = zone_update_apply_changeset(update, &args[i].changeset); // _fix not needed
+				*expires_at = knot_time_min(*expires_at, args[i].expires_at);
 			}
 		}
 		assert(!dnssec_ctx->validation_mode || changeset_empty(&args[i].changeset));
 		changeset_clear(&args[i].changeset);
-		zone_sign_ctx_free(args[i].sign_ctx);
+		if (args[i].sign_ctx != NULL) {
+			signatures += args[i].sign_ctx->signatures;
+			zone_sign_ctx_free(args[i].sign_ctx);
+		}
 	}
+	sign_pool_stats_add(signatures, time_diff_ms(&begin, &end) * 1000);
+
+	pthread_mutex_destroy(&ctx.it_lock);
+	zone_tree_it_free(&ctx.it);
 
 	return ret;
 }
@@ -690,10 +728,11 @@ static int rrset_add_zone_ds(knot_rrset_t *rrset, zone_key_t *zone_key, dnssec_k
 	return knot_rrset_add_rdata(rrset, cds_rdata.data, cds_rdata.size, NULL);
 }
 
-int knot_zone_sign(zone_update_t *update,
-                   zone_keyset_t *zone_keys,
-                   const kdnssec_ctx_t *dnssec_ctx,
-                   knot_time_t *expire_at)
+static int zone_sign(zone_update_t *update,
+                     zone_keyset_t *zone_keys,
+                     const kdnssec_ctx_t *dnssec_ctx,
+                     knot_time_t *expire_at,
+                     bool use_index)
 {
 	if (!update || !dnssec_ctx || !expire_at ||
 	    dnssec_ctx->policy->signing_threads < 1 ||
@@ -703,16 +742,26 @@ int knot_zone_sign(zone_update_t *update,
 
 	int result;
 
-	knot_time_t normal_expire = 0;
-	result = zone_tree_sign(update->new_cont->nodes, dnssec_ctx->policy->signing_threads,
-	                        zone_keys, dnssec_ctx, update, &normal_expire);
-	if (result != KNOT_EOK) {
-		return result;
+	// visit only the nodes with expiring RRSIGs if all the others are fine
+	zone_tree_t *due = NULL, *due_nsec3 = NULL;
+	knot_time_t due_next = 0;
+	use_index = use_index && !dnssec_ctx->validation_mode && !dnssec_ctx->rrsig_drop_existing &&
+	            zone_sign_index_due(update, zone_keys, dnssec_ctx, &due, &due_nsec3,
+	                                &due_next) == KNOT_EOK;
+	if (use_index) {
+		result = zone_tree_sign(due, due_nsec3, dnssec_ctx->policy->signing_threads,
+		                        zone_keys, dnssec_ctx, update, expire_at);
+		*expire_at = knot_time_min(*expire_at, due_next);
+	} else {
+		result = zone_tree_sign(update->new_cont->nodes, update->new_cont->nsec3_nodes,
+		                        dnssec_ctx->policy->signing_threads,
+		                        zone_keys, dnssec_ctx, update, expire_at);
 	}
-
-	knot_time_t nsec3_expire = 0;
-	result = zone_tree_sign(update->new_cont->nsec3_nodes, dnssec_ctx->policy->signing_threads,
-	                        zone_keys, dnssec_ctx, update, &nsec3_expire);
+	if (result == KNOT_EOK && !dnssec_ctx->validation_mode) {
+		zone_sign_index_signed(update, zone_keys, dnssec_ctx, due, due_nsec3);
+	}
+	zone_tree_free(&due);
+	zone_tree_free(&due_nsec3);
 	if (result != KNOT_EOK) {
 		return result;
 	}
@@ -723,11 +772,17 @@ int knot_zone_sign(zone_update_t *update,
 		result = zone_tree_apply(whole ? update->new_cont->nsec3_nodes : update->a_ctx->nsec3_ptrs, set_signed, NULL);
 	}
 
-	*expire_at = knot_time_min(normal_expire, nsec3_expire);
-
 	return result;
 }
 
+int knot_zone_sign(zone_update_t *update,
+                   zone_keyset_t *zone_keys,
+                   const kdnssec_ctx_t *dnssec_ctx,
+                   knot_time_t *expire_at)
+{
+	return zone_sign(update, zone_keys, dnssec_ctx, expire_at, true);
+}
+
 keyptr_dynarray_t knot_zone_sign_get_cdnskeys(const kdnssec_ctx_t *ctx,
 					      zone_keyset_t *zone_keys)
 {
@@ -874,6 +929,7 @@ int knot_zone_sign_update_dnskeys(zone_update_t *update,
 		if (dnssec_ctx->policy->ds_push && node_rrtype_exists(ch.add->apex, KNOT_RRTYPE_CDS)) {
 			// there is indeed a change to CDS
 			update->zone->timers.next_ds_push = time(NULL) + dnssec_ctx->policy->propagation_delay;
+			zone_timers_changed(update->zone);
 			zone_events_schedule_at(update->zone, ZONE_EVENT_DS_PUSH, update->zone->timers.next_ds_push);
 		}
 		CHECK_RET;
@@ -1018,17 +1074,16 @@ int knot_zone_sign_update(zone_update_t *update,
 	 * If so, we have to sign the whole zone. */
 	const bool full_sign = apex_dnssec_changed(update);
 	if (full_sign) {
-		ret = knot_zone_sign(update, zone_keys, dnssec_ctx, expire_at);
+		ret = zone_sign(update, zone_keys, dnssec_ctx, expire_at, false);
 	} else {
-		ret = zone_tree_sign(update->a_ctx->node_ptrs, dnssec_ctx->policy->signing_threads,
-				     zone_keys, dnssec_ctx, update, expire_at);
+		// NSEC3 nodes are validated, but signed later with the NSEC3 chain
+		zone_tree_t *nsec3_ptrs = dnssec_ctx->validation_mode ? update->a_ctx->nsec3_ptrs : NULL;
+		ret = zone_tree_sign(update->a_ctx->node_ptrs, nsec3_ptrs,
+		                     dnssec_ctx->policy->signing_threads,
+		                     zone_keys, dnssec_ctx, update, expire_at);
 		if (ret == KNOT_EOK) {
 			ret = zone_tree_apply(update->a_ctx->node_ptrs, set_signed, NULL);
 		}
-		if (ret == KNOT_EOK && dnssec_ctx->validation_mode) {
-			ret = zone_tree_sign(update->a_ctx->nsec3_ptrs, dnssec_ctx->policy->signing_threads,
-			                     zone_keys, dnssec_ctx, update, expire_at);
-		}
 		if (ret == KNOT_EOK && dnssec_ctx->validation_mode) {
 			ret = zone_tree_apply(update->a_ctx->nsec3_ptrs, set_signed, NULL);
 		}
@@ -93,6 +93,9 @@ int knot_validate_rrsigs(const knot_rrset_t *covered,
  *
  * Updates RRSIGs, NSEC(3)s, and DNSKEYs.
  *
+ * \note If the zone's RRSIG expiration index is usable, only the nodes with
+ *       expiring RRSIGs and the nodes changed by the update are visited.
+ *
  * \param update      Zone Update containing the zone and to be updated with new DNSKEYs and RRSIGs.
  * \param zone_keys   Zone keys.
  * \param dnssec_ctx  DNSSEC context.
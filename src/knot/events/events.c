@@ -16,12 +16,17 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
 #include <urcu.h>
 
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
+#include "contrib/time.h"
 #include "knot/common/log.h"
+#include "knot/common/subscribe.h"
+#include "knot/common/usdt.h"
 #include "knot/events/events.h"
 #include "knot/events/handlers.h"
 #include "knot/events/replan.h"
@@ -29,6 +34,15 @@
 
 #define ZONE_EVENT_IMMEDIATE 1 /* Fast-track to worker queue. */
 
+/*! \brief Time spent by the events of all the zones. */
+static struct {
+	pthread_mutex_t mx;
+	zone_event_usage_t usage[ZONE_EVENT_COUNT];
+	zone_event_slow_t slowest[ZONE_EVENT_SLOWEST];
+} total_usage = {
+	.mx = PTHREAD_MUTEX_INITIALIZER
+};
+
 typedef int (*zone_event_cb)(conf_t *conf, zone_t *zone);
 
 typedef struct event_info {
@@ -50,6 +64,7 @@ static const event_info_t EVENT_INFO[] = {
 	{ ZONE_EVENT_UTHAW,        event_uthaw,       "update thaw" },
 	{ ZONE_EVENT_DS_CHECK,     event_ds_check,    "DS check" },
 	{ ZONE_EVENT_DS_PUSH,      event_ds_push,     "DS push" },
+	{ ZONE_EVENT_UNLOAD,       event_unload,      "unload" },
 	{ 0 }
 };
 
@@ -80,6 +95,7 @@ bool ufreeze_applies(zone_event_type_t type)
 	case ZONE_EVENT_FLUSH:
 	case ZONE_EVENT_DNSSEC:
 	case ZONE_EVENT_DS_CHECK:
+	case ZONE_EVENT_UNLOAD:
 		return true;
 	default:
 		return false;
@@ -148,6 +164,36 @@ static zone_event_type_t get_next_event(zone_events_t *events)
 	return next_type;
 }
 
+/*!
+ * \brief Get worker pool priority of the event.
+ *
+ * User triggered events and events affecting clients (DDNS, NOTIFY) are
+ * preferred, lengthy background maintenance is postponed.
+ */
+static worker_prio_t get_event_prio(zone_events_t *events, zone_event_type_t type)
+{
+	if (!valid_event(type)) {
+		return WORKER_PRIO_NORMAL;
+	}
+
+	if (events->forced[type]) {
+		return WORKER_PRIO_HIGH;
+	}
+
+	switch (type) {
+	case ZONE_EVENT_UPDATE:
+	case ZONE_EVENT_NOTIFY:
+		return WORKER_PRIO_HIGH;
+	case ZONE_EVENT_FLUSH:
+	case ZONE_EVENT_BACKUP:
+	case ZONE_EVENT_DNSSEC:
+	case ZONE_EVENT_DS_CHECK:
+		return WORKER_PRIO_LOW;
+	default:
+		return WORKER_PRIO_NORMAL;
+	}
+}
+
 /*!
  * \brief Fined time of next scheduled event.
  */
@@ -189,6 +235,77 @@ static void reschedule(zone_events_t *events)
 	pthread_mutex_unlock(&events->reschedule_lock);
 }
 
+static uint64_t time_diff_us(const struct timespec *begin, const struct timespec *end)
+{
+	if (begin->tv_sec == 0 && begin->tv_nsec == 0) {
+		return 0;
+	}
+	struct timespec diff = time_diff(begin, end);
+	return diff.tv_sec * 1000000ULL + diff.tv_nsec / 1000;
+}
+
+static struct timespec thread_cpu_time(void)
+{
+	struct timespec result = { 0 };
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	(void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &result);
+#endif
+	return result;
+}
+
+static void usage_add(zone_event_usage_t *usage, uint64_t wall, uint64_t cpu,
+                      uint64_t wait)
+{
+	usage->count++;
+	usage->wall += wall;
+	usage->cpu += cpu;
+	usage->wait += wait;
+	usage->max_wall = MAX(usage->max_wall, wall);
+}
+
+static void slowest_add(const knot_dname_t *zone, zone_event_type_t type,
+                        uint64_t wall, uint64_t cpu, uint64_t wait)
+{
+	knot_time_t now = knot_time();
+
+	// Replace a forgotten record or the fastest one if faster than this event.
+	zone_event_slow_t *slot = NULL;
+	for (size_t i = 0; i < ZONE_EVENT_SLOWEST; i++) {
+		zone_event_slow_t *it = &total_usage.slowest[i];
+		if (it->finished + ZONE_EVENT_SLOWEST_AGE < now) {
+			slot = it;
+			break;
+		} else if (it->wall < wall && (slot == NULL || it->wall < slot->wall)) {
+			slot = it;
+		}
+	}
+	if (slot == NULL) {
+		return;
+	}
+
+	knot_dname_store(slot->zone, zone);
+	slot->type = type;
+	slot->finished = now;
+	slot->wall = wall;
+	slot->cpu = cpu;
+	slot->wait = wait;
+}
+
+static void record_usage(zone_t *zone, zone_event_type_t type, uint64_t wall,
+                         uint64_t cpu, uint64_t wait)
+{
+	zone_events_t *events = &zone->events;
+
+	pthread_mutex_lock(&events->mx);
+	usage_add(&events->usage[type], wall, cpu, wait);
+	pthread_mutex_unlock(&events->mx);
+
+	pthread_mutex_lock(&total_usage.mx);
+	usage_add(&total_usage.usage[type], wall, cpu, wait);
+	slowest_add(zone->name, type, wall, cpu, wait);
+	pthread_mutex_unlock(&total_usage.mx);
+}
+
 /*!
  * \brief Zone event wrapper, expected to be called from a worker thread.
  *
@@ -216,25 +333,52 @@ static void event_wrap(worker_task_t *task)
 	events->type = type;
 	event_set_time(events, type, 0);
 	events->forced[type] = false;
+	events->debounce[type].start = 0;
+	struct timespec queued = events->queued;
 	pthread_mutex_unlock(&events->mx);
 
 	const event_info_t *info = get_event_info(type);
 
+#ifdef ENABLE_USDT
+	knot_dname_txt_storage_t zone_str = "";
+	(void)knot_dname_to_str(zone_str, zone->name, sizeof(zone_str));
+#endif
+	struct timespec begin = time_now();
+	struct timespec cpu_begin = thread_cpu_time();
+	KNOT_PROBE(zone_event_start, zone_str, info->name);
+
 	/* Create a configuration copy just for this event. */
 	conf_t *conf;
 	rcu_read_lock();
 	int ret = conf_clone(&conf);
 	rcu_read_unlock();
 	if (ret == KNOT_EOK) {
+		zone_timers_t timers = zone->timers;
+
 		/* Execute the event callback. */
 		ret = info->callback(conf, zone);
 		conf_free(conf);
+
+		/* The changed timers are persisted in batches. */
+		if (!zone_timers_equal(&timers, &zone->timers)) {
+			zone_timers_changed(zone);
+		}
 	}
 
+	struct timespec end = time_now();
+	struct timespec cpu_end = thread_cpu_time();
+	KNOT_PROBE(zone_event_end, zone_str, info->name, ret,
+	           (uint64_t)time_diff_ms(&begin, &end));
+
+	record_usage(zone, type, time_diff_us(&begin, &end),
+	             time_diff_us(&cpu_begin, &cpu_end), time_diff_us(&queued, &begin));
+
 	if (ret != KNOT_EOK) {
 		log_zone_error(zone->name, "zone event '%s' failed (%s)",
 		               info->name, knot_strerror(ret));
 	}
+	subscribe_emit(SUBSCRIBE_EVENT, zone->name, info->name, "%s",
+	               (ret == KNOT_EOK) ? "ok" : knot_strerror(ret));
 
 	pthread_mutex_lock(&events->mx);
 	events->running = false;
@@ -267,6 +411,8 @@ static void event_dispatch(event_t *event)
 	pthread_mutex_lock(&events->mx);
 	if (!events->running && !events->frozen) {
 		events->running = true;
+		events->task.prio = get_event_prio(events, get_next_event(events));
+		events->queued = time_now();
 		worker_pool_assign(events->pool, &events->task);
 	}
 	pthread_mutex_unlock(&events->mx);
@@ -356,6 +502,53 @@ void _zone_events_schedule_at(zone_t *zone, ...)
 	va_end(args);
 }
 
+bool zone_events_schedule_debounced(zone_t *zone, zone_event_type_t type,
+                                    time_t window, time_t max_delay)
+{
+	if (!zone || !valid_event(type)) {
+		return false;
+	}
+
+	if (window <= 0) {
+		zone_events_schedule_now(zone, type);
+		return false;
+	}
+
+	zone_events_t *events = &zone->events;
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&events->mx);
+
+	time_t old_next = get_next_time(events);
+	time_t current = event_get_time(events, type);
+
+	// The window is open as long as the event is planned by the debouncing.
+	bool coalesced = events->debounce[type].start != 0 && current != 0 &&
+	                 current == events->debounce[type].planned;
+	if (!coalesced) {
+		events->debounce[type].start = now;
+	}
+
+	time_t planned = MIN(now + window,
+	                     events->debounce[type].start + MAX(window, max_delay));
+	if (coalesced || current == 0 || planned < current) {
+		event_set_time(events, type, planned);
+		events->debounce[type].planned = planned;
+	} else {
+		// Merged into the earlier planned event.
+		events->debounce[type].start = 0;
+		coalesced = true;
+	}
+
+	time_t next = get_next_time(events);
+	pthread_mutex_unlock(&events->mx);
+	if (old_next != next) {
+		reschedule(events);
+	}
+
+	return coalesced;
+}
+
 void zone_events_schedule_user(zone_t *zone, zone_event_type_t type)
 {
 	if (!zone || !valid_event(type)) {
@@ -423,6 +616,8 @@ void zone_events_enqueue(zone_t *zone, zone_event_type_t type)
 		events->running = true;
 		events->type = type;
 		event_set_time(events, type, ZONE_EVENT_IMMEDIATE);
+		events->task.prio = get_event_prio(events, type);
+		events->queued = time_now();
 		worker_pool_assign(events->pool, &events->task);
 		pthread_mutex_unlock(&events->mx);
 		return;
@@ -545,3 +740,55 @@ time_t zone_events_get_next(const struct zone *zone, zone_event_type_t *type)
 
 	return next_time;
 }
+
+void zone_events_get_usage(const struct zone *zone, zone_event_type_t type,
+                           zone_event_usage_t *usage)
+{
+	memset(usage, 0, sizeof(*usage));
+	if (zone == NULL || !valid_event(type)) {
+		return;
+	}
+
+	zone_events_t *events = (zone_events_t *)&zone->events;
+
+	pthread_mutex_lock(&events->mx);
+	*usage = events->usage[type];
+	pthread_mutex_unlock(&events->mx);
+}
+
+void zone_events_total_usage(zone_event_type_t type, zone_event_usage_t *usage)
+{
+	memset(usage, 0, sizeof(*usage));
+	if (!valid_event(type)) {
+		return;
+	}
+
+	pthread_mutex_lock(&total_usage.mx);
+	*usage = total_usage.usage[type];
+	pthread_mutex_unlock(&total_usage.mx);
+}
+
+static int slow_cmp(const void *a, const void *b)
+{
+	const zone_event_slow_t *sa = a, *sb = b;
+	return (sa->wall < sb->wall) - (sa->wall > sb->wall);
+}
+
+size_t zone_events_slowest(zone_event_slow_t *slowest, size_t max)
+{
+	knot_time_t now = knot_time();
+	size_t count = 0;
+
+	pthread_mutex_lock(&total_usage.mx);
+	for (size_t i = 0; i < ZONE_EVENT_SLOWEST && count < max; i++) {
+		const zone_event_slow_t *it = &total_usage.slowest[i];
+		if (it->finished != 0 && it->finished + ZONE_EVENT_SLOWEST_AGE >= now) {
+			slowest[count++] = *it;
+		}
+	}
+	pthread_mutex_unlock(&total_usage.mx);
+
+	qsort(slowest, count, sizeof(*slowest), slow_cmp);
+
+	return count;
+}
@@ -24,6 +24,8 @@
 #include "knot/common/evsched.h"
 #include "knot/worker/pool.h"
 #include "libknot/db/db.h"
+#include "libknot/dname.h"
+#include "contrib/time.h"
 
 struct zone;
 
@@ -42,10 +44,37 @@ typedef enum zone_event_type {
 	ZONE_EVENT_UTHAW,
 	ZONE_EVENT_DS_CHECK,
 	ZONE_EVENT_DS_PUSH,
+	ZONE_EVENT_UNLOAD,
 	// terminator
 	ZONE_EVENT_COUNT,
 } zone_event_type_t;
 
+/*!
+ * \brief Time spent by zone events of one type (in microseconds).
+ */
+typedef struct {
+	uint64_t count;		//!< Number of finished events.
+	uint64_t wall;		//!< Total wall-clock time of the events.
+	uint64_t cpu;		//!< Total CPU time of the events.
+	uint64_t wait;		//!< Total time the events waited for a worker.
+	uint64_t max_wall;	//!< Wall-clock time of the slowest event.
+} zone_event_usage_t;
+
+/*!
+ * \brief Record of a slow zone event.
+ */
+typedef struct {
+	knot_dname_storage_t zone;	//!< Zone name.
+	zone_event_type_t type;		//!< Event type.
+	knot_time_t finished;		//!< Time the event finished.
+	uint64_t wall;			//!< Wall-clock time of the event (microseconds).
+	uint64_t cpu;			//!< CPU time of the event (microseconds).
+	uint64_t wait;			//!< Time the event waited for a worker (microseconds).
+} zone_event_slow_t;
+
+#define ZONE_EVENT_SLOWEST	16	//!< Number of remembered slowest events.
+#define ZONE_EVENT_SLOWEST_AGE	3600	//!< Age after which a slow event is forgotten (seconds).
+
 typedef struct zone_events {
 	pthread_mutex_t mx;		//!< Mutex protecting the struct.
 	pthread_mutex_t reschedule_lock;//!< Prevent concurrent reschedule() making mess.
@@ -65,6 +94,13 @@ typedef struct zone_events {
 	bool forced[ZONE_EVENT_COUNT];  //!< Flag that the event was invoked by user ctl.
 	pthread_cond_t *blocking[ZONE_EVENT_COUNT];       //!< For blocking events: dispatching cond.
 	int result[ZONE_EVENT_COUNT];   //!< Event return values (in blocking operations).
+	struct {
+		time_t start;           //!< Beginning of the debounce window, 0 if none.
+		time_t planned;         //!< Event time set by the debouncing.
+	} debounce[ZONE_EVENT_COUNT];   //!< Open debounce windows.
+
+	struct timespec queued;		//!< Time the task was passed to the workers.
+	zone_event_usage_t usage[ZONE_EVENT_COUNT]; //!< Time spent by the events.
 } zone_events_t;
 
 /*!
@@ -136,6 +172,25 @@ void _zone_events_schedule_at(struct zone *zone, ...);
 #define zone_events_schedule_now(zone, type) \
 	zone_events_schedule_at(zone, type, time(NULL))
 
+/*!
+ * \brief Schedule zone event after a quiet period, coalescing the triggers.
+ *
+ * The event is planned 'window' seconds after the last trigger, but not later
+ * than 'max_delay' (or 'window' if smaller) after the first trigger of
+ * the window. A trigger arriving while the event is running opens a new window.
+ * An earlier planned time of the event is kept.
+ *
+ * \param zone       Zone to schedule new event for.
+ * \param type       Type of event.
+ * \param window     Quiet period (0 for scheduling now).
+ * \param max_delay  Maximum delay since the first trigger of the window.
+ *
+ * \retval true if the trigger was merged into an already planned event.
+ * \retval false if the event was planned anew.
+ */
+bool zone_events_schedule_debounced(struct zone *zone, zone_event_type_t type,
+                                    time_t window, time_t max_delay);
+
 /*!
  * \brief Schedule zone event to now, with forced flag.
  */
@@ -212,3 +267,31 @@ const char *zone_events_get_name(zone_event_type_t type);
  * \return time of the next event or an error (negative number)
  */
 time_t zone_events_get_next(const struct zone *zone, zone_event_type_t *type);
+
+/*!
+ * \brief Return time spent by the events of the zone.
+ *
+ * \param zone   Zone.
+ * \param type   Event type.
+ * \param usage  [out] Time spent by the events of the type.
+ */
+void zone_events_get_usage(const struct zone *zone, zone_event_type_t type,
+                           zone_event_usage_t *usage);
+
+/*!
+ * \brief Return time spent by the events of all the zones since the server start.
+ *
+ * \param type   Event type.
+ * \param usage  [out] Time spent by the events of the type.
+ */
+void zone_events_total_usage(zone_event_type_t type, zone_event_usage_t *usage);
+
+/*!
+ * \brief Return the slowest events finished within last ZONE_EVENT_SLOWEST_AGE.
+ *
+ * \param slowest  [out] Slow events, the slowest first.
+ * \param max      Size of the output array.
+ *
+ * \return Number of returned events.
+ */
+size_t zone_events_slowest(zone_event_slow_t *slowest, size_t max);
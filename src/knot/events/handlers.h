@@ -47,3 +47,5 @@ int event_uthaw(conf_t *conf, zone_t *zone);
 int event_ds_check(conf_t *conf, zone_t *zone);
 /*! \brief After change of CDS/CDNSKEY, push the new DS to parent zone as DDNS. */
 int event_ds_push(conf_t *conf, zone_t *zone);
+/*! \brief Frees contents of an idle zone, they are loaded again on demand. */
+int event_unload(conf_t *conf, zone_t *zone);
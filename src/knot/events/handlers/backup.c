@@ -46,9 +46,8 @@ int event_backup(conf_t *conf, zone_t *zone)
 	if (restore) {
 		// expire zone
 		zone_contents_t *expired = zone_switch_contents(zone, NULL);
-		synchronize_rcu();
 		knot_sem_wait(&zone->cow_lock);
-		zone_contents_deep_free(expired);
+		zone_retire_contents(expired);
 		knot_sem_post(&zone->cow_lock);
 		zone->zonefile.exists = false;
 	}
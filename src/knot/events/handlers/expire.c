@@ -31,12 +31,12 @@ int event_expire(conf_t *conf, zone_t *zone)
 	zone_contents_t *expired = zone_switch_contents(zone, NULL);
 	log_zone_info(zone->name, "zone expired");
 
-	synchronize_rcu();
 	knot_sem_wait(&zone->cow_lock);
-	zone_contents_deep_free(expired);
+	zone_retire_contents(expired);
 	knot_sem_post(&zone->cow_lock);
 
 	zone->zonefile.exists = false;
+	zone_unset_flag(zone, ZONE_IS_UNLOADED);
 
 	// NOTE: must preserve zone->timers.soa_expire
 	zone->timers.next_refresh = time(NULL);
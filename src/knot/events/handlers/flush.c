@@ -1,4 +1,4 @@
-/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -25,9 +25,18 @@ int event_flush(conf_t *conf, zone_t *zone)
 	assert(conf);
 	assert(zone);
 
-	if (zone_contents_is_empty(zone->contents)) {
+	if (zone_contents_is_empty(zone->contents) && zone->bg_flush == NULL) {
 		return KNOT_EOK;
 	}
 
-	return zone_flush_journal(conf, zone, true);
+	/* The blocking control operation expects the zone file written. */
+	pthread_mutex_lock(&zone->events.mx);
+	bool blocking = zone->events.blocking[ZONE_EVENT_FLUSH] != NULL;
+	pthread_mutex_unlock(&zone->events.mx);
+
+	if (blocking) {
+		return zone_flush_journal(conf, zone, true);
+	}
+
+	return zone_flush_journal_bg(conf, zone);
 }
@@ -23,6 +23,7 @@
 #include "knot/dnssec/zone-events.h"
 #include "knot/events/handlers.h"
 #include "knot/events/replan.h"
+#include "knot/zone/clone.h"
 #include "knot/zone/digest.h"
 #include "knot/zone/serial.h"
 #include "knot/zone/zone-diff.h"
@@ -65,6 +66,13 @@ int event_load(conf_t *conf, zone_t *zone)
 	val = conf_zone_get(conf, C_ZONEFILE_LOAD, zone->name);
 	unsigned zf_from = conf_opt(&val);
 
+	// The contents of a clone always replace the whole zone.
+	val = conf_zone_get(conf, C_CLONE_SOURCE, zone->name);
+	bool cloned = (val.code == KNOT_EOK);
+	if (cloned) {
+		zf_from = ZONEFILE_LOAD_WHOLE;
+	}
+
 	int ret = KNOT_EOK;
 
 	// If configured, load journal contents.
@@ -86,8 +94,23 @@ int event_load(conf_t *conf, zone_t *zone)
 		zone_in_journal_exists = zone_journal_has_zij(zone);
 	}
 
-	// If configured, attempt to load zonefile.
-	if (zf_from != ZONEFILE_LOAD_NONE && zone->cat_members == NULL) {
+	if (cloned) {
+		ret = zone_clone_load(conf, zone, &zf_conts);
+		if (ret != KNOT_EOK) {
+			zf_conts = NULL;
+			if (ret == KNOT_ENOENT) {
+				log_zone_info(zone->name, "clone source not loaded yet");
+				ret = KNOT_EOK;
+				goto cleanup;
+			}
+			log_zone_error(zone->name, "failed to clone zone contents (%s)",
+			               knot_strerror(ret));
+			goto cleanup;
+		}
+		log_zone_info(zone->name, "zone contents cloned, serial %u",
+		              zone_contents_serial(zf_conts));
+	} else if (zf_from != ZONEFILE_LOAD_NONE && zone->cat_members == NULL) {
+		// If configured, attempt to load zonefile.
 		struct timespec mtime;
 		char *filename = conf_zonefile(conf, zone->name);
 		ret = zonefile_exists(filename, &mtime);
@@ -95,7 +118,10 @@ int event_load(conf_t *conf, zone_t *zone)
 					   zone->zonefile.mtime.tv_sec == mtime.tv_sec &&
 					   zone->zonefile.mtime.tv_nsec == mtime.tv_nsec);
 		if (ret == KNOT_EOK) {
-			ret = zone_load_contents(conf, zone->name, &zf_conts, false);
+			ret = zone_load_snapshot(conf, zone->name, &zf_conts);
+			if (ret != KNOT_EOK) {
+				ret = zone_load_contents(conf, zone->name, &zf_conts, false);
+			}
 		}
 		if (ret != KNOT_EOK) {
 			zf_conts = NULL;
@@ -169,8 +195,7 @@ int event_load(conf_t *conf, zone_t *zone)
 		}
 	}
 
-	val = conf_zone_get(conf, C_DNSSEC_SIGNING, zone->name);
-	bool dnssec_enable = (conf_bool(&val) && zone->cat_members == NULL), zu_from_zf_conts = false;
+	bool dnssec_enable = (zone_is_signed(conf, zone) && zone->cat_members == NULL), zu_from_zf_conts = false;
 	bool do_diff = (zf_from == ZONEFILE_LOAD_DIFF || zf_from == ZONEFILE_LOAD_DIFSE || zone->cat_members != NULL);
 	bool ignore_dnssec = (do_diff && dnssec_enable);
 
@@ -341,6 +366,9 @@ load_end:
 		catalog_update_clear(zone->cat_members);
 	}
 
+	zone_unset_flag(zone, ZONE_IS_UNLOADED);
+	__atomic_store_n(&zone->last_used, time(NULL), __ATOMIC_RELAXED);
+
 	// Schedule dependent events.
 	if (dnssec_enable) {
 		event_dnssec_reschedule(conf, zone, &dnssec_refresh, false); // false since we handle NOTIFY below
@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 
 #include "knot/common/log.h"
 #include "knot/conf/conf.h"
@@ -76,65 +77,104 @@ static const knot_layer_api_t NOTIFY_API = {
 	ns_log(priority, zone, LOG_OPERATION_NOTIFY, LOG_DIRECTION_OUT, remote, \
 	       (reused), fmt, ## __VA_ARGS__)
 
-static int send_notify(conf_t *conf, zone_t *zone, const knot_rrset_t *soa,
-                       const conf_remote_t *slave, int timeout)
-{
-	struct notify_data data = {
-		.zone = zone->name,
-		.soa = soa,
-		.remote = (struct sockaddr *)&slave->addr,
-		.edns = query_edns_data_init(conf, slave->addr.ss_family, 0)
-	};
-
-	knot_requestor_t requestor;
-	knot_requestor_init(&requestor, &NOTIFY_API, &data, NULL);
+typedef struct {
+	conf_remote_t *addrs;  /*!< Addresses of the remote. */
+	size_t addr_count;
+	size_t next;           /*!< Address to be tried next. */
+	int ret;
+} notify_target_t;
 
+static knot_request_t *notify_request(conf_t *conf, const conf_remote_t *slave,
+                                      struct notify_data *data)
+{
 	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
-	if (!pkt) {
-		knot_requestor_clear(&requestor);
-		return KNOT_ENOMEM;
+	if (pkt == NULL) {
+		return NULL;
 	}
 
-	const struct sockaddr_storage *dst = &slave->addr;
-	const struct sockaddr_storage *src = &slave->via;
-	knot_request_flag_t flags = conf->cache.srv_tcp_fastopen ? KNOT_REQUEST_TFO : 0;
-	knot_request_t *req = knot_request_make(NULL, dst, src, pkt, &slave->key, flags);
-	if (!req) {
-		knot_request_free(req, NULL);
-		knot_requestor_clear(&requestor);
-		return KNOT_ENOMEM;
+	data->remote = (struct sockaddr *)&slave->addr;
+	data->edns = query_edns_data_init(conf, slave->addr.ss_family, 0);
+
+	knot_request_t *req = knot_request_make(NULL, &slave->addr, &slave->via,
+	                                        pkt, &slave->key, 0);
+	if (req == NULL) {
+		knot_pkt_free(pkt);
 	}
 
-	int ret = knot_requestor_exec(&requestor, req, timeout);
+	return req;
+}
+
+static void notify_log(zone_t *zone, const knot_rrset_t *soa, knot_requestor_t *requestor,
+                       knot_request_t *req, int ret)
+{
+	const struct sockaddr_storage *dst = &req->remote;
+	bool reused = requestor->layer.flags & KNOT_REQUESTOR_REUSED;
 
 	if (ret == KNOT_EOK && knot_pkt_ext_rcode(req->resp) == 0) {
-		NOTIFY_OUT_LOG(LOG_INFO, zone->name, dst,
-		               requestor.layer.flags & KNOT_REQUESTOR_REUSED,
+		NOTIFY_OUT_LOG(LOG_INFO, zone->name, dst, reused,
 		               "serial %u", knot_soa_serial(soa->rrs.rdata));
 		zone->timers.last_notified_serial = (knot_soa_serial(soa->rrs.rdata) | LAST_NOTIFIED_SERIAL_VALID);
 	} else if (knot_pkt_ext_rcode(req->resp) == 0) {
-		NOTIFY_OUT_LOG(LOG_WARNING, zone->name, dst,
-		               requestor.layer.flags & KNOT_REQUESTOR_REUSED,
+		NOTIFY_OUT_LOG(LOG_WARNING, zone->name, dst, reused,
 		               "failed (%s)", knot_strerror(ret));
 	} else {
-		NOTIFY_OUT_LOG(LOG_WARNING, zone->name, dst,
-		               requestor.layer.flags & KNOT_REQUESTOR_REUSED,
+		NOTIFY_OUT_LOG(LOG_WARNING, zone->name, dst, reused,
 		               "server responded with error '%s'",
 		               knot_pkt_ext_rcode_name(req->resp));
 	}
+}
+
+/*!
+ * \brief Sends one round of NOTIFYs, to the next address of each pending remote.
+ *
+ * \return Number of the remotes where NOTIFY was attempted.
+ */
+static size_t notify_round(conf_t *conf, zone_t *zone, const knot_rrset_t *soa,
+                           notify_target_t *targets, size_t count, int timeout)
+{
+	knot_requestor_t requestors[count];
+	knot_request_t *reqs[count];
+	struct notify_data data[count];
+	notify_target_t *sent[count];
+	int rets[count];
+
+	size_t pending = 0;
+	for (size_t i = 0; i < count; i++) {
+		notify_target_t *t = &targets[i];
+		if (t->ret == KNOT_EOK || t->next >= t->addr_count) {
+			continue;
+		}
+		const conf_remote_t *slave = &t->addrs[t->next++];
+
+		data[pending] = (struct notify_data) {
+			.zone = zone->name,
+			.soa = soa,
+		};
+		reqs[pending] = notify_request(conf, slave, &data[pending]);
+		if (reqs[pending] == NULL) {
+			t->ret = KNOT_ENOMEM;
+			continue;
+		}
+		knot_requestor_init(&requestors[pending], &NOTIFY_API, &data[pending], NULL);
+		sent[pending++] = t;
+	}
 
-	knot_request_free(req, NULL);
-	knot_requestor_clear(&requestor);
+	knot_requestor_exec_multi(requestors, reqs, rets, pending, timeout);
 
-	return ret;
+	for (size_t i = 0; i < pending; i++) {
+		notify_log(zone, soa, &requestors[i], reqs[i], rets[i]);
+		sent[i]->ret = rets[i];
+		knot_request_free(reqs[i], NULL);
+		knot_requestor_clear(&requestors[i]);
+	}
+
+	return pending;
 }
 
 int event_notify(conf_t *conf, zone_t *zone)
 {
 	assert(zone);
 
-	bool failed = false;
-
 	if (zone_contents_is_empty(zone->contents)) {
 		return KNOT_EOK;
 	}
@@ -143,30 +183,51 @@ int event_notify(conf_t *conf, zone_t *zone)
 	int timeout = conf->cache.srv_tcp_remote_io_timeout;
 	knot_rrset_t soa = node_rrset(zone->contents->apex, KNOT_RRTYPE_SOA);
 
-	// send NOTIFY to each remote, use working address
 	conf_val_t notify = conf_zone_get(conf, C_NOTIFY, zone->name);
 	conf_mix_iter_t iter;
 	conf_mix_iter_init(conf, &notify, &iter);
+	size_t count = 0;
 	while (iter.id->code == KNOT_EOK) {
-		conf_val_t addr = conf_id_get(conf, C_RMT, C_ADDR, iter.id);
-		size_t addr_count = conf_val_count(&addr);
+		count++;
+		conf_mix_iter_next(&iter);
+	}
+	if (count == 0) {
+		return KNOT_EOK;
+	}
 
-		int ret = KNOT_EOK;
+	notify_target_t *targets = calloc(count, sizeof(*targets));
+	if (targets == NULL) {
+		return KNOT_ENOMEM;
+	}
 
-		for (int i = 0; i < addr_count; i++) {
-			conf_remote_t slave = conf_remote(conf, iter.id, i);
-			ret = send_notify(conf, zone, &soa, &slave, timeout);
-			if (ret == KNOT_EOK) {
-				break;
-			}
+	// collect addresses of each remote
+	int ret = KNOT_EOK;
+	conf_mix_iter_init(conf, &notify, &iter);
+	for (size_t i = 0; i < count; i++) {
+		notify_target_t *t = &targets[i];
+		conf_val_t addr = conf_id_get(conf, C_RMT, C_ADDR, iter.id);
+		t->addr_count = conf_val_count(&addr);
+		t->addrs = calloc(t->addr_count, sizeof(*t->addrs));
+		if (t->addr_count > 0 && t->addrs == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
 		}
-
-		if (ret != KNOT_EOK) {
-			failed = true;
+		for (size_t j = 0; j < t->addr_count; j++) {
+			t->addrs[j] = conf_remote(conf, iter.id, j);
 		}
-
+		t->ret = (t->addr_count > 0) ? KNOT_ERROR : KNOT_EOK;
 		conf_mix_iter_next(&iter);
 	}
 
+	// send NOTIFY to all remotes at once, next address of failed ones in each round
+	while (ret == KNOT_EOK && notify_round(conf, zone, &soa, targets, count, timeout) > 0);
+
+	bool failed = (ret != KNOT_EOK);
+	for (size_t i = 0; i < count; i++) {
+		failed |= (targets[i].ret != KNOT_EOK);
+		free(targets[i].addrs);
+	}
+	free(targets);
+
 	return failed ? KNOT_ERROR : KNOT_EOK;
 }
@@ -15,15 +15,20 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "contrib/mempattern.h"
 #include "libdnssec/random.h"
 #include "knot/common/log.h"
+#include "knot/common/subscribe.h"
 #include "knot/conf/conf.h"
 #include "knot/dnssec/zone-events.h"
 #include "knot/events/handlers.h"
 #include "knot/events/replan.h"
+#include "knot/events/xfr_sched.h"
 #include "knot/nameserver/ixfr.h"
 #include "knot/query/layer.h"
 #include "knot/query/query.h"
@@ -81,6 +86,8 @@
 #define BOOTSTRAP_MAXTIME (24*60*60)
 #define BOOTSTRAP_JITTER (30)
 
+#define AXFR_PIPE_SIZE 16 // Maximum number of received messages awaiting insertion.
+
 enum state {
 	REFRESH_STATE_INVALID = 0,
 	STATE_SOA_QUERY,
@@ -111,6 +118,8 @@ struct refresh_data {
 	zone_master_fallback_t *fallback; //!< Flags allowing zone_master_try() fallbacks.
 	bool fallback_axfr;               //!< Flag allowing fallback to AXFR,
 	uint32_t expire_timer;            //!< Result: expire timer from answer EDNS.
+	unsigned xfr_limit;               //!< Limit of concurrent transfers from the remote.
+	size_t xfr_rate_limit;            //!< Limit of the transfer rate from the remote.
 
 	// internal state, initialize with zeroes:
 
@@ -121,15 +130,27 @@ struct refresh_data {
 	struct xfr_stats stats;           //!< Transfer statistics.
 	struct timespec started;          //!< When refresh started.
 	size_t change_size;               //!< Size of added and removed RRs.
+	bool xfr_slot;                    //!< Transfer slot of the remote acquired.
 
 	struct {
 		zone_contents_t *zone;    //!< AXFR result, new zone.
+		zcreator_t zc;            //!< Insertion into the new zone.
+		struct axfr_pipe *pipe;   //!< Insertion of the received messages.
 	} axfr;
 
 	struct {
 		struct ixfr_proc *proc;   //!< IXFR processing context.
 		knot_rrset_t *final_soa;  //!< SOA denoting end of transfer.
 		list_t changesets;        //!< IXFR result, zone updates.
+		unsigned count;           //!< Number of received changesets.
+		size_t buffered;          //!< Size of the not yet applied changes.
+		size_t window;            //!< Size of the changes to be applied in advance.
+		zone_update_t up;         //!< Zone update with the applied changes.
+		bool up_open;             //!< Indication of initialized zone update.
+		bool dnssec;              //!< Adjust SOA serials for signing.
+		unsigned serial_policy;   //!< Serial policy for signing.
+		uint32_t master_serial;   //!< Last remote serial when signing.
+		uint32_t local_serial;    //!< Last local serial when signing.
 	} ixfr;
 
 	bool updated;  // TODO: Can we fid a better way to check if zone was updated?
@@ -230,11 +251,19 @@ static int axfr_init(struct refresh_data *data)
 	}
 
 	data->axfr.zone = new_zone;
+	zcreator_clear(&data->axfr.zc);
+	data->axfr.zc.z = new_zone;
+	data->axfr.zc.master = false;
+	data->axfr.zc.ret = KNOT_EOK;
 	return KNOT_EOK;
 }
 
+static int axfr_pipe_stop(struct refresh_data *data);
+
 static void axfr_cleanup(struct refresh_data *data)
 {
+	(void)axfr_pipe_stop(data);
+	zcreator_clear(&data->axfr.zc);
 	zone_contents_deep_free(data->axfr.zone);
 	data->axfr.zone = NULL;
 }
@@ -267,8 +296,7 @@ static int axfr_finalize(struct refresh_data *data)
 {
 	zone_contents_t *new_zone = data->axfr.zone;
 
-	conf_val_t val = conf_zone_get(data->conf, C_DNSSEC_SIGNING, data->zone->name);
-	bool dnssec_enable = conf_bool(&val);
+	bool dnssec_enable = zone_is_signed(data->conf, data->zone);
 	uint32_t old_serial = zone_contents_serial(data->zone->contents), master_serial = 0;
 	bool bootstrap = (data->zone->contents == NULL);
 
@@ -285,7 +313,7 @@ static int axfr_finalize(struct refresh_data *data)
 	// Seized by zone_update. Don't free the contents again in axfr_cleanup.
 	data->axfr.zone = NULL;
 
-	ret = zone_update_semcheck(&up);
+	ret = zone_update_semcheck(data->conf, &up);
 	if (ret == KNOT_EOK) {
 		ret = zone_update_verify_digest(data->conf, &up);
 	}
@@ -294,7 +322,7 @@ static int axfr_finalize(struct refresh_data *data)
 		return ret;
 	}
 
-	val = conf_zone_get(data->conf, C_ZONEMD_GENERATE, data->zone->name);
+	conf_val_t val = conf_zone_get(data->conf, C_ZONEMD_GENERATE, data->zone->name);
 	unsigned digest_alg = conf_opt(&val);
 
 	if (dnssec_enable) {
@@ -341,20 +369,17 @@ static int axfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
 	assert(data);
 	assert(data->axfr.zone);
 
-	// zc is stateless structure which can be initialized for each rr
-	// the changes are stored only in data->axfr.zone (aka zc.z)
-	zcreator_t zc = {
-		.z = data->axfr.zone,
-		.master = false,
-		.ret = KNOT_EOK
-	};
+	// zc collects consecutive RRs of one RRSet, the changes are stored
+	// only in data->axfr.zone (aka zc.z)
+	zcreator_t *zc = &data->axfr.zc;
 
 	if (rr->type == KNOT_RRTYPE_SOA &&
-	    node_rrtype_exists(zc.z->apex, KNOT_RRTYPE_SOA)) {
-		return KNOT_STATE_DONE;
+	    node_rrtype_exists(zc->z->apex, KNOT_RRTYPE_SOA)) {
+		data->ret = zcreator_flush(zc);
+		return (data->ret == KNOT_EOK) ? KNOT_STATE_DONE : KNOT_STATE_FAIL;
 	}
 
-	data->ret = zcreator_step(&zc, rr);
+	data->ret = zcreator_step(zc, rr);
 	if (data->ret != KNOT_EOK) {
 		return KNOT_STATE_FAIL;
 	}
@@ -383,6 +408,182 @@ static int axfr_consume_packet(knot_pkt_t *pkt, struct refresh_data *data)
 	return ret;
 }
 
+/*!
+ * \brief Pipeline of the received AXFR messages.
+ *
+ * The requestor thread keeps receiving and verifying the messages while
+ * the records are inserted into the new zone contents in a separate thread.
+ */
+struct axfr_pipe {
+	struct refresh_data *data;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	knot_pkt_t *queue[AXFR_PIPE_SIZE];
+	unsigned head;
+	unsigned count;
+	bool eof;   // No more messages will be queued.
+	int state;  // State of the insertion.
+};
+
+static void *axfr_pipe_main(void *arg)
+{
+	struct axfr_pipe *pipe = arg;
+
+	pthread_mutex_lock(&pipe->lock);
+	while (true) {
+		while (pipe->count == 0 && !pipe->eof) {
+			pthread_cond_wait(&pipe->cond, &pipe->lock);
+		}
+		if (pipe->count == 0) {
+			break;
+		}
+
+		knot_pkt_t *pkt = pipe->queue[pipe->head];
+		pipe->head = (pipe->head + 1) % AXFR_PIPE_SIZE;
+		pipe->count--;
+		int state = pipe->state;
+		pthread_cond_signal(&pipe->cond);
+		pthread_mutex_unlock(&pipe->lock);
+
+		if (state == KNOT_STATE_CONSUME) {
+			int ret = knot_pkt_parse(pkt, 0);
+			if (ret != KNOT_EOK) {
+				pipe->data->ret = ret;
+				state = KNOT_STATE_FAIL;
+			} else {
+				state = axfr_consume_packet(pkt, pipe->data);
+			}
+		}
+		knot_pkt_free(pkt);
+
+		pthread_mutex_lock(&pipe->lock);
+		pipe->state = state;
+	}
+	pthread_mutex_unlock(&pipe->lock);
+
+	return NULL;
+}
+
+/*! \brief Starts the pipeline, the messages are inserted directly on failure. */
+static void axfr_pipe_start(struct refresh_data *data)
+{
+	struct axfr_pipe *pipe = calloc(1, sizeof(*pipe));
+	if (pipe == NULL) {
+		return;
+	}
+
+	pipe->data = data;
+	pipe->state = KNOT_STATE_CONSUME;
+	pthread_mutex_init(&pipe->lock, NULL);
+	pthread_cond_init(&pipe->cond, NULL);
+
+	/* The inserting thread mustn't receive the server signals. */
+	sigset_t all, orig;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &orig);
+	int ret = pthread_create(&pipe->thread, NULL, axfr_pipe_main, pipe);
+	pthread_sigmask(SIG_SETMASK, &orig, NULL);
+
+	if (ret != 0) {
+		pthread_cond_destroy(&pipe->cond);
+		pthread_mutex_destroy(&pipe->lock);
+		free(pipe);
+		return;
+	}
+
+	data->axfr.pipe = pipe;
+}
+
+/*! \brief Waits for the queued messages to be inserted and stops the pipeline. */
+static int axfr_pipe_stop(struct refresh_data *data)
+{
+	struct axfr_pipe *pipe = data->axfr.pipe;
+	if (pipe == NULL) {
+		return KNOT_STATE_CONSUME;
+	}
+
+	pthread_mutex_lock(&pipe->lock);
+	pipe->eof = true;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+
+	pthread_join(pipe->thread, NULL);
+
+	int state = pipe->state;
+	pthread_cond_destroy(&pipe->cond);
+	pthread_mutex_destroy(&pipe->lock);
+	free(pipe);
+	data->axfr.pipe = NULL;
+
+	return state;
+}
+
+static int axfr_pipe_push(struct axfr_pipe *pipe, const knot_pkt_t *pkt)
+{
+	knot_pkt_t *copy = knot_pkt_new(NULL, pkt->size, NULL);
+	if (copy == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(copy->wire, pkt->wire, pkt->size);
+	copy->size = pkt->size;
+
+	pthread_mutex_lock(&pipe->lock);
+	while (pipe->count == AXFR_PIPE_SIZE && pipe->state == KNOT_STATE_CONSUME) {
+		pthread_cond_wait(&pipe->cond, &pipe->lock);
+	}
+	if (pipe->state != KNOT_STATE_CONSUME) {
+		pthread_mutex_unlock(&pipe->lock);
+		knot_pkt_free(copy);
+		return KNOT_EOK; // The insertion already finished.
+	}
+	pipe->queue[(pipe->head + pipe->count) % AXFR_PIPE_SIZE] = copy;
+	pipe->count++;
+	pthread_cond_signal(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+
+	return KNOT_EOK;
+}
+
+static int axfr_pipe_state(struct axfr_pipe *pipe)
+{
+	pthread_mutex_lock(&pipe->lock);
+	int state = pipe->state;
+	pthread_mutex_unlock(&pipe->lock);
+
+	return state;
+}
+
+/*! \brief Checks if the message terminates the transfer (apex SOA already received). */
+static bool axfr_pkt_final(const knot_pkt_t *pkt)
+{
+	const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
+	for (uint16_t i = 0; i < answer->count; ++i) {
+		if (knot_pkt_rr(answer, i)->type == KNOT_RRTYPE_SOA) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int axfr_pipe_consume(knot_pkt_t *pkt, struct refresh_data *data)
+{
+	int ret = axfr_pipe_push(data->axfr.pipe, pkt);
+	if (ret == KNOT_EOK && !axfr_pkt_final(pkt) &&
+	    axfr_pipe_state(data->axfr.pipe) == KNOT_STATE_CONSUME) {
+		return KNOT_STATE_CONSUME;
+	}
+
+	// The pipeline is stopped, so the insertion results can be read.
+	int next = axfr_pipe_stop(data);
+	if (next == KNOT_STATE_CONSUME && ret != KNOT_EOK) {
+		data->ret = ret;
+		next = KNOT_STATE_FAIL;
+	}
+
+	return next;
+}
+
 static int axfr_consume(knot_pkt_t *pkt, struct refresh_data *data)
 {
 	assert(pkt);
@@ -426,7 +627,15 @@ static int axfr_consume(knot_pkt_t *pkt, struct refresh_data *data)
 
 	// Process answer packet
 	xfr_stats_add(&data->stats, pkt->size);
-	next = axfr_consume_packet(pkt, data);
+	if (data->axfr.pipe != NULL) {
+		next = axfr_pipe_consume(pkt, data);
+	} else {
+		next = axfr_consume_packet(pkt, data);
+		if (next == KNOT_STATE_CONSUME) {
+			// Insert the following messages in parallel with receiving.
+			axfr_pipe_start(data);
+		}
+	}
 
 	// Finalize
 	if (next == KNOT_STATE_DONE) {
@@ -437,6 +646,29 @@ static int axfr_consume(knot_pkt_t *pkt, struct refresh_data *data)
 }
 
 /*! \brief Initialize IXFR-in processing context. */
+static int ixfr_serial_init(struct refresh_data *data)
+{
+	zone_t *zone = data->zone;
+	uint32_t lastsigned;
+
+	data->ixfr.local_serial = zone_contents_serial(zone->contents);
+	if (zone_get_lastsigned_serial(zone, &lastsigned) != KNOT_EOK ||
+	    lastsigned != data->ixfr.local_serial) {
+		// this is kind of assert
+		return KNOT_ERROR;
+	}
+
+	conf_val_t val = conf_zone_get(data->conf, C_SERIAL_POLICY, zone->name);
+	data->ixfr.serial_policy = conf_opt(&val);
+
+	int ret = zone_get_master_serial(zone, &data->ixfr.master_serial);
+	if (ret != KNOT_EOK) {
+		log_zone_error(zone->name, "failed to read master serial"
+		                           "from KASP DB (%s)", knot_strerror(ret));
+	}
+	return ret;
+}
+
 static int ixfr_init(struct refresh_data *data)
 {
 	struct ixfr_proc *proc = mm_alloc(data->mm, sizeof(*proc));
@@ -450,12 +682,29 @@ static int ixfr_init(struct refresh_data *data)
 
 	data->ixfr.proc = proc;
 	data->ixfr.final_soa = NULL;
+	data->ixfr.count = 0;
+	data->ixfr.buffered = 0;
+	data->ixfr.up_open = false;
+	data->ixfr.master_serial = 0;
 
 	init_list(&data->ixfr.changesets);
 
+	conf_val_t val = conf_zone_get(data->conf, C_IXFR_APPLY_WINDOW, data->zone->name);
+	data->ixfr.window = conf_int(&val);
+
+	data->ixfr.dnssec = zone_is_signed(data->conf, data->zone);
+
 	return KNOT_EOK;
 }
 
+static void ixfr_update_clear(struct refresh_data *data)
+{
+	if (data->ixfr.up_open) {
+		zone_update_clear(&data->ixfr.up);
+		data->ixfr.up_open = false;
+	}
+}
+
 /*! \brief Clean up data allocated by IXFR-in processing. */
 static void ixfr_cleanup(struct refresh_data *data)
 {
@@ -469,132 +718,160 @@ static void ixfr_cleanup(struct refresh_data *data)
 	data->ixfr.proc = NULL;
 
 	changesets_free(&data->ixfr.changesets);
+	ixfr_update_clear(data);
+}
+
+/*! \brief Replaces the starting serial of the changeset from unsigned remote. */
+static bool ixfr_serial_from(changeset_t *ch, struct refresh_data *data)
+{
+	if (changeset_from(ch) != data->ixfr.master_serial) {
+		return false;
+	}
+
+	knot_soa_serial_set(ch->soa_from->rrs.rdata, data->ixfr.local_serial);
+
+	return true;
 }
 
-static bool ixfr_serial_once(changeset_t *ch, int policy, uint32_t *master_serial, uint32_t *local_serial)
+/*! \brief Replaces the ending serial of the changeset from unsigned remote. */
+static bool ixfr_serial_to(changeset_t *ch, struct refresh_data *data)
 {
-	uint32_t ch_from = changeset_from(ch), ch_to = changeset_to(ch);
+	uint32_t ch_to = changeset_to(ch);
 
-	if (ch_from != *master_serial || (serial_compare(ch_from, ch_to) & SERIAL_MASK_GEQ)) {
+	if (serial_compare(data->ixfr.master_serial, ch_to) & SERIAL_MASK_GEQ) {
 		return false;
 	}
 
-	uint32_t new_from = *local_serial;
-	uint32_t new_to = serial_next(new_from, policy, 1);
-	knot_soa_serial_set(ch->soa_from->rrs.rdata, new_from);
+	uint32_t new_to = serial_next(data->ixfr.local_serial, data->ixfr.serial_policy, 1);
 	knot_soa_serial_set(ch->soa_to->rrs.rdata, new_to);
 
-	*master_serial = ch_to;
-	*local_serial = new_to;
+	data->ixfr.master_serial = ch_to;
+	data->ixfr.local_serial = new_to;
 
 	return true;
 }
 
-static int ixfr_slave_sign_serial(list_t *changesets, zone_t *zone,
-                                  conf_t *conf, uint32_t *master_serial)
+/*! \brief Starts a changeset continuing the already applied one. */
+static int ixfr_continue(struct refresh_data *data, const changeset_t *applied)
 {
-	uint32_t local_serial = zone_contents_serial(zone->contents), lastsigned;
-
-	if (zone_get_lastsigned_serial(zone, &lastsigned) != KNOT_EOK || lastsigned != local_serial) {
-		// this is kind of assert
-		return KNOT_ERROR;
+	changeset_t *cont = changeset_new(data->zone->name);
+	if (cont == NULL) {
+		return KNOT_ENOMEM;
 	}
 
-	conf_val_t val = conf_zone_get(conf, C_SERIAL_POLICY, zone->name);
-	unsigned serial_policy = conf_opt(&val);
-
-	int ret = zone_get_master_serial(zone, master_serial);
-	if (ret != KNOT_EOK) {
-		log_zone_error(zone->name, "failed to read master serial"
-		                           "from KASP DB (%s)", knot_strerror(ret));
-		return ret;
+	if (applied->soa_from != NULL) {
+		cont->soa_from = knot_rrset_copy(applied->soa_from, NULL);
 	}
-	changeset_t *chs;
-	WALK_LIST(chs, *changesets) {
-		if (!ixfr_serial_once(chs, serial_policy, master_serial, &local_serial)) {
-			return KNOT_EINVAL;
-		}
+	if (applied->soa_to != NULL) {
+		cont->soa_to = knot_rrset_copy(applied->soa_to, NULL);
+	}
+	if ((applied->soa_from != NULL && cont->soa_from == NULL) ||
+	    (applied->soa_to != NULL && cont->soa_to == NULL)) {
+		changeset_free(cont);
+		return KNOT_ENOMEM;
 	}
 
+	add_tail(&data->ixfr.changesets, &cont->n);
+
 	return KNOT_EOK;
 }
 
-static int ixfr_finalize(struct refresh_data *data)
+/*!
+ * \brief Applies the received changesets into the zone update and frees them.
+ *
+ * \param data   Refresh data.
+ * \param final  The transfer is complete, otherwise the last incomplete
+ *               changeset is continued.
+ */
+static int ixfr_apply(struct refresh_data *data, bool final)
 {
-	conf_val_t val = conf_zone_get(data->conf, C_DNSSEC_SIGNING, data->zone->name);
-	bool dnssec_enable = conf_bool(&val);
-	uint32_t master_serial = 0, old_serial = zone_contents_serial(data->zone->contents);
-
-	if (dnssec_enable) {
-		int ret = ixfr_slave_sign_serial(&data->ixfr.changesets, data->zone, data->conf, &master_serial);
+	if (!data->ixfr.up_open) {
+		int ret = zone_update_init(&data->ixfr.up, data->zone,
+		                           UPDATE_INCREMENTAL | UPDATE_STRICT | UPDATE_NO_CHSET);
 		if (ret != KNOT_EOK) {
-			IXFRIN_LOG(LOG_WARNING, data,
-			           "failed to adjust SOA serials from unsigned remote (%s)",
-			           knot_strerror(ret));
 			data->fallback_axfr = false;
 			data->fallback->remote = false;
 			return ret;
 		}
+		data->ixfr.up_open = true;
 	}
 
-	zone_update_t up = { 0 };
-	int ret = zone_update_init(&up, data->zone, UPDATE_INCREMENTAL | UPDATE_STRICT | UPDATE_NO_CHSET);
-	if (ret != KNOT_EOK) {
-		data->fallback_axfr = false;
-		data->fallback->remote = false;
-		return ret;
-	}
-
-	changeset_t *set;
-	WALK_LIST(set, data->ixfr.changesets) {
-		ret = zone_update_apply_changeset(&up, set);
+	changeset_t *set, *nxt;
+	WALK_LIST_DELSAFE(set, nxt, data->ixfr.changesets) {
+		int ret = zone_update_apply_changeset(&data->ixfr.up, set);
 		if (ret != KNOT_EOK) {
-			uint32_t serial_from = knot_soa_serial(set->soa_from->rrs.rdata);
-			uint32_t serial_to = knot_soa_serial(set->soa_to->rrs.rdata);
-			zone_update_clear(&up);
+			const knot_rrset_t *soa_to = set->soa_to != NULL ? set->soa_to :
+			                                                     data->ixfr.final_soa;
 			IXFRIN_LOG(LOG_WARNING, data,
 			           "serial %u -> %u, failed to apply changes to zone (%s)",
-			           serial_from, serial_to, knot_strerror(ret));
+			           knot_soa_serial(set->soa_from->rrs.rdata),
+			           knot_soa_serial(soa_to->rrs.rdata), knot_strerror(ret));
 			return ret;
 		}
+
+		if (!final && set == TAIL(data->ixfr.changesets)) {
+			ret = ixfr_continue(data, set);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+		rem_node(&set->n);
+		changeset_free(set);
+	}
+	data->ixfr.buffered = 0;
+
+	return KNOT_EOK;
+}
+
+static int ixfr_finalize(struct refresh_data *data)
+{
+	bool dnssec_enable = data->ixfr.dnssec;
+	uint32_t old_serial = zone_contents_serial(data->zone->contents);
+
+	int ret = ixfr_apply(data, true);
+	if (ret != KNOT_EOK) {
+		ixfr_update_clear(data);
+		return ret;
 	}
+	zone_update_t *up = &data->ixfr.up;
 
-	ret = zone_update_semcheck(&up);
+	ret = zone_update_semcheck(data->conf, up);
 	if (ret == KNOT_EOK) {
-		ret = zone_update_verify_digest(data->conf, &up);
+		ret = zone_update_verify_digest(data->conf, up);
 	}
 	if (ret != KNOT_EOK) {
-		zone_update_clear(&up);
+		ixfr_update_clear(data);
 		data->fallback_axfr = false;
 		return ret;
 	}
 
-	val = conf_zone_get(data->conf, C_ZONEMD_GENERATE, data->zone->name);
+	conf_val_t val = conf_zone_get(data->conf, C_ZONEMD_GENERATE, data->zone->name);
 	unsigned digest_alg = conf_opt(&val);
 
 	if (dnssec_enable) {
-		ret = knot_dnssec_sign_update(&up, data->conf);
+		ret = knot_dnssec_sign_update(up, data->conf);
 	} else if (digest_alg != ZONE_DIGEST_NONE) {
-		assert(zone_update_to(&up) != NULL);
-		ret = zone_update_add_digest(&up, digest_alg, false);
+		assert(zone_update_to(up) != NULL);
+		ret = zone_update_add_digest(up, digest_alg, false);
 	}
 	if (ret != KNOT_EOK) {
-		zone_update_clear(&up);
+		ixfr_update_clear(data);
 		data->fallback_axfr = false;
 		data->fallback->remote = false;
 		return ret;
 	}
 
-	ret = zone_update_commit(data->conf, &up);
+	ret = zone_update_commit(data->conf, up);
 	if (ret != KNOT_EOK) {
-		zone_update_clear(&up);
+		ixfr_update_clear(data);
 		IXFRIN_LOG(LOG_WARNING, data,
 		           "failed to store changes (%s)", knot_strerror(ret));
 		return ret;
 	}
+	data->ixfr.up_open = false;
 
-	if (dnssec_enable && !EMPTY_LIST(data->ixfr.changesets)) {
-		ret = zone_set_master_serial(data->zone, master_serial);
+	if (dnssec_enable && data->ixfr.count > 0) {
+		ret = zone_set_master_serial(data->zone, data->ixfr.master_serial);
 		if (ret != KNOT_EOK) {
 			log_zone_warning(data->zone->name,
 			"unable to save master serial, future transfers might be broken");
@@ -603,7 +880,7 @@ static int ixfr_finalize(struct refresh_data *data)
 
 	finalize_edns_expire(data);
 	xfr_log_publish(data, old_serial, zone_contents_serial(data->zone->contents),
-	                master_serial, dnssec_enable, false);
+	                data->ixfr.master_serial, dnssec_enable, false);
 
 	return KNOT_EOK;
 }
@@ -628,6 +905,16 @@ static int ixfr_solve_start(const knot_rrset_t *rr, struct refresh_data *data)
 	return KNOT_EOK;
 }
 
+static int ixfr_serial_fail(struct refresh_data *data)
+{
+	IXFRIN_LOG(LOG_WARNING, data,
+	           "failed to adjust SOA serials from unsigned remote");
+	data->fallback_axfr = false;
+	data->fallback->remote = false;
+
+	return KNOT_EINVAL;
+}
+
 /*! \brief Decides what to do with a starting SOA (deletions). */
 static int ixfr_solve_soa_del(const knot_rrset_t *rr, struct refresh_data *data)
 {
@@ -650,12 +937,18 @@ static int ixfr_solve_soa_del(const knot_rrset_t *rr, struct refresh_data *data)
 
 	// Add changeset.
 	add_tail(&data->ixfr.changesets, &change->n);
+	data->ixfr.count++;
+
+	if (data->ixfr.dnssec && !ixfr_serial_from(change, data)) {
+		return ixfr_serial_fail(data);
+	}
 
 	return KNOT_EOK;
 }
 
 /*! \brief Stores ending SOA into changeset. */
-static int ixfr_solve_soa_add(const knot_rrset_t *rr, changeset_t *change, knot_mm_t *mm)
+static int ixfr_solve_soa_add(const knot_rrset_t *rr, changeset_t *change,
+                              struct refresh_data *data)
 {
 	if (rr->type != KNOT_RRTYPE_SOA) {
 		return KNOT_EMALF;
@@ -666,6 +959,10 @@ static int ixfr_solve_soa_add(const knot_rrset_t *rr, changeset_t *change, knot_
 		return KNOT_ENOMEM;
 	}
 
+	if (data->ixfr.dnssec && !ixfr_serial_to(change, data)) {
+		return ixfr_serial_fail(data);
+	}
+
 	return KNOT_EOK;
 }
 
@@ -737,7 +1034,7 @@ static int ixfr_step(const knot_rrset_t *rr, struct refresh_data *data)
 	case IXFR_DEL:
 		return ixfr_solve_del(rr, change, data->mm);
 	case IXFR_SOA_ADD:
-		return ixfr_solve_soa_add(rr, change, data->mm);
+		return ixfr_solve_soa_add(rr, change, data);
 	case IXFR_ADD:
 		return ixfr_solve_add(rr, change, data->mm);
 	case IXFR_DONE:
@@ -760,7 +1057,9 @@ static int ixfr_consume_rr(const knot_rrset_t *rr, struct refresh_data *data)
 		return KNOT_STATE_FAIL;
 	}
 
-	data->change_size += knot_rrset_size(rr);
+	size_t rr_size = knot_rrset_size(rr);
+	data->ixfr.buffered += rr_size;
+	data->change_size += rr_size;
 	if (data->change_size / 2 > data->max_zone_size) {
 		IXFRIN_LOG(LOG_WARNING, data,
 		           "transfer size exceeded");
@@ -908,6 +1207,18 @@ static int ixfr_consume(knot_pkt_t *pkt, struct refresh_data *data)
 			return KNOT_STATE_FAIL;
 		}
 
+		if (data->ixfr.dnssec) {
+			data->ret = ixfr_serial_init(data);
+			if (data->ret != KNOT_EOK) {
+				IXFRIN_LOG(LOG_WARNING, data,
+				           "failed to adjust SOA serials from unsigned remote (%s)",
+				           knot_strerror(data->ret));
+				data->fallback_axfr = false;
+				data->fallback->remote = false;
+				return KNOT_STATE_FAIL;
+			}
+		}
+
 		IXFRIN_LOG(LOG_INFO, data, "started");
 		xfr_stats_begin(&data->stats);
 		data->change_size = 0;
@@ -928,6 +1239,14 @@ static int ixfr_consume(knot_pkt_t *pkt, struct refresh_data *data)
 	xfr_stats_add(&data->stats, pkt->size);
 	next = ixfr_consume_packet(pkt, data);
 
+	// Apply the buffered changes in advance
+	if (next == KNOT_STATE_CONSUME && data->ixfr.buffered > data->ixfr.window) {
+		data->ret = ixfr_apply(data, false);
+		if (data->ret != KNOT_EOK) {
+			return KNOT_STATE_FAIL;
+		}
+	}
+
 	// Finalize
 	if (next == KNOT_STATE_DONE) {
 		xfr_stats_end(&data->stats);
@@ -1013,6 +1332,21 @@ static int transfer_produce(knot_layer_t *layer, knot_pkt_t *pkt)
 {
 	struct refresh_data *data = layer->data;
 
+	if (!data->xfr_slot) {
+		data->ret = xfr_sched_acquire(data->zone,
+		                              (const struct sockaddr_storage *)data->remote,
+		                              data->xfr_limit, data->xfr_rate_limit);
+		if (data->ret != KNOT_EOK) {
+			if (data->ret == KNOT_EBUSY) {
+				REFRESH_LOG(LOG_INFO, data, LOG_DIRECTION_NONE,
+				            "transfer postponed, remote busy");
+			}
+			data->fallback->remote = false;
+			return KNOT_STATE_FAIL;
+		}
+		data->xfr_slot = true;
+	}
+
 	query_init_pkt(pkt);
 
 	bool ixfr = (data->xfr_type == XFR_TYPE_IXFR);
@@ -1193,6 +1527,7 @@ static size_t max_zone_size(conf_t *conf, const knot_dname_t *zone)
 typedef struct {
 	bool force_axfr;
 	bool send_notify;
+	bool updated;
 	uint32_t expire_timer;
 } try_refresh_ctx_t;
 
@@ -1225,6 +1560,8 @@ static int try_refresh(conf_t *conf, zone_t *zone, const conf_remote_t *master,
 		.expire_timer = EXPIRE_TIMER_INVALID,
 		.fallback = fallback,
 		.fallback_axfr = false, // will be set upon IXFR consume
+		.xfr_limit = master->xfr_limit,
+		.xfr_rate_limit = master->xfr_rate_limit,
 	};
 
 	knot_requestor_t requestor;
@@ -1239,6 +1576,9 @@ static int try_refresh(conf_t *conf, zone_t *zone, const conf_remote_t *master,
 	const struct sockaddr_storage *dst = &master->addr;
 	const struct sockaddr_storage *src = &master->via;
 	knot_request_flag_t flags = conf->cache.srv_tcp_fastopen ? KNOT_REQUEST_TFO : 0;
+	if (data.soa != NULL) {
+		flags |= KNOT_REQUEST_MUX; // Only for the SOA query.
+	}
 	knot_request_t *req = knot_request_make(NULL, dst, src, pkt, &master->key, flags);
 	if (!req) {
 		knot_request_free(req, NULL);
@@ -1266,8 +1606,13 @@ static int try_refresh(conf_t *conf, zone_t *zone, const conf_remote_t *master,
 	knot_request_free(req, NULL);
 	knot_requestor_clear(&requestor);
 
+	if (data.xfr_slot) {
+		xfr_sched_release(&master->addr, data.stats.bytes);
+	}
+
 	if (ret == KNOT_EOK) {
 		trctx->send_notify = data.updated && !master->block_notify_after_xfr;
+		trctx->updated = data.updated;
 		trctx->force_axfr = false;
 		trctx->expire_timer = data.expire_timer;
 	}
@@ -1295,6 +1640,12 @@ int event_refresh(conf_t *conf, zone_t *zone)
 		return KNOT_ENOTSUP;
 	}
 
+	// Don't bootstrap an unloaded zone, the refresh follows its load.
+	if (zone->contents == NULL && zone_get_flag(zone, ZONE_IS_UNLOADED, false)) {
+		zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
+		return KNOT_EOK;
+	}
+
 	try_refresh_ctx_t trctx = { .expire_timer = EXPIRE_TIMER_INVALID };
 
 	// TODO: Flag on zone is ugly. Event specific parameters would be nice.
@@ -1305,8 +1656,13 @@ int event_refresh(conf_t *conf, zone_t *zone)
 
 	int ret = zone_master_try(conf, zone, try_refresh, &trctx, "refresh");
 	zone_clear_preferred_master(zone);
-	if (ret != KNOT_EOK) {
+	if (ret != KNOT_EOK && ret != KNOT_EBUSY) {
 		log_zone_error(zone->name, "refresh, failed (%s)", knot_strerror(ret));
+		subscribe_emit(SUBSCRIBE_REFRESH, zone->name, "refresh", "failed (%s)",
+		               knot_strerror(ret));
+	} else if (ret == KNOT_EOK) {
+		subscribe_emit(SUBSCRIBE_REFRESH, zone->name, "refresh", "%s",
+		               trctx.updated ? "updated" : "up-to-date");
 	}
 
 	time_t now = time(NULL);
@@ -1317,6 +1673,10 @@ int event_refresh(conf_t *conf, zone_t *zone)
 		zone->timers.next_expire = now + trctx.expire_timer;
 		zone->timers.next_refresh = now + knot_soa_refresh(soa->rdata);
 		zone->timers.last_refresh_ok = true;
+	} else if (ret == KNOT_EBUSY) {
+		/* Rescheduled by the transfer scheduler, this is just a fallback. */
+		zone->timers.next_refresh = now + (soa ? knot_soa_retry(soa->rdata) :
+		                                         XFR_SCHED_RECHECK);
 	} else {
 		time_t next;
 		if (soa) {
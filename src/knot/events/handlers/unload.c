@@ -0,0 +1,85 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <urcu.h>
+
+#include "knot/common/log.h"
+#include "knot/conf/conf.h"
+#include "knot/events/handlers.h"
+#include "knot/zone/contents.h"
+#include "knot/zone/zone.h"
+
+/*!
+ * \brief Check if the current contents can be loaded again without any change.
+ */
+static bool can_unload(conf_t *conf, zone_t *zone)
+{
+	if (zone->is_catalog_flag || zone->cat_members != NULL ||
+	    zone->control_update != NULL || zone_is_signed(conf, zone)) {
+		return false;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_JOURNAL_CONTENT, zone->name);
+	unsigned journal_content = conf_opt(&val);
+	val = conf_zone_get(conf, C_ZONEFILE_LOAD, zone->name);
+	unsigned zf_load = conf_opt(&val);
+
+	// The whole zone is stored in the journal.
+	if (journal_content == JOURNAL_CONTENT_ALL && zf_load != ZONEFILE_LOAD_WHOLE) {
+		return zone_journal_has_zij(zone);
+	}
+
+	// The zone file (or its snapshot), possibly with the journal changes.
+	if (zf_load == ZONEFILE_LOAD_NONE || zf_load == ZONEFILE_LOAD_DIFSE ||
+	    !zone->zonefile.exists) {
+		return false;
+	}
+	return journal_content != JOURNAL_CONTENT_NONE ||
+	       zone->zonefile.serial == zone_contents_serial(zone->contents);
+}
+
+int event_unload(conf_t *conf, zone_t *zone)
+{
+	assert(zone);
+
+	conf_val_t val = conf_zone_get(conf, C_IDLE_UNLOAD, zone->name);
+	int64_t idle = conf_int(&val);
+	if (idle <= 0 || zone->contents == NULL) {
+		return KNOT_EOK;
+	}
+
+	time_t last_used = __atomic_load_n(&zone->last_used, __ATOMIC_RELAXED);
+	if (time(NULL) < last_used + idle) {
+		zone_events_schedule_at(zone, ZONE_EVENT_UNLOAD, last_used + idle);
+		return KNOT_EOK;
+	}
+
+	if (!can_unload(conf, zone)) {
+		return KNOT_EOK;
+	}
+
+	zone_set_flag(zone, ZONE_IS_UNLOADED);
+	zone_contents_t *old = zone_switch_contents(zone, NULL);
+	log_zone_info(zone->name, "unloaded, idle for %"PRId64" seconds",
+	              (int64_t)(time(NULL) - last_used));
+
+	knot_sem_wait(&zone->cow_lock);
+	zone_retire_contents(old);
+	knot_sem_post(&zone->cow_lock);
+
+	return KNOT_EOK;
+}
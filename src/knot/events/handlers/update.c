@@ -20,6 +20,7 @@
 #include "knot/nameserver/log.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/capture.h"
+#include "knot/query/mux.h"
 #include "knot/query/requestor.h"
 #include "knot/updates/ddns.h"
 #include "knot/zone/digest.h"
@@ -147,9 +148,8 @@ static int process_normal(conf_t *conf, zone_t *zone, list_t *requests)
 	}
 
 	// Sign update.
-	conf_val_t val = conf_zone_get(conf, C_DNSSEC_SIGNING, zone->name);
-	bool dnssec_enable = conf_bool(&val);
-	val = conf_zone_get(conf, C_ZONEMD_GENERATE, zone->name);
+	bool dnssec_enable = zone_is_signed(conf, zone);
+	conf_val_t val = conf_zone_get(conf, C_ZONEMD_GENERATE, zone->name);
 	unsigned digest_alg = conf_opt(&val);
 	if (dnssec_enable) {
 		ret = knot_dnssec_sign_update(&up, conf);
@@ -214,18 +214,30 @@ static void process_requests(conf_t *conf, zone_t *zone, list_t *requests)
 	zone_events_schedule_at(zone, ZONE_EVENT_NOTIFY, time(NULL) + 1);
 }
 
-static int remote_forward(conf_t *conf, knot_request_t *request, conf_remote_t *remote)
+/*! \brief Copies the update to be forwarded and assigns it a new ID. */
+static knot_pkt_t *forward_query(const knot_pkt_t *orig, int *ret)
 {
-	/* Copy request and assign new ID. */
-	knot_pkt_t *query = knot_pkt_new(NULL, request->query->max_size, NULL);
-	int ret = knot_pkt_copy(query, request->query);
-	if (ret != KNOT_EOK) {
+	knot_pkt_t *query = knot_pkt_new(NULL, orig->max_size, NULL);
+	*ret = knot_pkt_copy(query, orig);
+	if (*ret != KNOT_EOK) {
 		knot_pkt_free(query);
-		return ret;
+		return NULL;
 	}
 	knot_wire_set_id(query->wire, dnssec_random_uint16_t());
 	knot_tsig_append(query->wire, &query->size, query->max_size, query->tsig_rr);
 
+	return query;
+}
+
+static int remote_forward(conf_t *conf, knot_request_t *request, conf_remote_t *remote)
+{
+	/* Copy request and assign new ID. */
+	int ret = KNOT_EOK;
+	knot_pkt_t *query = forward_query(request->query, &ret);
+	if (query == NULL) {
+		return ret;
+	}
+
 	/* Prepare packet capture layer. */
 	const knot_layer_api_t *capture = query_capture_api();
 	struct capture_param capture_param = {
@@ -261,7 +273,96 @@ static int remote_forward(conf_t *conf, knot_request_t *request, conf_remote_t *
 	return ret;
 }
 
-static void forward_request(conf_t *conf, zone_t *zone, knot_request_t *request)
+/*! \brief Update forwarded over a shared connection. */
+typedef struct {
+	knot_request_t *request;  /*!< Update from the client. */
+	knot_pkt_t *query;        /*!< Forwarded copy of the update. */
+	knot_pkt_t *resp;         /*!< Response from the master. */
+	query_mux_wait_t *wait;   /*!< In-flight query. */
+	bool done;                /*!< The response was received. */
+	int ret;                  /*!< Result of the last attempt. */
+} forward_t;
+
+static void forward_drop(forward_t *f)
+{
+	query_mux_unregister(global_query_mux, f->wait);
+	f->wait = NULL;
+	knot_pkt_free(f->query);
+	f->query = NULL;
+}
+
+/*!
+ * \brief Forwards the pending updates to the remote at once.
+ *
+ * All the updates are sent before waiting for the responses, so they are
+ * in flight concurrently on one connection and matched by the message ID.
+ */
+static void remote_forward_pipelined(conf_t *conf, forward_t *fwds, size_t count,
+                                     conf_remote_t *remote)
+{
+	int timeout = conf->cache.srv_tcp_remote_io_timeout;
+
+	for (size_t i = 0; i < count; i++) {
+		forward_t *f = &fwds[i];
+		if (f->done) {
+			continue;
+		}
+
+		f->query = forward_query(f->request->query, &f->ret);
+		if (f->query == NULL) {
+			continue;
+		}
+
+		bool reused = false;
+		f->ret = query_mux_register(global_query_mux, &remote->via, &remote->addr,
+		                            f->query, f->resp, &reused, &f->wait);
+		if (f->ret == KNOT_EOK) {
+			f->ret = query_mux_send(global_query_mux, f->wait, timeout);
+		}
+		if (f->ret != KNOT_EOK) {
+			forward_drop(f);
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		forward_t *f = &fwds[i];
+		if (f->wait == NULL) {
+			continue;
+		}
+
+		int ret = query_mux_recv(global_query_mux, f->wait, timeout);
+		forward_drop(f);
+		if (ret > 0) {
+			ret = knot_pkt_parse(f->resp, 0);
+		} else if (ret == 0) {
+			ret = KNOT_ECONN;
+		}
+		if (ret == KNOT_EOK) {
+			ret = knot_pkt_copy(f->request->resp, f->resp);
+		}
+		f->done = (ret == KNOT_EOK);
+		f->ret = ret;
+	}
+}
+
+static void forward_finish(zone_t *zone, knot_request_t *request, int ret)
+{
+	/* Restore message ID and TSIG. */
+	knot_wire_set_id(request->resp->wire, knot_wire_get_id(request->query->wire));
+	knot_tsig_append(request->resp->wire, &request->resp->size,
+	                 request->resp->max_size, request->resp->tsig_rr);
+
+	/* Set RCODE if forwarding failed. */
+	if (ret != KNOT_EOK) {
+		knot_wire_set_rcode(request->resp->wire, KNOT_RCODE_SERVFAIL);
+		log_zone_error(zone->name, "DDNS, failed to forward updates to the master (%s)",
+		               knot_strerror(ret));
+	} else {
+		log_zone_info(zone->name, "DDNS, updates forwarded to the master");
+	}
+}
+
+static conf_val_t forward_remote(conf_t *conf, zone_t *zone, size_t *addr_count)
 {
 	/* Read the ddns master or the first master. */
 	conf_val_t remote = conf_zone_get(conf, C_DDNS_MASTER, zone->name);
@@ -271,8 +372,16 @@ static void forward_request(conf_t *conf, zone_t *zone, knot_request_t *request)
 
 	/* Get the number of remote addresses. */
 	conf_val_t addr = conf_id_get(conf, C_RMT, C_ADDR, &remote);
-	size_t addr_count = conf_val_count(&addr);
-	assert(addr_count > 0);
+	*addr_count = conf_val_count(&addr);
+	assert(*addr_count > 0);
+
+	return remote;
+}
+
+static void forward_request(conf_t *conf, zone_t *zone, knot_request_t *request)
+{
+	size_t addr_count;
+	conf_val_t remote = forward_remote(conf, zone, &addr_count);
 
 	/* Try all remote addresses to forward the request to. */
 	int ret = KNOT_EOK;
@@ -285,19 +394,51 @@ static void forward_request(conf_t *conf, zone_t *zone, knot_request_t *request)
 		}
 	}
 
-	/* Restore message ID and TSIG. */
-	knot_wire_set_id(request->resp->wire, knot_wire_get_id(request->query->wire));
-	knot_tsig_append(request->resp->wire, &request->resp->size,
-	                 request->resp->max_size, request->resp->tsig_rr);
+	forward_finish(zone, request, ret);
+}
 
-	/* Set RCODE if forwarding failed. */
-	if (ret != KNOT_EOK) {
-		knot_wire_set_rcode(request->resp->wire, KNOT_RCODE_SERVFAIL);
-		log_zone_error(zone->name, "DDNS, failed to forward updates to the master (%s)",
-		               knot_strerror(ret));
-	} else {
-		log_zone_info(zone->name, "DDNS, updates forwarded to the master");
+static bool forward_pipelined(conf_t *conf, zone_t *zone, list_t *requests)
+{
+	size_t count = list_size(requests);
+	forward_t *fwds = calloc(count, sizeof(*fwds));
+	if (fwds == NULL) {
+		return false;
+	}
+
+	size_t i = 0;
+	ptrnode_t *node;
+	WALK_LIST(node, *requests) {
+		fwds[i].request = node->d;
+		fwds[i].resp = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+		fwds[i].ret = (fwds[i].resp != NULL) ? KNOT_EOK : KNOT_ENOMEM;
+		fwds[i].done = (fwds[i].resp == NULL);
+		i++;
+	}
+
+	size_t addr_count;
+	conf_val_t remote = forward_remote(conf, zone, &addr_count);
+
+	/* Retry the failed updates with the next remote address. */
+	for (size_t a = 0; a < addr_count; a++) {
+		conf_remote_t master = conf_remote(conf, &remote, a);
+		remote_forward_pipelined(conf, fwds, count, &master);
+
+		bool pending = false;
+		for (i = 0; i < count; i++) {
+			pending |= !fwds[i].done;
+		}
+		if (!pending) {
+			break;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		forward_finish(zone, fwds[i].request, fwds[i].ret);
+		knot_pkt_free(fwds[i].resp);
 	}
+	free(fwds);
+
+	return true;
 }
 
 static void forward_requests(conf_t *conf, zone_t *zone, list_t *requests)
@@ -305,6 +446,11 @@ static void forward_requests(conf_t *conf, zone_t *zone, list_t *requests)
 	assert(zone);
 	assert(requests);
 
+	/* Pipeline the updates over a shared connection if enabled. */
+	if (global_query_mux != NULL && forward_pipelined(conf, zone, requests)) {
+		return;
+	}
+
 	ptrnode_t *node;
 	WALK_LIST(node, *requests) {
 		knot_request_t *req = node->d;
@@ -321,7 +467,7 @@ static void send_update_response(conf_t *conf, zone_t *zone, knot_request_t *req
 			knotd_qdata_extra_t extra;
 			init_qdata_from_request(&qdata, zone, req, NULL, &extra);
 
-			(void)process_query_sign_response(req->resp, &qdata);
+			(void)process_query_sign_response(req->resp, &qdata, true);
 		}
 
 		if (net_is_stream(req->fd)) {
@@ -371,7 +517,7 @@ static int init_update_responses(list_t *updates)
 	return KNOT_EOK;
 }
 
-static size_t update_dequeue(zone_t *zone, list_t *updates)
+static size_t update_dequeue(zone_t *zone, list_t *updates, size_t max_count)
 {
 	assert(zone);
 	assert(updates);
@@ -384,13 +530,29 @@ static size_t update_dequeue(zone_t *zone, list_t *updates)
 		return 0;
 	}
 
-	*updates = zone->ddns_queue;
 	size_t update_count = zone->ddns_queue_size;
-	init_list(&zone->ddns_queue);
-	zone->ddns_queue_size = 0;
+	if (max_count == 0 || update_count <= max_count) {
+		*updates = zone->ddns_queue;
+		init_list(&zone->ddns_queue);
+	} else {
+		/* Take just the oldest updates, the rest is left for the next batch. */
+		init_list(updates);
+		for (size_t i = 0; i < max_count; i++) {
+			node_t *n = HEAD(zone->ddns_queue);
+			rem_node(n);
+			add_tail(updates, n);
+		}
+		update_count = max_count;
+	}
+	zone->ddns_queue_size -= update_count;
+	bool remaining = (zone->ddns_queue_size > 0);
 
 	pthread_mutex_unlock(&zone->ddns_lock);
 
+	if (remaining) {
+		zone_events_schedule_now(zone, ZONE_EVENT_UPDATE);
+	}
+
 	return update_count;
 }
 
@@ -399,8 +561,9 @@ int event_update(conf_t *conf, zone_t *zone)
 	assert(zone);
 
 	/* Get list of pending updates. */
+	conf_val_t val = conf_zone_get(conf, C_DDNS_BATCH, zone->name);
 	list_t updates;
-	size_t update_count = update_dequeue(zone, &updates);
+	size_t update_count = update_dequeue(zone, &updates, conf_int(&val));
 	if (update_count == 0) {
 		return KNOT_EOK;
 	}
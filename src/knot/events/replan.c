@@ -72,8 +72,7 @@ static void replan_dnssec(conf_t *conf, zone_t *zone)
 	assert(conf);
 	assert(zone);
 
-	conf_val_t val = conf_zone_get(conf, C_DNSSEC_SIGNING, zone->name);
-	if (conf_bool(&val)) {
+	if (zone_is_signed(conf, zone)) {
 		zone_events_schedule_now(zone, ZONE_EVENT_DNSSEC);
 	}
 }
@@ -84,7 +83,7 @@ static bool can_expire(const zone_t *zone)
 }
 
 /*!
- * \brief Replan events that depend on zone timers (REFRESH, EXPIRE, FLUSH, RESALT, PARENT DS QUERY).
+ * \brief Replan events that depend on zone timers (REFRESH, EXPIRE, FLUSH, RESALT, PARENT DS QUERY, UNLOAD).
  */
 void replan_from_timers(conf_t *conf, zone_t *zone)
 {
@@ -96,7 +95,8 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 	time_t refresh = TIME_CANCEL;
 	if (zone_is_slave(conf, zone)) {
 		refresh = zone->timers.next_refresh;
-		if (zone->contents == NULL && zone->timers.last_refresh_ok) { // zone disappeared w/o expiry
+		if (zone->contents == NULL && zone->timers.last_refresh_ok &&
+		    !zone_get_flag(zone, ZONE_IS_UNLOADED, false)) { // zone disappeared w/o expiry
 			refresh = now;
 		}
 		assert(refresh > 0);
@@ -111,8 +111,7 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 
 	time_t flush = TIME_IGNORE;
 	if (!zone_is_slave(conf, zone) || can_expire(zone)) {
-		conf_val_t val = conf_zone_get(conf, C_ZONEFILE_SYNC, zone->name);
-		int64_t sync_timeout = conf_int(&val);
+		int64_t sync_timeout = zone_zonefile_sync(conf, zone);
 		if (sync_timeout > 0) {
 			flush = zone->timers.last_flush + sync_timeout;
 		}
@@ -121,11 +120,10 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 	time_t resalt = TIME_IGNORE;
 	time_t ds_check = TIME_CANCEL;
 	time_t ds_push = TIME_CANCEL;
-	conf_val_t val = conf_zone_get(conf, C_DNSSEC_SIGNING, zone->name);
-	if (conf_bool(&val)) {
+	if (zone_is_signed(conf, zone)) {
 		conf_val_t policy = conf_zone_get(conf, C_DNSSEC_POLICY, zone->name);
 		conf_id_fix_default(&policy);
-		val = conf_id_get(conf, C_POLICY, C_NSEC3, &policy);
+		conf_val_t val = conf_id_get(conf, C_POLICY, C_NSEC3, &policy);
 		if (conf_bool(&val)) {
 			knot_time_t last_resalt = 0;
 			if (knot_lmdb_open(zone_kaspdb(zone)) == KNOT_EOK) {
@@ -151,6 +149,12 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 		}
 	}
 
+	time_t unload = TIME_CANCEL;
+	conf_val_t idle = conf_zone_get(conf, C_IDLE_UNLOAD, zone->name);
+	if (conf_int(&idle) > 0 && zone->contents != NULL) {
+		unload = zone->last_used + conf_int(&idle);
+	}
+
 	zone_events_schedule_at(zone,
 	                        ZONE_EVENT_REFRESH, refresh,
 	                        ZONE_EVENT_EXPIRE, expire_pre,
@@ -158,7 +162,8 @@ void replan_from_timers(conf_t *conf, zone_t *zone)
 	                        ZONE_EVENT_FLUSH, flush,
 	                        ZONE_EVENT_DNSSEC, resalt,
 	                        ZONE_EVENT_DS_CHECK, ds_check,
-	                        ZONE_EVENT_DS_PUSH, ds_push);
+	                        ZONE_EVENT_DS_PUSH, ds_push,
+	                        ZONE_EVENT_UNLOAD, unload);
 }
 
 void replan_load_new(zone_t *zone)
@@ -0,0 +1,350 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <urcu.h>
+
+#include "knot/events/xfr_sched.h"
+#include "knot/server/server.h"
+#include "contrib/sockaddr.h"
+#include "contrib/time.h"
+
+typedef struct waiter {
+	struct waiter *next;
+	knot_dname_t *zone;      // Name of the waiting zone.
+	bool urgent;             // Without contents or close to expiration.
+	size_t size;             // Size of the zone contents.
+	uint64_t seq;            // Order of arrival.
+	time_t granted;          // Time of the grant of a slot, 0 if none.
+} waiter_t;
+
+typedef struct primary {
+	struct primary *next;
+	struct sockaddr_storage addr;
+	server_t *server;        // For the rescheduling of the waiting zones.
+	unsigned limit;          // Last configured concurrency limit.
+	size_t rate_limit;       // Last configured rate limit.
+	unsigned active;         // Transfers in progress, including the granted ones.
+	double debt;             // [B] Data transferred over the rate limit.
+	struct timespec debt_time;
+	waiter_t *waiters;       // Ordered by priority.
+} primary_t;
+
+static struct {
+	pthread_mutex_t mx;
+	primary_t *primaries;
+	size_t waiting;
+	uint64_t seq;
+} sched = { .mx = PTHREAD_MUTEX_INITIALIZER };
+
+static bool prior(const waiter_t *a, const waiter_t *b)
+{
+	if (a->urgent != b->urgent) {
+		return a->urgent;
+	}
+	if (a->size != b->size) {
+		return a->size < b->size;
+	}
+	return a->seq < b->seq;
+}
+
+static primary_t *primary_get(const struct sockaddr_storage *addr, bool create)
+{
+	for (primary_t *p = sched.primaries; p != NULL; p = p->next) {
+		if (sockaddr_cmp(&p->addr, addr, false) == 0) {
+			return p;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	primary_t *p = calloc(1, sizeof(*p));
+	if (p == NULL) {
+		return NULL;
+	}
+	memcpy(&p->addr, addr, sizeof(*addr));
+	p->debt_time = time_now();
+	p->next = sched.primaries;
+	sched.primaries = p;
+
+	return p;
+}
+
+static void primary_drop_idle(primary_t *p)
+{
+	if (p->active > 0 || p->waiters != NULL || p->debt > 0) {
+		return;
+	}
+
+	for (primary_t **it = &sched.primaries; *it != NULL; it = &(*it)->next) {
+		if (*it == p) {
+			*it = p->next;
+			free(p);
+			return;
+		}
+	}
+}
+
+/*! \brief Pays off the debt for the time elapsed. */
+static void primary_repay(primary_t *p)
+{
+	struct timespec now = time_now();
+	if (p->rate_limit == 0) {
+		p->debt = 0;
+	} else if (p->debt > 0) {
+		p->debt -= p->rate_limit * time_diff_ms(&p->debt_time, &now) / 1000.0;
+		if (p->debt < 0) {
+			p->debt = 0;
+		}
+	}
+	p->debt_time = now;
+}
+
+static bool primary_free_slot(const primary_t *p)
+{
+	return (p->limit == 0 || p->active < p->limit) && p->debt <= 0;
+}
+
+static waiter_t **waiter_find(primary_t *p, const knot_dname_t *zone)
+{
+	for (waiter_t **it = &p->waiters; *it != NULL; it = &(*it)->next) {
+		if (knot_dname_is_equal((*it)->zone, zone)) {
+			return it;
+		}
+	}
+	return NULL;
+}
+
+static void waiter_free(waiter_t *w)
+{
+	knot_dname_free(w->zone, NULL);
+	free(w);
+	sched.waiting--;
+}
+
+static void waiter_insert(primary_t *p, waiter_t *w)
+{
+	waiter_t **it = &p->waiters;
+	while (*it != NULL && !prior(w, *it)) {
+		it = &(*it)->next;
+	}
+	w->next = *it;
+	*it = w;
+}
+
+/*! \brief Reschedules the refresh of the zone, returns false if no such zone. */
+static bool reschedule(server_t *server, const knot_dname_t *name, time_t when)
+{
+	if (server == NULL) {
+		return true;
+	}
+
+	rcu_read_lock();
+	zone_t *zone = knot_zonedb_find(server->zone_db, name);
+	if (zone != NULL) {
+		zone_events_schedule_at(zone, ZONE_EVENT_REFRESH, when);
+	}
+	rcu_read_unlock();
+
+	return zone != NULL;
+}
+
+/*!
+ * \brief Grants the free slots to the waiting zones in the order of priority.
+ *
+ * If the rate limit is exceeded, the first waiting zone is rescheduled to
+ * the time the debt gets paid off.
+ */
+static void primary_pass_on(primary_t *p)
+{
+	time_t now = time(NULL);
+
+	for (waiter_t *w = p->waiters; w != NULL; w = w->next) {
+		// Withdraw the grants not used in time.
+		if (w->granted != 0 && now - w->granted > XFR_SCHED_GRANT_TIMEOUT) {
+			w->granted = 0;
+			p->active--;
+		}
+	}
+
+	waiter_t **it = &p->waiters;
+	while (*it != NULL) {
+		waiter_t *w = *it;
+		if (w->granted != 0) {
+			it = &w->next;
+			continue;
+		}
+
+		bool exists;
+		if (p->debt > 0) {
+			time_t delay = p->debt / p->rate_limit + 1;
+			exists = reschedule(p->server, w->zone, now + delay);
+		} else if (primary_free_slot(p)) {
+			exists = reschedule(p->server, w->zone, now);
+			if (exists) {
+				w->granted = now;
+				p->active++;
+			}
+		} else {
+			break;
+		}
+
+		if (!exists) {
+			// The zone was removed meanwhile.
+			*it = w->next;
+			waiter_free(w);
+		} else if (w->granted == 0) {
+			break; // Waiting for the rate limit.
+		} else {
+			it = &w->next;
+		}
+	}
+}
+
+static bool is_urgent(zone_t *zone)
+{
+	return zone->contents == NULL ||
+	       (zone->timers.next_expire > 0 &&
+	        zone->timers.next_expire - time(NULL) < XFR_SCHED_URGENT_EXPIRE);
+}
+
+int xfr_sched_acquire(zone_t *zone, const struct sockaddr_storage *remote,
+                      unsigned limit, size_t rate_limit)
+{
+	if (zone == NULL || remote == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	pthread_mutex_lock(&sched.mx);
+
+	primary_t *p = primary_get(remote, limit > 0 || rate_limit > 0);
+	if (p == NULL) {
+		pthread_mutex_unlock(&sched.mx);
+		// Not scheduled at all without any limit.
+		return (limit > 0 || rate_limit > 0) ? KNOT_ENOMEM : KNOT_EOK;
+	}
+	p->server = zone->server;
+	p->limit = limit;
+	p->rate_limit = rate_limit;
+	primary_repay(p);
+
+	waiter_t **found = waiter_find(p, zone->name);
+	waiter_t *w = (found != NULL) ? *found : NULL;
+
+	bool allowed = (w != NULL && w->granted != 0);
+	if (!allowed && primary_free_slot(p)) {
+		// Not ahead of the waiting zones.
+		allowed = true;
+		for (waiter_t *it = p->waiters; it != NULL; it = it->next) {
+			if (it != w && it->granted == 0) {
+				allowed = (w != NULL && prior(w, it));
+				break;
+			}
+		}
+		if (allowed) {
+			p->active++;
+		}
+	}
+
+	int ret = KNOT_EOK;
+	if (allowed) {
+		if (w != NULL) {
+			*found = w->next;
+			waiter_free(w);
+		}
+	} else {
+		if (w != NULL) {
+			*found = w->next;
+		} else if ((w = calloc(1, sizeof(*w))) != NULL &&
+		           (w->zone = knot_dname_copy(zone->name, NULL)) != NULL) {
+			w->seq = sched.seq++;
+			sched.waiting++;
+		} else {
+			free(w);
+			w = NULL;
+		}
+
+		if (w != NULL) {
+			// The priority may have changed since the last attempt.
+			w->urgent = is_urgent(zone);
+			w->size = (zone->contents != NULL) ? zone->contents->size : 0;
+			waiter_insert(p, w);
+			ret = KNOT_EBUSY;
+		} else {
+			ret = KNOT_ENOMEM;
+		}
+		primary_pass_on(p);
+	}
+
+	pthread_mutex_unlock(&sched.mx);
+
+	return ret;
+}
+
+void xfr_sched_release(const struct sockaddr_storage *remote, size_t bytes)
+{
+	if (remote == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&sched.mx);
+
+	primary_t *p = primary_get(remote, false);
+	if (p != NULL) {
+		primary_repay(p);
+		if (p->rate_limit > 0) {
+			p->debt += bytes;
+		}
+		if (p->active > 0) {
+			p->active--;
+		}
+		primary_pass_on(p);
+		primary_drop_idle(p);
+	}
+
+	pthread_mutex_unlock(&sched.mx);
+}
+
+size_t xfr_sched_waiting(void)
+{
+	pthread_mutex_lock(&sched.mx);
+	size_t waiting = sched.waiting;
+	pthread_mutex_unlock(&sched.mx);
+
+	return waiting;
+}
+
+void xfr_sched_deinit(void)
+{
+	pthread_mutex_lock(&sched.mx);
+
+	while (sched.primaries != NULL) {
+		primary_t *p = sched.primaries;
+		sched.primaries = p->next;
+		while (p->waiters != NULL) {
+			waiter_t *w = p->waiters;
+			p->waiters = w->next;
+			waiter_free(w);
+		}
+		free(p);
+	}
+
+	pthread_mutex_unlock(&sched.mx);
+}
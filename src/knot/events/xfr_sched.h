@@ -0,0 +1,78 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Scheduling of the incoming zone transfers per primary.
+ *
+ * A zone refresh asks for a transfer slot of the primary before the transfer
+ * starts. If the primary has as many transfers in progress as its limit
+ * allows, or its transfer rate limit is exceeded, the zone waits. Once a slot
+ * is released, it's granted to the waiting zone with the highest priority and
+ * the refresh of that zone is rescheduled.
+ *
+ * The zones without contents or close to expiration go first, then smaller
+ * zones before the bigger ones, so that a mass resync gets most of the zones
+ * current early.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+#include "knot/zone/zone.h"
+
+/*! \brief Grant not used by the refreshed zone in time is withdrawn. */
+#define XFR_SCHED_GRANT_TIMEOUT	60 /* [s] */
+
+/*! \brief Fallback refresh of a waiting zone without SOA (in case of a lost wake-up). */
+#define XFR_SCHED_RECHECK	600 /* [s] */
+
+/*! \brief Zones expiring sooner are treated as without contents. */
+#define XFR_SCHED_URGENT_EXPIRE	3600 /* [s] */
+
+/*!
+ * \brief Requests a transfer slot of the primary for the zone.
+ *
+ * \param zone        Zone to be transferred.
+ * \param remote      Address of the primary.
+ * \param limit       Limit of concurrent transfers from the primary (0 if unlimited).
+ * \param rate_limit  [B/s] Limit of the transfer rate from the primary (0 if unlimited).
+ *
+ * \retval KNOT_EOK if the transfer can start now, xfr_sched_release() must follow.
+ * \retval KNOT_EBUSY if the zone has to wait, its refresh is rescheduled later.
+ * \retval KNOT_ENOMEM
+ */
+int xfr_sched_acquire(zone_t *zone, const struct sockaddr_storage *remote,
+                      unsigned limit, size_t rate_limit);
+
+/*!
+ * \brief Releases the transfer slot of the primary and passes it on.
+ *
+ * \param remote  Address of the primary.
+ * \param bytes   Transferred data accounted to the rate limit.
+ */
+void xfr_sched_release(const struct sockaddr_storage *remote, size_t bytes);
+
+/*!
+ * \brief Returns the number of the zones waiting for a transfer slot.
+ */
+size_t xfr_sched_waiting(void);
+
+/*!
+ * \brief Forgets all the primaries and the waiting zones.
+ */
+void xfr_sched_deinit(void);
@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <syslog.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #include <libknot/libknot.h>
 #include <libknot/yparser/ypschema.h>
@@ -216,6 +217,51 @@ typedef char* (*knotd_mod_idx_to_str_f)(uint32_t idx, uint32_t idx_count);
 int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_count,
                         knotd_mod_idx_to_str_f idx_to_str);
 
+/*!
+ * Statistics multi-counter read callback.
+ *
+ * Provides the subcounter values and names kept by the module on read.
+ *
+ * \param[in]  mod     Module context.
+ * \param[in]  ctr_id  Counter id.
+ * \param[out] vals    Subcounter values (zeroed, idx_count items).
+ * \param[out] names   Subcounter names (to be freed by the caller, NULL if unused).
+ */
+typedef void (*knotd_mod_stats_read_f)(knotd_mod_t *mod, uint32_t ctr_id,
+                                       uint64_t *vals, char **names);
+
+/*!
+ * Registers a statistics counter with values provided by the module on read.
+ *
+ * \note The counter can't be updated with knotd_mod_stats_incr() and alike.
+ *
+ * \param[in] mod        Module context.
+ * \param[in] ctr_name   Counter name.
+ * \param[in] idx_count  Number of subcounters.
+ * \param[in] read       Read callback.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int knotd_mod_stats_add_read(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_count,
+                             knotd_mod_stats_read_f read);
+
+/*!
+ * Switches the statistics counters to the compact mode.
+ *
+ * The counters are allocated on the first update and shared by all threads,
+ * which suits many module instances with infrequent updates (e.g. per zone).
+ * Instances whose counters are updated frequently get per-thread counters
+ * again, up to 'hot_limit' such instances in the server.
+ *
+ * \note Must be called after all the counters are registered.
+ *
+ * \param[in] mod        Module context.
+ * \param[in] hot_limit  Maximum number of instances with per-thread counters.
+ *
+ * \return Error code, KNOT_EOK if success.
+ */
+int knotd_mod_stats_compact(knotd_mod_t *mod, uint32_t hot_limit);
+
 /*!
  * Increments a statistics counter.
  *
@@ -284,6 +330,7 @@ typedef enum {
 	KNOTD_CONF_ENV_WORKERS_UDP = 2, /*!< Current number of UDP workers. */
 	KNOTD_CONF_ENV_WORKERS_TCP = 3, /*!< Current number of TCP workers. */
 	KNOTD_CONF_ENV_WORKERS_XDP = 4, /*!< Current number of UDP-over-XDP workers. */
+	KNOTD_CONF_ENV_WORKERS_XFR = 5, /*!< Current number of zone transfer workers. */
 } knotd_conf_env_t;
 
 /*!
@@ -318,6 +365,17 @@ knotd_conf_t knotd_conf_env(knotd_mod_t *mod, knotd_conf_env_t env);
  */
 unsigned knotd_mod_threads(knotd_mod_t *mod);
 
+/*!
+ * Gets memory context for long-lived module data (tables, tries).
+ *
+ * The allocations are accounted in the server memory statistics.
+ *
+ * \param[in] mod  Module context.
+ *
+ * \return Shared memory context (thread-safe).
+ */
+knot_mm_t *knotd_mod_mm(knotd_mod_t *mod);
+
 /*!
  * Gets module configuration value.
  *
@@ -394,6 +452,7 @@ typedef enum {
 	KNOTD_QUERY_FLAG_NO_IXFR    = 1 << 1, /*!< Don't process IXFR. */
 	KNOTD_QUERY_FLAG_LIMIT_SIZE = 1 << 2, /*!< Apply UDP size limit. */
 	KNOTD_QUERY_FLAG_COOKIE     = 1 << 3, /*!< Valid DNS Cookie indication. */
+	KNOTD_QUERY_FLAG_TLS        = 1 << 4, /*!< Query received over TLS. */
 } knotd_query_flag_t;
 
 /*! Query processing data context parameters. */
@@ -406,6 +465,14 @@ typedef struct {
 	const struct knot_xdp_msg *xdp_msg;    /*!< Possible XDP message context. */
 } knotd_qdata_params_t;
 
+/*! Query processing durations (see knotd_mod_timing_enable()). */
+typedef struct {
+	struct timespec begin; /*!< Processing start (CLOCK_MONOTONIC). */
+	uint64_t zone_lookup;  /*!< Zone lookup duration in nanoseconds. */
+	uint64_t answer;       /*!< Answer generation duration in nanoseconds. */
+	uint64_t modules;      /*!< Duration of the BEGIN stage hooks in nanoseconds. */
+} knotd_qdata_timing_t;
+
 /*! Query processing data context. */
 typedef struct {
 	knot_pkt_t *query;              /*!< Query to be solved. */
@@ -418,6 +485,7 @@ typedef struct {
 	knot_sign_context_t sign;       /*!< Signing context. */
 	knot_edns_client_subnet_t *ecs; /*!< EDNS Client Subnet option. */
 	bool err_truncated;             /*!< Set TC and AA bits if an error reply. */
+	knotd_qdata_timing_t timing;    /*!< Processing durations (if enabled). */
 
 	/*! Persistent items on processing reset. */
 	knot_mm_t *mm;                /*!< Memory context. */
@@ -465,6 +533,25 @@ const knot_dname_t *knotd_qdata_zone_name(knotd_qdata_t *qdata);
  */
 knot_rrset_t knotd_qdata_zone_apex_rrset(knotd_qdata_t *qdata, uint16_t type);
 
+/*!
+ * Gets the number of allocations from the query memory context so far.
+ *
+ * \param[in] qdata  Query data.
+ *
+ * \return Number of allocations (0 if not available).
+ */
+unsigned knotd_qdata_alloc_count(knotd_qdata_t *qdata);
+
+/*!
+ * Enables measuring of the query processing durations.
+ *
+ * \note The measuring is server-wide, the durations are available in all
+ *       the hooks via knotd_qdata_t.timing.
+ *
+ * \param[in] mod  Module context.
+ */
+void knotd_mod_timing_enable(knotd_mod_t *mod);
+
 /*! General query processing states. */
 typedef enum {
 	KNOTD_STATE_NOOP  = 0, /*!< No response. */
@@ -14,9 +14,36 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "knot/journal/journal_basic.h"
 #include "knot/journal/journal_metadata.h"
 #include "libknot/error.h"
+#include "contrib/string.h"
+
+unsigned journal_db_shard(const knot_dname_t *zone, unsigned shards)
+{
+	if (shards <= 1) {
+		return 0;
+	}
+
+	// FNV-1a, stable across restarts and tools.
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < knot_dname_size(zone); i++) {
+		hash = (hash ^ zone[i]) * 16777619U;
+	}
+
+	return hash % shards;
+}
+
+char *journal_db_shard_path(const char *dir, unsigned shard)
+{
+	if (shard == 0) {
+		return strdup(dir);
+	}
+
+	return sprintf_alloc("%s/shard%u", dir, shard);
+}
 
 MDB_val journal_changeset_id_to_key(bool zone_in_journal, uint32_t serial, const knot_dname_t *zone)
 {
@@ -49,11 +76,12 @@ void journal_del_zone(knot_lmdb_txn_t *txn, const knot_dname_t *zone)
 	free(prefix.mv_data);
 }
 
-void journal_make_header(void *chunk, uint32_t ch_serial_to)
+void journal_make_header(void *chunk, uint32_t ch_serial_to, uint32_t flags,
+                         uint64_t raw_size)
 {
+	// the second field used to be # of chunks, always zero since long ago
 	knot_lmdb_make_key_part(chunk, JOURNAL_HEADER_SIZE, "IILLL", ch_serial_to,
-	                        (uint32_t)0 /* we no longer care for # of chunks */,
-	                        (uint64_t)0, (uint64_t)0, (uint64_t)0);
+	                        flags, raw_size, (uint64_t)0, (uint64_t)0);
 }
 
 uint32_t journal_next_serial(const MDB_val *chunk)
@@ -61,6 +89,20 @@ uint32_t journal_next_serial(const MDB_val *chunk)
 	return knot_wire_read_u32(chunk->mv_data);
 }
 
+uint32_t journal_chunk_flags(const MDB_val *chunk)
+{
+	return knot_wire_read_u32(chunk->mv_data + sizeof(uint32_t));
+}
+
+uint64_t journal_chunk_raw_size(const MDB_val *chunk)
+{
+	if (journal_chunk_flags(chunk) & JOURNAL_CHUNK_ZSTD) {
+		return knot_wire_read_u64(chunk->mv_data + 2 * sizeof(uint32_t));
+	} else {
+		return chunk->mv_size - JOURNAL_HEADER_SIZE;
+	}
+}
+
 bool journal_serial_to(knot_lmdb_txn_t *txn, bool zij, uint32_t serial,
                        const knot_dname_t *zone, uint32_t *serial_to)
 {
@@ -90,3 +132,15 @@ size_t journal_conf_max_changesets(zone_journal_t j)
 	conf_val_t val = conf_zone_get(j.conf, C_JOURNAL_MAX_DEPTH, j.zone);
 	return conf_int(&val);
 }
+
+bool journal_conf_compress(zone_journal_t j)
+{
+	conf_val_t val = conf_zone_get(j.conf, C_JOURNAL_COMPRESS, j.zone);
+	return conf_bool(&val);
+}
+
+unsigned journal_conf_threads(zone_journal_t j)
+{
+	conf_val_t val = conf_zone_get(j.conf, C_ADJUST_THR, j.zone);
+	return conf_int(&val);
+}
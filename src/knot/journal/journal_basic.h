@@ -31,6 +31,11 @@ typedef struct {
 #define JOURNAL_CHUNK_THRESH (15 * 1024)
 #define JOURNAL_HEADER_SIZE (32)
 
+/*! \brief Chunk header flags. */
+enum {
+	JOURNAL_CHUNK_ZSTD = (1 << 0), // Chunk data compressed with Zstandard.
+};
+
 /*! \brief Convert journal_mode to LMDB environment flags. */
 inline static unsigned journal_env_flags(int journal_mode, bool readonly)
 {
@@ -38,6 +43,27 @@ inline static unsigned journal_env_flags(int journal_mode, bool readonly)
 	       (readonly ? MDB_RDONLY : 0);
 }
 
+/*!
+ * \brief Returns the index of the journal DB shard holding the zone.
+ *
+ * \param zone    Zone name (lower-case).
+ * \param shards  Number of the shards.
+ */
+unsigned journal_db_shard(const knot_dname_t *zone, unsigned shards);
+
+/*!
+ * \brief Returns the directory of the journal DB shard.
+ *
+ * The first shard is stored directly in the journal DB directory, the others
+ * in its subdirectories.
+ *
+ * \param dir    Journal DB directory.
+ * \param shard  Index of the shard.
+ *
+ * \return Directory path to be freed, NULL on error.
+ */
+char *journal_db_shard_path(const char *dir, unsigned shard);
+
 /*!
  * \brief Create a database key prefix to search for a changeset.
  *
@@ -74,10 +100,13 @@ void journal_del_zone(knot_lmdb_txn_t *txn, const knot_dname_t *zone);
 /*!
  * \brief Initialise chunk header.
  *
- * \param chunk   Pointer to the changeset chunk. It must be at least JOURNAL_HEADER_SIZE, perhaps more.
- * \param ch      Serial-to of the changeset being serialized.
+ * \param chunk      Pointer to the changeset chunk. It must be at least JOURNAL_HEADER_SIZE, perhaps more.
+ * \param ch         Serial-to of the changeset being serialized.
+ * \param flags      Chunk flags (JOURNAL_CHUNK_*).
+ * \param raw_size   Size of the uncompressed chunk data (if compressed).
  */
-void journal_make_header(void *chunk, uint32_t ch_serial_to);
+void journal_make_header(void *chunk, uint32_t ch_serial_to, uint32_t flags,
+                         uint64_t raw_size);
 
 /*!
  * \brief Obtain serial-to of the serialized changeset.
@@ -88,6 +117,16 @@ void journal_make_header(void *chunk, uint32_t ch_serial_to);
  */
 uint32_t journal_next_serial(const MDB_val *chunk);
 
+/*!
+ * \brief Obtain chunk flags (JOURNAL_CHUNK_*).
+ */
+uint32_t journal_chunk_flags(const MDB_val *chunk);
+
+/*!
+ * \brief Obtain size of the chunk data after decompression (without header).
+ */
+uint64_t journal_chunk_raw_size(const MDB_val *chunk);
+
 /*!
  * \brief Obtain serial-to of a changeset stored in journal.
  *
@@ -116,3 +155,9 @@ size_t journal_conf_max_usage(zone_journal_t j);
 
 /*! \brief Return configured maximal depth of journal. */
 size_t journal_conf_max_changesets(zone_journal_t j);
+
+/*! \brief Return true if the journal changesets shall be compressed according to conf. */
+bool journal_conf_compress(zone_journal_t j);
+
+/*! \brief Return number of threads for serializing the changesets according to conf. */
+unsigned journal_conf_threads(zone_journal_t j);
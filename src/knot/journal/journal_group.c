@@ -0,0 +1,218 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include "knot/journal/journal_group.h"
+#include "libknot/errcode.h"
+
+typedef struct {
+	node_t n;
+	zone_journal_t j;
+	journal_prepared_t prep;
+	int ret;
+	bool done;
+} group_req_t;
+
+/*! \brief Waits for the collecting period or termination, group must be locked. */
+static void collect_wait(journal_group_t *group)
+{
+	unsigned delay_ms = group->delay_ms;
+	if (delay_ms == 0) {
+		return;
+	}
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += delay_ms / 1000;
+	deadline.tv_nsec += (delay_ms % 1000) * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	while (!group->terminate &&
+	       pthread_cond_timedwait(&group->wake, &group->lock, &deadline) == 0);
+}
+
+/*! \brief Stores the requests within one transaction, falls back to one by one on error. */
+static void store_batch(list_t *batch)
+{
+	group_req_t *first = HEAD(*batch);
+	knot_lmdb_db_t *db = first->j.db;
+
+	knot_lmdb_txn_t txn = { 0 };
+	txn.ret = knot_lmdb_open(db);
+	if (txn.ret == KNOT_EOK) {
+		knot_lmdb_begin(db, &txn, true);
+	}
+	group_req_t *req;
+	WALK_LIST(req, *batch) {
+		if (txn.ret != KNOT_EOK) {
+			break;
+		}
+		journal_insert_txn(req->j, &txn, &req->prep);
+	}
+	knot_lmdb_commit(&txn);
+
+	if (txn.ret == KNOT_EOK || first == TAIL(*batch)) {
+		WALK_LIST(req, *batch) {
+			req->ret = txn.ret;
+		}
+		return;
+	}
+
+	// Each request gets its own result, e.g. for flushing a full journal.
+	WALK_LIST(req, *batch) {
+		req->ret = journal_insert_prepared(req->j, &req->prep);
+	}
+}
+
+static void *writer_main(void *arg)
+{
+	journal_group_t *group = arg;
+
+	pthread_mutex_lock(&group->lock);
+	while (true) {
+		while (!group->terminate && EMPTY_LIST(group->queue)) {
+			pthread_cond_wait(&group->wake, &group->lock);
+		}
+		if (EMPTY_LIST(group->queue)) {
+			break; // Terminated.
+		}
+
+		collect_wait(group);
+
+		// Take all requests for the same DB.
+		list_t batch;
+		init_list(&batch);
+		knot_lmdb_db_t *db = ((group_req_t *)HEAD(group->queue))->j.db;
+		group_req_t *req, *nxt;
+		WALK_LIST_DELSAFE(req, nxt, group->queue) {
+			if (req->j.db == db) {
+				rem_node(&req->n);
+				add_tail(&batch, &req->n);
+			}
+		}
+		pthread_mutex_unlock(&group->lock);
+
+		store_batch(&batch);
+
+		pthread_mutex_lock(&group->lock);
+		WALK_LIST(req, batch) {
+			req->done = true;
+		}
+		pthread_cond_broadcast(&group->done);
+	}
+	pthread_mutex_unlock(&group->lock);
+
+	return NULL;
+}
+
+int journal_group_init(journal_group_t *group, unsigned delay_ms)
+{
+	if (group == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(group, 0, sizeof(*group));
+	pthread_mutex_init(&group->lock, NULL);
+	pthread_cond_init(&group->wake, NULL);
+	pthread_cond_init(&group->done, NULL);
+	init_list(&group->queue);
+	group->delay_ms = delay_ms;
+
+	/* The writer mustn't receive the server signals. */
+	sigset_t all, orig;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &orig);
+	int ret = pthread_create(&group->thread, NULL, writer_main, group);
+	pthread_sigmask(SIG_SETMASK, &orig, NULL);
+	if (ret != 0) {
+		return knot_map_errno_code(ret);
+	}
+	group->running = true;
+
+	return KNOT_EOK;
+}
+
+void journal_group_deinit(journal_group_t *group)
+{
+	if (group == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&group->lock);
+	bool running = group->running;
+	group->terminate = true;
+	pthread_cond_signal(&group->wake);
+	pthread_mutex_unlock(&group->lock);
+
+	if (running) {
+		pthread_join(group->thread, NULL);
+	}
+	group->running = false;
+
+	pthread_cond_destroy(&group->done);
+	pthread_cond_destroy(&group->wake);
+	pthread_mutex_destroy(&group->lock);
+}
+
+void journal_group_set_delay(journal_group_t *group, unsigned delay_ms)
+{
+	if (group == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&group->lock);
+	group->delay_ms = delay_ms;
+	pthread_mutex_unlock(&group->lock);
+}
+
+int journal_group_insert(journal_group_t *group, zone_journal_t j,
+                         const changeset_t *ch, const changeset_t *extra,
+                         const zone_diff_t *zdiff)
+{
+	if (group == NULL) {
+		return journal_insert(j, ch, extra, zdiff);
+	}
+
+	// Serialized by the requesting thread, the writer only stores the chunks.
+	group_req_t req = { .j = j };
+	int ret = journal_insert_prepare(j, ch, extra, zdiff, &req.prep);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	pthread_mutex_lock(&group->lock);
+	if (!group->running || group->terminate || group->delay_ms == 0) {
+		pthread_mutex_unlock(&group->lock);
+		ret = journal_insert_prepared(j, &req.prep);
+		journal_prepared_clear(&req.prep);
+		return ret;
+	}
+	add_tail(&group->queue, &req.n);
+	pthread_cond_signal(&group->wake);
+	while (!req.done) {
+		pthread_cond_wait(&group->done, &group->lock);
+	}
+	pthread_mutex_unlock(&group->lock);
+	journal_prepared_clear(&req.prep);
+
+	return req.ret;
+}
@@ -0,0 +1,79 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Group commit of journal insertions.
+ *
+ * A writer thread collects the changesets of concurrently updated zones
+ * and stores them within a single journal DB transaction. Each caller waits
+ * until its changeset is committed, so the durability is kept per zone.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "contrib/ucw/lists.h"
+#include "knot/journal/journal_write.h"
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;   // Signals the writer about new requests.
+	pthread_cond_t done;   // Signals the callers about processed requests.
+	list_t queue;          // Pending requests.
+	pthread_t thread;
+	bool running;
+	bool terminate;
+	unsigned delay_ms;     // Collecting period, 0 disables grouping.
+} journal_group_t;
+
+/*!
+ * \brief Initializes the group and starts the writer thread.
+ *
+ * \param group     Group to be initialized.
+ * \param delay_ms  Period in milliseconds for collecting the changesets.
+ *
+ * \return KNOT_E*
+ */
+int journal_group_init(journal_group_t *group, unsigned delay_ms);
+
+/*!
+ * \brief Stores pending requests, stops the writer thread and deinitializes the group.
+ */
+void journal_group_deinit(journal_group_t *group);
+
+/*!
+ * \brief Changes the collecting period.
+ */
+void journal_group_set_delay(journal_group_t *group, unsigned delay_ms);
+
+/*!
+ * \brief Stores the changeset into the journal, possibly together with other zones.
+ *
+ * \see journal_insert()
+ *
+ * \param group   Journal group, NULL for an immediate insertion.
+ * \param j       Zone journal.
+ * \param ch      Changeset to be stored.
+ * \param extra   Extra changeset to be stored in the role of merged changeset.
+ * \param zdiff   Zone diff to be stored instead of changeset.
+ *
+ * \return KNOT_E*, once the changeset is committed or failed.
+ */
+int journal_group_insert(journal_group_t *group, zone_journal_t j,
+                         const changeset_t *ch, const changeset_t *extra,
+                         const zone_diff_t *zdiff);
@@ -25,6 +25,11 @@
 #include "libknot/error.h"
 
 #include <stdlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define JOURNAL_READ_AHEAD (64 * 1024 * 1024)
 
 struct journal_read {
 	knot_lmdb_txn_t txn;
@@ -32,6 +37,9 @@ struct journal_read {
 	const knot_dname_t *zone;
 	wire_ctx_t wire;
 	uint32_t next;
+	uint8_t *raw; // buffer for decompressed chunk data
+	knot_rdataset_builder_t view_rrs; // rdata of the last RRSet read as a view
+	knot_dname_storage_t view_owner; // owner of the last view from a decompressed chunk
 };
 
 int journal_read_get_error(const journal_read_t *ctx, int another_error)
@@ -41,8 +49,34 @@ int journal_read_get_error(const journal_read_t *ctx, int another_error)
 
 static void update_ctx_wire(journal_read_t *ctx)
 {
-	ctx->wire = wire_ctx_init_const(ctx->txn.cur_val.mv_data, ctx->txn.cur_val.mv_size);
-	wire_ctx_skip(&ctx->wire, JOURNAL_HEADER_SIZE);
+	if (!(journal_chunk_flags(&ctx->txn.cur_val) & JOURNAL_CHUNK_ZSTD)) {
+		ctx->wire = wire_ctx_init_const(ctx->txn.cur_val.mv_data, ctx->txn.cur_val.mv_size);
+		wire_ctx_skip(&ctx->wire, JOURNAL_HEADER_SIZE);
+		return;
+	}
+
+	ctx->wire = wire_ctx_init_const(NULL, 0);
+#ifdef HAVE_ZSTD
+	uint64_t raw_size = journal_chunk_raw_size(&ctx->txn.cur_val);
+	if (raw_size == 0 || raw_size > JOURNAL_CHUNK_MAX) {
+		ctx->txn.ret = KNOT_EMALF;
+		return;
+	}
+	if (ctx->raw == NULL && (ctx->raw = malloc(JOURNAL_CHUNK_MAX)) == NULL) {
+		ctx->txn.ret = KNOT_ENOMEM;
+		return;
+	}
+	size_t size = ZSTD_decompress(ctx->raw, raw_size,
+	                              ctx->txn.cur_val.mv_data + JOURNAL_HEADER_SIZE,
+	                              ctx->txn.cur_val.mv_size - JOURNAL_HEADER_SIZE);
+	if (ZSTD_isError(size) || size != raw_size) {
+		ctx->txn.ret = KNOT_EMALF;
+		return;
+	}
+	ctx->wire = wire_ctx_init_const(ctx->raw, raw_size);
+#else
+	ctx->txn.ret = KNOT_ENOTSUP;
+#endif
 }
 
 static bool go_next_changeset(journal_read_t *ctx, bool go_zone, const knot_dname_t *zone)
@@ -58,7 +92,7 @@ static bool go_next_changeset(journal_read_t *ctx, bool go_zone, const knot_dnam
 	}
 	ctx->next = journal_next_serial(&ctx->txn.cur_val);
 	update_ctx_wire(ctx);
-	return true;
+	return ctx->txn.ret == KNOT_EOK;
 }
 
 int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, journal_read_t **ctx)
@@ -78,12 +112,19 @@ int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, j
 
 	knot_lmdb_begin(j.db, &newctx->txn, false);
 
+	// The chunks are located randomly in the DB file, let them be read ahead.
+	MDB_val prefix = read_zone ? journal_changeset_id_to_key(true, 0, j.zone) :
+	                             journal_zone_prefix(j.zone);
+	knot_lmdb_prefetch(&newctx->txn, &prefix, JOURNAL_READ_AHEAD);
+	free(prefix.mv_data);
+
 	if (go_next_changeset(newctx, read_zone, j.zone)) {
 		*ctx = newctx;
 		return KNOT_EOK;
 	} else {
+		int ret = newctx->txn.ret == KNOT_EOK ? KNOT_ENOENT : newctx->txn.ret;
 		journal_read_end(newctx);
-		return KNOT_ENOENT;
+		return ret;
 	}
 }
 
@@ -92,6 +133,8 @@ void journal_read_end(journal_read_t *ctx)
 	if (ctx != NULL) {
 		free(ctx->key_prefix.mv_data);
 		knot_lmdb_abort(&ctx->txn);
+		free(ctx->raw);
+		knot_rdataset_builder_clear(&ctx->view_rrs);
 		free(ctx);
 	}
 }
@@ -112,7 +155,24 @@ static bool make_data_available(journal_read_t *ctx)
 		}
 		update_ctx_wire(ctx);
 	}
-	return true;
+	return ctx->txn.ret == KNOT_EOK;
+}
+
+/*! \brief Reserves the rdataset at once if it's completely in the current chunk. */
+static void reserve_rdataset(const wire_ctx_t *wire, uint16_t rrs_count,
+                             knot_rdataset_builder_t *builder)
+{
+	wire_ctx_t scan = *wire;
+	size_t total = 0;
+	for (int i = 0; i < rrs_count; i++) {
+		wire_ctx_skip(&scan, sizeof(uint32_t));
+		uint16_t len = wire_ctx_read_u16(&scan);
+		wire_ctx_skip(&scan, len);
+		total += knot_rdata_size(len);
+	}
+	if (scan.error == KNOT_EOK) {
+		(void)knot_rdataset_builder_reserve(builder, total);
+	}
 }
 
 // thoughts for next design of journal serialization:
@@ -120,47 +180,88 @@ static bool make_data_available(journal_read_t *ctx)
 // - endian
 // - optionally storing whole rdataset at once?
 
-bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_next_changeset)
+static bool read_rrset(journal_read_t *ctx, knot_rrset_t *rrset,
+                       bool allow_next_changeset, bool view)
 {
-	//knot_rdataset_clear(&rrset->rrs, NULL);
-	//memset(rrset, 0, sizeof(*rrset));
 	if (!make_data_available(ctx)) {
 		if (!allow_next_changeset || !go_next_changeset(ctx, false, ctx->zone)) {
 			return false;
 		}
 	}
-	rrset->owner = knot_dname_copy(ctx->wire.position, NULL);
-	wire_ctx_skip(&ctx->wire, knot_dname_size(rrset->owner));
+	knot_rdataset_builder_t local = { 0 }, *builder = &local;
+	if (view) {
+		// The owner is referenced directly in the LMDB map, which stays valid
+		// until the read txn ends, unless the chunk was decompressed.
+		size_t owner_size = knot_dname_size(ctx->wire.position);
+		if (journal_chunk_flags(&ctx->txn.cur_val) & JOURNAL_CHUNK_ZSTD) {
+			memcpy(ctx->view_owner, ctx->wire.position, MIN(owner_size, sizeof(ctx->view_owner)));
+			rrset->owner = ctx->view_owner;
+		} else {
+			rrset->owner = (knot_dname_t *)ctx->wire.position;
+		}
+		wire_ctx_skip(&ctx->wire, owner_size);
+		builder = &ctx->view_rrs;
+		knot_rdataset_builder_reset(builder);
+	} else {
+		rrset->owner = knot_dname_copy(ctx->wire.position, NULL);
+		wire_ctx_skip(&ctx->wire, knot_dname_size(rrset->owner));
+	}
 	rrset->type = wire_ctx_read_u16(&ctx->wire);
 	rrset->rclass = wire_ctx_read_u16(&ctx->wire);
 	uint16_t rrs_count = wire_ctx_read_u16(&ctx->wire);
+	reserve_rdataset(&ctx->wire, rrs_count, builder);
 	for (int i = 0; i < rrs_count && ctx->wire.error == KNOT_EOK; i++) {
 		if (!make_data_available(ctx)) {
 			ctx->wire.error = KNOT_EFEWDATA;
 		}
-		// TODO think of how to export serialized rr directly to knot_rdataset_add
-		// focus on: even address aligning
 		uint32_t ttl = wire_ctx_read_u32(&ctx->wire);
 		if (i == 0) {
 			rrset->ttl = ttl;
 		}
 		uint16_t len = wire_ctx_read_u16(&ctx->wire);
+		if (ctx->wire.error == KNOT_EOK && wire_ctx_available(&ctx->wire) < len) {
+			ctx->wire.error = KNOT_EMALF;
+		}
 		if (ctx->wire.error == KNOT_EOK) {
-			ctx->wire.error = knot_rrset_add_rdata(rrset, ctx->wire.position, len, NULL);
+			uint8_t buf[knot_rdata_size(len)];
+			knot_rdata_t *rdata = (knot_rdata_t *)buf;
+			knot_rdata_init(rdata, len, ctx->wire.position);
+			ctx->wire.error = knot_rdataset_builder_append(builder, rdata);
 		}
 		wire_ctx_skip(&ctx->wire, len);
 	}
+	if (ctx->wire.error == KNOT_EOK) {
+		ctx->wire.error = knot_rdataset_builder_finalize(builder);
+	}
+	if (ctx->wire.error == KNOT_EOK) {
+		rrset->rrs = builder->rrs;
+	} else if (!view) {
+		knot_rdataset_builder_clear(builder);
+	}
 	if (ctx->txn.ret == KNOT_EOK) {
 		ctx->txn.ret = ctx->wire.error == KNOT_ERANGE ? KNOT_EMALF : ctx->wire.error;
 	}
 	if (ctx->txn.ret == KNOT_EOK) {
 		return true;
+	} else if (view) {
+		knot_rrset_init_empty(rrset);
+		return false;
 	} else {
 		journal_read_clear_rrset(rrset);
 		return false;
 	}
 }
 
+bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_next_changeset)
+{
+	return read_rrset(ctx, rrset, allow_next_changeset, false);
+}
+
+bool journal_read_rrset_view(journal_read_t *ctx, knot_rrset_t *rrset, bool allow_next_changeset)
+{
+	return read_rrset(ctx, rrset, allow_next_changeset, true);
+}
+
 void journal_read_clear_rrset(knot_rrset_t *rr)
 {
 	knot_rrset_clear(rr, NULL);
@@ -171,12 +272,11 @@ int journal_read_rrsets(journal_read_t *read, journal_read_cb_t cb, void *ctx)
 	knot_rrset_t rr = { 0 };
 	bool in_remove_section = false;
 	int ret = KNOT_EOK;
-	while (ret == KNOT_EOK && journal_read_rrset(read, &rr, true)) {
+	while (ret == KNOT_EOK && journal_read_rrset_view(read, &rr, true)) {
 		if (rr_is_apex_soa(&rr, read->zone)) {
 			in_remove_section = !in_remove_section;
 		}
 		ret = cb(in_remove_section, &rr, ctx);
-		journal_read_clear_rrset(&rr);
 	}
 	ret = journal_read_get_error(read, ret);
 	journal_read_end(read);
@@ -335,6 +435,103 @@ read_one_special:
 	return ret;
 }
 
+static bool changeset_chunks_size(knot_lmdb_txn_t *txn, bool zij, uint32_t serial,
+                                  const knot_dname_t *zone, uint64_t *stored,
+                                  uint64_t *raw, size_t *chunks, uint32_t *serial_to)
+{
+	bool found = false;
+	MDB_val prefix = journal_changeset_id_to_key(zij, serial, zone);
+	knot_lmdb_foreach(txn, &prefix) {
+		*stored += txn->cur_val.mv_size;
+		*raw += JOURNAL_HEADER_SIZE + journal_chunk_raw_size(&txn->cur_val);
+		*serial_to = journal_next_serial(&txn->cur_val);
+		if (chunks != NULL) {
+			(*chunks)++;
+		}
+		found = true;
+	}
+	free(prefix.mv_data);
+	return found;
+}
+
+int journal_chunks_size(zone_journal_t j, uint64_t *stored, uint64_t *raw)
+{
+	*stored = 0;
+	*raw = 0;
+
+	if (!journal_is_existing(j)) {
+		return KNOT_EOK;
+	}
+
+	knot_lmdb_txn_t txn = { 0 };
+	journal_metadata_t md = { 0 };
+	uint32_t serial_to = 0;
+	knot_lmdb_begin(j.db, &txn, false);
+	journal_load_metadata(&txn, j.zone, &md);
+
+	(void)changeset_chunks_size(&txn, true, 0, j.zone, stored, raw, NULL, &serial_to);
+	if (md.flags & JOURNAL_MERGED_SERIAL_VALID) {
+		(void)changeset_chunks_size(&txn, false, md.merged_serial, j.zone,
+		                            stored, raw, NULL, &serial_to);
+	}
+	if (md.flags & JOURNAL_SERIAL_TO_VALID) {
+		uint32_t serial = md.first_serial;
+		for (uint32_t i = 0; i < md.changeset_count && serial != md.serial_to &&
+		     changeset_chunks_size(&txn, false, serial, j.zone, stored, raw, NULL, &serial_to); i++) {
+			serial = serial_to;
+		}
+	}
+
+	knot_lmdb_abort(&txn);
+	return txn.ret;
+}
+
+int journal_summary(zone_journal_t j, journal_summary_t *summary)
+{
+	memset(summary, 0, sizeof(*summary));
+
+	bool exists = false;
+	int ret = journal_info(j, &exists, NULL, NULL, NULL, NULL, NULL,
+	                       &summary->occupied, NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	} else if (!exists) {
+		return KNOT_ENOENT;
+	}
+
+	knot_lmdb_txn_t txn = { 0 };
+	journal_metadata_t *md = &summary->md;
+	uint32_t serial_to = 0;
+	knot_lmdb_begin(j.db, &txn, false);
+	journal_load_metadata(&txn, j.zone, md);
+
+	summary->has_zij = changeset_chunks_size(&txn, true, 0, j.zone, &summary->stored,
+	                                         &summary->raw, &summary->chunks,
+	                                         &summary->zij_serial);
+	bool consistent = !(summary->has_zij && (md->flags & JOURNAL_MERGED_SERIAL_VALID));
+	if (md->flags & JOURNAL_MERGED_SERIAL_VALID) {
+		consistent &= changeset_chunks_size(&txn, false, md->merged_serial, j.zone,
+		                                    &summary->stored, &summary->raw,
+		                                    &summary->chunks, &serial_to);
+	}
+
+	// The number of steps is bounded by the metadata in case of a cycle.
+	if (md->flags & JOURNAL_SERIAL_TO_VALID) {
+		uint32_t serial = md->first_serial;
+		while (summary->changesets < md->changeset_count && serial != md->serial_to &&
+		       changeset_chunks_size(&txn, false, serial, j.zone, &summary->stored,
+		                             &summary->raw, &summary->chunks, &serial_to)) {
+			summary->changesets++;
+			serial = serial_to;
+		}
+		consistent &= (serial == md->serial_to);
+	}
+	summary->consistent = consistent && summary->changesets == md->changeset_count;
+
+	knot_lmdb_abort(&txn);
+	return txn.ret;
+}
+
 typedef struct {
 	size_t observed_count;
 	size_t observed_merged;
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "knot/journal/journal_basic.h"
+#include "knot/journal/journal_metadata.h"
 
 typedef struct journal_read journal_read_t;
 
@@ -47,6 +48,23 @@ int journal_read_begin(zone_journal_t j, bool read_zone, uint32_t serial_from, j
  */
 bool journal_read_rrset(journal_read_t *ctx, knot_rrset_t *rr, bool allow_next_changeset);
 
+/*!
+ * \brief Read a single RRSet from a journal changeset without copying it.
+ *
+ * The owner references the mapped DB directly (or a copy held by the context
+ * if the chunk is compressed), the rdata is held by the context.
+ *
+ * \note The RRSet is valid until the next read or journal_read_end(), it
+ *       mustn't be cleared by journal_read_clear_rrset().
+ *
+ * \param ctx                    Journal reading context.
+ * \param rr                     Output: RRSet referencing the serialized data.
+ * \param allow_next_changeset   True to allow jumping to next changeset.
+ *
+ * \return False if no more RRSet in this changeset/journal, or failure.
+ */
+bool journal_read_rrset_view(journal_read_t *ctx, knot_rrset_t *rr, bool allow_next_changeset);
+
 /*!
  * \brief Free up heap allocations by journal_read_rrset().
  *
@@ -146,6 +164,43 @@ int journal_walk_from(zone_journal_t j, uint32_t from,
  */
 int journal_walk(zone_journal_t j, journal_walk_cb_t cb, void *ctx);
 
+/*!
+ * \brief Compute the stored and uncompressed size of all zone changesets.
+ *
+ * \param j        Zone journal.
+ * \param stored   Output: size of the changeset chunks in the DB.
+ * \param raw      Output: size of the changeset chunks after decompression.
+ *
+ * \return KNOT_E*
+ */
+int journal_chunks_size(zone_journal_t j, uint64_t *stored, uint64_t *raw);
+
+/*! \brief Journal overview gathered without deserializing the changesets. */
+typedef struct {
+	journal_metadata_t md; /*!< Zone metadata. */
+	bool has_zij;          /*!< Zone-in-journal is stored. */
+	uint32_t zij_serial;   /*!< Serial of the zone-in-journal. */
+	size_t changesets;     /*!< Changesets found following the serial chain. */
+	size_t chunks;         /*!< Number of all the changeset chunks. */
+	uint64_t stored;       /*!< Size of all the chunks in the DB. */
+	uint64_t raw;          /*!< Size of all the chunks after decompression. */
+	uint64_t occupied;     /*!< Approximate DB usage of the zone. */
+	bool consistent;       /*!< The serial chain corresponds to the metadata. */
+} journal_summary_t;
+
+/*!
+ * \brief Summarize the zone journal, only the chunk headers are read.
+ *
+ * \note Can be called concurrently for different zones of the same DB.
+ *
+ * \param j        Zone journal.
+ * \param summary  Output: journal summary.
+ *
+ * \retval KNOT_ENOENT  if the zone isn't in the journal.
+ * \return KNOT_E*
+ */
+int journal_summary(zone_journal_t j, journal_summary_t *summary);
+
 /*!
  * \brief Perform semantic check of the zone journal (consistency, metadata...).
  *
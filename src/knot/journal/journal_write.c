@@ -14,73 +14,321 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "knot/journal/journal_write.h"
 
 #include "contrib/macros.h"
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/journal_read.h"
 #include "knot/journal/serialization.h"
+#include "libknot/attribute.h"
 #include "libknot/error.h"
 
-static void journal_write_serialize(knot_lmdb_txn_t *txn, serialize_ctx_t *ser,
-                                    const knot_dname_t *apex, bool zij, uint32_t ch_from, uint32_t ch_to)
+/*! \brief Number of chunks compressed by one thread at once. */
+#define COMPRESS_BATCH	16
+
+typedef struct compress_ctx compress_ctx_t;
+
+/*! \brief Compression of a part of the serialized chunks by one thread. */
+typedef struct {
+	pthread_t thread;
+	compress_ctx_t *ctx;
+	MDB_val *chunks;
+	size_t count;
+	uint32_t ch_to;
+	int ret;
+} compress_job_t;
+
+#ifdef HAVE_ZSTD
+#define JOURNAL_ZSTD_LEVEL 3
+
+struct compress_ctx {
+	ZSTD_CCtx *cctx;
+	size_t out_size;
+	uint8_t out[];
+};
+
+static compress_ctx_t *compress_new(void)
+{
+	size_t out_size = ZSTD_compressBound(JOURNAL_CHUNK_MAX);
+	compress_ctx_t *ctx = malloc(sizeof(*ctx) + out_size);
+	if (ctx == NULL) {
+		return NULL;
+	}
+	ctx->cctx = ZSTD_createCCtx();
+	if (ctx->cctx == NULL) {
+		free(ctx);
+		return NULL;
+	}
+	ctx->out_size = out_size;
+	return ctx;
+}
+
+static void compress_free(compress_ctx_t *ctx)
+{
+	if (ctx != NULL) {
+		ZSTD_freeCCtx(ctx->cctx);
+		free(ctx);
+	}
+}
+
+static void *compress_thread(void *arg)
+{
+	compress_job_t *job = arg;
+
+	for (size_t i = 0; i < job->count && job->ret == KNOT_EOK; i++) {
+		MDB_val *chunk = &job->chunks[i];
+		size_t raw_size = chunk->mv_size - JOURNAL_HEADER_SIZE;
+		size_t size = ZSTD_compressCCtx(job->ctx->cctx, job->ctx->out, job->ctx->out_size,
+		                                chunk->mv_data + JOURNAL_HEADER_SIZE, raw_size,
+		                                JOURNAL_ZSTD_LEVEL);
+		if (ZSTD_isError(size) || size >= raw_size) {
+			continue; // incompressible data stored as is
+		}
+
+		uint8_t *data = malloc(JOURNAL_HEADER_SIZE + size);
+		if (data == NULL) {
+			job->ret = KNOT_ENOMEM;
+			break;
+		}
+		journal_make_header(data, job->ch_to, JOURNAL_CHUNK_ZSTD, raw_size);
+		memcpy(data + JOURNAL_HEADER_SIZE, job->ctx->out, size);
+		free(chunk->mv_data);
+		chunk->mv_data = data;
+		chunk->mv_size = JOURNAL_HEADER_SIZE + size;
+	}
+
+	return NULL;
+}
+#else
+static compress_ctx_t *compress_new(void)
+{
+	return NULL;
+}
+
+static void compress_free(_unused_ compress_ctx_t *ctx)
+{
+}
+
+static void *compress_thread(_unused_ void *arg)
 {
-	MDB_val chunk;
-	uint32_t i = 0;
-	while (serialize_unfinished(ser) && txn->ret == KNOT_EOK) {
+	assert(0);
+	return NULL;
+}
+#endif
+
+/*! \brief Compresses the chunks in parallel, one part per compression context. */
+static int compress_chunks(compress_ctx_t **ctxs, unsigned threads, MDB_val *chunks,
+                           size_t count, uint32_t ch_to)
+{
+	compress_job_t jobs[threads];
+	size_t part = (count + threads - 1) / threads;
+	unsigned used = 0;
+	for (size_t from = 0; from < count; from += part, used++) {
+		jobs[used] = (compress_job_t) {
+			.ctx = ctxs[used],
+			.chunks = chunks + from,
+			.count = MIN(part, count - from),
+			.ch_to = ch_to,
+			.ret = KNOT_EOK,
+		};
+	}
+
+	if (used == 1) {
+		(void)compress_thread(&jobs[0]);
+		return jobs[0].ret;
+	}
+
+	int ret = KNOT_EOK;
+	unsigned started = 0;
+	for (; started < used; started++) {
+		if (pthread_create(&jobs[started].thread, NULL, compress_thread,
+		                   &jobs[started]) != 0) {
+			break;
+		}
+	}
+	// The parts not started are compressed by the calling thread.
+	for (unsigned i = started; i < used; i++) {
+		(void)compress_thread(&jobs[i]);
+	}
+	for (unsigned i = 0; i < used; i++) {
+		if (i < started) {
+			pthread_join(jobs[i].thread, NULL);
+		}
+		if (ret == KNOT_EOK) {
+			ret = jobs[i].ret;
+		}
+	}
+
+	return ret;
+}
+
+static int chunks_append(journal_chunks_t *out, size_t raw_size)
+{
+	if (out->count % COMPRESS_BATCH == 0) {
+		MDB_val *chunks = realloc(out->chunks, (out->count + COMPRESS_BATCH) *
+		                                       sizeof(*chunks));
+		if (chunks == NULL) {
+			return KNOT_ENOMEM;
+		}
+		out->chunks = chunks;
+	}
+
+	MDB_val *chunk = &out->chunks[out->count];
+	chunk->mv_size = JOURNAL_HEADER_SIZE + raw_size;
+	chunk->mv_data = malloc(chunk->mv_size);
+	if (chunk->mv_data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	out->count++;
+
+	return KNOT_EOK;
+}
+
+static int journal_serialize(journal_chunks_t *out, serialize_ctx_t *ser,
+                             const knot_dname_t *apex, bool zij, uint32_t ch_from,
+                             uint32_t ch_to, bool compress, unsigned threads)
+{
+	memset(out, 0, sizeof(*out));
+	out->apex = apex;
+	out->zij = zij;
+	out->serial_from = ch_from;
+	out->serial_to = ch_to;
+
+	// if the compression contexts can't be allocated, store uncompressed
+	threads = MAX(threads, 1);
+	compress_ctx_t *ctxs[threads];
+	unsigned ctx_count = 0;
+	while (compress && ctx_count < threads &&
+	       (ctxs[ctx_count] = compress_new()) != NULL) {
+		ctx_count++;
+	}
+
+	// The serialization is a stream, only the compression runs in parallel.
+	int ret = KNOT_EOK;
+	size_t compressed = 0, size;
+	while (serialize_unfinished(ser) && ret == KNOT_EOK) {
 		serialize_prepare(ser, JOURNAL_CHUNK_THRESH - JOURNAL_HEADER_SIZE,
-		                  JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &chunk.mv_size);
-		if (chunk.mv_size == 0) {
+		                  JOURNAL_CHUNK_MAX - JOURNAL_HEADER_SIZE, &size);
+		if (size == 0) {
 			break; // beware! If this is omitted, it creates empty chunk => EMALF when reading.
 		}
-		chunk.mv_size += JOURNAL_HEADER_SIZE;
-		chunk.mv_data = NULL;
-		MDB_val key = journal_make_chunk_key(apex, ch_from, zij, i);
-		if (knot_lmdb_insert(txn, &key, &chunk)) {
-			journal_make_header(chunk.mv_data, ch_to);
-			serialize_chunk(ser, chunk.mv_data + JOURNAL_HEADER_SIZE, chunk.mv_size - JOURNAL_HEADER_SIZE);
+		ret = chunks_append(out, size);
+		if (ret != KNOT_EOK) {
+			break;
 		}
-		free(key.mv_data);
-		i++;
+		MDB_val *chunk = &out->chunks[out->count - 1];
+		journal_make_header(chunk->mv_data, ch_to, 0, 0);
+		serialize_chunk(ser, chunk->mv_data + JOURNAL_HEADER_SIZE, size);
+		out->size += size;
+
+		if (ctx_count > 0 && out->count - compressed >= ctx_count * COMPRESS_BATCH) {
+			ret = compress_chunks(ctxs, ctx_count, out->chunks + compressed,
+			                      out->count - compressed, ch_to);
+			compressed = out->count;
+		}
+	}
+	if (ret == KNOT_EOK && ctx_count > 0 && out->count > compressed) {
+		ret = compress_chunks(ctxs, ctx_count, out->chunks + compressed,
+		                      out->count - compressed, ch_to);
 	}
-	int ret = serialize_deinit(ser);
-	if (txn->ret == KNOT_EOK) {
-		txn->ret = ret;
+
+	for (unsigned i = 0; i < ctx_count; i++) {
+		compress_free(ctxs[i]);
+	}
+	int ser_ret = serialize_deinit(ser);
+	if (ret == KNOT_EOK) {
+		ret = ser_ret;
 	}
+	if (ret != KNOT_EOK) {
+		journal_chunks_clear(out);
+	}
+	return ret;
 }
 
-void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch)
+int journal_serialize_changeset(journal_chunks_t *out, const changeset_t *ch,
+                                bool compress, unsigned threads)
 {
 	serialize_ctx_t *ser = serialize_init(ch);
 	if (ser == NULL) {
-		txn->ret = KNOT_ENOMEM;
-		return;
-	}
-	if (ch->remove == NULL) {
-		journal_write_serialize(txn, ser, ch->soa_to->owner, true, 0, changeset_to(ch));
-	} else {
-		journal_write_serialize(txn, ser, ch->soa_to->owner, false, changeset_from(ch), changeset_to(ch));
+		return KNOT_ENOMEM;
 	}
+	return journal_serialize(out, ser, ch->soa_to->owner, ch->remove == NULL,
+	                         changeset_from(ch), changeset_to(ch), compress, threads);
 }
 
-void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z)
+int journal_serialize_zone(journal_chunks_t *out, const zone_contents_t *z,
+                           bool compress, unsigned threads)
 {
 	serialize_ctx_t *ser = serialize_zone_init(z);
 	if (ser == NULL) {
-		txn->ret = KNOT_ENOMEM;
-		return;
+		return KNOT_ENOMEM;
 	}
-	journal_write_serialize(txn, ser, z->apex->owner, true, 0, zone_contents_serial(z));
+	return journal_serialize(out, ser, z->apex->owner, true, 0, zone_contents_serial(z),
+	                         compress, threads);
 }
 
-void journal_write_zone_diff(knot_lmdb_txn_t *txn, const zone_diff_t *z)
+static int journal_serialize_zone_diff(journal_chunks_t *out, const zone_diff_t *z,
+                                       bool compress, unsigned threads)
 {
 	serialize_ctx_t *ser = serialize_zone_diff_init(z);
 	if (ser == NULL) {
-		txn->ret = KNOT_ENOMEM;
+		return KNOT_ENOMEM;
+	}
+	return journal_serialize(out, ser, z->apex->owner, false, zone_diff_from(z),
+	                         zone_diff_to(z), compress, threads);
+}
+
+void journal_write_chunks(knot_lmdb_txn_t *txn, const journal_chunks_t *chunks)
+{
+	for (size_t i = 0; i < chunks->count && txn->ret == KNOT_EOK; i++) {
+		MDB_val key = journal_make_chunk_key(chunks->apex, chunks->zij ? 0 : chunks->serial_from,
+		                                     chunks->zij, i);
+		MDB_val val = chunks->chunks[i];
+		knot_lmdb_insert(txn, &key, &val);
+		free(key.mv_data);
+	}
+}
+
+void journal_chunks_clear(journal_chunks_t *chunks)
+{
+	if (chunks == NULL) {
+		return;
+	}
+	for (size_t i = 0; i < chunks->count; i++) {
+		free(chunks->chunks[i].mv_data);
+	}
+	free(chunks->chunks);
+	memset(chunks, 0, sizeof(*chunks));
+}
+
+void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch, bool compress)
+{
+	if (txn->ret != KNOT_EOK) {
+		return;
+	}
+	journal_chunks_t chunks = { 0 };
+	txn->ret = journal_serialize_changeset(&chunks, ch, compress, 1);
+	journal_write_chunks(txn, &chunks);
+	journal_chunks_clear(&chunks);
+}
+
+void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z, bool compress)
+{
+	if (txn->ret != KNOT_EOK) {
 		return;
 	}
-	journal_write_serialize(txn, ser, z->apex->owner, false, zone_diff_from(z), zone_diff_to(z));
+	journal_chunks_t chunks = { 0 };
+	txn->ret = journal_serialize_zone(&chunks, z, compress, 1);
+	journal_write_chunks(txn, &chunks);
+	journal_chunks_clear(&chunks);
 }
 
 static bool delete_one(knot_lmdb_txn_t *txn, bool del_zij, uint32_t del_serial,
@@ -127,7 +375,7 @@ void journal_merge(zone_journal_t j, knot_lmdb_txn_t *txn, bool merge_zij,
 	delete_one(txn, merge_zij, merge_serial, j.zone, &del_freed, &del_next_serial);
 	assert(del_freed > 0 && del_next_serial == *original_serial_to);
 
-	journal_write_changeset(txn, &merge);
+	journal_write_changeset(txn, &merge, journal_conf_compress(j));
 	journal_read_clear_changeset(&merge);
 }
 
@@ -195,6 +443,77 @@ void journal_try_flush(zone_journal_t j, knot_lmdb_txn_t *txn, journal_metadata_
 
 #define U_MINUS(minuend, subtrahend) ((minuend) - MIN((minuend), (subtrahend)))
 
+static bool compact_due(zone_journal_t j, knot_lmdb_txn_t *txn, const journal_metadata_t *md)
+{
+	// With the zone file flushed, the changesets are deleted instead.
+	if (!(md->flags & JOURNAL_SERIAL_TO_VALID) || journal_allow_flush(j)) {
+		return false;
+	}
+
+	bool zij = journal_contains(txn, true, 0, j.zone);
+	bool merged = (md->flags & JOURNAL_MERGED_SERIAL_VALID);
+	if (md->changeset_count < ((zij || merged) ? 1 : 2)) {
+		return false;
+	}
+
+	uint64_t occupied = journal_get_occupied(txn, j.zone);
+	return occupied * 100 >= (uint64_t)journal_conf_max_usage(j) * JOURNAL_COMPACT_PCT ||
+	       md->changeset_count * 100 >= journal_conf_max_changesets(j) * JOURNAL_COMPACT_PCT;
+}
+
+bool journal_compact_due(zone_journal_t j)
+{
+	if (knot_lmdb_exists(j.db) == KNOT_ENODB || knot_lmdb_open(j.db) != KNOT_EOK) {
+		return false;
+	}
+
+	knot_lmdb_txn_t txn = { 0 };
+	journal_metadata_t md = { 0 };
+	knot_lmdb_begin(j.db, &txn, false);
+	journal_load_metadata(&txn, j.zone, &md);
+	bool due = compact_due(j, &txn, &md);
+	knot_lmdb_abort(&txn);
+
+	return due && txn.ret == KNOT_EOK;
+}
+
+int journal_compact(zone_journal_t j)
+{
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_lmdb_txn_t txn = { 0 };
+	journal_metadata_t md = { 0 };
+	knot_lmdb_begin(j.db, &txn, true);
+	journal_load_metadata(&txn, j.zone, &md);
+	if (!compact_due(j, &txn, &md)) {
+		knot_lmdb_abort(&txn);
+		return KNOT_EOK;
+	}
+
+	update_last_inserter(&txn, j.zone);
+
+	// Merge everything, then delete all the merged changesets at once.
+	journal_try_flush(j, &txn, &md);
+
+	uint32_t del_from = md.first_serial;
+	uint32_t del_upto = md.flushed_upto;
+	(void)journal_serial_to(&txn, true, 0, j.zone, &del_upto);
+	uint64_t freed = 0;
+	size_t removed = 0;
+	if (txn.ret == KNOT_EOK &&
+	    journal_delete(&txn, del_from, j.zone, UINT64_MAX, SIZE_MAX, del_upto,
+	                   &freed, &removed, &del_from)) {
+		journal_metadata_after_delete(&md, del_from, removed);
+	}
+
+	journal_store_metadata(&txn, j.zone, &md);
+	knot_lmdb_commit(&txn);
+	return txn.ret;
+}
+
 void journal_fix_occupation(zone_journal_t j, knot_lmdb_txn_t *txn, journal_metadata_t *md,
                             int64_t max_usage, ssize_t max_count)
 {
@@ -238,13 +557,22 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
+
+	// Serialized before the write transaction to keep it short.
+	journal_chunks_t chunks = { 0 };
+	ret = journal_serialize_zone(&chunks, z, journal_conf_compress(j),
+	                             journal_conf_threads(j));
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	knot_lmdb_txn_t txn = { 0 };
 	knot_lmdb_begin(j.db, &txn, true);
 
 	update_last_inserter(&txn, j.zone);
 	journal_del_zone_txn(&txn, j.zone);
 
-	journal_write_zone(&txn, z);
+	journal_write_chunks(&txn, &chunks);
 
 	journal_metadata_t md = { 0 };
 	md.flags = JOURNAL_SERIAL_TO_VALID;
@@ -253,18 +581,20 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z)
 	journal_store_metadata(&txn, j.zone, &md);
 
 	knot_lmdb_commit(&txn);
+	journal_chunks_clear(&chunks);
 	return txn.ret;
 }
 
-int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
-                   const zone_diff_t *zdiff)
+int journal_insert_prepare(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
+                           const zone_diff_t *zdiff, journal_prepared_t *out)
 {
 	assert(zdiff == NULL || (ch == NULL && extra == NULL));
 
-	size_t ch_size = zdiff == NULL ? changeset_serialized_size(ch) :
-	                                 zone_diff_serialized_size(*zdiff);
-	size_t max_usage = journal_conf_max_usage(j);
-	if (ch_size >= max_usage) {
+	memset(out, 0, sizeof(*out));
+
+	out->ch_size = zdiff == NULL ? changeset_serialized_size(ch) :
+	                               zone_diff_serialized_size(*zdiff);
+	if (out->ch_size >= journal_conf_max_usage(j)) {
 		return KNOT_ESPACE;
 	}
 
@@ -274,60 +604,109 @@ int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *e
 	     changeset_from(extra) == ch_from)) {
 		return KNOT_EINVAL;
 	}
-	int ret = knot_lmdb_open(j.db);
+
+	bool compress = journal_conf_compress(j);
+	unsigned threads = journal_conf_threads(j);
+	int ret = zdiff == NULL ? journal_serialize_changeset(&out->ch, ch, compress, threads) :
+	                          journal_serialize_zone_diff(&out->ch, zdiff, compress, threads);
+	if (ret == KNOT_EOK && extra != NULL) {
+		out->extra_size = changeset_serialized_size(extra);
+		ret = journal_serialize_changeset(&out->extra, extra, compress, threads);
+		out->has_extra = true;
+	}
 	if (ret != KNOT_EOK) {
-		return ret;
+		journal_prepared_clear(out);
 	}
-	knot_lmdb_txn_t txn = { 0 };
+
+	return ret;
+}
+
+void journal_prepared_clear(journal_prepared_t *prep)
+{
+	if (prep == NULL) {
+		return;
+	}
+	journal_chunks_clear(&prep->ch);
+	journal_chunks_clear(&prep->extra);
+	memset(prep, 0, sizeof(*prep));
+}
+
+void journal_insert_txn(zone_journal_t j, knot_lmdb_txn_t *txn, const journal_prepared_t *prep)
+{
+	size_t max_usage = journal_conf_max_usage(j);
+	size_t ch_size = prep->ch_size;
+	uint32_t ch_from = prep->ch.serial_from;
+	uint32_t ch_to = prep->ch.serial_to;
+
 	journal_metadata_t md = { 0 };
-	knot_lmdb_begin(j.db, &txn, true);
-	journal_load_metadata(&txn, j.zone, &md);
+	journal_load_metadata(txn, j.zone, &md);
 
-	update_last_inserter(&txn, j.zone);
+	update_last_inserter(txn, j.zone);
 
-	if (extra != NULL) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+	if (prep->has_extra) {
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		}
 		uint64_t merged_freed = 0;
-		delete_merged(&txn, j.zone, &md, &merged_freed);
-		ch_size += changeset_serialized_size(extra);
+		delete_merged(txn, j.zone, &md, &merged_freed);
+		ch_size += prep->extra_size;
 		ch_size -= merged_freed;
 		md.flushed_upto = md.serial_to; // set temporarily
 		md.flags |= JOURNAL_LAST_FLUSHED_VALID;
 	}
 
 	size_t chs_limit = journal_conf_max_changesets(j);
-	journal_fix_occupation(j, &txn, &md, max_usage - ch_size, chs_limit - 1);
+	journal_fix_occupation(j, txn, &md, max_usage - ch_size, chs_limit - 1);
 
 	// avoid discontinuity
 	if ((md.flags & JOURNAL_SERIAL_TO_VALID) && md.serial_to != ch_from) {
-		if (journal_contains(&txn, true, 0, j.zone)) {
-			txn.ret = KNOT_ESEMCHECK;
+		if (journal_contains(txn, true, 0, j.zone)) {
+			txn->ret = KNOT_ESEMCHECK;
 		} else {
-			journal_del_zone_txn(&txn, j.zone);
+			journal_del_zone_txn(txn, j.zone);
 			memset(&md, 0, sizeof(md));
 		}
 	}
 
 	// avoid cycle
-	if (journal_contains(&txn, false, ch_to, j.zone)) {
-		journal_fix_occupation(j, &txn, &md, INT64_MAX, 1);
+	if (journal_contains(txn, false, ch_to, j.zone)) {
+		journal_fix_occupation(j, txn, &md, INT64_MAX, 1);
 	}
 
-	if (zdiff == NULL) {
-		journal_write_changeset(&txn, ch);
-	} else {
-		journal_write_zone_diff(&txn, zdiff);
-	}
+	journal_write_chunks(txn, &prep->ch);
 	journal_metadata_after_insert(&md, ch_from, ch_to);
 
-	if (extra != NULL) {
-		journal_write_changeset(&txn, extra);
-		journal_metadata_after_extra(&md, changeset_from(extra), changeset_to(extra));
+	if (prep->has_extra) {
+		journal_write_chunks(txn, &prep->extra);
+		journal_metadata_after_extra(&md, prep->extra.serial_from, prep->extra.serial_to);
 	}
 
-	journal_store_metadata(&txn, j.zone, &md);
+	journal_store_metadata(txn, j.zone, &md);
+}
+
+int journal_insert_prepared(zone_journal_t j, const journal_prepared_t *prep)
+{
+	int ret = knot_lmdb_open(j.db);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(j.db, &txn, true);
+	journal_insert_txn(j, &txn, prep);
 	knot_lmdb_commit(&txn);
 	return txn.ret;
 }
+
+int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
+                   const zone_diff_t *zdiff)
+{
+	journal_prepared_t prep;
+	int ret = journal_insert_prepare(j, ch, extra, zdiff, &prep);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = journal_insert_prepared(j, &prep);
+	journal_prepared_clear(&prep);
+	return ret;
+}
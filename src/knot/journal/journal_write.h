@@ -20,21 +20,80 @@
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/serialization.h"
 
+/*! \brief Changeset serialized into journal chunks, ready to be written. */
+typedef struct {
+	const knot_dname_t *apex;
+	uint32_t serial_from;
+	uint32_t serial_to;
+	bool zij;
+	size_t size;      // Serialized size without the headers and compression.
+	size_t count;
+	MDB_val *chunks;  // Including the chunk headers.
+} journal_chunks_t;
+
+/*! \brief Changeset checked and serialized by journal_insert_prepare(). */
+typedef struct {
+	journal_chunks_t ch;
+	journal_chunks_t extra;
+	bool has_extra;
+	size_t ch_size;
+	size_t extra_size;
+} journal_prepared_t;
+
+/*!
+ * \brief Serialize a changeset into chunks, no DB access.
+ *
+ * The changeset is serialized sequentially, the chunks are compressed by
+ * more threads in parallel.
+ *
+ * \param out        Output: serialized chunks, to be cleared by journal_chunks_clear().
+ * \param ch         Changeset to be serialized.
+ * \param compress   Compress the chunks if supported.
+ * \param threads    Number of compressing threads.
+ *
+ * \return KNOT_E*
+ */
+int journal_serialize_changeset(journal_chunks_t *out, const changeset_t *ch,
+                                bool compress, unsigned threads);
+
+/*!
+ * \brief Serialize zone contents aka "bootstrap" changeset into chunks, no DB access.
+ *
+ * \see journal_serialize_changeset()
+ */
+int journal_serialize_zone(journal_chunks_t *out, const zone_contents_t *z,
+                           bool compress, unsigned threads);
+
+/*!
+ * \brief Write serialized chunks into DB with no checks and metadata update.
+ *
+ * \param txn      Journal DB transaction.
+ * \param chunks   Serialized changeset.
+ */
+void journal_write_chunks(knot_lmdb_txn_t *txn, const journal_chunks_t *chunks);
+
+/*!
+ * \brief Free the serialized chunks.
+ */
+void journal_chunks_clear(journal_chunks_t *chunks);
+
 /*!
  * \brief Serialize a changeset into chunks and write it into DB with no checks and metadata update.
  *
- * \param txn   Journal DB transaction.
- * \param ch    Changeset to be written.
+ * \param txn        Journal DB transaction.
+ * \param ch         Changeset to be written.
+ * \param compress   Compress the chunks if supported.
  */
-void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch);
+void journal_write_changeset(knot_lmdb_txn_t *txn, const changeset_t *ch, bool compress);
 
 /*!
  * \brief Serialize zone contents aka "bootstrap" changeset into journal, no checks.
  *
- * \param txn   Journal DB transaction.
- * \param z     Zone contents to be written.
+ * \param txn        Journal DB transaction.
+ * \param z          Zone contents to be written.
+ * \param compress   Compress the chunks if supported.
  */
-void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z);
+void journal_write_zone(knot_lmdb_txn_t *txn, const zone_contents_t *z, bool compress);
 
 /*!
  * \brief Merge all following changeset into one of journal changeset.
@@ -92,6 +151,31 @@ void journal_try_flush(zone_journal_t j, knot_lmdb_txn_t *txn, journal_metadata_
 void journal_fix_occupation(zone_journal_t j, knot_lmdb_txn_t *txn, journal_metadata_t *md,
 			    int64_t max_usage, ssize_t max_count);
 
+/*! \brief Journal occupancy (percentage of the limits) to merge the changesets ahead. */
+#define JOURNAL_COMPACT_PCT 75
+
+/*!
+ * \brief Check if the changesets of the zone shall be merged ahead of time.
+ *
+ * Without zone file flushing, the changesets are merged once the journal
+ * hits its limits, within the inserting transaction. To avoid that, the merge
+ * is due as soon as the journal is over JOURNAL_COMPACT_PCT of the limits.
+ *
+ * \param j    Zone journal.
+ *
+ * \return True if journal_compact() shall be called.
+ */
+bool journal_compact_due(zone_journal_t j);
+
+/*!
+ * \brief Merge all the changesets and delete the merged ones if due.
+ *
+ * \param j    Zone journal.
+ *
+ * \return KNOT_E*
+ */
+int journal_compact(zone_journal_t j);
+
 /*!
  * \brief Store zone-in-journal into the journal, update metadata.
  *
@@ -119,3 +203,47 @@ int journal_insert_zone(zone_journal_t j, const zone_contents_t *z);
  */
 int journal_insert(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
                    const zone_diff_t *zdiff);
+
+/*!
+ * \brief Check if the changeset can be stored into journal and serialize it.
+ *
+ * \note The serialization is done outside of any DB transaction, so that
+ *       the write transaction is kept short.
+ *
+ * \param j         Zone journal.
+ * \param ch        Changeset to be stored.
+ * \param extra     Extra changeset to be stored in the role of merged changeset.
+ * \param zdiff     Zone diff to be stored instead of changeset.
+ * \param out       Output: serialized changesets, to be cleared by journal_prepared_clear().
+ *
+ * \return KNOT_E*
+ */
+int journal_insert_prepare(zone_journal_t j, const changeset_t *ch, const changeset_t *extra,
+                           const zone_diff_t *zdiff, journal_prepared_t *out);
+
+/*!
+ * \brief Free the changesets serialized by journal_insert_prepare().
+ */
+void journal_prepared_clear(journal_prepared_t *prep);
+
+/*!
+ * \brief Store prepared changeset into journal within an open read-write txn.
+ *
+ * \see journal_insert()
+ *
+ * \param j         Zone journal.
+ * \param txn       Journal DB transaction.
+ * \param prep      Changeset serialized by journal_insert_prepare().
+ *
+ * \note The error code will be in txn->ret.
+ */
+void journal_insert_txn(zone_journal_t j, knot_lmdb_txn_t *txn, const journal_prepared_t *prep);
+
+/*!
+ * \brief Store prepared changeset into journal in its own transaction.
+ *
+ * \see journal_insert_txn()
+ *
+ * \return KNOT_E*
+ */
+int journal_insert_prepared(zone_journal_t j, const journal_prepared_t *prep);
@@ -17,13 +17,16 @@
 #include <stdarg.h>
 #include <stdio.h> // snprintf
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "knot/journal/knot_lmdb.h"
 
 #include "knot/conf/conf.h"
 #include "contrib/files.h"
+#include "contrib/macros.h"
 #include "contrib/wire_ctx.h"
 #include "libknot/dname.h"
 #include "libknot/endian.h"
@@ -79,6 +82,8 @@ void knot_lmdb_init(knot_lmdb_db_t *db, const char *path, size_t mapsize, unsign
 	db->env_flags = env_flags;
 	db->dbname = dbname;
 	pthread_mutex_init(&db->opening_mutex, NULL);
+	db->txn_count = 0;
+	db->resizing = 0;
 	db->maxdbs = 2;
 	db->maxreaders = conf_lmdb_readers(conf());
 }
@@ -222,6 +227,18 @@ void knot_lmdb_close(knot_lmdb_db_t *db)
 	pthread_mutex_unlock(&db->opening_mutex);
 }
 
+int knot_lmdb_sync(knot_lmdb_db_t *db)
+{
+	int ret = MDB_SUCCESS;
+	pthread_mutex_lock(&db->opening_mutex);
+	if (db->env != NULL) {
+		ret = mdb_env_sync(db->env, 1);
+	}
+	pthread_mutex_unlock(&db->opening_mutex);
+	err_to_knot(&ret);
+	return ret;
+}
+
 static int lmdb_reinit(knot_lmdb_db_t *db, const char *path, size_t mapsize, unsigned env_flags)
 {
 #ifdef __OpenBSD__
@@ -270,14 +287,90 @@ void knot_lmdb_deinit(knot_lmdb_db_t *db)
 	free(db->path);
 }
 
+static void pause_ms(long ms)
+{
+	struct timespec pause = { 0, ms * 1000000 };
+	nanosleep(&pause, NULL);
+}
+
+static void txn_enter(knot_lmdb_db_t *db)
+{
+	while (true) {
+		while (__atomic_load_n(&db->resizing, __ATOMIC_ACQUIRE)) {
+			pause_ms(1);
+		}
+		__atomic_add_fetch(&db->txn_count, 1, __ATOMIC_SEQ_CST);
+		if (!__atomic_load_n(&db->resizing, __ATOMIC_SEQ_CST)) {
+			return;
+		}
+		__atomic_sub_fetch(&db->txn_count, 1, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void txn_leave(knot_lmdb_db_t *db)
+{
+	__atomic_sub_fetch(&db->txn_count, 1, __ATOMIC_RELEASE);
+}
+
+int knot_lmdb_grow(knot_lmdb_db_t *db, size_t mapsize)
+{
+	if (!knot_lmdb_is_open(db)) {
+		return KNOT_EINVAL;
+	}
+
+	int idle = 0;
+	if (!__atomic_compare_exchange_n(&db->resizing, &idle, 1, false,
+	                                 __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+		return KNOT_EBUSY; // Another thread is resizing.
+	}
+
+	// Limited waiting, the caller or a thread holding a transaction
+	// can be opening another one.
+	int ret = KNOT_EBUSY;
+	for (int tries = 0; tries < 1000; tries++) {
+		if (__atomic_load_n(&db->txn_count, __ATOMIC_SEQ_CST) == 0) {
+			ret = KNOT_EOK;
+			break;
+		}
+		pause_ms(1);
+	}
+
+	MDB_envinfo info;
+	if (ret == KNOT_EOK) {
+		ret = mdb_env_info(db->env, &info);
+	}
+	if (ret == MDB_SUCCESS && (mapsize == 0 || mapsize > info.me_mapsize)) {
+		ret = mdb_env_set_mapsize(db->env, mapsize);
+		if (ret == MDB_SUCCESS && mdb_env_info(db->env, &info) == MDB_SUCCESS) {
+			db->mapsize = info.me_mapsize;
+		}
+	}
+	__atomic_store_n(&db->resizing, 0, __ATOMIC_RELEASE);
+
+	err_to_knot(&ret);
+	return ret;
+}
+
 void knot_lmdb_begin(knot_lmdb_db_t *db, knot_lmdb_txn_t *txn, bool rw)
 {
+	txn_enter(db);
 	txn->ret = mdb_txn_begin(db->env, NULL, rw ? 0 : MDB_RDONLY, &txn->txn);
+	if (txn->ret == MDB_MAP_RESIZED) {
+		// The map was enlarged by another process, adopt its size.
+		txn_leave(db);
+		txn->ret = knot_lmdb_grow(db, 0);
+		txn_enter(db);
+		if (txn->ret == KNOT_EOK || txn->ret == KNOT_EBUSY) {
+			txn->ret = mdb_txn_begin(db->env, NULL, rw ? 0 : MDB_RDONLY, &txn->txn);
+		}
+	}
 	err_to_knot(&txn->ret);
 	if (txn->ret == KNOT_EOK) {
 		txn->opened = true;
 		txn->db = db;
 		txn->is_rw = rw;
+	} else {
+		txn_leave(db);
 	}
 }
 
@@ -290,6 +383,7 @@ void knot_lmdb_abort(knot_lmdb_txn_t *txn)
 		}
 		mdb_txn_abort(txn->txn);
 		txn->opened = false;
+		txn_leave(txn->db);
 	}
 }
 
@@ -317,6 +411,7 @@ void knot_lmdb_commit(knot_lmdb_txn_t *txn)
 	txn->ret = mdb_txn_commit(txn->txn);
 	err_to_knot(&txn->ret);
 	txn->opened = false;
+	txn_leave(txn->db);
 }
 
 // save the programmer's frequent checking for ENOMEM when creating search keys
@@ -547,15 +642,51 @@ int knot_lmdb_copy_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
-	knot_lmdb_txn_t tr = { 0 }, tw = { 0 };
-	knot_lmdb_begin(from, &tr, false);
-	knot_lmdb_begin(to, &tw, true);
-	for (size_t i = 0; i < n_prefixes && ret == KNOT_EOK; i++) {
-		ret = knot_lmdb_copy_prefix(&tr, &tw, &prefixes[i]);
+	for (int attempt = 0; ; attempt++) {
+		knot_lmdb_txn_t tr = { 0 }, tw = { 0 };
+		knot_lmdb_begin(from, &tr, false);
+		knot_lmdb_begin(to, &tw, true);
+		for (size_t i = 0; i < n_prefixes && ret == KNOT_EOK; i++) {
+			ret = knot_lmdb_copy_prefix(&tr, &tw, &prefixes[i]);
+		}
+		knot_lmdb_commit(&tw);
+		knot_lmdb_commit(&tr);
+		ret = (ret == KNOT_EOK ? tw.ret : ret);
+
+		// The source may have grown since the target was created.
+		if (ret != KNOT_ESPACE || attempt >= 4 ||
+		    knot_lmdb_grow(to, 2 * to->mapsize) != KNOT_EOK) {
+			return ret;
+		}
+		ret = KNOT_EOK;
+	}
+}
+
+void knot_lmdb_prefetch(knot_lmdb_txn_t *txn, MDB_val *prefix, size_t max_size)
+{
+#ifdef MADV_WILLNEED
+	long page_size = sysconf(_SC_PAGESIZE);
+	if (page_size <= 0 || txn->ret != KNOT_EOK) {
+		return;
+	}
+
+	size_t total = 0;
+	knot_lmdb_foreach(txn, prefix) {
+		// Small values share the pages with the keys, already touched.
+		size_t len = txn->cur_val.mv_size;
+		if (len < (size_t)page_size) {
+			continue;
+		}
+		if (total + len > max_size) {
+			break;
+		}
+		total += len;
+
+		uintptr_t start = (uintptr_t)txn->cur_val.mv_data & ~(uintptr_t)(page_size - 1);
+		uintptr_t end = (uintptr_t)txn->cur_val.mv_data + len;
+		(void)madvise((void *)start, end - start, MADV_WILLNEED);
 	}
-	knot_lmdb_commit(&tw);
-	knot_lmdb_commit(&tr);
-	return ret == KNOT_EOK ? tw.ret : ret;
+#endif
 }
 
 size_t knot_lmdb_usage(knot_lmdb_txn_t *txn)
@@ -571,6 +702,39 @@ size_t knot_lmdb_usage(knot_lmdb_txn_t *txn)
 	return (pgs_used * st.ms_psize);
 }
 
+size_t knot_lmdb_resident(knot_lmdb_db_t *db)
+{
+	if (!knot_lmdb_is_open(db)) {
+		return 0;
+	}
+
+	MDB_envinfo info;
+	MDB_stat st;
+	if (mdb_env_info(db->env, &info) != MDB_SUCCESS ||
+	    mdb_env_stat(db->env, &st) != MDB_SUCCESS || info.me_mapaddr == NULL) {
+		return 0;
+	}
+
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t len = MIN((info.me_last_pgno + 1) * st.ms_psize, info.me_mapsize);
+	len = (len + page - 1) & ~(page - 1);
+
+	// Checked in blocks to keep the page vector small.
+	unsigned char vec[1024];
+	size_t resident = 0;
+	for (size_t off = 0; off < len; off += sizeof(vec) * page) {
+		size_t block = MIN(len - off, sizeof(vec) * page);
+		if (mincore((uint8_t *)info.me_mapaddr + off, block, vec) != 0) {
+			break;
+		}
+		for (size_t i = 0; i < block / page; i++) {
+			resident += (vec[i] & 1) ? page : 0;
+		}
+	}
+
+	return resident;
+}
+
 static bool make_key_part(void *key_data, size_t key_len, const char *format, va_list arg)
 {
 	wire_ctx_t wire = wire_ctx_init(key_data, key_len);
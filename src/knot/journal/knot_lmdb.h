@@ -27,6 +27,8 @@ typedef struct knot_lmdb_db {
 	MDB_dbi dbi;
 	MDB_env *env;
 	pthread_mutex_t opening_mutex;
+	unsigned txn_count; // transactions in progress, the map can't be resized meanwhile
+	int resizing;
 
 	// those are static options. Set them after knot_lmdb_init().
 	unsigned maxdbs;
@@ -119,6 +121,15 @@ int knot_lmdb_open(knot_lmdb_db_t *db);
  */
 void knot_lmdb_close(knot_lmdb_db_t *db);
 
+/*!
+ * \brief Flush the committed data to the disk, if the DB is open.
+ *
+ * \note Useful with MDB_NOSYNC, when the commits don't wait for the disk.
+ *
+ * \return KNOT_E*
+ */
+int knot_lmdb_sync(knot_lmdb_db_t *db);
+
 /*!
  * \brief Re-initialise existing DB with modified parameters.
  *
@@ -355,6 +366,19 @@ int knot_lmdb_quick_insert(knot_lmdb_db_t *db, MDB_val key, MDB_val val);
  */
 int knot_lmdb_copy_prefix(knot_lmdb_txn_t *from, knot_lmdb_txn_t *to, MDB_val *prefix);
 
+/*!
+ * \brief Enlarges the memory map of an open DB.
+ *
+ * Waits until no transaction of this process uses the DB. The map is never
+ * shrunk, zero size only adopts the size set by another process.
+ *
+ * \param db       DB to be enlarged.
+ * \param mapsize  Requested map size.
+ *
+ * \return KNOT_E*
+ */
+int knot_lmdb_grow(knot_lmdb_db_t *db, size_t mapsize);
+
 /*!
  * \brief Copy all records matching any of multiple prefixes.
  *
@@ -364,12 +388,27 @@ int knot_lmdb_copy_prefix(knot_lmdb_txn_t *from, knot_lmdb_txn_t *to, MDB_val *p
  * \param n_prefixes  Number of prefixes in the list.
  *
  * \note Prior to copying, all records from the target DB, matching any of the prefixes, will be deleted!
+ * \note The map of the target DB is enlarged if it gets full.
  *
  * \return KNOT_E*
  */
 int knot_lmdb_copy_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
                             MDB_val *prefixes, size_t n_prefixes);
 
+/*!
+ * \brief Asks the kernel to read ahead the values of the keys with the prefix.
+ *
+ * The values are only located, not touched, so the subsequent reading of
+ * large values (e.g. journal chunks) doesn't wait for random page faults.
+ *
+ * \note The cursor position is changed.
+ *
+ * \param txn       DB transaction.
+ * \param prefix    Prefix of the keys.
+ * \param max_size  Limit of the total size to be read ahead.
+ */
+void knot_lmdb_prefetch(knot_lmdb_txn_t *txn, MDB_val *prefix, size_t max_size);
+
 /*!
  * \brief Amount of bytes used by the DB storage.
  *
@@ -381,6 +420,15 @@ int knot_lmdb_copy_prefixes(knot_lmdb_db_t *from, knot_lmdb_db_t *to,
  */
 size_t knot_lmdb_usage(knot_lmdb_txn_t *txn);
 
+/*!
+ * \brief Amount of bytes of the used DB pages resident in the memory.
+ *
+ * \param db   DB (closed DB has nothing resident).
+ *
+ * \return Resident size.
+ */
+size_t knot_lmdb_resident(knot_lmdb_db_t *db);
+
 /*!
  * \brief Serialize various parameters into a DB key.
  *
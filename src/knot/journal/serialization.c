@@ -461,6 +461,22 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 	}
 	knot_rrset_init(rrset, owner, type, rclass, 0);
 
+	// Reserve the whole rdata array at once, the RRs are appended linearly.
+	knot_rdataset_builder_t builder = { 0 };
+	wire_ctx_t scan = *wire;
+	size_t rdata_total = 0;
+	for (size_t phase = 0; phase < rrcount && wire_ctx_available(&scan) > 0; phase++) {
+		wire_ctx_skip(&scan, sizeof(uint32_t));
+		uint16_t rdata_size = wire_ctx_read_u16(&scan);
+		wire_ctx_skip(&scan, rdata_size);
+		rdata_total += knot_rdata_size(rdata_size);
+	}
+	if (scan.error == KNOT_EOK &&
+	    knot_rdataset_builder_reserve(&builder, rdata_total) != KNOT_EOK) {
+		knot_rrset_clear(rrset, NULL);
+		return KNOT_ENOMEM;
+	}
+
 	for (size_t phase = 0; phase < rrcount && wire_ctx_available(wire) > 0; phase++) {
 		uint32_t ttl = wire_ctx_read_u32(wire);
 		uint32_t rdata_size = wire_ctx_read_u16(wire);
@@ -468,9 +484,16 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 			rrset->ttl = ttl;
 		}
 		if (wire->error != KNOT_EOK ||
-		    wire_ctx_available(wire) < rdata_size ||
-		    knot_rrset_add_rdata(rrset, wire->position, rdata_size,
-					 NULL) != KNOT_EOK) {
+		    wire_ctx_available(wire) < rdata_size) {
+			knot_rdataset_builder_clear(&builder);
+			knot_rrset_clear(rrset, NULL);
+			return KNOT_EMALF;
+		}
+		uint8_t buf[knot_rdata_size(rdata_size)];
+		knot_rdata_t *rdata = (knot_rdata_t *)buf;
+		knot_rdata_init(rdata, rdata_size, wire->position);
+		if (knot_rdataset_builder_append(&builder, rdata) != KNOT_EOK) {
+			knot_rdataset_builder_clear(&builder);
 			knot_rrset_clear(rrset, NULL);
 			return KNOT_EMALF;
 		}
@@ -478,6 +501,13 @@ int deserialize_rrset(wire_ctx_t *wire, knot_rrset_t *rrset)
 		assert(wire->error == KNOT_EOK);
 	}
 
+	if (knot_rdataset_builder_finalize(&builder) != KNOT_EOK) {
+		knot_rdataset_builder_clear(&builder);
+		knot_rrset_clear(rrset, NULL);
+		return KNOT_ENOMEM;
+	}
+	rrset->rrs = builder.rrs;
+
 	return KNOT_EOK;
 }
 
@@ -27,10 +27,14 @@
 #define ATOMIC_SET(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_RELAXED)
 #define ATOMIC_GET(src)      __atomic_load_n(&(src), __ATOMIC_RELAXED)
 #define ATOMIC_ADD(dst, val) __atomic_add_fetch(&(dst), (val), __ATOMIC_RELAXED)
+#define ATOMIC_ACQ(src)      __atomic_load_n(&(src), __ATOMIC_ACQUIRE)
+#define ATOMIC_REL_INC(dst)  __atomic_add_fetch(&(dst), 1, __ATOMIC_RELEASE)
 #else
 #define ATOMIC_SET(dst, val) ((dst) = (val))
 #define ATOMIC_GET(src)      (src)
 #define ATOMIC_ADD(dst, val) ((dst) += (val))
+#define ATOMIC_ACQ(src)      (src)
+#define ATOMIC_REL_INC(dst)  ((dst) += 1)
 #endif
 
 #define BADCOOKIE_CTR_INIT	1
@@ -57,11 +61,20 @@ int cookies_conf_check(knotd_conf_check_args_t *args)
 	return KNOT_EOK;
 }
 
+// Copy of the server secret private to an answering thread.
+typedef struct {
+	uint32_t generation;
+	uint8_t secret[KNOT_EDNS_COOKIE_SECRET_SIZE];
+} __attribute__((aligned(64))) thread_secret_t;
+
 typedef struct {
 	struct {
 		uint64_t variable;
 		uint64_t constant;
 	} secret;
+	uint32_t secret_gen; // Incremented after each secret change.
+	thread_secret_t *threads;
+	unsigned thread_count;
 	pthread_t update_secret;
 	uint32_t secret_lifetime;
 	uint32_t badcookie_slip;
@@ -91,10 +104,35 @@ static int generate_secret(cookies_ctx_t *ctx)
 	}
 
 	ATOMIC_SET(ctx->secret.variable, new_secret);
+	ATOMIC_REL_INC(ctx->secret_gen);
 
 	return KNOT_EOK;
 }
 
+static void load_secret(cookies_ctx_t *ctx, unsigned thread_id, uint8_t *secret)
+{
+	assert(ctx && secret);
+
+	// The generation is checked first, so the copy is never older than it.
+	uint32_t gen = ATOMIC_ACQ(ctx->secret_gen);
+	thread_secret_t *cache = (thread_id < ctx->thread_count) ?
+	                         &ctx->threads[thread_id] : NULL;
+	if (cache != NULL && cache->generation == gen) {
+		memcpy(secret, cache->secret, KNOT_EDNS_COOKIE_SECRET_SIZE);
+		return;
+	}
+
+	uint64_t current_secret = ATOMIC_GET(ctx->secret.variable);
+	memcpy(secret, &current_secret, sizeof(current_secret));
+	memcpy(secret + sizeof(current_secret), &ctx->secret.constant,
+	       sizeof(ctx->secret.constant));
+
+	if (cache != NULL) {
+		memcpy(cache->secret, secret, KNOT_EDNS_COOKIE_SECRET_SIZE);
+		cache->generation = gen;
+	}
+}
+
 static void *update_secret(void *data)
 {
 	knotd_mod_t *mod = (knotd_mod_t *)data;
@@ -179,10 +217,7 @@ static knotd_state_t cookies_process(knotd_state_t state, knot_pkt_t *pkt,
 		.lifetime_after = 300,
 		.client_addr = knotd_qdata_remote_addr(qdata)
 	};
-	uint64_t current_secret = ATOMIC_GET(ctx->secret.variable);
-	memcpy(params.secret, &current_secret, sizeof(current_secret));
-	memcpy(params.secret + sizeof(current_secret), &ctx->secret.constant,
-	       sizeof(ctx->secret.constant));
+	load_secret(ctx, qdata->params->thread_id, params.secret);
 
 	// Compare server cookie.
 	ret = knot_edns_cookie_server_check(&sc, &cc, &params);
@@ -259,6 +294,17 @@ int cookies_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	// Prepare the per-thread secret copies, invalid until the first use.
+	ctx->thread_count = knotd_mod_threads(mod);
+	ctx->threads = calloc(ctx->thread_count, sizeof(*ctx->threads));
+	if (ctx->threads == NULL) {
+		free(ctx);
+		return KNOT_ENOMEM;
+	}
+	for (unsigned i = 0; i < ctx->thread_count; i++) {
+		ctx->threads[i].generation = UINT32_MAX;
+	}
+
 	// Store module context before rollover thread is created.
 	knotd_mod_ctx_set(mod, ctx);
 
@@ -271,6 +317,7 @@ int cookies_load(knotd_mod_t *mod)
 	} else {
 		ret = dnssec_random_buffer((uint8_t *)&ctx->secret, sizeof(ctx->secret));
 		if (ret != KNOT_EOK) {
+			free(ctx->threads);
 			free(ctx);
 			return ret;
 		}
@@ -281,6 +328,7 @@ int cookies_load(knotd_mod_t *mod)
 		// Start the secret rollover thread.
 		if (pthread_create(&ctx->update_secret, NULL, update_secret, (void *)mod)) {
 			knotd_mod_log(mod, LOG_ERR, "failed to create the secret rollover thread");
+			free(ctx->threads);
 			free(ctx);
 			return KNOT_ERROR;
 		}
@@ -302,6 +350,8 @@ void cookies_unload(knotd_mod_t *mod)
 		(void)pthread_join(ctx->update_secret, NULL);
 	}
 	memzero(&ctx->secret, sizeof(ctx->secret));
+	memzero(ctx->threads, ctx->thread_count * sizeof(*ctx->threads));
+	free(ctx->threads);
 	free(ctx);
 }
 
@@ -14,7 +14,12 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
 #include "contrib/net.h"
+#include "contrib/ucw/lists.h"
 #include "knot/include/module.h"
 #include "knot/conf/schema.h"
 #include "knot/query/capture.h" // Forces static module!
@@ -26,6 +31,7 @@
 #define MOD_TIMEOUT		"\x07""timeout"
 #define MOD_FALLBACK		"\x08""fallback"
 #define MOD_CATCH_NXDOMAIN	"\x0E""catch-nxdomain"
+#define MOD_COALESCE		"\x08""coalesce"
 
 const yp_item_t dnsproxy_conf[] = {
 	{ MOD_REMOTE,         YP_TREF,  YP_VREF = { C_RMT }, YP_FNONE,
@@ -35,6 +41,7 @@ const yp_item_t dnsproxy_conf[] = {
 	{ MOD_FALLBACK,       YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_TCP_FASTOPEN,   YP_TBOOL, YP_VNONE },
 	{ MOD_CATCH_NXDOMAIN, YP_TBOOL, YP_VNONE },
+	{ MOD_COALESCE,       YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -56,36 +63,30 @@ typedef struct {
 	bool fallback;
 	bool tfo;
 	bool catch_nxdomain;
+	bool coalesce;
 	int timeout;
+	pthread_mutex_t lock;
+	list_t inflight;
 } dnsproxy_t;
 
-static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
-                                  knotd_qdata_t *qdata, knotd_mod_t *mod)
-{
-	assert(pkt && qdata && mod);
-
-	dnsproxy_t *proxy = knotd_mod_ctx(mod);
-
-	/* Forward only queries ending with REFUSED (no zone) or NXDOMAIN (if configured) */
-	if (proxy->fallback && !(qdata->rcode == KNOT_RCODE_REFUSED ||
-	     (qdata->rcode == KNOT_RCODE_NXDOMAIN && proxy->catch_nxdomain))) {
-		return state;
-	}
-
-	/* Forward from specified addresses only if configured. */
-	if (proxy->addr.count > 0) {
-		const struct sockaddr_storage *addr = knotd_qdata_remote_addr(qdata);
-		if (!knotd_conf_addr_range_match(&proxy->addr, addr)) {
-			return state;
-		}
-	}
-
-	/* Forward also original TSIG. */
-	if (qdata->query->tsig_rr != NULL && !proxy->fallback) {
-		knot_tsig_append(qdata->query->wire, &qdata->query->size,
-		                 qdata->query->max_size, qdata->query->tsig_rr);
-	}
+/*! Key of identical queries: QNAME wire, QTYPE, QCLASS, flags, EDNS payload. */
+#define KEY_MAXLEN (KNOT_DNAME_MAXLEN + 2 * sizeof(uint16_t) + 2 + sizeof(uint16_t))
 
+/*! \brief Upstream query with the same-query waiters. */
+typedef struct {
+	node_t n;
+	uint8_t key[KEY_MAXLEN];
+	size_t key_len;
+	uint8_t *resp;      // Copy of the upstream response.
+	size_t resp_len;
+	int ret;
+	bool done;
+	unsigned refs;
+	pthread_cond_t cond;
+} inflight_t;
+
+static int forward(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata, bool tsig)
+{
 	/* Capture layer context. */
 	const knot_layer_api_t *capture = query_capture_api();
 	struct capture_param capture_param = {
@@ -96,7 +97,7 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 	knot_requestor_t re;
 	int ret = knot_requestor_init(&re, capture, &capture_param, qdata->mm);
 	if (ret != KNOT_EOK) {
-		return state; /* Ignore, not enough memory. */
+		return ret;
 	}
 
 	knot_request_flag_t flags = KNOT_REQUEST_NONE;
@@ -104,14 +105,18 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 		flags = KNOT_REQUEST_UDP;
 	} else if (proxy->tfo) {
 		flags = KNOT_REQUEST_TFO;
+	} else if (!tsig) {
+		// The message ID can be changed on a shared connection.
+		flags = KNOT_REQUEST_MUX;
 	}
 	const struct sockaddr_storage *dst = &proxy->remote;
 	const struct sockaddr_storage *src = &proxy->via;
+	uint16_t id = knot_wire_get_id(qdata->query->wire);
 	knot_request_t *req = knot_request_make(re.mm, dst, src, qdata->query, NULL,
 	                                        flags);
 	if (req == NULL) {
 		knot_requestor_clear(&re);
-		return state; /* Ignore, not enough memory. */
+		return KNOT_ENOMEM;
 	}
 
 	/* Forward request. */
@@ -120,6 +125,179 @@ static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
 	knot_request_free(req, re.mm);
 	knot_requestor_clear(&re);
 
+	/* Restore the original message ID. */
+	knot_wire_set_id(qdata->query->wire, id);
+	if (ret == KNOT_EOK) {
+		knot_wire_set_id(pkt->wire, id);
+	}
+
+	return ret;
+}
+
+static size_t query_key(const knot_pkt_t *query, bool udp, uint8_t *key)
+{
+	/* Different EDNS options or TSIG may produce a different response. */
+	if (query->tsig_rr != NULL || query->qname_size == 0 ||
+	    (query->opt_rr != NULL && query->opt_rr->rrs.rdata->len > 0)) {
+		return 0;
+	}
+
+	uint8_t *pos = key;
+	memcpy(pos, knot_pkt_wire_qname(query), query->qname_size);
+	pos += query->qname_size;
+	memcpy(pos, query->wire + KNOT_WIRE_HEADER_SIZE + query->qname_size,
+	       2 * sizeof(uint16_t));
+	pos += 2 * sizeof(uint16_t);
+	*pos++ = knot_wire_get_flags1(query->wire) & KNOT_WIRE_RD_MASK;
+	*pos++ = (knot_wire_get_flags2(query->wire) & KNOT_WIRE_CD_MASK) |
+	         (knot_pkt_has_dnssec(query) ? 1 : 0);
+	uint16_t payload = 0;
+	if (udp && query->opt_rr != NULL) {
+		payload = knot_edns_get_payload(query->opt_rr);
+	}
+	memcpy(pos, &payload, sizeof(payload));
+	pos += sizeof(payload);
+
+	return pos - key;
+}
+
+static void inflight_release(inflight_t *inf)
+{
+	if (--inf->refs == 0) {
+		pthread_cond_destroy(&inf->cond);
+		free(inf->resp);
+		free(inf);
+	}
+}
+
+/*! \brief Forwards the query unless the same query is already being forwarded. */
+static int forward_coalesced(dnsproxy_t *proxy, knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	uint8_t key[KEY_MAXLEN];
+	size_t key_len = query_key(qdata->query, !net_is_stream(qdata->params->socket), key);
+	if (key_len == 0) {
+		return forward(proxy, pkt, qdata, qdata->query->tsig_rr != NULL);
+	}
+
+	pthread_mutex_lock(&proxy->lock);
+	inflight_t *inf = NULL, *it;
+	WALK_LIST(it, proxy->inflight) {
+		if (it->key_len == key_len && memcmp(it->key, key, key_len) == 0) {
+			inf = it;
+			break;
+		}
+	}
+
+	/* Wait for the response of the identical query. */
+	if (inf != NULL) {
+		inf->refs++;
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += proxy->timeout / 1000;
+		deadline.tv_nsec += (proxy->timeout % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		int ret = KNOT_EOK;
+		while (!inf->done && ret == KNOT_EOK) {
+			if (pthread_cond_timedwait(&inf->cond, &proxy->lock, &deadline) != 0) {
+				ret = inf->done ? KNOT_EOK : KNOT_ETIMEOUT;
+			}
+		}
+		if (inf->done) {
+			ret = inf->ret;
+		}
+		if (ret == KNOT_EOK && inf->resp_len > pkt->max_size) {
+			ret = KNOT_ESPACE;
+		}
+		if (ret == KNOT_EOK) {
+			knot_pkt_clear(pkt);
+			memcpy(pkt->wire, inf->resp, inf->resp_len);
+			pkt->size = inf->resp_len;
+		}
+		inflight_release(inf);
+		pthread_mutex_unlock(&proxy->lock);
+
+		if (ret == KNOT_EOK) {
+			knot_wire_set_id(pkt->wire, knot_wire_get_id(qdata->query->wire));
+			ret = knot_pkt_parse(pkt, 0);
+		}
+		return ret;
+	}
+
+	inf = calloc(1, sizeof(*inf));
+	if (inf == NULL) {
+		pthread_mutex_unlock(&proxy->lock);
+		return forward(proxy, pkt, qdata, false);
+	}
+	memcpy(inf->key, key, key_len);
+	inf->key_len = key_len;
+	inf->refs = 1;
+	pthread_cond_init(&inf->cond, NULL);
+	add_tail(&proxy->inflight, &inf->n);
+	pthread_mutex_unlock(&proxy->lock);
+
+	int ret = forward(proxy, pkt, qdata, false);
+
+	pthread_mutex_lock(&proxy->lock);
+	rem_node(&inf->n);
+	inf->ret = ret;
+	if (ret == KNOT_EOK && inf->refs > 1) {
+		inf->resp = malloc(pkt->size);
+		if (inf->resp != NULL) {
+			memcpy(inf->resp, pkt->wire, pkt->size);
+			inf->resp_len = pkt->size;
+		} else {
+			inf->ret = KNOT_ENOMEM;
+		}
+	}
+	inf->done = true;
+	pthread_cond_broadcast(&inf->cond);
+	inflight_release(inf);
+	pthread_mutex_unlock(&proxy->lock);
+
+	return ret;
+}
+
+static knotd_state_t dnsproxy_fwd(knotd_state_t state, knot_pkt_t *pkt,
+                                  knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	assert(pkt && qdata && mod);
+
+	dnsproxy_t *proxy = knotd_mod_ctx(mod);
+
+	/* Forward only queries ending with REFUSED (no zone) or NXDOMAIN (if configured) */
+	if (proxy->fallback && !(qdata->rcode == KNOT_RCODE_REFUSED ||
+	     (qdata->rcode == KNOT_RCODE_NXDOMAIN && proxy->catch_nxdomain))) {
+		return state;
+	}
+
+	/* Forward from specified addresses only if configured. */
+	if (proxy->addr.count > 0) {
+		const struct sockaddr_storage *addr = knotd_qdata_remote_addr(qdata);
+		if (!knotd_conf_addr_range_match(&proxy->addr, addr)) {
+			return state;
+		}
+	}
+
+	/* Forward also original TSIG. */
+	if (qdata->query->tsig_rr != NULL && !proxy->fallback) {
+		knot_tsig_append(qdata->query->wire, &qdata->query->size,
+		                 qdata->query->max_size, qdata->query->tsig_rr);
+	}
+
+	/* Forward request. */
+	int ret;
+	if (proxy->coalesce) {
+		ret = forward_coalesced(proxy, pkt, qdata);
+	} else {
+		ret = forward(proxy, pkt, qdata, qdata->query->tsig_rr != NULL);
+	}
+	if (ret == KNOT_ENOMEM) {
+		return state; /* Ignore, not enough memory. */
+	}
+
 	/* Check result. */
 	if (ret != KNOT_EOK) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
@@ -169,6 +347,12 @@ int dnsproxy_load(knotd_mod_t *mod)
 	conf = knotd_conf_mod(mod, MOD_CATCH_NXDOMAIN);
 	proxy->catch_nxdomain = conf.single.boolean;
 
+	conf = knotd_conf_mod(mod, MOD_COALESCE);
+	proxy->coalesce = conf.single.boolean;
+
+	pthread_mutex_init(&proxy->lock, NULL);
+	init_list(&proxy->inflight);
+
 	knotd_mod_ctx_set(mod, proxy);
 
 	if (proxy->fallback) {
@@ -183,6 +367,7 @@ void dnsproxy_unload(knotd_mod_t *mod)
 	dnsproxy_t *ctx = knotd_mod_ctx(mod);
 	if (ctx != NULL) {
 		knotd_conf_free(&ctx->addr);
+		pthread_mutex_destroy(&ctx->lock);
 	}
 	free(ctx);
 }
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -19,7 +19,6 @@
 
 #include "contrib/dnstap/dnstap.h"
 #include "contrib/dnstap/dnstap.pb-c.h"
-#include "contrib/dnstap/message.h"
 #include "contrib/dnstap/writer.h"
 #include "contrib/time.h"
 #include "knot/include/module.h"
@@ -30,6 +29,23 @@
 #define MOD_QUERIES		"\x0B""log-queries"
 #define MOD_RESPONSES		"\x0D""log-responses"
 #define MOD_WITH_QUERIES	"\x16""responses-with-queries"
+#define MOD_SAMPLE_RATE		"\x0B""sample-rate"
+#define MOD_QTYPE		"\x0A""query-type"
+#define MOD_RCODE		"\x05""rcode"
+#define MOD_ZONE		"\x04""zone"
+#define MOD_SLOW		"\x0E""slow-threshold"
+
+static int qtype_check(knotd_conf_check_args_t *args)
+{
+	uint16_t num;
+	int ret = knot_rrtype_from_string((const char *)args->data, &num);
+	if (ret != 0) {
+		args->err_str = "invalid RR type";
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
 
 const yp_item_t dnstap_conf[] = {
 	{ MOD_SINK,         YP_TSTR,  YP_VNONE },
@@ -38,6 +54,11 @@ const yp_item_t dnstap_conf[] = {
 	{ MOD_QUERIES,      YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_RESPONSES,    YP_TBOOL, YP_VBOOL = { true } },
 	{ MOD_WITH_QUERIES, YP_TBOOL, YP_VBOOL = { false } },
+	{ MOD_SAMPLE_RATE,  YP_TINT,  YP_VINT = { 1, UINT32_MAX, 1 } },
+	{ MOD_QTYPE,        YP_TSTR,  YP_VNONE, YP_FMULTI, { qtype_check } },
+	{ MOD_RCODE,        YP_TOPT,  YP_VOPT = { knot_rcode_names, KNOT_RCODE_NOERROR }, YP_FMULTI },
+	{ MOD_ZONE,         YP_TDNAME, YP_VNONE, YP_FMULTI },
+	{ MOD_SLOW,         YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0 } },
 	{ NULL }
 };
 
@@ -52,6 +73,35 @@ int dnstap_conf_check(knotd_conf_check_args_t *args)
 	return KNOT_EOK;
 }
 
+/*! Size of a frame arena block, small enough to be recycled often. */
+#define BLOCK_SIZE	(64 * 1024)
+
+/*!
+ * \brief Block of frames, released once all its frames are written.
+ *
+ * The frames are carved out of the block sequentially by the worker and
+ * freed by the fstrm I/O thread, the block is reference counted.
+ */
+typedef struct dt_block {
+	size_t refs;
+	struct dt_block **spare;
+	uint8_t data[];
+} dt_block_t;
+
+/*! \brief Per-thread frame arena. */
+typedef struct {
+	dt_block_t *block;   // Current block, referenced by the arena.
+	size_t used;
+	dt_block_t *spare;   // Released block for reuse, exchanged atomically.
+} dt_arena_t;
+
+/*! \brief Per-thread state. */
+typedef struct {
+	dt_arena_t arena;
+	uint64_t matched;    // Number of messages passing the filters.
+	bool sampled;        // The current query is logged.
+} dt_thread_t;
+
 typedef struct {
 	struct fstrm_iothr *iothread;
 	char *identity;
@@ -59,8 +109,91 @@ typedef struct {
 	char *version;
 	size_t version_len;
 	bool with_queries;
+	bool log_queries;
+	bool log_responses;
+	uint32_t sample_rate;
+	uint16_t *qtypes;
+	size_t qtypes_count;
+	uint8_t *rcodes;
+	size_t rcodes_count;
+	knotd_conf_t zones;
+	uint64_t slow_threshold; // In nanoseconds.
+	dt_thread_t *threads;
+	unsigned threads_count;
 } dnstap_ctx_t;
 
+static void block_unref(dt_block_t *block)
+{
+	if (__atomic_sub_fetch(&block->refs, 1, __ATOMIC_ACQ_REL) > 0) {
+		return;
+	}
+
+	dt_block_t *empty = NULL;
+	if (!__atomic_compare_exchange_n(block->spare, &empty, block, false,
+	                                 __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		free(block);
+	}
+}
+
+/*! \brief Frame free callback for fstrm. */
+static void block_free_frame(void *frame, void *block)
+{
+	(void)frame;
+	block_unref(block);
+}
+
+/*! \brief Reserves a frame in the arena, returns NULL if too big or no memory. */
+static uint8_t *arena_alloc(dt_arena_t *arena, size_t size, dt_block_t **block)
+{
+	if (size > BLOCK_SIZE) {
+		return NULL;
+	}
+
+	if (arena->block == NULL || BLOCK_SIZE - arena->used < size) {
+		if (arena->block != NULL) {
+			block_unref(arena->block);
+		}
+		arena->block = __atomic_exchange_n(&arena->spare, NULL, __ATOMIC_ACQUIRE);
+		if (arena->block == NULL) {
+			arena->block = malloc(sizeof(dt_block_t) + BLOCK_SIZE);
+			if (arena->block == NULL) {
+				return NULL;
+			}
+		}
+		arena->block->refs = 1;
+		arena->block->spare = &arena->spare;
+		arena->used = 0;
+	}
+
+	__atomic_add_fetch(&arena->block->refs, 1, __ATOMIC_RELAXED);
+	*block = arena->block;
+
+	uint8_t *frame = arena->block->data + arena->used;
+	arena->used += size;
+
+	return frame;
+}
+
+static void ctx_free(dnstap_ctx_t *ctx)
+{
+	if (ctx->threads != NULL) {
+		for (unsigned i = 0; i < ctx->threads_count; i++) {
+			dt_arena_t *arena = &ctx->threads[i].arena;
+			if (arena->block != NULL) {
+				block_unref(arena->block);
+			}
+			free(arena->spare);
+		}
+		free(ctx->threads);
+	}
+	knotd_conf_free(&ctx->zones);
+	free(ctx->qtypes);
+	free(ctx->rcodes);
+	free(ctx->identity);
+	free(ctx->version);
+	free(ctx);
+}
+
 static knotd_state_t log_message(knotd_state_t state, const knot_pkt_t *pkt,
                                  knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -73,79 +206,148 @@ static knotd_state_t log_message(knotd_state_t state, const knot_pkt_t *pkt,
 
 	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
 
+	unsigned thread_id = qdata->params->thread_id;
 	struct fstrm_iothr_queue *ioq =
-		fstrm_iothr_get_input_queue_idx(ctx->iothread, qdata->params->thread_id);
+		fstrm_iothr_get_input_queue_idx(ctx->iothread, thread_id);
 
 	/* Unless we want to measure the time it takes to process each query,
 	 * we can treat Q/R times the same. */
 	struct timespec tv = { .tv_sec = time(NULL) };
 
-	/* Determine query / response. */
-	Dnstap__Message__Type msgtype = DNSTAP__MESSAGE__TYPE__AUTH_QUERY;
-	if (knot_wire_get_qr(pkt->wire)) {
-		msgtype = DNSTAP__MESSAGE__TYPE__AUTH_RESPONSE;
-	}
-
 	/* Determine whether we run on UDP/TCP. */
 	int protocol = IPPROTO_TCP;
 	if (qdata->params->flags & KNOTD_QUERY_FLAG_LIMIT_SIZE) {
 		protocol = IPPROTO_UDP;
 	}
 
-	/* Create a dnstap message. */
 	struct sockaddr_storage buff;
-	Dnstap__Message msg;
-	int ret = dt_message_fill(&msg, msgtype,
-	                          (const struct sockaddr *)knotd_qdata_remote_addr(qdata),
-	                          (const struct sockaddr *)knotd_qdata_local_addr(qdata, &buff),
-	                          protocol, pkt->wire, pkt->size, &tv);
-	if (ret != KNOT_EOK) {
+	dt_msg_t msg = {
+		.identity = (const uint8_t *)ctx->identity,
+		.identity_len = ctx->identity_len,
+		.version = (const uint8_t *)ctx->version,
+		.version_len = ctx->version_len,
+		.query_sa = (const struct sockaddr *)knotd_qdata_remote_addr(qdata),
+		.response_sa = (const struct sockaddr *)knotd_qdata_local_addr(qdata, &buff),
+		.protocol = protocol,
+		.mtime = &tv
+	};
+
+	/* Determine query / response. */
+	if (knot_wire_get_qr(pkt->wire)) {
+		msg.type = DNSTAP__MESSAGE__TYPE__AUTH_RESPONSE;
+		msg.response_wire = pkt->wire;
+		msg.response_len = pkt->size;
+		/* Also add query message if 'responses-with-queries' is enabled. */
+		if (ctx->with_queries && qdata->query != NULL) {
+			msg.query_wire = qdata->query->wire;
+			msg.query_len = qdata->query->size;
+		}
+	} else {
+		msg.type = DNSTAP__MESSAGE__TYPE__AUTH_QUERY;
+		msg.query_wire = pkt->wire;
+		msg.query_len = pkt->size;
+	}
+
+	/* Serialize the message into the thread arena or into a heap buffer. */
+	size_t size = dt_encode(&msg, NULL, 0);
+	dt_block_t *block = NULL;
+	uint8_t *frame = NULL;
+	if (thread_id < ctx->threads_count) {
+		frame = arena_alloc(&ctx->threads[thread_id].arena, size, &block);
+	}
+	if (frame == NULL && (frame = malloc(size)) == NULL) {
 		return state;
 	}
+	(void)dt_encode(&msg, frame, size);
+
+	/* Submit a request. */
+	fstrm_res res;
+	if (block != NULL) {
+		res = fstrm_iothr_submit(ctx->iothread, ioq, frame, size,
+		                         block_free_frame, block);
+	} else {
+		res = fstrm_iothr_submit(ctx->iothread, ioq, frame, size,
+		                         fstrm_free_wrapper, NULL);
+	}
+	if (res != fstrm_res_success) {
+		if (block != NULL) {
+			block_unref(block);
+		} else {
+			free(frame);
+		}
+	}
+
+	return state;
+}
 
-	Dnstap__Dnstap dnstap = DNSTAP__DNSTAP__INIT;
-	dnstap.type = DNSTAP__DNSTAP__TYPE__MESSAGE;
-	dnstap.message = &msg;
+static bool elapsed_over(const knotd_qdata_t *qdata, uint64_t threshold)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t elapsed = (now.tv_sec - qdata->timing.begin.tv_sec) * 1000000000ULL +
+	                   now.tv_nsec - qdata->timing.begin.tv_nsec;
+	return elapsed >= threshold;
+}
 
-	/* Set message version and identity. */
-	if (ctx->identity_len > 0) {
-		dnstap.identity.data = (uint8_t *)ctx->identity;
-		dnstap.identity.len = ctx->identity_len;
-		dnstap.has_identity = 1;
+/*!
+ * \brief Evaluates the filters and the sampling for the current query.
+ *
+ * \param result  Also evaluate the filters depending on the query result.
+ */
+static bool query_sampled(dnstap_ctx_t *ctx, knotd_qdata_t *qdata, bool result)
+{
+	if (ctx->qtypes_count > 0) {
+		uint16_t qtype = knot_pkt_qtype(qdata->query);
+		bool found = false;
+		for (size_t i = 0; i < ctx->qtypes_count && !found; i++) {
+			found = (ctx->qtypes[i] == qtype);
+		}
+		if (!found) {
+			return false;
+		}
 	}
-	if (ctx->version_len > 0) {
-		dnstap.version.data = (uint8_t *)ctx->version;
-		dnstap.version.len = ctx->version_len;
-		dnstap.has_version = 1;
+
+	if (ctx->zones.count > 0) {
+		const knot_dname_t *zone = knotd_qdata_zone_name(qdata);
+		bool found = false;
+		for (size_t i = 0; i < ctx->zones.count && !found; i++) {
+			found = (zone != NULL && knot_dname_is_equal(ctx->zones.multi[i].dname, zone));
+		}
+		if (!found) {
+			return false;
+		}
 	}
 
-	/* Also add query message if 'responses-with-queries' is enabled and this is a response. */
-	if (ctx->with_queries &&
-	    msgtype == DNSTAP__MESSAGE__TYPE__AUTH_RESPONSE &&
-	    qdata->query != NULL)
-	{
-		msg.query_message.len = qdata->query->size;
-		msg.query_message.data = qdata->query->wire;
-		msg.has_query_message = 1;
+	if (result && ctx->rcodes_count > 0) {
+		bool found = false;
+		for (size_t i = 0; i < ctx->rcodes_count && !found; i++) {
+			found = (ctx->rcodes[i] == qdata->rcode);
+		}
+		if (!found) {
+			return false;
+		}
 	}
 
-	/* Pack the message. */
-	uint8_t *frame = NULL;
-	size_t size = 0;
-	dt_pack(&dnstap, &frame, &size);
-	if (frame == NULL) {
-		return state;
+	if (result && ctx->slow_threshold > 0 &&
+	    !elapsed_over(qdata, ctx->slow_threshold)) {
+		return false;
 	}
 
-	/* Submit a request. */
-	fstrm_res res = fstrm_iothr_submit(ctx->iothread, ioq, frame, size,
-	                                   fstrm_free_wrapper, NULL);
-	if (res != fstrm_res_success) {
-		free(frame);
-		return state;
+	if (ctx->sample_rate > 1) {
+		unsigned thread_id = qdata->params->thread_id;
+		if (thread_id >= ctx->threads_count ||
+		    ctx->threads[thread_id].matched++ % ctx->sample_rate != 0) {
+			return false;
+		}
 	}
 
-	return state;
+	return true;
+}
+
+static dt_thread_t *query_thread(dnstap_ctx_t *ctx, knotd_qdata_t *qdata)
+{
+	unsigned thread_id = qdata->params->thread_id;
+	return (thread_id < ctx->threads_count) ? &ctx->threads[thread_id] : NULL;
 }
 
 /*! \brief Submit message - query. */
@@ -154,6 +356,18 @@ static knotd_state_t dnstap_message_log_query(knotd_state_t state, knot_pkt_t *p
 {
 	assert(qdata);
 
+	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
+	dt_thread_t *thr = query_thread(ctx, qdata);
+
+	/* The decision is kept for the response of the same query. */
+	bool sampled = query_sampled(ctx, qdata, false);
+	if (thr != NULL) {
+		thr->sampled = sampled;
+	}
+	if (!sampled) {
+		return state;
+	}
+
 	return log_message(state, qdata->query, qdata, mod);
 }
 
@@ -161,9 +375,44 @@ static knotd_state_t dnstap_message_log_query(knotd_state_t state, knot_pkt_t *p
 static knotd_state_t dnstap_message_log_response(knotd_state_t state, knot_pkt_t *pkt,
                                                  knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
+	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
+	dt_thread_t *thr = query_thread(ctx, qdata);
+
+	bool sampled;
+	if (ctx->log_queries) {
+		sampled = (thr == NULL || thr->sampled);
+	} else {
+		sampled = query_sampled(ctx, qdata, false);
+	}
+	if (!sampled) {
+		return state;
+	}
+
 	return log_message(state, pkt, qdata, mod);
 }
 
+/*! \brief Submit messages - query and response, once the result is known. */
+static knotd_state_t dnstap_message_log_result(knotd_state_t state, knot_pkt_t *pkt,
+                                               knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	assert(qdata);
+
+	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	if (state == KNOTD_STATE_NOOP || !query_sampled(ctx, qdata, true)) {
+		return state;
+	}
+
+	if (ctx->log_queries) {
+		(void)log_message(state, qdata->query, qdata, mod);
+	}
+	if (ctx->log_responses) {
+		(void)log_message(state, pkt, qdata, mod);
+	}
+
+	return state;
+}
+
 /*! \brief Create a UNIX socket sink. */
 static struct fstrm_writer* dnstap_unix_writer(const char *path)
 {
@@ -272,11 +521,63 @@ int dnstap_load(knotd_mod_t *mod)
 
 	/* Set log_queries. */
 	conf = knotd_conf_mod(mod, MOD_QUERIES);
-	const bool log_queries = conf.single.boolean;
+	ctx->log_queries = conf.single.boolean;
 
 	/* Set log_responses. */
 	conf = knotd_conf_mod(mod, MOD_RESPONSES);
-	const bool log_responses = conf.single.boolean;
+	ctx->log_responses = conf.single.boolean;
+
+	/* Set sample-rate. */
+	conf = knotd_conf_mod(mod, MOD_SAMPLE_RATE);
+	ctx->sample_rate = conf.single.integer;
+
+	/* Set query-type. */
+	conf = knotd_conf_mod(mod, MOD_QTYPE);
+	if (conf.count > 0) {
+		ctx->qtypes = calloc(conf.count, sizeof(*ctx->qtypes));
+		if (ctx->qtypes == NULL) {
+			knotd_conf_free(&conf);
+			ctx_free(ctx);
+			return KNOT_ENOMEM;
+		}
+		for (size_t i = 0; i < conf.count; i++) {
+			(void)knot_rrtype_from_string(conf.multi[i].string,
+			                              &ctx->qtypes[i]);
+		}
+		ctx->qtypes_count = conf.count;
+	}
+	knotd_conf_free(&conf);
+
+	/* Set rcode. */
+	conf = knotd_conf_mod(mod, MOD_RCODE);
+	if (conf.count > 0) {
+		ctx->rcodes = calloc(conf.count, sizeof(*ctx->rcodes));
+		if (ctx->rcodes == NULL) {
+			knotd_conf_free(&conf);
+			ctx_free(ctx);
+			return KNOT_ENOMEM;
+		}
+		for (size_t i = 0; i < conf.count; i++) {
+			ctx->rcodes[i] = conf.multi[i].option;
+		}
+		ctx->rcodes_count = conf.count;
+	}
+	knotd_conf_free(&conf);
+
+	/* Set zone. */
+	ctx->zones = knotd_conf_mod(mod, MOD_ZONE);
+
+	/* Set slow-threshold. */
+	conf = knotd_conf_mod(mod, MOD_SLOW);
+	ctx->slow_threshold = conf.single.integer * 1000;
+
+	/* Initialize the per-thread states. */
+	ctx->threads_count = knotd_mod_threads(mod);
+	ctx->threads = calloc(ctx->threads_count, sizeof(*ctx->threads));
+	if (ctx->threads == NULL) {
+		ctx_free(ctx);
+		return KNOT_ENOMEM;
+	}
 
 	/* Initialize the writer and the options. */
 	struct fstrm_writer *writer = dnstap_writer(sink);
@@ -304,20 +605,28 @@ int dnstap_load(knotd_mod_t *mod)
 	knotd_mod_ctx_set(mod, ctx);
 
 	/* Hook to the query plan. */
-	if (log_queries) {
-		knotd_mod_hook(mod, KNOTD_STAGE_BEGIN, dnstap_message_log_query);
-	}
-	if (log_responses) {
-		knotd_mod_hook(mod, KNOTD_STAGE_END, dnstap_message_log_response);
+	if (ctx->rcodes_count > 0 || ctx->slow_threshold > 0) {
+		/* Both messages are logged once the result is known. */
+		if (ctx->slow_threshold > 0) {
+			knotd_mod_timing_enable(mod);
+		}
+		if (ctx->log_queries || ctx->log_responses) {
+			knotd_mod_hook(mod, KNOTD_STAGE_END, dnstap_message_log_result);
+		}
+	} else {
+		if (ctx->log_queries) {
+			knotd_mod_hook(mod, KNOTD_STAGE_BEGIN, dnstap_message_log_query);
+		}
+		if (ctx->log_responses) {
+			knotd_mod_hook(mod, KNOTD_STAGE_END, dnstap_message_log_response);
+		}
 	}
 
 	return KNOT_EOK;
 fail:
 	knotd_mod_log(mod, LOG_ERR, "failed to init sink '%s'", sink);
 
-	free(ctx->identity);
-	free(ctx->version);
-	free(ctx);
+	ctx_free(ctx);
 
 	return KNOT_ENOMEM;
 }
@@ -326,10 +635,9 @@ void dnstap_unload(knotd_mod_t *mod)
 {
 	dnstap_ctx_t *ctx = knotd_mod_ctx(mod);
 
+	/* All the submitted frames are released by the I/O thread. */
 	fstrm_iothr_destroy(&ctx->iothread);
-	free(ctx->identity);
-	free(ctx->version);
-	free(ctx);
+	ctx_free(ctx);
 }
 
 KNOTD_MOD_API(dnstap, KNOTD_MOD_FLAG_SCOPE_ANY,
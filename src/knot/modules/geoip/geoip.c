@@ -14,9 +14,12 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <arpa/inet.h>
+#include <sys/stat.h>
+#include <urcu.h>
 
 #include "knot/conf/schema.h"
 #include "knot/include/module.h"
@@ -25,6 +28,7 @@
 #include "contrib/qp-trie/trie.h"
 #include "contrib/ucw/lists.h"
 #include "contrib/macros.h"
+#include "contrib/openbsd/siphash.h"
 #include "contrib/sockaddr.h"
 #include "contrib/string.h"
 #include "contrib/strtonum.h"
@@ -38,6 +42,13 @@
 #define MOD_POLICY	"\x06""policy"
 #define MOD_GEODB_FILE	"\x0A""geodb-file"
 #define MOD_GEODB_KEY	"\x09""geodb-key"
+#define MOD_CACHE_SIZE	"\x0A""cache-size"
+#define MOD_REFRESH	"\x07""refresh"
+
+// Number of cached results with the same hash.
+#define GEO_CACHE_WAYS	4
+// Number of remembered geo DB network prefix lengths per address family.
+#define GEO_CACHE_SCOPES	4
 
 enum operation_mode {
 	MODE_SUBNET,
@@ -66,6 +77,8 @@ const yp_item_t geoip_conf[] = {
 	{ MOD_POLICY,      YP_TREF,  YP_VREF = { C_POLICY }, YP_FNONE, { knotd_conf_check_ref } },
 	{ MOD_GEODB_FILE,  YP_TSTR,  YP_VNONE },
 	{ MOD_GEODB_KEY,   YP_TSTR,  YP_VSTR = { "country/iso_code" }, YP_FMULTI },
+	{ MOD_CACHE_SIZE,  YP_TINT,  YP_VINT = { 0, 1 << 24, 1024 } },
+	{ MOD_REFRESH,     YP_TINT,  YP_VINT = { 0, UINT32_MAX, 0, YP_STIME } },
 	{ NULL }
 };
 
@@ -74,9 +87,14 @@ char geoip_check_str[1024];
 typedef struct {
 	knotd_conf_check_args_t	*args; // Set for a dry run.
 	knotd_mod_t *mod;              // Set for a real module load.
+	const struct geoip_ctx *prev;  // Set for a reload, the settings are taken over.
+	const char *config_file;       // Module configuration file for a reload.
+	const char *geodb_file;        // Geo DB file for a reload.
 } check_ctx_t;
 
-static int load_module(check_ctx_t *ctx);
+typedef struct geoip_ctx geoip_ctx_t;
+
+static int load_module(check_ctx_t *ctx, geoip_ctx_t **out);
 
 int geoip_conf_check(knotd_conf_check_args_t *args)
 {
@@ -114,10 +132,10 @@ int geoip_conf_check(knotd_conf_check_args_t *args)
 	}
 
 	check_ctx_t check = { .args = args };
-	return load_module(&check);
+	return load_module(&check, NULL);
 }
 
-typedef struct {
+struct geoip_ctx {
 	enum operation_mode mode;
 	uint32_t ttl;
 	trie_t *geo_trie;
@@ -126,7 +144,9 @@ typedef struct {
 	geodb_t *geodb;
 	geodb_path_t paths[GEODB_MAX_DEPTH];
 	uint16_t path_count;
-} geoip_ctx_t;
+
+	uint64_t generation; // Distinguishes the cached results of reloaded data.
+};
 
 typedef struct {
 	struct sockaddr_storage *subnet;
@@ -153,8 +173,60 @@ typedef struct {
 	size_t count, avail;
 	geo_view_t *views;
 	uint16_t total_weight;
+	uint8_t max_prefix[2];        // Longest view subnet prefix for IPv4 and IPv6.
 } geo_trie_val_t;
 
+typedef struct {
+	uint64_t generation;          // Zero if unused.
+	const geo_trie_val_t *node;
+	uint8_t addr[16];             // Address truncated to 'scope' bits.
+	sa_family_t family;
+	uint8_t scope;                // Prefix length of the addresses the entry is for.
+	uint16_t netmask;             // ECS scope prefix length of the answer.
+	uint32_t used;                // Last use stamp.
+	geo_view_t *view;             // NULL if no suitable view.
+} geo_cache_entry_t;
+
+/*!
+ * \brief Per-thread LRU cache of the selected views.
+ *
+ * The entries are grouped by their hash into sets of GEO_CACHE_WAYS
+ * entries, the least recently used entry of the set is replaced.
+ *
+ * An entry covers all the addresses of the network whose clients get
+ * the same view. In the subnet mode, it's given by the longest subnet
+ * prefix of the views of the name. In the geodb mode, it's the network
+ * of the geo DB record, and the most recent prefix lengths are tried.
+ */
+typedef struct {
+	geo_cache_entry_t *entries;
+	size_t mask;
+	uint32_t clock;
+	uint8_t scopes[2][GEO_CACHE_SCOPES]; // Most recent first.
+	uint8_t scope_count[2];
+} geo_cache_t;
+
+typedef struct {
+	geoip_ctx_t *ctx;             // Current data, replaced using RCU.
+	uint64_t generation;
+
+	geo_cache_t *caches;
+	unsigned caches_count;
+	SIPHASH_KEY hash_key;
+
+	knotd_mod_t *mod;
+	char *config_file;
+	char *geodb_file;
+	time_t config_mtime;
+	time_t geodb_mtime;
+	uint32_t refresh;
+	bool refresh_active;
+	bool refresh_stop;
+	pthread_t refresh_thread;
+	pthread_mutex_t refresh_lock;
+	pthread_cond_t refresh_cond;
+} geoip_state_t;
+
 typedef int (*view_cmp_t)(const void *a, const void *b);
 
 int geodb_view_cmp(const void *a, const void *b)
@@ -582,11 +654,12 @@ static int geo_conf_yparse(check_ctx_t *check, geoip_ctx_t *ctx)
 		goto cleanup;
 	}
 	yp_init(yp);
-	knotd_conf_t conf = geo_conf(check, MOD_CONFIG_FILE);
-	ret = yp_set_input_file(yp, conf.single.string);
+	const char *config_file = (check->prev != NULL) ? check->config_file :
+	                          geo_conf(check, MOD_CONFIG_FILE).single.string;
+	ret = yp_set_input_file(yp, config_file);
 	if (ret != KNOT_EOK) {
 		geo_log(check, LOG_ERR, "failed to load module config file '%s' (%s)",
-		        conf.single.string, knot_strerror(ret));
+		        config_file, knot_strerror(ret));
 		goto cleanup;
 	}
 
@@ -752,6 +825,14 @@ static void geo_sort_and_link(geoip_ctx_t *ctx)
 		geo_trie_val_t *val = (geo_trie_val_t *) (*trie_it_val(it));
 		qsort(val->views, val->count, sizeof(geo_view_t), cmp_fct[ctx->mode]);
 
+		if (ctx->mode == MODE_SUBNET) {
+			for (int i = 0; i < val->count; i++) {
+				geo_view_t *view = &val->views[i];
+				int fam = (view->subnet->ss_family == AF_INET6);
+				val->max_prefix[fam] = MAX(val->max_prefix[fam], view->subnet_prefix);
+			}
+		}
+
 		for (int i = 1; i < val->count; i++) {
 			geo_view_t *cur_view = &val->views[i];
 			geo_view_t *prev_view = &val->views[i - 1];
@@ -832,6 +913,212 @@ static void find_rr_in_view(uint16_t qtype, geo_view_t *view,
 	}
 }
 
+static unsigned common_prefix(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	unsigned bits = 0;
+	for (size_t i = 0; i < len; i++) {
+		uint8_t diff = a[i] ^ b[i];
+		if (diff != 0) {
+			return bits + __builtin_clz(diff) - 8 * (sizeof(unsigned) - 1);
+		}
+		bits += 8;
+	}
+	return bits;
+}
+
+/*!
+ * \brief Returns the prefix length of the address the view selection depends on.
+ *
+ * All addresses with this prefix are in the selected view and aren't in any
+ * of its more specific views, so they get the same answer.
+ */
+static uint16_t subnet_scope(const geo_trie_val_t *data, const geo_view_t *view,
+                             const struct sockaddr_storage *remote)
+{
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(remote, &len);
+	uint16_t scope = (view != NULL) ? view->subnet_prefix : 0;
+
+	for (size_t i = 0; i < data->count; i++) {
+		const geo_view_t *other = &data->views[i];
+		if (other->subnet->ss_family != remote->ss_family) {
+			continue;
+		}
+		const uint8_t *other_raw = sockaddr_raw(other->subnet, &len);
+		unsigned common = common_prefix(raw, other_raw, len);
+		if (common < other->subnet_prefix) {
+			// The first different bit keeps the addresses out of the view.
+			scope = MAX(scope, common + 1);
+		}
+	}
+
+	return scope;
+}
+
+static geo_view_t *select_view(geoip_ctx_t *ctx, geo_trie_val_t *data,
+                               const struct sockaddr_storage *remote,
+                               uint16_t *netmask)
+{
+	geodb_data_t entries[ctx->path_count];
+
+	// Create dummy view and fill it with data about the current remote.
+	geo_view_t dummy = { 0 };
+	switch(ctx->mode) {
+	case MODE_SUBNET:
+		dummy.subnet = (struct sockaddr_storage *)remote;
+		dummy.subnet_prefix = (remote->ss_family == AF_INET) ? 32 : 128;
+		break;
+	case MODE_GEODB:
+		if (geodb_query(ctx->geodb, entries, (struct sockaddr *)remote,
+		                ctx->paths, ctx->path_count, netmask) != 0) {
+			return NULL;
+		}
+		// MMDB may supply IPv6 prefixes even for IPv4 address, see man libmaxminddb.
+		if (remote->ss_family == AF_INET && *netmask > 32) {
+			*netmask -= 96;
+		}
+		geodb_fill_geodata(entries, ctx->path_count,
+		                   dummy.geodata, dummy.geodata_len, &dummy.geodepth);
+		break;
+	case MODE_WEIGHTED:
+		dummy.weight = dnssec_random_uint16_t() % data->total_weight;
+		break;
+	default:
+		assert(0);
+		break;
+	}
+
+	// Find last lower or equal view.
+	geo_view_t *view = find_best_view(&dummy, data, ctx);
+
+	// Save netmask for ECS if in subnet mode.
+	if (ctx->mode == MODE_SUBNET) {
+		*netmask = subnet_scope(data, view, remote);
+	}
+
+	return view;
+}
+
+static geo_cache_entry_t *cache_set(geoip_state_t *state, geo_cache_t *cache,
+                                    const geo_trie_val_t *node, const uint8_t *addr,
+                                    size_t addr_len, uint8_t scope)
+{
+	SIPHASH_CTX hctx;
+	SipHash24_Init(&hctx, &state->hash_key);
+	SipHash24_Update(&hctx, &node, sizeof(node));
+	SipHash24_Update(&hctx, &scope, sizeof(scope));
+	SipHash24_Update(&hctx, addr, addr_len);
+	uint64_t hash = SipHash24_End(&hctx);
+
+	return &cache->entries[(hash & cache->mask) * GEO_CACHE_WAYS];
+}
+
+static void truncate_addr(uint8_t *out, const uint8_t *addr, size_t addr_len,
+                          unsigned prefix)
+{
+	memset(out, 0, addr_len);
+	memcpy(out, addr, prefix / 8);
+	if (prefix % 8 != 0) {
+		out[prefix / 8] = addr[prefix / 8] & (0xff << (8 - prefix % 8));
+	}
+}
+
+/*! \brief Moves the prefix length to the front of the recent ones. */
+static void learn_scope(geo_cache_t *cache, int fam, uint8_t scope)
+{
+	uint8_t *scopes = cache->scopes[fam];
+	unsigned pos = 0;
+	while (pos < cache->scope_count[fam] && scopes[pos] != scope) {
+		pos++;
+	}
+	if (pos == cache->scope_count[fam]) {
+		if (pos < GEO_CACHE_SCOPES) {
+			cache->scope_count[fam]++;
+		} else {
+			pos--; // Replace the oldest one.
+		}
+	}
+	memmove(scopes + 1, scopes, pos);
+	scopes[0] = scope;
+}
+
+static geo_view_t *cached_select_view(geoip_state_t *state, geo_cache_t *cache,
+                                      geoip_ctx_t *ctx, geo_trie_val_t *data,
+                                      const struct sockaddr_storage *remote,
+                                      uint16_t *netmask)
+{
+	size_t addr_len = 0;
+	const uint8_t *addr = sockaddr_raw(remote, &addr_len);
+	if (addr == NULL || addr_len > sizeof(((geo_cache_entry_t *)0)->addr)) {
+		return select_view(ctx, data, remote, netmask);
+	}
+	int fam = (remote->ss_family == AF_INET6);
+
+	// In the subnet mode, the result doesn't depend on the bits
+	// beyond the longest view prefix.
+	uint8_t subnet_scopes[1] = { data->max_prefix[fam] };
+	const uint8_t *scopes = subnet_scopes;
+	unsigned scope_count = 1;
+	if (ctx->mode != MODE_SUBNET) {
+		scopes = cache->scopes[fam];
+		scope_count = cache->scope_count[fam];
+	}
+
+	uint8_t key[sizeof(((geo_cache_entry_t *)0)->addr)];
+	for (unsigned s = 0; s < scope_count; s++) {
+		truncate_addr(key, addr, addr_len, scopes[s]);
+		geo_cache_entry_t *set = cache_set(state, cache, data, key, addr_len, scopes[s]);
+		for (int i = 0; i < GEO_CACHE_WAYS; i++) {
+			geo_cache_entry_t *entry = &set[i];
+			if (entry->generation == ctx->generation && entry->node == data &&
+			    entry->family == remote->ss_family && entry->scope == scopes[s] &&
+			    memcmp(entry->addr, key, addr_len) == 0) {
+				entry->used = ++cache->clock;
+				*netmask = entry->netmask;
+				return entry->view;
+			}
+		}
+	}
+
+	geo_view_t *view = select_view(ctx, data, remote, netmask);
+
+	// The geo DB record network covers the addresses with the same data.
+	uint8_t scope = data->max_prefix[fam];
+	if (ctx->mode != MODE_SUBNET) {
+		scope = (view != NULL) ? MIN(*netmask, addr_len * 8) : addr_len * 8;
+		learn_scope(cache, fam, scope);
+	}
+
+	truncate_addr(key, addr, addr_len, scope);
+	geo_cache_entry_t *set = cache_set(state, cache, data, key, addr_len, scope);
+	geo_cache_entry_t *victim = NULL;
+	for (int i = 0; i < GEO_CACHE_WAYS; i++) {
+		geo_cache_entry_t *entry = &set[i];
+		if (entry->generation != ctx->generation) {
+			// Unused or stale entries are replaced first.
+			if (victim == NULL || victim->generation == ctx->generation) {
+				victim = entry;
+			}
+			continue;
+		}
+		if (victim == NULL || (victim->generation == ctx->generation &&
+		                       (int32_t)(entry->used - victim->used) < 0)) {
+			victim = entry;
+		}
+	}
+
+	victim->generation = ctx->generation;
+	victim->node = data;
+	victim->family = remote->ss_family;
+	memcpy(victim->addr, key, addr_len);
+	victim->scope = scope;
+	victim->netmask = *netmask;
+	victim->used = ++cache->clock;
+	victim->view = view;
+
+	return view;
+}
+
 static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
                                       knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -842,7 +1129,11 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 		return state;
 	}
 
-	geoip_ctx_t *ctx = (geoip_ctx_t *)knotd_mod_ctx(mod);
+	geoip_state_t *geo = knotd_mod_ctx(mod);
+
+	// The query processing is an RCU read-side section, the data and the
+	// answer records are valid until the processing finishes.
+	geoip_ctx_t *ctx = rcu_dereference(geo->ctx);
 
 	// Save the query type.
 	uint16_t qtype = knot_pkt_qtype(qdata->query);
@@ -869,59 +1160,32 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 		remote = &ecs_addr;
 	}
 
+	// Weighted views are chosen randomly, thus not cached.
 	uint16_t netmask = 0;
-	geodb_data_t entries[ctx->path_count];
-
-	// Create dummy view and fill it with data about the current remote.
-	geo_view_t dummy = { 0 };
-	switch(ctx->mode) {
-	case MODE_SUBNET:
-		dummy.subnet = (struct sockaddr_storage *)remote;
-		dummy.subnet_prefix = (remote->ss_family == AF_INET) ? 32 : 128;
-		break;
-	case MODE_GEODB:
-		if (geodb_query(ctx->geodb, entries, (struct sockaddr *)remote,
-		                ctx->paths, ctx->path_count, &netmask) != 0) {
-			return state;
-		}
-		// MMDB may supply IPv6 prefixes even for IPv4 address, see man libmaxminddb.
-		if (remote->ss_family == AF_INET && netmask > 32) {
-			netmask -= 96;
-		}
-		geodb_fill_geodata(entries, ctx->path_count,
-		                   dummy.geodata, dummy.geodata_len, &dummy.geodepth);
-		break;
-	case MODE_WEIGHTED:
-		dummy.weight = dnssec_random_uint16_t() % data->total_weight;
-		break;
-	default:
-		assert(0);
-		break;
+	geo_view_t *view;
+	unsigned thread_id = qdata->params->thread_id;
+	if (ctx->mode != MODE_WEIGHTED && thread_id < geo->caches_count) {
+		view = cached_select_view(geo, &geo->caches[thread_id], ctx, data,
+		                          remote, &netmask);
+	} else {
+		view = select_view(ctx, data, remote, &netmask);
 	}
-
-	// Find last lower or equal view.
-	geo_view_t *view = find_best_view(&dummy, data, ctx);
 	if (view == NULL) { // No suitable view was found.
 		return state;
 	}
 
-	// Save netmask for ECS if in subnet mode.
-	if (ctx->mode == MODE_SUBNET) {
-		netmask = view->subnet_prefix;
-	}
-
 	// Fetch the correct rrset from found view.
 	knot_rrset_t *rr = NULL;
 	knot_rrset_t *rrsig = NULL;
 	find_rr_in_view(qtype, view, &rr, &rrsig);
 
+	// Update ECS if used, the answer depends on the view.
+	if (qdata->ecs != NULL && netmask > 0) {
+		qdata->ecs->scope_len = netmask;
+	}
+
 	// Answer the query if possible.
 	if (rr != NULL) {
-		// Update ECS if used.
-		if (qdata->ecs != NULL && netmask > 0) {
-			qdata->ecs->scope_len = netmask;
-		}
-
 		knot_pkt_put(pkt, KNOT_COMPR_HINT_QNAME, rr, 0);
 		if (ctx->dnssec && knot_pkt_has_dnssec(qdata->query) && rrsig != NULL) {
 			knot_pkt_put(pkt, KNOT_COMPR_HINT_QNAME, rrsig, 0);
@@ -943,10 +1207,27 @@ static knotd_in_state_t geoip_process(knotd_in_state_t state, knot_pkt_t *pkt,
 	}
 }
 
-static int load_module(check_ctx_t *check)
+static int copy_geodb_paths(geoip_ctx_t *ctx, const geoip_ctx_t *prev)
+{
+	ctx->path_count = prev->path_count;
+	for (int i = 0; i < prev->path_count; i++) {
+		ctx->paths[i].type = prev->paths[i].type;
+		for (int j = 0; j < GEODB_MAX_PATH_LEN && prev->paths[i].path[j] != NULL; j++) {
+			ctx->paths[i].path[j] = strdup(prev->paths[i].path[j]);
+			if (ctx->paths[i].path[j] == NULL) {
+				return KNOT_ENOMEM;
+			}
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int load_module(check_ctx_t *check, geoip_ctx_t **out)
 {
 	assert((check->args != NULL) != (check->mod != NULL));
 	knotd_mod_t *mod = check->mod;
+	const geoip_ctx_t *prev = check->prev;
 
 	// Create module context.
 	geoip_ctx_t *ctx = calloc(1, sizeof(geoip_ctx_t));
@@ -954,13 +1235,20 @@ static int load_module(check_ctx_t *check)
 		return KNOT_ENOMEM;
 	}
 
-	knotd_conf_t conf = geo_conf(check, MOD_TTL);
-	ctx->ttl = conf.single.integer;
-	conf = geo_conf(check, MOD_MODE);
-	ctx->mode = conf.single.option;
+	knotd_conf_t conf;
+	if (prev != NULL) {
+		ctx->ttl = prev->ttl;
+		ctx->mode = prev->mode;
+		ctx->dnssec = prev->dnssec;
+	} else {
+		conf = geo_conf(check, MOD_TTL);
+		ctx->ttl = conf.single.integer;
+		conf = geo_conf(check, MOD_MODE);
+		ctx->mode = conf.single.option;
+	}
 
-	// Initialize the dname trie.
-	ctx->geo_trie = trie_create(NULL);
+	// Initialize the dname trie, accounted unless only checking the config.
+	ctx->geo_trie = trie_create(check->mod != NULL ? knotd_mod_mm(check->mod) : NULL);
 	if (ctx->geo_trie == NULL) {
 		free_geoip_ctx(ctx);
 		return KNOT_ENOMEM;
@@ -968,8 +1256,9 @@ static int load_module(check_ctx_t *check)
 
 	if (ctx->mode == MODE_GEODB) {
 		// Initialize geodb.
-		conf = geo_conf(check, MOD_GEODB_FILE);
-		ctx->geodb = geodb_open(conf.single.string);
+		const char *geodb_file = (prev != NULL) ? check->geodb_file :
+		                         geo_conf(check, MOD_GEODB_FILE).single.string;
+		ctx->geodb = geodb_open(geodb_file);
 		if (ctx->geodb == NULL) {
 			geo_log(check, LOG_ERR, "failed to open geo DB");
 			free_geoip_ctx(ctx);
@@ -977,16 +1266,24 @@ static int load_module(check_ctx_t *check)
 		}
 
 		// Load configured geodb keys.
-		conf = geo_conf(check, MOD_GEODB_KEY);
-		assert(conf.count <= GEODB_MAX_DEPTH);
-		ctx->path_count = conf.count;
-		for (size_t i = 0; i < conf.count; i++) {
-			(void)parse_geodb_path(&ctx->paths[i], (char *)conf.multi[i].string);
+		if (prev != NULL) {
+			int ret = copy_geodb_paths(ctx, prev);
+			if (ret != KNOT_EOK) {
+				free_geoip_ctx(ctx);
+				return ret;
+			}
+		} else {
+			conf = geo_conf(check, MOD_GEODB_KEY);
+			assert(conf.count <= GEODB_MAX_DEPTH);
+			ctx->path_count = conf.count;
+			for (size_t i = 0; i < conf.count; i++) {
+				(void)parse_geodb_path(&ctx->paths[i], (char *)conf.multi[i].string);
+			}
+			knotd_conf_free(&conf);
 		}
-		knotd_conf_free(&conf);
 	}
 
-	if (mod != NULL) {
+	if (mod != NULL && prev == NULL) {
 		// Is DNSSEC used on this zone?
 		conf = knotd_conf_mod(mod, MOD_DNSSEC);
 		if (conf.count == 0) {
@@ -1016,11 +1313,11 @@ static int load_module(check_ctx_t *check)
 		return ret;
 	}
 
-	if (mod != NULL) {
+	if (out != NULL) {
 		// Prepare geo views for faster search.
 		geo_sort_and_link(ctx);
 
-		knotd_mod_ctx_set(mod, ctx);
+		*out = ctx;
 	} else {
 		free_geoip_ctx(ctx);
 	}
@@ -1028,22 +1325,185 @@ static int load_module(check_ctx_t *check)
 	return ret;
 }
 
+static time_t file_mtime(const char *path)
+{
+	struct stat st;
+	if (path == NULL || stat(path, &st) != 0) {
+		return 0;
+	}
+
+	return st.st_mtime;
+}
+
+static void geoip_reload(geoip_state_t *state)
+{
+	geoip_ctx_t *old = state->ctx;
+	check_ctx_t check = {
+		.mod = state->mod,
+		.prev = old,
+		.config_file = state->config_file,
+		.geodb_file = state->geodb_file
+	};
+
+	geoip_ctx_t *ctx = NULL;
+	int ret = load_module(&check, &ctx);
+	if (ret != KNOT_EOK) {
+		knotd_mod_log(state->mod, LOG_WARNING, "failed to reload data, "
+		              "keeping the previous ones (%s)", knot_strerror(ret));
+		return;
+	}
+	ctx->generation = ++state->generation;
+
+	rcu_assign_pointer(state->ctx, ctx);
+	synchronize_rcu();
+	free_geoip_ctx(old);
+
+	knotd_mod_log(state->mod, LOG_INFO, "data reloaded");
+}
+
+static void *geoip_refresh(void *arg)
+{
+	geoip_state_t *state = arg;
+
+	rcu_register_thread();
+
+	pthread_mutex_lock(&state->refresh_lock);
+	while (!state->refresh_stop) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += state->refresh;
+		(void)pthread_cond_timedwait(&state->refresh_cond, &state->refresh_lock,
+		                             &deadline);
+		if (state->refresh_stop) {
+			break;
+		}
+
+		time_t config_mtime = file_mtime(state->config_file);
+		time_t geodb_mtime = file_mtime(state->geodb_file);
+		if (config_mtime != state->config_mtime || geodb_mtime != state->geodb_mtime) {
+			state->config_mtime = config_mtime;
+			state->geodb_mtime = geodb_mtime;
+			geoip_reload(state);
+		}
+	}
+	pthread_mutex_unlock(&state->refresh_lock);
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+static void free_geoip_state(geoip_state_t *state)
+{
+	if (state->refresh_active) {
+		pthread_mutex_lock(&state->refresh_lock);
+		state->refresh_stop = true;
+		pthread_cond_signal(&state->refresh_cond);
+		pthread_mutex_unlock(&state->refresh_lock);
+		pthread_join(state->refresh_thread, NULL);
+	}
+	pthread_mutex_destroy(&state->refresh_lock);
+	pthread_cond_destroy(&state->refresh_cond);
+
+	if (state->ctx != NULL) {
+		free_geoip_ctx(state->ctx);
+	}
+	if (state->caches != NULL) {
+		for (unsigned i = 0; i < state->caches_count; i++) {
+			free(state->caches[i].entries);
+		}
+		free(state->caches);
+	}
+	free(state->config_file);
+	free(state->geodb_file);
+	free(state);
+}
+
+static int init_caches(geoip_state_t *state, size_t size)
+{
+	// Number of sets, a power of two.
+	size_t sets = 1;
+	while (sets * GEO_CACHE_WAYS < size) {
+		sets <<= 1;
+	}
+
+	state->caches_count = knotd_mod_threads(state->mod);
+	state->caches = calloc(state->caches_count, sizeof(*state->caches));
+	if (state->caches == NULL) {
+		return KNOT_ENOMEM;
+	}
+	for (unsigned i = 0; i < state->caches_count; i++) {
+		geo_cache_t *cache = &state->caches[i];
+		cache->entries = calloc(sets * GEO_CACHE_WAYS, sizeof(*cache->entries));
+		if (cache->entries == NULL) {
+			return KNOT_ENOMEM;
+		}
+		cache->mask = sets - 1;
+	}
+
+	dnssec_random_buffer((uint8_t *)&state->hash_key, sizeof(state->hash_key));
+
+	return KNOT_EOK;
+}
+
 int geoip_load(knotd_mod_t *mod)
 {
+	geoip_state_t *state = calloc(1, sizeof(*state));
+	if (state == NULL) {
+		return KNOT_ENOMEM;
+	}
+	state->mod = mod;
+	pthread_mutex_init(&state->refresh_lock, NULL);
+	pthread_cond_init(&state->refresh_cond, NULL);
+
 	check_ctx_t check = { .mod = mod };
-	int ret = load_module(&check);
+	int ret = load_module(&check, &state->ctx);
 	if (ret != KNOT_EOK) {
+		free_geoip_state(state);
 		return ret;
 	}
+	state->ctx->generation = ++state->generation;
+
+	knotd_conf_t conf = knotd_conf_mod(mod, MOD_CACHE_SIZE);
+	if (conf.single.integer > 0) {
+		ret = init_caches(state, conf.single.integer);
+		if (ret != KNOT_EOK) {
+			free_geoip_state(state);
+			return ret;
+		}
+	}
+
+	conf = knotd_conf_mod(mod, MOD_REFRESH);
+	state->refresh = conf.single.integer;
+	if (state->refresh > 0) {
+		conf = knotd_conf_mod(mod, MOD_CONFIG_FILE);
+		state->config_file = strdup(conf.single.string);
+		if (state->ctx->mode == MODE_GEODB) {
+			conf = knotd_conf_mod(mod, MOD_GEODB_FILE);
+			state->geodb_file = strdup(conf.single.string);
+		}
+		state->config_mtime = file_mtime(state->config_file);
+		state->geodb_mtime = file_mtime(state->geodb_file);
+
+		if (state->config_file == NULL ||
+		    (state->ctx->mode == MODE_GEODB && state->geodb_file == NULL) ||
+		    pthread_create(&state->refresh_thread, NULL, geoip_refresh, state) != 0) {
+			free_geoip_state(state);
+			return KNOT_ENOMEM;
+		}
+		state->refresh_active = true;
+	}
+
+	knotd_mod_ctx_set(mod, state);
 
 	return knotd_mod_in_hook(mod, KNOTD_STAGE_PREANSWER, geoip_process);
 }
 
 void geoip_unload(knotd_mod_t *mod)
 {
-	geoip_ctx_t *ctx = knotd_mod_ctx(mod);
-	if (ctx != NULL) {
-		free_geoip_ctx(ctx);
+	geoip_state_t *state = knotd_mod_ctx(mod);
+	if (state != NULL) {
+		free_geoip_state(state);
 	}
 }
 
@@ -27,6 +27,7 @@
 #include "knot/dnssec/key-events.h"
 #include "knot/dnssec/policy.h"
 #include "knot/dnssec/rrset-sign.h"
+#include "knot/dnssec/sig-cache.h"
 #include "knot/dnssec/zone-events.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/nameserver/query_module.h"
@@ -34,6 +35,10 @@
 
 #define MOD_POLICY	"\x06""policy"
 #define MOD_NSEC_BITMAP	"\x0B""nsec-bitmap"
+#define MOD_SIG_CACHE	"\x0F""signature-cache"
+
+//! Number of ECDSA signing nonces kept precomputed for each key.
+#define PRECOMP_NONCES	1024
 
 int policy_check(knotd_conf_check_args_t *args)
 {
@@ -60,6 +65,7 @@ int bitmap_check(knotd_conf_check_args_t *args)
 const yp_item_t online_sign_conf[] = {
 	{ MOD_POLICY,      YP_TREF, YP_VREF = { C_POLICY }, YP_FNONE, { policy_check } },
 	{ MOD_NSEC_BITMAP, YP_TSTR, YP_VNONE, YP_FMULTI, { bitmap_check } },
+	{ MOD_SIG_CACHE,   YP_TINT, YP_VINT = { 0, 1048576, 4096 } },
 	{ NULL }
 };
 
@@ -87,6 +93,9 @@ typedef struct {
 
 	uint16_t *nsec_force_types;
 
+	sig_cache_t *sig_cache;
+	uint32_t keyset_gen; // Incremented on each reload of the keys.
+
 	bool zone_doomed;
 } online_sign_ctx_t;
 
@@ -236,6 +245,34 @@ static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
                                 zone_sign_ctx_t *sign_ctx,
                                 knot_mm_t *mm)
 {
+	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	// previously computed signatures not yet due for refresh
+
+	knot_rrset_t cached;
+	knot_rrset_init(&cached, (knot_dname_t *)owner, cover->type, cover->rclass,
+	                cover->ttl);
+	cached.rrs = cover->rrs;
+
+	if (ctx->sig_cache != NULL) {
+		knot_rrset_t *rrsig = knot_rrset_new(owner, KNOT_RRTYPE_RRSIG,
+		                                     cover->rclass, cover->ttl, mm);
+		if (!rrsig) {
+			return NULL;
+		}
+
+		pthread_rwlock_rdlock(&ctx->signing_mutex);
+		knot_time_t valid_till = knot_time_add(mod->dnssec->now,
+		                                       mod->dnssec->policy->rrsig_refresh_before);
+		int ret = sig_cache_get(ctx->sig_cache, &cached, ctx->keyset_gen,
+		                        valid_till, rrsig, mm);
+		pthread_rwlock_unlock(&ctx->signing_mutex);
+		if (ret == KNOT_EOK) {
+			return rrsig;
+		}
+		knot_rrset_free(rrsig, mm);
+	}
+
 	// copy of RR set with replaced owner name
 
 	knot_rrset_t *copy = knot_rrset_new(owner, cover->type, cover->rclass,
@@ -258,9 +295,11 @@ static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
 		return NULL;
 	}
 
-	online_sign_ctx_t *ctx = knotd_mod_ctx(mod);
 	pthread_rwlock_rdlock(&ctx->signing_mutex);
 	int ret = knot_sign_rrset2(rrsig, copy, sign_ctx, mm);
+	if (ret == KNOT_EOK) {
+		sig_cache_put(ctx->sig_cache, &cached, ctx->keyset_gen, rrsig);
+	}
 	pthread_rwlock_unlock(&ctx->signing_mutex);
 	if (ret != KNOT_EOK) {
 		knot_rrset_free(copy, NULL);
@@ -273,7 +312,7 @@ static knot_rrset_t *sign_rrset(const knot_dname_t *owner,
 	return rrsig;
 }
 
-static glue_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt)
+static const glue_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt)
 {
 	for (int i = KNOT_ANSWER; i <= KNOT_AUTHORITY; i++) {
 		const knot_pktsection_t *section = knot_pkt_section(pkt, i);
@@ -294,7 +333,7 @@ static glue_t *find_glue_for(const knot_rrset_t *rr, const knot_pkt_t *pkt)
 static bool shall_sign_rr(const knot_rrset_t *rr, const knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	if (pkt->current == KNOT_ADDITIONAL) {
-		glue_t *g = find_glue_for(rr, pkt);
+		const glue_t *g = find_glue_for(rr, pkt);
 		assert(g); // finds actually the node which is rr in
 		const zone_node_t *gn = glue_node(g, qdata->extra->node);
 		return !(gn->flags & NODE_FLAGS_NONAUTH);
@@ -471,6 +510,14 @@ static bool is_apex_query(knotd_qdata_t *qdata)
 	return knot_dname_is_equal(qdata->name, knotd_qdata_zone_name(qdata));
 }
 
+static void precompute_keys(knotd_mod_t *mod)
+{
+	// Unsupported keys (e.g. non-ECDSA or PKCS #11) are signed the usual way.
+	for (size_t i = 0; i < mod->keyset->count; i++) {
+		(void)dnssec_sign_precompute(mod->keyset->keys[i].key, PRECOMP_NONCES);
+	}
+}
+
 static knotd_in_state_t pre_routine(knotd_in_state_t state, knot_pkt_t *pkt,
                                     knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -520,7 +567,9 @@ static knotd_in_state_t pre_routine(knotd_in_state_t state, knot_pkt_t *pkt,
 			state = KNOTD_IN_STATE_ERROR;
 		} else {
 			ctx->event_rollover = knot_time_min(ctx->event_rollover, knot_get_next_zone_key_event(mod->keyset));
+			precompute_keys(mod);
 		}
+		ctx->keyset_gen++;
 		pthread_rwlock_unlock(&ctx->signing_mutex);
 	}
 	pthread_mutex_unlock(&ctx->event_mutex);
@@ -605,6 +654,7 @@ static void online_sign_ctx_free(online_sign_ctx_t *ctx)
 	pthread_mutex_destroy(&ctx->event_mutex);
 	pthread_rwlock_destroy(&ctx->signing_mutex);
 
+	sig_cache_free(ctx->sig_cache);
 	free(ctx->nsec_force_types);
 	free(ctx);
 }
@@ -646,6 +696,7 @@ static int online_sign_ctx_new(online_sign_ctx_t **ctx_ptr, knotd_mod_t *mod)
 	}
 
 	ctx->event_rollover = knot_time_min(ctx->event_rollover, knot_get_next_zone_key_event(mod->keyset));
+	precompute_keys(mod);
 
 	pthread_mutex_init(&ctx->event_mutex, NULL);
 	pthread_rwlock_init(&ctx->signing_mutex, NULL);
@@ -706,6 +757,15 @@ int online_sign_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	conf = knotd_conf_mod(mod, MOD_SIG_CACHE);
+	if (conf.single.integer > 0) {
+		ctx->sig_cache = sig_cache_new(conf.single.integer);
+		if (ctx->sig_cache == NULL) {
+			online_sign_ctx_free(ctx);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	knotd_mod_ctx_set(mod, ctx);
 
 	knotd_mod_in_hook(mod, KNOTD_STAGE_ANSWER, pre_routine);
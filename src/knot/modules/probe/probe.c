@@ -34,11 +34,13 @@
 #define MOD_PATH       "\x04""path"
 #define MOD_CHANNELS   "\x08""channels"
 #define MOD_MAX_RATE   "\x08""max-rate"
+#define MOD_SHM        "\x0D""shared-memory"
 
 const yp_item_t probe_conf[] = {
 	{ MOD_PATH,     YP_TSTR, YP_VNONE },
 	{ MOD_CHANNELS, YP_TINT, YP_VINT = { 1, UINT16_MAX, 1 } },
 	{ MOD_MAX_RATE, YP_TINT, YP_VINT = { 0, UINT32_MAX, 1000 } },
+	{ MOD_SHM,      YP_TBOOL, YP_VNONE },
 	{ NULL }
 };
 
@@ -153,6 +155,9 @@ int probe_load(knotd_mod_t *mod)
 		ctx->min_diff_ns = ctx->probe_count * 1000000000 / conf.single.integer;
 	}
 
+	conf = knotd_conf_mod(mod, MOD_SHM);
+	bool shm = conf.single.boolean;
+
 	for (int i = 0; i < ctx->probe_count; i++) {
 		knot_probe_t *probe = knot_probe_alloc();
 		if (probe == NULL) {
@@ -160,7 +165,8 @@ int probe_load(knotd_mod_t *mod)
 			return KNOT_ENOMEM;
 		}
 
-		int ret = knot_probe_set_producer(probe, ctx->path, i + 1);
+		int ret = shm ? knot_probe_set_ring_producer(probe, ctx->path, i + 1) :
+		                knot_probe_set_producer(probe, ctx->path, i + 1);
 		switch (ret) {
 		case KNOT_ECONN:
 			knotd_mod_log(mod, LOG_NOTICE, "channel %i not connected", i + 1);
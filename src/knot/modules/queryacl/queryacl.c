@@ -15,6 +15,7 @@
  */
 
 #include "knot/include/module.h"
+#include "contrib/ipset.h"
 #include "contrib/sockaddr.h"
 
 #define MOD_ADDRESS	"\x07""address"
@@ -27,10 +28,44 @@ const yp_item_t queryacl_conf[] = {
 };
 
 typedef struct {
-	knotd_conf_t allow_addr;
-	knotd_conf_t allow_iface;
+	ipset_t *allow_addr;  // NULL if any address.
+	ipset_t *allow_iface; // NULL if any interface.
 } queryacl_ctx_t;
 
+static int compile_ranges(knotd_mod_t *mod, const yp_name_t *item_name, ipset_t **out)
+{
+	knotd_conf_t conf = knotd_conf_mod(mod, item_name);
+	if (conf.count == 0) {
+		*out = NULL;
+		return KNOT_EOK;
+	}
+
+	ipset_t *set = ipset_new();
+	if (set == NULL) {
+		knotd_conf_free(&conf);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < conf.count && ret == KNOT_EOK; i++) {
+		knotd_conf_val_t *val = &conf.multi[i];
+		if (val->addr_max.ss_family == AF_UNSPEC) {
+			ret = ipset_add_prefix(set, &val->addr, val->addr_mask);
+		} else {
+			ret = ipset_add_range(set, &val->addr, &val->addr_max);
+		}
+	}
+	knotd_conf_free(&conf);
+	if (ret != KNOT_EOK) {
+		ipset_free(set);
+		return ret;
+	}
+	ipset_finalize(set);
+
+	*out = set;
+	return KNOT_EOK;
+}
+
 static knotd_state_t queryacl_process(knotd_state_t state, knot_pkt_t *pkt,
                                       knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -43,18 +78,18 @@ static knotd_state_t queryacl_process(knotd_state_t state, knot_pkt_t *pkt,
 		return state;
 	}
 
-	if (ctx->allow_addr.count > 0) {
+	if (ctx->allow_addr != NULL) {
 		const struct sockaddr_storage *addr = knotd_qdata_remote_addr(qdata);
-		if (!knotd_conf_addr_range_match(&ctx->allow_addr, addr)) {
+		if (!ipset_match(ctx->allow_addr, addr)) {
 			qdata->rcode = KNOT_RCODE_NOTAUTH;
 			return KNOTD_STATE_FAIL;
 		}
 	}
 
-	if (ctx->allow_iface.count > 0) {
+	if (ctx->allow_iface != NULL) {
 		struct sockaddr_storage buff;
 		const struct sockaddr_storage *addr = knotd_qdata_local_addr(qdata, &buff);
-		if (!knotd_conf_addr_range_match(&ctx->allow_iface, addr)) {
+		if (!ipset_match(ctx->allow_iface, addr)) {
 			qdata->rcode = KNOT_RCODE_NOTAUTH;
 			return KNOTD_STATE_FAIL;
 		}
@@ -71,8 +106,15 @@ int queryacl_load(knotd_mod_t *mod)
 		return KNOT_ENOMEM;
 	}
 
-	ctx->allow_addr = knotd_conf_mod(mod, MOD_ADDRESS);
-	ctx->allow_iface = knotd_conf_mod(mod, MOD_INTERFACE);
+	int ret = compile_ranges(mod, MOD_ADDRESS, &ctx->allow_addr);
+	if (ret == KNOT_EOK) {
+		ret = compile_ranges(mod, MOD_INTERFACE, &ctx->allow_iface);
+	}
+	if (ret != KNOT_EOK) {
+		ipset_free(ctx->allow_addr);
+		free(ctx);
+		return ret;
+	}
 
 	knotd_mod_ctx_set(mod, ctx);
 
@@ -83,8 +125,8 @@ void queryacl_unload(knotd_mod_t *mod)
 {
 	queryacl_ctx_t *ctx = knotd_mod_ctx(mod);
 	if (ctx != NULL) {
-		knotd_conf_free(&ctx->allow_addr);
-		knotd_conf_free(&ctx->allow_iface);
+		ipset_free(ctx->allow_addr);
+		ipset_free(ctx->allow_iface);
 	}
 	free(ctx);
 }
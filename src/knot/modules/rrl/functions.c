@@ -15,9 +15,12 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <time.h>
 
 #include "knot/modules/rrl/functions.h"
+#include "contrib/macros.h"
+#include "contrib/mempattern.h"
 #include "contrib/openbsd/strlcat.h"
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
@@ -35,7 +38,8 @@
 #define RRL_SSTART 2 /* 1/Nth of the rate for slow start */
 #define RRL_PSIZE_LARGE 1024
 #define RRL_CAPACITY 4 /* Window size in seconds */
-#define RRL_LOCK_GRANULARITY 32 /* Last digit granularity */
+#define RRL_SHARDS 64 /* Maximal number of table shards */
+#define RRL_SHARD_MIN_SIZE 1024 /* Minimal number of buckets in a shard */
 
 /* Classification */
 enum {
@@ -199,16 +203,16 @@ static int bucket_match(rrl_item_t *bucket, rrl_item_t *match)
 	       bucket->qname  == match->qname;
 }
 
-static int find_free(rrl_table_t *tbl, unsigned id, uint32_t now)
+static int find_free(rrl_shard_t *shard, unsigned id, uint32_t now)
 {
-	for (int i = id; i < tbl->size; i++) {
-		if (bucket_free(&tbl->arr[i], now)) {
+	for (int i = id; i < shard->size; i++) {
+		if (bucket_free(&shard->arr[i], now)) {
 			return i - id;
 		}
 	}
 	for (int i = 0; i < id; i++) {
-		if (bucket_free(&tbl->arr[i], now)) {
-			return i + (tbl->size - id);
+		if (bucket_free(&shard->arr[i], now)) {
+			return i + (shard->size - id);
 		}
 	}
 
@@ -216,15 +220,15 @@ static int find_free(rrl_table_t *tbl, unsigned id, uint32_t now)
 	return id;
 }
 
-static inline unsigned find_match(rrl_table_t *tbl, uint32_t id, rrl_item_t *m)
+static inline unsigned find_match(rrl_shard_t *shard, uint32_t id, rrl_item_t *m)
 {
 	unsigned new_id = 0;
 	unsigned hop = 0;
-	unsigned match_bitmap = tbl->arr[id].hop;
+	unsigned match_bitmap = shard->arr[id].hop;
 	while (match_bitmap != 0) {
 		hop = __builtin_ctz(match_bitmap); /* offset of next potential match */
-		new_id = (id + hop) % tbl->size;
-		if (bucket_match(&tbl->arr[new_id], m)) {
+		new_id = (id + hop) % shard->size;
+		if (bucket_match(&shard->arr[new_id], m)) {
 			return hop;
 		} else {
 			match_bitmap &= ~(1 << hop); /* clear potential match */
@@ -234,21 +238,21 @@ static inline unsigned find_match(rrl_table_t *tbl, uint32_t id, rrl_item_t *m)
 	return HOP_LEN + 1;
 }
 
-static inline unsigned reduce_dist(rrl_table_t *tbl, unsigned id, unsigned dist, unsigned *free_id)
+static inline unsigned reduce_dist(rrl_shard_t *shard, unsigned id, unsigned dist, unsigned *free_id)
 {
 	unsigned rd = HOP_LEN - 1;
 	while (rd > 0) {
-		unsigned vacate_id = (tbl->size + *free_id - rd) % tbl->size; /* bucket to be vacated */
-		if (tbl->arr[vacate_id].hop != 0) {
-			unsigned hop = __builtin_ctz(tbl->arr[vacate_id].hop);  /* offset of first valid bucket */
+		unsigned vacate_id = (shard->size + *free_id - rd) % shard->size; /* bucket to be vacated */
+		if (shard->arr[vacate_id].hop != 0) {
+			unsigned hop = __builtin_ctz(shard->arr[vacate_id].hop);  /* offset of first valid bucket */
 			if (hop < rd) { /* only offsets in <vacate_id, free_id> are interesting */
-				unsigned new_id = (vacate_id + hop) % tbl->size; /* this item will be displaced to [free_id] */
-				unsigned keep_hop = tbl->arr[*free_id].hop; /* unpredictable padding */
-				memcpy(tbl->arr + *free_id, tbl->arr + new_id, sizeof(rrl_item_t));
-				tbl->arr[*free_id].hop = keep_hop;
-				tbl->arr[new_id].cls = CLS_NULL;
-				tbl->arr[vacate_id].hop &= ~(1 << hop);
-				tbl->arr[vacate_id].hop |= 1 << rd;
+				unsigned new_id = (vacate_id + hop) % shard->size; /* this item will be displaced to [free_id] */
+				unsigned keep_hop = shard->arr[*free_id].hop; /* unpredictable padding */
+				memcpy(shard->arr + *free_id, shard->arr + new_id, sizeof(rrl_item_t));
+				shard->arr[*free_id].hop = keep_hop;
+				shard->arr[new_id].cls = CLS_NULL;
+				shard->arr[vacate_id].hop &= ~(1 << hop);
+				shard->arr[vacate_id].hop |= 1 << rd;
 				*free_id = new_id;
 				return dist - (rd - hop);
 			}
@@ -307,76 +311,65 @@ static void rrl_log_state(knotd_mod_t *mod, const struct sockaddr_storage *ss,
 	              addr_str, rrl_clsstr(cls), qname_str, what);
 }
 
-static void rrl_lock(rrl_table_t *tbl, int lk_id)
+static void rrl_destroy_shards(rrl_table_t *tbl, unsigned count)
 {
-	assert(lk_id > -1);
-	pthread_mutex_lock(tbl->lk + lk_id);
-}
-
-static void rrl_unlock(rrl_table_t *tbl, int lk_id)
-{
-	assert(lk_id > -1);
-	pthread_mutex_unlock(tbl->lk + lk_id);
+	for (unsigned i = 0; i < count; ++i) {
+		pthread_mutex_destroy(&tbl->shards[i].lock);
+	}
+	free(tbl->shards);
 }
 
-static int rrl_setlocks(rrl_table_t *tbl, uint32_t granularity)
+static int rrl_setshards(rrl_table_t *tbl)
 {
-	assert(!tbl->lk); /* Cannot change while locks are used. */
-	assert(granularity <= tbl->size / 10); /* Due to int. division err. */
+	unsigned count = MIN(RRL_SHARDS, MAX(1, tbl->size / RRL_SHARD_MIN_SIZE));
 
-	if (pthread_mutex_init(&tbl->ll, NULL) < 0) {
+	/* Align shards to separate cache lines. */
+	if (posix_memalign((void **)&tbl->shards, sizeof(rrl_shard_t),
+	                   count * sizeof(rrl_shard_t)) != 0) {
 		return KNOT_ENOMEM;
 	}
+	memset(tbl->shards, 0, count * sizeof(rrl_shard_t));
 
-	/* Alloc new locks. */
-	tbl->lk = malloc(granularity * sizeof(pthread_mutex_t));
-	if (!tbl->lk) {
-		return KNOT_ENOMEM;
-	}
-	memset(tbl->lk, 0, granularity * sizeof(pthread_mutex_t));
-
-	/* Initialize. */
-	for (size_t i = 0; i < granularity; ++i) {
-		if (pthread_mutex_init(tbl->lk + i, NULL) < 0) {
-			break;
-		}
-		++tbl->lk_count;
-	}
-
-	/* Incomplete initialization */
-	if (tbl->lk_count != granularity) {
-		for (size_t i = 0; i < tbl->lk_count; ++i) {
-			pthread_mutex_destroy(tbl->lk + i);
+	/* Distribute buckets evenly amongst shards. */
+	size_t offset = 0;
+	for (unsigned i = 0; i < count; ++i) {
+		rrl_shard_t *shard = &tbl->shards[i];
+		if (pthread_mutex_init(&shard->lock, NULL) != 0) {
+			rrl_destroy_shards(tbl, i);
+			return KNOT_ERROR;
 		}
-		free(tbl->lk);
-		tbl->lk_count = 0;
-		return KNOT_ERROR;
+		shard->size = tbl->size / count + (i < tbl->size % count ? 1 : 0);
+		shard->arr = tbl->arr + offset;
+		offset += shard->size;
 	}
+	assert(offset == tbl->size);
+	tbl->shard_count = count;
 
 	return KNOT_EOK;
 }
 
-rrl_table_t *rrl_create(size_t size, uint32_t rate)
+rrl_table_t *rrl_create(size_t size, uint32_t rate, knot_mm_t *mm)
 {
 	if (size == 0) {
 		return NULL;
 	}
 
 	const size_t tbl_len = sizeof(rrl_table_t) + size * sizeof(rrl_item_t);
-	rrl_table_t *tbl = calloc(1, tbl_len);
+	rrl_table_t *tbl = mm_calloc(mm, 1, tbl_len);
 	if (!tbl) {
 		return NULL;
 	}
+	tbl->mm = mm;
 	tbl->size = size;
 	tbl->rate = rate;
 
 	if (dnssec_random_buffer((uint8_t *)&tbl->key, sizeof(tbl->key)) != DNSSEC_EOK) {
-		free(tbl);
+		mm_free(mm, tbl);
 		return NULL;
 	}
 
-	if (rrl_setlocks(tbl, RRL_LOCK_GRANULARITY) != KNOT_EOK) {
-		free(tbl);
+	if (rrl_setshards(tbl) != KNOT_EOK) {
+		mm_free(mm, tbl);
 		return NULL;
 	}
 
@@ -388,20 +381,23 @@ static knot_dname_t *buf_qname(uint8_t *buf)
 	return buf + sizeof(uint8_t) + sizeof(uint64_t);
 }
 
-/*! \brief Get bucket for current combination of parameters. */
+/*! \brief Get bucket for current combination of parameters, lock its shard. */
 static rrl_item_t *rrl_hash(rrl_table_t *tbl, const struct sockaddr_storage *remote,
                             rrl_req_t *req, const knot_dname_t *zone, uint32_t stamp,
-                            int *lock, uint8_t *buf, size_t buf_len)
+                            rrl_shard_t **locked, uint8_t *buf, size_t buf_len)
 {
 	int len = rrl_classify(buf, buf_len, remote, req, zone);
 	if (len < 0) {
 		return NULL;
 	}
 
-	uint32_t id = SipHash24(&tbl->key, buf, len) % tbl->size;
+	uint64_t hash = SipHash24(&tbl->key, buf, len);
+	rrl_shard_t *shard = &tbl->shards[(hash >> 32) % tbl->shard_count];
+	uint32_t id = (uint32_t)hash % shard->size;
 
-	/* Lock for lookup. */
-	pthread_mutex_lock(&tbl->ll);
+	/* Lock the shard for both lookup and bucket update. */
+	pthread_mutex_lock(&shard->lock);
+	*locked = shard;
 
 	/* Find an exact match in <id, id + HOP_LEN). */
 	knot_dname_t *qname = buf_qname(buf);
@@ -417,26 +413,21 @@ static rrl_item_t *rrl_hash(rrl_table_t *tbl, const struct sockaddr_storage *rem
 		.time = stamp
 	};
 
-	unsigned dist = find_match(tbl, id, &match);
+	unsigned dist = find_match(shard, id, &match);
 	if (dist > HOP_LEN) { /* not an exact match, find free element [f] */
-		dist = find_free(tbl, id, stamp);
+		dist = find_free(shard, id, stamp);
 	}
 
 	/* Reduce distance to fit <id, id + HOP_LEN) */
-	unsigned free_id = (id + dist) % tbl->size;
+	unsigned free_id = (id + dist) % shard->size;
 	while (dist >= HOP_LEN) {
-		dist = reduce_dist(tbl, id, dist, &free_id);
+		dist = reduce_dist(shard, id, dist, &free_id);
 	}
 
-	/* Assign granular lock and unlock lookup. */
-	*lock = free_id % tbl->lk_count;
-	rrl_lock(tbl, *lock);
-	pthread_mutex_unlock(&tbl->ll);
-
 	/* found free bucket which is in <id, id + HOP_LEN) */
-	tbl->arr[id].hop |= (1 << dist);
-	rrl_item_t *bucket = &tbl->arr[free_id];
-	assert(free_id == (id + dist) % tbl->size);
+	shard->arr[id].hop |= (1 << dist);
+	rrl_item_t *bucket = &shard->arr[free_id];
+	assert(free_id == (id + dist) % shard->size);
 
 	/* Inspect bucket state. */
 	unsigned hop = bucket->hop;
@@ -468,12 +459,12 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote,
 
 	/* Calculate hash and fetch */
 	int ret = KNOT_EOK;
-	int lock = -1;
+	rrl_shard_t *shard = NULL;
 	uint32_t now = time_now().tv_sec;
-	rrl_item_t *bucket = rrl_hash(rrl, remote, req, zone, now, &lock, buf, sizeof(buf));
+	rrl_item_t *bucket = rrl_hash(rrl, remote, req, zone, now, &shard, buf, sizeof(buf));
 	if (!bucket) {
-		if (lock > -1) {
-			rrl_unlock(rrl, lock);
+		if (shard != NULL) {
+			pthread_mutex_unlock(&shard->lock);
 		}
 		return KNOT_ERROR;
 	}
@@ -519,9 +510,8 @@ int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *remote,
 		ret = KNOT_ELIMIT;
 	}
 
-	if (lock > -1) {
-		rrl_unlock(rrl, lock);
-	}
+	pthread_mutex_unlock(&shard->lock);
+
 	return ret;
 }
 
@@ -540,14 +530,7 @@ bool rrl_slip_roll(int n_slip)
 void rrl_destroy(rrl_table_t *rrl)
 {
 	if (rrl) {
-		if (rrl->lk_count > 0) {
-			pthread_mutex_destroy(&rrl->ll);
-		}
-		for (size_t i = 0; i < rrl->lk_count; ++i) {
-			pthread_mutex_destroy(rrl->lk + i);
-		}
-		free(rrl->lk);
+		rrl_destroy_shards(rrl, rrl->shard_count);
+		mm_free(rrl->mm, rrl);
 	}
-
-	free(rrl);
 }
@@ -37,6 +37,19 @@ typedef struct {
 	uint32_t time;       /* Timestamp. */
 } rrl_item_t;
 
+/*!
+ * \brief RRL hash bucket table shard.
+ *
+ * Each shard is an independent hopscotch table guarded by its own lock.
+ * Shards are cache line aligned so that locks of different shards don't share
+ * a cache line.
+ */
+typedef struct {
+	pthread_mutex_t lock; /* Shard lock. */
+	size_t size;          /* Number of buckets in the shard. */
+	rrl_item_t *arr;      /* Shard buckets. */
+} __attribute__((aligned(64))) rrl_shard_t;
+
 /*!
  * \brief RRL hash bucket table.
  *
@@ -45,18 +58,19 @@ typedef struct {
  * When a bucket is in a slow-start mode, it cannot reset again for the time
  * period.
  *
- * To avoid lock contention, N locks are created and distributed amongst buckets.
- * As of now lock K for bucket N is calculated as K = N % (num_buckets).
+ * To avoid lock contention, the table is split into shards. The shard is
+ * selected by the upper half of the bucket hash, so each bucket lives in
+ * exactly one shard and the rate accounting is shared by all threads, while
+ * threads only contend when accessing the same shard.
  */
-
 typedef struct {
-	SIPHASH_KEY key;     /* Siphash key. */
-	uint32_t rate;       /* Configured RRL limit. */
-	pthread_mutex_t ll;
-	pthread_mutex_t *lk; /* Table locks. */
-	unsigned lk_count;   /* Table lock count (granularity). */
-	size_t size;         /* Number of buckets. */
-	rrl_item_t arr[];    /* Buckets. */
+	SIPHASH_KEY key;      /* Siphash key. */
+	knot_mm_t *mm;        /* Memory context of the table. */
+	uint32_t rate;        /* Configured RRL limit. */
+	size_t size;          /* Number of buckets. */
+	unsigned shard_count; /* Number of table shards. */
+	rrl_shard_t *shards;  /* Table shards. */
+	rrl_item_t arr[];     /* Buckets. */
 } rrl_table_t;
 
 /*! \brief RRL request flags. */
@@ -79,9 +93,10 @@ typedef struct {
  * \brief Create a RRL table.
  * \param size Fixed hashtable size (reasonable large prime is recommended).
  * \param rate Rate (in pkts/sec).
+ * \param mm Memory context (NULL for malloc).
  * \return created table or NULL.
  */
-rrl_table_t *rrl_create(size_t size, uint32_t rate);
+rrl_table_t *rrl_create(size_t size, uint32_t rate, knot_mm_t *mm);
 
 /*!
  * \brief Query the RRL table for accept or deny, when the rate limit is reached.
@@ -0,0 +1,355 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/modules/rrl/nxdomain.h"
+#include "knot/nameserver/process_query.h" // Dependency on qdata->extra!
+#include "contrib/macros.h"
+#include "contrib/time.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+
+#define NXD_ZONES	256	/* Number of the zone accounting slots. */
+#define NXD_PROOFS	64	/* Proofs remembered per zone. */
+#define NXD_HOLD	10	/* Seconds the attack mode lasts after the rate drops. */
+
+nxd_table_t *nxd_create(uint32_t limit)
+{
+	nxd_table_t *tbl = calloc(1, sizeof(*tbl) + NXD_ZONES * sizeof(nxd_zone_t));
+	if (tbl == NULL) {
+		return NULL;
+	}
+
+	if (dnssec_random_buffer((uint8_t *)&tbl->key, sizeof(tbl->key)) != DNSSEC_EOK) {
+		free(tbl);
+		return NULL;
+	}
+	tbl->limit = limit;
+
+	for (unsigned i = 0; i < NXD_ZONES; i++) {
+		pthread_mutex_init(&tbl->zones[i].lock, NULL);
+	}
+
+	return tbl;
+}
+
+static void proof_clear(nxd_proof_t *proof)
+{
+	knot_dname_free(proof->owner, NULL);
+	knot_dname_free(proof->next, NULL);
+	knot_dname_free(proof->encloser, NULL);
+	for (unsigned i = 0; i < proof->count; i++) {
+		knot_rrset_clear(&proof->rrsets[i], NULL);
+	}
+	free(proof->rrsets);
+	free(proof->flags);
+	memset(proof, 0, sizeof(*proof));
+}
+
+static void zone_clear_proofs(nxd_zone_t *zone)
+{
+	for (unsigned i = 0; i < zone->proof_count; i++) {
+		proof_clear(&zone->proofs[i]);
+	}
+	zone->proof_count = 0;
+}
+
+void nxd_destroy(nxd_table_t *tbl)
+{
+	if (tbl == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < NXD_ZONES; i++) {
+		zone_clear_proofs(&tbl->zones[i]);
+		free(tbl->zones[i].proofs);
+		pthread_mutex_destroy(&tbl->zones[i].lock);
+	}
+	free(tbl);
+}
+
+static nxd_zone_t *zone_slot(nxd_table_t *tbl, const knot_dname_t *zone_name,
+                             uint64_t *hash)
+{
+	*hash = SipHash24(&tbl->key, zone_name, knot_dname_size(zone_name));
+	return &tbl->zones[*hash % NXD_ZONES];
+}
+
+/*! \brief Checks if the NSEC range covers the name, the last range wraps around. */
+static bool range_covers(const knot_dname_t *owner, const knot_dname_t *next,
+                         const knot_dname_t *name)
+{
+	return knot_dname_cmp(owner, name) < 0 &&
+	       (knot_dname_cmp(name, next) < 0 || knot_dname_cmp(next, owner) <= 0);
+}
+
+/*!
+ * \brief Gets the closest encloser of a name covered by the NSEC range.
+ *
+ * No name exists inside the range, so the closest encloser is the longest
+ * common ancestor of the name and one of the range bounds.
+ *
+ * \return Closest encloser (suffix of the name), NULL if the name exists.
+ */
+static const knot_dname_t *closest_encloser(const knot_dname_t *owner,
+                                            const knot_dname_t *next,
+                                            const knot_dname_t *name)
+{
+	size_t labels = MAX(knot_dname_matched_labels(name, owner),
+	                    knot_dname_matched_labels(name, next));
+	size_t name_labels = knot_dname_labels(name, NULL);
+	if (labels >= name_labels) {
+		return NULL; // Empty non-terminal.
+	}
+
+	for (size_t i = labels; i < name_labels; i++) {
+		name = knot_wire_next_label(name, NULL);
+	}
+
+	return name;
+}
+
+/*! \brief Finds the last proof with the NSEC owner before the name. */
+static nxd_proof_t *find_proof(nxd_zone_t *zone, const knot_dname_t *name)
+{
+	unsigned lo = 0, hi = zone->proof_count;
+	while (lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+		if (knot_dname_cmp(zone->proofs[mid].owner, name) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return (lo > 0) ? &zone->proofs[lo - 1] : NULL;
+}
+
+static bool accepts_proof(const knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	return qdata->type == KNOTD_QUERY_TYPE_NORMAL &&
+	       knot_pkt_qclass(qdata->query) == KNOT_CLASS_IN &&
+	       knot_pkt_has_dnssec(qdata->query) &&
+	       !knot_pkt_has_tsig(qdata->query) &&
+	       qdata->extra->contents != NULL;
+}
+
+static int proof_init(nxd_proof_t *proof, const knot_pkt_t *pkt,
+                      const knot_pktsection_t *auth, const knot_rrset_t *nsec,
+                      const knot_dname_t *qname)
+{
+	const knot_dname_t *next = knot_nsec_next(nsec->rrs.rdata);
+	const knot_dname_t *encloser = closest_encloser(nsec->owner, next, qname);
+	if (encloser == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	proof->owner = knot_dname_copy(nsec->owner, NULL);
+	proof->next = knot_dname_copy(next, NULL);
+	proof->encloser = knot_dname_copy(encloser, NULL);
+	proof->rrsets = calloc(auth->count, sizeof(knot_rrset_t));
+	proof->flags = calloc(auth->count, sizeof(uint16_t));
+	if (proof->owner == NULL || proof->next == NULL || proof->encloser == NULL ||
+	    proof->rrsets == NULL || proof->flags == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_dname_to_lower(proof->next);
+
+	for (uint16_t i = 0; i < auth->count; i++) {
+		const knot_rrset_t *rr = knot_pkt_rr(auth, i);
+		knot_rrset_t *copy = &proof->rrsets[i];
+		knot_rrset_init(copy, knot_dname_copy(rr->owner, NULL), rr->type,
+		                rr->rclass, rr->ttl);
+		proof->count++;
+		if (copy->owner == NULL ||
+		    knot_rdataset_copy(&copy->rrs, &rr->rrs, NULL) != KNOT_EOK) {
+			return KNOT_ENOMEM;
+		}
+		proof->flags[i] = pkt->rr_info[auth->pos + i].flags & ~KNOT_PF_FREE;
+	}
+
+	return KNOT_EOK;
+}
+
+static void remember_proof(nxd_zone_t *zone, knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	const knot_dname_t *qname = knot_pkt_qname(qdata->query);
+	if (knot_wire_get_ancount(pkt->wire) > 0 || !knot_wire_get_aa(pkt->wire) ||
+	    !accepts_proof(pkt, qdata)) {
+		return;
+	}
+
+	// Find the NSEC covering the QNAME.
+	const knot_pktsection_t *auth = knot_pkt_section(pkt, KNOT_AUTHORITY);
+	const knot_rrset_t *nsec = NULL;
+	for (uint16_t i = 0; i < auth->count; i++) {
+		const knot_rrset_t *rr = knot_pkt_rr(auth, i);
+		if (rr->type == KNOT_RRTYPE_NSEC && rr->rrs.count == 1 &&
+		    range_covers(rr->owner, knot_nsec_next(rr->rrs.rdata), qname)) {
+			nsec = rr;
+			break;
+		}
+	}
+	if (nsec == NULL) {
+		return; // E.g. NSEC3 or no proof.
+	}
+
+	// The proofs are valid only for one version of the zone.
+	uint32_t serial = zone_contents_serial(qdata->extra->contents);
+	if (zone->owner != qdata->extra->zone || zone->serial != serial) {
+		zone_clear_proofs(zone);
+		zone->owner = qdata->extra->zone;
+		zone->serial = serial;
+	}
+
+	nxd_proof_t *prev = find_proof(zone, qname);
+	if (prev != NULL && knot_dname_is_equal(prev->owner, nsec->owner)) {
+		return; // Already known.
+	}
+
+	if (zone->proofs == NULL) {
+		zone->proofs = calloc(NXD_PROOFS, sizeof(nxd_proof_t));
+		if (zone->proofs == NULL) {
+			return;
+		}
+	}
+	if (zone->proof_count == NXD_PROOFS) {
+		zone_clear_proofs(zone);
+		prev = NULL;
+	}
+
+	nxd_proof_t proof = { 0 };
+	if (proof_init(&proof, pkt, auth, nsec, qname) != KNOT_EOK) {
+		proof_clear(&proof);
+		return;
+	}
+
+	unsigned pos = (prev != NULL) ? prev - zone->proofs + 1 : 0;
+	memmove(&zone->proofs[pos + 1], &zone->proofs[pos],
+	        (zone->proof_count - pos) * sizeof(nxd_proof_t));
+	zone->proofs[pos] = proof;
+	zone->proof_count++;
+}
+
+void nxd_account(nxd_table_t *tbl, knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                 knotd_mod_t *mod)
+{
+	const knot_dname_t *zone_name = knotd_qdata_zone_name(qdata);
+	if (tbl == NULL || zone_name == NULL ||
+	    knot_wire_get_rcode(pkt->wire) != KNOT_RCODE_NXDOMAIN) {
+		return;
+	}
+
+	uint64_t hash;
+	nxd_zone_t *zone = zone_slot(tbl, zone_name, &hash);
+	uint32_t now = time_now().tv_sec;
+
+	pthread_mutex_lock(&zone->lock);
+	if (zone->zone != hash) {
+		zone_clear_proofs(zone);
+		zone->zone = hash;
+		zone->count = 0;
+		zone->owner = NULL;
+		__atomic_store_n(&zone->attack_until, 0, __ATOMIC_RELAXED);
+	}
+	if (zone->time != now) {
+		zone->time = now;
+		zone->count = 0;
+	}
+	if (++zone->count > tbl->limit) {
+		if (zone->attack_until <= now) {
+			knot_dname_txt_storage_t name_str;
+			(void)knot_dname_to_str(name_str, zone_name, sizeof(name_str));
+			knotd_mod_log(mod, LOG_NOTICE, "zone %s, NXDOMAIN rate exceeded, "
+			              "answering from denial proofs", name_str);
+		}
+		__atomic_store_n(&zone->attack_until, now + NXD_HOLD, __ATOMIC_RELAXED);
+	}
+	if (zone->attack_until > now) {
+		remember_proof(zone, pkt, qdata);
+	}
+	pthread_mutex_unlock(&zone->lock);
+}
+
+static int put_proof(const nxd_proof_t *proof, knot_pkt_t *pkt)
+{
+	int ret = knot_pkt_begin(pkt, KNOT_ANSWER);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_begin(pkt, KNOT_AUTHORITY);
+	}
+
+	for (unsigned i = 0; i < proof->count && ret == KNOT_EOK; i++) {
+		const knot_rrset_t *rr = &proof->rrsets[i];
+		knot_rrset_t copy;
+		knot_rrset_init(&copy, knot_dname_copy(rr->owner, &pkt->mm), rr->type,
+		                rr->rclass, rr->ttl);
+		if (copy.owner == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ret = knot_rdataset_copy(&copy.rrs, &rr->rrs, &pkt->mm);
+		if (ret == KNOT_EOK) {
+			ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &copy,
+			                   proof->flags[i] | KNOT_PF_FREE);
+		}
+		if (ret != KNOT_EOK) {
+			knot_rrset_clear(&copy, &pkt->mm);
+		}
+	}
+
+	return ret;
+}
+
+int nxd_answer(nxd_table_t *tbl, knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	const knot_dname_t *zone_name = knotd_qdata_zone_name(qdata);
+	if (tbl == NULL || zone_name == NULL || !accepts_proof(pkt, qdata)) {
+		return KNOT_ENOENT;
+	}
+
+	uint64_t hash;
+	nxd_zone_t *zone = zone_slot(tbl, zone_name, &hash);
+	uint32_t now = time_now().tv_sec;
+	if (__atomic_load_n(&zone->attack_until, __ATOMIC_RELAXED) <= now) {
+		return KNOT_ENOENT;
+	}
+
+	const knot_dname_t *qname = knot_pkt_qname(qdata->query);
+
+	int ret = KNOT_ENOENT;
+	pthread_mutex_lock(&zone->lock);
+	const nxd_proof_t *proof = NULL;
+	if (zone->zone == hash && zone->owner == qdata->extra->zone &&
+	    zone->serial == zone_contents_serial(qdata->extra->contents)) {
+		proof = find_proof(zone, qname);
+	}
+	if (proof != NULL && range_covers(proof->owner, proof->next, qname)) {
+		const knot_dname_t *encloser = closest_encloser(proof->owner, proof->next, qname);
+		if (encloser != NULL && knot_dname_is_equal(encloser, proof->encloser)) {
+			ret = put_proof(proof, pkt);
+		}
+	}
+	pthread_mutex_unlock(&zone->lock);
+
+	if (ret == KNOT_EOK) {
+		knot_wire_set_aa(pkt->wire);
+		qdata->rcode = KNOT_RCODE_NXDOMAIN;
+	}
+
+	return ret;
+}
@@ -0,0 +1,95 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "libknot/libknot.h"
+#include "knot/include/module.h"
+#include "contrib/openbsd/siphash.h"
+
+/*!
+ * \brief Random-subdomain (water torture) attack mitigation.
+ *
+ * The NXDOMAIN responses are counted per zone. Once a zone exceeds the
+ * configured rate, it's considered attacked for a while and the NSEC
+ * denial proofs of its NXDOMAIN responses are remembered together with
+ * the closest encloser. Other names falling into a remembered NSEC range
+ * with the same closest encloser get the same proof (similarly to the
+ * aggressive use of DNSSEC-validated cache, RFC 8198), so such queries are
+ * answered without the zone lookup and the proof assembly.
+ */
+
+/*! \brief Remembered NXDOMAIN proof. */
+typedef struct {
+	knot_dname_t *owner;     /*!< Owner of the NSEC covering the name. */
+	knot_dname_t *next;      /*!< Next name of the NSEC. */
+	knot_dname_t *encloser;  /*!< Closest encloser of the denied names. */
+	uint16_t count;          /*!< Number of the proof RRSets. */
+	knot_rrset_t *rrsets;    /*!< Authority section RRSets. */
+	uint16_t *flags;         /*!< Packet flags of the RRSets. */
+} nxd_proof_t;
+
+/*! \brief Per-zone NXDOMAIN accounting. */
+typedef struct {
+	pthread_mutex_t lock;
+	uint64_t zone;           /*!< Hash of the zone name. */
+	uint32_t time;           /*!< Current accounting second. */
+	uint32_t count;          /*!< NXDOMAIN responses in the second. */
+	uint32_t attack_until;   /*!< End of the attack mode. */
+	uint32_t serial;         /*!< Zone serial of the proofs. */
+	const void *owner;       /*!< Zone of the proofs. */
+	unsigned proof_count;
+	nxd_proof_t *proofs;     /*!< Proofs ordered by the NSEC owner. */
+} __attribute__((aligned(64))) nxd_zone_t;
+
+/*! \brief NXDOMAIN accounting table. */
+typedef struct {
+	SIPHASH_KEY key;         /*!< Siphash key. */
+	uint32_t limit;          /*!< NXDOMAIN responses per second per zone. */
+	nxd_zone_t zones[];
+} nxd_table_t;
+
+/*!
+ * \brief Creates the table.
+ *
+ * \param limit  NXDOMAIN rate limit per zone.
+ *
+ * \return Created table or NULL.
+ */
+nxd_table_t *nxd_create(uint32_t limit);
+
+/*!
+ * \brief Accounts the response and remembers its proof if the zone is attacked.
+ */
+void nxd_account(nxd_table_t *tbl, knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                 knotd_mod_t *mod);
+
+/*!
+ * \brief Tries to answer an attacked zone with a remembered proof.
+ *
+ * \retval KNOT_EOK if the NXDOMAIN response was put into the packet.
+ * \retval KNOT_ENOENT if no proof applies.
+ * \return KNOT_E* if the packet couldn't be completed.
+ */
+int nxd_answer(nxd_table_t *tbl, knot_pkt_t *pkt, knotd_qdata_t *qdata);
+
+/*!
+ * \brief Destroys the table.
+ */
+void nxd_destroy(nxd_table_t *tbl);
@@ -17,17 +17,20 @@
 #include "knot/include/module.h"
 #include "knot/nameserver/process_query.h" // Dependency on qdata->extra!
 #include "knot/modules/rrl/functions.h"
+#include "knot/modules/rrl/nxdomain.h"
 
 #define MOD_RATE_LIMIT		"\x0A""rate-limit"
 #define MOD_SLIP		"\x04""slip"
 #define MOD_TBL_SIZE		"\x0A""table-size"
 #define MOD_WHITELIST		"\x09""whitelist"
+#define MOD_NXDOMAIN_LIMIT	"\x0E""nxdomain-limit"
 
 const yp_item_t rrl_conf[] = {
 	{ MOD_RATE_LIMIT, YP_TINT, YP_VINT = { 1, INT32_MAX } },
 	{ MOD_SLIP,       YP_TINT, YP_VINT = { 0, 100, 1 } },
 	{ MOD_TBL_SIZE,   YP_TINT, YP_VINT = { 1, INT32_MAX, 393241 } },
 	{ MOD_WHITELIST,  YP_TNET, YP_VNONE, YP_FMULTI },
+	{ MOD_NXDOMAIN_LIMIT, YP_TINT, YP_VINT = { 0, INT32_MAX, 0 } },
 	{ NULL }
 };
 
@@ -44,6 +47,7 @@ int rrl_conf_check(knotd_conf_check_args_t *args)
 
 typedef struct {
 	rrl_table_t *rrl;
+	nxd_table_t *nxd;
 	int slip;
 	knotd_conf_t whitelist;
 } rrl_ctx_t;
@@ -147,10 +151,50 @@ static knotd_state_t ratelimit_apply(knotd_state_t state, knot_pkt_t *pkt,
 	}
 }
 
+static knotd_state_t nxdomain_answer(knotd_state_t state, knot_pkt_t *pkt,
+                                     knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	assert(pkt && qdata && mod);
+
+	if (state == KNOTD_STATE_DONE || state == KNOTD_STATE_FAIL) {
+		return state;
+	}
+
+	rrl_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	int ret = nxd_answer(ctx->nxd, pkt, qdata);
+	switch (ret) {
+	case KNOT_EOK:
+		knotd_mod_stats_incr(mod, qdata->params->thread_id, 2, 0, 1);
+		return KNOTD_STATE_DONE;
+	case KNOT_ENOENT:
+		return state;
+	default:
+		// The packet is incomplete, let the client retry over TCP.
+		qdata->err_truncated = true;
+		return KNOTD_STATE_FAIL;
+	}
+}
+
+static knotd_state_t nxdomain_account(knotd_state_t state, knot_pkt_t *pkt,
+                                      knotd_qdata_t *qdata, knotd_mod_t *mod)
+{
+	assert(pkt && qdata && mod);
+
+	rrl_ctx_t *ctx = knotd_mod_ctx(mod);
+
+	if (state == KNOTD_STATE_DONE) {
+		nxd_account(ctx->nxd, pkt, qdata, mod);
+	}
+
+	return state;
+}
+
 static void ctx_free(rrl_ctx_t *ctx)
 {
 	assert(ctx);
 
+	nxd_destroy(ctx->nxd);
 	rrl_destroy(ctx->rrl);
 	free(ctx);
 }
@@ -166,7 +210,7 @@ int rrl_load(knotd_mod_t *mod)
 	// Create table.
 	uint32_t rate = knotd_conf_mod(mod, MOD_RATE_LIMIT).single.integer;
 	size_t size = knotd_conf_mod(mod, MOD_TBL_SIZE).single.integer;
-	ctx->rrl = rrl_create(size, rate);
+	ctx->rrl = rrl_create(size, rate, knotd_mod_mm(mod));
 	if (ctx->rrl == NULL) {
 		ctx_free(ctx);
 		return KNOT_ENOMEM;
@@ -178,6 +222,16 @@ int rrl_load(knotd_mod_t *mod)
 	// Get whitelist.
 	ctx->whitelist = knotd_conf_mod(mod, MOD_WHITELIST);
 
+	// Create NXDOMAIN accounting if enabled.
+	uint32_t nxd_limit = knotd_conf_mod(mod, MOD_NXDOMAIN_LIMIT).single.integer;
+	if (nxd_limit > 0) {
+		ctx->nxd = nxd_create(nxd_limit);
+		if (ctx->nxd == NULL) {
+			ctx_free(ctx);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	// Set up statistics counters.
 	int ret = knotd_mod_stats_add(mod, "slipped", 1, NULL);
 	if (ret != KNOT_EOK) {
@@ -191,8 +245,19 @@ int rrl_load(knotd_mod_t *mod)
 		return ret;
 	}
 
+	ret = knotd_mod_stats_add(mod, "nxdomain-proofs", 1, NULL);
+	if (ret != KNOT_EOK) {
+		ctx_free(ctx);
+		return ret;
+	}
+
 	knotd_mod_ctx_set(mod, ctx);
 
+	if (ctx->nxd != NULL) {
+		knotd_mod_hook(mod, KNOTD_STAGE_BEGIN, nxdomain_answer);
+		knotd_mod_hook(mod, KNOTD_STAGE_END, nxdomain_account);
+	}
+
 	return knotd_mod_hook(mod, KNOTD_STAGE_END, ratelimit_apply);
 }
 
@@ -14,9 +14,13 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <arpa/inet.h>
+
 #include "contrib/macros.h"
+#include "contrib/string.h"
 #include "contrib/wire_ctx.h"
 #include "knot/include/module.h"
+#include "knot/modules/stats/topk.h"
 #include "knot/nameserver/xfr.h" // Dependency on qdata->extra!
 
 #define MOD_PROTOCOL	"\x10""request-protocol"
@@ -32,6 +36,18 @@
 #define MOD_QTYPE	"\x0A""query-type"
 #define MOD_QSIZE	"\x0A""query-size"
 #define MOD_RSIZE	"\x0A""reply-size"
+#define MOD_ALLOCS	"\x11""query-allocations"
+#define MOD_LATENCY	"\x0D""query-latency"
+#define MOD_LOOKUP_LAT	"\x0E""lookup-latency"
+#define MOD_ANSWER_LAT	"\x0E""answer-latency"
+#define MOD_MODULE_LAT	"\x0E""module-latency"
+#define MOD_COMPACT	"\x07""compact"
+#define MOD_HOT_LIMIT	"\x11""compact-hot-limit"
+#define MOD_TOP_QNAME	"\x09""top-qname"
+#define MOD_TOP_ZONE	"\x08""top-zone"
+#define MOD_TOP_CLIENT	"\x0A""top-client"
+#define MOD_TOP_ERROR	"\x09""top-error"
+#define MOD_TOP_SIZE	"\x08""top-size"
 
 #define OTHER		"other"
 
@@ -49,6 +65,18 @@ const yp_item_t stats_conf[] = {
 	{ MOD_QTYPE,      YP_TBOOL, YP_VNONE },
 	{ MOD_QSIZE,      YP_TBOOL, YP_VNONE },
 	{ MOD_RSIZE,      YP_TBOOL, YP_VNONE },
+	{ MOD_ALLOCS,     YP_TBOOL, YP_VNONE },
+	{ MOD_LATENCY,    YP_TBOOL, YP_VNONE },
+	{ MOD_LOOKUP_LAT, YP_TBOOL, YP_VNONE },
+	{ MOD_ANSWER_LAT, YP_TBOOL, YP_VNONE },
+	{ MOD_MODULE_LAT, YP_TBOOL, YP_VNONE },
+	{ MOD_COMPACT,    YP_TBOOL, YP_VNONE },
+	{ MOD_HOT_LIMIT,  YP_TINT,  YP_VINT = { 0, UINT32_MAX, 100 } },
+	{ MOD_TOP_QNAME,  YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_ZONE,   YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_CLIENT, YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_ERROR,  YP_TBOOL, YP_VNONE },
+	{ MOD_TOP_SIZE,   YP_TINT,  YP_VINT = { 1, TOPK_MAX, 20 } },
 	{ NULL }
 };
 
@@ -66,6 +94,23 @@ enum {
 	CTR_QTYPE,
 	CTR_QSIZE,
 	CTR_RSIZE,
+	CTR_ALLOCS,
+	CTR_LATENCY,
+	CTR_LOOKUP_LAT,
+	CTR_ANSWER_LAT,
+	CTR_MODULE_LAT,
+	CTR_TOP_QNAME,
+	CTR_TOP_ZONE,
+	CTR_TOP_CLIENT,
+	CTR_TOP_ERROR,
+};
+
+enum {
+	TOP_QNAME = 0,
+	TOP_ZONE,
+	TOP_CLIENT,
+	TOP_ERROR,
+	TOP__COUNT
 };
 
 typedef struct {
@@ -82,6 +127,13 @@ typedef struct {
 	bool qtype;
 	bool qsize;
 	bool rsize;
+	bool allocs;
+	bool latency;
+	bool lookup_lat;
+	bool answer_lat;
+	bool module_lat;
+	topk_t *top[TOP__COUNT]; // NULL if disabled.
+	unsigned top_size;
 } stats_t;
 
 typedef struct {
@@ -338,6 +390,73 @@ static char *rsize_to_str(uint32_t idx, uint32_t count)
 	return size_to_str(idx, count);
 }
 
+#define ALLOCS_MAX_IDX	8
+
+static char *allocs_to_str(uint32_t idx, uint32_t count)
+{
+	char str[16];
+
+	// Power of two ranges.
+	int ret;
+	if (idx <= 1) {
+		ret = snprintf(str, sizeof(str), "%u", idx);
+	} else if (idx < count - 1) {
+		ret = snprintf(str, sizeof(str), "%u-%u", 1U << (idx - 1), (1U << idx) - 1);
+	} else {
+		ret = snprintf(str, sizeof(str), "%u+", 1U << (idx - 1));
+	}
+
+	if (ret <= 0 || (size_t)ret >= sizeof(str)) {
+		return NULL;
+	} else {
+		return strdup(str);
+	}
+}
+
+enum {
+	LATENCY_UDP = 0,
+	LATENCY_TCP,
+	LATENCY_XDP,
+	LATENCY__COUNT
+};
+
+#define LATENCY_MAX_IDX	17
+#define LATENCY_BUCKETS	(LATENCY_MAX_IDX + 1)
+
+#define lookup_lat_to_str	latency_to_str
+#define answer_lat_to_str	latency_to_str
+#define module_lat_to_str	latency_to_str
+
+static char *latency_to_str(uint32_t idx, uint32_t count)
+{
+	static const char *protos[] = {
+		[LATENCY_UDP] = "udp",
+		[LATENCY_TCP] = "tcp",
+		[LATENCY_XDP] = "xdp",
+	};
+	const char *proto = protos[idx / LATENCY_BUCKETS];
+	idx %= LATENCY_BUCKETS;
+
+	char str[32];
+
+	// Power of two ranges in microseconds.
+	int ret;
+	if (idx <= 1) {
+		ret = snprintf(str, sizeof(str), "%s:%u", proto, idx);
+	} else if (idx < LATENCY_MAX_IDX) {
+		ret = snprintf(str, sizeof(str), "%s:%u-%u", proto,
+		               1U << (idx - 1), (1U << idx) - 1);
+	} else {
+		ret = snprintf(str, sizeof(str), "%s:%u+", proto, 1U << (idx - 1));
+	}
+
+	if (ret <= 0 || (size_t)ret >= sizeof(str)) {
+		return NULL;
+	} else {
+		return strdup(str);
+	}
+}
+
 static const ctr_desc_t ctr_descs[] = {
 	#define item(macro, name, count) \
 		[CTR_##macro] = { MOD_##macro, offsetof(stats_t, name), (count), name##_to_str }
@@ -354,9 +473,23 @@ static const ctr_desc_t ctr_descs[] = {
 	item(QTYPE,      qtype,      QTYPE__COUNT),
 	item(QSIZE,      qsize,      QSIZE_MAX_IDX + 1),
 	item(RSIZE,      rsize,      RSIZE_MAX_IDX + 1),
+	item(ALLOCS,     allocs,     ALLOCS_MAX_IDX + 1),
+	item(LATENCY,    latency,    LATENCY__COUNT * LATENCY_BUCKETS),
+	item(LOOKUP_LAT, lookup_lat, LATENCY__COUNT * LATENCY_BUCKETS),
+	item(ANSWER_LAT, answer_lat, LATENCY__COUNT * LATENCY_BUCKETS),
+	item(MODULE_LAT, module_lat, LATENCY__COUNT * LATENCY_BUCKETS),
 	{ NULL }
 };
 
+static void incr_latency(knotd_mod_t *mod, unsigned thr_id, unsigned ctr_name,
+                         unsigned proto, uint64_t nsec)
+{
+	uint64_t usec = nsec / 1000;
+	uint64_t idx = (usec == 0) ? 0 : 64 - __builtin_clzll(usec);
+	knotd_mod_stats_incr(mod, thr_id, ctr_name,
+	                     proto * LATENCY_BUCKETS + MIN(idx, LATENCY_MAX_IDX), 1);
+}
+
 static void incr_edns_option(knotd_mod_t *mod, unsigned thr_id, const knot_pkt_t *pkt, unsigned ctr_name)
 {
 	if (!knot_pkt_has_edns(pkt)) {
@@ -380,6 +513,118 @@ static void incr_edns_option(knotd_mod_t *mod, unsigned thr_id, const knot_pkt_t
 	}
 }
 
+#define CLIENT_PREFIX4	3 // /24
+#define CLIENT_PREFIX6	7 // /56
+
+static void top_client(topk_t *top, unsigned thr_id, const struct sockaddr_storage *addr)
+{
+	uint8_t key[1 + CLIENT_PREFIX6];
+	if (addr->ss_family == AF_INET) {
+		key[0] = 4;
+		memcpy(key + 1, &((struct sockaddr_in *)addr)->sin_addr, CLIENT_PREFIX4);
+		topk_add(top, thr_id, key, 1 + CLIENT_PREFIX4);
+	} else if (addr->ss_family == AF_INET6) {
+		key[0] = 6;
+		memcpy(key + 1, &((struct sockaddr_in6 *)addr)->sin6_addr, CLIENT_PREFIX6);
+		topk_add(top, thr_id, key, 1 + CLIENT_PREFIX6);
+	}
+}
+
+static void top_error(topk_t *top, unsigned thr_id, uint16_t rcode_idx,
+                      const knot_dname_t *qname)
+{
+	uint8_t key[sizeof(rcode_idx) + KNOT_DNAME_MAXLEN];
+	size_t len = knot_dname_size(qname);
+	memcpy(key, &rcode_idx, sizeof(rcode_idx));
+	memcpy(key + sizeof(rcode_idx), qname, len);
+	topk_add(top, thr_id, key, sizeof(rcode_idx) + len);
+}
+
+static char *dname_key_to_str(const uint8_t *key, size_t len)
+{
+	if (knot_dname_wire_check(key, key + len, NULL) <= 0) {
+		return NULL;
+	}
+	return knot_dname_to_str_alloc(key);
+}
+
+static char *client_key_to_str(const uint8_t *key, size_t len)
+{
+	uint8_t addr[16] = { 0 };
+	char str[INET6_ADDRSTRLEN + 4];
+
+	if (len == 1 + CLIENT_PREFIX4 && key[0] == 4) {
+		memcpy(addr, key + 1, CLIENT_PREFIX4);
+		if (inet_ntop(AF_INET, addr, str, sizeof(str)) == NULL) {
+			return NULL;
+		}
+	} else if (len == 1 + CLIENT_PREFIX6 && key[0] == 6) {
+		memcpy(addr, key + 1, CLIENT_PREFIX6);
+		if (inet_ntop(AF_INET6, addr, str, sizeof(str)) == NULL) {
+			return NULL;
+		}
+	} else {
+		return NULL;
+	}
+
+	size_t used = strlen(str);
+	(void)snprintf(str + used, sizeof(str) - used, "/%u",
+	               (key[0] == 4) ? CLIENT_PREFIX4 * 8 : CLIENT_PREFIX6 * 8);
+
+	return strdup(str);
+}
+
+static char *error_key_to_str(const uint8_t *key, size_t len)
+{
+	uint16_t rcode_idx;
+	if (len <= sizeof(rcode_idx)) {
+		return NULL;
+	}
+	memcpy(&rcode_idx, key, sizeof(rcode_idx));
+
+	char *rcode = rcode_to_str(rcode_idx, RCODE_OTHER + 1);
+	char *qname = dname_key_to_str(key + sizeof(rcode_idx), len - sizeof(rcode_idx));
+	char *str = NULL;
+	if (rcode != NULL && qname != NULL) {
+		str = sprintf_alloc("%s:%s", rcode, qname);
+	}
+	free(rcode);
+	free(qname);
+
+	return str;
+}
+
+static void top_read(knotd_mod_t *mod, uint32_t ctr_id, uint64_t *vals, char **names)
+{
+	stats_t *stats = knotd_mod_ctx(mod);
+	unsigned top = ctr_id - CTR_TOP_QNAME;
+	assert(top < TOP__COUNT && stats->top[top] != NULL);
+
+	topk_item_t *items = malloc(stats->top_size * sizeof(*items));
+	if (items == NULL) {
+		return;
+	}
+
+	size_t count = topk_read(stats->top[top], items, stats->top_size);
+	for (size_t i = 0; i < count; i++) {
+		switch (top) {
+		case TOP_QNAME:
+		case TOP_ZONE:
+			names[i] = dname_key_to_str(items[i].key, items[i].len);
+			break;
+		case TOP_CLIENT:
+			names[i] = client_key_to_str(items[i].key, items[i].len);
+			break;
+		case TOP_ERROR:
+			names[i] = error_key_to_str(items[i].key, items[i].len);
+			break;
+		}
+		vals[i] = items[i].count;
+	}
+
+	free(items);
+}
+
 static knotd_state_t update_counters(knotd_state_t state, knot_pkt_t *pkt,
                                      knotd_qdata_t *qdata, knotd_mod_t *mod)
 {
@@ -563,11 +808,34 @@ static knotd_state_t update_counters(knotd_state_t state, knot_pkt_t *pkt,
 		incr_edns_option(mod, tid, pkt, CTR_RESP_EOPT);
 	}
 
+	// Track the most active client prefixes.
+	if (stats->top[TOP_CLIENT] != NULL) {
+		top_client(stats->top[TOP_CLIENT], tid, knotd_qdata_remote_addr(qdata));
+	}
+
 	// Return if not query operation.
 	if (operation != OPERATION_QUERY) {
 		return state;
 	}
 
+	// Track the most frequent query names and zones.
+	if (stats->top[TOP_QNAME] != NULL) {
+		const knot_dname_t *qname = knot_pkt_qname(qdata->query);
+		topk_add(stats->top[TOP_QNAME], tid, qname, knot_dname_size(qname));
+	}
+	if (stats->top[TOP_ZONE] != NULL) {
+		const knot_dname_t *zone = knotd_qdata_zone_name(qdata);
+		if (zone != NULL) {
+			topk_add(stats->top[TOP_ZONE], tid, zone, knot_dname_size(zone));
+		}
+	}
+	if (stats->top[TOP_ERROR] != NULL && state != KNOTD_STATE_NOOP &&
+	    rcode != KNOT_RCODE_NOERROR) {
+		uint16_t idx = (qdata->rcode_tsig == KNOT_RCODE_BADSIG) ?
+		               RCODE_BADSIG : MIN(rcode, RCODE_OTHER);
+		top_error(stats->top[TOP_ERROR], tid, idx, knot_pkt_qname(qdata->query));
+	}
+
 	// Count NODATA reply (RFC 2308, Section 2.2).
 	if (stats->nodata && rcode == KNOT_RCODE_NOERROR && state != KNOTD_STATE_NOOP &&
 	    knot_wire_get_ancount(pkt->wire) == 0 && !knot_wire_get_tc(pkt->wire) &&
@@ -613,9 +881,54 @@ static knotd_state_t update_counters(knotd_state_t state, knot_pkt_t *pkt,
 		knotd_mod_stats_incr(mod, tid, CTR_RSIZE, MIN(idx, RSIZE_MAX_IDX), 1);
 	}
 
+	// Count the memory allocations made for the request.
+	if (stats->allocs) {
+		unsigned allocs = knotd_qdata_alloc_count(qdata);
+		uint64_t idx = (allocs == 0) ? 0 : 32 - __builtin_clz(allocs);
+		knotd_mod_stats_incr(mod, tid, CTR_ALLOCS, MIN(idx, ALLOCS_MAX_IDX), 1);
+	}
+
+	// Count the processing durations.
+	if (stats->latency || stats->lookup_lat || stats->answer_lat || stats->module_lat) {
+		unsigned proto;
+		if (qdata->params->xdp_msg != NULL) {
+			proto = LATENCY_XDP;
+		} else if (qdata->params->flags & KNOTD_QUERY_FLAG_LIMIT_SIZE) {
+			proto = LATENCY_UDP;
+		} else {
+			proto = LATENCY_TCP;
+		}
+
+		const knotd_qdata_timing_t *timing = &qdata->timing;
+		if (stats->latency) {
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			uint64_t total = (now.tv_sec - timing->begin.tv_sec) * 1000000000ULL +
+			                 now.tv_nsec - timing->begin.tv_nsec;
+			incr_latency(mod, tid, CTR_LATENCY, proto, total);
+		}
+		if (stats->lookup_lat) {
+			incr_latency(mod, tid, CTR_LOOKUP_LAT, proto, timing->zone_lookup);
+		}
+		if (stats->answer_lat) {
+			incr_latency(mod, tid, CTR_ANSWER_LAT, proto, timing->answer);
+		}
+		if (stats->module_lat) {
+			incr_latency(mod, tid, CTR_MODULE_LAT, proto, timing->modules);
+		}
+	}
+
 	return state;
 }
 
+static void stats_free(stats_t *stats)
+{
+	for (unsigned i = 0; i < TOP__COUNT; i++) {
+		topk_free(stats->top[i]);
+	}
+	free(stats);
+}
+
 int stats_load(knotd_mod_t *mod)
 {
 	stats_t *stats = calloc(1, sizeof(*stats));
@@ -638,6 +951,46 @@ int stats_load(knotd_mod_t *mod)
 		}
 	}
 
+	static const yp_name_t *top_names[] = {
+		[TOP_QNAME]  = MOD_TOP_QNAME,
+		[TOP_ZONE]   = MOD_TOP_ZONE,
+		[TOP_CLIENT] = MOD_TOP_CLIENT,
+		[TOP_ERROR]  = MOD_TOP_ERROR,
+	};
+
+	knotd_conf_t conf = knotd_conf_mod(mod, MOD_TOP_SIZE);
+	stats->top_size = conf.single.integer;
+	for (unsigned i = 0; i < TOP__COUNT; i++) {
+		int ret;
+		conf = knotd_conf_mod(mod, top_names[i]);
+		if (conf.single.boolean) {
+			stats->top[i] = topk_new(knotd_mod_threads(mod), stats->top_size);
+			ret = (stats->top[i] == NULL) ? KNOT_ENOMEM :
+			      knotd_mod_stats_add_read(mod, top_names[i] + 1,
+			                               stats->top_size, top_read);
+		} else {
+			ret = knotd_mod_stats_add(mod, NULL, 1, NULL);
+		}
+		if (ret != KNOT_EOK) {
+			stats_free(stats);
+			return ret;
+		}
+	}
+
+	conf = knotd_conf_mod(mod, MOD_COMPACT);
+	if (conf.single.boolean) {
+		conf = knotd_conf_mod(mod, MOD_HOT_LIMIT);
+		int ret = knotd_mod_stats_compact(mod, conf.single.integer);
+		if (ret != KNOT_EOK) {
+			stats_free(stats);
+			return ret;
+		}
+	}
+
+	if (stats->latency || stats->lookup_lat || stats->answer_lat || stats->module_lat) {
+		knotd_mod_timing_enable(mod);
+	}
+
 	knotd_mod_ctx_set(mod, stats);
 
 	return knotd_mod_hook(mod, KNOTD_STAGE_END, update_counters);
@@ -645,7 +998,7 @@ int stats_load(knotd_mod_t *mod)
 
 void stats_unload(knotd_mod_t *mod)
 {
-	free(knotd_mod_ctx(mod));
+	stats_free(knotd_mod_ctx(mod));
 }
 
 KNOTD_MOD_API(stats, KNOTD_MOD_FLAG_SCOPE_ANY | KNOTD_MOD_FLAG_OPT_CONF,
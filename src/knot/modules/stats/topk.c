@@ -0,0 +1,253 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/modules/stats/topk.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "contrib/macros.h"
+#include "contrib/openbsd/siphash.h"
+
+#ifdef HAVE_ATOMIC
+#define ATOMIC_SET(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_RELAXED)
+#define ATOMIC_GET(src)      __atomic_load_n(&(src), __ATOMIC_RELAXED)
+#define ATOMIC_ACQ(src)      __atomic_load_n(&(src), __ATOMIC_ACQUIRE)
+#define ATOMIC_REL(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_RELEASE)
+#define ATOMIC_FENCE_ACQ()   __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define ATOMIC_FENCE_REL()   __atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define ATOMIC_SET(dst, val) ((dst) = (val))
+#define ATOMIC_GET(src)      (src)
+#define ATOMIC_ACQ(src)      (src)
+#define ATOMIC_REL(dst, val) ((dst) = (val))
+#define ATOMIC_FENCE_ACQ()
+#define ATOMIC_FENCE_REL()
+#endif
+
+#define CM_DEPTH	4
+#define CM_WIDTH	512	// Power of two.
+
+/*! \brief Number of attempts to read a consistent table before skipping it. */
+#define READ_RETRIES	100
+
+/*! \brief Tracked key (the hash and count are kept aside for faster lookup). */
+typedef struct {
+	uint16_t len;
+	uint8_t key[TOPK_KEY_MAXLEN];
+} slot_t;
+
+/*! \brief Sketch of one thread, written only by that thread. */
+typedef struct {
+	uint64_t seq;      // Odd while a slot is being replaced.
+	uint32_t used;     // Number of the used slots.
+	uint32_t min_idx;  // Slot with the lowest count (if all used).
+	uint64_t hash[TOPK_MAX];
+	uint64_t count[TOPK_MAX];
+	uint64_t cm[CM_DEPTH][CM_WIDTH];
+	slot_t slots[];
+} topk_thread_t;
+
+struct topk {
+	SIPHASH_KEY key;
+	unsigned threads;
+	unsigned k;
+	topk_thread_t *thr[];
+};
+
+topk_t *topk_new(unsigned threads, unsigned k)
+{
+	if (threads == 0 || k == 0 || k > TOPK_MAX) {
+		return NULL;
+	}
+
+	topk_t *tk = calloc(1, sizeof(*tk) + threads * sizeof(tk->thr[0]));
+	if (tk == NULL) {
+		return NULL;
+	}
+	tk->threads = threads;
+	tk->k = k;
+
+	if (dnssec_random_buffer((uint8_t *)&tk->key, sizeof(tk->key)) != DNSSEC_EOK) {
+		free(tk);
+		return NULL;
+	}
+
+	return tk;
+}
+
+void topk_free(topk_t *tk)
+{
+	if (tk == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < tk->threads; i++) {
+		free(tk->thr[i]);
+	}
+	free(tk);
+}
+
+static void update_min(topk_thread_t *t)
+{
+	uint32_t min_idx = 0;
+	for (uint32_t i = 1; i < t->used; i++) {
+		if (t->count[i] < t->count[min_idx]) {
+			min_idx = i;
+		}
+	}
+	t->min_idx = min_idx;
+}
+
+void topk_add(topk_t *tk, unsigned thr_id, const uint8_t *key, size_t len)
+{
+	if (tk == NULL || thr_id >= tk->threads) {
+		return;
+	}
+
+	topk_thread_t *t = tk->thr[thr_id];
+	if (unlikely(t == NULL)) {
+		t = calloc(1, sizeof(*t) + tk->k * sizeof(t->slots[0]));
+		if (t == NULL) {
+			return;
+		}
+		ATOMIC_REL(tk->thr[thr_id], t);
+	}
+
+	len = MIN(len, TOPK_KEY_MAXLEN);
+	uint64_t hash = SipHash24(&tk->key, key, len);
+
+	// Count-Min estimate of the key frequency.
+	uint32_t h1 = hash, h2 = (hash >> 32) | 1;
+	uint64_t estimate = UINT64_MAX;
+	for (uint32_t d = 0; d < CM_DEPTH; d++) {
+		uint64_t *cell = &t->cm[d][(h1 + d * h2) & (CM_WIDTH - 1)];
+		*cell += 1;
+		estimate = MIN(estimate, *cell);
+	}
+
+	for (uint32_t i = 0; i < t->used; i++) {
+		if (t->hash[i] == hash) {
+			ATOMIC_SET(t->count[i], t->count[i] + 1);
+			if (i == t->min_idx && t->used == tk->k) {
+				update_min(t);
+			}
+			return;
+		}
+	}
+
+	// Replace the least frequent key if the new one is more frequent.
+	uint32_t idx;
+	if (t->used < tk->k) {
+		idx = t->used;
+	} else if (estimate > t->count[t->min_idx]) {
+		idx = t->min_idx;
+	} else {
+		return;
+	}
+
+	uint64_t seq = ATOMIC_GET(t->seq);
+	ATOMIC_SET(t->seq, seq + 1);
+	ATOMIC_FENCE_REL();
+	t->hash[idx] = hash;
+	t->count[idx] = estimate;
+	t->slots[idx].len = len;
+	memcpy(t->slots[idx].key, key, len);
+	if (idx == t->used) {
+		t->used++;
+	}
+	ATOMIC_REL(t->seq, seq + 2);
+
+	if (t->used == tk->k) {
+		update_min(t);
+	}
+}
+
+/*! \brief Copies the tracked keys of the thread, returns their number. */
+static size_t read_thread(const topk_thread_t *t, topk_item_t *out)
+{
+	for (int retry = 0; retry < READ_RETRIES; retry++) {
+		uint64_t seq = ATOMIC_ACQ(t->seq);
+		if (seq & 1) {
+			continue; // Being updated.
+		}
+		uint32_t used = ATOMIC_GET(t->used);
+		for (uint32_t i = 0; i < used; i++) {
+			out[i].hash = ATOMIC_GET(t->hash[i]);
+			out[i].count = ATOMIC_GET(t->count[i]);
+			out[i].len = ATOMIC_GET(t->slots[i].len);
+			memcpy(out[i].key, t->slots[i].key, MIN(out[i].len, TOPK_KEY_MAXLEN));
+		}
+		ATOMIC_FENCE_ACQ();
+		if (ATOMIC_GET(t->seq) == seq) {
+			return used;
+		}
+	}
+
+	// Unlike the counters, torn keys can't be used.
+	return 0;
+}
+
+static int cmp_hash(const void *a, const void *b)
+{
+	const topk_item_t *x = a, *y = b;
+	return (x->hash > y->hash) - (x->hash < y->hash);
+}
+
+static int cmp_count(const void *a, const void *b)
+{
+	const topk_item_t *x = a, *y = b;
+	return (x->count < y->count) - (x->count > y->count);
+}
+
+size_t topk_read(topk_t *tk, topk_item_t *out, size_t max)
+{
+	if (tk == NULL || out == NULL) {
+		return 0;
+	}
+
+	topk_item_t *all = malloc(tk->threads * tk->k * sizeof(*all));
+	if (all == NULL) {
+		return 0;
+	}
+
+	size_t count = 0;
+	for (unsigned i = 0; i < tk->threads; i++) {
+		topk_thread_t *t = ATOMIC_ACQ(tk->thr[i]);
+		if (t != NULL) {
+			count += read_thread(t, all + count);
+		}
+	}
+
+	// Merge the keys tracked by more threads.
+	qsort(all, count, sizeof(*all), cmp_hash);
+	size_t merged = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (merged > 0 && all[merged - 1].hash == all[i].hash) {
+			all[merged - 1].count += all[i].count;
+		} else if (merged++ != i) {
+			all[merged - 1] = all[i];
+		}
+	}
+
+	qsort(all, merged, sizeof(*all), cmp_count);
+	merged = MIN(merged, max);
+	memcpy(out, all, merged * sizeof(*all));
+	free(all);
+
+	return merged;
+}
@@ -0,0 +1,81 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Approximate heavy hitters (most frequent keys).
+ *
+ * Each thread tracks its top keys (Space-Saving) in its own memory, a key
+ * replaces the least frequent tracked one only if its Count-Min estimate is
+ * higher. The per-thread tables are merged on read.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TOPK_KEY_MAXLEN	258	/*!< Maximum key length (longer keys are truncated). */
+#define TOPK_MAX	256	/*!< Maximum number of the tracked keys. */
+
+/*! \brief Tracked key and its estimated count. */
+typedef struct {
+	uint64_t hash;
+	uint64_t count;
+	uint16_t len;
+	uint8_t key[TOPK_KEY_MAXLEN];
+} topk_item_t;
+
+typedef struct topk topk_t;
+
+/*!
+ * \brief Creates a sketch.
+ *
+ * \note The per-thread memory is allocated on the first use by the thread.
+ *
+ * \param threads  Number of the updating threads.
+ * \param k        Number of the tracked keys per thread (up to TOPK_MAX).
+ *
+ * \return Sketch or NULL if error.
+ */
+topk_t *topk_new(unsigned threads, unsigned k);
+
+/*!
+ * \brief Frees the sketch.
+ */
+void topk_free(topk_t *tk);
+
+/*!
+ * \brief Counts an occurrence of the key.
+ *
+ * \note Only the given thread may call this function with its index.
+ *
+ * \param tk      Sketch.
+ * \param thr_id  Index of the calling thread.
+ * \param key     Key.
+ * \param len     Key length.
+ */
+void topk_add(topk_t *tk, unsigned thr_id, const uint8_t *key, size_t len);
+
+/*!
+ * \brief Reads the merged top keys.
+ *
+ * \param tk   Sketch.
+ * \param out  Output array of the keys ordered by decreasing count.
+ * \param max  Size of the output array.
+ *
+ * \return Number of the output keys.
+ */
+size_t topk_read(topk_t *tk, topk_item_t *out, size_t max);
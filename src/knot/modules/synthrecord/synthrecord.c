@@ -107,49 +107,34 @@ int synth_record_conf_check(knotd_conf_check_args_t *args)
 #define IPV4_ARPA_LEN		14
 #define IPV6_ARPA_LEN		10
 
+/*! \brief Sorted disjoint address ranges of one address family. */
+typedef struct {
+	struct {
+		uint8_t min[sizeof(struct in6_addr)];
+		uint8_t max[sizeof(struct in6_addr)];
+	} *ranges;
+	size_t count;
+	size_t addr_len;
+} synth_index_t;
+
 /*!
  * \brief Synthetic response template.
  */
-typedef struct {
-	struct sockaddr_storage addr;
-	struct sockaddr_storage addr_max;
-	int addr_mask;
-} synth_templ_addr_t;
-
 typedef struct {
 	enum synth_template_type type;
 	char *prefix;
 	size_t prefix_len;
-	char *zone;
-	size_t zone_len;
+	knot_dname_t *zone;
 	uint32_t ttl;
-	size_t addr_count;
-	synth_templ_addr_t *addr;
+	synth_index_t index4;
+	synth_index_t index6;
 	bool reverse_short;
 } synth_template_t;
 
-typedef union {
-	uint32_t b32;
-	uint8_t b4[4];
-} addr_block_t;
-
-/*! \brief Write one IPV4 address block without redundant leading zeros. */
-static unsigned block_write(addr_block_t *block, char *addr_str)
+/*! \brief Separator character for address family. */
+static char str_separator(int addr_family)
 {
-	unsigned len = 0;
-
-	if (block->b4[0] != '0') {
-		addr_str[len++] = block->b4[0];
-	}
-	if (len > 0 || block->b4[1] != '0') {
-		addr_str[len++] = block->b4[1];
-	}
-	if (len > 0 || block->b4[2] != '0') {
-		addr_str[len++] = block->b4[2];
-	}
-	addr_str[len++] = block->b4[3];
-
-	return len;
+	return (addr_family == AF_INET6) ? ':' : '.';
 }
 
 /*! \brief Substitute all occurrences of given character. */
@@ -162,12 +147,6 @@ static void str_subst(char *str, size_t len, char from, char to)
 	}
 }
 
-/*! \brief Separator character for address family. */
-static char str_separator(int addr_family)
-{
-	return (addr_family == AF_INET6) ? ':' : '.';
-}
-
 /*! \brief Return true if query type is satisfied with provided address family. */
 static bool query_satisfied_by_family(uint16_t qtype, int family)
 {
@@ -179,23 +158,52 @@ static bool query_satisfied_by_family(uint16_t qtype, int family)
 	}
 }
 
-/*! \brief Parse address from reverse query QNAME and return address family. */
-static int reverse_addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl,
-                              char *addr_str, int *addr_family, bool *parent)
+/*! \brief Parse decimal IPv4 address block, as inet_pton() does. */
+static int ipv4_block_parse(const uint8_t *label, uint8_t *out)
+{
+	unsigned val = 0;
+	for (int i = 1; i <= *label; i++) {
+		if (!is_digit(label[i]) || (i > 1 && val == 0)) {
+			return KNOT_EINVAL;
+		}
+		val = val * 10 + label[i] - '0';
+	}
+	if (val > UINT8_MAX) {
+		return KNOT_EINVAL;
+	}
+
+	*out = val;
+	return KNOT_EOK;
+}
+
+/*! \brief Parse one hexadecimal IPv6 address nibble. */
+static int ipv6_nibble_parse(const uint8_t *label, uint8_t *out)
+{
+	uint8_t c = label[1];
+	if (*label != 1 || !is_xdigit(c)) {
+		return KNOT_EINVAL;
+	}
+
+	*out = is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+	return KNOT_EOK;
+}
+
+/*! \brief Parse address from reverse query QNAME. */
+static int reverse_addr_parse(knotd_qdata_t *qdata, struct sockaddr_storage *addr,
+                              bool *parent)
 {
 	/* QNAME required format is [address].[subnet/zone]
 	 * f.e.  [1.0...0].[h.g.f.e.0.0.0.0.d.c.b.a.ip6.arpa] represents
 	 *       [abcd:0:efgh::1] */
 	const knot_dname_t *label = qdata->name; // uncompressed name
 
-	static const char ipv4_zero[] = "0.0.0.0";
-
 	bool can_ipv4 = true;
 	bool can_ipv6 = true;
 	unsigned labels = 0;
 
-	uint8_t buf4[16], *buf4_end = buf4 + sizeof(buf4), *buf4_pos = buf4_end;
-	uint8_t buf6[32], *buf6_end = buf6 + sizeof(buf6), *buf6_pos = buf6_end;
+	// The labels hold the address blocks in the reverse order.
+	uint8_t blocks4[IPV4_ADDR_LABELS];
+	uint8_t nibbles[IPV6_ADDR_LABELS];
 
 	for ( ; labels < IPV6_ADDR_LABELS; labels++) {
 		if (unlikely(*label == 0)) {
@@ -204,119 +212,137 @@ static int reverse_addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl,
 		if (label[1] == 'i') {
 			break;
 		}
-		if (labels < IPV4_ADDR_LABELS) {
-			switch (*label) {
-			case 1:
-				assert(buf4 + 1 < buf4_pos && buf6 < buf6_pos);
-				*--buf6_pos = label[1];
-				*--buf4_pos = label[1];
-				*--buf4_pos = '.';
-				break;
-			case 2:
-			case 3:
-				assert(buf4 + *label < buf4_pos);
-				can_ipv6 = false;
-				buf4_pos -= *label;
-				memcpy(buf4_pos, label + 1, *label);
-				*--buf4_pos = '.';
-				break;
-			default:
-				return KNOT_EINVAL;
-			}
-		} else {
+		if (labels >= IPV4_ADDR_LABELS || *label > 3 ||
+		    ipv4_block_parse(label, &blocks4[labels]) != KNOT_EOK) {
 			can_ipv4 = false;
-			if (!can_ipv6 || *label != 1) {
-				return KNOT_EINVAL;
-			}
-			assert(buf6 < buf6_pos);
-			*--buf6_pos = label[1];
-
+		}
+		if (ipv6_nibble_parse(label, &nibbles[labels]) != KNOT_EOK) {
+			can_ipv6 = false;
+		}
+		if (!can_ipv4 && !can_ipv6) {
+			return KNOT_EINVAL;
 		}
 		label += *label + sizeof(*label);
 	}
 
 	if (can_ipv4 && knot_dname_is_equal(label, IPV4_ARPA_DNAME)) {
-		*addr_family = AF_INET;
 		*parent = (labels < IPV4_ADDR_LABELS);
-		int buf4_overweight = (buf4_end - buf4_pos) - (2 * labels);
-		assert(buf4_overweight >= 0);
-		memcpy(addr_str + buf4_overweight, ipv4_zero, sizeof(ipv4_zero));
-		if (labels > 0) {
-			buf4_pos++; // skip leading '.'
-			memcpy(addr_str, buf4_pos, buf4_end - buf4_pos);
+		uint8_t raw[IPV4_ADDR_LABELS] = { 0 };
+		for (unsigned i = 0; i < labels; i++) {
+			raw[i] = blocks4[labels - 1 - i];
 		}
-		return KNOT_EOK;
+		return sockaddr_set_raw(addr, AF_INET, raw, sizeof(raw));
 	} else if (can_ipv6 && knot_dname_is_equal(label, IPV6_ARPA_DNAME)) {
-		*addr_family = AF_INET6;
 		*parent = (labels < IPV6_ADDR_LABELS);
+		uint8_t raw[IPV6_ADDR_LABELS / 2] = { 0 };
+		for (unsigned i = 0; i < labels; i++) {
+			uint8_t nibble = nibbles[labels - 1 - i];
+			raw[i / 2] |= (i % 2 == 0) ? nibble << 4 : nibble;
+		}
+		return sockaddr_set_raw(addr, AF_INET6, raw, sizeof(raw));
+	}
 
-		addr_block_t blocks[8] = { { 0 } };
-		int compr_start = -1, compr_end = -1;
-
-		unsigned buf6_len = buf6_end - buf6_pos;
-		memcpy(blocks, buf6_pos, buf6_len);
-		memset(((uint8_t *)blocks) + buf6_len, 0x30, sizeof(blocks) - buf6_len);
-
-		for (int i = 0; i < 8; i++) {
-			addr_block_t *block = &blocks[i];
-
-			/* The Unicode string MUST NOT contain "--" in the third and fourth
-			   character positions and MUST NOT start or end with a "-".
-			   So we will not compress first, second, and last address blocks
-			   for simplicity. And we will not compress a single block.
-
-			   i:             0 1 2 3 4 5 6 7
-			   label block:   H:G:F:E:D:C:B:A
-			   address block: A B C D E F G H
-			   compressibles:     0 0 0 0 0
-			                      0 0 0 0
-			                      0 0 0
-			                      0 0
-			 */
-			// Check for trailing zero dual-blocks.
-			if (tpl->reverse_short && i > 1 && i < 6 &&
-			    block[0].b32 == 0x30303030UL && block[1].b32 == 0x30303030UL) {
-				if (compr_start == -1) {
-					compr_start = i;
-				}
-			} else {
-				if (compr_start != -1 && compr_end == -1) {
-					compr_end = i;
-				}
-			}
+	return KNOT_EINVAL;
+}
+
+/*! \brief Write decimal number without leading zeros. */
+static unsigned dec_write(char *out, uint8_t val)
+{
+	unsigned len = 0;
+	if (val >= 100) {
+		out[len++] = '0' + val / 100;
+	}
+	if (val >= 10) {
+		out[len++] = '0' + (val / 10) % 10;
+	}
+	out[len++] = '0' + val % 10;
+
+	return len;
+}
+
+/*! \brief Write hexadecimal number, optionally without leading zeros. */
+static unsigned hex_write(char *out, uint16_t val, bool shorten)
+{
+	static const char digits[] = "0123456789abcdef";
+
+	unsigned len = 0;
+	for (int shift = 12; shift >= 0; shift -= 4) {
+		unsigned nibble = (val >> shift) & 0xf;
+		if (len > 0 || nibble != 0 || !shorten || shift == 0) {
+			out[len++] = digits[nibble];
 		}
+	}
+
+	return len;
+}
 
-		// Write address blocks.
-		unsigned addr_len = 0;
-		for (int i = 0; i < 8; i++) {
-			if (compr_start == -1 || i < compr_start || i > compr_end) {
-				// Write regular address block.
-				if (tpl->reverse_short) {
-					addr_len += block_write(&blocks[i], addr_str + addr_len);
-				} else {
-					assert(sizeof(blocks[i]) == 4);
-					memcpy(addr_str + addr_len, &blocks[i], 4);
-					addr_len += 4;
-				}
-				// Write separator
-				if (i < 7) {
-					addr_str[addr_len++] = ':';
-				}
-			} else if (compr_start != -1 && compr_end == i) {
-				// Write compression double colon.
-				addr_str[addr_len++] = ':';
+/*! \brief Write the address as a part of a label, the blocks separated by '-'. */
+static unsigned addr_label_write(char *out, const struct sockaddr_storage *addr,
+                                 bool reverse_short)
+{
+	unsigned len = 0;
+
+	if (addr->ss_family == AF_INET) {
+		const uint8_t *raw = (const uint8_t *)&((struct sockaddr_in *)addr)->sin_addr;
+		for (int i = 0; i < 4; i++) {
+			len += dec_write(out + len, raw[i]);
+			if (i < 3) {
+				out[len++] = '-';
 			}
 		}
-		addr_str[addr_len] = '\0';
+		return len;
+	}
+
+	const uint8_t *raw = (const uint8_t *)&((struct sockaddr_in6 *)addr)->sin6_addr;
+	uint16_t blocks[8];
+	for (int i = 0; i < 8; i++) {
+		blocks[i] = (raw[2 * i] << 8) | raw[2 * i + 1];
+	}
+
+	/* The Unicode string MUST NOT contain "--" in the third and fourth
+	   character positions and MUST NOT start or end with a "-".
+	   So we will not compress first, second, and last address blocks
+	   for simplicity. And we will not compress a single block.
+
+	   i:             0 1 2 3 4 5 6 7
+	   address block: A B C D E F G H
+	   compressibles:     0 0 0 0 0
+	                      0 0 0 0
+	                      0 0 0
+	                      0 0
+	 */
+	int compr_start = -1, compr_end = -1;
+	if (reverse_short) {
+		for (int i = 2; i < 6; i++) {
+			if (blocks[i] == 0 && blocks[i + 1] == 0) {
+				compr_start = i;
+				break;
+			}
+		}
+		if (compr_start != -1) {
+			compr_end = compr_start + 1;
+			while (compr_end < 6 && blocks[compr_end + 1] == 0) {
+				compr_end++;
+			}
+		}
+	}
 
-		return KNOT_EOK;
+	for (int i = 0; i < 8; i++) {
+		if (compr_start == -1 || i < compr_start || i > compr_end) {
+			len += hex_write(out + len, blocks[i], reverse_short);
+			if (i < 7) {
+				out[len++] = '-';
+			}
+		} else if (compr_end == i) {
+			out[len++] = '-';
+		}
 	}
 
-	return KNOT_EINVAL;
+	return len;
 }
 
 static int forward_addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl,
-                              char *addr_str, int *addr_family)
+                              struct sockaddr_storage *addr)
 {
 	const knot_dname_t *label = qdata->name;
 
@@ -327,6 +353,7 @@ static int forward_addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl,
 	}
 
 	// Copy address part.
+	char addr_str[KNOT_DNAME_MAXLABELLEN + 1];
 	unsigned addr_len = label[0] - tpl->prefix_len;
 	memcpy(addr_str, label + 1 + tpl->prefix_len, addr_len);
 	addr_str[addr_len] = '\0';
@@ -345,56 +372,55 @@ static int forward_addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl,
 		ch++;
 	}
 	// Valid IPv4 address looks like A-B-C-D.
-	*addr_family = (hyphen_cnt == 3) ? AF_INET : AF_INET6;
+	int addr_family = (hyphen_cnt == 3) ? AF_INET : AF_INET6;
 
 	// Restore correct address format.
-	const char sep = str_separator(*addr_family);
+	const char sep = str_separator(addr_family);
 	str_subst(addr_str, addr_len, '-', sep);
 
-	return KNOT_EOK;
+	return sockaddr_set(addr, addr_family, addr_str, 0);
 }
 
-static int addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl, char *addr_str,
-                      int *addr_family, bool *parent)
+static int addr_parse(knotd_qdata_t *qdata, const synth_template_t *tpl,
+                      struct sockaddr_storage *addr, bool *parent)
 {
 	switch (tpl->type) {
-	case SYNTH_REVERSE: return reverse_addr_parse(qdata, tpl, addr_str, addr_family, parent);
-	case SYNTH_FORWARD: return forward_addr_parse(qdata, tpl, addr_str, addr_family);
+	case SYNTH_REVERSE: return reverse_addr_parse(qdata, addr, parent);
+	case SYNTH_FORWARD: return forward_addr_parse(qdata, tpl, addr);
 	default:            return KNOT_EINVAL;
 	}
 }
 
-static knot_dname_t *synth_ptrname(uint8_t *out, const char *addr_str,
-                                   const synth_template_t *tpl, int addr_family)
+static knot_dname_t *synth_ptrname(uint8_t *out, const struct sockaddr_storage *addr,
+                                   const synth_template_t *tpl)
 {
-	knot_dname_txt_storage_t ptrname;
-	int addr_len = strlen(addr_str);
-	const char sep = str_separator(addr_family);
-
-	// PTR right-hand value is [prefix][address][zone]
-	wire_ctx_t ctx = wire_ctx_init((uint8_t *)ptrname, sizeof(ptrname));
-	wire_ctx_write(&ctx, tpl->prefix, tpl->prefix_len);
-	wire_ctx_write(&ctx, addr_str, addr_len);
-	wire_ctx_write_u8(&ctx, '.');
-	wire_ctx_write(&ctx, tpl->zone, tpl->zone_len);
-	wire_ctx_write_u8(&ctx, '\0');
-	if (ctx.error != KNOT_EOK) {
+	// PTR right-hand value is [prefix][address].[zone]
+	char label[SOCKADDR_STRLEN];
+	unsigned addr_len = addr_label_write(label, addr, tpl->reverse_short);
+
+	size_t label_len = tpl->prefix_len + addr_len;
+	size_t zone_size = knot_dname_size(tpl->zone);
+	if (label_len > KNOT_DNAME_MAXLABELLEN ||
+	    1 + label_len + zone_size > KNOT_DNAME_MAXLEN) {
 		return NULL;
 	}
 
-	// Substitute address separator by '-'.
-	str_subst(ptrname + tpl->prefix_len, addr_len, sep, '-');
+	wire_ctx_t ctx = wire_ctx_init(out, KNOT_DNAME_MAXLEN);
+	wire_ctx_write_u8(&ctx, label_len);
+	wire_ctx_write(&ctx, tpl->prefix, tpl->prefix_len);
+	wire_ctx_write(&ctx, label, addr_len);
+	wire_ctx_write(&ctx, tpl->zone, zone_size);
+	assert(ctx.error == KNOT_EOK);
 
-	// Convert to domain name.
-	return knot_dname_from_str(out, ptrname, KNOT_DNAME_MAXLEN);
+	return out;
 }
 
-static int reverse_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *pkt,
-                      knot_rrset_t *rr, int addr_family)
+static int reverse_rr(const struct sockaddr_storage *addr, const synth_template_t *tpl,
+                      knot_pkt_t *pkt, knot_rrset_t *rr)
 {
 	// Synthesize PTR record data.
 	knot_dname_storage_t ptrname;
-	if (synth_ptrname(ptrname, addr_str, tpl, addr_family) == NULL) {
+	if (synth_ptrname(ptrname, addr, tpl) == NULL) {
 		return KNOT_EINVAL;
 	}
 
@@ -404,21 +430,18 @@ static int reverse_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *p
 	return KNOT_EOK;
 }
 
-static int forward_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *pkt,
-                      knot_rrset_t *rr, int addr_family)
+static int forward_rr(const struct sockaddr_storage *addr, const synth_template_t *tpl,
+                      knot_pkt_t *pkt, knot_rrset_t *rr)
 {
-	struct sockaddr_storage query_addr;
-	sockaddr_set(&query_addr, addr_family, addr_str, 0);
-
 	// Specify address type and data.
-	if (addr_family == AF_INET6) {
+	if (addr->ss_family == AF_INET6) {
 		rr->type = KNOT_RRTYPE_AAAA;
-		const struct sockaddr_in6* ip = (const struct sockaddr_in6*)&query_addr;
+		const struct sockaddr_in6* ip = (const struct sockaddr_in6*)addr;
 		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin6_addr,
 		                     sizeof(struct in6_addr), &pkt->mm);
-	} else if (addr_family == AF_INET) {
+	} else if (addr->ss_family == AF_INET) {
 		rr->type = KNOT_RRTYPE_A;
-		const struct sockaddr_in* ip = (const struct sockaddr_in*)&query_addr;
+		const struct sockaddr_in* ip = (const struct sockaddr_in*)addr;
 		knot_rrset_add_rdata(rr, (const uint8_t *)&ip->sin_addr,
 		                     sizeof(struct in_addr), &pkt->mm);
 	} else {
@@ -428,8 +451,8 @@ static int forward_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *p
 	return KNOT_EOK;
 }
 
-static knot_rrset_t *synth_rr(char *addr_str, const synth_template_t *tpl, knot_pkt_t *pkt,
-                              knotd_qdata_t *qdata, int addr_family)
+static knot_rrset_t *synth_rr(const struct sockaddr_storage *addr, const synth_template_t *tpl,
+                              knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	knot_rrset_t *rr = knot_rrset_new(qdata->name, 0, KNOT_CLASS_IN, tpl->ttl,
 	                                  &pkt->mm);
@@ -440,8 +463,8 @@ static knot_rrset_t *synth_rr(char *addr_str, const synth_template_t *tpl, knot_
 	// Fill in the specific data.
 	int ret = KNOT_ERROR;
 	switch (tpl->type) {
-	case SYNTH_REVERSE: ret = reverse_rr(addr_str, tpl, pkt, rr, addr_family); break;
-	case SYNTH_FORWARD: ret = forward_rr(addr_str, tpl, pkt, rr, addr_family); break;
+	case SYNTH_REVERSE: ret = reverse_rr(addr, tpl, pkt, rr); break;
+	case SYNTH_FORWARD: ret = forward_rr(addr, tpl, pkt, rr); break;
 	default: break;
 	}
 
@@ -453,38 +476,45 @@ static knot_rrset_t *synth_rr(char *addr_str, const synth_template_t *tpl, knot_
 	return rr;
 }
 
+/*! \brief Check if the address is in one of the template networks. */
+static bool index_match(const synth_index_t *index, const struct sockaddr_storage *addr)
+{
+	size_t addr_len = 0;
+	const uint8_t *raw = sockaddr_raw(addr, &addr_len);
+	if (raw == NULL || addr_len != index->addr_len) {
+		return false;
+	}
+
+	// Find the last range starting not above the address.
+	size_t lo = 0, hi = index->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (memcmp(index->ranges[mid].min, raw, addr_len) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo > 0 && memcmp(raw, index->ranges[lo - 1].max, addr_len) <= 0;
+}
+
 /*! \brief Check if query fits the template requirements. */
 static knotd_in_state_t template_match(knotd_in_state_t state, const synth_template_t *tpl,
                                        knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
-	int provided_af = AF_UNSPEC;
 	struct sockaddr_storage query_addr;
-	char addr_str[SOCKADDR_STRLEN];
-	assert(SOCKADDR_STRLEN > KNOT_DNAME_MAXLABELLEN);
 	bool parent = false; // querying empty-non-terminal being (possibly indirect) parent of synthesized name
 
 	// Parse address from query name.
-	if (addr_parse(qdata, tpl, addr_str, &provided_af, &parent) != KNOT_EOK ||
-	    sockaddr_set(&query_addr, provided_af, addr_str, 0) != KNOT_EOK) {
+	if (addr_parse(qdata, tpl, &query_addr, &parent) != KNOT_EOK) {
 		return state;
 	}
 
-	// Try all available addresses.
-	int i;
-	for (i = 0; i < tpl->addr_count; i++) {
-		if (tpl->addr[i].addr_max.ss_family == AF_UNSPEC) {
-			if (sockaddr_net_match(&query_addr, &tpl->addr[i].addr,
-			                       tpl->addr[i].addr_mask)) {
-				break;
-			}
-		} else {
-			if (sockaddr_range_match(&query_addr, &tpl->addr[i].addr,
-			                         &tpl->addr[i].addr_max)) {
-				break;
-			}
-		}
-	}
-	if (i >= tpl->addr_count) {
+	// Look up the template networks.
+	const synth_index_t *index = (query_addr.ss_family == AF_INET6) ?
+	                             &tpl->index6 : &tpl->index4;
+	if (!index_match(index, &query_addr)) {
 		return state;
 	}
 
@@ -493,7 +523,7 @@ static knotd_in_state_t template_match(knotd_in_state_t state, const synth_templ
 	switch (tpl->type) {
 	case SYNTH_FORWARD:
 		assert(!parent);
-		if (!query_satisfied_by_family(qtype, provided_af)) {
+		if (!query_satisfied_by_family(qtype, query_addr.ss_family)) {
 			qdata->rcode = KNOT_RCODE_NOERROR;
 			return KNOTD_IN_STATE_NODATA;
 		}
@@ -509,7 +539,7 @@ static knotd_in_state_t template_match(knotd_in_state_t state, const synth_templ
 	}
 
 	// Synthesize record from template.
-	knot_rrset_t *rr = synth_rr(addr_str, tpl, pkt, qdata, provided_af);
+	knot_rrset_t *rr = synth_rr(&query_addr, tpl, pkt, qdata);
 	if (rr == NULL) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return KNOTD_IN_STATE_ERROR;
@@ -540,6 +570,92 @@ static knotd_in_state_t solve_synth_record(knotd_in_state_t state, knot_pkt_t *p
 	return template_match(state, knotd_mod_ctx(mod), pkt, qdata);
 }
 
+static int range_cmp(const void *a, const void *b)
+{
+	// The unused tail of IPv4 addresses is zero.
+	return memcmp(a, b, sizeof(struct in6_addr));
+}
+
+/*! \brief Sort the network ranges and merge the overlapping ones. */
+static void index_sort(synth_index_t *index)
+{
+	if (index->count == 0) {
+		return;
+	}
+
+	qsort(index->ranges, index->count, sizeof(*index->ranges), range_cmp);
+
+	size_t len = index->addr_len;
+	size_t last = 0;
+	for (size_t i = 1; i < index->count; i++) {
+		if (memcmp(index->ranges[i].min, index->ranges[last].max, len) <= 0) {
+			if (memcmp(index->ranges[i].max, index->ranges[last].max, len) > 0) {
+				memcpy(index->ranges[last].max, index->ranges[i].max, len);
+			}
+		} else {
+			index->ranges[++last] = index->ranges[i];
+		}
+	}
+	index->count = last + 1;
+}
+
+/*! \brief Add the network or range to the index of its address family. */
+static void index_add(synth_template_t *tpl, const knotd_conf_val_t *net)
+{
+	synth_index_t *index = (net->addr.ss_family == AF_INET6) ?
+	                       &tpl->index6 : &tpl->index4;
+
+	size_t len = 0;
+	const uint8_t *raw = sockaddr_raw(&net->addr, &len);
+	if (raw == NULL || len != index->addr_len) {
+		return;
+	}
+	uint8_t *min = index->ranges[index->count].min;
+	uint8_t *max = index->ranges[index->count].max;
+
+	if (net->addr_max.ss_family == AF_UNSPEC) {
+		unsigned prefix = MIN(net->addr_mask, len * 8);
+		for (size_t i = 0; i < len; i++) {
+			unsigned bits = (prefix > 8 * i) ? MIN(prefix - 8 * i, 8) : 0;
+			uint8_t mask = (bits == 0) ? 0 : (0xff << (8 - bits));
+			min[i] = raw[i] & mask;
+			max[i] = raw[i] | ~mask;
+		}
+	} else {
+		size_t max_len = 0;
+		const uint8_t *raw_max = sockaddr_raw(&net->addr_max, &max_len);
+		if (raw_max == NULL || max_len != len || memcmp(raw, raw_max, len) > 0) {
+			return;
+		}
+		memcpy(min, raw, len);
+		memcpy(max, raw_max, len);
+	}
+	index->count++;
+}
+
+static int index_init(synth_template_t *tpl, const knotd_conf_t *conf)
+{
+	tpl->index4.addr_len = sizeof(struct in_addr);
+	tpl->index6.addr_len = sizeof(struct in6_addr);
+
+	// Allocated for all the networks, the unused part stays empty.
+	tpl->index4.ranges = calloc(conf->count, sizeof(*tpl->index4.ranges));
+	tpl->index6.ranges = calloc(conf->count, sizeof(*tpl->index6.ranges));
+	if (tpl->index4.ranges == NULL || tpl->index6.ranges == NULL) {
+		free(tpl->index4.ranges);
+		free(tpl->index6.ranges);
+		return KNOT_ENOMEM;
+	}
+
+	for (size_t i = 0; i < conf->count; i++) {
+		index_add(tpl, &conf->multi[i]);
+	}
+	index_sort(&tpl->index4);
+	index_sort(&tpl->index6);
+
+	return KNOT_EOK;
+}
+
 int synth_record_load(knotd_mod_t *mod)
 {
 	// Create synthesis template.
@@ -560,13 +676,12 @@ int synth_record_load(knotd_mod_t *mod)
 	// Set origin if generating reverse record.
 	if (tpl->type == SYNTH_REVERSE) {
 		conf = knotd_conf_mod(mod, MOD_ORIGIN);
-		tpl->zone = knot_dname_to_str_alloc(conf.single.dname);
+		tpl->zone = knot_dname_copy(conf.single.dname, NULL);
 		if (tpl->zone == NULL) {
 			free(tpl->prefix);
 			free(tpl);
 			return KNOT_ENOMEM;
 		}
-		tpl->zone_len = strlen(tpl->zone);
 	}
 
 	// Set ttl.
@@ -575,21 +690,14 @@ int synth_record_load(knotd_mod_t *mod)
 
 	// Set address.
 	conf = knotd_conf_mod(mod, MOD_NET);
-	tpl->addr_count = conf.count;
-	tpl->addr = calloc(conf.count, sizeof(*tpl->addr));
-	if (tpl->addr == NULL) {
-		knotd_conf_free(&conf);
+	int ret = index_init(tpl, &conf);
+	knotd_conf_free(&conf);
+	if (ret != KNOT_EOK) {
 		free(tpl->zone);
 		free(tpl->prefix);
 		free(tpl);
-		return KNOT_ENOMEM;
+		return ret;
 	}
-	for (size_t i = 0; i < conf.count; i++) {
-		tpl->addr[i].addr = conf.multi[i].addr;
-		tpl->addr[i].addr_max = conf.multi[i].addr_max;
-		tpl->addr[i].addr_mask = conf.multi[i].addr_mask;
-	}
-	knotd_conf_free(&conf);
 
 	// Set address shortening.
 	if (tpl->type == SYNTH_REVERSE) {
@@ -606,7 +714,8 @@ void synth_record_unload(knotd_mod_t *mod)
 {
 	synth_template_t *tpl = knotd_mod_ctx(mod);
 
-	free(tpl->addr);
+	free(tpl->index4.ranges);
+	free(tpl->index6.ranges);
 	free(tpl->zone);
 	free(tpl->prefix);
 	free(tpl);
@@ -101,6 +101,7 @@ static void axfr_query_cleanup(knotd_qdata_t *qdata)
 
 	zone_tree_it_free(&axfr->it);
 	ptrlist_free(&axfr->proc.nodes, qdata->mm);
+	xfr_cache_release(&axfr->proc);
 	mm_free(qdata->mm, axfr);
 
 	/* Allow zone changes (finished). */
@@ -116,7 +117,7 @@ static int axfr_query_check(knotd_qdata_t *qdata)
 	return KNOT_STATE_DONE;
 }
 
-static int axfr_query_init(knotd_qdata_t *qdata)
+static int axfr_query_init(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	assert(qdata);
 
@@ -149,10 +150,13 @@ static int axfr_query_init(knotd_qdata_t *qdata)
 	const zone_contents_t *contents = qdata->extra->contents;
 	/* Must be non-NULL for the first message. */
 	assert(contents);
-	ptrlist_add(&axfr->proc.nodes, contents->nodes, mm);
-	/* Put NSEC3 data if exists. */
-	if (!zone_tree_is_empty(contents->nsec3_nodes)) {
-		ptrlist_add(&axfr->proc.nodes, contents->nsec3_nodes, mm);
+	if (!xfr_cache_lookup(&axfr->proc, pkt, qdata, true, 0)) {
+		ptrlist_add(&axfr->proc.nodes, contents->nodes, mm);
+		/* Put NSEC3 data if exists. */
+		if (!zone_tree_is_empty(contents->nsec3_nodes)) {
+			ptrlist_add(&axfr->proc.nodes, contents->nsec3_nodes, mm);
+		}
+		xfr_cache_render(&axfr->proc, pkt, qdata, true, 0);
 	}
 
 	/* Set up cleanup callback. */
@@ -180,12 +184,13 @@ int axfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	/* Initialize on first call. */
 	struct axfr_proc *axfr = qdata->extra->ext;
 	if (axfr == NULL) {
-		int ret = axfr_query_init(qdata);
+		int ret = axfr_query_init(pkt, qdata);
 		axfr = qdata->extra->ext;
 		switch (ret) {
 		case KNOT_EOK:      /* OK */
-			AXFROUT_LOG(LOG_INFO, qdata, "started, serial %u",
-			            zone_contents_serial(qdata->extra->contents));
+			AXFROUT_LOG(LOG_INFO, qdata, "started, serial %u%s",
+			            zone_contents_serial(qdata->extra->contents),
+			            axfr->proc.cached != NULL ? ", cached" : "");
 			break;
 		case KNOT_EDENIED:  /* Not authorized, already logged. */
 			return KNOT_STATE_FAIL;
@@ -20,6 +20,7 @@
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/query_module.h"
+#include "knot/zone/referral-cache.h"
 #include "knot/zone/serial.h"
 #include "contrib/mempattern.h"
 
@@ -120,6 +121,23 @@ static bool have_dnssec(knotd_qdata_t *qdata)
 	       qdata->extra->contents->dnssec;
 }
 
+/*!
+ * \brief Fails like knot_pkt_put() if the RRSet certainly doesn't fit.
+ *
+ * Big RRSets over small buffers are refused without rendering them,
+ * using the wire size lower bound computed when adjusting the zone.
+ */
+static int check_space(knot_pkt_t *pkt, size_t wire_min, uint32_t flags)
+{
+	if (wire_min > pkt->max_size - pkt->size - pkt->reserved) {
+		if (!(flags & KNOT_PF_NOTRUNC)) {
+			knot_wire_set_tc(pkt->wire);
+		}
+		return KNOT_ESPACE;
+	}
+	return KNOT_EOK;
+}
+
 /*! \brief This is a wildcard-covered or any other terminal node for QNAME.
  *         e.g. positive answer.
  */
@@ -165,6 +183,21 @@ static int put_answer(knot_pkt_t *pkt, uint16_t type, knotd_qdata_t *qdata)
 		return KNOT_EOK;
 	}
 
+	/* The mandatory RRSIGs are appended later, truncated if they don't fit. */
+	if (rrset.type != KNOT_RRTYPE_RRSIG) {
+		const zone_node_t *node = qdata->extra->node;
+		int ret = check_space(pkt, node_rrset_wire_min(node, rrset.type, false),
+		                      put_rr_flags);
+		if (ret == KNOT_EOK && have_dnssec(qdata) &&
+		    (put_rr_flags & KNOT_PF_NOTRUNC) == 0) {
+			ret = check_space(pkt, node_rrset_wire_min(node, rrset.type, true),
+			                  KNOT_PF_NULL);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
 	return process_query_put_rr(pkt, qdata, &rrset, &rrsigs, compr_hint, put_rr_flags);
 }
 
@@ -212,6 +245,32 @@ static int put_nsec3_bitmap(const zone_node_t *for_node, knot_pkt_t *pkt,
 	                            KNOT_COMPR_HINT_NONE, flags);
 }
 
+#define AR_TYPES_MAX 3
+
+/*! \brief Picks the RRSets of the given types and the RRSIGs in one pass over the node. */
+static void glue_rrsets(const zone_node_t *node, const uint16_t *types, int count,
+                        knot_rrset_t *rrsets, knot_rrset_t *rrsigs)
+{
+	for (int k = 0; k < count; k++) {
+		knot_rrset_init_empty(&rrsets[k]);
+	}
+	knot_rrset_init_empty(rrsigs);
+
+	for (uint16_t i = 0; node != NULL && i < node->rrset_count; i++) {
+		uint16_t type = node->rrs[i].type;
+		if (type == KNOT_RRTYPE_RRSIG) {
+			*rrsigs = node_rrset_at(node, i);
+			continue;
+		}
+		for (int k = 0; k < count; k++) {
+			if (type == types[k]) {
+				rrsets[k] = node_rrset_at(node, i);
+				break;
+			}
+		}
+	}
+}
+
 /*! \brief Put additional records for given RR. */
 static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
                           knotd_qdata_t *qdata, knot_rrinfo_t *info, int state)
@@ -222,8 +281,11 @@ static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
 
 	/* Valid types for ADDITIONALS insertion. */
 	/* \note Not resolving CNAMEs as MX/NS name must not be an alias. (RFC2181/10.3) */
-	static uint16_t ar_type_list[] = { KNOT_RRTYPE_A, KNOT_RRTYPE_AAAA, KNOT_RRTYPE_SVCB };
-	static const int ar_type_count_default = 2;
+	uint16_t ar_type_list[AR_TYPES_MAX] = { KNOT_RRTYPE_A, KNOT_RRTYPE_AAAA };
+	int ar_type_count = 2;
+	if (rr->type == KNOT_RRTYPE_SVCB || rr->type == KNOT_RRTYPE_HTTPS) {
+		ar_type_list[ar_type_count++] = rr->type;
+	}
 
 	int ret = KNOT_EOK;
 
@@ -239,22 +301,22 @@ static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
 			flags |= KNOT_PF_NOTRUNC;
 		}
 
-		int ar_type_count = ar_type_count_default, ar_present = 0;
-		if (rr->type == KNOT_RRTYPE_SVCB || rr->type == KNOT_RRTYPE_HTTPS) {
-			ar_type_list[ar_type_count++] = rr->type;
-		}
-
+		int ar_present = 0;
 		uint16_t hint = knot_compr_hint(info, KNOT_COMPR_HINT_RDATA +
 		                                glue->ns_pos);
 		const zone_node_t *gluenode = glue_node(glue, qdata->extra->node);
-		knot_rrset_t rrsigs = node_rrset(gluenode, KNOT_RRTYPE_RRSIG);
+		knot_rrset_t rrsets[AR_TYPES_MAX], rrsigs;
+		glue_rrsets(gluenode, ar_type_list, ar_type_count, rrsets, &rrsigs);
 		for (int k = 0; k < ar_type_count; ++k) {
-			knot_rrset_t rrset = node_rrset(gluenode, ar_type_list[k]);
-			if (knot_rrset_empty(&rrset)) {
+			if (knot_rrset_empty(&rrsets[k])) {
 				continue;
 			}
-			ret = process_query_put_rr(pkt, qdata, &rrset, &rrsigs,
-			                           hint, flags);
+			ret = check_space(pkt, node_rrset_wire_min(gluenode, rrsets[k].type, false),
+			                  flags);
+			if (ret == KNOT_EOK) {
+				ret = process_query_put_rr(pkt, qdata, &rrsets[k], &rrsigs,
+				                           hint, flags);
+			}
 			if (ret != KNOT_EOK) {
 				break;
 			}
@@ -412,7 +474,7 @@ static int name_not_found(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	if (qdata->extra->encloser->flags & NODE_FLAGS_WILDCARD_CHILD) {
 		/* Find wildcard child in the zone. */
 		const zone_node_t *wildcard_node =
-			zone_contents_find_wildcard_child(
+			zone_contents_find_wildcard_child_cached(
 				qdata->extra->contents, qdata->extra->encloser);
 
 		qdata->extra->node = wildcard_node;
@@ -458,9 +520,12 @@ static int name_not_found(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 
 static int solve_name(int state, knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
-	int ret = zone_contents_find_dname(qdata->extra->contents, qdata->name,
-	                                   &qdata->extra->node, &qdata->extra->encloser,
-	                                   &qdata->extra->previous);
+	// Only the QNAME itself is available converted, not the CNAME targets.
+	const uint8_t *lf = (qdata->name == knot_pkt_qname(qdata->query)) ?
+	                    qdata->extra->qname_lf : NULL;
+	int ret = zone_contents_find_dname_lf(qdata->extra->contents, qdata->name, lf,
+	                                      &qdata->extra->node, &qdata->extra->encloser,
+	                                      &qdata->extra->previous);
 
 	switch (ret) {
 	case ZONE_NAME_FOUND:
@@ -632,15 +697,127 @@ static int solve_additional_dnssec(int state, knot_pkt_t *pkt, knotd_qdata_t *qd
 	}
 }
 
+/*! \brief Renders the referral from the delegation as if the delegation was queried. */
+static referral_t *render_referral(knotd_qdata_t *qdata, const zone_node_t *deleg,
+                                   bool dnssec)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, qdata->mm);
+	if (pkt == NULL) {
+		return NULL;
+	}
+
+	knotd_qdata_extra_t extra = *qdata->extra;
+	init_list(&extra.wildcards);
+	init_list(&extra.rrsigs);
+	knotd_qdata_t tmp = *qdata;
+	tmp.extra = &extra;
+	tmp.name = deleg->owner;
+
+	referral_t *ref = NULL;
+	int ret = knot_pkt_put_question(pkt, deleg->owner, KNOT_CLASS_IN, KNOT_RRTYPE_NS);
+	if (ret != KNOT_EOK ||
+	    zone_contents_find_dname(extra.contents, deleg->owner, &extra.node,
+	                             &extra.encloser, &extra.previous) != ZONE_NAME_FOUND ||
+	    extra.node != deleg) {
+		goto done;
+	}
+
+	int state = KNOTD_IN_STATE_DELEG;
+	knot_pkt_begin(pkt, KNOT_AUTHORITY);
+	state = solve_authority(state, pkt, &tmp, NULL);
+	if (dnssec && state == KNOTD_IN_STATE_DELEG) {
+		state = solve_authority_dnssec(state, pkt, &tmp, NULL);
+	}
+	knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+	if (state == KNOTD_IN_STATE_DELEG) {
+		state = solve_additional(state, pkt, &tmp, NULL);
+	}
+	if (dnssec && state == KNOTD_IN_STATE_DELEG) {
+		state = solve_additional_dnssec(state, pkt, &tmp, NULL);
+	}
+
+	if (state == KNOTD_IN_STATE_DELEG && !knot_wire_get_tc(pkt->wire)) {
+		size_t start = KNOT_WIRE_HEADER_SIZE + pkt->qname_size + 2 * sizeof(uint16_t);
+		ref = referral_new(deleg, dnssec, pkt->wire + start, pkt->size - start,
+		                   knot_wire_get_nscount(pkt->wire),
+		                   knot_wire_get_arcount(pkt->wire));
+	}
+done:
+	knot_pkt_free(pkt);
+	return ref;
+}
+
+/*! \brief Puts the whole referral from the cache of the rendered ones, if possible. */
+static bool put_cached_referral(knot_pkt_t *pkt, knotd_qdata_t *qdata, bool dnssec)
+{
+	conf_t *pconf = conf();
+	size_t cache_size = pconf->cache.srv_referral_cache;
+	if (cache_size == 0 || pconf->cache.srv_ans_rotate ||
+	    pkt->rrset_count > 0 || !EMPTY_LIST(qdata->extra->wildcards)) {
+		return false;
+	}
+
+	/* The ANSWER is empty, so the referral follows the question. */
+	size_t start = KNOT_WIRE_HEADER_SIZE + pkt->qname_size + 2 * sizeof(uint16_t);
+	if (pkt->size != start) {
+		return false;
+	}
+
+	/* Find closest delegation point. */
+	while (!(qdata->extra->node->flags & NODE_FLAGS_DELEG)) {
+		qdata->extra->node = node_parent(qdata->extra->node);
+	}
+	const zone_node_t *deleg = qdata->extra->node;
+	if (knot_dname_is_wildcard(deleg->owner)) {
+		return false;
+	}
+
+	referral_cache_t *cache = zone_contents_referral_cache(qdata->extra->contents,
+	                                                       cache_size);
+	int delta = pkt->qname_size - knot_dname_size(deleg->owner);
+	size_t maxlen = pkt->max_size - pkt->size - pkt->reserved;
+	uint16_t nscount = 0, arcount = 0;
+
+	int ret = referral_cache_write(cache, deleg, dnssec, delta, pkt->wire + pkt->size,
+	                               maxlen, &nscount, &arcount);
+	if (ret == KNOT_ENOENT) {
+		referral_cache_put(cache, render_referral(qdata, deleg, dnssec));
+		ret = referral_cache_write(cache, deleg, dnssec, delta, pkt->wire + pkt->size,
+		                           maxlen, &nscount, &arcount);
+	}
+	if (ret < 0) {
+		return false; /* Rendered the usual way, e.g. truncated. */
+	}
+
+	pkt->size += ret;
+	knot_wire_set_nscount(pkt->wire, nscount);
+	knot_wire_set_arcount(pkt->wire, arcount);
+
+	return true;
+}
+
 /*! \brief Helper for internet_query repetitive code. */
-#define SOLVE_STEP(solver, state, context) \
-	state = (solver)(state, pkt, qdata, context); \
+#define SOLVE_CHECK(state) \
 	if (state == KNOTD_IN_STATE_TRUNC) { \
 		return KNOT_STATE_DONE; \
 	} else if (state == KNOTD_IN_STATE_ERROR) { \
 		return KNOT_STATE_FAIL; \
 	}
 
+#define SOLVE_STEP(solver, state, context) \
+	state = (solver)(state, pkt, qdata, context); \
+	SOLVE_CHECK(state)
+
+#define SOLVE_MOD_STEPS(plan, stage_id, state) \
+	if (QUERY_PLAN_HAS(plan, stage_id)) { \
+		QUERY_PLAN_WALK(step, plan, stage_id) { \
+			QUERY_STEP_PROBE(module_hook_start, stage_id, step); \
+			state = step->process(state, pkt, qdata, step->ctx); \
+			QUERY_STEP_PROBE(module_hook_end, stage_id, step, state); \
+			SOLVE_CHECK(state) \
+		} \
+	}
+
 static int answer_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
 	int state = KNOTD_IN_STATE_BEGIN;
@@ -650,11 +827,7 @@ static int answer_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	bool with_dnssec = have_dnssec(qdata);
 
 	/* Resolve PREANSWER. */
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_PREANSWER]) {
-			SOLVE_STEP(step->process, state, step->ctx);
-		}
-	}
+	SOLVE_MOD_STEPS(plan, KNOTD_STAGE_PREANSWER, state);
 
 	/* Resolve ANSWER. */
 	knot_pkt_begin(pkt, KNOT_ANSWER);
@@ -662,23 +835,23 @@ static int answer_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	if (with_dnssec) {
 		SOLVE_STEP(solve_answer_dnssec, state, NULL);
 	}
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_ANSWER]) {
-			SOLVE_STEP(step->process, state, step->ctx);
-		}
-	}
+	SOLVE_MOD_STEPS(plan, KNOTD_STAGE_ANSWER, state);
 
 	/* Resolve AUTHORITY. */
 	knot_pkt_begin(pkt, KNOT_AUTHORITY);
+	if (state == KNOTD_IN_STATE_DELEG &&
+	    !QUERY_PLAN_HAS(plan, KNOTD_STAGE_AUTHORITY) &&
+	    !QUERY_PLAN_HAS(plan, KNOTD_STAGE_ADDITIONAL) &&
+	    put_cached_referral(pkt, qdata, with_dnssec)) {
+		knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+		knot_wire_set_rcode(pkt->wire, qdata->rcode);
+		return KNOT_STATE_DONE;
+	}
 	SOLVE_STEP(solve_authority, state, NULL);
 	if (with_dnssec) {
 		SOLVE_STEP(solve_authority_dnssec, state, NULL);
 	}
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_AUTHORITY]) {
-			SOLVE_STEP(step->process, state, step->ctx);
-		}
-	}
+	SOLVE_MOD_STEPS(plan, KNOTD_STAGE_AUTHORITY, state);
 
 	/* Resolve ADDITIONAL. */
 	knot_pkt_begin(pkt, KNOT_ADDITIONAL);
@@ -686,11 +859,7 @@ static int answer_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	if (with_dnssec) {
 		SOLVE_STEP(solve_additional_dnssec, state, NULL);
 	}
-	if (plan != NULL) {
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_ADDITIONAL]) {
-			SOLVE_STEP(step->process, state, step->ctx);
-		}
-	}
+	SOLVE_MOD_STEPS(plan, KNOTD_STAGE_ADDITIONAL, state);
 
 	/* Write resulting RCODE. */
 	knot_wire_set_rcode(pkt->wire, qdata->rcode);
@@ -54,10 +54,10 @@ static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
 		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA) {
 			ixfr->in_remove_section = !ixfr->in_remove_section;
 		}
-		journal_read_clear_rrset(&ixfr->cur_rr);
+		knot_rrset_init_empty(&ixfr->cur_rr);
 	}
 
-	while (journal_read_rrset(read, &ixfr->cur_rr, true)) {
+	while (journal_read_rrset_view(read, &ixfr->cur_rr, true)) {
 		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA &&
 		    !ixfr->in_remove_section &&
 		    knot_soa_serial(ixfr->cur_rr.rrs.rdata) == ixfr->soa_to) {
@@ -74,7 +74,7 @@ static int ixfr_put_chg_part(knot_pkt_t *pkt, struct ixfr_proc *ixfr,
 		if (ixfr->cur_rr.type == KNOT_RRTYPE_SOA) {
 			ixfr->in_remove_section = !ixfr->in_remove_section;
 		}
-		journal_read_clear_rrset(&ixfr->cur_rr);
+		knot_rrset_init_empty(&ixfr->cur_rr);
 	}
 
 	return journal_read_get_error(read, KNOT_EOK);
@@ -152,16 +152,17 @@ static void ixfr_answer_cleanup(knotd_qdata_t *qdata)
 	struct ixfr_proc *ixfr = (struct ixfr_proc *)qdata->extra->ext;
 	knot_mm_t *mm = qdata->mm;
 
-	knot_rrset_clear(&ixfr->cur_rr, NULL);
+	// The current RRSet is a view into the journal, released with it.
 	ptrlist_free(&ixfr->proc.nodes, mm);
 	journal_read_end(ixfr->journal_ctx);
+	xfr_cache_release(&ixfr->proc);
 	mm_free(mm, qdata->extra->ext);
 
 	/* Allow zone changes (finished). */
 	rcu_read_unlock();
 }
 
-static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
+static int ixfr_answer_init(knot_pkt_t *pkt, knotd_qdata_t *qdata, uint32_t *serial_from)
 {
 	assert(qdata);
 
@@ -190,11 +191,14 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	}
 	memset(xfer, 0, sizeof(*xfer));
 
-	int ret = ixfr_load_chsets(&xfer->journal_ctx, (zone_t *)qdata->extra->zone,
-	                           qdata->extra->contents, their_soa);
-	if (ret != KNOT_EOK) {
-		mm_free(mm, xfer);
-		return ret;
+	if (!xfr_cache_lookup(&xfer->proc, pkt, qdata, false, *serial_from)) {
+		int ret = ixfr_load_chsets(&xfer->journal_ctx, (zone_t *)qdata->extra->zone,
+		                           qdata->extra->contents, their_soa);
+		if (ret != KNOT_EOK) {
+			mm_free(mm, xfer);
+			return ret;
+		}
+		xfr_cache_render(&xfer->proc, pkt, qdata, false, *serial_from);
 	}
 
 	xfr_stats_begin(&xfer->proc.stats);
@@ -203,9 +207,11 @@ static int ixfr_answer_init(knotd_qdata_t *qdata, uint32_t *serial_from)
 	knot_rrset_init_empty(&xfer->cur_rr);
 	xfer->qdata = qdata;
 
-	ptrlist_add(&xfer->proc.nodes, xfer->journal_ctx, mm);
+	if (xfer->journal_ctx != NULL) {
+		ptrlist_add(&xfer->proc.nodes, xfer->journal_ctx, mm);
+	}
 
-	xfer->soa_from = knot_soa_serial(their_soa->rrs.rdata);
+	xfer->soa_from = *serial_from;
 	xfer->soa_to = zone_contents_serial(qdata->extra->contents);
 
 	qdata->extra->ext = xfer;
@@ -264,12 +270,13 @@ int ixfr_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	struct ixfr_proc *ixfr = qdata->extra->ext;
 	if (ixfr == NULL) {
 		uint32_t soa_from = 0;
-		int ret = ixfr_answer_init(qdata, &soa_from);
+		int ret = ixfr_answer_init(pkt, qdata, &soa_from);
 		ixfr = qdata->extra->ext;
 		switch (ret) {
 		case KNOT_EOK:       /* OK */
-			IXFROUT_LOG(LOG_INFO, qdata, "started, serial %u -> %u",
-				    ixfr->soa_from, ixfr->soa_to);
+			IXFROUT_LOG(LOG_INFO, qdata, "started, serial %u -> %u%s",
+				    ixfr->soa_from, ixfr->soa_to,
+				    ixfr->proc.cached != NULL ? ", cached" : "");
 			break;
 		case KNOT_EUPTODATE: /* Our zone is same age/older, send SOA. */
 			IXFROUT_LOG(LOG_INFO, qdata, "zone is up-to-date, serial %u", soa_from);
@@ -20,6 +20,7 @@
 #include "knot/nameserver/internet.h"
 #include "knot/nameserver/log.h"
 #include "knot/nameserver/tsig_ctx.h"
+#include "knot/server/server.h"
 #include "knot/zone/serial.h"
 #include "libdnssec/random.h"
 #include "libknot/libknot.h"
@@ -86,7 +87,16 @@ int notify_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 
 	/* Incoming NOTIFY expires REFRESH timer and renews EXPIRE timer. */
 	zone_set_preferred_master(zone, knotd_qdata_remote_addr(qdata));
-	zone_events_schedule_now(zone, ZONE_EVENT_REFRESH);
+
+	/* NOTIFY bursts are coalesced into one refresh. */
+	conf_val_t val = conf_zone_get(conf(), C_NOTIFY_DEBOUNCE, zone->name);
+	time_t window = conf_int(&val);
+	val = conf_zone_get(conf(), C_NOTIFY_DEBOUNCE_MAX, zone->name);
+	time_t max_delay = conf_int(&val);
+	if (zone_events_schedule_debounced(zone, ZONE_EVENT_REFRESH, window, max_delay) &&
+	    zone->server != NULL) {
+		__atomic_add_fetch(&zone->server->stats.refresh_suppressed, 1, __ATOMIC_RELAXED);
+	}
 
 	return KNOT_STATE_DONE;
 }
@@ -213,7 +213,7 @@ static int put_covering_nsec3(const zone_contents_t *zone,
 	const zone_node_t *prev = NULL;
 	const zone_node_t *node = NULL;
 
-	int match = zone_contents_find_nsec3_for_name(zone, name, &node, &prev);
+	int match = zone_contents_find_nsec3_cached(zone, name, &node, &prev);
 	if (match < 0) {
 		// ignore if missing
 		return KNOT_EOK;
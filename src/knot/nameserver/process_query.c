@@ -29,6 +29,7 @@
 #include "knot/nameserver/nsec_proofs.h"
 #include "knot/nameserver/notify.h"
 #include "knot/server/server.h"
+#include "knot/zone/replicas.h"
 #include "libknot/libknot.h"
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
@@ -65,7 +66,7 @@ static void query_data_init(knot_layer_t *ctx, knotd_qdata_params_t *params,
 	data->rcode_ede = KNOT_EDNS_EDE_NONE;
 
 	/* Initialize lists. */
-	memset(extra, 0, sizeof(*extra));
+	memset(extra, 0, offsetof(knotd_qdata_extra_t, qname_lf_storage));
 	init_list(&extra->wildcards);
 	init_list(&extra->rrsigs);
 }
@@ -74,8 +75,13 @@ static int process_query_begin(knot_layer_t *ctx, void *params)
 {
 	/* Initialize context. */
 	assert(ctx);
-	ctx->data = mm_alloc(ctx->mm, sizeof(knotd_qdata_t));
-	knotd_qdata_extra_t *extra = mm_alloc(ctx->mm, sizeof(*extra));
+	knotd_qdata_extra_t *extra;
+	if (ctx->flags & PROCESS_QUERY_PREALLOC) {
+		extra = &((process_query_data_t *)ctx->data)->extra;
+	} else {
+		ctx->data = mm_alloc(ctx->mm, sizeof(knotd_qdata_t));
+		extra = mm_alloc(ctx->mm, sizeof(*extra));
+	}
 
 	/* Initialize persistent data. */
 	query_data_init(ctx, params, extra);
@@ -97,6 +103,7 @@ static int process_query_reset(knot_layer_t *ctx)
 	knot_rrset_clear(&qdata->opt_rr, qdata->mm);
 	ptrlist_free(&extra->wildcards, qdata->mm);
 	nsec_clear_rrsigs(qdata);
+	knot_tsig_sign_ctx_clear(&qdata->sign);
 	if (extra->ext_cleanup != NULL) {
 		extra->ext_cleanup(qdata);
 	}
@@ -111,8 +118,10 @@ static int process_query_reset(knot_layer_t *ctx)
 static int process_query_finish(knot_layer_t *ctx)
 {
 	process_query_reset(ctx);
-	mm_free(ctx->mm, ctx->data);
-	ctx->data = NULL;
+	if (!(ctx->flags & PROCESS_QUERY_PREALLOC)) {
+		mm_free(ctx->mm, ctx->data);
+		ctx->data = NULL;
+	}
 
 	return KNOT_STATE_NOOP;
 }
@@ -182,7 +191,8 @@ static int query_chaos(knot_pkt_t *pkt, knot_layer_t *ctx)
 }
 
 /*! \brief Find zone for given question. */
-static zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zonedb)
+static zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zonedb,
+                                knotd_qdata_extra_t *extra)
 {
 	uint16_t qtype = knot_pkt_qtype(query);
 	uint16_t qclass = knot_pkt_qclass(query);
@@ -194,6 +204,9 @@ static zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zonedb)
 		return NULL;
 	}
 
+	// The converted QNAME is reused for the lookups in the zone contents.
+	extra->qname_lf = knot_dname_lf(qname, extra->qname_lf_storage);
+
 	/* In case of DS query, we strip the leftmost label when searching for
 	 * the zone (but use whole qname in search for the record), as the DS
 	 * records are only present in a parent zone.
@@ -211,10 +224,10 @@ static zone_t *answer_zone_find(const knot_pkt_t *query, knot_zonedb_t *zonedb)
 
 	if (zone == NULL) {
 		if (query_type(query) == KNOTD_QUERY_TYPE_NORMAL) {
-			zone = knot_zonedb_find_suffix(zonedb, qname);
+			zone = knot_zonedb_find_suffix_lf(zonedb, extra->qname_lf);
 		} else {
 			// Direct match required.
-			zone = knot_zonedb_find(zonedb, qname);
+			zone = knot_zonedb_find_lf(zonedb, extra->qname_lf);
 		}
 	}
 
@@ -417,6 +430,8 @@ static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx
 	/* Update maximal answer size. */
 	bool has_limit = qdata->params->flags & KNOTD_QUERY_FLAG_LIMIT_SIZE;
 	if (has_limit) {
+		/* The answer buffer may be smaller than the negotiated size. */
+		size_t buf_size = resp->max_size;
 		resp->max_size = KNOT_WIRE_MIN_PKTSIZE;
 		if (knot_pkt_has_edns(query)) {
 			uint16_t server_size;
@@ -434,8 +449,11 @@ static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx
 			uint16_t transfer = MIN(client_size, server_size);
 			resp->max_size = MAX(resp->max_size, transfer);
 		}
+		resp->max_size = MIN(resp->max_size, buf_size);
 	} else {
 		resp->max_size = KNOT_WIRE_MAX_PKTSIZE;
+		/* Large responses get optimal compression, fall back to hints. */
+		(void)knot_pkt_compr_table_init(resp);
 	}
 
 	/* All supported OPCODEs require a question. */
@@ -454,9 +472,13 @@ static int prepare_answer(knot_pkt_t *query, knot_pkt_t *resp, knot_layer_t *ctx
 	}
 
 	/* Find zone for QNAME. */
-	qdata->extra->zone = answer_zone_find(query, server->zone_db);
-	if (qdata->extra->zone != NULL && qdata->extra->contents == NULL) {
-		qdata->extra->contents = qdata->extra->zone->contents;
+	qdata->extra->zone = answer_zone_find(query, server->zone_db, qdata->extra);
+	if (qdata->extra->zone != NULL) {
+		zone_touch(qdata->extra->zone);
+		if (qdata->extra->contents == NULL) {
+			qdata->extra->contents = zone_replicas_local(qdata->extra->zone,
+			                                             qdata->extra->zone->contents);
+		}
 	}
 
 	/* Allow normal queries to catalog only over TCP and if allowed by ACL. */
@@ -525,7 +547,7 @@ static int process_query_err(knot_layer_t *ctx, knot_pkt_t *pkt)
 	set_rcode_to_packet(pkt, qdata);
 
 	/* Transaction security (if applicable). */
-	if (process_query_sign_response(pkt, qdata) != KNOT_EOK) {
+	if (process_query_sign_response(pkt, qdata, true) != KNOT_EOK) {
 		set_rcode_to_packet(pkt, qdata);
 	}
 
@@ -533,9 +555,11 @@ static int process_query_err(knot_layer_t *ctx, knot_pkt_t *pkt)
 }
 
 #define PROCESS_BEGIN(plan, step, next_state, qdata) \
-	if (plan != NULL) { \
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_BEGIN]) { \
+	if (QUERY_PLAN_HAS(plan, KNOTD_STAGE_BEGIN)) { \
+		QUERY_PLAN_WALK(step, plan, KNOTD_STAGE_BEGIN) { \
+			QUERY_STEP_PROBE(module_hook_start, KNOTD_STAGE_BEGIN, step); \
 			next_state = step->process(next_state, pkt, qdata, step->ctx); \
+			QUERY_STEP_PROBE(module_hook_end, KNOTD_STAGE_BEGIN, step, next_state); \
 			if (next_state == KNOT_STATE_FAIL) { \
 				goto finish; \
 			} \
@@ -543,15 +567,30 @@ static int process_query_err(knot_layer_t *ctx, knot_pkt_t *pkt)
 	}
 
 #define PROCESS_END(plan, step, next_state, qdata) \
-	if (plan != NULL) { \
-		WALK_LIST(step, plan->stage[KNOTD_STAGE_END]) { \
+	if (QUERY_PLAN_HAS(plan, KNOTD_STAGE_END)) { \
+		QUERY_PLAN_WALK(step, plan, KNOTD_STAGE_END) { \
+			QUERY_STEP_PROBE(module_hook_start, KNOTD_STAGE_END, step); \
 			next_state = step->process(next_state, pkt, qdata, step->ctx); \
+			QUERY_STEP_PROBE(module_hook_end, KNOTD_STAGE_END, step, next_state); \
 			if (next_state == KNOT_STATE_FAIL) { \
 				next_state = process_query_err(ctx, pkt); \
 			} \
 		} \
 	}
 
+/*! \brief Returns the nanoseconds elapsed since the mark and moves the mark to now. */
+static uint64_t timing_lap(struct timespec *mark)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	uint64_t elapsed = (now.tv_sec - mark->tv_sec) * 1000000000ULL +
+	                   now.tv_nsec - mark->tv_nsec;
+	*mark = now;
+
+	return elapsed;
+}
+
 static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 {
 	assert(pkt && ctx);
@@ -565,6 +604,16 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 
 	int next_state = KNOT_STATE_PRODUCE;
 
+	/* Measure the processing durations only if requested by some module. */
+	bool timing = query_module_timing();
+	struct timespec mark = { 0 };
+	if (timing) {
+		(void)timing_lap(&mark);
+		if (qdata->timing.begin.tv_sec == 0 && qdata->timing.begin.tv_nsec == 0) {
+			qdata->timing.begin = mark;
+		}
+	}
+
 	/* Check parse state. */
 	knot_pkt_t *query = qdata->query;
 	if (query->parsed < query->size) {
@@ -574,7 +623,11 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 	}
 
 	/* Preprocessing. */
-	if (prepare_answer(query, pkt, ctx) != KNOT_EOK) {
+	int ret = prepare_answer(query, pkt, ctx);
+	if (timing) {
+		qdata->timing.zone_lookup += timing_lap(&mark);
+	}
+	if (ret != KNOT_EOK) {
 		next_state = KNOT_STATE_FAIL;
 		goto finish;
 	}
@@ -586,6 +639,9 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 	/* Before query processing code. */
 	PROCESS_BEGIN(plan, step, next_state, qdata);
 	PROCESS_BEGIN(zone_plan, step, next_state, qdata);
+	if (timing) {
+		qdata->timing.modules += timing_lap(&mark);
+	}
 
 	/* Answer based on qclass. */
 	if (next_state == KNOT_STATE_PRODUCE) {
@@ -619,7 +675,8 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		}
 
 		/* Transaction security (if applicable). */
-		if (process_query_sign_response(pkt, qdata) != KNOT_EOK) {
+		if (process_query_sign_response(pkt, qdata,
+		                                next_state == KNOT_STATE_DONE) != KNOT_EOK) {
 			next_state = KNOT_STATE_FAIL;
 			goto finish;
 		}
@@ -641,6 +698,11 @@ finish:
 		set_rcode_to_packet(pkt, qdata);
 	}
 
+	/* Includes the BEGIN stage hooks if they failed. */
+	if (timing) {
+		qdata->timing.answer += timing_lap(&mark);
+	}
+
 	/* After query processing code. */
 	PROCESS_END(plan, step, next_state, qdata);
 	PROCESS_END(zone_plan, step, next_state, qdata);
@@ -680,8 +742,15 @@ bool process_query_acl_check(conf_t *conf, acl_action_t action,
 	}
 	const knot_lookup_t *act = knot_lookup_by_id((knot_lookup_t *)acl_actions, action);
 
-	conf_val_t acl = conf_zone_get(conf, C_ACL, zone_name);
-	bool allowed = acl_allowed(conf, &acl, action, query_source, &tsig, zone_name, query);
+	bool allowed;
+	const zone_conf_t *settings = rcu_dereference(qdata->extra->zone->settings);
+	if (settings != NULL) {
+		allowed = acl_allowed_ids(conf, settings->acl, settings->acl_len, action,
+		                          query_source, &tsig, zone_name, query);
+	} else {
+		conf_val_t acl = conf_zone_get(conf, C_ACL, zone_name);
+		allowed = acl_allowed(conf, &acl, action, query_source, &tsig, zone_name, query);
+	}
 
 	log_zone_debug(zone_name,
 	               "ACL, %s, action %s, remote %s, key %s%s%s",
@@ -776,7 +845,7 @@ int process_query_verify(knotd_qdata_t *qdata)
 	return ret;
 }
 
-int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata)
+int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata, bool last)
 {
 	if (pkt->size == 0) {
 		// Nothing to sign.
@@ -790,19 +859,19 @@ int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 	/* KEY provided and verified TSIG or BADTIME allows signing. */
 	if (ctx->tsig_key.name != NULL && knot_tsig_can_sign(qdata->rcode_tsig)) {
 		/* Sign query response. */
-		size_t new_digest_len = dnssec_tsig_algorithm_size(ctx->tsig_key.algorithm);
 		if (ctx->pkt_count == 0) {
+			size_t new_digest_len = dnssec_tsig_algorithm_size(ctx->tsig_key.algorithm);
 			ret = knot_tsig_sign(pkt->wire, &pkt->size, pkt->max_size,
 			                     ctx->tsig_digest, ctx->tsig_digestlen,
 			                     ctx->tsig_digest, &new_digest_len,
 			                     &ctx->tsig_key, qdata->rcode_tsig,
 			                     ctx->tsig_time_signed);
+		} else if (!last && ctx->unsigned_count + 1 < conf()->cache.srv_tsig_sign_interval) {
+			/* Covered by the signature of a later message. */
+			ret = knot_tsig_sign_skip(ctx, pkt->wire, pkt->size);
 		} else {
-			ret = knot_tsig_sign_next(pkt->wire, &pkt->size, pkt->max_size,
-			                          ctx->tsig_digest, ctx->tsig_digestlen,
-			                          ctx->tsig_digest, &new_digest_len,
-			                          &ctx->tsig_key,
-			                          pkt->wire, pkt->size);
+			ret = knot_tsig_sign_next_ctx(ctx, pkt->wire, &pkt->size,
+			                              pkt->max_size);
 		}
 		if (ret != KNOT_EOK) {
 			goto fail; /* Failed to sign. */
@@ -37,11 +37,43 @@ typedef struct knotd_qdata_extra {
 
 	uint8_t cname_chain; /*!< Length of the CNAME chain so far. */
 
+	/*! QNAME in the lookup format, converted once for the zone and node lookups. */
+	const uint8_t *qname_lf;
+
 	/* Extensions. */
 	void *ext;
 	void (*ext_cleanup)(knotd_qdata_t *); /*!< Extensions cleanup callback. */
+
+	/* Storage of the converted QNAME, not cleared between queries. */
+	knot_dname_storage_t qname_lf_storage;
 } knotd_qdata_extra_t;
 
+/*! \brief Query data storage reused for all the queries of a processing thread. */
+typedef struct {
+	knotd_qdata_t qdata;
+	knotd_qdata_extra_t extra;
+} process_query_data_t;
+
+/*! \brief Query processing layer flags. */
+typedef enum {
+	PROCESS_QUERY_PREALLOC = 1 << 0, /*!< Query data is provided by the caller. */
+} process_query_flag_t;
+
+/*!
+ * \brief Let the query processing layer use the provided query data storage.
+ *
+ * The query data and its extension are reset instead of being allocated
+ * from the layer memory context for each query.
+ *
+ * \param layer  Query processing layer.
+ * \param data   Query data storage with the same life time as the layer.
+ */
+static inline void process_query_prealloc(knot_layer_t *layer, process_query_data_t *data)
+{
+	layer->data = &data->qdata;
+	layer->flags |= PROCESS_QUERY_PREALLOC;
+}
+
 /*! \brief Visited wildcard node list. */
 struct wildcard_hit {
 	node_t n;
@@ -83,12 +115,16 @@ int process_query_verify(knotd_qdata_t *qdata);
 /*!
  * \brief Sign current query using configured TSIG keys.
  *
+ * A message which isn't the last one of the response may be left unsigned
+ * depending on the configured signing interval.
+ *
  * \param pkt    Outgoing message.
  * \param qdata  Query data.
+ * \param last   The message is the last one of the response.
  *
  * \retval KNOT_E*
  */
-int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata);
+int process_query_sign_response(knot_pkt_t *pkt, knotd_qdata_t *qdata, bool last);
 
 /*!
  * \brief Puts RRSet to packet, will store its RRSIG for later use.
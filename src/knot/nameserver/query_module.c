@@ -21,9 +21,12 @@
 #include <string.h>
 
 #include "contrib/sockaddr.h"
+#include "contrib/time.h"
+#include "contrib/ucw/mempool.h"
 #include "libknot/attribute.h"
 #include "libknot/xdp.h"
 #include "knot/common/log.h"
+#include "knot/common/memstat.h"
 #include "knot/conf/module.h"
 #include "knot/conf/tools.h"
 #include "knot/dnssec/rrset-sign.h"
@@ -35,13 +38,37 @@
  #define ATOMIC_ADD(dst, val) __atomic_add_fetch(&(dst), (val), __ATOMIC_RELAXED)
  #define ATOMIC_SUB(dst, val) __atomic_sub_fetch(&(dst), (val), __ATOMIC_RELAXED)
  #define ATOMIC_SET(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_RELAXED)
+ #define ATOMIC_REL(dst, val) __atomic_store_n(&(dst), (val), __ATOMIC_RELEASE)
+ #define ATOMIC_CAS(dst, exp, val) \
+	__atomic_compare_exchange_n(&(dst), &(exp), (val), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+ #define ATOMIC_FENCE_REL() __atomic_thread_fence(__ATOMIC_RELEASE)
 #else
  #warning "Statistics data can be inaccurate"
  #define ATOMIC_ADD(dst, val) ((dst) += (val))
  #define ATOMIC_SUB(dst, val) ((dst) -= (val))
  #define ATOMIC_SET(dst, val) ((dst) = (val))
+ #define ATOMIC_REL(dst, val) ((dst) = (val))
+ #define ATOMIC_CAS(dst, exp, val) \
+	(((dst) == (exp)) ? ((dst) = (val), true) : ((exp) = (dst), false))
+ #define ATOMIC_FENCE_REL()
 #endif
 
+/* Updates of the single-writer counters, no locked read-modify-write needed. */
+#define LOCAL_ADD(dst, val) ATOMIC_SET(dst, ATOMIC_GET(dst) + (val))
+#define LOCAL_SUB(dst, val) ATOMIC_SET(dst, ATOMIC_GET(dst) - (val))
+#define LOCAL_SET(dst, val) ATOMIC_SET(dst, val)
+
+/*! \brief Compact counters are checked for the update rate this often. */
+#define STATS_HOT_CHECK	65536
+/*! \brief Compact counters with STATS_HOT_CHECK updates per this time [ms] are hot. */
+#define STATS_HOT_MS	1000
+
+/*! \brief Number of modules requiring the query processing durations. */
+static unsigned timing_users = 0;
+
+/*! \brief Number of compact module counters that switched to per-thread. */
+static uint32_t stats_hot_count = 0;
+
 _public_
 int knotd_conf_check_ref(knotd_conf_check_args_t *args)
 {
@@ -50,16 +77,7 @@ int knotd_conf_check_ref(knotd_conf_check_args_t *args)
 
 struct query_plan *query_plan_create(void)
 {
-	struct query_plan *plan = malloc(sizeof(struct query_plan));
-	if (plan == NULL) {
-		return NULL;
-	}
-
-	for (unsigned i = 0; i < KNOTD_STAGES; ++i) {
-		init_list(&plan->stage[i]);
-	}
-
-	return plan;
+	return calloc(1, sizeof(struct query_plan));
 }
 
 void query_plan_free(struct query_plan *plan)
@@ -69,37 +87,28 @@ void query_plan_free(struct query_plan *plan)
 	}
 
 	for (unsigned i = 0; i < KNOTD_STAGES; ++i) {
-		struct query_step *step, *next;
-		WALK_LIST_DELSAFE(step, next, plan->stage[i]) {
-			free(step);
-		}
+		free(plan->stage[i]);
 	}
 
 	free(plan);
 }
 
-static struct query_step *make_step(query_step_process_f process, void *ctx)
-{
-	struct query_step *step = calloc(1, sizeof(struct query_step));
-	if (step == NULL) {
-		return NULL;
-	}
-
-	step->process = process;
-	step->ctx = ctx;
-
-	return step;
-}
-
 int query_plan_step(struct query_plan *plan, knotd_stage_t stage,
                     query_step_process_f process, void *ctx)
 {
-	struct query_step *step = make_step(process, ctx);
-	if (step == NULL) {
+	// The plan isn't published while being built, so it can be reallocated.
+	unsigned count = plan->count[stage];
+	struct query_step *steps = realloc(plan->stage[stage], (count + 1) * sizeof(*steps));
+	if (steps == NULL) {
 		return KNOT_ENOMEM;
 	}
 
-	add_tail(&plan->stage[stage], &step->node);
+	steps[count].process = process;
+	steps[count].ctx = ctx;
+
+	plan->stage[stage] = steps;
+	plan->count[stage] = count + 1;
+	plan->mask |= 1U << stage;
 
 	return KNOT_EOK;
 }
@@ -180,7 +189,15 @@ static void module_reset(conf_t *conf, knotd_mod_t *module, struct query_plan *n
 	knotd_mod_stats_free(module);
 	module->stats_info = NULL;
 	module->stats_vals = NULL;
+	module->stats_shared = NULL;
 	module->stats_count = 0;
+	module->stats_compact = false;
+
+	// Reset timing
+	if (module->timing) {
+		ATOMIC_SUB(timing_users, 1);
+		module->timing = false;
+	}
 
 	// Keep ->ctx
 }
@@ -259,11 +276,26 @@ void knotd_mod_vlog(knotd_mod_t *mod, int priority, const char *fmt, va_list arg
 	#undef LOG_ARGS
 }
 
+/*! \brief Allocates a zeroed block of per-thread counters. */
+static mod_stats_block_t *stats_block_alloc(size_t count)
+{
+	size_t size = sizeof(mod_stats_block_t) + count * sizeof(uint64_t);
+	size = (size + STATS_CACHE_LINE - 1) & ~(size_t)(STATS_CACHE_LINE - 1);
+
+	mod_stats_block_t *block;
+	if (posix_memalign((void **)&block, STATS_CACHE_LINE, size) != 0) {
+		return NULL;
+	}
+	memset(block, 0, size);
+
+	return block;
+}
+
 _public_
 int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_count,
                         knotd_mod_idx_to_str_f idx_to_str)
 {
-	if (mod == NULL || idx_count == 0) {
+	if (mod == NULL || idx_count == 0 || mod->stats_compact) {
 		return KNOT_EINVAL;
 	}
 
@@ -287,7 +319,7 @@ int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_cou
 		}
 
 		for (unsigned i = 0; i < threads; i++) {
-			mod->stats_vals[i] = calloc(idx_count, sizeof(**mod->stats_vals));
+			mod->stats_vals[i] = stats_block_alloc(idx_count);
 			if (mod->stats_vals[i] == NULL) {
 				knotd_mod_stats_free(mod);
 				return KNOT_ENOMEM;
@@ -312,23 +344,22 @@ int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_cou
 		stats += mod->stats_count;
 
 		for (unsigned i = 0; i < threads; i++) {
-			uint64_t *new_vals = realloc(mod->stats_vals[i],
-			                             (offset + idx_count) * sizeof(*new_vals));
-			if (new_vals == NULL) {
+			// Not used by the threads yet, so the block can be replaced.
+			mod_stats_block_t *block = stats_block_alloc(offset + idx_count);
+			if (block == NULL) {
 				knotd_mod_stats_free(mod);
 				return KNOT_ENOMEM;
 			}
-			mod->stats_vals[i] = new_vals;
-			new_vals += offset;
-			for (uint32_t j = 0; j < idx_count; j++) {
-				*new_vals++ = 0;
-			}
+			memcpy(block->vals, mod->stats_vals[i]->vals, offset * sizeof(uint64_t));
+			free(mod->stats_vals[i]);
+			mod->stats_vals[i] = block;
 		}
 	}
 
 	stats->name = ctr_name;
 	stats->count = idx_count;
 	stats->idx_to_str = idx_to_str;
+	stats->read = NULL;
 	stats->offset = offset;
 
 	mod->stats_count++;
@@ -336,6 +367,23 @@ int knotd_mod_stats_add(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_cou
 	return KNOT_EOK;
 }
 
+_public_
+int knotd_mod_stats_add_read(knotd_mod_t *mod, const char *ctr_name, uint32_t idx_count,
+                             knotd_mod_stats_read_f read)
+{
+	if (ctr_name == NULL || read == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = knotd_mod_stats_add(mod, ctr_name, idx_count, NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	mod->stats_info[mod->stats_count - 1].read = read;
+
+	return KNOT_EOK;
+}
+
 _public_
 void knotd_mod_stats_free(knotd_mod_t *mod)
 {
@@ -351,36 +399,161 @@ void knotd_mod_stats_free(knotd_mod_t *mod)
 	}
 
 	free(mod->stats_vals);
+	free(mod->stats_shared);
 	free(mod->stats_info);
+
+	if (mod->stats_hot) {
+		ATOMIC_SUB(stats_hot_count, 1);
+		mod->stats_hot = false;
+	}
+}
+
+static uint64_t now_ms(void)
+{
+	struct timespec now = time_now();
+	return now.tv_sec * 1000ULL + now.tv_nsec / 1000000;
+}
+
+_public_
+int knotd_mod_stats_compact(knotd_mod_t *mod, uint32_t hot_limit)
+{
+	if (mod == NULL || mod->stats_count == 0 || mod->stats_compact) {
+		return KNOT_EINVAL;
+	}
+
+	// The per-thread counters aren't used yet.
+	unsigned threads = knotd_mod_threads(mod);
+	for (unsigned i = 0; i < threads; i++) {
+		free(mod->stats_vals[i]);
+	}
+	free(mod->stats_vals);
+	mod->stats_vals = NULL;
+
+	mod->stats_compact = true;
+	mod->stats_hot_limit = hot_limit;
+	mod->stats_check_ms = now_ms();
+
+	return KNOT_EOK;
+}
+
+static size_t stats_size(knotd_mod_t *mod)
+{
+	const mod_ctr_t *last = &mod->stats_info[mod->stats_count - 1];
+	return last->offset + last->count;
+}
+
+/*! \brief Switches to per-thread counters if updated often and the limit allows. */
+static void stats_check_hot(knotd_mod_t *mod)
+{
+	uint64_t now = now_ms();
+	uint64_t last = ATOMIC_GET(mod->stats_check_ms);
+	ATOMIC_SET(mod->stats_check_ms, now);
+	if (now - last > STATS_HOT_MS) {
+		return;
+	}
+
+	if (ATOMIC_ADD(stats_hot_count, 1) > mod->stats_hot_limit) {
+		ATOMIC_SUB(stats_hot_count, 1);
+		return;
+	}
+
+	mod_stats_block_t **vals = calloc(knotd_mod_threads(mod), sizeof(*vals));
+	mod_stats_block_t **expected = NULL;
+	if (vals == NULL || !ATOMIC_CAS(mod->stats_vals, expected, vals)) {
+		free(vals);
+		ATOMIC_SUB(stats_hot_count, 1);
+		return;
+	}
+	ATOMIC_SET(mod->stats_hot, true);
+}
+
+/*! \brief Returns the per-thread counters in the compact mode if hot. */
+static mod_stats_block_t *compact_block(knotd_mod_t *mod, unsigned thr_id)
+{
+	// Hot counters are allocated by the thread using them.
+	mod_stats_block_t **per_thread = ATOMIC_ACQ(mod->stats_vals);
+	if (per_thread == NULL) {
+		return NULL;
+	}
+
+	mod_stats_block_t *block = per_thread[thr_id];
+	if (block == NULL) {
+		block = stats_block_alloc(stats_size(mod));
+		ATOMIC_REL(per_thread[thr_id], block);
+	}
+	return block;
 }
 
-#define STATS_BODY(OPERATION) { \
+/*! \brief Returns the counters shared by the threads in the compact mode. */
+static uint64_t *compact_shared(knotd_mod_t *mod)
+{
+	uint64_t *shared = ATOMIC_ACQ(mod->stats_shared);
+	if (unlikely(shared == NULL)) {
+		uint64_t *vals = calloc(stats_size(mod), sizeof(*vals));
+		if (vals == NULL) {
+			return NULL;
+		}
+		if (ATOMIC_CAS(mod->stats_shared, shared, vals)) {
+			shared = vals;
+		} else {
+			free(vals);
+		}
+	}
+
+	if (ATOMIC_ACQ(mod->stats_vals) == NULL &&
+	    ATOMIC_ADD(mod->stats_updates, 1) % STATS_HOT_CHECK == 0) {
+		stats_check_hot(mod);
+	}
+
+	return shared;
+}
+
+/*
+ * The per-thread counters are updated with plain stores enclosed in
+ * the sequence number changes (see stats_get_snapshot()), only the counters
+ * shared in the compact mode need atomic read-modify-write.
+ */
+#define STATS_BODY(LOCAL_OP, SHARED_OP) { \
 	if (mod == NULL) return; \
 	\
 	mod_ctr_t *ctr = mod->stats_info + ctr_id; \
 	assert(idx < ctr->count); \
-	OPERATION(mod->stats_vals[thr_id][ctr->offset + idx], val); \
+	uint32_t pos = ctr->offset + idx; \
+	mod_stats_block_t *block = mod->stats_compact ? compact_block(mod, thr_id) : \
+	                                                mod->stats_vals[thr_id]; \
+	if (block != NULL) { \
+		uint64_t seq = ATOMIC_GET(block->seq); \
+		ATOMIC_SET(block->seq, seq + 1); \
+		ATOMIC_FENCE_REL(); \
+		LOCAL_OP(block->vals[pos], val); \
+		ATOMIC_REL(block->seq, seq + 2); \
+	} else if (mod->stats_compact) { \
+		uint64_t *shared = compact_shared(mod); \
+		if (shared != NULL) { \
+			SHARED_OP(shared[pos], val); \
+		} \
+	} \
 }
 
 _public_
 void knotd_mod_stats_incr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
                           uint32_t idx, uint64_t val)
 {
-	STATS_BODY(ATOMIC_ADD)
+	STATS_BODY(LOCAL_ADD, ATOMIC_ADD)
 }
 
 _public_
 void knotd_mod_stats_decr(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
                           uint32_t idx, uint64_t val)
 {
-	STATS_BODY(ATOMIC_SUB)
+	STATS_BODY(LOCAL_SUB, ATOMIC_SUB)
 }
 
 _public_
 void knotd_mod_stats_store(knotd_mod_t *mod, unsigned thr_id, uint32_t ctr_id,
                            uint32_t idx, uint64_t val)
 {
-	STATS_BODY(ATOMIC_SET)
+	STATS_BODY(LOCAL_SET, ATOMIC_SET)
 }
 
 _public_
@@ -412,6 +585,9 @@ knotd_conf_t knotd_conf_env(knotd_mod_t *mod, knotd_conf_env_t env)
 	case KNOTD_CONF_ENV_WORKERS_XDP:
 		out.single.integer = config->cache.srv_xdp_threads;
 		break;
+	case KNOTD_CONF_ENV_WORKERS_XFR:
+		out.single.integer = config->cache.srv_xfr_threads;
+		break;
 	default:
 		return out;
 	}
@@ -427,7 +603,15 @@ unsigned knotd_mod_threads(knotd_mod_t *mod)
 	knotd_conf_t udp = knotd_conf_env(mod, KNOTD_CONF_ENV_WORKERS_UDP);
 	knotd_conf_t xdp = knotd_conf_env(mod, KNOTD_CONF_ENV_WORKERS_XDP);
 	knotd_conf_t tcp = knotd_conf_env(mod, KNOTD_CONF_ENV_WORKERS_TCP);
-	return udp.single.integer + xdp.single.integer + tcp.single.integer;
+	knotd_conf_t xfr = knotd_conf_env(mod, KNOTD_CONF_ENV_WORKERS_XFR);
+	return udp.single.integer + xdp.single.integer + tcp.single.integer +
+	       xfr.single.integer;
+}
+
+_public_
+knot_mm_t *knotd_mod_mm(knotd_mod_t *mod)
+{
+	return memstat_mm(MEMSTAT_MODULES);
 }
 
 static void set_val(yp_type_t type, knotd_conf_val_t *item, conf_val_t *val)
@@ -681,6 +865,41 @@ knot_rrset_t knotd_qdata_zone_apex_rrset(knotd_qdata_t *qdata, uint16_t type)
 	return node_rrset(qdata->extra->contents->apex, type);
 }
 
+_public_
+unsigned knotd_qdata_alloc_count(knotd_qdata_t *qdata)
+{
+	// The server processes the queries with memory pools.
+	if (qdata == NULL || qdata->mm == NULL ||
+	    qdata->mm->alloc != (knot_mm_alloc_t)mp_alloc) {
+		return 0;
+	}
+
+	return mp_alloc_count(qdata->mm->ctx);
+}
+
+_public_
+void knotd_mod_timing_enable(knotd_mod_t *mod)
+{
+	if (mod != NULL && !mod->timing) {
+		mod->timing = true;
+		ATOMIC_ADD(timing_users, 1);
+	}
+}
+
+bool query_module_timing(void)
+{
+	return timing_users > 0;
+}
+
+void query_module_timing_request(bool enable)
+{
+	if (enable) {
+		ATOMIC_ADD(timing_users, 1);
+	} else {
+		ATOMIC_SUB(timing_users, 1);
+	}
+}
+
 _public_
 int knotd_mod_dnssec_init(knotd_mod_t *mod)
 {
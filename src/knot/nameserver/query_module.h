@@ -17,6 +17,7 @@
 #pragma once
 
 #include "libknot/libknot.h"
+#include "knot/common/usdt.h"
 #include "knot/conf/conf.h"
 #include "knot/dnssec/context.h"
 #include "knot/dnssec/zone-keys.h"
@@ -26,10 +27,17 @@
 
 #ifdef HAVE_ATOMIC
  #define ATOMIC_GET(src) __atomic_load_n(&(src), __ATOMIC_RELAXED)
+ #define ATOMIC_ACQ(src) __atomic_load_n(&(src), __ATOMIC_ACQUIRE)
+ #define ATOMIC_FENCE_ACQ() __atomic_thread_fence(__ATOMIC_ACQUIRE)
 #else
  #define ATOMIC_GET(src) (src)
+ #define ATOMIC_ACQ(src) (src)
+ #define ATOMIC_FENCE_ACQ()
 #endif
 
+/*! \brief Alignment and size granularity of the per-thread counter blocks. */
+#define STATS_CACHE_LINE 64
+
 #define KNOTD_STAGES (KNOTD_STAGE_END + 1)
 
 typedef unsigned (*query_step_process_f)
@@ -37,7 +45,6 @@ typedef unsigned (*query_step_process_f)
 
 /*! \brief Single processing step in query processing. */
 struct query_step {
-	node_t node;
 	void *ctx;
 	query_step_process_f process;
 };
@@ -45,11 +52,25 @@ struct query_step {
 /*! Query plan represents a sequence of steps needed for query processing
  *  divided into several stages, where each stage represents a current response
  *  assembly phase, for example 'before processing', 'answer section' and so on.
+ *
+ *  The steps of each stage are stored in a flat array and 'mask' marks
+ *  the stages with at least one step, so empty stages cost a bit test.
  */
 struct query_plan {
-	list_t stage[KNOTD_STAGES];
+	struct query_step *stage[KNOTD_STAGES];
+	unsigned count[KNOTD_STAGES];
+	unsigned mask;
 };
 
+/*! \brief Check if the plan has some steps in the given stage. */
+#define QUERY_PLAN_HAS(plan, stage_id) \
+	((plan) != NULL && ((plan)->mask & (1U << (stage_id))))
+
+/*! \brief Iterate over the steps of the given stage. */
+#define QUERY_PLAN_WALK(step, plan, stage_id) \
+	for (step = (plan)->stage[stage_id]; \
+	     step < (plan)->stage[stage_id] + (plan)->count[stage_id]; step++)
+
 /*! \brief Create an empty query plan. */
 struct query_plan *query_plan_create(void);
 
@@ -75,10 +96,23 @@ typedef char* (*mod_idx_to_str_f)(uint32_t idx, uint32_t count);
 typedef struct {
 	const char *name;
 	mod_idx_to_str_f idx_to_str; // unused if count == 1
-	uint32_t offset; // offset of counters in stats_vals[thread_id]
+	knotd_mod_stats_read_f read; // values and names provided by the module if set
+	uint32_t offset; // offset of counters in stats_vals[thread_id]->vals
 	uint32_t count;
 } mod_ctr_t;
 
+/*!
+ * \brief Counters of one thread, written only by that thread.
+ *
+ * The block is cache-line aligned and padded so that the threads don't
+ * share the lines. The sequence number is odd while an update is in progress,
+ * which allows readers to take a consistent snapshot.
+ */
+typedef struct {
+	uint64_t seq;
+	uint64_t vals[];
+} mod_stats_block_t;
+
 struct knotd_mod {
 	node_t node;
 	conf_t *config;
@@ -91,9 +125,27 @@ struct knotd_mod {
 	zone_keyset_t *keyset;
 	zone_sign_ctx_t *sign_ctx;
 	mod_ctr_t *stats_info;
-	uint64_t **stats_vals;
+	mod_stats_block_t **stats_vals; // Per-thread counters, NULL until hot if compact.
+	uint64_t *stats_shared;    // Counters shared by the threads if compact.
 	uint32_t stats_count;
+	uint32_t stats_updates;    // Updates of the shared counters.
+	uint32_t stats_hot_limit;
+	uint64_t stats_check_ms;   // Time of the last check of the update rate.
+	bool stats_compact;
+	bool stats_hot;
+	bool timing;
 	void *ctx;
+	struct shared_inst *shared_inst; // Referenced shared instance (this is a placeholder).
 };
 
 void knotd_mod_stats_free(knotd_mod_t *mod);
+
+/*! \brief Fires the module hook probe, the query steps are module hooks. */
+#define QUERY_STEP_PROBE(probe, stage, step, ...) \
+	KNOT_PROBE(probe, stage, ((knotd_mod_t *)(step)->ctx)->id->name + 1, ##__VA_ARGS__)
+
+/*! \brief Check if some module requires the query processing durations. */
+bool query_module_timing(void);
+
+/*! \brief Requests (or drops the request of) the durations without a module. */
+void query_module_timing_request(bool enable);
@@ -61,24 +61,33 @@ static int update_enqueue(zone_t *zone, knotd_qdata_t *qdata)
 		assert(req->sign.tsig_key.algorithm == knot_tsig_rdata_alg(req->query->tsig_rr));
 	}
 
+	conf_val_t val = conf_zone_get(conf(), C_DDNS_DELAY, zone->name);
+	time_t delay = conf_int(&val);
+	val = conf_zone_get(conf(), C_DDNS_BATCH, zone->name);
+	size_t batch = conf_int(&val);
+
 	pthread_mutex_lock(&zone->ddns_lock);
 
 	/* Enqueue created request. */
 	ptrlist_add(&zone->ddns_queue, req, NULL);
-	++zone->ddns_queue_size;
+	size_t queued = ++zone->ddns_queue_size;
 
 	pthread_mutex_unlock(&zone->ddns_lock);
 
-	/* Schedule UPDATE event. */
-	zone_events_schedule_now(zone, ZONE_EVENT_UPDATE);
+	/* Schedule UPDATE event, the earlier planned time is kept. */
+	if (batch > 0 && queued >= batch) {
+		delay = 0;
+	}
+	zone_events_schedule_at(zone, ZONE_EVENT_UPDATE, time(NULL) + delay);
 
 	return KNOT_EOK;
 }
 
 int update_process_query(knot_pkt_t *pkt, knotd_qdata_t *qdata)
 {
-	/* DDNS over XDP not supported. */
-	if (qdata->params->xdp_msg != NULL) {
+	/* DDNS over XDP or TLS not supported. */
+	if (qdata->params->xdp_msg != NULL ||
+	    (qdata->params->flags & KNOTD_QUERY_FLAG_TLS)) {
 		qdata->rcode = KNOT_RCODE_SERVFAIL;
 		return KNOT_STATE_FAIL;
 	}
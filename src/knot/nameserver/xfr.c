@@ -16,6 +16,93 @@
 
 #include "knot/nameserver/xfr.h"
 #include "contrib/mempattern.h"
+#include "knot/zone/zone.h"
+
+/*! \brief Checks if the transfer messages may be cached or served from cache. */
+static bool cacheable(knot_pkt_t *pkt, knotd_qdata_t *qdata)
+{
+	return !(qdata->params->flags & KNOTD_QUERY_FLAG_LIMIT_SIZE) &&
+	       qdata->params->xdp_msg == NULL &&
+	       pkt->size == KNOT_WIRE_HEADER_SIZE + knot_pkt_question_size(pkt);
+}
+
+static xfr_cache_t *zone_xfr_cache(knotd_qdata_t *qdata)
+{
+	return qdata->extra->zone->xfr_cache;
+}
+
+bool xfr_cache_lookup(struct xfr_proc *xfer, knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      bool axfr, uint32_t serial_from)
+{
+	if (!cacheable(pkt, qdata)) {
+		return false;
+	}
+
+	uint32_t serial_to = zone_contents_serial(qdata->extra->contents);
+	xfer->cached = xfr_cache_get(zone_xfr_cache(qdata), axfr, serial_from, serial_to);
+	if (xfer->cached != NULL && xfer->cached->qsize != pkt->size) {
+		xfr_cache_entry_release(xfer->cached);
+		xfer->cached = NULL;
+	}
+
+	return xfer->cached != NULL;
+}
+
+void xfr_cache_render(struct xfr_proc *xfer, knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      bool axfr, uint32_t serial_from)
+{
+	if (!cacheable(pkt, qdata)) {
+		return;
+	}
+
+	uint32_t serial_to = zone_contents_serial(qdata->extra->contents);
+	xfer->render = xfr_cache_entry_new(zone_xfr_cache(qdata), axfr, serial_from,
+	                                   serial_to, pkt->size);
+}
+
+void xfr_cache_release(struct xfr_proc *xfer)
+{
+	xfr_cache_entry_release(xfer->cached);
+	xfer->cached = NULL;
+	xfr_cache_entry_release(xfer->render);
+	xfer->render = NULL;
+}
+
+/*! \brief Puts next cached message into the packet. */
+static int put_cached(knot_pkt_t *pkt, struct xfr_proc *xfer, knotd_qdata_t *qdata)
+{
+	xfr_cache_entry_t *entry = xfer->cached;
+	const xfr_cache_msg_t *msg = &entry->msgs[xfer->cached_next];
+	if (pkt->size != entry->qsize ||
+	    pkt->size + msg->len > pkt->max_size - pkt->reserved) {
+		return KNOT_ENOXFR;
+	}
+
+	memcpy(pkt->wire + pkt->size, msg->data, msg->len);
+	pkt->size += msg->len;
+	knot_wire_set_ancount(pkt->wire, msg->ancount);
+
+	xfr_stats_add(&xfer->stats, pkt->size + knot_rrset_size(&qdata->opt_rr));
+
+	return ++xfer->cached_next < entry->count ? KNOT_ESPACE : KNOT_EOK;
+}
+
+/*! \brief Stores the answer section of the rendered message into the cache entry. */
+static void render_add(knot_pkt_t *pkt, struct xfr_proc *xfer, knotd_qdata_t *qdata,
+                       bool last)
+{
+	xfr_cache_entry_t *entry = xfer->render;
+	if (pkt->size < entry->qsize ||
+	    xfr_cache_entry_add(entry, pkt->wire + entry->qsize, pkt->size - entry->qsize,
+	                        knot_wire_get_ancount(pkt->wire)) != KNOT_EOK) {
+		xfr_cache_entry_release(entry);
+	} else if (last) {
+		xfr_cache_put(zone_xfr_cache(qdata), entry);
+	} else {
+		return;
+	}
+	xfer->render = NULL;
+}
 
 int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata)
 {
@@ -32,6 +119,11 @@ int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata)
 	if (contents == NULL) {
 		return KNOT_ENOZONE;
 	}
+
+	if (xfer->cached != NULL) {
+		return put_cached(pkt, xfer, qdata);
+	}
+
 	knot_rrset_t soa_rr = node_rrset(contents->apex, KNOT_RRTYPE_SOA);
 
 	/* Prepend SOA on first packet. */
@@ -69,6 +161,10 @@ int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata)
 		return KNOT_ENOXFR;
 	}
 
+	if (xfer->render != NULL && (ret == KNOT_EOK || ret == KNOT_ESPACE)) {
+		render_add(pkt, xfer, qdata, ret == KNOT_EOK);
+	}
+
 	return ret;
 }
 
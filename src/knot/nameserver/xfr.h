@@ -20,6 +20,7 @@
 #include "contrib/ucw/lists.h"
 #include "knot/nameserver/log.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/nameserver/xfr_cache.h"
 #include "knot/zone/contents.h"
 #include "libknot/packet/pkt.h"
 
@@ -52,6 +53,9 @@ struct xfr_proc {
 	list_t nodes;               //!< Items to process (ptrnode_t).
 	zone_contents_t *contents;  //!< Processed zone.
 	struct xfr_stats stats;     //!< Packet transfer statistics.
+	xfr_cache_entry_t *cached;  //!< Cached messages to be sent instead of the items.
+	size_t cached_next;         //!< Next cached message.
+	xfr_cache_entry_t *render;  //!< Messages being rendered for the cache.
 };
 
 /*!
@@ -64,6 +68,36 @@ typedef int (*xfr_put_cb)(knot_pkt_t *pkt, const void *item, struct xfr_proc *xf
 /*!
  * \brief Put all items from xfr_proc.nodes to packet using a callback function.
  *
+ * If the transfer is cached, the cached messages are put instead. Otherwise
+ * the messages are rendered into the cache if prepared by xfr_cache_render().
+ *
  * \note qdata->extra->ext points to struct xfr_proc* (this is xfer-specific context)
  */
 int xfr_process_list(knot_pkt_t *pkt, xfr_put_cb put, knotd_qdata_t *qdata);
+
+/*!
+ * \brief Looks up the transfer of the current zone contents in the zone cache.
+ *
+ * \param xfer         Transfer processing state.
+ * \param pkt          First response packet (with the question only).
+ * \param qdata        Query data.
+ * \param axfr         AXFR or IXFR.
+ * \param serial_from  Starting serial of the IXFR.
+ *
+ * \return True if the cached messages are to be sent.
+ */
+bool xfr_cache_lookup(struct xfr_proc *xfer, knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      bool axfr, uint32_t serial_from);
+
+/*!
+ * \brief Prepares rendering of the transfer messages into the zone cache.
+ *
+ * \see xfr_cache_lookup()
+ */
+void xfr_cache_render(struct xfr_proc *xfer, knot_pkt_t *pkt, knotd_qdata_t *qdata,
+                      bool axfr, uint32_t serial_from);
+
+/*!
+ * \brief Releases the cached or rendered transfer messages.
+ */
+void xfr_cache_release(struct xfr_proc *xfer);
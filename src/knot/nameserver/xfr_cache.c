@@ -0,0 +1,224 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/xfr_cache.h"
+#include "libknot/errcode.h"
+
+struct xfr_cache {
+	pthread_mutex_t lock;
+	xfr_cache_entry_t *axfr;
+	xfr_cache_entry_t *entries[XFR_CACHE_IXFR_ENTRIES];
+	unsigned next;          // IXFR entry to be replaced next.
+	uint64_t generation;    // Incremented on each clear.
+};
+
+xfr_cache_t *xfr_cache_new(void)
+{
+	xfr_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+void xfr_cache_free(xfr_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	xfr_cache_clear(cache);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+void xfr_cache_clear(xfr_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	xfr_cache_entry_release(cache->axfr);
+	cache->axfr = NULL;
+	for (unsigned i = 0; i < XFR_CACHE_IXFR_ENTRIES; i++) {
+		xfr_cache_entry_release(cache->entries[i]);
+		cache->entries[i] = NULL;
+	}
+	cache->generation++;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+static bool entry_match(const xfr_cache_entry_t *entry, bool axfr,
+                        uint32_t serial_from, uint32_t serial_to)
+{
+	return entry != NULL && entry->axfr == axfr && entry->serial_to == serial_to &&
+	       (axfr || entry->serial_from == serial_from);
+}
+
+/*! \brief Finds the matching entry, cache must be locked. */
+static xfr_cache_entry_t *entry_find(xfr_cache_t *cache, bool axfr,
+                                     uint32_t serial_from, uint32_t serial_to)
+{
+	if (axfr) {
+		return entry_match(cache->axfr, axfr, serial_from, serial_to) ?
+		       cache->axfr : NULL;
+	}
+
+	for (unsigned i = 0; i < XFR_CACHE_IXFR_ENTRIES; i++) {
+		xfr_cache_entry_t *entry = cache->entries[i];
+		if (entry_match(entry, axfr, serial_from, serial_to)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+xfr_cache_entry_t *xfr_cache_get(xfr_cache_t *cache, bool axfr, uint32_t serial_from,
+                                 uint32_t serial_to)
+{
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	xfr_cache_entry_t *found = entry_find(cache, axfr, serial_from, serial_to);
+	if (found != NULL) {
+		__atomic_add_fetch(&found->refcount, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	return found;
+}
+
+void xfr_cache_put(xfr_cache_t *cache, xfr_cache_entry_t *entry)
+{
+	if (entry == NULL) {
+		return;
+	} else if (cache == NULL) {
+		xfr_cache_entry_release(entry);
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (entry->generation != cache->generation) {
+		// Rendered from outdated contents.
+		pthread_mutex_unlock(&cache->lock);
+		xfr_cache_entry_release(entry);
+		return;
+	}
+	if (entry_find(cache, entry->axfr, entry->serial_from, entry->serial_to) != NULL) {
+		// Rendered concurrently by another transfer.
+		pthread_mutex_unlock(&cache->lock);
+		xfr_cache_entry_release(entry);
+		return;
+	}
+	if (entry->axfr) {
+		xfr_cache_entry_release(cache->axfr);
+		cache->axfr = entry;
+	} else {
+		xfr_cache_entry_release(cache->entries[cache->next]);
+		cache->entries[cache->next] = entry;
+		cache->next = (cache->next + 1) % XFR_CACHE_IXFR_ENTRIES;
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+xfr_cache_entry_t *xfr_cache_entry_new(xfr_cache_t *cache, bool axfr, uint32_t serial_from,
+                                       uint32_t serial_to, uint16_t qsize)
+{
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	xfr_cache_entry_t *entry = calloc(1, sizeof(*entry));
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	entry->axfr = axfr;
+	entry->serial_from = serial_from;
+	entry->serial_to = serial_to;
+	entry->qsize = qsize;
+	entry->max_total = axfr ? XFR_CACHE_AXFR_MAX_SIZE : XFR_CACHE_IXFR_MAX_SIZE;
+	entry->refcount = 1;
+
+	pthread_mutex_lock(&cache->lock);
+	entry->generation = cache->generation;
+	pthread_mutex_unlock(&cache->lock);
+
+	return entry;
+}
+
+int xfr_cache_entry_add(xfr_cache_entry_t *entry, const uint8_t *data, size_t len,
+                        uint16_t ancount)
+{
+	if (entry == NULL || data == NULL || len > UINT16_MAX) {
+		return KNOT_EINVAL;
+	}
+
+	if (entry->total + len > entry->max_total) {
+		return KNOT_ESPACE;
+	}
+
+	if (entry->count == entry->allocd) {
+		size_t allocd = entry->allocd == 0 ? 8 : 2 * entry->allocd;
+		xfr_cache_msg_t *msgs = realloc(entry->msgs, allocd * sizeof(*msgs));
+		if (msgs == NULL) {
+			return KNOT_ENOMEM;
+		}
+		entry->msgs = msgs;
+		entry->allocd = allocd;
+	}
+
+	xfr_cache_msg_t *msg = &entry->msgs[entry->count];
+	msg->data = malloc(len);
+	if (msg->data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(msg->data, data, len);
+	msg->len = len;
+	msg->ancount = ancount;
+
+	entry->count++;
+	entry->total += len;
+	if (len > entry->max_len) {
+		entry->max_len = len;
+	}
+
+	return KNOT_EOK;
+}
+
+void xfr_cache_entry_release(xfr_cache_entry_t *entry)
+{
+	if (entry == NULL ||
+	    __atomic_sub_fetch(&entry->refcount, 1, __ATOMIC_ACQ_REL) > 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < entry->count; i++) {
+		free(entry->msgs[i].data);
+	}
+	free(entry->msgs);
+	free(entry);
+}
@@ -0,0 +1,134 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Per-zone cache of rendered outgoing transfer messages.
+ *
+ * The answer sections of all messages of a finished AXFR or IXFR are stored,
+ * so following requests for the same zone version (and IXFR serial range) are
+ * served without walking the zone tree or reading the journal. The cache is
+ * emptied on each contents switch.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*! \brief Maximum number of cached IXFR serial ranges per zone. */
+#define XFR_CACHE_IXFR_ENTRIES	4
+/*! \brief Maximum total size of the messages of one cached IXFR. */
+#define XFR_CACHE_IXFR_MAX_SIZE	(16 * 1024 * 1024)
+/*! \brief Maximum total size of the messages of the cached AXFR. */
+#define XFR_CACHE_AXFR_MAX_SIZE	(64 * 1024 * 1024)
+
+typedef struct {
+	uint8_t *data;      //!< Answer section wire (compression relative to the message start).
+	uint16_t len;
+	uint16_t ancount;
+} xfr_cache_msg_t;
+
+typedef struct {
+	bool axfr;              //!< AXFR or IXFR messages.
+	uint32_t serial_from;   //!< IXFR starting serial.
+	uint32_t serial_to;
+	uint16_t qsize;         //!< Header and question size the messages were rendered with.
+	uint64_t generation;    //!< Cache generation the rendering started in.
+	uint16_t max_len;       //!< Length of the longest message.
+	size_t total;           //!< Total size of the messages.
+	size_t max_total;       //!< Size limit of the messages.
+	size_t count;           //!< Number of messages.
+	size_t allocd;
+	xfr_cache_msg_t *msgs;
+	int refcount;
+} xfr_cache_entry_t;
+
+typedef struct xfr_cache xfr_cache_t;
+
+/*!
+ * \brief Creates an empty transfer cache.
+ */
+xfr_cache_t *xfr_cache_new(void);
+
+/*!
+ * \brief Frees the transfer cache, the referenced entries are freed once released.
+ */
+void xfr_cache_free(xfr_cache_t *cache);
+
+/*!
+ * \brief Drops all the cached transfers.
+ */
+void xfr_cache_clear(xfr_cache_t *cache);
+
+/*!
+ * \brief Finds a cached transfer and references it.
+ *
+ * \param cache        Transfer cache.
+ * \param axfr         Find AXFR (serial_from ignored) or IXFR.
+ * \param serial_from  Requested IXFR starting serial.
+ * \param serial_to    Current zone serial.
+ *
+ * \return Referenced entry (to be released) or NULL if not cached.
+ */
+xfr_cache_entry_t *xfr_cache_get(xfr_cache_t *cache, bool axfr, uint32_t serial_from,
+                                 uint32_t serial_to);
+
+/*!
+ * \brief Stores a completely rendered transfer into the cache.
+ *
+ * \note The caller's reference is taken over by the cache.
+ *
+ * \param cache  Transfer cache.
+ * \param entry  Rendered transfer.
+ */
+void xfr_cache_put(xfr_cache_t *cache, xfr_cache_entry_t *entry);
+
+/*!
+ * \brief Creates a new referenced entry for rendering a transfer.
+ *
+ * \note The entry isn't stored if the cache is cleared meanwhile.
+ *
+ * \param cache        Transfer cache.
+ * \param axfr         AXFR or IXFR is rendered.
+ * \param serial_from  Starting serial of the IXFR.
+ * \param serial_to    Ending serial of the transfer.
+ * \param qsize        Size of the message header and question.
+ *
+ * \return New entry or NULL.
+ */
+xfr_cache_entry_t *xfr_cache_entry_new(xfr_cache_t *cache, bool axfr, uint32_t serial_from,
+                                       uint32_t serial_to, uint16_t qsize);
+
+/*!
+ * \brief Appends a rendered message answer section to the entry.
+ *
+ * \param entry    Entry being rendered.
+ * \param data     Answer section wire.
+ * \param len      Answer section size.
+ * \param ancount  Number of answer records.
+ *
+ * \retval KNOT_EOK if stored.
+ * \retval KNOT_ESPACE if the transfer is too large to be cached.
+ * \retval KNOT_ENOMEM
+ */
+int xfr_cache_entry_add(xfr_cache_entry_t *entry, const uint8_t *data, size_t len,
+                        uint16_t ancount);
+
+/*!
+ * \brief Releases a reference to the entry.
+ */
+void xfr_cache_entry_release(xfr_cache_entry_t *entry);
@@ -0,0 +1,371 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "knot/query/mux.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/lists.h"
+#include "knot/common/unreachable.h"
+#include "libdnssec/random.h"
+#include "libknot/errcode.h"
+
+query_mux_t *global_query_mux = NULL;
+
+typedef struct {
+	node_t n;
+	struct sockaddr_storage src;
+	struct sockaddr_storage dst;
+	int fd;
+	bool broken;       // The connection failed.
+	bool retired;      // The connection can't be used for new queries.
+	bool reading;      // Some waiting requestor is reading the connection.
+	list_t waits;      // Registered in-flight queries.
+	knot_time_t last_active;
+	pthread_mutex_t send_lock;
+	pthread_cond_t cond;
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+} mux_conn_t;
+
+struct query_mux_wait {
+	node_t n;
+	mux_conn_t *conn;
+	knot_pkt_t *query;
+	knot_pkt_t *resp;
+	uint8_t *data;     // Received response.
+	int ret;           // Response size or error.
+	bool done;
+};
+
+struct query_mux {
+	pthread_mutex_t lock;
+	list_t conns;
+	knot_timediff_t timeout;
+};
+
+static void conn_free(mux_conn_t *conn)
+{
+	rem_node(&conn->n);
+	close(conn->fd);
+	pthread_mutex_destroy(&conn->send_lock);
+	pthread_cond_destroy(&conn->cond);
+	free(conn);
+}
+
+/*! \brief Fails all the in-flight queries, the mux must be locked. */
+static void conn_fail(mux_conn_t *conn, int ret)
+{
+	conn->retired = true;
+	if (!conn->broken) {
+		conn->broken = true;
+		// Wake up the reader, the socket is closed once unused.
+		(void)shutdown(conn->fd, SHUT_RDWR);
+	}
+
+	query_mux_wait_t *w;
+	WALK_LIST(w, conn->waits) {
+		if (!w->done) {
+			w->ret = ret;
+			w->done = true;
+		}
+	}
+	pthread_cond_broadcast(&conn->cond);
+}
+
+static query_mux_wait_t *conn_find(mux_conn_t *conn, uint16_t id)
+{
+	query_mux_wait_t *w;
+	WALK_LIST(w, conn->waits) {
+		if (knot_wire_get_id(w->query->wire) == id) {
+			return w;
+		}
+	}
+	return NULL;
+}
+
+/*! \brief Dispatches the received message to its query, the mux must be locked. */
+static void conn_dispatch(mux_conn_t *conn, size_t len)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE) {
+		conn_fail(conn, KNOT_EMALF);
+		return;
+	}
+
+	query_mux_wait_t *w = conn_find(conn, knot_wire_get_id(conn->buf));
+	if (w == NULL || w->done) {
+		return; // Unsolicited or late response.
+	}
+
+	if (len > w->resp->max_size) {
+		w->ret = KNOT_ESPACE;
+	} else if ((w->data = malloc(len)) == NULL) {
+		w->ret = KNOT_ENOMEM;
+	} else {
+		memcpy(w->data, conn->buf, len);
+		w->ret = len;
+	}
+	w->done = true;
+}
+
+/*! \brief Closes unused connections, the mux must be locked. */
+static void mux_sweep(query_mux_t *mux)
+{
+	knot_time_t now = knot_time();
+
+	mux_conn_t *conn, *nxt;
+	WALK_LIST_DELSAFE(conn, nxt, mux->conns) {
+		if (EMPTY_LIST(conn->waits) &&
+		    (conn->retired || knot_time_diff(now, conn->last_active) >= mux->timeout)) {
+			conn_free(conn);
+		}
+	}
+}
+
+static mux_conn_t *mux_connect(query_mux_t *mux, const struct sockaddr_storage *src,
+                               const struct sockaddr_storage *dst, int *ret)
+{
+	if (knot_unreachable_is(global_unreachables, dst, src)) {
+		*ret = KNOT_EUNREACH;
+		return NULL;
+	}
+
+	mux_conn_t *conn = calloc(1, sizeof(*conn));
+	if (conn == NULL) {
+		*ret = KNOT_ENOMEM;
+		return NULL;
+	}
+
+	conn->fd = net_connected_socket(SOCK_STREAM, dst, src, false);
+	if (conn->fd < 0) {
+		if (conn->fd == KNOT_ETIMEOUT) {
+			knot_unreachable_add(global_unreachables, dst, src);
+		}
+		*ret = conn->fd;
+		free(conn);
+		return NULL;
+	}
+
+	memcpy(&conn->src, src, sizeof(conn->src));
+	memcpy(&conn->dst, dst, sizeof(conn->dst));
+	conn->last_active = knot_time();
+	init_list(&conn->waits);
+	pthread_mutex_init(&conn->send_lock, NULL);
+	pthread_cond_init(&conn->cond, NULL);
+	add_tail(&mux->conns, &conn->n);
+
+	return conn;
+}
+
+query_mux_t *query_mux_init(knot_timediff_t timeout)
+{
+	query_mux_t *mux = calloc(1, sizeof(*mux));
+	if (mux == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_init(&mux->lock, NULL);
+	init_list(&mux->conns);
+	mux->timeout = timeout;
+
+	return mux;
+}
+
+void query_mux_deinit(query_mux_t *mux)
+{
+	if (mux == NULL) {
+		return;
+	}
+
+	mux_conn_t *conn, *nxt;
+	WALK_LIST_DELSAFE(conn, nxt, mux->conns) {
+		assert(EMPTY_LIST(conn->waits));
+		conn_free(conn);
+	}
+	pthread_mutex_destroy(&mux->lock);
+	free(mux);
+}
+
+void query_mux_timeout(query_mux_t *mux, knot_timediff_t timeout)
+{
+	if (mux == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&mux->lock);
+	mux->timeout = timeout;
+	pthread_mutex_unlock(&mux->lock);
+}
+
+int query_mux_register(query_mux_t *mux, const struct sockaddr_storage *src,
+                       const struct sockaddr_storage *dst, knot_pkt_t *query,
+                       knot_pkt_t *resp, bool *reused, query_mux_wait_t **wait)
+{
+	if (mux == NULL || src == NULL || dst == NULL || query == NULL ||
+	    resp == NULL || reused == NULL || wait == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	query_mux_wait_t *w = calloc(1, sizeof(*w));
+	if (w == NULL) {
+		return KNOT_ENOMEM;
+	}
+	w->query = query;
+	w->resp = resp;
+
+	pthread_mutex_lock(&mux->lock);
+	mux_sweep(mux);
+
+	mux_conn_t *conn = NULL, *it;
+	WALK_LIST(it, mux->conns) {
+		if (!it->retired && sockaddr_cmp(&it->dst, dst, false) == 0 &&
+		    sockaddr_cmp(&it->src, src, false) == 0) {
+			conn = it;
+			break;
+		}
+	}
+	*reused = (conn != NULL);
+	if (conn == NULL) {
+		int ret = KNOT_EOK;
+		conn = mux_connect(mux, src, dst, &ret);
+		if (conn == NULL) {
+			pthread_mutex_unlock(&mux->lock);
+			free(w);
+			return ret;
+		}
+	}
+
+	// The message ID must be unique among the in-flight queries.
+	while (conn_find(conn, knot_wire_get_id(query->wire)) != NULL) {
+		knot_wire_set_id(query->wire, dnssec_random_uint16_t());
+	}
+
+	w->conn = conn;
+	add_tail(&conn->waits, &w->n);
+	pthread_mutex_unlock(&mux->lock);
+
+	*wait = w;
+
+	return KNOT_EOK;
+}
+
+int query_mux_send(query_mux_t *mux, query_mux_wait_t *wait, int timeout_ms)
+{
+	if (mux == NULL || wait == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	mux_conn_t *conn = wait->conn;
+	knot_pkt_t *query = wait->query;
+
+	pthread_mutex_lock(&conn->send_lock);
+	ssize_t ret = net_dns_tcp_send(conn->fd, query->wire, query->size, timeout_ms, NULL);
+	pthread_mutex_unlock(&conn->send_lock);
+
+	if (ret == query->size) {
+		return KNOT_EOK;
+	}
+
+	if (ret >= 0) {
+		ret = KNOT_ECONN;
+	} else if (ret == KNOT_ETIMEOUT) {
+		knot_unreachable_add(global_unreachables, &conn->dst, &conn->src);
+	}
+	pthread_mutex_lock(&mux->lock);
+	conn_fail(conn, ret);
+	pthread_mutex_unlock(&mux->lock);
+
+	return ret;
+}
+
+int query_mux_recv(query_mux_t *mux, query_mux_wait_t *wait, int timeout_ms)
+{
+	if (mux == NULL || wait == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	mux_conn_t *conn = wait->conn;
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += timeout_ms / 1000;
+	deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&mux->lock);
+	while (!wait->done) {
+		if (!conn->reading) {
+			// Take the reading turn, the responses are dispatched to all the queries.
+			conn->reading = true;
+			pthread_mutex_unlock(&mux->lock);
+			ssize_t ret = net_dns_tcp_recv(conn->fd, conn->buf, sizeof(conn->buf), timeout_ms);
+			pthread_mutex_lock(&mux->lock);
+			conn->reading = false;
+			if (ret <= 0) {
+				conn_fail(conn, ret == 0 ? KNOT_ECONN : ret);
+			} else {
+				conn_dispatch(conn, ret);
+				conn->last_active = knot_time();
+			}
+			pthread_cond_broadcast(&conn->cond);
+		} else if (timeout_ms >= 0 &&
+		           pthread_cond_timedwait(&conn->cond, &mux->lock, &deadline) == ETIMEDOUT) {
+			wait->ret = KNOT_ETIMEOUT;
+			wait->done = true;
+			// A late response mustn't be matched with a query reusing the ID.
+			conn->retired = true;
+		} else if (timeout_ms < 0) {
+			pthread_cond_wait(&conn->cond, &mux->lock);
+		}
+	}
+	pthread_mutex_unlock(&mux->lock);
+
+	int ret = wait->ret;
+	if (ret > 0) {
+		knot_pkt_clear(wait->resp);
+		memcpy(wait->resp->wire, wait->data, ret);
+		wait->resp->size = ret;
+	}
+	free(wait->data);
+	wait->data = NULL;
+
+	return ret;
+}
+
+void query_mux_unregister(query_mux_t *mux, query_mux_wait_t *wait)
+{
+	if (mux == NULL || wait == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&mux->lock);
+	rem_node(&wait->n);
+	wait->conn->last_active = knot_time();
+	pthread_mutex_unlock(&mux->lock);
+
+	free(wait->data);
+	free(wait);
+}
@@ -0,0 +1,96 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Multiplexing of outgoing queries over shared TCP connections.
+ *
+ * Concurrent requests to the same remote are pipelined over one kept-open
+ * TCP connection. Each in-flight query gets a message ID unique within its
+ * connection and the responses are dispatched by the ID. There is no extra
+ * thread, the waiting requestors take turns in reading the connection.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "contrib/time.h"
+#include "libknot/packet/pkt.h"
+
+typedef struct query_mux query_mux_t;
+typedef struct query_mux_wait query_mux_wait_t;
+
+extern query_mux_t *global_query_mux;
+
+/*!
+ * \brief Allocate the query multiplexer.
+ *
+ * \param timeout  Timeout for closing unused connections (in seconds).
+ *
+ * \return Multiplexer or NULL if error.
+ */
+query_mux_t *query_mux_init(knot_timediff_t timeout);
+
+/*!
+ * \brief Close all the connections and deallocate the multiplexer.
+ *
+ * \note There mustn't be any requests in progress.
+ */
+void query_mux_deinit(query_mux_t *mux);
+
+/*!
+ * \brief Set the timeout for closing unused connections.
+ */
+void query_mux_timeout(query_mux_t *mux, knot_timediff_t timeout);
+
+/*!
+ * \brief Register a query before sending, sets its message ID.
+ *
+ * \note The query must be signed afterwards as its ID can be changed.
+ *
+ * \param mux     Multiplexer.
+ * \param src     Source address (may be AF_UNSPEC).
+ * \param dst     Remote address.
+ * \param query   Query to be sent.
+ * \param resp    Packet to receive the response into.
+ * \param reused  Out: an already open connection is used.
+ * \param wait    Out: registered in-flight query.
+ *
+ * \return KNOT_E*
+ */
+int query_mux_register(query_mux_t *mux, const struct sockaddr_storage *src,
+                       const struct sockaddr_storage *dst, knot_pkt_t *query,
+                       knot_pkt_t *resp, bool *reused, query_mux_wait_t **wait);
+
+/*!
+ * \brief Send the registered query.
+ *
+ * \return KNOT_E*
+ */
+int query_mux_send(query_mux_t *mux, query_mux_wait_t *wait, int timeout_ms);
+
+/*!
+ * \brief Wait for the response of the registered query.
+ *
+ * \return Response size or KNOT_E*.
+ */
+int query_mux_recv(query_mux_t *mux, query_mux_wait_t *wait, int timeout_ms);
+
+/*!
+ * \brief Unregister the query, the connection is kept open for other queries.
+ */
+void query_mux_unregister(query_mux_t *mux, query_mux_wait_t *wait);
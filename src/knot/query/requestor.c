@@ -15,6 +15,9 @@
  */
 
 #include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
 
 #include "libknot/attribute.h"
 #include "knot/common/unreachable.h"
@@ -24,12 +27,31 @@
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
 #include "contrib/sockaddr.h"
+#include "contrib/time.h"
 
 static bool use_tcp(knot_request_t *request)
 {
 	return (request->flags & KNOT_REQUEST_UDP) == 0;
 }
 
+/*!
+ * \brief Check if the request uses a shared connection.
+ *
+ * The multiplexing is applicable to single-message exchanges only, thus
+ * it's turned off if the processing continues with another query.
+ */
+static bool use_mux(knot_request_t *request)
+{
+	return use_tcp(request) && (request->flags & KNOT_REQUEST_MUX) &&
+	       global_query_mux != NULL;
+}
+
+static void request_mux_end(knot_request_t *request)
+{
+	query_mux_unregister(global_query_mux, request->mux_wait);
+	request->mux_wait = NULL;
+}
+
 static bool is_answer_to_query(const knot_pkt_t *query, const knot_pkt_t *answer)
 {
 	return knot_wire_get_id(query->wire) == knot_wire_get_id(answer->wire);
@@ -115,6 +137,18 @@ static int request_send(knot_request_t *request, int timeout_ms, bool *reused_fd
 static int request_recv(knot_request_t *request, int timeout_ms)
 {
 	knot_pkt_t *resp = request->resp;
+
+	/* Wait for the response dispatched from the shared connection. */
+	if (request->mux_wait != NULL) {
+		int ret = query_mux_recv(global_query_mux, request->mux_wait, timeout_ms);
+		request_mux_end(request);
+		if (ret <= 0) {
+			resp->size = 0;
+			return (ret == 0) ? KNOT_ECONN : ret;
+		}
+		return ret;
+	}
+
 	knot_pkt_clear(resp);
 
 	/* Wait for readability */
@@ -187,6 +221,8 @@ void knot_request_free(knot_request_t *request, knot_mm_t *mm)
 		return;
 	}
 
+	request_mux_end(request);
+
 	if (request->fd >= 0 && use_tcp(request) &&
 	    (request->flags & KNOT_REQUEST_KEEP)) {
 		request->fd = conn_pool_put(global_conn_pool,
@@ -237,6 +273,10 @@ static int request_reset(knot_requestor_t *req, knot_request_t *last)
 	knot_layer_reset(&req->layer);
 	tsig_reset(&last->tsig);
 
+	/* The following exchange needs its own connection. */
+	request_mux_end(last);
+	last->flags &= ~KNOT_REQUEST_MUX;
+
 	if (req->layer.flags & KNOT_REQUESTOR_CLOSE) {
 		req->layer.flags &= ~KNOT_REQUESTOR_CLOSE;
 		if (last->fd >= 0) {
@@ -257,6 +297,18 @@ static int request_produce(knot_requestor_t *req, knot_request_t *last,
 {
 	knot_layer_produce(&req->layer, last->query);
 
+	/* Register on a shared connection, the query ID may change. */
+	bool mux = (req->layer.state == KNOT_STATE_CONSUME && use_mux(last));
+	bool reused_fd = false;
+	if (mux) {
+		int ret = query_mux_register(global_query_mux, &last->source,
+		                             &last->remote, last->query, last->resp,
+		                             &reused_fd, &last->mux_wait);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
 	int ret = tsig_sign_packet(&last->tsig, last->query);
 	if (ret != KNOT_EOK) {
 		return ret;
@@ -264,8 +316,11 @@ static int request_produce(knot_requestor_t *req, knot_request_t *last,
 
 	// TODO: verify condition
 	if (req->layer.state == KNOT_STATE_CONSUME) {
-		bool reused_fd = false;
-		ret = request_send(last, timeout_ms, &reused_fd);
+		if (mux) {
+			ret = query_mux_send(global_query_mux, last->mux_wait, timeout_ms);
+		} else {
+			ret = request_send(last, timeout_ms, &reused_fd);
+		}
 		if (reused_fd) {
 			req->layer.flags |= KNOT_REQUESTOR_REUSED;
 		} else {
@@ -334,6 +389,32 @@ static int request_io(knot_requestor_t *req, knot_request_t *last,
 	}
 }
 
+static int request_finish(knot_requestor_t *requestor, knot_request_t *request,
+                          int ret)
+{
+	if (ret != KNOT_EOK) {
+		knot_layer_finish(&requestor->layer);
+		return ret;
+	}
+
+	/* Expect complete request. */
+	if (requestor->layer.state != KNOT_STATE_DONE) {
+		ret = KNOT_EPROCESSING;
+	} else {
+		request->flags |= KNOT_REQUEST_KEEP;
+	}
+
+	/* Verify last TSIG */
+	if (tsig_unsigned_count(&request->tsig) != 0) {
+		ret = KNOT_TSIG_EBADSIG;
+	}
+
+	/* Finish current query processing. */
+	knot_layer_finish(&requestor->layer);
+
+	return ret;
+}
+
 int knot_requestor_exec(knot_requestor_t *requestor, knot_request_t *request,
                         int timeout_ms)
 {
@@ -349,25 +430,140 @@ int knot_requestor_exec(knot_requestor_t *requestor, knot_request_t *request,
 	while (layer_active(requestor->layer.state)) {
 		ret = request_io(requestor, request, timeout_ms);
 		if (ret != KNOT_EOK) {
-			knot_layer_finish(&requestor->layer);
-			return ret;
+			break;
 		}
 	}
 
-	/* Expect complete request. */
-	if (requestor->layer.state != KNOT_STATE_DONE) {
-		ret = KNOT_EPROCESSING;
-	} else {
-		request->flags |= KNOT_REQUEST_KEEP;
+	return request_finish(requestor, request, ret);
+}
+
+/*! \brief Remaining time of the current operation (-1 for infinity). */
+static int remaining_ms(const struct timespec *start, int timeout_ms)
+{
+	if (timeout_ms < 0) {
+		return -1;
 	}
 
-	/* Verify last TSIG */
-	if (tsig_unsigned_count(&request->tsig) != 0) {
-		ret = KNOT_TSIG_EBADSIG;
+	struct timespec now = time_now();
+	double left = timeout_ms - time_diff_ms(start, &now);
+
+	return (left > 0) ? (int)left : 0;
+}
+
+typedef struct {
+	struct timespec start; /*!< Start of the current operation. */
+	bool done;
+} multi_state_t;
+
+static void multi_done(multi_state_t *st, int *ret_out, knot_requestor_t *req,
+                       knot_request_t *last, int ret, size_t *active)
+{
+	*ret_out = request_finish(req, last, ret);
+	st->done = true;
+	(*active)--;
+}
+
+void knot_requestor_exec_multi(knot_requestor_t *requestors, knot_request_t **requests,
+                               int *rets, size_t count, int timeout_ms)
+{
+	if (requestors == NULL || requests == NULL || rets == NULL || count == 0) {
+		return;
 	}
 
-	/* Finish current query processing. */
-	knot_layer_finish(&requestor->layer);
+	struct pollfd *pfds = malloc(count * sizeof(*pfds));
+	multi_state_t *states = calloc(count, sizeof(*states));
+	if (pfds == NULL || states == NULL) {
+		free(pfds);
+		free(states);
+		for (size_t i = 0; i < count; i++) {
+			rets[i] = knot_requestor_exec(&requestors[i], requests[i], timeout_ms);
+		}
+		return;
+	}
 
-	return ret;
+	/* TFO and shared connections would block in the sending. */
+	for (size_t i = 0; i < count; i++) {
+		requests[i]->flags &= ~(KNOT_REQUEST_TFO | KNOT_REQUEST_MUX);
+		requestors[i].layer.tsig = &requests[i]->tsig;
+		states[i].start = time_now();
+		rets[i] = KNOT_EOK;
+	}
+
+	size_t active = count;
+	while (active > 0) {
+		/* Do the steps which don't wait, prepare polling for the others. */
+		int wait_ms = -1;
+		for (size_t i = 0; i < count; i++) {
+			knot_requestor_t *req = &requestors[i];
+			knot_request_t *last = requests[i];
+			pfds[i].fd = -1; // Ignored by poll.
+			pfds[i].revents = 0;
+			if (states[i].done) {
+				continue;
+			}
+
+			int ret = KNOT_EOK;
+			while (ret == KNOT_EOK && req->layer.state == KNOT_STATE_RESET) {
+				ret = request_reset(req, last);
+			}
+			if (ret == KNOT_EOK && req->layer.state == KNOT_STATE_PRODUCE) {
+				ret = request_ensure_connected(last, NULL);
+			}
+			if (ret != KNOT_EOK || !layer_active(req->layer.state)) {
+				multi_done(&states[i], &rets[i], req, last, ret, &active);
+				continue;
+			}
+
+			int left = remaining_ms(&states[i].start, timeout_ms);
+			if (left == 0) {
+				if (req->layer.state == KNOT_STATE_PRODUCE && use_tcp(last)) {
+					knot_unreachable_add(global_unreachables, &last->remote,
+					                     &last->source);
+				}
+				multi_done(&states[i], &rets[i], req, last, KNOT_ETIMEOUT, &active);
+				continue;
+			}
+			if (left > 0 && (wait_ms < 0 || left < wait_ms)) {
+				wait_ms = left;
+			}
+
+			pfds[i].fd = last->fd;
+			pfds[i].events = (req->layer.state == KNOT_STATE_PRODUCE) ? POLLOUT : POLLIN;
+		}
+		if (active == 0) {
+			break;
+		}
+
+		int ready = poll(pfds, count, wait_ms);
+		if (ready < 0 && errno != EINTR && errno != EAGAIN) {
+			int ret = knot_map_errno();
+			for (size_t i = 0; i < count; i++) {
+				if (!states[i].done) {
+					multi_done(&states[i], &rets[i], &requestors[i],
+					           requests[i], ret, &active);
+				}
+			}
+			break;
+		}
+
+		/* Ready sockets don't block, errors are detected by the I/O itself. */
+		for (size_t i = 0; i < count && ready > 0; i++) {
+			if (pfds[i].fd < 0 || pfds[i].revents == 0) {
+				continue;
+			}
+			ready--;
+
+			knot_requestor_t *req = &requestors[i];
+			knot_request_t *last = requests[i];
+			int ret = request_io(req, last, remaining_ms(&states[i].start, timeout_ms));
+			if (ret != KNOT_EOK) {
+				multi_done(&states[i], &rets[i], req, last, ret, &active);
+			} else {
+				states[i].start = time_now();
+			}
+		}
+	}
+
+	free(pfds);
+	free(states);
 }
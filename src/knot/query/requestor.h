@@ -21,6 +21,7 @@
 
 #include "knot/nameserver/tsig_ctx.h"
 #include "knot/query/layer.h"
+#include "knot/query/mux.h"
 #include "libknot/mm_ctx.h"
 #include "libknot/rrtype/tsig.h"
 
@@ -29,6 +30,7 @@ typedef enum {
 	KNOT_REQUEST_UDP  = 1 << 0,  /*!< Use UDP for requests. */
 	KNOT_REQUEST_TFO  = 1 << 1,  /*!< Enable TCP Fast Open for requests. */
 	KNOT_REQUEST_KEEP = 1 << 2,  /*!< Keep upstream TCP connection in pool for later reuse. */
+	KNOT_REQUEST_MUX  = 1 << 3,  /*!< Share upstream TCP connection with concurrent requests. */
 } knot_request_flag_t;
 
 typedef enum {
@@ -53,6 +55,7 @@ typedef struct {
 	knot_pkt_t *query;
 	knot_pkt_t *resp;
 	tsig_ctx_t tsig;
+	query_mux_wait_t *mux_wait; /*!< In-flight query on a shared connection. */
 
 	knot_sign_context_t sign; /*!< Required for async. DDNS processing. */
 } knot_request_t;
@@ -117,3 +120,19 @@ void knot_requestor_clear(knot_requestor_t *requestor);
 int knot_requestor_exec(knot_requestor_t *requestor,
                         knot_request_t *request,
                         int timeout_ms);
+
+/*!
+ * \brief Execute several requests concurrently.
+ *
+ * All the sockets are connected at once and polled together, each request
+ * proceeds as soon as its socket is ready, so a slow or unreachable remote
+ * doesn't delay the others. TCP Fast Open and shared connections aren't used.
+ *
+ * \param requestors  Requestor instances, one for each request.
+ * \param requests    Request instances.
+ * \param rets        Out: result of each request (KNOT_EOK or error).
+ * \param count       Number of the requests.
+ * \param timeout_ms  Timeout of each operation in milliseconds (-1 for infinity).
+ */
+void knot_requestor_exec_multi(knot_requestor_t *requestors, knot_request_t **requests,
+                               int *rets, size_t count, int timeout_ms);
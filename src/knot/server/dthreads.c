@@ -582,12 +582,8 @@ int dt_stop(dt_unit_t *unit)
 	return KNOT_EOK;
 }
 
-int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
+static int thread_setaffinity(pthread_t thr, const unsigned *cpu_id, size_t cpu_count)
 {
-	if (thread == NULL) {
-		return KNOT_EINVAL;
-	}
-
 #ifdef HAVE_PTHREAD_SETAFFINITY_NP
 	int ret = -1;
 
@@ -598,7 +594,7 @@ int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
 	for (unsigned i = 0; i < cpu_count; ++i) {
 		CPU_SET(cpu_id[i], &set);
 	}
-	ret = pthread_setaffinity_np(thread->_thr, sizeof(cpu_set_t), &set);
+	ret = pthread_setaffinity_np(thr, sizeof(cpu_set_t), &set);
 /* NetBSD interface. */
 #elif defined(HAVE_CPUSET_NETBSD)
 	cpuset_t *set = cpuset_create();
@@ -609,7 +605,7 @@ int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
 	for (unsigned i = 0; i < cpu_count; ++i) {
 		cpuset_set(cpu_id[i], set);
 	}
-	ret = pthread_setaffinity_np(thread->_thr, cpuset_size(set), set);
+	ret = pthread_setaffinity_np(thr, cpuset_size(set), set);
 	cpuset_destroy(set);
 #endif /* interface */
 
@@ -624,6 +620,20 @@ int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
 	return KNOT_EOK;
 }
 
+int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
+{
+	if (thread == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return thread_setaffinity(thread->_thr, cpu_id, cpu_count);
+}
+
+int dt_setaffinity_self(const unsigned *cpu_id, size_t cpu_count)
+{
+	return thread_setaffinity(pthread_self(), cpu_id, cpu_count);
+}
+
 int dt_activate(dthread_t *thread)
 {
 	return dt_update_thread(thread, ThreadActive);
@@ -183,6 +183,18 @@ int dt_stop(dt_unit_t *unit);
  */
 int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count);
 
+/*!
+ * \brief Set affinity of the calling thread to masked CPU's.
+ *
+ * \note This also works for the threads not created as a part of a unit.
+ *
+ * \param cpu_id Array of CPU IDs to set affinity to.
+ * \param cpu_count Number of CPUs in the array.
+ *
+ * \retval KNOT_EOK on success.
+ */
+int dt_setaffinity_self(const unsigned *cpu_id, size_t cpu_count);
+
 /*!
  * \brief Wake up thread from idle state.
  *
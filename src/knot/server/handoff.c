@@ -0,0 +1,332 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "knot/server/handoff.h"
+#include "knot/server/server.h"
+#include "libknot/errcode.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+
+#define HANDOFF_MAGIC    0x4b484f31 // "KHO1"
+#define HANDOFF_READY    'R'
+#define HANDOFF_RELEASED 'F'
+
+/*! \brief Time limit of the socket transfer (in seconds). */
+#define HANDOFF_IO_TIMEOUT 5
+
+typedef struct {
+	uint32_t magic;
+	uint32_t pid;
+	uint32_t count;
+} handoff_hdr_t;
+
+typedef struct {
+	int32_t type;
+	struct sockaddr_storage addr;
+} handoff_rec_t;
+
+static void set_io_timeout(int sock, int timeout)
+{
+	struct timeval tv = { .tv_sec = timeout };
+	(void)setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	(void)setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+static int send_sock(int conn, int fd, int type, const struct sockaddr_storage *addr)
+{
+	handoff_rec_t rec = { .type = type, .addr = *addr };
+	struct iovec iov = { .iov_base = &rec, .iov_len = sizeof(rec) };
+
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} cmsg = { 0 };
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cmsg.buf,
+		.msg_controllen = sizeof(cmsg.buf),
+	};
+	struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+	c->cmsg_level = SOL_SOCKET;
+	c->cmsg_type = SCM_RIGHTS;
+	c->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(c), &fd, sizeof(int));
+
+	return sendmsg(conn, &msg, MSG_NOSIGNAL) == sizeof(rec) ? KNOT_EOK : knot_map_errno();
+}
+
+static int recv_sock(int conn, handoff_sock_t *sock)
+{
+	handoff_rec_t rec;
+	struct iovec iov = { .iov_base = &rec, .iov_len = sizeof(rec) };
+
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		struct cmsghdr align;
+	} cmsg;
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cmsg.buf,
+		.msg_controllen = sizeof(cmsg.buf),
+	};
+
+	ssize_t ret = recvmsg(conn, &msg, 0);
+	if (ret < 0) {
+		return knot_map_errno();
+	}
+
+	int fd = -1;
+	struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+	if (c != NULL && c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_RIGHTS &&
+	    c->cmsg_len == CMSG_LEN(sizeof(int))) {
+		memcpy(&fd, CMSG_DATA(c), sizeof(int));
+	}
+	if (ret != sizeof(rec) || fd < 0 || (msg.msg_flags & MSG_CTRUNC)) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		return KNOT_EMALF;
+	}
+
+	sock->fd = fd;
+	sock->type = rec.type;
+	sock->addr = rec.addr;
+
+	return KNOT_EOK;
+}
+
+int handoff_listen(const char *path)
+{
+	struct sockaddr_storage addr;
+	int ret = sockaddr_set(&addr, AF_UNIX, path, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	int sock = net_bound_socket(SOCK_SEQPACKET, &addr, 0);
+	if (sock < 0) {
+		return sock;
+	}
+
+	if (listen(sock, 1) != 0) {
+		ret = knot_map_errno();
+		close(sock);
+		return ret;
+	}
+
+	return sock;
+}
+
+int handoff_send(int conn, const server_t *server)
+{
+	if (server == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	set_io_timeout(conn, HANDOFF_IO_TIMEOUT);
+
+	handoff_hdr_t hdr = { .magic = HANDOFF_MAGIC, .pid = getpid() };
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		hdr.count += server->ifaces[i].fd_udp_count + server->ifaces[i].fd_tcp_count;
+	}
+	if (send(conn, &hdr, sizeof(hdr), MSG_NOSIGNAL) != sizeof(hdr)) {
+		return knot_map_errno();
+	}
+
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		const iface_t *iface = &server->ifaces[i];
+		for (unsigned j = 0; j < iface->fd_udp_count; j++) {
+			int ret = send_sock(conn, iface->fd_udp[j], SOCK_DGRAM, &iface->addr);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+		for (unsigned j = 0; j < iface->fd_tcp_count; j++) {
+			int ret = send_sock(conn, iface->fd_tcp[j], SOCK_STREAM, &iface->addr);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int handoff_wait_ready(int conn, int timeout_ms)
+{
+	struct pollfd pfd = { .fd = conn, .events = POLLIN };
+	int ret = poll(&pfd, 1, timeout_ms);
+	if (ret == 0 || (ret < 0 && errno == EINTR)) {
+		return KNOT_ETIMEOUT;
+	}
+
+	uint8_t state = 0;
+	if (ret < 0 || recv(conn, &state, sizeof(state), 0) != sizeof(state) ||
+	    state != HANDOFF_READY) {
+		return KNOT_ECONN;
+	}
+
+	return KNOT_EOK;
+}
+
+void handoff_released(int conn)
+{
+	uint8_t state = HANDOFF_RELEASED;
+	(void)send(conn, &state, sizeof(state), MSG_NOSIGNAL);
+	close(conn);
+}
+
+int handoff_connect(const char *path, handoff_t *handoff)
+{
+	if (path == NULL || handoff == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	memset(handoff, 0, sizeof(*handoff));
+	handoff->conn = -1;
+
+	struct sockaddr_storage addr;
+	int ret = sockaddr_set(&addr, AF_UNIX, path, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	int conn = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	if (conn < 0) {
+		return knot_map_errno();
+	}
+	if (connect(conn, (struct sockaddr *)&addr, sockaddr_len(&addr)) != 0) {
+		ret = (errno == ENOENT || errno == ECONNREFUSED) ? KNOT_ECONN : knot_map_errno();
+		close(conn);
+		return ret;
+	}
+
+	set_io_timeout(conn, HANDOFF_IO_TIMEOUT);
+
+	handoff_hdr_t hdr;
+	if (recv(conn, &hdr, sizeof(hdr), 0) != sizeof(hdr) || hdr.magic != HANDOFF_MAGIC) {
+		close(conn);
+		return KNOT_EMALF;
+	}
+
+	handoff->socks = calloc(hdr.count, sizeof(*handoff->socks));
+	if (handoff->socks == NULL && hdr.count > 0) {
+		close(conn);
+		return KNOT_ENOMEM;
+	}
+	handoff->conn = conn;
+	handoff->pid = hdr.pid;
+
+	for (; handoff->count < hdr.count; handoff->count++) {
+		ret = recv_sock(conn, &handoff->socks[handoff->count]);
+		if (ret != KNOT_EOK) {
+			handoff_deinit(handoff);
+			return ret;
+		}
+	}
+
+	// Waiting for the release isn't limited by the transfer timeout.
+	set_io_timeout(conn, 0);
+
+	return KNOT_EOK;
+}
+
+int handoff_take(handoff_t *handoff, int type, const struct sockaddr_storage *addr)
+{
+	if (handoff == NULL || addr == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	for (size_t i = 0; i < handoff->count; i++) {
+		handoff_sock_t *sock = &handoff->socks[i];
+		if (sock->fd >= 0 && sock->type == type &&
+		    sockaddr_cmp(&sock->addr, addr, false) == 0) {
+			int fd = sock->fd;
+			sock->fd = -1;
+			return fd;
+		}
+	}
+
+	return KNOT_ENOENT;
+}
+
+void handoff_close_unused(handoff_t *handoff)
+{
+	if (handoff == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < handoff->count; i++) {
+		if (handoff->socks[i].fd >= 0) {
+			close(handoff->socks[i].fd);
+			handoff->socks[i].fd = -1;
+		}
+	}
+}
+
+int handoff_ready(handoff_t *handoff, int timeout)
+{
+	if (handoff == NULL || handoff->conn < 0) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t state = HANDOFF_READY;
+	int ret = KNOT_EOK;
+	if (send(handoff->conn, &state, sizeof(state), MSG_NOSIGNAL) != sizeof(state)) {
+		ret = knot_map_errno();
+	} else {
+		struct pollfd pfd = { .fd = handoff->conn, .events = POLLIN };
+		int polled = poll(&pfd, 1, timeout * 1000);
+		if (polled == 0) {
+			ret = KNOT_ETIMEOUT;
+		} else if (polled < 0 ||
+		           recv(handoff->conn, &state, sizeof(state), 0) != sizeof(state) ||
+		           state != HANDOFF_RELEASED) {
+			ret = KNOT_ECONN;
+		}
+	}
+
+	close(handoff->conn);
+	handoff->conn = -1;
+
+	return ret;
+}
+
+void handoff_deinit(handoff_t *handoff)
+{
+	if (handoff == NULL) {
+		return;
+	}
+
+	handoff_close_unused(handoff);
+	free(handoff->socks);
+	if (handoff->conn >= 0) {
+		close(handoff->conn);
+	}
+
+	memset(handoff, 0, sizeof(*handoff));
+	handoff->conn = -1;
+}
@@ -0,0 +1,146 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Hand-over of the bound sockets to a successor server (hot restart).
+ *
+ * The running server (predecessor) listens on a UNIX socket. The successor
+ * connects to it and receives duplicates of the bound UDP and TCP sockets
+ * (SCM_RIGHTS), so no query or connection attempt is refused meanwhile.
+ * Once the successor has loaded its zones and serves the sockets, it reports
+ * ready. The predecessor releases its control and hand-over sockets, confirms
+ * it, and drains the pending TCP connections and zone transfers.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+struct server;
+
+/*! \brief Hand-over socket file name in the run directory. */
+#define HANDOFF_SOCKET "knot.handoff"
+
+/*! \brief Time to wait for the predecessor to release its sockets (in seconds). */
+#define HANDOFF_RELEASE_TIMEOUT 10
+
+/*! \brief Time to wait for the pending connections of the predecessor (in seconds). */
+#define HANDOFF_DRAIN_TIMEOUT 60
+
+/*! \brief Socket handed over from the predecessor. */
+typedef struct {
+	int fd;                       /*!< Socket descriptor, -1 if taken. */
+	int type;                     /*!< SOCK_DGRAM or SOCK_STREAM. */
+	struct sockaddr_storage addr; /*!< Bound address. */
+} handoff_sock_t;
+
+/*! \brief Successor side of the hand-over. */
+typedef struct {
+	int conn;               /*!< Connection to the predecessor, -1 if none. */
+	pid_t pid;              /*!< Predecessor PID. */
+	handoff_sock_t *socks;  /*!< Received sockets. */
+	size_t count;           /*!< Number of the received sockets. */
+} handoff_t;
+
+/*!
+ * \brief Binds the hand-over socket of the running server.
+ *
+ * \param path  Hand-over socket path.
+ *
+ * \return Listening socket or KNOT_E*.
+ */
+int handoff_listen(const char *path);
+
+/*!
+ * \brief Sends the bound UDP and TCP sockets of the server to the successor.
+ *
+ * \param conn    Accepted successor connection.
+ * \param server  Server with the configured interfaces.
+ *
+ * \return KNOT_E*
+ */
+int handoff_send(int conn, const struct server *server);
+
+/*!
+ * \brief Waits until the successor reports it serves the sockets.
+ *
+ * \param conn        Successor connection.
+ * \param timeout_ms  Poll timeout in milliseconds.
+ *
+ * \retval KNOT_EOK       if the successor is ready.
+ * \retval KNOT_ETIMEOUT  if not ready yet, wait again.
+ * \retval KNOT_ECONN     if the successor quit or failed.
+ */
+int handoff_wait_ready(int conn, int timeout_ms);
+
+/*!
+ * \brief Confirms the control and hand-over sockets were released.
+ *
+ * \param conn  Successor connection (closed).
+ */
+void handoff_released(int conn);
+
+/*!
+ * \brief Connects to the running server and receives its sockets.
+ *
+ * \param path     Hand-over socket path.
+ * \param handoff  Output hand-over context.
+ *
+ * \retval KNOT_EOK    if the sockets were received.
+ * \retval KNOT_ECONN  if no server is running.
+ * \retval KNOT_E*     if other error.
+ */
+int handoff_connect(const char *path, handoff_t *handoff);
+
+/*!
+ * \brief Takes a received socket bound to the given address.
+ *
+ * The sockets bound to the same address are taken in the order they were
+ * bound by the predecessor, i.e. in the order of their SO_REUSEPORT group.
+ *
+ * \param handoff  Hand-over context (NULL ok).
+ * \param type     Socket type.
+ * \param addr     Bound address.
+ *
+ * \return Socket descriptor or KNOT_ENOENT.
+ */
+int handoff_take(handoff_t *handoff, int type, const struct sockaddr_storage *addr);
+
+/*!
+ * \brief Closes the received sockets that haven't been taken.
+ *
+ * \param handoff  Hand-over context.
+ */
+void handoff_close_unused(handoff_t *handoff);
+
+/*!
+ * \brief Reports ready to the predecessor and waits for it to release its sockets.
+ *
+ * \param handoff  Hand-over context (connection closed).
+ * \param timeout  Release timeout in seconds.
+ *
+ * \return KNOT_E*
+ */
+int handoff_ready(handoff_t *handoff, int timeout);
+
+/*!
+ * \brief Closes the connection to the predecessor and the remaining sockets.
+ *
+ * \param handoff  Hand-over context.
+ */
+void handoff_deinit(handoff_t *handoff);
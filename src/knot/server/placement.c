@@ -0,0 +1,453 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "knot/server/placement.h"
+#include "knot/server/dthreads.h"
+#include "knot/common/log.h"
+#include "libknot/errcode.h"
+#include "contrib/openbsd/strlcpy.h"
+#include "contrib/sockaddr.h"
+
+#define NICS_MAX	32
+#define QUEUES_MAX	1024
+
+typedef struct {
+	char name[IF_NAMESIZE];
+	int node;          /*!< NUMA node of the NIC, -1 if unknown. */
+	unsigned queues;   /*!< Number of the queues with a known IRQ. */
+	int *queue_cpu;    /*!< CPU handling the IRQ of each queue, -1 if unknown. */
+} nic_t;
+
+struct placement {
+	unsigned cpus;     /*!< Number of online CPUs. */
+	unsigned *order;   /*!< Order of the CPUs for the query workers. */
+	unsigned irq_cpus; /*!< Number of the leading CPUs handling the NIC IRQs. */
+	unsigned workers;  /*!< Number of the query workers of each protocol. */
+	unsigned *bg;      /*!< CPUs for the background workers. */
+	size_t bg_count;
+	nic_t nics[NICS_MAX];
+	size_t nics_count;
+};
+
+static int read_first_int(const char *path, int *out)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		return KNOT_ENOENT;
+	}
+	int ret = (fscanf(file, "%d", out) == 1) ? KNOT_EOK : KNOT_EMALF;
+	fclose(file);
+
+	return ret;
+}
+
+static int cpu_node(unsigned cpu)
+{
+	char path[64];
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		return -1;
+	}
+	int node = -1;
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (sscanf(entry->d_name, "node%d", &node) == 1) {
+			break;
+		}
+	}
+	closedir(dir);
+
+	return node;
+}
+
+static int irq_cpu(const placement_t *pl, unsigned irq)
+{
+	// The effective affinity is available since Linux 4.13.
+	const char *files[] = { "effective_affinity_list", "smp_affinity_list" };
+	for (size_t i = 0; i < sizeof(files) / sizeof(*files); i++) {
+		char path[64];
+		(void)snprintf(path, sizeof(path), "/proc/irq/%u/%s", irq, files[i]);
+		int cpu;
+		if (read_first_int(path, &cpu) == KNOT_EOK && cpu >= 0 && (unsigned)cpu < pl->cpus) {
+			return cpu;
+		}
+	}
+
+	return -1;
+}
+
+/*!
+ * \brief Gets the queue number from an IRQ handler name like <dev>-TxRx-<queue>.
+ *
+ * \return Queue number or -1 if not a receiving queue of the device.
+ */
+static int irq_queue(const char *handler, const char *dev)
+{
+	size_t len = strlen(dev);
+	if (strncmp(handler, dev, len) != 0 || handler[len] != '-') {
+		return -1;
+	}
+
+	const char *num = strrchr(handler, '-') + 1;
+	if (*num == '\0' || strspn(num, "0123456789") != strlen(num)) {
+		return -1;
+	}
+
+	// Skip the transmit-only interrupts.
+	bool rx = false, tx = false;
+	for (const char *c = handler + len; c < num; c++) {
+		if (tolower(c[0]) == 'r' && tolower(c[1]) == 'x') {
+			rx = true;
+		} else if (tolower(c[0]) == 't' && tolower(c[1]) == 'x') {
+			tx = true;
+		}
+	}
+	if (tx && !rx) {
+		return -1;
+	}
+
+	int queue = atoi(num);
+	return (queue < QUEUES_MAX) ? queue : -1;
+}
+
+static void set_queue_cpu(nic_t *nic, unsigned queue, int cpu)
+{
+	if (queue >= nic->queues) {
+		int *cpus = realloc(nic->queue_cpu, (queue + 1) * sizeof(*cpus));
+		if (cpus == NULL) {
+			return;
+		}
+		for (unsigned i = nic->queues; i <= queue; i++) {
+			cpus[i] = -1;
+		}
+		nic->queue_cpu = cpus;
+		nic->queues = queue + 1;
+	}
+	nic->queue_cpu[queue] = cpu;
+}
+
+static void load_queue_irqs(const placement_t *pl, nic_t *nic)
+{
+	FILE *file = fopen("/proc/interrupts", "r");
+	if (file == NULL) {
+		return;
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	while (getline(&line, &line_size, file) != -1) {
+		unsigned irq;
+		if (sscanf(line, " %u:", &irq) != 1) {
+			continue;
+		}
+
+		// The handler name is the last column.
+		size_t len = strlen(line);
+		while (len > 0 && isspace((unsigned char)line[len - 1])) {
+			line[--len] = '\0';
+		}
+		char *handler = strrchr(line, ' ');
+		if (handler == NULL) {
+			continue;
+		}
+
+		int queue = irq_queue(handler + 1, nic->name);
+		if (queue >= 0) {
+			set_queue_cpu(nic, queue, irq_cpu(pl, irq));
+		}
+	}
+	free(line);
+	fclose(file);
+}
+
+static const nic_t *find_nic(const placement_t *pl, const char *name)
+{
+	for (size_t i = 0; i < pl->nics_count; i++) {
+		if (strcmp(pl->nics[i].name, name) == 0) {
+			return &pl->nics[i];
+		}
+	}
+
+	return NULL;
+}
+
+placement_t *placement_new(void)
+{
+	placement_t *pl = calloc(1, sizeof(*pl));
+	if (pl == NULL) {
+		return NULL;
+	}
+
+	int cpus = dt_online_cpus();
+	pl->cpus = (cpus > 0) ? cpus : 1;
+	pl->order = calloc(pl->cpus, sizeof(*pl->order));
+	pl->bg = calloc(pl->cpus, sizeof(*pl->bg));
+	if (pl->order == NULL || pl->bg == NULL) {
+		placement_free(pl);
+		return NULL;
+	}
+	for (unsigned i = 0; i < pl->cpus; i++) {
+		pl->order[i] = i;
+	}
+
+	return pl;
+}
+
+int placement_add_dev(placement_t *pl, const char *name)
+{
+	if (pl == NULL || name == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (strlen(name) >= IF_NAMESIZE || find_nic(pl, name) != NULL) {
+		return KNOT_EOK;
+	}
+
+	char path[64 + IF_NAMESIZE];
+	(void)snprintf(path, sizeof(path), "/sys/class/net/%s/device", name);
+	if (access(path, F_OK) != 0) {
+		return KNOT_EOK; // Not a hardware device.
+	}
+	if (pl->nics_count == NICS_MAX) {
+		return KNOT_ESPACE;
+	}
+
+	nic_t *nic = &pl->nics[pl->nics_count++];
+	memset(nic, 0, sizeof(*nic));
+	strlcpy(nic->name, name, sizeof(nic->name));
+
+	(void)snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", name);
+	if (read_first_int(path, &nic->node) != KNOT_EOK) {
+		nic->node = -1;
+	}
+
+	load_queue_irqs(pl, nic);
+
+	return KNOT_EOK;
+}
+
+int placement_add_addr(placement_t *pl, const struct sockaddr_storage *addr)
+{
+	if (pl == NULL || addr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (addr->ss_family != AF_INET && addr->ss_family != AF_INET6) {
+		return KNOT_EOK;
+	}
+
+	struct ifaddrs *ifaces = NULL;
+	if (getifaddrs(&ifaces) != 0) {
+		return knot_map_errno();
+	}
+
+	int ret = KNOT_EOK;
+	bool any = sockaddr_is_any(addr);
+	for (struct ifaddrs *i = ifaces; i != NULL && ret == KNOT_EOK; i = i->ifa_next) {
+		if (i->ifa_addr == NULL || i->ifa_addr->sa_family != addr->ss_family) {
+			continue;
+		}
+		struct sockaddr_storage ifa_addr = { 0 };
+		memcpy(&ifa_addr, i->ifa_addr, (addr->ss_family == AF_INET) ?
+		       sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
+		if (any || sockaddr_cmp(&ifa_addr, addr, true) == 0) {
+			ret = placement_add_dev(pl, i->ifa_name);
+		}
+	}
+	freeifaddrs(ifaces);
+
+	return ret;
+}
+
+void placement_build(placement_t *pl, unsigned workers)
+{
+	if (pl == NULL) {
+		return;
+	}
+
+	bool used[pl->cpus];
+	memset(used, 0, sizeof(used));
+	unsigned len = 0;
+
+	// CPUs handling the queue IRQs, interleaved over the NICs.
+	unsigned max_queues = 0;
+	for (size_t i = 0; i < pl->nics_count; i++) {
+		if (pl->nics[i].queues > max_queues) {
+			max_queues = pl->nics[i].queues;
+		}
+	}
+	for (unsigned q = 0; q < max_queues; q++) {
+		for (size_t i = 0; i < pl->nics_count; i++) {
+			const nic_t *nic = &pl->nics[i];
+			if (q < nic->queues && nic->queue_cpu[q] >= 0 && !used[nic->queue_cpu[q]]) {
+				used[nic->queue_cpu[q]] = true;
+				pl->order[len++] = nic->queue_cpu[q];
+			}
+		}
+	}
+	pl->irq_cpus = len;
+
+	// Other CPUs local to the NICs.
+	for (unsigned cpu = 0; cpu < pl->cpus; cpu++) {
+		if (used[cpu]) {
+			continue;
+		}
+		int node = cpu_node(cpu);
+		for (size_t i = 0; i < pl->nics_count; i++) {
+			if (node >= 0 && pl->nics[i].node == node) {
+				used[cpu] = true;
+				pl->order[len++] = cpu;
+				break;
+			}
+		}
+	}
+
+	// The rest.
+	for (unsigned cpu = 0; cpu < pl->cpus; cpu++) {
+		if (!used[cpu]) {
+			pl->order[len++] = cpu;
+		}
+	}
+
+	// The background workers avoid the query workers and the NIC IRQs.
+	pl->workers = workers;
+	pl->bg_count = 0;
+	unsigned first = (workers > pl->irq_cpus) ? workers : pl->irq_cpus;
+	for (unsigned i = first; i < pl->cpus; i++) {
+		pl->bg[pl->bg_count++] = pl->order[i];
+	}
+}
+
+unsigned placement_cpu(const placement_t *pl, unsigned idx)
+{
+	if (pl == NULL) {
+		int cpus = dt_online_cpus();
+		return (cpus > 0) ? idx % cpus : 0;
+	}
+
+	return pl->order[idx % pl->cpus];
+}
+
+unsigned placement_queue_cpu(const placement_t *pl, const char *name, unsigned queue)
+{
+	if (pl == NULL) {
+		return placement_cpu(NULL, queue);
+	}
+
+	const nic_t *nic = (name != NULL) ? find_nic(pl, name) : NULL;
+	if (nic != NULL && queue < nic->queues && nic->queue_cpu[queue] >= 0) {
+		return nic->queue_cpu[queue];
+	}
+
+	return placement_cpu(pl, queue);
+}
+
+size_t placement_background(const placement_t *pl, const unsigned **cpus)
+{
+	if (pl == NULL || cpus == NULL) {
+		return 0;
+	}
+
+	*cpus = pl->bg;
+	return pl->bg_count;
+}
+
+static const char *cpus_tostr(char *buf, size_t size, const unsigned *cpus, size_t count)
+{
+	if (count == 0) {
+		return "none";
+	}
+
+	size_t len = 0;
+	buf[0] = '\0';
+	for (size_t i = 0; i < count && len < size; ) {
+		size_t last = i;
+		while (last + 1 < count && cpus[last + 1] == cpus[last] + 1) {
+			last++;
+		}
+		int ret = (last > i) ?
+		          snprintf(buf + len, size - len, "%s%u-%u", (i > 0 ? "," : ""), cpus[i], cpus[last]) :
+		          snprintf(buf + len, size - len, "%s%u", (i > 0 ? "," : ""), cpus[i]);
+		if (ret < 0) {
+			break;
+		}
+		len += ret;
+		i = last + 1;
+	}
+
+	return buf;
+}
+
+void placement_log(const placement_t *pl)
+{
+	if (pl == NULL) {
+		return;
+	}
+
+	char buf[256];
+	unsigned cpus[pl->cpus];
+	for (size_t i = 0; i < pl->nics_count; i++) {
+		const nic_t *nic = &pl->nics[i];
+		size_t count = 0;
+		for (unsigned q = 0; q < nic->queues && count < pl->cpus; q++) {
+			if (nic->queue_cpu[q] >= 0) {
+				cpus[count++] = nic->queue_cpu[q];
+			}
+		}
+		char node[16] = "unknown";
+		if (nic->node >= 0) {
+			(void)snprintf(node, sizeof(node), "%d", nic->node);
+		}
+		log_info("CPU placement, interface %s, NUMA node %s, queue IRQs on CPUs %s",
+		         nic->name, node, cpus_tostr(buf, sizeof(buf), cpus, count));
+	}
+
+	unsigned workers = (pl->workers < pl->cpus) ? pl->workers : pl->cpus;
+	log_info("CPU placement, query workers on CPUs %s",
+	         cpus_tostr(buf, sizeof(buf), pl->order, workers));
+	if (pl->bg_count > 0) {
+		log_info("CPU placement, background workers on CPUs %s",
+		         cpus_tostr(buf, sizeof(buf), pl->bg, pl->bg_count));
+	} else {
+		log_info("CPU placement, no spare CPUs for background workers");
+	}
+}
+
+void placement_free(placement_t *pl)
+{
+	if (pl == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < pl->nics_count; i++) {
+		free(pl->nics[i].queue_cpu);
+	}
+	free(pl->order);
+	free(pl->bg);
+	free(pl);
+}
@@ -0,0 +1,105 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sys/socket.h>
+
+/*!
+ * \brief Placement of the worker threads by the topology of the network cards.
+ *
+ * The CPUs are ordered so that the ones handling the interrupts of the NIC
+ * queues come first, followed by the other CPUs of the NUMA nodes of the
+ * NICs and then the rest. The query worker i is pinned to the i-th CPU of
+ * the order, the background workers use the CPUs not taken by the query
+ * workers nor by the NIC interrupts (if any are left).
+ *
+ * The IRQ of a queue is recognized by the name of its handler (e.g. eth0-TxRx-3)
+ * in /proc/interrupts, the NUMA node of a NIC is read from sysfs.
+ */
+typedef struct placement placement_t;
+
+/*!
+ * \brief Creates an empty placement (all CPUs in their natural order).
+ *
+ * \return Placement or NULL if no memory.
+ */
+placement_t *placement_new(void);
+
+/*!
+ * \brief Considers the NICs carrying the listening address.
+ *
+ * \note A wildcard address considers all the NICs.
+ *
+ * \param pl    Placement.
+ * \param addr  Listening address.
+ *
+ * \return KNOT_E*
+ */
+int placement_add_addr(placement_t *pl, const struct sockaddr_storage *addr);
+
+/*!
+ * \brief Considers the NIC of the given name.
+ *
+ * \note Devices without a hardware backing (e.g. loopback) are ignored.
+ *
+ * \return KNOT_E*
+ */
+int placement_add_dev(placement_t *pl, const char *name);
+
+/*!
+ * \brief Computes the CPU order for the given number of query workers.
+ *
+ * \param pl       Placement.
+ * \param workers  Number of the query workers of each protocol.
+ */
+void placement_build(placement_t *pl, unsigned workers);
+
+/*!
+ * \brief Returns the CPU for the query worker of the given index.
+ *
+ * \note Without placement, the worker i runs on the CPU (i modulo online CPUs).
+ */
+unsigned placement_cpu(const placement_t *pl, unsigned idx);
+
+/*!
+ * \brief Returns the CPU handling the interrupts of the given NIC queue.
+ *
+ * \note Without placement or if not known, the queue number modulo
+ *       the number of online CPUs is returned.
+ */
+unsigned placement_queue_cpu(const placement_t *pl, const char *name, unsigned queue);
+
+/*!
+ * \brief Returns the CPUs for the background workers.
+ *
+ * \param pl    Placement.
+ * \param cpus  Output array of the CPUs (not to be freed).
+ *
+ * \return Number of the CPUs, 0 if the background workers shouldn't be pinned.
+ */
+size_t placement_background(const placement_t *pl, const unsigned **cpus);
+
+/*!
+ * \brief Logs the detected NICs and the placement of the workers.
+ */
+void placement_log(const placement_t *pl);
+
+/*!
+ * \brief Frees the placement.
+ */
+void placement_free(placement_t *pl);
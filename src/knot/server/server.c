@@ -20,11 +20,13 @@
 #include <sys/types.h>   // OpenBSD
 #include <netinet/tcp.h> // TCP_FASTOPEN
 #include <sys/resource.h>
+#include <urcu.h>
 
 #include "libknot/libknot.h"
 #include "libknot/yparser/ypschema.h"
 #include "libknot/xdp.h"
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
 #include "knot/common/stats.h"
 #include "knot/common/systemd.h"
 #include "knot/common/unreachable.h"
@@ -32,16 +34,24 @@
 #include "knot/conf/migration.h"
 #include "knot/conf/module.h"
 #include "knot/dnssec/kasp/kasp_db.h"
+#include "knot/dnssec/key-cache.h"
+#include "knot/dnssec/sign-pool.h"
+#include "knot/events/xfr_sched.h"
 #include "knot/journal/journal_basic.h"
+#include "knot/query/mux.h"
 #include "knot/server/server.h"
 #include "knot/server/udp-handler.h"
+#include "knot/server/steering.h"
 #include "knot/server/tcp-handler.h"
 #include "knot/zone/timers.h"
 #include "knot/zone/zonedb-load.h"
+#include "knot/worker/isolation.h"
 #include "knot/worker/pool.h"
 #include "contrib/conn_pool.h"
+#include "contrib/macros.h"
 #include "contrib/net.h"
 #include "contrib/openbsd/strlcat.h"
+#include "contrib/openbsd/strlcpy.h"
 #include "contrib/os.h"
 #include "contrib/sockaddr.h"
 #include "contrib/trim.h"
@@ -54,6 +64,15 @@
 #include <linux/filter.h>
 #endif
 
+/*! \brief Interval of persisting the changed zone timers (in seconds). */
+#define TIMERS_FLUSH_INTERVAL 60
+
+/*! \brief Time to wait for the first data before accepting a connection (in seconds). */
+#define TCP_DEFER_ACCEPT_TIMEOUT 3
+
+/*! \brief Number of the returned TCP message buffers kept per size class. */
+#define TCP_BUFS_KEPT 1024
+
 /*! \brief Minimal send/receive buffer sizes. */
 enum {
 	UDP_MIN_RCVSIZE = 4096,
@@ -118,21 +137,35 @@ static void server_deinit_iface_list(iface_t *ifaces, size_t n)
  *
  * \param sock        Socket where to attach the CBPF filter to.
  * \param sock_count  Number of sockets.
+ * \param placement   Placement of the workers (may be NULL).
  */
-static bool server_attach_reuseport_bpf(const int sock, const int sock_count)
+static bool server_attach_reuseport_bpf(const int sock, const int sock_count,
+                                        const placement_t *placement)
 {
 #ifdef SO_ATTACH_REUSEPORT_CBPF
-	struct sock_filter code[] = {
-		/* A = raw_smp_processor_id(). */
-		{ BPF_LD  | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
-		/* Adjust the CPUID to socket group size. */
-		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, sock_count },
-		/* Return A. */
-		{ BPF_RET | BPF_A, 0, 0, 0 },
-	};
+	/* The table of the workers' CPUs is limited by the program size. */
+	int table = (placement != NULL) ? MIN(sock_count, (BPF_MAXINSNS - 3) / 2) : 0;
+	struct sock_filter code[3 + 2 * table];
+	unsigned len = 0;
+
+	/* A = raw_smp_processor_id(). */
+	code[len++] = (struct sock_filter){ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU };
+	/* Return the socket of the worker pinned to the CPU. */
+	for (int i = 0; i < table; i++) {
+		unsigned cpu = placement_cpu(placement, i);
+		if (i > 0 && cpu == placement_cpu(placement, 0)) {
+			break;
+		}
+		code[len++] = (struct sock_filter){ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, cpu };
+		code[len++] = (struct sock_filter){ BPF_RET | BPF_K, 0, 0, i };
+	}
+	/* Adjust the CPUID to socket group size. */
+	code[len++] = (struct sock_filter){ BPF_ALU | BPF_MOD | BPF_K, 0, 0, sock_count };
+	/* Return A. */
+	code[len++] = (struct sock_filter){ BPF_RET | BPF_A, 0, 0, 0 };
 
 	struct sock_fprog prog = { 0 };
-	prog.len = sizeof(code) / sizeof(*code);
+	prog.len = len;
 	prog.filter = code;
 
 	return setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0;
@@ -224,20 +257,35 @@ static int disable_pmtudisc(int sock, int family)
 	return KNOT_EOK;
 }
 
-static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_check,
+/*! \brief Returns the number of XDP interfaces, each bond member counted separately. */
+static size_t xdp_iface_count(const conf_val_t *lisxdp_val)
+{
+	size_t count = 0;
+	conf_val_t val = *lisxdp_val;
+	while (val.code == KNOT_EOK) {
+		struct sockaddr_storage addr = conf_addr(&val, NULL);
+		conf_xdp_iface_t iface;
+		if (conf_xdp_iface(&addr, &iface) == KNOT_EOK && iface.member_count > 0) {
+			count += iface.member_count;
+		} else {
+			count++;
+		}
+		conf_val_next(&val);
+	}
+
+	return count;
+}
+
+static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr,
+                                      const conf_xdp_iface_t *dev, bool route_check,
                                       bool tcp, unsigned *thread_id_start)
 {
 #ifndef ENABLE_XDP
 	assert(0);
 	return NULL;
 #else
-	conf_xdp_iface_t iface;
-	int ret = conf_xdp_iface(addr, &iface);
-	if (ret != KNOT_EOK) {
-		log_error("failed to initialize XDP interface (%s)",
-		          knot_strerror(ret));
-		return NULL;
-	}
+	const conf_xdp_iface_t iface = *dev;
+	int ret = KNOT_EOK;
 
 	iface_t *new_if = calloc(1, sizeof(*new_if));
 	if (new_if == NULL) {
@@ -245,6 +293,7 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 		return NULL;
 	}
 	memcpy(&new_if->addr, addr, sizeof(*addr));
+	strlcpy(new_if->xdp_name, iface.name, sizeof(new_if->xdp_name));
 
 	new_if->fd_xdp = calloc(iface.queues, sizeof(int));
 	new_if->xdp_sockets = calloc(iface.queues, sizeof(*new_if->xdp_sockets));
@@ -261,16 +310,25 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 		xdp_flags |= KNOT_XDP_LISTEN_PORT_TCP;
 	}
 
+	conf_t *pconf = conf();
+	conf_val_t val = conf_get(pconf, C_XDP, C_ZERO_COPY);
+	const knot_xdp_config_t xdp_config = {
+		.bind_mode = conf_opt(&val), // XDP_BIND_* match knot_xdp_bind_t.
+		.busy_poll_timeout = conf_get_int(pconf, C_XDP, C_BUSYPOLL_TIMEOUT),
+		.busy_poll_budget = conf_get_int(pconf, C_XDP, C_BUSYPOLL_BUDGET),
+	};
+
 	for (int i = 0; i < iface.queues; i++) {
 		knot_xdp_load_bpf_t mode =
 			(i == 0 ? KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
 		ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-		                    iface.port | xdp_flags, mode);
+		                    iface.port | xdp_flags, mode, &xdp_config);
 		if (ret == -EBUSY && i == 0) {
 			log_notice("XDP interface %s@%u is busy, retrying initialization",
 			           iface.name, iface.port);
 			ret = knot_xdp_init(new_if->xdp_sockets + i, iface.name, i,
-			                    iface.port | xdp_flags, KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD);
+			                    iface.port | xdp_flags, KNOT_XDP_LOAD_BPF_ALWAYS_UNLOAD,
+			                    &xdp_config);
 		}
 		if (ret != KNOT_EOK) {
 			log_warning("failed to initialize XDP interface %s@%u, queue %d (%s)",
@@ -285,10 +343,18 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
 
 	if (ret == KNOT_EOK) {
 		knot_xdp_mode_t mode = knot_eth_xdp_mode(if_nametoindex(iface.name));
-		log_debug("initialized XDP interface %s@%u UDP%s, queues %d, %s mode%s",
+		bool zero_copy = knot_xdp_zero_copy(new_if->xdp_sockets[0]);
+		log_debug("initialized XDP interface %s@%u UDP%s, queues %d, %s mode, %s%s%s",
 		          iface.name, iface.port, (tcp ? "/TCP" : ""), iface.queues,
 		          (mode == KNOT_XDP_MODE_FULL ? "native" : "emulated"),
+		          (zero_copy ? "zero-copy" : "copy"),
+		          (xdp_config.busy_poll_timeout > 0 ? ", busy polling" : ""),
 		          route_check ? ", route check" : "");
+		if (!zero_copy && mode == KNOT_XDP_MODE_FULL &&
+		    xdp_config.bind_mode == KNOT_XDP_BIND_AUTO) {
+			log_notice("XDP interface %s@%u, zero-copy not supported, using copy mode",
+			           iface.name, iface.port);
+		}
 	}
 
 	return new_if;
@@ -305,13 +371,20 @@ static iface_t *server_init_xdp_iface(struct sockaddr_storage *addr, bool route_
  * \param tcp_thread_count  Number of created TCP workers.
  * \param tcp_reuseport     Indication if reuseport on TCP is enabled.
  * \param socket_affinity   Indication if CBPF should be attached.
+ * \param steering          eBPF steering contexts for UDP and TCP (may be NULL).
+ * \param placement         Placement of the workers (may be NULL).
+ * \param tls               Indication of a DNS over TLS interface (TCP only).
+ * \param handoff           Sockets handed over by the predecessor (may be NULL).
  *
  * \retval Pointer to a new initialized interface.
  * \retval NULL if error.
  */
 static iface_t *server_init_iface(struct sockaddr_storage *addr,
                                   int udp_thread_count, int tcp_thread_count,
-                                  bool tcp_reuseport, bool socket_affinity)
+                                  bool tcp_reuseport, bool socket_affinity,
+                                  steering_t *steering[2],
+                                  const placement_t *placement, bool tls,
+                                  handoff_t *handoff)
 {
 	iface_t *new_if = calloc(1, sizeof(*new_if));
 	if (new_if == NULL) {
@@ -319,6 +392,7 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 		return NULL;
 	}
 	memcpy(&new_if->addr, addr, sizeof(*addr));
+	new_if->tls = tls;
 
 	/* Convert to string address format. */
 	char addr_str[SOCKADDR_STRLEN] = { 0 };
@@ -339,9 +413,14 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 	}
 #endif
 
+	/* DNS over TLS is only served over TCP. */
+	if (tls) {
+		udp_socket_count = 0;
+	}
+
 	new_if->fd_udp = malloc(udp_socket_count * sizeof(int));
 	new_if->fd_tcp = malloc(tcp_socket_count * sizeof(int));
-	if (new_if->fd_udp == NULL || new_if->fd_tcp == NULL) {
+	if ((new_if->fd_udp == NULL && udp_socket_count > 0) || new_if->fd_tcp == NULL) {
 		log_error("failed to initialize interface");
 		server_deinit_iface(new_if, true);
 		return NULL;
@@ -355,7 +434,10 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 
 	/* Create bound UDP sockets. */
 	for (int i = 0; i < udp_socket_count; i++) {
-		int sock = net_bound_socket(SOCK_DGRAM, addr, udp_bind_flags);
+		int sock = handoff_take(handoff, SOCK_DGRAM, addr);
+		if (sock < 0) {
+			sock = net_bound_socket(SOCK_DGRAM, addr, udp_bind_flags);
+		}
 		if (sock == KNOT_EADDRNOTAVAIL) {
 			udp_bind_flags |= NET_BIND_NONLOCAL;
 			sock = net_bound_socket(SOCK_DGRAM, addr, udp_bind_flags);
@@ -373,7 +455,7 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 		}
 
 		if ((udp_bind_flags & NET_BIND_MULTIPLE) && socket_affinity) {
-			if (!server_attach_reuseport_bpf(sock, udp_socket_count) &&
+			if (!server_attach_reuseport_bpf(sock, udp_socket_count, placement) &&
 			    warn_cbpf) {
 				log_warning("cannot ensure optimal CPU locality for UDP");
 				warn_cbpf = false;
@@ -403,6 +485,15 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 		new_if->fd_udp_count += 1;
 	}
 
+	/* Replace the CPU based socket selection. */
+	if ((udp_bind_flags & NET_BIND_MULTIPLE) && steering[IO_UDP] != NULL) {
+		int ret = steering_attach(steering[IO_UDP], new_if->fd_udp, new_if->fd_udp_count);
+		if (ret != KNOT_EOK) {
+			log_warning("cannot attach socket steering for UDP (%s)",
+			            knot_strerror(ret));
+		}
+	}
+
 	warn_bind = true;
 	warn_cbpf = true;
 	warn_bufsize = true;
@@ -410,7 +501,10 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 
 	/* Create bound TCP sockets. */
 	for (int i = 0; i < tcp_socket_count; i++) {
-		int sock = net_bound_socket(SOCK_STREAM, addr, tcp_bind_flags);
+		int sock = handoff_take(handoff, SOCK_STREAM, addr);
+		if (sock < 0) {
+			sock = net_bound_socket(SOCK_STREAM, addr, tcp_bind_flags);
+		}
 		if (sock == KNOT_EADDRNOTAVAIL) {
 			tcp_bind_flags |= NET_BIND_NONLOCAL;
 			sock = net_bound_socket(SOCK_STREAM, addr, tcp_bind_flags);
@@ -445,7 +539,7 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 		}
 
 		if ((tcp_bind_flags & NET_BIND_MULTIPLE) && socket_affinity) {
-			if (!server_attach_reuseport_bpf(sock, tcp_socket_count) &&
+			if (!server_attach_reuseport_bpf(sock, tcp_socket_count, placement) &&
 			    warn_cbpf) {
 				log_warning("cannot ensure optimal CPU locality for TCP");
 				warn_cbpf = false;
@@ -459,11 +553,70 @@ static iface_t *server_init_iface(struct sockaddr_storage *addr,
 			            addr_str, knot_strerror(ret));
 			warn_flag_misc = false;
 		}
+
+		/* Don't wake up the workers before the query arrives. */
+		if (addr->ss_family != AF_UNIX) {
+			ret = net_bound_defer_accept(sock, TCP_DEFER_ACCEPT_TIMEOUT);
+			if (ret != KNOT_EOK && ret != KNOT_ENOTSUP && warn_flag_misc) {
+				log_warning("failed to enable deferred accept on %s (%s)",
+				            addr_str, knot_strerror(ret));
+				warn_flag_misc = false;
+			}
+		}
+	}
+
+	if ((tcp_bind_flags & NET_BIND_MULTIPLE) && steering[IO_TCP] != NULL) {
+		int ret = steering_attach(steering[IO_TCP], new_if->fd_tcp, new_if->fd_tcp_count);
+		if (ret != KNOT_EOK) {
+			log_warning("cannot attach socket steering for TCP (%s)",
+			            knot_strerror(ret));
+		}
 	}
 
 	return new_if;
 }
 
+static placement_t *init_placement(conf_t *conf, unsigned workers)
+{
+	placement_t *pl = placement_new();
+	if (pl == NULL) {
+		return NULL;
+	}
+
+	const yp_name_t *items[] = { C_LISTEN, C_LISTEN_TLS };
+	for (size_t i = 0; i < sizeof(items) / sizeof(*items); i++) {
+		conf_val_t val = conf_get(conf, C_SRV, items[i]);
+		while (val.code == KNOT_EOK) {
+			struct sockaddr_storage addr = conf_addr(&val, NULL);
+			(void)placement_add_addr(pl, &addr);
+			conf_val_next(&val);
+		}
+	}
+#ifdef ENABLE_XDP
+	conf_val_t val = conf_get(conf, C_XDP, C_LISTEN);
+	if (val.code != KNOT_EOK) {
+		val = conf_get(conf, C_SRV, C_LISTEN_XDP);
+	}
+	while (val.code == KNOT_EOK) {
+		struct sockaddr_storage addr = conf_addr(&val, NULL);
+		conf_xdp_iface_t iface;
+		if (conf_xdp_iface(&addr, &iface) == KNOT_EOK) {
+			for (unsigned i = 0; i < iface.member_count; i++) {
+				(void)placement_add_dev(pl, iface.members[i].name);
+			}
+			if (iface.member_count == 0) {
+				(void)placement_add_dev(pl, iface.name);
+			}
+		}
+		conf_val_next(&val);
+	}
+#endif
+
+	placement_build(pl, workers);
+
+	return pl;
+}
+
 static void log_sock_conf(conf_t *conf)
 {
 	char buf[128] = "";
@@ -476,7 +629,16 @@ static void log_sock_conf(conf_t *conf)
 	if (conf->cache.srv_socket_affinity) {
 		strlcat(buf, ", socket affinity", sizeof(buf));
 	}
+	if (conf->cache.srv_socket_steering) {
+		strlcat(buf, ", socket steering", sizeof(buf));
+	}
 #endif
+	if (conf->cache.srv_cpu_placement) {
+		if (buf[0] != '\0') {
+			strlcat(buf, ", ", sizeof(buf));
+		}
+		strlcat(buf, "CPU placement", sizeof(buf));
+	}
 #if defined(TCP_FASTOPEN)
 	if (buf[0] != '\0') {
 		strlcat(buf, ", ", sizeof(buf));
@@ -504,9 +666,10 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	if (lisxdp_val.code != KNOT_EOK) {
 		lisxdp_val = conf_get(conf, C_SRV, C_LISTEN_XDP);
 	}
+	conf_val_t listls_val = conf_get(conf, C_SRV, C_LISTEN_TLS);
 	conf_val_t rundir_val = conf_get(conf, C_SRV, C_RUNDIR);
 
-	if (listen_val.code == KNOT_EOK) {
+	if (listen_val.code == KNOT_EOK || listls_val.code == KNOT_EOK) {
 		log_sock_conf(conf);
 	} else if (lisxdp_val.code != KNOT_EOK) {
 		log_warning("no network interface configured");
@@ -530,8 +693,23 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	}
 #endif
 
+	if (listls_val.code == KNOT_EOK) {
+		conf_val_t cert_val = conf_get(conf, C_SRV, C_TLS_CERT);
+		conf_val_t key_val = conf_get(conf, C_SRV, C_TLS_KEY);
+		char *cert = conf_abs_path(&cert_val, CONFIG_DIR);
+		char *key = conf_abs_path(&key_val, CONFIG_DIR);
+		int ret = tls_creds_init(cert, key, &s->tls_creds);
+		free(cert);
+		free(key);
+		if (ret != KNOT_EOK) {
+			log_error("failed to initialize DNS over TLS (%s)", knot_strerror(ret));
+			return ret;
+		}
+	}
+
 	size_t real_nifs = 0;
-	size_t nifs = conf_val_count(&listen_val) + conf_val_count(&lisxdp_val);
+	size_t nifs = conf_val_count(&listen_val) + conf_val_count(&listls_val) +
+	              xdp_iface_count(&lisxdp_val);
 	iface_t *newlist = calloc(nifs, sizeof(*newlist));
 	if (newlist == NULL) {
 		log_error("failed to allocate memory for network sockets");
@@ -543,6 +721,26 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	unsigned size_tcp = s->handlers[IO_TCP].handler.unit->size;
 	bool tcp_reuseport = conf->cache.srv_tcp_reuseport;
 	bool socket_affinity = conf->cache.srv_socket_affinity;
+	if (conf->cache.srv_cpu_placement && s->placement == NULL) {
+		s->placement = init_placement(conf, MAX(size_udp, size_tcp));
+		if (s->placement != NULL) {
+			placement_log(s->placement);
+		} else {
+			log_warning("cannot initialize CPU placement");
+		}
+	}
+#ifdef ENABLE_REUSEPORT
+	if (conf->cache.srv_socket_steering && s->steering[IO_UDP] == NULL) {
+		int ret = steering_new(size_udp, false, s->placement, &s->steering[IO_UDP]);
+		if (ret == KNOT_EOK && tcp_reuseport) {
+			ret = steering_new(size_tcp, true, s->placement, &s->steering[IO_TCP]);
+		}
+		if (ret != KNOT_EOK) {
+			log_warning("cannot initialize socket steering (%s)",
+			            knot_strerror(ret));
+		}
+	}
+#endif
 	char *rundir = conf_abs_path(&rundir_val, NULL);
 	while (listen_val.code == KNOT_EOK) {
 		struct sockaddr_storage addr = conf_addr(&listen_val, rundir);
@@ -551,7 +749,9 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		log_info("binding to interface %s", addr_str);
 
 		iface_t *new_if = server_init_iface(&addr, size_udp, size_tcp,
-		                                    tcp_reuseport, socket_affinity);
+		                                    tcp_reuseport, socket_affinity,
+		                                    s->steering, s->placement, false,
+		                                    s->handoff);
 		if (new_if == NULL) {
 			server_deinit_iface_list(newlist, nifs);
 			free(rundir);
@@ -564,6 +764,27 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	}
 	free(rundir);
 
+	/* DNS over TLS sockets. */
+	while (listls_val.code == KNOT_EOK) {
+		struct sockaddr_storage addr = conf_addr(&listls_val, NULL);
+		char addr_str[SOCKADDR_STRLEN] = { 0 };
+		sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
+		log_info("binding to TLS interface %s", addr_str);
+
+		iface_t *new_if = server_init_iface(&addr, size_udp, size_tcp,
+		                                    tcp_reuseport, socket_affinity,
+		                                    s->steering, s->placement, true,
+		                                    s->handoff);
+		if (new_if == NULL) {
+			server_deinit_iface_list(newlist, nifs);
+			return KNOT_ERROR;
+		}
+		memcpy(&newlist[real_nifs++], new_if, sizeof(*newlist));
+		free(new_if);
+
+		conf_val_next(&listls_val);
+	}
+
 	/* XDP sockets. */
 	bool xdp_tcp = conf->cache.xdp_tcp;
 	bool route_check = conf->cache.xdp_route_check;
@@ -575,13 +796,35 @@ static int configure_sockets(conf_t *conf, server_t *s)
 		sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
 		log_info("binding to XDP interface %s", addr_str);
 
-		iface_t *new_if = server_init_xdp_iface(&addr, route_check, xdp_tcp, &thread_id);
-		if (new_if == NULL) {
+		conf_xdp_iface_t xdp_if;
+		int ret = conf_xdp_iface(&addr, &xdp_if);
+		if (ret != KNOT_EOK) {
+			log_error("failed to initialize XDP interface (%s)",
+			          knot_strerror(ret));
 			server_deinit_iface_list(newlist, nifs);
 			return KNOT_ERROR;
 		}
-		memcpy(&newlist[real_nifs++], new_if, sizeof(*newlist));
-		free(new_if);
+
+		/* Each member of a bond gets its own filter and sockets. */
+		for (unsigned i = 0; i < MAX(xdp_if.member_count, 1); i++) {
+			conf_xdp_iface_t dev = xdp_if;
+			if (xdp_if.member_count > 0) {
+				strlcpy(dev.name, xdp_if.members[i].name, sizeof(dev.name));
+				dev.queues = xdp_if.members[i].queues;
+				dev.member_count = 0;
+				log_info("binding to XDP interface %s, bond member %s",
+				         addr_str, dev.name);
+			}
+
+			iface_t *new_if = server_init_xdp_iface(&addr, &dev, route_check,
+			                                        xdp_tcp, &thread_id);
+			if (new_if == NULL) {
+				server_deinit_iface_list(newlist, nifs);
+				return KNOT_ERROR;
+			}
+			memcpy(&newlist[real_nifs++], new_if, sizeof(*newlist));
+			free(new_if);
+		}
 
 		conf_val_next(&lisxdp_val);
 	}
@@ -594,7 +837,7 @@ static int configure_sockets(conf_t *conf, server_t *s)
 
 	/* Assign thread identifiers unique per all handlers. */
 	unsigned thread_count = 0;
-	for (unsigned proto = IO_UDP; proto <= IO_XDP; ++proto) {
+	for (unsigned proto = IO_UDP; proto <= IO_XFR; ++proto) {
 		dt_unit_t *tu = s->handlers[proto].handler.unit;
 		for (unsigned i = 0; tu != NULL && i < tu->size; ++i) {
 			s->handlers[proto].handler.thread_id[i] = thread_count++;
@@ -604,6 +847,31 @@ static int configure_sockets(conf_t *conf, server_t *s)
 	return KNOT_EOK;
 }
 
+static void timers_flush(server_t *server)
+{
+	rcu_read_lock();
+	int ret = zone_timers_dirty_flush(&server->timerdb, &server->timers.zones,
+	                                  server->zone_db);
+	rcu_read_unlock();
+	if (ret != KNOT_EOK) {
+		log_warning("failed to update persistent timer DB (%s)",
+		            knot_strerror(ret));
+	}
+}
+
+static void timers_flush_task(worker_task_t *task)
+{
+	server_t *server = task->ctx;
+	timers_flush(server);
+	evsched_schedule(server->timers.event, TIMERS_FLUSH_INTERVAL * 1000);
+}
+
+static void timers_flush_dispatch(event_t *event)
+{
+	server_t *server = event->data;
+	worker_pool_assign(server->workers, &server->timers.task);
+}
+
 int server_init(server_t *server, int bg_workers)
 {
 	if (server == NULL) {
@@ -612,6 +880,7 @@ int server_init(server_t *server, int bg_workers)
 
 	/* Clear the structure. */
 	memset(server, 0, sizeof(server_t));
+	buf_pool_init(&server->tcp_bufs, TCP_BUFS_KEPT);
 
 	/* Initialize event scheduler. */
 	if (evsched_init(&server->sched, server) != KNOT_EOK) {
@@ -631,6 +900,21 @@ int server_init(server_t *server, int bg_workers)
 		return ret;
 	}
 
+	ret = zone_timers_dirty_init(&server->timers.zones);
+	server->timers.event = evsched_event_create(&server->sched, timers_flush_dispatch, server);
+	if (ret != KNOT_EOK || server->timers.event == NULL) {
+		zone_timers_dirty_deinit(&server->timers.zones);
+		catalog_update_deinit(&server->catalog_upd);
+		worker_pool_destroy(server->workers);
+		evsched_deinit(&server->sched);
+		return KNOT_ENOMEM;
+	}
+	server->timers.task = (worker_task_t){
+		.ctx = server,
+		.run = timers_flush_task,
+		.prio = WORKER_PRIO_LOW,
+	};
+
 	zone_backups_init(&server->backup_ctxs);
 
 	char *catalog_dir = conf_db(conf(), C_CATALOG_DB);
@@ -642,16 +926,33 @@ int server_init(server_t *server, int bg_workers)
 	char *journal_dir = conf_db(conf(), C_JOURNAL_DB);
 	conf_val_t journal_size = conf_db_param(conf(), C_JOURNAL_DB_MAX_SIZE);
 	conf_val_t journal_mode = conf_db_param(conf(), C_JOURNAL_DB_MODE);
-	knot_lmdb_init(&server->journaldb, journal_dir, conf_int(&journal_size), journal_env_flags(conf_opt(&journal_mode), false), NULL);
+	conf_val_t journal_shards = conf_db_param(conf(), C_JOURNAL_DB_SHARDS);
+	server->journaldb_shards = conf_int(&journal_shards);
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		char *shard_dir = journal_db_shard_path(journal_dir, i);
+		knot_lmdb_init(&server->journaldb[i], shard_dir, conf_int(&journal_size),
+		               journal_env_flags(conf_opt(&journal_mode), false), NULL);
+		free(shard_dir);
+	}
 	free(journal_dir);
+	conf_val_t journal_delay = conf_db_param(conf(), C_JOURNAL_DB_COMMIT_DELAY);
+	ret = journal_group_init(&server->journal_group, conf_int(&journal_delay));
+	if (ret != KNOT_EOK) {
+		log_warning("failed to start journal group commit (%s)", knot_strerror(ret));
+	}
 
 	kasp_db_ensure_init(&server->kaspdb, conf());
+	key_cache_init();
 
 	char *timer_dir = conf_db(conf(), C_TIMER_DB);
 	conf_val_t timer_size = conf_db_param(conf(), C_TIMER_DB_MAX_SIZE);
 	knot_lmdb_init(&server->timerdb, timer_dir, conf_int(&timer_size), 0, NULL);
 	free(timer_dir);
 
+	/* Optional, the zone files are written by the event workers without it. */
+	server->flusher = worker_pool_create(1);
+	worker_pool_start(server->flusher);
+
 	return KNOT_EOK;
 }
 
@@ -663,28 +964,53 @@ void server_deinit(server_t *server)
 
 	zone_backups_deinit(&server->backup_ctxs);
 
-	/* Save zone timers. */
+	/* Save changed zone timers. */
+	evsched_cancel(server->timers.event);
+	evsched_event_free(server->timers.event);
 	if (server->zone_db != NULL) {
 		log_info("updating persistent timer DB");
-		int ret = zone_timers_write_all(&server->timerdb, server->zone_db);
-		if (ret != KNOT_EOK) {
-			log_warning("failed to update persistent timer DB (%s)",
-				    knot_strerror(ret));
-		}
+		timers_flush(server);
 	}
+	zone_timers_dirty_deinit(&server->timers.zones);
 
 	/* Free remaining interfaces. */
+	zone_answers_set_hook(NULL, NULL);
 	server_deinit_iface_list(server->ifaces, server->n_ifaces);
+	tls_creds_free(server->tls_creds);
+	steering_free(server->steering[IO_UDP]);
+	steering_free(server->steering[IO_TCP]);
+	placement_free(server->placement);
+	free(server->xdp_acl);
+	worker_isolation_deinit();
+	tcp_xfr_free(server->xfr);
 
 	/* Free threads and event handlers. */
 	worker_pool_destroy(server->workers);
 
+	/* Stop zone signing helpers. */
+	sign_pool_deinit();
+	key_cache_deinit();
+
 	/* Free zone database. */
 	knot_zonedb_deep_free(&server->zone_db, true);
 
+	/* Forget the zones waiting for incoming transfers. */
+	xfr_sched_deinit();
+
+	/* Free the contents waiting for deferred release. */
+	reclaim_deinit();
+
+	/* Stop the zone file writing after the zones waited for it. */
+	worker_pool_stop(server->flusher);
+	worker_pool_join(server->flusher);
+	worker_pool_destroy(server->flusher);
+
 	/* Free remaining events. */
 	evsched_deinit(&server->sched);
 
+	/* Free the buffers kept for the TCP clients. */
+	buf_pool_deinit(&server->tcp_bufs);
+
 	/* Free catalog zone context. */
 	catalog_update_clear(&server->catalog_upd);
 	catalog_update_deinit(&server->catalog_upd);
@@ -696,12 +1022,17 @@ void server_deinit(server_t *server)
 	/* Close kasp_db. */
 	knot_lmdb_deinit(&server->kaspdb);
 
-	/* Close journal database if open. */
-	knot_lmdb_deinit(&server->journaldb);
+	/* Store pending changesets and close journal database if open. */
+	journal_group_deinit(&server->journal_group);
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		knot_lmdb_deinit(&server->journaldb[i]);
+	}
 
 	/* Close and deinit connection pool. */
 	conn_pool_deinit(global_conn_pool);
 	global_conn_pool = NULL;
+	query_mux_deinit(global_query_mux);
+	global_query_mux = NULL;
 	knot_unreachables_deinit(&global_unreachables);
 }
 
@@ -751,6 +1082,9 @@ static void server_free_handler(iohandler_t *h)
 	free(h->thread_id);
 }
 
+/*! \brief Number of the tasks enqueued before the startup (zone loads mostly). */
+static int startup_tasks = 0;
+
 static void worker_wait_cb(worker_pool_t *pool)
 {
 	systemd_zone_load_timeout_notify();
@@ -762,7 +1096,7 @@ static void worker_wait_cb(worker_pool_t *pool)
 	if (now_ns - last_ns > 1000000000) {
 		int running, queued;
 		worker_pool_status(pool, true, &running, &queued);
-		systemd_tasks_status_notify(running + queued);
+		systemd_tasks_status_notify(running + queued, startup_tasks);
 		last_ns = now_ns;
 	}
 }
@@ -774,20 +1108,23 @@ int server_start(server_t *server, bool async)
 	}
 
 	/* Start workers. */
+	int running;
+	worker_pool_status(server->workers, false, &running, &startup_tasks);
 	worker_pool_start(server->workers);
 
 	/* Wait for enqueued events if not asynchronous. */
 	if (!async) {
 		worker_pool_wait_cb(server->workers, worker_wait_cb);
-		systemd_tasks_status_notify(0);
+		systemd_tasks_status_notify(0, 0);
 	}
 
 	/* Start evsched handler. */
 	evsched_start(&server->sched);
+	evsched_schedule(server->timers.event, TIMERS_FLUSH_INTERVAL * 1000);
 
 	/* Start I/O handlers. */
 	server->state |= ServerRunning;
-	for (int proto = IO_UDP; proto <= IO_XDP; ++proto) {
+	for (int proto = IO_UDP; proto <= IO_XFR; ++proto) {
 		if (server->handlers[proto].size > 0) {
 			int ret = dt_start(server->handlers[proto].handler.unit);
 			if (ret != KNOT_EOK) {
@@ -808,7 +1145,7 @@ void server_wait(server_t *server)
 	evsched_join(&server->sched);
 	worker_pool_join(server->workers);
 
-	for (int proto = IO_UDP; proto <= IO_XDP; ++proto) {
+	for (int proto = IO_UDP; proto <= IO_XFR; ++proto) {
 		if (server->handlers[proto].size > 0) {
 			server_free_handler(&server->handlers[proto].handler);
 		}
@@ -865,17 +1202,19 @@ static int reload_conf(conf_t *new_conf)
 	return KNOT_EOK;
 }
 
-/*! \brief Check if parameter listen(-xdp) has been changed since knotd started. */
+/*! \brief Check if parameter listen(-xdp/-tls) has been changed since knotd started. */
 static bool listen_changed(conf_t *conf, server_t *server)
 {
 	assert(server->ifaces);
 
 	conf_val_t listen_val = conf_get(conf, C_SRV, C_LISTEN);
+	conf_val_t listls_val = conf_get(conf, C_SRV, C_LISTEN_TLS);
 	conf_val_t lisxdp_val = conf_get(conf, C_XDP, C_LISTEN);
 	if (lisxdp_val.code != KNOT_EOK) {
 		lisxdp_val = conf_get(conf, C_SRV, C_LISTEN_XDP);
 	}
-	size_t new_count = conf_val_count(&listen_val) + conf_val_count(&lisxdp_val);
+	size_t new_count = conf_val_count(&listen_val) + conf_val_count(&listls_val) +
+	                   xdp_iface_count(&lisxdp_val);
 	size_t old_count = server->n_ifaces;
 	if (new_count != old_count) {
 		return true;
@@ -903,14 +1242,32 @@ static bool listen_changed(conf_t *conf, server_t *server)
 	}
 	free(rundir);
 
+	while (listls_val.code == KNOT_EOK) {
+		struct sockaddr_storage addr = conf_addr(&listls_val, NULL);
+		bool found = false;
+		for (size_t i = 0; i < server->n_ifaces; i++) {
+			if (server->ifaces[i].tls &&
+			    sockaddr_cmp(&addr, &server->ifaces[i].addr, false) == 0) {
+				matches++;
+				found = true;
+				break;
+			}
+		}
+		if (!found) {
+			break;
+		}
+		conf_val_next(&listls_val);
+	}
+
 	while (lisxdp_val.code == KNOT_EOK) {
 		struct sockaddr_storage addr = conf_addr(&lisxdp_val, NULL);
 		bool found = false;
 		for (size_t i = 0; i < server->n_ifaces; i++) {
-			if (sockaddr_cmp(&addr, &server->ifaces[i].addr, false) == 0) {
+			// All the members of a bond share the address.
+			if (server->ifaces[i].fd_xdp_count > 0 &&
+			    sockaddr_cmp(&addr, &server->ifaces[i].addr, false) == 0) {
 				matches++;
 				found = true;
-				break;
 			}
 		}
 		if (!found) {
@@ -929,13 +1286,17 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 
 	static bool warn_tcp_reuseport = true;
 	static bool warn_socket_affinity = true;
+	static bool warn_socket_steering = true;
+	static bool warn_cpu_placement = true;
 	static bool warn_udp = true;
 	static bool warn_tcp = true;
+	static bool warn_xfr = true;
 	static bool warn_bg = true;
 	static bool warn_listen = true;
 	static bool warn_xdp_tcp = true;
 	static bool warn_route_check = true;
 	static bool warn_rmt_pool_limit = true;
+	static bool warn_rmt_pool_mux = true;
 
 	if (warn_tcp_reuseport && conf->cache.srv_tcp_reuseport != conf_get_bool(conf, C_SRV, C_TCP_REUSEPORT)) {
 		log_warning(msg, &C_TCP_REUSEPORT[1]);
@@ -947,6 +1308,16 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 		warn_socket_affinity = false;
 	}
 
+	if (warn_socket_steering && conf->cache.srv_socket_steering != conf_get_bool(conf, C_SRV, C_SOCKET_STEERING)) {
+		log_warning(msg, &C_SOCKET_STEERING[1]);
+		warn_socket_steering = false;
+	}
+
+	if (warn_cpu_placement && conf->cache.srv_cpu_placement != conf_get_bool(conf, C_SRV, C_CPU_PLACEMENT)) {
+		log_warning(msg, &C_CPU_PLACEMENT[1]);
+		warn_cpu_placement = false;
+	}
+
 	if (warn_udp && server->handlers[IO_UDP].size != conf_udp_threads(conf)) {
 		log_warning(msg, &C_UDP_WORKERS[1]);
 		warn_udp = false;
@@ -957,13 +1328,18 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 		warn_tcp = false;
 	}
 
+	if (warn_xfr && server->handlers[IO_XFR].size != conf_xfr_threads(conf)) {
+		log_warning(msg, &C_XFR_WORKERS[1]);
+		warn_xfr = false;
+	}
+
 	if (warn_bg && conf->cache.srv_bg_threads != conf_bg_threads(conf)) {
 		log_warning(msg, &C_BG_WORKERS[1]);
 		warn_bg = false;
 	}
 
 	if (warn_listen && server->ifaces != NULL && listen_changed(conf, server)) {
-		log_warning(msg, "listen(-xdp)");
+		log_warning(msg, "listen(-xdp/-tls)");
 		warn_listen = false;
 	}
 
@@ -982,6 +1358,12 @@ static void warn_server_reconfigure(conf_t *conf, server_t *server)
 		log_warning(msg, &C_RMT_POOL_LIMIT[1]);
 		warn_rmt_pool_limit = false;
 	}
+
+	if (warn_rmt_pool_mux && global_query_mux != NULL &&
+	    !conf_get_bool(conf, C_SRV, C_RMT_POOL_MUX)) {
+		log_warning(msg, &C_RMT_POOL_MUX[1]);
+		warn_rmt_pool_mux = false;
+	}
 }
 
 int server_reload(server_t *server)
@@ -1035,6 +1417,7 @@ int server_reload(server_t *server)
 
 	/* Update to the new config. */
 	conf_t *old_conf = conf_update(new_conf, upd_flags);
+	zone_answers_invalidate();
 
 	/* Reload each component if full reload or a specific one if required. */
 	if (full || (flags & CONF_IO_FRLD_LOG)) {
@@ -1045,7 +1428,8 @@ int server_reload(server_t *server)
 		warn_server_reconfigure(conf(), server);
 		stats_reconfigure(conf(), server);
 	}
-	if (full || (flags & (CONF_IO_FRLD_ZONES | CONF_IO_FRLD_ZONE))) {
+	if (full || (flags & (CONF_IO_FRLD_ZONES | CONF_IO_FRLD_ZONE |
+	                      CONF_IO_FZONE | CONF_IO_FTPL))) {
 		server_update_zones(conf(), server);
 	}
 
@@ -1067,6 +1451,33 @@ int server_reload(server_t *server)
 	return KNOT_EOK;
 }
 
+void server_drain(server_t *server, unsigned timeout)
+{
+	log_info("draining connections");
+	server->state |= ServerDraining;
+
+	/* The zones are maintained by the successor. */
+	evsched_stop(&server->sched);
+	worker_pool_stop(server->workers);
+
+	/* The stateless processing stops reading the shared sockets right away. */
+	for (int proto = IO_UDP; proto <= IO_XDP; ++proto) {
+		if (proto != IO_TCP && server->handlers[proto].size > 0) {
+			dt_stop(server->handlers[proto].handler.unit);
+		}
+	}
+
+	/* Let the TCP connections and zone transfers finish. */
+	for (unsigned i = 0; i < timeout * 10; i++) {
+		if (__atomic_load_n(&server->tcp_running[0], __ATOMIC_ACQUIRE) == 0 &&
+		    __atomic_load_n(&server->tcp_running[1], __ATOMIC_ACQUIRE) == 0) {
+			return;
+		}
+		usleep(100000);
+	}
+	log_warning("draining connections timed out");
+}
+
 void server_stop(server_t *server)
 {
 	log_info("stopping server");
@@ -1108,6 +1519,18 @@ static int configure_threads(conf_t *conf, server_t *server)
 		}
 	}
 
+	/* The hand-over queues must exist before the TCP workers start. */
+	if (conf->cache.srv_xfr_threads > 0) {
+		server->xfr = tcp_xfr_new(conf->cache.srv_xfr_threads);
+		if (server->xfr == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ret = set_handler(server, IO_XFR, conf->cache.srv_xfr_threads, xfr_master);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
 	return set_handler(server, IO_TCP, conf->cache.srv_tcp_threads, tcp_master);
 }
 
@@ -1116,13 +1539,23 @@ static int reconfigure_journal_db(conf_t *conf, server_t *server)
 	char *journal_dir = conf_db(conf, C_JOURNAL_DB);
 	conf_val_t journal_size = conf_db_param(conf, C_JOURNAL_DB_MAX_SIZE);
 	conf_val_t journal_mode = conf_db_param(conf, C_JOURNAL_DB_MODE);
-	int ret = knot_lmdb_reinit(&server->journaldb, journal_dir, conf_int(&journal_size),
-	                           journal_env_flags(conf_opt(&journal_mode), false));
-	if (ret != KNOT_EOK) {
-		log_warning("ignored reconfiguration of journal DB (%s)", knot_strerror(ret));
+	// The number of shards is kept till restart, the zones are mapped onto them.
+	for (unsigned i = 0; i < server->journaldb_shards; i++) {
+		char *shard_dir = journal_db_shard_path(journal_dir, i);
+		int ret = (shard_dir == NULL) ? KNOT_ENOMEM :
+		          knot_lmdb_reinit(&server->journaldb[i], shard_dir, conf_int(&journal_size),
+		                           journal_env_flags(conf_opt(&journal_mode), false));
+		free(shard_dir);
+		if (ret != KNOT_EOK) {
+			log_warning("ignored reconfiguration of journal DB (%s)", knot_strerror(ret));
+			break;
+		}
 	}
 	free(journal_dir);
 
+	conf_val_t journal_delay = conf_db_param(conf, C_JOURNAL_DB_COMMIT_DELAY);
+	journal_group_set_delay(&server->journal_group, conf_int(&journal_delay));
+
 	return KNOT_EOK; // not "ret"
 }
 
@@ -1148,6 +1581,32 @@ static int reconfigure_timer_db(conf_t *conf, server_t *server)
 	return ret;
 }
 
+static int reconfigure_background(conf_t *conf, server_t *server)
+{
+	conf_val_t val = conf_get(conf, C_SRV, C_BG_CPUS);
+	unsigned *cpus = NULL;
+	size_t count = 0;
+	int ret = conf_cpu_list(conf_str(&val), &cpus, &count);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Without explicit CPUs, the ones left by the query workers are used. */
+	const unsigned *bg_cpus = cpus;
+	if (count == 0) {
+		count = placement_background(server->placement, &bg_cpus);
+	}
+
+	val = conf_get(conf, C_SRV, C_BG_PRIORITY);
+	ret = worker_isolation_set(bg_cpus, count, conf_opt(&val));
+	free(cpus);
+
+	val = conf_get(conf, C_SRV, C_SIGNING_RATE_LIMIT);
+	sign_pool_set_rate_limit(conf_int(&val));
+
+	return ret;
+}
+
 static int reconfigure_remote_pool(conf_t *conf)
 {
 	conf_val_t val = conf_get(conf, C_SRV, C_RMT_POOL_LIMIT);
@@ -1164,6 +1623,17 @@ static int reconfigure_remote_pool(conf_t *conf)
 		(void)conn_pool_timeout(global_conn_pool, timeout);
 	}
 
+	val = conf_get(conf, C_SRV, C_RMT_POOL_MUX);
+	if (global_query_mux == NULL && conf_bool(&val)) {
+		query_mux_t *new_mux = query_mux_init(timeout);
+		if (new_mux == NULL) {
+			return KNOT_ENOMEM;
+		}
+		global_query_mux = new_mux;
+	} else {
+		query_mux_timeout(global_query_mux, timeout);
+	}
+
 	val = conf_get(conf, C_SRV, C_RMT_RETRY_DELAY);
 	int delay_ms = conf_int(&val);
 	if (global_unreachables == NULL && delay_ms > 0) {
@@ -1175,6 +1645,154 @@ static int reconfigure_remote_pool(conf_t *conf)
 	return KNOT_EOK;
 }
 
+static void reconfigure_xdp_rrl(conf_t *conf, server_t *server)
+{
+#ifdef ENABLE_XDP
+	uint32_t rate = conf_get_int(conf, C_XDP, C_RATE_LIMIT);
+	uint32_t slip = conf_get_int(conf, C_XDP, C_RATE_LIMIT_SLIP);
+
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		if (iface->fd_xdp_count == 0) {
+			continue;
+		}
+
+		/* The setting is shared by all queues of the interface. */
+		int ret = knot_xdp_rrl_set(iface->xdp_sockets[0], rate, slip);
+		if (ret != KNOT_EOK && (rate > 0 || ret != KNOT_ENOTSUP)) {
+			log_warning("failed to configure XDP rate limiting (%s)",
+			            knot_strerror(ret));
+		}
+	}
+#endif
+}
+
+#ifdef ENABLE_XDP
+static size_t xdp_acl_rules(conf_t *conf, const yp_name_t *item, uint32_t action,
+                            struct knot_xdp_acl_rule *rules)
+{
+	size_t count = 0;
+	conf_val_t val = conf_get(conf, C_XDP, item);
+	while (val.code == KNOT_EOK) {
+		struct sockaddr_storage max_ss;
+		int prefix_len;
+		struct sockaddr_storage ss = conf_addr_range(&val, &max_ss, &prefix_len);
+		conf_val_next(&val);
+
+		struct knot_xdp_acl_rule *rule = &rules[count];
+		memset(rule, 0, sizeof(*rule));
+		int bits;
+		if (ss.ss_family == AF_INET) {
+			struct sockaddr_in *sa = (struct sockaddr_in *)&ss;
+			memcpy(rule->key.addr, &sa->sin_addr, sizeof(sa->sin_addr));
+			rule->key.family = 4;
+			bits = 32;
+		} else if (ss.ss_family == AF_INET6) {
+			struct sockaddr_in6 *sa = (struct sockaddr_in6 *)&ss;
+			memcpy(rule->key.addr, &sa->sin6_addr, sizeof(sa->sin6_addr));
+			rule->key.family = 6;
+			bits = 128;
+		} else {
+			continue;
+		}
+		if (max_ss.ss_family != AF_UNSPEC) {
+			continue; // Ranges are refused by the configuration check.
+		}
+		if (prefix_len < 0 || prefix_len > bits) {
+			prefix_len = bits;
+		}
+
+		/* Clear the host bits. */
+		for (int i = prefix_len; i < bits; i++) {
+			rule->key.addr[i / 8] &= ~(0x80 >> (i % 8));
+		}
+		rule->key.prefixlen = 8 + prefix_len;
+		rule->action = action;
+		count++;
+	}
+
+	return count;
+}
+#endif
+
+static void reconfigure_xdp_acl(conf_t *conf, server_t *server)
+{
+#ifdef ENABLE_XDP
+	conf_val_t deny = conf_get(conf, C_XDP, C_DENY_PREFIX);
+	conf_val_t allow = conf_get(conf, C_XDP, C_ALLOW_PREFIX);
+	size_t max_count = conf_val_count(&deny) + conf_val_count(&allow);
+
+	struct knot_xdp_acl_rule *rules = NULL;
+	size_t count = 0;
+	if (max_count > 0) {
+		rules = calloc(max_count, sizeof(*rules));
+		if (rules == NULL) {
+			log_warning("failed to configure XDP access control (%s)",
+			            knot_strerror(KNOT_ENOMEM));
+			return;
+		}
+		count = xdp_acl_rules(conf, C_DENY_PREFIX, KNOT_XDP_ACL_DENY, rules);
+		count += xdp_acl_rules(conf, C_ALLOW_PREFIX, KNOT_XDP_ACL_ALLOW, rules + count);
+	}
+
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		if (iface->fd_xdp_count == 0) {
+			continue;
+		}
+
+		/* The setting is shared by all queues of the interface. */
+		int ret = knot_xdp_acl_set(iface->xdp_sockets[0], rules, count);
+		if (ret != KNOT_EOK && (count > 0 || ret != KNOT_ENOTSUP)) {
+			log_warning("failed to configure XDP access control (%s)",
+			            knot_strerror(ret));
+		}
+	}
+
+	/* Kept for the statistics. */
+	free(server->xdp_acl);
+	server->xdp_acl = rules;
+	server->xdp_acl_count = count;
+#endif
+}
+
+#ifdef ENABLE_XDP
+static pthread_mutex_t xdp_answers_mx = PTHREAD_MUTEX_INITIALIZER;
+static bool xdp_answers_enabled = false;
+
+static void xdp_answers_update(void *data)
+{
+	server_t *server = data;
+
+	/* Serialized so that an older generation never overwrites a newer one. */
+	pthread_mutex_lock(&xdp_answers_mx);
+	uint32_t generation = zone_answers_generation();
+	for (size_t i = 0; i < server->n_ifaces; i++) {
+		iface_t *iface = &server->ifaces[i];
+		if (iface->fd_xdp_count > 0) {
+			(void)knot_xdp_answer_conf(iface->xdp_sockets[0], xdp_answers_enabled,
+			                           generation);
+		}
+	}
+	pthread_mutex_unlock(&xdp_answers_mx);
+}
+#endif
+
+static void reconfigure_xdp_answers(conf_t *conf, server_t *server)
+{
+#ifdef ENABLE_XDP
+	bool enabled = conf->cache.xdp_answer_cache > 0 && !conf->cache.xdp_route_check;
+
+	pthread_mutex_lock(&xdp_answers_mx);
+	xdp_answers_enabled = enabled;
+	pthread_mutex_unlock(&xdp_answers_mx);
+
+	/* The answers in the filter are tied to the current answer generation. */
+	zone_answers_set_hook(enabled ? xdp_answers_update : NULL, server);
+	xdp_answers_update(server);
+#endif
+}
+
 int server_reconfigure(conf_t *conf, server_t *server)
 {
 	if (conf == NULL || server == NULL) {
@@ -1197,14 +1815,16 @@ int server_reconfigure(conf_t *conf, server_t *server)
 		}
 
 		/* Configure server threads. */
-		if ((ret = configure_threads(conf, server)) != KNOT_EOK) {
+		if (!(server->state & ServerNoIO) &&
+		    (ret = configure_threads(conf, server)) != KNOT_EOK) {
 			log_error("failed to configure server threads (%s)",
 			          knot_strerror(ret));
 			return ret;
 		}
 
 		/* Configure sockets. */
-		if ((ret = configure_sockets(conf, server)) != KNOT_EOK) {
+		if (!(server->state & ServerNoIO) &&
+		    (ret = configure_sockets(conf, server)) != KNOT_EOK) {
 			return ret;
 		}
 
@@ -1237,6 +1857,21 @@ int server_reconfigure(conf_t *conf, server_t *server)
 		          knot_strerror(ret));
 	}
 
+	/* Reconfigure background isolation. */
+	if ((ret = reconfigure_background(conf, server)) != KNOT_EOK) {
+		log_error("failed to reconfigure background workers (%s)",
+		          knot_strerror(ret));
+	}
+
+	/* Reconfigure XDP access control. */
+	reconfigure_xdp_acl(conf, server);
+
+	/* Reconfigure XDP rate limiting. */
+	reconfigure_xdp_rrl(conf, server);
+
+	/* Reconfigure XDP answers. */
+	reconfigure_xdp_answers(conf, server);
+
 	return KNOT_EOK;
 }
 
@@ -1246,6 +1881,11 @@ void server_update_zones(conf_t *conf, server_t *server)
 		return;
 	}
 
+	/* Apply just the zone changes of the configuration transaction if possible. */
+	if (zonedb_reload_changed(conf, server) == KNOT_EOK) {
+		return;
+	}
+
 	/* Prevent emitting of new zone events. */
 	if (server->zone_db) {
 		knot_zonedb_foreach(server->zone_db, zone_events_freeze);
@@ -20,14 +20,23 @@
 #include "knot/catalog/catalog_update.h"
 #include "knot/common/evsched.h"
 #include "knot/common/fdset.h"
+#include "knot/journal/journal_group.h"
 #include "knot/journal/knot_lmdb.h"
 #include "knot/server/dthreads.h"
+#include "knot/server/handoff.h"
+#include "knot/server/placement.h"
+#include "knot/server/steering.h"
+#include "knot/server/tls.h"
 #include "knot/worker/pool.h"
 #include "knot/zone/backup.h"
+#include "knot/zone/timers.h"
 #include "knot/zone/zonedb.h"
+#include "contrib/bufpool.h"
 
 struct server;
 struct knot_xdp_socket;
+struct knot_xdp_acl_rule;
+struct tcp_xfr;
 
 /*!
  * \brief I/O handler structure.
@@ -45,6 +54,8 @@ typedef struct {
 typedef enum {
 	ServerIdle    = 0 << 0, /*!< Server is idle. */
 	ServerRunning = 1 << 0, /*!< Server is running. */
+	ServerNoIO    = 1 << 1, /*!< No network I/O, the caller processes the queries. */
+	ServerDraining = 1 << 2, /*!< Sockets handed over, finishing the connections. */
 } server_state_t;
 
 /*!
@@ -58,8 +69,10 @@ typedef struct {
 	int *fd_xdp;
 	unsigned fd_xdp_count;
 	unsigned xdp_first_thread_id;
+	char xdp_name[32];
 	struct knot_xdp_socket **xdp_sockets;
 	struct sockaddr_storage addr;
+	bool tls;
 } iface_t;
 
 /*!
@@ -69,6 +82,7 @@ enum {
 	IO_UDP = 0,
 	IO_TCP = 1,
 	IO_XDP = 2,
+	IO_XFR = 3,
 };
 
 /*!
@@ -82,7 +96,9 @@ typedef struct server {
 
 	knot_zonedb_t *zone_db;
 	knot_lmdb_db_t timerdb;
-	knot_lmdb_db_t journaldb;
+	knot_lmdb_db_t journaldb[JOURNAL_DB_SHARDS_MAX]; /*!< Journal DB shards. */
+	unsigned journaldb_shards;
+	journal_group_t journal_group;
 	knot_lmdb_db_t kaspdb;
 	catalog_t catalog;
 
@@ -90,25 +106,75 @@ typedef struct server {
 	struct {
 		unsigned size;
 		iohandler_t handler;
-	} handlers[3];
+	} handlers[4];
+
+	/*! \brief Connections handed over to the zone transfer workers. */
+	struct tcp_xfr *xfr;
 
 	/*! \brief Background jobs. */
 	worker_pool_t *workers;
 
+	/*! \brief Background zone file writing. */
+	worker_pool_t *flusher;
+
 	/*! \brief Event scheduler. */
 	evsched_t sched;
 
+	/*! \brief Periodic persisting of the changed zone timers. */
+	struct {
+		zone_timers_dirty_t zones; /*!< Zones with changed timers. */
+		event_t *event;            /*!< Flush scheduling. */
+		worker_task_t task;        /*!< Flush running in the background workers. */
+	} timers;
+
 	/*! \brief List of interfaces. */
 	iface_t *ifaces;
 	size_t n_ifaces;
 
+	/*! \brief Sockets handed over by the predecessor (during the startup only). */
+	handoff_t *handoff;
+
+	/*! \brief Running TCP and zone transfer workers (observed when draining). */
+	unsigned tcp_running[2];
+
+	/*! \brief Placement of the worker threads by the NIC topology. */
+	placement_t *placement;
+
+	/*! \brief Source prefix rules of the XDP access control. */
+	struct knot_xdp_acl_rule *xdp_acl;
+	size_t xdp_acl_count;
+
+	/*! \brief eBPF steering of the UDP and TCP socket groups. */
+	steering_t *steering[2];
+
+	/*! \brief DNS over TLS server credentials. */
+	tls_creds_t *tls_creds;
+
 	/*! \brief Pending changes to catalog member zones. */
 	catalog_update_t catalog_upd;
 
 	/*! \brief Context of pending zones' backup. */
 	zone_backup_ctxs_t backup_ctxs;
+
+	/*! \brief Shared buffers of the partly received TCP messages. */
+	buf_pool_t tcp_bufs;
+
+	/*! \brief Server-wide I/O counters (updated atomically). */
+	struct {
+		uint64_t udp_gso_msgs;  /*!< Sent UDP GSO super-packets. */
+		uint64_t udp_gso_segs;  /*!< Responses sent within GSO super-packets. */
+		uint64_t refresh_suppressed; /*!< NOTIFYs coalesced into a planned refresh. */
+	} stats;
 } server_t;
 
+/*!
+ * \brief Returns the journal DB shard holding the zone.
+ */
+inline static knot_lmdb_db_t *server_journaldb(server_t *server, const knot_dname_t *zone)
+{
+	return &server->journaldb[journal_db_shard(zone, server->journaldb_shards)];
+}
+
 /*!
  * \brief Initializes the server structure.
  *
@@ -160,6 +226,17 @@ int server_reload(server_t *server);
  */
 void server_stop(server_t *server);
 
+/*!
+ * \brief Stops serving the sockets handed over to the successor.
+ *
+ * The zone events and UDP processing stop immediately, the TCP connections
+ * and zone transfers in progress are finished, no new connections are accepted.
+ *
+ * \param server   Server structure to be used for operation.
+ * \param timeout  Time limit for the connections to finish (in seconds).
+ */
+void server_drain(server_t *server, unsigned timeout);
+
 /*!
  * \brief Server reconfiguration routine.
  *
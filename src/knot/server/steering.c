@@ -0,0 +1,397 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "knot/server/steering.h"
+#include "libknot/errcode.h"
+
+#ifdef HAVE_REUSEPORT_EBPF
+
+#include <dirent.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/bpf.h>
+
+#include "knot/server/dthreads.h"
+
+// Limit of the NUMA node identifiers.
+#define NODES_MAX	64
+
+// Load difference above which a flow leaves its primary socket.
+#define LOAD_MARGIN	8
+
+// Not defined in older headers, the map is just not mmapable there.
+#define MAP_F_MMAPABLE	(1U << 10)
+
+#define INSN(c, d, s, o, i)	((struct bpf_insn){ .code = (c), .dst_reg = (d), \
+				                    .src_reg = (s), .off = (o), .imm = (i) })
+#define MOV_REG(d, s)		INSN(BPF_ALU64 | BPF_MOV | BPF_X, d, s, 0, 0)
+#define MOV_IMM(d, i)		INSN(BPF_ALU64 | BPF_MOV | BPF_K, d, 0, 0, i)
+#define ALU_REG(op, d, s)	INSN(BPF_ALU64 | (op) | BPF_X, d, s, 0, 0)
+#define ALU_IMM(op, d, i)	INSN(BPF_ALU64 | (op) | BPF_K, d, 0, 0, i)
+#define LDX_W(d, s, o)		INSN(BPF_LDX | BPF_MEM | BPF_W, d, s, o, 0)
+#define LDX_DW(d, s, o)		INSN(BPF_LDX | BPF_MEM | BPF_DW, d, s, o, 0)
+#define STX_W(d, s, o)		INSN(BPF_STX | BPF_MEM | BPF_W, d, s, o, 0)
+#define STX_DW(d, s, o)		INSN(BPF_STX | BPF_MEM | BPF_DW, d, s, o, 0)
+#define JMP_IMM(op, d, i)	INSN(BPF_JMP | (op) | BPF_K, d, 0, 0, i)
+#define JMP_REG(op, d, s)	INSN(BPF_JMP | (op) | BPF_X, d, s, 0, 0)
+#define CALL(f)			INSN(BPF_JMP | BPF_CALL, 0, 0, 0, f)
+#define EXIT()			INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+// The map reference is a 64-bit immediate, i.e. two instructions.
+#define LD_MAP(prog, len, d, fd) { \
+	(prog)[(len)++] = INSN(BPF_LD | BPF_DW | BPF_IMM, d, BPF_PSEUDO_MAP_FD, 0, fd); \
+	(prog)[(len)++] = INSN(0, 0, 0, 0, 0); \
+}
+
+typedef struct {
+	uint32_t first; // First key of the node group.
+	uint32_t count; // Number of the sockets in the group.
+} group_t;
+
+struct steering {
+	unsigned count;
+	int groups_fd;
+	int load_fd;        // -1 if the load isn't considered.
+	uint64_t *load;     // Mapped load map values (arrays keep 8-byte values).
+	size_t load_size;
+	uint32_t key[];     // Socket array key of each socket.
+};
+
+static int sys_bpf(int cmd, union bpf_attr *attr)
+{
+	int ret = syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+	if (ret < 0) {
+		return (errno == ENOSYS) ? KNOT_ENOTSUP : knot_map_errno();
+	}
+	return ret;
+}
+
+static int map_create(uint32_t type, uint32_t value_size, uint32_t entries, uint32_t flags)
+{
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = type;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = value_size;
+	attr.max_entries = entries;
+	attr.map_flags = flags;
+
+	return sys_bpf(BPF_MAP_CREATE, &attr);
+}
+
+static int map_update(int fd, uint32_t key, const void *value)
+{
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = fd;
+	attr.key = (uintptr_t)&key;
+	attr.value = (uintptr_t)value;
+	attr.flags = BPF_ANY;
+
+	int ret = sys_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+	return (ret < 0) ? ret : KNOT_EOK;
+}
+
+static unsigned cpu_node(unsigned cpu)
+{
+	char path[64];
+	(void)snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+
+	unsigned node = 0;
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		return node;
+	}
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (sscanf(entry->d_name, "node%u", &node) == 1) {
+			break;
+		}
+	}
+	closedir(dir);
+
+	return (node < NODES_MAX) ? node : 0;
+}
+
+static int prog_load(steering_t *st, int socks_fd)
+{
+	struct bpf_insn prog[64];
+	unsigned len = 0, to_pass[2], to_select[2];
+
+	// r6 = context, r7 = flow hash.
+	prog[len++] = MOV_REG(BPF_REG_6, BPF_REG_1);
+	prog[len++] = LDX_W(BPF_REG_7, BPF_REG_6, offsetof(struct sk_reuseport_md, hash));
+	// r8 = first key, r9 = number of sockets of the local node group.
+	prog[len++] = CALL(BPF_FUNC_get_numa_node_id);
+	prog[len++] = STX_W(BPF_REG_10, BPF_REG_0, -4);
+	LD_MAP(prog, len, BPF_REG_1, st->groups_fd);
+	prog[len++] = MOV_REG(BPF_REG_2, BPF_REG_10);
+	prog[len++] = ALU_IMM(BPF_ADD, BPF_REG_2, -4);
+	prog[len++] = CALL(BPF_FUNC_map_lookup_elem);
+	to_pass[0] = len;
+	prog[len++] = JMP_IMM(BPF_JEQ, BPF_REG_0, 0);
+	prog[len++] = LDX_W(BPF_REG_8, BPF_REG_0, offsetof(group_t, first));
+	prog[len++] = LDX_W(BPF_REG_9, BPF_REG_0, offsetof(group_t, count));
+	to_pass[1] = len;
+	prog[len++] = JMP_IMM(BPF_JEQ, BPF_REG_9, 0);
+	// Primary key = first + hash % count.
+	prog[len++] = MOV_REG(BPF_REG_1, BPF_REG_7);
+	prog[len++] = ALU_REG(BPF_MOD, BPF_REG_1, BPF_REG_9);
+	prog[len++] = ALU_REG(BPF_ADD, BPF_REG_1, BPF_REG_8);
+	prog[len++] = STX_W(BPF_REG_10, BPF_REG_1, -8);
+
+	unsigned selects = 0;
+	if (st->load_fd >= 0) {
+		// Load of the primary socket.
+		LD_MAP(prog, len, BPF_REG_1, st->load_fd);
+		prog[len++] = MOV_REG(BPF_REG_2, BPF_REG_10);
+		prog[len++] = ALU_IMM(BPF_ADD, BPF_REG_2, -8);
+		prog[len++] = CALL(BPF_FUNC_map_lookup_elem);
+		to_select[selects++] = len;
+		prog[len++] = JMP_IMM(BPF_JEQ, BPF_REG_0, 0);
+		prog[len++] = LDX_DW(BPF_REG_1, BPF_REG_0, 0);
+		prog[len++] = STX_DW(BPF_REG_10, BPF_REG_1, -16);
+		// Alternative key = first + (hash >> 16) % count.
+		prog[len++] = MOV_REG(BPF_REG_1, BPF_REG_7);
+		prog[len++] = ALU_IMM(BPF_RSH, BPF_REG_1, 16);
+		prog[len++] = ALU_REG(BPF_MOD, BPF_REG_1, BPF_REG_9);
+		prog[len++] = ALU_REG(BPF_ADD, BPF_REG_1, BPF_REG_8);
+		prog[len++] = STX_W(BPF_REG_10, BPF_REG_1, -20);
+		LD_MAP(prog, len, BPF_REG_1, st->load_fd);
+		prog[len++] = MOV_REG(BPF_REG_2, BPF_REG_10);
+		prog[len++] = ALU_IMM(BPF_ADD, BPF_REG_2, -20);
+		prog[len++] = CALL(BPF_FUNC_map_lookup_elem);
+		to_select[selects++] = len;
+		prog[len++] = JMP_IMM(BPF_JEQ, BPF_REG_0, 0);
+		// Keep the primary one unless its load is notably higher.
+		prog[len++] = LDX_DW(BPF_REG_1, BPF_REG_0, 0);
+		prog[len++] = ALU_IMM(BPF_ADD, BPF_REG_1, LOAD_MARGIN);
+		prog[len++] = LDX_DW(BPF_REG_2, BPF_REG_10, -16);
+		prog[len++] = JMP_REG(BPF_JLE, BPF_REG_2, BPF_REG_1);
+		unsigned keep = len - 1;
+		prog[len++] = LDX_W(BPF_REG_1, BPF_REG_10, -20);
+		prog[len++] = STX_W(BPF_REG_10, BPF_REG_1, -8);
+		prog[keep].off = len - keep - 1;
+	}
+
+	// Select the socket, the default selection by hash is used on failure.
+	for (unsigned i = 0; i < selects; i++) {
+		prog[to_select[i]].off = len - to_select[i] - 1;
+	}
+	prog[len++] = MOV_REG(BPF_REG_1, BPF_REG_6);
+	LD_MAP(prog, len, BPF_REG_2, socks_fd);
+	prog[len++] = MOV_REG(BPF_REG_3, BPF_REG_10);
+	prog[len++] = ALU_IMM(BPF_ADD, BPF_REG_3, -8);
+	prog[len++] = MOV_IMM(BPF_REG_4, 0);
+	prog[len++] = CALL(BPF_FUNC_sk_select_reuseport);
+
+	for (unsigned i = 0; i < 2; i++) {
+		prog[to_pass[i]].off = len - to_pass[i] - 1;
+	}
+	prog[len++] = MOV_IMM(BPF_REG_0, SK_PASS);
+	prog[len++] = EXIT();
+
+	union bpf_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_SK_REUSEPORT;
+	attr.insns = (uintptr_t)prog;
+	attr.insn_cnt = len;
+	attr.license = (uintptr_t)"GPL";
+
+	return sys_bpf(BPF_PROG_LOAD, &attr);
+}
+
+static int set_groups(steering_t *st, const placement_t *placement)
+{
+	unsigned node[st->count];
+	unsigned cpus = dt_online_cpus();
+	for (unsigned i = 0; i < st->count; i++) {
+		node[i] = (cpus > 1) ? cpu_node(placement_cpu(placement, i)) : 0;
+	}
+
+	// The keys of the sockets of each node are consecutive.
+	group_t groups[NODES_MAX] = { { 0 } };
+	uint32_t key = 0;
+	for (unsigned n = 0; n < NODES_MAX; n++) {
+		groups[n].first = key;
+		for (unsigned i = 0; i < st->count; i++) {
+			if (node[i] == n) {
+				st->key[i] = key++;
+			}
+		}
+		groups[n].count = key - groups[n].first;
+	}
+
+	// Nodes without a worker use all the sockets.
+	for (unsigned n = 0; n < NODES_MAX; n++) {
+		if (groups[n].count == 0) {
+			groups[n].first = 0;
+			groups[n].count = st->count;
+		}
+		int ret = map_update(st->groups_fd, n, &groups[n]);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static void load_init(steering_t *st)
+{
+	st->load_fd = map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint64_t), st->count,
+	                         MAP_F_MMAPABLE);
+	if (st->load_fd < 0) {
+		return;
+	}
+
+	long page = sysconf(_SC_PAGESIZE);
+	st->load_size = (st->count * sizeof(uint64_t) + page - 1) & ~(page - 1);
+	st->load = mmap(NULL, st->load_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	                st->load_fd, 0);
+	if (st->load == MAP_FAILED) {
+		st->load = NULL;
+		close(st->load_fd);
+		st->load_fd = -1;
+	}
+}
+
+int steering_new(unsigned count, bool load, const placement_t *placement,
+                 steering_t **out)
+{
+	if (count == 0 || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	steering_t *st = calloc(1, sizeof(*st) + count * sizeof(st->key[0]));
+	if (st == NULL) {
+		return KNOT_ENOMEM;
+	}
+	st->count = count;
+	st->load_fd = -1;
+
+	st->groups_fd = map_create(BPF_MAP_TYPE_ARRAY, sizeof(group_t), NODES_MAX, 0);
+	if (st->groups_fd < 0) {
+		int ret = st->groups_fd;
+		free(st);
+		return ret;
+	}
+
+	int ret = set_groups(st, placement);
+	if (ret != KNOT_EOK) {
+		steering_free(st);
+		return ret;
+	}
+
+	if (load) {
+		load_init(st);
+	}
+
+	*out = st;
+	return KNOT_EOK;
+}
+
+int steering_attach(steering_t *st, const int *socks, unsigned count)
+{
+	if (st == NULL || socks == NULL || count != st->count) {
+		return KNOT_EINVAL;
+	}
+
+	int socks_fd = map_create(BPF_MAP_TYPE_REUSEPORT_SOCKARRAY, sizeof(uint32_t),
+	                          count, 0);
+	if (socks_fd < 0) {
+		return socks_fd;
+	}
+
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < count && ret == KNOT_EOK; i++) {
+		uint32_t fd = socks[i];
+		ret = map_update(socks_fd, st->key[i], &fd);
+	}
+
+	if (ret == KNOT_EOK) {
+		int prog_fd = prog_load(st, socks_fd);
+		if (prog_fd < 0) {
+			ret = prog_fd;
+		} else {
+			// Replaces any program of the group, both maps are kept by it.
+			if (setsockopt(socks[0], SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF,
+			               &prog_fd, sizeof(prog_fd)) != 0) {
+				ret = knot_map_errno();
+			}
+			close(prog_fd);
+		}
+	}
+	close(socks_fd);
+
+	return ret;
+}
+
+void steering_load(steering_t *st, unsigned idx, unsigned load)
+{
+	if (st == NULL || st->load == NULL || idx >= st->count) {
+		return;
+	}
+
+	__atomic_store_n(&st->load[st->key[idx]], load, __ATOMIC_RELAXED);
+}
+
+void steering_free(steering_t *st)
+{
+	if (st == NULL) {
+		return;
+	}
+
+	if (st->load != NULL) {
+		(void)munmap(st->load, st->load_size);
+	}
+	if (st->load_fd >= 0) {
+		close(st->load_fd);
+	}
+	close(st->groups_fd);
+	free(st);
+}
+
+#else // HAVE_REUSEPORT_EBPF
+
+int steering_new(unsigned count, bool load, const placement_t *placement,
+                 steering_t **out)
+{
+	return KNOT_ENOTSUP;
+}
+
+int steering_attach(steering_t *st, const int *socks, unsigned count)
+{
+	return KNOT_ENOTSUP;
+}
+
+void steering_load(steering_t *st, unsigned idx, unsigned load)
+{
+}
+
+void steering_free(steering_t *st)
+{
+}
+
+#endif // HAVE_REUSEPORT_EBPF
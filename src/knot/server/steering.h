@@ -0,0 +1,75 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "knot/server/placement.h"
+
+/*!
+ * \brief eBPF steering of packets and connections over a SO_REUSEPORT group.
+ *
+ * The socket is chosen by the flow hash of the client among the sockets
+ * whose workers run on the NUMA node of the CPU that received the packet
+ * (i.e. of the NIC queue). If the load of the workers is published, a flow
+ * is moved to an alternative socket of the node if the load of the primary
+ * one is notably higher.
+ *
+ * The socket i is expected to be served by a worker pinned to the CPU
+ * placement_cpu(placement, i).
+ */
+typedef struct steering steering_t;
+
+/*!
+ * \brief Prepares the steering shared by the socket groups of one protocol.
+ *
+ * \param count      Number of the sockets in each group.
+ * \param load       Consider the published load of the workers.
+ * \param placement  Placement of the workers (NULL if not used).
+ * \param out        Output steering context.
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_ENOTSUP if not supported by the system.
+ * \return KNOT_E* on error.
+ */
+int steering_new(unsigned count, bool load, const placement_t *placement,
+                 steering_t **out);
+
+/*!
+ * \brief Attaches the steering program to a group of SO_REUSEPORT sockets.
+ *
+ * \param st     Steering context.
+ * \param socks  Bound (and listening in the case of TCP) sockets.
+ * \param count  Number of the sockets.
+ *
+ * \return KNOT_E*
+ */
+int steering_attach(steering_t *st, const int *socks, unsigned count);
+
+/*!
+ * \brief Publishes the load (e.g. open connections) of the worker (NULL is ignored).
+ *
+ * \param st    Steering context.
+ * \param idx   Index of the socket served by the worker.
+ * \param load  Current load of the worker.
+ */
+void steering_load(steering_t *st, unsigned idx, unsigned load);
+
+/*!
+ * \brief Frees the steering context, attached programs stay in use.
+ */
+void steering_free(steering_t *st);
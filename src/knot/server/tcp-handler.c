@@ -17,13 +17,16 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include <urcu.h>
 #ifdef HAVE_SYS_UIO_H	// struct iovec (OpenBSD)
 #include <sys/uio.h>
@@ -31,10 +34,14 @@
 
 #include "knot/server/server.h"
 #include "knot/server/tcp-handler.h"
+#include "knot/server/tls.h"
 #include "knot/common/log.h"
 #include "knot/common/fdset.h"
+#include "knot/common/memstat.h"
+#include "knot/common/usdt.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/layer.h"
+#include "contrib/bufpool.h"
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/net.h"
@@ -43,11 +50,20 @@
 #include "contrib/time.h"
 #include "contrib/ucw/mempool.h"
 
+#define TCP_OUT_SLOTS 16 /*!< Buffers of large responses being sent. */
+#define TCP_OUT_BATCH 4 /*!< Large responses written at once. */
+#define TCP_OUT_MIN_SIZE (16 * 1024) /*!< Minimal response size to be sent from its buffer. */
+#define TCP_OUT_LOWAT (TCP_OUT_BATCH * KNOT_WIRE_MAX_PKTSIZE) /*!< Limit of unsent data in the socket. */
+#define TCP_HEADROOM sizeof(uint16_t) /*!< Space for the length prefix before the response. */
+
 /*! \brief TCP context data. */
 typedef struct tcp_context {
 	knot_layer_t layer;              /*!< Query processing layer. */
 	server_t *server;                /*!< Name server structure. */
 	struct iovec iov[2];             /*!< TX/RX buffers. */
+	uint8_t *batch;                  /*!< Pending responses to pipelined queries. */
+	size_t batch_len;                /*!< Length of the pending responses. */
+	tls_conn_t *tls;                 /*!< TLS session of the served client (if any). */
 	unsigned client_threshold;       /*!< Index of first TCP client. */
 	struct timespec last_poll_time;  /*!< Time of the last socket poll. */
 	bool is_throttled;               /*!< TCP connections throttling switch. */
@@ -56,9 +72,68 @@ typedef struct tcp_context {
 	unsigned max_worker_fds;         /*!< Max TCP clients per worker configuration + no. of ifaces. */
 	int idle_timeout;                /*!< [s] TCP idle timeout configuration. */
 	int io_timeout;                  /*!< [ms] TCP send/recv timeout configuration. */
+	tcp_xfr_t *xfr;                  /*!< Zone transfer workers (NULL if disabled). */
+	int xfr_slot;                    /*!< Index of the zone transfer worker, -1 if TCP worker. */
+	unsigned xfr_remote_limit;       /*!< Concurrent transfers per remote (0 if unlimited). */
+	size_t xfr_rate;                 /*!< [B/s] Zone transfer pacing (0 if unlimited). */
+	struct {
+		struct timespec start;       /*!< Start of the paced transfer. */
+		uint64_t bytes;              /*!< Data of the paced transfer. */
+		bool active;                 /*!< A zone transfer is being paced. */
+	} pace;
+	struct {
+		uint8_t *buf[TCP_OUT_SLOTS]; /*!< Buffers of large responses (including headroom). */
+		unsigned end[TCP_OUT_SLOTS]; /*!< Zero-copy sends to be completed to release the buffer. */
+		unsigned slots;              /*!< Number of the buffers in use. */
+		unsigned answers;            /*!< Large responses on the served connection. */
+		unsigned pending;            /*!< Last of them not written yet. */
+		unsigned sends;              /*!< Zero-copy sends on the served connection. */
+		unsigned done;               /*!< Completed zero-copy sends. */
+		bool zerocopy;               /*!< Zero-copy used on the served connection. */
+		bool failed;                 /*!< A buffer may be still used by the kernel. */
+		bool zc_enabled;             /*!< Zero-copy send configuration. */
+	} out;
 } tcp_context_t;
 
+/*! \brief State of a client connection. */
+typedef struct {
+	tls_conn_t *tls;                 /*!< TLS session (if accepted on a TLS interface). */
+	uint8_t *msg;                    /*!< Incomplete message (NULL if not needed). */
+	uint32_t msg_cap;                /*!< Size of the pooled message buffer. */
+	uint16_t msg_len;                /*!< Length of the message being received. */
+	uint16_t msg_recv;               /*!< Received part of the message. */
+	uint8_t prefix[sizeof(uint16_t)]; /*!< Length prefix of the message. */
+	uint8_t prefix_recv;             /*!< Received part of the length prefix. */
+	uint8_t *pending;                /*!< Unprocessed input handed over with the connection. */
+	uint32_t pending_len;            /*!< Length of the unprocessed input. */
+	bool handoff;                    /*!< To be handed over to a zone transfer worker. */
+} tcp_conn_t;
+
+/*! \brief Connection handed over to a zone transfer worker. */
+typedef struct tcp_handoff {
+	struct tcp_handoff *next;
+	int fd;
+	tcp_conn_t *conn;
+} tcp_handoff_t;
+
+/*! \brief Queue of the connections of a zone transfer worker. */
+typedef struct {
+	tcp_handoff_t *head;
+	tcp_handoff_t **tail;
+	int wake[2];                     /*!< Pipe waking up the worker. */
+	unsigned clients;                /*!< Connections served by the worker (approximate). */
+} xfr_queue_t;
+
+struct tcp_xfr {
+	pthread_mutex_t mx;              /*!< Lock of the queues and of the remotes. */
+	unsigned workers;                /*!< Number of the zone transfer workers. */
+	struct sockaddr_storage *remotes; /*!< Remote of the transfer in progress per worker. */
+	xfr_queue_t queue[];
+};
+
 #define TCP_SWEEP_INTERVAL 2 /*!< [secs] granularity of connection sweeping. */
+#define TCP_BATCH_QUERIES 16 /*!< Maximum number of pipelined queries processed at once. */
+#define TCP_BATCH_SIZE (4 * (KNOT_WIRE_MAX_PKTSIZE + sizeof(uint16_t))) /*!< Size of pending responses. */
 
 static void update_sweep_timer(struct timespec *timer)
 {
@@ -74,9 +149,239 @@ static void update_tcp_conf(tcp_context_t *tcp)
 		MAX(pconf->cache.srv_tcp_max_clients / pconf->cache.srv_tcp_threads, 1);
 	tcp->idle_timeout = pconf->cache.srv_tcp_idle_timeout;
 	tcp->io_timeout = pconf->cache.srv_tcp_io_timeout;
+	tcp->out.zc_enabled = pconf->cache.srv_tcp_zerocopy;
+	if (tcp->xfr_slot >= 0) {
+		/* The handed-over connections were already admitted. */
+		tcp->max_worker_fds = UINT_MAX;
+		tcp->xfr_remote_limit = pconf->cache.srv_xfr_remote_limit;
+		tcp->xfr_rate = pconf->cache.srv_xfr_rate_limit;
+	}
 	rcu_read_unlock();
 }
 
+static void tcp_conn_release(tcp_conn_t *conn, buf_pool_t *bufs)
+{
+	buf_pool_put(bufs, conn->msg, conn->msg_cap);
+	conn->msg = NULL;
+	conn->msg_cap = 0;
+}
+
+static void tcp_conn_free(tcp_conn_t *conn, buf_pool_t *bufs)
+{
+	if (conn == NULL) {
+		return;
+	}
+
+	tls_conn_free(conn->tls);
+	tcp_conn_release(conn, bufs);
+	free(conn->pending);
+	free(conn);
+}
+
+/*!
+ * \brief Makes room for the size of the incomplete message.
+ *
+ * The buffer starts small and is moved to a bigger size class as the message
+ * is being received, so the stalled clients don't hold maximal buffers.
+ */
+static int tcp_conn_reserve(tcp_conn_t *conn, buf_pool_t *bufs, size_t size)
+{
+	if (size <= conn->msg_cap) {
+		return KNOT_EOK;
+	}
+
+	size_t cap = buf_pool_size(size);
+	uint8_t *msg = buf_pool_get(bufs, cap);
+	if (msg == NULL) {
+		return KNOT_ENOMEM;
+	}
+	if (conn->msg_recv > 0) {
+		memcpy(msg, conn->msg, conn->msg_recv);
+	}
+	tcp_conn_release(conn, bufs);
+	conn->msg = msg;
+	conn->msg_cap = cap;
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Keeps the zone transfer query and the rest of the received data
+ *        to be processed by the zone transfer worker.
+ */
+static int tcp_conn_stash(tcp_conn_t *conn, buf_pool_t *bufs, struct iovec *query,
+                          const uint8_t *data, size_t len)
+{
+	size_t size = sizeof(conn->prefix) + query->iov_len + len;
+	uint8_t *pending = malloc(size);
+	if (pending == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_wire_write_u16(pending, query->iov_len);
+	memcpy(pending + sizeof(conn->prefix), query->iov_base, query->iov_len);
+	if (len > 0) {
+		memcpy(pending + sizeof(conn->prefix) + query->iov_len, data, len);
+	}
+
+	tcp_conn_release(conn, bufs);
+	conn->msg_recv = 0;
+	conn->prefix_recv = 0;
+	conn->pending = pending;
+	conn->pending_len = size;
+	conn->handoff = true;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Checks if the message is a zone transfer query. */
+static bool tcp_is_xfr(const uint8_t *wire, size_t len)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE || knot_wire_get_qr(wire) ||
+	    knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1) {
+		return false;
+	}
+
+	const uint8_t *qname = wire + KNOT_WIRE_HEADER_SIZE;
+	int qname_len = knot_dname_wire_check(qname, wire + len, NULL);
+	if (qname_len <= 0 ||
+	    KNOT_WIRE_HEADER_SIZE + qname_len + 2 * sizeof(uint16_t) > len) {
+		return false;
+	}
+
+	uint16_t qtype = knot_wire_read_u16(qname + qname_len);
+	return (qtype == KNOT_RRTYPE_AXFR || qtype == KNOT_RRTYPE_IXFR);
+}
+
+tcp_xfr_t *tcp_xfr_new(unsigned workers)
+{
+	tcp_xfr_t *xfr = calloc(1, sizeof(*xfr) + workers * sizeof(xfr->queue[0]));
+	if (xfr == NULL) {
+		return NULL;
+	}
+	pthread_mutex_init(&xfr->mx, NULL);
+
+	xfr->remotes = calloc(workers, sizeof(*xfr->remotes));
+	if (xfr->remotes == NULL) {
+		tcp_xfr_free(xfr);
+		return NULL;
+	}
+
+	for (unsigned i = 0; i < workers; i++) {
+		xfr_queue_t *q = &xfr->queue[i];
+		q->tail = &q->head;
+		if (pipe(q->wake) != 0) {
+			q->wake[0] = q->wake[1] = -1;
+			tcp_xfr_free(xfr);
+			return NULL;
+		}
+		xfr->workers++;
+		(void)fcntl(q->wake[0], F_SETFL, O_NONBLOCK);
+		(void)fcntl(q->wake[1], F_SETFL, O_NONBLOCK);
+	}
+
+	return xfr;
+}
+
+void tcp_xfr_free(tcp_xfr_t *xfr)
+{
+	if (xfr == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < xfr->workers; i++) {
+		xfr_queue_t *q = &xfr->queue[i];
+		while (q->head != NULL) {
+			tcp_handoff_t *h = q->head;
+			q->head = h->next;
+			tcp_conn_free(h->conn, NULL);
+			close(h->fd);
+			free(h);
+		}
+		close(q->wake[0]);
+		close(q->wake[1]);
+	}
+
+	pthread_mutex_destroy(&xfr->mx);
+	free(xfr->remotes);
+	free(xfr);
+}
+
+/*!
+ * \brief Hands the connection over to the least loaded zone transfer worker.
+ *
+ * The descriptor is duplicated as the original one is closed on the removal
+ * from the set of the TCP worker.
+ */
+static int tcp_xfr_handoff(tcp_xfr_t *xfr, int fd, tcp_conn_t *conn)
+{
+	tcp_handoff_t *h = malloc(sizeof(*h));
+	if (h == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	h->fd = dup(fd);
+	if (h->fd < 0) {
+		free(h);
+		return knot_map_errno();
+	}
+	h->next = NULL;
+	h->conn = conn;
+	conn->handoff = false;
+
+	xfr_queue_t *q = &xfr->queue[0];
+	for (unsigned i = 1; i < xfr->workers; i++) {
+		if (__atomic_load_n(&xfr->queue[i].clients, __ATOMIC_RELAXED) <
+		    __atomic_load_n(&q->clients, __ATOMIC_RELAXED)) {
+			q = &xfr->queue[i];
+		}
+	}
+	__atomic_add_fetch(&q->clients, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&xfr->mx);
+	*q->tail = h;
+	q->tail = &h->next;
+	pthread_mutex_unlock(&xfr->mx);
+
+	/* A full pipe means the worker is to be woken up anyway. */
+	uint8_t token = 0;
+	(void)write(q->wake[1], &token, sizeof(token));
+
+	return KNOT_EOK;
+}
+
+/*! \brief Registers the transfer unless the remote is over its limit. */
+static bool tcp_xfr_begin(tcp_xfr_t *xfr, unsigned slot, const struct sockaddr_storage *remote,
+                          unsigned limit)
+{
+	bool allowed = true;
+
+	pthread_mutex_lock(&xfr->mx);
+	if (limit > 0) {
+		unsigned active = 0;
+		for (unsigned i = 0; i < xfr->workers; i++) {
+			if (i != slot && xfr->remotes[i].ss_family != AF_UNSPEC &&
+			    sockaddr_cmp(&xfr->remotes[i], remote, true) == 0) {
+				active++;
+			}
+		}
+		allowed = (active < limit);
+	}
+	if (allowed) {
+		memcpy(&xfr->remotes[slot], remote, sizeof(*remote));
+	}
+	pthread_mutex_unlock(&xfr->mx);
+
+	return allowed;
+}
+
+static void tcp_xfr_end(tcp_xfr_t *xfr, unsigned slot)
+{
+	pthread_mutex_lock(&xfr->mx);
+	xfr->remotes[slot].ss_family = AF_UNSPEC;
+	pthread_mutex_unlock(&xfr->mx);
+}
+
 static void client_addr(const struct sockaddr_storage *ss, char *out, size_t out_len)
 {
 	if (ss->ss_family == AF_UNIX) {
@@ -87,9 +392,11 @@ static void client_addr(const struct sockaddr_storage *ss, char *out, size_t out
 }
 
 /*! \brief Sweep TCP connection. */
-static fdset_sweep_state_t tcp_sweep(fdset_t *set, int fd, _unused_ void *data)
+static fdset_sweep_state_t tcp_sweep(fdset_t *set, unsigned idx, void *data)
 {
-	assert(set && fd >= 0);
+	assert(set);
+
+	int fd = fdset_get_fd(set, idx);
 
 	/* Best-effort, name and shame. */
 	struct sockaddr_storage ss = { 0 };
@@ -100,6 +407,8 @@ static fdset_sweep_state_t tcp_sweep(fdset_t *set, int fd, _unused_ void *data)
 		log_notice("TCP, terminated inactive client, address %s", addr_str);
 	}
 
+	tcp_conn_free(fdset_get_ctx(set, idx), data);
+
 	return FDSET_SWEEP;
 }
 
@@ -124,14 +433,14 @@ static void tcp_log_error(struct sockaddr_storage *ss, const char *operation, in
 	}
 }
 
-static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
-                               fdset_t *fds, int thread_id)
+static unsigned tcp_set_ifaces(const server_t *server, fdset_t *fds, int thread_id)
 {
-	if (n_ifaces == 0) {
+	if (server->n_ifaces == 0) {
 		return 0;
 	}
 
-	for (const iface_t *i = ifaces; i != ifaces + n_ifaces; i++) {
+	const iface_t *ifaces = server->ifaces;
+	for (const iface_t *i = ifaces; i != ifaces + server->n_ifaces; i++) {
 		if (i->fd_tcp_count == 0) { // Ignore XDP interface.
 			assert(i->fd_xdp_count > 0);
 			continue;
@@ -141,13 +450,16 @@ static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
 #ifdef ENABLE_REUSEPORT
 		if (conf()->cache.srv_tcp_reuseport) {
 			/* Note: thread_ids start with UDP threads, TCP threads follow. */
-			assert((i->fd_udp_count <= thread_id) &&
-			       (thread_id < i->fd_tcp_count + i->fd_udp_count));
+			unsigned udp_threads = server->handlers[IO_UDP].handler.unit->size;
+			assert((udp_threads <= thread_id) &&
+			       (thread_id < i->fd_tcp_count + udp_threads));
 
-			tcp_id = thread_id - i->fd_udp_count;
+			tcp_id = thread_id - udp_threads;
 		}
 #endif
-		int ret = fdset_add(fds, i->fd_tcp[tcp_id], FDSET_POLLIN, NULL);
+		/* TLS listening sockets carry the server credentials. */
+		void *ctx = i->tls ? server->tls_creds : NULL;
+		int ret = fdset_add(fds, i->fd_tcp[tcp_id], FDSET_POLLIN, ctx);
 		if (ret < 0) {
 			return 0;
 		}
@@ -156,37 +468,243 @@ static unsigned tcp_set_ifaces(const iface_t *ifaces, size_t n_ifaces,
 	return fdset_get_length(fds);
 }
 
-static int tcp_handle(tcp_context_t *tcp, int fd, struct iovec *rx, struct iovec *tx)
+/*! \brief Sends the pending responses at once. */
+static int tcp_flush(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss)
 {
-	/* Get peer name. */
-	struct sockaddr_storage ss;
-	socklen_t addrlen = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &addrlen) != 0) {
-		return KNOT_EADDRNOTAVAIL;
+	if (tcp->batch_len == 0) {
+		return KNOT_EOK;
 	}
 
-	/* Create query processing parameter. */
-	knotd_qdata_params_t params = {
-		.remote = &ss,
-		.socket = fd,
-		.server = tcp->server,
-		.thread_id = tcp->thread_id
-	};
+	int sent = (tcp->tls != NULL) ?
+	           tls_conn_send(tcp->tls, tcp->batch, tcp->batch_len, tcp->io_timeout) :
+	           net_stream_send(fd, tcp->batch, tcp->batch_len, tcp->io_timeout);
+	size_t len = tcp->batch_len;
+	tcp->batch_len = 0;
+	if (sent != len) {
+		tcp_log_error(ss, "send", sent);
+		return KNOT_EOF;
+	}
+
+	return KNOT_EOK;
+}
 
-	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
+/*! \brief Timeout for the kernel to release the zero-copy buffers. */
+static int tcp_zc_timeout(tcp_context_t *tcp)
+{
+	// The transmission is complete once acknowledged by the client.
+	return (tcp->io_timeout < 0) ? -1 : MAX(tcp->io_timeout, tcp->idle_timeout * 1000);
+}
 
-	/* Receive data. */
-	int recv = net_dns_tcp_recv(fd, rx->iov_base, rx->iov_len, tcp->io_timeout);
-	if (recv > 0) {
-		rx->iov_len = recv;
+/*! \brief Writes the small responses and the large ones, in this order. */
+static int tcp_out_flush(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss)
+{
+	int ret = tcp_flush(tcp, fd, ss);
+	if (ret != KNOT_EOK || tcp->out.pending == 0) {
+		return ret;
+	}
+
+	struct iovec iov[TCP_OUT_BATCH];
+	size_t total = 0;
+	unsigned first = tcp->out.answers - tcp->out.pending;
+	for (unsigned i = 0; i < tcp->out.pending; i++) {
+		uint8_t *msg = tcp->out.buf[(first + i) % tcp->out.slots];
+		iov[i].iov_base = msg;
+		iov[i].iov_len = TCP_HEADROOM + knot_wire_read_u16(msg);
+		total += iov[i].iov_len;
+	}
+
+	int cnt = tcp->out.pending;
+	tcp->out.pending = 0;
+
+	ssize_t sent;
+	if (tcp->out.zerocopy) {
+		sent = net_zerocopy_sendv(fd, iov, cnt, tcp->io_timeout, &tcp->out.sends);
+		for (unsigned i = 0; i < cnt; i++) {
+			tcp->out.end[(first + i) % tcp->out.slots] = tcp->out.sends;
+		}
+		if (sent != total) {
+			tcp->out.failed = true;
+		}
 	} else {
-		tcp_log_error(&ss, "receive", recv);
+		sent = net_stream_sendv(fd, iov, cnt, tcp->io_timeout);
+	}
+	if (sent != total) {
+		tcp_log_error(ss, "send", sent);
+		return KNOT_EOF;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Prepares the connection for sending of large responses. */
+static void tcp_out_begin(tcp_context_t *tcp, int fd)
+{
+	tcp->out.zerocopy = tcp->out.zc_enabled && net_zerocopy_enable(fd) == KNOT_EOK;
+	/* Unless zero-copy, the buffers are free again once written. */
+	tcp->out.slots = tcp->out.zerocopy ? TCP_OUT_SLOTS : TCP_OUT_BATCH;
+#ifdef TCP_NOTSENT_LOWAT
+	/* Don't let the socket buffer grow much beyond one batch. */
+	int lowat = TCP_OUT_LOWAT;
+	(void)setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &lowat, sizeof(lowat));
+#endif
+}
+
+/*!
+ * \brief Queues the response to be written from its buffer without copying.
+ *
+ * The packet continues with a spare buffer. In the zero-copy mode, the buffer
+ * of a written response is reused only after the kernel releases it.
+ *
+ * \return KNOT_ENOTSUP if the response shall be copied to the batch.
+ */
+static int tcp_out_queue(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss,
+                         knot_pkt_t *ans)
+{
+	if (tcp->out.answers == 0) {
+		tcp_out_begin(tcp, fd);
+	}
+
+	unsigned slot = tcp->out.answers % tcp->out.slots;
+	if (tcp->out.zerocopy) {
+		int ret = net_zerocopy_wait(fd, &tcp->out.done, tcp->out.end[slot],
+		                            tcp_zc_timeout(tcp));
+		if (ret != KNOT_EOK) {
+			tcp_log_error(ss, "send", ret);
+			tcp->out.failed = true;
+			return KNOT_EOF;
+		}
+	}
+
+	uint8_t *spare = tcp->out.buf[slot];
+	if (spare == NULL) {
+		spare = malloc(TCP_HEADROOM + KNOT_WIRE_MAX_PKTSIZE);
+		if (spare == NULL) {
+			return KNOT_ENOTSUP;
+		}
+	}
+
+	uint8_t *msg = ans->wire - TCP_HEADROOM;
+	knot_wire_write_u16(msg, ans->size);
+	tcp->out.buf[slot] = msg;
+	tcp->out.answers++;
+	tcp->out.pending++;
+
+	/* Continue with the spare buffer, keep the header for the final probe. */
+	memcpy(spare + TCP_HEADROOM, ans->wire, KNOT_WIRE_HEADER_SIZE);
+	tcp->iov[1].iov_base = spare + TCP_HEADROOM;
+	ans->wire = tcp->iov[1].iov_base;
+	ans->compr.wire = ans->wire;
+
+	if (tcp->out.pending == TCP_OUT_BATCH) {
+		return tcp_out_flush(tcp, fd, ss);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Writes all the responses and waits for the release of the buffers. */
+static int tcp_out_finish(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss)
+{
+	int ret = tcp_out_flush(tcp, fd, ss);
+
+	if (!tcp->out.failed && tcp->out.done != tcp->out.sends) {
+		int waited = net_zerocopy_wait(fd, &tcp->out.done, tcp->out.sends,
+		                               tcp_zc_timeout(tcp));
+		if (waited != KNOT_EOK) {
+			tcp_log_error(ss, "send", waited);
+			tcp->out.failed = true;
+		}
+	}
+
+	if (tcp->out.failed) {
+		/* Drop the unsent data so that the kernel releases the buffers. */
+		struct linger lin = { .l_onoff = 1, .l_linger = 0 };
+		(void)setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin));
+		ret = KNOT_EOF;
+	}
+
+	memset(tcp->out.end, 0, sizeof(tcp->out.end));
+	tcp->out.answers = 0;
+	tcp->out.pending = 0;
+	tcp->out.sends = 0;
+	tcp->out.done = 0;
+	tcp->out.zerocopy = false;
+	tcp->out.failed = false;
+
+	return ret;
+}
+
+/*! \brief Appends the response to the pending ones. */
+static int tcp_enqueue(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss,
+                       knot_pkt_t *ans)
+{
+	/* Large responses (e.g. zone transfer messages) are written from their buffers. */
+	if (tcp->tls == NULL && ans->size >= TCP_OUT_MIN_SIZE) {
+		int ret = tcp_out_queue(tcp, fd, ss, ans);
+		if (ret != KNOT_ENOTSUP) {
+			return ret;
+		}
+	}
+
+	/* Keep the order with the large responses. */
+	if (tcp->out.pending > 0) {
+		int ret = tcp_out_flush(tcp, fd, ss);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (tcp->batch_len + sizeof(uint16_t) + ans->size > TCP_BATCH_SIZE) {
+		int ret = tcp_flush(tcp, fd, ss);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	knot_wire_write_u16(tcp->batch + tcp->batch_len, ans->size);
+	memcpy(tcp->batch + tcp->batch_len + sizeof(uint16_t), ans->wire, ans->size);
+	tcp->batch_len += sizeof(uint16_t) + ans->size;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Slows the paced zone transfer down to the configured rate. */
+static int tcp_pace(tcp_context_t *tcp, int fd, struct sockaddr_storage *ss, size_t size)
+{
+	tcp->pace.bytes += size;
+
+	struct timespec now = time_now();
+	double ahead_ms = tcp->pace.bytes * 1000.0 / tcp->xfr_rate -
+	                  time_diff_ms(&tcp->pace.start, &now);
+	if (ahead_ms <= 0) {
+		return KNOT_EOK;
+	}
+
+	/* Don't hold back the already produced messages. */
+	int ret = tcp_out_flush(tcp, fd, ss);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Don't delay the server shutdown. */
+	if (!(tcp->server->state & ServerRunning)) {
 		return KNOT_EOF;
 	}
 
+	struct timespec delay = {
+		.tv_sec = ahead_ms / 1000,
+		.tv_nsec = ((long)ahead_ms % 1000) * 1000000
+	};
+	(void)nanosleep(&delay, NULL);
+
+	return KNOT_EOK;
+}
+
+static int tcp_process(tcp_context_t *tcp, knotd_qdata_params_t *params,
+                       struct iovec *rx, struct iovec *tx)
+{
 	/* Initialize processing layer. */
-	knot_layer_begin(&tcp->layer, &params);
+	knot_layer_begin(&tcp->layer, params);
 
 	/* Create packets. */
 	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
@@ -197,26 +715,267 @@ static int tcp_handle(tcp_context_t *tcp, int fd, struct iovec *rx, struct iovec
 	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
 		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
 	}
+	KNOT_PROBE(query_recv, "tcp", knot_pkt_qname(query), knot_pkt_qtype(query),
+	           query->size);
 	knot_layer_consume(&tcp->layer, query);
 
 	/* Resolve until NOOP or finished. */
+	ret = KNOT_EOK;
 	while (tcp_active_state(tcp->layer.state)) {
 		knot_layer_produce(&tcp->layer, ans);
 		/* Send, if response generation passed and wasn't ignored. */
 		if (ans->size > 0 && tcp_send_state(tcp->layer.state)) {
-			int sent = net_dns_tcp_send(fd, ans->wire, ans->size,
-			                            tcp->io_timeout, NULL);
-			if (sent != ans->size) {
-				tcp_log_error(&ss, "send", sent);
-				ret = KNOT_EOF;
+			ret = tcp_enqueue(tcp, params->socket,
+			                  (struct sockaddr_storage *)params->remote, ans);
+			if (ret == KNOT_EOK && tcp->pace.active) {
+				ret = tcp_pace(tcp, params->socket,
+				               (struct sockaddr_storage *)params->remote,
+				               ans->size);
+			}
+			if (ret != KNOT_EOK) {
 				break;
 			}
 		}
 	}
+	KNOT_PROBE(query_send, "tcp", knot_pkt_qname(query),
+	           knot_wire_get_rcode(ans->wire), ans->size);
 
 	/* Reset after processing. */
 	knot_layer_finish(&tcp->layer);
 
+	return ret;
+}
+
+/*! \brief Answers the query with REFUSED. */
+static int tcp_refuse(tcp_context_t *tcp, knotd_qdata_params_t *params,
+                      struct iovec *rx, struct iovec *tx)
+{
+	knot_pkt_t *query = knot_pkt_new(rx->iov_base, rx->iov_len, tcp->layer.mm);
+	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, tcp->layer.mm);
+	if (query == NULL || ans == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = knot_pkt_parse_question(query);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_init_response(ans, query);
+	}
+	if (ret != KNOT_EOK) {
+		return KNOT_EOF;
+	}
+	knot_wire_set_rcode(ans->wire, KNOT_RCODE_REFUSED);
+
+	return tcp_enqueue(tcp, params->socket, (struct sockaddr_storage *)params->remote, ans);
+}
+
+/*!
+ * \brief Processes the zone transfer query in the zone transfer worker.
+ *
+ * The transfers over the limit per remote address are refused, the allowed
+ * ones are paced if configured.
+ */
+static int tcp_process_xfr(tcp_context_t *tcp, knotd_qdata_params_t *params,
+                           struct iovec *rx, struct iovec *tx)
+{
+	if (!tcp_xfr_begin(tcp->xfr, tcp->xfr_slot, params->remote, tcp->xfr_remote_limit)) {
+		char addr_str[SOCKADDR_STRLEN];
+		client_addr(params->remote, addr_str, sizeof(addr_str));
+		log_notice("TCP, refused zone transfer over the limit per remote, address %s",
+		           addr_str);
+		return tcp_refuse(tcp, params, rx, tx);
+	}
+
+	tcp->pace.active = (tcp->xfr_rate > 0);
+	tcp->pace.start = time_now();
+	tcp->pace.bytes = 0;
+
+	int ret = tcp_process(tcp, params, rx, tx);
+
+	tcp->pace.active = false;
+	tcp_xfr_end(tcp->xfr, tcp->xfr_slot);
+
+	return ret;
+}
+
+/*!
+ * \brief Processes the pipelined queries received over TLS.
+ *
+ * The decrypted TLS data are drained completely as they don't wake up
+ * the socket poll.
+ */
+static int tcp_serve_tls(tcp_context_t *tcp, tls_conn_t *tls, struct sockaddr_storage *ss,
+                         knotd_qdata_params_t *params, struct iovec *rx, struct iovec *tx,
+                         unsigned *queries)
+{
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; (i < TCP_BATCH_QUERIES || tls_conn_pending(tls)) &&
+	                     ret == KNOT_EOK; i++) {
+		if (i > 0 && !tls_conn_pending(tls)) {
+			break;
+		}
+
+		rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
+		tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
+
+		/* Receive data. */
+		int recv = tls_conn_recv_dns(tls, rx->iov_base, rx->iov_len, tcp->io_timeout);
+		if (recv > 0) {
+			rx->iov_len = recv;
+		} else {
+			tcp_log_error(ss, "receive", recv);
+			ret = KNOT_EOF;
+			break;
+		}
+
+		ret = tcp_process(tcp, params, rx, tx);
+		(*queries)++;
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Processes the queries completed by the data available in the socket.
+ *
+ * The socket is read only once, an incomplete query is kept in the connection
+ * state until the rest of it arrives, so a slow client doesn't block
+ * the others.
+ *
+ * The TCP worker stops at a zone transfer query and marks the connection
+ * to be handed over to a zone transfer worker, which continues with the input
+ * left over.
+ */
+static int tcp_serve_stream(tcp_context_t *tcp, int fd, tcp_conn_t *conn,
+                            knotd_qdata_params_t *params, struct iovec *rx,
+                            struct iovec *tx, unsigned *queries)
+{
+	uint8_t *pending = conn->pending;
+	uint8_t *data = rx->iov_base;
+	size_t len;
+	if (pending != NULL) {
+		data = pending;
+		len = conn->pending_len;
+		conn->pending = NULL;
+		conn->pending_len = 0;
+	} else {
+		ssize_t got = recv(fd, rx->iov_base, KNOT_WIRE_MAX_PKTSIZE, MSG_DONTWAIT);
+		if (got == 0) {
+			return KNOT_EOF;
+		} else if (got < 0) {
+			bool again = (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+			return again ? KNOT_EOK : KNOT_EOF;
+		}
+		len = got;
+	}
+
+	int ret = KNOT_EOK;
+	while (len > 0 && ret == KNOT_EOK) {
+		/* Length prefix, possibly split too. */
+		if (conn->prefix_recv < sizeof(conn->prefix)) {
+			conn->prefix[conn->prefix_recv++] = *data++;
+			len--;
+			if (conn->prefix_recv == sizeof(conn->prefix)) {
+				conn->msg_len = knot_wire_read_u16(conn->prefix);
+				if (conn->msg_len == 0) {
+					ret = KNOT_EOF;
+				}
+			}
+			continue;
+		}
+
+		struct iovec query;
+		if (conn->msg == NULL && len >= conn->msg_len) {
+			/* Complete query in the received data. */
+			query.iov_base = data;
+			query.iov_len = conn->msg_len;
+			data += conn->msg_len;
+			len -= conn->msg_len;
+		} else {
+			size_t part = MIN(len, conn->msg_len - conn->msg_recv);
+			if (tcp_conn_reserve(conn, &tcp->server->tcp_bufs,
+			                     conn->msg_recv + part) != KNOT_EOK) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			memcpy(conn->msg + conn->msg_recv, data, part);
+			conn->msg_recv += part;
+			data += part;
+			len -= part;
+			if (conn->msg_recv < conn->msg_len) {
+				break;
+			}
+			query.iov_base = conn->msg;
+			query.iov_len = conn->msg_len;
+		}
+
+		tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
+		if (tcp->xfr != NULL && tcp_is_xfr(query.iov_base, query.iov_len)) {
+			if (tcp->xfr_slot < 0) {
+				ret = tcp_conn_stash(conn, &tcp->server->tcp_bufs,
+				                     &query, data, len);
+				break;
+			}
+			ret = tcp_process_xfr(tcp, params, &query, tx);
+		} else {
+			ret = tcp_process(tcp, params, &query, tx);
+		}
+		(*queries)++;
+
+		tcp_conn_release(conn, &tcp->server->tcp_bufs);
+		conn->msg_recv = 0;
+		conn->prefix_recv = 0;
+	}
+
+	free(pending);
+
+	return ret;
+}
+
+static int tcp_handle(tcp_context_t *tcp, int fd, tcp_conn_t *conn,
+                      struct iovec *rx, struct iovec *tx, unsigned *queries)
+{
+	tls_conn_t *tls = conn->tls;
+
+	/* Get peer name. */
+	struct sockaddr_storage ss;
+	socklen_t addrlen = sizeof(struct sockaddr_storage);
+	if (getpeername(fd, (struct sockaddr *)&ss, &addrlen) != 0) {
+		return KNOT_EADDRNOTAVAIL;
+	}
+
+	/* Continue the TLS handshake, wait for the query if not buffered. */
+	if (tls != NULL) {
+		int ret = tls_conn_handshake(tls, tcp->io_timeout);
+		if (ret == KNOT_EAGAIN) {
+			return KNOT_EOK;
+		} else if (ret != KNOT_EOK) {
+			tcp_log_error(&ss, "handshake", ret);
+			return KNOT_EOF;
+		}
+	}
+	tcp->tls = tls;
+
+	/* Create query processing parameter. */
+	knotd_qdata_params_t params = {
+		.flags = (tls != NULL) ? KNOTD_QUERY_FLAG_TLS : 0,
+		.remote = &ss,
+		.socket = fd,
+		.server = tcp->server,
+		.thread_id = tcp->thread_id
+	};
+
+	/* Process the pipelined queries, the responses are sent together. */
+	int ret = (tls != NULL) ?
+	          tcp_serve_tls(tcp, tls, &ss, &params, rx, tx, queries) :
+	          tcp_serve_stream(tcp, fd, conn, &params, rx, tx, queries);
+
+	int flushed = (tcp->out.answers > 0) ? tcp_out_finish(tcp, fd, &ss) :
+	                                       tcp_flush(tcp, fd, &ss);
+	if (ret == KNOT_EOK) {
+		ret = flushed;
+	}
+	tcp->tls = NULL;
+
 	/* Flush per-query memory (including query and answer packets). */
 	mp_flush(tcp->layer.mm->ctx);
 
@@ -229,9 +988,24 @@ static void tcp_event_accept(tcp_context_t *tcp, unsigned i)
 	int fd = fdset_get_fd(&tcp->set, i);
 	int client = net_accept(fd, NULL);
 	if (client >= 0) {
+		tcp_conn_t *conn = calloc(1, sizeof(*conn));
+		if (conn == NULL) {
+			close(client);
+			return;
+		}
+
+		/* Start a TLS session if accepted on a TLS interface. */
+		tls_creds_t *creds = fdset_get_ctx(&tcp->set, i);
+		if (creds != NULL && (conn->tls = tls_conn_new(creds, client)) == NULL) {
+			free(conn);
+			close(client);
+			return;
+		}
+
 		/* Assign to fdset. */
-		int idx = fdset_add(&tcp->set, client, FDSET_POLLIN, NULL);
+		int idx = fdset_add(&tcp->set, client, FDSET_POLLIN, conn);
 		if (idx < 0) {
+			tcp_conn_free(conn, NULL);
 			close(client);
 			return;
 		}
@@ -243,10 +1017,11 @@ static void tcp_event_accept(tcp_context_t *tcp, unsigned i)
 
 static int tcp_event_serve(tcp_context_t *tcp, unsigned i)
 {
-	int ret = tcp_handle(tcp, fdset_get_fd(&tcp->set, i),
-	                     &tcp->iov[0], &tcp->iov[1]);
-	if (ret == KNOT_EOK) {
-		/* Update socket activity timer. */
+	unsigned queries = 0;
+	int ret = tcp_handle(tcp, fdset_get_fd(&tcp->set, i), fdset_get_ctx(&tcp->set, i),
+	                     &tcp->iov[0], &tcp->iov[1], &queries);
+	if (ret == KNOT_EOK && queries > 0) {
+		/* Update socket activity timer, trickling data don't count. */
 		(void)fdset_set_watchdog(&tcp->set, i, tcp->idle_timeout);
 	}
 
@@ -261,8 +1036,10 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 	assert(fdset_get_length(set) <= tcp->max_worker_fds);
 	tcp->is_throttled = fdset_get_length(set) == tcp->max_worker_fds;
 
-	/* If throttled, temporarily ignore new TCP connections. */
-	unsigned offset = tcp->is_throttled ? tcp->client_threshold : 0;
+	/* If throttled, temporarily ignore new TCP connections. If draining,
+	   leave them to the successor (the wake-up pipe is still needed). */
+	bool draining = (tcp->server->state & ServerDraining) && tcp->xfr_slot < 0;
+	unsigned offset = (tcp->is_throttled || draining) ? tcp->client_threshold : 0;
 
 	/* Wait for events. */
 	fdset_it_t it;
@@ -274,46 +1051,86 @@ static void tcp_wait_for_events(tcp_context_t *tcp)
 	/* Process events. */
 	for (; !fdset_it_is_done(&it); fdset_it_next(&it)) {
 		bool should_close = false;
+		bool handed_over = false;
 		unsigned int idx = fdset_it_get_idx(&it);
 		if (fdset_it_is_error(&it)) {
 			should_close = (idx >= tcp->client_threshold);
 		} else if (fdset_it_is_pollin(&it)) {
 			/* Master sockets - new connection to accept. */
 			if (idx < tcp->client_threshold) {
+				if (tcp->xfr_slot >= 0) {
+					/* Wake-up pipe, the connections are taken over later. */
+					uint8_t tokens[64];
+					while (read(fdset_get_fd(set, idx), tokens, sizeof(tokens)) > 0);
 				/* Don't accept more clients than configured. */
-				if (fdset_get_length(set) < tcp->max_worker_fds) {
+				} else if (fdset_get_length(set) < tcp->max_worker_fds) {
 					tcp_event_accept(tcp, idx);
 				}
 			/* Client sockets - already accepted connection or
 			   closed connection :-( */
 			} else if (tcp_event_serve(tcp, idx) != KNOT_EOK) {
 				should_close = true;
+			} else if (((tcp_conn_t *)fdset_get_ctx(set, idx))->handoff) {
+				handed_over = (tcp_xfr_handoff(tcp->xfr, fdset_get_fd(set, idx),
+				                               fdset_get_ctx(set, idx)) == KNOT_EOK);
+				should_close = !handed_over;
 			}
 		}
 
 		/* Evaluate. */
-		if (should_close) {
+		if (handed_over) {
+			fdset_it_remove(&it);
+		} else if (should_close) {
+			tcp_conn_free(fdset_get_ctx(set, idx), &tcp->server->tcp_bufs);
 			fdset_it_remove(&it);
 		}
 	}
 	fdset_it_commit(&it);
 }
 
-int tcp_master(dthread_t *thread)
+/*!
+ * \brief Adds the connections handed over to the zone transfer worker
+ *        and processes their pending input.
+ */
+static void tcp_xfr_takeover(tcp_context_t *tcp)
 {
-	if (thread == NULL || thread->data == NULL) {
-		return KNOT_EINVAL;
+	xfr_queue_t *q = &tcp->xfr->queue[tcp->xfr_slot];
+
+	pthread_mutex_lock(&tcp->xfr->mx);
+	tcp_handoff_t *h = q->head;
+	q->head = NULL;
+	q->tail = &q->head;
+	pthread_mutex_unlock(&tcp->xfr->mx);
+
+	while (h != NULL) {
+		tcp_handoff_t *next = h->next;
+		int idx = fdset_add(&tcp->set, h->fd, FDSET_POLLIN, h->conn);
+		if (idx < 0) {
+			tcp_conn_free(h->conn, &tcp->server->tcp_bufs);
+			close(h->fd);
+		} else if (tcp_event_serve(tcp, idx) != KNOT_EOK) {
+			tcp_conn_free(h->conn, &tcp->server->tcp_bufs);
+			(void)fdset_remove(&tcp->set, idx);
+		} else {
+			(void)fdset_set_watchdog(&tcp->set, idx, tcp->idle_timeout);
+		}
+		free(h);
+		h = next;
 	}
+}
 
+static int tcp_worker(dthread_t *thread, int xfr_slot)
+{
 	iohandler_t *handler = (iohandler_t *)thread->data;
 	int thread_id = handler->thread_id[dt_get_id(thread)];
 
 #ifdef ENABLE_REUSEPORT
 	/* Set thread affinity to CPU core (overlaps with UDP/XDP). */
-	if (conf()->cache.srv_tcp_reuseport) {
+	if (xfr_slot < 0 && conf()->cache.srv_tcp_reuseport) {
 		unsigned cpu = dt_online_cpus();
 		if (cpu > 1) {
-			unsigned cpu_mask = (dt_get_id(thread) % cpu);
+			unsigned cpu_mask = placement_cpu(handler->server->placement,
+			                                  dt_get_id(thread));
 			dt_setaffinity(thread, &cpu_mask, 1);
 		}
 	}
@@ -324,23 +1141,34 @@ int tcp_master(dthread_t *thread)
 	/* Create big enough memory cushion. */
 	knot_mm_t mm;
 	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	size_t pool_size = 0;
 
 	/* Create TCP answering context. */
 	tcp_context_t tcp = {
 		.server = handler->server,
 		.is_throttled = false,
 		.thread_id = thread_id,
+		.xfr = handler->server->xfr,
+		.xfr_slot = xfr_slot,
 	};
 	knot_layer_init(&tcp.layer, &mm, process_query_layer());
 
-	/* Create iovec abstraction. */
+	/* Create iovec abstraction, the TX buffer with space for the length prefix. */
 	for (unsigned i = 0; i < 2; ++i) {
-		tcp.iov[i].iov_len = KNOT_WIRE_MAX_PKTSIZE;
-		tcp.iov[i].iov_base = malloc(tcp.iov[i].iov_len);
-		if (tcp.iov[i].iov_base == NULL) {
+		size_t headroom = (i == 1) ? TCP_HEADROOM : 0;
+		uint8_t *buf = malloc(headroom + KNOT_WIRE_MAX_PKTSIZE);
+		if (buf == NULL) {
 			ret = KNOT_ENOMEM;
 			goto finish;
 		}
+		tcp.iov[i].iov_len = KNOT_WIRE_MAX_PKTSIZE;
+		tcp.iov[i].iov_base = buf + headroom;
+	}
+
+	tcp.batch = malloc(TCP_BATCH_SIZE);
+	if (tcp.batch == NULL) {
+		ret = KNOT_ENOMEM;
+		goto finish;
 	}
 
 	/* Initialize sweep interval and TCP configuration. */
@@ -353,36 +1181,112 @@ int tcp_master(dthread_t *thread)
 		goto finish;
 	}
 
-	/* Set descriptors for the configured interfaces. */
-	tcp.client_threshold = tcp_set_ifaces(handler->server->ifaces,
-	                                      handler->server->n_ifaces,
-	                                      &tcp.set, thread_id);
-	if (tcp.client_threshold == 0) {
-		goto finish; /* Terminate on zero interfaces. */
+	if (xfr_slot >= 0) {
+		/* The wake-up pipe instead of the listening sockets. */
+		int wake = tcp.xfr->queue[xfr_slot].wake[0];
+		if (fdset_add(&tcp.set, wake, FDSET_POLLIN, NULL) < 0) {
+			goto finish;
+		}
+		tcp.client_threshold = 1;
+	} else {
+		/* Set descriptors for the configured interfaces. */
+		tcp.client_threshold = tcp_set_ifaces(handler->server, &tcp.set, thread_id);
+		if (tcp.client_threshold == 0) {
+			goto finish; /* Terminate on zero interfaces. */
+		}
 	}
 
+	unsigned *running = &handler->server->tcp_running[xfr_slot >= 0];
+	__atomic_add_fetch(running, 1, __ATOMIC_RELEASE);
+
 	for (;;) {
 		/* Check for cancellation. */
 		if (dt_is_cancelled(thread)) {
 			break;
 		}
 
+		/* The transfers are handed over until the last TCP worker finishes. */
+		bool draining = handler->server->state & ServerDraining;
+		bool drained = draining && (xfr_slot < 0 ||
+		               __atomic_load_n(&handler->server->tcp_running[0], __ATOMIC_ACQUIRE) == 0);
+
+		/* Account the memory pool of the thread. */
+		memstat_pool_update(MEMSTAT_THREAD_POOLS, &pool_size, mp_total_size(mm.ctx));
+
+		/* Continue with the connections handed over by the TCP workers. */
+		if (xfr_slot >= 0) {
+			tcp_xfr_takeover(&tcp);
+		}
+
 		/* Serve client requests. */
 		tcp_wait_for_events(&tcp);
 
+		unsigned clients = fdset_get_length(&tcp.set) - tcp.client_threshold;
+		if (xfr_slot >= 0) {
+			/* Publish the number of clients for the hand-overs. */
+			__atomic_store_n(&tcp.xfr->queue[xfr_slot].clients, clients,
+			                 __ATOMIC_RELAXED);
+		} else {
+			/* Publish the number of clients for the connection steering. */
+			steering_load(handler->server->steering[IO_TCP], dt_get_id(thread),
+			              clients);
+		}
+
+		/* Finish when drained, the new connections are left to the successor. */
+		if (drained && clients == 0) {
+			break;
+		}
+
 		/* Sweep inactive clients and refresh TCP configuration. */
 		if (tcp.last_poll_time.tv_sec >= next_sweep.tv_sec) {
-			fdset_sweep(&tcp.set, &tcp_sweep, NULL);
+			fdset_sweep(&tcp.set, &tcp_sweep, &tcp.server->tcp_bufs);
 			update_sweep_timer(&next_sweep);
 			update_tcp_conf(&tcp);
 		}
 	}
 
+	__atomic_sub_fetch(running, 1, __ATOMIC_RELEASE);
+
 finish:
+	/* Free the states of the remaining clients. */
+	for (unsigned i = tcp.client_threshold; tcp.client_threshold > 0 &&
+	                                        i < fdset_get_length(&tcp.set); i++) {
+		tcp_conn_free(fdset_get_ctx(&tcp.set, i), &tcp.server->tcp_bufs);
+	}
 	free(tcp.iov[0].iov_base);
-	free(tcp.iov[1].iov_base);
+	if (tcp.iov[1].iov_base != NULL) {
+		free((uint8_t *)tcp.iov[1].iov_base - TCP_HEADROOM);
+	}
+	for (unsigned i = 0; i < TCP_OUT_SLOTS; i++) {
+		free(tcp.out.buf[i]);
+	}
+	free(tcp.batch);
+	memstat_pool_update(MEMSTAT_THREAD_POOLS, &pool_size, 0);
 	mp_delete(mm.ctx);
 	fdset_clear(&tcp.set);
 
 	return ret;
 }
+
+int tcp_master(dthread_t *thread)
+{
+	if (thread == NULL || thread->data == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return tcp_worker(thread, -1);
+}
+
+int xfr_master(dthread_t *thread)
+{
+	if (thread == NULL || thread->data == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	iohandler_t *handler = (iohandler_t *)thread->data;
+	if (handler->server->xfr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return tcp_worker(thread, dt_get_id(thread));
+}
@@ -28,6 +28,23 @@
 
 #define TCP_BACKLOG_SIZE  10 /*!< TCP listen backlog size. */
 
+/*! \brief Connections handed over to the zone transfer workers. */
+typedef struct tcp_xfr tcp_xfr_t;
+
+/*!
+ * \brief Creates the hand-over queues of the zone transfer workers.
+ *
+ * \param workers  Number of the zone transfer workers.
+ *
+ * \return Queues or NULL on error.
+ */
+tcp_xfr_t *tcp_xfr_new(unsigned workers);
+
+/*!
+ * \brief Closes the connections left in the queues and frees them.
+ */
+void tcp_xfr_free(tcp_xfr_t *xfr);
+
 /*!
  * \brief TCP handler thread runnable.
  *
@@ -41,3 +58,18 @@
  * \retval KNOT_EINVAL invalid parameters.
  */
 int tcp_master(dthread_t *thread);
+
+/*!
+ * \brief Zone transfer handler thread runnable.
+ *
+ * Serves the connections the TCP handler threads hand over upon an AXFR
+ * or IXFR query, so that the outgoing transfers don't delay the other TCP
+ * clients. The concurrent transfers per remote address are limited and
+ * the transfers are paced if configured.
+ *
+ * \param thread Associated thread from DThreads unit.
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_EINVAL invalid parameters.
+ */
+int xfr_master(dthread_t *thread);
@@ -0,0 +1,268 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <gnutls/gnutls.h>
+#define GNUTLS_VERSION_KTLS_READY 0x030703
+#if GNUTLS_VERSION_NUMBER >= GNUTLS_VERSION_KTLS_READY
+#include <gnutls/socket.h>
+#endif
+
+#include "knot/server/tls.h"
+#include "knot/common/log.h"
+#include "contrib/string.h"
+#include "libknot/errcode.h"
+#include "libknot/wire.h"
+
+static const gnutls_datum_t dot_alpn = {
+	(unsigned char *)"dot", 3
+};
+
+struct tls_creds {
+	gnutls_certificate_credentials_t cert;
+	gnutls_datum_t ticket_key;
+};
+
+struct tls_conn {
+	gnutls_session_t session;
+	int fd;
+	bool established;
+};
+
+int tls_creds_init(const char *cert_file, const char *key_file, tls_creds_t **creds)
+{
+	if (cert_file == NULL || key_file == NULL || creds == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	tls_creds_t *new = calloc(1, sizeof(*new));
+	if (new == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = gnutls_certificate_allocate_credentials(&new->cert);
+	if (ret != GNUTLS_E_SUCCESS) {
+		free(new);
+		return KNOT_ENOMEM;
+	}
+
+	ret = gnutls_certificate_set_x509_key_file(new->cert, cert_file, key_file,
+	                                           GNUTLS_X509_FMT_PEM);
+	if (ret != GNUTLS_E_SUCCESS) {
+		log_error("TLS, failed to load certificate '%s' and key '%s' (%s)",
+		          cert_file, key_file, gnutls_strerror(ret));
+		tls_creds_free(new);
+		return KNOT_EFILE;
+	}
+
+	// The ticket key is valid until the credentials are reloaded.
+	ret = gnutls_session_ticket_key_generate(&new->ticket_key);
+	if (ret != GNUTLS_E_SUCCESS) {
+		tls_creds_free(new);
+		return KNOT_ENOMEM;
+	}
+
+	*creds = new;
+
+	return KNOT_EOK;
+}
+
+void tls_creds_free(tls_creds_t *creds)
+{
+	if (creds == NULL) {
+		return;
+	}
+
+	if (creds->ticket_key.data != NULL) {
+		memzero(creds->ticket_key.data, creds->ticket_key.size);
+		gnutls_free(creds->ticket_key.data);
+	}
+	gnutls_certificate_free_credentials(creds->cert);
+	free(creds);
+}
+
+tls_conn_t *tls_conn_new(tls_creds_t *creds, int fd)
+{
+	if (creds == NULL || fd < 0) {
+		return NULL;
+	}
+
+	tls_conn_t *conn = calloc(1, sizeof(*conn));
+	if (conn == NULL) {
+		return NULL;
+	}
+	conn->fd = fd;
+
+	if (gnutls_init(&conn->session, GNUTLS_SERVER | GNUTLS_NONBLOCK) != GNUTLS_E_SUCCESS) {
+		free(conn);
+		return NULL;
+	}
+
+	if (gnutls_set_default_priority(conn->session) != GNUTLS_E_SUCCESS ||
+	    gnutls_credentials_set(conn->session, GNUTLS_CRD_CERTIFICATE,
+	                           creds->cert) != GNUTLS_E_SUCCESS ||
+	    gnutls_session_ticket_enable_server(conn->session,
+	                                        &creds->ticket_key) != GNUTLS_E_SUCCESS ||
+	    gnutls_alpn_set_protocols(conn->session, &dot_alpn, 1, 0) != GNUTLS_E_SUCCESS) {
+		tls_conn_free(conn);
+		return NULL;
+	}
+
+	gnutls_certificate_server_set_request(conn->session, GNUTLS_CERT_IGNORE);
+	gnutls_transport_set_int(conn->session, fd);
+
+	return conn;
+}
+
+/*! \brief Waits for the socket to be ready in the direction required by GnuTLS. */
+static int tls_wait(tls_conn_t *conn, int timeout_ms)
+{
+	struct pollfd pfd = {
+		.fd = conn->fd,
+		.events = gnutls_record_get_direction(conn->session) ? POLLOUT : POLLIN,
+	};
+
+	int ret = poll(&pfd, 1, timeout_ms);
+	if (ret == 0) {
+		return KNOT_ETIMEOUT;
+	} else if (ret < 0) {
+		return knot_map_errno();
+	}
+
+	return KNOT_EOK;
+}
+
+int tls_conn_handshake(tls_conn_t *conn, int timeout_ms)
+{
+	if (conn == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (conn->established) {
+		return KNOT_EOK;
+	}
+
+	int ret;
+	while ((ret = gnutls_handshake(conn->session)) != GNUTLS_E_SUCCESS) {
+		if (gnutls_error_is_fatal(ret) != 0) {
+			return KNOT_ECONN;
+		}
+		// Don't wait for the client, the worker is woken up by the socket.
+		if (gnutls_record_get_direction(conn->session) == 0) {
+			return KNOT_EAGAIN;
+		}
+		ret = tls_wait(conn, timeout_ms);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	conn->established = true;
+
+#if GNUTLS_VERSION_NUMBER >= GNUTLS_VERSION_KTLS_READY
+	if (gnutls_transport_is_ktls_enabled(conn->session) == GNUTLS_KTLS_DUPLEX) {
+		log_debug("TLS, kernel TLS offload enabled, fd %i", conn->fd);
+	}
+#endif
+
+	return KNOT_EOK;
+}
+
+bool tls_conn_pending(tls_conn_t *conn)
+{
+	return conn != NULL && gnutls_record_check_pending(conn->session) > 0;
+}
+
+static ssize_t tls_recv_all(tls_conn_t *conn, uint8_t *buf, size_t len, int timeout_ms)
+{
+	size_t total = 0;
+	while (total < len) {
+		ssize_t ret = gnutls_record_recv(conn->session, buf + total, len - total);
+		if (ret > 0) {
+			total += ret;
+		} else if (ret == 0) {
+			return 0;
+		} else if (gnutls_error_is_fatal(ret) != 0) {
+			return KNOT_ECONN;
+		} else if (ret == GNUTLS_E_AGAIN) {
+			int wait = tls_wait(conn, timeout_ms);
+			if (wait != KNOT_EOK) {
+				return wait;
+			}
+		}
+	}
+
+	return total;
+}
+
+ssize_t tls_conn_recv_dns(tls_conn_t *conn, uint8_t *buf, size_t size, int timeout_ms)
+{
+	if (conn == NULL || buf == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint8_t prefix[sizeof(uint16_t)];
+	ssize_t ret = tls_recv_all(conn, prefix, sizeof(prefix), timeout_ms);
+	if (ret <= 0) {
+		return ret;
+	}
+
+	size_t len = knot_wire_read_u16(prefix);
+	if (len > size) {
+		return KNOT_ESPACE;
+	}
+
+	return tls_recv_all(conn, buf, len, timeout_ms);
+}
+
+ssize_t tls_conn_send(tls_conn_t *conn, const uint8_t *buf, size_t len, int timeout_ms)
+{
+	if (conn == NULL || buf == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	size_t total = 0;
+	while (total < len) {
+		// Each call produces at most one maximum-sized record.
+		ssize_t ret = gnutls_record_send(conn->session, buf + total, len - total);
+		if (ret > 0) {
+			total += ret;
+		} else if (ret == GNUTLS_E_AGAIN || ret == GNUTLS_E_INTERRUPTED) {
+			int wait = tls_wait(conn, timeout_ms);
+			if (wait != KNOT_EOK) {
+				return wait;
+			}
+		} else {
+			return KNOT_ECONN;
+		}
+	}
+
+	return total;
+}
+
+void tls_conn_free(tls_conn_t *conn)
+{
+	if (conn == NULL) {
+		return;
+	}
+
+	if (conn->established) {
+		(void)gnutls_bye(conn->session, GNUTLS_SHUT_WR);
+	}
+	gnutls_deinit(conn->session);
+	free(conn);
+}
@@ -0,0 +1,96 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Server side of DNS over TLS (RFC 7858).
+ *
+ * The connections are served by the TCP workers. The TLS handshake is
+ * driven by the socket events so that a slow client doesn't block the
+ * worker. Session resumption is supported via session tickets. If the
+ * GnuTLS library is configured to use kernel TLS, the record encryption
+ * is offloaded to the kernel.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct tls_creds tls_creds_t;
+typedef struct tls_conn tls_conn_t;
+
+/*!
+ * \brief Load the server certificate and create the credentials.
+ *
+ * \param cert_file  Certificate file in the PEM format.
+ * \param key_file   Private key file in the PEM format.
+ * \param creds      Out: created credentials.
+ *
+ * \return KNOT_E*
+ */
+int tls_creds_init(const char *cert_file, const char *key_file, tls_creds_t **creds);
+
+/*!
+ * \brief Free the credentials.
+ *
+ * \note There mustn't be any connection using them.
+ */
+void tls_creds_free(tls_creds_t *creds);
+
+/*!
+ * \brief Create a TLS session for an accepted non-blocking connection.
+ *
+ * \param creds  Server credentials.
+ * \param fd     Connected socket.
+ *
+ * \return Connection or NULL if error.
+ */
+tls_conn_t *tls_conn_new(tls_creds_t *creds, int fd);
+
+/*!
+ * \brief Continue the TLS handshake with the data available on the socket.
+ *
+ * \retval KNOT_EOK     Handshake finished (also if already established).
+ * \retval KNOT_EAGAIN  More data from the client is needed.
+ * \retval KNOT_E*      Handshake failed.
+ */
+int tls_conn_handshake(tls_conn_t *conn, int timeout_ms);
+
+/*!
+ * \brief Check if some decrypted data are available without reading the socket.
+ */
+bool tls_conn_pending(tls_conn_t *conn);
+
+/*!
+ * \brief Receive one DNS message with the two-byte length prefix.
+ *
+ * \return Message size, 0 if closed by the peer, or KNOT_E*.
+ */
+ssize_t tls_conn_recv_dns(tls_conn_t *conn, uint8_t *buf, size_t size, int timeout_ms);
+
+/*!
+ * \brief Send the data (possibly several prefixed DNS messages) at once.
+ *
+ * \return Number of bytes sent or KNOT_E*.
+ */
+ssize_t tls_conn_send(tls_conn_t *conn, const uint8_t *buf, size_t len, int timeout_ms);
+
+/*!
+ * \brief Free the TLS session, the socket is kept open.
+ */
+void tls_conn_free(tls_conn_t *conn);
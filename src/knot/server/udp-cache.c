@@ -0,0 +1,268 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/macros.h"
+#include "contrib/openbsd/siphash.h"
+#include "knot/conf/conf.h"
+#include "knot/server/udp-cache.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+
+typedef struct {
+	uint64_t generation;
+	uint32_t hash;
+	uint16_t qtype;
+	uint16_t max_size;
+	uint8_t flags;
+	uint8_t qname_size;
+	uint16_t wire_size; // Zero if the entry is empty.
+	bool promoted;      // Already handed over by udp_cache_promote().
+	knot_dname_storage_t qname;
+	uint8_t wire[UDP_CACHE_MAX_WIRE];
+} udp_cache_entry_t;
+
+struct udp_cache {
+	SIPHASH_KEY key;
+	size_t mask;
+	udp_cache_entry_t *entries;
+};
+
+udp_cache_t *udp_cache_new(size_t size)
+{
+	if (size == 0) {
+		return NULL;
+	}
+
+	size_t count = 1;
+	while (count < size) {
+		count <<= 1;
+	}
+
+	udp_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->entries = calloc(count, sizeof(udp_cache_entry_t));
+	if (cache->entries == NULL ||
+	    dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		free(cache->entries);
+		free(cache);
+		return NULL;
+	}
+	cache->mask = count - 1;
+
+	return cache;
+}
+
+void udp_cache_free(udp_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	free(cache->entries);
+	free(cache);
+}
+
+static bool parse_opt(const uint8_t *pos, const uint8_t *end, uint16_t *payload,
+                      bool *do_bit)
+{
+	/* Only an empty OPT record ending the packet is accepted. */
+	if (end - pos != KNOT_EDNS_MIN_SIZE || pos[0] != '\0' ||
+	    knot_wire_read_u16(pos + 1) != KNOT_RRTYPE_OPT ||
+	    knot_wire_read_u16(pos + 9) != 0) {
+		return false;
+	}
+
+	uint32_t ttl = knot_wire_read_u32(pos + 5);
+	if ((ttl >> 24) != 0 || ((ttl >> 16) & 0xff) != KNOT_EDNS_VERSION) {
+		return false;
+	}
+
+	*payload = knot_wire_read_u16(pos + 3);
+	*do_bit = (ttl & KNOT_EDNS_DO_MASK);
+
+	return true;
+}
+
+bool udp_cache_key(udp_cache_t *cache, udp_cache_key_t *key,
+                   const uint8_t *wire, size_t len,
+                   const struct sockaddr_storage *remote)
+{
+	assert(key && wire && remote);
+
+	if (cache == NULL || len < KNOT_WIRE_HEADER_SIZE + KNOT_WIRE_QUESTION_MIN_SIZE) {
+		return false;
+	}
+
+	/* Answers modified by query modules or rotated can't be cached. */
+	conf_t *pconf = conf();
+	if (pconf->query_plan != NULL || pconf->cache.srv_ans_rotate) {
+		return false;
+	}
+
+	/* Plain query with a single question and an optional OPT record. */
+	uint16_t arcount = knot_wire_get_arcount(wire);
+	if (knot_wire_get_qr(wire) || knot_wire_get_tc(wire) ||
+	    knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1 || knot_wire_get_ancount(wire) != 0 ||
+	    knot_wire_get_nscount(wire) != 0 || arcount > 1) {
+		return false;
+	}
+
+	const uint8_t *pos = wire + KNOT_WIRE_HEADER_SIZE;
+	const uint8_t *end = wire + len;
+	int qname_size = knot_dname_wire_check(pos, end, NULL);
+	if (qname_size <= 0 || (size_t)(end - pos) < qname_size + 2 * sizeof(uint16_t)) {
+		return false;
+	}
+
+	uint16_t qtype = knot_wire_read_u16(pos + qname_size);
+	uint16_t qclass = knot_wire_read_u16(pos + qname_size + sizeof(uint16_t));
+	if (qclass != KNOT_CLASS_IN || knot_rrtype_is_metatype(qtype)) {
+		return false;
+	}
+	const uint8_t *opt = pos + qname_size + 2 * sizeof(uint16_t);
+
+	uint16_t server_size;
+	switch (remote->ss_family) {
+	case AF_INET:
+		server_size = pconf->cache.srv_udp_max_payload_ipv4;
+		key->flags = 0;
+		break;
+	case AF_INET6:
+		server_size = pconf->cache.srv_udp_max_payload_ipv6;
+		key->flags = UDP_CACHE_KEY_IPV6;
+		break;
+	default:
+		return false;
+	}
+
+	/* The maximal answer size is determined the same way as in prepare_answer(). */
+	key->max_size = KNOT_WIRE_MIN_PKTSIZE;
+	if (arcount == 1) {
+		uint16_t client_size;
+		bool do_bit;
+		if (!parse_opt(opt, end, &client_size, &do_bit)) {
+			return false;
+		}
+		key->flags |= UDP_CACHE_KEY_EDNS | (do_bit ? UDP_CACHE_KEY_DO : 0);
+		key->max_size = MAX(key->max_size, MIN(client_size, server_size));
+	} else if (opt != end) {
+		return false;
+	}
+
+	key->qtype = qtype;
+	key->qname_size = qname_size;
+	knot_dname_copy_lower(key->qname, pos);
+
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &cache->key);
+	SipHash24_Update(&ctx, key->qname, key->qname_size);
+	SipHash24_Update(&ctx, &key->qtype, sizeof(key->qtype));
+	SipHash24_Update(&ctx, &key->max_size, sizeof(key->max_size));
+	SipHash24_Update(&ctx, &key->flags, sizeof(key->flags));
+	key->hash = SipHash24_End(&ctx);
+
+	/* Read before processing so that a concurrent change invalidates the answer. */
+	key->generation = zone_answers_generation();
+
+	return true;
+}
+
+static bool entry_match(const udp_cache_entry_t *entry, const udp_cache_key_t *key)
+{
+	return entry->wire_size > 0 &&
+	       entry->generation == key->generation &&
+	       entry->hash == key->hash &&
+	       entry->qtype == key->qtype &&
+	       entry->max_size == key->max_size &&
+	       entry->flags == key->flags &&
+	       entry->qname_size == key->qname_size &&
+	       memcmp(entry->qname, key->qname, key->qname_size) == 0;
+}
+
+size_t udp_cache_answer(udp_cache_t *cache, const udp_cache_key_t *key,
+                        const uint8_t *query, uint8_t *out, size_t out_max)
+{
+	assert(cache && key && query && out);
+
+	const udp_cache_entry_t *entry = &cache->entries[key->hash & cache->mask];
+	if (!entry_match(entry, key) || entry->wire_size > out_max) {
+		return 0;
+	}
+
+	memcpy(out, entry->wire, entry->wire_size);
+
+	/* Patch the fields copied from the query. */
+	knot_wire_set_id(out, knot_wire_get_id(query));
+	if (knot_wire_get_rd(query)) {
+		knot_wire_set_rd(out);
+	} else {
+		knot_wire_clear_rd(out);
+	}
+	memcpy(out + KNOT_WIRE_HEADER_SIZE, query + KNOT_WIRE_HEADER_SIZE,
+	       key->qname_size);
+
+	return entry->wire_size;
+}
+
+void udp_cache_store(udp_cache_t *cache, const udp_cache_key_t *key,
+                     const knot_pkt_t *ans, const zone_t *zone)
+{
+	assert(cache && key && ans);
+
+	/* Only complete authoritative answers from zones without modules. */
+	if (zone == NULL || zone->query_plan != NULL || ans->size > UDP_CACHE_MAX_WIRE ||
+	    knot_wire_get_tc(ans->wire) || ans->tsig_rr != NULL) {
+		return;
+	}
+	uint8_t rcode = knot_wire_get_rcode(ans->wire);
+	if (rcode != KNOT_RCODE_NOERROR && rcode != KNOT_RCODE_NXDOMAIN) {
+		return;
+	}
+
+	udp_cache_entry_t *entry = &cache->entries[key->hash & cache->mask];
+	entry->generation = key->generation;
+	entry->hash = key->hash;
+	entry->qtype = key->qtype;
+	entry->max_size = key->max_size;
+	entry->flags = key->flags;
+	entry->qname_size = key->qname_size;
+	memcpy(entry->qname, key->qname, key->qname_size);
+	memcpy(entry->wire, ans->wire, ans->size);
+	entry->wire_size = ans->size;
+	entry->promoted = false;
+}
+
+bool udp_cache_promote(udp_cache_t *cache, const udp_cache_key_t *key)
+{
+	assert(cache && key);
+
+	udp_cache_entry_t *entry = &cache->entries[key->hash & cache->mask];
+	if (!entry_match(entry, key) || entry->promoted) {
+		return false;
+	}
+
+	entry->promoted = true;
+	return true;
+}
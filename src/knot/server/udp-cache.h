@@ -0,0 +1,129 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Per-thread cache of rendered UDP answers.
+ *
+ * Answers to plain queries (single question, no EDNS options, no TSIG, no
+ * query modules) are stored in wire format and reused for subsequent queries
+ * with the same key. Only the message ID, the RD flag, and the QNAME letter
+ * case are patched in the cached answer. The cache is invalidated as a whole
+ * whenever the answer generation (see zone_answers_generation()) changes.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "knot/zone/zone.h"
+#include "libknot/packet/pkt.h"
+
+#define UDP_CACHE_MAX_WIRE 1232 /*!< Maximal size of a cached answer. */
+
+/*! \brief Cache key flags. */
+enum {
+	UDP_CACHE_KEY_EDNS = 1 << 0, /*!< The query contains OPT. */
+	UDP_CACHE_KEY_DO   = 1 << 1, /*!< The DO bit is set. */
+	UDP_CACHE_KEY_IPV6 = 1 << 2, /*!< The query was received over IPv6. */
+};
+
+/*! \brief Cache key of a query eligible for caching. */
+typedef struct {
+	uint64_t generation; /*!< Answer generation at the time of the query. */
+	uint32_t hash;       /*!< Key hash. */
+	uint16_t qtype;      /*!< Query type. */
+	uint16_t max_size;   /*!< Maximal answer size. */
+	uint8_t flags;       /*!< EDNS, DO bit, and address family flags. */
+	uint8_t qname_size;  /*!< Size of the QNAME. */
+	knot_dname_storage_t qname; /*!< Lower-cased QNAME. */
+} udp_cache_key_t;
+
+typedef struct udp_cache udp_cache_t;
+
+/*!
+ * \brief Creates a new answer cache.
+ *
+ * \param size  Number of cache entries (rounded up to a power of two).
+ *
+ * \return Answer cache or NULL if error.
+ */
+udp_cache_t *udp_cache_new(size_t size);
+
+/*!
+ * \brief Deallocates the answer cache.
+ */
+void udp_cache_free(udp_cache_t *cache);
+
+/*!
+ * \brief Checks if the query is eligible for caching and computes its key.
+ *
+ * \note Must be called within an RCU read-side critical section.
+ *
+ * \param cache   Answer cache.
+ * \param key     Output cache key.
+ * \param wire    Query wire.
+ * \param len     Query size.
+ * \param remote  Query source address.
+ *
+ * \return True if the query might be answered from or stored in the cache.
+ */
+bool udp_cache_key(udp_cache_t *cache, udp_cache_key_t *key,
+                   const uint8_t *wire, size_t len,
+                   const struct sockaddr_storage *remote);
+
+/*!
+ * \brief Writes a cached answer for the query if available.
+ *
+ * \param cache    Answer cache.
+ * \param key      Key of the query.
+ * \param query    Query wire the key was computed from.
+ * \param out      Output buffer.
+ * \param out_max  Size of the output buffer.
+ *
+ * \return Size of the written answer, 0 if not cached.
+ */
+size_t udp_cache_answer(udp_cache_t *cache, const udp_cache_key_t *key,
+                        const uint8_t *query, uint8_t *out, size_t out_max);
+
+/*!
+ * \brief Stores the answer to the cache if it is eligible for caching.
+ *
+ * \note Must be called within the same RCU read-side critical section
+ *       the query was processed in.
+ *
+ * \param cache  Answer cache.
+ * \param key    Key of the query.
+ * \param ans    Complete answer.
+ * \param zone   Zone the answer was produced from.
+ */
+void udp_cache_store(udp_cache_t *cache, const udp_cache_key_t *key,
+                     const knot_pkt_t *ans, const zone_t *zone);
+
+/*!
+ * \brief Checks if the cached answer of the query is to be promoted.
+ *
+ * Returns true only for the first hit of each stored answer, which is used
+ * for handing the answers that are repeatedly asked for over to a faster
+ * path (e.g. the XDP filter).
+ *
+ * \param cache  Answer cache.
+ * \param key    Key of the query just answered from the cache.
+ *
+ * \return True if promoted for the first time.
+ */
+bool udp_cache_promote(udp_cache_t *cache, const udp_cache_key_t *key);
@@ -23,22 +23,32 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <sys/param.h>
 #ifdef HAVE_SYS_UIO_H	// struct iovec (OpenBSD)
 #include <sys/uio.h>
 #endif /* HAVE_SYS_UIO_H */
 #include <unistd.h>
+#include <urcu.h>
+#ifdef ENABLE_IO_URING
+#include <liburing.h>
+#endif
 
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
 #include "contrib/sockaddr.h"
 #include "contrib/ucw/mempool.h"
 #include "knot/common/fdset.h"
+#include "knot/common/log.h"
+#include "knot/common/memstat.h"
+#include "knot/common/usdt.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/layer.h"
 #include "knot/server/server.h"
+#include "knot/server/udp-cache.h"
 #include "knot/server/udp-handler.h"
+#include "knot/server/udp-refuse.h"
 #include "knot/server/xdp-handler.h"
 
 /* Buffer identifiers. */
@@ -53,6 +63,10 @@ typedef struct {
 	knot_layer_t layer; /*!< Query processing layer. */
 	server_t *server;   /*!< Name server structure. */
 	unsigned thread_id; /*!< Thread identifier. */
+	udp_cache_t *cache; /*!< Answer cache (optional). */
+	process_query_data_t qdata; /*!< Reused query data. */
+	knot_pkt_t query;   /*!< Reused query packet. */
+	knot_pkt_t ans;     /*!< Reused answer packet. */
 } udp_context_t;
 
 static bool udp_state_active(int state)
@@ -74,18 +88,56 @@ static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 		.thread_id = udp->thread_id
 	};
 
+	/* Try to answer from the cache. */
+	udp_cache_key_t key;
+	bool cacheable = false;
+	if (udp->cache != NULL) {
+		rcu_read_lock();
+		cacheable = udp_cache_key(udp->cache, &key, rx->iov_base, rx->iov_len, ss);
+		if (cacheable) {
+			size_t len = udp_cache_answer(udp->cache, &key, rx->iov_base,
+			                              tx->iov_base, tx->iov_len);
+			if (len > 0) {
+				rcu_read_unlock();
+				tx->iov_len = len;
+				return;
+			}
+		} else {
+			rcu_read_unlock();
+		}
+	}
+
+	/* Refuse queries to the zones not served without full processing. */
+	if (!cacheable) {
+		rcu_read_lock();
+	}
+	size_t refused = udp_refuse(udp->server->zone_db, rx->iov_base, rx->iov_len,
+	                            ss, tx->iov_base, tx->iov_len);
+	if (refused > 0) {
+		rcu_read_unlock();
+		tx->iov_len = refused;
+		return;
+	}
+	if (!cacheable) {
+		rcu_read_unlock();
+	}
+
 	/* Start query processing. */
 	knot_layer_begin(&udp->layer, &params);
 
-	/* Create packets. */
-	knot_pkt_t *query = knot_pkt_new(rx->iov_base, rx->iov_len, udp->layer.mm);
-	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, udp->layer.mm);
+	/* Initialize packets. */
+	knot_pkt_t *query = &udp->query;
+	knot_pkt_t *ans = &udp->ans;
+	(void)knot_pkt_init(query, rx->iov_base, rx->iov_len, udp->layer.mm);
+	(void)knot_pkt_init(ans, tx->iov_base, tx->iov_len, udp->layer.mm);
 
 	/* Input packet. */
 	int ret = knot_pkt_parse(query, 0);
 	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
 		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
 	}
+	KNOT_PROBE(query_recv, "udp", knot_pkt_qname(query), knot_pkt_qtype(query),
+	           query->size);
 	knot_layer_consume(&udp->layer, query);
 
 	/* Process answer. */
@@ -99,21 +151,33 @@ static void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 	} else {
 		tx->iov_len = 0;
 	}
+	KNOT_PROBE(query_send, "udp", knot_pkt_qname(query),
+	           knot_wire_get_rcode(ans->wire), tx->iov_len);
+
+	/* Store the answer while the zone is still protected. */
+	if (cacheable) {
+		if (tx->iov_len > 0) {
+			knotd_qdata_t *qdata = udp->layer.data;
+			udp_cache_store(udp->cache, &key, ans, qdata->extra->zone);
+		}
+		rcu_read_unlock();
+	}
 
 	/* Reset after processing. */
 	knot_layer_finish(&udp->layer);
 
-	/* Flush per-query memory (including query and answer packets). */
+	/* Flush per-query memory (packet data). */
 	mp_flush(udp->layer.mm->ctx);
 }
 
 typedef struct {
-	void* (*udp_init)(void *);
+	void* (*udp_init)(fdset_t *, void *);
 	void (*udp_deinit)(void *);
 	int (*udp_recv)(int, void *);
 	void (*udp_handle)(udp_context_t *, void *);
-	void (*udp_send)(void *);
+	void (*udp_send)(udp_context_t *, void *);
 	void (*udp_sweep)(void *); // Optional
+	int (*udp_wait)(void *, int); // Optional, replaces polling and udp_recv
 } udp_api_t;
 
 /*! \brief Control message to fit IP_PKTINFO or IPv6_RECVPKTINFO. */
@@ -150,6 +214,22 @@ static void udp_pktinfo_handle(const struct msghdr *rx, struct msghdr *tx)
 #endif
 }
 
+#if defined(ENABLE_RECVMMSG) || defined(ENABLE_IO_URING)
+/*!
+ * \brief Returns the size of the message buffers.
+ *
+ * Neither the answers nor the processed queries exceed the maximal
+ * EDNS payload, so full 64 KiB buffers aren't needed.
+ */
+static size_t udp_slot_size(void)
+{
+	conf_t *pconf = conf();
+	size_t size = MAX(pconf->cache.srv_udp_max_payload_ipv4,
+	                  pconf->cache.srv_udp_max_payload_ipv6);
+	return MAX(size, KNOT_WIRE_MIN_PKTSIZE);
+}
+#endif
+
 /* UDP recvfrom() request struct. */
 struct udp_recvfrom {
 	int fd;
@@ -160,7 +240,7 @@ struct udp_recvfrom {
 	cmsg_pktinfo_t pktinfo;
 };
 
-static void *udp_recvfrom_init(_unused_ void *xdp_sock)
+static void *udp_recvfrom_init(_unused_ fdset_t *fds, _unused_ void *xdp_sock)
 {
 	struct udp_recvfrom *rq = malloc(sizeof(struct udp_recvfrom));
 	if (rq == NULL) {
@@ -219,7 +299,7 @@ static void udp_recvfrom_handle(udp_context_t *ctx, void *d)
 	udp_handle(ctx, rq->fd, &rq->addr, &rq->iov[RX], &rq->iov[TX], NULL);
 }
 
-static void udp_recvfrom_send(void *d)
+static void udp_recvfrom_send(_unused_ udp_context_t *ctx, void *d)
 {
 	struct udp_recvfrom *rq = d;
 	if (rq->iov[TX].iov_len > 0) {
@@ -237,36 +317,101 @@ static udp_api_t udp_recvfrom_api = {
 };
 
 #ifdef ENABLE_RECVMMSG
+#ifdef UDP_SEGMENT
+#define UDP_GSO_MAX_SIZE 65507 /*!< Maximum UDP payload of a GSO super-packet. */
+
+/*! \brief Control message to fit IP_PKTINFO or IPv6_RECVPKTINFO and UDP_SEGMENT. */
+typedef union {
+	struct cmsghdr cmsg;
+	uint8_t buf[CMSG_SPACE(sizeof(struct in6_pktinfo)) + CMSG_SPACE(sizeof(uint16_t))];
+} cmsg_gso_t;
+#endif
+
 /* UDP recvmmsg() request struct. */
 struct udp_recvmmsg {
 	int fd;
-	struct sockaddr_storage addrs[RECVMMSG_BATCHLEN];
+	struct sockaddr_storage *addrs;
 	char *iobuf[NBUFS];
 	struct iovec *iov[NBUFS];
 	struct mmsghdr *msgs[NBUFS];
 	unsigned rcvd;
+	unsigned batch;     /*!< Current batch size. */
+	unsigned batch_max; /*!< Size of the allocated batch. */
+	size_t slot_size;   /*!< Size of each message buffer. */
 	knot_mm_t mm;
-	cmsg_pktinfo_t pktinfo[RECVMMSG_BATCHLEN];
+	cmsg_pktinfo_t *pktinfo;
+#ifdef UDP_SEGMENT
+	bool gso_failed; /*!< UDP GSO not supported, don't try again. */
+	struct mmsghdr *gso_msgs;
+	cmsg_gso_t *gso_cmsg;
+#endif
 };
 
-static void *udp_recvmmsg_init(_unused_ void *xdp_sock)
+/*!
+ * \brief Adapts the batch size to the receive queue occupancy.
+ *
+ * The batch is doubled if it was filled completely as more messages are
+ * likely pending, and halved back if it was mostly empty.
+ */
+static unsigned udp_batch_adapt(unsigned batch, unsigned rcvd, unsigned batch_max)
+{
+	unsigned batch_min = MIN(RECVMMSG_BATCHLEN, batch_max);
+	if (rcvd >= batch) {
+		return MIN(2 * batch, batch_max);
+	} else if (rcvd < batch / 4) {
+		return MAX(batch / 2, batch_min);
+	}
+	return batch;
+}
+
+#ifdef UDP_SEGMENT
+static bool udp_gso_supported(void)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) {
+		return false;
+	}
+
+	/* Older kernels would silently ignore the UDP_SEGMENT control message. */
+	int val = 0;
+	socklen_t len = sizeof(val);
+	int ret = getsockopt(fd, SOL_UDP, UDP_SEGMENT, &val, &len);
+	close(fd);
+
+	return ret == 0;
+}
+#endif
+
+static void *udp_recvmmsg_init(_unused_ fdset_t *fds, _unused_ void *xdp_sock)
 {
 	knot_mm_t mm;
-	mm_ctx_mempool(&mm, sizeof(struct udp_recvmmsg));
+	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
 
 	struct udp_recvmmsg *rq = mm_alloc(&mm, sizeof(struct udp_recvmmsg));
 	memset(rq, 0, sizeof(*rq));
 	memcpy(&rq->mm, &mm, sizeof(knot_mm_t));
 
+	rq->batch_max = conf()->cache.srv_udp_batch_size;
+	rq->batch = MIN(RECVMMSG_BATCHLEN, rq->batch_max);
+	rq->slot_size = udp_slot_size();
+
+	rq->addrs = mm_alloc(&mm, sizeof(*rq->addrs) * rq->batch_max);
+	rq->pktinfo = mm_alloc(&mm, sizeof(*rq->pktinfo) * rq->batch_max);
+	memset(rq->addrs, 0, sizeof(*rq->addrs) * rq->batch_max);
+#ifdef UDP_SEGMENT
+	rq->gso_msgs = mm_alloc(&mm, sizeof(*rq->gso_msgs) * rq->batch_max);
+	rq->gso_cmsg = mm_alloc(&mm, sizeof(*rq->gso_cmsg) * rq->batch_max);
+#endif
+
 	/* Initialize buffers. */
 	for (unsigned i = 0; i < NBUFS; ++i) {
-		rq->iobuf[i] = mm_alloc(&mm, KNOT_WIRE_MAX_PKTSIZE * RECVMMSG_BATCHLEN);
-		rq->iov[i] = mm_alloc(&mm, sizeof(struct iovec) * RECVMMSG_BATCHLEN);
-		rq->msgs[i] = mm_alloc(&mm, sizeof(struct mmsghdr) * RECVMMSG_BATCHLEN);
-		memset(rq->msgs[i], 0, sizeof(struct mmsghdr) * RECVMMSG_BATCHLEN);
-		for (unsigned k = 0; k < RECVMMSG_BATCHLEN; ++k) {
-			rq->iov[i][k].iov_base = rq->iobuf[i] + k * KNOT_WIRE_MAX_PKTSIZE;
-			rq->iov[i][k].iov_len = KNOT_WIRE_MAX_PKTSIZE;
+		rq->iobuf[i] = mm_alloc(&mm, rq->slot_size * rq->batch_max);
+		rq->iov[i] = mm_alloc(&mm, sizeof(struct iovec) * rq->batch_max);
+		rq->msgs[i] = mm_alloc(&mm, sizeof(struct mmsghdr) * rq->batch_max);
+		memset(rq->msgs[i], 0, sizeof(struct mmsghdr) * rq->batch_max);
+		for (unsigned k = 0; k < rq->batch_max; ++k) {
+			rq->iov[i][k].iov_base = rq->iobuf[i] + k * rq->slot_size;
+			rq->iov[i][k].iov_len = rq->slot_size;
 			rq->msgs[i][k].msg_hdr.msg_iov = rq->iov[i] + k;
 			rq->msgs[i][k].msg_hdr.msg_iovlen = 1;
 			rq->msgs[i][k].msg_hdr.msg_name = rq->addrs + k;
@@ -276,6 +421,10 @@ static void *udp_recvmmsg_init(_unused_ void *xdp_sock)
 		}
 	}
 
+#ifdef UDP_SEGMENT
+	rq->gso_failed = !udp_gso_supported();
+#endif
+
 	return rq;
 }
 
@@ -291,10 +440,11 @@ static int udp_recvmmsg_recv(int fd, void *d)
 {
 	struct udp_recvmmsg *rq = d;
 
-	int n = recvmmsg(fd, rq->msgs[RX], RECVMMSG_BATCHLEN, MSG_DONTWAIT, NULL);
+	int n = recvmmsg(fd, rq->msgs[RX], rq->batch, MSG_DONTWAIT, NULL);
 	if (n > 0) {
 		rq->fd = fd;
 		rq->rcvd = n;
+		rq->batch = udp_batch_adapt(rq->batch, n, rq->batch_max);
 	}
 	return n;
 }
@@ -321,16 +471,113 @@ static void udp_recvmmsg_handle(udp_context_t *ctx, void *d)
 	}
 }
 
-static void udp_recvmmsg_send(void *d)
+#ifdef UDP_SEGMENT
+static bool udp_gso_mergeable(struct udp_recvmmsg *rq, unsigned first, unsigned i,
+                              size_t total)
+{
+	const struct msghdr *a = &rq->msgs[TX][first].msg_hdr;
+	const struct msghdr *b = &rq->msgs[TX][i].msg_hdr;
+	size_t seg_len = rq->iov[TX][first].iov_len;
+	size_t len = rq->iov[TX][i].iov_len;
+
+	/* All segments but the last one must be of the same size. */
+	if (len == 0 || len > seg_len || rq->iov[TX][i - 1].iov_len != seg_len ||
+	    total + len > UDP_GSO_MAX_SIZE) {
+		return false;
+	}
+
+	/* Same destination and the same source address. */
+	return sockaddr_cmp(rq->addrs + first, rq->addrs + i, false) == 0 &&
+	       a->msg_controllen == b->msg_controllen &&
+	       (a->msg_controllen == 0 ||
+	        memcmp(a->msg_control, b->msg_control, a->msg_controllen) == 0);
+}
+
+static void udp_gso_set_cmsg(struct msghdr *msg, cmsg_gso_t *gso, uint16_t seg_len)
+{
+	size_t pktinfo_len = CMSG_ALIGN(msg->msg_controllen);
+	if (pktinfo_len > 0) {
+		memcpy(gso->buf, msg->msg_control, msg->msg_controllen);
+	}
+
+	struct cmsghdr *cmsg = (struct cmsghdr *)(gso->buf + pktinfo_len);
+	cmsg->cmsg_level = SOL_UDP;
+	cmsg->cmsg_type = UDP_SEGMENT;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(seg_len));
+	memcpy(CMSG_DATA(cmsg), &seg_len, sizeof(seg_len));
+
+	msg->msg_control = gso->buf;
+	msg->msg_controllen = pktinfo_len + CMSG_SPACE(sizeof(seg_len));
+}
+
+/*!
+ * \brief Send the responses, coalescing consecutive same-sized responses
+ *        to the same destination into UDP GSO super-packets.
+ *
+ * \return False if the GSO send failed and the plain send should be used.
+ */
+static bool udp_recvmmsg_send_gso(udp_context_t *ctx, struct udp_recvmmsg *rq)
+{
+	unsigned count = 0, gso_msgs = 0, gso_segs = 0;
+
+	for (unsigned i = 0; i < rq->rcvd; ) {
+		if (rq->iov[TX][i].iov_len == 0) {
+			i++; // No response.
+			continue;
+		}
+
+		unsigned first = i;
+		size_t total = rq->iov[TX][first].iov_len;
+		for (i++; i < rq->rcvd && udp_gso_mergeable(rq, first, i, total); i++) {
+			total += rq->iov[TX][i].iov_len;
+		}
+
+		struct mmsghdr *out = &rq->gso_msgs[count++];
+		*out = rq->msgs[TX][first];
+		if (i - first > 1) {
+			out->msg_hdr.msg_iov = rq->iov[TX] + first;
+			out->msg_hdr.msg_iovlen = i - first;
+			udp_gso_set_cmsg(&out->msg_hdr, &rq->gso_cmsg[count - 1],
+			                 rq->iov[TX][first].iov_len);
+			gso_msgs++;
+			gso_segs += i - first;
+		}
+	}
+
+	if (gso_msgs == 0) {
+		return false; // Nothing to coalesce, use the ordinary send.
+	}
+
+	int ret = sendmmsg(rq->fd, rq->gso_msgs, count, 0);
+	if (ret < 0 && (errno == EINVAL || errno == EIO)) {
+		// EIO means no checksum offload, EINVAL a segment exceeding the MTU.
+		rq->gso_failed = (errno == EIO);
+		return false;
+	}
+
+	__atomic_add_fetch(&ctx->server->stats.udp_gso_msgs, gso_msgs, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&ctx->server->stats.udp_gso_segs, gso_segs, __ATOMIC_RELAXED);
+
+	return true;
+}
+#endif
+
+static void udp_recvmmsg_send(udp_context_t *ctx, void *d)
 {
 	struct udp_recvmmsg *rq = d;
-	(void)sendmmsg(rq->fd, rq->msgs[TX], rq->rcvd, 0);
+#ifdef UDP_SEGMENT
+	if (rq->rcvd < 2 || !conf()->cache.srv_udp_gso || rq->gso_failed ||
+	    !udp_recvmmsg_send_gso(ctx, rq))
+#endif
+	{
+		(void)sendmmsg(rq->fd, rq->msgs[TX], rq->rcvd, 0);
+	}
 	for (unsigned i = 0; i < rq->rcvd; ++i) {
 		/* Reset buffer size and address len. */
 		struct iovec *rx = rq->msgs[RX][i].msg_hdr.msg_iov;
 		struct iovec *tx = rq->msgs[TX][i].msg_hdr.msg_iov;
-		rx->iov_len = KNOT_WIRE_MAX_PKTSIZE; /* Reset RX buflen */
-		tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
+		rx->iov_len = rq->slot_size; /* Reset RX buflen */
+		tx->iov_len = rq->slot_size;
 
 		memset(rq->addrs + i, 0, sizeof(struct sockaddr_storage));
 		rq->msgs[RX][i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
@@ -348,9 +595,202 @@ static udp_api_t udp_recvmmsg_api = {
 };
 #endif /* ENABLE_RECVMMSG */
 
+#ifdef ENABLE_IO_URING
+#define IOURING_FD_SLOTS RECVMMSG_BATCHLEN /*!< Outstanding receives per socket. */
+
+/* Operation type encoded in the lowest bit of the request user data. */
+enum {
+	IOURING_RECV = 0,
+	IOURING_SEND = 1,
+};
+
+/* UDP io_uring request slot, each with at most one pending operation. */
+struct udp_iouring_slot {
+	int fd;
+	struct sockaddr_storage addr;
+	struct msghdr msg[NBUFS];
+	struct iovec iov[NBUFS];
+	cmsg_pktinfo_t pktinfo;
+	uint8_t *buf[NBUFS];
+};
+
+/* UDP io_uring request struct. */
+struct udp_iouring {
+	struct io_uring ring;
+	struct udp_iouring_slot *slots;
+	unsigned nslots;
+	size_t slot_size; /* Size of each message buffer. */
+	struct io_uring_cqe **cqes;
+	unsigned *rcvd;  /* Indices of slots with a received message. */
+	unsigned nrcvd;
+	knot_mm_t mm;
+};
+
+static void udp_iouring_prep(struct udp_iouring *rq, unsigned idx, int op)
+{
+	struct udp_iouring_slot *slot = &rq->slots[idx];
+
+	/* Each slot has at most one pending request, the SQ can't overflow. */
+	struct io_uring_sqe *sqe = io_uring_get_sqe(&rq->ring);
+	assert(sqe != NULL);
+
+	if (op == IOURING_RECV) {
+		slot->iov[RX].iov_len = rq->slot_size;
+		slot->msg[RX].msg_namelen = sizeof(slot->addr);
+		slot->msg[RX].msg_control = &slot->pktinfo.cmsg;
+		slot->msg[RX].msg_controllen = sizeof(slot->pktinfo);
+		io_uring_prep_recvmsg(sqe, slot->fd, &slot->msg[RX], 0);
+	} else {
+		io_uring_prep_sendmsg(sqe, slot->fd, &slot->msg[TX], 0);
+	}
+	io_uring_sqe_set_data64(sqe, ((uint64_t)idx << 1) | op);
+}
+
+static void udp_iouring_deinit(void *d)
+{
+	struct udp_iouring *rq = d;
+	if (rq != NULL) {
+		io_uring_queue_exit(&rq->ring);
+		mp_delete(rq->mm.ctx);
+	}
+}
+
+static void *udp_iouring_init(fdset_t *fds, _unused_ void *xdp_sock)
+{
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+
+	struct udp_iouring *rq = mm_alloc(&mm, sizeof(struct udp_iouring));
+	memset(rq, 0, sizeof(*rq));
+	memcpy(&rq->mm, &mm, sizeof(knot_mm_t));
+
+	unsigned nfds = fdset_get_length(fds);
+	rq->nslots = nfds * IOURING_FD_SLOTS;
+	rq->slot_size = udp_slot_size();
+	rq->slots = mm_alloc(&mm, rq->nslots * sizeof(*rq->slots));
+	rq->cqes = mm_alloc(&mm, rq->nslots * sizeof(*rq->cqes));
+	rq->rcvd = mm_alloc(&mm, rq->nslots * sizeof(*rq->rcvd));
+	if (rq->slots == NULL || rq->cqes == NULL || rq->rcvd == NULL) {
+		mp_delete(mm.ctx);
+		return NULL;
+	}
+
+	int ret = io_uring_queue_init(rq->nslots, &rq->ring, 0);
+	if (ret < 0) {
+		log_warning("UDP, failed to initialize io_uring (%s)",
+		            knot_strerror(knot_map_errno_code(-ret)));
+		mp_delete(mm.ctx);
+		return NULL;
+	}
+
+	/* Post the initial receives on all sockets. */
+	for (unsigned i = 0; i < rq->nslots; ++i) {
+		struct udp_iouring_slot *slot = &rq->slots[i];
+		memset(slot, 0, sizeof(*slot));
+		slot->fd = fdset_get_fd(fds, i / IOURING_FD_SLOTS);
+		for (unsigned k = 0; k < NBUFS; ++k) {
+			slot->buf[k] = mm_alloc(&mm, rq->slot_size);
+			if (slot->buf[k] == NULL) {
+				io_uring_queue_exit(&rq->ring);
+				mp_delete(mm.ctx);
+				return NULL;
+			}
+			slot->iov[k].iov_base = slot->buf[k];
+			slot->iov[k].iov_len = rq->slot_size;
+			slot->msg[k].msg_name = &slot->addr;
+			slot->msg[k].msg_namelen = sizeof(slot->addr);
+			slot->msg[k].msg_iov = &slot->iov[k];
+			slot->msg[k].msg_iovlen = 1;
+		}
+		udp_iouring_prep(rq, i, IOURING_RECV);
+	}
+
+	return rq;
+}
+
+static int udp_iouring_wait(void *d, int timeout_ms)
+{
+	struct udp_iouring *rq = d;
+	struct __kernel_timespec ts = {
+		.tv_sec = timeout_ms / 1000,
+		.tv_nsec = (timeout_ms % 1000) * 1000000
+	};
+
+	/* Submit the prepared sends and receives and wait, all in one syscall. */
+	struct io_uring_cqe *cqe;
+	int ret = io_uring_submit_and_wait_timeout(&rq->ring, &cqe, 1, &ts, NULL);
+	if (ret < 0) { // Timeout or interrupted.
+		return 0;
+	}
+
+	rq->nrcvd = 0;
+	unsigned count = io_uring_peek_batch_cqe(&rq->ring, rq->cqes, rq->nslots);
+	for (unsigned i = 0; i < count; ++i) {
+		uint64_t data = io_uring_cqe_get_data64(rq->cqes[i]);
+		unsigned idx = data >> 1;
+		assert(idx < rq->nslots);
+
+		if ((data & 1) == IOURING_RECV && rq->cqes[i]->res > 0) {
+			rq->slots[idx].iov[RX].iov_len = rq->cqes[i]->res;
+			rq->rcvd[rq->nrcvd++] = idx;
+		} else {
+			/* Completed send or failed receive, receive again. */
+			udp_iouring_prep(rq, idx, IOURING_RECV);
+		}
+	}
+	io_uring_cq_advance(&rq->ring, count);
+
+	return rq->nrcvd;
+}
+
+static int udp_iouring_recv(_unused_ int fd, _unused_ void *d)
+{
+	assert(0); // Replaced by udp_iouring_wait().
+	return 0;
+}
+
+static void udp_iouring_handle(udp_context_t *ctx, void *d)
+{
+	struct udp_iouring *rq = d;
+
+	for (unsigned i = 0; i < rq->nrcvd; ++i) {
+		unsigned idx = rq->rcvd[i];
+		struct udp_iouring_slot *slot = &rq->slots[idx];
+
+		/* Prepare TX address. */
+		slot->msg[TX].msg_namelen = slot->msg[RX].msg_namelen;
+		slot->iov[TX].iov_len = rq->slot_size;
+
+		udp_pktinfo_handle(&slot->msg[RX], &slot->msg[TX]);
+
+		udp_handle(ctx, slot->fd, &slot->addr, &slot->iov[RX], &slot->iov[TX], NULL);
+
+		/* Receive again once the response is sent. */
+		udp_iouring_prep(rq, idx, slot->iov[TX].iov_len > 0 ? IOURING_SEND :
+		                                                      IOURING_RECV);
+	}
+	rq->nrcvd = 0;
+}
+
+static void udp_iouring_send(_unused_ udp_context_t *ctx, _unused_ void *d)
+{
+	/* The prepared sends are submitted within the next udp_iouring_wait(). */
+}
+
+static udp_api_t udp_iouring_api = {
+	udp_iouring_init,
+	udp_iouring_deinit,
+	udp_iouring_recv,
+	udp_iouring_handle,
+	udp_iouring_send,
+	NULL,
+	udp_iouring_wait,
+};
+#endif /* ENABLE_IO_URING */
+
 #ifdef ENABLE_XDP
 
-static void *xdp_recvmmsg_init(void *xdp_sock)
+static void *xdp_recvmmsg_init(_unused_ fdset_t *fds, void *xdp_sock)
 {
 	return xdp_handle_init(xdp_sock);
 }
@@ -370,7 +810,7 @@ static void xdp_recvmmsg_handle(udp_context_t *ctx, void *d)
 	xdp_handle_msgs(d, &ctx->layer, ctx->server, ctx->thread_id);
 }
 
-static void xdp_recvmmsg_send(void *d)
+static void xdp_recvmmsg_send(_unused_ udp_context_t *ctx, void *d)
 {
 	xdp_handle_send(d);
 }
@@ -391,6 +831,12 @@ static udp_api_t xdp_recvmmsg_api = {
 };
 #endif /* ENABLE_XDP */
 
+#ifdef ENABLE_RECVMMSG
+#define UDP_DEFAULT_API udp_recvmmsg_api
+#else
+#define UDP_DEFAULT_API udp_recvfrom_api
+#endif
+
 static bool is_xdp_thread(const server_t *server, int thread_id)
 {
 	return server->handlers[IO_XDP].size > 0 &&
@@ -453,6 +899,27 @@ static unsigned udp_set_ifaces(const server_t *server, size_t n_ifaces, fdset_t
 	return fdset_get_length(fds);
 }
 
+/*!
+ * \brief Returns the NIC queue served by the XDP thread.
+ *
+ * Drivers usually bind the IRQ of the N-th queue to the N-th CPU, so pinning
+ * the thread to the same CPU keeps the packet processing on one core.
+ */
+static unsigned xdp_thread_cpu(const server_t *server, int thread_id)
+{
+#ifdef ENABLE_XDP
+	const iface_t *ifaces = server->ifaces;
+	for (const iface_t *i = ifaces; i != ifaces + server->n_ifaces; i++) {
+		if (i->fd_xdp_count > 0 && thread_id >= i->xdp_first_thread_id &&
+		    thread_id < i->xdp_first_thread_id + i->fd_xdp_count) {
+			return placement_queue_cpu(server->placement, i->xdp_name,
+			                           thread_id - i->xdp_first_thread_id);
+		}
+	}
+#endif
+	return placement_queue_cpu(server->placement, NULL, thread_id);
+}
+
 int udp_master(dthread_t *thread)
 {
 	if (thread == NULL || thread->data == NULL) {
@@ -466,10 +933,13 @@ int udp_master(dthread_t *thread)
 		return KNOT_EOK;
 	}
 
-	/* Set thread affinity to CPU core (same for UDP and XDP). */
+	/* Set thread affinity to CPU core (XDP threads follow their NIC queue). */
 	unsigned cpu = dt_online_cpus();
 	if (cpu > 1) {
-		unsigned cpu_mask = (dt_get_id(thread) % cpu);
+		unsigned cpu_mask = placement_cpu(handler->server->placement, dt_get_id(thread));
+		if (is_xdp_thread(handler->server, thread_id)) {
+			cpu_mask = xdp_thread_cpu(handler->server, thread_id);
+		}
 		dt_setaffinity(thread, &cpu_mask, 1);
 	}
 
@@ -482,17 +952,19 @@ int udp_master(dthread_t *thread)
 		assert(0);
 #endif
 	} else {
-#ifdef ENABLE_RECVMMSG
-		api = &udp_recvmmsg_api;
-#else
-		api = &udp_recvfrom_api;
+#ifdef ENABLE_IO_URING
+		if (conf()->cache.srv_udp_io_uring) {
+			api = &udp_iouring_api;
+		} else
 #endif
+		api = &UDP_DEFAULT_API;
 	}
 	void *api_ctx = NULL;
 
 	/* Create big enough memory cushion. */
 	knot_mm_t mm;
 	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+	size_t pool_size = 0;
 
 	/* Create UDP answering context. */
 	udp_context_t udp = {
@@ -500,6 +972,7 @@ int udp_master(dthread_t *thread)
 		.thread_id = thread_id,
 	};
 	knot_layer_init(&udp.layer, &mm, process_query_layer());
+	process_query_prealloc(&udp.layer, &udp.qdata);
 
 	/* Allocate descriptors for the configured interfaces. */
 	void *xdp_socket = NULL;
@@ -515,11 +988,26 @@ int udp_master(dthread_t *thread)
 	}
 
 	/* Initialize the networking API. */
-	api_ctx = api->udp_init(xdp_socket);
+	api_ctx = api->udp_init(&fds, xdp_socket);
+#ifdef ENABLE_IO_URING
+	if (api_ctx == NULL && api == &udp_iouring_api) {
+		api = &UDP_DEFAULT_API; // Fall back to the default API.
+		api_ctx = api->udp_init(&fds, xdp_socket);
+	}
+#endif
 	if (api_ctx == NULL) {
 		goto finish;
 	}
 
+	/* Create the answer cache if configured (XDP workers have their own). */
+	size_t cache_size = conf()->cache.srv_udp_answer_cache;
+	if (cache_size > 0 && !is_xdp_thread(handler->server, thread_id)) {
+		udp.cache = udp_cache_new(cache_size);
+		if (udp.cache == NULL) {
+			log_warning("UDP, failed to create answer cache");
+		}
+	}
+
 	/* Loop until all data is read. */
 	for (;;) {
 		/* Cancellation point. */
@@ -527,6 +1015,18 @@ int udp_master(dthread_t *thread)
 			break;
 		}
 
+		/* Account the memory pool of the thread. */
+		memstat_pool_update(MEMSTAT_THREAD_POOLS, &pool_size, mp_total_size(mm.ctx));
+
+		/* Completion based API waits for the received messages itself. */
+		if (api->udp_wait != NULL) {
+			if (api->udp_wait(api_ctx, 1000) > 0) {
+				api->udp_handle(&udp, api_ctx);
+				api->udp_send(&udp, api_ctx);
+			}
+			continue;
+		}
+
 		/* Wait for events. */
 		fdset_it_t it;
 		(void)fdset_poll(&fds, &it, 0, 1000);
@@ -538,7 +1038,7 @@ int udp_master(dthread_t *thread)
 			}
 			if (api->udp_recv(fdset_it_get_fd(&it), api_ctx) > 0) {
 				api->udp_handle(&udp, api_ctx);
-				api->udp_send(api_ctx);
+				api->udp_send(&udp, api_ctx);
 			}
 		}
 
@@ -549,7 +1049,9 @@ int udp_master(dthread_t *thread)
 	}
 
 finish:
+	udp_cache_free(udp.cache);
 	api->udp_deinit(api_ctx);
+	memstat_pool_update(MEMSTAT_THREAD_POOLS, &pool_size, 0);
 	mp_delete(mm.ctx);
 	fdset_clear(&fds);
 
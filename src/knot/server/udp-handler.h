@@ -26,7 +26,7 @@
 
 #include "knot/server/dthreads.h"
 
-#define RECVMMSG_BATCHLEN 10 /*!< Default recvmmsg() batch size. */
+#define RECVMMSG_BATCHLEN 10 /*!< Initial and minimal recvmmsg() batch size. */
 
 /*!
  * \brief UDP handler thread runnable.
@@ -0,0 +1,161 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "knot/server/udp-refuse.h"
+#include "knot/conf/conf.h"
+#include "libknot/libknot.h"
+
+/*! \brief Size of the answer OPT with the extended error. */
+#define OPT_SIZE (KNOT_EDNS_MIN_SIZE + KNOT_EDNS_OPTION_HDRLEN + sizeof(uint16_t))
+
+static bool check_opt(const uint8_t *pos, const uint8_t *end, bool *do_bit)
+{
+	/* OPT version 0 ending the packet with well-formed options. */
+	if (end - pos < KNOT_EDNS_MIN_SIZE || pos[0] != '\0' ||
+	    knot_wire_read_u16(pos + 1) != KNOT_RRTYPE_OPT ||
+	    knot_wire_read_u16(pos + 9) != end - pos - KNOT_EDNS_MIN_SIZE) {
+		return false;
+	}
+
+	uint32_t ttl = knot_wire_read_u32(pos + 5);
+	if ((ttl >> 24) != 0 || ((ttl >> 16) & 0xff) != KNOT_EDNS_VERSION) {
+		return false;
+	}
+	*do_bit = (ttl & KNOT_EDNS_DO_MASK);
+
+	/* Options affecting the answer need the full processing. */
+	bool ecs = conf()->cache.srv_ecs;
+	for (pos += KNOT_EDNS_MIN_SIZE; pos < end; ) {
+		if (end - pos < KNOT_EDNS_OPTION_HDRLEN) {
+			return false;
+		}
+		uint16_t code = knot_wire_read_u16(pos);
+		uint16_t opt_len = knot_wire_read_u16(pos + sizeof(uint16_t));
+		pos += KNOT_EDNS_OPTION_HDRLEN;
+		if (end - pos < opt_len || code == KNOT_EDNS_OPTION_NSID ||
+		    (ecs && code == KNOT_EDNS_OPTION_CLIENT_SUBNET)) {
+			return false;
+		}
+		pos += opt_len;
+	}
+
+	return true;
+}
+
+size_t udp_refuse(knot_zonedb_t *zonedb, const uint8_t *wire, size_t len,
+                  const struct sockaddr_storage *remote, uint8_t *out, size_t out_max)
+{
+	assert(wire && remote && out);
+
+	if (zonedb == NULL || len < KNOT_WIRE_HEADER_SIZE + KNOT_WIRE_QUESTION_MIN_SIZE) {
+		return 0;
+	}
+
+	/* Query modules might answer or account the query. */
+	conf_t *pconf = conf();
+	if (pconf->query_plan != NULL) {
+		return 0;
+	}
+
+	/* Plain query with a single question and an optional OPT record. */
+	uint16_t arcount = knot_wire_get_arcount(wire);
+	if (knot_wire_get_qr(wire) || knot_wire_get_tc(wire) ||
+	    knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1 || knot_wire_get_ancount(wire) != 0 ||
+	    knot_wire_get_nscount(wire) != 0 || arcount > 1) {
+		return 0;
+	}
+
+	const uint8_t *pos = wire + KNOT_WIRE_HEADER_SIZE;
+	const uint8_t *end = wire + len;
+	int qname_size = knot_dname_wire_check(pos, end, NULL);
+	if (qname_size <= 0 || (size_t)(end - pos) < qname_size + 2 * sizeof(uint16_t)) {
+		return 0;
+	}
+
+	uint16_t qtype = knot_wire_read_u16(pos + qname_size);
+	uint16_t qclass = knot_wire_read_u16(pos + qname_size + sizeof(uint16_t));
+	if (qclass != KNOT_CLASS_IN || knot_rrtype_is_metatype(qtype)) {
+		return 0;
+	}
+	const uint8_t *opt = pos + qname_size + 2 * sizeof(uint16_t);
+
+	uint16_t max_payload;
+	switch (remote->ss_family) {
+	case AF_INET:
+		max_payload = pconf->cache.srv_udp_max_payload_ipv4;
+		break;
+	case AF_INET6:
+		max_payload = pconf->cache.srv_udp_max_payload_ipv6;
+		break;
+	default:
+		return 0;
+	}
+
+	bool do_bit = false;
+	if (arcount == 1) {
+		if (!check_opt(opt, end, &do_bit)) {
+			return 0;
+		}
+	} else if (opt != end) {
+		return 0;
+	}
+
+	/* Any zone at or above the QNAME (also covers the DS parent lookup). */
+	knot_dname_storage_t qname;
+	knot_dname_copy_lower(qname, pos);
+	if (knot_zonedb_find_suffix(zonedb, qname) != NULL) {
+		return 0;
+	}
+
+	size_t base_size = opt - wire;
+	size_t ans_size = base_size + ((arcount == 1) ? OPT_SIZE : 0);
+	if (ans_size > out_max) {
+		return 0;
+	}
+
+	/* Header and question as in knot_pkt_init_response() and process_query_err(). */
+	memcpy(out, wire, base_size);
+	knot_wire_set_qr(out);
+	knot_wire_clear_tc(out);
+	knot_wire_clear_ad(out);
+	knot_wire_clear_ra(out);
+	knot_wire_clear_aa(out);
+	knot_wire_clear_z(out);
+	knot_wire_clear_cd(out);
+	knot_wire_set_rcode(out, KNOT_RCODE_REFUSED);
+	knot_wire_set_ancount(out, 0);
+	knot_wire_set_nscount(out, 0);
+	knot_wire_set_arcount(out, arcount);
+
+	if (arcount == 1) {
+		uint8_t *rr = out + base_size;
+		rr[0] = '\0';
+		knot_wire_write_u16(rr + 1, KNOT_RRTYPE_OPT);
+		knot_wire_write_u16(rr + 3, max_payload);
+		knot_wire_write_u32(rr + 5, ((uint32_t)KNOT_EDNS_VERSION << 16) |
+		                            (do_bit ? KNOT_EDNS_DO_MASK : 0));
+		knot_wire_write_u16(rr + 9, KNOT_EDNS_OPTION_HDRLEN + sizeof(uint16_t));
+		knot_wire_write_u16(rr + 11, KNOT_EDNS_OPTION_EDE);
+		knot_wire_write_u16(rr + 13, sizeof(uint16_t));
+		knot_wire_write_u16(rr + 15, KNOT_EDNS_EDE_NOTAUTH);
+	}
+
+	return ans_size;
+}
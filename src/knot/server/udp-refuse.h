@@ -0,0 +1,50 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Early refusal of UDP queries to the zones not served.
+ *
+ * Plain queries (single IN question, no TSIG, no query modules, and an optional
+ * OPT without NSID or handled ECS) whose QNAME falls into no configured zone
+ * are answered with REFUSED directly from the query wire, without the packet
+ * parsing and the query processing layer. The answer is identical to the one
+ * of the full processing, including the NOTAUTH extended error if EDNS is used.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "knot/zone/zonedb.h"
+
+/*!
+ * \brief Writes a REFUSED answer if the query is eligible and no zone matches.
+ *
+ * \note Must be called within an RCU read-side critical section.
+ *
+ * \param zonedb   Zone database.
+ * \param wire     Query wire.
+ * \param len      Query size.
+ * \param remote   Query source address.
+ * \param out      Output buffer.
+ * \param out_max  Size of the output buffer.
+ *
+ * \return Size of the written answer, 0 if the query has to be fully processed.
+ */
+size_t udp_refuse(knot_zonedb_t *zonedb, const uint8_t *wire, size_t len,
+                  const struct sockaddr_storage *remote, uint8_t *out, size_t out_max);
@@ -16,13 +16,18 @@
 
 #ifdef ENABLE_XDP
 
+#include <arpa/inet.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <urcu.h>
 
 #include "knot/server/xdp-handler.h"
 #include "knot/common/log.h"
+#include "knot/common/usdt.h"
+#include "knot/nameserver/process_query.h"
 #include "knot/server/server.h"
+#include "knot/server/udp-cache.h"
 #include "contrib/sockaddr.h"
 #include "contrib/ucw/mempool.h"
 #include "libknot/error.h"
@@ -30,18 +35,24 @@
 
 typedef struct xdp_handle_ctx {
 	knot_xdp_socket_t *sock;
-	knot_xdp_msg_t msg_recv[XDP_BATCHLEN];
-	knot_xdp_msg_t msg_send_udp[XDP_BATCHLEN];
+	knot_xdp_msg_t *msg_recv;
+	knot_xdp_msg_t *msg_send_udp;
 	knot_tcp_relay_dynarray_t tcp_relays;
 	uint32_t msg_recv_count;
 	uint32_t msg_udp_count;
+	uint32_t batch;     // Current receive batch size.
+	uint32_t batch_max; // Size of the message arrays.
 	knot_tcp_table_t *tcp_table;
+	knot_pkt_t query; // Reused query packet.
+	knot_pkt_t ans;   // Reused answer packet.
+	udp_cache_t *cache; // Answer cache (optional).
 
 	bool tcp;
 	size_t tcp_max_conns;
 	size_t tcp_max_inbufs;
 	uint32_t tcp_idle_close; // In microseconds.
 	uint32_t tcp_idle_reset; // In microseconds.
+	uint32_t tcp_resend;     // In microseconds.
 } xdp_handle_ctx_t;
 
 static bool udp_state_active(int state)
@@ -68,12 +79,21 @@ void xdp_handle_reconfigure(xdp_handle_ctx_t *ctx)
 	ctx->tcp_max_inbufs = pconf->cache.xdp_tcp_inbuf_max_size / pconf->cache.srv_xdp_threads;
 	ctx->tcp_idle_close = pconf->cache.xdp_tcp_idle_close * 1000000;
 	ctx->tcp_idle_reset = pconf->cache.xdp_tcp_idle_reset * 1000000;
+	ctx->tcp_resend     = pconf->cache.xdp_tcp_resend * 1000;
 	rcu_read_unlock();
+
+	if (ctx->tcp_table != NULL && ctx->tcp_max_conns > 0 &&
+	    ctx->tcp_table->size != ctx->tcp_max_conns) {
+		(void)knot_tcp_table_resize(ctx->tcp_table, ctx->tcp_max_conns);
+	}
 }
 
 void xdp_handle_free(xdp_handle_ctx_t *ctx)
 {
 	knot_tcp_table_free(ctx->tcp_table);
+	udp_cache_free(ctx->cache);
+	free(ctx->msg_recv);
+	free(ctx->msg_send_udp);
 	free(ctx);
 }
 
@@ -85,6 +105,15 @@ xdp_handle_ctx_t *xdp_handle_init(knot_xdp_socket_t *xdp_sock)
 	}
 	ctx->sock = xdp_sock;
 
+	ctx->batch_max = conf()->cache.xdp_batch_size;
+	ctx->batch = MIN(XDP_BATCHLEN, ctx->batch_max);
+	ctx->msg_recv = calloc(ctx->batch_max, sizeof(*ctx->msg_recv));
+	ctx->msg_send_udp = calloc(ctx->batch_max, sizeof(*ctx->msg_send_udp));
+	if (ctx->msg_recv == NULL || ctx->msg_send_udp == NULL) {
+		xdp_handle_free(ctx);
+		return NULL;
+	}
+
 	xdp_handle_reconfigure(ctx);
 
 	if (ctx->tcp) {
@@ -96,18 +125,38 @@ xdp_handle_ctx_t *xdp_handle_init(knot_xdp_socket_t *xdp_sock)
 		}
 	}
 
+	size_t cache_size = conf()->cache.xdp_answer_cache;
+	if (cache_size > 0) {
+		ctx->cache = udp_cache_new(cache_size);
+		if (ctx->cache == NULL) {
+			log_warning("XDP, failed to create answer cache");
+		}
+	}
+
 	return ctx;
 }
 
 int xdp_handle_recv(xdp_handle_ctx_t *ctx)
 {
-	int ret = knot_xdp_recv(ctx->sock, ctx->msg_recv, XDP_BATCHLEN,
+	int ret = knot_xdp_recv(ctx->sock, ctx->msg_recv, ctx->batch,
 	                        &ctx->msg_recv_count, NULL);
-	return ret == KNOT_EOK ? ctx->msg_recv_count : ret;
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Double the batch if filled completely, halve it if mostly empty.
+	if (ctx->msg_recv_count >= ctx->batch) {
+		ctx->batch = MIN(2 * ctx->batch, ctx->batch_max);
+	} else if (ctx->msg_recv_count < ctx->batch / 4) {
+		ctx->batch = MAX(ctx->batch / 2, MIN(XDP_BATCHLEN, ctx->batch_max));
+	}
+
+	return ctx->msg_recv_count;
 }
 
 static void handle_init(knotd_qdata_params_t *params, knot_layer_t *layer,
-                        const knot_xdp_msg_t *msg, const struct iovec *payload)
+                        knot_pkt_t *query, const knot_xdp_msg_t *msg,
+                        const struct iovec *payload)
 {
 	params->remote = (struct sockaddr_storage *)&msg->ip_from;
 	params->xdp_msg = msg;
@@ -119,11 +168,13 @@ static void handle_init(knotd_qdata_params_t *params, knot_layer_t *layer,
 
 	knot_layer_begin(layer, params);
 
-	knot_pkt_t *query = knot_pkt_new(payload->iov_base, payload->iov_len, layer->mm);
+	(void)knot_pkt_init(query, payload->iov_base, payload->iov_len, layer->mm);
 	int ret = knot_pkt_parse(query, 0);
 	if (ret != KNOT_EOK && query->parsed > 0) { // parsing failed (e.g. 2x OPT)
 		query->parsed--; // artificially decreasing "parsed" leads to FORMERR
 	}
+	KNOT_PROBE(query_recv, (msg->flags & KNOT_XDP_MSG_TCP) ? "xdp-tcp" : "xdp-udp",
+	           knot_pkt_qname(query), knot_pkt_qtype(query), query->size);
 	knot_layer_consume(layer, query);
 }
 
@@ -131,10 +182,38 @@ static void handle_finish(knot_layer_t *layer)
 {
 	knot_layer_finish(layer);
 
-	// Flush per-query memory (including query and answer packets).
+	// Flush per-query memory (packet data).
 	mp_flush(layer->mm->ctx);
 }
 
+static void push_answer(xdp_handle_ctx_t *ctx, const udp_cache_key_t *key,
+                        const uint8_t *wire, size_t len)
+{
+	// The filter answers only IPv4 queries and only the short answers.
+	size_t question = KNOT_WIRE_HEADER_SIZE + key->qname_size + 2 * sizeof(uint16_t);
+	if ((key->flags & UDP_CACHE_KEY_IPV6) || key->qname_size > KNOT_XDP_ANSWER_QNAME_MAX ||
+	    len > KNOT_XDP_ANSWER_SIZE_MAX || len < question ||
+	    len - question > KNOT_XDP_ANSWER_DATA_MAX) {
+		return;
+	}
+
+	struct knot_xdp_answer_key akey = {
+		.generation = (uint32_t)key->generation,
+		.qtype = htons(key->qtype),
+		.flags = ((key->flags & UDP_CACHE_KEY_EDNS) ? KNOT_XDP_ANSWER_EDNS : 0) |
+		         ((key->flags & UDP_CACHE_KEY_DO) ? KNOT_XDP_ANSWER_DO : 0),
+		.qname_len = key->qname_size,
+	};
+	memcpy(akey.qname, key->qname, key->qname_size);
+
+	struct knot_xdp_answer answer = { .len = len - question };
+	memcpy(answer.flags, wire + 2, sizeof(answer.flags));
+	memcpy(answer.counts, wire + 6, sizeof(answer.counts));
+	memcpy(answer.data, wire + question, answer.len);
+
+	(void)knot_xdp_answer_set(ctx->sock, &akey, &answer);
+}
+
 static void handle_udp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
                        knotd_qdata_params_t *params)
 {
@@ -157,12 +236,40 @@ static void handle_udp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 		}
 		ctx->msg_udp_count++;
 
+		// Try to answer from the cache.
+		udp_cache_key_t key;
+		bool cacheable = false;
+		if (ctx->cache != NULL) {
+			rcu_read_lock();
+			cacheable = udp_cache_key(ctx->cache, &key, msg_recv->payload.iov_base,
+			                          msg_recv->payload.iov_len,
+			                          (struct sockaddr_storage *)&msg_recv->ip_from);
+			if (cacheable) {
+				size_t len = udp_cache_answer(ctx->cache, &key,
+				                              msg_recv->payload.iov_base,
+				                              msg_send->payload.iov_base,
+				                              msg_send->payload.iov_len);
+				if (len > 0) {
+					rcu_read_unlock();
+					msg_send->payload.iov_len = len;
+					// Answers asked for repeatedly are handed over to the filter.
+					if (udp_cache_promote(ctx->cache, &key)) {
+						push_answer(ctx, &key, msg_send->payload.iov_base, len);
+					}
+					continue;
+				}
+			} else {
+				rcu_read_unlock();
+			}
+		}
+
 		// Consume the query.
-		handle_init(params, layer, msg_recv, &msg_recv->payload);
+		handle_init(params, layer, &ctx->query, msg_recv, &msg_recv->payload);
 
 		// Process the reply.
-		knot_pkt_t *ans = knot_pkt_new(msg_send->payload.iov_base,
-		                               msg_send->payload.iov_len, layer->mm);
+		knot_pkt_t *ans = &ctx->ans;
+		(void)knot_pkt_init(ans, msg_send->payload.iov_base,
+		                    msg_send->payload.iov_len, layer->mm);
 		while (udp_state_active(layer->state)) {
 			knot_layer_produce(layer, ans);
 		}
@@ -172,6 +279,17 @@ static void handle_udp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 			// If not success, don't send any reply.
 			msg_send->payload.iov_len = 0;
 		}
+		KNOT_PROBE(query_send, "xdp-udp", knot_pkt_qname(&ctx->query),
+		           knot_wire_get_rcode(ans->wire), msg_send->payload.iov_len);
+
+		// Store the answer while the zone is still protected.
+		if (cacheable) {
+			if (msg_send->payload.iov_len > 0) {
+				knotd_qdata_t *qdata = layer->data;
+				udp_cache_store(ctx->cache, &key, ans, qdata->extra->zone);
+			}
+			rcu_read_unlock();
+		}
 
 		// Reset the processing.
 		handle_finish(layer);
@@ -203,10 +321,11 @@ static void handle_tcp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 		}
 
 		// Consume the query.
-		handle_init(params, layer, rl->msg, &rl->data);
+		handle_init(params, layer, &ctx->query, rl->msg, &rl->data);
 
 		// Process the reply.
-		knot_pkt_t *ans = knot_pkt_new(ans_buf, sizeof(ans_buf), layer->mm);
+		knot_pkt_t *ans = &ctx->ans;
+		(void)knot_pkt_init(ans, ans_buf, sizeof(ans_buf), layer->mm);
 		while (tcp_active_state(layer->state)) {
 			knot_layer_produce(layer, ans);
 			if (!tcp_send_state(layer->state)) {
@@ -215,6 +334,8 @@ static void handle_tcp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 
 			ret = knot_tcp_relay_answer(&ctx->tcp_relays, rl,
 			                            ans->wire, ans->size);
+			// The relays may have been reallocated.
+			rl = knot_tcp_relay_dynarray_arr(&ctx->tcp_relays) + rli;
 			if (ret != KNOT_EOK) {
 				char addr[SOCKADDR_STRLEN];
 				sockaddr_tostr(addr, sizeof(addr), params->remote);
@@ -223,6 +344,8 @@ static void handle_tcp(xdp_handle_ctx_t *ctx, knot_layer_t *layer,
 				layer->state = KNOT_STATE_FAIL;
 			}
 		}
+		KNOT_PROBE(query_send, "xdp-tcp", knot_pkt_qname(&ctx->query),
+		           knot_wire_get_rcode(ans->wire), ans->size);
 
 		handle_finish(layer);
 	}
@@ -297,6 +420,14 @@ void xdp_handle_sweep(xdp_handle_ctx_t *ctx)
 		log_notice("TCP, connection timeout, %u closed, %u reset",
 		           total_close, total_reset);
 	}
+
+	uint32_t prev_resend, total_resend = 0;
+	do {
+		prev_resend = total_resend;
+		ret = knot_tcp_resend(ctx->tcp_table, ctx->sock, 20, ctx->tcp_resend,
+		                      &total_resend);
+	} while (ret == KNOT_EOK && prev_resend < total_resend &&
+	         total_resend - prev_resend == 20);
 }
 
 #endif // ENABLE_XDP
@@ -15,8 +15,196 @@
  */
 
 #include "knot/updates/acl.h"
+#include "contrib/ipset.h"
+#include "contrib/qp-trie/trie.h"
 #include "contrib/wire_ctx.h"
 
+typedef struct {
+	knot_dname_t *name;
+	dnssec_tsig_algorithm_t alg;
+} acl_key_t;
+
+typedef struct {
+	bool remote;       // References remotes, not compiled.
+	bool deny;
+	ipset_t *addrs;    // NULL if any address.
+	acl_key_t *keys;
+	size_t key_count;
+	unsigned actions;  // Bitmap of (1 << acl_action_t).
+} acl_rule_t;
+
+struct acl_table {
+	trie_t *rules;     // ACL identifier -> acl_rule_t.
+};
+
+static void rule_free(acl_rule_t *rule)
+{
+	if (rule == NULL) {
+		return;
+	}
+
+	ipset_free(rule->addrs);
+	for (size_t i = 0; i < rule->key_count; i++) {
+		knot_dname_free(rule->keys[i].name, NULL);
+	}
+	free(rule->keys);
+	free(rule);
+}
+
+static int rule_compile(conf_t *conf, conf_val_t *id, acl_rule_t *rule)
+{
+	conf_val_t val = conf_id_get(conf, C_ACL, C_RMT, id);
+	rule->remote = (val.code == KNOT_EOK);
+	if (rule->remote) {
+		return KNOT_EOK;
+	}
+
+	val = conf_id_get(conf, C_ACL, C_DENY, id);
+	rule->deny = conf_bool(&val);
+
+	val = conf_id_get(conf, C_ACL, C_ADDR, id);
+	if (val.code == KNOT_EOK) {
+		rule->addrs = ipset_new();
+		if (rule->addrs == NULL) {
+			return KNOT_ENOMEM;
+		}
+		while (val.code == KNOT_EOK) {
+			int prefix;
+			struct sockaddr_storage max;
+			struct sockaddr_storage min = conf_addr_range(&val, &max, &prefix);
+			int ret = (max.ss_family == AF_UNSPEC) ?
+			          ipset_add_prefix(rule->addrs, &min, prefix) :
+			          ipset_add_range(rule->addrs, &min, &max);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			conf_val_next(&val);
+		}
+		ipset_finalize(rule->addrs);
+	}
+
+	val = conf_id_get(conf, C_ACL, C_KEY, id);
+	size_t count = conf_val_count(&val);
+	if (count > 0) {
+		rule->keys = calloc(count, sizeof(*rule->keys));
+		if (rule->keys == NULL) {
+			return KNOT_ENOMEM;
+		}
+		while (val.code == KNOT_EOK) {
+			acl_key_t *key = &rule->keys[rule->key_count++];
+			key->name = knot_dname_copy(conf_dname(&val), NULL);
+			if (key->name == NULL) {
+				return KNOT_ENOMEM;
+			}
+			conf_val_t alg_val = conf_id_get(conf, C_KEY, C_ALG, &val);
+			key->alg = conf_opt(&alg_val);
+			conf_val_next(&val);
+		}
+	}
+
+	val = conf_id_get(conf, C_ACL, C_ACTION, id);
+	while (val.code == KNOT_EOK) {
+		rule->actions |= 1 << conf_opt(&val);
+		conf_val_next(&val);
+	}
+
+	return KNOT_EOK;
+}
+
+acl_table_t *acl_table_new(conf_t *conf)
+{
+	if (conf == NULL) {
+		return NULL;
+	}
+
+	acl_table_t *table = calloc(1, sizeof(*table));
+	if (table == NULL) {
+		return NULL;
+	}
+	table->rules = trie_create(NULL);
+	if (table->rules == NULL) {
+		free(table);
+		return NULL;
+	}
+
+	for (conf_iter_t iter = conf_iter(conf, C_ACL); iter.code == KNOT_EOK;
+	     conf_iter_next(conf, &iter)) {
+		conf_val_t id = conf_iter_id(conf, &iter);
+		conf_val(&id);
+
+		acl_rule_t *rule = calloc(1, sizeof(*rule));
+		trie_val_t *val = trie_get_ins(table->rules, id.data, id.len);
+		if (rule == NULL || val == NULL ||
+		    rule_compile(conf, &id, rule) != KNOT_EOK) {
+			rule_free(rule);
+			conf_iter_finish(conf, &iter);
+			acl_table_free(table);
+			return NULL;
+		}
+		*val = rule;
+	}
+
+	return table;
+}
+
+static int free_rule_cb(trie_val_t *val, void *ctx)
+{
+	rule_free(*val);
+	return KNOT_EOK;
+}
+
+void acl_table_free(acl_table_t *table)
+{
+	if (table == NULL) {
+		return;
+	}
+
+	trie_apply(table->rules, free_rule_cb, NULL);
+	trie_free(table->rules);
+	free(table);
+}
+
+static const acl_rule_t *acl_table_get(acl_table_t *table, const uint8_t *id,
+                                       size_t id_len)
+{
+	if (table == NULL) {
+		return NULL;
+	}
+
+	trie_val_t *val = trie_get_try(table->rules, id, id_len);
+
+	return (val != NULL) ? *val : NULL;
+}
+
+/*!
+ * \brief Checks the precompiled rule address and key, returns the matching key.
+ */
+static bool rule_addr_key(const acl_rule_t *rule, const struct sockaddr_storage *addr,
+                          const knot_tsig_key_t *tsig, const acl_key_t **key)
+{
+	if (rule->addrs != NULL && !ipset_match(rule->addrs, addr)) {
+		return false;
+	}
+
+	*key = NULL;
+	if (rule->key_count == 0) {
+		// Empty list without key provided or denied.
+		return tsig->name == NULL || rule->deny;
+	}
+	if (tsig->name == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < rule->key_count; i++) {
+		if (knot_dname_is_equal(rule->keys[i].name, tsig->name) &&
+		    rule->keys[i].alg == tsig->algorithm) {
+			*key = &rule->keys[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static bool match_type(uint16_t type, conf_val_t *types)
 {
 	if (types == NULL) {
@@ -85,17 +273,18 @@ static bool match_names(const knot_dname_t *rr_owner, const knot_dname_t *zone_n
 	return false;
 }
 
-static bool update_match(conf_t *conf, conf_val_t *acl, knot_dname_t *key_name,
-                         const knot_dname_t *zone_name, knot_pkt_t *query)
+static bool update_match(conf_t *conf, const uint8_t *id, size_t id_len,
+                         knot_dname_t *key_name, const knot_dname_t *zone_name,
+                         knot_pkt_t *query)
 {
 	if (query == NULL) {
 		return true;
 	}
 
-	conf_val_t val_types = conf_id_get(conf, C_ACL, C_UPDATE_TYPE, acl);
+	conf_val_t val_types = conf_rawid_get(conf, C_ACL, C_UPDATE_TYPE, id, id_len);
 	conf_val_t *types = (conf_val_count(&val_types) > 0) ? &val_types : NULL;
 
-	conf_val_t val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER, acl);
+	conf_val_t val = conf_rawid_get(conf, C_ACL, C_UPDATE_OWNER, id, id_len);
 	acl_update_owner_t owner = conf_opt(&val);
 
 	/* Return if no specific requirements configured. */
@@ -105,14 +294,14 @@ static bool update_match(conf_t *conf, conf_val_t *acl, knot_dname_t *key_name,
 
 	acl_update_owner_match_t match = ACL_UPDATE_MATCH_SUBEQ;
 	if (owner != ACL_UPDATE_OWNER_NONE) {
-		val = conf_id_get(conf, C_ACL, C_UPDATE_OWNER_MATCH, acl);
+		val = conf_rawid_get(conf, C_ACL, C_UPDATE_OWNER_MATCH, id, id_len);
 		match = conf_opt(&val);
 	}
 
 	conf_val_t *names = NULL;
 	conf_val_t val_names;
 	if (owner == ACL_UPDATE_OWNER_NAME) {
-		val_names = conf_id_get(conf, C_ACL, C_UPDATE_OWNER_NAME, acl);
+		val_names = conf_rawid_get(conf, C_ACL, C_UPDATE_OWNER_NAME, id, id_len);
 		if (conf_val_count(&val_names) > 0) {
 			names = &val_names;
 		}
@@ -218,22 +407,37 @@ static bool check_addr_key(conf_t *conf, conf_val_t *addr_val, conf_val_t *key_v
 	return true;
 }
 
-bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
-                 const struct sockaddr_storage *addr, knot_tsig_key_t *tsig,
-                 const knot_dname_t *zone_name, knot_pkt_t *query)
-{
-	if (acl == NULL || addr == NULL || tsig == NULL) {
-		return false;
-	}
+typedef enum {
+	ACL_NEXT,
+	ACL_ALLOW,
+	ACL_DENY,
+} acl_verdict_t;
 
-	while (acl->code == KNOT_EOK) {
-		conf_val_t rmt_val = conf_id_get(conf, C_ACL, C_RMT, acl);
+static acl_verdict_t acl_check(conf_t *conf, const uint8_t *id, size_t id_len,
+                               acl_action_t action, const struct sockaddr_storage *addr,
+                               knot_tsig_key_t *tsig, const knot_dname_t *zone_name,
+                               knot_pkt_t *query)
+{
+	const acl_rule_t *rule = acl_table_get(conf->cache.acl_table, id, id_len);
+	const acl_key_t *rule_key = NULL;
+	conf_val_t key_val = { NULL };
+	bool deny;
+	unsigned actions = 0;
+
+	if (rule != NULL && !rule->remote) {
+		deny = rule->deny;
+		if (!rule_addr_key(rule, addr, tsig, &rule_key)) {
+			return ACL_NEXT;
+		}
+		actions = rule->actions;
+	} else {
+		conf_val_t rmt_val = conf_rawid_get(conf, C_ACL, C_RMT, id, id_len);
 		bool remote = (rmt_val.code == KNOT_EOK);
-		conf_val_t deny_val = conf_id_get(conf, C_ACL, C_DENY, acl);
-		bool deny = conf_bool(&deny_val);
+		conf_val_t deny_val = conf_rawid_get(conf, C_ACL, C_DENY, id, id_len);
+		deny = conf_bool(&deny_val);
 
 		/* Check if a remote matches given address and key. */
-		conf_val_t addr_val, key_val;
+		conf_val_t addr_val;
 		conf_mix_iter_t iter;
 		conf_mix_iter_init(conf, &rmt_val, &iter);
 		while (iter.id->code == KNOT_EOK) {
@@ -245,58 +449,101 @@ bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
 			conf_mix_iter_next(&iter);
 		}
 		if (iter.id->code == KNOT_EOF) {
-			goto next_acl;
+			return ACL_NEXT;
 		}
 		/* Or check if acl address/key matches given address and key. */
 		if (!remote) {
-			addr_val = conf_id_get(conf, C_ACL, C_ADDR, acl);
-			key_val = conf_id_get(conf, C_ACL, C_KEY, acl);
+			addr_val = conf_rawid_get(conf, C_ACL, C_ADDR, id, id_len);
+			key_val = conf_rawid_get(conf, C_ACL, C_KEY, id, id_len);
 			if (!check_addr_key(conf, &addr_val, &key_val, remote, addr, tsig, deny)) {
-				goto next_acl;
+				return ACL_NEXT;
 			}
 		}
 
-		/* Check if the action is allowed. */
-		if (action != ACL_ACTION_NONE) {
-			conf_val_t val = conf_id_get(conf, C_ACL, C_ACTION, acl);
-			while (val.code == KNOT_EOK) {
-				if (conf_opt(&val) != action) {
-					conf_val_next(&val);
-					continue;
-				}
+		conf_val_t val = conf_rawid_get(conf, C_ACL, C_ACTION, id, id_len);
+		while (val.code == KNOT_EOK) {
+			actions |= 1 << conf_opt(&val);
+			conf_val_next(&val);
+		}
+	}
 
-				break;
-			}
-			switch (val.code) {
-			case KNOT_EOK: /* Check for action match. */
-				break;
-			case KNOT_ENOENT: /* Empty action list allowed with deny only. */
-				return false;
-			default: /* No match. */
-				goto next_acl;
-			}
+	/* Check if the action is allowed. */
+	if (action != ACL_ACTION_NONE) {
+		if (actions == 0) {
+			/* Empty action list allowed with deny only. */
+			return ACL_DENY;
+		} else if (!(actions & (1 << action))) {
+			return ACL_NEXT;
 		}
+	}
+
+	/* If the action is update, check for update rule match. */
+	if (action == ACL_ACTION_UPDATE &&
+	    !update_match(conf, id, id_len, tsig->name, zone_name, query)) {
+		return ACL_NEXT;
+	}
+
+	/* Check if denied. */
+	if (deny) {
+		return ACL_DENY;
+	}
+
+	/* Fill the output with tsig secret if provided. */
+	if (tsig->name != NULL) {
+		conf_val_t val = (rule_key != NULL) ?
+		        conf_rawid_get(conf, C_KEY, C_SECRET, rule_key->name,
+		                       knot_dname_size(rule_key->name)) :
+		        conf_id_get(conf, C_KEY, C_SECRET, &key_val);
+		tsig->secret.data = (uint8_t *)conf_bin(&val, &tsig->secret.size);
+	}
+
+	return ACL_ALLOW;
+}
+
+bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
+                 const struct sockaddr_storage *addr, knot_tsig_key_t *tsig,
+                 const knot_dname_t *zone_name, knot_pkt_t *query)
+{
+	if (acl == NULL || addr == NULL || tsig == NULL) {
+		return false;
+	}
 
-		/* If the action is update, check for update rule match. */
-		if (action == ACL_ACTION_UPDATE &&
-		    !update_match(conf, acl, tsig->name, zone_name, query)) {
-			goto next_acl;
+	while (acl->code == KNOT_EOK) {
+		conf_val(acl);
+		acl_verdict_t ret = acl_check(conf, acl->data, acl->len, action,
+		                              addr, tsig, zone_name, query);
+		if (ret != ACL_NEXT) {
+			return ret == ACL_ALLOW;
 		}
+		conf_val_next(acl);
+	}
+
+	return false;
+}
 
-		/* Check if denied. */
-		if (deny) {
+bool acl_allowed_ids(conf_t *conf, const uint8_t *ids, size_t ids_len,
+                     acl_action_t action, const struct sockaddr_storage *addr,
+                     knot_tsig_key_t *tsig, const knot_dname_t *zone_name,
+                     knot_pkt_t *query)
+{
+	if (addr == NULL || tsig == NULL) {
+		return false;
+	}
+
+	wire_ctx_t ctx = wire_ctx_init_const(ids, ids_len);
+	while (wire_ctx_available(&ctx) > 0) {
+		uint16_t len = wire_ctx_read_u16(&ctx);
+		const uint8_t *id = ctx.position;
+		wire_ctx_skip(&ctx, len);
+		if (ctx.error != KNOT_EOK) {
 			return false;
 		}
 
-		/* Fill the output with tsig secret if provided. */
-		if (tsig->name != NULL) {
-			conf_val_t val = conf_id_get(conf, C_KEY, C_SECRET, &key_val);
-			tsig->secret.data = (uint8_t *)conf_bin(&val, &tsig->secret.size);
+		acl_verdict_t ret = acl_check(conf, id, len, action, addr, tsig,
+		                              zone_name, query);
+		if (ret != ACL_NEXT) {
+			return ret == ACL_ALLOW;
 		}
-
-		return true;
-next_acl:
-		conf_val_next(acl);
 	}
 
 	return false;
@@ -45,6 +45,27 @@ typedef enum {
 	ACL_UPDATE_MATCH_SUB   = 2,
 } acl_update_owner_match_t;
 
+/*! \brief ACL rules precompiled from the configuration. */
+typedef struct acl_table acl_table_t;
+
+/*!
+ * \brief Compiles all the configured ACL rules.
+ *
+ * The address lists are merged into range sets and the key names, key
+ * algorithms, and actions are extracted, so the checks don't need to read
+ * the configuration DB. Rules referencing remotes aren't compiled.
+ *
+ * \param conf  Configuration.
+ *
+ * \return Precompiled rules or NULL if error.
+ */
+acl_table_t *acl_table_new(conf_t *conf);
+
+/*!
+ * \brief Frees the precompiled ACL rules.
+ */
+void acl_table_free(acl_table_t *table);
+
 /*!
  * \brief Checks if the address and/or tsig key matches given ACL list.
  *
@@ -63,3 +84,25 @@ typedef enum {
 bool acl_allowed(conf_t *conf, conf_val_t *acl, acl_action_t action,
                  const struct sockaddr_storage *addr, knot_tsig_key_t *tsig,
                  const knot_dname_t *zone_name, knot_pkt_t *query);
+
+/*!
+ * \brief Checks if the address and/or tsig key matches given ACL identifiers.
+ *
+ * Same as acl_allowed(), but the ACL list is a copy of the configuration
+ * multivalued identifier data (length-prefixed identifiers).
+ *
+ * \param conf       Configuration.
+ * \param ids        ACL identifiers.
+ * \param ids_len    Length of the ACL identifiers data.
+ * \param action     ACL action.
+ * \param addr       IP address.
+ * \param tsig       TSIG parameters.
+ * \param zone_name  Zone name.
+ * \param query      Update query.
+ *
+ * \retval True if authenticated.
+ */
+bool acl_allowed_ids(conf_t *conf, const uint8_t *ids, size_t ids_len,
+                     acl_action_t action, const struct sockaddr_storage *addr,
+                     knot_tsig_key_t *tsig, const knot_dname_t *zone_name,
+                     knot_pkt_t *query);
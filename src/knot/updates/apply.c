@@ -18,6 +18,8 @@
 
 #include "knot/common/log.h"
 #include "knot/updates/apply.h"
+#include "knot/zone/cold-rdata.h"
+#include "knot/zone/mapped-rdata.h"
 #include "libknot/libknot.h"
 #include "contrib/macros.h"
 #include "contrib/mempattern.h"
@@ -53,6 +55,7 @@ static int replace_rdataset_with_copy(zone_node_t *node, uint16_t type)
 
 	// Store new data into node RRS.
 	rrs->rdata = copy;
+	data->flags &= ~(RR_DATA_COLD | RR_DATA_MAPPED);
 
 	return KNOT_EOK;
 }
@@ -171,6 +174,10 @@ int apply_init_ctx(apply_ctx_t *ctx, zone_contents_t *contents, uint32_t flags)
 	}
 	ctx->adjust_ptrs->flags = contents->nodes->flags;
 
+	// Stale once the NSEC3 tree is changed, updated when adjusting.
+	ctx->nsec3_index = contents->nsec3_index;
+	contents->nsec3_index = NULL;
+
 	ctx->flags = flags;
 
 	return KNOT_EOK;
@@ -272,6 +279,349 @@ int apply_remove_rr(apply_ctx_t *ctx, const knot_rrset_t *rr)
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Returns position of the first RR of sorted 'what' missing in sorted
+ *        'rrs', or -1 if all are present.
+ */
+static int rdataset_missing(const knot_rdataset_t *rrs, const knot_rdataset_t *what)
+{
+	knot_rdata_t *rr = rrs->rdata, *cmp = what->rdata;
+	uint16_t pos = 0;
+	for (uint16_t i = 0; i < what->count; ++i) {
+		int diff = -1;
+		while (pos < rrs->count && (diff = knot_rdata_cmp(rr, cmp)) < 0) {
+			rr = knot_rdataset_next(rr);
+			pos++;
+		}
+		if (diff != 0) {
+			return i;
+		}
+		cmp = knot_rdataset_next(cmp);
+	}
+
+	return -1;
+}
+
+/*!
+ * \brief Returns position of the first RR of sorted 'add' present in sorted
+ *        'rrs' and not removed by sorted 'rem', or -1 if there is none.
+ */
+static int rdataset_existing(const knot_rdataset_t *rrs, const knot_rdataset_t *rem,
+                             const knot_rdataset_t *add)
+{
+	knot_rdata_t *rr = rrs->rdata, *del = rem->rdata, *cmp = add->rdata;
+	uint16_t pos = 0, del_pos = 0;
+	for (uint16_t i = 0; i < add->count; ++i) {
+		int diff = -1;
+		while (pos < rrs->count && (diff = knot_rdata_cmp(rr, cmp)) < 0) {
+			rr = knot_rdataset_next(rr);
+			pos++;
+		}
+		if (diff == 0) {
+			diff = -1;
+			while (del_pos < rem->count && (diff = knot_rdata_cmp(del, cmp)) < 0) {
+				del = knot_rdataset_next(del);
+				del_pos++;
+			}
+			if (diff != 0) {
+				return i;
+			}
+		}
+		cmp = knot_rdataset_next(cmp);
+	}
+
+	return -1;
+}
+
+/*!
+ * \brief Merges sorted RR sets in one pass, out = (rrs - rem) + add.
+ *
+ * \note The 'rem' must be a subset of 'rrs' and 'add' must not intersect
+ *       the remaining RRs.
+ */
+static int rdataset_merge_sorted(const knot_rdataset_t *rrs, const knot_rdataset_t *rem,
+                                 const knot_rdataset_t *add, knot_rdataset_t *out)
+{
+	size_t count = rrs->count - rem->count + add->count;
+	size_t size = rrs->size - rem->size + add->size;
+	if (count > UINT16_MAX || size > UINT32_MAX) {
+		return KNOT_ESPACE;
+	}
+
+	knot_rdataset_init(out);
+	if (count == 0) {
+		return KNOT_EOK;
+	}
+	out->rdata = malloc(size);
+	if (out->rdata == NULL) {
+		return KNOT_ENOMEM;
+	}
+	out->count = count;
+	out->size = size;
+
+	knot_rdata_t *rr = rrs->rdata, *del = rem->rdata, *ins = add->rdata;
+	uint16_t rr_left = rrs->count, del_left = rem->count, ins_left = add->count;
+	uint8_t *pos = (uint8_t *)out->rdata;
+	while (rr_left > 0 || ins_left > 0) {
+		if (rr_left > 0 && del_left > 0 && knot_rdata_cmp(rr, del) == 0) {
+			rr = knot_rdataset_next(rr);
+			rr_left--;
+			del = knot_rdataset_next(del);
+			del_left--;
+			continue;
+		}
+
+		knot_rdata_t **src = &ins;
+		uint16_t *left = &ins_left;
+		if (rr_left > 0 && (ins_left == 0 || knot_rdata_cmp(rr, ins) < 0)) {
+			src = &rr;
+			left = &rr_left;
+		}
+		size_t len = knot_rdata_size((*src)->len);
+		memcpy(pos, *src, len);
+		pos += len;
+		*src = knot_rdataset_next(*src);
+		(*left)--;
+	}
+	assert(pos == (uint8_t *)out->rdata + size);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Logs the TTL change of an existing RRSet. */
+static void log_ttl_change(apply_ctx_t *ctx, const knot_rrset_t *rr)
+{
+	knot_dname_txt_storage_t buff;
+	char *owner = knot_dname_to_str(buff, rr->owner, sizeof(buff));
+	if (owner == NULL) {
+		owner = "";
+	}
+	char type[16] = "";
+	knot_rrtype_to_string(rr->type, type, sizeof(type));
+	log_zone_notice(ctx->contents->apex->owner, "TTL mismatch, owner %s, "
+	                "type %s, TTL set to %u", owner, type, rr->ttl);
+}
+
+/*!
+ * \brief Removes and adds the RRs of one type of the node in one pass.
+ *
+ * \param ctx           Apply context.
+ * \param node          Zone node (may be NULL if only removing).
+ * \param nsec3rel      The node belongs to the NSEC3 tree.
+ * \param rem           RRs to be removed (may be NULL).
+ * \param add           RRs to be added (may be NULL).
+ * \param prepared      Indication that the node is already prepared for the change.
+ * \param nsec_changed  Set if NSEC or NSEC3 records were changed.
+ */
+static int apply_rdatasets(apply_ctx_t *ctx, zone_node_t *node, bool nsec3rel,
+                           const knot_rrset_t *rem, const knot_rrset_t *add,
+                           bool *prepared, bool *nsec_changed)
+{
+	const knot_rdataset_t empty = { 0 };
+	const bool strict = (ctx->flags & APPLY_STRICT);
+	const knot_rdataset_t *rrs = node_rdataset(node, knot_rrset_empty(rem) ?
+	                                                 add->type : rem->type);
+
+	if (!knot_rrset_empty(rem)) {
+		int pos = (rrs == NULL) ? 0 : rdataset_missing(rrs, &rem->rrs);
+		if (pos >= 0) {
+			can_log_rrset(rem, pos, ctx, true);
+			if (strict) {
+				return KNOT_ENORECORD;
+			}
+			rem = NULL;
+		}
+	}
+	if (!knot_rrset_empty(add) && rrs != NULL) {
+		int pos = rdataset_existing(rrs, knot_rrset_empty(rem) ? &empty : &rem->rrs,
+		                            &add->rrs);
+		if (pos >= 0) {
+			can_log_rrset(add, pos, ctx, false);
+			if (strict) {
+				return KNOT_EISRECORD;
+			}
+			add = NULL;
+		}
+	}
+	if (knot_rrset_empty(rem) && knot_rrset_empty(add)) {
+		return KNOT_EOK;
+	}
+
+	if (!*prepared) {
+		zone_tree_t *ptrs = nsec3rel ? ctx->nsec3_ptrs : ctx->node_ptrs;
+		int ret = zone_tree_insert_with_parents(ptrs, node, nsec3rel);
+		if (ret == KNOT_EOK) {
+			ret = binode_prepare_change(node, NULL);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		*prepared = true;
+	}
+
+	uint16_t type = knot_rrset_empty(rem) ? add->type : rem->type;
+	if (type == KNOT_RRTYPE_NSEC || type == KNOT_RRTYPE_NSEC3) {
+		*nsec_changed = true;
+	}
+
+	struct rr_data *data = NULL;
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		if (node->rrs[i].type == type) {
+			data = &node->rrs[i];
+			break;
+		}
+	}
+	if (data == NULL) {
+		// New RRSet, nothing to remove.
+		return node_add_rrset(node, add, NULL);
+	}
+
+	knot_rdataset_t merged;
+	int ret = rdataset_merge_sorted(&data->rrs, knot_rrset_empty(rem) ? &empty : &rem->rrs,
+	                                knot_rrset_empty(add) ? &empty : &add->rrs, &merged);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	node->flags &= ~(NODE_FLAGS_RRSIGS_VALID | NODE_FLAGS_WIRE_SIZES);
+
+	if (merged.count == 0) {
+		node_remove_rdataset(node, type);
+		return KNOT_EOK;
+	}
+
+	if (!binode_rdata_shared(node, type) && !cold_rdata_release(data) &&
+	    !mapped_rdata_release(data)) {
+		free(data->rrs.rdata);
+	}
+	data->flags = 0;
+	if (!knot_rrset_empty(add)) {
+		bool kept = (merged.count > add->rrs.count);
+		if (!kept) {
+			data->ttl = add->ttl;
+		} else if (type != KNOT_RRTYPE_RRSIG && data->ttl != add->ttl) {
+			log_ttl_change(ctx, add);
+			data->ttl = add->ttl;
+		}
+	}
+	data->rrs = merged;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Applies the removals and additions of one owner name. */
+static int apply_node(apply_ctx_t *ctx, bool nsec3rel, const zone_node_t *rem_node,
+                      const zone_node_t *add_node, bool *nsec_changed)
+{
+	zone_contents_t *contents = ctx->contents;
+	zone_tree_t *ptrs = nsec3rel ? ctx->nsec3_ptrs : ctx->node_ptrs;
+	zone_tree_t *tree = nsec3rel ? contents->nsec3_nodes : contents->nodes;
+
+	uint16_t rem_count = (rem_node == NULL) ? 0 : rem_node->rrset_count;
+	uint16_t add_count = (add_node == NULL) ? 0 : add_node->rrset_count;
+
+	// Get or create node with this owner, just once for all its changes.
+	zone_node_t *node = NULL;
+	if (add_count > 0) {
+		knot_rrset_t rr = node_rrset_at(add_node, 0);
+		tree = zone_contents_tree_for_rr(contents, &rr);
+		if (tree == NULL) {
+			return KNOT_ENOMEM;
+		}
+		int ret = zone_tree_add_node(tree, contents->apex, add_node->owner,
+		                             add_node_cb, ptrs, &node);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	} else if (rem_count > 0 && tree != NULL) {
+		node = zone_tree_get(tree, rem_node->owner);
+	}
+
+	// Both RRSets arrays are sorted by type.
+	bool prepared = false;
+	uint16_t i = 0, j = 0;
+	while (i < rem_count || j < add_count) {
+		knot_rrset_t rem = { 0 }, add = { 0 };
+		if (i < rem_count && (j == add_count ||
+		                      rem_node->rrs[i].type <= add_node->rrs[j].type)) {
+			rem = node_rrset_at(rem_node, i++);
+		}
+		if (j < add_count && (knot_rrset_empty(&rem) ||
+		                      add_node->rrs[j].type == rem.type)) {
+			add = node_rrset_at(add_node, j++);
+		}
+
+		int ret = apply_rdatasets(ctx, node, nsec3rel, &rem, &add,
+		                          &prepared, nsec_changed);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (prepared && node->rrset_count == 0 && node->children == 0 &&
+	    node != contents->apex) {
+		zone_tree_del_node(tree, node, false);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Walks both changeset trees in the canonical order at once. */
+static int apply_trees(apply_ctx_t *ctx, zone_tree_t *rem_tree, zone_tree_t *add_tree,
+                       bool nsec3rel, bool *nsec_changed)
+{
+	zone_tree_it_t rem_it = { 0 }, add_it = { 0 };
+	int ret = KNOT_EOK;
+	if (rem_tree != NULL) {
+		ret = zone_tree_it_begin(rem_tree, &rem_it);
+	}
+	if (ret == KNOT_EOK && add_tree != NULL) {
+		ret = zone_tree_it_begin(add_tree, &add_it);
+	}
+
+	while (ret == KNOT_EOK &&
+	       (!zone_tree_it_finished(&rem_it) || !zone_tree_it_finished(&add_it))) {
+		zone_node_t *rem = zone_tree_it_finished(&rem_it) ? NULL : zone_tree_it_val(&rem_it);
+		zone_node_t *add = zone_tree_it_finished(&add_it) ? NULL : zone_tree_it_val(&add_it);
+		int cmp = (rem == NULL) ? 1 : (add == NULL) ? -1 :
+		          knot_dname_cmp(rem->owner, add->owner);
+
+		ret = apply_node(ctx, nsec3rel, cmp <= 0 ? rem : NULL,
+		                 cmp >= 0 ? add : NULL, nsec_changed);
+		if (cmp <= 0) {
+			zone_tree_it_next(&rem_it);
+		}
+		if (cmp >= 0) {
+			zone_tree_it_next(&add_it);
+		}
+	}
+
+	zone_tree_it_free(&rem_it);
+	zone_tree_it_free(&add_it);
+
+	return ret;
+}
+
+int apply_changeset(apply_ctx_t *ctx, const changeset_t *ch, bool *nsec_changed)
+{
+	if (ctx == NULL || ch == NULL || nsec_changed == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	zone_contents_t *rem = ch->remove, *add = ch->add;
+	int ret = apply_trees(ctx, rem ? rem->nodes : NULL, add ? add->nodes : NULL,
+	                      false, nsec_changed);
+	if (ret == KNOT_EOK) {
+		ret = apply_trees(ctx, rem ? rem->nsec3_nodes : NULL,
+		                  add ? add->nsec3_nodes : NULL, true, nsec_changed);
+	}
+	if (ret == KNOT_EOK && ch->soa_to != NULL) {
+		ret = apply_replace_soa(ctx, ch->soa_to);
+	}
+
+	return ret;
+}
+
 int apply_replace_soa(apply_ctx_t *ctx, const knot_rrset_t *rr)
 {
 	zone_contents_t *contents = ctx->contents;
@@ -311,6 +661,8 @@ void apply_cleanup(apply_ctx_t *ctx)
 	zone_tree_free(&ctx->node_ptrs);
 	zone_tree_free(&ctx->nsec3_ptrs);
 	zone_tree_free(&ctx->adjust_ptrs);
+	nsec3_index_free(ctx->nsec3_index);
+	ctx->nsec3_index = NULL;
 
 	if (ctx->cow_mutex != NULL) {
 		knot_sem_post(ctx->cow_mutex);
@@ -334,6 +686,8 @@ void apply_rollback(apply_ctx_t *ctx)
 	zone_tree_free(&ctx->node_ptrs);
 	zone_tree_free(&ctx->nsec3_ptrs);
 	zone_tree_free(&ctx->adjust_ptrs);
+	nsec3_index_free(ctx->nsec3_index);
+	ctx->nsec3_index = NULL;
 
 	trie_cow_rollback(ctx->contents->nodes->cow, NULL, NULL);
 	ctx->contents->nodes->cow = NULL;
@@ -349,6 +703,10 @@ void apply_rollback(apply_ctx_t *ctx)
 	free(ctx->contents->nsec3_nodes);
 
 	dnssec_nsec3_params_free(&ctx->contents->nsec3_params);
+	nsec3_cache_free(ctx->contents->nsec3_cache);
+	nsec3_index_free(ctx->contents->nsec3_index);
+	referral_cache_free(ctx->contents->referrals);
+	wildcard_cache_free(ctx->contents->wildcards);
 
 	free(ctx->contents);
 
@@ -374,6 +732,10 @@ void update_free_zone(zone_contents_t *contents)
 	free(contents->nsec3_nodes);
 
 	dnssec_nsec3_params_free(&contents->nsec3_params);
+	nsec3_cache_free(contents->nsec3_cache);
+	nsec3_index_free(contents->nsec3_index);
+	referral_cache_free(contents->referrals);
+	wildcard_cache_free(contents->wildcards);
 
 	free(contents);
 }
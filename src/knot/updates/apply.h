@@ -31,6 +31,7 @@ struct apply_ctx {
 	zone_tree_t *node_ptrs;   /*!< Just pointers to the affected nodes in contents. */
 	zone_tree_t *nsec3_ptrs;  /*!< The same for NSEC3 nodes. */
 	zone_tree_t *adjust_ptrs; /*!< Pointers to nodes affected by adjusting. */
+	nsec3_index_t *nsec3_index; /*!< NSEC3 index of the contents before the changes. */
 	uint32_t flags;
 	knot_sem_t *cow_mutex;
 };
@@ -68,6 +69,21 @@ int apply_add_rr(apply_ctx_t *ctx, const knot_rrset_t *rr);
  */
 int apply_remove_rr(apply_ctx_t *ctx, const knot_rrset_t *rr);
 
+/*!
+ * \brief Applies the whole changeset into zone contents.
+ *
+ * The changeset is walked in the canonical order, all removals and additions
+ * of one owner are applied with a single node lookup and the RRs of each type
+ * are merged in one pass.
+ *
+ * \param ctx           Apply context.
+ * \param ch            Changeset to apply.
+ * \param nsec_changed  Set to true if any NSEC or NSEC3 records were changed.
+ *
+ * \return KNOT_E*
+ */
+int apply_changeset(apply_ctx_t *ctx, const changeset_t *ch, bool *nsec_changed);
+
 /*!
  * \brief Remove SOA and add a new SOA.
  *
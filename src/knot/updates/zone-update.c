@@ -16,15 +16,22 @@
 
 #include "knot/catalog/interpret.h"
 #include "knot/common/log.h"
+#include "knot/common/subscribe.h"
 #include "knot/common/systemd.h"
+#include "knot/dnssec/sign-index.h"
 #include "knot/dnssec/zone-events.h"
 #include "knot/updates/zone-update.h"
 #include "knot/zone/adds_tree.h"
 #include "knot/zone/adjust.h"
+#include "knot/zone/clone.h"
+#include "knot/zone/cold-rdata.h"
 #include "knot/zone/digest.h"
+#include "knot/zone/replicas.h"
+#include "knot/zone/shared-rdata.h"
 #include "knot/zone/serial.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/zonefile.h"
+#include "contrib/hugepool.h"
 #include "contrib/trim.h"
 #include "contrib/ucw/lists.h"
 
@@ -186,7 +193,8 @@ int zone_update_from_differences(zone_update_t *update, zone_t *zone, zone_conte
 		old_cont = zone->contents;
 	}
 
-	ret = zone_contents_diff(old_cont, new_cont, &diff, ignore_dnssec);
+	conf_val_t thr = conf_zone_get(conf(), C_ADJUST_THR, zone->name);
+	ret = zone_contents_diff(old_cont, new_cont, &diff, ignore_dnssec, conf_int(&thr));
 	switch (ret) {
 	case KNOT_ENODIFF:
 	case KNOT_ESEMCHECK:
@@ -287,7 +295,9 @@ int zone_update_start_extra(zone_update_t *update, conf_t *conf)
 			return ret;
 		}
 
-		ret = zone_contents_diff(update->init_cont, update->new_cont, &update->extra_ch, false);
+		conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
+		ret = zone_contents_diff(update->init_cont, update->new_cont, &update->extra_ch,
+		                         false, conf_int(&thr));
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -388,6 +398,8 @@ void zone_update_clear(zone_update_t *update)
 	if (update->new_cont != NULL) {
 		additionals_tree_free(update->new_cont->adds_tree);
 		update->new_cont->adds_tree = NULL;
+		zone_digest_cache_discard(update->zone->digest_cache, update->new_cont);
+		zone_sign_index_discard(update->zone->sign_index, update->new_cont);
 	}
 
 	if (update->flags & (UPDATE_INCREMENTAL | UPDATE_HYBRID)) {
@@ -623,6 +635,16 @@ static int update_chset_step(const knot_rrset_t *rrset, bool addition, void *ctx
 
 int zone_update_apply_changeset(zone_update_t *update, const changeset_t *changes)
 {
+	if ((update->flags & UPDATE_INCREMENTAL) && (update->flags & UPDATE_NO_CHSET)) {
+		// Nothing to be recorded, the changeset can be applied at once.
+		bool nsec_changed = false;
+		int ret = apply_changeset(update->a_ctx, changes, &nsec_changed);
+		if (nsec_changed) {
+			update->flags |= UPDATE_CHANGED_NSEC;
+		}
+		return ret;
+	}
+
 	return changeset_walk(changes, update_chset_step, update);
 }
 
@@ -728,6 +750,62 @@ static int commit_incremental(conf_t *conf, zone_update_t *update)
 	return KNOT_EOK;
 }
 
+// Shared by all the zones, the memory is reused by their following versions.
+static hp_pool_t mem_pools[] = {
+	[MEMORY_POLICY_HUGEPAGE]   = { .mx = PTHREAD_MUTEX_INITIALIZER, .policy = HP_POLICY_LOCAL },
+	[MEMORY_POLICY_INTERLEAVE] = { .mx = PTHREAD_MUTEX_INITIALIZER, .policy = HP_POLICY_INTERLEAVE },
+};
+
+static void set_memory_policy(zone_update_t *update, int policy)
+{
+	if (policy == MEMORY_POLICY_DEFAULT) {
+		return;
+	}
+
+	knot_mm_t mm;
+	mm_ctx_hugepool(&mm, &mem_pools[policy]);
+
+	// The contents stay usable in the original memory on failure.
+	int ret = zone_contents_set_mm(update->new_cont, &mm);
+	if (ret != KNOT_EOK) {
+		log_zone_warning(update->zone->name, "failed to apply memory policy (%s)",
+		                 knot_strerror(ret));
+	}
+}
+
+static int move_cold_rrsig(conf_t *conf, zone_update_t *update)
+{
+	conf_val_t val = conf_get(conf, C_SRV, C_COLD_STORAGE);
+	char *dir = NULL;
+	if (val.code == KNOT_EOK) {
+		conf_val_t rundir_val = conf_get(conf, C_SRV, C_RUNDIR);
+		char *rundir = conf_abs_path(&rundir_val, NULL);
+		dir = conf_abs_path(&val, rundir);
+		free(rundir);
+	}
+
+	int ret = cold_rdata_init(dir);
+	free(dir);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Only the changed nodes of an incremental update have their own rdata.
+	if (update->flags & UPDATE_INCREMENTAL) {
+		ret = cold_rdata_move(update->a_ctx->node_ptrs);
+		if (ret == KNOT_EOK) {
+			ret = cold_rdata_move(update->a_ctx->nsec3_ptrs);
+		}
+	} else {
+		ret = cold_rdata_move(update->new_cont->nodes);
+		if (ret == KNOT_EOK) {
+			ret = cold_rdata_move(update->new_cont->nsec3_nodes);
+		}
+	}
+
+	return ret;
+}
+
 static int commit_full(conf_t *conf, zone_update_t *update)
 {
 	assert(update);
@@ -739,6 +817,9 @@ static int commit_full(conf_t *conf, zone_update_t *update)
 		return KNOT_ESEMCHECK;
 	}
 
+	conf_val_t val = conf_zone_get(conf, C_MEMORY_POLICY, update->zone->name);
+	set_memory_policy(update, conf_opt(&val));
+
 	return KNOT_EOK;
 }
 
@@ -751,15 +832,22 @@ static int update_catalog(conf_t *conf, zone_update_t *update)
 
 	zone_set_flag(update->zone, ZONE_IS_CATALOG);
 
-	int ret = catalog_zone_verify(update->new_cont);
+	// Only the changed member nodes are verified and interpreted if possible.
+	zone_diff_t diff;
+	if ((update->flags & UPDATE_NO_CHSET)) {
+		get_zone_diff(&diff, update);
+	} else if ((update->flags & UPDATE_INCREMENTAL)) {
+		zone_diff_from_zone(&diff, update->change.add);
+	}
+	bool whole = !(update->flags & (UPDATE_NO_CHSET | UPDATE_INCREMENTAL));
+
+	int ret = catalog_zone_verify(update->new_cont, whole ? NULL : &diff);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
 	ssize_t upd_count = 0;
 	if ((update->flags & UPDATE_NO_CHSET)) {
-		zone_diff_t diff;
-		get_zone_diff(&diff, update);
 		ret = catalog_update_from_zone(zone_catalog_upd(update->zone),
 		                               NULL, &diff, update->new_cont,
 		                               false, zone_catalog(update->zone), &upd_count);
@@ -828,6 +916,9 @@ typedef struct {
 
 	apply_ctx_t *cleanup_apply;
 
+	zone_replicas_t *free_replicas;
+	zone_replicas_t *new_replicas;
+
 	size_t new_cont_size;
 } update_clear_ctx_t;
 
@@ -838,6 +929,7 @@ static void update_clear(struct rcu_head *param)
 	update_clear_ctx_t *ctx = (update_clear_ctx_t *)param;
 
 	ctx->free_method(ctx->free_contents);
+	zone_replicas_retire(ctx->free_replicas, ctx->new_replicas);
 	apply_cleanup(ctx->cleanup_apply);
 	free(ctx->cleanup_apply);
 
@@ -854,9 +946,9 @@ static void discard_adds_tree(zone_update_t *update)
 	update->new_cont->adds_tree = NULL;
 }
 
-int zone_update_semcheck(zone_update_t *update)
+int zone_update_semcheck(conf_t *conf, zone_update_t *update)
 {
-	if (update == NULL) {
+	if (conf == NULL || update == NULL) {
 		return KNOT_EINVAL;
 	}
 
@@ -874,8 +966,15 @@ int zone_update_semcheck(zone_update_t *update)
 		.cb = err_handler_logger
 	};
 
-	ret = sem_checks_process(update->new_cont, SEMCHECK_MANDATORY_ONLY,
-	                         &handler, time(NULL));
+	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
+	if (node_ptrs != NULL) {
+		ret = sem_checks_process_nodes(update->new_cont, node_ptrs,
+		                               SEMCHECK_MANDATORY_ONLY, &handler,
+		                               time(NULL), conf_int(&thr));
+	} else {
+		ret = sem_checks_process(update->new_cont, SEMCHECK_MANDATORY_ONLY,
+		                         &handler, time(NULL), conf_int(&thr));
+	}
 	if (ret != KNOT_EOK) {
 		// error is logged by the error handler
 		return ret;
@@ -891,7 +990,8 @@ int zone_update_verify_digest(conf_t *conf, zone_update_t *update)
 		return KNOT_EOK;
 	}
 
-	int ret = zone_contents_digest_verify(update->new_cont);
+	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
+	int ret = zone_contents_digest_verify(update->new_cont, conf_int(&thr));
 	if (ret != KNOT_EOK) {
 		log_zone_error(update->zone->name, "ZONEMD, verification failed (%s)",
 		               knot_strerror(ret));
@@ -924,8 +1024,7 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		return ret;
 	}
 
-	conf_val_t val = conf_zone_get(conf, C_DNSSEC_SIGNING, update->zone->name);
-	bool dnssec = conf_bool(&val);
+	bool dnssec = zone_is_signed(conf, update->zone);
 
 	conf_val_t thr = conf_zone_get(conf, C_ADJUST_THR, update->zone->name);
 	if ((update->flags & (UPDATE_HYBRID | UPDATE_FULL))) {
@@ -939,7 +1038,7 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 	}
 
 	/* Check the zone size. */
-	val = conf_zone_get(conf, C_ZONE_MAX_SIZE, update->zone->name);
+	conf_val_t val = conf_zone_get(conf, C_ZONE_MAX_SIZE, update->zone->name);
 	size_t size_limit = conf_int(&val);
 
 	if (update->new_cont->size > size_limit) {
@@ -996,6 +1095,34 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		}
 	}
 
+	/* Completely new contents are deduplicated with other zones. */
+	val = conf_zone_get(conf, C_RDATA_SHARING, update->zone->name);
+	if ((update->flags & (UPDATE_FULL | UPDATE_HYBRID)) && conf_bool(&val)) {
+		ret = shared_rdata_share(update->new_cont);
+		if (ret != KNOT_EOK) {
+			log_zone_warning(update->zone->name, "failed to share rdata (%s)",
+			                 knot_strerror(ret));
+		}
+	}
+
+	/* Signatures are kept apart from the more often answered records. */
+	val = conf_zone_get(conf, C_COLD_RRSIG, update->zone->name);
+	if (conf_bool(&val)) {
+		ret = move_cold_rrsig(conf, update);
+		if (ret != KNOT_EOK) {
+			log_zone_warning(update->zone->name, "failed to move signatures "
+			                 "to cold storage (%s)", knot_strerror(ret));
+		}
+	}
+
+	/* Prepare node-local copies before the contents are published. */
+	zone_replicas_t *old_replicas = update->zone->replicas, *new_replicas = NULL;
+	val = conf_zone_get(conf, C_NUMA_REPLICAS, update->zone->name);
+	if (conf_bool(&val)) {
+		new_replicas = zone_replicas_commit(update, conf_int(&thr));
+	}
+	rcu_assign_pointer(update->zone->replicas, new_replicas);
+
 	/* Switch zone contents. */
 	zone_contents_t *old_contents;
 	old_contents = zone_switch_contents(update->zone, update->new_cont);
@@ -1014,6 +1141,8 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 			zone_contents_deep_free : update_free_zone
 		);
 		clear_ctx->cleanup_apply = update->a_ctx;
+		clear_ctx->free_replicas = old_replicas;
+		clear_ctx->new_replicas = new_replicas;
 		clear_ctx->new_cont_size = update->new_cont->size;
 
 		call_rcu((struct rcu_head *)clear_ctx, update_clear);
@@ -1021,9 +1150,10 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		log_zone_error(update->zone->name, "failed to deallocate unused memory");
 	}
 
+	zone_clone_propagate(conf, update->zone);
+
 	/* Sync zonefile immediately if configured. */
-	val = conf_zone_get(conf, C_ZONEFILE_SYNC, update->zone->name);
-	if (conf_int(&val) == 0) {
+	if (zone_zonefile_sync(conf, update->zone) == 0) {
 		zone_events_schedule_now(update->zone, ZONE_EVENT_FLUSH);
 	}
 
@@ -1031,6 +1161,8 @@ int zone_update_commit(conf_t *conf, zone_update_t *update)
 		systemd_emit_zone_updated(update->zone->name,
 		                          zone_contents_serial(update->zone->contents));
 	}
+	subscribe_emit(SUBSCRIBE_SERIAL, update->zone->name, "serial", "%u",
+	               zone_contents_serial(update->zone->contents));
 
 	memset(update, 0, sizeof(*update));
 
@@ -0,0 +1,144 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "knot/worker/isolation.h"
+#include "knot/server/dthreads.h"
+#include "libknot/errcode.h"
+
+/*! \brief Nice value added to the low priority threads. */
+#define LOW_NICE	10
+#define MAX_NICE	19
+
+static struct {
+	pthread_mutex_t lock;
+	unsigned *cpus;
+	size_t count;
+	worker_sched_t sched;
+	unsigned generation;   // Incremented on each change.
+	int base_nice;         // Nice value of the process.
+	bool base_init;
+} iso = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/*! \brief Generation of the setting applied to the thread, 0 means none. */
+static __thread unsigned applied = 0;
+
+static void set_sched(worker_sched_t sched)
+{
+#ifdef __linux__
+	bool idle = false;
+#ifdef SCHED_IDLE
+	struct sched_param param = { 0 };
+	int policy = (sched == WORKER_SCHED_IDLE) ? SCHED_IDLE : SCHED_OTHER;
+	idle = (pthread_setschedparam(pthread_self(), policy, &param) == 0 &&
+	        policy == SCHED_IDLE);
+#endif
+	// The nice value is per thread on Linux.
+	int nice = iso.base_nice;
+	if (sched == WORKER_SCHED_LOW || (sched == WORKER_SCHED_IDLE && !idle)) {
+		nice += LOW_NICE;
+	}
+	(void)setpriority(PRIO_PROCESS, syscall(SYS_gettid), (nice < MAX_NICE) ? nice : MAX_NICE);
+#endif
+}
+
+int worker_isolation_set(const unsigned *cpus, size_t count, worker_sched_t sched)
+{
+	if (cpus == NULL && count > 0) {
+		return KNOT_EINVAL;
+	}
+
+	unsigned *copy = NULL;
+	if (count > 0) {
+		copy = malloc(count * sizeof(*copy));
+		if (copy == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memcpy(copy, cpus, count * sizeof(*copy));
+	}
+
+	pthread_mutex_lock(&iso.lock);
+	bool changed = (count != iso.count || sched != iso.sched ||
+	                (count > 0 && memcmp(copy, iso.cpus, count * sizeof(*copy)) != 0));
+	if (!changed) {
+		pthread_mutex_unlock(&iso.lock);
+		free(copy);
+		return KNOT_EOK;
+	}
+
+	if (!iso.base_init) {
+		errno = 0;
+		int nice = getpriority(PRIO_PROCESS, 0);
+		iso.base_nice = (errno == 0) ? nice : 0;
+		iso.base_init = true;
+	}
+
+	free(iso.cpus);
+	iso.cpus = copy;
+	iso.count = count;
+	iso.sched = sched;
+	__atomic_add_fetch(&iso.generation, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&iso.lock);
+
+	return KNOT_EOK;
+}
+
+void worker_isolation_apply(void)
+{
+	if (__atomic_load_n(&iso.generation, __ATOMIC_ACQUIRE) == applied) {
+		return;
+	}
+
+	pthread_mutex_lock(&iso.lock);
+	if (iso.count > 0) {
+		(void)dt_setaffinity_self(iso.cpus, iso.count);
+	} else if (applied > 0) {
+		// Lift the previous restriction.
+		int online = dt_online_cpus();
+		if (online > 0) {
+			unsigned all[online];
+			for (int i = 0; i < online; i++) {
+				all[i] = i;
+			}
+			(void)dt_setaffinity_self(all, online);
+		}
+	}
+	set_sched(iso.sched);
+	applied = iso.generation;
+	pthread_mutex_unlock(&iso.lock);
+}
+
+void worker_isolation_deinit(void)
+{
+	pthread_mutex_lock(&iso.lock);
+	free(iso.cpus);
+	iso.cpus = NULL;
+	iso.count = 0;
+	pthread_mutex_unlock(&iso.lock);
+}
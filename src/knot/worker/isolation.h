@@ -0,0 +1,53 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Isolation of the background threads from the query processing.
+ *
+ * The background workers and the signing helpers apply the configured CPU
+ * set and scheduling priority to themselves whenever the setting changes.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+typedef enum {
+	WORKER_SCHED_NORMAL = 0, /*!< Default scheduling. */
+	WORKER_SCHED_LOW,        /*!< Increased nice value. */
+	WORKER_SCHED_IDLE,       /*!< SCHED_IDLE policy (nice if not supported). */
+} worker_sched_t;
+
+/*!
+ * \brief Sets the isolation of the background threads.
+ *
+ * \param cpus   CPUs the threads are restricted to.
+ * \param count  Number of the CPUs, 0 for no restriction.
+ * \param sched  Scheduling priority of the threads.
+ *
+ * \return KNOT_E*
+ */
+int worker_isolation_set(const unsigned *cpus, size_t count, worker_sched_t sched);
+
+/*!
+ * \brief Applies the isolation to the calling thread if changed since the last call.
+ */
+void worker_isolation_apply(void);
+
+/*!
+ * \brief Releases the isolation setting.
+ */
+void worker_isolation_deinit(void);
@@ -20,30 +20,136 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "contrib/time.h"
 #include "libknot/libknot.h"
 #include "knot/server/dthreads.h"
+#include "knot/worker/isolation.h"
 #include "knot/worker/pool.h"
 
+/*! \brief Every n-th dequeue prefers the lowest priority to avoid starvation. */
+#define STARVATION_PERIOD 16
+
+#define ATOMIC_GET(x)     __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define ATOMIC_SET(x, v)  __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_ADD(x, v)  __atomic_add_fetch(&(x), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_SUB(x, v)  __atomic_sub_fetch(&(x), (v), __ATOMIC_SEQ_CST)
+
+static const worker_prio_t prio_order[WORKER_PRIO_COUNT] = {
+	WORKER_PRIO_HIGH, WORKER_PRIO_NORMAL, WORKER_PRIO_LOW
+};
+
+/*!
+ * \brief Task queue owned by one worker, other workers can steal from it.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	worker_queue_t tasks[WORKER_PRIO_COUNT];
+	size_t length[WORKER_PRIO_COUNT]; /*!< Queue lengths, readable without the lock. */
+} worker_local_t;
+
 /*!
  * \brief Worker pool state.
  */
 struct worker_pool {
 	dt_unit_t *threads;
 
-	pthread_mutex_t lock;
-	pthread_cond_t wake;
+	pthread_mutex_t lock;	/*!< Protects sleeping of workers and waiters. */
+	pthread_cond_t wake;	/*!< Signalled on new tasks and state changes. */
+	pthread_cond_t done;	/*!< Signalled on task completion if any waiter. */
 
 	bool terminating;	/*!< Is the pool terminating? .*/
 	bool suspended;		/*!< Is execution temporarily suspended? .*/
 	int running;		/*!< Number of running threads. */
-	worker_queue_t tasks;
+	int queued;		/*!< Number of queued tasks. */
+	int idle;		/*!< Number of sleeping threads. */
+	int waiters;		/*!< Number of threads waiting for an empty pool. */
+	unsigned next;		/*!< Queue for the next assigned task. */
+
+	unsigned nqueues;
+	worker_local_t *queues;
+
+	uint64_t executed[WORKER_PRIO_COUNT];
+	uint64_t wait_total[WORKER_PRIO_COUNT];
+	uint64_t wait_max[WORKER_PRIO_COUNT];
 };
 
+static void update_metrics(worker_pool_t *pool, worker_task_t *task)
+{
+	struct timespec now = time_now();
+	struct timespec diff = time_diff(&task->enqueued, &now);
+	uint64_t wait = diff.tv_sec * 1000000 + diff.tv_nsec / 1000;
+
+	worker_prio_t prio = task->prio;
+	__atomic_add_fetch(&pool->executed[prio], 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&pool->wait_total[prio], wait, __ATOMIC_RELAXED);
+	uint64_t max = __atomic_load_n(&pool->wait_max[prio], __ATOMIC_RELAXED);
+	while (wait > max &&
+	       !__atomic_compare_exchange_n(&pool->wait_max[prio], &max, wait, true,
+	                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+}
+
+/*!
+ * \brief Take a task from the given queue.
+ *
+ * The running counter is increased before the queued counter is decreased,
+ * so that waiters never see an empty pool while a task is being taken.
+ */
+static worker_task_t *take_from(worker_pool_t *pool, worker_local_t *local,
+                                worker_prio_t prio)
+{
+	if (ATOMIC_GET(local->length[prio]) == 0) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&local->lock);
+	worker_task_t *task = worker_queue_dequeue(&local->tasks[prio]);
+	if (task != NULL) {
+		ATOMIC_SUB(local->length[prio], 1);
+		ATOMIC_ADD(pool->running, 1);
+		ATOMIC_SUB(pool->queued, 1);
+	}
+	pthread_mutex_unlock(&local->lock);
+
+	return task;
+}
+
+/*!
+ * \brief Take the most important task, preferably from the own queue.
+ */
+static worker_task_t *take_task(worker_pool_t *pool, unsigned self, unsigned *round)
+{
+	bool reverse = (++(*round) % STARVATION_PERIOD == 0);
+
+	for (int i = 0; i < WORKER_PRIO_COUNT; i++) {
+		worker_prio_t prio = prio_order[reverse ? WORKER_PRIO_COUNT - 1 - i : i];
+		for (unsigned j = 0; j < pool->nqueues; j++) {
+			worker_local_t *local = &pool->queues[(self + j) % pool->nqueues];
+			worker_task_t *task = take_from(pool, local, prio);
+			if (task != NULL) {
+				return task;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void notify_waiters(worker_pool_t *pool)
+{
+	if (ATOMIC_GET(pool->waiters) > 0) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
 /*!
  * \brief Worker thread.
  *
- * The thread takes a task from the tasks queue and runs it, while checking
- * if the dispatching of new tasks is allowed by the thread pool.
+ * The thread takes a task from its own queue, or steals one from another
+ * worker's queue, and runs it, while checking if the dispatching of new
+ * tasks is allowed by the thread pool.
  *
  * An execution of a running thread cannot be enforced.
  *
@@ -53,37 +159,38 @@ static int worker_main(dthread_t *thread)
 	assert(thread);
 
 	worker_pool_t *pool = thread->data;
+	unsigned self = dt_get_id(thread) % pool->nqueues;
+	unsigned round = 0;
 
-	pthread_mutex_lock(&pool->lock);
-
-	for (;;) {
-		if (pool->terminating) {
-			break;
-		}
+	while (!ATOMIC_GET(pool->terminating)) {
+		worker_isolation_apply();
 
 		worker_task_t *task = NULL;
-		if (!pool->suspended) {
-			task = worker_queue_dequeue(&pool->tasks);
+		if (!ATOMIC_GET(pool->suspended)) {
+			task = take_task(pool, self, &round);
 		}
 
-		if (task == NULL) {
-			pthread_cond_wait(&pool->wake, &pool->lock);
+		if (task != NULL) {
+			assert(task->run);
+			update_metrics(pool, task);
+			task->run(task);
+
+			ATOMIC_SUB(pool->running, 1);
+			notify_waiters(pool);
 			continue;
 		}
 
-		assert(task->run);
-		pool->running += 1;
-
-		pthread_mutex_unlock(&pool->lock);
-		task->run(task);
+		/* Sleep until a task is assigned or the pool state changes. */
 		pthread_mutex_lock(&pool->lock);
-
-		pool->running -= 1;
-		pthread_cond_broadcast(&pool->wake);
+		ATOMIC_ADD(pool->idle, 1);
+		while (!pool->terminating &&
+		       (pool->suspended || ATOMIC_GET(pool->queued) == 0)) {
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		}
+		ATOMIC_SUB(pool->idle, 1);
+		pthread_mutex_unlock(&pool->lock);
 	}
 
-	pthread_mutex_unlock(&pool->lock);
-
 	return KNOT_EOK;
 }
 
@@ -97,6 +204,19 @@ worker_pool_t *worker_pool_create(unsigned threads)
 	}
 
 	memset(pool, 0, sizeof(worker_pool_t));
+	pool->nqueues = (threads > 0) ? threads : 1;
+	pool->queues = calloc(pool->nqueues, sizeof(worker_local_t));
+	if (pool->queues == NULL) {
+		free(pool);
+		return NULL;
+	}
+	for (unsigned i = 0; i < pool->nqueues; i++) {
+		pthread_mutex_init(&pool->queues[i].lock, NULL);
+		for (int prio = 0; prio < WORKER_PRIO_COUNT; prio++) {
+			worker_queue_init(&pool->queues[i].tasks[prio]);
+		}
+	}
+
 	pool->threads = dt_create(threads, worker_main, NULL, pool);
 	if (pool->threads == NULL) {
 		goto fail;
@@ -106,16 +226,19 @@ worker_pool_t *worker_pool_create(unsigned threads)
 		goto fail;
 	}
 
-	if (pthread_cond_init(&pool->wake, NULL) != 0) {
+	if (pthread_cond_init(&pool->wake, NULL) != 0 ||
+	    pthread_cond_init(&pool->done, NULL) != 0) {
 		goto fail;
 	}
 
-	worker_queue_init(&pool->tasks);
-
 	return pool;
 
 fail:
 	dt_delete(&pool->threads);
+	for (unsigned i = 0; i < pool->nqueues; i++) {
+		pthread_mutex_destroy(&pool->queues[i].lock);
+	}
+	free(pool->queues);
 	free(pool);
 	return NULL;
 }
@@ -130,8 +253,15 @@ void worker_pool_destroy(worker_pool_t *pool)
 
 	pthread_mutex_destroy(&pool->lock);
 	pthread_cond_destroy(&pool->wake);
+	pthread_cond_destroy(&pool->done);
 
-	worker_queue_deinit(&pool->tasks);
+	for (unsigned i = 0; i < pool->nqueues; i++) {
+		pthread_mutex_destroy(&pool->queues[i].lock);
+		for (int prio = 0; prio < WORKER_PRIO_COUNT; prio++) {
+			worker_queue_deinit(&pool->queues[i].tasks[prio]);
+		}
+	}
+	free(pool->queues);
 
 	free(pool);
 }
@@ -152,7 +282,7 @@ void worker_pool_stop(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->terminating = true;
+	ATOMIC_SET(pool->terminating, true);
 	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 
@@ -166,7 +296,7 @@ void worker_pool_suspend(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->suspended = true;
+	ATOMIC_SET(pool->suspended, true);
 	pthread_mutex_unlock(&pool->lock);
 }
 
@@ -177,7 +307,7 @@ void worker_pool_resume(worker_pool_t *pool)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	pool->suspended = false;
+	ATOMIC_SET(pool->suspended, false);
 	pthread_cond_broadcast(&pool->wake);
 	pthread_mutex_unlock(&pool->lock);
 }
@@ -198,12 +328,15 @@ void worker_pool_wait_cb(worker_pool_t *pool, wait_callback_t cb)
 	}
 
 	pthread_mutex_lock(&pool->lock);
-	while (!EMPTY_LIST(pool->tasks.list) || pool->running > 0) {
+	ATOMIC_ADD(pool->waiters, 1);
+	/* The queued counter must be read first, see take_from(). */
+	while (ATOMIC_GET(pool->queued) > 0 || ATOMIC_GET(pool->running) > 0) {
 		if (cb != NULL) {
 			cb(pool);
 		}
-		pthread_cond_wait(&pool->wake, &pool->lock);
+		pthread_cond_wait(&pool->done, &pool->lock);
 	}
+	ATOMIC_SUB(pool->waiters, 1);
 	pthread_mutex_unlock(&pool->lock);
 }
 
@@ -218,10 +351,26 @@ void worker_pool_assign(worker_pool_t *pool, struct task *task)
 		return;
 	}
 
-	pthread_mutex_lock(&pool->lock);
-	worker_queue_enqueue(&pool->tasks, task);
-	pthread_cond_signal(&pool->wake);
-	pthread_mutex_unlock(&pool->lock);
+	if (task->prio >= WORKER_PRIO_COUNT) {
+		task->prio = WORKER_PRIO_NORMAL;
+	}
+	task->enqueued = time_now();
+
+	unsigned idx = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED) % pool->nqueues;
+	worker_local_t *local = &pool->queues[idx];
+
+	pthread_mutex_lock(&local->lock);
+	worker_queue_enqueue(&local->tasks[task->prio], task);
+	ATOMIC_ADD(local->length[task->prio], 1);
+	ATOMIC_ADD(pool->queued, 1);
+	pthread_mutex_unlock(&local->lock);
+
+	/* Sleeping workers recheck the queued counter under the pool lock. */
+	if (ATOMIC_GET(pool->idle) > 0) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_signal(&pool->wake);
+		pthread_mutex_unlock(&pool->lock);
+	}
 }
 
 void worker_pool_clear(worker_pool_t *pool)
@@ -230,25 +379,49 @@ void worker_pool_clear(worker_pool_t *pool)
 		return;
 	}
 
-	pthread_mutex_lock(&pool->lock);
-	worker_queue_deinit(&pool->tasks);
-	worker_queue_init(&pool->tasks);
-	pthread_mutex_unlock(&pool->lock);
+	for (unsigned i = 0; i < pool->nqueues; i++) {
+		worker_local_t *local = &pool->queues[i];
+		pthread_mutex_lock(&local->lock);
+		for (int prio = 0; prio < WORKER_PRIO_COUNT; prio++) {
+			worker_queue_deinit(&local->tasks[prio]);
+			worker_queue_init(&local->tasks[prio]);
+			ATOMIC_SUB(pool->queued, local->length[prio]);
+			ATOMIC_SET(local->length[prio], 0);
+		}
+		pthread_mutex_unlock(&local->lock);
+	}
+
+	notify_waiters(pool);
 }
 
-void worker_pool_status(worker_pool_t *pool, bool locked, int *running, int *queued)
+void worker_pool_status(worker_pool_t *pool, _unused_ bool locked, int *running, int *queued)
 {
 	if (!pool) {
 		*running = *queued = 0;
 		return;
 	}
 
-	if (!locked) {
-		pthread_mutex_lock(&pool->lock);
+	*running = ATOMIC_GET(pool->running);
+	*queued = ATOMIC_GET(pool->queued);
+}
+
+void worker_pool_stats(worker_pool_t *pool, worker_pool_stats_t *stats)
+{
+	if (!stats) {
+		return;
 	}
-	*running = pool->running;
-	*queued = worker_queue_length(&pool->tasks);
-	if (!locked) {
-		pthread_mutex_unlock(&pool->lock);
+
+	memset(stats, 0, sizeof(*stats));
+	if (!pool) {
+		return;
+	}
+
+	for (int prio = 0; prio < WORKER_PRIO_COUNT; prio++) {
+		for (unsigned i = 0; i < pool->nqueues; i++) {
+			stats->queued[prio] += ATOMIC_GET(pool->queues[i].length[prio]);
+		}
+		stats->executed[prio] = __atomic_load_n(&pool->executed[prio], __ATOMIC_RELAXED);
+		stats->wait_total[prio] = __atomic_load_n(&pool->wait_total[prio], __ATOMIC_RELAXED);
+		stats->wait_max[prio] = __atomic_load_n(&pool->wait_max[prio], __ATOMIC_RELAXED);
 	}
 }
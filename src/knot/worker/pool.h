@@ -17,6 +17,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "knot/worker/queue.h"
 
@@ -25,6 +26,16 @@ typedef struct worker_pool worker_pool_t;
 
 typedef void(*wait_callback_t)(worker_pool_t *);
 
+/*!
+ * \brief Worker pool metrics per task priority class.
+ */
+typedef struct {
+	size_t queued[WORKER_PRIO_COUNT];       /*!< Current queue depth. */
+	uint64_t executed[WORKER_PRIO_COUNT];   /*!< Number of dequeued tasks. */
+	uint64_t wait_total[WORKER_PRIO_COUNT]; /*!< Total queue wait time in microseconds. */
+	uint64_t wait_max[WORKER_PRIO_COUNT];   /*!< Maximal queue wait time in microseconds. */
+} worker_pool_stats_t;
+
 /*!
  * \brief Initialize worker pool.
  *
@@ -77,6 +88,10 @@ void worker_pool_wait_cb(worker_pool_t *pool, wait_callback_t cb);
 
 /*!
  * \brief Assign a task to be performed by a worker in the pool.
+ *
+ * Tasks are distributed among per-worker queues, idle workers steal tasks
+ * from the other queues. Tasks of higher priority are preferred, tasks
+ * of the same priority are dequeued in FIFO order per queue.
  */
 void worker_pool_assign(worker_pool_t *pool, struct task *task);
 
@@ -88,6 +103,12 @@ void worker_pool_clear(worker_pool_t *pool);
 /*!
  * \brief Obtain info regarding how the pool is busy.
  *
- * \note Locked means if the mutex `pool->lock` is locked.
+ * \note Locked means if the mutex `pool->lock` is locked. The counters are
+ *       read atomically, so the lock isn't needed anymore.
  */
 void worker_pool_status(worker_pool_t *pool, bool locked, int *running, int *queued);
+
+/*!
+ * \brief Obtain queue depth and wait time metrics of the pool.
+ */
+void worker_pool_stats(worker_pool_t *pool, worker_pool_stats_t *stats);
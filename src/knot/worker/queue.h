@@ -16,17 +16,31 @@
 
 #pragma once
 
+#include <time.h>
+
 #include "contrib/ucw/lists.h"
 
 struct task;
 typedef void (*task_cb)(struct task *);
 
+/*!
+ * \brief Task priority classes.
+ */
+typedef enum {
+	WORKER_PRIO_NORMAL = 0, /*!< Default priority. */
+	WORKER_PRIO_HIGH,       /*!< Latency sensitive tasks (e.g. DDNS, NOTIFY). */
+	WORKER_PRIO_LOW,        /*!< Bulk background tasks (e.g. refresh, signing). */
+	WORKER_PRIO_COUNT
+} worker_prio_t;
+
 /*!
  * \brief Task executable by a worker.
  */
 typedef struct task {
 	void *ctx;
 	task_cb run;
+	worker_prio_t prio;       /*!< Priority class. */
+	struct timespec enqueued; /*!< Time of assignment (set by the pool). */
 } worker_task_t;
 
 /*!
@@ -16,6 +16,7 @@
 
 #include "knot/zone/adjust.h"
 #include "knot/common/log.h"
+#include "knot/dnssec/sign-pool.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/adds_tree.h"
 #include "knot/zone/measure.h"
@@ -231,23 +232,14 @@ static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
 	size_t total_count = mandatory_count + others_count;
 	additional_t *new_addit = NULL;
 	if (total_count > 0) {
-		new_addit = malloc(sizeof(additional_t));
+		new_addit = additional_new(total_count);
 		if (new_addit == NULL) {
 			return KNOT_ENOMEM;
 		}
-		new_addit->count = total_count;
 
-		size_t size = total_count * sizeof(glue_t);
-		new_addit->glues = malloc(size);
-		if (new_addit->glues == NULL) {
-			free(new_addit);
-			return KNOT_ENOMEM;
-		}
-
-		size_t mandatory_size = mandatory_count * sizeof(glue_t);
-		memcpy(new_addit->glues, mandatory, mandatory_size);
+		memcpy(new_addit->glues, mandatory, mandatory_count * sizeof(glue_t));
 		memcpy(new_addit->glues + mandatory_count, others,
-		       size - mandatory_size);
+		       others_count * sizeof(glue_t));
 	}
 
 	/* If the result differs, shallow copy node and store additionals. */
@@ -277,6 +269,8 @@ static int discover_additionals(zone_node_t *adjn, uint16_t rr_at,
 
 int adjust_cb_additionals(zone_node_t *node, adjust_ctx_t *ctx)
 {
+	node_update_wire_sizes(node);
+
 	/* Lookup additional records for specific nodes. */
 	for(uint16_t i = 0; i < node->rrset_count; ++i) {
 		struct rr_data *rr_data = &node->rrs[i];
@@ -334,14 +328,12 @@ typedef struct {
 	measure_t *m;
 
 	// just for parallel
-	unsigned threads;
-	unsigned thr_id;
-	size_t i;
-	pthread_t thread;
 	int ret;
-	zone_tree_t *tree;
 } zone_adjust_arg_t;
 
+#define ADJUST_CHUNK 64 /*!< Consecutive nodes adjusted by one participant at once. */
+#define ADJUST_PARALLEL_MIN 4096 /*!< Nodes per participant worth the parallel adjusting. */
+
 static int adjust_single(zone_node_t *node, void *data)
 {
 	assert(node != NULL);
@@ -349,13 +341,6 @@ static int adjust_single(zone_node_t *node, void *data)
 
 	zone_adjust_arg_t *args = (zone_adjust_arg_t *)data;
 
-	// parallel adjust support
-	if (args->threads > 1) {
-		if (args->i++ % args->threads != args->thr_id) {
-			return KNOT_EOK;
-		}
-	}
-
 	if (args->m != NULL) {
 		knot_measure_node(node, args->m);
 	}
@@ -411,20 +396,62 @@ static int zone_adjust_tree(zone_tree_t *tree, adjust_ctx_t *ctx, adjust_cb_t ad
 	return KNOT_EOK;
 }
 
-static void *adjust_tree_thread(void *ctx)
+typedef struct {
+	zone_tree_it_t it;
+	pthread_mutex_t it_lock;
+	bool failed;
+	zone_adjust_arg_t *args;
+} adjust_tree_ctx_t;
+
+/*!
+ * \brief Get the next chunk of consecutive nodes to be adjusted.
+ *
+ * \return Number of nodes in the chunk, zero if no more work.
+ */
+static size_t next_chunk(adjust_tree_ctx_t *ctx, zone_node_t **chunk)
 {
-	zone_adjust_arg_t *arg = ctx;
+	size_t count = 0;
+
+	pthread_mutex_lock(&ctx->it_lock);
+	while (!ctx->failed && !zone_tree_it_finished(&ctx->it) && count < ADJUST_CHUNK) {
+		chunk[count++] = zone_tree_it_val(&ctx->it);
+		zone_tree_it_next(&ctx->it);
+	}
+	pthread_mutex_unlock(&ctx->it_lock);
 
-	arg->ret = zone_tree_apply(arg->tree, adjust_single, ctx);
+	return count;
+}
+
+static void adjust_tree_job(void *_ctx, unsigned index)
+{
+	adjust_tree_ctx_t *ctx = _ctx;
+	zone_adjust_arg_t *arg = &ctx->args[index];
+
+	zone_node_t *chunk[ADJUST_CHUNK];
+	while (arg->ret == KNOT_EOK) {
+		size_t count = next_chunk(ctx, chunk);
+		if (count == 0) {
+			break;
+		}
+		for (size_t i = 0; i < count && arg->ret == KNOT_EOK; i++) {
+			arg->ret = adjust_single(chunk[i], arg);
+		}
+	}
 
-	return NULL;
+	if (arg->ret != KNOT_EOK) {
+		pthread_mutex_lock(&ctx->it_lock);
+		ctx->failed = true;
+		pthread_mutex_unlock(&ctx->it_lock);
+	}
 }
 
 static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
                                      adjust_cb_t adjust_cb, unsigned threads)
 {
-	if (zone_tree_is_empty(tree)) {
-		return KNOT_EOK;
+	// Small trees don't pay off the thread synchronization.
+	threads = MIN(threads, zone_tree_count(tree) / ADJUST_PARALLEL_MIN);
+	if (threads <= 1) {
+		return zone_adjust_tree(tree, ctx, adjust_cb, false, NULL);
 	}
 
 	zone_adjust_arg_t args[threads];
@@ -432,16 +459,9 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 	int ret = KNOT_EOK;
 
 	for (unsigned i = 0; i < threads; i++) {
-		args[i].first_node = NULL;
 		args[i].ctx = *ctx;
 		args[i].adjust_cb = adjust_cb;
-		args[i].adjust_prevs = false;
-		args[i].m = NULL;
-		args[i].tree = tree;
-		args[i].threads = threads;
-		args[i].i = 0;
-		args[i].thr_id = i;
-		args[i].ret = -1;
+		args[i].ret = KNOT_EOK;
 		if (ctx->changed_nodes != NULL) {
 			args[i].ctx.changed_nodes = zone_tree_create(true);
 			if (args[i].ctx.changed_nodes == NULL) {
@@ -451,23 +471,25 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 			args[i].ctx.changed_nodes->flags = tree->flags;
 		}
 	}
+
+	adjust_tree_ctx_t tctx = { .args = args };
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_it_begin(tree, &tctx.it);
+	}
 	if (ret != KNOT_EOK) {
 		for (unsigned i = 0; i < threads; i++) {
 			zone_tree_free(&args[i].ctx.changed_nodes);
 		}
 		return ret;
 	}
+	pthread_mutex_init(&tctx.it_lock, NULL);
 
-	for (unsigned i = 0; i < threads; i++) {
-		args[i].ret = pthread_create(&args[i].thread, NULL, adjust_tree_thread, &args[i]);
-	}
+	// Shared helper threads, each participant takes consecutive nodes.
+	sign_pool_run(threads, adjust_tree_job, &tctx);
 
 	for (unsigned i = 0; i < threads; i++) {
-		if (args[i].ret == 0) {
-			args[i].ret = pthread_join(args[i].thread, NULL);
-		}
-		if (args[i].ret != 0) {
-			ret = knot_map_errno_code(args[i].ret);
+		if (args[i].ret != KNOT_EOK) {
+			ret = args[i].ret;
 		}
 		if (ret == KNOT_EOK && ctx->changed_nodes != NULL) {
 			ret = zone_tree_merge(ctx->changed_nodes, args[i].ctx.changed_nodes);
@@ -475,6 +497,9 @@ static int zone_adjust_tree_parallel(zone_tree_t *tree, adjust_ctx_t *ctx,
 		zone_tree_free(&args[i].ctx.changed_nodes);
 	}
 
+	pthread_mutex_destroy(&tctx.it_lock);
+	zone_tree_it_free(&tctx.it);
+
 	return ret;
 }
 
@@ -541,6 +566,10 @@ int zone_adjust_update(zone_update_t *update, adjust_cb_t nodes_cb, adjust_cb_t
 
 int zone_adjust_full(zone_contents_t *zone, unsigned threads)
 {
+	// Optional, the trees were bulk loaded so let the lookups follow the memory order.
+	(void)zone_tree_compact(zone->nodes);
+	(void)zone_tree_compact(zone->nsec3_nodes);
+
 	int ret = zone_adjust_contents(zone, adjust_cb_flags, adjust_cb_nsec3_flags,
 	                               true, true, 1, NULL);
 	if (ret == KNOT_EOK) {
@@ -551,21 +580,86 @@ int zone_adjust_full(zone_contents_t *zone, unsigned threads)
 		additionals_tree_free(zone->adds_tree);
 		ret = additionals_tree_from_zone(&zone->adds_tree, zone);
 	}
+	if (ret == KNOT_EOK) {
+		// Optional, the lookups fall back to the NSEC3 tree.
+		nsec3_index_free(zone->nsec3_index);
+		zone->nsec3_index = nsec3_index_build(zone->nsec3_nodes, zone->apex->owner);
+	}
 	return ret;
 }
 
-static int adjust_additionals_cb(zone_node_t *node, void *ctx)
+/*!
+ * \brief Checks if the pointers to the node held by other nodes may be stale.
+ *
+ * The additionals and NSEC3 pointers refer to the node itself (its bi-node),
+ * not to its records, so only a change of the node existence or of its
+ * delegation flags (deciding mandatory glue) matters to the referring nodes.
+ */
+static bool node_target_changed(zone_node_t *node)
 {
-	adjust_ctx_t *actx = ctx;
-	zone_node_t *real_node = zone_tree_fix_get(node, actx->zone->nodes);
-	return adjust_cb_additionals(real_node, actx);
+	zone_node_t *counter = binode_counterpart(node);
+	if (counter == NULL) {
+		return true;
+	}
+
+	bool exists = !(node->flags & NODE_FLAGS_DELETED);
+	bool existed = !(counter->flags & NODE_FLAGS_DELETED);
+	uint16_t deleg = NODE_FLAGS_DELEG | NODE_FLAGS_NONAUTH;
+
+	return exists != existed || (node->flags & deleg) != (counter->flags & deleg);
 }
 
-static int adjust_point_to_nsec3_cb(zone_node_t *node, void *ctx)
+typedef struct {
+	zone_tree_t *deps;        // Collected referring nodes.
+	const zone_tree_t *skip;  // Nodes adjusted anyway.
+} collect_deps_ctx_t;
+
+static int collect_dep_cb(zone_node_t *node, void *ctx)
 {
-	adjust_ctx_t *actx = ctx;
-	zone_node_t *real_node = zone_tree_fix_get(node, actx->zone->nodes);
-	return adjust_cb_nsec3_pointer(real_node, actx);
+	collect_deps_ctx_t *cctx = ctx;
+	if (cctx->skip != NULL && zone_tree_get((zone_tree_t *)cctx->skip, node->owner) != NULL) {
+		return KNOT_EOK;
+	}
+	return zone_tree_insert(cctx->deps, &node);
+}
+
+/*!
+ * \brief Adjusts the nodes referring to the changed nodes of the tree.
+ *
+ * Each referring node is adjusted once, even if it refers to several changed
+ * nodes, and only the changed nodes that can affect the references are followed.
+ */
+static int adjust_dependents(adjust_ctx_t *ctx, const zone_tree_t *changed,
+                             const zone_tree_t *skip, adjust_cb_t adjust_cb)
+{
+	if (zone_tree_is_empty((zone_tree_t *)changed)) {
+		return KNOT_EOK;
+	}
+
+	collect_deps_ctx_t cctx = { zone_tree_create(true), skip };
+	if (cctx.deps == NULL) {
+		return KNOT_ENOMEM;
+	}
+	cctx.deps->flags = ctx->zone->nodes->flags;
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin((zone_tree_t *)changed, &it);
+	while (!zone_tree_it_finished(&it) && ret == KNOT_EOK) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		if (node_target_changed(node)) {
+			ret = additionals_reverse_apply(ctx->zone->adds_tree, node->owner,
+			                                collect_dep_cb, &cctx);
+		}
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_tree(cctx.deps, ctx, adjust_cb, false, NULL);
+	}
+
+	zone_tree_free(&cctx.deps);
+	return ret;
 }
 
 int zone_adjust_incremental_update(zone_update_t *update, unsigned threads)
@@ -604,25 +698,24 @@ int zone_adjust_incremental_update(zone_update_t *update, unsigned threads)
 		}
 	}
 	if (ret == KNOT_EOK) {
-		ret = additionals_reverse_apply_multi(
-			update->new_cont->adds_tree,
-			update->a_ctx->node_ptrs,
-			adjust_additionals_cb,
-			&ctx
-		);
+		// The changed nodes themselves are re-resolved right after.
+		ret = adjust_dependents(&ctx, update->a_ctx->node_ptrs,
+		                        update->a_ctx->node_ptrs, adjust_cb_additionals);
 	}
 	if (ret == KNOT_EOK) {
 		ret = zone_adjust_update(update, adjust_cb_additionals, adjust_cb_void, false);
 	}
+	if (ret == KNOT_EOK && !nsec3change) {
+		ret = adjust_dependents(&ctx, update->a_ctx->nsec3_ptrs,
+		                        NULL, adjust_cb_nsec3_pointer);
+	}
 	if (ret == KNOT_EOK) {
-		if (!nsec3change) {
-			ret = additionals_reverse_apply_multi(
-				update->new_cont->adds_tree,
-				update->a_ctx->nsec3_ptrs,
-				adjust_point_to_nsec3_cb,
-				&ctx
-			);
-		}
+		zone_contents_t *cont = update->new_cont;
+		nsec3_index_free(cont->nsec3_index);
+		cont->nsec3_index = nsec3_index_update(update->a_ctx->nsec3_index,
+		                                       cont->nsec3_nodes,
+		                                       update->a_ctx->nsec3_ptrs,
+		                                       cont->apex->owner);
 	}
 	return ret;
 }
@@ -51,7 +51,7 @@ int adjust_cb_nsec3_flags(zone_node_t *node, adjust_ctx_t *ctx);
 // fix pointer at corresponding NSEC3 node
 int adjust_cb_nsec3_pointer(zone_node_t *node, adjust_ctx_t *ctx);
 
-// fix NORMAL node flags to additionals, like NS records and glue...
+// fix NORMAL node flags to additionals, like NS records and glue, and the wire sizes
 int adjust_cb_additionals(zone_node_t *node, adjust_ctx_t *ctx);
 
 // adjust_cb_flags and adjust_cb_nsec3_pointer at once
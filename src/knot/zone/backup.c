@@ -74,36 +74,88 @@ int zone_backup_init(bool restore_mode, bool forced, const char *backup_dir,
 	ctx->failed = false;
 	ctx->init_time = time(NULL);
 	ctx->zone_count = 0;
+	ctx->bck_timers = NULL;
 	ctx->backup_dir = (char *)(ctx + 1);
 	memcpy(ctx->backup_dir, backup_dir, backup_dir_len);
 
+	if (!restore_mode) {
+		ctx->bck_timers = trie_create(NULL);
+		if (ctx->bck_timers == NULL) {
+			free(ctx);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	// Backup directory, lock file, label file.
 	// In restore, set the backup format.
 	int ret = backupdir_init(ctx);
 	if (ret != KNOT_EOK) {
+		trie_free(ctx->bck_timers);
 		free(ctx);
 		return ret;
 	}
 
 	pthread_mutex_init(&ctx->readers_mutex, NULL);
 
+	// The zones are backed up in parallel by the background workers, so
+	// the backup databases are synced once when finished, not per commit.
+	unsigned env_flags = restore_mode ? 0 : MDB_NOSYNC;
+
 	char db_dir[backup_dir_len + 16];
 	(void)snprintf(db_dir, sizeof(db_dir), "%s/keys", backup_dir);
-	knot_lmdb_init(&ctx->bck_kasp_db, db_dir, kasp_db_size, 0, "keys_db");
+	knot_lmdb_init(&ctx->bck_kasp_db, db_dir, kasp_db_size, env_flags, "keys_db");
 
 	(void)snprintf(db_dir, sizeof(db_dir), "%s/timers", backup_dir);
-	knot_lmdb_init(&ctx->bck_timer_db, db_dir, timer_db_size, 0, NULL);
+	knot_lmdb_init(&ctx->bck_timer_db, db_dir, timer_db_size, env_flags, NULL);
 
 	(void)snprintf(db_dir, sizeof(db_dir), "%s/journal", backup_dir);
-	knot_lmdb_init(&ctx->bck_journal, db_dir, journal_db_size, 0, NULL);
+	knot_lmdb_init(&ctx->bck_journal, db_dir, journal_db_size, env_flags, NULL);
 
 	(void)snprintf(db_dir, sizeof(db_dir), "%s/catalog", backup_dir);
-	knot_lmdb_init(&ctx->bck_catalog, db_dir, catalog_db_size, 0, NULL);
+	knot_lmdb_init(&ctx->bck_catalog, db_dir, catalog_db_size, env_flags, NULL);
 
 	*out_ctx = ctx;
 	return KNOT_EOK;
 }
 
+static int free_timers(trie_val_t *val, _unused_ void *ctx)
+{
+	free(*val);
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Store the collected timers and sync the databases written without syncing.
+ */
+static int backup_finish(zone_backup_ctx_t *ctx)
+{
+	int ret = KNOT_EOK;
+	if (trie_weight(ctx->bck_timers) > 0) {
+		ret = knot_lmdb_open(&ctx->bck_timer_db);
+		if (ret == KNOT_EOK) {
+			ret = zone_timers_write_all(&ctx->bck_timer_db, ctx->bck_timers);
+		}
+		if (ret != KNOT_EOK) {
+			log_error("failed to store timers in %s (%s)", ctx->backup_dir,
+			          knot_strerror(ret));
+			return ret;
+		}
+	}
+
+	knot_lmdb_db_t *dbs[] = {
+		&ctx->bck_kasp_db, &ctx->bck_timer_db, &ctx->bck_journal, &ctx->bck_catalog
+	};
+	for (int i = 0; i < sizeof(dbs) / sizeof(*dbs) && ret == KNOT_EOK; i++) {
+		ret = knot_lmdb_sync(dbs[i]);
+	}
+	if (ret != KNOT_EOK) {
+		log_error("failed to sync backup in %s (%s)", ctx->backup_dir,
+		          knot_strerror(ret));
+	}
+
+	return ret;
+}
+
 int zone_backup_deinit(zone_backup_ctx_t *ctx)
 {
 	if (ctx == NULL) {
@@ -118,13 +170,25 @@ int zone_backup_deinit(zone_backup_ctx_t *ctx)
 	pthread_mutex_unlock(&ctx->readers_mutex);
 
 	if (left == 0) {
+		if (!ctx->restore_mode) {
+			if (!ctx->failed) {
+				ret = backup_finish(ctx);
+				ctx->failed = (ret != KNOT_EOK);
+			}
+			trie_apply(ctx->bck_timers, free_timers, NULL);
+			trie_free(ctx->bck_timers);
+		}
+
 		knot_lmdb_deinit(&ctx->bck_catalog);
 		knot_lmdb_deinit(&ctx->bck_journal);
 		knot_lmdb_deinit(&ctx->bck_timer_db);
 		knot_lmdb_deinit(&ctx->bck_kasp_db);
 		pthread_mutex_destroy(&ctx->readers_mutex);
 
-		ret = backupdir_deinit(ctx);
+		int ret_dir = backupdir_deinit(ctx);
+		if (ret == KNOT_EOK) {
+			ret = ret_dir;
+		}
 		zone_backups_rem(ctx);
 		free(ctx);
 	}
@@ -290,7 +354,7 @@ static int backup_zonefile(conf_t *conf, zone_t *zone, zone_backup_ctx_t *ctx)
 		if (ret == KNOT_EOK) {
 			if (can_flush) {
 				if (zone->contents != NULL) {
-					ret = zonefile_write(backup_zf, zone->contents);
+					ret = zonefile_write(backup_zf, zone->contents, 1);
 				} else {
 					log_zone_notice(zone->name,
 					                "empty zone, skipping a zone file backup");
@@ -369,6 +433,30 @@ done:
 	return ret;
 }
 
+static int collect_timers(zone_backup_ctx_t *ctx, zone_t *zone)
+{
+	zone_timers_t *timers = malloc(sizeof(*timers));
+	if (timers == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*timers = zone->timers;
+
+	pthread_mutex_lock(&ctx->readers_mutex);
+	trie_val_t *val = trie_get_ins(ctx->bck_timers, (const trie_key_t *)zone->name,
+	                               knot_dname_size(zone->name));
+	if (val != NULL) {
+		free(*val);
+		*val = timers;
+	}
+	pthread_mutex_unlock(&ctx->readers_mutex);
+
+	if (val == NULL) {
+		free(timers);
+		return KNOT_ENOMEM;
+	}
+	return KNOT_EOK;
+}
+
 int zone_backup(conf_t *conf, zone_t *zone)
 {
 	zone_backup_ctx_t *ctx = zone->backup_ctx;
@@ -419,18 +507,21 @@ int zone_backup(conf_t *conf, zone_t *zone)
 		goto done;
 	}
 
-	if (ctx->backup_timers) {
+	if (ctx->backup_timers && ctx->restore_mode) {
 		ret = knot_lmdb_open(&ctx->bck_timer_db);
 		if (ret != KNOT_EOK) {
 			LOG_MARK_FAIL("timers open");
 			goto done;
 		}
-		if (ctx->restore_mode) {
-			ret = zone_timers_read(&ctx->bck_timer_db, zone->name, &zone->timers);
-			zone_timers_sanitize(conf, zone);
-		} else {
-			ret = zone_timers_write(&ctx->bck_timer_db, zone->name, &zone->timers);
+		ret = zone_timers_read(&ctx->bck_timer_db, zone->name, &zone->timers);
+		zone_timers_sanitize(conf, zone);
+		if (ret != KNOT_EOK) {
+			LOG_MARK_FAIL("timers");
+			goto done;
 		}
+	} else if (ctx->backup_timers) {
+		// The timers of all the zones are stored in one transaction when finished.
+		ret = collect_timers(ctx, zone);
 		if (ret != KNOT_EOK) {
 			LOG_MARK_FAIL("timers");
 			goto done;
@@ -40,12 +40,13 @@ typedef struct zone_backup_ctx {
 	bool backup_catalog;                // if true, also backup zone catalog (default on)
 	bool backup_global;                 // perform global backup for all zones
 	ssize_t readers;                    // when decremented to 0, all zones done, free this context
-	pthread_mutex_t readers_mutex;      // mutex covering readers counter
+	pthread_mutex_t readers_mutex;      // mutex covering readers counter and collected timers
 	char *backup_dir;                   // path of directory to backup to / restore from
 	knot_lmdb_db_t bck_kasp_db;         // backup KASP db
 	knot_lmdb_db_t bck_timer_db;        // backup timer DB
 	knot_lmdb_db_t bck_journal;         // backup journal DB
 	knot_lmdb_db_t bck_catalog;         // backup catalog DB
+	trie_t *bck_timers;                 // timers of the backed up zones, stored at once when finished
 	bool failed;                        // true if an error occurred in processing of any zone
 	knot_backup_format_t backup_format; // the backup format version used
 	time_t init_time;                   // time when the current backup operation has started
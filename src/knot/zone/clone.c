@@ -0,0 +1,258 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <urcu.h>
+
+#include "knot/zone/clone.h"
+#include "knot/server/server.h"
+#include "libknot/libknot.h"
+
+typedef struct {
+	zone_contents_t *contents;
+	const knot_dname_t *from;   // Apex of the source.
+	size_t from_labels;
+	const knot_dname_t *to;     // Apex of the clone.
+	uint8_t *buf;               // Rdata being moved.
+} clone_ctx_t;
+
+static bool cloned_type(uint16_t type)
+{
+	switch (type) {
+	case KNOT_RRTYPE_RRSIG:
+	case KNOT_RRTYPE_NSEC:
+	case KNOT_RRTYPE_NSEC3:
+	case KNOT_RRTYPE_NSEC3PARAM:
+	case KNOT_RRTYPE_DNSKEY:
+	case KNOT_RRTYPE_CDS:
+	case KNOT_RRTYPE_CDNSKEY:
+	case KNOT_RRTYPE_ZONEMD:
+		return false;
+	default:
+		return true;
+	}
+}
+
+/*! \brief Writes the name moved under the clone apex if within the source zone. */
+static int rebase_name(const clone_ctx_t *ctx, const knot_dname_t *name,
+                       uint8_t *out, size_t max)
+{
+	const knot_dname_t *res = name;
+	knot_dname_t *moved = NULL;
+	if (knot_dname_in_bailiwick(name, ctx->from) >= 0) {
+		moved = knot_dname_replace_suffix(name, ctx->from_labels, ctx->to, NULL);
+		if (moved == NULL) {
+			return KNOT_ENOMEM;
+		}
+		res = moved;
+	}
+
+	size_t size = knot_dname_size(res);
+	if (size > max) {
+		knot_dname_free(moved, NULL);
+		return KNOT_ESPACE;
+	}
+	memcpy(out, res, size);
+	knot_dname_free(moved, NULL);
+
+	return size;
+}
+
+/*! \brief Copies the rdata moving the domain names, returns the new length. */
+static int rebase_rdata(const clone_ctx_t *ctx, uint16_t type, const knot_rdata_t *rd,
+                        uint8_t *out, size_t max)
+{
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(type);
+	if (desc->type_name == NULL) {
+		desc = knot_get_obsolete_rdata_descriptor(type);
+	}
+
+	const uint8_t *pos = rd->data, *end = rd->data + rd->len;
+	size_t len = 0;
+	int ret;
+
+	for (int i = 0; desc->block_types[i] != KNOT_RDATA_WF_END && pos < end; i++) {
+		int block = desc->block_types[i];
+		size_t block_len;
+		switch (block) {
+		case KNOT_RDATA_WF_COMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_DECOMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_FIXED_DNAME:
+			ret = rebase_name(ctx, pos, out + len, max - len);
+			if (ret < 0) {
+				return ret;
+			}
+			pos += knot_dname_size(pos);
+			len += ret;
+			continue;
+		case KNOT_RDATA_WF_NAPTR_HEADER:
+			ret = knot_naptr_header_size(pos, end);
+			if (ret < 0) {
+				return ret;
+			}
+			block_len = ret;
+			break;
+		case KNOT_RDATA_WF_REMAINDER:
+			block_len = end - pos;
+			break;
+		default:
+			assert(block > 0);
+			block_len = block;
+		}
+		if (block_len > end - pos || block_len > max - len) {
+			return KNOT_EMALF;
+		}
+		memcpy(out + len, pos, block_len);
+		pos += block_len;
+		len += block_len;
+	}
+
+	if (pos < end) {
+		return KNOT_EMALF;
+	}
+
+	return len;
+}
+
+static int clone_node(zone_node_t *node, void *data)
+{
+	clone_ctx_t *ctx = data;
+
+	knot_dname_storage_t owner;
+	int ret = rebase_name(ctx, node->owner, owner, sizeof(owner));
+	if (ret < 0) {
+		return ret;
+	}
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		if (!cloned_type(rrset.type)) {
+			continue;
+		}
+
+		knot_rrset_t copy;
+		knot_rrset_init(&copy, owner, rrset.type, rrset.rclass, rrset.ttl);
+
+		knot_rdata_t *rd = rrset.rrs.rdata;
+		for (uint16_t j = 0; j < rrset.rrs.count && ret >= 0; j++) {
+			ret = rebase_rdata(ctx, rrset.type, rd, ctx->buf, KNOT_RDATA_MAXLEN);
+			if (ret >= 0) {
+				ret = knot_rrset_add_rdata(&copy, ctx->buf, ret, NULL);
+			}
+			rd = knot_rdataset_next(rd);
+		}
+
+		zone_node_t *unused = NULL;
+		if (ret >= 0) {
+			ret = zone_contents_add_rr(ctx->contents, &copy, &unused);
+		}
+		knot_rdataset_clear(&copy.rrs, NULL);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int zone_clone_contents(const zone_contents_t *source, const knot_dname_t *apex,
+                        zone_contents_t **out)
+{
+	if (source == NULL || apex == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	clone_ctx_t ctx = {
+		.contents = zone_contents_new(apex, true),
+		.from = source->apex->owner,
+		.from_labels = knot_dname_labels(source->apex->owner, NULL),
+		.to = apex,
+		.buf = malloc(KNOT_RDATA_MAXLEN),
+	};
+	if (ctx.contents == NULL || ctx.buf == NULL) {
+		zone_contents_free(ctx.contents);
+		free(ctx.buf);
+		return KNOT_ENOMEM;
+	}
+
+	// The NSEC3 tree holds only the DNSSEC records.
+	int ret = zone_tree_apply(source->nodes, clone_node, &ctx);
+	free(ctx.buf);
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(ctx.contents);
+		return ret;
+	}
+
+	*out = ctx.contents;
+	return KNOT_EOK;
+}
+
+int zone_clone_load(conf_t *conf, zone_t *zone, zone_contents_t **out)
+{
+	if (conf == NULL || zone == NULL || out == NULL || zone->server == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_CLONE_SOURCE, zone->name);
+	const knot_dname_t *source_name = conf_dname(&val);
+	if (source_name == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	// Cloning from a clone could loop the propagation of the changes.
+	val = conf_zone_get(conf, C_CLONE_SOURCE, source_name);
+	if (val.code == KNOT_EOK || knot_dname_is_equal(source_name, zone->name)) {
+		return KNOT_EDENIED;
+	}
+
+	rcu_read_lock();
+	int ret = KNOT_ENOENT;
+	zone_t *source = knot_zonedb_find(zone->server->zone_db, source_name);
+	if (source != NULL) {
+		// Let the source know it has to propagate its changes.
+		zone_set_flag(source, ZONE_IS_CLONE_SOURCE);
+		zone_contents_t *contents = rcu_dereference(source->contents);
+		if (contents != NULL) {
+			ret = zone_clone_contents(contents, zone->name, out);
+		}
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+static void reload_clone(zone_t *zone, conf_t *conf, const knot_dname_t *source)
+{
+	conf_val_t val = conf_zone_get(conf, C_CLONE_SOURCE, zone->name);
+	if (val.code == KNOT_EOK && knot_dname_is_equal(conf_dname(&val), source)) {
+		zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
+	}
+}
+
+void zone_clone_propagate(conf_t *conf, zone_t *zone)
+{
+	if (conf == NULL || zone == NULL || zone->server == NULL ||
+	    !zone_get_flag(zone, ZONE_IS_CLONE_SOURCE, false)) {
+		return;
+	}
+
+	// Not a usual case, the clones aren't indexed.
+	rcu_read_lock();
+	knot_zonedb_foreach(zone->server->zone_db, reload_clone, conf, zone->name);
+	rcu_read_unlock();
+}
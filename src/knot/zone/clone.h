@@ -0,0 +1,64 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Zones instantiated from the contents of another zone.
+ *
+ * A clone zone has no zone file nor primary, its contents are a copy of
+ * the current contents of the source zone with the owners and the in-zone
+ * names in the rdata moved under the apex of the clone. Any change of
+ * the source zone reloads all its clones.
+ */
+
+#pragma once
+
+#include "knot/conf/conf.h"
+#include "knot/zone/zone.h"
+
+/*!
+ * \brief Creates the contents of a clone.
+ *
+ * The DNSSEC records of the source are not copied as they can't be valid
+ * for the clone.
+ *
+ * \param source  Contents of the source zone.
+ * \param apex    Apex of the clone.
+ * \param out     [out] New contents.
+ *
+ * \return KNOT_E*
+ */
+int zone_clone_contents(const zone_contents_t *source, const knot_dname_t *apex,
+                        zone_contents_t **out);
+
+/*!
+ * \brief Creates the contents of a clone zone from its configured source zone.
+ *
+ * \param conf  Configuration.
+ * \param zone  Clone zone.
+ * \param out   [out] New contents.
+ *
+ * \retval KNOT_ENOENT if the source zone isn't loaded (yet).
+ * \return KNOT_E*
+ */
+int zone_clone_load(conf_t *conf, zone_t *zone, zone_contents_t **out);
+
+/*!
+ * \brief Schedules reload of the clones after the source zone changed.
+ *
+ * \param conf  Configuration.
+ * \param zone  Possible source zone.
+ */
+void zone_clone_propagate(conf_t *conf, zone_t *zone);
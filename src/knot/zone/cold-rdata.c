@@ -0,0 +1,150 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/zone/cold-rdata.h"
+#include "contrib/hugepool.h"
+#include "libknot/libknot.h"
+
+static struct {
+	pthread_mutex_t mx;
+	hp_pool_t pool;
+	bool init;
+	size_t bytes;
+} cold = { .mx = PTHREAD_MUTEX_INITIALIZER };
+
+int cold_rdata_init(const char *dir)
+{
+	int ret = KNOT_EOK;
+
+	pthread_mutex_lock(&cold.mx);
+	if (!cold.init) {
+		ret = hp_pool_init_cold(&cold.pool, dir);
+		cold.init = (ret == KNOT_EOK);
+	}
+	pthread_mutex_unlock(&cold.mx);
+
+	return ret;
+}
+
+void cold_rdata_deinit(void)
+{
+	pthread_mutex_lock(&cold.mx);
+	if (cold.init) {
+		hp_pool_deinit(&cold.pool);
+		cold.init = false;
+		cold.bytes = 0;
+	}
+	pthread_mutex_unlock(&cold.mx);
+}
+
+static int move_node(zone_node_t *node, void *data)
+{
+	size_t *moved = data;
+	zone_node_t *counter = binode_counterpart(node);
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		struct rr_data *rr = &node->rrs[i];
+		if (rr->type != KNOT_RRTYPE_RRSIG ||
+		    (rr->flags & (RR_DATA_COLD | RR_DATA_MAPPED)) ||
+		    rr->rrs.size == 0 || rr->rrs.size > HP_MAX_BLOCK) {
+			continue;
+		}
+		// The other half would keep a dangling pointer.
+		if (counter != NULL && counter->rrs != node->rrs &&
+		    binode_rdata_shared(node, rr->type)) {
+			continue;
+		}
+
+		void *copy = hp_alloc(&cold.pool, rr->rrs.size);
+		if (copy == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memcpy(copy, rr->rrs.rdata, rr->rrs.size);
+		free(rr->rrs.rdata);
+		rr->rrs.rdata = copy;
+		rr->flags |= RR_DATA_COLD;
+		*moved += rr->rrs.size;
+	}
+
+	return KNOT_EOK;
+}
+
+int cold_rdata_move(zone_tree_t *tree)
+{
+	if (!cold.init) {
+		return KNOT_EINVAL;
+	}
+
+	size_t moved = 0;
+	int ret = zone_tree_apply(tree, move_node, &moved);
+	__atomic_add_fetch(&cold.bytes, moved, __ATOMIC_RELAXED);
+
+	// Make the moved pages the first candidates for reclaim.
+	if (moved > 0) {
+		hp_pool_advise_cold(&cold.pool);
+	}
+
+	return ret;
+}
+
+int cold_rdata_warm(struct rr_data *data)
+{
+	if (!(data->flags & RR_DATA_COLD)) {
+		return KNOT_EOK;
+	}
+
+	void *copy = malloc(data->rrs.size);
+	if (copy == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(copy, data->rrs.rdata, data->rrs.size);
+
+	(void)cold_rdata_release(data);
+	data->rrs.rdata = copy;
+
+	return KNOT_EOK;
+}
+
+bool cold_rdata_release(struct rr_data *data)
+{
+	if (!(data->flags & RR_DATA_COLD)) {
+		return false;
+	}
+
+	__atomic_sub_fetch(&cold.bytes, data->rrs.size, __ATOMIC_RELAXED);
+	hp_free(data->rrs.rdata);
+	data->rrs.rdata = NULL;
+	data->flags &= ~RR_DATA_COLD;
+
+	return true;
+}
+
+void cold_rdata_stats(cold_rdata_stats_t *stats)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cold.mx);
+	stats->bytes = __atomic_load_n(&cold.bytes, __ATOMIC_RELAXED);
+	stats->mapped = cold.init ? __atomic_load_n(&cold.pool.mapped, __ATOMIC_RELAXED) : 0;
+	pthread_mutex_unlock(&cold.mx);
+}
@@ -0,0 +1,89 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Out-of-line storage of the RRSIG rdata.
+ *
+ * The signatures make most of the memory of a signed zone, but they are
+ * needed only for the DNSSEC queries. Moving them into a separate pool keeps
+ * the other rdata denser in the heap and lets the kernel reclaim the pool
+ * memory first, optionally to a backing file instead of swap.
+ *
+ * The moved rdata are marked with RR_DATA_COLD and must not be reallocated
+ * in place, see cold_rdata_warm().
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "knot/zone/contents.h"
+
+typedef struct {
+	size_t bytes;   /*!< Size of the rdata in the pool. */
+	size_t mapped;  /*!< Memory mapped by the pool. */
+} cold_rdata_stats_t;
+
+/*!
+ * \brief Initializes the pool unless already initialized.
+ *
+ * \param dir  Directory for the backing file, NULL for anonymous memory.
+ *
+ * \note The directory of an initialized pool can't be changed.
+ *
+ * \return KNOT_E*
+ */
+int cold_rdata_init(const char *dir);
+
+/*!
+ * \brief Releases the pool, all the moved rdata must be freed before.
+ */
+void cold_rdata_deinit(void);
+
+/*!
+ * \brief Moves the RRSIG rdata of the nodes in the tree into the pool.
+ *
+ * The nodes must not be published yet. The rdata shared with the other half
+ * of a bi-node in a separate RRSet array are skipped.
+ *
+ * \param tree  Zone tree or a tree of the changed nodes of an update.
+ *
+ * \return KNOT_E*
+ */
+int cold_rdata_move(zone_tree_t *tree);
+
+/*!
+ * \brief Moves the rdata back to the heap so that they can be modified.
+ *
+ * \note No-op if the rdata aren't in the pool.
+ *
+ * \return KNOT_E*
+ */
+int cold_rdata_warm(struct rr_data *data);
+
+/*!
+ * \brief Frees the rdata if stored in the pool.
+ *
+ * \return True if the rdata were freed.
+ */
+bool cold_rdata_release(struct rr_data *data);
+
+/*!
+ * \brief Gets the pool usage.
+ */
+void cold_rdata_stats(cold_rdata_stats_t *stats);
@@ -275,6 +275,16 @@ int zone_contents_find_dname(const zone_contents_t *zone,
                              const zone_node_t **match,
                              const zone_node_t **closest,
                              const zone_node_t **previous)
+{
+	return zone_contents_find_dname_lf(zone, name, NULL, match, closest, previous);
+}
+
+int zone_contents_find_dname_lf(const zone_contents_t *zone,
+                                const knot_dname_t *name,
+                                const uint8_t *lf,
+                                const zone_node_t **match,
+                                const zone_node_t **closest,
+                                const zone_node_t **previous)
 {
 	if (name == NULL || match == NULL || closest == NULL) {
 		return KNOT_EINVAL;
@@ -288,10 +298,15 @@ int zone_contents_find_dname(const zone_contents_t *zone,
 		return KNOT_EOUTOFZONE;
 	}
 
+	knot_dname_storage_t lf_storage;
+	if (lf == NULL) {
+		lf = knot_dname_lf(name, lf_storage);
+	}
+
 	zone_node_t *node = NULL;
 	zone_node_t *prev = NULL;
 
-	int found = zone_tree_get_less_or_equal(zone->nodes, name, &node, &prev);
+	int found = zone_tree_get_less_or_equal_lf(zone->nodes, lf, &node, &prev);
 	if (found < 0) {
 		// error
 		return found;
@@ -345,6 +360,24 @@ const zone_node_t *zone_contents_find_nsec3_node(const zone_contents_t *zone,
 	return get_nsec3_node(zone, name);
 }
 
+/*!
+ * \brief Skips the preceding NSEC3 nodes not from the current NSEC3 chain.
+ */
+static const zone_node_t *nsec3_chain_previous(const zone_node_t *prev)
+{
+	// The previous may be from wrong NSEC3 chain. Search for previous from the right chain.
+	const zone_node_t *original_prev = prev;
+	while (prev != NULL && !(prev->flags & NODE_FLAGS_IN_NSEC3_CHAIN)) {
+		prev = node_prev(prev);
+		if (prev == original_prev) {
+			// cycle
+			return NULL;
+		}
+	}
+
+	return prev;
+}
+
 int zone_contents_find_nsec3_for_name(const zone_contents_t *zone,
                                       const knot_dname_t *name,
                                       const zone_node_t **nsec3_node,
@@ -366,6 +399,29 @@ int zone_contents_find_nsec3_for_name(const zone_contents_t *zone,
 		return KNOT_ENSEC3PAR;
 	}
 
+	if (zone->nsec3_index != NULL) {
+		dnssec_binary_t data = {
+			.data = (uint8_t *)name,
+			.size = knot_dname_size(name)
+		};
+		dnssec_binary_t hash = { 0 };
+		int ret = dnssec_nsec3_hash(&data, &zone->nsec3_params, &hash);
+		if (ret != DNSSEC_EOK) {
+			return knot_error_from_libdnssec(ret);
+		}
+
+		zone_node_t *found = NULL, *prev = NULL;
+		ret = nsec3_index_find(zone->nsec3_index, zone->nsec3_nodes,
+		                       hash.data, hash.size, &found, &prev);
+		dnssec_binary_free(&hash);
+		if (ret >= 0) {
+			*nsec3_node = found;
+			*nsec3_previous = nsec3_chain_previous(prev);
+			return (ret > 0 ? ZONE_NAME_FOUND : ZONE_NAME_NOT_FOUND);
+		}
+		// Hash length not matching the index, fall back to the tree.
+	}
+
 	knot_dname_storage_t nsec3_name;
 	int ret = knot_create_nsec3_owner(nsec3_name, sizeof(nsec3_name),
 	                                  name, zone->apex->owner, &zone->nsec3_params);
@@ -376,6 +432,66 @@ int zone_contents_find_nsec3_for_name(const zone_contents_t *zone,
 	return zone_contents_find_nsec3(zone, nsec3_name, nsec3_node, nsec3_previous);
 }
 
+int zone_contents_find_nsec3_cached(const zone_contents_t *zone,
+                                    const knot_dname_t *name,
+                                    const zone_node_t **nsec3_node,
+                                    const zone_node_t **nsec3_previous)
+{
+	if (zone == NULL || name == NULL || nsec3_node == NULL || nsec3_previous == NULL) {
+		return zone_contents_find_nsec3_for_name(zone, name, nsec3_node, nsec3_previous);
+	}
+
+	nsec3_cache_t *cache = __atomic_load_n(&zone->nsec3_cache, __ATOMIC_ACQUIRE);
+	int match;
+	if (nsec3_cache_get(cache, name, &match, nsec3_node, nsec3_previous)) {
+		return match;
+	}
+
+	match = zone_contents_find_nsec3_for_name(zone, name, nsec3_node, nsec3_previous);
+	if (match < 0) {
+		return match;
+	}
+
+	if (cache == NULL) {
+		// The contents are shared by the answering threads, the first one installs the cache.
+		nsec3_cache_t *new = nsec3_cache_new();
+		nsec3_cache_t *expected = NULL;
+		if (new != NULL && !__atomic_compare_exchange_n(&((zone_contents_t *)zone)->nsec3_cache,
+		                                                &expected, new, false,
+		                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			nsec3_cache_free(new);
+			new = expected;
+		}
+		cache = new;
+	}
+	nsec3_cache_put(cache, name, match, *nsec3_node, *nsec3_previous);
+
+	return match;
+}
+
+referral_cache_t *zone_contents_referral_cache(const zone_contents_t *contents, size_t size)
+{
+	if (contents == NULL) {
+		return NULL;
+	}
+
+	referral_cache_t *cache = __atomic_load_n(&contents->referrals, __ATOMIC_ACQUIRE);
+	if (cache == NULL) {
+		// Like the NSEC3 cache, the first answering thread installs the cache.
+		referral_cache_t *new = referral_cache_new(size);
+		referral_cache_t *expected = NULL;
+		if (new != NULL && !__atomic_compare_exchange_n(&((zone_contents_t *)contents)->referrals,
+		                                                &expected, new, false,
+		                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			referral_cache_free(new);
+			new = expected;
+		}
+		cache = new;
+	}
+
+	return cache;
+}
+
 int zone_contents_find_nsec3(const zone_contents_t *zone,
                              const knot_dname_t *nsec3_name,
                              const zone_node_t **nsec3_node,
@@ -398,16 +514,7 @@ int zone_contents_find_nsec3(const zone_contents_t *zone,
 		*nsec3_previous = prev;
 	}
 
-	// The previous may be from wrong NSEC3 chain. Search for previous from the right chain.
-	const zone_node_t *original_prev = *nsec3_previous;
-	while (!((*nsec3_previous)->flags & NODE_FLAGS_IN_NSEC3_CHAIN)) {
-		*nsec3_previous = node_prev(*nsec3_previous);
-		if (*nsec3_previous == original_prev || *nsec3_previous == NULL) {
-			// cycle
-			*nsec3_previous = NULL;
-			break;
-		}
-	}
+	*nsec3_previous = nsec3_chain_previous(*nsec3_previous);
 
 	return (match ? ZONE_NAME_FOUND : ZONE_NAME_NOT_FOUND);
 }
@@ -425,6 +532,41 @@ const zone_node_t *zone_contents_find_wildcard_child(const zone_contents_t *cont
 	return zone_contents_find_node(contents, wildcard);
 }
 
+const zone_node_t *zone_contents_find_wildcard_child_cached(const zone_contents_t *contents,
+                                                            const zone_node_t *parent)
+{
+	if (contents == NULL) {
+		return NULL;
+	}
+
+	wildcard_cache_t *cache = __atomic_load_n(&contents->wildcards, __ATOMIC_ACQUIRE);
+	const zone_node_t *wildcard = wildcard_cache_get(cache, parent);
+	if (wildcard != NULL) {
+		return wildcard;
+	}
+
+	wildcard = zone_contents_find_wildcard_child(contents, parent);
+	if (wildcard == NULL) {
+		return NULL;
+	}
+
+	if (cache == NULL) {
+		// Like the NSEC3 cache, the first answering thread installs the cache.
+		wildcard_cache_t *new = wildcard_cache_new();
+		wildcard_cache_t *expected = NULL;
+		if (new != NULL && !__atomic_compare_exchange_n(&((zone_contents_t *)contents)->wildcards,
+		                                                &expected, new, false,
+		                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			wildcard_cache_free(new);
+			new = expected;
+		}
+		cache = new;
+	}
+	wildcard_cache_put(cache, parent, wildcard);
+
+	return wildcard;
+}
+
 bool zone_contents_find_node_or_wildcard(const zone_contents_t *contents,
                                          const knot_dname_t *find,
                                          const zone_node_t **found)
@@ -456,6 +598,19 @@ int zone_contents_nsec3_apply(zone_contents_t *contents,
 	return zone_tree_apply(contents->nsec3_nodes, function, data);
 }
 
+int zone_contents_set_mm(zone_contents_t *contents, knot_mm_t *mm)
+{
+	if (contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = zone_tree_set_mm(contents->nodes, mm);
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_set_mm(contents->nsec3_nodes, mm);
+	}
+	return ret;
+}
+
 int zone_contents_cow(zone_contents_t *from, zone_contents_t **to)
 {
 	if (to == NULL) {
@@ -494,6 +649,7 @@ int zone_contents_cow(zone_contents_t *from, zone_contents_t **to)
 	}
 	contents->adds_tree = from->adds_tree;
 	from->adds_tree = NULL;
+	contents->nsec3_index = nsec3_index_ref(from->nsec3_index);
 	contents->size = from->size;
 	contents->max_ttl = from->max_ttl;
 
@@ -512,6 +668,10 @@ void zone_contents_free(zone_contents_t *contents)
 	zone_tree_free(&contents->nsec3_nodes);
 
 	dnssec_nsec3_params_free(&contents->nsec3_params);
+	nsec3_cache_free(contents->nsec3_cache);
+	nsec3_index_free(contents->nsec3_index);
+	referral_cache_free(contents->referrals);
+	wildcard_cache_free(contents->wildcards);
 	additionals_tree_free(contents->adds_tree);
 
 	free(contents);
@@ -568,6 +728,13 @@ int zone_contents_load_nsec3param(zone_contents_t *contents)
 		return KNOT_EINVAL;
 	}
 
+	nsec3_cache_free(contents->nsec3_cache);
+	contents->nsec3_cache = NULL;
+	referral_cache_free(contents->referrals);
+	contents->referrals = NULL;
+	wildcard_cache_free(contents->wildcards);
+	contents->wildcards = NULL;
+
 	const knot_rdataset_t *rrs = NULL;
 	rrs = node_rdataset(contents->apex, KNOT_RRTYPE_NSEC3PARAM);
 	if (rrs == NULL) {
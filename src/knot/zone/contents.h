@@ -19,6 +19,10 @@
 #include "libdnssec/nsec.h"
 #include "libknot/rrtype/nsec3param.h"
 #include "knot/zone/node.h"
+#include "knot/zone/nsec3-cache.h"
+#include "knot/zone/nsec3-index.h"
+#include "knot/zone/referral-cache.h"
+#include "knot/zone/wildcard-cache.h"
 #include "knot/zone/zone-tree.h"
 
 enum zone_contents_find_dname_result {
@@ -35,11 +39,23 @@ typedef struct zone_contents {
 	trie_t *adds_tree; // "additionals tree" for reverse lookup of nodes affected by additionals
 
 	dnssec_nsec3_params_t nsec3_params;
+	nsec3_cache_t *nsec3_cache; // Allocated on the first cached lookup.
+	nsec3_index_t *nsec3_index; // Built when adjusted, NULL during an update.
+	referral_cache_t *referrals; // Allocated on the first cached referral.
+	wildcard_cache_t *wildcards; // Allocated on the first cached wildcard lookup.
 	size_t size;
 	uint32_t max_ttl;
 	bool dnssec;
 } zone_contents_t;
 
+/*! \brief Memory allocated by zone contents, in bytes, without allocator overhead. */
+typedef struct {
+	size_t trees;       /*!< Search trees of the nodes (NSEC3 and its index included). */
+	size_t nodes;       /*!< Nodes, their owners and RRSet arrays. */
+	size_t rdata;       /*!< Record data. */
+	size_t additionals; /*!< Glue arrays and the reverse additionals tree. */
+} zone_memory_t;
+
 /*!
  * \brief Allocate and create new zone contents.
  *
@@ -133,6 +149,19 @@ int zone_contents_find_dname(const zone_contents_t *contents,
                              const zone_node_t **closest,
                              const zone_node_t **previous);
 
+/*!
+ * \brief Same as zone_contents_find_dname() with the name optionally already
+ *        converted to the lookup format.
+ *
+ * \param[in]  lf  Name in the lookup format (see knot_dname_lf()), or NULL.
+ */
+int zone_contents_find_dname_lf(const zone_contents_t *contents,
+                                const knot_dname_t *name,
+                                const uint8_t *lf,
+                                const zone_node_t **match,
+                                const zone_node_t **closest,
+                                const zone_node_t **previous);
+
 /*!
  * \brief Tries to find a node with the specified name among the NSEC3 nodes
  *        of the zone.
@@ -172,6 +201,28 @@ int zone_contents_find_nsec3_for_name(const zone_contents_t *contents,
                                       const zone_node_t **nsec3_node,
                                       const zone_node_t **nsec3_previous);
 
+/*!
+ * \brief Same as zone_contents_find_nsec3_for_name(), with the results cached.
+ *
+ * \note Only for the published (not changing) contents, e.g. when answering.
+ */
+int zone_contents_find_nsec3_cached(const zone_contents_t *contents,
+                                    const knot_dname_t *name,
+                                    const zone_node_t **nsec3_node,
+                                    const zone_node_t **nsec3_previous);
+
+/*!
+ * \brief Returns the cache of the rendered referrals, creates it if needed.
+ *
+ * \note Only for the published (not changing) contents, e.g. when answering.
+ *
+ * \param contents  Zone contents.
+ * \param size      Number of the cache entries if created.
+ *
+ * \return Referral cache or NULL if error.
+ */
+referral_cache_t *zone_contents_referral_cache(const zone_contents_t *contents, size_t size);
+
 /*!
  * \brief Finds NSEC3 node and previous NSEC3 node to specified NSEC3 name.
  *
@@ -200,6 +251,14 @@ int zone_contents_find_nsec3(const zone_contents_t *zone,
 const zone_node_t *zone_contents_find_wildcard_child(const zone_contents_t *contents,
                                                      const zone_node_t *parent);
 
+/*!
+ * \brief Same as zone_contents_find_wildcard_child(), with the results cached.
+ *
+ * \note Only for the published (not changing) contents, e.g. when answering.
+ */
+const zone_node_t *zone_contents_find_wildcard_child_cached(const zone_contents_t *contents,
+                                                            const zone_node_t *parent);
+
 /*!
  * \brief For given name, find either exactly matching node in zone, or a matching wildcard node.
  *
@@ -234,6 +293,18 @@ int zone_contents_apply(zone_contents_t *contents,
 int zone_contents_nsec3_apply(zone_contents_t *contents,
                               zone_tree_apply_cb_t function, void *data);
 
+/*!
+ * \brief Move the zone tries to a different memory context.
+ *
+ * The following COW copies of the contents keep using the context.
+ *
+ * \param contents  Zone contents, not in the middle of an update.
+ * \param mm        Memory context, must outlive the contents and its copies.
+ *
+ * \return KNOT_E*
+ */
+int zone_contents_set_mm(zone_contents_t *contents, knot_mm_t *mm);
+
 /*!
  * \brief Create new zone_contents by COW copy of zone trees.
  *
@@ -14,11 +14,13 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 
 #include "knot/zone/digest.h"
 #include "knot/dnssec/rrset-sign.h"
 #include "knot/updates/zone-update.h"
+#include "contrib/qp-trie/trie.h"
 #include "contrib/wire_ctx.h"
 #include "libdnssec/digest.h"
 #include "libknot/libknot.h"
@@ -26,13 +28,40 @@
 #define DIGEST_BUF_MIN 4096
 #define DIGEST_BUF_MAX (40 * 1024 * 1024)
 
+#define DIGEST_BATCH 1024 // Nodes serialized by one thread at once.
+#define DIGEST_PIPE_DEPTH 2 // Serialized batches per thread waiting for hashing.
+
+typedef struct {
+	uint8_t *data;
+	size_t size;
+	size_t max;
+	bool ready; // Waiting for hashing, owned by the hashing thread.
+} digest_chunk_t;
+
 typedef struct {
 	size_t buf_size;
 	uint8_t *buf;
-	struct dnssec_digest_ctx *digest_ctx;
+	struct dnssec_digest_ctx *digest_ctx; // Either hash directly...
+	digest_chunk_t *chunk;                // ...or append to the chunk.
 	const zone_node_t *apex;
 } contents_digest_ctx_t;
 
+static int chunk_append(digest_chunk_t *chunk, const uint8_t *data, size_t len)
+{
+	if (chunk->size + len > chunk->max) {
+		size_t new_max = MAX(2 * chunk->max, chunk->size + len);
+		uint8_t *new_data = realloc(chunk->data, new_max);
+		if (new_data == NULL) {
+			return KNOT_ENOMEM;
+		}
+		chunk->data = new_data;
+		chunk->max = new_max;
+	}
+	memcpy(chunk->data + chunk->size, data, len);
+	chunk->size += len;
+	return KNOT_EOK;
+}
+
 static int digest_rrset(knot_rrset_t *rrset, const zone_node_t *node, void *vctx)
 {
 	contents_digest_ctx_t *ctx = vctx;
@@ -85,6 +114,9 @@ static int digest_rrset(knot_rrset_t *rrset, const zone_node_t *node, void *vctx
 	}
 
 	// digest serialized RRSet
+	if (ctx->chunk != NULL) {
+		return chunk_append(ctx->chunk, ctx->buf, ret);
+	}
 	dnssec_binary_t bufbin = { ret, ctx->buf };
 	return dnssec_digest(ctx->digest_ctx, &bufbin);
 }
@@ -99,8 +131,200 @@ static int digest_node(zone_node_t *node, void *ctx)
 	return ret;
 }
 
+typedef struct digest_pipe digest_pipe_t;
+
+typedef struct {
+	contents_digest_ctx_t ctx;
+	digest_pipe_t *pipe;
+	unsigned thr_id;
+	size_t produced;  // Count of published batches.
+	bool finished;
+	pthread_t thread;
+	digest_chunk_t chunks[DIGEST_PIPE_DEPTH];
+} digest_producer_t;
+
+struct digest_pipe {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	zone_tree_t *tree;
+	unsigned threads;
+	int ret;          // First error, stops all the threads.
+	digest_producer_t *prods;
+};
+
+static digest_chunk_t *chunk_acquire(digest_producer_t *prod)
+{
+	digest_pipe_t *pipe = prod->pipe;
+	digest_chunk_t *chunk = &prod->chunks[prod->produced % DIGEST_PIPE_DEPTH];
+
+	pthread_mutex_lock(&pipe->lock);
+	while (chunk->ready && pipe->ret == KNOT_EOK) {
+		pthread_cond_wait(&pipe->cond, &pipe->lock);
+	}
+	bool ok = (pipe->ret == KNOT_EOK);
+	pthread_mutex_unlock(&pipe->lock);
+
+	chunk->size = 0;
+	return ok ? chunk : NULL;
+}
+
+static void chunk_publish(digest_producer_t *prod, digest_chunk_t *chunk)
+{
+	digest_pipe_t *pipe = prod->pipe;
+
+	pthread_mutex_lock(&pipe->lock);
+	chunk->ready = true;
+	prod->produced++;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+/*!
+ * \brief Serializes every threads-th batch of nodes in the canonical order.
+ */
+static void *digest_producer_thread(void *arg)
+{
+	digest_producer_t *prod = arg;
+	digest_pipe_t *pipe = prod->pipe;
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin(pipe->tree, &it);
+	for (size_t i = 0; ret == KNOT_EOK && !zone_tree_it_finished(&it); i++) {
+		if ((i / DIGEST_BATCH) % pipe->threads == prod->thr_id) {
+			if (prod->ctx.chunk == NULL &&
+			    (prod->ctx.chunk = chunk_acquire(prod)) == NULL) {
+				break; // Stopped by another thread.
+			}
+			ret = digest_node(zone_tree_it_val(&it), &prod->ctx);
+		} else if (prod->ctx.chunk != NULL) {
+			chunk_publish(prod, prod->ctx.chunk);
+			prod->ctx.chunk = NULL;
+		}
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+	if (ret == KNOT_EOK && prod->ctx.chunk != NULL) {
+		chunk_publish(prod, prod->ctx.chunk);
+	}
+	prod->ctx.chunk = NULL;
+
+	pthread_mutex_lock(&pipe->lock);
+	if (ret != KNOT_EOK && pipe->ret == KNOT_EOK) {
+		pipe->ret = ret;
+	}
+	prod->finished = true;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+
+	return NULL;
+}
+
+/*!
+ * \brief Hashes the batches serialized by the producers in the canonical order.
+ */
+static int digest_consume(digest_pipe_t *pipe, struct dnssec_digest_ctx *digest_ctx)
+{
+	int ret = KNOT_EOK;
+	for (size_t batch = 0; ret == KNOT_EOK; batch++) {
+		digest_producer_t *prod = &pipe->prods[batch % pipe->threads];
+		size_t seq = batch / pipe->threads;
+		digest_chunk_t *chunk = &prod->chunks[seq % DIGEST_PIPE_DEPTH];
+
+		pthread_mutex_lock(&pipe->lock);
+		while (!chunk->ready && !(prod->finished && prod->produced <= seq) &&
+		       pipe->ret == KNOT_EOK) {
+			pthread_cond_wait(&pipe->cond, &pipe->lock);
+		}
+		ret = pipe->ret;
+		bool ready = chunk->ready;
+		pthread_mutex_unlock(&pipe->lock);
+
+		// The batches are dealt round-robin, the first missing one is the end.
+		if (ret != KNOT_EOK || !ready) {
+			break;
+		}
+
+		if (chunk->size > 0) {
+			dnssec_binary_t bin = { chunk->size, chunk->data };
+			ret = knot_error_from_libdnssec(dnssec_digest(digest_ctx, &bin));
+		}
+
+		pthread_mutex_lock(&pipe->lock);
+		chunk->ready = false;
+		if (ret != KNOT_EOK) {
+			pipe->ret = ret;
+		}
+		pthread_cond_broadcast(&pipe->cond);
+		pthread_mutex_unlock(&pipe->lock);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Digest the tree with the RRSets canonicalized in parallel.
+ *
+ * As the SIMPLE scheme hashes one stream, the threads serialize the batches
+ * of nodes and the calling thread hashes them in the canonical order.
+ */
+static int digest_tree_parallel(zone_tree_t *tree, const zone_node_t *apex,
+                                struct dnssec_digest_ctx *digest_ctx, unsigned threads)
+{
+	digest_producer_t prods[threads];
+	memset(prods, 0, sizeof(prods));
+	digest_pipe_t pipe = {
+		.tree = tree,
+		.threads = threads,
+		.prods = prods,
+	};
+	pthread_mutex_init(&pipe.lock, NULL);
+	pthread_cond_init(&pipe.cond, NULL);
+
+	int ret = KNOT_EOK;
+	unsigned started = 0;
+	for ( ; started < threads; started++) {
+		digest_producer_t *prod = &prods[started];
+		prod->pipe = &pipe;
+		prod->thr_id = started;
+		prod->ctx.apex = apex;
+		prod->ctx.buf_size = DIGEST_BUF_MIN;
+		prod->ctx.buf = malloc(DIGEST_BUF_MIN);
+		if (prod->ctx.buf == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		int thr_ret = pthread_create(&prod->thread, NULL, digest_producer_thread, prod);
+		if (thr_ret != 0) {
+			free(prod->ctx.buf);
+			ret = knot_map_errno_code(thr_ret);
+			break;
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = digest_consume(&pipe, digest_ctx);
+	} else {
+		pthread_mutex_lock(&pipe.lock);
+		pipe.ret = ret;
+		pthread_cond_broadcast(&pipe.cond);
+		pthread_mutex_unlock(&pipe.lock);
+	}
+
+	for (unsigned i = 0; i < started; i++) {
+		(void)pthread_join(prods[i].thread, NULL);
+		free(prods[i].ctx.buf);
+		for (unsigned j = 0; j < DIGEST_PIPE_DEPTH; j++) {
+			free(prods[i].chunks[j].data);
+		}
+	}
+	pthread_cond_destroy(&pipe.cond);
+	pthread_mutex_destroy(&pipe.lock);
+
+	return ret;
+}
+
 int zone_contents_digest(const zone_contents_t *contents, int algorithm,
-                         uint8_t **out_digest, size_t *out_size)
+                         unsigned threads, uint8_t **out_digest, size_t *out_size)
 {
 	if (out_digest == NULL || out_size == NULL) {
 		return KNOT_EINVAL;
@@ -136,7 +360,9 @@ int zone_contents_digest(const zone_contents_t *contents, int algorithm,
 		}
 	}
 
-	if (ret == KNOT_EOK) {
+	if (ret == KNOT_EOK && threads > 1 && zone_tree_count(conts) > DIGEST_BATCH) {
+		ret = digest_tree_parallel(conts, contents->apex, ctx.digest_ctx, threads);
+	} else if (ret == KNOT_EOK) {
 		ret = zone_tree_apply(conts, digest_node, &ctx);
 	}
 
@@ -154,11 +380,12 @@ int zone_contents_digest(const zone_contents_t *contents, int algorithm,
 	return ret;
 }
 
-static int verify_zonemd(const knot_rdata_t *zonemd, const zone_contents_t *contents)
+static int verify_zonemd(const knot_rdata_t *zonemd, const zone_contents_t *contents,
+                         unsigned threads)
 {
 	uint8_t *computed = NULL;
 	size_t comp_size = 0;
-	int ret = zone_contents_digest(contents, knot_zonemd_algorithm(zonemd),
+	int ret = zone_contents_digest(contents, knot_zonemd_algorithm(zonemd), threads,
 	                               &computed, &comp_size);
 	if (ret != KNOT_EOK) {
 		return ret;
@@ -193,7 +420,7 @@ bool zone_contents_digest_exists(const zone_contents_t *contents, int alg, bool
 		return true;
 	}
 
-	return verify_zonemd(zonemd->rdata, contents) == KNOT_EOK;
+	return verify_zonemd(zonemd->rdata, contents, 1) == KNOT_EOK;
 }
 
 static bool check_duplicate_schalg(const knot_rdataset_t *zonemd, int check_upto,
@@ -211,7 +438,7 @@ static bool check_duplicate_schalg(const knot_rdataset_t *zonemd, int check_upto
 	return true;
 }
 
-int zone_contents_digest_verify(const zone_contents_t *contents)
+int zone_contents_digest_verify(const zone_contents_t *contents, unsigned threads)
 {
 	if (contents == NULL) {
 		return KNOT_EEMPTYZONE;
@@ -238,7 +465,395 @@ int zone_contents_digest_verify(const zone_contents_t *contents)
 		rr = knot_rdataset_next(rr);
 	}
 
-	return supported == NULL ? KNOT_ENOTSUP : verify_zonemd(supported, contents);
+	return supported == NULL ? KNOT_ENOTSUP : verify_zonemd(supported, contents, threads);
+}
+
+struct zone_digest_cache {
+	pthread_mutex_t lock;
+	const zone_contents_t *contents; // Contents the serialization corresponds to.
+	trie_t *ranges;                  // First owner (LF) -> digest_range_t.
+};
+
+typedef struct {
+	digest_chunk_t wire; // Serialized nodes up to the next range, except apex.
+	bool dirty;
+} digest_range_t;
+
+typedef struct {
+	knot_dname_storage_t lo;
+	knot_dname_storage_t hi;
+	size_t lo_len;
+	size_t hi_len; // Zero if the last range.
+	digest_range_t *range;
+} dirty_range_t;
+
+/*! \brief Iterator over both zone trees in the canonical order. */
+typedef struct {
+	trie_it_t *it[2];
+	zone_tree_t *tree[2];
+} digest_it_t;
+
+static int key_cmp(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len)
+{
+	int ret = memcmp(a, b, MIN(a_len, b_len));
+	return ret != 0 ? ret : (a_len > b_len) - (a_len < b_len);
+}
+
+static void digest_it_free(digest_it_t *dit)
+{
+	for (int i = 0; i < 2; i++) {
+		trie_it_free(dit->it[i]);
+		dit->it[i] = NULL;
+	}
+}
+
+static int digest_it_begin(digest_it_t *dit, const zone_contents_t *contents,
+                           const uint8_t *lo, size_t lo_len)
+{
+	dit->tree[0] = contents->nodes;
+	dit->tree[1] = contents->nsec3_nodes;
+	for (int i = 0; i < 2; i++) {
+		dit->it[i] = NULL;
+		if (zone_tree_is_empty(dit->tree[i])) {
+			continue;
+		}
+		dit->it[i] = trie_it_begin(dit->tree[i]->trie);
+		if (dit->it[i] == NULL) {
+			digest_it_free(dit);
+			return KNOT_ENOMEM;
+		}
+		int ret = trie_it_get_leq(dit->it[i], lo, lo_len);
+		if (ret == 1) {
+			trie_it_next(dit->it[i]);
+		} else if (ret == KNOT_ENOENT) {
+			trie_it_free(dit->it[i]);
+			dit->it[i] = trie_it_begin(dit->tree[i]->trie);
+		} else if (ret != KNOT_EOK) {
+			digest_it_free(dit);
+			return ret;
+		}
+	}
+	return KNOT_EOK;
+}
+
+/*! \brief Returns the next node below the limit (if set) or NULL. */
+static zone_node_t *digest_it_next(digest_it_t *dit, const uint8_t *hi, size_t hi_len,
+                                   const uint8_t **key, size_t *key_len)
+{
+	int next = -1;
+	for (int i = 0; i < 2; i++) {
+		if (dit->it[i] == NULL || trie_it_finished(dit->it[i])) {
+			continue;
+		}
+		size_t len;
+		const uint8_t *k = (const uint8_t *)trie_it_key(dit->it[i], &len);
+		if (next < 0 || key_cmp(k, len, *key, *key_len) < 0) {
+			next = i;
+			*key = k;
+			*key_len = len;
+		}
+	}
+	if (next < 0 || (hi_len > 0 && key_cmp(*key, *key_len, hi, hi_len) >= 0)) {
+		return NULL;
+	}
+
+	zone_node_t *node = zone_tree_fix_get(*trie_it_val(dit->it[next]), dit->tree[next]);
+	trie_it_next(dit->it[next]);
+	return node;
+}
+
+static void range_free(digest_range_t *range)
+{
+	free(range->wire.data);
+	free(range);
+}
+
+static int range_free_cb(trie_val_t *val, void *ctx)
+{
+	range_free(*val);
+	return KNOT_EOK;
+}
+
+static void cache_clear(zone_digest_cache_t *cache)
+{
+	trie_apply(cache->ranges, range_free_cb, NULL);
+	trie_clear(cache->ranges);
+	cache->contents = NULL;
+}
+
+static digest_range_t *range_insert(zone_digest_cache_t *cache, const uint8_t *key,
+                                    size_t key_len)
+{
+	trie_val_t *val = trie_get_ins(cache->ranges, key, key_len);
+	if (val == NULL) {
+		return NULL;
+	}
+	if (*val == NULL) {
+		*val = calloc(1, sizeof(digest_range_t));
+	}
+	return *val;
+}
+
+/*!
+ * \brief Serializes the nodes from lo up to hi (or end), splits big ranges.
+ */
+static int range_fill(zone_digest_cache_t *cache, const zone_contents_t *contents,
+                      digest_range_t *range, const uint8_t *lo, size_t lo_len,
+                      const uint8_t *hi, size_t hi_len, contents_digest_ctx_t *ctx)
+{
+	digest_it_t dit;
+	int ret = digest_it_begin(&dit, contents, lo, lo_len);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	range->wire.size = 0;
+	range->dirty = false;
+	ctx->chunk = &range->wire;
+
+	const uint8_t *key = NULL;
+	size_t key_len = 0, count = 0;
+	zone_node_t *node;
+	while (ret == KNOT_EOK &&
+	       (node = digest_it_next(&dit, hi, hi_len, &key, &key_len)) != NULL) {
+		if (node == contents->apex) {
+			continue;
+		}
+		if (++count > DIGEST_BATCH) {
+			digest_range_t *split = range_insert(cache, key, key_len);
+			if (split == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			split->wire.size = 0;
+			split->dirty = false;
+			ctx->chunk = &split->wire;
+			count = 1;
+		}
+		ret = digest_node(node, ctx);
+	}
+	ctx->chunk = NULL;
+	digest_it_free(&dit);
+
+	return ret;
+}
+
+static int cache_rebuild(zone_digest_cache_t *cache, const zone_contents_t *contents,
+                         contents_digest_ctx_t *ctx)
+{
+	cache_clear(cache);
+
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(contents->apex->owner, lf_storage);
+	digest_range_t *range = range_insert(cache, lf + 1, *lf);
+	if (range == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return range_fill(cache, contents, range, lf + 1, *lf, NULL, 0, ctx);
+}
+
+static void mark_dirty(zone_digest_cache_t *cache, zone_tree_t *tree)
+{
+	zone_tree_it_t it = { 0 };
+	if (zone_tree_is_empty(tree) || zone_tree_it_begin(tree, &it) != KNOT_EOK) {
+		return;
+	}
+	for ( ; !zone_tree_it_finished(&it); zone_tree_it_next(&it)) {
+		knot_dname_storage_t lf_storage;
+		uint8_t *lf = knot_dname_lf(zone_tree_it_val(&it)->owner, lf_storage);
+		trie_val_t *val = NULL;
+		(void)trie_get_leq(cache->ranges, lf + 1, *lf, &val);
+		if (val != NULL) {
+			((digest_range_t *)*val)->dirty = true;
+		}
+	}
+	zone_tree_it_free(&it);
+}
+
+/*!
+ * \brief Serializes again only the ranges touched by the changeset.
+ */
+static int cache_update(zone_digest_cache_t *cache, const zone_contents_t *contents,
+                        const changeset_t *ch, contents_digest_ctx_t *ctx)
+{
+	mark_dirty(cache, ch->add->nodes);
+	mark_dirty(cache, ch->add->nsec3_nodes);
+	mark_dirty(cache, ch->remove->nodes);
+	mark_dirty(cache, ch->remove->nsec3_nodes);
+
+	// Collect the dirty ranges first as splitting modifies the trie.
+	size_t count = 0;
+	trie_it_t *it = trie_it_begin(cache->ranges);
+	for ( ; it != NULL && !trie_it_finished(it); trie_it_next(it)) {
+		count += ((digest_range_t *)*trie_it_val(it))->dirty ? 1 : 0;
+	}
+	trie_it_free(it);
+	if (count == 0) {
+		return KNOT_EOK;
+	}
+
+	dirty_range_t *dirty = calloc(count, sizeof(*dirty));
+	if (dirty == NULL) {
+		return KNOT_ENOMEM;
+	}
+	size_t i = 0;
+	dirty_range_t *prev = NULL;
+	it = trie_it_begin(cache->ranges);
+	for ( ; it != NULL && !trie_it_finished(it); trie_it_next(it)) {
+		size_t len;
+		const trie_key_t *key = trie_it_key(it, &len);
+		if (prev != NULL) {
+			memcpy(prev->hi, key, len);
+			prev->hi_len = len;
+			prev = NULL;
+		}
+		digest_range_t *range = *trie_it_val(it);
+		if (range->dirty) {
+			prev = &dirty[i++];
+			memcpy(prev->lo, key, len);
+			prev->lo_len = len;
+			prev->range = range;
+		}
+	}
+	trie_it_free(it);
+
+	int ret = (i == count) ? KNOT_EOK : KNOT_ENOMEM;
+	for (i = 0; i < count && ret == KNOT_EOK; i++) {
+		ret = range_fill(cache, contents, dirty[i].range, dirty[i].lo, dirty[i].lo_len,
+		                 dirty[i].hi, dirty[i].hi_len, ctx);
+	}
+	free(dirty);
+
+	return ret;
+}
+
+static int cache_digest(zone_digest_cache_t *cache, const zone_contents_t *contents,
+                        int algorithm, contents_digest_ctx_t *ctx, dnssec_binary_t *res)
+{
+	int ret = dnssec_digest_init(algorithm, &ctx->digest_ctx);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	// The apex changes with every update (SOA serial), it isn't cached.
+	ret = digest_node(contents->apex, ctx);
+
+	trie_it_t *it = trie_it_begin(cache->ranges);
+	if (it == NULL && ret == KNOT_EOK) {
+		ret = KNOT_ENOMEM;
+	}
+	for ( ; ret == KNOT_EOK && !trie_it_finished(it); trie_it_next(it)) {
+		digest_range_t *range = *trie_it_val(it);
+		if (range->wire.size > 0) {
+			dnssec_binary_t bin = { range->wire.size, range->wire.data };
+			ret = knot_error_from_libdnssec(dnssec_digest(ctx->digest_ctx, &bin));
+		}
+	}
+	trie_it_free(it);
+
+	if (ret == KNOT_EOK) {
+		ret = knot_error_from_libdnssec(dnssec_digest_finish(ctx->digest_ctx, res));
+	}
+	return ret;
+}
+
+static int digest_cached(zone_update_t *update, int algorithm,
+                         uint8_t **out_digest, size_t *out_size)
+{
+	zone_digest_cache_t *cache = update->zone->digest_cache;
+	const zone_contents_t *contents = update->new_cont;
+
+	contents_digest_ctx_t ctx = {
+		.buf_size = DIGEST_BUF_MIN,
+		.buf = malloc(DIGEST_BUF_MIN),
+		.apex = contents->apex,
+	};
+	if (ctx.buf == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+
+	// The changeset describes the changes from the current zone contents.
+	bool incremental = (update->flags & UPDATE_INCREMENTAL) &&
+	                   !(update->flags & UPDATE_NO_CHSET) &&
+	                   cache->contents != NULL &&
+	                   (cache->contents == update->zone->contents ||
+	                    cache->contents == contents);
+	int ret = incremental ? cache_update(cache, contents, &update->change, &ctx) :
+	                        cache_rebuild(cache, contents, &ctx);
+
+	dnssec_binary_t res = { 0 };
+	if (ret == KNOT_EOK) {
+		cache->contents = contents;
+		ret = cache_digest(cache, contents, algorithm, &ctx, &res);
+	}
+	if (ret != KNOT_EOK) {
+		cache_clear(cache);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	free(ctx.buf);
+	*out_digest = res.data;
+	*out_size = res.size;
+	return ret;
+}
+
+zone_digest_cache_t *zone_digest_cache_new(void)
+{
+	zone_digest_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->ranges = trie_create(NULL);
+	if (cache->ranges == NULL) {
+		free(cache);
+		return NULL;
+	}
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return cache;
+}
+
+void zone_digest_cache_free(zone_digest_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	cache_clear(cache);
+	trie_free(cache->ranges);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache);
+}
+
+void zone_digest_cache_switch(zone_digest_cache_t *cache, const zone_contents_t *contents)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (cache->contents != contents) {
+		cache_clear(cache);
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void zone_digest_cache_discard(zone_digest_cache_t *cache, const zone_contents_t *contents)
+{
+	if (cache == NULL || contents == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&cache->lock);
+	if (cache->contents == contents) {
+		cache_clear(cache);
+	}
+	pthread_mutex_unlock(&cache->lock);
 }
 
 static ptrdiff_t zonemd_hash_offs(void)
@@ -267,7 +882,15 @@ int zone_update_add_digest(struct zone_update *update, int algorithm, bool place
 			return KNOT_EOK;
 		}
 	} else {
-		int ret = zone_contents_digest(update->new_cont, algorithm, &digest, &dsize);
+		int ret;
+		conf_val_t val = conf_zone_get(conf(), C_ZONEMD_CACHE, update->zone->name);
+		if (conf_bool(&val) && update->zone->digest_cache != NULL) {
+			ret = digest_cached(update, algorithm, &digest, &dsize);
+		} else {
+			val = conf_zone_get(conf(), C_ADJUST_THR, update->zone->name);
+			ret = zone_contents_digest(update->new_cont, algorithm, conf_int(&val),
+			                           &digest, &dsize);
+		}
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
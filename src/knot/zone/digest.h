@@ -18,18 +18,28 @@
 
 #include "knot/zone/contents.h"
 
+/*!
+ * \brief Cached canonical serialization of the zone for ZONEMD computation.
+ *
+ * The serialized zone nodes are kept in ranges, so that only the ranges
+ * affected by an incremental update are serialized again. The digest is
+ * still computed over the whole serialized zone.
+ */
+typedef struct zone_digest_cache zone_digest_cache_t;
+
 /*!
  * \brief Compute hash over whole zone by concatenating RRSets in wire format.
  *
  * \param contents     Zone contents to digest.
  * \param algorithm    Algorithm to use.
+ * \param threads      Canonicalize the RRSets using specified threads.
  * \param out_digest   Output: buffer with computed hash (to be freed).
  * \param out_size     Output: size of the resulting hash.
  *
  * \return KNOT_E*
  */
 int zone_contents_digest(const zone_contents_t *contents, int algorithm,
-                         uint8_t **out_digest, size_t *out_size);
+                         unsigned threads, uint8_t **out_digest, size_t *out_size);
 
 /*!
  * \brief Check whether exactly one ZONEMD exists in the zone, is valid and matches given algorithm.
@@ -46,6 +56,7 @@ bool zone_contents_digest_exists(const zone_contents_t *contents, int alg, bool
  * \brief Verify zone dgest in ZONEMD record.
  *
  * \param contents   Zone contents ot be verified.
+ * \param threads    Canonicalize the RRSets using specified threads.
  *
  * \retval KNOT_EEMPTYZONE  The zone is empty.
  * \retval KNOT_ENOENT      There is no ZONEMD in contents' apex.
@@ -55,7 +66,7 @@ bool zone_contents_digest_exists(const zone_contents_t *contents, int alg, bool
  * \retval KNOT_EMALF       The computed hash differs from ZONEMD.
  * \return KNOT_E*
  */
-int zone_contents_digest_verify(const zone_contents_t *contents);
+int zone_contents_digest_verify(const zone_contents_t *contents, unsigned threads);
 
 struct zone_update;
 /*!
@@ -65,8 +76,32 @@ struct zone_update;
  * \param algorithm     ZONEMD algorithm.
  * \param placeholder   Don't calculate, just put placeholder (if ZONEMD not yet present).
  *
+ * \note The digest is computed using the configured adjust-threads or
+ *       incrementally using the zone's cache if zonemd-cache is enabled.
  * \note Special value 255 of algorithm means to remove ZONEMD.
  *
  * \return KNOT_E*
  */
 int zone_update_add_digest(struct zone_update *update, int algorithm, bool placeholder);
+
+/*!
+ * \brief Allocate an empty ZONEMD cache.
+ *
+ * \return Cache or NULL if error.
+ */
+zone_digest_cache_t *zone_digest_cache_new(void);
+
+/*!
+ * \brief Free the ZONEMD cache.
+ */
+void zone_digest_cache_free(zone_digest_cache_t *cache);
+
+/*!
+ * \brief Keep the cache only if it corresponds to the new zone contents.
+ */
+void zone_digest_cache_switch(zone_digest_cache_t *cache, const zone_contents_t *contents);
+
+/*!
+ * \brief Empty the cache if it corresponds to the discarded zone contents.
+ */
+void zone_digest_cache_discard(zone_digest_cache_t *cache, const zone_contents_t *contents);
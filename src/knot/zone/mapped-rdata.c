@@ -0,0 +1,410 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "knot/zone/mapped-rdata.h"
+#include "contrib/files.h"
+#include "libknot/libknot.h"
+
+#define IMAGE_MAGIC      "KNOTZRDT"
+#define IMAGE_VERSION    1
+#define IMAGE_BYTE_ORDER 0x01020304
+#define IMAGE_DATA_OFF   4096
+#define IMAGE_ALIGN      8
+
+/*
+ * Image layout (host byte order, the rdata are stored as in memory):
+ *
+ *   header (padded to IMAGE_DATA_OFF) rdataset... (each aligned to IMAGE_ALIGN)
+ *
+ * The rdatasets follow the order of the zone trees (the regular nodes first,
+ * then the NSEC3 nodes), so the image is verified against the contents while
+ * attaching and an image of other contents is never used.
+ */
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint8_t id[MAPPED_RDATA_ID_MAXLEN];
+	uint64_t size;     // Size of the image file.
+	uint64_t sets;     // Number of the rdatasets.
+} image_hdr_t;
+
+typedef struct {
+	uint8_t *base;
+	size_t size;
+	size_t refs;
+} segment_t;
+
+static struct {
+	pthread_mutex_t mx;
+	segment_t *segs;   // Sorted by the base address.
+	size_t count;
+	size_t bytes;
+	size_t mapped;
+} images = { .mx = PTHREAD_MUTEX_INITIALIZER };
+
+typedef struct {
+	FILE *file;
+	const uint8_t *base;
+	size_t size;
+	size_t offset;
+	uint64_t sets;
+	size_t bytes;
+} walk_ctx_t;
+
+static bool mappable(const struct rr_data *rr)
+{
+	return rr->type != KNOT_RRTYPE_SOA && rr->rrs.size > 0 &&
+	       !(rr->flags & (RR_DATA_COLD | RR_DATA_MAPPED));
+}
+
+static size_t align_offset(size_t offset)
+{
+	return (offset + IMAGE_ALIGN - 1) & ~(size_t)(IMAGE_ALIGN - 1);
+}
+
+static int write_node(zone_node_t *node, void *data)
+{
+	walk_ctx_t *ctx = data;
+	static const uint8_t pad[IMAGE_ALIGN] = { 0 };
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		const struct rr_data *rr = &node->rrs[i];
+		if (!mappable(rr)) {
+			continue;
+		}
+
+		size_t aligned = align_offset(ctx->offset);
+		if ((aligned > ctx->offset &&
+		     fwrite(pad, aligned - ctx->offset, 1, ctx->file) != 1) ||
+		    fwrite(rr->rrs.rdata, rr->rrs.size, 1, ctx->file) != 1) {
+			return KNOT_EFILE;
+		}
+		ctx->offset = aligned + rr->rrs.size;
+		ctx->sets++;
+	}
+
+	return KNOT_EOK;
+}
+
+static int verify_node(zone_node_t *node, void *data)
+{
+	walk_ctx_t *ctx = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		const struct rr_data *rr = &node->rrs[i];
+		if (!mappable(rr)) {
+			continue;
+		}
+
+		ctx->offset = align_offset(ctx->offset);
+		if (ctx->offset + rr->rrs.size > ctx->size ||
+		    memcmp(ctx->base + ctx->offset, rr->rrs.rdata, rr->rrs.size) != 0) {
+			return KNOT_EMALF;
+		}
+		ctx->offset += rr->rrs.size;
+		ctx->bytes += rr->rrs.size;
+		ctx->sets++;
+	}
+
+	return KNOT_EOK;
+}
+
+static int map_node(zone_node_t *node, void *data)
+{
+	walk_ctx_t *ctx = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		struct rr_data *rr = &node->rrs[i];
+		if (!mappable(rr)) {
+			continue;
+		}
+
+		ctx->offset = align_offset(ctx->offset);
+		free(rr->rrs.rdata);
+		rr->rrs.rdata = (knot_rdata_t *)(ctx->base + ctx->offset);
+		rr->flags |= RR_DATA_MAPPED;
+		ctx->offset += rr->rrs.size;
+	}
+
+	return KNOT_EOK;
+}
+
+static int apply_all(zone_contents_t *contents, zone_tree_apply_cb_t cb, walk_ctx_t *ctx)
+{
+	int ret = zone_tree_apply(contents->nodes, cb, ctx);
+	if (ret == KNOT_EOK) {
+		ret = zone_tree_apply(contents->nsec3_nodes, cb, ctx);
+	}
+	return ret;
+}
+
+static int write_image(zone_contents_t *contents, const char *path, image_hdr_t *hdr)
+{
+	walk_ctx_t ctx = { .offset = IMAGE_DATA_OFF };
+	char *tmp_name = NULL;
+	int ret = open_tmp_file(path, &tmp_name, &ctx.file, S_IRUSR|S_IWUSR|S_IRGRP);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (fseek(ctx.file, IMAGE_DATA_OFF, SEEK_SET) != 0) {
+		ret = KNOT_EFILE;
+	} else {
+		ret = apply_all(contents, write_node, &ctx);
+	}
+	if (ret == KNOT_EOK) {
+		hdr->size = ctx.offset;
+		hdr->sets = ctx.sets;
+		// The file is extended to the data offset even if no rdata were written.
+		if (fseek(ctx.file, 0, SEEK_SET) != 0 ||
+		    fwrite(hdr, sizeof(*hdr), 1, ctx.file) != 1 ||
+		    fflush(ctx.file) != 0 ||
+		    ftruncate(fileno(ctx.file), ctx.offset) != 0) {
+			ret = KNOT_EFILE;
+		}
+	}
+	if (fclose(ctx.file) != 0 && ret == KNOT_EOK) {
+		ret = KNOT_EFILE;
+	}
+
+	/* Other processes keep their mapping of the replaced image. */
+	if (ret == KNOT_EOK && rename(tmp_name, path) != 0) {
+		ret = knot_map_errno();
+	}
+	if (ret != KNOT_EOK) {
+		unlink(tmp_name);
+	}
+	free(tmp_name);
+
+	return ret;
+}
+
+static int map_image(const char *path, const image_hdr_t *expect,
+                     uint8_t **base, size_t *size, uint64_t *sets)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return knot_map_errno();
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int ret = knot_map_errno();
+		close(fd);
+		return ret;
+	}
+	if (st.st_size < IMAGE_DATA_OFF) {
+		close(fd);
+		return KNOT_EMALF;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return knot_map_errno();
+	}
+
+	const image_hdr_t *hdr = data;
+	if (memcmp(hdr->magic, expect->magic, sizeof(hdr->magic)) != 0 ||
+	    hdr->version != expect->version || hdr->byte_order != expect->byte_order ||
+	    memcmp(hdr->id, expect->id, sizeof(hdr->id)) != 0 ||
+	    hdr->size != st.st_size) {
+		munmap(data, st.st_size);
+		return KNOT_ESEMCHECK;
+	}
+
+	*base = data;
+	*size = st.st_size;
+	*sets = hdr->sets;
+
+	return KNOT_EOK;
+}
+
+static int map_verified(zone_contents_t *contents, const char *path,
+                        const image_hdr_t *expect, walk_ctx_t *ctx)
+{
+	uint8_t *base = NULL;
+	size_t size = 0;
+	uint64_t sets = 0;
+	int ret = map_image(path, expect, &base, &size, &sets);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	*ctx = (walk_ctx_t){ .base = base, .size = size, .offset = IMAGE_DATA_OFF };
+	ret = apply_all(contents, verify_node, ctx);
+	if (ret == KNOT_EOK && (ctx->sets != sets || ctx->offset != size)) {
+		ret = KNOT_EMALF;
+	}
+	if (ret != KNOT_EOK) {
+		munmap(base, size);
+	}
+
+	return ret;
+}
+
+static segment_t *find_segment(const uint8_t *ptr)
+{
+	size_t lo = 0, hi = images.count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		segment_t *seg = &images.segs[mid];
+		if (ptr < seg->base) {
+			hi = mid;
+		} else if (ptr >= seg->base + seg->size) {
+			lo = mid + 1;
+		} else {
+			return seg;
+		}
+	}
+
+	return NULL;
+}
+
+static int add_segment(uint8_t *base, size_t size, size_t refs, size_t bytes)
+{
+	segment_t *segs = realloc(images.segs, (images.count + 1) * sizeof(*segs));
+	if (segs == NULL) {
+		return KNOT_ENOMEM;
+	}
+	images.segs = segs;
+
+	size_t pos = 0;
+	while (pos < images.count && segs[pos].base < base) {
+		pos++;
+	}
+	memmove(&segs[pos + 1], &segs[pos], (images.count - pos) * sizeof(*segs));
+	segs[pos] = (segment_t){ .base = base, .size = size, .refs = refs };
+	images.count++;
+	images.bytes += bytes;
+	images.mapped += size;
+
+	return KNOT_EOK;
+}
+
+int mapped_rdata_attach(zone_contents_t *contents, const char *path,
+                        const uint8_t *id, size_t id_len)
+{
+	if (contents == NULL || path == NULL || id == NULL ||
+	    id_len > MAPPED_RDATA_ID_MAXLEN) {
+		return KNOT_EINVAL;
+	}
+
+	image_hdr_t hdr = {
+		.version = IMAGE_VERSION,
+		.byte_order = IMAGE_BYTE_ORDER,
+	};
+	memcpy(hdr.magic, IMAGE_MAGIC, sizeof(hdr.magic));
+	memcpy(hdr.id, id, id_len);
+
+	// The image is shared, it's rewritten only if it doesn't fit the contents.
+	walk_ctx_t ctx;
+	int ret = map_verified(contents, path, &hdr, &ctx);
+	if (ret != KNOT_EOK) {
+		ret = write_image(contents, path, &hdr);
+		if (ret == KNOT_EOK) {
+			ret = map_verified(contents, path, &hdr, &ctx);
+		}
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (ctx.sets == 0) {
+		munmap((void *)ctx.base, ctx.size);
+		return KNOT_EOK;
+	}
+
+	// Nothing refers to the new segment until the contents are published.
+	pthread_mutex_lock(&images.mx);
+	ret = add_segment((uint8_t *)ctx.base, ctx.size, ctx.sets, ctx.bytes);
+	pthread_mutex_unlock(&images.mx);
+	if (ret != KNOT_EOK) {
+		munmap((void *)ctx.base, ctx.size);
+		return ret;
+	}
+
+	ctx.offset = IMAGE_DATA_OFF;
+	(void)apply_all(contents, map_node, &ctx);
+
+	return KNOT_EOK;
+}
+
+int mapped_rdata_warm(struct rr_data *data)
+{
+	if (!(data->flags & RR_DATA_MAPPED)) {
+		return KNOT_EOK;
+	}
+
+	void *copy = malloc(data->rrs.size);
+	if (copy == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(copy, data->rrs.rdata, data->rrs.size);
+
+	(void)mapped_rdata_release(data);
+	data->rrs.rdata = copy;
+
+	return KNOT_EOK;
+}
+
+bool mapped_rdata_release(struct rr_data *data)
+{
+	if (!(data->flags & RR_DATA_MAPPED)) {
+		return false;
+	}
+
+	pthread_mutex_lock(&images.mx);
+	segment_t *seg = find_segment((const uint8_t *)data->rrs.rdata);
+	assert(seg != NULL && seg->refs > 0);
+	images.bytes -= data->rrs.size;
+	if (--seg->refs == 0) {
+		munmap(seg->base, seg->size);
+		images.mapped -= seg->size;
+		images.count--;
+		memmove(seg, seg + 1, (images.segs + images.count - seg) * sizeof(*seg));
+	}
+	pthread_mutex_unlock(&images.mx);
+
+	data->rrs.rdata = NULL;
+	data->flags &= ~RR_DATA_MAPPED;
+
+	return true;
+}
+
+void mapped_rdata_stats(mapped_rdata_stats_t *stats)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&images.mx);
+	stats->bytes = images.bytes;
+	stats->mapped = images.mapped;
+	pthread_mutex_unlock(&images.mx);
+}
@@ -0,0 +1,82 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Rdata mapped read-only from an image file shared by the processes.
+ *
+ * The image holds the rdatasets of zone contents in their in-memory layout.
+ * The rdata of the contents are replaced with pointers into a shared mapping
+ * of the image, so all the processes loading the same contents share one
+ * copy of the rdata in the page cache.
+ *
+ * The mapped rdata are marked with RR_DATA_MAPPED and must not be modified
+ * in place, see mapped_rdata_warm(). An image stays mapped as long as any
+ * rdataset refers to it.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "knot/zone/contents.h"
+
+/*! \brief Maximum length of the image identifier. */
+#define MAPPED_RDATA_ID_MAXLEN 64
+
+typedef struct {
+	size_t bytes;   /*!< Size of the rdata referring to the images. */
+	size_t mapped;  /*!< Size of the mapped images. */
+} mapped_rdata_stats_t;
+
+/*!
+ * \brief Replaces the rdata of the contents with the rdata mapped from the image.
+ *
+ * The image is (re)created if it doesn't exist or its identifier differs.
+ * The contents must not be published yet. SOA rdata are never mapped as
+ * the serial is modified in place.
+ *
+ * \param contents  Zone contents.
+ * \param path      Image file path.
+ * \param id        Identifier of the contents (e.g. a digest of their source).
+ * \param id_len    Length of the identifier.
+ *
+ * \return KNOT_E* (the contents are unchanged if error).
+ */
+int mapped_rdata_attach(zone_contents_t *contents, const char *path,
+                        const uint8_t *id, size_t id_len);
+
+/*!
+ * \brief Copies the rdata to the heap so that they can be modified.
+ *
+ * \note No-op if the rdata aren't mapped.
+ *
+ * \return KNOT_E*
+ */
+int mapped_rdata_warm(struct rr_data *data);
+
+/*!
+ * \brief Drops the reference to the image if the rdata are mapped.
+ *
+ * \return True if the rdata were mapped.
+ */
+bool mapped_rdata_release(struct rr_data *data);
+
+/*!
+ * \brief Gets the usage of the mapped images.
+ */
+void mapped_rdata_stats(mapped_rdata_stats_t *stats);
@@ -131,3 +131,56 @@ void knot_measure_finish_update(measure_t *m, zone_update_t *update)
 		break;
 	}
 }
+
+static void measure_tree_memory(zone_tree_t *tree, zone_memory_t *mem)
+{
+	if (tree == NULL) {
+		return;
+	}
+
+	mem->trees += sizeof(*tree) + trie_mem_size(tree->trie);
+
+	zone_tree_it_t it = { 0 };
+	if (zone_tree_it_begin(tree, &it) != KNOT_EOK) {
+		return;
+	}
+	for (; !zone_tree_it_finished(&it); zone_tree_it_next(&it)) {
+		const zone_node_t *node = zone_tree_it_val(&it);
+
+		// Bi-nodes are allocated together, the halves share the data.
+		size_t halves = (node->flags & NODE_FLAGS_BINODE) ? 2 : 1;
+		mem->nodes += halves * sizeof(*node) + knot_dname_size(node->owner) +
+		              node->rrset_count * sizeof(*node->rrs);
+		if (!(node->flags & NODE_FLAGS_NSEC3_NODE) && node->nsec3_hash != NULL) {
+			mem->nodes += knot_dname_size(node->nsec3_hash);
+		}
+		if (node->nsec3_wildcard_name != NULL) {
+			mem->nodes += knot_dname_size(node->nsec3_wildcard_name);
+		}
+
+		for (uint16_t i = 0; i < node->rrset_count; i++) {
+			const struct rr_data *rr = &node->rrs[i];
+			mem->rdata += rr->rrs.size;
+			if (rr->additional != NULL) {
+				mem->additionals += sizeof(*rr->additional) +
+				                    rr->additional->count * sizeof(glue_t);
+			}
+		}
+	}
+	zone_tree_it_free(&it);
+}
+
+void knot_measure_memory(zone_contents_t *contents, zone_memory_t *mem)
+{
+	memset(mem, 0, sizeof(*mem));
+	if (contents == NULL) {
+		return;
+	}
+
+	measure_tree_memory(contents->nodes, mem);
+	measure_tree_memory(contents->nsec3_nodes, mem);
+	mem->trees += nsec3_index_size(contents->nsec3_index);
+	if (contents->adds_tree != NULL) {
+		mem->additionals += trie_mem_size(contents->adds_tree);
+	}
+}
@@ -69,3 +69,13 @@ void knot_measure_finish_zone(measure_t *m, zone_contents_t *zone);
  * \param m        Measured results.
  */
 void knot_measure_finish_update(measure_t *m, zone_update_t *update);
+
+/*!
+ * \brief Measure memory allocated by the zone contents.
+ *
+ * \note This walks all the nodes of the zone.
+ *
+ * \param contents  Zone contents.
+ * \param mem       Output memory usage.
+ */
+void knot_measure_memory(zone_contents_t *contents, zone_memory_t *mem);
@@ -15,15 +15,25 @@
  */
 
 #include "knot/zone/node.h"
+#include "contrib/macros.h"
+#include "knot/zone/cold-rdata.h"
+#include "knot/zone/mapped-rdata.h"
+#include "knot/zone/shared-rdata.h"
 #include "libknot/libknot.h"
 
-void additional_clear(additional_t *additional)
+additional_t *additional_new(uint16_t count)
 {
+	additional_t *additional = malloc(sizeof(*additional) + count * sizeof(glue_t));
 	if (additional == NULL) {
-		return;
+		return NULL;
 	}
+	additional->count = count;
 
-	free(additional->glues);
+	return additional;
+}
+
+void additional_clear(additional_t *additional)
+{
 	free(additional);
 }
 
@@ -45,7 +55,10 @@ bool additional_equal(additional_t *a, additional_t *b)
 /*! \brief Clears allocated data in RRSet entry. */
 static void rr_data_clear(struct rr_data *data, knot_mm_t *mm)
 {
-	knot_rdataset_clear(&data->rrs, mm);
+	if (!cold_rdata_release(data) && !mapped_rdata_release(data) &&
+	    !shared_rdata_release(data->type, &data->rrs)) {
+		knot_rdataset_clear(&data->rrs, mm);
+	}
 	memset(data, 0, sizeof(*data));
 }
 
@@ -58,6 +71,9 @@ static int rr_data_from(const knot_rrset_t *rrset, struct rr_data *data, knot_mm
 	}
 	data->ttl = rrset->ttl;
 	data->type = rrset->type;
+	data->flags = 0;
+	data->wire_min = 0;
+	data->rrsig_wire_min = 0;
 	data->additional = NULL;
 
 	return KNOT_EOK;
@@ -107,18 +123,18 @@ static bool ttl_changed(struct rr_data *node_data, const knot_rrset_t *rrset)
 
 zone_node_t *node_new(const knot_dname_t *owner, bool binode, bool second, knot_mm_t *mm)
 {
-	zone_node_t *ret = mm_alloc(mm, (binode ? 2 : 1) * sizeof(zone_node_t));
+	/* The owner is stored right behind the node (or both bi-node halves). */
+	size_t nodes_size = (binode ? 2 : 1) * sizeof(zone_node_t);
+	size_t owner_size = knot_dname_size(owner);
+	zone_node_t *ret = mm_alloc(mm, nodes_size + owner_size);
 	if (ret == NULL) {
 		return NULL;
 	}
 	memset(ret, 0, sizeof(*ret));
 
 	if (owner) {
-		ret->owner = knot_dname_copy(owner, mm);
-		if (ret->owner == NULL) {
-			mm_free(mm, ret);
-			return NULL;
-		}
+		ret->owner = (knot_dname_t *)((uint8_t *)ret + nodes_size);
+		memcpy(ret->owner, owner, owner_size);
 	}
 
 	// Node is authoritative by default.
@@ -287,8 +303,6 @@ void node_free(zone_node_t *node, knot_mm_t *mm)
 		return;
 	}
 
-	knot_dname_free(node->owner, mm);
-
 	assert((node->flags & NODE_FLAGS_BINODE) || !(node->flags & NODE_FLAGS_SECOND));
 	assert(binode_counterpart(node) == NULL ||
 	       binode_counterpart(node)->nsec3_wildcard_name == node->nsec3_wildcard_name);
@@ -311,7 +325,7 @@ int node_add_rrset(zone_node_t *node, const knot_rrset_t *rrset, knot_mm_t *mm)
 		return KNOT_EINVAL;
 	}
 
-	node->flags &= ~NODE_FLAGS_RRSIGS_VALID;
+	node->flags &= ~(NODE_FLAGS_RRSIGS_VALID | NODE_FLAGS_WIRE_SIZES);
 
 	for (uint16_t i = 0; i < node->rrset_count; ++i) {
 		if (node->rrs[i].type == rrset->type) {
@@ -321,8 +335,14 @@ int node_add_rrset(zone_node_t *node, const knot_rrset_t *rrset, knot_mm_t *mm)
 				node_data->ttl = rrset->ttl;
 			}
 
-			int ret = knot_rdataset_merge(&node_data->rrs,
-			                              &rrset->rrs, mm);
+			int ret = cold_rdata_warm(node_data);
+			if (ret == KNOT_EOK) {
+				ret = mapped_rdata_warm(node_data);
+			}
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			ret = knot_rdataset_merge(&node_data->rrs, &rrset->rrs, mm);
 			if (ret != KNOT_EOK) {
 				return ret;
 			} else {
@@ -341,7 +361,7 @@ void node_remove_rdataset(zone_node_t *node, uint16_t type)
 		return;
 	}
 
-	node->flags &= ~NODE_FLAGS_RRSIGS_VALID;
+	node->flags &= ~(NODE_FLAGS_RRSIGS_VALID | NODE_FLAGS_WIRE_SIZES);
 
 	for (int i = 0; i < node->rrset_count; ++i) {
 		if (node->rrs[i].type == type) {
@@ -365,14 +385,28 @@ int node_remove_rrset(zone_node_t *node, const knot_rrset_t *rrset, knot_mm_t *m
 		return KNOT_EINVAL;
 	}
 
-	knot_rdataset_t *node_rrs = node_rdataset(node, rrset->type);
-	if (node_rrs == NULL) {
+	struct rr_data *data = NULL;
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		if (node->rrs[i].type == rrset->type) {
+			data = &node->rrs[i];
+			break;
+		}
+	}
+	if (data == NULL) {
 		return KNOT_ENOENT;
 	}
+	knot_rdataset_t *node_rrs = &data->rrs;
 
-	node->flags &= ~NODE_FLAGS_RRSIGS_VALID;
+	node->flags &= ~(NODE_FLAGS_RRSIGS_VALID | NODE_FLAGS_WIRE_SIZES);
 
-	int ret = knot_rdataset_subtract(node_rrs, &rrset->rrs, mm);
+	int ret = cold_rdata_warm(data);
+	if (ret == KNOT_EOK) {
+		ret = mapped_rdata_warm(data);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	ret = knot_rdataset_subtract(node_rrs, &rrset->rrs, mm);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -438,6 +472,68 @@ bool node_rrtype_is_signed(const zone_node_t *node, uint16_t type)
 	return false;
 }
 
+#define RR_HEADER_SIZE	10	// Type, class, TTL, and rdata length.
+
+static bool rdata_compressible(uint16_t type)
+{
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(type);
+	for (const int *block = desc->block_types; *block != KNOT_RDATA_WF_END; block++) {
+		if (*block == KNOT_RDATA_WF_COMPRESSIBLE_DNAME) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint16_t wire_min(size_t size)
+{
+	return MIN(size, UINT16_MAX);
+}
+
+void node_update_wire_sizes(zone_node_t *node)
+{
+	if (node == NULL) {
+		return;
+	}
+
+	// The owner can be compressed to a pointer.
+	size_t owner_min = MIN(knot_dname_size(node->owner), sizeof(uint16_t));
+	const knot_rdataset_t *rrsigs = node_rdataset(node, KNOT_RRTYPE_RRSIG);
+
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		struct rr_data *data = &node->rrs[i];
+
+		bool compressible = rdata_compressible(data->type);
+		size_t size = 0;
+		knot_rdata_t *rd = data->rrs.rdata;
+		for (uint16_t j = 0; j < data->rrs.count; ++j) {
+			size += owner_min + RR_HEADER_SIZE + (compressible ? 0 : rd->len);
+			rd = knot_rdataset_next(rd);
+		}
+
+		size_t sig_size = 0;
+		if (rrsigs != NULL && data->type != KNOT_RRTYPE_RRSIG) {
+			rd = rrsigs->rdata;
+			for (uint16_t j = 0; j < rrsigs->count; ++j) {
+				if (knot_rrsig_type_covered(rd) == data->type) {
+					sig_size += owner_min + RR_HEADER_SIZE + rd->len;
+				}
+				rd = knot_rdataset_next(rd);
+			}
+		}
+
+		// Avoid needless writes, the RR data may be shared with the counterpart.
+		if (data->wire_min != wire_min(size)) {
+			data->wire_min = wire_min(size);
+		}
+		if (data->rrsig_wire_min != wire_min(sig_size)) {
+			data->rrsig_wire_min = wire_min(sig_size);
+		}
+	}
+
+	node->flags |= NODE_FLAGS_WIRE_SIZES;
+}
+
 bool node_bitmap_equal(const zone_node_t *a, const zone_node_t *b)
 {
 	if (a == NULL || b == NULL || a->rrset_count != b->rrset_count) {
@@ -60,20 +60,31 @@ typedef struct {
 	bool optional; /*!< Optional glue indicator. */
 } glue_t;
 
-/*!< \brief Additional data. */
+/*!< \brief Additional data, allocated together with the glue array. */
 typedef struct {
-	glue_t *glues; /*!< Glue data. */
 	uint16_t count; /*!< Number of glue nodes. */
+	glue_t glues[]; /*!< Glue data. */
 } additional_t;
 
 /*!< \brief Structure storing RR data. */
 struct rr_data {
 	uint32_t ttl; /*!< RRSet TTL. */
 	uint16_t type; /*!< RR type of data. */
+	uint16_t flags; /*!< RR_DATA_* flags. */
+	uint16_t wire_min; /*!< Lower bound of the RRSet wire size, see node_update_wire_sizes(). */
+	uint16_t rrsig_wire_min; /*!< Lower bound of the wire size of the covering RRSIGs. */
 	knot_rdataset_t rrs; /*!< Data of given type. */
 	additional_t *additional; /*!< Additional nodes with glues. */
 };
 
+/*! \brief Flags of the RR data. */
+enum rr_data_flags {
+	/*! \brief The rdata are stored in the cold memory, see cold_rdata_move(). */
+	RR_DATA_COLD = 1 << 0,
+	/*! \brief The rdata are mapped read-only, see mapped_rdata_attach(). */
+	RR_DATA_MAPPED = 1 << 1,
+};
+
 /*! \brief Flags used to mark nodes with some property. */
 enum node_flags {
 	/*! \brief Node is authoritative, default. */
@@ -104,11 +115,22 @@ enum node_flags {
 	NODE_FLAGS_SUBTREE_AUTH =    1 << 11,
 	/*! \brief The node or some node in subtree has any data in it, possibly just insec deleg. */
 	NODE_FLAGS_SUBTREE_DATA =    1 << 12,
+	/*! \brief The wire sizes of the RR data are valid, see node_update_wire_sizes(). */
+	NODE_FLAGS_WIRE_SIZES =      1 << 13,
 };
 
 typedef void (*node_addrem_cb)(zone_node_t *, void *);
 typedef zone_node_t *(*node_new_cb)(const knot_dname_t *, void *);
 
+/*!
+ * \brief Allocates additional structure for the given number of glues.
+ *
+ * \param count  Number of glue nodes.
+ *
+ * \return Additional structure with uninitialized glues or NULL if error.
+ */
+additional_t *additional_new(uint16_t count);
+
 /*!
  * \brief Clears additional structure.
  *
@@ -124,7 +146,7 @@ bool additional_equal(additional_t *a, additional_t *b);
 /*!
  * \brief Creates and initializes new node structure.
  *
- * \param owner  Node's owner, will be duplicated.
+ * \param owner  Node's owner, will be copied into the node allocation.
  * \param binode Create bi-node.
  * \param second The second part of the bi-node shall be used now.
  * \param mm     Memory context to use.
@@ -320,6 +342,40 @@ inline static void node_set_flag_hierarch(zone_node_t *node, uint16_t fl)
  */
 bool node_rrtype_is_signed(const zone_node_t *node, uint16_t type);
 
+/*!
+ * \brief Computes the lower bounds of the wire sizes of the node's RRSets.
+ *
+ * The bound assumes the owner and the compressible rdata names to be
+ * compressed, so that an RRSet exceeding the space left in a response
+ * certainly doesn't fit and needn't be rendered.
+ *
+ * \param node  Node to update.
+ */
+void node_update_wire_sizes(zone_node_t *node);
+
+/*!
+ * \brief Returns the lower bound of the RRSet wire size.
+ *
+ * \param node     Node containing the RRSet.
+ * \param type     RRSet type.
+ * \param rrsigs   Include the covering RRSIGs.
+ *
+ * \return Wire size lower bound, 0 if unknown.
+ */
+inline static size_t node_rrset_wire_min(const zone_node_t *node, uint16_t type, bool rrsigs)
+{
+	if (node == NULL || !(node->flags & NODE_FLAGS_WIRE_SIZES)) {
+		return 0;
+	}
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		if (node->rrs[i].type == type) {
+			return node->rrs[i].wire_min +
+			       (rrsigs ? node->rrs[i].rrsig_wire_min : 0);
+		}
+	}
+	return 0;
+}
+
 /*!
  * \brief Checks whether node contains RRSet for given type.
  *
@@ -0,0 +1,122 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/openbsd/siphash.h"
+#include "knot/zone/nsec3-cache.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+
+#define SHARDS 16
+
+typedef struct {
+	uint64_t hash;
+	const zone_node_t *node;
+	const zone_node_t *previous;
+	int match;
+	uint8_t name_len;        // 0 if the entry is empty.
+	uint8_t name[NSEC3_CACHE_MAX_NAME];
+} nsec3_entry_t;
+
+struct nsec3_cache {
+	SIPHASH_KEY key;
+	pthread_mutex_t locks[SHARDS];
+	nsec3_entry_t entries[NSEC3_CACHE_SIZE];
+};
+
+nsec3_cache_t *nsec3_cache_new(void)
+{
+	nsec3_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	if (dnssec_random_buffer((uint8_t *)&cache->key, sizeof(cache->key)) != DNSSEC_EOK) {
+		free(cache);
+		return NULL;
+	}
+
+	for (unsigned i = 0; i < SHARDS; i++) {
+		pthread_mutex_init(&cache->locks[i], NULL);
+	}
+
+	return cache;
+}
+
+void nsec3_cache_free(nsec3_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < SHARDS; i++) {
+		pthread_mutex_destroy(&cache->locks[i]);
+	}
+	free(cache);
+}
+
+bool nsec3_cache_get(nsec3_cache_t *cache, const knot_dname_t *name, int *match,
+                     const zone_node_t **node, const zone_node_t **previous)
+{
+	size_t len = knot_dname_size(name);
+	if (cache == NULL || len > NSEC3_CACHE_MAX_NAME) {
+		return false;
+	}
+
+	uint64_t hash = SipHash24(&cache->key, name, len);
+	size_t idx = hash % NSEC3_CACHE_SIZE;
+	nsec3_entry_t *entry = &cache->entries[idx];
+
+	bool found = false;
+	pthread_mutex_t *lock = &cache->locks[idx % SHARDS];
+	pthread_mutex_lock(lock);
+	if (entry->hash == hash && entry->name_len == len &&
+	    memcmp(entry->name, name, len) == 0) {
+		*match = entry->match;
+		*node = entry->node;
+		*previous = entry->previous;
+		found = true;
+	}
+	pthread_mutex_unlock(lock);
+
+	return found;
+}
+
+void nsec3_cache_put(nsec3_cache_t *cache, const knot_dname_t *name, int match,
+                     const zone_node_t *node, const zone_node_t *previous)
+{
+	size_t len = knot_dname_size(name);
+	if (cache == NULL || len > NSEC3_CACHE_MAX_NAME) {
+		return;
+	}
+
+	uint64_t hash = SipHash24(&cache->key, name, len);
+	size_t idx = hash % NSEC3_CACHE_SIZE;
+	nsec3_entry_t *entry = &cache->entries[idx];
+
+	pthread_mutex_t *lock = &cache->locks[idx % SHARDS];
+	pthread_mutex_lock(lock);
+	entry->hash = hash;
+	entry->node = node;
+	entry->previous = previous;
+	entry->match = match;
+	entry->name_len = len;
+	memcpy(entry->name, name, len);
+	pthread_mutex_unlock(lock);
+}
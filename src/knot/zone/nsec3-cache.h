@@ -0,0 +1,77 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Cache of NSEC3 lookups of the names being denied.
+ *
+ * Computing the NSEC3 hash of a name takes the configured number of SHA-1
+ * iterations, which is the costliest part of an NSEC3 denial proof. The cache
+ * keeps the lookup results (matching or covering NSEC3 node) of recently
+ * denied names of one zone contents version, so repeated queries for a name
+ * don't hash it again. The node pointers are valid as long as the contents.
+ *
+ * The cache is direct-mapped and split into shards with a lock of their own,
+ * a colliding entry is just replaced. Too long names aren't cached.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "knot/zone/node.h"
+
+#define NSEC3_CACHE_SIZE	1024
+#define NSEC3_CACHE_MAX_NAME	64
+
+typedef struct nsec3_cache nsec3_cache_t;
+
+/*!
+ * \brief Creates a new empty cache of NSEC3_CACHE_SIZE entries.
+ *
+ * \return NSEC3 cache or NULL if error.
+ */
+nsec3_cache_t *nsec3_cache_new(void);
+
+/*!
+ * \brief Deallocates the cache (NULL is ignored).
+ */
+void nsec3_cache_free(nsec3_cache_t *cache);
+
+/*!
+ * \brief Looks up the NSEC3 lookup result of a name.
+ *
+ * \param cache     NSEC3 cache.
+ * \param name      Looked up name.
+ * \param match     Output: ZONE_NAME_FOUND or ZONE_NAME_NOT_FOUND.
+ * \param node      Output: matching NSEC3 node.
+ * \param previous  Output: previous NSEC3 node from the chain.
+ *
+ * \return True if found.
+ */
+bool nsec3_cache_get(nsec3_cache_t *cache, const knot_dname_t *name, int *match,
+                     const zone_node_t **node, const zone_node_t **previous);
+
+/*!
+ * \brief Stores the NSEC3 lookup result of a name.
+ *
+ * \param cache     NSEC3 cache.
+ * \param name      Looked up name.
+ * \param match     ZONE_NAME_FOUND or ZONE_NAME_NOT_FOUND.
+ * \param node      Matching NSEC3 node.
+ * \param previous  Previous NSEC3 node from the chain.
+ */
+void nsec3_cache_put(nsec3_cache_t *cache, const knot_dname_t *name, int match,
+                     const zone_node_t *node, const zone_node_t *previous);
@@ -0,0 +1,351 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/zone/nsec3-index.h"
+#include "contrib/base32hex.h"
+#include "libknot/libknot.h"
+
+#define HASH_MAX	64
+
+struct nsec3_index {
+	size_t refs;
+	size_t count;
+	size_t hash_len;
+	uint64_t *keys;       // Leading 8 bytes of the hashes, big endian.
+	zone_node_t **nodes;  // First halves of the bi-nodes.
+	uint8_t *hashes;
+};
+
+typedef struct {
+	uint8_t hash[HASH_MAX];
+	zone_node_t *node;    // NULL if removed.
+} change_t;
+
+static nsec3_index_t *index_new(size_t count, size_t hash_len)
+{
+	size_t size = sizeof(nsec3_index_t) +
+	              count * (sizeof(uint64_t) + sizeof(zone_node_t *) + hash_len);
+	nsec3_index_t *index = malloc(size);
+	if (index == NULL) {
+		return NULL;
+	}
+
+	index->refs = 1;
+	index->count = count;
+	index->hash_len = hash_len;
+	index->keys = (uint64_t *)(index + 1);
+	index->nodes = (zone_node_t **)(index->keys + count);
+	index->hashes = (uint8_t *)(index->nodes + count);
+
+	return index;
+}
+
+static uint64_t hash_key(const uint8_t *hash, size_t len)
+{
+	uint64_t key = 0;
+	for (size_t i = 0; i < sizeof(key); i++) {
+		key = (key << 8) | (i < len ? hash[i] : 0);
+	}
+	return key;
+}
+
+static void index_set(nsec3_index_t *index, size_t pos, const uint8_t *hash,
+                      zone_node_t *node)
+{
+	index->keys[pos] = hash_key(hash, index->hash_len);
+	index->nodes[pos] = binode_first(node);
+	memcpy(index->hashes + pos * index->hash_len, hash, index->hash_len);
+}
+
+/*! \brief Decodes the hash from the owner, returns its length or an error. */
+static int owner_hash(const knot_dname_t *owner, const knot_dname_t *suffix,
+                      uint8_t *hash)
+{
+	// Only the direct children of the same node are comparable by hash.
+	if (*owner == 0 || (suffix != NULL &&
+	    !knot_dname_is_equal(owner + *owner + 1, suffix))) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = knot_base32hex_decode(owner + 1, *owner, hash, HASH_MAX);
+	return (ret == 0) ? KNOT_EINVAL : ret;
+}
+
+static int cmp_at(const nsec3_index_t *index, size_t pos, uint64_t key, const uint8_t *hash)
+{
+	if (index->keys[pos] != key) {
+		return (index->keys[pos] < key) ? -1 : 1;
+	}
+	return memcmp(index->hashes + pos * index->hash_len, hash, index->hash_len);
+}
+
+/*! \brief Returns the number of the hashes less than or equal to the hash. */
+static size_t upper_bound(const nsec3_index_t *index, const uint8_t *hash)
+{
+	size_t count = index->count;
+	uint64_t key = hash_key(hash, index->hash_len);
+	uint64_t lo = index->keys[0], hi = index->keys[count - 1];
+	if (key < lo) {
+		return 0;
+	} else if (key > hi) {
+		return count;
+	}
+
+	// Interpolation estimate for the uniformly distributed hashes.
+	size_t guess = 0;
+	if (hi > lo) {
+		guess = (double)(key - lo) / (double)(hi - lo) * (count - 1);
+		guess = MIN(guess, count - 1);
+	}
+
+	// Exponential search from the estimate for a range with the result.
+	size_t l, r;
+	if (cmp_at(index, guess, key, hash) <= 0) {
+		l = guess + 1;
+		for (size_t step = 1; ; step *= 2) {
+			r = l + step - 1;
+			if (r >= count) {
+				r = count;
+				break;
+			} else if (cmp_at(index, r, key, hash) > 0) {
+				break;
+			}
+			l = r + 1;
+		}
+	} else {
+		r = guess;
+		for (size_t step = 1; ; step *= 2) {
+			if (r < step) {
+				l = 0;
+				break;
+			}
+			size_t probe = r - step;
+			if (cmp_at(index, probe, key, hash) <= 0) {
+				l = probe + 1;
+				break;
+			}
+			r = probe;
+		}
+	}
+
+	while (l < r) {
+		size_t mid = l + (r - l) / 2;
+		if (cmp_at(index, mid, key, hash) <= 0) {
+			l = mid + 1;
+		} else {
+			r = mid;
+		}
+	}
+
+	return l;
+}
+
+nsec3_index_t *nsec3_index_build(zone_tree_t *nsec3_nodes, const knot_dname_t *apex)
+{
+	size_t count = zone_tree_count(nsec3_nodes);
+	if (count == 0) {
+		return NULL;
+	}
+
+	zone_tree_it_t it = { 0 };
+	if (zone_tree_it_begin(nsec3_nodes, &it) != KNOT_EOK) {
+		return NULL;
+	}
+
+	nsec3_index_t *index = NULL;
+	uint8_t hash[HASH_MAX];
+	size_t pos = 0;
+	for (; !zone_tree_it_finished(&it); zone_tree_it_next(&it), pos++) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		int len = owner_hash(node->owner, apex, hash);
+		if (len < 0 || pos >= count) {
+			break;
+		}
+		if (index == NULL) {
+			index = index_new(count, len);
+			if (index == NULL) {
+				break;
+			}
+		} else if (len != index->hash_len ||
+		           cmp_at(index, pos - 1, hash_key(hash, len), hash) >= 0) {
+			break;
+		}
+		index_set(index, pos, hash, node);
+	}
+	bool complete = zone_tree_it_finished(&it) && pos == count;
+	zone_tree_it_free(&it);
+
+	if (!complete) {
+		free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+static int change_cmp(const void *a, const void *b, void *len)
+{
+	return memcmp(((const change_t *)a)->hash, ((const change_t *)b)->hash, *(size_t *)len);
+}
+
+static nsec3_index_t *merge(nsec3_index_t *old, change_t *changes, size_t changes_count,
+                            size_t count)
+{
+	nsec3_index_t *index = index_new(count, old->hash_len);
+	if (index == NULL) {
+		return NULL;
+	}
+
+	size_t len = old->hash_len, i = 0, j = 0, pos = 0;
+	while (i < old->count || j < changes_count) {
+		int cmp = (i == old->count) ? 1 : (j == changes_count) ? -1 :
+		          memcmp(old->hashes + i * len, changes[j].hash, len);
+		const uint8_t *hash;
+		zone_node_t *node;
+		if (cmp < 0) {
+			hash = old->hashes + i * len;
+			node = old->nodes[i++];
+		} else {
+			hash = changes[j].hash;
+			node = changes[j++].node;
+			i += (cmp == 0);
+		}
+		if (node == NULL) {
+			continue;
+		} else if (pos == count) {
+			free(index);
+			return NULL;
+		}
+		index_set(index, pos++, hash, node);
+	}
+
+	if (pos != count) {
+		free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+nsec3_index_t *nsec3_index_update(nsec3_index_t *old, zone_tree_t *nsec3_nodes,
+                                  zone_tree_t *changed, const knot_dname_t *apex)
+{
+	size_t count = zone_tree_count(nsec3_nodes);
+	size_t changes_count = zone_tree_count(changed);
+	if (old == NULL || count == 0 || changes_count > count / 4) {
+		// Not worth patching.
+		return nsec3_index_build(nsec3_nodes, apex);
+	} else if (changes_count == 0) {
+		return (count == old->count) ? nsec3_index_ref(old) : nsec3_index_build(nsec3_nodes, apex);
+	}
+
+	change_t *changes = malloc(changes_count * sizeof(*changes));
+	zone_tree_it_t it = { 0 };
+	if (changes == NULL || zone_tree_it_begin(changed, &it) != KNOT_EOK) {
+		free(changes);
+		return NULL;
+	}
+
+	// Skip the changes keeping the node in the index.
+	size_t pos = 0;
+	bool valid = true;
+	for (; !zone_tree_it_finished(&it) && valid; zone_tree_it_next(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		change_t *change = &changes[pos];
+		valid = (owner_hash(node->owner, apex, change->hash) == old->hash_len);
+		if (!valid) {
+			break;
+		}
+		zone_node_t *current = zone_tree_get(nsec3_nodes, node->owner);
+		change->node = (binode_first(current) == binode_first(node)) ? node : NULL;
+
+		size_t ub = upper_bound(old, change->hash);
+		bool indexed = ub > 0 && memcmp(old->hashes + (ub - 1) * old->hash_len,
+		                                change->hash, old->hash_len) == 0;
+		if (!indexed || old->nodes[ub - 1] != binode_first(change->node)) {
+			pos++;
+		}
+	}
+	zone_tree_it_free(&it);
+
+	nsec3_index_t *index = NULL;
+	if (!valid) {
+		index = nsec3_index_build(nsec3_nodes, apex);
+	} else if (pos == 0 && count == old->count) {
+		index = nsec3_index_ref(old);
+	} else {
+		size_t len = old->hash_len;
+		qsort_r(changes, pos, sizeof(*changes), change_cmp, &len);
+		index = merge(old, changes, pos, count);
+		if (index == NULL) {
+			index = nsec3_index_build(nsec3_nodes, apex);
+		}
+	}
+	free(changes);
+
+	return index;
+}
+
+nsec3_index_t *nsec3_index_ref(nsec3_index_t *index)
+{
+	if (index != NULL) {
+		__atomic_add_fetch(&index->refs, 1, __ATOMIC_RELAXED);
+	}
+	return index;
+}
+
+void nsec3_index_free(nsec3_index_t *index)
+{
+	if (index != NULL && __atomic_sub_fetch(&index->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		free(index);
+	}
+}
+
+int nsec3_index_find(const nsec3_index_t *index, zone_tree_t *nsec3_nodes,
+                     const uint8_t *hash, size_t hash_len,
+                     zone_node_t **found, zone_node_t **previous)
+{
+	if (index == NULL || hash == NULL || hash_len != index->hash_len) {
+		return KNOT_EINVAL;
+	}
+
+	size_t ub = upper_bound(index, hash);
+	if (ub > 0 && memcmp(index->hashes + (ub - 1) * hash_len, hash, hash_len) == 0) {
+		*found = zone_tree_fix_get(index->nodes[ub - 1], nsec3_nodes);
+		*previous = node_prev(*found);
+		return 1;
+	}
+
+	// Before the first one, the last one precedes cyclically.
+	*found = NULL;
+	*previous = zone_tree_fix_get(index->nodes[(ub > 0 ? ub : index->count) - 1],
+	                              nsec3_nodes);
+	return 0;
+}
+
+size_t nsec3_index_size(const nsec3_index_t *index)
+{
+	if (index == NULL) {
+		return 0;
+	}
+
+	return sizeof(*index) +
+	       index->count * (sizeof(uint64_t) + sizeof(zone_node_t *) + index->hash_len);
+}
@@ -0,0 +1,95 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Index of the NSEC3 nodes by the raw owner hash.
+ *
+ * The NSEC3 owner hashes are uniformly distributed, so the position of a hash
+ * in the sorted array of the hashes is well estimated by interpolation. The
+ * lookup starts at the estimate and narrows the range by exponential and
+ * binary search over the leading 8 bytes of the hashes, kept in an array
+ * of their own, so it takes a few cache misses even in huge zones.
+ *
+ * The index is built when the contents are adjusted. An incremental update
+ * shares the index of the previous contents if it doesn't add or remove any
+ * NSEC3 node, otherwise the changed nodes are merged into a new copy.
+ * The index is reference counted, node pointers are resolved in the tree
+ * of the looking up contents.
+ */
+
+#pragma once
+
+#include "knot/zone/zone-tree.h"
+
+typedef struct nsec3_index nsec3_index_t;
+
+/*!
+ * \brief Builds the index of the NSEC3 tree.
+ *
+ * \param nsec3_nodes  NSEC3 tree.
+ * \param apex         Zone apex, the common parent of the NSEC3 nodes.
+ *
+ * \return New index, NULL if empty tree, not a uniform NSEC3 tree, or error.
+ */
+nsec3_index_t *nsec3_index_build(zone_tree_t *nsec3_nodes, const knot_dname_t *apex);
+
+/*!
+ * \brief Gets the index of the NSEC3 tree after an incremental update.
+ *
+ * \param old          Index of the contents before the update.
+ * \param nsec3_nodes  NSEC3 tree after the update.
+ * \param changed      Tree of the NSEC3 nodes changed by the update.
+ * \param apex         Zone apex.
+ *
+ * \return The old index with a new reference, its updated copy, or NULL.
+ */
+nsec3_index_t *nsec3_index_update(nsec3_index_t *old, zone_tree_t *nsec3_nodes,
+                                  zone_tree_t *changed, const knot_dname_t *apex);
+
+/*!
+ * \brief Adds a reference to the index (NULL is ignored).
+ */
+nsec3_index_t *nsec3_index_ref(nsec3_index_t *index);
+
+/*!
+ * \brief Drops a reference to the index, frees it with the last one (NULL is ignored).
+ */
+void nsec3_index_free(nsec3_index_t *index);
+
+/*!
+ * \brief Finds the NSEC3 node with the hash or the one preceding it.
+ *
+ * Same semantics as zone_tree_get_less_or_equal().
+ *
+ * \param index        NSEC3 index.
+ * \param nsec3_nodes  NSEC3 tree of the contents the index belongs to.
+ * \param hash         Raw NSEC3 hash.
+ * \param hash_len     Length of the hash.
+ * \param found        Output: node with the hash, NULL if not found.
+ * \param previous     Output: preceding node, the last one if none.
+ *
+ * \retval 1 if exact match, 0 if not found.
+ * \retval KNOT_EINVAL if the hash length doesn't match the index.
+ */
+int nsec3_index_find(const nsec3_index_t *index, zone_tree_t *nsec3_nodes,
+                     const uint8_t *hash, size_t hash_len,
+                     zone_node_t **found, zone_node_t **previous);
+
+/*!
+ * \brief Returns the memory used by the index.
+ */
+size_t nsec3_index_size(const nsec3_index_t *index);
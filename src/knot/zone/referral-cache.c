@@ -0,0 +1,265 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/zone/referral-cache.h"
+#include "libknot/descriptor.h"
+#include "libknot/errcode.h"
+#include "libknot/packet/wire.h"
+
+#define SHARDS 16
+#define RR_FIXED_SIZE 10 // TYPE, CLASS, TTL, RDLENGTH.
+
+struct referral {
+	const zone_node_t *node;
+	bool dnssec;
+	uint16_t nscount;
+	uint16_t arcount;
+	uint16_t ptr_count;
+	uint16_t *ptrs;       // Positions of the compression pointers.
+	uint8_t *wire;
+	size_t size;
+	uint16_t data[];      // Pointer positions followed by the wire.
+};
+
+struct referral_cache {
+	pthread_mutex_t locks[SHARDS];
+	size_t mask;
+	referral_t **entries;
+};
+
+referral_cache_t *referral_cache_new(size_t size)
+{
+	size_t count = 1;
+	while (count < size) {
+		count <<= 1;
+	}
+
+	referral_cache_t *cache = calloc(1, sizeof(*cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->entries = calloc(count, sizeof(*cache->entries));
+	if (cache->entries == NULL) {
+		free(cache);
+		return NULL;
+	}
+	cache->mask = count - 1;
+
+	for (unsigned i = 0; i < SHARDS; i++) {
+		pthread_mutex_init(&cache->locks[i], NULL);
+	}
+
+	return cache;
+}
+
+void referral_cache_free(referral_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i <= cache->mask; i++) {
+		free(cache->entries[i]);
+	}
+	for (unsigned i = 0; i < SHARDS; i++) {
+		pthread_mutex_destroy(&cache->locks[i]);
+	}
+	free(cache->entries);
+	free(cache);
+}
+
+/*! \brief Skips a name, notes its compression pointer (if any). */
+static int skip_name(const uint8_t *wire, size_t size, size_t *pos,
+                     uint16_t *ptrs, uint16_t *ptr_count)
+{
+	while (*pos < size) {
+		uint8_t len = wire[*pos];
+		if (knot_wire_is_pointer(wire + *pos)) {
+			if (*pos + 2 > size) {
+				return KNOT_EMALF;
+			}
+			if (ptrs != NULL) {
+				ptrs[*ptr_count] = *pos;
+			}
+			(*ptr_count)++;
+			*pos += 2;
+			return KNOT_EOK;
+		} else if (len == 0) {
+			*pos += 1;
+			return KNOT_EOK;
+		} else if (len > KNOT_DNAME_MAXLABELLEN) {
+			return KNOT_EMALF;
+		}
+		*pos += 1 + len;
+	}
+
+	return KNOT_EMALF;
+}
+
+static int skip_rdata(const uint8_t *wire, size_t size, size_t pos, uint16_t type,
+                      uint16_t *ptrs, uint16_t *ptr_count)
+{
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(type);
+
+	for (int i = 0; pos < size && desc->block_types[i] != KNOT_RDATA_WF_END; i++) {
+		int block = desc->block_types[i];
+		switch (block) {
+		case KNOT_RDATA_WF_COMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_DECOMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_FIXED_DNAME:
+			if (skip_name(wire, size, &pos, ptrs, ptr_count) != KNOT_EOK) {
+				return KNOT_EMALF;
+			}
+			break;
+		case KNOT_RDATA_WF_REMAINDER:
+			pos = size;
+			break;
+		case KNOT_RDATA_WF_NAPTR_HEADER:
+			return KNOT_ENOTSUP; // Not expected in a referral.
+		default:
+			pos += block;
+			break;
+		}
+	}
+
+	return (pos == size) ? KNOT_EOK : KNOT_EMALF;
+}
+
+/*! \brief Walks the records, notes the compression pointers if 'ptrs' is set. */
+static int scan_records(const uint8_t *wire, size_t size, unsigned count,
+                        uint16_t *ptrs, uint16_t *ptr_count)
+{
+	size_t pos = 0;
+	*ptr_count = 0;
+
+	for (unsigned i = 0; i < count; i++) {
+		int ret = skip_name(wire, size, &pos, ptrs, ptr_count);
+		if (ret != KNOT_EOK || pos + RR_FIXED_SIZE > size) {
+			return KNOT_EMALF;
+		}
+		uint16_t type = knot_wire_read_u16(wire + pos);
+		uint16_t rdlen = knot_wire_read_u16(wire + pos + 8);
+		pos += RR_FIXED_SIZE;
+		if (pos + rdlen > size) {
+			return KNOT_EMALF;
+		}
+		ret = skip_rdata(wire, pos + rdlen, pos, type, ptrs, ptr_count);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		pos += rdlen;
+	}
+
+	return (pos == size) ? KNOT_EOK : KNOT_EMALF;
+}
+
+referral_t *referral_new(const zone_node_t *node, bool dnssec, const uint8_t *wire,
+                         size_t size, uint16_t nscount, uint16_t arcount)
+{
+	if (node == NULL || wire == NULL) {
+		return NULL;
+	}
+
+	// Count the pointers first.
+	uint16_t ptr_count;
+	if (scan_records(wire, size, nscount + arcount, NULL, &ptr_count) != KNOT_EOK) {
+		return NULL;
+	}
+
+	referral_t *ref = malloc(sizeof(*ref) + size + ptr_count * sizeof(uint16_t));
+	if (ref == NULL) {
+		return NULL;
+	}
+	ref->node = node;
+	ref->dnssec = dnssec;
+	ref->nscount = nscount;
+	ref->arcount = arcount;
+	ref->size = size;
+	ref->ptrs = ref->data;
+	ref->wire = (uint8_t *)(ref->data + ptr_count);
+	memcpy(ref->wire, wire, size);
+	(void)scan_records(ref->wire, size, nscount + arcount, ref->ptrs, &ref->ptr_count);
+
+	return ref;
+}
+
+static size_t entry_index(const referral_cache_t *cache, const zone_node_t *node, bool dnssec)
+{
+	uint64_t key = ((uintptr_t)node >> 4) ^ dnssec;
+	return (key * 0x9E3779B97F4A7C15ULL >> 32) & cache->mask;
+}
+
+void referral_cache_put(referral_cache_t *cache, referral_t *ref)
+{
+	if (cache == NULL || ref == NULL) {
+		free(ref);
+		return;
+	}
+
+	size_t idx = entry_index(cache, ref->node, ref->dnssec);
+
+	pthread_mutex_t *lock = &cache->locks[idx % SHARDS];
+	pthread_mutex_lock(lock);
+	referral_t *old = cache->entries[idx];
+	cache->entries[idx] = ref;
+	pthread_mutex_unlock(lock);
+
+	free(old);
+}
+
+int referral_cache_write(referral_cache_t *cache, const zone_node_t *node, bool dnssec,
+                         int delta, uint8_t *wire, size_t maxlen,
+                         uint16_t *nscount, uint16_t *arcount)
+{
+	if (cache == NULL || node == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	size_t idx = entry_index(cache, node, dnssec);
+
+	int ret = KNOT_ENOENT;
+	pthread_mutex_t *lock = &cache->locks[idx % SHARDS];
+	pthread_mutex_lock(lock);
+	referral_t *ref = cache->entries[idx];
+	if (ref != NULL && ref->node == node && ref->dnssec == dnssec) {
+		if (ref->size > maxlen) {
+			ret = KNOT_ESPACE;
+		} else {
+			memcpy(wire, ref->wire, ref->size);
+			ret = ref->size;
+			for (uint16_t i = 0; i < ref->ptr_count; i++) {
+				uint8_t *pos = wire + ref->ptrs[i];
+				int ptr = knot_wire_get_pointer(pos) + delta;
+				if (ptr < KNOT_WIRE_HEADER_SIZE || ptr > KNOT_WIRE_PTR_MAX) {
+					ret = KNOT_ESPACE;
+					break;
+				}
+				knot_wire_put_pointer(pos, ptr);
+			}
+			*nscount = ref->nscount;
+			*arcount = ref->arcount;
+		}
+	}
+	pthread_mutex_unlock(lock);
+
+	return ret;
+}
@@ -0,0 +1,94 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Cache of rendered referrals.
+ *
+ * A referral from a delegation depends only on the delegation node and the
+ * DO bit, not on the queried name below it. The cache keeps the AUTHORITY
+ * and ADDITIONAL sections of the referrals of one zone contents version in
+ * the wire format, rendered as if the delegation was queried, together with
+ * the positions of the compression pointers. Writing the sections to another
+ * response just shifts the pointers by the difference of the QNAME lengths.
+ *
+ * The cache is direct-mapped and split into shards with a lock of their own,
+ * a colliding entry is just replaced.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "knot/zone/node.h"
+
+typedef struct referral_cache referral_cache_t;
+
+typedef struct referral referral_t;
+
+/*!
+ * \brief Creates a new empty cache.
+ *
+ * \param size  Number of the cache entries.
+ *
+ * \return Referral cache or NULL if error.
+ */
+referral_cache_t *referral_cache_new(size_t size);
+
+/*!
+ * \brief Deallocates the cache (NULL is ignored).
+ */
+void referral_cache_free(referral_cache_t *cache);
+
+/*!
+ * \brief Creates a referral from the rendered sections.
+ *
+ * \param node     Delegation node.
+ * \param dnssec   DO bit of the rendered response.
+ * \param wire     AUTHORITY and ADDITIONAL sections in the wire format.
+ * \param size     Size of the sections.
+ * \param nscount  Number of the AUTHORITY records.
+ * \param arcount  Number of the ADDITIONAL records.
+ *
+ * \return Referral or NULL if error (e.g. malformed sections).
+ */
+referral_t *referral_new(const zone_node_t *node, bool dnssec, const uint8_t *wire,
+                         size_t size, uint16_t nscount, uint16_t arcount);
+
+/*!
+ * \brief Stores the referral into the cache, the cache takes its ownership.
+ */
+void referral_cache_put(referral_cache_t *cache, referral_t *ref);
+
+/*!
+ * \brief Writes the cached referral from the delegation.
+ *
+ * \param cache    Referral cache.
+ * \param node     Delegation node.
+ * \param dnssec   DO bit of the response.
+ * \param delta    Offset of the response sections from the rendered ones.
+ * \param wire     Output: position of the sections in the response.
+ * \param maxlen   Available space in the response.
+ * \param nscount  Output: number of the AUTHORITY records.
+ * \param arcount  Output: number of the ADDITIONAL records.
+ *
+ * \retval Size of the written sections.
+ * \retval KNOT_ENOENT if not cached.
+ * \retval KNOT_ESPACE if not enough space.
+ */
+int referral_cache_write(referral_cache_t *cache, const zone_node_t *node, bool dnssec,
+                         int delta, uint8_t *wire, size_t maxlen,
+                         uint16_t *nscount, uint16_t *arcount);
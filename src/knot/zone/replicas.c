@@ -0,0 +1,277 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <urcu.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "knot/zone/replicas.h"
+#include "knot/common/log.h"
+#include "knot/updates/apply.h"
+#include "knot/zone/adds_tree.h"
+#include "knot/zone/adjust.h"
+#include "contrib/ctype.h"
+#include "contrib/macros.h"
+
+// Limited by the node mask passed to the kernel.
+#define NODES_MAX (8 * sizeof(unsigned long))
+
+static __thread int thread_node = -1;
+
+unsigned zone_replicas_nodes(void)
+{
+	static unsigned nodes = 0;
+
+	unsigned count = __atomic_load_n(&nodes, __ATOMIC_RELAXED);
+	if (count > 0) {
+		return count;
+	}
+
+	count = 1;
+#ifdef __linux__
+	// The format is a list of ranges, e.g. "0-1,3".
+	FILE *f = fopen("/sys/devices/system/node/online", "r");
+	if (f != NULL) {
+		char buf[256];
+		if (fgets(buf, sizeof(buf), f) != NULL) {
+			unsigned id = 0;
+			for (const char *c = buf; *c != '\0'; c++) {
+				if (is_digit(*c)) {
+					id = id * 10 + (*c - '0');
+				} else {
+					count = MAX(count, id + 1);
+					id = 0;
+				}
+			}
+			count = MAX(count, id + 1);
+		}
+		fclose(f);
+	}
+#endif
+	count = MIN(count, NODES_MAX);
+
+	__atomic_store_n(&nodes, count, __ATOMIC_RELAXED);
+	return count;
+}
+
+static unsigned local_node(void)
+{
+	// The answering threads are expected to be pinned, so the node is
+	// looked up only once per thread.
+	if (thread_node < 0) {
+		unsigned cpu = 0, node = 0;
+#if defined(__linux__) && defined(SYS_getcpu)
+		if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+			node = 0;
+		}
+#endif
+		thread_node = node;
+	}
+
+	return thread_node;
+}
+
+static void prefer_node(int node)
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+	if (node < 0) {
+		(void)syscall(SYS_set_mempolicy, MPOL_DEFAULT, NULL, 0);
+	} else {
+		unsigned long mask = 1UL << node;
+		(void)syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, 8 * sizeof(mask));
+	}
+#endif
+}
+
+zone_contents_t *zone_replicas_local(zone_t *zone, zone_contents_t *contents)
+{
+	zone_replicas_t *replicas = rcu_dereference(zone->replicas);
+	if (replicas == NULL || replicas->main != contents) {
+		return contents;
+	}
+
+	unsigned node = local_node();
+	if (node >= replicas->count || replicas->node[node].contents == NULL) {
+		return contents;
+	}
+
+	return replicas->node[node].contents;
+}
+
+static int copy_node_cb(zone_node_t *node, void *data)
+{
+	zone_contents_t *copy = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rr = node_rrset_at(node, i);
+		zone_node_t *unused = NULL;
+		int ret = zone_contents_add_rr(copy, &rr, &unused);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static zone_contents_t *copy_contents(zone_contents_t *contents, unsigned threads)
+{
+	zone_contents_t *copy = zone_contents_new(contents->apex->owner, true);
+	if (copy == NULL) {
+		return NULL;
+	}
+
+	int ret = zone_contents_apply(contents, copy_node_cb, copy);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_nsec3_apply(contents, copy_node_cb, copy);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_full(copy, threads);
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(copy);
+		return NULL;
+	}
+	// Not published yet, so the bi-nodes can be unified right away.
+	zone_trees_unify_binodes(copy->nodes, copy->nsec3_nodes, false);
+	copy->size = contents->size;
+	copy->max_ttl = contents->max_ttl;
+
+	return copy;
+}
+
+static zone_contents_t *replay_changeset(zone_update_t *update, zone_contents_t *replica,
+                                         apply_ctx_t **a_ctx, unsigned threads)
+{
+	// Minimal update of the copy, the zone is already locked by 'update'.
+	zone_update_t up = {
+		.zone = update->zone,
+		.flags = UPDATE_INCREMENTAL,
+	};
+
+	up.a_ctx = calloc(1, sizeof(*up.a_ctx));
+	if (up.a_ctx == NULL) {
+		return NULL;
+	}
+
+	int ret = zone_contents_cow(replica, &up.new_cont);
+	if (ret != KNOT_EOK) {
+		free(up.a_ctx);
+		return NULL;
+	}
+
+	bool nsec_changed = false;
+	ret = apply_init_ctx(up.a_ctx, up.new_cont, 0);
+	if (ret == KNOT_EOK) {
+		ret = apply_changeset(up.a_ctx, &update->change, &nsec_changed);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_incremental_update(&up, threads);
+	}
+	if (ret != KNOT_EOK) {
+		additionals_tree_free(up.new_cont->adds_tree);
+		up.new_cont->adds_tree = NULL;
+		apply_rollback(up.a_ctx);
+		free(up.a_ctx);
+		return NULL;
+	}
+
+	*a_ctx = up.a_ctx;
+	return up.new_cont;
+}
+
+zone_replicas_t *zone_replicas_commit(zone_update_t *update, unsigned threads)
+{
+	unsigned count = zone_replicas_nodes();
+	if (count < 2) {
+		return NULL;
+	}
+
+	zone_replicas_t *replicas = calloc(1, sizeof(*replicas) + count * sizeof(replicas->node[0]));
+	if (replicas == NULL) {
+		log_zone_warning(update->zone->name, "failed to prepare NUMA replicas (%s)",
+		                 knot_strerror(KNOT_ENOMEM));
+		return NULL;
+	}
+	replicas->main = update->new_cont;
+	replicas->count = count;
+
+	// The changeset can be replayed only on copies of the current contents.
+	zone_replicas_t *old = update->zone->replicas;
+	bool replay = old != NULL && old->count == count && old->main == update->zone->contents &&
+	              (update->flags & UPDATE_INCREMENTAL) && !(update->flags & UPDATE_NO_CHSET);
+
+	for (unsigned i = 0; i < count; i++) {
+		prefer_node(i);
+		if (replay && old->node[i].contents != NULL) {
+			replicas->node[i].contents = replay_changeset(update, old->node[i].contents,
+			                                              &replicas->node[i].a_ctx, threads);
+		}
+		if (replicas->node[i].contents == NULL) {
+			replicas->node[i].contents = copy_contents(update->new_cont, threads);
+		}
+		if (replicas->node[i].contents == NULL) {
+			log_zone_warning(update->zone->name, "failed to prepare NUMA replica "
+			                 "for node %u", i);
+		}
+	}
+	prefer_node(-1);
+
+	return replicas;
+}
+
+void zone_replicas_retire(zone_replicas_t *old, zone_replicas_t *new)
+{
+	if (old == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < old->count; i++) {
+		if (new != NULL && i < new->count && new->node[i].a_ctx != NULL) {
+			// The new copy shares the unchanged nodes with the old one.
+			update_free_zone(old->node[i].contents);
+			apply_cleanup(new->node[i].a_ctx);
+			free(new->node[i].a_ctx);
+			new->node[i].a_ctx = NULL;
+		} else {
+			zone_contents_deep_free(old->node[i].contents);
+		}
+	}
+
+	free(old);
+}
+
+void zone_replicas_free(zone_replicas_t *replicas)
+{
+	if (replicas == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < replicas->count; i++) {
+		if (replicas->node[i].a_ctx != NULL) {
+			apply_cleanup(replicas->node[i].a_ctx);
+			free(replicas->node[i].a_ctx);
+		}
+		zone_contents_deep_free(replicas->node[i].contents);
+	}
+
+	free(replicas);
+}
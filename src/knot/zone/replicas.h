@@ -0,0 +1,77 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "knot/updates/zone-update.h"
+
+/*!
+ * \brief Copies of the published zone contents, one per NUMA memory node.
+ *
+ * Each copy is allocated on its node and the answering threads use the copy
+ * of the node they run on. The copies are valid only as long as 'main'
+ * is the published contents of the zone.
+ */
+typedef struct zone_replicas {
+	const zone_contents_t *main; /*!< Published contents the copies correspond to. */
+	unsigned count;              /*!< Number of the memory nodes. */
+	struct {
+		zone_contents_t *contents;
+		apply_ctx_t *a_ctx;  /*!< Pending cleanup of the update of the copy. */
+	} node[];
+} zone_replicas_t;
+
+/*!
+ * \brief Returns the number of NUMA memory nodes (1 if not NUMA).
+ */
+unsigned zone_replicas_nodes(void);
+
+/*!
+ * \brief Returns the contents to answer from in the calling thread.
+ *
+ * \param zone      Zone.
+ * \param contents  Published contents of the zone.
+ *
+ * \return Local copy of the contents if available, 'contents' otherwise.
+ */
+zone_contents_t *zone_replicas_local(zone_t *zone, zone_contents_t *contents);
+
+/*!
+ * \brief Prepares the copies of the contents being committed.
+ *
+ * If the previous copies correspond to the current contents and the update
+ * holds a changeset, the changeset is applied to the copies. Otherwise the
+ * new contents are copied completely.
+ *
+ * \param update   Zone update being committed, before the contents switch.
+ * \param threads  Number of threads for adjusting.
+ *
+ * \return New copies, NULL if single node or on error (logged).
+ */
+zone_replicas_t *zone_replicas_commit(zone_update_t *update, unsigned threads);
+
+/*!
+ * \brief Frees the copies replaced by the new ones, after RCU grace period.
+ *
+ * \param old  Replaced copies (NULL is ignored).
+ * \param new  New copies (may be NULL).
+ */
+void zone_replicas_retire(zone_replicas_t *old, zone_replicas_t *new);
+
+/*!
+ * \brief Frees the copies (NULL is ignored).
+ */
+void zone_replicas_free(zone_replicas_t *replicas);
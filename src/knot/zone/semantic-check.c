@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -22,6 +23,7 @@
 
 #include "libdnssec/error.h"
 #include "contrib/base32hex.h"
+#include "contrib/macros.h"
 #include "contrib/string.h"
 #include "libknot/libknot.h"
 #include "knot/zone/semantic-check.h"
@@ -151,10 +153,13 @@ typedef enum {
 
 typedef struct {
 	zone_contents_t *zone;
+	zone_tree_t *nodes; /* Checked nodes, all zone nodes if NULL. */
 	sem_handler_t *handler;
 	const zone_node_t *next_nsec;
 	check_level_t level;
 	time_t time;
+	bool parallel;   /* Run the checks independent of the other nodes. */
+	bool sequential; /* Run the checks depending on the previous nodes. */
 } semchecks_data_t;
 
 static int check_soa(const zone_node_t *node, semchecks_data_t *data);
@@ -174,6 +179,7 @@ static int check_nsec3_presence(const zone_node_t *node, semchecks_data_t *data)
 struct check_function {
 	int (*function)(const zone_node_t *, semchecks_data_t *);
 	check_level_t level;
+	bool sequential; /* The check must process the nodes in order. */
 };
 
 /* List of function callbacks for defined check_level */
@@ -187,7 +193,7 @@ static const struct check_function CHECK_FUNCTIONS[] = {
 	{ check_rrsig,          NSEC | NSEC3 },
 	{ check_rrsig_signed,   NSEC | NSEC3 },
 	{ check_nsec_bitmap,    NSEC | NSEC3 },
-	{ check_nsec,           NSEC },
+	{ check_nsec,           NSEC, true },
 	{ check_nsec3,          NSEC3 },
 	{ check_nsec3_presence, NSEC3 },
 	{ check_nsec3_opt_out,  NSEC3 },
@@ -197,12 +203,19 @@ static const int CHECK_FUNCTIONS_LEN = sizeof(CHECK_FUNCTIONS)
                                      / sizeof(struct check_function);
 
 static int check_signature(const knot_rdata_t *rrsig, const dnssec_key_t *key,
-                           const knot_rrset_t *covered)
+                           const knot_rrset_t *covered, valid_cache_t *cache)
 {
 	if (!rrsig || !key || !dnssec_key_can_verify(key)) {
 		return KNOT_EINVAL;
 	}
 
+	uint8_t digest[VALID_CACHE_DIGEST_SIZE];
+	bool cacheable = cache != NULL &&
+	                 valid_cache_digest(key, rrsig, covered, digest) == KNOT_EOK;
+	if (cacheable && valid_cache_lookup(cache, digest)) {
+		return KNOT_EOK;
+	}
+
 	int ret = KNOT_EOK;
 	dnssec_sign_ctx_t *sign_ctx = NULL;
 
@@ -230,6 +243,9 @@ static int check_signature(const knot_rdata_t *rrsig, const dnssec_key_t *key,
 		goto fail;
 	}
 
+	if (cacheable) {
+		valid_cache_insert(cache, digest, knot_rrsig_sig_expiration(rrsig));
+	}
 fail:
 	dnssec_sign_free(sign_ctx);
 	return ret;
@@ -340,7 +356,7 @@ static int check_rrsig_rdata(sem_handler_t *handler,
 					continue;
 				}
 
-				ret = check_signature(rrsig, key, rrset);
+				ret = check_signature(rrsig, key, rrset, handler->valid_cache);
 				dnssec_key_free(key);
 				if (ret == KNOT_EOK) {
 					*verified = true;
@@ -1167,10 +1183,16 @@ static int do_checks_in_tree(zone_node_t *node, void *data)
 {
 	semchecks_data_t *s_data = (semchecks_data_t *)data;
 
+	// A node removed by an incremental update.
+	if (node->flags & NODE_FLAGS_DELETED) {
+		return KNOT_EOK;
+	}
+
 	int ret = KNOT_EOK;
 
 	for (int i = 0; ret == KNOT_EOK && i < CHECK_FUNCTIONS_LEN; ++i) {
-		if (CHECK_FUNCTIONS[i].level & s_data->level) {
+		bool run = CHECK_FUNCTIONS[i].sequential ? s_data->sequential : s_data->parallel;
+		if (run && (CHECK_FUNCTIONS[i].level & s_data->level)) {
 			ret = CHECK_FUNCTIONS[i].function(node, s_data);
 		}
 	}
@@ -1179,6 +1201,193 @@ static int do_checks_in_tree(zone_node_t *node, void *data)
 	return ret;
 }
 
+/*! \brief Minimal number of nodes worth checking on multiple threads. */
+#define SEM_PARALLEL_MIN_NODES 4096
+
+typedef struct {
+	size_t idx;               /* Sequence number of the checked node. */
+	const zone_node_t *node;
+	sem_error_t code;
+	bool error;
+	char *data;
+} sem_record_t;
+
+/*!
+ * \brief Error handler storing the errors for a later replay.
+ *
+ * \note The handler must be the first member.
+ */
+typedef struct {
+	sem_handler_t handler;
+	size_t idx;
+	sem_record_t *recs;
+	size_t count;
+	size_t capacity;
+	bool nomem;
+} sem_recorder_t;
+
+static void recorder_cb(sem_handler_t *handler, _unused_ const zone_contents_t *zone,
+                        const zone_node_t *node, sem_error_t error, const char *data)
+{
+	sem_recorder_t *rec = (sem_recorder_t *)handler;
+
+	if (rec->count == rec->capacity) {
+		size_t capacity = MAX(2 * rec->capacity, 16);
+		sem_record_t *recs = realloc(rec->recs, capacity * sizeof(*recs));
+		if (recs == NULL) {
+			rec->nomem = true;
+			handler->error = false;
+			return;
+		}
+		rec->recs = recs;
+		rec->capacity = capacity;
+	}
+
+	rec->recs[rec->count++] = (sem_record_t) {
+		.idx = rec->idx,
+		.node = node,
+		.code = error,
+		.error = handler->error,
+		.data = (data != NULL) ? strdup(data) : NULL,
+	};
+	handler->error = false;
+}
+
+static void recorder_deinit(sem_recorder_t *rec)
+{
+	for (size_t i = 0; i < rec->count; i++) {
+		free(rec->recs[i].data);
+	}
+	free(rec->recs);
+}
+
+typedef struct {
+	semchecks_data_t data;
+	sem_recorder_t rec;
+	size_t threads;
+	size_t thr_id;
+	size_t i;
+	size_t next;         /* Next record to be replayed. */
+	pthread_t thread;
+	bool started;
+	int ret;
+} sem_thread_t;
+
+static int do_checks_in_thread(zone_node_t *node, void *ctx)
+{
+	sem_thread_t *arg = ctx;
+
+	arg->rec.idx = arg->i++;
+	if (arg->rec.idx % arg->threads != arg->thr_id) {
+		return KNOT_EOK;
+	}
+
+	return do_checks_in_tree(node, &arg->data);
+}
+
+static void *checks_thread(void *ctx)
+{
+	sem_thread_t *arg = ctx;
+
+	zone_tree_t *nodes = (arg->data.nodes != NULL) ? arg->data.nodes : arg->data.zone->nodes;
+	arg->ret = zone_tree_apply(nodes, do_checks_in_thread, arg);
+
+	return NULL;
+}
+
+/*! \brief Pass the recorded errors of the nodes with sequence numbers below the limit. */
+static void replay_records(sem_thread_t *arg, size_t limit, const zone_contents_t *zone,
+                           sem_handler_t *handler)
+{
+	for (; arg->next < arg->rec.count && arg->rec.recs[arg->next].idx < limit; arg->next++) {
+		const sem_record_t *rec = &arg->rec.recs[arg->next];
+		handler->error = rec->error;
+		handler->cb(handler, zone, rec->node, rec->code, rec->data);
+		handler->error = false;
+	}
+}
+
+/*!
+ * \brief Run the node checks on multiple threads.
+ *
+ * The nodes are dealt to the threads round-robin, the order-dependent checks
+ * are run by the calling thread meanwhile. The recorded errors are passed to
+ * the handler in the same order as if the checks were run sequentially.
+ */
+static int checks_parallel(semchecks_data_t *data, unsigned threads)
+{
+	sem_thread_t args[threads + 1];
+	memset(args, 0, sizeof(args));
+
+	for (unsigned i = 0; i <= threads; i++) {
+		args[i].data = *data;
+		args[i].data.handler = &args[i].rec.handler;
+		args[i].rec.handler.cb = recorder_cb;
+		args[i].rec.handler.valid_cache = data->handler->valid_cache;
+		args[i].threads = threads;
+		args[i].thr_id = i;
+	}
+
+	// The last one is the calling thread doing the order-dependent checks.
+	sem_thread_t *seq = &args[threads];
+	seq->data.parallel = false;
+	seq->threads = 1;
+	seq->thr_id = 0;
+
+	for (unsigned i = 0; i < threads; i++) {
+		args[i].data.sequential = false;
+		args[i].started = (pthread_create(&args[i].thread, NULL,
+		                                  checks_thread, &args[i]) == 0);
+	}
+	if (data->level & NSEC) {
+		checks_thread(seq);
+		data->next_nsec = seq->data.next_nsec;
+	}
+
+	int ret = seq->ret;
+	for (unsigned i = 0; i < threads; i++) {
+		if (!args[i].started) {
+			ret = KNOT_ERROR;
+			continue;
+		}
+		(void)pthread_join(args[i].thread, NULL);
+		if (ret == KNOT_EOK) {
+			ret = args[i].ret;
+		}
+	}
+	for (unsigned i = 0; i <= threads; i++) {
+		if (ret == KNOT_EOK && args[i].rec.nomem) {
+			ret = KNOT_ENOMEM;
+		}
+	}
+
+	// Merge the errors by the node sequence numbers.
+	while (ret == KNOT_EOK) {
+		sem_thread_t *min = NULL;
+		for (unsigned i = 0; i < threads; i++) {
+			sem_thread_t *arg = &args[i];
+			if (arg->next < arg->rec.count && (min == NULL ||
+			    arg->rec.recs[arg->next].idx < min->rec.recs[min->next].idx)) {
+				min = arg;
+			}
+		}
+		if (min == NULL) {
+			replay_records(seq, SIZE_MAX, data->zone, data->handler);
+			break;
+		}
+		size_t idx = min->rec.recs[min->next].idx;
+		replay_records(seq, idx, data->zone, data->handler);
+		replay_records(min, idx + 1, data->zone, data->handler);
+		replay_records(seq, idx + 1, data->zone, data->handler);
+	}
+
+	for (unsigned i = 0; i <= threads; i++) {
+		recorder_deinit(&args[i].rec);
+	}
+
+	return ret;
+}
+
 static void check_nsec3param(knot_rdataset_t *nsec3param, zone_contents_t *zone,
                              sem_handler_t *handler, semchecks_data_t *data)
 {
@@ -1254,7 +1463,7 @@ static int unmark_nsec3_optout(zone_node_t *node, _unused_ void *ctx)
 }
 
 int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_handler_t *handler,
-                       time_t time)
+                       time_t time, unsigned threads)
 {
 	if (handler == NULL) {
 		return KNOT_EINVAL;
@@ -1270,6 +1479,8 @@ int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_
 		.next_nsec = zone->apex,
 		.level = MANDATORY,
 		.time = time,
+		.parallel = true,
+		.sequential = true,
 	};
 
 	if (optional != SEMCHECK_MANDATORY_ONLY) {
@@ -1294,7 +1505,12 @@ int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_
 			return ret;
 		}
 	}
-	int ret = zone_contents_apply(zone, do_checks_in_tree, &data);
+	int ret;
+	if (threads > 1 && zone_tree_count(zone->nodes) >= SEM_PARALLEL_MIN_NODES) {
+		ret = checks_parallel(&data, threads);
+	} else {
+		ret = zone_contents_apply(zone, do_checks_in_tree, &data);
+	}
 	if (data.level & NSEC3) {
 		(void)zone_tree_apply(zone->nodes, unmark_nsec3_optout, NULL);
 	}
@@ -1315,3 +1531,55 @@ int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_
 
 	return KNOT_EOK;
 }
+
+int sem_checks_process_nodes(zone_contents_t *zone, zone_tree_t *nodes,
+                             semcheck_optional_t optional, sem_handler_t *handler,
+                             time_t time, unsigned threads)
+{
+	if (handler == NULL || nodes == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	// The DNSSEC checks follow the NSEC(3) chains over the whole zone.
+	if (optional == SEMCHECK_DNSSEC || optional == SEMCHECK_AUTO_DNSSEC) {
+		return sem_checks_process(zone, optional, handler, time, threads);
+	}
+
+	if (zone == NULL) {
+		return KNOT_EEMPTYZONE;
+	}
+
+	semchecks_data_t data = {
+		.handler = handler,
+		.zone = zone,
+		.nodes = nodes,
+		.level = MANDATORY,
+		.time = time,
+		.parallel = true,
+		.sequential = true,
+	};
+	if (optional != SEMCHECK_MANDATORY_ONLY) {
+		data.level |= OPTIONAL;
+	}
+
+	// The apex is checked even if untouched (e.g. SOA presence).
+	int ret = KNOT_EOK;
+	if (zone_tree_get(nodes, zone->apex->owner) == NULL) {
+		ret = do_checks_in_tree(zone->apex, &data);
+	}
+	if (ret == KNOT_EOK) {
+		if (threads > 1 && zone_tree_count(nodes) >= SEM_PARALLEL_MIN_NODES) {
+			ret = checks_parallel(&data, threads);
+		} else {
+			ret = zone_tree_apply(nodes, do_checks_in_tree, &data);
+		}
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (data.handler->fatal_error) {
+		return KNOT_ESEMCHECK;
+	}
+
+	return KNOT_EOK;
+}
@@ -18,6 +18,7 @@
 
 #include "knot/zone/node.h"
 #include "knot/zone/contents.h"
+#include "knot/dnssec/valid-cache.h"
 
 typedef enum {
 	SEMCHECK_MANDATORY_ONLY,
@@ -114,17 +115,21 @@ struct sem_handler {
 	bool fatal_error; /* Error(s) in the zonefile. */
 	bool warning;     /* Warning(s) in the zonefile. */
 	bool error;       /* An error in the current check. */
+	valid_cache_t *valid_cache; /* Optional cache of validated signatures. */
 };
 
 /*!
  * \brief Check zone for semantic errors.
  *
- * Errors are logged in error handler.
+ * Errors are logged in error handler. If the handler has a validation cache,
+ * the signatures found in it aren't verified again and the newly verified
+ * ones are recorded into it.
  *
  * \param zone      Zone to be searched / checked.
  * \param optional  To do also optional check.
  * \param handler   Semantic error handler.
  * \param time      Check zone at given time (rrsig expiration).
+ * \param threads   Number of threads checking the nodes (0 or 1 for sequential).
  *
  * \retval KNOT_EOK         no error found
  * \retval KNOT_ESEMCHECK   found semantic error
@@ -132,4 +137,29 @@ struct sem_handler {
  * \retval KNOT_EINVAL      another error
  */
 int sem_checks_process(zone_contents_t *zone, semcheck_optional_t optional, sem_handler_t *handler,
-                       time_t time);
+                       time_t time, unsigned threads);
+
+/*!
+ * \brief Check the given zone nodes for semantic errors.
+ *
+ * Only the checks not depending on the other nodes are run (e.g. for CNAME
+ * and DNAME owners or delegation points), so the nodes must include all those
+ * whose result may have changed, i.e. the changed nodes with their parents.
+ * The zone apex is always checked. With DNSSEC checks, the whole zone is
+ * checked as with sem_checks_process().
+ *
+ * \param zone      Zone to be checked.
+ * \param nodes     Nodes to be checked (e.g. affected by an incremental update).
+ * \param optional  To do also optional check.
+ * \param handler   Semantic error handler.
+ * \param time      Check zone at given time (rrsig expiration).
+ * \param threads   Number of threads checking the nodes (0 or 1 for sequential).
+ *
+ * \retval KNOT_EOK         no error found
+ * \retval KNOT_ESEMCHECK   found semantic error
+ * \retval KNOT_EEMPTYZONE  the zone is empty
+ * \retval KNOT_EINVAL      another error
+ */
+int sem_checks_process_nodes(zone_contents_t *zone, zone_tree_t *nodes,
+                             semcheck_optional_t optional, sem_handler_t *handler,
+                             time_t time, unsigned threads);
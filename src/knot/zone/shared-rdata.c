@@ -0,0 +1,269 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/zone/shared-rdata.h"
+#include "contrib/macros.h"
+#include "contrib/openbsd/siphash.h"
+#include "libdnssec/error.h"
+#include "libdnssec/random.h"
+#include "libknot/libknot.h"
+
+#define SHARDS		16
+#define BUCKETS_MIN	64
+
+typedef struct entry {
+	struct entry *next;
+	uint64_t hash;
+	uint32_t refs;
+	uint16_t type;
+	knot_rdataset_t rrs;     // Adopted rdata of the first zone.
+} entry_t;
+
+typedef struct {
+	pthread_mutex_t mx;
+	entry_t **buckets;
+	size_t size;             // Number of the buckets.
+	size_t count;            // Number of the entries.
+	shared_rdata_stats_t stats;
+} shard_t;
+
+static struct {
+	pthread_once_t once;
+	SIPHASH_KEY key;
+	size_t entries;          // Total count of the entries (updated atomically).
+	shard_t shards[SHARDS];
+} table = { .once = PTHREAD_ONCE_INIT };
+
+static void table_init(void)
+{
+	if (dnssec_random_buffer((uint8_t *)&table.key, sizeof(table.key)) != DNSSEC_EOK) {
+		memset(&table.key, 0, sizeof(table.key));
+	}
+	for (int i = 0; i < SHARDS; i++) {
+		pthread_mutex_init(&table.shards[i].mx, NULL);
+	}
+}
+
+static uint64_t rdata_hash(uint16_t type, const knot_rdataset_t *rrs)
+{
+	SIPHASH_CTX ctx;
+	SipHash24_Init(&ctx, &table.key);
+	SipHash24_Update(&ctx, &type, sizeof(type));
+	SipHash24_Update(&ctx, &rrs->count, sizeof(rrs->count));
+	SipHash24_Update(&ctx, rrs->rdata, rrs->size);
+	return SipHash24_End(&ctx);
+}
+
+static shard_t *get_shard(uint64_t hash)
+{
+	return &table.shards[hash >> 60];
+}
+
+static entry_t **bucket(shard_t *shard, uint64_t hash)
+{
+	return &shard->buckets[hash & (shard->size - 1)];
+}
+
+static bool shard_grow(shard_t *shard)
+{
+	if (shard->count < shard->size) {
+		return true;
+	}
+
+	size_t size = MAX(shard->size * 2, BUCKETS_MIN);
+	entry_t **buckets = calloc(size, sizeof(*buckets));
+	if (buckets == NULL) {
+		return false;
+	}
+
+	for (size_t i = 0; i < shard->size; i++) {
+		while (shard->buckets[i] != NULL) {
+			entry_t *e = shard->buckets[i];
+			shard->buckets[i] = e->next;
+			e->next = buckets[e->hash & (size - 1)];
+			buckets[e->hash & (size - 1)] = e;
+		}
+	}
+	free(shard->buckets);
+	shard->buckets = buckets;
+	shard->size = size;
+
+	return true;
+}
+
+static bool rdata_equal(const entry_t *e, uint64_t hash, uint16_t type,
+                        const knot_rdataset_t *rrs)
+{
+	return e->hash == hash && e->type == type && e->rrs.count == rrs->count &&
+	       e->rrs.size == rrs->size && memcmp(e->rrs.rdata, rrs->rdata, rrs->size) == 0;
+}
+
+/*! \brief Shares the rdataset, returns false on allocation failure. */
+static bool share(shard_t *shard, uint64_t hash, uint16_t type, knot_rdataset_t *rrs)
+{
+	for (entry_t *e = *bucket(shard, hash); e != NULL; e = e->next) {
+		if (e->rrs.rdata == rrs->rdata) {
+			return true; // Already shared.
+		}
+		if (rdata_equal(e, hash, type, rrs)) {
+			free(rrs->rdata);
+			rrs->rdata = e->rrs.rdata;
+			e->refs++;
+			shard->stats.refs++;
+			shard->stats.saved += rrs->size;
+			return true;
+		}
+	}
+
+	entry_t *e = malloc(sizeof(*e));
+	if (e == NULL || !shard_grow(shard)) {
+		free(e);
+		return false;
+	}
+	e->hash = hash;
+	e->refs = 1;
+	e->type = type;
+	e->rrs = *rrs;
+
+	entry_t **b = bucket(shard, hash);
+	e->next = *b;
+	*b = e;
+	shard->count++;
+	shard->stats.sets++;
+	shard->stats.refs++;
+	shard->stats.bytes += rrs->size;
+	__atomic_add_fetch(&table.entries, 1, __ATOMIC_RELAXED);
+
+	return true;
+}
+
+static bool shareable(uint16_t type)
+{
+	switch (type) {
+	case KNOT_RRTYPE_SOA:    // Unique and modified in place.
+	case KNOT_RRTYPE_RRSIG:
+	case KNOT_RRTYPE_NSEC:
+	case KNOT_RRTYPE_NSEC3:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static int share_node(zone_node_t *node, _unused_ void *data)
+{
+	zone_node_t *counter = binode_counterpart(node);
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		struct rr_data *rr = &node->rrs[i];
+		if (!shareable(rr->type) || rr->rrs.count == 0 ||
+		    (rr->flags & RR_DATA_MAPPED)) {
+			continue;
+		}
+		// A separate copy of the rdata pointer would be released twice.
+		if (counter != NULL && counter->rrs != node->rrs &&
+		    binode_rdata_shared(node, rr->type)) {
+			continue;
+		}
+
+		uint64_t hash = rdata_hash(rr->type, &rr->rrs);
+		shard_t *shard = get_shard(hash);
+		pthread_mutex_lock(&shard->mx);
+		bool ok = share(shard, hash, rr->type, &rr->rrs);
+		pthread_mutex_unlock(&shard->mx);
+		if (!ok) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int shared_rdata_share(zone_contents_t *contents)
+{
+	if (contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	(void)pthread_once(&table.once, table_init);
+
+	// The NSEC3 tree holds only the records unique to the zone.
+	return zone_tree_apply(contents->nodes, share_node, NULL);
+}
+
+bool shared_rdata_release(uint16_t type, const knot_rdataset_t *rrs)
+{
+	if (rrs == NULL || rrs->rdata == NULL || !shareable(type) ||
+	    __atomic_load_n(&table.entries, __ATOMIC_RELAXED) == 0) {
+		return false;
+	}
+
+	uint64_t hash = rdata_hash(type, rrs);
+	shard_t *shard = get_shard(hash);
+	bool shared = false;
+
+	pthread_mutex_lock(&shard->mx);
+	for (entry_t **it = (shard->size > 0) ? bucket(shard, hash) : NULL;
+	     it != NULL && *it != NULL; it = &(*it)->next) {
+		entry_t *e = *it;
+		if (e->rrs.rdata != rrs->rdata) {
+			continue;
+		}
+		shared = true;
+		shard->stats.refs--;
+		if (--e->refs > 0) {
+			shard->stats.saved -= e->rrs.size;
+			break;
+		}
+		*it = e->next;
+		shard->count--;
+		shard->stats.sets--;
+		shard->stats.bytes -= e->rrs.size;
+		__atomic_sub_fetch(&table.entries, 1, __ATOMIC_RELAXED);
+		free(e->rrs.rdata);
+		free(e);
+		break;
+	}
+	pthread_mutex_unlock(&shard->mx);
+
+	return shared;
+}
+
+void shared_rdata_stats(shared_rdata_stats_t *stats)
+{
+	if (stats == NULL) {
+		return;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	if (__atomic_load_n(&table.entries, __ATOMIC_RELAXED) == 0) {
+		return;
+	}
+
+	for (int i = 0; i < SHARDS; i++) {
+		shard_t *shard = &table.shards[i];
+		pthread_mutex_lock(&shard->mx);
+		stats->sets += shard->stats.sets;
+		stats->refs += shard->stats.refs;
+		stats->bytes += shard->stats.bytes;
+		stats->saved += shard->stats.saved;
+		pthread_mutex_unlock(&shard->mx);
+	}
+}
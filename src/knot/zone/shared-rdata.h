@@ -0,0 +1,72 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Sharing of identical rdatasets across the zones.
+ *
+ * Zones differing only in the apex name, e.g. parked domains, hold many
+ * identical rdatasets. The shared rdatasets are stored once, indexed by
+ * a hash of the type and the rdata, and reference counted. The owner TTL
+ * is kept in the node, so it doesn't prevent the sharing.
+ *
+ * The shared rdata are immutable. A zone update copies the rdataset of
+ * the modified node before the change as it does for any rdataset shared
+ * with the previous zone version, so only the updated zone gets its own copy.
+ * Releasing a shared rdataset just drops the reference.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "knot/zone/contents.h"
+
+/*! \brief Statistics of the shared rdatasets. */
+typedef struct {
+	size_t sets;    /*!< Number of the stored rdatasets. */
+	size_t refs;    /*!< Number of the references to them. */
+	size_t bytes;   /*!< Size of the stored rdata. */
+	size_t saved;   /*!< Size of the rdata deduplicated by the sharing. */
+} shared_rdata_stats_t;
+
+/*!
+ * \brief Replaces the rdatasets of the contents with the shared ones.
+ *
+ * The rdatasets not shared yet are adopted, not copied. SOA and the
+ * DNSSEC records unique to the zone are skipped.
+ *
+ * \param contents  Zone contents not published yet.
+ *
+ * \return KNOT_E*
+ */
+int shared_rdata_share(zone_contents_t *contents);
+
+/*!
+ * \brief Drops the reference to the rdataset if shared.
+ *
+ * \param type  Type of the rdataset.
+ * \param rrs   Rdataset being freed.
+ *
+ * \retval true if the rdataset was shared, it mustn't be freed by the caller.
+ * \retval false if the rdataset isn't shared.
+ */
+bool shared_rdata_release(uint16_t type, const knot_rdataset_t *rrs);
+
+/*!
+ * \brief Returns the statistics of the shared rdatasets.
+ */
+void shared_rdata_stats(shared_rdata_stats_t *stats);
@@ -0,0 +1,543 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "contrib/files.h"
+#include "contrib/string.h"
+#include "contrib/wire_ctx.h"
+#include "knot/journal/serialization.h"
+#include "knot/zone/mapped-rdata.h"
+#include "knot/zone/snapshot.h"
+#include "libdnssec/digest.h"
+#include "libdnssec/error.h"
+#include "libknot/libknot.h"
+
+#define SNAPSHOT_MAGIC       "KNOTZSNP"
+#define SNAPSHOT_MAGIC_LEN   8
+#define SNAPSHOT_HEADER_SIZE (SNAPSHOT_MAGIC_LEN + 4 + 4 + 8 + 4 + 8 + 8)
+#define SNAPSHOT_DIGEST      DNSSEC_DIGEST_SHA384
+#define SNAPSHOT_DIGEST_SIZE 48
+
+/*
+ * Snapshot layout (all numbers in network byte order):
+ *
+ *   magic[8] version[4] serial[4] mtime_sec[8] mtime_nsec[4] size[8]
+ *   rrset_count[8] apex_name rrset... digest[48]
+ *
+ * The digest covers all the preceding data.
+ */
+
+typedef struct {
+	FILE *file;
+	dnssec_digest_ctx_t *digest;
+	uint8_t *buf;
+	size_t buf_size;
+	uint64_t rrsets;
+} write_ctx_t;
+
+char *zone_snapshot_path(const char *zonefile)
+{
+	if (zonefile == NULL) {
+		return NULL;
+	}
+
+	return sprintf_alloc("%s%s", zonefile, ZONE_SNAPSHOT_SUFFIX);
+}
+
+static int write_data(write_ctx_t *ctx, uint8_t *data, size_t size)
+{
+	if (fwrite(data, size, 1, ctx->file) != 1) {
+		return KNOT_EFILE;
+	}
+	if (ctx->digest == NULL) {
+		return KNOT_EOK;
+	}
+
+	dnssec_binary_t bin = { .data = data, .size = size };
+	int ret = dnssec_digest(ctx->digest, &bin);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	return KNOT_EOK;
+}
+
+static int count_node(zone_node_t *node, void *data)
+{
+	write_ctx_t *ctx = data;
+	ctx->rrsets += node->rrset_count;
+
+	return KNOT_EOK;
+}
+
+static int write_node(zone_node_t *node, void *data)
+{
+	write_ctx_t *ctx = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		size_t size = rrset_serialized_size(&rrset);
+		if (size > ctx->buf_size) {
+			uint8_t *buf = realloc(ctx->buf, size);
+			if (buf == NULL) {
+				return KNOT_ENOMEM;
+			}
+			ctx->buf = buf;
+			ctx->buf_size = size;
+		}
+
+		wire_ctx_t wire = wire_ctx_init(ctx->buf, size);
+		int ret = serialize_rrset(&wire, &rrset);
+		if (ret == KNOT_EOK) {
+			ret = write_data(ctx, ctx->buf, wire_ctx_offset(&wire));
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static size_t write_header(uint8_t *header, size_t header_size, uint32_t serial,
+                           const struct stat *source, uint64_t rrsets,
+                           const knot_dname_t *apex)
+{
+	wire_ctx_t wire = wire_ctx_init(header, header_size);
+	wire_ctx_write(&wire, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+	wire_ctx_write_u32(&wire, ZONE_SNAPSHOT_VERSION);
+	wire_ctx_write_u32(&wire, serial);
+	wire_ctx_write_u64(&wire, source->st_mtim.tv_sec);
+	wire_ctx_write_u32(&wire, source->st_mtim.tv_nsec);
+	wire_ctx_write_u64(&wire, source->st_size);
+	wire_ctx_write_u64(&wire, rrsets);
+	wire_ctx_write(&wire, apex, knot_dname_size(apex));
+	assert(wire.error == KNOT_EOK);
+
+	return wire_ctx_offset(&wire);
+}
+
+static int write_digest(write_ctx_t *ctx)
+{
+	dnssec_binary_t digest = { 0 };
+	int ret = dnssec_digest_finish(ctx->digest, &digest);
+	ctx->digest = NULL;
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+	assert(digest.size == SNAPSHOT_DIGEST_SIZE);
+
+	if (fwrite(digest.data, digest.size, 1, ctx->file) != 1) {
+		ret = KNOT_EFILE;
+	}
+	dnssec_binary_free(&digest);
+
+	return ret;
+}
+
+static int write_snapshot(write_ctx_t *ctx, zone_contents_t *contents,
+                          const struct stat *source)
+{
+	int ret = zone_contents_apply(contents, count_node, ctx);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_nsec3_apply(contents, count_node, ctx);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	uint8_t header[SNAPSHOT_HEADER_SIZE + KNOT_DNAME_MAXLEN];
+	size_t header_len = write_header(header, sizeof(header),
+	                                 zone_contents_serial(contents), source,
+	                                 ctx->rrsets, contents->apex->owner);
+
+	ret = write_data(ctx, header, header_len);
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_apply(contents, write_node, ctx);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_contents_nsec3_apply(contents, write_node, ctx);
+	}
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return write_digest(ctx);
+}
+
+static int finish_file(write_ctx_t *ctx, const char *path, char *tmp_name, int ret)
+{
+	if (ctx->digest != NULL) {
+		dnssec_binary_t unused = { 0 };
+		(void)dnssec_digest_finish(ctx->digest, &unused);
+		dnssec_binary_free(&unused);
+	}
+	free(ctx->buf);
+
+	if (fclose(ctx->file) != 0 && ret == KNOT_EOK) {
+		ret = KNOT_EFILE;
+	}
+
+	/* Swap temporary snapshot and new snapshot. */
+	if (ret == KNOT_EOK && rename(tmp_name, path) != 0) {
+		ret = knot_map_errno();
+	}
+	if (ret != KNOT_EOK) {
+		unlink(tmp_name);
+	}
+	free(tmp_name);
+
+	return ret;
+}
+
+int zone_snapshot_write(zone_contents_t *contents, const char *path,
+                        const struct stat *source)
+{
+	if (contents == NULL || path == NULL || source == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	write_ctx_t ctx = { 0 };
+	char *tmp_name = NULL;
+	int ret = open_tmp_file(path, &tmp_name, &ctx.file, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = dnssec_digest_init(SNAPSHOT_DIGEST, &ctx.digest);
+	if (ret == DNSSEC_EOK) {
+		ret = write_snapshot(&ctx, contents, source);
+	} else {
+		ret = knot_error_from_libdnssec(ret);
+	}
+
+	return finish_file(&ctx, path, tmp_name, ret);
+}
+
+struct zone_snapshot_stream {
+	write_ctx_t ctx;
+	char *path;
+	char *tmp_name;
+	uint32_t serial;
+	knot_dname_t *apex;
+	int ret;
+};
+
+int zone_snapshot_stream_open(const char *path, const knot_dname_t *apex,
+                              uint32_t serial, zone_snapshot_stream_t **stream)
+{
+	if (path == NULL || apex == NULL || stream == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	zone_snapshot_stream_t *s = calloc(1, sizeof(*s));
+	if (s == NULL) {
+		return KNOT_ENOMEM;
+	}
+	s->serial = serial;
+	s->path = strdup(path);
+	s->apex = knot_dname_copy(apex, NULL);
+	if (s->path == NULL || s->apex == NULL) {
+		free(s->path);
+		knot_dname_free(s->apex, NULL);
+		free(s);
+		return KNOT_ENOMEM;
+	}
+
+	int ret = open_tmp_file(path, &s->tmp_name, &s->ctx.file,
+	                        S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	if (ret != KNOT_EOK) {
+		free(s->path);
+		knot_dname_free(s->apex, NULL);
+		free(s);
+		return ret;
+	}
+
+	// Placeholder, rewritten when the source and the record count are known.
+	struct stat none = { 0 };
+	uint8_t header[SNAPSHOT_HEADER_SIZE + KNOT_DNAME_MAXLEN];
+	size_t header_len = write_header(header, sizeof(header), serial, &none, 0, apex);
+	s->ret = write_data(&s->ctx, header, header_len);
+
+	*stream = s;
+
+	return KNOT_EOK;
+}
+
+int zone_snapshot_stream_write(zone_snapshot_stream_t *stream, const uint8_t *data,
+                               size_t size, uint64_t rrsets)
+{
+	if (stream == NULL || (data == NULL && size > 0)) {
+		return KNOT_EINVAL;
+	}
+
+	if (stream->ret == KNOT_EOK && size > 0) {
+		stream->ret = write_data(&stream->ctx, (uint8_t *)data, size);
+	}
+	stream->ctx.rrsets += rrsets;
+
+	return stream->ret;
+}
+
+static int stream_finish(zone_snapshot_stream_t *s, const struct stat *source)
+{
+	write_ctx_t *ctx = &s->ctx;
+
+	uint8_t header[SNAPSHOT_HEADER_SIZE + KNOT_DNAME_MAXLEN];
+	size_t header_len = write_header(header, sizeof(header), s->serial, source,
+	                                 ctx->rrsets, s->apex);
+	if (fseek(ctx->file, 0, SEEK_SET) != 0 ||
+	    fwrite(header, header_len, 1, ctx->file) != 1 ||
+	    fflush(ctx->file) != 0) {
+		return KNOT_EFILE;
+	}
+
+	int ret = dnssec_digest_init(SNAPSHOT_DIGEST, &ctx->digest);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	// The digest covers the final header, so the data are read back.
+	FILE *in = fopen(s->tmp_name, "r");
+	if (in == NULL) {
+		return knot_map_errno();
+	}
+	uint8_t buf[64 * 1024];
+	size_t len;
+	while (ret == KNOT_EOK && (len = fread(buf, 1, sizeof(buf), in)) > 0) {
+		dnssec_binary_t bin = { .data = buf, .size = len };
+		ret = dnssec_digest(ctx->digest, &bin);
+		if (ret != DNSSEC_EOK) {
+			ret = knot_error_from_libdnssec(ret);
+		}
+	}
+	if (ret == KNOT_EOK && ferror(in)) {
+		ret = KNOT_EFILE;
+	}
+	fclose(in);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (fseek(ctx->file, 0, SEEK_END) != 0) {
+		return KNOT_EFILE;
+	}
+
+	return write_digest(ctx);
+}
+
+int zone_snapshot_stream_close(zone_snapshot_stream_t *stream, const struct stat *source)
+{
+	if (stream == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = stream->ret;
+	if (source == NULL) {
+		ret = KNOT_ECONNABORTED;
+	} else if (ret == KNOT_EOK) {
+		ret = stream_finish(stream, source);
+	}
+	ret = finish_file(&stream->ctx, stream->path, stream->tmp_name, ret);
+	if (source == NULL) {
+		ret = KNOT_EOK;
+	}
+
+	free(stream->path);
+	knot_dname_free(stream->apex, NULL);
+	free(stream);
+
+	return ret;
+}
+
+static int verify_digest(const uint8_t *data, size_t size)
+{
+	dnssec_digest_ctx_t *digest_ctx = NULL;
+	int ret = dnssec_digest_init(SNAPSHOT_DIGEST, &digest_ctx);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	dnssec_binary_t bin = { .data = (uint8_t *)data, .size = size - SNAPSHOT_DIGEST_SIZE };
+	(void)dnssec_digest(digest_ctx, &bin);
+
+	dnssec_binary_t digest = { 0 };
+	ret = dnssec_digest_finish(digest_ctx, &digest);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+
+	if (digest.size != SNAPSHOT_DIGEST_SIZE ||
+	    memcmp(digest.data, data + bin.size, SNAPSHOT_DIGEST_SIZE) != 0) {
+		ret = KNOT_EMALF;
+	}
+	dnssec_binary_free(&digest);
+
+	return ret;
+}
+
+static int read_snapshot(const uint8_t *data, size_t size,
+                         const knot_dname_t *zone_name, const struct stat *source,
+                         zone_contents_t **out)
+{
+	if (size < SNAPSHOT_HEADER_SIZE + SNAPSHOT_DIGEST_SIZE ||
+	    memcmp(data, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0) {
+		return KNOT_EMALF;
+	}
+
+	wire_ctx_t wire = wire_ctx_init_const(data, size - SNAPSHOT_DIGEST_SIZE);
+	wire_ctx_skip(&wire, SNAPSHOT_MAGIC_LEN);
+	if (wire_ctx_read_u32(&wire) != ZONE_SNAPSHOT_VERSION) {
+		return KNOT_ENOTSUP;
+	}
+
+	uint32_t serial = wire_ctx_read_u32(&wire);
+	uint64_t mtime_sec = wire_ctx_read_u64(&wire);
+	uint32_t mtime_nsec = wire_ctx_read_u32(&wire);
+	uint64_t file_size = wire_ctx_read_u64(&wire);
+	uint64_t rrsets = wire_ctx_read_u64(&wire);
+	assert(wire.error == KNOT_EOK);
+
+	if (mtime_sec != source->st_mtim.tv_sec || mtime_nsec != source->st_mtim.tv_nsec ||
+	    file_size != source->st_size) {
+		return KNOT_ESEMCHECK;
+	}
+
+	int ret = verify_digest(data, size);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (knot_dname_wire_check(wire.position, wire.position + wire_ctx_available(&wire),
+	                          NULL) <= 0 ||
+	    !knot_dname_is_equal(wire.position, zone_name)) {
+		return KNOT_EMALF;
+	}
+	wire_ctx_skip(&wire, knot_dname_size(wire.position));
+
+	zone_contents_t *contents = zone_contents_new(zone_name, false);
+	if (contents == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	for (uint64_t i = 0; i < rrsets && ret == KNOT_EOK; i++) {
+		if (knot_dname_wire_check(wire.position, wire.position + wire_ctx_available(&wire),
+		                          NULL) <= 0) {
+			ret = KNOT_EMALF;
+			break;
+		}
+
+		knot_rrset_t rrset = { 0 };
+		ret = deserialize_rrset(&wire, &rrset);
+		if (ret == KNOT_EOK) {
+			zone_node_t *unused = NULL;
+			ret = zone_contents_add_rr(contents, &rrset, &unused);
+		}
+		knot_rrset_clear(&rrset, NULL);
+	}
+
+	if (ret == KNOT_EOK && (wire_ctx_available(&wire) != 0 ||
+	                        zone_contents_serial(contents) != serial)) {
+		ret = KNOT_EMALF;
+	}
+	if (ret != KNOT_EOK) {
+		zone_contents_deep_free(contents);
+		return ret;
+	}
+
+	*out = contents;
+
+	return KNOT_EOK;
+}
+
+int zone_snapshot_load(const char *path, const knot_dname_t *zone_name,
+                       const struct stat *source, zone_contents_t **contents)
+{
+	if (path == NULL || zone_name == NULL || source == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return knot_map_errno();
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		int ret = knot_map_errno();
+		close(fd);
+		return ret;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return KNOT_EMALF;
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return knot_map_errno();
+	}
+	(void)madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	int ret = read_snapshot(data, st.st_size, zone_name, source, contents);
+	munmap(data, st.st_size);
+
+	return ret;
+}
+
+int zone_snapshot_map_rdata(const char *path, zone_contents_t *contents)
+{
+	if (path == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return knot_map_errno();
+	}
+
+	// The trailing digest identifies the snapshot contents.
+	uint8_t digest[SNAPSHOT_DIGEST_SIZE];
+	struct stat st;
+	int ret = KNOT_EOK;
+	if (fstat(fd, &st) != 0) {
+		ret = knot_map_errno();
+	} else if (st.st_size < SNAPSHOT_HEADER_SIZE + SNAPSHOT_DIGEST_SIZE ||
+	           pread(fd, digest, sizeof(digest), st.st_size - sizeof(digest)) != sizeof(digest)) {
+		ret = KNOT_EMALF;
+	}
+	close(fd);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	char *image = sprintf_alloc("%s%s", path, ZONE_SNAPSHOT_RDATA_SUFFIX);
+	if (image == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ret = mapped_rdata_attach(contents, image, digest, sizeof(digest));
+	free(image);
+
+	return ret;
+}
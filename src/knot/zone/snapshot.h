@@ -0,0 +1,129 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Binary snapshot of zone file contents.
+ *
+ * The snapshot stores the records parsed from a zone file in the journal
+ * serialization format, so that the zone can be loaded without running the
+ * zone file parser. The snapshot is bound to the zone file it was created
+ * from by the zone file modification time and size, and its integrity is
+ * protected by a trailing digest.
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+
+#include "knot/zone/contents.h"
+
+#define ZONE_SNAPSHOT_VERSION 1
+#define ZONE_SNAPSHOT_SUFFIX  ".snapshot"
+#define ZONE_SNAPSHOT_RDATA_SUFFIX ".rdata"
+
+/*!
+ * \brief Returns the snapshot file path for the given zone file path.
+ *
+ * \param zonefile  Zone file path.
+ *
+ * \return Allocated snapshot path or NULL if error.
+ */
+char *zone_snapshot_path(const char *zonefile);
+
+/*!
+ * \brief Writes the snapshot of zone contents atomically.
+ *
+ * \param contents  Zone contents parsed from the zone file.
+ * \param path      Snapshot file path.
+ * \param source    Zone file status obtained before the zone file was parsed.
+ *
+ * \return KNOT_E*
+ */
+int zone_snapshot_write(zone_contents_t *contents, const char *path,
+                        const struct stat *source);
+
+typedef struct zone_snapshot_stream zone_snapshot_stream_t;
+
+/*!
+ * \brief Starts writing a snapshot record by record.
+ *
+ * Intended for contents that don't fit in memory, the records are written
+ * as they are produced and the snapshot is bound to its zone file once the
+ * zone file is complete.
+ *
+ * \param path    Snapshot file path.
+ * \param apex    Zone name.
+ * \param serial  SOA serial of the contents.
+ * \param stream  Output snapshot stream.
+ *
+ * \return KNOT_E*
+ */
+int zone_snapshot_stream_open(const char *path, const knot_dname_t *apex,
+                              uint32_t serial, zone_snapshot_stream_t **stream);
+
+/*!
+ * \brief Appends serialized records to the snapshot.
+ *
+ * \param stream  Snapshot stream.
+ * \param data    Records in the journal serialization format.
+ * \param size    Size of the data.
+ * \param rrsets  Number of the serialized RRSets.
+ *
+ * \return KNOT_E* (the first error is kept until the stream is closed).
+ */
+int zone_snapshot_stream_write(zone_snapshot_stream_t *stream, const uint8_t *data,
+                               size_t size, uint64_t rrsets);
+
+/*!
+ * \brief Finishes the snapshot and replaces the previous one atomically.
+ *
+ * \param stream  Snapshot stream (freed).
+ * \param source  Status of the written zone file, NULL to discard the snapshot.
+ *
+ * \return KNOT_E*
+ */
+int zone_snapshot_stream_close(zone_snapshot_stream_t *stream, const struct stat *source);
+
+/*!
+ * \brief Loads zone contents from the snapshot.
+ *
+ * \param path       Snapshot file path.
+ * \param zone_name  Zone name.
+ * \param source     Current zone file status.
+ * \param contents   Output zone contents (not adjusted).
+ *
+ * \retval KNOT_EOK       if success.
+ * \retval KNOT_ENOENT    if no snapshot exists.
+ * \retval KNOT_ESEMCHECK if the snapshot doesn't match the zone file.
+ * \retval KNOT_EMALF     if the snapshot is corrupted.
+ * \retval KNOT_E*        if other error.
+ */
+int zone_snapshot_load(const char *path, const knot_dname_t *zone_name,
+                       const struct stat *source, zone_contents_t **contents);
+
+/*!
+ * \brief Maps the rdata of the contents loaded from the snapshot from a shared image.
+ *
+ * The image is stored next to the snapshot (the snapshot path with the
+ * ZONE_SNAPSHOT_RDATA_SUFFIX) and bound to the snapshot by its digest, it's
+ * created by the first process loading the snapshot. See mapped_rdata_attach().
+ *
+ * \param path      Snapshot file path.
+ * \param contents  Contents loaded from the snapshot, not published yet.
+ *
+ * \return KNOT_E* (the contents are unchanged if error).
+ */
+int zone_snapshot_map_rdata(const char *path, zone_contents_t *contents);
@@ -158,18 +158,27 @@ int zone_timers_read(knot_lmdb_db_t *db, const knot_dname_t *zone,
 	}
 	knot_lmdb_txn_t txn = { 0 };
 	knot_lmdb_begin(db, &txn, false);
+	ret = zone_timers_read_txn(&txn, zone, timers);
+	knot_lmdb_abort(&txn);
+
+	return ret;
+}
+
+int zone_timers_read_txn(knot_lmdb_txn_t *txn, const knot_dname_t *zone,
+                         zone_timers_t *timers)
+{
 	MDB_val k = { knot_dname_size(zone), (void *)zone };
-	if (knot_lmdb_find(&txn, &k, KNOT_LMDB_EXACT | KNOT_LMDB_FORCE)) {
-		deserialize_timers(timers, txn.cur_val.mv_data, txn.cur_val.mv_size);
+	if (!knot_lmdb_find(txn, &k, KNOT_LMDB_EXACT)) {
+		return txn->ret == KNOT_EOK ? KNOT_ENOENT : txn->ret;
 	}
-	knot_lmdb_abort(&txn);
+	(void)deserialize_timers(timers, txn->cur_val.mv_data, txn->cur_val.mv_size);
 
 	// backward compatibility
 	if (timers->next_expire == 0 && timers->last_refresh > 0) {
 		timers->next_expire = timers->last_refresh + timers->soa_expire;
 	}
 
-	return txn.ret;
+	return KNOT_EOK;
 }
 
 int zone_timers_write(knot_lmdb_db_t *db, const knot_dname_t *zone,
@@ -182,22 +191,111 @@ int zone_timers_write(knot_lmdb_db_t *db, const knot_dname_t *zone,
 	return txn.ret;
 }
 
-static void txn_zone_write(zone_t *z, knot_lmdb_txn_t *txn)
+int zone_timers_write_all(knot_lmdb_db_t *db, trie_t *timers)
+{
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, true);
+	trie_it_t *it = trie_it_begin(timers);
+	for (; !trie_it_finished(it) && txn.ret == KNOT_EOK; trie_it_next(it)) {
+		const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+		txn_write_timers(&txn, name, *trie_it_val(it));
+	}
+	trie_it_free(it);
+	knot_lmdb_commit(&txn);
+	return txn.ret;
+}
+
+bool zone_timers_equal(const zone_timers_t *a, const zone_timers_t *b)
+{
+	return a->soa_expire == b->soa_expire &&
+	       a->last_flush == b->last_flush &&
+	       a->last_refresh == b->last_refresh &&
+	       a->next_refresh == b->next_refresh &&
+	       a->last_refresh_ok == b->last_refresh_ok &&
+	       a->last_notified_serial == b->last_notified_serial &&
+	       a->next_ds_check == b->next_ds_check &&
+	       a->next_ds_push == b->next_ds_push &&
+	       a->catalog_member == b->catalog_member &&
+	       a->next_expire == b->next_expire;
+}
+
+int zone_timers_dirty_init(zone_timers_dirty_t *dirty)
+{
+	dirty->zones = trie_create(NULL);
+	if (dirty->zones == NULL) {
+		return KNOT_ENOMEM;
+	}
+	pthread_mutex_init(&dirty->lock, NULL);
+	return KNOT_EOK;
+}
+
+void zone_timers_dirty_deinit(zone_timers_dirty_t *dirty)
+{
+	if (dirty->zones != NULL) {
+		pthread_mutex_destroy(&dirty->lock);
+		trie_free(dirty->zones);
+		dirty->zones = NULL;
+	}
+}
+
+void zone_timers_dirty_add(zone_timers_dirty_t *dirty, const knot_dname_t *zone)
 {
-	txn_write_timers(txn, z->name, &z->timers);
+	pthread_mutex_lock(&dirty->lock);
+	(void)trie_get_ins(dirty->zones, (const trie_key_t *)zone, knot_dname_size(zone));
+	pthread_mutex_unlock(&dirty->lock);
 }
 
-int zone_timers_write_all(knot_lmdb_db_t *db, knot_zonedb_t *zonedb)
+int zone_timers_dirty_flush(knot_lmdb_db_t *db, zone_timers_dirty_t *dirty,
+                            knot_zonedb_t *zonedb)
 {
+	trie_t *empty = trie_create(NULL);
+	if (empty == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// Take the current set, new changes are collected meanwhile.
+	pthread_mutex_lock(&dirty->lock);
+	trie_t *zones = dirty->zones;
+	dirty->zones = empty;
+	pthread_mutex_unlock(&dirty->lock);
+
+	if (trie_weight(zones) == 0) {
+		trie_free(zones);
+		return KNOT_EOK;
+	}
+
 	int ret = knot_lmdb_open(db);
+	if (ret == KNOT_EOK) {
+		knot_lmdb_txn_t txn = { 0 };
+		knot_lmdb_begin(db, &txn, true);
+		trie_it_t *it = trie_it_begin(zones);
+		for (; !trie_it_finished(it); trie_it_next(it)) {
+			const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+			zone_t *zone = knot_zonedb_find(zonedb, name);
+			if (zone != NULL) {
+				txn_write_timers(&txn, zone->name, &zone->timers);
+			}
+		}
+		trie_it_free(it);
+		knot_lmdb_commit(&txn);
+		ret = txn.ret;
+	}
+
+	// Keep the zones for the next attempt.
 	if (ret != KNOT_EOK) {
-		return ret;
+		pthread_mutex_lock(&dirty->lock);
+		trie_it_t *it = trie_it_begin(zones);
+		for (; !trie_it_finished(it); trie_it_next(it)) {
+			size_t len;
+			const trie_key_t *key = trie_it_key(it, &len);
+			(void)trie_get_ins(dirty->zones, key, len);
+		}
+		trie_it_free(it);
+		pthread_mutex_unlock(&dirty->lock);
 	}
-	knot_lmdb_txn_t txn = { 0 };
-	knot_lmdb_begin(db, &txn, true);
-	knot_zonedb_foreach(zonedb, txn_zone_write, &txn);
-	knot_lmdb_commit(&txn);
-	return txn.ret;
+
+	trie_free(zones);
+	return ret;
 }
 
 int zone_timers_sweep(knot_lmdb_db_t *db, sweep_cb keep_zone, void *cb_data)
@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <pthread.h>
 #include <stdint.h>
 #include <time.h>
 
+#include "contrib/qp-trie/trie.h"
 #include "libknot/dname.h"
 #include "knot/journal/knot_lmdb.h"
 
@@ -59,6 +61,21 @@ typedef struct knot_zonedb knot_zonedb_t;
 int zone_timers_read(knot_lmdb_db_t *db, const knot_dname_t *zone,
                      zone_timers_t *timers);
 
+/*!
+ * \brief Load timers for one zone within an open transaction.
+ *
+ * Useful for reading timers of many zones at once.
+ *
+ * \param[in]  txn     Open read transaction of the timer database.
+ * \param[in]  zone    Zone name.
+ * \param[out] timers  Loaded timers
+ *
+ * \return KNOT_E*
+ * \retval KNOT_ENOENT  Zone not found in the database.
+ */
+int zone_timers_read_txn(knot_lmdb_txn_t *txn, const knot_dname_t *zone,
+                         zone_timers_t *timers);
+
 /*!
  * \brief Write timers for one zone.
  *
@@ -72,14 +89,61 @@ int zone_timers_write(knot_lmdb_db_t *db, const knot_dname_t *zone,
                       const zone_timers_t *timers);
 
 /*!
- * \brief Write timers for all zones.
+ * \brief Set of zones with changed timers to be persisted.
+ */
+typedef struct {
+	pthread_mutex_t lock;
+	trie_t *zones;          //!< Names of the zones.
+} zone_timers_dirty_t;
+
+/*!
+ * \brief Write the timers of many zones in one transaction.
+ *
+ * \param db      Timer database.
+ * \param timers  Trie of zone_timers_t pointers indexed by the zone names.
+ *
+ * \return KNOT_E*
+ */
+int zone_timers_write_all(knot_lmdb_db_t *db, trie_t *timers);
+
+/*!
+ * \brief Compare two sets of timers.
+ */
+bool zone_timers_equal(const zone_timers_t *a, const zone_timers_t *b);
+
+/*!
+ * \brief Initialize the set of zones with changed timers.
+ *
+ * \return KNOT_EOK, KNOT_ENOMEM
+ */
+int zone_timers_dirty_init(zone_timers_dirty_t *dirty);
+
+/*!
+ * \brief Deinitialize the set of zones with changed timers.
+ */
+void zone_timers_dirty_deinit(zone_timers_dirty_t *dirty);
+
+/*!
+ * \brief Mark the zone timers as changed.
+ */
+void zone_timers_dirty_add(zone_timers_dirty_t *dirty, const knot_dname_t *zone);
+
+/*!
+ * \brief Write the current timers of the changed zones in one transaction.
+ *
+ * The zones not present in the zone database are skipped. If the write
+ * fails, the zones are kept in the set for the next attempt.
+ *
+ * \note The zone database must be protected (e.g. RCU read lock).
  *
  * \param db      Timer database.
+ * \param dirty   Set of zones with changed timers.
  * \param zonedb  Zones database.
  *
  * \return KNOT_E*
  */
-int zone_timers_write_all(knot_lmdb_db_t *db, knot_zonedb_t *zonedb);
+int zone_timers_dirty_flush(knot_lmdb_db_t *db, zone_timers_dirty_t *dirty,
+                            knot_zonedb_t *zonedb);
 
 /*!
  * \brief Selectively delete zones from the database.
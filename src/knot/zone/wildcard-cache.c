@@ -0,0 +1,94 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "knot/zone/wildcard-cache.h"
+
+typedef struct {
+	const zone_node_t *encloser;
+	const zone_node_t *wildcard;
+} wildcard_entry_t;
+
+struct wildcard_cache {
+	wildcard_entry_t *entries[WILDCARD_CACHE_SIZE];
+};
+
+wildcard_cache_t *wildcard_cache_new(void)
+{
+	return calloc(1, sizeof(wildcard_cache_t));
+}
+
+void wildcard_cache_free(wildcard_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < WILDCARD_CACHE_SIZE; i++) {
+		free(cache->entries[i]);
+	}
+	free(cache);
+}
+
+static size_t entry_index(const zone_node_t *encloser)
+{
+	uint64_t key = (uintptr_t)encloser >> 4;
+	return (key * 0x9E3779B97F4A7C15ULL >> 32) % WILDCARD_CACHE_SIZE;
+}
+
+const zone_node_t *wildcard_cache_get(wildcard_cache_t *cache, const zone_node_t *encloser)
+{
+	if (cache == NULL || encloser == NULL) {
+		return NULL;
+	}
+
+	wildcard_entry_t *entry = __atomic_load_n(&cache->entries[entry_index(encloser)],
+	                                          __ATOMIC_ACQUIRE);
+	if (entry == NULL || entry->encloser != encloser) {
+		return NULL;
+	}
+
+	return entry->wildcard;
+}
+
+void wildcard_cache_put(wildcard_cache_t *cache, const zone_node_t *encloser,
+                        const zone_node_t *wildcard)
+{
+	if (cache == NULL || encloser == NULL || wildcard == NULL) {
+		return;
+	}
+
+	wildcard_entry_t **slot = &cache->entries[entry_index(encloser)];
+	if (__atomic_load_n(slot, __ATOMIC_RELAXED) != NULL) {
+		return;
+	}
+
+	wildcard_entry_t *entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		return;
+	}
+	entry->encloser = encloser;
+	entry->wildcard = wildcard;
+
+	// The readers don't lock, so a set entry is never replaced.
+	wildcard_entry_t *expected = NULL;
+	if (!__atomic_compare_exchange_n(slot, &expected, entry, false,
+	                                 __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+		free(entry);
+	}
+}
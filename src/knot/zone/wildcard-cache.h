@@ -0,0 +1,62 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Cache of the wildcard children of the closest enclosers.
+ *
+ * Each query for a name covered by a wildcard looks up the wildcard child
+ * of its closest encloser. The cache keeps the results of one zone contents
+ * version, the node pointers are valid as long as the contents.
+ *
+ * The cache is direct-mapped and lock-free. An entry is set only once, a
+ * colliding encloser isn't cached.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "knot/zone/node.h"
+
+#define WILDCARD_CACHE_SIZE	1024
+
+typedef struct wildcard_cache wildcard_cache_t;
+
+/*!
+ * \brief Creates a new empty cache of WILDCARD_CACHE_SIZE entries.
+ *
+ * \return Wildcard cache or NULL if error.
+ */
+wildcard_cache_t *wildcard_cache_new(void);
+
+/*!
+ * \brief Deallocates the cache (NULL is ignored).
+ */
+void wildcard_cache_free(wildcard_cache_t *cache);
+
+/*!
+ * \brief Looks up the wildcard child of the encloser.
+ *
+ * \return Wildcard node or NULL if not cached.
+ */
+const zone_node_t *wildcard_cache_get(wildcard_cache_t *cache, const zone_node_t *encloser);
+
+/*!
+ * \brief Stores the wildcard child of the encloser.
+ */
+void wildcard_cache_put(wildcard_cache_t *cache, const zone_node_t *encloser,
+                        const zone_node_t *wildcard);
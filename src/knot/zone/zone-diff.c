@@ -15,17 +15,33 @@
  */
 
 #include <assert.h>
-#include <stdlib.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "libknot/libknot.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/serial.h"
+#include "contrib/macros.h"
+
+#define DIFF_THREADS_MAX	64
+#define DIFF_PARALLEL_MIN	10000	// Smaller trees are diffed sequentially.
 
+/*! \brief Range of the canonical order to be diffed. */
 struct zone_diff_param {
-	zone_tree_t *nodes;
+	zone_tree_t *nodes1;
+	zone_tree_t *nodes2;
+	const trie_key_t *from;	// Including, NULL for the beginning.
+	uint32_t from_len;
+	const trie_key_t *to;	// Excluding, NULL for the end.
+	uint32_t to_len;
 	changeset_t *changeset;
 	bool ignore_dnssec;
+
+	pthread_t thread;
+	changeset_t ch;		// Partial changeset of a parallel range.
+	int ret;
 };
 
 static bool rrset_is_dnssec(const knot_rrset_t *rrset)
@@ -207,36 +223,16 @@ static int diff_rrsets(const knot_rrset_t *rrset1, const knot_rrset_t *rrset2,
 	return KNOT_EOK;
 }
 
-/*!< \todo this could be generic function for adding / removing. */
-static int knot_zone_diff_node(zone_node_t *node, void *data)
+static int diff_nodes(const zone_node_t *node, const zone_node_t *node2,
+                      changeset_t *changeset, bool ignore_dnssec)
 {
-	if (node == NULL || data == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/*
-	 * First, we have to search the second tree to see if there's according
-	 * node, if not, the whole node has been removed.
-	 */
-	zone_node_t *node_in_second_tree = zone_tree_get(param->nodes, node->owner);
-	if (node_in_second_tree == NULL) {
-		return remove_node(node, param->changeset, param->ignore_dnssec);
-	}
-
-	assert(node_in_second_tree != node);
-
 	/* The nodes are in both trees, we have to diff each RRSet. */
 	if (node->rrset_count == 0) {
 		/*
 		 * If there are no RRs in the first tree, all of the RRs
 		 * in the second tree will have to be inserted to ADD section.
 		 */
-		return add_node(node_in_second_tree, param->changeset, param->ignore_dnssec);
+		return add_node(node2, changeset, ignore_dnssec);
 	}
 
 	for (unsigned i = 0; i < node->rrset_count; i++) {
@@ -248,47 +244,43 @@ static int knot_zone_diff_node(zone_node_t *node, void *data)
 			continue;
 		}
 
-		if (param->ignore_dnssec && rrset_is_dnssec(&rrset)) {
+		if (ignore_dnssec && rrset_is_dnssec(&rrset)) {
 			continue;
 		}
 
-		knot_rrset_t rrset_from_second_node =
-			node_rrset(node_in_second_tree, rrset.type);
+		knot_rrset_t rrset_from_second_node = node_rrset(node2, rrset.type);
 		if (knot_rrset_empty(&rrset_from_second_node)) {
 			/* RRSet has been removed. Make a copy and remove. */
-			int ret = changeset_add_removal(
-				param->changeset, &rrset, 0);
+			int ret = changeset_add_removal(changeset, &rrset, 0);
 			if (ret != KNOT_EOK) {
 				return ret;
 			}
 		} else {
 			/* Diff RRSets. */
-			int ret = diff_rrsets(&rrset, &rrset_from_second_node,
-			                      param->changeset);
+			int ret = diff_rrsets(&rrset, &rrset_from_second_node, changeset);
 			if (ret != KNOT_EOK) {
 				return ret;
 			}
 		}
 	}
 
-	for (unsigned i = 0; i < node_in_second_tree->rrset_count; i++) {
+	for (unsigned i = 0; i < node2->rrset_count; i++) {
 		/* Search for the RRSet in the node from the second tree. */
-		knot_rrset_t rrset = node_rrset_at(node_in_second_tree, i);
+		knot_rrset_t rrset = node_rrset_at(node2, i);
 
 		/* SOAs are handled explicitly. */
 		if (rrset.type == KNOT_RRTYPE_SOA) {
 			continue;
 		}
 
-		if (param->ignore_dnssec && rrset_is_dnssec(&rrset)) {
+		if (ignore_dnssec && rrset_is_dnssec(&rrset)) {
 			continue;
 		}
 
 		knot_rrset_t rrset_from_first_node = node_rrset(node, rrset.type);
 		if (knot_rrset_empty(&rrset_from_first_node)) {
 			/* RRSet has been added. Make a copy and add. */
-			int ret = changeset_add_addition(
-				param->changeset, &rrset, 0);
+			int ret = changeset_add_addition(changeset, &rrset, 0);
 			if (ret != KNOT_EOK) {
 				return ret;
 			}
@@ -298,56 +290,194 @@ static int knot_zone_diff_node(zone_node_t *node, void *data)
 	return KNOT_EOK;
 }
 
-/*!< \todo possibly not needed! */
-static int add_new_nodes(zone_node_t *node, void *data)
+static int key_cmp(const trie_key_t *key1, size_t len1,
+                   const trie_key_t *key2, size_t len2)
 {
-	if (node == NULL || data == NULL) {
-		return KNOT_EINVAL;
+	int ret = memcmp(key1, key2, MIN(len1, len2));
+	if (ret == 0) {
+		ret = (len1 > len2) - (len1 < len2);
 	}
+	return ret;
+}
 
-	struct zone_diff_param *param = (struct zone_diff_param *)data;
-	if (param->changeset == NULL) {
-		return KNOT_EINVAL;
+static int range_begin(zone_tree_t *tree, const struct zone_diff_param *param,
+                       trie_it_t **it)
+{
+	if (zone_tree_is_empty(tree)) {
+		*it = NULL;
+		return KNOT_EOK;
 	}
 
-	/*
-	* If a node is not present in the second zone, it is a new node
-	* and has to be added to changeset. Differences on the RRSet level are
-	* already handled.
-	*/
-	zone_node_t *new_node = zone_tree_get(param->nodes, node->owner);
-	if (new_node == NULL) {
-		assert(node);
-		return add_node(node, param->changeset, param->ignore_dnssec);
+	*it = trie_it_begin(tree->trie);
+	if (*it == NULL) {
+		return KNOT_ENOMEM;
+	}
+	if (param->from != NULL) {
+		(void)trie_it_get_geq(*it, param->from, param->from_len);
 	}
 
 	return KNOT_EOK;
 }
 
+static bool range_finished(trie_it_t *it, const struct zone_diff_param *param)
+{
+	if (it == NULL || trie_it_finished(it)) {
+		return true;
+	}
+	if (param->to == NULL) {
+		return false;
+	}
+
+	size_t len;
+	const trie_key_t *key = trie_it_key(it, &len);
+	return key_cmp(key, len, param->to, param->to_len) >= 0;
+}
+
+/*!
+ * \brief Compares the nodes of both trees in the range in canonical order.
+ *
+ * Subtrees shared by the trees (after COW) are identical and skipped.
+ */
+static int diff_range(struct zone_diff_param *param)
+{
+	trie_it_t *it1 = NULL, *it2 = NULL;
+	int ret = range_begin(param->nodes1, param, &it1);
+	if (ret == KNOT_EOK) {
+		ret = range_begin(param->nodes2, param, &it2);
+	}
+
+	while (ret == KNOT_EOK) {
+		bool fin1 = range_finished(it1, param);
+		bool fin2 = range_finished(it2, param);
+		if (fin1 && fin2) {
+			break;
+		}
+
+		int cmp = fin1 ? 1 : -1;
+		if (!fin1 && !fin2) {
+			size_t len1, len2;
+			const trie_key_t *key1 = trie_it_key(it1, &len1);
+			const trie_key_t *key2 = trie_it_key(it2, &len2);
+			cmp = key_cmp(key1, len1, key2, len2);
+			if (cmp == 0 && trie_it_skip_shared(it1, it2)) {
+				continue;
+			}
+		}
+
+		if (cmp < 0) {
+			/* The whole node has been removed. */
+			zone_node_t *node = zone_tree_fix_get(*trie_it_val(it1), param->nodes1);
+			ret = remove_node(node, param->changeset, param->ignore_dnssec);
+			trie_it_next(it1);
+		} else if (cmp > 0) {
+			/* The whole node has been added. */
+			zone_node_t *node = zone_tree_fix_get(*trie_it_val(it2), param->nodes2);
+			ret = add_node(node, param->changeset, param->ignore_dnssec);
+			trie_it_next(it2);
+		} else {
+			zone_node_t *node1 = zone_tree_fix_get(*trie_it_val(it1), param->nodes1);
+			zone_node_t *node2 = zone_tree_fix_get(*trie_it_val(it2), param->nodes2);
+			ret = diff_nodes(node1, node2, param->changeset, param->ignore_dnssec);
+			trie_it_next(it1);
+			trie_it_next(it2);
+		}
+	}
+
+	trie_it_free(it1);
+	trie_it_free(it2);
+
+	return ret;
+}
+
+static void *diff_range_thread(void *arg)
+{
+	struct zone_diff_param *param = arg;
+	param->ret = diff_range(param);
+	return NULL;
+}
+
 static int load_trees(zone_tree_t *nodes1, zone_tree_t *nodes2,
-		      changeset_t *changeset, bool ignore_dnssec)
+                      changeset_t *changeset, bool ignore_dnssec, unsigned threads)
 {
 	assert(changeset);
 
-	struct zone_diff_param param = {
+	struct zone_diff_param whole = {
+		.nodes1 = nodes1,
+		.nodes2 = nodes2,
 		.changeset = changeset,
 		.ignore_dnssec = ignore_dnssec,
 	};
 
-	// Traverse one tree, compare every node, each RRSet with its rdata.
-	param.nodes = nodes2;
-	int ret = zone_tree_apply(nodes1, knot_zone_diff_node, &param);
-	if (ret != KNOT_EOK) {
-		return ret;
+	// Split the trees to aligned ranges of the canonical order.
+	threads = MIN(threads, DIFF_THREADS_MAX);
+	trie_key_t *keys[DIFF_THREADS_MAX];
+	uint32_t lens[DIFF_THREADS_MAX];
+	size_t nkeys = 0;
+	if (threads > 1 && zone_tree_count(nodes1) >= DIFF_PARALLEL_MIN) {
+		nkeys = trie_split_keys(nodes1->trie, threads, keys, lens);
+	}
+	if (nkeys == 0) {
+		return diff_range(&whole);
+	}
+
+	size_t parts = nkeys + 1;
+	struct zone_diff_param *params = calloc(parts, sizeof(*params));
+	if (params == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = KNOT_EOK;
+	size_t inited = 0;
+	for (; inited < parts; inited++) {
+		struct zone_diff_param *p = &params[inited];
+		ret = changeset_init(&p->ch, changeset->add->apex->owner);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		p->nodes1 = nodes1;
+		p->nodes2 = nodes2;
+		p->changeset = &p->ch;
+		p->ignore_dnssec = ignore_dnssec;
+		if (inited > 0) {
+			p->from = keys[inited - 1];
+			p->from_len = lens[inited - 1];
+		}
+		if (inited < nkeys) {
+			p->to = keys[inited];
+			p->to_len = lens[inited];
+		}
+	}
+
+	// Each range is diffed into its own changeset.
+	size_t started = 0;
+	for (; ret == KNOT_EOK && started < parts; started++) {
+		if (pthread_create(&params[started].thread, NULL,
+		                   diff_range_thread, &params[started]) != 0) {
+			ret = KNOT_ERROR;
+			break;
+		}
+	}
+	for (size_t i = 0; i < started; i++) {
+		pthread_join(params[i].thread, NULL);
+		if (ret == KNOT_EOK) {
+			ret = params[i].ret;
+		}
+	}
+
+	// Merge the partial changesets in order.
+	for (size_t i = 0; i < inited; i++) {
+		if (ret == KNOT_EOK) {
+			ret = changeset_merge(changeset, &params[i].ch, 0);
+		}
+		changeset_clear(&params[i].ch);
 	}
+	free(params);
 
-	// Some nodes may have been added. Add missing nodes to changeset.
-	param.nodes = nodes1;
-	return zone_tree_apply(nodes2, add_new_nodes, &param);
+	return ret;
 }
 
 int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone2,
-		       changeset_t *changeset, bool ignore_dnssec)
+                       changeset_t *changeset, bool ignore_dnssec, unsigned threads)
 {
 	if (changeset == NULL) {
 		return KNOT_EINVAL;
@@ -362,12 +492,12 @@ int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone
 		return ret_soa;
 	}
 
-	int ret = load_trees(zone1->nodes, zone2->nodes, changeset, ignore_dnssec);
+	int ret = load_trees(zone1->nodes, zone2->nodes, changeset, ignore_dnssec, threads);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	ret = load_trees(zone1->nsec3_nodes, zone2->nsec3_nodes, changeset, ignore_dnssec);
+	ret = load_trees(zone1->nsec3_nodes, zone2->nsec3_nodes, changeset, ignore_dnssec, threads);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -385,5 +515,5 @@ int zone_tree_add_diff(zone_tree_t *t1, zone_tree_t *t2, changeset_t *changeset)
 		return KNOT_EINVAL;
 	}
 
-	return load_trees(t1, t2, changeset, false);
+	return load_trees(t1, t2, changeset, false, 1);
 }
@@ -21,9 +21,12 @@
 
 /*!
  * \brief Create diff between two zone trees.
+ *
+ * Big trees are split into ranges diffed in parallel by \a threads threads.
+ * Subtrees shared by both zones (copy-on-write) are skipped.
  * */
 int zone_contents_diff(const zone_contents_t *zone1, const zone_contents_t *zone2,
-                       changeset_t *changeset, bool ignore_dnssec);
+                       changeset_t *changeset, bool ignore_dnssec, unsigned threads);
 
 /*!
  * \brief Add diff between two zone trees into the changeset.
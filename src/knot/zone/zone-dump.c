@@ -15,7 +15,9 @@
  */
 
 #include <inttypes.h>
+#include <pthread.h>
 
+#include "contrib/macros.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/zone/zone-dump.h"
 #include "libknot/libknot.h"
@@ -23,11 +25,25 @@
 /*! \brief Size of auxiliary buffer. */
 #define DUMP_BUF_LEN (70 * 1024)
 
+/*! \brief Size of the formatted output written to the file at once. */
+#define DUMP_OUT_LEN (1024 * 1024)
+
+#define DUMP_BATCH 1024     // Nodes formatted by one thread at once.
+#define DUMP_PIPE_DEPTH 2   // Formatted batches per thread waiting for writing.
+
+/*! \brief Formatted output. */
+typedef struct {
+	char *data;
+	size_t size;
+	size_t max;
+	bool ready; // Waiting for writing, owned by the writing thread.
+} dump_chunk_t;
+
 /*! \brief Dump parameters. */
 typedef struct {
-	FILE     *file;
 	char     *buf;
 	size_t   buflen;
+	dump_chunk_t *out;
 	uint64_t rr_count;
 	bool     dump_rrsig;
 	bool     dump_nsec;
@@ -36,20 +52,52 @@ typedef struct {
 	const char *first_comment;
 } dump_params_t;
 
+static int chunk_append(dump_chunk_t *chunk, const char *data, size_t len)
+{
+	if (chunk->size + len > chunk->max) {
+		size_t new_max = MAX(2 * chunk->max, chunk->size + len);
+		char *new_data = realloc(chunk->data, new_max);
+		if (new_data == NULL) {
+			return KNOT_ENOMEM;
+		}
+		chunk->data = new_data;
+		chunk->max = new_max;
+	}
+	memcpy(chunk->data + chunk->size, data, len);
+	chunk->size += len;
+	return KNOT_EOK;
+}
+
+static int chunk_write(dump_chunk_t *chunk, FILE *file)
+{
+	if (chunk->size > 0 && fwrite(chunk->data, chunk->size, 1, file) != 1) {
+		return KNOT_EFILE;
+	}
+	chunk->size = 0;
+	return KNOT_EOK;
+}
+
+static int rrset_dump_text(knot_rrset_t *rrset, dump_params_t *params)
+{
+	int ret = knot_rrset_txt_dump(rrset, &params->buf, &params->buflen,
+	                              params->style);
+	if (ret < 0) {
+		return ret;
+	}
+	params->rr_count += rrset->rrs.count;
+	return chunk_append(params->out, params->buf, ret);
+}
+
 static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 {
 	knot_rrset_t soa = node_rrset(node, KNOT_RRTYPE_SOA);
 
 	// Dump SOA record as a first.
 	if (!params->dump_nsec) {
-		int ret = knot_rrset_txt_dump(&soa, &params->buf, &params->buflen,
-		                              params->style);
-		if (ret < 0) {
+		int ret = rrset_dump_text(&soa, params);
+		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		params->rr_count += soa.rrs.count;
-		fprintf(params->file, "%s", params->buf);
-		params->buf[0] = '\0';
 	}
 
 	// Dump other records.
@@ -66,14 +114,10 @@ static int apex_node_dump_text(zone_node_t *node, dump_params_t *params)
 			break;
 		}
 
-		int ret = knot_rrset_txt_dump(&rrset, &params->buf, &params->buflen,
-		                              params->style);
-		if (ret < 0) {
+		int ret = rrset_dump_text(&rrset, params);
+		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		params->rr_count +=  rrset.rrs.count;
-		fprintf(params->file, "%s", params->buf);
-		params->buf[0] = '\0';
 	}
 
 	return KNOT_EOK;
@@ -118,24 +162,258 @@ static int node_dump_text(zone_node_t *node, void *data)
 
 		// Dump block comment if available.
 		if (params->first_comment != NULL) {
-			fprintf(params->file, "%s", params->first_comment);
+			int ret = chunk_append(params->out, params->first_comment,
+			                       strlen(params->first_comment));
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
 			params->first_comment = NULL;
 		}
 
-		int ret = knot_rrset_txt_dump(&rrset, &params->buf, &params->buflen,
-		                              params->style);
-		if (ret < 0) {
+		int ret = rrset_dump_text(&rrset, params);
+		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		params->rr_count += rrset.rrs.count;
-		fprintf(params->file, "%s", params->buf);
-		params->buf[0] = '\0';
 	}
 
 	return KNOT_EOK;
 }
 
-int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char *color)
+typedef struct {
+	dump_params_t *params;
+	FILE *file;
+} dump_seq_ctx_t;
+
+static int node_dump_seq(zone_node_t *node, void *data)
+{
+	dump_seq_ctx_t *ctx = data;
+
+	int ret = node_dump_text(node, ctx->params);
+	if (ret == KNOT_EOK && ctx->params->out->size >= DUMP_OUT_LEN) {
+		ret = chunk_write(ctx->params->out, ctx->file);
+	}
+	return ret;
+}
+
+typedef struct dump_pipe dump_pipe_t;
+
+typedef struct {
+	dump_params_t params;
+	dump_pipe_t *pipe;
+	unsigned thr_id;
+	size_t produced;  // Count of published batches.
+	bool finished;
+	pthread_t thread;
+	dump_chunk_t chunks[DUMP_PIPE_DEPTH];
+} dump_producer_t;
+
+struct dump_pipe {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	zone_tree_t *tree;
+	unsigned threads;
+	int ret;          // First error, stops all the threads.
+	dump_producer_t *prods;
+};
+
+static dump_chunk_t *chunk_acquire(dump_producer_t *prod)
+{
+	dump_pipe_t *pipe = prod->pipe;
+	dump_chunk_t *chunk = &prod->chunks[prod->produced % DUMP_PIPE_DEPTH];
+
+	pthread_mutex_lock(&pipe->lock);
+	while (chunk->ready && pipe->ret == KNOT_EOK) {
+		pthread_cond_wait(&pipe->cond, &pipe->lock);
+	}
+	bool ok = (pipe->ret == KNOT_EOK);
+	pthread_mutex_unlock(&pipe->lock);
+
+	chunk->size = 0;
+	return ok ? chunk : NULL;
+}
+
+static void chunk_publish(dump_producer_t *prod, dump_chunk_t *chunk)
+{
+	dump_pipe_t *pipe = prod->pipe;
+
+	pthread_mutex_lock(&pipe->lock);
+	chunk->ready = true;
+	prod->produced++;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+}
+
+/*!
+ * \brief Formats every threads-th batch of nodes.
+ */
+static void *dump_producer_thread(void *arg)
+{
+	dump_producer_t *prod = arg;
+	dump_pipe_t *pipe = prod->pipe;
+
+	zone_tree_it_t it = { 0 };
+	int ret = zone_tree_it_begin(pipe->tree, &it);
+	for (size_t i = 0; ret == KNOT_EOK && !zone_tree_it_finished(&it); i++) {
+		if ((i / DUMP_BATCH) % pipe->threads == prod->thr_id) {
+			if (prod->params.out == NULL &&
+			    (prod->params.out = chunk_acquire(prod)) == NULL) {
+				break; // Stopped by another thread.
+			}
+			ret = node_dump_text(zone_tree_it_val(&it), &prod->params);
+		} else if (prod->params.out != NULL) {
+			chunk_publish(prod, prod->params.out);
+			prod->params.out = NULL;
+		}
+		zone_tree_it_next(&it);
+	}
+	zone_tree_it_free(&it);
+	if (ret == KNOT_EOK && prod->params.out != NULL) {
+		chunk_publish(prod, prod->params.out);
+	}
+	prod->params.out = NULL;
+
+	pthread_mutex_lock(&pipe->lock);
+	if (ret != KNOT_EOK && pipe->ret == KNOT_EOK) {
+		pipe->ret = ret;
+	}
+	prod->finished = true;
+	pthread_cond_broadcast(&pipe->cond);
+	pthread_mutex_unlock(&pipe->lock);
+
+	return NULL;
+}
+
+/*!
+ * \brief Writes the batches formatted by the producers in the tree order.
+ */
+static int dump_consume(dump_pipe_t *pipe, FILE *file, const char **first_comment)
+{
+	int ret = KNOT_EOK;
+	for (size_t batch = 0; ret == KNOT_EOK; batch++) {
+		dump_producer_t *prod = &pipe->prods[batch % pipe->threads];
+		size_t seq = batch / pipe->threads;
+		dump_chunk_t *chunk = &prod->chunks[seq % DUMP_PIPE_DEPTH];
+
+		pthread_mutex_lock(&pipe->lock);
+		while (!chunk->ready && !(prod->finished && prod->produced <= seq) &&
+		       pipe->ret == KNOT_EOK) {
+			pthread_cond_wait(&pipe->cond, &pipe->lock);
+		}
+		ret = pipe->ret;
+		bool ready = chunk->ready;
+		pthread_mutex_unlock(&pipe->lock);
+
+		// The batches are dealt round-robin, the first missing one is the end.
+		if (ret != KNOT_EOK || !ready) {
+			break;
+		}
+
+		// The block comment precedes the first dumped record.
+		if (chunk->size > 0 && *first_comment != NULL) {
+			if (fputs(*first_comment, file) == EOF) {
+				ret = KNOT_EFILE;
+			}
+			*first_comment = NULL;
+		}
+		if (ret == KNOT_EOK) {
+			ret = chunk_write(chunk, file);
+		}
+
+		pthread_mutex_lock(&pipe->lock);
+		chunk->ready = false;
+		if (ret != KNOT_EOK) {
+			pipe->ret = ret;
+		}
+		pthread_cond_broadcast(&pipe->cond);
+		pthread_mutex_unlock(&pipe->lock);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Dump the tree with the nodes formatted in parallel.
+ *
+ * The threads format the batches of nodes and the calling thread writes
+ * them in the tree order, so the output is the same as the sequential one.
+ */
+static int dump_tree_parallel(zone_tree_t *tree, dump_params_t *params, FILE *file,
+                              unsigned threads)
+{
+	dump_producer_t prods[threads];
+	memset(prods, 0, sizeof(prods));
+	dump_pipe_t pipe = {
+		.tree = tree,
+		.threads = threads,
+		.prods = prods,
+	};
+	pthread_mutex_init(&pipe.lock, NULL);
+	pthread_cond_init(&pipe.cond, NULL);
+
+	int ret = KNOT_EOK;
+	unsigned started = 0;
+	for ( ; started < threads; started++) {
+		dump_producer_t *prod = &prods[started];
+		prod->pipe = &pipe;
+		prod->thr_id = started;
+		prod->params = *params;
+		prod->params.out = NULL;
+		prod->params.rr_count = 0;
+		prod->params.first_comment = NULL;
+		prod->params.buflen = DUMP_BUF_LEN;
+		prod->params.buf = malloc(DUMP_BUF_LEN);
+		if (prod->params.buf == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		int thr_ret = pthread_create(&prod->thread, NULL, dump_producer_thread, prod);
+		if (thr_ret != 0) {
+			free(prod->params.buf);
+			ret = knot_map_errno_code(thr_ret);
+			break;
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = dump_consume(&pipe, file, &params->first_comment);
+	} else {
+		pthread_mutex_lock(&pipe.lock);
+		pipe.ret = ret;
+		pthread_cond_broadcast(&pipe.cond);
+		pthread_mutex_unlock(&pipe.lock);
+	}
+
+	for (unsigned i = 0; i < started; i++) {
+		(void)pthread_join(prods[i].thread, NULL);
+		params->rr_count += prods[i].params.rr_count;
+		free(prods[i].params.buf);
+		for (unsigned j = 0; j < DUMP_PIPE_DEPTH; j++) {
+			free(prods[i].chunks[j].data);
+		}
+	}
+	pthread_cond_destroy(&pipe.cond);
+	pthread_mutex_destroy(&pipe.lock);
+
+	return ret;
+}
+
+static int dump_tree(zone_tree_t *tree, dump_params_t *params, FILE *file,
+                     unsigned threads)
+{
+	if (threads > 1 && zone_tree_count(tree) > DUMP_BATCH) {
+		return dump_tree_parallel(tree, params, file, threads);
+	}
+
+	dump_seq_ctx_t ctx = { params, file };
+	int ret = zone_tree_apply(tree, node_dump_seq, &ctx);
+	if (ret == KNOT_EOK) {
+		ret = chunk_write(params->out, file);
+	}
+	return ret;
+}
+
+int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char *color,
+                   unsigned threads)
 {
 	if (file == NULL) {
 		return KNOT_EINVAL;
@@ -151,6 +429,8 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 		return KNOT_ENOMEM;
 	}
 
+	dump_chunk_t out = { 0 };
+
 	if (comments) {
 		fprintf(file, ";; Zone dump (Knot DNS %s)\n", PACKAGE_VERSION);
 	}
@@ -159,9 +439,9 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	knot_dump_style_t style = KNOT_DUMP_STYLE_DEFAULT;
 	style.color = color;
 	dump_params_t params = {
-		.file = file,
 		.buf = buf,
 		.buflen = DUMP_BUF_LEN,
+		.out = &out,
 		.rr_count = 0,
 		.origin = zone->apex->owner,
 		.style = &style,
@@ -170,49 +450,44 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 	};
 
 	// Dump standard zone records without RRSIGS.
-	int ret = zone_contents_apply(zone, node_dump_text, &params);
+	int ret = dump_tree(zone->nodes, &params, file, threads);
 	if (ret != KNOT_EOK) {
-		free(params.buf);
-		return ret;
+		goto done;
 	}
 
 	// Dump RRSIG records if available.
 	params.dump_rrsig = true;
 	params.dump_nsec = false;
 	params.first_comment = comments ? ";; DNSSEC signatures\n" : NULL;
-	ret = zone_contents_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nodes, &params, file, threads);
 	if (ret != KNOT_EOK) {
-		free(params.buf);
-		return ret;
+		goto done;
 	}
 
 	// Dump NSEC chain if available.
 	params.dump_rrsig = false;
 	params.dump_nsec = true;
 	params.first_comment = comments ? ";; DNSSEC NSEC chain\n" : NULL;
-	ret = zone_contents_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nodes, &params, file, threads);
 	if (ret != KNOT_EOK) {
-		free(params.buf);
-		return ret;
+		goto done;
 	}
 
 	// Dump NSEC3 chain if available.
 	params.dump_rrsig = false;
 	params.dump_nsec = true;
 	params.first_comment = comments ? ";; DNSSEC NSEC3 chain\n" : NULL;
-	ret = zone_contents_nsec3_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nsec3_nodes, &params, file, threads);
 	if (ret != KNOT_EOK) {
-		free(params.buf);
-		return ret;
+		goto done;
 	}
 
 	params.dump_rrsig = true;
 	params.dump_nsec = false;
 	params.first_comment = comments ? ";; DNSSEC NSEC3 signatures\n" : NULL;
-	ret = zone_contents_nsec3_apply(zone, node_dump_text, &params);
+	ret = dump_tree(zone->nsec3_nodes, &params, file, threads);
 	if (ret != KNOT_EOK) {
-		free(params.buf);
-		return ret;
+		goto done;
 	}
 
 	if (comments) {
@@ -229,7 +504,9 @@ int zone_dump_text(zone_contents_t *zone, FILE *file, bool comments, const char
 		        params.rr_count, date);
 	}
 
+done:
 	free(params.buf); // params.buf may be != buf because of knot_rrset_txt_dump_dynamic()
+	free(out.data);
 
-	return KNOT_EOK;
+	return ret;
 }
@@ -14,10 +14,13 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <sys/stat.h>
+
 #include "knot/common/log.h"
 #include "knot/journal/journal_metadata.h"
 #include "knot/journal/journal_read.h"
 #include "knot/zone/zone-diff.h"
+#include "knot/zone/snapshot.h"
 #include "knot/zone/zone-load.h"
 #include "knot/zone/zonefile.h"
 #include "knot/dnssec/key-events.h"
@@ -49,6 +52,9 @@ int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
 	zl.err_handler = &handler;
 	zl.creator->master = !zone_load_can_bootstrap(conf, zone_name);
 
+	val = conf_zone_get(conf, C_ADJUST_THR, zone_name);
+	zl.threads = conf_int(&val);
+
 	*contents = zonefile_load(&zl);
 	zonefile_close(&zl);
 	if (*contents == NULL) {
@@ -61,6 +67,89 @@ int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
 	return KNOT_EOK;
 }
 
+int zone_load_snapshot(conf_t *conf, const knot_dname_t *zone_name,
+                       zone_contents_t **contents)
+{
+	if (conf == NULL || zone_name == NULL || contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	char *zonefile = conf_zonefile(conf, zone_name);
+	char *path = zone_snapshot_path(zonefile);
+	if (path == NULL) {
+		free(zonefile);
+		return KNOT_ENOMEM;
+	}
+
+	struct stat st;
+	int ret = (stat(zonefile, &st) == 0) ? KNOT_EOK : knot_map_errno();
+	if (ret == KNOT_EOK) {
+		ret = zone_snapshot_load(path, zone_name, &st, contents);
+	}
+	switch (ret) {
+	case KNOT_EOK:
+		log_zone_info(zone_name, "loaded zone snapshot '%s', serial %u",
+		              path, zone_contents_serial(*contents));
+		conf_val_t val = conf_zone_get(conf, C_SHARED_SNAPSHOT, zone_name);
+		if (conf_bool(&val)) {
+			int map_ret = zone_snapshot_map_rdata(path, *contents);
+			if (map_ret != KNOT_EOK) {
+				log_zone_warning(zone_name, "failed to map shared snapshot rdata (%s)",
+				                 knot_strerror(map_ret));
+			}
+		}
+		break;
+	case KNOT_ENOENT:
+		break;
+	case KNOT_ESEMCHECK:
+		log_zone_debug(zone_name, "zone snapshot '%s' outdated, ignored", path);
+		break;
+	default:
+		log_zone_warning(zone_name, "failed to load zone snapshot '%s' (%s)",
+		                 path, knot_strerror(ret));
+		break;
+	}
+	free(path);
+	free(zonefile);
+
+	return ret;
+}
+
+int zone_load_write_snapshot(conf_t *conf, const knot_dname_t *zone_name)
+{
+	if (conf == NULL || zone_name == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	char *zonefile = conf_zonefile(conf, zone_name);
+	char *path = zone_snapshot_path(zonefile);
+	if (path == NULL) {
+		free(zonefile);
+		return KNOT_ENOMEM;
+	}
+
+	// Bind the snapshot to the zone file status before parsing.
+	struct stat st;
+	int ret = (stat(zonefile, &st) == 0) ? KNOT_EOK : knot_map_errno();
+	free(zonefile);
+
+	zone_contents_t *contents = NULL;
+	if (ret == KNOT_EOK) {
+		ret = zone_load_contents(conf, zone_name, &contents, false);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_snapshot_write(contents, path, &st);
+	}
+	if (ret == KNOT_EOK) {
+		log_zone_info(zone_name, "zone snapshot '%s' written, serial %u",
+		              path, zone_contents_serial(contents));
+	}
+	zone_contents_deep_free(contents);
+	free(path);
+
+	return ret;
+}
+
 static int apply_one_cb(bool remove, const knot_rrset_t *rr, void *ctx)
 {
 	zone_node_t *unused = NULL;
@@ -134,10 +223,9 @@ int zone_load_from_journal(conf_t *conf, zone_t *zone, zone_contents_t **content
 	}
 
 	knot_rrset_t rr = { 0 };
-	while (ret == KNOT_EOK && journal_read_rrset(read, &rr, false)) {
+	while (ret == KNOT_EOK && journal_read_rrset_view(read, &rr, false)) {
 		zone_node_t *unused = NULL;
 		ret = zone_contents_add_rr(*contents, &rr, &unused);
-		journal_read_clear_rrset(&rr);
 	}
 
 	if (ret == KNOT_EOK) {
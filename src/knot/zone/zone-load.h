@@ -34,6 +34,34 @@
 int zone_load_contents(conf_t *conf, const knot_dname_t *zone_name,
                        zone_contents_t **contents, bool fail_on_warning);
 
+/*!
+ * \brief Load zone contents from the zone file snapshot if it is up-to-date.
+ *
+ * \note The snapshot is ignored if the zone file has been modified since
+ *       the snapshot was written.
+ *
+ * \param conf
+ * \param zone_name
+ * \param contents
+ *
+ * \retval KNOT_EOK        if success.
+ * \retval KNOT_ENOENT     if no snapshot exists.
+ * \retval KNOT_ESEMCHECK  if the snapshot is outdated.
+ * \retval KNOT_E*         if error.
+ */
+int zone_load_snapshot(conf_t *conf, const knot_dname_t *zone_name,
+                       zone_contents_t **contents);
+
+/*!
+ * \brief Parse the zone file and write its snapshot.
+ *
+ * \param conf
+ * \param zone_name
+ *
+ * \return KNOT_EOK or an error
+ */
+int zone_load_write_snapshot(conf_t *conf, const knot_dname_t *zone_name);
+
 /*!
  * \brief Update zone contents from the journal.
  *
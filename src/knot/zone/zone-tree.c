@@ -89,6 +89,25 @@ zone_tree_t *zone_tree_shallow_copy(zone_tree_t *from)
 	return to;
 }
 
+int zone_tree_set_mm(zone_tree_t *tree, knot_mm_t *mm)
+{
+	if (tree == NULL) {
+		return KNOT_EOK;
+	}
+	if (tree->cow != NULL) {
+		return KNOT_EINVAL;
+	}
+
+	trie_t *moved = trie_dup(tree->trie, nocopy, mm);
+	if (moved == NULL) {
+		return KNOT_ENOMEM;
+	}
+	trie_free(tree->trie);
+	tree->trie = moved;
+
+	return KNOT_EOK;
+}
+
 int zone_tree_insert(zone_tree_t *tree, zone_node_t **node)
 {
 	if (tree == NULL || node == NULL || *node == NULL) {
@@ -123,11 +142,7 @@ int zone_tree_insert_with_parents(zone_tree_t *tree, zone_node_t *node, bool wit
 
 zone_node_t *zone_tree_get(zone_tree_t *tree, const knot_dname_t *owner)
 {
-	if (owner == NULL) {
-		return NULL;
-	}
-
-	if (zone_tree_is_empty(tree)) {
+	if (owner == NULL || zone_tree_is_empty(tree)) {
 		return NULL;
 	}
 
@@ -135,6 +150,15 @@ zone_node_t *zone_tree_get(zone_tree_t *tree, const knot_dname_t *owner)
 	uint8_t *lf = knot_dname_lf(owner, lf_storage);
 	assert(lf);
 
+	return zone_tree_get_lf(tree, lf);
+}
+
+zone_node_t *zone_tree_get_lf(zone_tree_t *tree, const uint8_t *lf)
+{
+	if (lf == NULL || zone_tree_is_empty(tree)) {
+		return NULL;
+	}
+
 	trie_val_t *val = trie_get_try(tree->trie, lf + 1, *lf);
 	if (val == NULL) {
 		return NULL;
@@ -148,18 +172,30 @@ int zone_tree_get_less_or_equal(zone_tree_t *tree,
                                 zone_node_t **found,
                                 zone_node_t **previous)
 {
-	if (owner == NULL || found == NULL || previous == NULL) {
+	if (owner == NULL) {
 		return KNOT_EINVAL;
 	}
 
-	if (zone_tree_is_empty(tree)) {
-		return KNOT_ENONODE;
-	}
-
 	knot_dname_storage_t lf_storage;
 	uint8_t *lf = knot_dname_lf(owner, lf_storage);
 	assert(lf);
 
+	return zone_tree_get_less_or_equal_lf(tree, lf, found, previous);
+}
+
+int zone_tree_get_less_or_equal_lf(zone_tree_t *tree,
+                                   const uint8_t *lf,
+                                   zone_node_t **found,
+                                   zone_node_t **previous)
+{
+	if (lf == NULL || found == NULL || previous == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (zone_tree_is_empty(tree)) {
+		return KNOT_ENONODE;
+	}
+
 	trie_val_t *fval = NULL;
 	int ret = trie_get_leq(tree->trie, lf + 1, *lf, &fval);
 	if (fval != NULL) {
@@ -500,6 +536,15 @@ void zone_trees_unify_binodes(zone_tree_t *nodes, zone_tree_t *nsec3_nodes, bool
 	}
 }
 
+int zone_tree_compact(zone_tree_t *tree)
+{
+	if (tree == NULL || tree->cow != NULL) {
+		return KNOT_EOK;
+	}
+
+	return trie_compact(tree->trie);
+}
+
 void zone_tree_free(zone_tree_t **tree)
 {
 	if (tree == NULL || *tree == NULL) {
@@ -77,6 +77,21 @@ zone_tree_t *zone_tree_cow(zone_tree_t *from);
  */
 zone_tree_t *zone_tree_shallow_copy(zone_tree_t *from);
 
+/*!
+ * \brief Move the trie of the zone tree to a different memory context.
+ *
+ * The trie is rebuilt in the depth-first order, so the nodes visited by
+ * neighbouring lookups are near each other. The zone nodes are untouched.
+ *
+ * \warning The tree must not be in the middle of COW.
+ *
+ * \param tree  Zone tree (NULL is ignored).
+ * \param mm    Memory context for the new trie (NULL for malloc).
+ *
+ * \return KNOT_E*
+ */
+int zone_tree_set_mm(zone_tree_t *tree, knot_mm_t *mm);
+
 /*!
  * \brief Return number of nodes in the zone tree.
  *
@@ -151,6 +166,16 @@ int zone_tree_insert_with_parents(zone_tree_t *tree, zone_node_t *node, bool wit
  */
 zone_node_t *zone_tree_get(zone_tree_t *tree, const knot_dname_t *owner);
 
+/*!
+ * \brief Finds node with the given owner in the zone tree.
+ *
+ * \param tree Zone tree to search in.
+ * \param lf   Owner of the node to find in the lookup format (see knot_dname_lf()).
+ *
+ * \retval Found node or NULL.
+ */
+zone_node_t *zone_tree_get_lf(zone_tree_t *tree, const uint8_t *lf);
+
 /*!
  * \brief Tries to find the given domain name in the zone tree and returns the
  *        associated node and previous node in canonical order.
@@ -175,6 +200,15 @@ int zone_tree_get_less_or_equal(zone_tree_t *tree,
                                 zone_node_t **found,
                                 zone_node_t **previous);
 
+/*!
+ * \brief Same as zone_tree_get_less_or_equal() with the owner already
+ *        converted to the lookup format (see knot_dname_lf()).
+ */
+int zone_tree_get_less_or_equal_lf(zone_tree_t *tree,
+                                   const uint8_t *lf,
+                                   zone_node_t **found,
+                                   zone_node_t **previous);
+
 /*!
  * \brief Remove a node from a tree with no checks.
  *
@@ -329,6 +363,17 @@ int zone_tree_merge(zone_tree_t *into, zone_tree_t *what);
  */
 void zone_trees_unify_binodes(zone_tree_t *nodes, zone_tree_t *nsec3_nodes, bool free_deleted);
 
+/*!
+ * \brief Relocates the tree structure in the order of the nodes.
+ *
+ * \note The tree mustn't be published yet, it's skipped during an update.
+ *
+ * \param tree  Zone tree to be compacted.
+ *
+ * \return KNOT_E*
+ */
+int zone_tree_compact(zone_tree_t *tree);
+
 /*!
  * \brief Destroys the zone tree, not touching the saved data.
  *
@@ -17,19 +17,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <urcu.h>
 
 #include "knot/common/log.h"
+#include "knot/common/reclaim.h"
 #include "knot/conf/module.h"
 #include "knot/dnssec/kasp/kasp_db.h"
+#include "knot/dnssec/sign-index.h"
 #include "knot/events/replan.h"
+#include "knot/journal/journal_group.h"
 #include "knot/journal/journal_read.h"
 #include "knot/journal/journal_write.h"
+#include "knot/nameserver/xfr_cache.h"
 #include "knot/nameserver/process_query.h"
 #include "knot/query/requestor.h"
 #include "knot/updates/zone-update.h"
 #include "knot/server/server.h"
 #include "knot/zone/contents.h"
+#include "knot/zone/digest.h"
+#include "knot/zone/replicas.h"
 #include "knot/zone/serial.h"
 #include "knot/zone/zone.h"
 #include "knot/zone/zonefile.h"
@@ -52,12 +60,162 @@ static void free_ddns_queue(zone_t *zone)
 	ptrlist_free(&zone->ddns_queue, NULL);
 }
 
+/*!
+ * \brief Zone file write running in the background flush thread.
+ */
+typedef struct zone_bg_flush {
+	worker_task_t task;
+	zone_t *zone;
+	char *zonefile;
+	unsigned threads;
+	const zone_contents_t *contents; //!< Written contents (only compared).
+	uint32_t serial;                 //!< Serial of the written contents.
+	int ret;
+	bool done;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} zone_bg_flush_t;
+
+static void bg_flush_lower_prio(void)
+{
+#if defined(__linux__) && defined(SYS_ioprio_set)
+	/* Best-effort class (2) with the lowest priority (7) for this thread. */
+	(void)syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, (2 << 13) | 7);
+#endif
+}
+
+static void bg_flush_run(worker_task_t *task)
+{
+	zone_bg_flush_t *ctx = task->ctx;
+
+	bg_flush_lower_prio();
+
+	/* The published contents stays valid until the read-side section ends. */
+	char *tmp_name = NULL;
+	rcu_read_lock();
+	zone_contents_t *contents = rcu_dereference(ctx->zone->contents);
+	ctx->contents = contents;
+	ctx->serial = zone_contents_serial(contents);
+	int ret = zonefile_write_tmp(ctx->zonefile, contents, ctx->threads, &tmp_name);
+	rcu_read_unlock();
+
+	if (ret == KNOT_EOK) {
+		ret = zonefile_write_commit(ctx->zonefile, tmp_name);
+	}
+
+	/* The result is applied by the flush event, the zone mustn't be freed meanwhile. */
+	pthread_mutex_lock(&ctx->lock);
+	ctx->ret = ret;
+	ctx->done = true;
+	zone_events_schedule_now(ctx->zone, ZONE_EVENT_FLUSH);
+	pthread_cond_broadcast(&ctx->cond);
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+static int bg_flush_start(zone_t *zone, char *zonefile, unsigned threads)
+{
+	zone_bg_flush_t *ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	ctx->task = (worker_task_t){
+		.ctx = ctx,
+		.run = bg_flush_run,
+		.prio = WORKER_PRIO_LOW,
+	};
+	ctx->zone = zone;
+	ctx->zonefile = zonefile;
+	ctx->threads = threads;
+	pthread_mutex_init(&ctx->lock, NULL);
+	pthread_cond_init(&ctx->cond, NULL);
+
+	zone->bg_flush = ctx;
+	worker_pool_assign(zone->server->flusher, &ctx->task);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Checks (or waits) if the background flush has finished. */
+static bool bg_flush_finished(zone_bg_flush_t *ctx, bool wait)
+{
+	pthread_mutex_lock(&ctx->lock);
+	while (wait && !ctx->done) {
+		pthread_cond_wait(&ctx->cond, &ctx->lock);
+	}
+	bool done = ctx->done;
+	pthread_mutex_unlock(&ctx->lock);
+
+	return done;
+}
+
+static void bg_flush_free(zone_bg_flush_t *ctx)
+{
+	pthread_mutex_destroy(&ctx->lock);
+	pthread_cond_destroy(&ctx->cond);
+	free(ctx->zonefile);
+	free(ctx);
+}
+
+/*!
+ * \brief Updates the zone file attributes and the journal after the zone file write.
+ *
+ * \param current  The written contents is the current one.
+ */
+static int zonefile_written(zone_t *zone, zone_journal_t j, const char *zonefile,
+                            uint32_t serial_to, bool current, int ret)
+{
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone->name, "failed to update zone file (%s)",
+		                 knot_strerror(ret));
+		return ret;
+	}
+
+	if (zone->zonefile.exists) {
+		log_zone_info(zone->name, "zone file updated, serial %u -> %u",
+		              zone->zonefile.serial, serial_to);
+	} else {
+		log_zone_info(zone->name, "zone file updated, serial %u",
+		              serial_to);
+	}
+
+	/* Update zone version. */
+	struct stat st;
+	if (stat(zonefile, &st) < 0) {
+		log_zone_warning(zone->name, "failed to update zone file (%s)",
+		                 knot_strerror(knot_map_errno()));
+		return KNOT_EACCES;
+	}
+
+	/* Update zone file attributes. */
+	zone->zonefile.exists = true;
+	zone->zonefile.mtime = st.st_mtim;
+	zone->zonefile.serial = serial_to;
+
+	/* Newer changes are left for the next flush. */
+	if (!current) {
+		return KNOT_EOK;
+	}
+
+	zone->zonefile.resigned = false;
+	zone->zonefile.retransfer = false;
+
+	/* Flush journal. */
+	if (journal_is_existing(j)) {
+		ret = journal_set_flushed(j);
+	}
+
+	return ret;
+}
+
 /*!
  * \param allow_empty_zone useful when need to flush journal but zone is not yet loaded
  * ...in this case we actually don't have to do anything because the zonefile is current,
  * but we must mark the journal as flushed
+ * \param background  Write the zone file in the background flush thread.
  */
-static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool verbose)
+static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool verbose,
+                         bool background)
 {
 	/*! @note Function expects nobody will change zone contents meanwhile. */
 
@@ -66,15 +224,30 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 	int ret = KNOT_EOK;
 	zone_journal_t j = zone_journal(zone);
 
-	bool force = zone_get_flag(zone, ZONE_FORCE_FLUSH, true);
+	int64_t sync_timeout = zone_zonefile_sync(conf, zone);
 
-	conf_val_t val = conf_zone_get(conf, C_ZONEFILE_SYNC, zone->name);
-	int64_t sync_timeout = conf_int(&val);
+	/* Apply the result of the background flush first. */
+	zone_bg_flush_t *bg = zone->bg_flush;
+	if (bg != NULL) {
+		if (!bg_flush_finished(bg, !background)) {
+			return KNOT_EOK; // Flush event is planned once finished.
+		}
+		zone->bg_flush = NULL;
+
+		ret = zonefile_written(zone, j, bg->zonefile, bg->serial,
+		                       bg->contents == zone->contents, bg->ret);
+		bg_flush_free(bg);
+		if (ret != KNOT_EOK) {
+			goto flush_journal_replan;
+		}
+	}
+
+	bool force = zone_get_flag(zone, ZONE_FORCE_FLUSH, true);
 
 	if (zone_contents_is_empty(zone->contents)) {
 		if (allow_empty_zone && journal_is_existing(j)) {
 			ret = journal_set_flushed(j);
-		} else {
+		} else if (bg == NULL) {
 			ret = KNOT_EEMPTYZONE;
 		}
 		goto flush_journal_replan;
@@ -82,6 +255,14 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 
 	/* Check for disabled zonefile synchronization. */
 	if (sync_timeout < 0 && !force) {
+		if (journal_compact_due(j)) {
+			ret = journal_compact(j);
+			if (ret != KNOT_EOK) {
+				log_zone_warning(zone->name, "failed to merge journal changesets (%s)",
+				                 knot_strerror(ret));
+			}
+			return ret;
+		}
 		if (verbose) {
 			log_zone_warning(zone->name, "zonefile synchronization disabled, "
 			                             "use force command to override it");
@@ -99,51 +280,23 @@ static int flush_journal(conf_t *conf, zone_t *zone, bool allow_empty_zone, bool
 	}
 
 	char *zonefile = conf_zonefile(conf, zone->name);
+	conf_val_t val = conf_zone_get(conf, C_ADJUST_THR, zone->name);
 
-	/* Synchronize journal. */
-	ret = zonefile_write(zonefile, contents);
-	if (ret != KNOT_EOK) {
-		log_zone_warning(zone->name, "failed to update zone file (%s)",
-		                 knot_strerror(ret));
-		free(zonefile);
-		goto flush_journal_replan;
-	}
-
-	if (zone->zonefile.exists) {
-		log_zone_info(zone->name, "zone file updated, serial %u -> %u",
-		              zone->zonefile.serial, serial_to);
-	} else {
-		log_zone_info(zone->name, "zone file updated, serial %u",
-		              serial_to);
-	}
-
-	/* Update zone version. */
-	struct stat st;
-	if (stat(zonefile, &st) < 0) {
-		log_zone_warning(zone->name, "failed to update zone file (%s)",
-		                 knot_strerror(knot_map_errno()));
+	/* Write the zone file without blocking the zone events. */
+	if (background && zone->server != NULL && zone->server->flusher != NULL) {
+		ret = bg_flush_start(zone, zonefile, conf_int(&val));
+		if (ret == KNOT_EOK) {
+			return KNOT_EOK; // Replanned once finished.
+		}
 		free(zonefile);
-		ret = KNOT_EACCES;
 		goto flush_journal_replan;
 	}
 
+	/* Synchronize journal. */
+	ret = zonefile_write(zonefile, contents, conf_int(&val));
+	ret = zonefile_written(zone, j, zonefile, serial_to, true, ret);
 	free(zonefile);
 
-	/* Update zone file attributes. */
-	zone->zonefile.exists = true;
-	zone->zonefile.mtime = st.st_mtim;
-	zone->zonefile.serial = serial_to;
-	zone->zonefile.resigned = false;
-	zone->zonefile.retransfer = false;
-
-	/* Flush journal. */
-	if (journal_is_existing(j)) {
-		ret = journal_set_flushed(j);
-		if (ret != KNOT_EOK) {
-			goto flush_journal_replan;
-		}
-	}
-
 flush_journal_replan:
 	/* Plan next journal flush after proper period. */
 	zone->timers.last_flush = time(NULL);
@@ -177,9 +330,20 @@ zone_t* zone_new(const knot_dname_t *name)
 
 	knot_sem_init(&zone->cow_lock, 1);
 
+	zone->last_used = time(NULL);
+
 	// Preferred master lock
 	pthread_mutex_init(&zone->preferred_lock, NULL);
 
+	// Outgoing transfer cache (optional)
+	zone->xfr_cache = xfr_cache_new();
+
+	// ZONEMD serialization cache (optional)
+	zone->digest_cache = zone_digest_cache_new();
+
+	// RRSIG expiration index (optional)
+	zone->sign_index = zone_sign_index_new();
+
 	// Initialize events
 	zone_events_init(zone);
 
@@ -208,6 +372,12 @@ void zone_free(zone_t **zone_ptr)
 
 	zone_t *zone = *zone_ptr;
 
+	/* Wait for the background zone file write. */
+	if (zone->bg_flush != NULL) {
+		(void)bg_flush_finished(zone->bg_flush, true);
+		bg_flush_free(zone->bg_flush);
+	}
+
 	zone_events_deinit(zone);
 
 	knot_dname_free(zone->name, NULL);
@@ -229,22 +399,71 @@ void zone_free(zone_t **zone_ptr)
 
 	/* Free zone contents. */
 	zone_contents_deep_free(zone->contents);
+	zone_replicas_free(zone->replicas);
+	xfr_cache_free(zone->xfr_cache);
+	zone_digest_cache_free(zone->digest_cache);
+	zone_sign_index_free(zone->sign_index);
 
 	conf_deactivate_modules(&zone->query_modules, &zone->query_plan);
 
+	zone_conf_free(zone->settings);
+
 	free(zone);
 	*zone_ptr = NULL;
 }
 
+zone_conf_t *zone_conf_new(conf_t *conf, const knot_dname_t *name)
+{
+	if (conf == NULL || name == NULL) {
+		return NULL;
+	}
+
+	zone_conf_t *settings = calloc(1, sizeof(*settings));
+	if (settings == NULL) {
+		return NULL;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_MASTER, name);
+	settings->is_slave = conf_val_count(&val) > 0;
+
+	val = conf_zone_get(conf, C_DNSSEC_SIGNING, name);
+	settings->dnssec_signing = conf_bool(&val);
+
+	val = conf_zone_get(conf, C_ZONEFILE_SYNC, name);
+	settings->zonefile_sync = conf_int(&val);
+
+	val = conf_zone_get(conf, C_ACL, name);
+	if (val.code == KNOT_EOK && val.blob_len > 0) {
+		settings->acl = malloc(val.blob_len);
+		if (settings->acl == NULL) {
+			free(settings);
+			return NULL;
+		}
+		memcpy(settings->acl, val.blob, val.blob_len);
+		settings->acl_len = val.blob_len;
+	}
+
+	return settings;
+}
+
+void zone_conf_free(zone_conf_t *settings)
+{
+	if (settings == NULL) {
+		return;
+	}
+
+	free(settings->acl);
+	free(settings);
+}
+
 void zone_reset(conf_t *conf, zone_t *zone)
 {
 	if (zone == NULL) {
 		return;
 	}
 
-	zone_contents_t *old_contents = zone_switch_contents(zone, NULL);
+	zone_retire_contents(zone_switch_contents(zone, NULL));
 	conf_reset_modules(conf, &zone->query_modules, &zone->query_plan); // includes synchronize_rcu()
-	zone_contents_deep_free(old_contents);
 	if (zone_expired(zone)) {
 		replan_from_timers(conf, zone);
 	} else {
@@ -254,7 +473,7 @@ void zone_reset(conf_t *conf, zone_t *zone)
 
 knot_lmdb_db_t *zone_journaldb(const zone_t *zone)
 {
-	return &zone->server->journaldb;
+	return server_journaldb(zone->server, zone->name);
 }
 
 knot_lmdb_db_t *zone_kaspdb(const zone_t *zone)
@@ -272,6 +491,14 @@ catalog_update_t *zone_catalog_upd(const zone_t *zone)
 	return &zone->server->catalog_upd;
 }
 
+/*! \brief Let the flush event merge the changesets before the journal is full. */
+static void plan_compact(zone_t *zone, zone_journal_t j, int store_ret)
+{
+	if (store_ret == KNOT_EOK && journal_compact_due(j)) {
+		zone_events_schedule_now(zone, ZONE_EVENT_FLUSH);
+	}
+}
+
 int zone_change_store(conf_t *conf, zone_t *zone, changeset_t *change, changeset_t *extra)
 {
 	if (conf == NULL || zone == NULL || change == NULL) {
@@ -280,16 +507,17 @@ int zone_change_store(conf_t *conf, zone_t *zone, changeset_t *change, changeset
 
 	zone_journal_t j = { zone_journaldb(zone), zone->name, conf };
 
-	int ret = journal_insert(j, change, extra, NULL);
+	int ret = journal_group_insert(&zone->server->journal_group, j, change, extra, NULL);
 	if (ret == KNOT_EBUSY) {
 		log_zone_notice(zone->name, "journal is full, flushing");
 
 		/* Transaction rolled back, journal released, we may flush. */
-		ret = flush_journal(conf, zone, true, false);
+		ret = flush_journal(conf, zone, true, false, false);
 		if (ret == KNOT_EOK) {
-			ret = journal_insert(j, change, extra, NULL);
+			ret = journal_group_insert(&zone->server->journal_group, j, change, extra, NULL);
 		}
 	}
+	plan_compact(zone, j, ret);
 
 	return ret;
 }
@@ -302,16 +530,17 @@ int zone_diff_store(conf_t *conf, zone_t *zone, const zone_diff_t *diff)
 
 	zone_journal_t j = { zone_journaldb(zone), zone->name, conf };
 
-	int ret = journal_insert(j, NULL, NULL, diff);
+	int ret = journal_group_insert(&zone->server->journal_group, j, NULL, NULL, diff);
 	if (ret == KNOT_EBUSY) {
 		log_zone_notice(zone->name, "journal is full, flushing");
 
 		/* Transaction rolled back, journal released, we may flush. */
-		ret = flush_journal(conf, zone, true, false);
+		ret = flush_journal(conf, zone, true, false, false);
 		if (ret == KNOT_EOK) {
-			ret = journal_insert(j, NULL, NULL, diff);
+			ret = journal_group_insert(&zone->server->journal_group, j, NULL, NULL, diff);
 		}
 	}
+	plan_compact(zone, j, ret);
 
 	return ret;
 }
@@ -322,6 +551,8 @@ int zone_changes_clear(conf_t *conf, zone_t *zone)
 		return KNOT_EINVAL;
 	}
 
+	xfr_cache_clear(zone->xfr_cache);
+
 	return journal_scrape_with_md(zone_journal(zone), true);
 }
 
@@ -352,7 +583,16 @@ int zone_flush_journal(conf_t *conf, zone_t *zone, bool verbose)
 		return KNOT_EINVAL;
 	}
 
-	return flush_journal(conf, zone, false, verbose);
+	return flush_journal(conf, zone, false, verbose, false);
+}
+
+int zone_flush_journal_bg(conf_t *conf, zone_t *zone)
+{
+	if (conf == NULL || zone == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return flush_journal(conf, zone, false, true, true);
 }
 
 bool zone_journal_has_zij(zone_t *zone)
@@ -372,19 +612,83 @@ zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_content
 	zone_contents_t **current_contents = &zone->contents;
 	old_contents = rcu_xchg_pointer(current_contents, new_contents);
 
+	xfr_cache_clear(zone->xfr_cache);
+	zone_digest_cache_switch(zone->digest_cache, new_contents);
+	zone_sign_index_switch(zone->sign_index, new_contents);
+	zone_answers_invalidate();
+
 	return old_contents;
 }
 
+void zone_retire_contents(zone_contents_t *contents)
+{
+	if (contents != NULL) {
+		reclaim_defer(contents, (reclaim_free_t)zone_contents_deep_free, contents->size);
+	}
+}
+
+static uint64_t answers_generation = 0;
+static void (*answers_hook)(void *data) = NULL;
+static void *answers_hook_data = NULL;
+
+uint64_t zone_answers_generation(void)
+{
+	return __atomic_load_n(&answers_generation, __ATOMIC_ACQUIRE);
+}
+
+void zone_answers_invalidate(void)
+{
+	(void)__atomic_add_fetch(&answers_generation, 1, __ATOMIC_RELEASE);
+
+	if (answers_hook != NULL) {
+		answers_hook(answers_hook_data);
+	}
+}
+
+void zone_answers_set_hook(void (*hook)(void *data), void *data)
+{
+	answers_hook_data = data;
+	answers_hook = hook;
+}
+
 bool zone_is_slave(conf_t *conf, const zone_t *zone)
 {
 	if (conf == NULL || zone == NULL) {
 		return false;
 	}
 
+	if (zone->settings != NULL) {
+		return zone->settings->is_slave;
+	}
+
 	conf_val_t val = conf_zone_get(conf, C_MASTER, zone->name);
 	return conf_val_count(&val) > 0 ? true : false;
 }
 
+bool zone_is_signed(conf_t *conf, const zone_t *zone)
+{
+	if (conf == NULL || zone == NULL) {
+		return false;
+	}
+
+	if (zone->settings != NULL) {
+		return zone->settings->dnssec_signing;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_DNSSEC_SIGNING, zone->name);
+	return conf_bool(&val);
+}
+
+int64_t zone_zonefile_sync(conf_t *conf, const zone_t *zone)
+{
+	if (zone->settings != NULL) {
+		return zone->settings->zonefile_sync;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_ZONEFILE_SYNC, zone->name);
+	return conf_int(&val);
+}
+
 void zone_set_preferred_master(zone_t *zone, const struct sockaddr_storage *addr)
 {
 	if (zone == NULL || addr == NULL) {
@@ -493,6 +797,7 @@ void zone_timers_sanitize(conf_t *conf, zone_t *zone)
 	assert(zone);
 
 	time_t now = time(NULL);
+	zone_timers_t orig = zone->timers;
 
 	// assume now if we don't know when we flushed
 	time_set_default(&zone->timers.last_flush, now);
@@ -507,6 +812,30 @@ void zone_timers_sanitize(conf_t *conf, zone_t *zone)
 		zone->timers.last_refresh_ok = false;
 		zone->timers.next_expire = 0;
 	}
+
+	if (!zone_timers_equal(&orig, &zone->timers)) {
+		zone_timers_changed(zone);
+	}
+}
+
+void zone_timers_changed(zone_t *zone)
+{
+	if (zone->server != NULL) {
+		zone_timers_dirty_add(&zone->server->timers.zones, zone->name);
+	}
+}
+
+void zone_touch(zone_t *zone)
+{
+	// Avoid needless cache line bouncing, the precision is a second.
+	time_t now = time(NULL);
+	if (__atomic_load_n(&zone->last_used, __ATOMIC_RELAXED) != now) {
+		__atomic_store_n(&zone->last_used, now, __ATOMIC_RELAXED);
+	}
+
+	if (zone->contents == NULL && zone_get_flag(zone, ZONE_IS_UNLOADED, false)) {
+		zone_events_schedule_now(zone, ZONE_EVENT_LOAD);
+	}
 }
 
 /*!
@@ -656,7 +985,8 @@ int zone_dump_to_dir(conf_t *conf, zone_t *zone, const char *dir)
 	}
 	free(zonefile);
 
-	return zonefile_write(target, zone->contents);
+	conf_val_t val = conf_zone_get(conf, C_ADJUST_THR, zone->name);
+	return zonefile_write(target, zone->contents, conf_int(&val));
 }
 
 int zone_set_master_serial(zone_t *zone, uint32_t serial)
@@ -685,8 +1015,7 @@ int slave_zone_serial(zone_t *zone, conf_t *conf, uint32_t *serial)
 	assert(zone->contents != NULL);
 	*serial = zone_contents_serial(zone->contents);
 
-	conf_val_t val = conf_zone_get(conf, C_DNSSEC_SIGNING, zone->name);
-	if (conf_bool(&val)) {
+	if (zone_is_signed(conf, zone)) {
 		ret = zone_get_master_serial(zone, serial);
 	}
 
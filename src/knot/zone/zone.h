@@ -31,6 +31,10 @@
 
 struct zone_update;
 struct zone_backup_ctx;
+struct xfr_cache;
+struct zone_digest_cache;
+struct zone_sign_index;
+struct zone_bg_flush;
 
 /*!
  * \brief Zone flags.
@@ -44,8 +48,25 @@ typedef enum {
 	ZONE_IS_CATALOG     = 1 << 5, /*!< This is a catalog. */
 	ZONE_IS_CAT_MEMBER  = 1 << 6, /*!< This zone exists according to a catalog. */
 	ZONE_XFR_FROZEN     = 1 << 7, /*!< Outgoing AXFR/IXFR temporarily disabled. */
+	ZONE_IS_UNLOADED    = 1 << 8, /*!< Idle contents unloaded, to be loaded on demand. */
+	ZONE_IS_CLONE_SOURCE = 1 << 9, /*!< Some clone zones are instantiated from this zone. */
 } zone_flag_t;
 
+/*!
+ * \brief Zone configuration values materialized from the configuration DB.
+ *
+ * The snapshot is created together with the zone and replaced (via RCU)
+ * if the zone configuration changes, so the frequently read values are
+ * available without the confdb lookups.
+ */
+typedef struct {
+	bool is_slave;          //!< At least one master configured.
+	bool dnssec_signing;    //!< Automatic DNSSEC signing enabled.
+	int64_t zonefile_sync;  //!< Zone file synchronization timeout.
+	uint8_t *acl;           //!< ACL identifiers (confdb multivalued data).
+	size_t acl_len;         //!< Length of the ACL identifiers data.
+} zone_conf_t;
+
 /*!
  * \brief Structure for holding DNS zone.
  */
@@ -56,6 +77,9 @@ typedef struct zone
 	zone_flag_t flags;
 	bool is_catalog_flag; //!< Lock-less indication of ZONE_IS_CATALOG flag.
 
+	/*! \brief Materialized zone configuration (NULL if not created). */
+	zone_conf_t *settings;
+
 	/*! \brief Dynamic configuration zone change type. */
 	conf_io_type_t change_type;
 
@@ -68,6 +92,9 @@ typedef struct zone
 		bool retransfer;
 	} zonefile;
 
+	/*! \brief Time of the last query to the zone (updated lock-less). */
+	time_t last_used;
+
 	/*! \brief Zone events. */
 	zone_timers_t timers;      //!< Persistent zone timers.
 	zone_events_t events;      //!< Zone events timers.
@@ -94,6 +121,28 @@ typedef struct zone
 	catalog_update_t *cat_members;
 	const char *catalog_group;
 
+	/*! \brief Rendered outgoing transfers, emptied on contents switch. */
+	struct xfr_cache *xfr_cache;
+
+	/*! \brief Canonical serialization for incremental ZONEMD, kept on contents switch. */
+	struct zone_digest_cache *digest_cache;
+
+	/*! \brief Nodes by RRSIG expiration for re-signing, kept on contents switch. */
+	struct zone_sign_index *sign_index;
+
+	/*! \brief Per NUMA node copies of the contents (NULL if not replicated). */
+	struct zone_replicas *replicas;
+
+	/*! \brief Zone file write running in the background (NULL if none). */
+	struct zone_bg_flush *bg_flush;
+
+	/*! \brief Memory usage of the contents, measured on demand (see memstat). */
+	struct {
+		const zone_contents_t *contents; /*!< Measured contents. */
+		uint32_t serial;                 /*!< Serial of the measured contents. */
+		zone_memory_t mem;
+	} memory;
+
 	/*! \brief Preferred master lock. Also used for flags access. */
 	pthread_mutex_t preferred_lock;
 	/*! \brief Preferred master for remote operation. */
@@ -122,6 +171,21 @@ zone_t* zone_new(const knot_dname_t *name);
  */
 void zone_free(zone_t **zone_ptr);
 
+/*!
+ * \brief Creates the materialized zone configuration.
+ *
+ * \param conf  Configuration.
+ * \param name  Zone name.
+ *
+ * \return The configuration snapshot or NULL if an error occurred.
+ */
+zone_conf_t *zone_conf_new(conf_t *conf, const knot_dname_t *name);
+
+/*!
+ * \brief Deallocates the materialized zone configuration.
+ */
+void zone_conf_free(zone_conf_t *settings);
+
 /*!
  * \brief Clear zone contents (->SERVFAIL), reset modules, plan LOAD.
  *
@@ -162,6 +226,14 @@ int zone_in_journal_store(conf_t *conf, zone_t *zone, zone_contents_t *new_conte
 /*! \brief Synchronize zone file with journal. */
 int zone_flush_journal(conf_t *conf, zone_t *zone, bool verbose);
 
+/*!
+ * \brief Synchronize zone file with journal in the background flush thread.
+ *
+ * The zone file is written from the published zone contents, the result
+ * is applied by the flush event planned once the write finishes.
+ */
+int zone_flush_journal_bg(conf_t *conf, zone_t *zone);
+
 bool zone_journal_has_zij(zone_t *zone);
 
 /*!
@@ -169,9 +241,52 @@ bool zone_journal_has_zij(zone_t *zone);
  */
 zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_contents);
 
+/*!
+ * \brief Frees switched-out contents once the RCU readers are done with them.
+ *
+ * The call doesn't wait for the grace period, the contents are freed
+ * by the reclaim thread.
+ *
+ * \param contents  Contents no longer published (NULL is ignored).
+ */
+void zone_retire_contents(zone_contents_t *contents);
+
+/*!
+ * \brief Return the current generation of the served answers.
+ *
+ * The generation is incremented whenever zone contents, the zone database,
+ * or query modules are switched, so cached answers can be invalidated.
+ */
+uint64_t zone_answers_generation(void);
+
+/*!
+ * \brief Invalidate all cached answers by incrementing the answer generation.
+ */
+void zone_answers_invalidate(void);
+
+/*!
+ * \brief Set a callback called after each answer generation increment.
+ *
+ * The callback is called synchronously by the invalidating thread, so that
+ * the answers cached outside of the server (e.g. in the XDP filter) are
+ * invalidated before the new contents are served.
+ *
+ * \note Must not be changed while the zones can be updated.
+ *
+ * \param hook  Callback (NULL to unset).
+ * \param data  Callback parameter.
+ */
+void zone_answers_set_hook(void (*hook)(void *data), void *data);
+
 /*! \brief Checks if the zone is slave. */
 bool zone_is_slave(conf_t *conf, const zone_t *zone);
 
+/*! \brief Checks if automatic DNSSEC signing is enabled for the zone. */
+bool zone_is_signed(conf_t *conf, const zone_t *zone);
+
+/*! \brief Returns the zone file synchronization timeout. */
+int64_t zone_zonefile_sync(conf_t *conf, const zone_t *zone);
+
 /*! \brief Sets the address as a preferred master address. */
 void zone_set_preferred_master(zone_t *zone, const struct sockaddr_storage *addr);
 
@@ -201,6 +316,16 @@ bool zone_expired(const zone_t *zone);
  */
 void zone_timers_sanitize(conf_t *conf, zone_t *zone);
 
+/*!
+ * \brief Mark the zone timers as changed to be persisted.
+ */
+void zone_timers_changed(zone_t *zone);
+
+/*!
+ * \brief Note the zone is being queried, load its contents if unloaded.
+ */
+void zone_touch(zone_t *zone);
+
 typedef struct {
 	bool address; //!< Fallback to next remote address is required.
 	bool remote;  //!< Fallback to next remote server is required.
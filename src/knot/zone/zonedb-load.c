@@ -15,6 +15,8 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <urcu.h>
 
@@ -31,6 +33,7 @@
 #include "knot/zone/zonedb.h"
 #include "knot/zone/zonefile.h"
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
 
 static bool zone_file_updated(conf_t *conf, const zone_t *old_zone,
                               const knot_dname_t *zone_name)
@@ -64,7 +67,8 @@ static void zone_get_catalog_group(conf_t *conf, zone_t *zone)
 	}
 }
 
-static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
+static zone_t *create_zone_from(conf_t *conf, const knot_dname_t *name,
+                                server_t *server)
 {
 	zone_t *zone = zone_new(name);
 	if (!zone) {
@@ -73,6 +77,12 @@ static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
 
 	zone->server = server;
 
+	zone->settings = zone_conf_new(conf, name);
+	if (zone->settings == NULL) {
+		zone_free(&zone);
+		return NULL;
+	}
+
 	int result = zone_events_setup(zone, server->workers, &server->sched);
 	if (result != KNOT_EOK) {
 		zone_free(&zone);
@@ -85,12 +95,14 @@ static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
 static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
                                   server_t *server, zone_t *old_zone)
 {
-	zone_t *zone = create_zone_from(name, server);
+	zone_t *zone = create_zone_from(conf, name, server);
 	if (!zone) {
 		return NULL;
 	}
 
 	zone->contents = old_zone->contents;
+	zone->replicas = old_zone->replicas;
+	old_zone->replicas = NULL;
 	zone_set_flag(zone, zone_get_flag(old_zone, ZONE_IS_CATALOG | ZONE_IS_CAT_MEMBER, false));
 
 	zone->timers = old_zone->timers;
@@ -124,15 +136,157 @@ static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
 	return zone;
 }
 
+/*! Maximum number of new member zones per second initially loaded from one primary. */
+#define MEMBER_LOAD_RATE 100
+
+/*!
+ * \brief New zone to be loaded with the other ones.
+ */
+typedef struct {
+	zone_t *zone;
+	off_t size;                 //!< Size of the zone file.
+} bulk_load_t;
+
+/*!
+ * \brief Context for creating many member zones at once.
+ */
+typedef struct {
+	knot_lmdb_txn_t timers_txn; //!< Shared read transaction of the timer database.
+	trie_t *primaries;          //!< Number of new zones per primary (NULL if no staggering).
+	time_t now;                 //!< Creation time.
+	bool defer_loads;           //!< Collect the initial loads instead of enqueuing them.
+	bulk_load_t *loads;         //!< Collected initial loads.
+	size_t loads_count;
+	size_t loads_max;
+} member_bulk_t;
+
+static void member_bulk_init(member_bulk_t *bulk, server_t *server, bool stagger)
+{
+	memset(bulk, 0, sizeof(*bulk));
+	if (knot_lmdb_exists(&server->timerdb) == KNOT_EOK &&
+	    knot_lmdb_open(&server->timerdb) == KNOT_EOK) {
+		knot_lmdb_begin(&server->timerdb, &bulk->timers_txn, false);
+	}
+	if (stagger) {
+		bulk->primaries = trie_create(NULL);
+	}
+	bulk->now = time(NULL);
+}
+
+static void member_bulk_deinit(member_bulk_t *bulk)
+{
+	if (bulk->timers_txn.opened) {
+		knot_lmdb_abort(&bulk->timers_txn);
+	}
+	trie_free(bulk->primaries);
+	free(bulk->loads);
+}
+
+/*!
+ * \brief Postpones the initial load of the new zone till member_bulk_run_loads().
+ *
+ * \return True if postponed.
+ */
+static bool member_bulk_defer_load(member_bulk_t *bulk, conf_t *conf, zone_t *zone)
+{
+	if (bulk == NULL || !bulk->defer_loads) {
+		return false;
+	}
+
+	if (bulk->loads_count == bulk->loads_max) {
+		size_t max = MAX(2 * bulk->loads_max, 256);
+		bulk_load_t *loads = realloc(bulk->loads, max * sizeof(*loads));
+		if (loads == NULL) {
+			return false;
+		}
+		bulk->loads = loads;
+		bulk->loads_max = max;
+	}
+
+	bulk_load_t *load = &bulk->loads[bulk->loads_count++];
+	load->zone = zone;
+	load->size = 0;
+
+	struct stat st;
+	char *path = conf_zonefile(conf, zone->name);
+	if (path != NULL && stat(path, &st) == 0) {
+		load->size = st.st_size;
+	}
+	free(path);
+
+	return true;
+}
+
+static int load_size_cmp(const void *a, const void *b)
+{
+	off_t size_a = ((const bulk_load_t *)a)->size;
+	off_t size_b = ((const bulk_load_t *)b)->size;
+
+	return (size_a < size_b) - (size_a > size_b);
+}
+
+/*!
+ * \brief Enqueues the postponed loads, the biggest zone files first.
+ *
+ * The background workers take the queued loads in order, so the longest
+ * loads start first instead of prolonging the startup in the end.
+ */
+static void member_bulk_run_loads(member_bulk_t *bulk)
+{
+	qsort(bulk->loads, bulk->loads_count, sizeof(*bulk->loads), load_size_cmp);
+	for (size_t i = 0; i < bulk->loads_count; i++) {
+		replan_load_new(bulk->loads[i].zone); // if load fails, fallback to bootstrap
+	}
+	bulk->loads_count = 0;
+}
+
+/*!
+ * \brief Get the initial load delay of a new member zone.
+ *
+ * The new zones are spread over time so that their first refreshes
+ * don't overload the primary server, or the event scheduler.
+ */
+static time_t member_bulk_delay(member_bulk_t *bulk, conf_t *conf,
+                                const knot_dname_t *name)
+{
+	if (bulk == NULL || bulk->primaries == NULL) {
+		return 0;
+	}
+
+	// Zones without a primary are counted together.
+	const uint8_t *key = (const uint8_t *)"";
+	size_t key_len = 1;
+	conf_val_t val = conf_zone_get(conf, C_MASTER, name);
+	if (val.code == KNOT_EOK) {
+		conf_val(&val);
+		key = val.data;
+		key_len = val.len;
+	}
+
+	trie_val_t *count = trie_get_ins(bulk->primaries, (const trie_key_t *)key, key_len);
+	if (count == NULL) {
+		return 0;
+	}
+	uintptr_t order = (uintptr_t)*count;
+	*count = (void *)(order + 1);
+
+	return order / MEMBER_LOAD_RATE;
+}
+
 static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
-                               server_t *server)
+                               server_t *server, member_bulk_t *bulk)
 {
-	zone_t *zone = create_zone_from(name, server);
+	zone_t *zone = create_zone_from(conf, name, server);
 	if (!zone) {
 		return NULL;
 	}
 
-	int ret = zone_timers_read(&server->timerdb, name, &zone->timers);
+	int ret;
+	if (bulk != NULL && bulk->timers_txn.opened) {
+		ret = zone_timers_read_txn(&bulk->timers_txn, name, &zone->timers);
+	} else {
+		ret = zone_timers_read(&server->timerdb, name, &zone->timers);
+	}
 	if (ret != KNOT_EOK && ret != KNOT_ENODB && ret != KNOT_ENOENT) {
 		log_zone_error(zone->name, "failed to load persistent timers (%s)",
 		               knot_strerror(ret));
@@ -149,6 +303,7 @@ static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
 		zone->catalog_gen = knot_dname_copy(conf_dname(&catz), NULL);
 		if (zone->timers.catalog_member == 0) {
 			zone->timers.catalog_member = time(NULL);
+			zone_timers_changed(zone);
 		}
 		if (zone->catalog_gen == NULL) {
 			log_zone_error(zone->name, "failed to initialize catalog member zone (%s)",
@@ -171,14 +326,21 @@ static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
 		}
 	}
 
+	time_t delay;
 	if (zone_expired(zone)) {
 		// expired => force bootstrap, no load attempt
 		log_zone_info(zone->name, "zone will be bootstrapped");
 		assert(zone_is_slave(conf, zone));
 		replan_load_bootstrap(conf, zone);
+	} else if ((delay = member_bulk_delay(bulk, conf, name)) > 0) {
+		log_zone_info(zone->name, "zone will be loaded in %lld seconds",
+		              (long long)delay);
+		zone_events_schedule_at(zone, ZONE_EVENT_LOAD, bulk->now + delay);
 	} else {
 		log_zone_info(zone->name, "zone will be loaded");
-		replan_load_new(zone); // if load fails, fallback to bootstrap
+		if (!member_bulk_defer_load(bulk, conf, zone)) {
+			replan_load_new(zone); // if load fails, fallback to bootstrap
+		}
 	}
 
 	return zone;
@@ -190,11 +352,12 @@ static zone_t *create_zone_new(conf_t *conf, const knot_dname_t *name,
  * \param conf       Configuration.
  * \param server     Server.
  * \param old_zone   Already loaded zone (can be NULL).
+ * \param bulk       Context of creating many new zones (can be NULL).
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static zone_t *create_zone(conf_t *conf, const knot_dname_t *name, server_t *server,
-                           zone_t *old_zone)
+                           zone_t *old_zone, member_bulk_t *bulk)
 {
 	assert(conf);
 	assert(name);
@@ -205,7 +368,7 @@ static zone_t *create_zone(conf_t *conf, const knot_dname_t *name, server_t *ser
 	if (old_zone) {
 		z = create_zone_reload(conf, name, server, old_zone);
 	} else {
-		z = create_zone_new(conf, name, server);
+		z = create_zone_new(conf, name, server, bulk);
 	}
 
 	if (z != NULL) {
@@ -258,6 +421,7 @@ static void zone_purge(conf_t *conf, zone_t *zone, server_t *server)
 static zone_contents_t *zone_expire(zone_t *zone)
 {
 	zone->timers.next_refresh = time(NULL);
+	zone_timers_changed(zone);
 	return zone_switch_contents(zone, NULL);
 }
 
@@ -279,14 +443,14 @@ static bool check_open_catalog(catalog_t *cat)
 	return false;
 }
 
-static zone_t *reuse_member_zone(zone_t *zone, server_t *server, conf_t *conf,
-                                 list_t *expired_contents)
+static zone_t *reuse_member_zone(zone_t *zone, catalog_update_t *cat_upd, server_t *server,
+                                 conf_t *conf, list_t *expired_contents)
 {
 	if (!zone_get_flag(zone, ZONE_IS_CAT_MEMBER, false)) {
 		return NULL;
 	}
 
-	catalog_upd_val_t *upd = catalog_update_get(&server->catalog_upd, zone->name);
+	catalog_upd_val_t *upd = catalog_update_get(cat_upd, zone->name);
 	if (upd != NULL) {
 		switch (upd->type) {
 		case CAT_UPD_UNIQ:
@@ -302,7 +466,7 @@ static zone_t *reuse_member_zone(zone_t *zone, server_t *server, conf_t *conf,
 		}
 	}
 
-	zone_t *newzone = create_zone(conf, zone->name, server, zone);
+	zone_t *newzone = create_zone(conf, zone->name, server, zone, NULL);
 	if (newzone == NULL) {
 		log_zone_error(zone->name, "zone cannot be created");
 	} else {
@@ -314,17 +478,19 @@ static zone_t *reuse_member_zone(zone_t *zone, server_t *server, conf_t *conf,
 }
 
 // cold start of knot: add unchanged member zone to zonedb
-static zone_t *reuse_cold_zone(const knot_dname_t *zname, server_t *server, conf_t *conf)
+static zone_t *reuse_cold_zone(const knot_dname_t *zname, server_t *server, conf_t *conf,
+                               member_bulk_t *bulk)
 {
 	catalog_upd_val_t *upd = catalog_update_get(&server->catalog_upd, zname);
 	if (upd != NULL && upd->type == CAT_UPD_REM) {
 		return NULL; // zone will be removed immediately
 	}
 
-	zone_t *zone = create_zone(conf, zname, server, NULL);
+	zone_t *zone = create_zone_new(conf, zname, server, bulk);
 	if (zone == NULL) {
 		log_zone_error(zname, "zone cannot be created");
 	} else {
+		zone_get_catalog_group(conf, zone);
 		zone_set_flag(zone, ZONE_IS_CAT_MEMBER);
 		conf_activate_modules(conf, server, zone->name, &zone->query_modules,
 		                      &zone->query_plan);
@@ -336,6 +502,7 @@ typedef struct {
 	knot_zonedb_t *zonedb;
 	server_t *server;
 	conf_t *conf;
+	member_bulk_t *bulk;
 } reuse_cold_zone_ctx_t;
 
 static int reuse_cold_zone_cb(const knot_dname_t *member, _unused_ const knot_dname_t *owner,
@@ -344,7 +511,7 @@ static int reuse_cold_zone_cb(const knot_dname_t *member, _unused_ const knot_dn
 {
 	reuse_cold_zone_ctx_t *rcz = ctx;
 
-	zone_t *zone = reuse_cold_zone(member, rcz->server, rcz->conf);
+	zone_t *zone = reuse_cold_zone(member, rcz->server, rcz->conf, rcz->bulk);
 	if (zone == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -352,7 +519,7 @@ static int reuse_cold_zone_cb(const knot_dname_t *member, _unused_ const knot_dn
 }
 
 static zone_t *add_member_zone(catalog_upd_val_t *val, knot_zonedb_t *check,
-                               server_t *server, conf_t *conf)
+                               server_t *server, conf_t *conf, member_bulk_t *bulk)
 {
 	if (val->type != CAT_UPD_ADD) {
 		return NULL;
@@ -363,10 +530,11 @@ static zone_t *add_member_zone(catalog_upd_val_t *val, knot_zonedb_t *check,
 		return NULL;
 	}
 
-	zone_t *zone = create_zone(conf, val->member, server, NULL);
+	zone_t *zone = create_zone_new(conf, val->member, server, bulk);
 	if (zone == NULL) {
 		log_zone_error(val->member, "zone cannot be created");
 	} else {
+		zone_get_catalog_group(conf, zone);
 		zone_set_flag(zone, ZONE_IS_CAT_MEMBER);
 		conf_activate_modules(conf, server, zone->name, &zone->query_modules,
 		                      &zone->query_plan);
@@ -375,6 +543,26 @@ static zone_t *add_member_zone(catalog_upd_val_t *val, knot_zonedb_t *check,
 	return zone;
 }
 
+/*!
+ * \brief Refresh the materialized configuration of a reused zone.
+ *
+ * \param conf              New server configuration.
+ * \param zone              Reused zone.
+ * \param expired_settings  Out: ptrlist of zone_conf_t to be freed after sync RCU.
+ */
+static void refresh_zone_settings(conf_t *conf, zone_t *zone, list_t *expired_settings)
+{
+	zone_conf_t *settings = zone_conf_new(conf, zone->name);
+	if (settings == NULL) {
+		log_zone_error(zone->name, "failed to update configuration (%s)",
+		               knot_strerror(KNOT_ENOMEM));
+		return;
+	}
+
+	zone_conf_t *old = rcu_xchg_pointer(&zone->settings, settings);
+	ptrlist_add(expired_settings, old, NULL);
+}
+
 /*!
  * \brief Create new zone database.
  *
@@ -384,10 +572,12 @@ static zone_t *add_member_zone(catalog_upd_val_t *val, knot_zonedb_t *check,
  * \param conf              New server configuration.
  * \param server            Server instance.
  * \param expired_contents  Out: ptrlist of zone_contents_t to be deep freed after sync RCU.
+ * \param expired_settings  Out: ptrlist of zone_conf_t to be freed after sync RCU.
  *
  * \return New zone database.
  */
-static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expired_contents)
+static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expired_contents,
+                                    list_t *expired_settings)
 {
 	assert(conf);
 	assert(server);
@@ -406,6 +596,15 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expi
 		mark_changed_zones(server->zone_db, conf->io.zones);
 	}
 
+	/* The initial loads are enqueued together, ordered by zone size. */
+	member_bulk_t startup;
+	member_bulk_t *startup_bulk = NULL;
+	if (db_old == NULL) {
+		member_bulk_init(&startup, server, false);
+		startup.defer_loads = true;
+		startup_bulk = &startup;
+	}
+
 	for (conf_iter_t iter = conf_iter(conf, C_ZONE); iter.code == KNOT_EOK;
 	     conf_iter_next(conf, &iter)) {
 		conf_val_t id = conf_iter_id(conf, &iter);
@@ -415,12 +614,17 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expi
 		if (old_zone != NULL && !full) {
 			/* Reuse unchanged zone. */
 			if (!(old_zone->change_type & CONF_IO_TRELOAD)) {
+				/* Possibly changed values not requiring the zone reload. */
+				if ((old_zone->change_type & CONF_IO_TCHANGE) ||
+				    (conf->io.flags & (CONF_IO_FDIFF_ZONES | CONF_IO_FTPL))) {
+					refresh_zone_settings(conf, old_zone, expired_settings);
+				}
 				knot_zonedb_insert(db_new, old_zone);
 				continue;
 			}
 		}
 
-		zone_t *zone = create_zone(conf, name, server, old_zone);
+		zone_t *zone = create_zone(conf, name, server, old_zone, startup_bulk);
 		if (zone == NULL) {
 			log_zone_error(name, "zone cannot be created");
 			continue;
@@ -435,6 +639,10 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expi
 	int ret = catalog_update_commit(&server->catalog_upd, &server->catalog);
 	if (ret != KNOT_EOK) {
 		log_error("catalog, failed to apply changes (%s)", knot_strerror(ret));
+		if (startup_bulk != NULL) {
+			member_bulk_run_loads(startup_bulk);
+			member_bulk_deinit(startup_bulk);
+		}
 		return db_new;
 	}
 
@@ -442,7 +650,8 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expi
 		knot_zonedb_iter_t *it = knot_zonedb_iter_begin(db_old);
 		while (!knot_zonedb_iter_finished(it)) {
 			zone_t *newzone = reuse_member_zone(knot_zonedb_iter_val(it),
-			                                    server, conf, expired_contents);
+			                                    &server->catalog_upd, server,
+			                                    conf, expired_contents);
 			if (newzone != NULL) {
 				knot_zonedb_insert(db_new, newzone);
 			}
@@ -450,23 +659,31 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server, list_t *expi
 		}
 		knot_zonedb_iter_free(it);
 	} else if (check_open_catalog(&server->catalog)) {
-		reuse_cold_zone_ctx_t rcz = { db_new, server, conf };
+		reuse_cold_zone_ctx_t rcz = { db_new, server, conf, startup_bulk };
 		ret = catalog_apply(&server->catalog, NULL, reuse_cold_zone_cb, &rcz, false);
 		if (ret != KNOT_EOK) {
 			log_error("catalog, failed to reload member zones (%s)", knot_strerror(ret));
 		}
 	}
 
+	if (startup_bulk != NULL) {
+		member_bulk_run_loads(startup_bulk);
+		member_bulk_deinit(startup_bulk);
+	}
+
+	member_bulk_t bulk;
+	member_bulk_init(&bulk, server, true);
 	catalog_it_t *it = catalog_it_begin(&server->catalog_upd);
 	while (!catalog_it_finished(it)) {
 		catalog_upd_val_t *val = catalog_it_val(it);
-		zone_t *zone = add_member_zone(val, db_new, server, conf);
+		zone_t *zone = add_member_zone(val, db_new, server, conf, &bulk);
 		if (zone != NULL) {
 			knot_zonedb_insert(db_new, zone);
 		}
 		catalog_it_next(it);
 	}
 	catalog_it_free(it);
+	member_bulk_deinit(&bulk);
 
 	return db_new;
 }
@@ -551,13 +768,14 @@ void zonedb_reload(conf_t *conf, server_t *server)
 		return;
 	}
 
-	list_t contents_tofree;
+	list_t contents_tofree, settings_tofree;
 	init_list(&contents_tofree);
+	init_list(&settings_tofree);
 
-	catalog_update_finalize(&server->catalog_upd, &server->catalog, conf);
+	catalog_update_finalize(&server->catalog_upd, &server->catalog, conf, true);
 
 	/* Insert all required zones to the new zone DB. */
-	knot_zonedb_t *db_new = create_zonedb(conf, server, &contents_tofree);
+	knot_zonedb_t *db_new = create_zonedb(conf, server, &contents_tofree, &settings_tofree);
 	if (db_new == NULL) {
 		log_error("failed to create new zone database");
 		return;
@@ -568,16 +786,326 @@ void zonedb_reload(conf_t *conf, server_t *server)
 	/* Switch the databases. */
 	knot_zonedb_t **db_current = &server->zone_db;
 	knot_zonedb_t *db_old = rcu_xchg_pointer(db_current, db_new);
+	zone_answers_invalidate();
 
 	/* Wait for readers to finish reading old zone database. */
 	synchronize_rcu();
 
-	ptrlist_free_custom(&contents_tofree, NULL, (ptrlist_free_cb)zone_contents_deep_free);
+	ptrlist_free_custom(&contents_tofree, NULL, (ptrlist_free_cb)zone_retire_contents);
+	ptrlist_free_custom(&settings_tofree, NULL, (ptrlist_free_cb)zone_conf_free);
 
 	/* Remove old zone DB. */
 	remove_old_zonedb(conf, db_old, server);
 }
 
+/*!
+ * \brief Check if the configuration transaction can be applied just to the changed zones.
+ */
+static bool changed_zones_only(conf_t *conf, server_t *server)
+{
+	yp_flag_t flags = conf->io.flags;
+	if (!(flags & CONF_IO_FACTIVE) || server->zone_db == NULL ||
+	    (flags & (CONF_IO_FRLD_ZONES | CONF_IO_FDIFF_ZONES | CONF_IO_FTPL))) {
+		return false;
+	}
+
+	/* Catalog changes are processed with the whole zone database. */
+	catalog_it_t *cat_it = catalog_it_begin(&server->catalog_upd);
+	bool cat_changes = !catalog_it_finished(cat_it);
+	catalog_it_free(cat_it);
+	if (cat_changes) {
+		return false;
+	}
+
+	if (conf->io.zones == NULL) {
+		return true;
+	}
+
+	bool ret = true;
+	trie_it_t *it = trie_it_begin(conf->io.zones);
+	for (; !trie_it_finished(it) && ret; trie_it_next(it)) {
+		const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+
+		zone_t *zone = knot_zonedb_find(server->zone_db, name);
+		if (zone != NULL) {
+			ret = (zone->cat_members == NULL &&
+			       !zone_get_flag(zone, ZONE_IS_CATALOG | ZONE_IS_CAT_MEMBER, false));
+		} else {
+			ret = !catalog_has_member(&server->catalog, name);
+		}
+
+		/* Catalog zones affect their members. */
+		conf_val_t role = conf_zone_get(conf, C_CATALOG_ROLE, name);
+		if (conf_opt(&role) == CATALOG_ROLE_GENERATE ||
+		    conf_opt(&role) == CATALOG_ROLE_INTERPRET) {
+			ret = false;
+		}
+	}
+	trie_it_free(it);
+
+	return ret;
+}
+
+/*!
+ * \brief Apply just the catalog member changes if the configuration hasn't changed.
+ */
+static int reload_catalog_members(conf_t *conf, server_t *server)
+{
+	/* Take over the changes, the catalog zones can continue interpreting. */
+	catalog_update_t upd;
+	int ret = catalog_update_init(&upd);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	pthread_mutex_lock(&server->catalog_upd.mutex);
+	trie_t *upd_trie = server->catalog_upd.upd;
+	server->catalog_upd.upd = upd.upd;
+	upd.upd = upd_trie;
+	pthread_mutex_unlock(&server->catalog_upd.mutex);
+
+	/* The configured zones are the same, no need to check them all. */
+	catalog_update_finalize(&upd, &server->catalog, conf, false);
+
+	ret = catalog_update_commit(&upd, &server->catalog);
+	if (ret != KNOT_EOK) {
+		log_error("catalog, failed to apply changes (%s)", knot_strerror(ret));
+		catalog_update_clear(&upd);
+		catalog_update_deinit(&upd);
+		return ret;
+	}
+
+	knot_zonedb_t *db_old = server->zone_db;
+	knot_zonedb_t *db_new = knot_zonedb_cow(db_old);
+	if (db_new == NULL) {
+		catalog_update_clear(&upd);
+		catalog_update_deinit(&upd);
+		return KNOT_ENOMEM;
+	}
+
+	list_t reused, created, replaced, removed, contents_tofree;
+	init_list(&reused);
+	init_list(&created);
+	init_list(&replaced);
+	init_list(&removed);
+	init_list(&contents_tofree);
+
+	catalog_it_t *it = catalog_it_begin(&upd);
+	for (; !catalog_it_finished(it); catalog_it_next(it)) {
+		catalog_upd_val_t *val = catalog_it_val(it);
+
+		zone_t *old_zone = knot_zonedb_find(db_old, val->member);
+		if (old_zone == NULL || !zone_get_flag(old_zone, ZONE_IS_CAT_MEMBER, false)) {
+			continue;
+		}
+
+		zone_events_freeze_blocking(old_zone);
+
+		zone_t *zone = reuse_member_zone(old_zone, &upd, server, conf, &contents_tofree);
+		if (zone != NULL) {
+			knot_zonedb_insert(db_new, zone);
+			ptrlist_add(&created, zone, NULL);
+			ptrlist_add(&replaced, old_zone, NULL);
+		} else if (val->type == CAT_UPD_REM) {
+			knot_zonedb_del(db_new, val->member);
+			ptrlist_add(&removed, old_zone, NULL);
+		} else {
+			ptrlist_add(&reused, old_zone, NULL);
+		}
+	}
+	catalog_it_free(it);
+
+	/* Add the new member zones, the timers are read at once. */
+	member_bulk_t bulk;
+	member_bulk_init(&bulk, server, true);
+	it = catalog_it_begin(&upd);
+	for (; !catalog_it_finished(it); catalog_it_next(it)) {
+		catalog_upd_val_t *val = catalog_it_val(it);
+		if (knot_zonedb_find(db_old, val->member) != NULL) {
+			continue;
+		}
+		zone_t *zone = add_member_zone(val, db_new, server, conf, &bulk);
+		if (zone != NULL) {
+			knot_zonedb_insert(db_new, zone);
+			ptrlist_add(&created, zone, NULL);
+		}
+	}
+	catalog_it_free(it);
+	member_bulk_deinit(&bulk);
+
+	/* Update generated catalogs with the changed member zones. */
+	it = catalog_it_begin(&upd);
+	for (; !catalog_it_finished(it); catalog_it_next(it)) {
+		catalogs_generate_zone(db_new, db_old, catalog_it_val(it)->member);
+	}
+	catalog_it_free(it);
+
+	/* Switch the databases. */
+	rcu_assign_pointer(server->zone_db, db_new);
+	zone_answers_invalidate();
+
+	/* Wait for readers to finish reading old zone database. */
+	synchronize_rcu();
+
+	knot_zonedb_cow_commit(db_new, &db_old);
+	catalog_commit_cleanup(&server->catalog);
+	ptrlist_free_custom(&contents_tofree, NULL, (ptrlist_free_cb)zone_retire_contents);
+
+	ptrnode_t *n;
+	WALK_LIST(n, replaced) {
+		zone_t *zone = n->d;
+		zone->contents = NULL; // contents have been re-used by the new zone
+		zone_free(&zone);
+	}
+	WALK_LIST(n, removed) {
+		zone_t *zone = n->d;
+		zone_purge(conf, zone, server);
+		zone_free(&zone);
+	}
+	WALK_LIST(n, reused) {
+		zone_events_start(n->d);
+	}
+	WALK_LIST(n, created) {
+		zone_events_start(n->d);
+	}
+	ptrlist_free(&replaced, NULL);
+	ptrlist_free(&removed, NULL);
+	ptrlist_free(&reused, NULL);
+	ptrlist_free(&created, NULL);
+
+	catalog_update_clear(&upd);
+	catalog_update_deinit(&upd);
+
+	return KNOT_EOK;
+}
+
+int zonedb_reload_changed(conf_t *conf, server_t *server)
+{
+	if (conf == NULL || server == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Catalog changes without a configuration transaction. */
+	if (!(conf->io.flags & CONF_IO_FACTIVE) && server->zone_db != NULL) {
+		pthread_mutex_lock(&server->catalog_upd.mutex);
+		bool cat_changes = trie_weight(server->catalog_upd.upd) > 0;
+		pthread_mutex_unlock(&server->catalog_upd.mutex);
+		if (cat_changes) {
+			return reload_catalog_members(conf, server);
+		}
+	}
+
+	if (!changed_zones_only(conf, server)) {
+		return KNOT_ENOTSUP;
+	}
+
+	if (conf->io.zones == NULL || trie_weight(conf->io.zones) == 0) {
+		return KNOT_EOK;
+	}
+
+	knot_zonedb_t *db_old = server->zone_db;
+	knot_zonedb_t *db_new = knot_zonedb_cow(db_old);
+	if (db_new == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	list_t reused, created, replaced, removed, settings_tofree;
+	init_list(&reused);
+	init_list(&created);
+	init_list(&replaced);
+	init_list(&removed);
+	init_list(&settings_tofree);
+
+	trie_it_t *it = trie_it_begin(conf->io.zones);
+	for (; !trie_it_finished(it); trie_it_next(it)) {
+		const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+		conf_io_type_t type = conf_io_trie_val(it);
+
+		zone_t *old_zone = knot_zonedb_find(db_old, name);
+		if (old_zone != NULL) {
+			old_zone->change_type = type;
+			zone_events_freeze_blocking(old_zone);
+		}
+
+		/* Removed zone. */
+		if (!conf_rawid_exists(conf, C_ZONE, name, knot_dname_size(name))) {
+			if (old_zone != NULL) {
+				knot_zonedb_del(db_new, name);
+				ptrlist_add(&removed, old_zone, NULL);
+			}
+			continue;
+		}
+
+		/* Changed zone not requiring reload. */
+		if (old_zone != NULL && !(type & CONF_IO_TRELOAD)) {
+			if (type & CONF_IO_TCHANGE) {
+				refresh_zone_settings(conf, old_zone, &settings_tofree);
+			}
+			ptrlist_add(&reused, old_zone, NULL);
+			continue;
+		}
+
+		/* New or reloaded zone. */
+		zone_t *zone = create_zone(conf, name, server, old_zone, NULL);
+		if (zone == NULL) {
+			log_zone_error(name, "zone cannot be created");
+			if (old_zone != NULL) {
+				ptrlist_add(&reused, old_zone, NULL);
+			}
+			continue;
+		}
+		conf_activate_modules(conf, server, zone->name, &zone->query_modules,
+		                      &zone->query_plan);
+		knot_zonedb_insert(db_new, zone);
+		ptrlist_add(&created, zone, NULL);
+		if (old_zone != NULL) {
+			ptrlist_add(&replaced, old_zone, NULL);
+		}
+	}
+
+	trie_it_free(it);
+
+	/* Update generated catalogs with the changed member zones. */
+	it = trie_it_begin(conf->io.zones);
+	for (; !trie_it_finished(it); trie_it_next(it)) {
+		const knot_dname_t *name = (const knot_dname_t *)trie_it_key(it, NULL);
+		catalogs_generate_zone(db_new, db_old, name);
+	}
+	trie_it_free(it);
+
+	/* Switch the databases. */
+	rcu_assign_pointer(server->zone_db, db_new);
+	zone_answers_invalidate();
+
+	/* Wait for readers to finish reading old zone database. */
+	synchronize_rcu();
+
+	knot_zonedb_cow_commit(db_new, &db_old);
+	ptrlist_free_custom(&settings_tofree, NULL, (ptrlist_free_cb)zone_conf_free);
+
+	ptrnode_t *n;
+	WALK_LIST(n, replaced) {
+		zone_t *zone = n->d;
+		zone->contents = NULL; // contents have been re-used by the new zone
+		zone_free(&zone);
+	}
+	WALK_LIST(n, removed) {
+		zone_t *zone = n->d;
+		zone_free(&zone);
+	}
+	WALK_LIST(n, reused) {
+		zone_events_start(n->d);
+	}
+	WALK_LIST(n, created) {
+		zone_events_start(n->d);
+	}
+	ptrlist_free(&replaced, NULL);
+	ptrlist_free(&removed, NULL);
+	ptrlist_free(&reused, NULL);
+	ptrlist_free(&created, NULL);
+
+	return KNOT_EOK;
+}
+
 int zone_reload_modules(conf_t *conf, server_t *server, const knot_dname_t *zone_name)
 {
 	zone_t **zone = knot_zonedb_find_ptr(server->zone_db, zone_name);
@@ -589,7 +1117,7 @@ int zone_reload_modules(conf_t *conf, server_t *server, const knot_dname_t *zone
 	zone_events_freeze_blocking(*zone);
 	knot_sem_wait(&(*zone)->cow_lock);
 
-	zone_t *newzone = create_zone(conf, zone_name, server, *zone);
+	zone_t *newzone = create_zone(conf, zone_name, server, *zone, NULL);
 	if (newzone == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -597,6 +1125,7 @@ int zone_reload_modules(conf_t *conf, server_t *server, const knot_dname_t *zone
 	                      &newzone->query_plan);
 
 	zone_t *oldzone = rcu_xchg_pointer(zone, newzone);
+	zone_answers_invalidate();
 	synchronize_rcu();
 
 	assert(newzone->contents == oldzone->contents);
@@ -27,6 +27,25 @@
  */
 void zonedb_reload(conf_t *conf, server_t *server);
 
+/*!
+ * \brief Update just the zones changed by the configuration transaction.
+ *
+ * Only the added, removed, and changed zones are (re)created and they are
+ * switched into a copy-on-write update of the zone database, the other
+ * zones aren't touched. Only the events of the affected zones are frozen.
+ *
+ * Without a configuration transaction, the pending catalog changes are
+ * applied the same way just to the affected member zones.
+ *
+ * \param conf    Configuration.
+ * \param server  Server instance.
+ *
+ * \retval KNOT_EOK      The changes applied.
+ * \retval KNOT_ENOTSUP  The changes require zonedb_reload().
+ * \retval KNOT_E*       Other error.
+ */
+int zonedb_reload_changed(conf_t *conf, server_t *server);
+
 /*!
  * \brief Re-create zone_t struct in zoneDB so that the zone is reloaded incl modules.
  *
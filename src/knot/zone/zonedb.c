@@ -76,7 +76,12 @@ int knot_zonedb_insert(knot_zonedb_t *db, zone_t *zone)
 	uint8_t *lf = knot_dname_lf(zone->name, lf_storage);
 	assert(lf);
 
-	*trie_get_ins(db->trie, lf + 1, *lf) = zone;
+	trie_val_t *val = (db->cow != NULL) ? trie_get_cow(db->cow, lf + 1, *lf) :
+	                                      trie_get_ins(db->trie, lf + 1, *lf);
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*val = zone;
 
 	return KNOT_EOK;
 }
@@ -96,6 +101,10 @@ int knot_zonedb_del(knot_zonedb_t *db, const knot_dname_t *zone_name)
 		return KNOT_ENOENT;
 	}
 
+	if (db->cow != NULL) {
+		return trie_del_cow(db->cow, lf + 1, *lf, NULL);
+	}
+
 	return trie_del(db->trie, lf + 1, *lf, NULL);
 }
 
@@ -109,6 +118,15 @@ zone_t *knot_zonedb_find(knot_zonedb_t *db, const knot_dname_t *zone_name)
 	uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
 	assert(lf);
 
+	return knot_zonedb_find_lf(db, lf);
+}
+
+zone_t *knot_zonedb_find_lf(knot_zonedb_t *db, const uint8_t *lf)
+{
+	if (db == NULL || lf == NULL) {
+		return NULL;
+	}
+
 	trie_val_t *val = trie_get_try(db->trie, lf + 1, *lf);
 	if (val == NULL) {
 		return NULL;
@@ -141,20 +159,24 @@ zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name
 		return NULL;
 	}
 
-	while (true) {
-		knot_dname_storage_t lf_storage;
-		uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
-		assert(lf);
+	knot_dname_storage_t lf_storage;
+	uint8_t *lf = knot_dname_lf(zone_name, lf_storage);
+	assert(lf);
 
-		trie_val_t *val = trie_get_try(db->trie, lf + 1, *lf);
-		if (val != NULL) {
-			return *val;
-		} else if (zone_name[0] == 0) {
-			return NULL;
-		}
+	return knot_zonedb_find_suffix_lf(db, lf);
+}
 
-		zone_name = knot_wire_next_label(zone_name, NULL);
+zone_t *knot_zonedb_find_suffix_lf(knot_zonedb_t *db, const uint8_t *lf)
+{
+	if (db == NULL || lf == NULL) {
+		return NULL;
 	}
+
+	// The keys are zero-terminated labels from the root, so the longest
+	// key prefix corresponds to the closest enclosing zone.
+	trie_val_t *val = trie_get_prefix(db->trie, lf + 1, *lf);
+
+	return (val != NULL) ? *val : NULL;
 }
 
 size_t knot_zonedb_size(const knot_zonedb_t *db)
@@ -166,6 +188,42 @@ size_t knot_zonedb_size(const knot_zonedb_t *db)
 	return trie_weight(db->trie);
 }
 
+knot_zonedb_t *knot_zonedb_cow(knot_zonedb_t *db)
+{
+	if (db == NULL || db->cow != NULL) {
+		return NULL;
+	}
+
+	knot_zonedb_t *new_db = calloc(1, sizeof(knot_zonedb_t));
+	if (new_db == NULL) {
+		return NULL;
+	}
+
+	new_db->cow = trie_cow(db->trie, NULL, NULL);
+	if (new_db->cow == NULL) {
+		free(new_db);
+		return NULL;
+	}
+	new_db->trie = trie_cow_new(new_db->cow);
+	// The memory pool is shared, its ownership is passed to the new database.
+	new_db->mm = db->mm;
+
+	return new_db;
+}
+
+void knot_zonedb_cow_commit(knot_zonedb_t *db, knot_zonedb_t **db_old)
+{
+	if (db == NULL || db->cow == NULL || db_old == NULL || *db_old == NULL) {
+		return;
+	}
+
+	db->trie = trie_cow_commit(db->cow, NULL, NULL);
+	db->cow = NULL;
+
+	free(*db_old);
+	*db_old = NULL;
+}
+
 void knot_zonedb_free(knot_zonedb_t **db)
 {
 	if (db == NULL || *db == NULL) {
@@ -28,6 +28,7 @@
 
 struct knot_zonedb {
 	trie_t *trie;
+	trie_cow_t *cow; //!< Pending copy-on-write update (NULL if none).
 	knot_mm_t mm;
 };
 
@@ -95,6 +96,12 @@ int knot_zonedb_del(knot_zonedb_t *db, const knot_dname_t *zone_name);
  */
 zone_t *knot_zonedb_find(knot_zonedb_t *db, const knot_dname_t *zone_name);
 
+/*!
+ * \brief Finds zone exactly matching the given zone name in the lookup format
+ *        (see knot_dname_lf()).
+ */
+zone_t *knot_zonedb_find_lf(knot_zonedb_t *db, const uint8_t *lf);
+
 /*!
  * \brief Finds pointer to zone exactly matching the given zone name.
  *
@@ -116,8 +123,41 @@ zone_t **knot_zonedb_find_ptr(knot_zonedb_t *db, const knot_dname_t *zone_name);
  */
 zone_t *knot_zonedb_find_suffix(knot_zonedb_t *db, const knot_dname_t *zone_name);
 
+/*!
+ * \brief Finds zone the given domain name in the lookup format
+ *        (see knot_dname_lf()) should belong to.
+ */
+zone_t *knot_zonedb_find_suffix_lf(knot_zonedb_t *db, const uint8_t *lf);
+
 size_t knot_zonedb_size(const knot_zonedb_t *db);
 
+/*!
+ * \brief Starts a copy-on-write update of the zone database.
+ *
+ * The new database shares the zones and unchanged parts of the lookup
+ * structure with the old one, which remains valid for concurrent readers.
+ * Insertions and removals in the new database copy just the affected paths.
+ *
+ * \note The old database mustn't be modified or freed until the update
+ *       is committed with knot_zonedb_cow_commit().
+ *
+ * \param db Current zone database.
+ *
+ * \return New zone database or NULL if error.
+ */
+knot_zonedb_t *knot_zonedb_cow(knot_zonedb_t *db);
+
+/*!
+ * \brief Finishes the copy-on-write update, frees the old zone database
+ *        structure (but not the zones within).
+ *
+ * \note There mustn't be any readers of the old database.
+ *
+ * \param db      Updated zone database.
+ * \param db_old  Old zone database to be freed.
+ */
+void knot_zonedb_cow_commit(knot_zonedb_t *db, knot_zonedb_t **db_old);
+
 /*!
  * \brief Destroys and deallocates the zone database structure (but not the
  *        zones within).
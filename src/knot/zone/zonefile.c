@@ -19,6 +19,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -39,17 +41,29 @@
 #define WARNING(zone, fmt, ...) log_zone_warning(zone, "zone loader, " fmt, ##__VA_ARGS__)
 #define NOTICE(zone, fmt, ...) log_zone_notice(zone, "zone loader, " fmt, ##__VA_ARGS__)
 
-static void process_error(zs_scanner_t *s)
-{
-	zcreator_t *zc = s->process.data;
-	const knot_dname_t *zname = zc->z->apex->owner;
+/*! \brief Minimal size of a zone file chunk parsed in parallel. */
+#define CHUNK_MIN_SIZE	(4 * 1024 * 1024)
+/*! \brief Maximal size of a zone file chunk parsed in parallel. */
+#define CHUNK_MAX_SIZE	(64 * 1024 * 1024)
+/*! \brief Number of chunks per parsing thread. */
+#define CHUNKS_PER_THREAD	4
+/*! \brief Number of parsed chunks per thread waiting for insertion. */
+#define CHUNK_WINDOW_PER_THREAD	2
 
+static void log_scanner_error(const knot_dname_t *zname, zs_scanner_t *s)
+{
 	ERROR(zname, "%s in zone, file '%s', line %"PRIu64" (%s)",
 	      s->error.fatal ? "fatal error" : "error",
 	      s->file.name, s->line_counter,
 	      zs_strerror(s->error.code));
 }
 
+static void process_error(zs_scanner_t *s)
+{
+	zcreator_t *zc = s->process.data;
+	log_scanner_error(zc->z->apex->owner, s);
+}
+
 static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool master)
 {
 	const knot_dname_t *zname = zc->z->apex->owner;
@@ -75,65 +89,582 @@ static bool handle_err(zcreator_t *zc, const knot_rrset_t *rr, int ret, bool mas
 	}
 }
 
+static int insert_rrset(zcreator_t *zc, const knot_rrset_t *rr)
+{
+	zone_node_t *node = NULL;
+	int ret = zone_contents_add_rr(zc->z, rr, &node);
+	if (ret != KNOT_EOK) {
+		if (!handle_err(zc, rr, ret, zc->master)) {
+			// Fatal error
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 {
 	if (zc == NULL || rr == NULL || rr->rrs.count != 1) {
 		return KNOT_EINVAL;
 	}
 
-	if (rr->type == KNOT_RRTYPE_SOA &&
-	    node_rrtype_exists(zc->z->apex, KNOT_RRTYPE_SOA)) {
-		// Ignore extra SOA
-		return KNOT_EOK;
-	}
+	if (zc->pending.owner != NULL) {
+		if (rr->type == zc->pending.type && rr->rclass == zc->pending.rclass &&
+		    rr->ttl == zc->pending.ttl &&
+		    knot_dname_is_equal(rr->owner, zc->pending.owner)) {
+			int ret = knot_rdataset_builder_append(&zc->builder, rr->rrs.rdata);
+			if (ret != KNOT_EOK && !handle_err(zc, rr, ret, zc->master)) {
+				return ret;
+			}
+			return KNOT_EOK;
+		}
 
-	zone_node_t *node = NULL;
-	int ret = zone_contents_add_rr(zc->z, rr, &node);
-	if (ret != KNOT_EOK) {
-		if (!handle_err(zc, rr, ret, zc->master)) {
-			// Fatal error
+		int ret = zcreator_flush(zc);
+		if (ret != KNOT_EOK) {
 			return ret;
 		}
 	}
 
+	if (rr->type == KNOT_RRTYPE_SOA) {
+		if (node_rrtype_exists(zc->z->apex, KNOT_RRTYPE_SOA)) {
+			// Ignore extra SOA
+			return KNOT_EOK;
+		}
+		// SOA is added immediately, its presence is checked by the callers.
+		return insert_rrset(zc, rr);
+	}
+
+	// Collect the RRSet, the rdata array is extended geometrically.
+	int ret = knot_rdataset_builder_append(&zc->builder, rr->rrs.rdata);
+	if (ret != KNOT_EOK) {
+		return handle_err(zc, rr, ret, zc->master) ? KNOT_EOK : ret;
+	}
+	memcpy(zc->owner, rr->owner, knot_dname_size(rr->owner));
+	knot_rrset_init(&zc->pending, zc->owner, rr->type, rr->rclass, rr->ttl);
+
 	return KNOT_EOK;
 }
 
-/*! \brief Creates RR from parser input, passes it to handling function. */
-static void process_data(zs_scanner_t *scanner)
+int zcreator_flush(zcreator_t *zc)
 {
-	zcreator_t *zc = scanner->process.data;
-	if (zc->ret != KNOT_EOK) {
-		scanner->state = ZS_STATE_STOP;
+	if (zc == NULL) {
+		return KNOT_EINVAL;
+	} else if (zc->pending.owner == NULL) {
+		return KNOT_EOK;
+	}
+
+	int ret = knot_rdataset_builder_finalize(&zc->builder);
+	if (ret == KNOT_EOK) {
+		zc->pending.rrs = zc->builder.rrs;
+		ret = insert_rrset(zc, &zc->pending);
+	}
+
+	knot_rdataset_builder_reset(&zc->builder);
+	knot_rrset_init_empty(&zc->pending);
+
+	return ret;
+}
+
+void zcreator_clear(zcreator_t *zc)
+{
+	if (zc == NULL) {
 		return;
 	}
 
-	knot_dname_t *owner = knot_dname_copy(scanner->r_owner, NULL);
+	knot_rdataset_builder_clear(&zc->builder);
+	knot_rrset_init_empty(&zc->pending);
+}
+
+/*! \brief Creates RR from parsed values, passes it to handling function. */
+static int process_rr(zcreator_t *zc, const knot_dname_t *r_owner, uint16_t r_type,
+                      uint16_t r_class, uint32_t r_ttl, const uint8_t *r_data,
+                      uint16_t r_data_length)
+{
+	knot_dname_t *owner = knot_dname_copy(r_owner, NULL);
 	if (owner == NULL) {
-		zc->ret = KNOT_ENOMEM;
-		return;
+		return KNOT_ENOMEM;
 	}
 
 	knot_rrset_t rr;
-	knot_rrset_init(&rr, owner, scanner->r_type, scanner->r_class, scanner->r_ttl);
+	knot_rrset_init(&rr, owner, r_type, r_class, r_ttl);
 
-	int ret = knot_rrset_add_rdata(&rr, scanner->r_data, scanner->r_data_length, NULL);
+	int ret = knot_rrset_add_rdata(&rr, r_data, r_data_length, NULL);
 	if (ret != KNOT_EOK) {
 		knot_rrset_clear(&rr, NULL);
-		zc->ret = ret;
-		return;
+		return ret;
 	}
 
 	/* Convert RDATA dnames to lowercase before adding to zone. */
 	ret = knot_rrset_rr_to_canonical(&rr);
 	if (ret != KNOT_EOK) {
 		knot_rrset_clear(&rr, NULL);
-		zc->ret = ret;
-		return;
+		return ret;
 	}
 
-	zc->ret = zcreator_step(zc, &rr);
+	ret = zcreator_step(zc, &rr);
 	knot_rrset_clear(&rr, NULL);
+
+	return ret;
+}
+
+/*! \brief Creates RR from parser input, passes it to handling function. */
+static void process_data(zs_scanner_t *scanner)
+{
+	zcreator_t *zc = scanner->process.data;
+	if (zc->ret != KNOT_EOK) {
+		scanner->state = ZS_STATE_STOP;
+		return;
+	}
+
+	zc->ret = process_rr(zc, scanner->r_owner, scanner->r_type, scanner->r_class,
+	                     scanner->r_ttl, scanner->r_data, scanner->r_data_length);
+}
+
+/*! \brief Text span in the zone file. */
+typedef struct {
+	const char *start;
+	size_t len;
+} zspan_t;
+
+struct zparallel;
+
+/*! \brief Zone file chunk parsed by one thread. */
+typedef struct {
+	struct zparallel *par; /*!< Parallel parsing context. */
+	const char *start;     /*!< Chunk text. */
+	size_t size;           /*!< Chunk text length. */
+	uint64_t line;         /*!< Line number of the chunk start. */
+	char *context;         /*!< $TTL and $ORIGIN directives in effect. */
+	size_t context_len;    /*!< Length of the directives. */
+	uint8_t *recs;         /*!< Serialized parsed records. */
+	size_t recs_len;       /*!< Length of the serialized records. */
+	size_t recs_max;       /*!< Allocated size for the records. */
+	uint64_t errors;       /*!< Number of scanner errors. */
+	int ret;               /*!< Processing result other than scanner errors. */
+	bool done;             /*!< Parsing of the chunk finished. */
+} zchunk_t;
+
+/*! \brief Parallel zone file parsing context. */
+typedef struct zparallel {
+	const knot_dname_t *zname; /*!< Zone name. */
+	const char *source;        /*!< Zone file name. */
+	char *origin;              /*!< Textual zone origin. */
+	zchunk_t *chunks;          /*!< Zone file chunks. */
+	size_t count;              /*!< Number of chunks. */
+	size_t next;               /*!< Next chunk to be parsed. */
+	size_t consumed;           /*!< Number of chunks already inserted. */
+	size_t window;             /*!< Maximum of parsed chunks waiting for insertion. */
+	bool stop;                 /*!< Parsing interrupted. */
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+} zparallel_t;
+
+/*! \brief Header of a serialized parsed record. */
+typedef struct {
+	uint32_t ttl;
+	uint16_t type;
+	uint16_t rclass;
+	uint16_t rdata_len;
+	uint8_t owner_len;
+} zrec_hdr_t;
+
+static bool is_blank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static bool is_directive(const char *pos, const char *end, const char *name)
+{
+	size_t len = strlen(name);
+	return end - pos > len && strncasecmp(pos, name, len) == 0 && is_blank(pos[len]);
+}
+
+/*!
+ * \brief Remembers the directive ending before eol for the following chunks.
+ *
+ * Only the last $TTL and $ORIGIN (always absolute) affect the following
+ * records. Zone files with $INCLUDE are not split.
+ */
+static int track_directive(const char *pos, const char *eol, zspan_t *ttl,
+                           zspan_t *origin)
+{
+	if (memchr(pos, '(', eol - pos) != NULL) {
+		return KNOT_ENOTSUP;
+	}
+
+	if (is_directive(pos, eol, "$TTL")) {
+		*ttl = (zspan_t){ pos, eol - pos };
+	} else if (is_directive(pos, eol, "$ORIGIN")) {
+		*origin = (zspan_t){ pos, eol - pos };
+	} else if (is_directive(pos, eol, "$INCLUDE")) {
+		return KNOT_ENOTSUP;
+	}
+
+	return KNOT_EOK;
+}
+
+static int add_chunk(zchunk_t **chunks, size_t *count, const char *start,
+                     const char *end, uint64_t line, const zspan_t *ttl,
+                     const zspan_t *origin)
+{
+	zchunk_t *new_chunks = realloc(*chunks, (*count + 1) * sizeof(zchunk_t));
+	if (new_chunks == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*chunks = new_chunks;
+
+	zchunk_t *chunk = &new_chunks[*count];
+	memset(chunk, 0, sizeof(*chunk));
+	chunk->start = start;
+	chunk->size = end - start;
+	chunk->line = line;
+	(*count)++;
+
+	/* Prepare the directives for the chunk scanner. */
+	size_t len = ttl->len + origin->len + 2;
+	chunk->context = malloc(len);
+	if (chunk->context == NULL) {
+		return KNOT_ENOMEM;
+	}
+	const zspan_t *spans[] = { ttl, origin };
+	for (int i = 0; i < 2; i++) {
+		if (spans[i]->len > 0) {
+			memcpy(chunk->context + chunk->context_len, spans[i]->start, spans[i]->len);
+			chunk->context_len += spans[i]->len;
+			chunk->context[chunk->context_len++] = '\n';
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static void free_chunks(zchunk_t *chunks, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		free(chunks[i].context);
+		free(chunks[i].recs);
+	}
+	free(chunks);
+}
+
+/*!
+ * \brief Splits the zone file text into chunks at safe record boundaries.
+ *
+ * A chunk always starts on a line with an explicit owner outside of quoted
+ * strings, comments, and parentheses, so it doesn't depend on the previous
+ * records except for the collected $TTL and $ORIGIN directives.
+ */
+static int split_chunks(const char *start, const char *end, size_t chunk_size,
+                        zchunk_t **out_chunks, size_t *out_count)
+{
+	zchunk_t *chunks = NULL;
+	size_t count = 0;
+	zspan_t ttl = { 0 }, origin = { 0 };
+	zspan_t chunk_ttl = { 0 }, chunk_origin = { 0 };
+
+	const char *chunk_start = start;
+	uint64_t chunk_line = 1;
+	uint64_t line = 1;
+	unsigned parens = 0;
+	bool quoted = false, comment = false, line_start = true;
+	int ret = KNOT_EOK;
+
+	for (const char *p = start; p < end; p++) {
+		if (line_start && parens == 0) {
+			if (*p == '$') {
+				const char *eol = memchr(p, '\n', end - p);
+				ret = track_directive(p, (eol != NULL) ? eol : end, &ttl, &origin);
+				if (ret != KNOT_EOK) {
+					goto fail;
+				}
+			} else if (!is_blank(*p) && *p != ';' && p - chunk_start >= chunk_size) {
+				ret = add_chunk(&chunks, &count, chunk_start, p, chunk_line,
+				                &chunk_ttl, &chunk_origin);
+				if (ret != KNOT_EOK) {
+					goto fail;
+				}
+				chunk_start = p;
+				chunk_line = line;
+				chunk_ttl = ttl;
+				chunk_origin = origin;
+			}
+		}
+		line_start = false;
+
+		char c = *p;
+		if (c == '\n') {
+			line++;
+		}
+		if (comment) {
+			if (c == '\n') {
+				comment = false;
+				line_start = true;
+			}
+			continue;
+		}
+		if (c == '\\') {
+			if (p + 1 < end && *(++p) == '\n') {
+				line++;
+			}
+			continue;
+		}
+		if (quoted) {
+			quoted = (c != '"');
+			continue;
+		}
+		switch (c) {
+		case '"':  quoted = true; break;
+		case ';':  comment = true; break;
+		case '(':  parens++; break;
+		case ')':  parens -= (parens > 0); break;
+		case '\n': line_start = true; break;
+		default:   break;
+		}
+	}
+
+	ret = add_chunk(&chunks, &count, chunk_start, end, chunk_line,
+	                &chunk_ttl, &chunk_origin);
+	if (ret != KNOT_EOK) {
+		goto fail;
+	}
+
+	*out_chunks = chunks;
+	*out_count = count;
+	return KNOT_EOK;
+fail:
+	free_chunks(chunks, count);
+	return ret;
+}
+
+static void chunk_record(zs_scanner_t *s)
+{
+	zchunk_t *chunk = s->process.data;
+
+	zrec_hdr_t hdr = {
+		.ttl = s->r_ttl,
+		.type = s->r_type,
+		.rclass = s->r_class,
+		.rdata_len = s->r_data_length,
+		.owner_len = s->r_owner_length,
+	};
+
+	size_t need = chunk->recs_len + sizeof(hdr) + hdr.owner_len + hdr.rdata_len;
+	if (need > chunk->recs_max) {
+		size_t new_max = MAX(need, 2 * chunk->recs_max);
+		uint8_t *new_recs = realloc(chunk->recs, new_max);
+		if (new_recs == NULL) {
+			chunk->ret = KNOT_ENOMEM;
+			s->state = ZS_STATE_STOP;
+			return;
+		}
+		chunk->recs = new_recs;
+		chunk->recs_max = new_max;
+	}
+
+	uint8_t *pos = chunk->recs + chunk->recs_len;
+	memcpy(pos, &hdr, sizeof(hdr));
+	pos += sizeof(hdr);
+	memcpy(pos, s->r_owner, hdr.owner_len);
+	pos += hdr.owner_len;
+	memcpy(pos, s->r_data, hdr.rdata_len);
+	chunk->recs_len = need;
+}
+
+static void chunk_error(zs_scanner_t *s)
+{
+	zchunk_t *chunk = s->process.data;
+	log_scanner_error(chunk->par->zname, s);
+}
+
+static void parse_chunk(zparallel_t *par, zchunk_t *chunk)
+{
+	zs_scanner_t s;
+	if (zs_init(&s, par->origin, KNOT_CLASS_IN, 3600) != 0) {
+		chunk->ret = KNOT_ENOMEM;
+		zs_deinit(&s);
+		return;
+	}
+
+	/* Restore the directives in effect, already checked by the previous chunk. */
+	if (chunk->context_len > 0 &&
+	    (zs_set_input_string(&s, chunk->context, chunk->context_len) != 0 ||
+	     zs_parse_all(&s) != 0)) {
+		chunk->ret = KNOT_EPARSEFAIL;
+		zs_deinit(&s);
+		return;
+	}
+
+	if (zs_set_input_string(&s, chunk->start, chunk->size) != 0 ||
+	    zs_set_processing(&s, chunk_record, chunk_error, chunk) != 0 ||
+	    (s.file.name = strdup(par->source)) == NULL) {
+		chunk->ret = KNOT_ENOMEM;
+		zs_deinit(&s);
+		return;
+	}
+	s.line_counter = chunk->line;
+
+	(void)zs_parse_all(&s);
+	chunk->errors = s.error.counter;
+
+	zs_deinit(&s);
+}
+
+static void *parse_thread(void *arg)
+{
+	zparallel_t *par = arg;
+
+	pthread_mutex_lock(&par->mx);
+	while (true) {
+		while (!par->stop && par->next < par->count &&
+		       par->next >= par->consumed + par->window) {
+			pthread_cond_wait(&par->cond, &par->mx);
+		}
+		if (par->stop || par->next >= par->count) {
+			break;
+		}
+		zchunk_t *chunk = &par->chunks[par->next++];
+		pthread_mutex_unlock(&par->mx);
+
+		parse_chunk(par, chunk);
+
+		pthread_mutex_lock(&par->mx);
+		chunk->done = true;
+		pthread_cond_broadcast(&par->cond);
+	}
+	pthread_mutex_unlock(&par->mx);
+
+	return NULL;
+}
+
+static int insert_chunk(zcreator_t *zc, const zchunk_t *chunk)
+{
+	const uint8_t *pos = chunk->recs;
+	const uint8_t *end = chunk->recs + chunk->recs_len;
+	while (pos < end) {
+		zrec_hdr_t hdr;
+		memcpy(&hdr, pos, sizeof(hdr));
+		pos += sizeof(hdr);
+		const knot_dname_t *owner = pos;
+		pos += hdr.owner_len;
+
+		int ret = process_rr(zc, owner, hdr.type, hdr.rclass, hdr.ttl,
+		                     pos, hdr.rdata_len);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		pos += hdr.rdata_len;
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Parses the zone file by chunks in parallel.
+ *
+ * The chunks are scanned concurrently, but the records are inserted into
+ * the zone in the original order by the calling thread.
+ *
+ * \retval KNOT_ENOTSUP if the zone file is not suitable for parallel parsing.
+ */
+static int zonefile_parse_parallel(zloader_t *loader)
+{
+	zcreator_t *zc = loader->creator;
+	zs_scanner_t *scanner = &loader->scanner;
+	const char *start = scanner->input.start;
+	const char *end = scanner->input.end;
+	if (start == NULL || end - start < 2 * CHUNK_MIN_SIZE) {
+		return KNOT_ENOTSUP;
+	}
+
+	unsigned threads = loader->threads;
+	size_t chunk_size = (end - start) / (threads * CHUNKS_PER_THREAD);
+	chunk_size = MIN(MAX(chunk_size, CHUNK_MIN_SIZE), CHUNK_MAX_SIZE);
+
+	zparallel_t par = {
+		.zname = zc->z->apex->owner,
+		.source = loader->source,
+		.window = threads * CHUNK_WINDOW_PER_THREAD,
+	};
+
+	int ret = split_chunks(start, end, chunk_size, &par.chunks, &par.count);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (par.count < 2) {
+		free_chunks(par.chunks, par.count);
+		return KNOT_ENOTSUP;
+	}
+	for (size_t i = 0; i < par.count; i++) {
+		par.chunks[i].par = &par;
+	}
+
+	par.origin = knot_dname_to_str_alloc(par.zname);
+	if (par.origin == NULL) {
+		free_chunks(par.chunks, par.count);
+		return KNOT_ENOMEM;
+	}
+
+	pthread_mutex_init(&par.mx, NULL);
+	pthread_cond_init(&par.cond, NULL);
+
+	threads = MIN(threads, par.count);
+	pthread_t thread_ids[threads];
+	unsigned started = 0;
+	while (started < threads &&
+	       pthread_create(&thread_ids[started], NULL, parse_thread, &par) == 0) {
+		started++;
+	}
+	if (started == 0) {
+		ret = KNOT_ENOTSUP;
+		goto finish;
+	}
+
+	uint64_t errors = 0;
+	for (size_t i = 0; i < par.count && ret == KNOT_EOK; i++) {
+		zchunk_t *chunk = &par.chunks[i];
+
+		pthread_mutex_lock(&par.mx);
+		while (!chunk->done) {
+			pthread_cond_wait(&par.cond, &par.mx);
+		}
+		pthread_mutex_unlock(&par.mx);
+
+		/* Like the sequential parsing, stop inserting after an error. */
+		errors += chunk->errors;
+		ret = chunk->ret;
+		if (ret == KNOT_EOK && errors == 0) {
+			zc->ret = insert_chunk(zc, chunk);
+			if (zc->ret != KNOT_EOK) {
+				break;
+			}
+		}
+		free(chunk->recs);
+		chunk->recs = NULL;
+
+		pthread_mutex_lock(&par.mx);
+		par.consumed++;
+		pthread_cond_broadcast(&par.cond);
+		pthread_mutex_unlock(&par.mx);
+	}
+
+	pthread_mutex_lock(&par.mx);
+	par.stop = true;
+	pthread_cond_broadcast(&par.cond);
+	pthread_mutex_unlock(&par.mx);
+
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(thread_ids[i], NULL);
+	}
+
+	scanner->error.counter += errors;
+finish:
+	pthread_cond_destroy(&par.cond);
+	pthread_mutex_destroy(&par.mx);
+	free(par.origin);
+	free_chunks(par.chunks, par.count);
+
+	return ret;
 }
 
 int zonefile_open(zloader_t *loader, const char *source,
@@ -200,13 +731,26 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	const knot_dname_t *zname = zc->z->apex->owner;
 
 	assert(zc);
-	int ret = zs_parse_all(&loader->scanner);
-	if (ret != 0 && loader->scanner.error.counter == 0) {
+	int ret = KNOT_ENOTSUP;
+	if (loader->threads > 1) {
+		ret = zonefile_parse_parallel(loader);
+	}
+	if (ret == KNOT_ENOTSUP) {
+		ret = zs_parse_all(&loader->scanner);
+		if (ret != 0 && loader->scanner.error.counter == 0) {
+			ERROR(zname, "failed to load zone, file '%s' (%s)",
+			      loader->source, zs_strerror(loader->scanner.error.code));
+			goto fail;
+		}
+	} else if (ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
-		      loader->source, zs_strerror(loader->scanner.error.code));
+		      loader->source, knot_strerror(ret));
 		goto fail;
 	}
 
+	if (zc->ret == KNOT_EOK) {
+		zc->ret = zcreator_flush(zc);
+	}
 	if (zc->ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
 		      loader->source, knot_strerror(zc->ret));
@@ -235,7 +779,7 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	}
 
 	ret = sem_checks_process(zc->z, loader->semantic_checks,
-	                         loader->err_handler, loader->time);
+	                         loader->err_handler, loader->time, loader->threads);
 
 	if (ret != KNOT_EOK) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
@@ -278,9 +822,10 @@ int zonefile_exists(const char *path, struct timespec *mtime)
 	return KNOT_EOK;
 }
 
-int zonefile_write(const char *path, zone_contents_t *zone)
+int zonefile_write_tmp(const char *path, zone_contents_t *zone, unsigned threads,
+                       char **tmp_name)
 {
-	if (path == NULL) {
+	if (path == NULL || tmp_name == NULL) {
 		return KNOT_EINVAL;
 	}
 
@@ -294,32 +839,62 @@ int zonefile_write(const char *path, zone_contents_t *zone)
 	}
 
 	FILE *file = NULL;
-	char *tmp_name = NULL;
-	ret = open_tmp_file(path, &tmp_name, &file, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	ret = open_tmp_file(path, tmp_name, &file, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	ret = zone_dump_text(zone, file, true, NULL);
-	fclose(file);
+	ret = zone_dump_text(zone, file, true, NULL, threads);
+	if (fclose(file) != 0 && ret == KNOT_EOK) {
+		ret = KNOT_EFILE;
+	}
 	if (ret != KNOT_EOK) {
-		unlink(tmp_name);
-		free(tmp_name);
-		return ret;
+		unlink(*tmp_name);
+		free(*tmp_name);
+		*tmp_name = NULL;
+	}
+
+	return ret;
+}
+
+int zonefile_write_commit(const char *path, char *tmp_name)
+{
+	if (path == NULL || tmp_name == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Make the new contents durable before it replaces the zonefile. */
+	int ret = KNOT_EOK;
+	int fd = open(tmp_name, O_RDONLY);
+	if (fd < 0 || fsync(fd) != 0) {
+		ret = knot_map_errno();
+	}
+	if (fd >= 0) {
+		close(fd);
 	}
 
 	/* Swap temporary zonefile and new zonefile. */
-	ret = rename(tmp_name, path);
-	if (ret != 0) {
+	if (ret == KNOT_EOK && rename(tmp_name, path) != 0) {
 		ret = knot_map_errno();
+	}
+	if (ret != KNOT_EOK) {
 		unlink(tmp_name);
-		free(tmp_name);
-		return ret;
 	}
 
 	free(tmp_name);
 
-	return KNOT_EOK;
+	return ret;
+}
+
+int zonefile_write(const char *path, zone_contents_t *zone, unsigned threads)
+{
+	char *tmp_name = NULL;
+	int ret = zonefile_write_tmp(path, zone, threads, &tmp_name);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return zonefile_write_commit(path, tmp_name);
 }
 
 void zonefile_close(zloader_t *loader)
@@ -330,6 +905,7 @@ void zonefile_close(zloader_t *loader)
 
 	zs_deinit(&loader->scanner);
 	free(loader->source);
+	zcreator_clear(loader->creator);
 	free(loader->creator);
 }
 
@@ -29,6 +29,10 @@ typedef struct zcreator {
 	zone_contents_t *z;  /*!< Created zone. */
 	bool master;         /*!< True if server is a primary master for the zone. */
 	int ret;             /*!< Return value. */
+
+	knot_rrset_t pending;            /*!< RRSet of the consecutive RRs not yet added. */
+	knot_dname_storage_t owner;      /*!< Owner of the pending RRSet. */
+	knot_rdataset_builder_t builder; /*!< RRs of the pending RRSet. */
 } zcreator_t;
 
 /*!
@@ -41,6 +45,7 @@ typedef struct {
 	zcreator_t *creator;         /*!< Loader context. */
 	zs_scanner_t scanner;        /*!< Zone scanner. */
 	time_t time;                 /*!< time for zone check. */
+	unsigned threads;            /*!< Zone file parsing threads (0 or 1 for sequential). */
 } zloader_t;
 
 void err_handler_logger(sem_handler_t *handler, const zone_contents_t *zone,
@@ -83,8 +88,40 @@ int zonefile_exists(const char *path, struct timespec *mtime);
 
 /*!
  * \brief Write zone contents to zone file.
+ *
+ * \param path     Zonefile path.
+ * \param zone     Zone contents.
+ * \param threads  Number of threads formatting the records (0 or 1 for sequential).
+ *
+ * \return KNOT_E*
+ */
+int zonefile_write(const char *path, zone_contents_t *zone, unsigned threads);
+
+/*!
+ * \brief Write zone contents to a temporary file next to the zone file.
+ *
+ * This is the first step of zonefile_write(). The contents is no longer
+ * needed once this function returns.
+ *
+ * \param path      Zonefile path.
+ * \param zone      Zone contents.
+ * \param threads   Number of threads formatting the records (0 or 1 for sequential).
+ * \param tmp_name  Out: name of the written temporary file.
+ *
+ * \return KNOT_E*
+ */
+int zonefile_write_tmp(const char *path, zone_contents_t *zone, unsigned threads,
+                       char **tmp_name);
+
+/*!
+ * \brief Sync the temporary file to the disk and rename it to the zone file.
+ *
+ * \param path      Zonefile path.
+ * \param tmp_name  Temporary file from zonefile_write_tmp(), freed.
+ *
+ * \return KNOT_E*
  */
-int zonefile_write(const char *path, zone_contents_t *zone);
+int zonefile_write_commit(const char *path, char *tmp_name);
 
 /*!
  * \brief Close zone file loader.
@@ -96,9 +133,28 @@ void zonefile_close(zloader_t *loader);
 /*!
  * \brief Adds one RR into zone.
  *
+ * Consecutive RRs of the same RRSet are collected and added at once,
+ * zcreator_flush() must be called after the last RR.
+ *
  * \param zl  Zone loader.
  * \param rr  RR to add.
  *
  * \return KNOT_E*
  */
 int zcreator_step(zcreator_t *zl, const knot_rrset_t *rr);
+
+/*!
+ * \brief Adds the pending RRSet into zone.
+ *
+ * \param zl  Zone loader.
+ *
+ * \return KNOT_E*
+ */
+int zcreator_flush(zcreator_t *zl);
+
+/*!
+ * \brief Drops the pending RRSet and frees the collecting space.
+ *
+ * \param zl  Zone loader.
+ */
+void zcreator_clear(zcreator_t *zl);
@@ -20,6 +20,7 @@
 #include "libdnssec/crypto.h"
 #include "libdnssec/p11/p11.h"
 #include "libdnssec/shared/shared.h"
+#include "libdnssec/sign/precomp.h"
 
 _public_
 void dnssec_crypto_init(void)
@@ -31,6 +32,7 @@ void dnssec_crypto_init(void)
 _public_
 void dnssec_crypto_cleanup(void)
 {
+	precomp_deinit();
 	gnutls_global_deinit();
 	p11_cleanup();
 }
@@ -21,6 +21,7 @@
 
 #include "libdnssec/key.h"
 #include "libdnssec/shared/dname.h"
+#include "libdnssec/sign/precomp.h"
 
 /*!
  * DNSSEC key.
@@ -32,4 +33,6 @@ struct dnssec_key {
 	gnutls_pubkey_t public_key;
 	gnutls_privkey_t private_key;
 	unsigned bits;
+
+	precomp_t *precomp;  //!< Precomputed signing nonces.
 };
@@ -82,6 +82,9 @@ static void key_free_internals(dnssec_key_t *key)
 	free(key->dname);
 	key->dname = NULL;
 
+	precomp_free(key->precomp);
+	key->precomp = NULL;
+
 	gnutls_privkey_deinit(key->private_key);
 	key->private_key = NULL;
 
@@ -106,6 +106,23 @@ int dnssec_nsec3_hash(const dnssec_binary_t *data,
 		      const dnssec_nsec3_params_t *params,
 		      dnssec_binary_t *hash);
 
+/*!
+ * Compute NSEC3 hashes for a batch of data.
+ *
+ * Several SHA-1 hashes are computed at once if supported by the CPU.
+ *
+ * \param[in]  data    Array of data to be hashed (usually domain names).
+ * \param[in]  count   Number of items in the array.
+ * \param[in]  params  NSEC3 parameters.
+ * \param[out] hashes  Buffer for the computed hashes, one after another,
+ *                     of dnssec_nsec3_hash_length() bytes each.
+ *
+ * \return Error code, DNSSEC_EOK if successful.
+ */
+int dnssec_nsec3_hash_batch(const dnssec_binary_t *data, size_t count,
+			    const dnssec_nsec3_params_t *params,
+			    uint8_t *hashes);
+
 /*!
  * Get length of raw NSEC3 hash for a given algorithm.
  *
@@ -15,6 +15,7 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/crypto.h>
 #include <string.h>
@@ -30,6 +31,33 @@
  *
  * \todo Input data should be converted to lowercase.
  */
+static int nsec3_hash_raw(gnutls_hash_hd_t digest, size_t hash_size, int iterations,
+			  const dnssec_binary_t *salt, const dnssec_binary_t *data,
+			  uint8_t *hash)
+{
+	const uint8_t *in = data->data;
+	size_t in_size = data->size;
+
+	for (int i = 0; i <= iterations; i++) {
+		int result = gnutls_hash(digest, in, in_size);
+		if (result < 0) {
+			return DNSSEC_NSEC3_HASHING_ERROR;
+		}
+
+		result = gnutls_hash(digest, salt->data, salt->size);
+		if (result < 0) {
+			return DNSSEC_NSEC3_HASHING_ERROR;
+		}
+
+		gnutls_hash_output(digest, hash);
+
+		in = hash;
+		in_size = hash_size;
+	}
+
+	return DNSSEC_EOK;
+}
+
 static int nsec3_hash(gnutls_digest_algorithm_t algorithm, int iterations,
 		      const dnssec_binary_t *salt, const dnssec_binary_t *data,
 		      dnssec_binary_t *hash)
@@ -54,28 +82,185 @@ static int nsec3_hash(gnutls_digest_algorithm_t algorithm, int iterations,
 		return DNSSEC_NSEC3_HASHING_ERROR;
 	}
 
-	const uint8_t *in = data->data;
-	size_t in_size = data->size;
+	return nsec3_hash_raw(digest, hash_size, iterations, salt, data, hash->data);
+}
 
-	for (int i = 0; i <= iterations; i++) {
-		result = gnutls_hash(digest, in, in_size);
-		if (result < 0) {
-			return DNSSEC_NSEC3_HASHING_ERROR;
+/*!
+ * Multi-buffer SHA-1 for the batched NSEC3 hashing.
+ *
+ * Eight messages are hashed at once, one in each 32-bit lane of the AVX2
+ * registers. The messages are padded in advance, the lanes with fewer blocks
+ * keep their state while the longer ones are still being processed.
+ */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define HAVE_SHA1_X8
+
+#define SHA1_LANES	8
+#define SHA1_SIZE	20
+// Up to 255 bytes of the name and 255 bytes of the salt, padded.
+#define SHA1_STRIDE	(9 * 64)
+
+typedef struct {
+	uint8_t buf[SHA1_LANES][SHA1_STRIDE];
+	uint32_t blocks[SHA1_LANES];
+} sha1_x8_t;
+
+static void sha1_x8_set(sha1_x8_t *ctx, unsigned lane, const uint8_t *msg, size_t len,
+			const dnssec_binary_t *salt)
+{
+	uint8_t *buf = ctx->buf[lane];
+	size_t total = len + salt->size;
+	size_t blocks = (total + 8) / 64 + 1;
+
+	memcpy(buf, msg, len);
+	memcpy(buf + len, salt->data, salt->size);
+	buf[total] = 0x80;
+	memset(buf + total + 1, 0, blocks * 64 - total - 1);
+	uint64_t bits = total * 8;
+	for (int i = 0; i < 8; i++) {
+		buf[blocks * 64 - 1 - i] = bits >> (8 * i);
+	}
+	ctx->blocks[lane] = blocks;
+}
+
+#define ROTL(x, n) _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - (n)))
+
+__attribute__((target("avx2")))
+static void sha1_x8(const sha1_x8_t *ctx, uint8_t out[SHA1_LANES][SHA1_SIZE])
+{
+	const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+	                                       3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	const __m256i offsets = _mm256_setr_epi32(0, SHA1_STRIDE, 2 * SHA1_STRIDE, 3 * SHA1_STRIDE,
+	                                          4 * SHA1_STRIDE, 5 * SHA1_STRIDE,
+	                                          6 * SHA1_STRIDE, 7 * SHA1_STRIDE);
+	const __m256i blocks = _mm256_loadu_si256((const __m256i *)ctx->blocks);
+
+	__m256i h[5] = {
+		_mm256_set1_epi32(0x67452301), _mm256_set1_epi32(0xEFCDAB89),
+		_mm256_set1_epi32(0x98BADCFE), _mm256_set1_epi32(0x10325476),
+		_mm256_set1_epi32(0xC3D2E1F0)
+	};
+
+	uint32_t max_blocks = 0;
+	for (int i = 0; i < SHA1_LANES; i++) {
+		max_blocks = ctx->blocks[i] > max_blocks ? ctx->blocks[i] : max_blocks;
+	}
+
+	for (uint32_t blk = 0; blk < max_blocks; blk++) {
+		__m256i w[16];
+		for (int t = 0; t < 16; t++) {
+			__m256i idx = _mm256_add_epi32(offsets, _mm256_set1_epi32(blk * 64 + t * 4));
+			w[t] = _mm256_shuffle_epi8(_mm256_i32gather_epi32((const int *)ctx->buf, idx, 1),
+			                           bswap);
 		}
 
-		result = gnutls_hash(digest, salt->data, salt->size);
-		if (result < 0) {
-			return DNSSEC_NSEC3_HASHING_ERROR;
+		__m256i a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for (int t = 0; t < 80; t++) {
+			if (t >= 16) {
+				__m256i x = _mm256_xor_si256(_mm256_xor_si256(w[(t - 3) & 15], w[(t - 8) & 15]),
+				                             _mm256_xor_si256(w[(t - 14) & 15], w[t & 15]));
+				w[t & 15] = ROTL(x, 1);
+			}
+			__m256i f, k;
+			if (t < 20) {
+				f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_andnot_si256(b, d));
+				k = _mm256_set1_epi32(0x5A827999);
+			} else if (t < 40) {
+				f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+				k = _mm256_set1_epi32(0x6ED9EBA1);
+			} else if (t < 60) {
+				f = _mm256_or_si256(_mm256_and_si256(b, c),
+				                    _mm256_and_si256(d, _mm256_or_si256(b, c)));
+				k = _mm256_set1_epi32(0x8F1BBCDC);
+			} else {
+				f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+				k = _mm256_set1_epi32(0xCA62C1D6);
+			}
+			__m256i tmp = _mm256_add_epi32(_mm256_add_epi32(ROTL(a, 5), f),
+			                               _mm256_add_epi32(_mm256_add_epi32(e, k), w[t & 15]));
+			e = d;
+			d = c;
+			c = ROTL(b, 30);
+			b = a;
+			a = tmp;
+		}
+
+		// Only the lanes with a message block left are updated.
+		__m256i active = _mm256_cmpgt_epi32(blocks, _mm256_set1_epi32(blk));
+		h[0] = _mm256_add_epi32(h[0], _mm256_and_si256(a, active));
+		h[1] = _mm256_add_epi32(h[1], _mm256_and_si256(b, active));
+		h[2] = _mm256_add_epi32(h[2], _mm256_and_si256(c, active));
+		h[3] = _mm256_add_epi32(h[3], _mm256_and_si256(d, active));
+		h[4] = _mm256_add_epi32(h[4], _mm256_and_si256(e, active));
+	}
+
+	for (int i = 0; i < 5; i++) {
+		uint8_t words[SHA1_LANES * 4];
+		_mm256_storeu_si256((__m256i *)words, _mm256_shuffle_epi8(h[i], bswap));
+		for (int lane = 0; lane < SHA1_LANES; lane++) {
+			memcpy(out[lane] + i * 4, words + lane * 4, 4);
 		}
+	}
+}
 
-		gnutls_hash_output(digest, hash->data);
+/*!
+ * Compute NSEC3 SHA-1 hashes of up to eight names at once.
+ *
+ * \return False if some name or the salt is too long to be hashed here.
+ */
+static bool nsec3_hash_x8(sha1_x8_t *ctx, int iterations, const dnssec_binary_t *salt,
+			  const dnssec_binary_t *data, size_t count, uint8_t *hashes)
+{
+	uint8_t out[SHA1_LANES][SHA1_SIZE];
 
-		in = hash->data;
-		in_size = hash->size;
+	if (salt->size > 255) {
+		return false;
+	}
+	for (unsigned lane = 0; lane < count; lane++) {
+		if (data[lane].size > 255) {
+			return false;
+		}
 	}
 
-	return DNSSEC_EOK;
+	memset(ctx->blocks, 0, sizeof(ctx->blocks));
+	for (unsigned lane = 0; lane < count; lane++) {
+		sha1_x8_set(ctx, lane, data[lane].data, data[lane].size, salt);
+	}
+	sha1_x8(ctx, out);
+
+	// The further iterations hash messages of the same length.
+	for (int i = 0; i < iterations; i++) {
+		for (unsigned lane = 0; lane < count; lane++) {
+			if (i == 0) {
+				sha1_x8_set(ctx, lane, out[lane], SHA1_SIZE, salt);
+			} else {
+				memcpy(ctx->buf[lane], out[lane], SHA1_SIZE);
+			}
+		}
+		sha1_x8(ctx, out);
+	}
+
+	for (unsigned lane = 0; lane < count; lane++) {
+		memcpy(hashes + lane * SHA1_SIZE, out[lane], SHA1_SIZE);
+	}
+
+	return true;
+}
+
+static bool sha1_x8_supported(void)
+{
+	static int supported = -1;
+	int cached = __atomic_load_n(&supported, __ATOMIC_RELAXED);
+	if (cached < 0) {
+		__builtin_cpu_init();
+		cached = __builtin_cpu_supports("avx2") ? 1 : 0;
+		__atomic_store_n(&supported, cached, __ATOMIC_RELAXED);
+	}
+	return cached;
 }
+#endif
 
 /*!
  * Get GnuTLS digest algorithm from DNSSEC algorithm number.
@@ -110,6 +295,65 @@ int dnssec_nsec3_hash(const dnssec_binary_t *data,
 	return nsec3_hash(algorithm, params->iterations, &params->salt, data, hash);
 }
 
+/*!
+ * Compute NSEC3 hashes for a batch of data.
+ */
+_public_
+int dnssec_nsec3_hash_batch(const dnssec_binary_t *data, size_t count,
+			    const dnssec_nsec3_params_t *params,
+			    uint8_t *hashes)
+{
+	if (!data || !params || !hashes) {
+		return DNSSEC_EINVAL;
+	}
+
+	gnutls_digest_algorithm_t algorithm = algorithm_d2g(params->algorithm);
+	if (algorithm == GNUTLS_DIG_UNKNOWN) {
+		return DNSSEC_INVALID_NSEC3_ALGORITHM;
+	}
+
+	size_t hash_size = gnutls_hash_get_len(algorithm);
+	size_t done = 0;
+
+#ifdef HAVE_SHA1_X8
+	if (algorithm == GNUTLS_DIG_SHA1 && count >= SHA1_LANES / 2 && sha1_x8_supported()) {
+		sha1_x8_t *ctx = calloc(1, sizeof(*ctx));
+		if (ctx == NULL) {
+			return DNSSEC_ENOMEM;
+		}
+		while (done < count) {
+			size_t lanes = count - done < SHA1_LANES ? count - done : SHA1_LANES;
+			if (!nsec3_hash_x8(ctx, params->iterations, &params->salt,
+					   data + done, lanes, hashes + done * hash_size)) {
+				break;
+			}
+			done += lanes;
+		}
+		free(ctx);
+	}
+#endif
+
+	if (done == count) {
+		return DNSSEC_EOK;
+	}
+
+	_cleanup_hash_ gnutls_hash_hd_t digest = NULL;
+	if (gnutls_hash_init(&digest, algorithm) < 0) {
+		return DNSSEC_NSEC3_HASHING_ERROR;
+	}
+
+	for (; done < count; done++) {
+		int result = nsec3_hash_raw(digest, hash_size, params->iterations,
+					    &params->salt, data + done,
+					    hashes + done * hash_size);
+		if (result != DNSSEC_EOK) {
+			return result;
+		}
+	}
+
+	return DNSSEC_EOK;
+}
+
 /*!
  * Get length of raw NSEC3 hash for a given algorithm.
  */
@@ -88,6 +88,41 @@ void p11_cleanup(void)
 	gnutls_pkcs11_deinit();
 }
 
+int p11_privkey_session(gnutls_privkey_t key, gnutls_privkey_t *session_ptr)
+{
+	if (gnutls_privkey_get_type(key) != GNUTLS_PRIVKEY_PKCS11) {
+		return DNSSEC_EINVAL;
+	}
+
+	gnutls_pkcs11_privkey_t p11_key = NULL;
+	int r = gnutls_privkey_export_pkcs11(key, &p11_key);
+	if (r != GNUTLS_E_SUCCESS) {
+		return DNSSEC_ERROR;
+	}
+
+	char *url = NULL;
+	r = gnutls_pkcs11_privkey_export_url(p11_key, GNUTLS_PKCS11_URL_GENERIC, &url);
+	gnutls_pkcs11_privkey_deinit(p11_key);
+	if (r != GNUTLS_E_SUCCESS) {
+		return DNSSEC_ERROR;
+	}
+
+	gnutls_privkey_t session = NULL;
+	r = gnutls_privkey_init(&session);
+	if (r == GNUTLS_E_SUCCESS) {
+		r = gnutls_privkey_import_pkcs11_url(session, url);
+	}
+	gnutls_free(url);
+	if (r != GNUTLS_E_SUCCESS) {
+		gnutls_privkey_deinit(session);
+		return DNSSEC_NOT_FOUND;
+	}
+
+	*session_ptr = session;
+
+	return DNSSEC_EOK;
+}
+
 #else
 
 int p11_init(void)
@@ -110,4 +145,9 @@ void p11_cleanup(void)
 	// this function intentionally left blank
 }
 
+int p11_privkey_session(gnutls_privkey_t key, gnutls_privkey_t *session_ptr)
+{
+	return DNSSEC_NOT_IMPLEMENTED_ERROR;
+}
+
 #endif
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <gnutls/abstract.h>
+
 /*!
  * Initialize PKCS11 global context.
  */
@@ -39,3 +41,16 @@ int p11_load_module(const char *name);
  * Should be called when the library is deinitialized to prevent memory leaks.
  */
 void p11_cleanup(void);
+
+/*!
+ * Open a separate PKCS11 session for a private key stored in a token.
+ *
+ * The new private key refers to the same token object, but requests signed
+ * with it don't have to wait for requests in the session of the original key.
+ *
+ * \param key          Private key stored in a token.
+ * \param session_ptr  Output: new private key with its own session.
+ *
+ * \return Error code, DNSSEC_EOK if successful.
+ */
+int p11_privkey_session(gnutls_privkey_t key, gnutls_privkey_t *session_ptr);
@@ -96,6 +96,37 @@ int dnssec_sign_add(dnssec_sign_ctx_t *ctx, const dnssec_binary_t *data);
 int dnssec_sign_write(dnssec_sign_ctx_t *ctx, dnssec_sign_flags_t flags,
                       dnssec_binary_t *signature);
 
+/*!
+ * Write down the DNSSEC signatures of several contexts at once.
+ *
+ * Used for signing the same data with multiple keys, the contexts are
+ * expected to be filled with the same data.
+ *
+ * \param ctxs        Signing contexts.
+ * \param count       Number of the contexts.
+ * \param flags       Additional flags to be used for signing.
+ * \param signatures  Array of 'count' signatures to be allocated and written.
+ *
+ * \return Error code, DNSSEC_EOK if successful (all or nothing).
+ */
+int dnssec_sign_write_batch(dnssec_sign_ctx_t **ctxs, size_t count,
+                            dnssec_sign_flags_t flags,
+                            dnssec_binary_t *signatures);
+
+/*!
+ * Enable precomputation of the signing nonces of the key.
+ *
+ * A background thread keeps up to 'count' nonces prepared, so that the
+ * non-reproducible signing with the key is faster. Supported only for
+ * ECDSA keys not stored in PKCS #11.
+ *
+ * \param key    Signing key.
+ * \param count  Number of the nonces to keep ready, 0 to disable.
+ *
+ * \return Error code, DNSSEC_NOT_IMPLEMENTED_ERROR if not supported.
+ */
+int dnssec_sign_precompute(dnssec_key_t *key, unsigned count);
+
 /*!
  * Verify DNSSEC signature.
  *
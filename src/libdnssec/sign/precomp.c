@@ -0,0 +1,398 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contrib/string.h"
+#include "libdnssec/error.h"
+#include "libdnssec/key.h"
+#include "libdnssec/sign/precomp.h"
+
+#ifdef HAVE_ECDSA_PRECOMP
+
+#include <sched.h>
+#include <gmp.h>
+#include <gnutls/crypto.h>
+#include <nettle/ecc.h>
+#include <nettle/ecc-curve.h>
+
+#define MAX_INT_SIZE 48
+
+typedef struct {
+	mpz_t kinv;
+	mpz_t r;
+} pair_t;
+
+struct precomp {
+	precomp_t *next;
+	const struct ecc_curve *curve;
+	gnutls_digest_algorithm_t digest;
+	size_t int_size;
+	mpz_t q;
+	mpz_t d;
+
+	pthread_mutex_t mx;
+	unsigned size;
+	unsigned count;   // Ready pairs.
+	pair_t *pairs;
+
+	bool busy;        // Being refilled by the background thread.
+};
+
+static struct {
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	pthread_t thread;
+	bool running;
+	bool terminate;
+	precomp_t *pools;
+} bg = {
+	.mx = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+// Group orders of the curves.
+static const char *P256_ORDER =
+	"FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551";
+static const char *P384_ORDER =
+	"FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF"
+	"C7634D81F4372DDF581A0DB248B0A77AECEC196ACCC52973";
+
+static void mpz_wipe(mpz_t z)
+{
+	size_t size = mpz_size(z);
+	if (size > 0) {
+		mp_limb_t *limbs = mpz_limbs_modify(z, size);
+		memset(limbs, 0, size * sizeof(*limbs));
+	}
+	mpz_clear(z);
+}
+
+static void random_cb(void *ctx, size_t len, uint8_t *dst)
+{
+	(void)ctx;
+	if (gnutls_rnd(GNUTLS_RND_KEY, dst, len) != 0) {
+		abort(); // A predictable nonce would reveal the key.
+	}
+}
+
+static void write_int(uint8_t *dst, size_t size, const mpz_t z)
+{
+	size_t len = (mpz_sizeinbase(z, 2) + 7) / 8;
+	assert(len <= size);
+	memset(dst, 0, size);
+	mpz_export(dst + size - len, NULL, 1, 1, 1, 0, z);
+}
+
+static bool compute_pair(precomp_t *pc, mpz_t kinv, mpz_t r)
+{
+	struct ecc_scalar k;
+	struct ecc_point p;
+	ecc_scalar_init(&k, pc->curve);
+	ecc_point_init(&p, pc->curve);
+
+	mpz_t kz;
+	mpz_init(kz);
+
+	ecc_scalar_random(&k, NULL, random_cb);
+	ecc_point_mul_g(&p, &k);
+	ecc_point_get(&p, r, NULL);
+	mpz_mod(r, r, pc->q);
+
+	// Modular inversion by Fermat's little theorem in constant time.
+	ecc_scalar_get(&k, kz);
+	mpz_sub_ui(kinv, pc->q, 2);
+	mpz_powm_sec(kinv, kz, kinv, pc->q);
+
+	mpz_wipe(kz);
+	ecc_point_clear(&p);
+	ecc_scalar_clear(&k);
+
+	return mpz_sgn(r) != 0;
+}
+
+static precomp_t *pick_pool(void)
+{
+	precomp_t *best = NULL;
+	for (precomp_t *pc = bg.pools; pc != NULL; pc = pc->next) {
+		unsigned count = __atomic_load_n(&pc->count, __ATOMIC_RELAXED);
+		if (count < pc->size && (best == NULL || count < best->count)) {
+			best = pc;
+		}
+	}
+	return best;
+}
+
+static void *precomp_thread(void *arg)
+{
+	(void)arg;
+
+#ifdef SCHED_IDLE
+	struct sched_param param = { 0 };
+	(void)pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+	mpz_t kinv, r;
+	mpz_init(kinv);
+	mpz_init(r);
+
+	pthread_mutex_lock(&bg.mx);
+	while (!bg.terminate) {
+		precomp_t *pc = pick_pool();
+		if (pc == NULL) {
+			pthread_cond_wait(&bg.cond, &bg.mx);
+			continue;
+		}
+		pc->busy = true;
+		pthread_mutex_unlock(&bg.mx);
+
+		if (compute_pair(pc, kinv, r)) {
+			pthread_mutex_lock(&pc->mx);
+			if (pc->count < pc->size) {
+				pair_t *pair = &pc->pairs[pc->count];
+				mpz_swap(pair->kinv, kinv);
+				mpz_swap(pair->r, r);
+				__atomic_store_n(&pc->count, pc->count + 1, __ATOMIC_RELAXED);
+			}
+			pthread_mutex_unlock(&pc->mx);
+		}
+
+		pthread_mutex_lock(&bg.mx);
+		pc->busy = false;
+		pthread_cond_broadcast(&bg.cond);
+	}
+	pthread_mutex_unlock(&bg.mx);
+
+	mpz_wipe(kinv);
+	mpz_wipe(r);
+
+	return NULL;
+}
+
+static void pool_free(precomp_t *pc)
+{
+	for (unsigned i = 0; i < pc->size; i++) {
+		mpz_wipe(pc->pairs[i].kinv);
+		mpz_wipe(pc->pairs[i].r);
+	}
+	free(pc->pairs);
+	mpz_wipe(pc->d);
+	mpz_clear(pc->q);
+	pthread_mutex_destroy(&pc->mx);
+	free(pc);
+}
+
+static int set_curve(precomp_t *pc, uint8_t algorithm)
+{
+	switch ((dnssec_key_algorithm_t)algorithm) {
+	case DNSSEC_KEY_ALGORITHM_ECDSA_P256_SHA256:
+		pc->curve = nettle_get_secp_256r1();
+		pc->digest = GNUTLS_DIG_SHA256;
+		pc->int_size = 32;
+		return mpz_set_str(pc->q, P256_ORDER, 16);
+	case DNSSEC_KEY_ALGORITHM_ECDSA_P384_SHA384:
+		pc->curve = nettle_get_secp_384r1();
+		pc->digest = GNUTLS_DIG_SHA384;
+		pc->int_size = 48;
+		return mpz_set_str(pc->q, P384_ORDER, 16);
+	default:
+		return -1;
+	}
+}
+
+int precomp_new(precomp_t **out, gnutls_privkey_t key, uint8_t algorithm,
+                unsigned size)
+{
+	if (out == NULL || key == NULL || size == 0) {
+		return DNSSEC_EINVAL;
+	}
+
+	// Only software keys can be exported.
+	gnutls_ecc_curve_t curve;
+	gnutls_datum_t x = { 0 }, y = { 0 }, k = { 0 };
+	if (gnutls_privkey_export_ecc_raw(key, &curve, &x, &y, &k) != 0) {
+		return DNSSEC_NOT_IMPLEMENTED_ERROR;
+	}
+	gnutls_free(x.data);
+	gnutls_free(y.data);
+
+	precomp_t *pc = calloc(1, sizeof(*pc));
+	pair_t *pairs = calloc(size, sizeof(*pairs));
+	if (pc == NULL || pairs == NULL) {
+		memzero(k.data, k.size);
+		gnutls_free(k.data);
+		free(pc);
+		free(pairs);
+		return DNSSEC_ENOMEM;
+	}
+	pc->pairs = pairs;
+	pc->size = size;
+	pthread_mutex_init(&pc->mx, NULL);
+	mpz_init(pc->q);
+	mpz_init(pc->d);
+	for (unsigned i = 0; i < size; i++) {
+		mpz_init(pairs[i].kinv);
+		mpz_init(pairs[i].r);
+	}
+
+	mpz_import(pc->d, k.size, 1, 1, 1, 0, k.data);
+	memzero(k.data, k.size);
+	gnutls_free(k.data);
+
+	if (set_curve(pc, algorithm) != 0) {
+		pool_free(pc);
+		return DNSSEC_INVALID_KEY_ALGORITHM;
+	}
+
+	pthread_mutex_lock(&bg.mx);
+	if (!bg.running) {
+		bg.terminate = false;
+		if (pthread_create(&bg.thread, NULL, precomp_thread, NULL) != 0) {
+			pthread_mutex_unlock(&bg.mx);
+			pool_free(pc);
+			return DNSSEC_ERROR;
+		}
+		bg.running = true;
+	}
+	pc->next = bg.pools;
+	bg.pools = pc;
+	pthread_cond_broadcast(&bg.cond);
+	pthread_mutex_unlock(&bg.mx);
+
+	*out = pc;
+	return DNSSEC_EOK;
+}
+
+void precomp_free(precomp_t *pc)
+{
+	if (pc == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&bg.mx);
+	while (pc->busy) {
+		pthread_cond_wait(&bg.cond, &bg.mx);
+	}
+	precomp_t **it = &bg.pools;
+	while (*it != pc) {
+		it = &(*it)->next;
+	}
+	*it = pc->next;
+	pthread_mutex_unlock(&bg.mx);
+
+	pool_free(pc);
+}
+
+int precomp_sign(precomp_t *pc, const dnssec_binary_t *data,
+                 dnssec_binary_t *signature)
+{
+	assert(pc && data && signature);
+
+	uint8_t hash[MAX_INT_SIZE];
+	if (gnutls_hash_fast(pc->digest, data->data, data->size, hash) != 0) {
+		return DNSSEC_SIGN_ERROR;
+	}
+
+	pthread_mutex_lock(&pc->mx);
+	if (pc->count == 0) {
+		pthread_mutex_unlock(&pc->mx);
+		return DNSSEC_NOT_FOUND;
+	}
+	unsigned count = pc->count - 1;
+	__atomic_store_n(&pc->count, count, __ATOMIC_RELAXED);
+	pair_t pair;
+	mpz_init(pair.kinv);
+	mpz_init(pair.r);
+	mpz_swap(pair.kinv, pc->pairs[count].kinv);
+	mpz_swap(pair.r, pc->pairs[count].r);
+	pthread_mutex_unlock(&pc->mx);
+
+	// Wake up the background thread once the pool is half empty.
+	if (count == pc->size / 2) {
+		pthread_mutex_lock(&bg.mx);
+		pthread_cond_signal(&bg.cond);
+		pthread_mutex_unlock(&bg.mx);
+	}
+
+	// s = k^-1 * (e + r * d) mod q
+	mpz_t s;
+	mpz_init(s);
+	mpz_import(s, pc->int_size, 1, 1, 1, 0, hash);
+	mpz_addmul(s, pair.r, pc->d);
+	mpz_mul(s, s, pair.kinv);
+	mpz_mod(s, s, pc->q);
+
+	int ret = DNSSEC_SIGN_ERROR;
+	if (mpz_sgn(s) != 0) {
+		ret = dnssec_binary_alloc(signature, 2 * pc->int_size);
+	}
+	if (ret == DNSSEC_EOK) {
+		write_int(signature->data, pc->int_size, pair.r);
+		write_int(signature->data + pc->int_size, pc->int_size, s);
+	}
+
+	mpz_wipe(s);
+	mpz_wipe(pair.kinv);
+	mpz_wipe(pair.r);
+
+	return ret;
+}
+
+void precomp_deinit(void)
+{
+	pthread_mutex_lock(&bg.mx);
+	if (!bg.running) {
+		pthread_mutex_unlock(&bg.mx);
+		return;
+	}
+	bg.terminate = true;
+	pthread_cond_broadcast(&bg.cond);
+	pthread_mutex_unlock(&bg.mx);
+
+	pthread_join(bg.thread, NULL);
+
+	pthread_mutex_lock(&bg.mx);
+	bg.running = false;
+	pthread_mutex_unlock(&bg.mx);
+}
+
+#else // HAVE_ECDSA_PRECOMP
+
+int precomp_new(precomp_t **out, gnutls_privkey_t key, uint8_t algorithm,
+                unsigned size)
+{
+	return DNSSEC_NOT_IMPLEMENTED_ERROR;
+}
+
+void precomp_free(precomp_t *pc)
+{
+}
+
+int precomp_sign(precomp_t *pc, const dnssec_binary_t *data,
+                 dnssec_binary_t *signature)
+{
+	return DNSSEC_NOT_FOUND;
+}
+
+void precomp_deinit(void)
+{
+}
+
+#endif // HAVE_ECDSA_PRECOMP
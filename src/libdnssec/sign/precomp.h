@@ -0,0 +1,69 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gnutls/abstract.h>
+#include <stdint.h>
+
+#include "libdnssec/binary.h"
+
+/*
+ * Precomputation of ECDSA signing nonces.
+ *
+ * Most of the ECDSA signing cost is the scalar multiplication k * G, which
+ * doesn't depend on the signed data. A background thread running with the
+ * idle scheduling priority keeps a pool of pairs (k^-1 mod q, r) for each
+ * registered key, so the signing itself takes just a few modular operations.
+ * Each pair is used only once.
+ */
+
+typedef struct precomp precomp_t;
+
+/*!
+ * Register a key for precomputation.
+ *
+ * \param[out] out        Precomputation pool of the key.
+ * \param[in]  key        Software ECDSA private key.
+ * \param[in]  algorithm  DNSSEC algorithm of the key.
+ * \param[in]  size       Number of the pairs to keep ready.
+ *
+ * \return Error code, DNSSEC_EOK if successful.
+ */
+int precomp_new(precomp_t **out, gnutls_privkey_t key, uint8_t algorithm,
+                unsigned size);
+
+/*!
+ * Unregister the key and free the pool (NULL is ignored).
+ */
+void precomp_free(precomp_t *pc);
+
+/*!
+ * Sign the data with a precomputed pair.
+ *
+ * \param[in]  pc         Precomputation pool.
+ * \param[in]  data       Data to be signed.
+ * \param[out] signature  Allocated signature in DNSSEC format.
+ *
+ * \return Error code, DNSSEC_NOT_FOUND if no pair is ready.
+ */
+int precomp_sign(precomp_t *pc, const dnssec_binary_t *data,
+                 dnssec_binary_t *signature);
+
+/*!
+ * Stop the background thread, the pools stay valid.
+ */
+void precomp_deinit(void);
@@ -26,9 +26,11 @@
 #include "libdnssec/error.h"
 #include "libdnssec/key.h"
 #include "libdnssec/key/internal.h"
+#include "libdnssec/p11/p11.h"
 #include "libdnssec/shared/shared.h"
 #include "libdnssec/sign.h"
 #include "libdnssec/sign/der.h"
+#include "libdnssec/sign/precomp.h"
 #include "libdnssec/shared/binary_wire.h"
 
 /*!
@@ -70,6 +72,8 @@ struct dnssec_sign_ctx {
 
 	gnutls_sign_algorithm_t sign_algorithm;   //!< Used algorithm for signing.
 	struct vpool buffer;                      //!< Buffer for the data to be signed.
+
+	gnutls_privkey_t session_key;             //!< Key with own PKCS #11 session.
 };
 
 /* -- signature format conversions ----------------------------------------- */
@@ -257,6 +261,17 @@ static gnutls_sign_algorithm_t algo_dnssec2gnutls(dnssec_key_algorithm_t algorit
 	}
 }
 
+static int sign_data(dnssec_sign_ctx_t *ctx, gnutls_privkey_t key, unsigned flags,
+		     const gnutls_datum_t *data, gnutls_datum_t *signature)
+{
+#ifdef HAVE_SIGN_DATA2
+	return gnutls_privkey_sign_data2(key, ctx->sign_algorithm, flags, data, signature);
+#else
+	gnutls_digest_algorithm_t digest_algorithm = get_digest_algorithm(ctx->key);
+	return gnutls_privkey_sign_data(key, digest_algorithm, flags, data, signature);
+#endif
+}
+
 /* -- public API ---------------------------------------------------------- */
 
 _public_
@@ -291,6 +306,15 @@ int dnssec_sign_new(dnssec_sign_ctx_t **ctx_ptr, const dnssec_key_t *key)
 		return result;
 	}
 
+	/*
+	 * Signing contexts used in parallel don't share one PKCS #11 session.
+	 * The shared key is used if no more sessions can be opened.
+	 */
+	if (key->private_key != NULL &&
+	    gnutls_privkey_get_type(key->private_key) == GNUTLS_PRIVKEY_PKCS11) {
+		(void)p11_privkey_session(key->private_key, &ctx->session_key);
+	}
+
 	*ctx_ptr = ctx;
 
 	return DNSSEC_EOK;
@@ -304,6 +328,7 @@ void dnssec_sign_free(dnssec_sign_ctx_t *ctx)
 	}
 
 	vpool_reset(&ctx->buffer);
+	gnutls_privkey_deinit(ctx->session_key);
 
 	free(ctx);
 }
@@ -362,18 +387,25 @@ int dnssec_sign_write(dnssec_sign_ctx_t *ctx, dnssec_sign_flags_t flags, dnssec_
 	}
 #endif
 
+	if (ctx->key->precomp != NULL && !(flags & DNSSEC_SIGN_REPRODUCIBLE)) {
+		dnssec_binary_t bin_data = binary_from_datum(&data);
+		int ret = precomp_sign(ctx->key->precomp, &bin_data, signature);
+		if (ret != DNSSEC_NOT_FOUND) {
+			return ret;
+		}
+		// No nonce ready, sign the usual way.
+	}
+
 	assert(ctx->key->private_key);
 	_cleanup_datum_ gnutls_datum_t raw = { 0 };
-#ifdef HAVE_SIGN_DATA2
-	int result = gnutls_privkey_sign_data2(ctx->key->private_key,
-					       ctx->sign_algorithm,
-					       gnutls_flags, &data, &raw);
-#else
-	gnutls_digest_algorithm_t digest_algorithm = get_digest_algorithm(ctx->key);
-	int result = gnutls_privkey_sign_data(ctx->key->private_key,
-					      digest_algorithm,
-					      gnutls_flags, &data, &raw);
-#endif
+	int result = sign_data(ctx, ctx->session_key != NULL ? ctx->session_key :
+	                       ctx->key->private_key, gnutls_flags, &data, &raw);
+	if (result < 0 && ctx->session_key != NULL) {
+		// Fall back to the shared session, e.g. if this one was closed.
+		gnutls_privkey_deinit(ctx->session_key);
+		ctx->session_key = NULL;
+		result = sign_data(ctx, ctx->key->private_key, gnutls_flags, &data, &raw);
+	}
 	if (result < 0) {
 		return DNSSEC_SIGN_ERROR;
 	}
@@ -383,6 +415,52 @@ int dnssec_sign_write(dnssec_sign_ctx_t *ctx, dnssec_sign_flags_t flags, dnssec_
 	return ctx->functions->x509_to_dnssec(ctx, &bin_raw, signature);
 }
 
+_public_
+int dnssec_sign_write_batch(dnssec_sign_ctx_t **ctxs, size_t count,
+                            dnssec_sign_flags_t flags,
+                            dnssec_binary_t *signatures)
+{
+	if (!ctxs || !signatures) {
+		return DNSSEC_EINVAL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		int ret = dnssec_sign_write(ctxs[i], flags, &signatures[i]);
+		if (ret != DNSSEC_EOK) {
+			for (size_t j = 0; j < i; j++) {
+				dnssec_binary_free(&signatures[j]);
+			}
+			return ret;
+		}
+	}
+
+	return DNSSEC_EOK;
+}
+
+_public_
+int dnssec_sign_precompute(dnssec_key_t *key, unsigned count)
+{
+	if (!key) {
+		return DNSSEC_EINVAL;
+	}
+
+	precomp_free(key->precomp);
+	key->precomp = NULL;
+
+	if (count == 0) {
+		return DNSSEC_EOK;
+	}
+	if (!dnssec_key_can_sign(key)) {
+		return DNSSEC_NO_PRIVATE_KEY;
+	}
+	if (gnutls_privkey_get_type(key->private_key) == GNUTLS_PRIVKEY_PKCS11) {
+		return DNSSEC_NOT_IMPLEMENTED_ERROR;
+	}
+
+	return precomp_new(&key->precomp, key->private_key,
+	                   dnssec_key_get_algorithm(key), count);
+}
+
 _public_
 int dnssec_sign_verify(dnssec_sign_ctx_t *ctx, bool sign_cmp, const dnssec_binary_t *signature)
 {
@@ -45,6 +45,9 @@
 /*! The first data item code. */
 #define DATA_CODE_OFFSET	16
 
+/*! The binary data item code. */
+#define WIRE_CODE		(DATA_CODE_OFFSET - 1)
+
 /*! Control context structure. */
 struct knot_ctl {
 	/*! Memory pool context. */
@@ -58,6 +61,10 @@ struct knot_ctl {
 
 	/*! The latter read data. */
 	knot_ctl_data_t data;
+	/*! The latter read binary data item. */
+	const uint8_t *wire;
+	/*! Length of the latter read binary data item. */
+	uint16_t wire_len;
 
 	/*! Write wire context. */
 	wire_ctx_t wire_out;
@@ -132,6 +139,8 @@ static void clean_data(knot_ctl_t *ctx)
 {
 	mp_flush(ctx->mm.ctx);
 	memzero(ctx->data, sizeof(ctx->data));
+	ctx->wire = NULL;
+	ctx->wire_len = 0;
 }
 
 static void close_sock(int *sock)
@@ -268,6 +277,25 @@ int knot_ctl_accept(knot_ctl_t *ctx)
 	return KNOT_EOK;
 }
 
+_public_
+knot_ctl_t* knot_ctl_clone(knot_ctl_t *ctx)
+{
+	if (ctx == NULL || ctx->sock < 0) {
+		return NULL;
+	}
+
+	knot_ctl_t *res = knot_ctl_alloc();
+	if (res == NULL) {
+		return NULL;
+	}
+
+	res->timeout = ctx->timeout;
+	res->sock = ctx->sock;
+	ctx->sock = -1;
+
+	return res;
+}
+
 _public_
 int knot_ctl_connect(knot_ctl_t *ctx, const char *path)
 {
@@ -325,7 +353,8 @@ static int ensure_output(knot_ctl_t *ctx, uint16_t len)
 	return KNOT_EOK;
 }
 
-static int send_item(knot_ctl_t *ctx, uint8_t code, const char *data, bool flush)
+static int send_item(knot_ctl_t *ctx, uint8_t code, const uint8_t *data,
+                     size_t data_len, bool flush)
 {
 	wire_ctx_t *w = &ctx->wire_out;
 
@@ -341,8 +370,6 @@ static int send_item(knot_ctl_t *ctx, uint8_t code, const char *data, bool flush
 
 	// Control block data is optional.
 	if (data != NULL) {
-		// Get the data length.
-		size_t data_len = strlen(data);
 		if (data_len > UINT16_MAX) {
 			return KNOT_ERANGE;
 		}
@@ -362,7 +389,7 @@ static int send_item(knot_ctl_t *ctx, uint8_t code, const char *data, bool flush
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
-		wire_ctx_write(w, (uint8_t *)data, data_len);
+		wire_ctx_write(w, data, data_len);
 		if (w->error != KNOT_EOK) {
 			return w->error;
 		}
@@ -385,7 +412,14 @@ static int send_item(knot_ctl_t *ctx, uint8_t code, const char *data, bool flush
 _public_
 int knot_ctl_send(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data)
 {
-	if (ctx == NULL) {
+	return knot_ctl_send_wire(ctx, type, data, NULL, 0);
+}
+
+_public_
+int knot_ctl_send_wire(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data,
+                       const uint8_t *wire, uint16_t wire_len)
+{
+	if (ctx == NULL || (wire != NULL && !is_data_type(type))) {
 		return KNOT_EINVAL;
 	}
 
@@ -396,7 +430,7 @@ int knot_ctl_send(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data)
 	}
 
 	// Send unit type.
-	int ret = send_item(ctx, code, NULL, !is_data_type(type));
+	int ret = send_item(ctx, code, NULL, 0, !is_data_type(type));
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -410,13 +444,22 @@ int knot_ctl_send(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data)
 				continue;
 			}
 
-			ret = send_item(ctx, idx_to_code(i), value, false);
+			ret = send_item(ctx, idx_to_code(i), (const uint8_t *)value,
+			                strlen(value), false);
 			if (ret != KNOT_EOK) {
 				return ret;
 			}
 		}
 	}
 
+	// Send the binary data item.
+	if (wire != NULL) {
+		ret = send_item(ctx, WIRE_CODE, wire, wire_len, false);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
 	return KNOT_EOK;
 }
 
@@ -467,7 +510,7 @@ static int receive_item_code(knot_ctl_t *ctx, uint8_t *code)
 	return KNOT_EOK;
 }
 
-static int receive_item_value(knot_ctl_t *ctx, char **value)
+static int receive_item_value(knot_ctl_t *ctx, char **value, uint16_t *value_len)
 {
 	wire_ctx_t *w = &ctx->wire_in;
 
@@ -496,6 +539,10 @@ static int receive_item_value(knot_ctl_t *ctx, char **value)
 	}
 	(*value)[data_len] = '\0';
 
+	if (value_len != NULL) {
+		*value_len = data_len;
+	}
+
 	return KNOT_EOK;
 }
 
@@ -542,6 +589,15 @@ int knot_ctl_receive(knot_ctl_t *ctx, knot_ctl_type_t *type, knot_ctl_data_t *da
 			}
 		}
 
+		// Check for binary data item code.
+		if (code == WIRE_CODE) {
+			ret = receive_item_value(ctx, (char **)&ctx->wire, &ctx->wire_len);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+			continue;
+		}
+
 		// Check for data item code.
 		int idx = code_to_idx(code);
 		if (idx == -1) {
@@ -549,7 +605,7 @@ int knot_ctl_receive(knot_ctl_t *ctx, knot_ctl_type_t *type, knot_ctl_data_t *da
 		}
 
 		// Store the item data value.
-		ret = receive_item_value(ctx, (char **)&ctx->data[idx]);
+		ret = receive_item_value(ctx, (char **)&ctx->data[idx], NULL);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -562,3 +618,61 @@ int knot_ctl_receive(knot_ctl_t *ctx, knot_ctl_type_t *type, knot_ctl_data_t *da
 
 	return KNOT_EOK;
 }
+
+_public_
+const uint8_t *knot_ctl_wire(knot_ctl_t *ctx, uint16_t *wire_len)
+{
+	if (ctx == NULL || ctx->wire == NULL) {
+		return NULL;
+	}
+
+	if (wire_len != NULL) {
+		*wire_len = ctx->wire_len;
+	}
+
+	return ctx->wire;
+}
+
+_public_
+int knot_ctl_flush(knot_ctl_t *ctx)
+{
+	if (ctx == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	wire_ctx_t *w = &ctx->wire_out;
+	if (wire_ctx_offset(w) == 0) {
+		return KNOT_EOK;
+	}
+
+	int ret = net_stream_send(ctx->sock, w->wire, wire_ctx_offset(w),
+	                          ctx->timeout);
+	if (ret < 0) {
+		return ret;
+	}
+
+	*w = wire_ctx_init(w->wire, CTL_BUFF_SIZE);
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_ctl_poll(knot_ctl_t *ctx, int timeout_ms)
+{
+	if (ctx == NULL || ctx->sock < 0) {
+		return KNOT_EINVAL;
+	}
+
+	// Already received but not processed input.
+	if (wire_ctx_available(&ctx->wire_in) > 0) {
+		return KNOT_EOK;
+	}
+
+	struct pollfd pfd = { .fd = ctx->sock, .events = POLLIN };
+	int ret = poll(&pfd, 1, timeout_ms);
+	if (ret < 0) {
+		return knot_map_errno();
+	}
+
+	return (ret > 0) ? KNOT_EOK : KNOT_ETIMEOUT;
+}
@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 /*! Control data item indexes. */
 typedef enum {
 	KNOT_CTL_IDX_CMD = 0, /*!< Control command name. */
@@ -125,6 +127,20 @@ int knot_ctl_connect(knot_ctl_t *ctx, const char *path);
  */
 int knot_ctl_accept(knot_ctl_t *ctx);
 
+/*!
+ * Moves the accepted connection to a new control context.
+ *
+ * The new context can be used for the connection processing in another thread
+ * while the original one is accepting further connections.
+ *
+ * \note Server operation.
+ *
+ * \param[in] ctx  Control context with an accepted connection.
+ *
+ * \return New control context or NULL if error.
+ */
+knot_ctl_t* knot_ctl_clone(knot_ctl_t *ctx);
+
 /*!
  * Closes the remote connections.
  *
@@ -145,6 +161,24 @@ void knot_ctl_close(knot_ctl_t *ctx);
  */
 int knot_ctl_send(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data);
 
+/*!
+ * Sends one control data unit with a binary data item.
+ *
+ * The binary item carries e.g. wire format records instead of their text
+ * form. It's only understood by peers supporting it, other ones fail to
+ * receive the unit.
+ *
+ * \param[in] ctx       Control context.
+ * \param[in] type      Data unit type to send.
+ * \param[in] data      Data unit to send (optional).
+ * \param[in] wire      Binary data item to send (optional).
+ * \param[in] wire_len  Length of the binary data item.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_ctl_send_wire(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data,
+                       const uint8_t *wire, uint16_t wire_len);
+
 /*!
  * Receives one control unit.
  *
@@ -156,4 +190,38 @@ int knot_ctl_send(knot_ctl_t *ctx, knot_ctl_type_t type, knot_ctl_data_t *data);
  */
 int knot_ctl_receive(knot_ctl_t *ctx, knot_ctl_type_t *type, knot_ctl_data_t *data);
 
+/*!
+ * Returns the binary data item of the latter received data unit.
+ *
+ * The item is valid until the next receive.
+ *
+ * \param[in] ctx        Control context.
+ * \param[out] wire_len  Length of the binary data item (optional).
+ *
+ * \return Binary data item or NULL if not present.
+ */
+const uint8_t *knot_ctl_wire(knot_ctl_t *ctx, uint16_t *wire_len);
+
+/*!
+ * Sends the buffered output (data units are buffered until a non-data unit).
+ *
+ * \param[in] ctx  Control context.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_ctl_flush(knot_ctl_t *ctx);
+
+/*!
+ * Waits for an input from the remote side (incl. the connection close).
+ *
+ * \param[in] ctx         Control context.
+ * \param[in] timeout_ms  Wait timeout in milliseconds.
+ *
+ * \retval KNOT_EOK       If some input is available.
+ * \retval KNOT_ETIMEOUT  If no input in the given time.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_ctl_poll(knot_ctl_t *ctx, int timeout_ms);
+
 /*! @} */
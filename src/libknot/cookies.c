@@ -21,9 +21,11 @@
 #include "libknot/cookies.h"
 #include "libknot/endian.h"
 #include "libknot/errcode.h"
+#include "contrib/macros.h"
 #include "contrib/string.h"
 #include "contrib/sockaddr.h"
 #include "contrib/openbsd/siphash.h"
+#include "contrib/sipbatch.h"
 
 _public_
 int knot_edns_cookie_client_generate(knot_edns_cookie_t *out,
@@ -168,3 +170,96 @@ int knot_edns_cookie_server_check(const knot_edns_cookie_t *sc,
 
 	return KNOT_EOK;
 }
+
+#define BATCH_CHUNK	32
+#define SRVR_FIXED_LEN	8
+
+static int batch_precheck(const knot_edns_cookie_t *sc, const knot_edns_cookie_t *cc,
+                          const struct sockaddr_storage *client_addr,
+                          const knot_edns_cookie_params_t *params)
+{
+	if (sc->len != SRVR_FIXED_LEN + sizeof(uint64_t) ||
+	    cc->len != KNOT_EDNS_COOKIE_CLNT_SIZE || client_addr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	uint32_t cookie_time;
+	memcpy(&cookie_time, &sc->data[4], sizeof(cookie_time));
+	cookie_time = be32toh(cookie_time);
+
+	uint32_t min_time = params->timestamp - params->lifetime_before;
+	uint32_t max_time = params->timestamp + params->lifetime_after;
+	if (cookie_time < min_time || cookie_time > max_time) {
+		return KNOT_ERANGE;
+	}
+
+	if (sc->data[0] != KNOT_EDNS_COOKIE_VERSION) {
+		return KNOT_ENOTSUP;
+	}
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_edns_cookie_server_check_batch(const knot_edns_cookie_t *sc,
+                                        const knot_edns_cookie_t *cc,
+                                        const struct sockaddr_storage *const *client_addrs,
+                                        const knot_edns_cookie_params_t *params,
+                                        size_t count, int *results)
+{
+	if (sc == NULL || cc == NULL || client_addrs == NULL || params == NULL ||
+	    results == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	const SIPHASH_KEY *key = (const SIPHASH_KEY *)params->secret;
+
+	for (size_t base = 0; base < count; base += BATCH_CHUNK) {
+		size_t chunk = MIN(count - base, BATCH_CHUNK);
+
+		// Input of the hash: client cookie, server cookie header, address.
+		uint8_t msgs[BATCH_CHUNK][KNOT_EDNS_COOKIE_CLNT_SIZE + SRVR_FIXED_LEN +
+		                          sizeof(struct in6_addr)];
+		const uint8_t *src[BATCH_CHUNK];
+		size_t len[BATCH_CHUNK];
+		size_t idx[BATCH_CHUNK];
+		size_t pending = 0;
+
+		for (size_t i = base; i < base + chunk; i++) {
+			results[i] = batch_precheck(&sc[i], &cc[i], client_addrs[i], params);
+			if (results[i] != KNOT_EOK) {
+				continue;
+			}
+
+			size_t addr_len = 0;
+			void *addr = sockaddr_raw(client_addrs[i], &addr_len);
+			if (addr == NULL || addr_len > sizeof(struct in6_addr)) {
+				results[i] = KNOT_EINVAL;
+				continue;
+			}
+
+			uint8_t *msg = msgs[pending];
+			memcpy(msg, cc[i].data, KNOT_EDNS_COOKIE_CLNT_SIZE);
+			memcpy(msg + KNOT_EDNS_COOKIE_CLNT_SIZE, sc[i].data, SRVR_FIXED_LEN);
+			memcpy(msg + KNOT_EDNS_COOKIE_CLNT_SIZE + SRVR_FIXED_LEN, addr, addr_len);
+			src[pending] = msg;
+			len[pending] = KNOT_EDNS_COOKIE_CLNT_SIZE + SRVR_FIXED_LEN + addr_len;
+			idx[pending] = i;
+			pending++;
+		}
+
+		uint64_t hash[BATCH_CHUNK];
+		siphash24_batch(key, src, len, pending, hash);
+
+		for (size_t p = 0; p < pending; p++) {
+			size_t i = idx[p];
+			if (const_time_memcmp(sc[i].data + SRVR_FIXED_LEN, &hash[p],
+			                      sizeof(hash[p])) != 0) {
+				results[i] = KNOT_EINVAL;
+			}
+		}
+		memzero(msgs, sizeof(msgs));
+	}
+
+	return KNOT_EOK;
+}
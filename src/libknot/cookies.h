@@ -100,4 +100,27 @@ int knot_edns_cookie_server_check(const knot_edns_cookie_t *sc,
                                   const knot_edns_cookie_t *cc,
                                   const knot_edns_cookie_params_t *params);
 
+/*!
+ * \brief Check several server cookies at once.
+ *
+ * The server cookies are expected to be generated by this library, so only
+ * the ones of the full length are accepted. The hashes of the cookies are
+ * computed together, which is faster than checking them one by one.
+ *
+ * \param sc            Server cookies that should be checked.
+ * \param cc            Client cookies of the server cookies.
+ * \param client_addrs  Client addresses of the server cookies.
+ * \param params        Common server cookie parameters (client address ignored).
+ * \param count         Number of the cookies.
+ * \param results       Results of knot_edns_cookie_server_check() per cookie.
+ *
+ * \retval KNOT_EOK
+ * \retval KNOT_EINVAL
+ */
+int knot_edns_cookie_server_check_batch(const knot_edns_cookie_t *sc,
+                                        const knot_edns_cookie_t *cc,
+                                        const struct sockaddr_storage *const *client_addrs,
+                                        const knot_edns_cookie_params_t *params,
+                                        size_t count, int *results);
+
 /*! @} */
@@ -28,6 +28,42 @@
 #include "contrib/mempattern.h"
 #include "contrib/tolower.h"
 
+/*! \brief Convert data to lowercase, processed by words. */
+static void lower_copy(uint8_t *dst, const uint8_t *src, size_t len)
+{
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t w;
+		memcpy(&w, src + i, sizeof(w));
+		w = knot_tolower_u64(w);
+		memcpy(dst + i, &w, sizeof(w));
+	}
+	for (; i < len; i++) {
+		dst[i] = knot_tolower(src[i]);
+	}
+}
+
+/*! \brief Compare data case-insensitively, processed by words. */
+static bool lower_is_equal(const uint8_t *d1, const uint8_t *d2, size_t len)
+{
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+		uint64_t w1, w2;
+		memcpy(&w1, d1 + i, sizeof(w1));
+		memcpy(&w2, d2 + i, sizeof(w2));
+		if (knot_tolower_u64(w1) != knot_tolower_u64(w2)) {
+			return false;
+		}
+	}
+	for (; i < len; i++) {
+		if (knot_tolower(d1[i]) != knot_tolower(d2[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 static bool label_is_equal(const uint8_t *lb1, const uint8_t *lb2, bool no_case)
 {
 	if (*lb1 != *lb2) {
@@ -35,14 +71,7 @@ static bool label_is_equal(const uint8_t *lb1, const uint8_t *lb2, bool no_case)
 	}
 
 	if (no_case) {
-		uint8_t len = *lb1;
-		for (uint8_t i = 1; i <= len; i++) {
-			if (knot_tolower(lb1[i]) != knot_tolower(lb2[i])) {
-				return false;
-			}
-		}
-
-		return true;
+		return lower_is_equal(lb1 + 1, lb2 + 1, *lb1);
 	} else {
 		return memcmp(lb1 + 1, lb2 + 1, *lb1) == 0;
 	}
@@ -478,13 +507,8 @@ void knot_dname_to_lower(knot_dname_t *name)
 		return;
 	}
 
-	while (*name != '\0') {
-		uint8_t len = *name;
-		for (uint8_t i = 1; i <= len; ++i) {
-			name[i] = knot_tolower(name[i]);
-		}
-		name += 1 + len;
-	}
+	// Label lengths aren't affected, lowercase the whole name at once.
+	lower_copy(name, name, knot_dname_size(name));
 }
 
 _public_
@@ -494,16 +518,8 @@ void knot_dname_copy_lower(knot_dname_t *dst, const knot_dname_t *name)
 		return;
 	}
 
-	while (*name != '\0') {
-		uint8_t len = *name;
-		*dst = len;
-		for (uint8_t i = 1; i <= len; ++i) {
-			dst[i] = knot_tolower(name[i]);
-		}
-		dst += 1 + len;
-		name += 1 + len;
-	}
-	*dst = '\0';
+	// Label lengths aren't affected, lowercase the whole name at once.
+	lower_copy(dst, name, knot_dname_size(name));
 }
 
 _public_
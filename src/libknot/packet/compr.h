@@ -26,6 +26,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 
 #include "libknot/packet/wire.h"
 
@@ -63,6 +64,29 @@ typedef struct {
 	uint16_t compress_ptr[KNOT_COMPR_HINT_COUNT]; /* Array of compr. ptr hints. */
 } knot_rrinfo_t;
 
+/*! \brief Number of slots in the suffix table (must be a power of two). */
+#define KNOT_COMPR_TABLE_SIZE 1024
+
+/*! \brief Slot position marking a removed suffix. */
+#define KNOT_COMPR_TABLE_DELETED 0xFFFF
+
+/*!
+ * \brief Suffix table for optimal name compression.
+ *
+ * Each name suffix written to the packet (within the pointer range) is
+ * stored as a hash of its lowercased labels and its position. A name being
+ * written is then compressed against the longest already written suffix with
+ * one lookup per label. The table is optional as clearing it costs more than
+ * the compression hints save in small responses.
+ */
+typedef struct {
+	uint16_t count; /* Number of occupied slots. */
+	struct knot_compr_slot {
+		uint32_t hash; /* Suffix hash. */
+		uint16_t pos;  /* Suffix position in the packet (0 if empty slot). */
+	} slots[KNOT_COMPR_TABLE_SIZE];
+} knot_compr_table_t;
+
 /*!
  * \brief Name compression context.
  */
@@ -73,6 +97,7 @@ typedef struct knot_compr {
 		uint16_t pos;   /* Position of current suffix. */
 		uint8_t labels; /* Label count of the suffix. */
 	} suffix;
+	knot_compr_table_t *table; /* Optional suffix table (may be NULL). */
 } knot_compr_t;
 
 /*!
@@ -98,4 +123,34 @@ static inline void knot_compr_hint_set(knot_rrinfo_t *info, uint16_t hint_id,
 	}
 }
 
+/*!
+ * \brief Remove all the suffixes from the table.
+ */
+static inline void knot_compr_table_clear(knot_compr_table_t *table)
+{
+	if (table != NULL) {
+		memset(table, 0, sizeof(*table));
+	}
+}
+
+/*!
+ * \brief Remove the suffixes written at or after the given position.
+ *
+ * \note Used when a partially written RRSet is dropped from the packet.
+ */
+static inline void knot_compr_table_trim(knot_compr_table_t *table, uint16_t limit)
+{
+	if (table == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < KNOT_COMPR_TABLE_SIZE; i++) {
+		uint16_t pos = table->slots[i].pos;
+		if (pos != 0 && pos != KNOT_COMPR_TABLE_DELETED && pos >= limit) {
+			// Keep the slot occupied, it may be in the middle of a probe chain.
+			table->slots[i].pos = KNOT_COMPR_TABLE_DELETED;
+		}
+	}
+}
+
 /*! @} */
@@ -176,6 +176,7 @@ static void compr_clear(knot_compr_t *compr)
 	compr->rrinfo = NULL;
 	compr->suffix.pos = 0;
 	compr->suffix.labels = 0;
+	knot_compr_table_clear(compr->table);
 }
 
 /*! \brief Clear the packet and switch wireformat pointers (possibly allocate new). */
@@ -242,6 +243,16 @@ knot_pkt_t *knot_pkt_new(void *wire, uint16_t len, knot_mm_t *mm)
 	return pkt_new_mm(wire, len, mm);
 }
 
+_public_
+int knot_pkt_init(knot_pkt_t *pkt, void *wire, uint16_t len, knot_mm_t *mm)
+{
+	if (pkt == NULL || wire == NULL || mm == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return pkt_init(pkt, wire, len, mm);
+}
+
 static int append_tsig(knot_pkt_t *dst, const knot_pkt_t *src)
 {
 	/* Check if a wire TSIG is available. */
@@ -398,6 +409,9 @@ void knot_pkt_free(knot_pkt_t *pkt)
 	mm_free(&pkt->mm, pkt->rr);
 	mm_free(&pkt->mm, pkt->rr_info);
 
+	/* Free the compression suffix table. */
+	mm_free(&pkt->mm, pkt->compr.table);
+
 	/* Free the space for wireformat. */
 	if (pkt->flags & KNOT_PF_FREE) {
 		mm_free(&pkt->mm, pkt->wire);
@@ -497,6 +511,24 @@ int knot_pkt_put_question(knot_pkt_t *pkt, const knot_dname_t *qname, uint16_t q
 	return knot_pkt_begin(pkt, KNOT_ANSWER);
 }
 
+_public_
+int knot_pkt_compr_table_init(knot_pkt_t *pkt)
+{
+	if (pkt == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (pkt->compr.table == NULL) {
+		pkt->compr.table = mm_alloc(&pkt->mm, sizeof(knot_compr_table_t));
+		if (pkt->compr.table == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+	knot_compr_table_clear(pkt->compr.table);
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t *rr,
                         uint16_t rotate, uint16_t flags)
@@ -544,6 +576,11 @@ int knot_pkt_put_rotate(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t
 	/* Write RRSet to wireformat. */
 	ret = knot_rrset_to_wire_extra(rr, pos, maxlen, rotate, compr, flags);
 	if (ret < 0) {
+		/* Forget the suffixes of the dropped RRSet. */
+		if (compr != NULL) {
+			knot_compr_table_trim(compr->table, pkt->size);
+		}
+
 		/* Truncate packet if required. */
 		if (ret == KNOT_ESPACE && !(flags & KNOT_PF_NOTRUNC)) {
 			knot_wire_set_tc(pkt->wire);
@@ -715,12 +752,90 @@ static int parse_section(knot_pkt_t *pkt, unsigned flags)
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Parses the payload of a plain query without the generic RR parsing.
+ *
+ * Only the payload consisting of at most one OPT record is handled, other
+ * payloads (including the malformed ones) are left to parse_payload().
+ *
+ * \return KNOT_EOK if parsed, KNOT_EAGAIN if not applicable, or an error.
+ */
+static int parse_plain_payload(knot_pkt_t *pkt, unsigned flags)
+{
+	if (knot_wire_get_ancount(pkt->wire) != 0 ||
+	    knot_wire_get_nscount(pkt->wire) != 0 ||
+	    knot_wire_get_arcount(pkt->wire) > 1) {
+		return KNOT_EAGAIN;
+	}
+
+	const uint8_t *pos = pkt->wire + pkt->parsed;
+	size_t avail = pkt->size - pkt->parsed;
+
+	if (knot_wire_get_arcount(pkt->wire) == 0) {
+		if (avail > 0) {
+			return KNOT_EAGAIN;
+		}
+		(void)knot_pkt_begin(pkt, KNOT_AUTHORITY);
+		(void)knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+		return KNOT_EOK;
+	}
+
+	/* Root owner, TYPE, CLASS, TTL, and RDLENGTH exactly to the packet end. */
+	if (avail < KNOT_EDNS_MIN_SIZE || pos[0] != '\0' ||
+	    knot_wire_read_u16(pos + 1) != KNOT_RRTYPE_OPT ||
+	    knot_wire_read_u16(pos + 9) != avail - KNOT_EDNS_MIN_SIZE) {
+		return KNOT_EAGAIN;
+	}
+	uint16_t rclass = knot_wire_read_u16(pos + 3);
+	uint16_t rdlen = avail - KNOT_EDNS_MIN_SIZE;
+	if (rdlen == 0 && rclass == KNOT_CLASS_IN) {
+		return KNOT_EAGAIN; // Refused by the generic parser.
+	}
+
+	(void)knot_pkt_begin(pkt, KNOT_AUTHORITY);
+	(void)knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+
+	uint16_t idx = pkt->rrset_count;
+	int ret = pkt_rr_array_alloc(pkt, idx + 1);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	memset(&pkt->rr_info[idx], 0, sizeof(knot_rrinfo_t));
+	pkt->rr_info[idx].pos = pkt->parsed;
+	pkt->rr_info[idx].flags = KNOT_PF_FREE;
+
+	knot_rrset_t *rr = &pkt->rr[idx];
+	knot_dname_t *owner = knot_dname_copy(pos, &pkt->mm);
+	if (owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_rrset_init(rr, owner, KNOT_RRTYPE_OPT, rclass, knot_wire_read_u32(pos + 5));
+	ret = knot_rrset_add_rdata(rr, pos + KNOT_EDNS_MIN_SIZE, rdlen, &pkt->mm);
+	if (ret != KNOT_EOK) {
+		knot_rrset_clear(rr, &pkt->mm);
+		return ret;
+	}
+
+	pkt->parsed += avail;
+	pkt->rrset_count++;
+	pkt->sections[KNOT_ADDITIONAL].count++;
+
+	return check_rr_constraints(pkt, rr, avail, flags);
+}
+
 static int parse_payload(knot_pkt_t *pkt, unsigned flags)
 {
 	assert(pkt);
 	assert(pkt->wire);
 	assert(pkt->size > 0);
 
+	/* Most queries carry nothing but the question and OPT. */
+	int ret = parse_plain_payload(pkt, flags);
+	if (ret != KNOT_EAGAIN) {
+		return ret;
+	}
+
 	/* Reserve memory in advance to avoid resizing. */
 	size_t rr_count = knot_wire_get_ancount(pkt->wire) +
 	                  knot_wire_get_nscount(pkt->wire) +
@@ -730,7 +845,7 @@ static int parse_payload(knot_pkt_t *pkt, unsigned flags)
 		return KNOT_EMALF;
 	}
 
-	int ret = pkt_rr_array_alloc(pkt, rr_count);
+	ret = pkt_rr_array_alloc(pkt, rr_count);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -122,6 +122,24 @@ struct knot_pkt {
  */
 knot_pkt_t *knot_pkt_new(void *wire, uint16_t len, knot_mm_t *mm);
 
+/*!
+ * \brief Initialize a packet structure provided by the caller over existing memory.
+ *
+ * Unlike \ref knot_pkt_new, the structure itself isn't allocated so it can
+ * be reused for many messages.
+ *
+ * \note The previous content isn't freed, the memory context is expected to
+ *       be a memory pool flushed between the messages.
+ *
+ * \param pkt   Packet structure to initialize.
+ * \param wire  Wire format of the packet.
+ * \param len   Wire format length.
+ * \param mm    Memory context for the packet data.
+ *
+ * \return KNOT_EOK, KNOT_EINVAL
+ */
+int knot_pkt_init(knot_pkt_t *pkt, void *wire, uint16_t len, knot_mm_t *mm);
+
 /*!
  * \brief Copy packet.
  *
@@ -247,6 +265,18 @@ int knot_pkt_begin(knot_pkt_t *pkt, knot_section_t section_id);
 int knot_pkt_put_question(knot_pkt_t *pkt, const knot_dname_t *qname,
                           uint16_t qclass, uint16_t qtype);
 
+/*!
+ * \brief Enable the suffix table for optimal name compression.
+ *
+ * \note The table is allocated from the packet memory context and kept
+ *       until the packet is freed. It's worth it for large responses only.
+ *
+ * \param pkt  Packet.
+ *
+ * \return KNOT_EOK, KNOT_ENOMEM
+ */
+int knot_pkt_compr_table_init(knot_pkt_t *pkt);
+
 /*!
  * \brief Put RRSet into packet.
  *
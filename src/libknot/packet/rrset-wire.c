@@ -170,6 +170,150 @@ static int write_rdata_naptr_header(const uint8_t **src, size_t *src_avail,
 		written += (len); \
 	}
 
+/*! \brief FNV-1a hash of a lowercased label chained with its suffix hash. */
+static uint32_t compr_label_hash(const uint8_t *label, uint32_t suffix_hash)
+{
+	uint32_t hash = suffix_hash;
+	for (uint8_t i = 0; i <= *label; i++) {
+		hash = (hash ^ knot_tolower(label[i])) * 16777619U;
+	}
+
+	return hash;
+}
+
+/*!
+ * \brief Get the labels of a name and the hashes of the suffixes starting there.
+ *
+ * \param name    Name (possibly compressed).
+ * \param wire    Wire the name is compressed in (NULL for uncompressed name).
+ * \param labels  Out: label positions.
+ * \param hashes  Out: suffix hashes.
+ *
+ * \return Number of labels.
+ */
+static uint8_t compr_suffix_hashes(const knot_dname_t *name, const uint8_t *wire,
+                                   const uint8_t *labels[KNOT_DNAME_MAXLABELS],
+                                   uint32_t hashes[KNOT_DNAME_MAXLABELS])
+{
+	uint8_t count = 0;
+	while (*name != '\0' && count < KNOT_DNAME_MAXLABELS) {
+		labels[count++] = name;
+		name = knot_wire_next_label(name, wire);
+	}
+
+	uint32_t hash = 2166136261U;
+	for (int i = count - 1; i >= 0; i--) {
+		hash = compr_label_hash(labels[i], hash);
+		hashes[i] = hash;
+	}
+
+	return count;
+}
+
+static void compr_table_insert(knot_compr_table_t *table, uint32_t hash, uint16_t pos)
+{
+	// Keep some free slots to terminate the probing.
+	if (table->count >= KNOT_COMPR_TABLE_SIZE / 4 * 3) {
+		return;
+	}
+
+	for (uint32_t i = hash; ; i++) {
+		struct knot_compr_slot *slot = &table->slots[i & (KNOT_COMPR_TABLE_SIZE - 1)];
+		if (slot->pos == 0) {
+			slot->hash = hash;
+			slot->pos = pos;
+			table->count++;
+			return;
+		}
+	}
+}
+
+/*! \brief Find the position of a written suffix, 0 if not found. */
+static uint16_t compr_table_find(const knot_compr_t *compr, const knot_dname_t *suffix,
+                                 uint32_t hash)
+{
+	const knot_compr_table_t *table = compr->table;
+
+	for (uint32_t i = hash; ; i++) {
+		const struct knot_compr_slot *slot = &table->slots[i & (KNOT_COMPR_TABLE_SIZE - 1)];
+		if (slot->pos == 0) {
+			return 0;
+		}
+		if (slot->hash == hash && slot->pos != KNOT_COMPR_TABLE_DELETED &&
+		    dname_equal_wire(suffix, compr->wire + slot->pos, compr->wire)) {
+			return slot->pos;
+		}
+	}
+}
+
+/*!
+ * \brief Write domain name compressed against the longest written suffix.
+ *
+ * \see compr_put_dname
+ */
+static int compr_table_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
+                                 knot_compr_t *compr)
+{
+	knot_compr_table_t *table = compr->table;
+	const uint8_t *labels[KNOT_DNAME_MAXLABELS];
+	uint32_t hashes[KNOT_DNAME_MAXLABELS];
+
+	// QNAME is the first name in the packet.
+	if (table->count == 0) {
+		const uint8_t *qname = compr->wire + KNOT_WIRE_HEADER_SIZE;
+		uint8_t count = compr_suffix_hashes(qname, compr->wire, labels, hashes);
+		for (uint8_t i = 0; i < count; i++) {
+			compr_table_insert(table, hashes[i], labels[i] - compr->wire);
+		}
+	}
+
+	// Find the longest written suffix.
+	uint8_t count = compr_suffix_hashes(dname, NULL, labels, hashes);
+	uint8_t match = count;
+	uint16_t match_pos = 0;
+	for (uint8_t i = 0; i < count; i++) {
+		match_pos = compr_table_find(compr, labels[i], hashes[i]);
+		if (match_pos != 0) {
+			match = i;
+			break;
+		}
+	}
+
+	// Write the unmatched labels followed by the pointer or the root label.
+	uint16_t written = 0;
+	if (match < count) {
+		WRITE_LABEL(dst, written, dname, max, labels[match] - dname);
+		if (written + sizeof(uint16_t) > max) {
+			return KNOT_ESPACE;
+		}
+		knot_wire_put_pointer(dst + written, match_pos);
+		written += sizeof(uint16_t);
+	} else {
+		WRITE_LABEL(dst, written, dname, max, knot_dname_size(dname));
+	}
+
+	assert(dst >= compr->wire);
+	size_t wire_pos = dst - compr->wire;
+	assert(wire_pos < KNOT_WIRE_MAX_PKTSIZE);
+
+	// Remember the new suffixes.
+	for (uint8_t i = 0; i < match; i++) {
+		size_t pos = wire_pos + (labels[i] - dname);
+		if (pos >= KNOT_WIRE_PTR_MAX) {
+			break;
+		}
+		compr_table_insert(table, hashes[i], pos);
+	}
+
+	// Needed for the owner coincidence check.
+	if (written > sizeof(uint16_t) && wire_pos + written < KNOT_WIRE_PTR_MAX) {
+		compr->suffix.pos = wire_pos;
+		compr->suffix.labels = count;
+	}
+
+	return written;
+}
+
 /*!
  * \brief Write compressed domain name to the destination wire.
  *
@@ -189,6 +333,10 @@ static int compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max
 		return knot_dname_to_wire(dst, dname, max);
 	}
 
+	if (compr->table != NULL) {
+		return compr_table_put_dname(dname, dst, max, compr);
+	}
+
 	// Get number of labels (should not be a zero label dname).
 	size_t name_labels = knot_dname_labels(dname, NULL);
 	assert(name_labels > 0);
@@ -425,6 +573,54 @@ static int rdata_traverse_write(const uint8_t **src, size_t *src_avail,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Write RDATA of the given type.
+ *
+ * The most common types are written directly, the result is the same
+ * as with the traversal of their descriptors.
+ */
+static int rdata_write(uint16_t type, const uint8_t **src, size_t *src_avail,
+                       uint8_t **dst, size_t *dst_avail,
+                       knot_compr_t *compr, uint16_t hint)
+{
+	int ret;
+	switch (type) {
+	case KNOT_RRTYPE_A:
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, 4);
+	case KNOT_RRTYPE_AAAA:
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, 16);
+	case KNOT_RRTYPE_TXT:
+	case KNOT_RRTYPE_DS:
+	case KNOT_RRTYPE_NSEC3:
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, *src_avail);
+	case KNOT_RRTYPE_NS:
+	case KNOT_RRTYPE_CNAME:
+		return compress_rdata_dname(src, src_avail, dst, dst_avail,
+		                            compr, compr, hint);
+	case KNOT_RRTYPE_MX:
+		ret = write_rdata_fixed(src, src_avail, dst, dst_avail, 2);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		return compress_rdata_dname(src, src_avail, dst, dst_avail,
+		                            compr, compr, hint);
+	case KNOT_RRTYPE_RRSIG:
+		ret = write_rdata_fixed(src, src_avail, dst, dst_avail, 18);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		ret = compress_rdata_dname(src, src_avail, dst, dst_avail,
+		                           NULL, compr, hint);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, *src_avail);
+	default:
+		return rdata_traverse_write(src, src_avail, dst, dst_avail,
+		                            knot_get_rdata_descriptor(type), compr, hint);
+	}
+}
+
 static int write_rdata(const knot_rrset_t *rrset, uint16_t rrset_index,
                        uint8_t **dst, size_t *dst_avail, knot_compr_t *compr)
 {
@@ -450,10 +646,8 @@ static int write_rdata(const knot_rrset_t *rrset, uint16_t rrset_index,
 	size_t src_avail = rdata->len;
 	if (src_avail > 0) {
 		// Only write non-empty data.
-		const knot_rdata_descriptor_t *desc =
-			knot_get_rdata_descriptor(rrset->type);
-		int ret = rdata_traverse_write(&src, &src_avail, dst, dst_avail,
-		                         desc, compr, KNOT_COMPR_HINT_RDATA + rrset_index);
+		int ret = rdata_write(rrset->type, &src, &src_avail, dst, dst_avail,
+		                      compr, KNOT_COMPR_HINT_RDATA + rrset_index);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -631,6 +825,49 @@ static int rdata_traverse_parse(const uint8_t **src, size_t *src_avail,
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Parse RDATA of the given type.
+ *
+ * \see rdata_write
+ */
+static int rdata_parse(uint16_t type, const uint8_t **src, size_t *src_avail,
+                       uint8_t **dst, size_t *dst_avail,
+                       const knot_rdata_descriptor_t *desc, const uint8_t *pkt_wire)
+{
+	int ret;
+	switch (type) {
+	case KNOT_RRTYPE_A:
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, 4);
+	case KNOT_RRTYPE_AAAA:
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, 16);
+	case KNOT_RRTYPE_TXT:
+	case KNOT_RRTYPE_DS:
+	case KNOT_RRTYPE_NSEC3:
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, *src_avail);
+	case KNOT_RRTYPE_NS:
+	case KNOT_RRTYPE_CNAME:
+		return decompress_rdata_dname(src, src_avail, dst, dst_avail, pkt_wire);
+	case KNOT_RRTYPE_MX:
+		ret = write_rdata_fixed(src, src_avail, dst, dst_avail, 2);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		return decompress_rdata_dname(src, src_avail, dst, dst_avail, pkt_wire);
+	case KNOT_RRTYPE_RRSIG:
+		ret = write_rdata_fixed(src, src_avail, dst, dst_avail, 18);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		ret = decompress_rdata_dname(src, src_avail, dst, dst_avail, pkt_wire);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		return write_rdata_fixed(src, src_avail, dst, dst_avail, *src_avail);
+	default:
+		return rdata_traverse_parse(src, src_avail, dst, dst_avail, desc, pkt_wire);
+	}
+}
+
 static bool allow_zero_rdata(const knot_rrset_t *rr,
                              const knot_rdata_descriptor_t *desc)
 {
@@ -672,7 +909,7 @@ static int parse_rdata(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
 	size_t dst_avail = max_rdata_len;
 
 	// Parse RDATA.
-	int ret = rdata_traverse_parse(&src, &src_avail, &dst, &dst_avail, desc, pkt_wire);
+	int ret = rdata_parse(rrset->type, &src, &src_avail, &dst, &dst_avail, desc, pkt_wire);
 	if (ret != KNOT_EOK) {
 		return KNOT_EMALF;
 	}
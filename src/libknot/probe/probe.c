@@ -15,10 +15,13 @@
  */
 
 #include <fcntl.h>
+#include <limits.h>
 #include <poll.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -28,13 +31,39 @@
 #include "libknot/attribute.h"
 #include "libknot/errcode.h"
 #include "libknot/probe/probe.h"
+#include "contrib/spinlock.h"
 #include "contrib/time.h"
 
+#define RING_MAGIC	0x524e4b50 // "PKNR"
+#define RING_ALIGN	64
+
+/*!
+ * Shared memory ring of the data units.
+ *
+ * The head is only moved by the producer, the tail by the consumer.
+ * If the consumer is about to sleep, it sets the waiting flag and the next
+ * produced data unit is followed by a wake-up datagram over the socket.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t unit_size;
+	uint32_t capacity;   // Number of data units, a power of two.
+	uint32_t closed;     // Set if the consumer doesn't exist anymore.
+	uint64_t head __attribute__((aligned(RING_ALIGN)));
+	uint64_t tail __attribute__((aligned(RING_ALIGN)));
+	uint32_t waiting __attribute__((aligned(RING_ALIGN)));
+	uint8_t data[] __attribute__((aligned(RING_ALIGN)));
+} probe_ring_t;
+
 struct knot_probe {
 	struct sockaddr_un path;
 	uint32_t last_unconn_time;
 	bool consumer;
 	int fd;
+	probe_ring_t *ring;
+	size_t ring_size;
+	char ring_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	knot_spin_t ring_lock;
 };
 
 _public_
@@ -46,10 +75,20 @@ knot_probe_t *knot_probe_alloc(void)
 	}
 
 	probe->fd = -1;
+	knot_spin_init(&probe->ring_lock);
 
 	return probe;
 }
 
+static void ring_unmap(knot_probe_t *probe)
+{
+	if (probe->ring != NULL) {
+		munmap(probe->ring, probe->ring_size);
+		probe->ring = NULL;
+		probe->ring_size = 0;
+	}
+}
+
 _public_
 void knot_probe_free(knot_probe_t *probe)
 {
@@ -60,7 +99,13 @@ void knot_probe_free(knot_probe_t *probe)
 	close(probe->fd);
 	if (probe->consumer) {
 		(void)unlink(probe->path.sun_path);
+		if (probe->ring != NULL) {
+			__atomic_store_n(&probe->ring->closed, 1, __ATOMIC_RELEASE);
+			(void)unlink(probe->ring_path);
+		}
 	}
+	ring_unmap(probe);
+	knot_spin_destroy(&probe->ring_lock);
 	free(probe);
 }
 
@@ -97,6 +142,62 @@ static int probe_init(knot_probe_t *probe, const char *dir, uint16_t idx)
 	return KNOT_EOK;
 }
 
+static int ring_set_path(knot_probe_t *probe, const char *dir, uint16_t idx)
+{
+	int ret = snprintf(probe->ring_path, sizeof(probe->ring_path),
+	                   "%s/probe%02u.ring", dir, idx);
+	if (ret < 0 || ret >= sizeof(probe->ring_path)) {
+		return KNOT_ERANGE;
+	}
+
+	return KNOT_EOK;
+}
+
+static int ring_map(knot_probe_t *probe, int fd, size_t size)
+{
+	void *ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED) {
+		return knot_map_errno();
+	}
+
+	probe->ring = ring;
+	probe->ring_size = size;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Maps the ring created by the consumer. */
+static int ring_attach(knot_probe_t *probe)
+{
+	int fd = open(probe->ring_path, O_RDWR);
+	if (fd < 0) {
+		return KNOT_ECONN;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < sizeof(probe_ring_t)) {
+		close(fd);
+		return KNOT_ECONN;
+	}
+
+	int ret = ring_map(probe, fd, st.st_size);
+	close(fd);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	probe_ring_t *ring = probe->ring;
+	if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != RING_MAGIC ||
+	    ring->unit_size != sizeof(knot_probe_data_t) ||
+	    sizeof(probe_ring_t) + (size_t)ring->capacity * ring->unit_size > st.st_size ||
+	    __atomic_load_n(&ring->closed, __ATOMIC_RELAXED) != 0) {
+		ring_unmap(probe);
+		return KNOT_ECONN;
+	}
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_probe_set_producer(knot_probe_t *probe, const char *dir, uint16_t idx)
 {
@@ -113,6 +214,26 @@ int knot_probe_set_producer(knot_probe_t *probe, const char *dir, uint16_t idx)
 	return KNOT_EOK;
 }
 
+_public_
+int knot_probe_set_ring_producer(knot_probe_t *probe, const char *dir, uint16_t idx)
+{
+	int ret = probe_init(probe, dir, idx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = ring_set_path(probe, dir, idx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (ring_attach(probe) != KNOT_EOK || probe_connect(probe) != 0) {
+		return KNOT_ECONN;
+	}
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_probe_set_consumer(knot_probe_t *probe, const char *dir, uint16_t idx)
 {
@@ -141,6 +262,71 @@ int knot_probe_set_consumer(knot_probe_t *probe, const char *dir, uint16_t idx)
 	return KNOT_EOK;
 }
 
+_public_
+int knot_probe_set_ring_consumer(knot_probe_t *probe, const char *dir, uint16_t idx,
+                                 uint32_t capacity)
+{
+	if (capacity == 0 || capacity > (1U << 31)) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = knot_probe_set_consumer(probe, dir, idx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = ring_set_path(probe, dir, idx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Detach the producers from a possibly left over ring.
+	if (ring_attach(probe) == KNOT_EOK) {
+		__atomic_store_n(&probe->ring->closed, 1, __ATOMIC_RELEASE);
+		ring_unmap(probe);
+	}
+	(void)unlink(probe->ring_path);
+
+	uint32_t pow2 = 1;
+	while (pow2 < capacity) {
+		pow2 <<= 1;
+	}
+	size_t size = sizeof(probe_ring_t) + (size_t)pow2 * sizeof(knot_probe_data_t);
+
+	int fd = open(probe->ring_path, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		return knot_map_errno();
+	}
+#if defined(__linux__)
+	// The same access as for the socket.
+	if (fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH) != 0) {
+		ret = knot_map_errno();
+		close(fd);
+		(void)unlink(probe->ring_path);
+		return ret;
+	}
+#endif
+	if (ftruncate(fd, size) != 0) {
+		ret = knot_map_errno();
+		close(fd);
+		(void)unlink(probe->ring_path);
+		return ret;
+	}
+
+	ret = ring_map(probe, fd, size);
+	close(fd);
+	if (ret != KNOT_EOK) {
+		(void)unlink(probe->ring_path);
+		return ret;
+	}
+
+	probe->ring->unit_size = sizeof(knot_probe_data_t);
+	probe->ring->capacity = pow2;
+	__atomic_store_n(&probe->ring->magic, RING_MAGIC, __ATOMIC_RELEASE);
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_probe_fd(knot_probe_t *probe)
 {
@@ -151,6 +337,62 @@ int knot_probe_fd(knot_probe_t *probe)
 	return probe->fd;
 }
 
+static bool ring_reattach_time(knot_probe_t *probe)
+{
+	struct timespec now = time_now();
+	if (now.tv_sec - probe->last_unconn_time > 2) {
+		probe->last_unconn_time = now.tv_sec;
+		return true;
+	}
+	return false;
+}
+
+static int ring_produce(knot_probe_t *probe, const knot_probe_data_t *data,
+                        size_t used_len)
+{
+	// The producer can be shared by more threads.
+	knot_spin_lock(&probe->ring_lock);
+
+	probe_ring_t *ring = probe->ring;
+	if (ring != NULL && __atomic_load_n(&ring->closed, __ATOMIC_RELAXED) != 0) {
+		ring_unmap(probe);
+		ring = NULL;
+	}
+	if (ring == NULL) {
+		if (!ring_reattach_time(probe) || ring_attach(probe) != KNOT_EOK) {
+			knot_spin_unlock(&probe->ring_lock);
+			return KNOT_ECONN;
+		}
+		(void)probe_connect(probe);
+		ring = probe->ring;
+	}
+
+	uint64_t head = ring->head;
+	uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (head - tail >= ring->capacity) {
+		knot_spin_unlock(&probe->ring_lock);
+		return KNOT_ESPACE;
+	}
+
+	uint8_t *unit = ring->data + (head & (ring->capacity - 1)) * ring->unit_size;
+	memcpy(unit, data, used_len);
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+	// Wake up the consumer if waiting (the fence pairs with the consumer one).
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	bool wakeup = __atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST) != 0 &&
+	              __atomic_exchange_n(&ring->waiting, 0, __ATOMIC_SEQ_CST) != 0;
+
+	knot_spin_unlock(&probe->ring_lock);
+
+	if (wakeup) {
+		uint8_t dummy = 0;
+		(void)send(probe->fd, &dummy, sizeof(dummy), 0);
+	}
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8_t count)
 {
@@ -159,6 +401,10 @@ int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8
 	}
 
 	size_t used_len = sizeof(*data) - KNOT_DNAME_MAXLEN + data->query.qname_len;
+	if (probe->ring_path[0] != '\0') {
+		return ring_produce(probe, data, used_len);
+	}
+
 	if (send(probe->fd, data, used_len, 0) == -1) {
 		struct timespec now = time_now();
 		if (now.tv_sec - probe->last_unconn_time > 2) {
@@ -175,6 +421,51 @@ int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8
 	return KNOT_EOK;
 }
 
+static int ring_pop(probe_ring_t *ring, knot_probe_data_t *data, uint8_t count)
+{
+	uint64_t tail = ring->tail;
+	uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	uint8_t i;
+	for (i = 0; i < count && tail != head; i++, tail++) {
+		memcpy(&data[i], ring->data + (tail & (ring->capacity - 1)) * ring->unit_size,
+		       sizeof(*data));
+	}
+	__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+	return i;
+}
+
+static int ring_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t count,
+                        int timeout_ms)
+{
+	probe_ring_t *ring = probe->ring;
+
+	int ret = ring_pop(ring, data, count);
+	if (ret > 0 || timeout_ms == 0) {
+		return ret;
+	}
+
+	// Announce the sleep and check the ring again to not miss the wake-up.
+	__atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	ret = ring_pop(ring, data, count);
+	if (ret == 0) {
+		struct pollfd pfd = { .fd = probe->fd, .events = POLLIN };
+		if (poll(&pfd, 1, timeout_ms) == -1) {
+			__atomic_store_n(&ring->waiting, 0, __ATOMIC_SEQ_CST);
+			return knot_map_errno();
+		}
+	}
+	__atomic_store_n(&ring->waiting, 0, __ATOMIC_SEQ_CST);
+
+	// Drain the wake-up datagrams.
+	uint8_t dummy[16];
+	while (recv(probe->fd, dummy, sizeof(dummy), 0) > 0);
+
+	return (ret > 0) ? ret : ring_pop(ring, data, count);
+}
+
 _public_
 int knot_probe_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t count,
                        int timeout_ms)
@@ -183,6 +474,10 @@ int knot_probe_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t cou
 		return KNOT_EINVAL;
 	}
 
+	if (probe->ring != NULL) {
+		return ring_consume(probe, data, count, timeout_ms);
+	}
+
 #ifdef ENABLE_RECVMMSG
 	struct mmsghdr msgs[count];
 	struct iovec iovecs[count];
@@ -228,3 +523,29 @@ int knot_probe_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t cou
 	return (ret > 0 ? 1 : 0);
 #endif
 }
+
+_public_
+int knot_probe_consume_bulk(knot_probe_t *probe, knot_probe_data_t *data, uint32_t count,
+                            int timeout_ms)
+{
+	if (probe == NULL || data == NULL || count == 0 || count > INT_MAX) {
+		return KNOT_EINVAL;
+	}
+
+	uint32_t total = 0;
+	while (total < count) {
+		uint32_t left = count - total;
+		uint8_t batch = (left > UINT8_MAX) ? UINT8_MAX : left;
+		// Only the first batch is waited for.
+		int ret = knot_probe_consume(probe, data + total, batch,
+		                             (total == 0) ? timeout_ms : 0);
+		if (ret < 0) {
+			return (total > 0) ? total : ret;
+		} else if (ret == 0) {
+			break;
+		}
+		total += ret;
+	}
+
+	return total;
+}
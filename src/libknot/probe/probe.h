@@ -58,6 +58,24 @@ void knot_probe_free(knot_probe_t *probe);
  */
 int knot_probe_set_producer(knot_probe_t *probe, const char *dir, uint16_t idx);
 
+/*!
+ * \brief Initializes one probe producer using a shared memory ring.
+ *
+ * The data units are written to the ring created by the consumer, the unix
+ * socket is only used for waking up the consumer when it waits for data.
+ * If the ring isn't available, attaching is retried when producing, at most
+ * once per 2 seconds.
+ *
+ * \param probe  Probe context.
+ * \param dir    Unix socket and ring directory.
+ * \param idx    Probe ID (counted from 1).
+ *
+ * \retval KNOT_EOK    Success.
+ * \retval KNOT_ECONN  Initial attaching failed.
+ * \return KNOT_E*     If error.
+ */
+int knot_probe_set_ring_producer(knot_probe_t *probe, const char *dir, uint16_t idx);
+
 /*!
  * \brief Initializes one probe consumer.
  *
@@ -72,6 +90,22 @@ int knot_probe_set_producer(knot_probe_t *probe, const char *dir, uint16_t idx);
  */
 int knot_probe_set_consumer(knot_probe_t *probe, const char *dir, uint16_t idx);
 
+/*!
+ * \brief Initializes one probe consumer using a shared memory ring.
+ *
+ * \note The socket and ring file permissions are set to 777/666 on Linux!
+ *
+ * \param probe     Probe context.
+ * \param dir       Unix socket and ring directory.
+ * \param idx       Probe ID (counted from 1).
+ * \param capacity  Ring capacity in data units (rounded up to a power of two).
+ *
+ * \retval KNOT_EOK  Success.
+ * \return KNOT_E*   If error.
+ */
+int knot_probe_set_ring_consumer(knot_probe_t *probe, const char *dir, uint16_t idx,
+                                 uint32_t capacity);
+
 /*!
  * \brief Returns file descriptor of the probe.
  *
@@ -88,12 +122,15 @@ int knot_probe_fd(knot_probe_t *probe);
  * 2 seconds, reconnection is attempted and if successful, the send operation
  * is repeated.
  *
+ * If the shared memory ring is full, the data unit is dropped.
+ *
  * \param probe  Probe context.
  * \param data   Array of data units.
  * \param count  Length of data unit array.
  *
- * \retval KNOT_EOK  Success.
- * \return KNOT_E*   If error.
+ * \retval KNOT_EOK     Success.
+ * \retval KNOT_ESPACE  The ring is full.
+ * \return KNOT_E*      If error.
  */
 int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8_t count);
 
@@ -113,4 +150,22 @@ int knot_probe_produce(knot_probe_t *probe, const knot_probe_data_t *data, uint8
 int knot_probe_consume(knot_probe_t *probe, knot_probe_data_t *data, uint8_t count,
                        int timeout_ms);
 
+/*!
+ * \brief Receives many data units from a probe into a contiguous array.
+ *
+ * Blocks until the first data unit is received or timeout is hit, then
+ * receives the already available data units without waiting until the array
+ * is full.
+ *
+ * \param probe       Probe context.
+ * \param data        Array of data units.
+ * \param count       Length of data unit array (at most INT_MAX).
+ * \param timeout_ms  Poll timeout in milliseconds (-1 means infinity).
+ *
+ * \retval >= 0    Number of data units received.
+ * \return KNOT_E* If error and no data unit has been received.
+ */
+int knot_probe_consume_bulk(knot_probe_t *probe, knot_probe_data_t *data, uint32_t count,
+                            int timeout_ms);
+
 /*! @} */
@@ -20,6 +20,7 @@
 
 #include "libknot/attribute.h"
 #include "libknot/rdataset.h"
+#include "contrib/macros.h"
 #include "contrib/mempattern.h"
 
 static knot_rdata_t *rr_seek(const knot_rdataset_t *rrs, uint16_t pos)
@@ -264,6 +265,69 @@ bool knot_rdataset_subset(const knot_rdataset_t *subset, const knot_rdataset_t *
 	return true;
 }
 
+static bool is_sorted(const knot_rdataset_t *rrs)
+{
+	knot_rdata_t *rr = rrs->rdata;
+	for (uint16_t i = 1; i < rrs->count; ++i) {
+		knot_rdata_t *next = knot_rdataset_next(rr);
+		if (knot_rdata_cmp(rr, next) >= 0) {
+			return false;
+		}
+		rr = next;
+	}
+
+	return true;
+}
+
+/*! \brief Merges sorted RRS into a new rdata array in one pass. */
+static int merge_sorted(knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2,
+                        knot_mm_t *mm)
+{
+	const size_t max_size = (size_t)rrs1->size + rrs2->size;
+	uint8_t *out = mm_alloc(mm, max_size);
+	if (out == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rdata_t *rr1 = rrs1->rdata, *rr2 = rrs2->rdata;
+	uint16_t left1 = rrs1->count, left2 = rrs2->count;
+	size_t count = 0, size = 0;
+	while (left1 > 0 || left2 > 0) {
+		int cmp = (left1 == 0) ? 1 : (left2 == 0) ? -1 : knot_rdata_cmp(rr1, rr2);
+		knot_rdata_t *rr = (cmp <= 0) ? rr1 : rr2;
+		size_t rr_size = knot_rdata_size(rr->len);
+		memcpy(out + size, rr, rr_size);
+		size += rr_size;
+		count++;
+		if (cmp <= 0) {
+			rr1 = knot_rdataset_next(rr1);
+			left1--;
+		}
+		if (cmp >= 0) {
+			rr2 = knot_rdataset_next(rr2);
+			left2--;
+		}
+	}
+
+	if (count > UINT16_MAX || size > UINT32_MAX) {
+		mm_free(mm, out);
+		return KNOT_ESPACE;
+	}
+	if (size < max_size) {
+		uint8_t *tmp = mm_realloc(mm, out, size, max_size);
+		if (tmp != NULL) {
+			out = tmp;
+		}
+	}
+
+	mm_free(mm, rrs1->rdata);
+	rrs1->rdata = (knot_rdata_t *)out;
+	rrs1->count = count;
+	rrs1->size = size;
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_rdataset_merge(knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2,
                         knot_mm_t *mm)
@@ -272,6 +336,16 @@ int knot_rdataset_merge(knot_rdataset_t *rrs1, const knot_rdataset_t *rrs2,
 		return KNOT_EINVAL;
 	}
 
+	if (rrs1->rdata == rrs2->rdata) {
+		// Merging with itself changes nothing.
+		return KNOT_EOK;
+	}
+
+	// Merge larger sorted RRS in one pass instead of inserting one by one.
+	if (rrs2->count > 1 && is_sorted(rrs2)) {
+		return merge_sorted(rrs1, rrs2, mm);
+	}
+
 	knot_rdata_t *rr2 = rrs2->rdata;
 	for (uint16_t i = 0; i < rrs2->count; ++i) {
 		int ret = knot_rdataset_add(rrs1, rr2, mm);
@@ -337,3 +411,162 @@ int knot_rdataset_subtract(knot_rdataset_t *from, const knot_rdataset_t *what,
 
 	return KNOT_EOK;
 }
+
+_public_
+void knot_rdataset_builder_init(knot_rdataset_builder_t *b, knot_mm_t *mm)
+{
+	if (b == NULL) {
+		return;
+	}
+
+	knot_rdataset_init(&b->rrs);
+	b->capacity = 0;
+	b->last = 0;
+	b->unsorted = false;
+	b->mm = mm;
+}
+
+static int builder_grow(knot_rdataset_builder_t *b, size_t size, bool exact)
+{
+	if (size <= b->capacity) {
+		return KNOT_EOK;
+	} else if (size > UINT32_MAX) {
+		return KNOT_ESPACE;
+	}
+
+	size_t capacity = exact ? size : MIN(MAX(size, 2 * (size_t)b->capacity), UINT32_MAX);
+	knot_rdata_t *tmp = mm_realloc(b->mm, b->rrs.rdata, capacity, b->rrs.size);
+	if (tmp == NULL) {
+		return KNOT_ENOMEM;
+	}
+	b->rrs.rdata = tmp;
+	b->capacity = capacity;
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_rdataset_builder_reserve(knot_rdataset_builder_t *b, size_t size)
+{
+	if (b == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return builder_grow(b, b->rrs.size + size, true);
+}
+
+_public_
+int knot_rdataset_builder_append(knot_rdataset_builder_t *b, const knot_rdata_t *rr)
+{
+	if (b == NULL || rr == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (b->rrs.count > 0) {
+		knot_rdata_t *last = (knot_rdata_t *)((uint8_t *)b->rrs.rdata + b->last);
+		int cmp = knot_rdata_cmp(last, rr);
+		if (cmp == 0) {
+			// Duplicate - no need to add this RR.
+			return KNOT_EOK;
+		} else if (cmp > 0) {
+			b->unsorted = true;
+		}
+	}
+	if (b->rrs.count == UINT16_MAX) {
+		return KNOT_ESPACE;
+	}
+
+	const size_t rr_size = knot_rdata_size(rr->len);
+	int ret = builder_grow(b, b->rrs.size + rr_size, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_rdata_t *pos = (knot_rdata_t *)((uint8_t *)b->rrs.rdata + b->rrs.size);
+	knot_rdata_init(pos, rr->len, rr->data);
+	b->last = b->rrs.size;
+	b->rrs.count++;
+	b->rrs.size += rr_size;
+
+	return KNOT_EOK;
+}
+
+static int rdata_ptr_cmp(const void *a, const void *b)
+{
+	return knot_rdata_cmp(*(const knot_rdata_t **)a, *(const knot_rdata_t **)b);
+}
+
+_public_
+int knot_rdataset_builder_finalize(knot_rdataset_builder_t *b)
+{
+	if (b == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	// The appended RRs are strictly increasing, thus without duplicates.
+	if (!b->unsorted) {
+		return KNOT_EOK;
+	}
+
+	knot_rdata_t **index = malloc(b->rrs.count * sizeof(*index));
+	uint8_t *out = mm_alloc(b->mm, b->capacity);
+	if (index == NULL || out == NULL) {
+		free(index);
+		mm_free(b->mm, out);
+		return KNOT_ENOMEM;
+	}
+
+	knot_rdata_t *rr = b->rrs.rdata;
+	for (uint16_t i = 0; i < b->rrs.count; ++i) {
+		index[i] = rr;
+		rr = knot_rdataset_next(rr);
+	}
+	qsort(index, b->rrs.count, sizeof(*index), rdata_ptr_cmp);
+
+	uint16_t count = 0;
+	uint32_t size = 0, last = 0;
+	for (uint16_t i = 0; i < b->rrs.count; ++i) {
+		if (i > 0 && knot_rdata_cmp(index[i - 1], index[i]) == 0) {
+			continue;
+		}
+		size_t rr_size = knot_rdata_size(index[i]->len);
+		memcpy(out + size, index[i], rr_size);
+		last = size;
+		size += rr_size;
+		count++;
+	}
+	free(index);
+
+	mm_free(b->mm, b->rrs.rdata);
+	b->rrs.rdata = (knot_rdata_t *)out;
+	b->rrs.count = count;
+	b->rrs.size = size;
+	b->last = last;
+	b->unsorted = false;
+
+	return KNOT_EOK;
+}
+
+_public_
+void knot_rdataset_builder_reset(knot_rdataset_builder_t *b)
+{
+	if (b == NULL) {
+		return;
+	}
+
+	b->rrs.count = 0;
+	b->rrs.size = 0;
+	b->last = 0;
+	b->unsorted = false;
+}
+
+_public_
+void knot_rdataset_builder_clear(knot_rdataset_builder_t *b)
+{
+	if (b == NULL) {
+		return;
+	}
+
+	mm_free(b->mm, b->rrs.rdata);
+	knot_rdataset_builder_init(b, b->mm);
+}
@@ -203,4 +203,70 @@ inline static int knot_rdataset_remove(knot_rdataset_t *rrs, const knot_rdata_t
 	return knot_rdataset_subtract(rrs, &rrs_rm, mm);
 }
 
+/*!< \brief Builder of a large RRS, the RRs are appended and sorted at once. */
+typedef struct {
+	knot_rdataset_t rrs; /*!< \brief Appended RRs, sorted once finalized. */
+	uint32_t capacity;   /*!< \brief Allocated size of the rdata array. */
+	uint32_t last;       /*!< \brief Offset of the last appended RR. */
+	bool unsorted;       /*!< \brief The appended RRs are not in canonical order. */
+	knot_mm_t *mm;       /*!< \brief Memory context. */
+} knot_rdataset_builder_t;
+
+/*!
+ * \brief Initializes RRS builder.
+ *
+ * \note Zeroed structure is an initialized builder without memory context.
+ *
+ * \param b   Builder to be initialized.
+ * \param mm  Memory context.
+ */
+void knot_rdataset_builder_init(knot_rdataset_builder_t *b, knot_mm_t *mm);
+
+/*!
+ * \brief Reserves space for further RRs so that they are appended without
+ *        reallocation.
+ *
+ * \param b     RRS builder.
+ * \param size  Total size of the RRs to be appended (see knot_rdata_size()).
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_builder_reserve(knot_rdataset_builder_t *b, size_t size);
+
+/*!
+ * \brief Appends RR to the builder, the space is extended geometrically.
+ *
+ * \param b   RRS builder.
+ * \param rr  RR to append, data will be copied.
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_builder_append(knot_rdataset_builder_t *b, const knot_rdata_t *rr);
+
+/*!
+ * \brief Sorts the appended RRs canonically and removes duplicates.
+ *
+ * The resulting RRS is available in \a b->rrs. It may be used as is or
+ * seized by the caller followed by knot_rdataset_builder_init().
+ *
+ * \param b  RRS builder.
+ *
+ * \return KNOT_E*
+ */
+int knot_rdataset_builder_finalize(knot_rdataset_builder_t *b);
+
+/*!
+ * \brief Removes the appended RRs, keeps the allocated space for reuse.
+ *
+ * \param b  RRS builder.
+ */
+void knot_rdataset_builder_reset(knot_rdataset_builder_t *b);
+
+/*!
+ * \brief Frees the builder space.
+ *
+ * \param b  RRS builder.
+ */
+void knot_rdataset_builder_clear(knot_rdataset_builder_t *b);
+
 /*! @} */
@@ -33,6 +33,7 @@
 #include "libknot/codes.h"
 #include "libknot/consts.h"
 #include "libknot/descriptor.h"
+#include "libknot/dname.h"
 #include "libknot/errcode.h"
 #include "libknot/lookup.h"
 #include "libknot/rrtype/rrsig.h"
@@ -89,6 +90,27 @@ const knot_dump_style_t KNOT_DUMP_STYLE_DEFAULT = {
 	.color = NULL,
 };
 
+/*!
+ * \brief Faster equivalent of snprintf(dst, maxlen, "%"PRIu64, num).
+ *
+ * \return Length of the number, nothing written if not less than maxlen.
+ */
+static int u64_to_str(char *dst, size_t maxlen, uint64_t num)
+{
+	char buf[20];
+	int len = 0;
+	do {
+		buf[sizeof(buf) - ++len] = '0' + num % 10;
+		num /= 10;
+	} while (num > 0);
+
+	if ((size_t)len < maxlen) {
+		memcpy(dst, buf + sizeof(buf) - len, len);
+		dst[len] = '\0';
+	}
+	return len;
+}
+
 static void dump_string(rrset_dump_params_t *p, const char *str)
 {
 	CHECK_PRET
@@ -124,7 +146,7 @@ static void wire_num8_to_str(rrset_dump_params_t *p)
 	CHECK_INMAX(in_len)
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%u", data);
+	int ret = u64_to_str(p->out, p->out_max, data);
 	CHECK_RET_OUTMAX_SNPRINTF
 	out_len = ret;
 
@@ -150,7 +172,7 @@ static void wire_num16_to_str(rrset_dump_params_t *p)
 	data = knot_wire_read_u16(p->in);
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%u", data);
+	int ret = u64_to_str(p->out, p->out_max, data);
 	CHECK_RET_OUTMAX_SNPRINTF
 	out_len = ret;
 
@@ -176,7 +198,7 @@ static void wire_num32_to_str(rrset_dump_params_t *p)
 	data = knot_wire_read_u32(p->in);
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%u", data);
+	int ret = u64_to_str(p->out, p->out_max, data);
 	CHECK_RET_OUTMAX_SNPRINTF
 	out_len = ret;
 
@@ -202,7 +224,7 @@ static void wire_num48_to_str(rrset_dump_params_t *p)
 	data = knot_wire_read_u48(p->in);
 
 	// Write number.
-	int ret = snprintf(p->out, p->out_max, "%"PRIu64"", data);
+	int ret = u64_to_str(p->out, p->out_max, data);
 	CHECK_RET_OUTMAX_SNPRINTF
 	out_len = ret;
 
@@ -226,12 +248,21 @@ static void wire_ipv4_to_str(rrset_dump_params_t *p)
 
 	FILL_IN_INPUT(addr4.s_addr)
 
-	// Write address.
-	if (inet_ntop(AF_INET, &addr4, p->out, p->out_max) == NULL) {
+	// Write address, the same as inet_ntop() just faster.
+	const uint8_t *octets = (const uint8_t *)&addr4.s_addr;
+	char buf[INET_ADDRSTRLEN];
+	for (int i = 0; i < 4; i++) {
+		if (i > 0) {
+			buf[out_len++] = '.';
+		}
+		out_len += u64_to_str(buf + out_len, sizeof(buf) - out_len, octets[i]);
+	}
+	if (out_len >= p->out_max) {
 		p->ret = -1;
 		return;
 	}
-	out_len = strlen(p->out);
+	memcpy(p->out, buf, out_len);
+	p->out[out_len] = '\0';
 
 	// Fill in output.
 	p->in += in_len;
@@ -2121,18 +2152,37 @@ int knot_rrset_txt_dump_header(const knot_rrset_t      *rrset,
 	int    ret;
 
 	// Dump rrset owner.
-	char *name = knot_dname_to_str_alloc(rrset->owner);
+	knot_dname_txt_storage_t owner;
+	char *name;
 	if (style->ascii_to_idn != NULL) {
-		style->ascii_to_idn(&name);
+		name = knot_dname_to_str_alloc(rrset->owner);
+		if (name != NULL) {
+			style->ascii_to_idn(&name);
+		}
+	} else {
+		name = knot_dname_to_str(owner, rrset->owner, sizeof(owner));
+	}
+	if (name == NULL) {
+		return KNOT_EINVAL;
+	}
+	// The same as "%-20s%c" format.
+	size_t name_len = strlen(name);
+	size_t pad_len = (name_len < 20) ? 20 - name_len : 0;
+	ret = name_len + pad_len + 1;
+	if ((size_t)ret < maxlen - len) {
+		memcpy(dst + len, name, name_len);
+		memset(dst + len + name_len, ' ', pad_len);
+		dst[len + ret - 1] = name_len < 4 * TAB_WIDTH ? '\t' : ' ';
+		dst[len + ret] = '\0';
+	}
+	if (name != owner) {
+		free(name);
 	}
-	char sep = strlen(name) < 4 * TAB_WIDTH ? '\t' : ' ';
-	ret = snprintf(dst + len, maxlen - len, "%-20s%c", name, sep);
-	free(name);
 	SNPRINTF_CHECK(ret, maxlen - len);
 	len += ret;
 
 	// Set white space separation character.
-	sep = style->wrap ? ' ' : '\t';
+	char sep = style->wrap ? ' ' : '\t';
 
 	// Dump rrset ttl.
 	if (style->show_ttl) {
@@ -2146,7 +2196,11 @@ int knot_rrset_txt_dump_header(const knot_rrset_t      *rrset,
 			ret = snprintf(dst + len, maxlen - len, "%s%c",
 			               buf, sep);
 		} else {
-			ret = snprintf(dst + len, maxlen - len, "%u%c", ttl, sep);
+			ret = u64_to_str(dst + len, maxlen - len, ttl) + 1;
+			if ((size_t)ret < maxlen - len) {
+				dst[len + ret - 1] = sep;
+				dst[len + ret] = '\0';
+			}
 		}
 		SNPRINTF_CHECK(ret, maxlen - len);
 		len += ret;
@@ -2196,6 +2250,11 @@ static int rrset_txt_dump(const knot_rrset_t      *rrset,
 
 	dst[0] = '\0';
 
+	// The header is dumped once and copied while the TTL doesn't change.
+	size_t hdr_pos = 0;
+	int hdr_len = -1;
+	uint32_t hdr_ttl = 0;
+
 	// Loop over rdata in rrset.
 	uint16_t rr_count = rrset->rrs.count;
 	knot_rdata_t *rr = rrset->rrs.rdata;
@@ -2213,10 +2272,23 @@ static int rrset_txt_dump(const knot_rrset_t      *rrset,
 		uint32_t ttl = ((style->original_ttl && rrset->type == KNOT_RRTYPE_RRSIG) ?
 		                knot_rrsig_original_ttl(rr) : rrset->ttl);
 
-		int ret = knot_rrset_txt_dump_header(rrset, ttl, dst + len,
-		                                     maxlen - len, style);
-		if (ret < 0) {
-			return KNOT_ESPACE;
+		int ret;
+		if (hdr_len >= 0 && ttl == hdr_ttl) {
+			if ((size_t)hdr_len >= maxlen - len) {
+				return KNOT_ESPACE;
+			}
+			memcpy(dst + len, dst + hdr_pos, hdr_len);
+			dst[len + hdr_len] = '\0';
+			ret = hdr_len;
+		} else {
+			ret = knot_rrset_txt_dump_header(rrset, ttl, dst + len,
+			                                 maxlen - len, style);
+			if (ret < 0) {
+				return KNOT_ESPACE;
+			}
+			hdr_pos = len;
+			hdr_len = ret;
+			hdr_ttl = ttl;
 		}
 		len += ret;
 
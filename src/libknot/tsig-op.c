@@ -415,22 +415,36 @@ int knot_tsig_sign(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	return KNOT_EOK;
 }
 
-_public_
-int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
-                        const uint8_t *prev_digest, size_t prev_digest_len,
-                        uint8_t *digest, size_t *digest_len,
-                        const knot_tsig_key_t *key, uint8_t *to_sign,
-                        size_t to_sign_len)
+static void add_prev_digest(dnssec_tsig_ctx_t *hmac, const uint8_t *prev_digest,
+                            size_t prev_digest_len)
 {
-	if (!msg || !msg_len || !key || !digest || !digest_len) {
-		return KNOT_EINVAL;
-	}
+	uint8_t len[2];
+	knot_wire_write_u16(len, prev_digest_len);
+
+	dnssec_binary_t cover = { .data = len, .size = sizeof(len) };
+	dnssec_tsig_add(hmac, &cover);
+	cover.data = (uint8_t *)prev_digest;
+	cover.size = prev_digest_len;
+	dnssec_tsig_add(hmac, &cover);
+}
 
+/*!
+ * Finishes the digest of 'hmac', which already covers the previous digest
+ * and possibly some unsigned messages, and appends the TSIG RR to the message.
+ */
+static int sign_next(dnssec_tsig_ctx_t *hmac, uint8_t *msg, size_t *msg_len,
+                     size_t msg_max_len, uint8_t *digest, size_t *digest_len,
+                     const knot_tsig_key_t *key, const uint8_t *to_sign,
+                     size_t to_sign_len)
+{
 	uint8_t digest_tmp[KNOT_TSIG_MAX_DIGEST_SIZE];
-	size_t digest_tmp_len = 0;
+	size_t digest_tmp_len = dnssec_tsig_size(hmac);
 	knot_rrset_t *tmp_tsig = knot_rrset_new(key->name, KNOT_RRTYPE_TSIG,
 	                                        KNOT_CLASS_ANY, 0, NULL);
 	if (!tmp_tsig) {
+		uint8_t discard[KNOT_TSIG_MAX_DIGEST_SIZE];
+		dnssec_tsig_write(hmac, discard); // Reset the HMAC state.
+		*digest_len = 0;
 		return KNOT_ENOMEM;
 	}
 
@@ -441,31 +455,16 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	knot_tsig_rdata_set_time_signed(tmp_tsig, time(NULL));
 	knot_tsig_rdata_set_fudge(tmp_tsig, KNOT_TSIG_FUDGE_DEFAULT);
 
-	/* Create wire to be signed. */
-	size_t wire_len = prev_digest_len + to_sign_len + KNOT_TSIG_TIMERS_LENGTH + 2;
-	uint8_t *wire = malloc(wire_len);
-	if (!wire) {
-		knot_rrset_free(tmp_tsig, NULL);
-		return KNOT_ENOMEM;
-	}
-	memset(wire, 0, wire_len);
+	/* Digest the message and the timers. */
+	uint8_t timers[KNOT_TSIG_TIMERS_LENGTH];
+	wire_write_timers(timers, tmp_tsig);
 
-	/* Write previous digest length. */
-	knot_wire_write_u16(wire, prev_digest_len);
-	/* Write previous digest. */
-	memcpy(wire + 2, prev_digest, prev_digest_len);
-	/* Write original message. */
-	memcpy(wire + prev_digest_len + 2, to_sign, to_sign_len);
-	/* Write timers. */
-	wire_write_timers(wire + prev_digest_len + to_sign_len + 2, tmp_tsig);
-
-	int ret = compute_digest(wire, wire_len, digest_tmp, &digest_tmp_len, key);
-	free(wire);
-	if (ret != KNOT_EOK) {
-		knot_rrset_free(tmp_tsig, NULL);
-		*digest_len = 0;
-		return ret;
-	}
+	dnssec_binary_t cover = { .data = (uint8_t *)to_sign, .size = to_sign_len };
+	dnssec_tsig_add(hmac, &cover);
+	cover.data = timers;
+	cover.size = sizeof(timers);
+	dnssec_tsig_add(hmac, &cover);
+	dnssec_tsig_write(hmac, digest_tmp);
 
 	if (digest_tmp_len > *digest_len) {
 		knot_rrset_free(tmp_tsig, NULL);
@@ -482,8 +481,8 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	/* Set other data. */
 	knot_tsig_rdata_set_other_data(tmp_tsig, 0, NULL);
 
-	ret = knot_rrset_to_wire(tmp_tsig, msg + *msg_len,
-	                         msg_max_len - *msg_len, NULL);
+	int ret = knot_rrset_to_wire(tmp_tsig, msg + *msg_len,
+	                             msg_max_len - *msg_len, NULL);
 	if (ret < 0) {
 		knot_rrset_free(tmp_tsig, NULL);
 		*digest_len = 0;
@@ -504,6 +503,119 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
 	return KNOT_EOK;
 }
 
+_public_
+int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
+                        const uint8_t *prev_digest, size_t prev_digest_len,
+                        uint8_t *digest, size_t *digest_len,
+                        const knot_tsig_key_t *key, uint8_t *to_sign,
+                        size_t to_sign_len)
+{
+	if (!msg || !msg_len || !key || !digest || !digest_len) {
+		return KNOT_EINVAL;
+	}
+
+	if (!key->name) {
+		return KNOT_EMALF;
+	}
+
+	dnssec_tsig_ctx_t *hmac = NULL;
+	int ret = dnssec_tsig_new(&hmac, key->algorithm, &key->secret);
+	if (ret != DNSSEC_EOK) {
+		*digest_len = 0;
+		return KNOT_TSIG_EBADSIG;
+	}
+
+	add_prev_digest(hmac, prev_digest, prev_digest_len);
+	ret = sign_next(hmac, msg, msg_len, msg_max_len, digest, digest_len,
+	                key, to_sign, to_sign_len);
+	dnssec_tsig_free(hmac);
+
+	return ret;
+}
+
+static int sign_ctx_hmac(knot_sign_context_t *ctx)
+{
+	if (ctx->hmac != NULL) {
+		return KNOT_EOK;
+	}
+
+	if (ctx->tsig_key.name == NULL) {
+		return KNOT_EMALF;
+	}
+
+	int ret = dnssec_tsig_new(&ctx->hmac, ctx->tsig_key.algorithm,
+	                          &ctx->tsig_key.secret);
+	if (ret != DNSSEC_EOK) {
+		ctx->hmac = NULL;
+		return KNOT_TSIG_EBADSIG;
+	}
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_tsig_sign_skip(knot_sign_context_t *ctx, const uint8_t *msg, size_t msg_len)
+{
+	if (ctx == NULL || msg == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = sign_ctx_hmac(ctx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (ctx->unsigned_count == 0) {
+		add_prev_digest(ctx->hmac, ctx->tsig_digest, ctx->tsig_digestlen);
+	}
+
+	dnssec_binary_t cover = { .data = (uint8_t *)msg, .size = msg_len };
+	dnssec_tsig_add(ctx->hmac, &cover);
+	ctx->unsigned_count++;
+
+	return KNOT_EOK;
+}
+
+_public_
+int knot_tsig_sign_next_ctx(knot_sign_context_t *ctx, uint8_t *msg, size_t *msg_len,
+                            size_t msg_max_len)
+{
+	if (ctx == NULL || msg == NULL || msg_len == NULL || ctx->tsig_digest == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = sign_ctx_hmac(ctx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (ctx->unsigned_count == 0) {
+		add_prev_digest(ctx->hmac, ctx->tsig_digest, ctx->tsig_digestlen);
+	}
+	ctx->unsigned_count = 0;
+
+	size_t digest_len = dnssec_tsig_algorithm_size(ctx->tsig_key.algorithm);
+	ret = sign_next(ctx->hmac, msg, msg_len, msg_max_len, ctx->tsig_digest,
+	                &digest_len, &ctx->tsig_key, msg, *msg_len);
+	if (ret == KNOT_EOK) {
+		ctx->tsig_digestlen = digest_len;
+	}
+
+	return ret;
+}
+
+_public_
+void knot_tsig_sign_ctx_clear(knot_sign_context_t *ctx)
+{
+	if (ctx == NULL) {
+		return;
+	}
+
+	dnssec_tsig_free(ctx->hmac);
+	ctx->hmac = NULL;
+	ctx->unsigned_count = 0;
+}
+
 static int check_digest(const knot_rrset_t *tsig_rr,
                         const uint8_t *wire, size_t size,
                         const uint8_t *request_mac, size_t request_mac_len,
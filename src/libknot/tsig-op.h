@@ -100,6 +100,47 @@ int knot_tsig_sign_next(uint8_t *msg, size_t *msg_len, size_t msg_max_len,
                         const knot_tsig_key_t *key, uint8_t *to_sign,
                         size_t to_sign_len);
 
+/*!
+ * \brief Generate TSIG signature of a 2nd or later message using the context.
+ *
+ * Same as knot_tsig_sign_next() with the previous digest taken from and the
+ * new digest saved to the context. The keyed HMAC state is created on the
+ * first use and kept in the context, thus the key isn't set up again for each
+ * message. The signature also covers the messages passed to
+ * knot_tsig_sign_skip() since the last signed message.
+ *
+ * \param ctx          Signing context with the previous digest.
+ * \param msg          Message to be signed.
+ * \param msg_len      Size of the message in bytes.
+ * \param msg_max_len  Maximum size of the message in bytes.
+ *
+ * \retval KNOT_EOK if successful.
+ */
+int knot_tsig_sign_next_ctx(knot_sign_context_t *ctx, uint8_t *msg, size_t *msg_len,
+                            size_t msg_max_len);
+
+/*!
+ * \brief Leave a 2nd or later message unsigned (RFC 8945, Section 5.3.1).
+ *
+ * The message is digested into the context and covered by the signature
+ * of the next message signed with knot_tsig_sign_next_ctx().
+ *
+ * \note The last message of the response must be signed and there shouldn't
+ *       be more than 99 unsigned messages in a row.
+ *
+ * \param ctx      Signing context.
+ * \param msg      Message left unsigned.
+ * \param msg_len  Size of the message in bytes.
+ *
+ * \retval KNOT_EOK if successful.
+ */
+int knot_tsig_sign_skip(knot_sign_context_t *ctx, const uint8_t *msg, size_t msg_len);
+
+/*!
+ * \brief Free the HMAC state kept in the signing context.
+ */
+void knot_tsig_sign_ctx_clear(knot_sign_context_t *ctx);
+
 /*!
  * \brief Checks incoming request.
  *
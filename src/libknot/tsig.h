@@ -46,6 +46,8 @@ typedef struct {
 	size_t tsig_digestlen;
 	uint64_t tsig_time_signed;
 	size_t pkt_count;
+	dnssec_tsig_ctx_t *hmac;  /*!< Keyed HMAC reused for subsequent messages. */
+	size_t unsigned_count;    /*!< Unsigned messages since the last signed one. */
 } knot_sign_context_t;
 
 /*!
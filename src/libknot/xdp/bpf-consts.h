@@ -25,6 +25,8 @@
 
 #pragma once
 
+#include <linux/types.h>
+
 #define KNOT_XDP_LISTEN_PORT_MASK    0xFFFF0000  /*!< Listen port option mask. */
 
 enum {
@@ -34,4 +36,129 @@ enum {
 	KNOT_XDP_LISTEN_PORT_ROUTE = 1 << 19,    /*!< Consider routing information from kernel. */
 };
 
+#define KNOT_XDP_RRL_CAPACITY    4       /*!< Rate limiting window size in seconds. */
+#define KNOT_XDP_RRL_TABLE_SIZE  65536   /*!< Number of rate limited prefixes. */
+
+/*!
+ * \brief Configuration and counters of the rate limiting in the XDP filter.
+ *
+ * Queries are accounted per source /24 (IPv4) or /56 (IPv6) prefix.
+ */
+struct knot_xdp_rrl {
+	__u32 rate;    /*!< Allowed queries per second from one prefix (0 disables). */
+	__u32 slip;    /*!< Every Nth limited query is passed to user space (0 never). */
+	__u64 dropped; /*!< Number of dropped queries. */
+	__u64 slipped; /*!< Number of limited queries passed to user space. */
+};
+
+#define KNOT_XDP_ANSWER_QNAME_MAX   64    /*!< Longest QNAME answered by the filter. */
+#define KNOT_XDP_ANSWER_DATA_MAX    496   /*!< Longest answer part following the question. */
+#define KNOT_XDP_ANSWER_SIZE_MAX    512   /*!< Longest DNS message answered by the filter. */
+#define KNOT_XDP_ANSWER_TABLE_SIZE  1024  /*!< Number of answers in the filter. */
+
+/*! \brief Flags of the answer key. */
+enum {
+	KNOT_XDP_ANSWER_EDNS = 1 << 0,  /*!< The query has an (empty) OPT record. */
+	KNOT_XDP_ANSWER_DO   = 1 << 1,  /*!< The query has the DO bit set. */
+};
+
+/*!
+ * \brief Configuration and counters of the answers from the XDP filter.
+ */
+struct knot_xdp_answer_conf {
+	__u32 enabled;     /*!< Non-zero if the filter answers the queries. */
+	__u32 generation;  /*!< Current generation, answers of other ones don't match. */
+	__u64 answered;    /*!< Number of queries answered by the filter. */
+};
+
+/*!
+ * \brief Key of an answer in the filter (unused octets must be zero).
+ */
+struct knot_xdp_answer_key {
+	__u32 generation;  /*!< Answer generation. */
+	__u16 qtype;       /*!< Query type (network byte order). */
+	__u8 flags;        /*!< KNOT_XDP_ANSWER_* flags. */
+	__u8 qname_len;    /*!< Length of the QNAME. */
+	__u8 qname[KNOT_XDP_ANSWER_QNAME_MAX]; /*!< Lower-cased QNAME in wire format. */
+};
+
+/*!
+ * \brief Pre-rendered answer of the filter.
+ *
+ * The answer is formed from the query: its header with the flags and counts
+ * replaced (except the RD flag) and the question, followed by the data.
+ */
+struct knot_xdp_answer {
+	__u8 flags[2];     /*!< Header flags octets (RD ignored). */
+	__u8 counts[6];    /*!< ANCOUNT, NSCOUNT, and ARCOUNT (network byte order). */
+	__u16 len;         /*!< Length of the data. */
+	__u8 data[KNOT_XDP_ANSWER_DATA_MAX]; /*!< Sections following the question. */
+};
+
+#define KNOT_XDP_ACL_TABLE_SIZE  16384  /*!< Number of prefixes in the access control. */
+
+/*! \brief Action of an access control prefix. */
+enum {
+	KNOT_XDP_ACL_DENY  = 0,  /*!< Drop the packets from the prefix. */
+	KNOT_XDP_ACL_ALLOW = 1,  /*!< Pass the packets from the prefix. */
+};
+
+/*!
+ * \brief Configuration and counters of the access control in the XDP filter.
+ */
+struct knot_xdp_acl_conf {
+	__u32 enabled;       /*!< Non-zero if the source prefixes are checked. */
+	__u32 default_deny;  /*!< Non-zero if sources without a matching prefix are dropped. */
+	__u64 dropped;       /*!< Number of packets dropped as not matching any prefix. */
+};
+
+/*!
+ * \brief Key of a source prefix (longest prefix match, unused octets must be zero).
+ *
+ * The address family octet precedes the address, so the prefix length
+ * includes its 8 bits.
+ */
+struct knot_xdp_acl_key {
+	__u32 prefixlen;  /*!< Prefix length in bits including the family octet. */
+	__u8 family;      /*!< 4 for IPv4, 6 for IPv6. */
+	__u8 addr[16];    /*!< Address in network byte order. */
+};
+
+/*!
+ * \brief Action and counter of a source prefix.
+ */
+struct knot_xdp_acl_value {
+	__u32 action;   /*!< KNOT_XDP_ACL_DENY or KNOT_XDP_ACL_ALLOW. */
+	__u64 dropped;  /*!< Number of packets dropped due to the prefix. */
+};
+
+/*!
+ * \brief Access control rule of a source prefix.
+ */
+struct knot_xdp_acl_rule {
+	struct knot_xdp_acl_key key;  /*!< Source prefix (address bits beyond the prefix zero). */
+	__u32 action;                 /*!< KNOT_XDP_ACL_DENY or KNOT_XDP_ACL_ALLOW. */
+};
+
+/*!
+ * \brief Interface configuration of the XDP filter.
+ */
+struct knot_xdp_iface_conf {
+	__u32 master_ifindex;  /*!< Index of the bond the interface is a member of, 0 if none. */
+};
+
+#define KNOT_XDP_VLAN_MAX      2  /*!< VLAN tags (802.1Q or QinQ) handled by the filter. */
+#define KNOT_XDP_IPV6_EXT_MAX  4  /*!< IPv6 extension headers handled by the filter. */
+
+/*! \brief Reasons for passing a packet to the kernel network stack. */
+enum knot_xdp_pass_reason {
+	KNOT_XDP_PASS_NOT_IP = 0,  /*!< Neither IPv4 nor IPv6 (e.g. ARP). */
+	KNOT_XDP_PASS_HEADERS,     /*!< Too many VLAN tags or IPv6 extension headers. */
+	KNOT_XDP_PASS_PROTO,       /*!< Neither UDP nor TCP, or TCP not enabled. */
+	KNOT_XDP_PASS_PORT,        /*!< Not to a listening port. */
+	KNOT_XDP_PASS_ROUTE,       /*!< The reply would be routed through another interface. */
+	KNOT_XDP_PASS_NO_NEIGH,    /*!< The link-layer address of the next hop is unknown. */
+	KNOT_XDP_PASS_REASONS
+};
+
 /*! @} */
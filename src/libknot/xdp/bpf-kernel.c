@@ -35,6 +35,8 @@
 /* Assume netdev has no more than 128 queues. */
 #define QUEUE_MAX	128
 
+#define NSEC_PER_SEC	1000000000ULL
+
 /* A set entry here means that the corresponding queue_id
  * has an active AF_XDP socket bound to it. */
 struct bpf_map_def SEC("maps") qidconf_map = {
@@ -50,11 +52,104 @@ struct bpf_map_def SEC("maps") xsks_map = {
 	.max_entries = QUEUE_MAX,
 };
 
+/* Rate limiting configuration and counters common for all queues. */
+struct bpf_map_def SEC("maps") rrl_conf_map = {
+	.type = BPF_MAP_TYPE_ARRAY,
+	.key_size = sizeof(int),
+	.value_size = sizeof(struct knot_xdp_rrl),
+	.max_entries = 1,
+};
+
+/* Token bucket of one source prefix. */
+struct rrl_bucket {
+	__u64 time;    /* Time of the last refill in nanoseconds. */
+	__u32 tokens;  /* Available tokens. */
+	__u32 limited; /* Number of limited queries. */
+};
+
+/* Source prefix (/24 or /56, IPv6 flagged in the last octet) to its bucket. */
+struct bpf_map_def SEC("maps") rrl_map = {
+	.type = BPF_MAP_TYPE_LRU_HASH,
+	.key_size = sizeof(__u64),
+	.value_size = sizeof(struct rrl_bucket),
+	.max_entries = KNOT_XDP_RRL_TABLE_SIZE,
+};
+
+/* Counters of the packets passed to the kernel, indexed by the reason. */
+struct bpf_map_def SEC("maps") pass_stats_map = {
+	.type = BPF_MAP_TYPE_ARRAY,
+	.key_size = sizeof(int),
+	.value_size = sizeof(__u64),
+	.max_entries = KNOT_XDP_PASS_REASONS,
+};
+
+/* Configuration and counters of the answers from the filter. */
+struct bpf_map_def SEC("maps") answer_conf_map = {
+	.type = BPF_MAP_TYPE_ARRAY,
+	.key_size = sizeof(int),
+	.value_size = sizeof(struct knot_xdp_answer_conf),
+	.max_entries = 1,
+};
+
+/* Pre-rendered answers of the hottest queries, filled from user space. */
+struct bpf_map_def SEC("maps") answer_map = {
+	.type = BPF_MAP_TYPE_LRU_HASH,
+	.key_size = sizeof(struct knot_xdp_answer_key),
+	.value_size = sizeof(struct knot_xdp_answer),
+	.max_entries = KNOT_XDP_ANSWER_TABLE_SIZE,
+};
+
+/* Configuration and default counter of the source access control. */
+struct bpf_map_def SEC("maps") acl_conf_map = {
+	.type = BPF_MAP_TYPE_ARRAY,
+	.key_size = sizeof(int),
+	.value_size = sizeof(struct knot_xdp_acl_conf),
+	.max_entries = 1,
+};
+
+/* Denied and allowed source prefixes, filled from user space. */
+struct bpf_map_def SEC("maps") acl_map = {
+	.type = BPF_MAP_TYPE_LPM_TRIE,
+	.key_size = sizeof(struct knot_xdp_acl_key),
+	.value_size = sizeof(struct knot_xdp_acl_value),
+	.max_entries = KNOT_XDP_ACL_TABLE_SIZE,
+	.map_flags = BPF_F_NO_PREALLOC,
+};
+
+/* Interface configuration, filled from user space. */
+struct bpf_map_def SEC("maps") iface_conf_map = {
+	.type = BPF_MAP_TYPE_ARRAY,
+	.key_size = sizeof(int),
+	.value_size = sizeof(struct knot_xdp_iface_conf),
+	.max_entries = 1,
+};
+
+struct vlan_hdr {
+	__be16 tci;
+	__be16 proto;
+} __attribute__((packed));
+
 struct ipv6_frag_hdr {
 	unsigned char nexthdr;
 	unsigned char whatever[7];
 } __attribute__((packed));
 
+/* Common header of the hop-by-hop, routing, and destination options. */
+struct ipv6_ext_hdr {
+	unsigned char nexthdr;
+	unsigned char hdrlen; /* In 8-octet units, not including the first 8 octets. */
+} __attribute__((packed));
+
+static __always_inline
+int pass(int reason)
+{
+	__u64 *counter = bpf_map_lookup_elem(&pass_stats_map, &reason);
+	if (counter) {
+		__sync_fetch_and_add(counter, 1);
+	}
+	return XDP_PASS;
+}
+
 static __always_inline
 int check_route(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
                 const __u8 is_ipv4, const __u32 port_info)
@@ -85,7 +180,14 @@ int check_route(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
 		case BPF_FIB_LKUP_RET_SUCCESS:
 			/* Cross-interface answers are handled thru normal stack. */
 			if (fib.ifindex != ctx->ingress_ifindex) {
-				return XDP_PASS;
+				/* The route of a bond member leads via the bond. */
+				int key = 0;
+				struct knot_xdp_iface_conf *conf =
+					bpf_map_lookup_elem(&iface_conf_map, &key);
+				if (!conf || conf->master_ifindex == 0 ||
+				    fib.ifindex != conf->master_ifindex) {
+					return pass(KNOT_XDP_PASS_ROUTE);
+				}
 			}
 
 			/* Update destination MAC for responding. */
@@ -94,7 +196,7 @@ int check_route(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
 		case BPF_FIB_LKUP_RET_FWD_DISABLED: /* Disabled forwarding on loopback. */
 			return XDP_ABORTED;
 		case BPF_FIB_LKUP_RET_NO_NEIGH: /* Use normal stack to obtain MAC. */
-			return XDP_PASS;
+			return pass(KNOT_XDP_PASS_NO_NEIGH);
 		default:
 			return XDP_DROP;
 		}
@@ -104,6 +206,273 @@ int check_route(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
 	return bpf_redirect_map(&xsks_map, index, 0);
 }
 
+/* Return non-zero if the query should be dropped due to its source. */
+static __always_inline
+int acl_deny(const void *iphdr, const __u8 is_ipv4)
+{
+	int zero = 0;
+	struct knot_xdp_acl_conf *conf = bpf_map_lookup_elem(&acl_conf_map, &zero);
+	if (!conf || !conf->enabled) {
+		return 0;
+	}
+
+	struct knot_xdp_acl_key key = { 0 };
+	if (is_ipv4) {
+		const struct iphdr *ip4 = iphdr;
+		key.prefixlen = 8 + 32;
+		key.family = 4;
+		__builtin_memcpy(key.addr, &ip4->saddr, 4);
+	} else {
+		const struct ipv6hdr *ip6 = iphdr;
+		key.prefixlen = 8 + 128;
+		key.family = 6;
+		__builtin_memcpy(key.addr, &ip6->saddr, 16);
+	}
+
+	struct knot_xdp_acl_value *val = bpf_map_lookup_elem(&acl_map, &key);
+	if (val) {
+		if (val->action == KNOT_XDP_ACL_DENY) {
+			__sync_fetch_and_add(&val->dropped, 1);
+			return 1;
+		}
+		return 0;
+	}
+
+	if (conf->default_deny) {
+		__sync_fetch_and_add(&conf->dropped, 1);
+		return 1;
+	}
+	return 0;
+}
+
+/* Return non-zero if the query should be dropped due to rate limiting. */
+static __always_inline
+int rate_limit(const void *iphdr, const __u8 is_ipv4)
+{
+	int zero = 0;
+	struct knot_xdp_rrl *conf = bpf_map_lookup_elem(&rrl_conf_map, &zero);
+	if (!conf || conf->rate == 0) {
+		return 0;
+	}
+	const __u64 rate = conf->rate;
+	const __u64 capacity = rate * KNOT_XDP_RRL_CAPACITY;
+
+	/* Same prefixes as in the RRL module. */
+	__u64 key = 0;
+	if (is_ipv4) {
+		const struct iphdr *ip4 = iphdr;
+		__builtin_memcpy(&key, &ip4->saddr, 3);
+	} else {
+		const struct ipv6hdr *ip6 = iphdr;
+		__builtin_memcpy(&key, &ip6->saddr, 7);
+		((__u8 *)&key)[7] = 6;
+	}
+
+	__u64 now = bpf_ktime_get_ns();
+	struct rrl_bucket *bucket = bpf_map_lookup_elem(&rrl_map, &key);
+	if (!bucket) {
+		struct rrl_bucket new_bucket = {
+			.time = now,
+			.tokens = capacity - 1,
+		};
+		(void)bpf_map_update_elem(&rrl_map, &key, &new_bucket, BPF_NOEXIST);
+		return 0;
+	}
+
+	/* Add new tokens for each elapsed second. Concurrent updates from
+	 * other CPUs may be lost, which only makes the limit approximate. */
+	__u64 dt = (now - bucket->time) / NSEC_PER_SEC;
+	if (dt > 0) {
+		if (dt > KNOT_XDP_RRL_CAPACITY) {
+			dt = KNOT_XDP_RRL_CAPACITY;
+			bucket->time = now;
+		} else {
+			bucket->time += dt * NSEC_PER_SEC;
+		}
+		__u64 tokens = bucket->tokens + rate * dt;
+		bucket->tokens = (tokens > capacity) ? capacity : tokens;
+	}
+
+	if (bucket->tokens > 0) {
+		bucket->tokens--;
+		return 0;
+	}
+
+	/* Let every Nth limited query through for slipping in user space. */
+	__u32 slip = conf->slip;
+	if (slip > 0 && (bucket->limited++ % slip) == 0) {
+		__sync_fetch_and_add(&conf->slipped, 1);
+		return 0;
+	}
+
+	__sync_fetch_and_add(&conf->dropped, 1);
+	return 1;
+}
+
+static __always_inline
+__u16 ipv4_csum(const __u16 *hdr)
+{
+	__u32 sum = 0;
+#pragma unroll
+	for (int i = 0; i < sizeof(struct iphdr) / sizeof(__u16); i++) {
+		sum += hdr[i];
+	}
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+/* Answer the query from the answer map. Returns XDP_TX if answered,
+ * XDP_DROP if the packet got corrupted, or -1 if not answered (the packet
+ * is unchanged but all packet pointers must be reloaded). */
+static __always_inline
+int answer(struct xdp_md *ctx, const __u32 ip_off)
+{
+	void *data = (void *)(long)ctx->data;
+	void *data_end = (void *)(long)ctx->data_end;
+
+	int zero = 0;
+	struct knot_xdp_answer_conf *conf = bpf_map_lookup_elem(&answer_conf_map, &zero);
+	if (!conf || !conf->enabled) {
+		return -1;
+	}
+
+	if (ip_off > sizeof(struct ethhdr) + KNOT_XDP_VLAN_MAX * sizeof(struct vlan_hdr)) {
+		return -1;
+	}
+	const struct iphdr *ip4 = data + ip_off;
+	const struct udphdr *udp = (void *)ip4 + sizeof(*ip4);
+	const __u8 *dns = (void *)udp + sizeof(*udp);
+	if ((void *)dns + 12 > data_end || ip4->ihl != 5) {
+		return -1;
+	}
+
+	/* Plain query with a single question and an optional OPT record. */
+	if ((dns[2] & 0xfa) != 0 || dns[4] != 0 || dns[5] != 1 || dns[6] != 0 ||
+	    dns[7] != 0 || dns[8] != 0 || dns[9] != 0 || dns[10] != 0 || dns[11] > 1) {
+		return -1;
+	}
+	const __u8 has_opt = dns[11];
+
+	/* Lower-cased QNAME without compression. */
+	struct knot_xdp_answer_key key = { 0 };
+	__u32 label = 0, len = 0;
+#pragma unroll
+	for (int i = 0; i < KNOT_XDP_ANSWER_QNAME_MAX; i++) {
+		const __u8 *pos = dns + 12 + i;
+		if ((void *)pos + 1 > data_end) {
+			return -1;
+		}
+		__u8 c = *pos;
+		if (i == label) {
+			if (c == 0) {
+				len = i + 1;
+				break;
+			} else if (c > 63) {
+				return -1;
+			}
+			label = i + c + 1;
+		} else if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		key.qname[i] = c;
+	}
+	if (len == 0) {
+		return -1;
+	}
+	key.qname_len = len;
+
+	/* QTYPE, QCLASS IN, and the optional empty OPT record ending the query. */
+	const __u32 question_len = 12 + len + 4;
+	const __u8 *q = dns + 12 + len;
+	if ((void *)q + 4 > data_end || q[2] != 0 || q[3] != 1) {
+		return -1;
+	}
+	__builtin_memcpy(&key.qtype, q, sizeof(key.qtype));
+	if (__bpf_ntohs(udp->len) != sizeof(*udp) + question_len + 11 * has_opt) {
+		return -1;
+	}
+	if (has_opt) {
+		const __u8 *opt = q + 4;
+		if ((void *)opt + 11 > data_end) {
+			return -1;
+		}
+		if (opt[0] != 0 || opt[1] != 0 || opt[2] != 41 || opt[5] != 0 ||
+		    opt[6] != 0 || opt[9] != 0 || opt[10] != 0) {
+			return -1;
+		}
+		key.flags = KNOT_XDP_ANSWER_EDNS | ((opt[7] & 0x80) ? KNOT_XDP_ANSWER_DO : 0);
+	}
+	key.generation = conf->generation;
+
+	const struct knot_xdp_answer *ans = bpf_map_lookup_elem(&answer_map, &key);
+	if (!ans || ans->len > KNOT_XDP_ANSWER_DATA_MAX ||
+	    question_len + ans->len > KNOT_XDP_ANSWER_SIZE_MAX) {
+		return -1;
+	}
+	const __u32 dns_len = question_len + ans->len;
+
+	/* The data is copied in 8-octet blocks, the frame may end with padding. */
+	const __u32 frame_len = ip_off + sizeof(*ip4) + sizeof(*udp) + question_len +
+	                        ((ans->len + 7) & ~7);
+	if (bpf_xdp_adjust_tail(ctx, (int)frame_len - (int)(data_end - data)) != 0) {
+		return -1;
+	}
+
+	/* Reload the packet pointers. */
+	data = (void *)(long)ctx->data;
+	data_end = (void *)(long)ctx->data_end;
+	struct ethhdr *eth = data;
+	struct iphdr *ip = data + ip_off;
+	struct udphdr *uh = (void *)ip + sizeof(*ip);
+	__u8 *msg = (void *)uh + sizeof(*uh);
+	if ((void *)msg + question_len > data_end) {
+		return XDP_DROP;
+	}
+
+	/* Copy the data after the question. */
+	__u8 *dst = msg + question_len;
+#pragma unroll
+	for (int i = 0; i < KNOT_XDP_ANSWER_DATA_MAX / 8; i++) {
+		if (i * 8 >= ans->len) {
+			break;
+		}
+		if ((void *)dst + i * 8 + 8 > data_end) {
+			return XDP_DROP;
+		}
+		__builtin_memcpy(dst + i * 8, ans->data + i * 8, 8);
+	}
+
+	/* DNS header: keep the ID, the RD flag, and QDCOUNT. */
+	msg[2] = (ans->flags[0] & ~0x01) | (msg[2] & 0x01);
+	msg[3] = ans->flags[1];
+	__builtin_memcpy(msg + 6, ans->counts, sizeof(ans->counts));
+
+	/* Swap the addresses and the ports. */
+	__u8 mac[ETH_ALEN];
+	__builtin_memcpy(mac, eth->h_dest, ETH_ALEN);
+	__builtin_memcpy(eth->h_dest, eth->h_source, ETH_ALEN);
+	__builtin_memcpy(eth->h_source, mac, ETH_ALEN);
+
+	__be32 addr = ip->saddr;
+	ip->saddr = ip->daddr;
+	ip->daddr = addr;
+	ip->tot_len = __bpf_htons(sizeof(*ip) + sizeof(*uh) + dns_len);
+	ip->ttl = 64;
+	ip->check = 0;
+	ip->check = ipv4_csum((const __u16 *)ip);
+
+	__be16 port = uh->source;
+	uh->source = uh->dest;
+	uh->dest = port;
+	uh->len = __bpf_htons(sizeof(*uh) + dns_len);
+	uh->check = 0; /* Optional for IPv4. */
+
+	__sync_fetch_and_add(&conf->answered, 1);
+
+	return XDP_TX;
+}
+
 static __always_inline
 int process_l4(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
                const void *l4hdr, const __u8 is_ipv4, const __u8 is_tcp,
@@ -141,14 +510,14 @@ int process_l4(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
 	/* Treat specified destination ports. */
 	if (port_info & (KNOT_XDP_LISTEN_PORT_PASS | KNOT_XDP_LISTEN_PORT_DROP)) {
 		if (port_dest < port_conf) {
-			return XDP_PASS;
+			return pass(KNOT_XDP_PASS_PORT);
 		}
 		if (port_info & KNOT_XDP_LISTEN_PORT_DROP) {
 			return XDP_DROP;
 		}
 	} else {
 		if (port_dest != port_conf) {
-			return XDP_PASS;
+			return pass(KNOT_XDP_PASS_PORT);
 		}
 	}
 
@@ -157,6 +526,34 @@ int process_l4(struct xdp_md *ctx, struct ethhdr *eth, const void *iphdr,
 		return XDP_DROP;
 	}
 
+	/* Drop queries from the denied sources. */
+	if (acl_deny(iphdr, is_ipv4)) {
+		return XDP_DROP;
+	}
+
+	/* Drop UDP queries over the rate limit. */
+	if (!is_tcp && rate_limit(iphdr, is_ipv4)) {
+		return XDP_DROP;
+	}
+
+	/* Answer the hottest IPv4 queries directly if the reply isn't routed. */
+	if (!is_tcp && is_ipv4 && !(port_info & KNOT_XDP_LISTEN_PORT_ROUTE)) {
+		const __u32 ip_off = iphdr - (void *)eth;
+		int ret = answer(ctx, ip_off);
+		if (ret >= 0) {
+			return ret;
+		}
+
+		/* The packet pointers are invalidated by the lookup. */
+		data_end = (void *)(long)ctx->data_end;
+		eth = (void *)(long)ctx->data;
+		iphdr = (void *)eth + ip_off;
+		if (ip_off > sizeof(struct ethhdr) + KNOT_XDP_VLAN_MAX * sizeof(struct vlan_hdr) ||
+		    iphdr + sizeof(struct iphdr) > data_end) {
+			return XDP_DROP;
+		}
+	}
+
 	return check_route(ctx, eth, iphdr, is_ipv4, port_info);
 }
 
@@ -181,10 +578,26 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 		return XDP_DROP;
 	}
 	data += sizeof(*eth);
+	__be16 eth_proto = eth->h_proto;
+
+	/* Skip VLAN tags (802.1Q or QinQ). */
+#pragma unroll
+	for (int i = 0; i < KNOT_XDP_VLAN_MAX; i++) {
+		if (eth_proto != __constant_htons(ETH_P_8021Q) &&
+		    eth_proto != __constant_htons(ETH_P_8021AD)) {
+			break;
+		}
+		const struct vlan_hdr *vlan = data;
+		if ((void *)vlan + sizeof(*vlan) > data_end) {
+			return XDP_DROP;
+		}
+		eth_proto = vlan->proto;
+		data += sizeof(*vlan);
+	}
 	iphdr = data;
 
 	/* Parse IPv4 or IPv6 header. */
-	switch (eth->h_proto) {
+	switch (eth_proto) {
 	case __constant_htons(ETH_P_IP):
 		ip4 = iphdr;
 		if ((void *)ip4 + sizeof(*ip4) > data_end) {
@@ -225,20 +638,42 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 
 		ip_proto = ip6->nexthdr;
 		data += sizeof(*ip6);
-		if (ip_proto == IPPROTO_FRAGMENT) {
-			fragmented = 1;
-			const struct ipv6_frag_hdr *frag = data;
-			if ((void *)frag + sizeof(*frag) > data_end) {
-				return XDP_DROP;
+
+		/* Skip the common extension headers. */
+#pragma unroll
+		for (int i = 0; i < KNOT_XDP_IPV6_EXT_MAX; i++) {
+			if (ip_proto == IPPROTO_FRAGMENT) {
+				fragmented = 1;
+				const struct ipv6_frag_hdr *frag = data;
+				if ((void *)frag + sizeof(*frag) > data_end) {
+					return XDP_DROP;
+				}
+				ip_proto = frag->nexthdr;
+				data += sizeof(*frag);
+			} else if (ip_proto == IPPROTO_HOPOPTS ||
+			           ip_proto == IPPROTO_ROUTING ||
+			           ip_proto == IPPROTO_DSTOPTS) {
+				const struct ipv6_ext_hdr *ext = data;
+				if ((void *)ext + sizeof(*ext) > data_end) {
+					return XDP_DROP;
+				}
+				ip_proto = ext->nexthdr;
+				data += (ext->hdrlen + 1) * 8;
+			} else {
+				break;
 			}
-			ip_proto = frag->nexthdr;
-			data += sizeof(*frag);
+		}
+		if (ip_proto == IPPROTO_FRAGMENT || ip_proto == IPPROTO_HOPOPTS ||
+		    ip_proto == IPPROTO_ROUTING || ip_proto == IPPROTO_DSTOPTS) {
+			return pass(KNOT_XDP_PASS_HEADERS);
 		}
 		l4hdr = data;
 		break;
+	case __constant_htons(ETH_P_8021Q):
+	case __constant_htons(ETH_P_8021AD):
+		return pass(KNOT_XDP_PASS_HEADERS);
 	default:
-		/* Also applies to VLAN. */
-		return XDP_PASS;
+		return pass(KNOT_XDP_PASS_NOT_IP);
 	}
 
 	/* Get the queue options. */
@@ -260,7 +695,7 @@ int xdp_redirect_dns_func(struct xdp_md *ctx)
 			break;
 		}
 	default: /* FALLTHROUGH */
-		return XDP_PASS;
+		return pass(KNOT_XDP_PASS_PROTO);
 	}
 
 	return process_l4(ctx, eth, iphdr, l4hdr, is_ipv4, is_tcp, port_info, fragmented);
@@ -16,7 +16,9 @@
 
 #include <bpf/bpf.h>
 #include <linux/if_link.h>
+#include <limits.h>
 #include <net/if.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -28,7 +30,7 @@
 #include "libknot/xdp/eth.h"
 #include "contrib/openbsd/strlcpy.h"
 
-#define NO_BPF_MAPS	2
+#define NO_BPF_MAPS	10
 
 static inline bool IS_ERR_OR_NULL(const void *ptr)
 {
@@ -110,13 +112,55 @@ static void unget_bpf_maps(struct kxsk_iface *iface)
 	if (iface->xsks_map_fd >= 0) {
 		close(iface->xsks_map_fd);
 	}
-	iface->qidconf_map_fd = iface->xsks_map_fd = -1;
+	if (iface->rrl_conf_map_fd >= 0) {
+		close(iface->rrl_conf_map_fd);
+	}
+	if (iface->pass_stats_map_fd >= 0) {
+		close(iface->pass_stats_map_fd);
+	}
+	if (iface->answer_conf_map_fd >= 0) {
+		close(iface->answer_conf_map_fd);
+	}
+	if (iface->answer_map_fd >= 0) {
+		close(iface->answer_map_fd);
+	}
+	if (iface->acl_conf_map_fd >= 0) {
+		close(iface->acl_conf_map_fd);
+	}
+	if (iface->acl_map_fd >= 0) {
+		close(iface->acl_map_fd);
+	}
+	iface->qidconf_map_fd = iface->xsks_map_fd = iface->rrl_conf_map_fd = -1;
+	iface->pass_stats_map_fd = iface->answer_conf_map_fd = iface->answer_map_fd = -1;
+	iface->acl_conf_map_fd = iface->acl_map_fd = -1;
+}
+
+/*!
+ * \brief Stores the index of the bond the interface is a member of into the map.
+ */
+static void set_iface_conf(int map_fd, const char *if_name)
+{
+	struct knot_xdp_iface_conf conf = { 0 };
+
+	char path[64], master[PATH_MAX];
+	(void)snprintf(path, sizeof(path), "/sys/class/net/%s/master", if_name);
+	ssize_t len = readlink(path, master, sizeof(master) - 1);
+	if (len > 0) {
+		master[len] = '\0';
+		const char *name = strrchr(master, '/');
+		conf.master_ifindex = if_nametoindex(name != NULL ? name + 1 : master);
+	}
+
+	int key = 0;
+	(void)bpf_map_update_elem(map_fd, &key, &conf, BPF_ANY);
 }
 
 /*!
- * /brief Get FDs for the two maps and assign them into xsk_info-> fields.
+ * /brief Get FDs for the maps and assign them into xsk_info-> fields.
  *
  * Inspired by xsk_lookup_bpf_maps() from libbpf before qidconf_map elimination.
+ * The rate limiting, statistics, answer, and access control maps are optional
+ * as an older program can be loaded.
  */
 static int get_bpf_maps(int prog_fd, struct kxsk_iface *iface)
 {
@@ -161,6 +205,42 @@ static int get_bpf_maps(int prog_fd, struct kxsk_iface *iface)
 			continue;
 		}
 
+		if (strcmp(map_info.name, "rrl_conf_map") == 0) {
+			iface->rrl_conf_map_fd = fd;
+			continue;
+		}
+
+		if (strcmp(map_info.name, "pass_stats_map") == 0) {
+			iface->pass_stats_map_fd = fd;
+			continue;
+		}
+
+		if (strcmp(map_info.name, "answer_conf_map") == 0) {
+			iface->answer_conf_map_fd = fd;
+			continue;
+		}
+
+		if (strcmp(map_info.name, "answer_map") == 0) {
+			iface->answer_map_fd = fd;
+			continue;
+		}
+
+		if (strcmp(map_info.name, "acl_conf_map") == 0) {
+			iface->acl_conf_map_fd = fd;
+			continue;
+		}
+
+		if (strcmp(map_info.name, "acl_map") == 0) {
+			iface->acl_map_fd = fd;
+			continue;
+		}
+
+		if (strcmp(map_info.name, "iface_conf_map") == 0) {
+			set_iface_conf(fd, iface->if_name);
+			close(fd);
+			continue;
+		}
+
 		close(fd);
 	}
 
@@ -206,6 +286,232 @@ void kxsk_socket_stop(const struct kxsk_iface *iface)
 	bpf_map_delete_elem(iface->xsks_map_fd, &iface->if_queue);
 }
 
+int kxsk_rrl_set(const struct kxsk_iface *iface, uint32_t rate, uint32_t slip)
+{
+	if (iface == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->rrl_conf_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	/* Keep the counters. */
+	int key = 0;
+	struct knot_xdp_rrl rrl = { 0 };
+	int ret = bpf_map_lookup_elem(iface->rrl_conf_map_fd, &key, &rrl);
+	if (ret != 0) {
+		return ret;
+	}
+	rrl.rate = rate;
+	rrl.slip = slip;
+
+	return bpf_map_update_elem(iface->rrl_conf_map_fd, &key, &rrl, 0);
+}
+
+int kxsk_rrl_get(const struct kxsk_iface *iface, struct knot_xdp_rrl *out)
+{
+	if (iface == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->rrl_conf_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	int key = 0;
+	return bpf_map_lookup_elem(iface->rrl_conf_map_fd, &key, out);
+}
+
+int kxsk_answer_conf(const struct kxsk_iface *iface, bool enabled, uint32_t generation)
+{
+	if (iface == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->answer_conf_map_fd < 0 || iface->answer_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	/* Keep the counters. */
+	int key = 0;
+	struct knot_xdp_answer_conf conf = { 0 };
+	int ret = bpf_map_lookup_elem(iface->answer_conf_map_fd, &key, &conf);
+	if (ret != 0) {
+		return ret;
+	}
+	conf.enabled = enabled;
+	conf.generation = generation;
+
+	return bpf_map_update_elem(iface->answer_conf_map_fd, &key, &conf, 0);
+}
+
+int kxsk_answer_set(const struct kxsk_iface *iface, const struct knot_xdp_answer_key *key,
+                    const struct knot_xdp_answer *answer)
+{
+	if (iface == NULL || key == NULL || answer == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->answer_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	return bpf_map_update_elem(iface->answer_map_fd, key, answer, 0);
+}
+
+int kxsk_answer_get(const struct kxsk_iface *iface, struct knot_xdp_answer_conf *out)
+{
+	if (iface == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->answer_conf_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	int key = 0;
+	return bpf_map_lookup_elem(iface->answer_conf_map_fd, &key, out);
+}
+
+static bool acl_key_eq(const struct knot_xdp_acl_key *a, const struct knot_xdp_acl_key *b)
+{
+	return a->prefixlen == b->prefixlen && a->family == b->family &&
+	       memcmp(a->addr, b->addr, sizeof(a->addr)) == 0;
+}
+
+static const struct knot_xdp_acl_rule *acl_rule_find(const struct knot_xdp_acl_rule *rules,
+                                                     size_t count,
+                                                     const struct knot_xdp_acl_key *key)
+{
+	for (size_t i = 0; i < count; i++) {
+		if (acl_key_eq(&rules[i].key, key)) {
+			return &rules[i];
+		}
+	}
+	return NULL;
+}
+
+int kxsk_acl_set(const struct kxsk_iface *iface, const struct knot_xdp_acl_rule *rules,
+                 size_t count)
+{
+	if (iface == NULL || (rules == NULL && count > 0)) {
+		return KNOT_EINVAL;
+	} else if (iface->acl_conf_map_fd < 0 || iface->acl_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	} else if (count > KNOT_XDP_ACL_TABLE_SIZE) {
+		return KNOT_ELIMIT;
+	}
+
+	bool *present = calloc(count + 1, sizeof(*present));
+	if (present == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	/* Collect the prefixes not configured any more (deletion breaks the iteration). */
+	struct knot_xdp_acl_key *stale = NULL;
+	size_t stale_count = 0, stale_max = 0;
+	struct knot_xdp_acl_key key, prev;
+	bool first = true;
+	while (bpf_map_get_next_key(iface->acl_map_fd, first ? NULL : &prev, &key) == 0) {
+		const struct knot_xdp_acl_rule *rule = acl_rule_find(rules, count, &key);
+		if (rule != NULL) {
+			present[rule - rules] = true;
+		} else {
+			if (stale_count == stale_max) {
+				stale_max = (stale_max == 0) ? 16 : 2 * stale_max;
+				struct knot_xdp_acl_key *tmp = realloc(stale, stale_max * sizeof(*stale));
+				if (tmp == NULL) {
+					free(stale);
+					free(present);
+					return KNOT_ENOMEM;
+				}
+				stale = tmp;
+			}
+			stale[stale_count++] = key;
+		}
+		prev = key;
+		first = false;
+	}
+	for (size_t i = 0; i < stale_count; i++) {
+		(void)bpf_map_delete_elem(iface->acl_map_fd, &stale[i]);
+	}
+	free(stale);
+
+	/* Insert or update the configured prefixes, keep the counters. */
+	bool default_deny = false;
+	for (size_t i = 0; i < count; i++) {
+		// The lookup of a present prefix returns the prefix itself.
+		struct knot_xdp_acl_value val = { 0 };
+		if (present[i] &&
+		    (bpf_map_lookup_elem(iface->acl_map_fd, &rules[i].key, &val) != 0 ||
+		     val.action != rules[i].action)) {
+			val.dropped = 0;
+		}
+		val.action = rules[i].action;
+		int ret = bpf_map_update_elem(iface->acl_map_fd, &rules[i].key, &val, 0);
+		if (ret != 0) {
+			free(present);
+			return ret;
+		}
+		if (rules[i].action == KNOT_XDP_ACL_ALLOW) {
+			default_deny = true;
+		}
+	}
+	free(present);
+
+	int zero = 0;
+	struct knot_xdp_acl_conf conf = { 0 };
+	int ret = bpf_map_lookup_elem(iface->acl_conf_map_fd, &zero, &conf);
+	if (ret != 0) {
+		return ret;
+	}
+	conf.enabled = (count > 0);
+	conf.default_deny = default_deny;
+
+	return bpf_map_update_elem(iface->acl_conf_map_fd, &zero, &conf, 0);
+}
+
+int kxsk_acl_get(const struct kxsk_iface *iface, struct knot_xdp_acl_conf *out)
+{
+	if (iface == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->acl_conf_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	int key = 0;
+	return bpf_map_lookup_elem(iface->acl_conf_map_fd, &key, out);
+}
+
+int kxsk_acl_dropped(const struct kxsk_iface *iface, const struct knot_xdp_acl_key *key,
+                     uint64_t *out)
+{
+	if (iface == NULL || key == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->acl_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	/* The lookup of a present prefix returns the prefix itself. */
+	struct knot_xdp_acl_value val;
+	int ret = bpf_map_lookup_elem(iface->acl_map_fd, key, &val);
+	if (ret != 0) {
+		return ret;
+	}
+	*out = val.dropped;
+
+	return KNOT_EOK;
+}
+
+int kxsk_pass_get(const struct kxsk_iface *iface, uint64_t out[KNOT_XDP_PASS_REASONS])
+{
+	if (iface == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	} else if (iface->pass_stats_map_fd < 0) {
+		return KNOT_ENOTSUP;
+	}
+
+	for (int key = 0; key < KNOT_XDP_PASS_REASONS; key++) {
+		int ret = bpf_map_lookup_elem(iface->pass_stats_map_fd, &key, &out[key]);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 int kxsk_iface_new(const char *if_name, int if_queue, knot_xdp_load_bpf_t load_bpf,
                    struct kxsk_iface **out_iface)
 {
@@ -225,7 +531,9 @@ int kxsk_iface_new(const char *if_name, int if_queue, knot_xdp_load_bpf_t load_b
 		return KNOT_EINVAL;
 	}
 	iface->if_queue = if_queue;
-	iface->qidconf_map_fd = iface->xsks_map_fd = -1;
+	iface->qidconf_map_fd = iface->xsks_map_fd = iface->rrl_conf_map_fd = -1;
+	iface->pass_stats_map_fd = iface->answer_conf_map_fd = iface->answer_map_fd = -1;
+	iface->acl_conf_map_fd = iface->acl_map_fd = -1;
 
 	int ret;
 	switch (load_bpf) {
@@ -41,6 +41,18 @@ struct kxsk_iface {
 	int qidconf_map_fd;
 	/*! XSK BPF map file descriptor. */
 	int xsks_map_fd;
+	/*! Rate limiting BPF map file descriptor (-1 if not supported). */
+	int rrl_conf_map_fd;
+	/*! Statistics BPF map file descriptor (-1 if not supported). */
+	int pass_stats_map_fd;
+	/*! Answers configuration BPF map file descriptor (-1 if not supported). */
+	int answer_conf_map_fd;
+	/*! Answers BPF map file descriptor (-1 if not supported). */
+	int answer_map_fd;
+	/*! Access control configuration BPF map file descriptor (-1 if not supported). */
+	int acl_conf_map_fd;
+	/*! Access control prefixes BPF map file descriptor (-1 if not supported). */
+	int acl_map_fd;
 
 	/*! BPF program object. */
 	struct bpf_object *prog_obj;
@@ -83,6 +95,12 @@ struct knot_xdp_socket {
 
 	/*! The limit of frame size. */
 	unsigned frame_limit;
+
+	/*! The driver negotiated the zero-copy mode. */
+	bool zero_copy;
+
+	/*! Busy polling is enabled on the socket. */
+	bool busy_poll;
 };
 
 /*!
@@ -126,4 +144,106 @@ int kxsk_socket_start(const struct kxsk_iface *iface, uint32_t listen_port,
  */
 void kxsk_socket_stop(const struct kxsk_iface *iface);
 
+/*!
+ * \brief Set the rate limiting parameters of the BPF program.
+ *
+ * \note The parameters are common for all queues of the interface.
+ *
+ * \param iface  Interface context.
+ * \param rate   Allowed queries per second from one prefix (0 disables).
+ * \param slip   Every Nth limited query is passed to user space (0 never).
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_rrl_set(const struct kxsk_iface *iface, uint32_t rate, uint32_t slip);
+
+/*!
+ * \brief Read back the rate limiting parameters and counters.
+ *
+ * \param iface  Interface context.
+ * \param out    Output: current rate limiting state.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_rrl_get(const struct kxsk_iface *iface, struct knot_xdp_rrl *out);
+
+/*!
+ * \brief Enable or disable the answers of the BPF program.
+ *
+ * \param iface       Interface context.
+ * \param enabled     Answer the queries from the answer map.
+ * \param generation  Current answer generation.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_answer_conf(const struct kxsk_iface *iface, bool enabled, uint32_t generation);
+
+/*!
+ * \brief Insert or replace an answer of the BPF program.
+ *
+ * \param iface   Interface context.
+ * \param key     Answer key.
+ * \param answer  Pre-rendered answer.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_answer_set(const struct kxsk_iface *iface, const struct knot_xdp_answer_key *key,
+                    const struct knot_xdp_answer *answer);
+
+/*!
+ * \brief Read back the answers configuration and counters.
+ *
+ * \param iface  Interface context.
+ * \param out    Output: current answers state.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_answer_get(const struct kxsk_iface *iface, struct knot_xdp_answer_conf *out);
+
+/*!
+ * \brief Replace the access control rules of the BPF program.
+ *
+ * \note The counters of the prefixes present before and after are kept.
+ *
+ * \param iface  Interface context.
+ * \param rules  Source prefix rules.
+ * \param count  Number of the rules (0 disables the access control).
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_acl_set(const struct kxsk_iface *iface, const struct knot_xdp_acl_rule *rules,
+                 size_t count);
+
+/*!
+ * \brief Read back the access control configuration and the default counter.
+ *
+ * \param iface  Interface context.
+ * \param out    Output: current access control state.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_acl_get(const struct kxsk_iface *iface, struct knot_xdp_acl_conf *out);
+
+/*!
+ * \brief Read the number of packets dropped due to the source prefix.
+ *
+ * \param iface  Interface context.
+ * \param key    Configured source prefix.
+ * \param out    Output: number of dropped packets.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_acl_dropped(const struct kxsk_iface *iface, const struct knot_xdp_acl_key *key,
+                     uint64_t *out);
+
+/*!
+ * \brief Read the counters of the packets passed to the kernel.
+ *
+ * \param iface  Interface context.
+ * \param out    Output: counters indexed by enum knot_xdp_pass_reason.
+ *
+ * \return KNOT_E* or -errno
+ */
+int kxsk_pass_get(const struct kxsk_iface *iface, uint64_t out[KNOT_XDP_PASS_REASONS]);
+
 /*! @} */
@@ -21,6 +21,8 @@
 #include <linux/if.h>
 #include <linux/if_link.h>
 #include <linux/sockios.h>
+#include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
@@ -99,6 +101,41 @@ int knot_eth_mtu(const char *devname)
 	return ret;
 }
 
+_public_
+int knot_eth_bond_members(const char *devname, char *out, size_t out_len)
+{
+	if (devname == NULL || out == NULL || out_len == 0) {
+		return KNOT_EINVAL;
+	}
+
+	char path[64 + IFNAMSIZ];
+	(void)snprintf(path, sizeof(path), "/sys/class/net/%s/bonding/slaves", devname);
+
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		return (errno == ENOENT) ? 0 : knot_map_errno();
+	}
+
+	*out = '\0';
+	int ret = 0;
+	char name[IFNAMSIZ + 1];
+	while (fscanf(file, "%16s", name) == 1) {
+		size_t len = strlen(out);
+		if (len + (len > 0) + strlen(name) + 1 > out_len) {
+			ret = KNOT_ESPACE;
+			break;
+		}
+		if (len > 0) {
+			out[len++] = ' ';
+		}
+		strlcpy(out + len, name, out_len - len);
+		ret++;
+	}
+
+	fclose(file);
+	return ret;
+}
+
 _public_
 int knot_eth_name_from_addr(const struct sockaddr_storage *addr, char *out,
                             size_t out_len)
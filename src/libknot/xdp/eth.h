@@ -50,6 +50,19 @@ int knot_eth_queues(const char *devname);
  */
 int knot_eth_mtu(const char *devname);
 
+/*!
+ * \brief Get the member (slave) interfaces of a bonding interface.
+ *
+ * \param devname  Name of the ethdev (e.g. bond0).
+ * \param out      Output buffer for the member names separated by a space.
+ * \param out_len  Size of the output buffer.
+ *
+ * \retval < 0   KNOT_E* if error.
+ * \retval 0     The interface isn't a bond or has no members.
+ * \return > 0   Number of the members.
+ */
+int knot_eth_bond_members(const char *devname, char *out, size_t out_len);
+
 /*!
  * \brief Get the corresponding network interface name for the address.
  *
@@ -39,6 +39,9 @@ typedef enum {
 	KNOT_XDP_MSG_FIN   = (1 << 4), /*!< FIN flag set (TCP only). */
 	KNOT_XDP_MSG_RST   = (1 << 5), /*!< RST flag set (TCP only). */
 	KNOT_XDP_MSG_MSS   = (1 << 6), /*!< MSS option in TCP header (TCP only). */
+	KNOT_XDP_MSG_WSC   = (1 << 7), /*!< Window scale option in TCP header (TCP only). */
+	KNOT_XDP_MSG_VLAN  = (1 << 8), /*!< VLAN tagged (802.1Q). */
+	KNOT_XDP_MSG_QINQ  = (1 << 9), /*!< Double VLAN tagged (QinQ), along with VLAN flag. */
 } knot_xdp_msg_flag_t;
 
 /*! \brief Packet description with src & dst MAC & IP addrs + DNS payload. */
@@ -47,11 +50,15 @@ typedef struct knot_xdp_msg {
 	struct sockaddr_in6 ip_to;
 	uint8_t eth_from[ETH_ALEN];
 	uint8_t eth_to[ETH_ALEN];
+	uint16_t vlan_tpid[2]; /*!< VLAN tag protocol IDs, the outer one first. */
+	uint16_t vlan_tci[2];  /*!< VLAN tag control information. */
 	knot_xdp_msg_flag_t flags;
 	struct iovec payload;
 	uint32_t seqno;
 	uint32_t ackno;
 	uint16_t mss;
+	uint16_t win;
+	uint8_t win_scale;
 } knot_xdp_msg_t;
 
 /*! @} */
@@ -53,11 +53,15 @@ inline static void msg_init(knot_xdp_msg_t *msg, knot_xdp_msg_flag_t flags)
 
 inline static void msg_init_reply(knot_xdp_msg_t *msg, const knot_xdp_msg_t *query)
 {
-	msg_init_base(msg, query->flags & (KNOT_XDP_MSG_IPV6 | KNOT_XDP_MSG_TCP | KNOT_XDP_MSG_MSS));
+	msg_init_base(msg, query->flags & (KNOT_XDP_MSG_IPV6 | KNOT_XDP_MSG_TCP | KNOT_XDP_MSG_MSS |
+	                                   KNOT_XDP_MSG_VLAN | KNOT_XDP_MSG_QINQ));
 
 	memcpy(msg->eth_from, query->eth_to,   ETH_ALEN);
 	memcpy(msg->eth_to,   query->eth_from, ETH_ALEN);
 
+	memcpy(msg->vlan_tpid, query->vlan_tpid, sizeof(msg->vlan_tpid));
+	memcpy(msg->vlan_tci,  query->vlan_tci,  sizeof(msg->vlan_tci));
+
 	memcpy(&msg->ip_from, &query->ip_to,   sizeof(msg->ip_from));
 	memcpy(&msg->ip_to,   &query->ip_from, sizeof(msg->ip_to));
 
@@ -22,6 +22,7 @@
 #include <linux/tcp.h>
 #include <linux/udp.h>
 #include <netinet/in.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include "libknot/endian.h"
@@ -55,6 +56,22 @@ enum {
 	PROT_TCP_OPT_LEN_WSC = 3,
 };
 
+struct prot_vlan_hdr {
+	uint16_t tci;
+	uint16_t proto;
+};
+
+// Common header of the hop-by-hop, routing, and destination options.
+struct prot_ipv6_ext_hdr {
+	uint8_t nexthdr;
+	uint8_t hdrlen;
+};
+
+inline static bool prot_vlan_proto(uint16_t proto)
+{
+	return proto == __constant_htons(ETH_P_8021Q) || proto == __constant_htons(ETH_P_8021AD);
+}
+
 inline static void *prot_read_tcp(void *data, knot_xdp_msg_t *msg, uint16_t *src_port, uint16_t *dst_port)
 {
 	const struct tcphdr *tcp = data;
@@ -76,6 +93,7 @@ inline static void *prot_read_tcp(void *data, knot_xdp_msg_t *msg, uint16_t *src
 
 	msg->seqno = be32toh(tcp->seq);
 	msg->ackno = be32toh(tcp->ack_seq);
+	msg->win = be16toh(tcp->window);
 
 	*src_port = tcp->source;
 	*dst_port = tcp->dest;
@@ -87,7 +105,7 @@ inline static void *prot_read_tcp(void *data, knot_xdp_msg_t *msg, uint16_t *src
 			continue;
 		}
 
-		if (opts + 1 > hdr_end || opts + opts[1] > hdr_end) {
+		if (opts + 1 >= hdr_end || opts[1] < 2 || opts + opts[1] > hdr_end) {
 			// Malformed option.
 			break;
 		}
@@ -98,6 +116,11 @@ inline static void *prot_read_tcp(void *data, knot_xdp_msg_t *msg, uint16_t *src
 			msg->mss = be16toh(msg->mss);
 		}
 
+		if (opts[0] == PROT_TCP_OPT_WSC && opts[1] == PROT_TCP_OPT_LEN_WSC) {
+			msg->flags |= KNOT_XDP_MSG_WSC;
+			msg->win_scale = opts[2] > 14 ? 14 : opts[2]; // RFC 7323 limit
+		}
+
 		opts += opts[1];
 	}
 
@@ -153,10 +176,19 @@ inline static void *prot_read_ipv6(void *data, knot_xdp_msg_t *msg, void **data_
 	data += sizeof(*ip6);
 	*data_end = data + be16toh(ip6->payload_len);
 
-	if (ip6->nexthdr == IPPROTO_TCP) {
+	// Extension headers (except fragment) are allowed by the BPF filter.
+	uint8_t nexthdr = ip6->nexthdr;
+	while (nexthdr == IPPROTO_HOPOPTS || nexthdr == IPPROTO_ROUTING ||
+	       nexthdr == IPPROTO_DSTOPTS) {
+		const struct prot_ipv6_ext_hdr *ext = data;
+		nexthdr = ext->nexthdr;
+		data += (ext->hdrlen + 1) * 8;
+	}
+
+	if (nexthdr == IPPROTO_TCP) {
 		return prot_read_tcp(data, msg, &src->sin6_port, &dst->sin6_port);
 	} else {
-		assert(ip6->nexthdr == IPPROTO_UDP);
+		assert(nexthdr == IPPROTO_UDP);
 		return prot_read_udp(data, &src->sin6_port, &dst->sin6_port);
 	}
 }
@@ -171,10 +203,21 @@ inline static void *prot_read_eth(void *data, knot_xdp_msg_t *msg, void **data_e
 
 	data += sizeof(*eth);
 
-	if (eth->h_proto == __constant_htons(ETH_P_IPV6)) {
+	// At most two tags are allowed by the BPF filter.
+	uint16_t proto = eth->h_proto;
+	for (int i = 0; i < 2 && prot_vlan_proto(proto); i++) {
+		const struct prot_vlan_hdr *vlan = data;
+		msg->flags |= (i == 0) ? KNOT_XDP_MSG_VLAN : KNOT_XDP_MSG_QINQ;
+		msg->vlan_tpid[i] = be16toh(proto);
+		msg->vlan_tci[i] = be16toh(vlan->tci);
+		proto = vlan->proto;
+		data += sizeof(*vlan);
+	}
+
+	if (proto == __constant_htons(ETH_P_IPV6)) {
 		return prot_read_ipv6(data, msg, data_end);
 	} else {
-		assert(eth->h_proto == __constant_htons(ETH_P_IP));
+		assert(proto == __constant_htons(ETH_P_IP));
 		return prot_read_ipv4(data, msg, data_end);
 	}
 }
@@ -187,6 +230,13 @@ inline static size_t prot_write_hdrs_len(const knot_xdp_msg_t *msg)
 		res += sizeof(struct ipv6hdr) - sizeof(struct iphdr);
 	}
 
+	if (msg->flags & KNOT_XDP_MSG_VLAN) {
+		res += sizeof(struct prot_vlan_hdr);
+		if (msg->flags & KNOT_XDP_MSG_QINQ) {
+			res += sizeof(struct prot_vlan_hdr);
+		}
+	}
+
 	if (msg->flags & KNOT_XDP_MSG_TCP) {
 		res += sizeof(struct tcphdr) - sizeof(struct udphdr) + 4; // 4 == PROT_TCP_OPT_LEN_WSC + align
 
@@ -399,11 +449,21 @@ inline static void prot_write_eth(void *data, const knot_xdp_msg_t *msg,
 
 	data += sizeof(*eth);
 
+	// The protocol field is followed by the VLAN tags if any.
+	int vlans = !!(msg->flags & KNOT_XDP_MSG_VLAN) + !!(msg->flags & KNOT_XDP_MSG_QINQ);
+	for (int i = 0; i < vlans; i++) {
+		uint16_t tag[2] = { htobe16(msg->vlan_tpid[i]), htobe16(msg->vlan_tci[i]) };
+		memcpy(data - sizeof(tag[0]), tag, sizeof(tag));
+		data += sizeof(struct prot_vlan_hdr);
+	}
+
+	uint16_t proto = (msg->flags & KNOT_XDP_MSG_IPV6) ? __constant_htons(ETH_P_IPV6) :
+	                                                    __constant_htons(ETH_P_IP);
+	memcpy(data - sizeof(proto), &proto, sizeof(proto));
+
 	if (msg->flags & KNOT_XDP_MSG_IPV6) {
-		eth->h_proto = __constant_htons(ETH_P_IPV6);
 		prot_write_ipv6(data, msg, data_end, tcp_mss);
 	} else {
-		eth->h_proto = __constant_htons(ETH_P_IP);
 		prot_write_ipv4(data, msg, data_end, tcp_mss);
 	}
 }
@@ -59,9 +59,33 @@ static uint64_t hash_four_tuple(const struct sockaddr_in6 *rem, const struct soc
 	return SipHash24_End(&ctx);
 }
 
+/*
+ * The lists follow the table structure in the same allocation. All of them
+ * are ordered by the last activity of the connections:
+ * - timeout: connections not closed by the sweep yet,
+ * - closing: connections being closed, including the ones closed by the sweep,
+ * - inbufs: connections with a partial DNS message buffered,
+ * - resend: connections with the retransmission timer running, ordered by
+ *   the last arming of the timer.
+ */
 static list_t *tcp_table_timeout(knot_tcp_table_t *table)
 {
-	return (list_t *)&table->conns[table->size];
+	return (list_t *)(table + 1);
+}
+
+static list_t *tcp_table_closing(knot_tcp_table_t *table)
+{
+	return (list_t *)(table + 1) + 1;
+}
+
+static list_t *tcp_table_inbufs(knot_tcp_table_t *table)
+{
+	return (list_t *)(table + 1) + 2;
+}
+
+static list_t *tcp_table_resend(knot_tcp_table_t *table)
+{
+	return (list_t *)(table + 1) + 3;
 }
 
 static node_t *tcp_conn_node(knot_tcp_conn_t *conn)
@@ -69,17 +93,79 @@ static node_t *tcp_conn_node(knot_tcp_conn_t *conn)
 	return (node_t *)&conn->list_node_placeholder;
 }
 
+static node_t *tcp_conn_inbuf_node(knot_tcp_conn_t *conn)
+{
+	return (node_t *)&conn->inbuf_node_placeholder;
+}
+
+static knot_tcp_conn_t *tcp_conn_from_inbuf_node(node_t *node)
+{
+	return (knot_tcp_conn_t *)((uint8_t *)node - offsetof(knot_tcp_conn_t, inbuf_node_placeholder));
+}
+
+static bool tcp_conn_has_inbuf_node(knot_tcp_conn_t *conn)
+{
+	return tcp_conn_inbuf_node(conn)->next != NULL;
+}
+
+static node_t *tcp_conn_resend_node(knot_tcp_conn_t *conn)
+{
+	return (node_t *)&conn->resend_node_placeholder;
+}
+
+static knot_tcp_conn_t *tcp_conn_from_resend_node(node_t *node)
+{
+	return (knot_tcp_conn_t *)((uint8_t *)node - offsetof(knot_tcp_conn_t, resend_node_placeholder));
+}
+
+static bool tcp_conn_has_resend_node(knot_tcp_conn_t *conn)
+{
+	return tcp_conn_resend_node(conn)->next != NULL;
+}
+
+// Remember the VLAN tags for the replies, unused tags are zero.
+static void tcp_conn_set_vlan(knot_tcp_conn_t *conn, const knot_xdp_msg_t *msg)
+{
+	memset(conn->vlan_tpid, 0, sizeof(conn->vlan_tpid));
+	memset(conn->vlan_tci, 0, sizeof(conn->vlan_tci));
+	int vlans = !!(msg->flags & KNOT_XDP_MSG_VLAN) + !!(msg->flags & KNOT_XDP_MSG_QINQ);
+	for (int i = 0; i < vlans; i++) {
+		conn->vlan_tpid[i] = msg->vlan_tpid[i];
+		conn->vlan_tci[i] = msg->vlan_tci[i];
+	}
+}
+
+// Bytes of the data sent and neither acknowledged nor timed out.
+static uint32_t tcp_conn_inflight(const knot_tcp_conn_t *conn)
+{
+	uint32_t res = 0;
+	for (const knot_tcp_outbuf_t *ob = conn->outbufs; ob != NULL && ob->assigned; ob = ob->next) {
+		if (ob->sent) {
+			res += ob->len;
+		}
+	}
+	return res;
+}
+
 _public_
 knot_tcp_table_t *knot_tcp_table_new(size_t size)
 {
-	knot_tcp_table_t *table = calloc(1, sizeof(*table) + sizeof(list_t) +
-	                                    size * sizeof(table->conns[0]));
+	knot_tcp_table_t *table = calloc(1, sizeof(*table) + 4 * sizeof(list_t));
 	if (table == NULL) {
 		return table;
 	}
 
+	table->conns = calloc(size, sizeof(table->conns[0]));
+	if (table->conns == NULL) {
+		free(table);
+		return NULL;
+	}
+
 	table->size = size;
 	init_list(tcp_table_timeout(table));
+	init_list(tcp_table_closing(table));
+	init_list(tcp_table_inbufs(table));
+	init_list(tcp_table_resend(table));
 
 	assert(sizeof(table->hash_secret) == sizeof(SIPHASH_KEY));
 	table->hash_secret[0] = dnssec_random_uint64_t();
@@ -88,14 +174,56 @@ knot_tcp_table_t *knot_tcp_table_new(size_t size)
 	return table;
 }
 
+_public_
+int knot_tcp_table_resize(knot_tcp_table_t *table, size_t size)
+{
+	if (table == NULL || size == 0) {
+		return KNOT_EINVAL;
+	}
+	if (size == table->size) {
+		return KNOT_EOK;
+	}
+
+	knot_tcp_conn_t **conns = calloc(size, sizeof(conns[0]));
+	if (conns == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	for (size_t i = 0; i < table->size; i++) {
+		knot_tcp_conn_t *conn = table->conns[i], *next;
+		for (; conn != NULL; conn = next) {
+			next = conn->next;
+			uint64_t hash = hash_four_tuple(&conn->ip_rem, &conn->ip_loc, table);
+			knot_tcp_conn_t **addto = conns + (hash % size);
+			conn->next = *addto;
+			*addto = conn;
+		}
+	}
+
+	free(table->conns);
+	table->conns = conns;
+	table->size = size;
+
+	return KNOT_EOK;
+}
+
+static void tcp_table_free_list(list_t *list)
+{
+	knot_tcp_conn_t *conn, *next;
+	WALK_LIST_DELSAFE(conn, next, *list) {
+		free(conn->inbuf.iov_base);
+		tcp_outbufs_free(&conn->outbufs, &conn->outbufs_last, NULL);
+		free(conn);
+	}
+}
+
 _public_
 void knot_tcp_table_free(knot_tcp_table_t *table)
 {
 	if (table != NULL) {
-		knot_tcp_conn_t *conn, *next;
-		WALK_LIST_DELSAFE(conn, next, *tcp_table_timeout(table)) {
-			free(conn);
-		}
+		tcp_table_free_list(tcp_table_timeout(table));
+		tcp_table_free_list(tcp_table_closing(table));
+		free(table->conns);
 		free(table);
 	}
 }
@@ -110,8 +238,6 @@ static knot_tcp_conn_t **tcp_table_lookup(const struct sockaddr_in6 *rem,
 	while (*res != NULL) {
 		if (memcmp(&(*res)->ip_rem, rem, sdl) == 0 &&
 		    memcmp(&(*res)->ip_loc, loc, sdl) == 0) {
-			rem_node(tcp_conn_node(*res));
-			add_tail(tcp_table_timeout(table), tcp_conn_node(*res));
 			break;
 		}
 		res = &(*res)->next;
@@ -119,13 +245,54 @@ static knot_tcp_conn_t **tcp_table_lookup(const struct sockaddr_in6 *rem,
 	return res;
 }
 
+// Move the connection to the end of the lists, as the most recently active.
+// Any activity of the peer also re-arms the retransmission timer.
+static void tcp_table_touch(knot_tcp_conn_t *conn, knot_tcp_table_t *table)
+{
+	conn->last_active = get_timestamp();
+	conn->last_resend = conn->last_active;
+
+	rem_node(tcp_conn_node(conn));
+	add_tail(conn->state == XDP_TCP_CLOSING ? tcp_table_closing(table) :
+	                                          tcp_table_timeout(table),
+	         tcp_conn_node(conn));
+
+	if (tcp_conn_has_inbuf_node(conn)) {
+		rem_node(tcp_conn_inbuf_node(conn));
+		add_tail(tcp_table_inbufs(table), tcp_conn_inbuf_node(conn));
+	}
+
+	if (tcp_conn_has_resend_node(conn)) {
+		rem_node(tcp_conn_resend_node(conn));
+	}
+	add_tail(tcp_table_resend(table), tcp_conn_resend_node(conn));
+}
+
+// Keeps the connections with a partial DNS message buffered in the inbuf list.
+static void tcp_table_inbuf_changed(knot_tcp_conn_t *conn, knot_tcp_table_t *table)
+{
+	if (tcp_conn_has_inbuf_node(conn)) {
+		rem_node(tcp_conn_inbuf_node(conn));
+	}
+	if (conn->inbuf.iov_len > 0) {
+		add_tail(tcp_table_inbufs(table), tcp_conn_inbuf_node(conn));
+	}
+}
+
 static void tcp_table_del_conn(knot_tcp_conn_t **todel)
 {
 	knot_tcp_conn_t *conn = *todel;
 	if (conn != NULL) {
 		*todel = conn->next; // remove from conn-table linked list
 		rem_node(tcp_conn_node(conn)); // remove from timeout double-linked list
+		if (tcp_conn_has_inbuf_node(conn)) {
+			rem_node(tcp_conn_inbuf_node(conn));
+		}
+		if (tcp_conn_has_resend_node(conn)) {
+			rem_node(tcp_conn_resend_node(conn));
+		}
 		free(conn->inbuf.iov_base);
+		tcp_outbufs_free(&conn->outbufs, &conn->outbufs_last, NULL);
 		free(conn);
 	}
 }
@@ -163,16 +330,29 @@ static int tcp_table_add(knot_xdp_msg_t *msg, uint64_t hash, knot_tcp_table_t *t
 
 	memcpy(&c->last_eth_rem, &msg->eth_from, sizeof(c->last_eth_rem));
 	memcpy(&c->last_eth_loc, &msg->eth_to,   sizeof(c->last_eth_loc));
+	tcp_conn_set_vlan(c, msg);
 
 	c->seqno = msg->seqno;
 	c->ackno = msg->ackno;
 	c->acked = msg->ackno;
+	c->mss = MAX(msg->mss, 536); // minimal MSS, most importantly not zero!
+
+	// The window in a SYN is never scaled.
+	c->window_scale = (msg->flags & KNOT_XDP_MSG_WSC) ? msg->win_scale : 0;
+	c->window_size = (uint32_t)msg->win << ((msg->flags & KNOT_XDP_MSG_SYN) ? 0 : c->window_scale);
+	c->cong_window = MIN(10 * c->mss, MAX(2 * c->mss, 14600)); // RFC 6928
+	c->ssthresh = UINT32_MAX;
 
 	c->last_active = get_timestamp();
+	c->last_resend = c->last_active;
 	add_tail(tcp_table_timeout(table), tcp_conn_node(c));
+	memset(tcp_conn_inbuf_node(c), 0, sizeof(node_t));
+	add_tail(tcp_table_resend(table), tcp_conn_resend_node(c));
 
 	c->state = XDP_TCP_NORMAL;
 	memset(&c->inbuf, 0, sizeof(c->inbuf));
+	c->outbufs = NULL;
+	c->outbufs_last = NULL;
 
 	c->next = *addto;
 	*addto = c;
@@ -184,6 +364,36 @@ static int tcp_table_add(knot_xdp_msg_t *msg, uint64_t hash, knot_tcp_table_t *t
 
 knot_dynarray_define(knot_tcp_relay, knot_tcp_relay_t, DYNARRAY_VISIBILITY_PUBLIC)
 
+// Process the acknowledgment and the window advertised by the peer.
+static void tcp_conn_ack(knot_tcp_conn_t *conn, const knot_xdp_msg_t *msg)
+{
+	conn->acked = msg->ackno;
+	conn->window_size = (uint32_t)msg->win << conn->window_scale;
+
+	size_t acked = tcp_outbufs_ack(&conn->outbufs, &conn->outbufs_last, msg->ackno);
+	if (acked == 0) {
+		return;
+	}
+
+	uint32_t incr;
+	if (conn->cong_window < conn->ssthresh) { // slow start
+		incr = MIN(acked, conn->mss);
+	} else { // congestion avoidance
+		incr = MAX((uint32_t)conn->mss * conn->mss / conn->cong_window, 1);
+	}
+	conn->cong_window = MIN(conn->cong_window + incr, UINT32_MAX / 2);
+}
+
+static bool tcp_conn_unsent(const knot_tcp_conn_t *conn)
+{
+	for (const knot_tcp_outbuf_t *ob = conn->outbufs; ob != NULL; ob = ob->next) {
+		if (!ob->sent) {
+			return true;
+		}
+	}
+	return false;
+}
+
 static bool check_seq_ack(const knot_xdp_msg_t *msg, const knot_tcp_conn_t *conn)
 {
 	if (conn == NULL || conn->seqno != msg->seqno) {
@@ -243,14 +453,23 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 			(*conn)->seqno = knot_tcp_next_seqno(msg);
 			memcpy((*conn)->last_eth_rem, msg->eth_from, sizeof((*conn)->last_eth_rem));
 			memcpy((*conn)->last_eth_loc, msg->eth_to, sizeof((*conn)->last_eth_loc));
-			(*conn)->last_active = get_timestamp();
+			tcp_conn_set_vlan(*conn, msg);
+			tcp_table_touch(*conn, tcp_table);
 			if (msg->flags & KNOT_XDP_MSG_ACK) {
-				(*conn)->acked = msg->ackno;
+				tcp_conn_ack(*conn, msg);
 			}
 		}
 
 		knot_tcp_relay_t relay = { .msg = msg, .conn = *conn };
 
+		// The connection isn't removed below if not closing, reset or finished.
+		knot_tcp_conn_t *unsent = NULL;
+		if (seq_ack_match && (*conn)->state != XDP_TCP_CLOSING &&
+		    !(msg->flags & (KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_RST)) &&
+		    tcp_conn_unsent(*conn)) {
+			unsent = *conn;
+		}
+
 		// process incoming data
 		if (seq_ack_match && (msg->flags & KNOT_XDP_MSG_ACK) && msg->payload.iov_len > 0) {
 			resp_ack(msg, KNOT_XDP_MSG_ACK);
@@ -259,6 +478,7 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 			struct iovec msg_payload = msg->payload, tofree;
 			ret = tcp_inbuf_update(&(*conn)->inbuf, &msg_payload,
 			                       &tofree, &tcp_table->inbufs_total);
+			tcp_table_inbuf_changed(*conn, tcp_table);
 
 			if (tofree.iov_len > 0 && ret == KNOT_EOK) {
 				relay.data.iov_base = tofree.iov_base + sizeof(uint16_t);
@@ -302,7 +522,6 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 				if (ret == KNOT_EOK) {
 					relay.conn->state = XDP_TCP_ESTABLISHING;
 					relay.conn->seqno++;
-					relay.conn->mss = MAX(msg->mss, 536); // minimal MSS, most importantly not zero!
 					relay.conn->acked = acks[n_acks - 1].seqno;
 					relay.conn->ackno = relay.conn->acked + (synack ? 0 : 1);
 				}
@@ -316,12 +535,21 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 				if (syn_table != NULL && msg->payload.iov_len == 0 &&
 				    *(conn = tcp_table_lookup(&msg->ip_from, &msg->ip_to, &syn_hash, syn_table)) != NULL &&
 				     check_seq_ack(msg, *conn)) {
+					uint16_t mss = (*conn)->mss;
+					uint8_t window_scale = (*conn)->window_scale;
 					tcp_table_del(conn, syn_table);
 					*conn = NULL;
 					relay.action = XDP_TCP_ESTABLISH;
 					ret = tcp_table_add(msg, conn_hash, tcp_table, &relay.conn);
-					if (ret == KNOT_EOK && knot_tcp_relay_dynarray_add(relays, &relay) == NULL) {
-						ret = KNOT_ENOMEM;
+					if (ret == KNOT_EOK) {
+						// The options were negotiated in the SYN.
+						relay.conn->mss = mss;
+						relay.conn->window_scale = window_scale;
+						relay.conn->window_size = (uint32_t)msg->win << window_scale;
+						relay.conn->cong_window = MIN(10 * mss, MAX(2 * mss, 14600));
+						if (knot_tcp_relay_dynarray_add(relays, &relay) == NULL) {
+							ret = KNOT_ENOMEM;
+						}
 					}
 				}
 				// unmatching ACK is ignored, this includes:
@@ -374,6 +602,14 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
 		default:
 			break;
 		}
+
+		// More data can be sent as the window moved.
+		if (unsent != NULL && ret == KNOT_EOK) {
+			knot_tcp_relay_t push = { .msg = msg, .answer = XDP_TCP_DATA, .conn = unsent };
+			if (knot_tcp_relay_dynarray_add(relays, &push) == NULL) {
+				ret = KNOT_ENOMEM;
+			}
+		}
 	}
 
 	if (n_acks > 0 && ret == KNOT_EOK) {
@@ -396,35 +632,29 @@ int knot_tcp_relay_answer(knot_tcp_relay_dynarray_t *relays, const knot_tcp_rela
 	}
 
 	assert(data_len <= UINT16_MAX);
-	uint16_t prefix = htobe16(data_len);
-#define PREFIX_LEN (prefix == 0 ? 0 : sizeof(prefix))
-
-	while (data_len > 0) {
-		knot_tcp_relay_t *clone = knot_tcp_relay_dynarray_add(relays, relay);
-		if (clone == NULL) {
-			return KNOT_ENOMEM;
-		}
-
-		size_t chunk = MIN(data_len + PREFIX_LEN, relay->conn->mss);
-		assert(chunk >= PREFIX_LEN);
-
-		clone->data.iov_base = malloc(chunk);
-		if (clone->data.iov_base == NULL) {
-			return KNOT_ENOMEM;
-		}
-		clone->data.iov_len = chunk;
-
-		memcpy(clone->data.iov_base, &prefix, PREFIX_LEN);
-		chunk -= PREFIX_LEN;
+	knot_tcp_conn_t *conn = relay->conn;
+	int ret = tcp_outbufs_add(&conn->outbufs, &conn->outbufs_last,
+	                          data, data_len, conn->mss);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
 
-		memcpy(clone->data.iov_base + PREFIX_LEN, data, chunk);
-		clone->answer = XDP_TCP_ANSWER | XDP_TCP_DATA;
-		clone->free_data = XDP_TCP_FREE_DATA;
+	// One relay sends all the queued data the window allows.
+	knot_tcp_relay_t *last = relays->size > 0 ?
+	                         knot_tcp_relay_dynarray_arr(relays) + relays->size - 1 : NULL;
+	if (last != NULL && last->conn == conn && last->answer == (XDP_TCP_ANSWER | XDP_TCP_DATA)) {
+		return KNOT_EOK;
+	}
 
-		data += chunk;
-		data_len -= chunk;
-		prefix = 0;
+	knot_tcp_relay_t clone = *relay;
+	clone.data.iov_base = NULL;
+	clone.data.iov_len = 0;
+	clone.free_data = XDP_TCP_FREE_NONE;
+	clone.answer = XDP_TCP_ANSWER | XDP_TCP_DATA;
+	if (knot_tcp_relay_dynarray_add(relays, &clone) == NULL) {
+		return KNOT_ENOMEM;
 	}
+
 	return KNOT_EOK;
 }
 
@@ -444,88 +674,276 @@ void knot_tcp_relay_free(knot_tcp_relay_dynarray_t *relays)
 	knot_tcp_relay_dynarray_free(relays);
 }
 
-_public_
-int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t relay_count)
+#define TCP_SEND_BATCH 16
+
+typedef struct {
+	knot_xdp_socket_t *socket;
+	knot_xdp_msg_t msgs[TCP_SEND_BATCH];
+	uint32_t count;
+} send_ctx_t;
+
+static int send_flush(send_ctx_t *ctx)
 {
-	if (relay_count == 0) {
+	if (ctx->count == 0) {
 		return KNOT_EOK;
 	}
-	if (socket == NULL || relays == NULL) {
-		return KNOT_EINVAL;
+
+	uint32_t sent_unused;
+	int ret = knot_xdp_send(ctx->socket, ctx->msgs, ctx->count, &sent_unused);
+	ctx->count = 0;
+	return ret;
+}
+
+static int send_alloc(send_ctx_t *ctx, knot_tcp_conn_t *conn, knot_xdp_msg_t **out)
+{
+	if (ctx->count == TCP_SEND_BATCH) {
+		int ret = send_flush(ctx);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
 	}
 
-	knot_xdp_msg_t msgs[relay_count], *msg = &msgs[0];
-	int ret = KNOT_EOK, n_msgs = 0;
+	knot_xdp_msg_flag_t fl = KNOT_XDP_MSG_TCP;
+	if (conn->ip_loc.sin6_family == AF_INET6) {
+		fl |= KNOT_XDP_MSG_IPV6;
+	}
+	if (conn->vlan_tpid[0] != 0) {
+		fl |= KNOT_XDP_MSG_VLAN;
+		if (conn->vlan_tpid[1] != 0) {
+			fl |= KNOT_XDP_MSG_QINQ;
+		}
+	}
 
-	for (size_t irl = 0; irl < relay_count; irl++) {
-		knot_tcp_relay_t *rl = &relays[irl];
-		if ((rl->answer & 0x0f) == XDP_TCP_NOOP) {
+	knot_xdp_msg_t *msg = &ctx->msgs[ctx->count];
+	int ret = knot_xdp_send_alloc(ctx->socket, fl, msg);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	ctx->count++;
+
+	memcpy(msg->vlan_tpid, conn->vlan_tpid, sizeof(msg->vlan_tpid));
+	memcpy(msg->vlan_tci, conn->vlan_tci, sizeof(msg->vlan_tci));
+
+	memcpy( msg->eth_from, conn->last_eth_loc, sizeof(msg->eth_from));
+	memcpy( msg->eth_to,   conn->last_eth_rem, sizeof(msg->eth_to));
+	memcpy(&msg->ip_from, &conn->ip_loc,  sizeof(msg->ip_from));
+	memcpy(&msg->ip_to,   &conn->ip_rem,  sizeof(msg->ip_to));
+
+	msg->ackno = conn->seqno;
+	msg->seqno = conn->ackno;
+
+	*out = msg;
+	return KNOT_EOK;
+}
+
+// Send the queued segments as allowed by the smaller of the receive window
+// and the congestion window. If nothing is in flight, one segment is sent
+// anyway, which also probes a zero window.
+static int send_outbufs(send_ctx_t *ctx, knot_tcp_conn_t *conn)
+{
+	uint32_t window = MIN(conn->window_size, conn->cong_window);
+	uint32_t inflight = tcp_conn_inflight(conn);
+
+	for (knot_tcp_outbuf_t *ob = conn->outbufs; ob != NULL; ob = ob->next) {
+		if (ob->sent) {
 			continue;
 		}
-
-		knot_xdp_msg_flag_t fl = KNOT_XDP_MSG_TCP;
-		if (rl->conn->ip_loc.sin6_family == AF_INET6) {
-			fl |= KNOT_XDP_MSG_IPV6;
+		if (inflight > 0 && inflight + ob->len > window) {
+			break;
 		}
 
-		ret = knot_xdp_send_alloc(socket, fl, msg);
+		knot_xdp_msg_t *msg;
+		int ret = send_alloc(ctx, conn, &msg);
 		if (ret != KNOT_EOK) {
-			break;
+			return ret;
+		}
+		msg->flags |= KNOT_XDP_MSG_ACK;
+		if (ob->len > msg->payload.iov_len) {
+			msg->payload.iov_len = 0; // an empty ACK is sent instead
+			return KNOT_ESPACE;
 		}
 
-		memcpy( msg->eth_from, rl->conn->last_eth_loc, sizeof(msg->eth_from));
-		memcpy( msg->eth_to,   rl->conn->last_eth_rem, sizeof(msg->eth_to));
-		memcpy(&msg->ip_from, &rl->conn->ip_loc,  sizeof(msg->ip_from));
-		memcpy(&msg->ip_to,   &rl->conn->ip_rem,  sizeof(msg->ip_to));
+		if (!ob->assigned) {
+			ob->seqno = conn->ackno;
+			ob->assigned = true;
+			conn->ackno += ob->len;
+		}
+		msg->seqno = ob->seqno;
+		memcpy(msg->payload.iov_base, ob->bytes, ob->len);
+		msg->payload.iov_len = ob->len;
+
+		ob->sent = true;
+		inflight += ob->len;
+	}
+
+	return KNOT_EOK;
+}
 
-		msg->ackno = rl->conn->seqno;
-		msg->seqno = rl->conn->ackno;
+_public_
+int knot_tcp_send(knot_xdp_socket_t *socket, knot_tcp_relay_t relays[], uint32_t relay_count)
+{
+	if (relay_count == 0) {
+		return KNOT_EOK;
+	}
+	if (socket == NULL || relays == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	send_ctx_t ctx = { .socket = socket };
+	int ret = KNOT_EOK;
+
+	for (size_t irl = 0; irl < relay_count && ret == KNOT_EOK; irl++) {
+		knot_tcp_relay_t *rl = &relays[irl];
+		knot_xdp_msg_t *msg;
 
 		switch (rl->answer & 0x0f) {
+		case XDP_TCP_NOOP:
+			break;
 		case XDP_TCP_ESTABLISH:
-			msg->flags |= KNOT_XDP_MSG_SYN;
-			msg->payload.iov_len = 0;
+			ret = send_alloc(&ctx, rl->conn, &msg);
+			if (ret == KNOT_EOK) {
+				msg->flags |= KNOT_XDP_MSG_SYN;
+				msg->payload.iov_len = 0;
+			}
 			break;
 		case XDP_TCP_DATA:
-			msg->flags |= KNOT_XDP_MSG_ACK;
-			if (rl->data.iov_len > UINT16_MAX ||
-			    rl->data.iov_len > msg->payload.iov_len) {
-				ret = KNOT_ESPACE;
-			} else {
-				memcpy(msg->payload.iov_base, rl->data.iov_base,
-				       rl->data.iov_len);
-				msg->payload.iov_len = rl->data.iov_len;
-			}
 			assert(rl->conn != NULL);
-			rl->conn->ackno += msg->payload.iov_len;
+			ret = send_outbufs(&ctx, rl->conn);
 			break;
 		case XDP_TCP_CLOSE:
-			msg->flags |= (KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_ACK);
-			msg->payload.iov_len = 0;
 			assert(rl->conn != NULL);
-			rl->conn->ackno++;
-			rl->conn->state = XDP_TCP_CLOSING;
+			ret = send_alloc(&ctx, rl->conn, &msg);
+			if (ret == KNOT_EOK) {
+				// The data not sent yet would follow the FIN.
+				knot_tcp_outbuf_t *unassigned = rl->conn->outbufs;
+				while (unassigned != NULL && unassigned->assigned) {
+					unassigned = unassigned->next;
+				}
+				if (unassigned != NULL) {
+					tcp_outbufs_free(&rl->conn->outbufs, &rl->conn->outbufs_last,
+					                 unassigned);
+				}
+
+				msg->flags |= (KNOT_XDP_MSG_FIN | KNOT_XDP_MSG_ACK);
+				msg->payload.iov_len = 0;
+				rl->conn->ackno++;
+				rl->conn->state = XDP_TCP_CLOSING;
+			}
 			break;
 		case XDP_TCP_RESET:
 		default:
-			msg->flags |= KNOT_XDP_MSG_RST;
-			msg->payload.iov_len = 0;
+			ret = send_alloc(&ctx, rl->conn, &msg);
+			if (ret == KNOT_EOK) {
+				msg->flags |= KNOT_XDP_MSG_RST;
+				msg->payload.iov_len = 0;
+			}
 			break;
 		}
+	}
 
-		msg++;
-		n_msgs++;
-		if (ret != KNOT_EOK) {
+	(void)send_flush(&ctx);
+
+	return ret;
+}
+
+_public_
+int knot_tcp_resend(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
+                    uint32_t max_at_once, uint32_t resend_timeout,
+                    uint32_t *resend_count)
+{
+	if (tcp_table == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	knot_tcp_relay_dynarray_t relays = { 0 };
+	list_t *resend = tcp_table_resend(tcp_table), rearmed;
+	init_list(&rearmed);
+	uint32_t now = get_timestamp();
+
+	node_t *n, *nxt;
+	WALK_LIST_DELSAFE(n, nxt, *resend) {
+		knot_tcp_conn_t *conn = tcp_conn_from_resend_node(n);
+		if (relays.size >= max_at_once || now - conn->last_resend < resend_timeout) {
 			break;
 		}
+
+		rem_node(n);
+		if (conn->outbufs == NULL) {
+			continue; // nothing to retransmit, the timer stops
+		}
+
+		// Go back to the first unacknowledged segment and start slowly.
+		conn->ssthresh = MAX(tcp_conn_inflight(conn) / 2, 2 * conn->mss);
+		conn->cong_window = conn->mss;
+		for (knot_tcp_outbuf_t *ob = conn->outbufs; ob != NULL; ob = ob->next) {
+			ob->sent = false;
+		}
+
+		conn->last_resend = now;
+		add_tail(&rearmed, n);
+
+		knot_tcp_relay_t rl = { .answer = XDP_TCP_DATA, .conn = conn };
+		(void)knot_tcp_relay_dynarray_add(&relays, &rl);
 	}
 
-	uint32_t sent_unused;
-	(void)knot_xdp_send(socket, msgs, n_msgs, &sent_unused);
+	WALK_LIST_DELSAFE(n, nxt, rearmed) {
+		rem_node(n);
+		add_tail(resend, n);
+	}
+
+	if (resend_count != NULL) {
+		*resend_count += relays.size;
+	}
+
+	knot_xdp_send_prepare(socket);
+	int ret = knot_tcp_send(socket, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	(void)knot_xdp_send_finish(socket);
+
+	knot_tcp_relay_free(&relays);
 
 	return ret;
 }
 
+typedef struct {
+	knot_tcp_relay_dynarray_t relays;
+	list_t to_remove;
+	uint32_t max_at_once;
+	size_t reset_buf_size;
+} sweep_ctx_t;
+
+static bool sweep_full(sweep_ctx_t *ctx)
+{
+	return ctx->relays.size >= ctx->max_at_once;
+}
+
+static void sweep_reset(sweep_ctx_t *ctx, knot_tcp_conn_t *conn)
+{
+	knot_tcp_relay_t rl = { .answer = XDP_TCP_RESET, .conn = conn };
+	(void)knot_tcp_relay_dynarray_add(&ctx->relays, &rl);
+
+	// move this conn into to-remove list
+	rem_node(tcp_conn_node(conn));
+	add_tail(&ctx->to_remove, tcp_conn_node(conn));
+	if (tcp_conn_has_inbuf_node(conn)) {
+		rem_node(tcp_conn_inbuf_node(conn));
+	}
+
+	ctx->reset_buf_size -= MIN(ctx->reset_buf_size, conn->inbuf.iov_len);
+}
+
+static knot_tcp_conn_t *older_conn(list_t *a, list_t *b)
+{
+	knot_tcp_conn_t *conn_a = EMPTY_LIST(*a) ? NULL : HEAD(*a);
+	knot_tcp_conn_t *conn_b = EMPTY_LIST(*b) ? NULL : HEAD(*b);
+	if (conn_a == NULL || conn_b == NULL) {
+		return (conn_a != NULL) ? conn_a : conn_b;
+	}
+
+	// The same reference time for both as the timestamps overflow.
+	uint32_t now = get_timestamp();
+	return (now - conn_a->last_active >= now - conn_b->last_active) ? conn_a : conn_b;
+}
+
 _public_
 int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
                    uint32_t max_at_once, uint32_t close_timeout, uint32_t reset_timeout,
@@ -536,55 +954,79 @@ int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
 		return KNOT_EINVAL;
 	}
 
-	knot_tcp_relay_t rl = { 0 };
-	knot_tcp_relay_dynarray_t relays = { 0 };
-	uint32_t now = get_timestamp(), i = 0;
+	sweep_ctx_t ctx = {
+		.max_at_once = max_at_once,
+		.reset_buf_size = reset_buf_size,
+	};
+	init_list(&ctx.to_remove);
+
+	list_t *timeout = tcp_table_timeout(tcp_table);
+	list_t *closing = tcp_table_closing(tcp_table);
+	list_t *inbufs = tcp_table_inbufs(tcp_table);
+	uint32_t now = get_timestamp();
 	knot_tcp_conn_t *conn, *next;
-	list_t to_remove;
-	init_list(&to_remove);
 
-	WALK_LIST_DELSAFE(conn, next, *tcp_table_timeout(tcp_table)) {
-		if (i++ < reset_at_least ||
-		    now - conn->last_active >= reset_timeout ||
-		    (reset_buf_size > 0 && conn->inbuf.iov_len > 0)) {
-			rl.answer = XDP_TCP_RESET;
+	// Each list is ordered by the last activity, so each walk stops
+	// at the first connection which isn't to be swept.
 
-			// move this conn into to-remove list
-			rem_node((node_t *)conn);
-			add_tail(&to_remove, (node_t *)conn);
+	for (uint32_t i = 0; i < reset_at_least && !sweep_full(&ctx); i++) {
+		conn = older_conn(closing, timeout);
+		if (conn == NULL) {
+			break;
+		}
+		sweep_reset(&ctx, conn);
+	}
+
+	WALK_LIST_DELSAFE(conn, next, *closing) {
+		if (sweep_full(&ctx) || now - conn->last_active < reset_timeout) {
+			break;
+		}
+		sweep_reset(&ctx, conn);
+	}
 
-			reset_buf_size -= MIN(reset_buf_size, conn->inbuf.iov_len);
+	WALK_LIST_DELSAFE(conn, next, *timeout) {
+		if (sweep_full(&ctx)) {
+			break;
+		}
+		if (now - conn->last_active >= reset_timeout) {
+			sweep_reset(&ctx, conn);
 		} else if (now - conn->last_active >= close_timeout) {
 			if (conn->state != XDP_TCP_CLOSING) {
-				rl.answer = XDP_TCP_CLOSE;
+				knot_tcp_relay_t rl = { .answer = XDP_TCP_CLOSE, .conn = conn };
+				(void)knot_tcp_relay_dynarray_add(&ctx.relays, &rl);
 				if (close_count != NULL) {
 					(*close_count)++;
 				}
 			}
-		} else if (reset_buf_size == 0) {
+			// Sending the FIN makes it closing.
+			rem_node(tcp_conn_node(conn));
+			add_tail(closing, tcp_conn_node(conn));
+		} else {
 			break;
 		}
+	}
 
-		rl.conn = conn;
-		(void)knot_tcp_relay_dynarray_add(&relays, &rl);
-		if (relays.size >= max_at_once) {
+	node_t *n, *nxt;
+	WALK_LIST_DELSAFE(n, nxt, *inbufs) {
+		if (sweep_full(&ctx) || ctx.reset_buf_size == 0) {
 			break;
 		}
+		sweep_reset(&ctx, tcp_conn_from_inbuf_node(n));
 	}
 
 	knot_xdp_send_prepare(socket);
-	(void)knot_tcp_send(socket, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	(void)knot_tcp_send(socket, knot_tcp_relay_dynarray_arr(&ctx.relays), ctx.relays.size);
 	(void)knot_xdp_send_finish(socket);
 
 	// immediately remove reset connections
 	if (reset_count != NULL) {
-		*reset_count += list_size(&to_remove);
+		*reset_count += list_size(&ctx.to_remove);
 	}
-	WALK_LIST_DELSAFE(conn, next, to_remove) {
+	WALK_LIST_DELSAFE(conn, next, ctx.to_remove) {
 		tcp_table_del_lookup(conn, tcp_table);
 	}
 
-	knot_tcp_relay_free(&relays);
+	knot_tcp_relay_free(&ctx.relays);
 
 	return KNOT_EOK;
 }
@@ -56,17 +56,34 @@ typedef struct knot_tcp_conn {
 		void *list_node_placeholder1;
 		void *list_node_placeholder2;
 	} list_node_placeholder;
+	struct {
+		void *list_node_placeholder1;
+		void *list_node_placeholder2;
+	} inbuf_node_placeholder;
+	struct {
+		void *list_node_placeholder1;
+		void *list_node_placeholder2;
+	} resend_node_placeholder;
 	struct sockaddr_in6 ip_rem;
 	struct sockaddr_in6 ip_loc;
 	uint8_t last_eth_rem[ETH_ALEN];
 	uint8_t last_eth_loc[ETH_ALEN];
+	uint16_t vlan_tpid[2];
+	uint16_t vlan_tci[2];
 	uint16_t mss;
 	uint32_t seqno;
 	uint32_t ackno;
 	uint32_t acked;
 	uint32_t last_active;
+	uint32_t last_resend;    // Last arming of the retransmission timer.
+	uint32_t window_size;    // Receive window of the peer (scaled).
+	uint32_t cong_window;    // Congestion window.
+	uint32_t ssthresh;       // Slow start threshold.
+	uint8_t window_scale;
 	knot_tcp_state_t state;
 	struct iovec inbuf;
+	struct knot_tcp_outbuf *outbufs;
+	struct knot_tcp_outbuf *outbufs_last;
 	struct knot_tcp_conn *next;
 } knot_tcp_conn_t;
 
@@ -75,7 +92,7 @@ typedef struct {
 	size_t usage;
 	size_t inbufs_total;
 	uint64_t hash_secret[2];
-	knot_tcp_conn_t *conns[];
+	knot_tcp_conn_t **conns;
 } knot_tcp_table_t;
 
 typedef struct {
@@ -111,10 +128,26 @@ inline static uint32_t knot_tcp_next_seqno(const knot_xdp_msg_t *msg)
  *
  * \note Hashing conflicts are solved by single-linked-lists in each record.
  *
+ * \note Besides the hash table, the connections are kept in lists ordered by
+ *       their last activity, so that the sweeping cost is proportional to
+ *       the number of the timed-out connections.
+ *
  * \return The table, or NULL.
  */
 knot_tcp_table_t *knot_tcp_table_new(size_t size);
 
+/*!
+ * \brief Change the number of records of the hash table.
+ *
+ * The connections are kept, they are redistributed into the new records.
+ *
+ * \param table  Table of TCP connections.
+ * \param size   New number of records.
+ *
+ * \return KNOT_EOK, KNOT_EINVAL, KNOT_ENOMEM
+ */
+int knot_tcp_table_resize(knot_tcp_table_t *table, size_t size);
+
 /*!
  * \brief Free TCP connection hash table including all connection records.
  *
@@ -140,7 +173,11 @@ int knot_tcp_relay(knot_xdp_socket_t *socket, knot_xdp_msg_t msgs[], uint32_t ms
                    knot_tcp_relay_dynarray_t *relays, uint32_t *ack_errors);
 
 /*!
- * \brief Fetch answer to one relay with one or more relays with data payload.
+ * \brief Queue answer to one relay and add a relay for sending it.
+ *
+ * The data is copied to the send buffer of the connection, split into segments
+ * of at most MSS. The segments are sent by knot_tcp_send() as the send window
+ * allows and kept until acknowledged.
  *
  * \param relays    Relays.
  * \param relay     The relay to answer to.
@@ -160,6 +197,9 @@ void knot_tcp_relay_free(knot_tcp_relay_dynarray_t *relays);
 /*!
  * \brief Send TCP packets.
  *
+ * \note The data relays send the queued segments respecting the receive window
+ *       of the peer and the congestion window.
+ *
  * \param socket       XDP socket to send through.
  * \param relays       Connection changes and data.
  * \param relay_count  Number of connection changes and data.
@@ -190,4 +230,22 @@ int knot_tcp_sweep(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
                    uint32_t reset_at_least, size_t reset_buf_size,
                    uint32_t *close_count, uint32_t *reset_count);
 
+/*!
+ * \brief Retransmit the unacknowledged data of the connections.
+ *
+ * The connections with no acknowledgment for the timeout have their congestion
+ * window collapsed and the data in flight sent once more.
+ *
+ * \param tcp_table       TCP connection table.
+ * \param socket          XDP socket to send through.
+ * \param max_at_once     Don't retransmit to more connections at once.
+ * \param resend_timeout  Retransmit data unacknowledged for this time (usecs).
+ * \param resend_count    Optional: Out: incremented with number of retransmits.
+ *
+ * \return KNOT_E*
+ */
+int knot_tcp_resend(knot_tcp_table_t *tcp_table, knot_xdp_socket_t *socket,
+                    uint32_t max_at_once, uint32_t resend_timeout,
+                    uint32_t *resend_count);
+
 /*! @} */
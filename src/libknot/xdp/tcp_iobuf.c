@@ -91,3 +91,85 @@ int tcp_inbuf_update(struct iovec *buffer, struct iovec *data,
 	}
 	return KNOT_EOK;
 }
+
+int tcp_outbufs_add(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t **bufs_last,
+                    const uint8_t *data, size_t len, size_t mss)
+{
+	assert(len <= UINT16_MAX && mss > sizeof(uint16_t));
+
+	uint16_t prefix = htobe16(len), prefix_len = sizeof(prefix);
+	knot_tcp_outbuf_t *first = NULL, *last = NULL;
+
+	while (len > 0 || prefix_len > 0) {
+		size_t chunk = MIN(len + prefix_len, mss);
+		knot_tcp_outbuf_t *ob = malloc(sizeof(*ob) + chunk);
+		if (ob == NULL) {
+			while (first != NULL) {
+				knot_tcp_outbuf_t *next = first->next;
+				free(first);
+				first = next;
+			}
+			return KNOT_ENOMEM;
+		}
+		ob->next = NULL;
+		ob->len = chunk;
+		ob->seqno = 0;
+		ob->assigned = false;
+		ob->sent = false;
+
+		memcpy(ob->bytes, &prefix, prefix_len);
+		memcpy(ob->bytes + prefix_len, data, chunk - prefix_len);
+		data += chunk - prefix_len;
+		len -= chunk - prefix_len;
+		prefix_len = 0;
+
+		if (last == NULL) {
+			first = ob;
+		} else {
+			last->next = ob;
+		}
+		last = ob;
+	}
+
+	if (*bufs == NULL) {
+		*bufs = first;
+	} else {
+		(*bufs_last)->next = first;
+	}
+	*bufs_last = last;
+
+	return KNOT_EOK;
+}
+
+size_t tcp_outbufs_ack(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t **bufs_last,
+                       uint32_t ackno)
+{
+	size_t res = 0;
+	while (*bufs != NULL && (*bufs)->assigned &&
+	       (int32_t)(ackno - ((*bufs)->seqno + (*bufs)->len)) >= 0) {
+		knot_tcp_outbuf_t *next = (*bufs)->next;
+		res += (*bufs)->len;
+		free(*bufs);
+		*bufs = next;
+	}
+	if (*bufs == NULL) {
+		*bufs_last = NULL;
+	}
+	return res;
+}
+
+void tcp_outbufs_free(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t **bufs_last,
+                      knot_tcp_outbuf_t *from)
+{
+	knot_tcp_outbuf_t **it = bufs, *prev = NULL;
+	while (*it != from && from != NULL) {
+		prev = *it;
+		it = &(*it)->next;
+	}
+	while (*it != NULL) {
+		knot_tcp_outbuf_t *next = (*it)->next;
+		free(*it);
+		*it = next;
+	}
+	*bufs_last = prev;
+}
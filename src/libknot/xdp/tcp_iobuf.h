@@ -26,11 +26,23 @@
 #pragma once
 
 #include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/uio.h>
 
 #include "libknot/endian.h"
 
+/*! \brief One segment of the outgoing data, at most MSS long. */
+typedef struct knot_tcp_outbuf {
+	struct knot_tcp_outbuf *next;
+	uint32_t len;
+	uint32_t seqno;     /*!< Sequence number, valid once assigned. */
+	bool assigned;      /*!< The segment has been sent at least once. */
+	bool sent;          /*!< The segment is in flight (sent and not timed out). */
+	uint8_t bytes[];
+} knot_tcp_outbuf_t;
+
 /*!
  * \brief Return the required length for payload buffer.
  */
@@ -55,4 +67,32 @@ inline static size_t tcp_payload_len(const struct iovec *payload)
 int tcp_inbuf_update(struct iovec *buffer, struct iovec *data,
                      struct iovec *data_tofree, size_t *buffers_total);
 
+/*!
+ * \brief Append a DNS message, prefixed with its length, to the outgoing segments.
+ *
+ * \param bufs           In/out: first segment of the queue.
+ * \param bufs_last      In/out: last segment of the queue.
+ * \param data           DNS message.
+ * \param len            DNS message length.
+ * \param mss            Maximum segment size.
+ *
+ * \return KNOT_EOK, KNOT_ENOMEM
+ */
+int tcp_outbufs_add(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t **bufs_last,
+                    const uint8_t *data, size_t len, size_t mss);
+
+/*!
+ * \brief Free the segments fully acknowledged by 'ackno'.
+ *
+ * \return Size of the freed segments.
+ */
+size_t tcp_outbufs_ack(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t **bufs_last,
+                       uint32_t ackno);
+
+/*!
+ * \brief Free the segments starting with 'from' (all if NULL).
+ */
+void tcp_outbufs_free(knot_tcp_outbuf_t **bufs, knot_tcp_outbuf_t **bufs_last,
+                      knot_tcp_outbuf_t *from);
+
 /*! @} */
@@ -23,6 +23,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -44,6 +45,17 @@
 #define UMEM_RING_LEN_TX (UMEM_FRAME_COUNT_TX * 2)
 #define UMEM_FRAME_COUNT (UMEM_FRAME_COUNT_RX + UMEM_FRAME_COUNT_TX)
 
+/* Busy polling socket options (Linux >= 5.11) missing in older headers. */
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
+#endif
+
 #define ALLOC_RETRY_NUM   15
 #define ALLOC_RETRY_DELAY 20 // In nanoseconds.
 
@@ -127,8 +139,43 @@ static void deconfigure_xsk_umem(struct kxsk_umem *umem)
 	free(umem);
 }
 
+static bool negotiated_zero_copy(int fd)
+{
+#ifdef XDP_OPTIONS
+	struct xdp_options opts = { 0 };
+	socklen_t len = sizeof(opts);
+	if (getsockopt(fd, SOL_XDP, XDP_OPTIONS, &opts, &len) == 0) {
+		return (opts.flags & XDP_OPTIONS_ZEROCOPY);
+	}
+#endif
+	return false;
+}
+
+static int configure_busy_poll(int fd, const knot_xdp_config_t *config)
+{
+	int opt = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &opt, sizeof(opt)) != 0) {
+		return knot_map_errno();
+	}
+
+	opt = config->busy_poll_timeout;
+	if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &opt, sizeof(opt)) != 0) {
+		return knot_map_errno();
+	}
+
+	if (config->busy_poll_budget > 0) {
+		opt = config->busy_poll_budget;
+		if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &opt, sizeof(opt)) != 0) {
+			return knot_map_errno();
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 static int configure_xsk_socket(struct kxsk_umem *umem,
                                 const struct kxsk_iface *iface,
+                                const knot_xdp_config_t *config,
                                 knot_xdp_socket_t **out_sock)
 {
 	knot_xdp_socket_t *xsk_info = calloc(1, sizeof(*xsk_info));
@@ -138,10 +185,19 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 	xsk_info->iface = iface;
 	xsk_info->umem = umem;
 
+	/* Without any flag, the kernel tries zero-copy and falls back to copy. */
+	uint16_t bind_flags = 0;
+	switch (config->bind_mode) {
+	case KNOT_XDP_BIND_ZEROCOPY: bind_flags = XDP_ZEROCOPY; break;
+	case KNOT_XDP_BIND_COPY:     bind_flags = XDP_COPY; break;
+	default:                     break;
+	}
+
 	const struct xsk_socket_config sock_conf = {
 		.tx_size = UMEM_RING_LEN_TX,
 		.rx_size = UMEM_RING_LEN_RX,
 		.libbpf_flags = XSK_LIBBPF_FLAGS__INHIBIT_PROG_LOAD,
+		.bind_flags = bind_flags,
 	};
 
 	int ret = xsk_socket__create(&xsk_info->xsk, iface->if_name,
@@ -152,18 +208,37 @@ static int configure_xsk_socket(struct kxsk_umem *umem,
 		return ret;
 	}
 
+	int fd = xsk_socket__fd(xsk_info->xsk);
+	xsk_info->zero_copy = (bind_flags == XDP_ZEROCOPY) || negotiated_zero_copy(fd);
+
+	if (config->busy_poll_timeout > 0) {
+		ret = configure_busy_poll(fd, config);
+		if (ret != KNOT_EOK) {
+			xsk_socket__delete(xsk_info->xsk);
+			free(xsk_info);
+			return ret;
+		}
+		xsk_info->busy_poll = true;
+	}
+
 	*out_sock = xsk_info;
 	return KNOT_EOK;
 }
 
 _public_
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
-                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf)
+                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf,
+                  const knot_xdp_config_t *config)
 {
 	if (socket == NULL || if_name == NULL) {
 		return KNOT_EINVAL;
 	}
 
+	const knot_xdp_config_t default_config = { 0 };
+	if (config == NULL) {
+		config = &default_config;
+	}
+
 	struct kxsk_iface *iface;
 	int ret = kxsk_iface_new(if_name, if_queue, load_bpf, &iface);
 	if (ret != KNOT_EOK) {
@@ -178,7 +253,7 @@ int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
 		return ret;
 	}
 
-	ret = configure_xsk_socket(umem, iface, socket);
+	ret = configure_xsk_socket(umem, iface, config, socket);
 	if (ret != KNOT_EOK) {
 		deconfigure_xsk_umem(umem);
 		kxsk_iface_free(iface);
@@ -233,6 +308,105 @@ int knot_xdp_socket_fd(knot_xdp_socket_t *socket)
 	return xsk_socket__fd(socket->xsk);
 }
 
+_public_
+bool knot_xdp_zero_copy(const knot_xdp_socket_t *socket)
+{
+	return socket != NULL && socket->zero_copy;
+}
+
+_public_
+int knot_xdp_rrl_set(knot_xdp_socket_t *socket, uint32_t rate, uint32_t slip)
+{
+	if (socket == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_rrl_set(socket->iface, rate, slip);
+}
+
+_public_
+int knot_xdp_rrl_get(knot_xdp_socket_t *socket, struct knot_xdp_rrl *out)
+{
+	if (socket == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_rrl_get(socket->iface, out);
+}
+
+_public_
+int knot_xdp_answer_conf(knot_xdp_socket_t *socket, bool enabled, uint32_t generation)
+{
+	if (socket == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_answer_conf(socket->iface, enabled, generation);
+}
+
+_public_
+int knot_xdp_answer_set(knot_xdp_socket_t *socket, const struct knot_xdp_answer_key *key,
+                        const struct knot_xdp_answer *answer)
+{
+	if (socket == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_answer_set(socket->iface, key, answer);
+}
+
+_public_
+int knot_xdp_answer_get(knot_xdp_socket_t *socket, struct knot_xdp_answer_conf *out)
+{
+	if (socket == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_answer_get(socket->iface, out);
+}
+
+_public_
+int knot_xdp_pass_get(knot_xdp_socket_t *socket, uint64_t out[KNOT_XDP_PASS_REASONS])
+{
+	if (socket == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_pass_get(socket->iface, out);
+}
+
+_public_
+int knot_xdp_acl_set(knot_xdp_socket_t *socket, const struct knot_xdp_acl_rule *rules,
+                     size_t count)
+{
+	if (socket == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_acl_set(socket->iface, rules, count);
+}
+
+_public_
+int knot_xdp_acl_get(knot_xdp_socket_t *socket, struct knot_xdp_acl_conf *out)
+{
+	if (socket == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_acl_get(socket->iface, out);
+}
+
+_public_
+int knot_xdp_acl_dropped(knot_xdp_socket_t *socket, const struct knot_xdp_acl_key *key,
+                         uint64_t *out)
+{
+	if (socket == NULL || key == NULL || out == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	return kxsk_acl_dropped(socket->iface, key, out);
+}
+
 static void tx_free_relative(struct kxsk_umem *umem, uint64_t addr_relative)
 {
 	/* The address may not point to *start* of buffer, but `/` solves that. */
@@ -526,6 +700,10 @@ void knot_xdp_info(const knot_xdp_socket_t *socket, FILE *file)
 		        (unsigned)RING_BUSY((ring)), \
 		        (unsigned)*(ring)->producer, (unsigned)*(ring)->consumer)
 
+	fprintf(file, "\nBind mode: %s, busy polling %s",
+	        socket->zero_copy ? "zero-copy" : "copy",
+	        socket->busy_poll ? "on" : "off");
+
 	const int rx_busyf = RING_BUSY(&socket->umem->fq) + RING_BUSY(&socket->rx);
 	fprintf(file, "\nLOST RX frames: %4d", (int)(UMEM_FRAME_COUNT_RX - rx_busyf));
 
@@ -48,6 +48,20 @@ typedef enum {
 	 * libbpf: Kernel error message: XDP program already attached */
 } knot_xdp_load_bpf_t;
 
+/*! \brief Binding modes of the XDP socket. */
+typedef enum {
+	KNOT_XDP_BIND_AUTO,     /*!< Zero-copy if supported by the driver, copy otherwise. */
+	KNOT_XDP_BIND_ZEROCOPY, /*!< Zero-copy only; fail if not supported. */
+	KNOT_XDP_BIND_COPY,     /*!< Copy only. */
+} knot_xdp_bind_t;
+
+/*! \brief Optional XDP socket configuration. */
+typedef struct {
+	knot_xdp_bind_t bind_mode;  /*!< Socket binding mode. */
+	uint32_t busy_poll_timeout; /*!< Busy polling duration in microseconds (0 disables). */
+	uint32_t busy_poll_budget;  /*!< Busy polling packet budget (0 is kernel default). */
+} knot_xdp_config_t;
+
 /*! \brief Context structure for one XDP socket. */
 typedef struct knot_xdp_socket knot_xdp_socket_t;
 
@@ -59,11 +73,13 @@ typedef struct knot_xdp_socket knot_xdp_socket_t;
  * \param if_queue     Network card queue to be used (normally 1 socket per each queue).
  * \param listen_port  Port to listen on, or KNOT_XDP_LISTEN_PORT_* flag.
  * \param load_bpf     Insert BPF program into packet processing.
+ * \param config       Optional socket configuration (NULL for defaults).
  *
  * \return KNOT_E* or -errno
  */
 int knot_xdp_init(knot_xdp_socket_t **socket, const char *if_name, int if_queue,
-                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf);
+                  uint32_t listen_port, knot_xdp_load_bpf_t load_bpf,
+                  const knot_xdp_config_t *config);
 
 /*!
  * \brief De-init XDP socket.
@@ -81,6 +97,135 @@ void knot_xdp_deinit(knot_xdp_socket_t *socket);
  */
 int knot_xdp_socket_fd(knot_xdp_socket_t *socket);
 
+/*!
+ * \brief Check if the socket was bound in the zero-copy mode.
+ *
+ * \param socket  XDP socket.
+ *
+ * \return True if the driver negotiated zero-copy, false for the copy mode.
+ */
+bool knot_xdp_zero_copy(const knot_xdp_socket_t *socket);
+
+/*!
+ * \brief Configure rate limiting of UDP queries in the BPF program.
+ *
+ * Queries from one source /24 (IPv4) or /56 (IPv6) prefix exceeding the rate
+ * are dropped before reaching the socket, except for every Nth one.
+ *
+ * \note The setting is common for all sockets of the interface.
+ *
+ * \param socket  XDP socket.
+ * \param rate    Allowed queries per second from one prefix (0 disables).
+ * \param slip    Every Nth limited query is passed to the socket (0 never).
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_rrl_set(knot_xdp_socket_t *socket, uint32_t rate, uint32_t slip);
+
+/*!
+ * \brief Read back the rate limiting configuration and counters.
+ *
+ * \param socket  XDP socket.
+ * \param out     Output: current rate limiting state.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_rrl_get(knot_xdp_socket_t *socket, struct knot_xdp_rrl *out);
+
+/*!
+ * \brief Configure answering of UDP queries directly from the BPF program.
+ *
+ * IPv4 queries matching an answer inserted by knot_xdp_answer_set() with
+ * the current generation are answered by the program (XDP_TX) without
+ * reaching the socket. Answers of other generations never match.
+ *
+ * \note The setting is common for all sockets of the interface.
+ *
+ * \param socket      XDP socket.
+ * \param enabled     Answer the queries from the answer table.
+ * \param generation  Current answer generation.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_answer_conf(knot_xdp_socket_t *socket, bool enabled, uint32_t generation);
+
+/*!
+ * \brief Insert or replace an answer of the BPF program.
+ *
+ * The least recently used answers are evicted if the table is full.
+ *
+ * \param socket  XDP socket.
+ * \param key     Answer key (unused octets of the QNAME must be zero).
+ * \param answer  Pre-rendered answer.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_answer_set(knot_xdp_socket_t *socket, const struct knot_xdp_answer_key *key,
+                        const struct knot_xdp_answer *answer);
+
+/*!
+ * \brief Read back the configuration and counters of the BPF program answers.
+ *
+ * \param socket  XDP socket.
+ * \param out     Output: current answers state.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_answer_get(knot_xdp_socket_t *socket, struct knot_xdp_answer_conf *out);
+
+/*!
+ * \brief Replace the source prefix access control rules of the BPF program.
+ *
+ * UDP and TCP packets to the listening ports from a source whose longest
+ * matching prefix is denied are dropped before reaching the socket. If any
+ * prefix is allowed, the packets from sources without a matching prefix are
+ * dropped too.
+ *
+ * \note The setting is common for all sockets of the interface.
+ *
+ * \param socket  XDP socket.
+ * \param rules   Source prefix rules.
+ * \param count   Number of the rules (0 disables the access control).
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_acl_set(knot_xdp_socket_t *socket, const struct knot_xdp_acl_rule *rules,
+                     size_t count);
+
+/*!
+ * \brief Read back the access control configuration and the default counter.
+ *
+ * \param socket  XDP socket.
+ * \param out     Output: current access control state.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_acl_get(knot_xdp_socket_t *socket, struct knot_xdp_acl_conf *out);
+
+/*!
+ * \brief Read the number of packets dropped due to the configured source prefix.
+ *
+ * \param socket  XDP socket.
+ * \param key     Source prefix of a rule.
+ * \param out     Output: number of dropped packets.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_acl_dropped(knot_xdp_socket_t *socket, const struct knot_xdp_acl_key *key,
+                         uint64_t *out);
+
+/*!
+ * \brief Read the counters of the packets the BPF program passed to the kernel.
+ *
+ * \note The counters are common for all sockets of the interface.
+ *
+ * \param socket  XDP socket.
+ * \param out     Output: counters indexed by enum knot_xdp_pass_reason.
+ *
+ * \return KNOT_E* or -errno
+ */
+int knot_xdp_pass_get(knot_xdp_socket_t *socket, uint64_t out[KNOT_XDP_PASS_REASONS]);
+
 /*!
  * \brief Collect completed TX buffers, so they can be used by knot_xdp_send_alloc().
  *
@@ -532,6 +532,95 @@ int zs_parse_record(
 	return 0;
 }
 
+/*!
+ * \brief Returns the start of the nearest empty or comment line, or 'pe'.
+ */
+static const char *next_blank_line(
+	const char *p,
+	const char *pe)
+{
+	while (p < pe) {
+		const char *nl = memchr(p, '\n', pe - p);
+		if (nl == NULL || nl + 1 >= pe) {
+			break;
+		}
+		if (nl[1] == '\n' || nl[1] == ';') {
+			return nl + 1;
+		}
+		p = nl + 1;
+	}
+
+	return pe;
+}
+
+/*!
+ * \brief Skips the empty and whole-line comment lines.
+ *
+ * A comment without the terminating newline is left to the state machine.
+ */
+static const char *skip_blank_lines(
+	zs_scanner_t *s,
+	const char *p,
+	const char *pe)
+{
+	while (p < pe) {
+		if (*p == '\n') {
+			p++;
+		} else if (*p == ';') {
+			const char *nl = memchr(p, '\n', pe - p);
+			if (nl == NULL) {
+				break;
+			}
+			p = nl + 1;
+		} else {
+			break;
+		}
+		s->line_counter++;
+	}
+
+	return p;
+}
+
+/*!
+ * \brief Parses the input, the blank and comment lines between records are
+ *        skipped without the state machine.
+ *
+ * The input is parsed in blocks ending before such lines. If the machine is
+ * at the beginning of a line after a block, the following blank lines are
+ * skipped using memchr(), which is vectorized in common libc implementations.
+ * Only applicable if no comment processing is set.
+ */
+static void parse_skipping(
+	zs_scanner_t *s,
+	wrap_t *wrap)
+{
+	const char *start = s->input.start;
+	const char *end = s->input.end;
+	const bool eof = s->input.eof;
+
+	while (s->input.current < end) {
+		if (s->cs == %%{ write start; }%% && s->top == 0 && !s->multiline) {
+			s->input.current = skip_blank_lines(s, s->input.current, end);
+		}
+
+		s->input.end = next_blank_line(s->input.current, end);
+		s->input.eof = eof && s->input.end == end;
+		parse(s, wrap);
+		// Input replaced to process a wrap, possible only in the last block.
+		if (s->input.start != start) {
+			return;
+		}
+		// Stopped, the block not parsed completely on error, or the last one.
+		if (s->state == ZS_STATE_STOP || s->input.current != s->input.end ||
+		    s->input.end == end) {
+			break;
+		}
+	}
+
+	s->input.end = end;
+	s->input.eof = eof;
+}
+
 __attribute__((visibility("default")))
 int zs_parse_all(
 	zs_scanner_t *s)
@@ -544,7 +633,11 @@ int zs_parse_all(
 
 	// Parse input block.
 	wrap_t wrap = WRAP_NONE;
-	parse(s, &wrap);
+	if (s->process.comment == NULL) {
+		parse_skipping(s, &wrap);
+	} else {
+		parse(s, &wrap);
+	}
 
 	// Parse trailing newline-char block if it makes sense.
 	if (s->state != ZS_STATE_STOP && !s->error.fatal) {
@@ -29,8 +29,6 @@
 #include "utils/common/https.h"
 #include "utils/common/msg.h"
 
-#define is_read(ctx) (ctx->stream == -1)
-
 int https_params_copy(https_params_t *dst, const https_params_t *src)
 {
 	if (dst == NULL || src == NULL) {
@@ -64,7 +62,6 @@ void https_params_clean(https_params_t *params)
 #ifdef LIBNGHTTP2
 
 #define HTTP_STATUS_SUCCESS	200
-#define HTTPS_MAX_STREAMS	16
 #define HTTPS_AUTHORITY_LEN	(INET6_ADDRSTRLEN + 2)
 
 #define MAKE_NV(K, KS, V, VS) \
@@ -84,6 +81,35 @@ static const nghttp2_settings_entry settings[] = {
 	{ NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, HTTPS_MAX_STREAMS }
 };
 
+static int https_send_stream(https_ctx_t *ctx, https_stream_t *stream);
+
+static https_stream_t *https_get_stream(https_ctx_t *ctx, int32_t stream_id)
+{
+	for (size_t i = 0; i < HTTPS_MAX_STREAMS; i++) {
+		if (ctx->streams[i].id == stream_id) {
+			return &ctx->streams[i];
+		}
+	}
+	return NULL;
+}
+
+static bool https_pending(const https_ctx_t *ctx)
+{
+	for (size_t i = 0; i < HTTPS_MAX_STREAMS; i++) {
+		if (ctx->streams[i].id >= 0 && !ctx->streams[i].closed) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void https_stream_reset(https_stream_t *stream)
+{
+	free(stream->data);
+	memset(stream, 0, sizeof(*stream));
+	stream->id = -1;
+}
+
 static bool https_status_is_redirect(unsigned long status)
 {
 	switch (status) {
@@ -142,7 +168,9 @@ static ssize_t https_recv_callback(nghttp2_session *session, uint8_t *data, size
 
 	ssize_t ret = 0;
 	while ((ret = gnutls_record_recv(ctx->tls->session, data, length)) <= 0) {
-		if (is_read(ctx)) { //Unblock `nghttp2_session_recv(nghttp2_session)`
+		// Unblock `nghttp2_session_recv(nghttp2_session)` if a response
+		// is complete or nothing is expected.
+		if (ctx->closed > 0 || !https_pending(ctx)) {
 			return NGHTTP2_ERR_WOULDBLOCK;
 		}
 		if (ret == 0) {
@@ -166,12 +194,20 @@ static int https_on_data_chunk_recv_callback(nghttp2_session *session, uint8_t f
 {
 	assert(user_data);
 
-	https_ctx_t *ctx = (https_ctx_t *)user_data;
-	if (ctx->stream == stream_id) {
-		int cpy_len = MIN(len, ctx->recv_buflen);
-		memcpy(ctx->recv_buf, data, cpy_len);
-		ctx->recv_buf += cpy_len;
-		ctx->recv_buflen -= cpy_len;
+	https_stream_t *stream = https_get_stream(user_data, stream_id);
+	if (stream != NULL) {
+		// No DNS message is longer.
+		size_t cpy_len = MIN(len, UINT16_MAX - stream->data_len);
+		if (cpy_len == 0) {
+			return KNOT_EOK;
+		}
+		uint8_t *new_data = realloc(stream->data, stream->data_len + cpy_len);
+		if (new_data == NULL) {
+			return NGHTTP2_ERR_CALLBACK_FAILURE;
+		}
+		memcpy(new_data + stream->data_len, data, cpy_len);
+		stream->data = new_data;
+		stream->data_len += cpy_len;
 	}
 	return KNOT_EOK;
 }
@@ -181,8 +217,10 @@ static int https_on_stream_close_callback(nghttp2_session *session, int32_t stre
 	assert(user_data);
 
 	https_ctx_t *ctx = (https_ctx_t *)user_data;
-	if (ctx->stream == stream_id) {
-		ctx->stream = -1;
+	https_stream_t *stream = https_get_stream(ctx, stream_id);
+	if (stream != NULL && !stream->closed) {
+		stream->closed = true;
+		ctx->closed++;
 	}
 	return KNOT_EOK;
 }
@@ -194,17 +232,21 @@ static int https_on_header_callback(nghttp2_session *session, const nghttp2_fram
 {
 	assert(user_data);
 	https_ctx_t *ctx = (https_ctx_t *)user_data;
+	https_stream_t *stream = https_get_stream(ctx, frame->hd.stream_id);
+	if (stream == NULL) {
+		return KNOT_EOK;
+	}
 
 	if (!strncasecmp(":status", (const char *)name, namelen)) {
 		char *end;
 		long status;
 		status = strtoul((const char *)value, &end, 10);
 		if (value != (const uint8_t *)end) {
-			ctx->status = status;
+			stream->status = status;
 		}
 	}
 	else if (!strncasecmp("location", (const char *)name, namelen) &&
-		 https_status_is_redirect(ctx->status)) {
+		 https_status_is_redirect(stream->status)) {
 		struct http_parser_url redirect_url;
 		http_parser_parse_url((const char *)value, valuelen, 0, &redirect_url);
 
@@ -227,23 +269,14 @@ static int https_on_header_callback(nghttp2_session *session, const nghttp2_fram
 		if (r_path) {
 			free(old_path);
 		}
-		return https_send_dns_query(ctx, ctx->send_buf, ctx->send_buflen);
+		// The query is repeated in a new stream, the old one is ignored.
+		return https_send_stream(ctx, stream);
 	}
 	return KNOT_EOK;
 }
 
-int https_ctx_init(https_ctx_t *ctx, tls_ctx_t *tls_ctx, const https_params_t *params)
+static int https_session_new(https_ctx_t *ctx)
 {
-	if (ctx == NULL || tls_ctx == NULL || params == NULL) {
-		return KNOT_EINVAL;
-	}
-	if (ctx->session != NULL) { // Already initialized before
-		return KNOT_EINVAL;
-	}
-	if (!params->enable) {
-		return KNOT_EINVAL;
-	}
-
 	nghttp2_session_callbacks *callbacks;
 	nghttp2_session_callbacks_new(&callbacks);
 	nghttp2_session_callbacks_set_send_callback(callbacks, https_send_callback);
@@ -254,11 +287,35 @@ int https_ctx_init(https_ctx_t *ctx, tls_ctx_t *tls_ctx, const https_params_t *p
 	nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, https_on_stream_close_callback);
 
 	int ret = nghttp2_session_client_new(&(ctx->session), callbacks, ctx);
+	nghttp2_session_callbacks_del(callbacks);
 	if (ret != 0) {
 		return KNOT_EINVAL;
 	}
 
-	nghttp2_session_callbacks_del(callbacks);
+	for (size_t i = 0; i < HTTPS_MAX_STREAMS; i++) {
+		https_stream_reset(&ctx->streams[i]);
+	}
+	ctx->closed = 0;
+
+	return KNOT_EOK;
+}
+
+int https_ctx_init(https_ctx_t *ctx, tls_ctx_t *tls_ctx, const https_params_t *params)
+{
+	if (ctx == NULL || tls_ctx == NULL || params == NULL) {
+		return KNOT_EINVAL;
+	}
+	if (ctx->session != NULL) { // Already initialized before
+		return KNOT_EINVAL;
+	}
+	if (!params->enable) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = https_session_new(ctx);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
 
 	if (pthread_mutex_init(&ctx->recv_mx, NULL) != 0) {
 		return KNOT_EINVAL;
@@ -268,7 +325,6 @@ int https_ctx_init(https_ctx_t *ctx, tls_ctx_t *tls_ctx, const https_params_t *p
 	ctx->params = *params;
 	ctx->authority = (tls_ctx->params->hostname) ? strdup(tls_ctx->params->hostname) : NULL;
 	ctx->path = strdup((ctx->params.path) ? ctx->params.path : (char *)default_path);
-	ctx->stream = -1;
 
 	return KNOT_EOK;
 }
@@ -325,6 +381,16 @@ int https_ctx_connect(https_ctx_t *ctx, int sockfd, const char *remote,
 		return KNOT_EINVAL;
 	}
 
+	// A session can't continue over a new connection, pending queries are lost.
+	if (nghttp2_session_get_next_stream_id(ctx->session) > 1) {
+		nghttp2_session_del(ctx->session);
+		ctx->session = NULL;
+		int ret = https_session_new(ctx);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
 	// Create TLS connection
 	int ret = tls_ctx_connect(ctx->tls, sockfd, remote, fastopen, addr, https_protocols);
 	if (ret != KNOT_EOK) {
@@ -360,13 +426,16 @@ int https_ctx_connect(https_ctx_t *ctx, int sockfd, const char *remote,
 	return KNOT_EOK;
 }
 
-static int https_send_dns_query_common(https_ctx_t *ctx, nghttp2_nv *hdrs, size_t hdrs_len, nghttp2_data_provider *data_provider)
+static int https_send_dns_query_common(https_ctx_t *ctx, https_stream_t *stream,
+                                       nghttp2_nv *hdrs, size_t hdrs_len,
+                                       nghttp2_data_provider *data_provider)
 {
 	assert(hdrs != NULL && hdrs_len > 0);
 
-	ctx->stream = nghttp2_submit_request(ctx->session, NULL, hdrs, hdrs_len,
-	                                     data_provider, NULL);
-	if (ctx->stream < 0) {
+	stream->id = nghttp2_submit_request(ctx->session, NULL, hdrs, hdrs_len,
+	                                    data_provider, NULL);
+	if (stream->id < 0) {
+		stream->id = -1;
 		return KNOT_NET_ESEND;
 	}
 	int ret = nghttp2_session_send(ctx->session);
@@ -377,17 +446,17 @@ static int https_send_dns_query_common(https_ctx_t *ctx, nghttp2_nv *hdrs, size_
 	return KNOT_EOK;
 }
 
-static int https_send_dns_query_get(https_ctx_t *ctx)
+static int https_send_dns_query_get(https_ctx_t *ctx, https_stream_t *stream)
 {
 	const size_t dns_query_len = strlen(ctx->path) +
 	                             sizeof(default_query) +
-	                             (ctx->send_buflen * 4) / 3 + 3;
+	                             (stream->query_len * 4) / 3 + 3;
 	char dns_query[dns_query_len];
 	strlcpy(dns_query, ctx->path, dns_query_len);
 	strlcat(dns_query, default_query, dns_query_len);
 
 	size_t tmp_strlen = strlen(dns_query);
-	int32_t ret = knot_base64url_encode(ctx->send_buf, ctx->send_buflen,
+	int32_t ret = knot_base64url_encode(stream->query, stream->query_len,
 		(uint8_t *)(dns_query + tmp_strlen), dns_query_len - tmp_strlen - 1);
 	if (ret < 0) {
 		return KNOT_EINVAL;
@@ -401,7 +470,7 @@ static int https_send_dns_query_get(https_ctx_t *ctx)
 		MAKE_STATIC_NV("accept", "application/dns-message"),
 	};
 
-	return https_send_dns_query_common(ctx, hdrs, sizeof(hdrs) / sizeof(*hdrs),
+	return https_send_dns_query_common(ctx, stream, hdrs, sizeof(hdrs) / sizeof(*hdrs),
 	                                   NULL);
 }
 
@@ -422,11 +491,11 @@ static ssize_t https_send_data_callback(nghttp2_session *session, int32_t stream
 	return sent;
 }
 
-static int https_send_dns_query_post(https_ctx_t *ctx)
+static int https_send_dns_query_post(https_ctx_t *ctx, https_stream_t *stream)
 {
 	                                             // size of number in text form (base 10)
 	char content_length[sizeof(size_t) * 3 + 1]; // limit for x->inf: log10(2^(8*sizeof(x))-1)/sizeof(x) = 2,408239965 -> 3
-	int content_length_len = sprintf(content_length, "%zu", ctx->send_buflen);
+	int content_length_len = sprintf(content_length, "%zu", stream->query_len);
 
 	nghttp2_nv hdrs[] = {
 		MAKE_STATIC_NV(":method", "POST"),
@@ -438,36 +507,50 @@ static int https_send_dns_query_post(https_ctx_t *ctx)
 		MAKE_NV("content-length", 14, content_length, content_length_len)
 	};
 
-	https_data_provider_t data = {
-		.buf = ctx->send_buf,
-		.buf_len = ctx->send_buflen
-	};
+	// The body may be sent later, e.g. if the peer limits the concurrent streams.
+	stream->body.buf = stream->query;
+	stream->body.buf_len = stream->query_len;
 
 	nghttp2_data_provider data_provider = {
-		.source.ptr = &data,
+		.source.ptr = &stream->body,
 		.read_callback = https_send_data_callback
 	};
 
-	return https_send_dns_query_common(ctx, hdrs, sizeof(hdrs) / sizeof(*hdrs),
+	return https_send_dns_query_common(ctx, stream, hdrs, sizeof(hdrs) / sizeof(*hdrs),
 	                                   &data_provider);
 }
 
+static int https_send_stream(https_ctx_t *ctx, https_stream_t *stream)
+{
+	assert(ctx->params.method == POST || ctx->params.method == GET);
+
+	free(stream->data);
+	stream->data = NULL;
+	stream->data_len = 0;
+	stream->status = 0;
+
+	if (ctx->params.method == POST) {
+		return https_send_dns_query_post(ctx, stream);
+	} else {
+		return https_send_dns_query_get(ctx, stream);
+	}
+}
+
 int https_send_dns_query(https_ctx_t *ctx, const uint8_t *buf, const size_t buf_len)
 {
 	if (ctx == NULL || buf == NULL || buf_len == 0) {
 		return KNOT_EINVAL;
 	}
 
-	ctx->send_buf = buf;
-	ctx->send_buflen = buf_len;
+	https_stream_t *stream = https_get_stream(ctx, -1);
+	if (stream == NULL) {
+		return KNOT_ELIMIT;
+	}
 
-	assert(ctx->params.method == POST || ctx->params.method == GET);
+	stream->query = buf;
+	stream->query_len = buf_len;
 
-	if (ctx->params.method == POST) {
-		return https_send_dns_query_post(ctx);
-	} else {
-		return https_send_dns_query_get(ctx);
-	}
+	return https_send_stream(ctx, stream);
 }
 
 int https_recv_dns_response(https_ctx_t *ctx, uint8_t *buf, const size_t buf_len)
@@ -477,15 +560,33 @@ int https_recv_dns_response(https_ctx_t *ctx, uint8_t *buf, const size_t buf_len
 	}
 
 	pthread_mutex_lock(&ctx->recv_mx);
-	ctx->recv_buf = buf;
-	ctx->recv_buflen = buf_len;
 
-	int ret = nghttp2_session_recv(ctx->session);
-	if (ret != 0) {
+	if (ctx->closed == 0) {
+		int ret = nghttp2_session_recv(ctx->session);
+		if (ret != 0) {
+			pthread_mutex_unlock(&ctx->recv_mx);
+			return KNOT_NET_ERECV;
+		}
+	}
+
+	https_stream_t *stream = NULL;
+	for (size_t i = 0; i < HTTPS_MAX_STREAMS && stream == NULL; i++) {
+		if (ctx->streams[i].id >= 0 && ctx->streams[i].closed) {
+			stream = &ctx->streams[i];
+		}
+	}
+	if (stream == NULL) {
 		pthread_mutex_unlock(&ctx->recv_mx);
 		return KNOT_NET_ERECV;
 	}
-	ctx->recv_buf = NULL;
+
+	size_t len = MIN(stream->data_len, buf_len);
+	if (len > 0) {
+		memcpy(buf, stream->data, len);
+	}
+	ctx->status = stream->status;
+	https_stream_reset(stream);
+	ctx->closed--;
 
 	pthread_mutex_unlock(&ctx->recv_mx);
 
@@ -494,8 +595,7 @@ int https_recv_dns_response(https_ctx_t *ctx, uint8_t *buf, const size_t buf_len
 		return KNOT_NET_ERECV;
 	}
 
-	assert(buf_len >= ctx->recv_buflen);
-	return buf_len - ctx->recv_buflen;
+	return len;
 }
 
 void https_ctx_deinit(https_ctx_t *ctx)
@@ -504,6 +604,9 @@ void https_ctx_deinit(https_ctx_t *ctx)
 		return;
 	}
 
+	for (size_t i = 0; i < HTTPS_MAX_STREAMS; i++) {
+		https_stream_reset(&ctx->streams[i]);
+	}
 	nghttp2_session_del(ctx->session);
 	ctx->session = NULL;
 	pthread_mutex_destroy(&ctx->recv_mx);
@@ -18,6 +18,9 @@
 
 #include <stdbool.h>
 
+/*! \brief Maximum number of concurrent requests over one connection. */
+#define HTTPS_MAX_STREAMS	16
+
 /*! \brief HTTP method to transfer query. */
 typedef enum {
 	POST,
@@ -52,6 +55,18 @@ typedef struct {
 	size_t buf_len;
 } https_data_provider_t;
 
+/*! \brief One request in progress. */
+typedef struct {
+	int32_t id;              /*!< Stream ID, -1 if the slot is unused. */
+	const uint8_t *query;    /*!< Query to be resent on redirect. */
+	size_t query_len;
+	uint8_t *data;           /*!< Received response. */
+	size_t data_len;
+	unsigned long status;
+	bool closed;             /*!< The response is complete. */
+	https_data_provider_t body;
+} https_stream_t;
+
 /*! \brief HTTPS context. */
 typedef struct {
 	// Parameters
@@ -63,18 +78,13 @@ typedef struct {
 	char *authority;
 	char *path;
 
-	// Send destination
-	const uint8_t *send_buf;
-	size_t send_buflen;
-
-	// Recv destination
-	uint8_t *recv_buf;
-	size_t recv_buflen;
+	// Requests in progress, answered in any order
+	https_stream_t streams[HTTPS_MAX_STREAMS];
+	size_t closed;
 	unsigned long status;
 
 	// Recv locks
 	pthread_mutex_t recv_mx;
-	int32_t stream;
 } https_ctx_t;
 
 /*!
@@ -110,12 +120,17 @@ int https_ctx_connect(https_ctx_t *ctx, int sockfd, const char *remote,
 /*!
  * \brief Send buffer as DNS message over HTTPS.
  *
+ * Up to HTTPS_MAX_STREAMS queries can be sent before receiving the responses,
+ * each one is sent in its own stream of the connection. The buffer must be
+ * valid until the response is received.
+ *
  * \param ctx      HTTPS context.
  * \param buf      Buffer with DNS message in wire format.
  * \param buf_len  Length of buffer.
  *
  * \retval KNOT_EOK        When successfully sent.
  * \retval KNOT_EINVAL     When parameters are invalid.
+ * \retval KNOT_ELIMIT     When too many queries are pending.
  * \retval KNOT_NET_ESEND  When error occurs while sending a data.
  */
 int https_send_dns_query(https_ctx_t *ctx, const uint8_t *buf, const size_t buf_len);
@@ -123,6 +138,8 @@ int https_send_dns_query(https_ctx_t *ctx, const uint8_t *buf, const size_t buf_
 /*!
  * \brief Receive DATA frame as HTTPS packet, and store it into buffer.
  *
+ * The responses of several pending queries may be returned in any order.
+ *
  * \param ctx      HTTPS context.
  * \param buf      Buffer where will be DNS response stored.
  * \param buf_len  Length of buffer.
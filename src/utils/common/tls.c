@@ -17,8 +17,11 @@
 #include <assert.h>
 #include <arpa/inet.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <poll.h>
+#include <unistd.h>
 #include <gnutls/gnutls.h>
 #include <gnutls/ocsp.h>
 #include <gnutls/x509.h>
@@ -93,6 +96,14 @@ int tls_params_copy(tls_params_t *dst, const tls_params_t *src)
 
 	dst->ocsp_stapling = src->ocsp_stapling;
 
+	if (src->session_file != NULL) {
+		dst->session_file = strdup(src->session_file);
+		if (dst->session_file == NULL) {
+			tls_params_clean(dst);
+			return KNOT_ENOMEM;
+		}
+	}
+
 	ptrnode_t *n;
 	WALK_LIST(n, src->ca_files) {
 		char *src_file = (char *)n->d;
@@ -136,6 +147,7 @@ void tls_params_clean(tls_params_t *params)
 	free(params->sni);
 	free(params->keyfile);
 	free(params->certfile);
+	free(params->session_file);
 
 	memset(params, 0, sizeof(*params));
 }
@@ -421,6 +433,63 @@ static int verify_certificate(gnutls_session_t session)
 	return GNUTLS_E_SUCCESS;
 }
 
+#define SESSION_FILE_MAX	(64 * 1024)
+
+static void session_load(tls_ctx_t *ctx)
+{
+	FILE *f = fopen(ctx->params->session_file, "r");
+	if (f == NULL) {
+		return; // Not stored yet.
+	}
+
+	uint8_t *data = gnutls_malloc(SESSION_FILE_MAX);
+	size_t len = (data != NULL) ? fread(data, 1, SESSION_FILE_MAX, f) : 0;
+	fclose(f);
+	if (len == 0 || len == SESSION_FILE_MAX) {
+		gnutls_free(data);
+		return;
+	}
+
+	ctx->session_data.data = data;
+	ctx->session_data.size = len;
+	DBG("TLS, loaded session from '%s'\n", ctx->params->session_file);
+}
+
+static void session_save(tls_ctx_t *ctx)
+{
+	gnutls_datum_t data = { NULL, 0 };
+	// Fails unless the handshake completed.
+	if (gnutls_session_get_data2(ctx->session, &data) != GNUTLS_E_SUCCESS) {
+		return;
+	}
+
+	gnutls_free(ctx->session_data.data);
+	ctx->session_data = data;
+
+	if (ctx->params->session_file == NULL) {
+		return;
+	}
+
+	// The session holds the keys, keep it private and don't let parallel
+	// connections overwrite a partially written file.
+	const char *file = ctx->params->session_file;
+	size_t tmp_len = strlen(file) + 8;
+	char tmp[tmp_len];
+	(void)snprintf(tmp, tmp_len, "%s.XXXXXX", file);
+	int fd = mkstemp(tmp);
+	if (fd < 0) {
+		WARN("TLS, failed to store session into '%s'\n", file);
+		return;
+	}
+
+	bool written = (write(fd, data.data, data.size) == (ssize_t)data.size);
+	close(fd);
+	if (!written || rename(tmp, file) != 0) {
+		WARN("TLS, failed to store session into '%s'\n", file);
+		unlink(tmp);
+	}
+}
+
 int tls_ctx_init(tls_ctx_t *ctx, const tls_params_t *params, int wait)
 {
 	if (ctx == NULL || params == NULL || !params->enable) {
@@ -533,6 +602,19 @@ int tls_ctx_connect(tls_ctx_t *ctx, int sockfd, const char *remote, bool fastope
 
 	gnutls_session_set_ptr(ctx->session, ctx);
 
+	// Resume the previous session if available.
+	if (ctx->session_data.data == NULL && ctx->params->session_file != NULL) {
+		session_load(ctx);
+	}
+	if (ctx->session_data.data != NULL) {
+		ret = gnutls_session_set_data(ctx->session, ctx->session_data.data,
+		                              ctx->session_data.size);
+		if (ret != GNUTLS_E_SUCCESS) {
+			DBG("TLS, failed to resume session (%s)\n",
+			    gnutls_strerror_name(ret));
+		}
+	}
+
 	if (fastopen) {
 #if GNUTLS_VERSION_NUMBER >= GNUTLS_VERSION_FASTOPEN_READY
 		gnutls_transport_set_fastopen(ctx->session, sockfd, (struct sockaddr *)addr,
@@ -687,6 +769,10 @@ void tls_ctx_close(tls_ctx_t *ctx)
 		return;
 	}
 
+	// TLS 1.3 tickets arrive after the handshake, so the session is
+	// retrieved at the end of the connection.
+	session_save(ctx);
+
 	gnutls_bye(ctx->session, GNUTLS_SHUT_RDWR);
 	gnutls_deinit(ctx->session);
 }
@@ -701,6 +787,10 @@ void tls_ctx_deinit(tls_ctx_t *ctx)
 		gnutls_certificate_free_credentials(ctx->credentials);
 		ctx->credentials = NULL;
 	}
+
+	gnutls_free(ctx->session_data.data);
+	ctx->session_data.data = NULL;
+	ctx->session_data.size = 0;
 }
 
 void print_tls(const tls_ctx_t *ctx)
@@ -710,6 +800,7 @@ void print_tls(const tls_ctx_t *ctx)
 	}
 
 	char *msg = gnutls_session_get_desc(ctx->session);
-	printf(";; TLS session %s\n", msg);
+	printf(";; TLS session %s%s\n", msg,
+	       gnutls_session_is_resumed(ctx->session) ? " (resumed)" : "");
 	gnutls_free(msg);
 }
@@ -43,6 +43,8 @@ typedef struct {
 	char *certfile;
 	/*! Optional validity of stapled OCSP response for the server cert. */
 	uint32_t ocsp_stapling;
+	/*! Optional file to store the session for resumption across runs. */
+	char *session_file;
 } tls_params_t;
 
 /*! \brief TLS context. */
@@ -57,6 +59,8 @@ typedef struct {
 	gnutls_session_t session;
 	/*! GnuTLS credentials handle. */
 	gnutls_certificate_credentials_t credentials;
+	/*! Data of the last session for resumption. */
+	gnutls_datum_t session_data;
 } tls_ctx_t;
 
 extern const gnutls_datum_t dot_alpn;
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "contrib/qp-trie/trie.h"
 #include "knot/catalog/catalog_db.h"
 #include "utils/common/msg.h"
 #include "utils/common/params.h"
@@ -35,6 +36,7 @@ static void print_help(void)
 	       " -C, --confdb <dir>  Path to a configuration database directory.\n"
 	       "                      (default %s)\n"
 	       " -D, --dir <path>    Path to a catalog database directory, use default configuration.\n"
+	       " -S, --summary       Print the number of members of each catalog in JSON.\n"
 	       " -h, --help          Print the program help.\n"
 	       " -V, --version       Print the program version.\n",
 	       PROGRAM_NAME, CONF_DEFAULT_FILE, CONF_DEFAULT_DBDIR);
@@ -78,19 +80,70 @@ static void catalog_print(catalog_t *cat)
 	printf("Total records: %zd\n", total);
 }
 
+static int catalog_count_cb(_unused_ const knot_dname_t *mem, _unused_ const knot_dname_t *ow,
+                            const knot_dname_t *cz, _unused_ const char *group, void *ctx)
+{
+	trie_val_t *val = trie_get_ins(ctx, (const trie_key_t *)cz, knot_dname_size(cz));
+	if (val == NULL) {
+		return KNOT_ENOMEM;
+	}
+	*val = (void *)((uintptr_t)*val + 1);
+	return KNOT_EOK;
+}
+
+static int catalog_summary(catalog_t *cat)
+{
+	trie_t *counts = trie_create(NULL);
+	if (counts == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// Only the keys are parsed, the member records are not printed.
+	int ret = catalog_open(cat);
+	if (ret == KNOT_EOK) {
+		ret = catalog_apply(cat, NULL, catalog_count_cb, counts, false);
+	}
+
+	trie_it_t *it = trie_it_begin(counts);
+	for (; ret == KNOT_EOK && it != NULL && !trie_it_finished(it); trie_it_next(it)) {
+		size_t len = 0;
+		const knot_dname_t *cz = (const knot_dname_t *)trie_it_key(it, &len);
+		knot_dname_txt_storage_t cz_str;
+		if (knot_dname_to_str(cz_str, cz, sizeof(cz_str)) == NULL) {
+			ret = KNOT_EINVAL;
+			break;
+		}
+		printf("{\"catalog\":\"");
+		for (const char *c = cz_str; *c != '\0'; c++) {
+			if (*c == '"' || *c == '\\') {
+				putchar('\\');
+			}
+			putchar(*c);
+		}
+		printf("\",\"members\":%zu}\n", (size_t)(uintptr_t)*trie_it_val(it));
+	}
+	trie_it_free(it);
+	trie_free(counts);
+
+	return ret;
+}
+
 int main(int argc, char *argv[])
 {
 	struct option opts[] = {
 		{ "config",  required_argument, NULL, 'c' },
 		{ "confdb",  required_argument, NULL, 'C' },
 		{ "dir",     required_argument, NULL, 'D' },
+		{ "summary", no_argument,       NULL, 'S' },
 		{ "help",    no_argument,       NULL, 'h' },
 		{ "version", no_argument,       NULL, 'V' },
 		{ NULL }
 	};
 
+	bool summary = false;
+
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:D:hV", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:D:ShV", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			if (util_conf_init_file(optarg) != KNOT_EOK) {
@@ -107,6 +160,9 @@ int main(int argc, char *argv[])
 				goto failure;
 			}
 			break;
+		case 'S':
+			summary = true;
+			break;
 		case 'h':
 			print_help();
 			goto success;
@@ -137,6 +193,15 @@ int main(int argc, char *argv[])
 	char *db = conf_db(conf(), C_CATALOG_DB);
 	catalog_init(&c, db, 0); // mapsize grows automatically
 	free(db);
+	if (summary) {
+		int ret = catalog_summary(&c);
+		catalog_deinit(&c);
+		if (ret != KNOT_EOK && ret != KNOT_ENODB) {
+			ERR2("failed to summarize catalog (%s)\n", knot_strerror(ret));
+			goto failure;
+		}
+		goto success;
+	}
 	catalog_print(&c);
 	catalog_deinit(&c);
 
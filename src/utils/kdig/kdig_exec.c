@@ -14,6 +14,8 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
@@ -25,6 +27,7 @@
 #include "utils/common/netio.h"
 #include "utils/common/sign.h"
 #include "libknot/libknot.h"
+#include "contrib/macros.h"
 #include "contrib/sockaddr.h"
 #include "contrib/time.h"
 #include "contrib/ucw/lists.h"
@@ -1209,6 +1212,373 @@ finish:
 	return ret;
 }
 
+#define BULK_WINDOW		32
+#define BULK_THREADS_MAX	128
+#define BULK_LINE_MAX		1024
+
+/*! \brief Shared state of the bulk query workers. */
+typedef struct {
+	const query_t *query;
+	const srv_info_t *remote;
+	FILE *in;
+	pthread_mutex_t in_lock;
+	size_t line;
+	pthread_mutex_t out_lock;
+	uint32_t window;
+	size_t total;
+	size_t failed;
+} bulk_ctx_t;
+
+/*! \brief One in-flight query of a bulk query worker. */
+typedef struct {
+	knot_pkt_t *pkt;
+	char owner[KNOT_DNAME_TXT_MAXLEN + 1];
+	uint16_t type;
+	uint16_t cls;
+	size_t line;
+	struct timespec t_sent;
+	bool done;
+} bulk_slot_t;
+
+static void bulk_json_str(FILE *out, const char *key, const char *str)
+{
+	fprintf(out, "\"%s\":\"", key);
+	for (const char *c = str; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(out, "\\%c", *c);
+		} else if ((unsigned char)*c < 0x20) {
+			fprintf(out, "\\u%04x", (unsigned char)*c);
+		} else {
+			fputc(*c, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void bulk_result(bulk_ctx_t *ctx, const bulk_slot_t *slot,
+                        const knot_pkt_t *reply, const char *error)
+{
+	char type[16], cls[16];
+	(void)knot_rrtype_to_string(slot->type, type, sizeof(type));
+	(void)knot_rrclass_to_string(slot->cls, cls, sizeof(cls));
+
+	pthread_mutex_lock(&ctx->out_lock);
+
+	fputc('{', stdout);
+	bulk_json_str(stdout, "qname", slot->owner);
+	fputc(',', stdout);
+	bulk_json_str(stdout, "qtype", type);
+	fputc(',', stdout);
+	bulk_json_str(stdout, "qclass", cls);
+	if (reply != NULL) {
+		struct timespec t_recv;
+		clock_gettime(CLOCK_MONOTONIC, &t_recv);
+
+		fputc(',', stdout);
+		bulk_json_str(stdout, "rcode", knot_pkt_ext_rcode_name(reply));
+		printf(",\"aa\":%s,\"tc\":%s,\"answer\":%u,\"authority\":%u,"
+		       "\"additional\":%u,\"time\":%.3f}\n",
+		       knot_wire_get_aa(reply->wire) ? "true" : "false",
+		       knot_wire_get_tc(reply->wire) ? "true" : "false",
+		       knot_wire_get_ancount(reply->wire),
+		       knot_wire_get_nscount(reply->wire),
+		       knot_wire_get_arcount(reply->wire),
+		       time_diff_ms(&slot->t_sent, &t_recv));
+	} else {
+		fputc(',', stdout);
+		bulk_json_str(stdout, "error", error);
+		fputs("}\n", stdout);
+		ctx->failed++;
+	}
+	ctx->total++;
+
+	pthread_mutex_unlock(&ctx->out_lock);
+}
+
+/*!
+ * \brief Reads the next query from the list into the slot.
+ *
+ * \retval KNOT_EOK     if the slot is ready to be queried.
+ * \retval KNOT_EMALF   if the line is malformed (already reported).
+ * \retval KNOT_ENOENT  if the query list is exhausted.
+ */
+static int bulk_read(bulk_ctx_t *ctx, query_t *query, bulk_slot_t *slot)
+{
+	char line[BULK_LINE_MAX];
+
+	do {
+		pthread_mutex_lock(&ctx->in_lock);
+		char *ret = fgets(line, sizeof(line), ctx->in);
+		slot->line = ++ctx->line;
+		pthread_mutex_unlock(&ctx->in_lock);
+		if (ret == NULL) {
+			return KNOT_ENOENT;
+		}
+		line[strcspn(line, "#;\r\n")] = '\0';
+	} while (line[strspn(line, " \t")] == '\0');
+
+	// Line format: name [type] [class] (type and class in any order).
+	char *save = NULL;
+	char *owner = strtok_r(line, " \t", &save);
+	slot->type = ctx->query->type_num;
+	slot->cls = ctx->query->class_num;
+	(void)snprintf(slot->owner, sizeof(slot->owner), "%s", owner);
+
+	bool valid = true;
+	for (char *tok = strtok_r(NULL, " \t", &save); tok != NULL;
+	     tok = strtok_r(NULL, " \t", &save)) {
+		if (knot_rrtype_from_string(tok, &slot->type) != 0 &&
+		    knot_rrclass_from_string(tok, &slot->cls) != 0) {
+			valid = false;
+		}
+	}
+	if (!valid || slot->type == KNOT_RRTYPE_AXFR || slot->type == KNOT_RRTYPE_IXFR) {
+		bulk_result(ctx, slot, NULL, "malformed query");
+		return KNOT_EMALF;
+	}
+
+	query->owner = slot->owner;
+	query->type_num = slot->type;
+	query->class_num = slot->cls;
+	slot->pkt = create_query_packet(query);
+	query->owner = NULL;
+	if (slot->pkt == NULL) {
+		bulk_result(ctx, slot, NULL, "malformed query");
+		return KNOT_EMALF;
+	}
+
+	// Report the canonical form of the name.
+	(void)knot_dname_to_str(slot->owner, knot_pkt_wire_qname(slot->pkt),
+	                        sizeof(slot->owner));
+	slot->done = false;
+
+	return KNOT_EOK;
+}
+
+static bulk_slot_t *bulk_match(bulk_slot_t *slots, size_t count,
+                               uint16_t base, const knot_pkt_t *reply)
+{
+	uint16_t idx = knot_wire_get_id(reply->wire) - base;
+	if (idx >= count || slots[idx].done) {
+		return NULL;
+	}
+
+	knot_pkt_t *query = slots[idx].pkt;
+	if (!knot_wire_get_qr(reply->wire) ||
+	    knot_pkt_qtype(reply) != knot_pkt_qtype(query) ||
+	    knot_pkt_qclass(reply) != knot_pkt_qclass(query) ||
+	    !knot_dname_is_case_equal(knot_pkt_qname(reply), knot_pkt_qname(query))) {
+		return NULL;
+	}
+
+	return &slots[idx];
+}
+
+static void *bulk_worker(void *arg)
+{
+	bulk_ctx_t *ctx = arg;
+	const query_t *conf = ctx->query;
+
+	query_t *query = query_create(NULL, conf);
+	bulk_slot_t *slots = calloc(ctx->window, sizeof(*slots));
+	uint8_t *buf = malloc(MAX_PACKET_SIZE);
+	if (query == NULL || slots == NULL || buf == NULL) {
+		ERR("not enough memory\n");
+		goto finish;
+	}
+
+	int iptype = get_iptype(conf->ip);
+	int socktype = get_socktype(conf->protocol, conf->type_num);
+	int flags = conf->fastopen ? NET_FLAGS_FASTOPEN : NET_FLAGS_NONE;
+	bool stream = (socktype == SOCK_STREAM);
+
+	// One connection per worker, reused for all its queries. Over HTTPS,
+	// the queries of the window are multiplexed in concurrent streams.
+	net_t net;
+	int ret = net_init(conf->local, ctx->remote, iptype, socktype, conf->wait,
+	                   flags, &conf->tls, &conf->https, &net);
+	if (ret != KNOT_EOK) {
+		ERR("can't initialize connection to %s@%s (%s)\n",
+		    ctx->remote->name, ctx->remote->service, knot_strerror(ret));
+		goto finish;
+	}
+
+	bool eof = false;
+	while (!eof) {
+		// Fill the window with next queries.
+		size_t count = 0;
+		while (count < ctx->window) {
+			ret = bulk_read(ctx, query, &slots[count]);
+			if (ret == KNOT_ENOENT) {
+				eof = true;
+				break;
+			} else if (ret == KNOT_EOK) {
+				count++;
+			}
+		}
+		if (count == 0) {
+			break;
+		}
+
+		// Consecutive message IDs allow simple matching of the replies.
+		uint16_t base = knot_wire_get_id(slots[0].pkt->wire);
+		for (size_t i = 0; i < count; i++) {
+			knot_wire_set_id(slots[i].pkt->wire, base + i);
+		}
+
+		// UDP uses retries, broken streams are reconnected once.
+		uint32_t attempts = stream ? 1 : conf->retries;
+		size_t pending = count;
+		const char *error = "timeout";
+		for (uint32_t attempt = 0; pending > 0 && attempt <= attempts; attempt++) {
+			if (net.sockfd < 0 && net_connect(&net) != KNOT_EOK) {
+				error = "connection failed";
+				continue;
+			}
+
+			bool broken = false;
+			for (size_t i = 0; i < count && !broken; i++) {
+				if (slots[i].done) {
+					continue;
+				}
+				clock_gettime(CLOCK_MONOTONIC, &slots[i].t_sent);
+				if (net_send(&net, slots[i].pkt->wire, slots[i].pkt->size) != KNOT_EOK) {
+					broken = true;
+				}
+			}
+
+			while (pending > 0 && !broken) {
+				int len = net_receive(&net, buf, MAX_PACKET_SIZE);
+				if (len == KNOT_NET_ETIMEOUT) {
+					error = "timeout";
+					break;
+				} else if (len <= 0) {
+					broken = true;
+					break;
+				}
+
+				knot_pkt_t *reply = knot_pkt_new(buf, len, NULL);
+				if (reply == NULL || knot_pkt_parse(reply, 0) != KNOT_EOK) {
+					knot_pkt_free(reply);
+					continue;
+				}
+				bulk_slot_t *slot = bulk_match(slots, count, base, reply);
+				if (slot != NULL) {
+					bulk_result(ctx, slot, reply, NULL);
+					slot->done = true;
+					pending--;
+				}
+				knot_pkt_free(reply);
+			}
+
+			if (broken) {
+				error = "connection failed";
+				net_close(&net);
+			} else if (stream) {
+				// Unanswered requests would occupy the HTTPS streams.
+				if (pending > 0 && conf->https.enable) {
+					net_close(&net);
+				}
+				// Don't repeat queries over a working connection.
+				break;
+			}
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			if (!slots[i].done) {
+				bulk_result(ctx, &slots[i], NULL, error);
+			}
+			knot_pkt_free(slots[i].pkt);
+			slots[i].pkt = NULL;
+		}
+	}
+
+	if (net.sockfd >= 0) {
+		net_close(&net);
+	}
+	net_clean(&net);
+finish:
+	free(buf);
+	free(slots);
+	query_free(query);
+
+	return NULL;
+}
+
+static int process_bulk(const query_t *query)
+{
+	if (query->tsig_key.name != NULL) {
+		ERR("bulk mode doesn't support TSIG\n");
+		return KNOT_ENOTSUP;
+	}
+
+	if (EMPTY_LIST(query->servers)) {
+		WARN("no servers to query\n");
+		return KNOT_EINVAL;
+	}
+
+	bulk_ctx_t ctx = {
+		.query = query,
+		.remote = (srv_info_t *)HEAD(query->servers),
+	};
+
+	if (strcmp(query->bulk, "-") == 0) {
+		ctx.in = stdin;
+	} else {
+		ctx.in = fopen(query->bulk, "r");
+		if (ctx.in == NULL) {
+			ERR("can't open query list %s\n", query->bulk);
+			return KNOT_EFILE;
+		}
+	}
+
+	// Spread the concurrent queries over worker threads with a few
+	// outstanding queries each.
+	uint32_t window = query->https.enable ? HTTPS_MAX_STREAMS : BULK_WINDOW;
+	uint32_t threads = MIN((query->bulk_inflight + window - 1) / window,
+	                       BULK_THREADS_MAX);
+	ctx.window = (query->bulk_inflight + threads - 1) / threads;
+
+	pthread_mutex_init(&ctx.in_lock, NULL);
+	pthread_mutex_init(&ctx.out_lock, NULL);
+
+	// Connections closed by the server are reopened, not fatal.
+	signal(SIGPIPE, SIG_IGN);
+
+	struct timespec t_start, t_end;
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+
+	pthread_t workers[BULK_THREADS_MAX];
+	uint32_t started = 0;
+	for (; started < threads; started++) {
+		if (pthread_create(&workers[started], NULL, bulk_worker, &ctx) != 0) {
+			break;
+		}
+	}
+	if (started == 0) {
+		ERR("can't start bulk query workers\n");
+	}
+	for (uint32_t i = 0; i < started; i++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	double elapsed = time_diff_ms(&t_start, &t_end) / 1000;
+
+	fflush(stdout);
+	fprintf(stderr, ";; Bulk: %zu queries, %zu failed, %.2f s, %.0f qps\n",
+	        ctx.total, ctx.failed, elapsed,
+	        elapsed > 0 ? ctx.total / elapsed : 0);
+
+	pthread_mutex_destroy(&ctx.in_lock);
+	pthread_mutex_destroy(&ctx.out_lock);
+	if (ctx.in != stdin) {
+		fclose(ctx.in);
+	}
+
+	return (started > 0 && ctx.failed == 0) ? KNOT_EOK : KNOT_ERROR;
+}
+
 int kdig_exec(const kdig_params_t *params)
 {
 	node_t *n;
@@ -1228,7 +1598,11 @@ int kdig_exec(const kdig_params_t *params)
 		int ret = -1;
 		switch (query->operation) {
 		case OPERATION_QUERY:
-			ret = process_query(query, &net);
+			if (query->bulk != NULL) {
+				ret = process_bulk(query);
+			} else {
+				ret = process_query(query, &net);
+			}
 			break;
 		case OPERATION_XFR:
 			ret = process_xfr(query, &net);
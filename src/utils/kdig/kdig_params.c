@@ -41,6 +41,8 @@
 
 #define DEFAULT_RETRIES_DIG		2
 #define DEFAULT_TIMEOUT_DIG		5
+#define DEFAULT_BULK_INFLIGHT		1000
+#define MAX_BULK_INFLIGHT		65535
 #define DEFAULT_ALIGNMENT_SIZE		128
 #define DEFAULT_TLS_OCSP_STAPLING	(7 * 24 * 3600)
 
@@ -819,6 +821,26 @@ static int opt_notls_certfile(const char *arg, void *query)
 	return KNOT_EOK;
 }
 
+static int opt_tls_session(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	free(q->tls.session_file);
+	q->tls.session_file = strdup(arg);
+
+	return opt_tls(arg, query);
+}
+
+static int opt_notls_session(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	free(q->tls.session_file);
+	q->tls.session_file = NULL;
+
+	return KNOT_EOK;
+}
+
 static int opt_tls_ocsp_stapling(const char *arg, void *query)
 {
 	query_t *q = query;
@@ -1245,6 +1267,51 @@ static int opt_noretry(const char *arg, void *query)
 	return KNOT_EOK;
 }
 
+static int opt_bulk(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	free(q->bulk);
+	q->bulk = strdup(arg);
+	if (q->bulk == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_nobulk(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	free(q->bulk);
+	q->bulk = NULL;
+
+	return KNOT_EOK;
+}
+
+static int opt_bulk_inflight(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	if (str_to_u32(arg, &q->bulk_inflight) != KNOT_EOK ||
+	    q->bulk_inflight == 0 || q->bulk_inflight > MAX_BULK_INFLIGHT) {
+		ERR("invalid +bulk-inflight=%s\n", arg);
+		return KNOT_EINVAL;
+	}
+
+	return KNOT_EOK;
+}
+
+static int opt_nobulk_inflight(const char *arg, void *query)
+{
+	query_t *q = query;
+
+	q->bulk_inflight = DEFAULT_BULK_INFLIGHT;
+
+	return KNOT_EOK;
+}
+
 static int parse_ednsopt(const char *arg, ednsopt_t **opt_ptr)
 {
 	errno = 0;
@@ -1431,6 +1498,9 @@ static const param_t kdig_opts2[] = {
 	{ "tls-certfile",   ARG_REQUIRED, opt_tls_certfile },
 	{ "notls-certfile", ARG_NONE,     opt_notls_certfile },
 
+	{ "tls-session",    ARG_REQUIRED, opt_tls_session },
+	{ "notls-session",  ARG_NONE,     opt_notls_session },
+
 	{ "tls-ocsp-stapling",   ARG_OPTIONAL, opt_tls_ocsp_stapling },
 	{ "notls-ocsp-stapling", ARG_NONE,     opt_notls_ocsp_stapling },
 
@@ -1477,6 +1547,12 @@ static const param_t kdig_opts2[] = {
 	{ "ednsopt",        ARG_REQUIRED, opt_ednsopt },
 	{ "noednsopt",      ARG_NONE,     opt_noednsopt },
 
+	{ "bulk",           ARG_REQUIRED, opt_bulk },
+	{ "nobulk",         ARG_NONE,     opt_nobulk },
+
+	{ "bulk-inflight",  ARG_REQUIRED, opt_bulk_inflight },
+	{ "nobulk-inflight", ARG_NONE,    opt_nobulk_inflight },
+
 	/* "idn" doesn't work since it must be called before query creation. */
 	{ "noidn",          ARG_NONE,     opt_noidn },
 
@@ -1506,6 +1582,8 @@ query_t *query_create(const char *owner, const query_t *conf)
 		query->retries = DEFAULT_RETRIES_DIG;
 		query->wait = DEFAULT_TIMEOUT_DIG;
 		query->ignore_tc = false;
+		query->bulk = NULL;
+		query->bulk_inflight = DEFAULT_BULK_INFLIGHT;
 		query->class_num = -1;
 		query->type_num = -1;
 		query->serial = -1;
@@ -1531,6 +1609,14 @@ query_t *query_create(const char *owner, const query_t *conf)
 	} else {
 		*query = *conf;
 		query->conf = conf;
+		query->bulk = NULL;
+		if (conf->bulk != NULL) {
+			query->bulk = strdup(conf->bulk);
+			if (query->bulk == NULL) {
+				query_free(query);
+				return NULL;
+			}
+		}
 		if (conf->local != NULL) {
 			query->local = srv_info_create(conf->local->name,
 			                               conf->local->service);
@@ -1628,6 +1714,7 @@ void query_free(query_t *query)
 
 	free(query->owner);
 	free(query->port);
+	free(query->bulk);
 	free(query);
 }
 
@@ -2184,6 +2271,7 @@ static void print_help(void)
 	       "       +[no]tls-sni=STR           Use TLS with Server Name Indication.\n"
 	       "       +[no]tls-keyfile=FILE      Use TLS with a client keyfile.\n"
 	       "       +[no]tls-certfile=FILE     Use TLS with a client certfile.\n"
+	       "       +[no]tls-session=FILE      Use TLS with session resumption from FILE.\n"
 	       "       +[no]tls-ocsp-stapling[=H] Use TLS with a valid stapled OCSP response for the\n"
 	       "                                  server certificate (%u or specify hours).\n"
 #ifdef LIBNGHTTP2
@@ -2202,11 +2290,14 @@ static void print_help(void)
 	       "       +[no]cookie[=HEX]          Attach EDNS(0) cookie to the query.\n"
 	       "       +[no]badcookie             Repeat a query with the correct cookie.\n"
 	       "       +[no]ednsopt=CODE[:HEX]    Set custom EDNS option.\n"
+	       "       +[no]bulk=FILE             Query names from FILE concurrently, print JSON.\n"
+	       "       +[no]bulk-inflight=N       Set number of concurrent bulk queries (%u).\n"
 	       "       +noidn                     Disable IDN transformation.\n"
 	       "\n"
 	       "       -h, --help                 Print the program help.\n"
 	       "       -V, --version              Print the program version.\n",
-	       PROGRAM_NAME, DEFAULT_TLS_OCSP_STAPLING / 3600, DEFAULT_ALIGNMENT_SIZE);
+	       PROGRAM_NAME, DEFAULT_TLS_OCSP_STAPLING / 3600, DEFAULT_ALIGNMENT_SIZE,
+	       DEFAULT_BULK_INFLIGHT);
 }
 
 static int parse_opt1(const char *opt, const char *value, kdig_params_t *params,
@@ -2570,6 +2661,15 @@ int kdig_parse(kdig_params_t *params, int argc, char *argv[])
 		}
 	}
 
+	// The bulk mode needs just a template query for the names from the list.
+	if (params->config->bulk != NULL && list_size(&params->queries) == 0) {
+		query_t *query = query_create(NULL, params->config);
+		if (query == NULL) {
+			return KNOT_ENOMEM;
+		}
+		add_tail(&params->queries, (node_t *)query);
+	}
+
 	// Complete missing data in queries based on defaults.
 	complete_queries(&params->queries, params->config);
 
@@ -93,6 +93,10 @@ struct query {
 	int32_t		wait;
 	/*!< Ignore truncated response. */
 	bool		ignore_tc;
+	/*!< Query list file for the bulk mode (NULL if disabled). */
+	char		*bulk;
+	/*!< Maximum number of concurrent queries in the bulk mode. */
+	uint32_t	bulk_inflight;
 	/*!< Class number (16unsigned + -1 uninitialized). */
 	int32_t		class_num;
 	/*!< Type number (16unsigned + -1 uninitialized). */
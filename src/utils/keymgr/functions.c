@@ -15,6 +15,8 @@
  */
 
 #include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
 #include <strings.h>
 #include <time.h>
@@ -198,7 +200,8 @@ static int check_timers(const knot_kasp_key_timing_t *t)
 #undef check_lower
 
 // modifies ctx->policy options, so don't do anything afterwards !
-int keymgr_generate_key(kdnssec_ctx_t *ctx, int argc, char *argv[])
+static int generate_key(kdnssec_ctx_t *ctx, int argc, char *argv[],
+                        pthread_mutex_t *commit_lock, const char **key_id)
 {
 	knot_time_t now = knot_time(), infinity = 0;
 	knot_kasp_key_timing_t gen_timing = { now, infinity, now, infinity, now, infinity, infinity, infinity, infinity };
@@ -250,16 +253,20 @@ int keymgr_generate_key(kdnssec_ctx_t *ctx, int argc, char *argv[])
 		char *last_policy_last = NULL;
 
 		knot_dname_t *unused = NULL;
+		// The last key of the policy must be updated atomically.
+		if (commit_lock != NULL) {
+			pthread_mutex_lock(commit_lock);
+		}
 		ret = kasp_db_get_policy_last(ctx->kasp_db, addtopolicy, &unused,
 		                              &last_policy_last);
 		knot_dname_free(unused, NULL);
-		if (ret != KNOT_EOK && ret != KNOT_ENOENT) {
-			free(last_policy_last);
-			return ret;
+		if (ret == KNOT_EOK || ret == KNOT_ENOENT) {
+			ret = kasp_db_set_policy_last(ctx->kasp_db, addtopolicy, last_policy_last,
+			                              ctx->zone->dname, key->id);
+		}
+		if (commit_lock != NULL) {
+			pthread_mutex_unlock(commit_lock);
 		}
-
-		ret = kasp_db_set_policy_last(ctx->kasp_db, addtopolicy, last_policy_last,
-		                              ctx->zone->dname, key->id);
 		free(last_policy_last);
 		if (ret != KNOT_EOK) {
 			return ret;
@@ -267,10 +274,171 @@ int keymgr_generate_key(kdnssec_ctx_t *ctx, int argc, char *argv[])
 	}
 
 	ret = kdnssec_ctx_commit(ctx);
+	if (ret == KNOT_EOK) {
+		*key_id = key->id;
+	}
+
+	return ret;
+}
+
+int keymgr_generate_key(kdnssec_ctx_t *ctx, int argc, char *argv[])
+{
+	const char *key_id = NULL;
+	int ret = generate_key(ctx, argc, argv, NULL, &key_id);
+	if (ret == KNOT_EOK) {
+		printf("%s\n", key_id);
+	}
+
+	return ret;
+}
+
+typedef struct {
+	knot_lmdb_db_t *kaspdb;
+	char **zones;
+	size_t count;
+	size_t next;    // Index of the next zone to process.
+	size_t failed;  // Number of zones that failed.
+	int argc;
+	char **argv;
+	pthread_mutex_t lock;
+} bulk_ctx_t;
+
+static void bulk_one(bulk_ctx_t *bulk, const char *zone)
+{
+	knot_dname_t *zone_name = knot_dname_from_str_alloc(zone);
+	if (zone_name == NULL) {
+		ERR2("zone %s, invalid name\n", zone);
+		__atomic_add_fetch(&bulk->failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	knot_dname_to_lower(zone_name);
 
+	kdnssec_ctx_t kctx = { 0 };
+	const char *key_id = NULL;
+	int ret = kdnssec_ctx_init(conf(), &kctx, zone_name, bulk->kaspdb, NULL);
 	if (ret == KNOT_EOK) {
-		printf("%s\n", key->id);
+		ret = generate_key(&kctx, bulk->argc, bulk->argv, &bulk->lock, &key_id);
+	}
+	if (ret == KNOT_EOK) {
+		printf("%s %s\n", zone, key_id);
+	} else {
+		ERR2("zone %s, %s\n", zone, knot_strerror(ret));
+		__atomic_add_fetch(&bulk->failed, 1, __ATOMIC_RELAXED);
+	}
+
+	kdnssec_ctx_deinit(&kctx);
+	free(zone_name);
+}
+
+static void *bulk_thread(void *arg)
+{
+	bulk_ctx_t *bulk = arg;
+
+	size_t i;
+	while ((i = __atomic_fetch_add(&bulk->next, 1, __ATOMIC_RELAXED)) < bulk->count) {
+		bulk_one(bulk, bulk->zones[i]);
+	}
+
+	return NULL;
+}
+
+static void bulk_run(bulk_ctx_t *bulk, unsigned threads)
+{
+	// The calling thread participates too.
+	pthread_t thr[threads];
+	unsigned started = 0;
+	for (; started < threads - 1; started++) {
+		if (pthread_create(&thr[started], NULL, bulk_thread, bulk) != 0) {
+			break;
+		}
+	}
+	(void)bulk_thread(bulk);
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(thr[i], NULL);
+	}
+}
+
+static int load_zone_list(const char *zone_list, char ***zones, size_t *count)
+{
+	FILE *f = (strcmp(zone_list, "-") == 0) ? stdin : fopen(zone_list, "r");
+	if (f == NULL) {
+		return knot_map_errno();
+	}
+
+	int ret = KNOT_EOK;
+	size_t max = 0;
+	char *line = NULL;
+	size_t line_size = 0;
+	while (getline(&line, &line_size, f) != -1) {
+		char *start = line, *end = line + strlen(line);
+		while (is_space(*start)) {
+			start++;
+		}
+		while (end > start && is_space(end[-1])) {
+			end--;
+		}
+		if (start == end || *start == '#') {
+			continue;
+		}
+		*end = '\0';
+
+		if (*count == max) {
+			max = (max == 0) ? 1024 : 2 * max;
+			char **tmp = realloc(*zones, max * sizeof(*tmp));
+			if (tmp == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			*zones = tmp;
+		}
+		(*zones)[*count] = strdup(start);
+		if ((*zones)[*count] == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		(*count)++;
+	}
+	free(line);
+
+	if (f != stdin) {
+		fclose(f);
+	}
+
+	return ret;
+}
+
+int keymgr_generate_bulk(knot_lmdb_db_t *kaspdb, const char *zone_list,
+                         unsigned threads, int argc, char *argv[])
+{
+	bulk_ctx_t bulk = {
+		.kaspdb = kaspdb,
+		.argc = argc,
+		.argv = argv,
+	};
+
+	int ret = load_zone_list(zone_list, &bulk.zones, &bulk.count);
+	if (ret != KNOT_EOK) {
+		ERR2("failed to load zone list '%s' (%s)\n", zone_list, knot_strerror(ret));
+		goto bulk_end;
+	}
+
+	pthread_mutex_init(&bulk.lock, NULL);
+	bulk_run(&bulk, MAX(1, MIN(threads, bulk.count)));
+	pthread_mutex_destroy(&bulk.lock);
+
+	// The commits didn't wait for the disk.
+	ret = knot_lmdb_sync(kaspdb);
+	if (ret == KNOT_EOK && bulk.failed > 0) {
+		ERR2("failed to generate keys for %zu zone(s) out of %zu\n",
+		     bulk.failed, bulk.count);
+		ret = KNOT_ERROR;
+	}
+
+bulk_end:
+	for (size_t i = 0; i < bulk.count; i++) {
+		free(bulk.zones[i]);
 	}
+	free(bulk.zones);
 
 	return ret;
 }
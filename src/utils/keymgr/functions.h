@@ -30,6 +30,9 @@ int parse_timestamp(char *arg, knot_time_t *stamp);
 
 int keymgr_generate_key(kdnssec_ctx_t *ctx, int argc, char *argv[]);
 
+int keymgr_generate_bulk(knot_lmdb_db_t *kaspdb, const char *zone_list,
+                         unsigned threads, int argc, char *argv[]);
+
 int keymgr_import_bind(kdnssec_ctx_t *ctx, const char *import_file, bool pub_only);
 
 int keymgr_import_pem(kdnssec_ctx_t *ctx, const char *import_file, int argc, char *argv[]);
@@ -20,6 +20,7 @@
 
 #include "contrib/strtonum.h"
 #include "knot/dnssec/zone-keys.h"
+#include "knot/server/dthreads.h"
 #include "libknot/libknot.h"
 #include "utils/common/msg.h"
 #include "utils/common/params.h"
@@ -34,6 +35,7 @@ static void print_help(void)
 	printf("Usage:\n"
 	       "  %s [-c | -C | -D <path>] <zone_name> <command> [<argument>...]\n"
 	       "  %s [-c | -C | -D <path>] -l\n"
+	       "  %s [-c | -C | -D <path>] [-j <jobs>] -z <zone_list> generate <attribute_name>=<value>...\n"
 	       "  %s -t <tsig_name> [<algorithm> [<bits>]]\n"
 	       "\n"
 	       "Parameters:\n"
@@ -44,6 +46,9 @@ static void print_help(void)
 	       "  -D, --dir <path>         Path to a KASP database directory, use default configuration.\n"
 	       "  -t, --tsig <name> [alg]  Generate a TSIG key.\n"
 	       "  -l, --list               List all zones that have at least one key in KASP database.\n"
+	       "  -z, --zones <file>       Generate a key for each zone listed in the file ('-' for stdin).\n"
+	       "  -j, --jobs <num>         Number of parallel jobs with --zones or sign-ksr\n"
+	       "                            (default: number of CPUs).\n"
 	       "  -x, --mono               Don't color the output.\n"
 	       "  -X, --color              Force output colorization in the normal mode.\n"
 	       "  -v, --verbose            Listing of keys with full description.\n"
@@ -109,11 +114,12 @@ static void print_help(void)
 	       "  ksk        Whether the generated/imported key shall be Key Signing Key.\n"
 	       "  created/publish/ready/active/retire/remove  The timestamp of the key\n"
 	       "             lifetime event (e.g. published=+1d active=1499770874)\n",
-	       PROGRAM_NAME, PROGRAM_NAME, PROGRAM_NAME, CONF_DEFAULT_FILE, CONF_DEFAULT_DBDIR);
+	       PROGRAM_NAME, PROGRAM_NAME, PROGRAM_NAME, PROGRAM_NAME,
+	       CONF_DEFAULT_FILE, CONF_DEFAULT_DBDIR);
 }
 
 static int key_command(int argc, char *argv[], int opt_ind, knot_lmdb_db_t *kaspdb,
-                       keymgr_list_params_t *list_params)
+                       keymgr_list_params_t *list_params, unsigned jobs)
 {
 	if (argc < opt_ind + 2) {
 		ERR2("zone name or command not specified\n");
@@ -260,7 +266,7 @@ static int key_command(int argc, char *argv[], int opt_ind, knot_lmdb_db_t *kasp
 		print_ok_on_succes = false;
 	} else if (strcmp(argv[1], "sign-ksr") == 0) {
 		CHECK_MISSING_ARG("Input file not specified");
-		ret = keymgr_sign_ksr(&kctx, argv[2]);
+		ret = keymgr_sign_ksr(&kctx, argv[2], jobs);
 		print_ok_on_succes = false;
 	} else if (strcmp(argv[1], "validate-skr") == 0) {
 		CHECK_MISSING_ARG("Input file not specified");
@@ -296,6 +302,8 @@ int main(int argc, char *argv[])
 		{ "dir",     required_argument, NULL, 'D' },
 		{ "tsig",    required_argument, NULL, 't' },
 		{ "list",    no_argument,       NULL, 'l' },
+		{ "zones",   required_argument, NULL, 'z' },
+		{ "jobs",    required_argument, NULL, 'j' },
 		{ "brief",   no_argument,       NULL, 'b' }, // Legacy.
 		{ "mono",    no_argument,       NULL, 'x' },
 		{ "color",   no_argument,       NULL, 'X' },
@@ -309,12 +317,14 @@ int main(int argc, char *argv[])
 
 	int ret;
 	bool just_list = false;
+	const char *zone_list = NULL;
+	int jobs = dt_optimal_size();
 	keymgr_list_params_t list_params = { 0 };
 
 	list_params.color = isatty(STDOUT_FILENO);
 
 	int opt = 0, parm = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:D:t:lbxXvhV", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:D:t:lz:j:bxXvhV", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			if (util_conf_init_file(optarg) != KNOT_EOK) {
@@ -344,6 +354,15 @@ int main(int argc, char *argv[])
 		case 'l':
 			just_list = true;
 			break;
+		case 'z':
+			zone_list = optarg;
+			break;
+		case 'j':
+			if (str_to_int(optarg, &jobs, 1, 1024) != KNOT_EOK) {
+				ERR2("invalid number of jobs '%s'\n", optarg);
+				goto failure;
+			}
+			break;
 		case 'b':
 			WARN2("option '--brief' is deprecated and enabled by default\n");
 			break;
@@ -377,13 +396,23 @@ int main(int argc, char *argv[])
 	knot_lmdb_db_t kaspdb = { 0 };
 	conf_val_t mapsize = conf_db_param(conf(), C_KASP_DB_MAX_SIZE);
 	char *kasp_dir = conf_db(conf(), C_KASP_DB);
-	knot_lmdb_init(&kaspdb, kasp_dir, conf_int(&mapsize), 0, "keys_db");
+	// Many zones at once, the disk is synchronized just at the end.
+	unsigned env_flags = (zone_list != NULL) ? MDB_NOSYNC : 0;
+	knot_lmdb_init(&kaspdb, kasp_dir, conf_int(&mapsize), env_flags, "keys_db");
 	free(kasp_dir);
 
 	if (just_list) {
 		ret = keymgr_list_zones(&kaspdb);
+	} else if (zone_list != NULL) {
+		if (argc <= optind || strcmp(argv[optind], "generate") != 0) {
+			ERR2("only the 'generate' command is supported with a zone list\n");
+			ret = KNOT_EINVAL;
+		} else {
+			ret = keymgr_generate_bulk(&kaspdb, zone_list, jobs,
+			                           argc - optind - 1, argv + optind + 1);
+		}
 	} else {
-		ret = key_command(argc, argv, optind, &kaspdb, &list_params);
+		ret = key_command(argc, argv, optind, &kaspdb, &list_params, jobs);
 	}
 	knot_lmdb_deinit(&kaspdb);
 	if (ret != KNOT_EOK) {
@@ -14,11 +14,13 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 
 #include "utils/keymgr/offline_ksk.h"
+#include "contrib/macros.h"
 #include "knot/dnssec/kasp/policy.h"
 #include "knot/dnssec/key-events.h"
 #include "knot/dnssec/key_records.h"
@@ -133,12 +135,18 @@ static int dump_rrset_to_buf(const knot_rrset_t *rrset, char **buf, size_t *buf_
 	return knot_rrset_txt_dump(rrset, buf, buf_size, &style);
 }
 
-static void print_header(const char *of_what, knot_time_t timestamp, const char *contents)
+static void fprint_header(FILE *out, const char *of_what, knot_time_t timestamp,
+                          const char *contents)
 {
 	char date[64] = { 0 };
 	(void)knot_time_print(TIME_PRINT_ISO8601, timestamp, date, sizeof(date));
-	printf(";; %s %"PRIu64" (%s) =========\n%s", of_what,
-	       timestamp, date, contents);
+	fprintf(out, ";; %s %"PRIu64" (%s) =========\n%s", of_what,
+	        timestamp, date, contents);
+}
+
+static void print_header(const char *of_what, knot_time_t timestamp, const char *contents)
+{
+	fprint_header(stdout, of_what, timestamp, contents);
 }
 
 int keymgr_print_offline_records(kdnssec_ctx_t *ctx, char *arg_from, char *arg_to)
@@ -271,15 +279,96 @@ int keymgr_print_ksr(kdnssec_ctx_t *ctx, char *arg_from, char *arg_to)
 	return ret;
 }
 
+/*! \brief One KSR with the SKRs up to the next one. */
+typedef struct {
+	knot_time_t timestamp;
+	knot_time_t next_timestamp; // 0 if the last KSR.
+	knot_rrset_t *dnskey;       // ZSKs from the KSR.
+	char *out;                  // Printed SKRs.
+	size_t out_size;
+	int ret;
+} ksr_period_t;
+
 typedef struct {
 	int ret;
 	key_records_t r;
 	knot_time_t timestamp;
 	kdnssec_ctx_t *kctx;
+	ksr_period_t *periods;
+	size_t count;
+	size_t max;
+	size_t next;                // Index of the next period to sign.
+	knot_time_t delete_from;    // SKR import: first timestamp to replace.
+	knot_time_t *skr_times;     // SKR import: timestamps of the SKRs.
+	key_records_t *skrs;        // SKR import: SKRs to be stored.
+	size_t skr_count;
+	size_t skr_max;
 } ksr_sign_ctx_t;
 
+static int add_period(ksr_sign_ctx_t *ctx, ksr_period_t **period)
+{
+	if (ctx->count == ctx->max) {
+		size_t max = (ctx->max == 0) ? 64 : 2 * ctx->max;
+		ksr_period_t *tmp = realloc(ctx->periods, max * sizeof(*tmp));
+		if (tmp == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ctx->periods = tmp;
+		ctx->max = max;
+	}
+
+	*period = &ctx->periods[ctx->count++];
+	memset(*period, 0, sizeof(**period));
+	return KNOT_EOK;
+}
+
+static void clear_periods(ksr_sign_ctx_t *ctx)
+{
+	for (size_t i = 0; i < ctx->count; i++) {
+		ksr_period_t *p = &ctx->periods[i];
+		knot_rrset_free(p->dnskey, NULL);
+		free(p->out);
+	}
+	free(ctx->periods);
+	ctx->periods = NULL;
+	ctx->count = ctx->max = 0;
+
+	for (size_t i = 0; i < ctx->skr_count; i++) {
+		key_records_clear(&ctx->skrs[i]);
+	}
+	free(ctx->skr_times);
+	free(ctx->skrs);
+	ctx->skr_times = NULL;
+	ctx->skrs = NULL;
+	ctx->skr_count = ctx->skr_max = 0;
+}
+
+static int add_skr(ksr_sign_ctx_t *ctx)
+{
+	if (ctx->skr_count == ctx->skr_max) {
+		size_t max = (ctx->skr_max == 0) ? 64 : 2 * ctx->skr_max;
+		knot_time_t *times = realloc(ctx->skr_times, max * sizeof(*times));
+		if (times == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ctx->skr_times = times;
+		key_records_t *skrs = realloc(ctx->skrs, max * sizeof(*skrs));
+		if (skrs == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ctx->skrs = skrs;
+		ctx->skr_max = max;
+	}
+
+	// the records are moved, the next SKR starts with new ones
+	ctx->skr_times[ctx->skr_count] = ctx->timestamp;
+	ctx->skrs[ctx->skr_count++] = ctx->r;
+	key_records_init(ctx->kctx, &ctx->r);
+	return KNOT_EOK;
+}
+
 static int ksr_sign_dnskey(kdnssec_ctx_t *ctx, knot_rrset_t *zsk, knot_time_t now,
-                           knot_time_t *next_sign)
+                           knot_time_t *next_sign, FILE *out)
 {
 	zone_keyset_t keyset = { 0 };
 	char *buf = NULL;
@@ -316,7 +405,7 @@ static int ksr_sign_dnskey(kdnssec_ctx_t *ctx, knot_rrset_t *zsk, knot_time_t no
 	}
 	ret = key_records_dump(&buf, &buf_size, &r, true);
 	if (ret == KNOT_EOK) {
-		print_header("SignedKeyResponse "KSR_SKR_VER, ctx->now, buf);
+		fprint_header(out, "SignedKeyResponse "KSR_SKR_VER, ctx->now, buf);
 		*next_sign = knot_time_min(
 			knot_get_next_zone_key_event(&keyset),
 			knot_time_add(rrsigs_expire, -(knot_timediff_t)ctx->policy->rrsig_refresh_before)
@@ -330,10 +419,11 @@ done:
 	return ret;
 }
 
-static int process_skr_between_ksrs(ksr_sign_ctx_t *ctx, knot_time_t from, knot_time_t to)
+static int process_skr_between_ksrs(kdnssec_ctx_t *ctx, knot_rrset_t *zsk,
+                                    knot_time_t from, knot_time_t to, FILE *out)
 {
 	for (knot_time_t t = from; t < to /* if (t == infinity) stop */; ) {
-		int ret = ksr_sign_dnskey(ctx->kctx, &ctx->r.dnskey, t, &t);
+		int ret = ksr_sign_dnskey(ctx, zsk, t, &t, out);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
@@ -341,6 +431,89 @@ static int process_skr_between_ksrs(ksr_sign_ctx_t *ctx, knot_time_t from, knot_
 	return KNOT_EOK;
 }
 
+static void ksr_sign_period(kdnssec_ctx_t *ctx, ksr_period_t *p)
+{
+	FILE *out = open_memstream(&p->out, &p->out_size);
+	if (out == NULL) {
+		p->ret = KNOT_ENOMEM;
+		return;
+	}
+
+	// sign the KSR and inbetween KSK changes
+	knot_time_t inbetween_from;
+	p->ret = ksr_sign_dnskey(ctx, p->dnskey, p->timestamp, &inbetween_from, out);
+	if (p->next_timestamp > 0 && p->ret == KNOT_EOK) {
+		p->ret = process_skr_between_ksrs(ctx, p->dnskey, inbetween_from,
+		                                  p->next_timestamp, out);
+	}
+
+	fclose(out);
+}
+
+typedef struct {
+	ksr_sign_ctx_t *sign;
+	kdnssec_ctx_t *kctx; // NULL if own context needed.
+} ksr_sign_job_t;
+
+static void *ksr_sign_thread(void *arg)
+{
+	ksr_sign_job_t *job = arg;
+	ksr_sign_ctx_t *sign = job->sign;
+
+	kdnssec_ctx_t own = { 0 };
+	kdnssec_ctx_t *kctx = job->kctx;
+	if (kctx == NULL) {
+		// Each thread needs its own keys and keystore session.
+		if (kdnssec_ctx_init(conf(), &own, sign->kctx->zone->dname,
+		                     sign->kctx->kasp_db, NULL) != KNOT_EOK) {
+			return NULL; // The other threads do the work.
+		}
+		kctx = &own;
+	}
+
+	size_t i;
+	while ((i = __atomic_fetch_add(&sign->next, 1, __ATOMIC_RELAXED)) < sign->count) {
+		ksr_sign_period(kctx, &sign->periods[i]);
+	}
+
+	kdnssec_ctx_deinit(&own);
+	return NULL;
+}
+
+static int ksr_sign_periods(ksr_sign_ctx_t *ctx, unsigned threads)
+{
+	threads = MAX(1, MIN(threads, ctx->count));
+
+	// The calling thread participates with the original context.
+	pthread_t thr[threads];
+	ksr_sign_job_t jobs[threads];
+	unsigned started = 0;
+	for (; started < threads - 1; started++) {
+		jobs[started] = (ksr_sign_job_t){ .sign = ctx };
+		if (pthread_create(&thr[started], NULL, ksr_sign_thread, &jobs[started]) != 0) {
+			break;
+		}
+	}
+	ksr_sign_job_t own = { .sign = ctx, .kctx = ctx->kctx };
+	(void)ksr_sign_thread(&own);
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(thr[i], NULL);
+	}
+
+	// Print the SKRs in the KSR order, up to the first failure.
+	for (size_t i = 0; i < ctx->count; i++) {
+		ksr_period_t *p = &ctx->periods[i];
+		if (p->out != NULL) {
+			fwrite(p->out, 1, p->out_size, stdout);
+		}
+		if (p->ret != KNOT_EOK) {
+			return p->ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 static void ksr_sign_header(zs_scanner_t *sc)
 {
 	ksr_sign_ctx_t *ctx = sc->process.data;
@@ -355,14 +528,17 @@ static void ksr_sign_header(zs_scanner_t *sc)
 	}
 	(void)header_ver;
 
-	// sign previous KSR and inbetween KSK changes
+	// queue previous KSR to be signed together with inbetween KSK changes
 	if (ctx->timestamp > 0) {
-		knot_time_t inbetween_from;
-		ctx->ret = ksr_sign_dnskey(ctx->kctx, &ctx->r.dnskey, ctx->timestamp,
-		                           &inbetween_from);
-		if (next_timestamp > 0 && ctx->ret == KNOT_EOK) {
-			ctx->ret = process_skr_between_ksrs(ctx, inbetween_from,
-			                                    next_timestamp);
+		ksr_period_t *p = NULL;
+		ctx->ret = add_period(ctx, &p);
+		if (ctx->ret == KNOT_EOK) {
+			p->timestamp = ctx->timestamp;
+			p->next_timestamp = next_timestamp;
+			p->dnskey = knot_rrset_copy(&ctx->r.dnskey, NULL);
+			if (p->dnskey == NULL) {
+				ctx->ret = KNOT_ENOMEM;
+			}
 		}
 		key_records_clear_rdatasets(&ctx->r);
 	}
@@ -386,7 +562,7 @@ static void skr_import_header(zs_scanner_t *sc)
 
 	// parse header
 	float header_ver;
-	knot_time_t next_timestamp;
+	knot_time_t next_timestamp = 0;
 	if (sc->error.code != 0 || ctx->ret != KNOT_EOK ||
 	    sscanf((const char *)sc->buffer, "; SignedKeyResponse %f %"PRIu64,
 	           &header_ver, &next_timestamp) < 1) {
@@ -394,21 +570,19 @@ static void skr_import_header(zs_scanner_t *sc)
 	}
 	(void)header_ver;
 
-	// delete possibly existing conflicting offline records
-	ctx->ret = kasp_db_delete_offline_records(
-		ctx->kctx->kasp_db, ctx->kctx->zone->dname, next_timestamp, 0
-	);
+	// possibly existing conflicting offline records are replaced
+	if (ctx->timestamp == 0) {
+		ctx->delete_from = next_timestamp;
+	}
 
-	// store previous SKR
+	// queue previous SKR to be stored, all at once in the end
 	if (ctx->timestamp > 0 && ctx->ret == KNOT_EOK) {
 		ctx->ret = key_records_verify(&ctx->r, ctx->kctx, ctx->timestamp);
 		if (ctx->ret != KNOT_EOK) {
 			return;
 		}
 
-		ctx->ret = kasp_db_store_offline_records(ctx->kctx->kasp_db,
-		                                         ctx->timestamp, &ctx->r);
-		key_records_clear_rdatasets(&ctx->r);
+		ctx->ret = add_skr(ctx);
 	}
 
 	// start new SKR
@@ -449,7 +623,7 @@ static void skr_import_once(zs_scanner_t *sc)
 	}
 }
 
-static int read_ksr_skr(kdnssec_ctx_t *ctx, const char *infile,
+static int read_ksr_skr(kdnssec_ctx_t *ctx, ksr_sign_ctx_t *pctx, const char *infile,
                         void (*cb_header)(zs_scanner_t *), void (*cb_record)(zs_scanner_t *))
 {
 	zs_scanner_t sc = { 0 };
@@ -464,10 +638,9 @@ static int read_ksr_skr(kdnssec_ctx_t *ctx, const char *infile,
 		return KNOT_EFILE;
 	}
 
-	ksr_sign_ctx_t pctx = { 0 };
-	key_records_init(ctx, &pctx.r);
-	pctx.kctx = ctx;
-	ret = zs_set_processing(&sc, cb_record, NULL, &pctx);
+	key_records_init(ctx, &pctx->r);
+	pctx->kctx = ctx;
+	ret = zs_set_processing(&sc, cb_record, NULL, pctx);
 	if (ret < 0) {
 		zs_deinit(&sc);
 		return KNOT_EBUSY;
@@ -478,22 +651,30 @@ static int read_ksr_skr(kdnssec_ctx_t *ctx, const char *infile,
 
 	if (sc.error.code != 0) {
 		ret = KNOT_EMALF;
-	} else if (pctx.ret != KNOT_EOK) {
-		ret = pctx.ret;
-	} else if (ret < 0 || pctx.r.dnskey.rrs.count > 0 || pctx.r.cdnskey.rrs.count > 0 ||
-		   pctx.r.cds.rrs.count > 0 || pctx.r.rrsig.rrs.count > 0) {
+	} else if (pctx->ret != KNOT_EOK) {
+		ret = pctx->ret;
+	} else if (ret < 0 || pctx->r.dnskey.rrs.count > 0 || pctx->r.cdnskey.rrs.count > 0 ||
+		   pctx->r.cds.rrs.count > 0 || pctx->r.rrsig.rrs.count > 0) {
 		ret = KNOT_EMALF;
 	}
-	key_records_clear(&pctx.r);
+	key_records_clear(&pctx->r);
 	zs_deinit(&sc);
 	return ret;
 }
 
-int keymgr_sign_ksr(kdnssec_ctx_t *ctx, const char *ksr_file)
+int keymgr_sign_ksr(kdnssec_ctx_t *ctx, const char *ksr_file, unsigned threads)
 {
 	OFFLINE_KSK_CONF_CHECK
 
-	int ret = read_ksr_skr(ctx, ksr_file, ksr_sign_header, ksr_sign_once);
+	// The KSRs are read first and then signed in parallel.
+	ksr_sign_ctx_t pctx = { 0 };
+	int ret = read_ksr_skr(ctx, &pctx, ksr_file, ksr_sign_header, ksr_sign_once);
+	int sign_ret = ksr_sign_periods(&pctx, threads);
+	if (ret == KNOT_EOK) {
+		ret = sign_ret;
+	}
+	clear_periods(&pctx);
+
 	printf(";; SignedKeyResponse %s ", KSR_SKR_VER);
 	print_generated_message();
 	return ret;
@@ -503,10 +684,24 @@ int keymgr_import_skr(kdnssec_ctx_t *ctx, const char *skr_file)
 {
 	OFFLINE_KSK_CONF_CHECK
 
-	return read_ksr_skr(ctx, skr_file, skr_import_header, skr_import_once);
+	// The verified SKRs are stored in one transaction.
+	ksr_sign_ctx_t pctx = { 0 };
+	int ret = read_ksr_skr(ctx, &pctx, skr_file, skr_import_header, skr_import_once);
+	if (pctx.delete_from > 0) {
+		int store_ret = kasp_db_replace_offline_records(ctx->kasp_db, ctx->zone->dname,
+		                                                pctx.delete_from, pctx.skr_times,
+		                                                pctx.skrs, pctx.skr_count);
+		if (ret == KNOT_EOK) {
+			ret = store_ret;
+		}
+	}
+	clear_periods(&pctx);
+
+	return ret;
 }
 
 int keymgr_validate_skr(kdnssec_ctx_t *ctx, const char *skr_file)
 {
-	return read_ksr_skr(ctx, skr_file, skr_validate_header, skr_import_once);
+	ksr_sign_ctx_t pctx = { 0 };
+	return read_ksr_skr(ctx, &pctx, skr_file, skr_validate_header, skr_import_once);
 }
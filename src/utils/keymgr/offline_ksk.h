@@ -28,7 +28,7 @@ int keymgr_del_all_old(kdnssec_ctx_t *ctx);
 
 int keymgr_print_ksr(kdnssec_ctx_t *ctx, char *arg_from, char *arg_to);
 
-int keymgr_sign_ksr(kdnssec_ctx_t *ctx, const char *ksr_file);
+int keymgr_sign_ksr(kdnssec_ctx_t *ctx, const char *ksr_file, unsigned threads);
 
 int keymgr_import_skr(kdnssec_ctx_t *ctx, const char *skr_file);
 
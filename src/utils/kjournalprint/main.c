@@ -15,6 +15,7 @@
  */
 
 #include <getopt.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -39,6 +40,7 @@ static void print_help(void)
 	printf("Usage:\n"
 	       " %s [-c | -C | -D <path>] [parameters] <zone_name>\n"
 	       " %s [-c | -C | -D <path>] -z\n"
+	       " %s [-c | -C | -D <path>] -S [-j <num>] [<zone_name>]\n"
 	       "\n"
 	       "Parameters:\n"
 	       " -c, --config <file>  Path to a textual configuration file.\n"
@@ -48,6 +50,9 @@ static void print_help(void)
 	       " -D, --dir <path>     Path to a journal database directory, use default configuration.\n"
 	       " -z, --zone-list      Instead of reading the journal, display the list\n"
 	       "                      of zones in the DB.\n"
+	       " -S, --summary        Print a JSON summary of each zone journal without\n"
+	       "                      reading the changesets.\n"
+	       " -j, --jobs <num>     Number of threads for the summary.\n"
 	       " -l, --limit <num>    Read only <num> newest changes.\n"
 	       " -s, --serial <soa>   Start with a specific SOA serial.\n"
 	       " -H, --check          Additional journal semantic checks.\n"
@@ -57,7 +62,7 @@ static void print_help(void)
 	       " -X, --color          Force output coloring.\n"
 	       " -h, --help           Print the program help.\n"
 	       " -V, --version        Print the program version.\n",
-	       PROGRAM_NAME, PROGRAM_NAME, CONF_DEFAULT_FILE, CONF_DEFAULT_DBDIR);
+	       PROGRAM_NAME, PROGRAM_NAME, PROGRAM_NAME, CONF_DEFAULT_FILE, CONF_DEFAULT_DBDIR);
 }
 
 typedef struct {
@@ -231,10 +236,16 @@ int print_journal(char *path, knot_dname_t *name, print_params_t *params)
 		}
 	}
 
+	uint64_t stored = 0, raw = 0;
+	if (params->debug && ret == KNOT_EOK) {
+		ret = journal_chunks_size(j, &stored, &raw);
+	}
 	if (params->debug && ret == KNOT_EOK) {
 		printf("Total number of changesets:  %zu\n", params->changes);
 		printf("Occupied this zone (approx): %"PRIu64" KiB\n", occupied / 1024);
 		printf("Occupied all zones together: %"PRIu64" KiB\n", occupied_all / 1024);
+		printf("Compression ratio:           %.2f (%"PRIu64" KiB uncompressed)\n",
+		       stored > 0 ? (double)raw / stored : 1.0, raw / 1024);
 	}
 
 	knot_lmdb_deinit(&jdb);
@@ -274,7 +285,7 @@ static int list_zone(const knot_dname_t *zone, bool detailed, knot_lmdb_db_t *jd
 	return KNOT_EOK;
 }
 
-int list_zones(char *path, bool detailed)
+static int list_shard(char *path, bool detailed, uint64_t *occupied_all)
 {
 	knot_lmdb_db_t jdb = { 0 };
 	knot_lmdb_init(&jdb, path, 0, journal_env_flags(JOURNAL_MODE_ROBUST, true), NULL);
@@ -282,28 +293,238 @@ int list_zones(char *path, bool detailed)
 	list_t zones;
 	init_list(&zones);
 	ptrnode_t *zone;
-	uint64_t occupied_all = 0;
+	uint64_t occupied_shard = 0;
 
 	int ret = journals_walk(&jdb, add_zone_to_list, &zones);
 	WALK_LIST(zone, zones) {
 		if (ret != KNOT_EOK) {
 			break;
 		}
-		ret = list_zone(zone->d, detailed, &jdb, &occupied_all);
+		ret = list_zone(zone->d, detailed, &jdb, &occupied_shard);
 	}
+	*occupied_all += occupied_shard;
 
 	knot_lmdb_deinit(&jdb);
 	ptrlist_deep_free(&zones, NULL);
 
+	return ret;
+}
+
+int list_zones(char *path, unsigned shards, bool detailed)
+{
+	uint64_t occupied_all = 0;
+	bool found = false;
+
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < shards && ret == KNOT_EOK; i++) {
+		char *shard_path = journal_db_shard_path(path, i);
+		if (shard_path == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ret = list_shard(shard_path, detailed, &occupied_all);
+		free(shard_path);
+		// Not yet used shards are missing.
+		if (ret == KNOT_EOK) {
+			found = true;
+		} else if ((ret == KNOT_ENODB || ret == KNOT_ENOENT) && i + 1 < shards) {
+			ret = KNOT_EOK;
+		}
+	}
+	if (found && (ret == KNOT_ENODB || ret == KNOT_ENOENT)) {
+		ret = KNOT_EOK;
+	}
+
 	if (detailed && ret == KNOT_EOK) {
 		printf("Occupied all zones together: %"PRIu64" KiB\n", occupied_all / 1024);
 	}
 	return ret;
 }
 
+typedef struct {
+	knot_lmdb_db_t *db;
+	unsigned shard;
+	knot_dname_t *zone;
+	journal_summary_t sum;
+	int ret;
+} summary_item_t;
+
+typedef struct {
+	summary_item_t *items;
+	size_t count;
+	size_t capacity;
+	size_t next;        // Next item to be summarized.
+	knot_lmdb_db_t *db; // DB of the shard being walked.
+	unsigned shard;
+} summary_ctx_t;
+
+static int add_summary_item(const knot_dname_t *zone, void *data)
+{
+	summary_ctx_t *ctx = data;
+	if (ctx->count == ctx->capacity) {
+		size_t capacity = MAX(2 * ctx->capacity, 256);
+		summary_item_t *items = realloc(ctx->items, capacity * sizeof(*items));
+		if (items == NULL) {
+			return KNOT_ENOMEM;
+		}
+		ctx->items = items;
+		ctx->capacity = capacity;
+	}
+
+	summary_item_t *item = &ctx->items[ctx->count];
+	memset(item, 0, sizeof(*item));
+	item->zone = knot_dname_copy(zone, NULL);
+	if (item->zone == NULL) {
+		return KNOT_ENOMEM;
+	}
+	item->db = ctx->db;
+	item->shard = ctx->shard;
+	ctx->count++;
+
+	return KNOT_EOK;
+}
+
+static void *summary_thread(void *data)
+{
+	summary_ctx_t *ctx = data;
+
+	size_t idx;
+	while ((idx = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)) < ctx->count) {
+		summary_item_t *item = &ctx->items[idx];
+		zone_journal_t j = { item->db, item->zone };
+		item->ret = journal_summary(j, &item->sum);
+	}
+
+	return NULL;
+}
+
+static void print_json_str(const char *key, const char *str)
+{
+	printf("\"%s\":\"", key);
+	for (const char *c = str; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			printf("\\%c", *c);
+		} else if ((unsigned char)*c < 0x20) {
+			printf("\\u%04x", (unsigned char)*c);
+		} else {
+			putchar(*c);
+		}
+	}
+	putchar('"');
+}
+
+static void print_summary_item(const summary_item_t *item)
+{
+	knot_dname_txt_storage_t zone_str;
+	if (knot_dname_to_str(zone_str, item->zone, sizeof(zone_str)) == NULL) {
+		zone_str[0] = '\0';
+	}
+
+	putchar('{');
+	print_json_str("zone", zone_str);
+	printf(",\"shard\":%u", item->shard);
+	if (item->ret != KNOT_EOK) {
+		putchar(',');
+		print_json_str("error", knot_strerror(item->ret));
+		printf("}\n");
+		return;
+	}
+
+	const journal_summary_t *sum = &item->sum;
+	const journal_metadata_t *md = &sum->md;
+	printf(",\"occupied\":%"PRIu64",\"stored\":%"PRIu64",\"raw\":%"PRIu64
+	       ",\"chunks\":%zu,\"changesets\":%zu",
+	       sum->occupied, sum->stored, sum->raw, sum->chunks, sum->changesets);
+	if (md->flags & JOURNAL_SERIAL_TO_VALID) {
+		printf(",\"first_serial\":%u,\"serial_to\":%u", md->first_serial, md->serial_to);
+	}
+	if (sum->has_zij) {
+		printf(",\"zone_in_journal\":%u", sum->zij_serial);
+	}
+	if (md->flags & JOURNAL_MERGED_SERIAL_VALID) {
+		printf(",\"merged_serial\":%u", md->merged_serial);
+	}
+	printf(",\"consistent\":%s}\n", sum->consistent ? "true" : "false");
+}
+
+static int summary(char *path, unsigned shards, const knot_dname_t *zone, unsigned jobs)
+{
+	knot_lmdb_db_t dbs[shards];
+	memset(dbs, 0, sizeof(dbs));
+	summary_ctx_t ctx = { 0 };
+	bool found = false;
+
+	int ret = KNOT_EOK;
+	for (unsigned i = 0; i < shards && ret == KNOT_EOK; i++) {
+		if (zone != NULL && i != journal_db_shard(zone, shards)) {
+			continue;
+		}
+		char *shard_path = journal_db_shard_path(path, i);
+		if (shard_path == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+		knot_lmdb_init(&dbs[i], shard_path, 0, journal_env_flags(JOURNAL_MODE_ROBUST, true), NULL);
+		free(shard_path);
+
+		ctx.db = &dbs[i];
+		ctx.shard = i;
+		if (zone != NULL) {
+			ret = knot_lmdb_exists(&dbs[i]);
+			if (ret == KNOT_EOK) {
+				ret = knot_lmdb_open(&dbs[i]);
+			}
+			if (ret == KNOT_EOK) {
+				ret = add_summary_item(zone, &ctx);
+			}
+		} else {
+			ret = journals_walk(&dbs[i], add_summary_item, &ctx);
+		}
+		// Not yet used shards are missing.
+		if (ret == KNOT_EOK) {
+			found = true;
+		} else if (zone == NULL && (ret == KNOT_ENODB || ret == KNOT_ENOENT)) {
+			ret = KNOT_EOK;
+		}
+	}
+	if (ret == KNOT_EOK && !found) {
+		ret = KNOT_ENODB;
+	}
+
+	if (ret == KNOT_EOK) {
+		jobs = MIN(jobs, MAX(ctx.count, 1));
+		pthread_t threads[jobs];
+		bool started[jobs];
+		for (unsigned i = 1; i < jobs; i++) {
+			started[i] = (pthread_create(&threads[i], NULL, summary_thread, &ctx) == 0);
+		}
+		(void)summary_thread(&ctx);
+		for (unsigned i = 1; i < jobs; i++) {
+			if (started[i]) {
+				(void)pthread_join(threads[i], NULL);
+			}
+		}
+
+		for (size_t i = 0; i < ctx.count; i++) {
+			print_summary_item(&ctx.items[i]);
+		}
+	}
+
+	for (size_t i = 0; i < ctx.count; i++) {
+		knot_dname_free(ctx.items[i].zone, NULL);
+	}
+	free(ctx.items);
+	for (unsigned i = 0; i < shards; i++) {
+		knot_lmdb_deinit(&dbs[i]);
+	}
+
+	return ret;
+}
+
 int main(int argc, char *argv[])
 {
 	bool justlist = false;
+	bool justsummary = false;
+	uint32_t jobs = 1;
 
 	print_params_t params = {
 		.debug = false,
@@ -320,6 +541,8 @@ int main(int argc, char *argv[])
 		{ "limit",     required_argument, NULL, 'l' },
 		{ "serial",    required_argument, NULL, 's' },
 		{ "zone-list", no_argument,       NULL, 'z' },
+		{ "summary",   no_argument,       NULL, 'S' },
+		{ "jobs",      required_argument, NULL, 'j' },
 		{ "check",     no_argument,       NULL, 'H' },
 		{ "debug",     no_argument,       NULL, 'd' },
 		{ "no-color",  no_argument,       NULL, 'n' },
@@ -331,7 +554,7 @@ int main(int argc, char *argv[])
 	};
 
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:D:l:s:zHdnxXhV", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:D:l:s:zSj:HdnxXhV", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			if (util_conf_init_file(optarg) != KNOT_EOK) {
@@ -364,6 +587,15 @@ int main(int argc, char *argv[])
 		case 'z':
 			justlist = true;
 			break;
+		case 'S':
+			justsummary = true;
+			break;
+		case 'j':
+			if (str_to_u32(optarg, &jobs) != KNOT_EOK || jobs == 0) {
+				print_help();
+				goto failure;
+			}
+			break;
 		case 'H':
 			params.check = true;
 			break;
@@ -403,9 +635,40 @@ int main(int argc, char *argv[])
 	}
 
 	char *db = conf_db(conf(), C_JOURNAL_DB);
+	conf_val_t shards_val = conf_db_param(conf(), C_JOURNAL_DB_SHARDS);
+	unsigned shards = conf_int(&shards_val);
 
-	if (justlist) {
-		int ret = list_zones(db, params.debug);
+	if (justsummary) {
+		if (argc - optind > 1) {
+			print_help();
+			free(db);
+			goto failure;
+		}
+		knot_dname_t *name = NULL;
+		if (argc - optind == 1) {
+			name = knot_dname_from_str_alloc(argv[optind]);
+			if (name == NULL) {
+				ERR2("invalid zone name\n");
+				free(db);
+				goto failure;
+			}
+			knot_dname_to_lower(name);
+		}
+		int ret = summary(db, shards, name, jobs);
+		free(name);
+		free(db);
+		switch (ret) {
+		case KNOT_EOK:
+			goto success;
+		case KNOT_ENODB:
+			ERR2("the journal DB does not exist\n");
+			goto failure;
+		default:
+			ERR2("failed to summarize the journal DB (%s)\n", knot_strerror(ret));
+			goto failure;
+		}
+	} else if (justlist) {
+		int ret = list_zones(db, shards, params.debug);
 		free(db);
 		switch (ret) {
 		case KNOT_ENOENT:
@@ -432,7 +695,9 @@ int main(int argc, char *argv[])
 		knot_dname_t *name = knot_dname_from_str_alloc(argv[optind]);
 		knot_dname_to_lower(name);
 
-		int ret = print_journal(db, name, &params);
+		char *shard_db = journal_db_shard_path(db, journal_db_shard(name, shards));
+		int ret = (shard_db == NULL) ? KNOT_ENOMEM : print_journal(shard_db, name, &params);
+		free(shard_db);
 		free(name);
 		free(db);
 		switch (ret) {
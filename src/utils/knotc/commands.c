@@ -46,6 +46,7 @@
 #define CMD_ZONE_RETRANSFER	"zone-retransfer"
 #define CMD_ZONE_NOTIFY		"zone-notify"
 #define CMD_ZONE_FLUSH		"zone-flush"
+#define CMD_ZONE_SNAPSHOT	"zone-snapshot"
 #define CMD_ZONE_BACKUP		"zone-backup"
 #define CMD_ZONE_RESTORE	"zone-restore"
 #define CMD_ZONE_SIGN		"zone-sign"
@@ -67,6 +68,7 @@
 #define CMD_ZONE_UNSET		"zone-unset"
 #define CMD_ZONE_PURGE		"zone-purge"
 #define CMD_ZONE_STATS		"zone-stats"
+#define CMD_ZONE_SUBSCRIBE	"zone-subscribe"
 
 #define CMD_CONF_INIT		"conf-init"
 #define CMD_CONF_CHECK		"conf-check"
@@ -247,6 +249,7 @@ static void format_data(ctl_cmd_t cmd, knot_ctl_type_t data_type,
 	case CTL_ZONE_RETRANSFER:
 	case CTL_ZONE_NOTIFY:
 	case CTL_ZONE_FLUSH:
+	case CTL_ZONE_SNAPSHOT:
 	case CTL_ZONE_BACKUP:
 	case CTL_ZONE_RESTORE:
 	case CTL_ZONE_SIGN:
@@ -347,6 +350,23 @@ static void format_data(ctl_cmd_t cmd, knot_ctl_type_t data_type,
 		       (value != NULL ? value      : ""));
 		*empty = false;
 		break;
+	case CTL_ZONE_SUBSCRIBE:
+		// Print each notification immediately.
+		printf("%s%s%s%s%s%s%s%s%s%s%s%s\n",
+		       (error != NULL ? "error: (" : ""),
+		       (error != NULL ? error      : ""),
+		       (error != NULL ? ")"        : ""),
+		       (zone  != NULL ? "["        : ""),
+		       (zone  != NULL ? zone       : ""),
+		       (zone  != NULL ? "] "       : ""),
+		       (key0  != NULL ? key0       : ""),
+		       (type  != NULL ? " "        : ""),
+		       (type  != NULL ? type       : ""),
+		       (value != NULL ? ":"        : ""),
+		       (value != NULL ? " "        : ""),
+		       (value != NULL ? value      : ""));
+		fflush(stdout);
+		break;
 	default:
 		assert(0);
 	}
@@ -374,6 +394,7 @@ static void format_block(ctl_cmd_t cmd, bool failed, bool empty)
 	case CTL_ZONE_RETRANSFER:
 	case CTL_ZONE_NOTIFY:
 	case CTL_ZONE_FLUSH:
+	case CTL_ZONE_SNAPSHOT:
 	case CTL_ZONE_BACKUP:
 	case CTL_ZONE_RESTORE:
 	case CTL_ZONE_SIGN:
@@ -404,6 +425,9 @@ static void format_block(ctl_cmd_t cmd, bool failed, bool empty)
 	case CTL_STATS:
 		printf("%s", empty ? "" : "\n");
 		break;
+	case CTL_ZONE_SUBSCRIBE:
+		// Each notification is finished separately.
+		break;
 	default:
 		assert(0);
 	}
@@ -636,6 +660,11 @@ static int cmd_zone_ctl(cmd_args_t *args)
 		CTL_SEND_DATA
 	}
 
+	// The block is finalized after the last merged command.
+	if (args->batch) {
+		return KNOT_EOK;
+	}
+
 	CTL_SEND_BLOCK
 
 	return ctl_receive(args);
@@ -673,6 +702,7 @@ const filter_desc_t zone_status_filters[MAX_FILTERS] = {
 	{ "+transaction", CTL_FILTER_STATUS_TRANSACTION },
 	{ "+freeze",      CTL_FILTER_STATUS_FREEZE },
 	{ "+events",      CTL_FILTER_STATUS_EVENTS },
+	{ "+usage",       CTL_FILTER_STATUS_USAGE },
 };
 
 const filter_desc_t zone_purge_filters[MAX_FILTERS] = {
@@ -684,6 +714,12 @@ const filter_desc_t zone_purge_filters[MAX_FILTERS] = {
 	{ "+orphan",   CTL_FILTER_PURGE_ORPHAN },
 };
 
+const filter_desc_t zone_subscribe_filters[MAX_FILTERS] = {
+	{ "+serial",  CTL_FILTER_SUBSCRIBE_SERIAL },
+	{ "+events",  CTL_FILTER_SUBSCRIBE_EVENTS },
+	{ "+refresh", CTL_FILTER_SUBSCRIBE_REFRESH },
+};
+
 const filter_desc_t null_filter = { 0 };
 
 static const filter_desc_t *get_filter(ctl_cmd_t cmd, const char *filter_name)
@@ -703,6 +739,9 @@ static const filter_desc_t *get_filter(ctl_cmd_t cmd, const char *filter_name)
 	case CTL_ZONE_PURGE:
 		fd = zone_purge_filters;
 		break;
+	case CTL_ZONE_SUBSCRIBE:
+		fd = zone_subscribe_filters;
+		break;
 	default:
 		return &null_filter;
 	}
@@ -887,6 +926,12 @@ static int cmd_zone_node_ctl(cmd_args_t *args)
 	}
 
 	CTL_SEND_DATA
+
+	// The block is finalized after the last merged command.
+	if (args->batch) {
+		return KNOT_EOK;
+	}
+
 	CTL_SEND_BLOCK
 
 	return ctl_receive(args);
@@ -1188,6 +1233,7 @@ const cmd_desc_t cmd_table[] = {
 	{ CMD_ZONE_RETRANSFER, cmd_zone_ctl,          CTL_ZONE_RETRANSFER, CMD_FOPT_ZONE },
 	{ CMD_ZONE_NOTIFY,     cmd_zone_ctl,          CTL_ZONE_NOTIFY,     CMD_FOPT_ZONE },
 	{ CMD_ZONE_FLUSH,      cmd_zone_filter_ctl,   CTL_ZONE_FLUSH,      CMD_FOPT_ZONE },
+	{ CMD_ZONE_SNAPSHOT,   cmd_zone_ctl,          CTL_ZONE_SNAPSHOT,   CMD_FOPT_ZONE },
 	{ CMD_ZONE_BACKUP,     cmd_zone_filter_ctl,   CTL_ZONE_BACKUP,     CMD_FOPT_ZONE },
 	{ CMD_ZONE_RESTORE,    cmd_zone_filter_ctl,   CTL_ZONE_RESTORE,    CMD_FOPT_ZONE },
 	{ CMD_ZONE_SIGN,       cmd_zone_ctl,          CTL_ZONE_SIGN,       CMD_FOPT_ZONE },
@@ -1209,6 +1255,7 @@ const cmd_desc_t cmd_table[] = {
 	{ CMD_ZONE_UNSET,      cmd_zone_node_ctl,   CTL_ZONE_UNSET,      CMD_FREQ_ZONE },
 	{ CMD_ZONE_PURGE,      cmd_zone_filter_ctl, CTL_ZONE_PURGE,      CMD_FREQ_ZONE | CMD_FOPT_ZONE },
 	{ CMD_ZONE_STATS,      cmd_stats_ctl,       CTL_ZONE_STATS,      CMD_FREQ_ZONE },
+	{ CMD_ZONE_SUBSCRIBE,  cmd_zone_filter_ctl, CTL_ZONE_SUBSCRIBE,  CMD_FOPT_ZONE },
 
 	{ CMD_CONF_INIT,       cmd_conf_init,     CTL_NONE,            CMD_FWRITE },
 	{ CMD_CONF_CHECK,      cmd_conf_check,    CTL_NONE,            CMD_FREAD  | CMD_FREQ_MOD },
@@ -1241,6 +1288,7 @@ static const cmd_help_t cmd_help_table[] = {
 	{ CMD_ZONE_NOTIFY,     "[<zone>...]",                                "Send a NOTIFY message to all configured remotes. (#)" },
 	{ CMD_ZONE_RETRANSFER, "[<zone>...]",                                "Force slave zone retransfer (no serial check). (#)" },
 	{ CMD_ZONE_FLUSH,      "[<zone>...] [<filter>...]",                  "Flush zone journal into the zone file. (#)" },
+	{ CMD_ZONE_SNAPSHOT,   "[<zone>...]",                                "Write a binary snapshot of the zone file." },
 	{ CMD_ZONE_BACKUP,     "[<zone>...] [<filter>...] +backupdir <dir>", "Backup zone data and metadata. (#)" },
 	{ CMD_ZONE_RESTORE,    "[<zone>...] [<filter>...] +backupdir <dir>", "Restore zone data and metadata. (#)" },
 	{ CMD_ZONE_SIGN,       "[<zone>...]",                                "Re-sign the automatically signed zone. (#)" },
@@ -1262,6 +1310,7 @@ static const cmd_help_t cmd_help_table[] = {
 	{ CMD_ZONE_UNSET,      "<zone>  <owner> [<type> [<rdata>]]",         "Remove zone data within the transaction." },
 	{ CMD_ZONE_PURGE,      "<zone>... [<filter>...]",                    "Purge zone data, zone file, journal, timers, and KASP data. (#)" },
 	{ CMD_ZONE_STATS,      "<zone> [<module>[.<counter>]]",              "Show zone statistics counter(s)."},
+	{ CMD_ZONE_SUBSCRIBE,  "[<zone>...] [<filter>...]",                  "Print zone notifications as they occur (until interrupted)." },
 	{ "",                  "",                                           "" },
 	{ CMD_CONF_INIT,       "",                                           "Initialize the confdb. (*)" },
 	{ CMD_CONF_CHECK,      "",                                           "Check the server configuration. (*)" },
@@ -1296,3 +1345,26 @@ void print_commands(void)
 	       " (#) indicates an optionally blocking operation.\n"
 	       " The '-b' and '-f' options can be placed right after the command name.\n");
 }
+
+bool cmd_batchable(const cmd_args_t *args)
+{
+	// Only commands with a specified zone and without output are merged.
+	if (args->desc->fcn == cmd_zone_node_ctl) {
+		if (args->desc->cmd != CTL_ZONE_SET && args->desc->cmd != CTL_ZONE_UNSET) {
+			return false;
+		}
+	} else if (args->desc->fcn != cmd_zone_ctl) {
+		return false;
+	}
+
+	return args->argc > 0 && strcmp(args->argv[0], "--") != 0;
+}
+
+int cmd_batch_finish(cmd_args_t *args)
+{
+	int ret;
+
+	CTL_SEND_BLOCK
+
+	return ctl_receive(args);
+}
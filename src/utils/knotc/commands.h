@@ -47,6 +47,7 @@ typedef struct {
 	char flags[4];
 	bool force;
 	bool blocking;
+	bool batch;
 } cmd_args_t;
 
 /*! \brief Command callback description. */
@@ -69,3 +70,15 @@ extern const cmd_desc_t cmd_table[];
 
 /*! \brief Prints commands help. */
 void print_commands(void);
+
+/*!
+ * \brief Checks if the command can be merged with other same commands into
+ *        one command block.
+ */
+bool cmd_batchable(const cmd_args_t *args);
+
+/*!
+ * \brief Finalizes the command block of the merged commands and receives
+ *        the response.
+ */
+int cmd_batch_finish(cmd_args_t *args);
@@ -16,6 +16,7 @@
 
 #include <getopt.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "contrib/strtonum.h"
 #include "knot/common/log.h"
@@ -43,6 +44,7 @@ static void print_help(void)
 	       " -t, --timeout <sec>      "SPACE"Use a control socket timeout (max 86400 seconds).\n"
 	       "                          "SPACE" (default %u seconds)\n"
 	       " -b, --blocking	          "SPACE"Zone event trigger commands wait until the event is finished.\n"
+	       " -B, --batch <file>       "SPACE"Process commands from the file ('-' for stdin) over one connection.\n"
 	       " -f, --force              "SPACE"Forced operation. Overrides some checks.\n"
 	       " -v, --verbose            "SPACE"Enable debug output.\n"
 	       " -h, --help               "SPACE"Print the program help.\n"
@@ -68,6 +70,7 @@ int main(int argc, char **argv)
 		{ "socket",        required_argument, NULL, 's' },
 		{ "timeout",       required_argument, NULL, 't' },
 		{ "blocking",      no_argument,       NULL, 'b' },
+		{ "batch",         required_argument, NULL, 'B' },
 		{ "force",         no_argument,       NULL, 'f' },
 		{ "verbose",       no_argument,       NULL, 'v' },
 		{ "help",          no_argument,       NULL, 'h' },
@@ -80,7 +83,7 @@ int main(int argc, char **argv)
 
 	/* Parse command line arguments */
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "+c:C:m:s:t:bfvhV", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "+c:C:m:s:t:bB:fvhV", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			params.orig_config = optarg;
@@ -110,6 +113,9 @@ int main(int argc, char **argv)
 		case 'b':
 			params.blocking = true;
 			break;
+		case 'B':
+			params.batch = optarg;
+			break;
 		case 'f':
 			params.force = true;
 			break;
@@ -140,7 +146,19 @@ int main(int argc, char **argv)
 	}
 
 	int ret;
-	if (argc - optind < 1) {
+	if (params.batch != NULL) {
+		FILE *in = (strcmp(params.batch, "-") == 0) ? stdin : fopen(params.batch, "r");
+		if (in == NULL) {
+			log_error("failed to open file '%s' (%s)", params.batch,
+			          knot_strerror(knot_map_errno()));
+			ret = KNOT_EFILE;
+		} else {
+			ret = process_batch(in, &params);
+			if (in != stdin) {
+				fclose(in);
+			}
+		}
+	} else if (argc - optind < 1) {
 		ret = interactive_loop(&params);
 	} else {
 		ret = process_cmd(argc - optind, (const char **)argv + optind, &params);
@@ -14,7 +14,10 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <histedit.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 
 #include "contrib/openbsd/strlcat.h"
@@ -23,6 +26,9 @@
 #include "utils/knotc/commands.h"
 #include "utils/knotc/process.h"
 
+/*! Maximum number of merged commands in one command block. */
+#define BATCH_MAX_CMDS	256
+
 static const cmd_desc_t *get_cmd_desc(const char *command)
 {
 	/* Find requested command. */
@@ -211,6 +217,53 @@ void unset_ctl(knot_ctl_t *ctl)
 	knot_ctl_free(ctl);
 }
 
+static void set_args(cmd_args_t *args, const cmd_desc_t *desc, int argc,
+                     const char **argv, params_t *params)
+{
+	*args = (cmd_args_t) {
+		.desc = desc,
+		.argc = argc,
+		.argv = argv,
+		.force = params->force,
+		.blocking = params->blocking
+	};
+
+	/* Check for special flags after command. */
+	while (args->argc > 0) {
+		if (get_cmd_force_flag(args->argv[0])) {
+			args->force = true;
+			args->argc--;
+			args->argv++;
+		} else if (get_cmd_blocking_flag(args->argv[0])) {
+			args->blocking = true;
+			args->argc--;
+			args->argv++;
+		} else {
+			break;
+		}
+	}
+
+	/* Prepare flags parameter. */
+	if (args->force) {
+		strlcat(args->flags, CTL_FLAG_FORCE, sizeof(args->flags));
+	}
+	if (args->blocking) {
+		strlcat(args->flags, CTL_FLAG_BLOCKING, sizeof(args->flags));
+	}
+}
+
+static int get_ctl_timeout(const cmd_args_t *args, const params_t *params)
+{
+	int cmd_timeout = params->timeout != -1 ? params->timeout : DEFAULT_CTL_TIMEOUT_MS;
+	// The blocking commands and the subscription wait indefinitely.
+	if ((args->blocking || args->desc->cmd == CTL_ZONE_SUBSCRIBE) &&
+	    params->timeout == -1) {
+		cmd_timeout = 0;
+	}
+
+	return cmd_timeout;
+}
+
 int process_cmd(int argc, const char **argv, params_t *params)
 {
 	if (argc == 0) {
@@ -235,43 +288,11 @@ int process_cmd(int argc, const char **argv, params_t *params)
 	}
 
 	/* Prepare command parameters. */
-	cmd_args_t args = {
-		.desc = desc,
-		.argc = argc - 1,
-		.argv = argv + 1,
-		.force = params->force,
-		.blocking = params->blocking
-	};
-
-	/* Check for special flags after command. */
-	while (args.argc > 0) {
-		if (get_cmd_force_flag(args.argv[0])) {
-			args.force = true;
-			args.argc--;
-			args.argv++;
-		} else if (get_cmd_blocking_flag(args.argv[0])) {
-			args.blocking = true;
-			args.argc--;
-			args.argv++;
-		} else {
-			break;
-		}
-	}
-
-	/* Prepare flags parameter. */
-	if (args.force) {
-		strlcat(args.flags, CTL_FLAG_FORCE, sizeof(args.flags));
-	}
-	if (args.blocking) {
-		strlcat(args.flags, CTL_FLAG_BLOCKING, sizeof(args.flags));
-	}
+	cmd_args_t args;
+	set_args(&args, desc, argc - 1, argv + 1, params);
 
 	/* Set control interface if necessary. */
-	int cmd_timeout = params->timeout != -1 ? params->timeout : DEFAULT_CTL_TIMEOUT_MS;
-	if (args.blocking && params->timeout == -1) {
-		cmd_timeout = 0;
-	}
-	ret = set_ctl(&args.ctl, params->socket, cmd_timeout, desc);
+	ret = set_ctl(&args.ctl, params->socket, get_ctl_timeout(&args, params), desc);
 	if (ret != KNOT_EOK) {
 		conf_update(NULL, CONF_UPD_FNONE);
 		return ret;
@@ -286,3 +307,119 @@ int process_cmd(int argc, const char **argv, params_t *params)
 
 	return ret;
 }
+
+static int batch_finish(cmd_args_t *batch, size_t *batch_cmds)
+{
+	if (*batch_cmds == 0) {
+		return KNOT_EOK;
+	}
+	*batch_cmds = 0;
+
+	return cmd_batch_finish(batch);
+}
+
+int process_batch(FILE *in, params_t *params)
+{
+	Tokenizer *tok = tok_init(NULL);
+	if (tok == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_ctl_t *ctl = NULL;
+	cmd_args_t batch = { 0 };
+	size_t batch_cmds = 0;
+	bool failed = false;
+
+	int ret = KNOT_EOK;
+	char *line = NULL;
+	size_t line_size = 0;
+	ssize_t len;
+	while ((len = getline(&line, &line_size, in)) != -1) {
+		if (len > 0 && line[len - 1] == '\n') {
+			line[len - 1] = '\0';
+		}
+
+		int argc;
+		const char **argv;
+		tok_reset(tok);
+		if (tok_str(tok, line, &argc, &argv) != 0) {
+			log_error("invalid command line '%s'", line);
+			failed = true;
+			continue;
+		}
+		if (argc == 0 || argv[0][0] == '#') {
+			continue;
+		}
+
+		const cmd_desc_t *desc = get_cmd_desc(argv[0]);
+		if (desc == NULL) {
+			failed = true;
+			continue;
+		} else if (desc->fcn == NULL) {
+			break;
+		}
+
+		/* Local operations are processed separately. */
+		if ((desc->flags & (CMD_FREAD | CMD_FWRITE)) != CMD_FNONE) {
+			if (batch_finish(&batch, &batch_cmds) != KNOT_EOK ||
+			    process_cmd(argc, argv, params) != KNOT_EOK) {
+				failed = true;
+			}
+			continue;
+		}
+
+		cmd_args_t args;
+		set_args(&args, desc, argc - 1, argv + 1, params);
+
+		/* All the control operations share one connection. */
+		if (ctl == NULL) {
+			ret = set_config(desc, params);
+			if (ret != KNOT_EOK) {
+				break;
+			}
+			ret = set_ctl(&ctl, params->socket, get_ctl_timeout(&args, params), desc);
+			conf_update(NULL, CONF_UPD_FNONE);
+			if (ret != KNOT_EOK) {
+				break;
+			}
+		}
+		args.ctl = ctl;
+
+		/* Finalize the current block if the command can't be merged. */
+		args.batch = cmd_batchable(&args);
+		if (batch_cmds > 0 &&
+		    (!args.batch || args.desc != batch.desc ||
+		     strcmp(args.flags, batch.flags) != 0 || batch_cmds >= BATCH_MAX_CMDS)) {
+			if (batch_finish(&batch, &batch_cmds) != KNOT_EOK) {
+				failed = true;
+			}
+		}
+
+		knot_ctl_set_timeout(ctl, get_ctl_timeout(&args, params));
+
+		if (desc->fcn(&args) != KNOT_EOK) {
+			failed = true;
+		} else if (args.batch) {
+			if (batch_cmds == 0) {
+				batch = args;
+				batch.argc = 0;
+				batch.argv = NULL;
+			}
+			batch_cmds++;
+		}
+	}
+
+	if (batch_finish(&batch, &batch_cmds) != KNOT_EOK) {
+		failed = true;
+	}
+
+	free(line);
+	tok_end(tok);
+	unset_ctl(ctl);
+
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return failed ? KNOT_ERROR : KNOT_EOK;
+}
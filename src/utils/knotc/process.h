@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <stdio.h>
+
 #include "utils/knotc/commands.h"
 
 #define DEFAULT_CTL_TIMEOUT_MS	(60 * 1000)
@@ -32,6 +34,7 @@ typedef struct {
 	bool force;
 	bool blocking;
 	int timeout;
+	const char *batch;
 } params_t;
 
 /*!
@@ -73,3 +76,17 @@ void unset_ctl(knot_ctl_t *ctl);
  * \return Error code, KNOT_EOK if successful.
  */
 int process_cmd(int argc, const char **argv, params_t *params);
+
+/*!
+ * Processes the utility commands from the input, one command per line.
+ *
+ * All the control commands are sent over one control connection. Consecutive
+ * same commands for specified zones (e.g. zone-set) are merged into one
+ * command block so the server processes them without waiting for the client.
+ *
+ * \param[in] in      Input with the commands.
+ * \param[in] params  Utility parameters.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int process_batch(FILE *in, params_t *params);
@@ -17,6 +17,7 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,7 +33,9 @@
 
 #include "libdnssec/crypto.h"
 #include "libknot/libknot.h"
+#include "contrib/string.h"
 #include "contrib/strtonum.h"
+#include "knot/ctl/commands.h"
 #include "knot/ctl/process.h"
 #include "knot/conf/conf.h"
 #include "knot/conf/migration.h"
@@ -40,7 +43,9 @@
 #include "knot/common/log.h"
 #include "knot/common/process.h"
 #include "knot/common/stats.h"
+#include "knot/common/subscribe.h"
 #include "knot/common/systemd.h"
+#include "knot/server/handoff.h"
 #include "knot/server/server.h"
 #include "knot/server/tcp-handler.h"
 
@@ -203,8 +208,205 @@ static void drop_capabilities(void)
 #endif /* ENABLE_CAP_NG */
 }
 
+/*! \brief Control connection processing thread. */
+typedef struct {
+	pthread_t thread;
+	pthread_t main_thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	server_t *server;
+	knot_ctl_t *ctl;  // Connection being processed.
+	int thread_idx;
+	bool exit;
+} ctl_worker_t;
+
+static void *ctl_worker_main(void *arg)
+{
+	ctl_worker_t *worker = arg;
+
+	rcu_register_thread();
+
+	pthread_mutex_lock(&worker->lock);
+	while (true) {
+		while (worker->ctl == NULL && !worker->exit) {
+			pthread_cond_wait(&worker->cond, &worker->lock);
+		}
+		if (worker->ctl == NULL) {
+			break;
+		}
+		pthread_mutex_unlock(&worker->lock);
+
+		int ret = ctl_process(worker->ctl, worker->server, worker->thread_idx);
+		knot_ctl_free(worker->ctl);
+
+		pthread_mutex_lock(&worker->lock);
+		worker->ctl = NULL;
+
+		// Stop the server the same way as the terminating signal does.
+		if (ret == KNOT_CTL_ESTOP && !sig_req_stop) {
+			pthread_kill(worker->main_thread, SIGTERM);
+		}
+	}
+	pthread_mutex_unlock(&worker->lock);
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+static int ctl_workers_start(ctl_worker_t *workers, server_t *server)
+{
+	for (int i = 0; i < CTL_MAX_CONCURRENT; i++) {
+		ctl_worker_t *worker = &workers[i];
+		*worker = (ctl_worker_t) {
+			.main_thread = pthread_self(),
+			.server = server,
+			.thread_idx = i + 1
+		};
+		pthread_mutex_init(&worker->lock, NULL);
+		pthread_cond_init(&worker->cond, NULL);
+
+		// The server signals are blocked as in the main thread at this point.
+		if (pthread_create(&worker->thread, NULL, ctl_worker_main, worker) != 0) {
+			pthread_cond_destroy(&worker->cond);
+			pthread_mutex_destroy(&worker->lock);
+			return i;
+		}
+	}
+
+	return CTL_MAX_CONCURRENT;
+}
+
+static void ctl_workers_stop(ctl_worker_t *workers, int count)
+{
+	for (int i = 0; i < count; i++) {
+		pthread_mutex_lock(&workers[i].lock);
+		workers[i].exit = true;
+		pthread_cond_signal(&workers[i].cond);
+		pthread_mutex_unlock(&workers[i].lock);
+	}
+	for (int i = 0; i < count; i++) {
+		pthread_join(workers[i].thread, NULL);
+		pthread_cond_destroy(&workers[i].cond);
+		pthread_mutex_destroy(&workers[i].lock);
+	}
+}
+
+/*! \brief Passes the accepted connection to an idle worker if any. */
+static bool ctl_workers_assign(ctl_worker_t *workers, int count, knot_ctl_t *ctl)
+{
+	for (int i = 0; i < count; i++) {
+		ctl_worker_t *worker = &workers[i];
+		pthread_mutex_lock(&worker->lock);
+		if (worker->ctl == NULL) {
+			worker->ctl = knot_ctl_clone(ctl);
+			bool assigned = (worker->ctl != NULL);
+			pthread_cond_signal(&worker->cond);
+			pthread_mutex_unlock(&worker->lock);
+			return assigned;
+		}
+		pthread_mutex_unlock(&worker->lock);
+	}
+
+	return false;
+}
+
+/*! \brief Hand-over of the server sockets to a successor (hot restart). */
+typedef struct {
+	pthread_t thread;
+	pthread_t main_thread;
+	server_t *server;
+	char *path;  // Hand-over socket path.
+	int sock;    // Listening hand-over socket.
+	int conn;    // Connection to the ready successor, -1 if none.
+	volatile bool exit;
+} handoff_worker_t;
+
+/*! \brief Poll interval of the hand-over worker for the exit request (in milliseconds). */
+#define HANDOFF_POLL_INTERVAL 1000
+
+static void *handoff_worker_main(void *arg)
+{
+	handoff_worker_t *worker = arg;
+
+	while (!worker->exit) {
+		struct pollfd pfd = { .fd = worker->sock, .events = POLLIN };
+		if (poll(&pfd, 1, HANDOFF_POLL_INTERVAL) <= 0) {
+			continue;
+		}
+		int conn = accept(worker->sock, NULL, NULL);
+		if (conn < 0) {
+			continue;
+		}
+
+		// The interfaces aren't reconfigured while running.
+		int ret = handoff_send(conn, worker->server);
+		if (ret != KNOT_EOK) {
+			log_error("hot restart, failed to hand over sockets (%s)",
+			          knot_strerror(ret));
+			close(conn);
+			continue;
+		}
+		log_info("hot restart, sockets handed over, waiting for the successor");
+
+		do {
+			ret = handoff_wait_ready(conn, HANDOFF_POLL_INTERVAL);
+		} while (ret == KNOT_ETIMEOUT && !worker->exit);
+
+		if (ret == KNOT_EOK) {
+			worker->conn = conn;
+			// Stop the server the same way as the terminating signal does.
+			pthread_kill(worker->main_thread, SIGTERM);
+			break;
+		}
+		if (!worker->exit) {
+			log_warning("hot restart, successor failed, continuing");
+		}
+		close(conn);
+	}
+
+	return NULL;
+}
+
+static void handoff_worker_start(handoff_worker_t *worker, server_t *server)
+{
+	worker->main_thread = pthread_self();
+	worker->server = server;
+	worker->conn = -1;
+	worker->exit = false;
+
+	worker->sock = handoff_listen(worker->path);
+	if (worker->sock < 0) {
+		log_error("hot restart, failed to bind socket '%s' (%s)",
+		          worker->path, knot_strerror(worker->sock));
+		return;
+	}
+
+	// The server signals are blocked as in the main thread at this point.
+	if (pthread_create(&worker->thread, NULL, handoff_worker_main, worker) != 0) {
+		log_error("hot restart, failed to start");
+		close(worker->sock);
+		(void)unlink(worker->path);
+		worker->sock = -1;
+	}
+}
+
+static void handoff_worker_stop(handoff_worker_t *worker)
+{
+	if (worker->sock < 0) {
+		return;
+	}
+
+	worker->exit = true;
+	pthread_join(worker->thread, NULL);
+
+	close(worker->sock);
+	(void)unlink(worker->path);
+	worker->sock = -1;
+}
+
 /*! \brief Event loop listening for signals and remote commands. */
-static void event_loop(server_t *server, const char *socket)
+static void event_loop(server_t *server, const char *socket, handoff_worker_t *handoff)
 {
 	knot_ctl_t *ctl = knot_ctl_alloc();
 	if (ctl == NULL) {
@@ -246,6 +448,15 @@ static void event_loop(server_t *server, const char *socket)
 	}
 	free(listen);
 
+	/* Start the concurrent control processing. */
+	ctl_worker_t workers[CTL_MAX_CONCURRENT];
+	int workers_count = ctl_workers_start(workers, server);
+
+	/* Accept a successor for the hot restart. */
+	if (handoff != NULL) {
+		handoff_worker_start(handoff, server);
+	}
+
 	enable_signals();
 
 	/* Notify systemd about successful start. */
@@ -259,11 +470,15 @@ static void event_loop(server_t *server, const char *socket)
 		/* Interrupts. */
 		if (sig_req_reload && !sig_req_stop) {
 			sig_req_reload = false;
+			ctl_exclusive_lock();
 			server_reload(server);
+			ctl_exclusive_unlock();
 		}
 		if (sig_req_zones_reload && !sig_req_stop) {
 			sig_req_zones_reload = false;
+			ctl_exclusive_lock();
 			server_update_zones(conf(), server);
+			ctl_exclusive_unlock();
 		}
 		if (sig_req_stop) {
 			break;
@@ -277,13 +492,22 @@ static void event_loop(server_t *server, const char *socket)
 			continue;
 		}
 
-		ret = ctl_process(ctl, server);
+		// Process the connection in the main thread if no worker is idle.
+		if (ctl_workers_assign(workers, workers_count, ctl)) {
+			continue;
+		}
+
+		ret = ctl_process(ctl, server, 0);
 		knot_ctl_close(ctl);
 		if (ret == KNOT_CTL_ESTOP) {
 			break;
 		}
 	}
 
+	/* Wait for the connections in progress, finish the subscriptions. */
+	subscribe_shutdown();
+	ctl_workers_stop(workers, workers_count);
+
 	if (conf()->cache.srv_dbus_event & DBUS_EVENT_RUNNING) {
 		systemd_emit_running(false);
 	}
@@ -291,6 +515,41 @@ static void event_loop(server_t *server, const char *socket)
 	/* Unbind the control socket. */
 	knot_ctl_unbind(ctl);
 	knot_ctl_free(ctl);
+
+	/* The successor binds the sockets once released. */
+	if (handoff != NULL) {
+		handoff_worker_stop(handoff);
+	}
+}
+
+/*! \brief Returns the hand-over socket path in the run directory. */
+static char *handoff_path(void)
+{
+	conf_val_t rundir_val = conf_get(conf(), C_SRV, C_RUNDIR);
+	char *rundir = conf_abs_path(&rundir_val, NULL);
+	char *path = sprintf_alloc("%s/%s", rundir, HANDOFF_SOCKET);
+	free(rundir);
+
+	return path;
+}
+
+/*! \brief Receives the sockets of the running server if any. */
+static void handoff_take_over(handoff_t *handoff, const char *path)
+{
+	int ret = handoff_connect(path, handoff);
+	switch (ret) {
+	case KNOT_EOK:
+		log_info("hot restart, taking over %zu sockets from PID %u",
+		         handoff->count, (unsigned)handoff->pid);
+		break;
+	case KNOT_ECONN:
+		log_info("hot restart, no running server found");
+		break;
+	default:
+		log_error("hot restart, failed to receive sockets (%s)",
+		          knot_strerror(ret));
+		break;
+	}
 }
 
 static void print_help(void)
@@ -307,6 +566,7 @@ static void print_help(void)
 	       " -s, --socket <path>        Use a remote control UNIX socket path.\n"
 	       "                             (default %s)\n"
 	       " -d, --daemonize=[dir]      Run the server as a daemon (with new root directory).\n"
+	       " -H, --hot-restart          Take over from the running server, allow the same for a successor.\n"
 	       " -v, --verbose              Enable debug output.\n"
 	       " -h, --help                 Print the program help.\n"
 	       " -V, --version              Print the program version.\n",
@@ -381,6 +641,7 @@ int main(int argc, char **argv)
 	const char *daemon_root = "/";
 	char *socket = NULL;
 	bool verbose = false;
+	bool hot_restart = false;
 
 	/* Long options. */
 	struct option opts[] = {
@@ -389,6 +650,7 @@ int main(int argc, char **argv)
 		{ "max-conf-size", required_argument, NULL, 'm' },
 		{ "socket",        required_argument, NULL, 's' },
 		{ "daemonize",     optional_argument, NULL, 'd' },
+		{ "hot-restart",   no_argument,       NULL, 'H' },
 		{ "verbose",       no_argument,       NULL, 'v' },
 		{ "help",          no_argument,       NULL, 'h' },
 		{ "version",       no_argument,       NULL, 'V' },
@@ -400,7 +662,7 @@ int main(int argc, char **argv)
 
 	/* Parse command line arguments. */
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:m:s:dvhV", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:m:s:dHvhV", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			config = optarg;
@@ -425,6 +687,9 @@ int main(int argc, char **argv)
 				daemon_root = optarg;
 			}
 			break;
+		case 'H':
+			hot_restart = true;
+			break;
 		case 'v':
 			verbose = true;
 			break;
@@ -493,11 +758,34 @@ int main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 
+	/* Receive the sockets of the running server to take over. */
+	handoff_t handoff = { .conn = -1 };
+	handoff_worker_t handoff_worker = { .sock = -1 };
+	if (hot_restart) {
+		conf_val_t lisxdp_val = conf_get(conf(), C_XDP, C_LISTEN);
+		conf_val_t srvxdp_val = conf_get(conf(), C_SRV, C_LISTEN_XDP);
+		if (lisxdp_val.code == KNOT_EOK || srvxdp_val.code == KNOT_EOK) {
+			log_fatal("hot restart, not supported with XDP interfaces");
+			server_wait(&server);
+			server_deinit(&server);
+			conf_free(conf());
+			log_close();
+			return EXIT_FAILURE;
+		}
+		handoff_worker.path = handoff_path();
+		handoff_take_over(&handoff, handoff_worker.path);
+		server.handoff = &handoff;
+	}
+
 	/* Reconfigure server workers, interfaces, and databases.
 	 * @note This MUST be done before we drop privileges. */
 	ret = server_reconfigure(conf(), &server);
+	server.handoff = NULL;
+	handoff_close_unused(&handoff);
 	if (ret != KNOT_EOK) {
 		log_fatal("failed to configure server");
+		handoff_deinit(&handoff);
+		free(handoff_worker.path);
 		server_wait(&server);
 		server_deinit(&server);
 		conf_free(conf());
@@ -518,6 +806,8 @@ int main(int argc, char **argv)
 	    log_update_privileges(uid, gid) != KNOT_EOK ||
 	    proc_update_privileges(uid, gid) != KNOT_EOK) {
 		log_fatal("failed to drop privileges");
+		handoff_deinit(&handoff);
+		free(handoff_worker.path);
 		server_wait(&server);
 		server_deinit(&server);
 		conf_free(conf());
@@ -534,8 +824,10 @@ int main(int argc, char **argv)
 	                      &conf()->query_plan);
 
 	/* Check and create PID file. */
-	unsigned long pid = pid_check_and_create();
+	unsigned long pid = pid_check_and_create(handoff.pid);
 	if (pid == 0) {
+		handoff_deinit(&handoff);
+		free(handoff_worker.path);
 		server_wait(&server);
 		server_deinit(&server);
 		conf_free(conf());
@@ -570,9 +862,12 @@ int main(int argc, char **argv)
 	/* Start it up. */
 	log_info("starting server");
 	conf_val_t async_val = conf_get(conf(), C_SRV, C_ASYNC_START);
-	ret = server_start(&server, conf_bool(&async_val));
+	bool async = conf_bool(&async_val) && handoff.conn < 0; // Taking over loaded zones.
+	ret = server_start(&server, async);
 	if (ret != KNOT_EOK) {
 		log_fatal("failed to start server (%s)", knot_strerror(ret));
+		handoff_deinit(&handoff);
+		free(handoff_worker.path);
 		server_wait(&server);
 		stats_deinit();
 		server_deinit(&server);
@@ -590,16 +885,37 @@ int main(int argc, char **argv)
 		log_info("server started in the foreground, PID %lu", pid);
 	}
 
+	/* Let the predecessor drain, it releases the control socket first. */
+	if (handoff.conn >= 0) {
+		ret = handoff_ready(&handoff, HANDOFF_RELEASE_TIMEOUT);
+		if (ret != KNOT_EOK) {
+			log_warning("hot restart, predecessor didn't confirm release (%s)",
+			            knot_strerror(ret));
+		}
+	}
+	handoff_deinit(&handoff);
+
 	/* Start the event loop. */
-	event_loop(&server, socket);
+	event_loop(&server, socket, hot_restart ? &handoff_worker : NULL);
+
+	/* Hand over the service to the successor. */
+	bool handed_over = (handoff_worker.conn >= 0);
+	if (handed_over) {
+		log_info("hot restart, handing over to the successor");
+		handoff_released(handoff_worker.conn);
+		server_drain(&server, HANDOFF_DRAIN_TIMEOUT);
+	}
+	free(handoff_worker.path);
 
 	/* Teardown server. */
 	server_stop(&server);
 	server_wait(&server);
 	stats_deinit();
 
-	/* Cleanup PID file. */
-	pid_cleanup();
+	/* Cleanup PID file (rewritten by the successor). */
+	if (!handed_over) {
+		pid_cleanup();
+	}
 
 	/* Free server and configuration. */
 	server_deinit(&server);
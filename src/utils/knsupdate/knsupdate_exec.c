@@ -385,20 +385,27 @@ static int rr_list_to_packet(knot_pkt_t *dst, list_t *list)
 	return KNOT_EOK;
 }
 
-/*! \brief Build UPDATE query. */
-static int build_query(knsupdate_params_t *params)
+/*! \brief Clear the message and write UPDATE header and question. */
+static int init_query(knot_pkt_t *query, knsupdate_params_t *params)
 {
-	/* Clear old query. */
-	knot_pkt_t *query = params->query;
 	knot_pkt_clear(query);
 
-	/* Write question. */
 	knot_wire_set_id(query->wire, dnssec_random_uint16_t());
 	knot_wire_set_opcode(query->wire, KNOT_OPCODE_UPDATE);
 	knot_dname_t *qname = knot_dname_from_str_alloc(params->zone);
 	int ret = knot_pkt_put_question(query, qname, params->class_num,
 	                                params->type_num);
 	knot_dname_free(qname, NULL);
+
+	return ret;
+}
+
+/*! \brief Build UPDATE query. */
+static int build_query(knsupdate_params_t *params)
+{
+	/* Clear old query and write question. */
+	knot_pkt_t *query = params->query;
+	int ret = init_query(query, params);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -477,6 +484,293 @@ static int pkt_sendrecv(knsupdate_params_t *params)
 	return rb;
 }
 
+static int batch_connect(knsupdate_params_t *params)
+{
+	knsupdate_batch_t *batch = &params->batch;
+	if (batch->connected) {
+		return KNOT_EOK;
+	}
+
+	int ret = net_init(params->srcif,
+	                   params->server,
+	                   get_iptype(params->ip),
+	                   get_socktype(params->protocol, KNOT_RRTYPE_SOA),
+	                   params->wait,
+	                   NET_FLAGS_NONE,
+	                   NULL,
+	                   NULL,
+	                   &batch->net);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = net_connect(&batch->net);
+	DBG("%s: batch connection = %d\n", __func__, batch->net.sockfd);
+	if (ret != KNOT_EOK) {
+		net_clean(&batch->net);
+		return ret;
+	}
+	batch->connected = true;
+
+	return KNOT_EOK;
+}
+
+static void batch_disconnect(knsupdate_batch_t *batch)
+{
+	if (batch->connected) {
+		net_close(&batch->net);
+		net_clean(&batch->net);
+		batch->connected = false;
+	}
+}
+
+static bool batch_id_used(const knsupdate_batch_t *batch, uint16_t id)
+{
+	for (size_t i = 0; i < batch->sent_count; i++) {
+		if (batch->sent[i].id == id) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*! \brief Receive and check a response to one of the batched messages. */
+static int batch_receive(knsupdate_params_t *params)
+{
+	knsupdate_batch_t *batch = &params->batch;
+	assert(batch->sent_count > 0);
+
+	/* Clear response buffer. */
+	knot_pkt_clear(params->answer);
+
+	int rb = net_receive(&batch->net, params->answer->wire,
+	                     params->answer->max_size);
+	DBG("%s: receive_msg = %d\n", __func__, rb);
+	if (rb <= 0) {
+		ERR("no response to %zu UPDATE messages\n", batch->sent_count);
+		batch_disconnect(batch);
+		return KNOT_ECONNREFUSED;
+	}
+	params->answer->size = rb;
+
+	int ret = knot_pkt_parse(params->answer, KNOT_PF_NOCANON);
+	if (ret != KNOT_EOK) {
+		ERR("failed to parse response (%s)\n", knot_strerror(ret));
+		return ret;
+	}
+
+	/* Pair the response with its message. */
+	uint16_t id = knot_wire_get_id(params->answer->wire);
+	size_t idx = 0;
+	while (idx < batch->sent_count && batch->sent[idx].id != id) {
+		idx++;
+	}
+	if (idx == batch->sent_count) {
+		ERR("unexpected response with ID %u\n", id);
+		return KNOT_EMALF;
+	}
+	knsupdate_sent_t sent = batch->sent[idx];
+	batch->sent[idx] = batch->sent[--batch->sent_count];
+
+	/* Check signature if expected. */
+	if (params->tsig_key.name) {
+		ret = verify_packet(params->answer, &sent.sign_ctx);
+	}
+	sign_context_deinit(&sent.sign_ctx);
+	if (ret != KNOT_EOK) {
+		print_packet(params->answer, NULL, 0, -1, 0, true,
+		             &params->style);
+		ERR("reply verification (%s)\n", knot_strerror(ret));
+		return ret;
+	}
+
+	/* Check return code. */
+	if (knot_pkt_ext_rcode(params->answer) != KNOT_RCODE_NOERROR) {
+		print_packet(params->answer, NULL, 0, -1, 0, true, &params->style);
+		ERR("batch of %zu updates failed with error '%s'\n",
+		    sent.updates, knot_pkt_ext_rcode_name(params->answer));
+		return KNOT_ERROR;
+	}
+	DBG("batch of %zu updates success\n", sent.updates);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Send the message, wait for a response first if too many are in flight. */
+static int batch_submit(knsupdate_params_t *params, knot_pkt_t *pkt, size_t updates)
+{
+	knsupdate_batch_t *batch = &params->batch;
+
+	if (batch->sent == NULL) {
+		batch->sent = calloc(params->batch_size, sizeof(*batch->sent));
+		if (batch->sent == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	int ret = batch_connect(params);
+	if (ret != KNOT_EOK) {
+		return KNOT_ECONNREFUSED;
+	}
+
+	while (batch->sent_count >= params->batch_size) {
+		ret = batch_receive(params);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	/* The ID must be unique among the messages in flight. */
+	knsupdate_sent_t *sent = &batch->sent[batch->sent_count];
+	memset(sent, 0, sizeof(*sent));
+	do {
+		sent->id = dnssec_random_uint16_t();
+	} while (batch_id_used(batch, sent->id));
+	sent->updates = updates;
+	knot_wire_set_id(pkt->wire, sent->id);
+
+	/* Sign if key specified. */
+	if (params->tsig_key.name) {
+		ret = sign_context_init_tsig(&sent->sign_ctx, &params->tsig_key);
+		if (ret == KNOT_EOK) {
+			ret = sign_packet(pkt, &sent->sign_ctx);
+		}
+		if (ret != KNOT_EOK) {
+			ERR("failed to sign UPDATE message (%s)\n",
+			    knot_strerror(ret));
+			sign_context_deinit(&sent->sign_ctx);
+			return ret;
+		}
+	}
+
+	ret = net_send(&batch->net, pkt->wire, pkt->size);
+	if (ret != KNOT_EOK) {
+		sign_context_deinit(&sent->sign_ctx);
+		batch_disconnect(batch);
+		return KNOT_ECONNREFUSED;
+	}
+	batch->sent_count++;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Send the message being filled with the updates, if any. */
+static int batch_send_pending(knsupdate_params_t *params)
+{
+	knsupdate_batch_t *batch = &params->batch;
+	if (batch->updates == 0) {
+		return KNOT_EOK;
+	}
+
+	int ret = batch_submit(params, batch->pkt, batch->updates);
+	batch->updates = 0;
+
+	return ret;
+}
+
+/*! \brief Send the pending updates and wait for all the responses. */
+static int batch_flush(knsupdate_params_t *params)
+{
+	knsupdate_batch_t *batch = &params->batch;
+
+	/* Nothing more is sent after a failure, the responses are awaited though. */
+	int ret = batch->error;
+	if (ret == KNOT_EOK) {
+		ret = batch_send_pending(params);
+	}
+	while (batch->sent_count > 0 && batch->connected) {
+		int recv_ret = batch_receive(params);
+		if (ret == KNOT_EOK) {
+			ret = recv_ret;
+		}
+	}
+
+	for (size_t i = 0; i < batch->sent_count; i++) {
+		sign_context_deinit(&batch->sent[i].sign_ctx);
+	}
+	batch->sent_count = 0;
+	batch->updates = 0;
+	batch->error = KNOT_EOK;
+	batch_disconnect(batch);
+
+	return ret;
+}
+
+/*!
+ * \brief Add the update to the message being filled.
+ *
+ * Updates without prerequisites are packed into as big messages as possible,
+ * which are sent when full. An update with prerequisites is sent in a message
+ * of its own as the prerequisites apply to the whole message.
+ */
+static int batch_send(knsupdate_params_t *params)
+{
+	knsupdate_batch_t *batch = &params->batch;
+	if (batch->error != KNOT_EOK) {
+		return batch->error;
+	}
+
+	int ret = KNOT_EOK;
+	if (!EMPTY_LIST(params->prereq_list)) {
+		ret = batch_send_pending(params);
+		if (ret == KNOT_EOK) {
+			ret = build_query(params);
+			if (ret != KNOT_EOK) {
+				ERR("failed to build UPDATE message (%s)\n",
+				    knot_strerror(ret));
+			}
+		}
+		if (ret == KNOT_EOK) {
+			ret = batch_submit(params, params->query, 1);
+		}
+		knsupdate_reset(params);
+		batch->error = ret;
+		return ret;
+	}
+
+	if (batch->pkt == NULL) {
+		batch->pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, &params->mm);
+		if (batch->pkt == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	/* Uncompressed size is an upper bound of the space needed. */
+	size_t size = 0;
+	ptrnode_t *node;
+	WALK_LIST(node, params->update_list) {
+		size += knot_rrset_size((knot_rrset_t *)node->d);
+	}
+	if (params->tsig_key.name) {
+		size += knot_tsig_wire_size(&params->tsig_key);
+	}
+
+	if (batch->updates > 0 && batch->pkt->size + size > batch->pkt->max_size) {
+		ret = batch_send_pending(params);
+	}
+	if (ret == KNOT_EOK && batch->updates == 0) {
+		ret = init_query(batch->pkt, params);
+		if (ret == KNOT_EOK) {
+			ret = knot_pkt_begin(batch->pkt, KNOT_AUTHORITY);
+		}
+	}
+	if (ret == KNOT_EOK) {
+		ret = rr_list_to_packet(batch->pkt, &params->update_list);
+		if (ret != KNOT_EOK) {
+			ERR("failed to build UPDATE message (%s)\n",
+			    knot_strerror(ret));
+		}
+	}
+	if (ret == KNOT_EOK) {
+		batch->updates++;
+	}
+
+	knsupdate_reset(params);
+	batch->error = ret;
+	return ret;
+}
+
 int knsupdate_process_line(const char *line, knsupdate_params_t *params)
 {
 	/* Check for empty line or comment. */
@@ -576,6 +870,12 @@ int knsupdate_exec(knsupdate_params_t *params)
 		}
 	}
 
+	/* Finish the batched updates. */
+	int flush_ret = batch_flush(params);
+	if (ret == KNOT_EOK) {
+		ret = flush_ret;
+	}
+
 	return ret;
 }
 
@@ -648,6 +948,11 @@ int cmd_class(const char* lp, knsupdate_params_t *params)
 		return KNOT_EPARSEFAIL;
 	}
 
+	int ret = batch_flush(params);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	params->class_num = cls;
 	params->parser.default_class = params->class_num;
 
@@ -810,6 +1115,10 @@ int cmd_send(const char* lp, knsupdate_params_t *params)
 	DBG("%s: lp='%s'\n", __func__, lp);
 	DBG("sending packet\n");
 
+	if (params->batch_size > 0) {
+		return batch_send(params);
+	}
+
 	/* Build query packet. */
 	int ret = build_query(params);
 	if (ret != KNOT_EOK) {
@@ -898,6 +1207,11 @@ int cmd_zone(const char* lp, knsupdate_params_t *params)
 		return KNOT_EPARSEFAIL;
 	}
 
+	int ret = batch_flush(params);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	free(params->zone);
 	params->zone = strdup(lp);
 
@@ -915,6 +1229,12 @@ int cmd_server(const char* lp, knsupdate_params_t *params)
 		return KNOT_ENOMEM;
 	}
 
+	int ret = batch_flush(params);
+	if (ret != KNOT_EOK) {
+		srv_info_free(srv);
+		return ret;
+	}
+
 	srv_info_free(params->server);
 	params->server = srv;
 
@@ -932,6 +1252,12 @@ int cmd_local(const char* lp, knsupdate_params_t *params)
 		return KNOT_ENOMEM;
 	}
 
+	int ret = batch_flush(params);
+	if (ret != KNOT_EOK) {
+		srv_info_free(srv);
+		return ret;
+	}
+
 	srv_info_free(params->srcif);
 	params->srcif = srv;
 
@@ -962,6 +1288,12 @@ int cmd_answer(const char* lp, knsupdate_params_t *params)
 		return KNOT_EOK;
 	}
 
+	/* Wait for the batched updates. */
+	int ret = batch_flush(params);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	printf("\nAnswer:\n");
 	print_packet(params->answer, NULL, 0, -1, 0, true, &params->style);
 
@@ -972,14 +1304,18 @@ int cmd_key(const char* lp, knsupdate_params_t *params)
 {
 	DBG("%s: lp='%s'\n", __func__, lp);
 
+	/* The batched messages must be verified with the previous key. */
+	int ret = batch_flush(params);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
 	/* Convert to default format. */
 	char *kstr = strdup(lp);
 	if (!kstr) {
 		return KNOT_ENOMEM;
 	}
 
-	int ret = KNOT_EOK;
-
 	/* Search for the name secret separation. Allow also alg:name:key form. */
 	char *sep = strchr(kstr, ' ');
 	if (sep != NULL) {
@@ -143,6 +143,18 @@ void knsupdate_clean(knsupdate_params_t *params)
 	zs_deinit(&params->parser);
 	knot_pkt_free(params->query);
 	knot_pkt_free(params->answer);
+
+	/* Clear unfinished batch. */
+	knsupdate_batch_t *batch = &params->batch;
+	for (size_t i = 0; i < batch->sent_count; i++) {
+		sign_context_deinit(&batch->sent[i].sign_ctx);
+	}
+	free(batch->sent);
+	knot_pkt_free(batch->pkt);
+	if (batch->connected) {
+		net_close(&batch->net);
+		net_clean(&batch->net);
+	}
 	knot_tsig_key_deinit(&params->tsig_key);
 
 	/* Clean up the structure. */
@@ -176,7 +188,8 @@ void knsupdate_reset(knsupdate_params_t *params)
 static void print_help(void)
 {
 	printf("Usage: %s [-d] [-v] [-k keyfile | -y [hmac:]name:key]\n"
-	       "                 [-p port] [-t timeout] [-r retries] [filename]\n",
+	       "                 [-p port] [-t timeout] [-r retries] [-b num]\n"
+	       "                 [filename]\n",
 	       PROGRAM_NAME);
 }
 
@@ -200,7 +213,7 @@ int knsupdate_parse(knsupdate_params_t *params, int argc, char *argv[])
 
 	/* Command line options processing. */
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "dhDvVp:t:r:y:k:", opts, NULL))
+	while ((opt = getopt_long(argc, argv, "dhDvVp:t:r:y:k:b:", opts, NULL))
 	       != -1) {
 		switch (opt) {
 		case 'd':
@@ -233,6 +246,15 @@ int knsupdate_parse(knsupdate_params_t *params, int argc, char *argv[])
 				return ret;
 			}
 			break;
+		case 'b':
+			ret = str_to_u32(optarg, &params->batch_size);
+			if (ret != KNOT_EOK || params->batch_size == 0) {
+				ERR("invalid batch size '%s'\n", optarg);
+				return KNOT_EINVAL;
+			}
+			/* Batched messages are pipelined over one connection. */
+			params->protocol = PROTO_TCP;
+			break;
 		case 't':
 			ret = params_parse_wait(optarg, &params->wait);
 			if (ret != KNOT_EOK) {
@@ -27,6 +27,34 @@
 
 #define PROGRAM_NAME "knsupdate"
 
+/*! \brief Batched UPDATE message waiting for the response. */
+typedef struct {
+	/*!< Message ID. */
+	uint16_t	id;
+	/*!< Number of the sent updates in the message. */
+	size_t		updates;
+	/*!< Signing context for the response verification. */
+	sign_context_t	sign_ctx;
+} knsupdate_sent_t;
+
+/*! \brief Batched submission state. */
+typedef struct {
+	/*!< Connection to the server shared by the batched messages. */
+	net_t		net;
+	/*!< The connection is established. */
+	bool		connected;
+	/*!< Message being filled with the sent updates. */
+	knot_pkt_t	*pkt;
+	/*!< Number of the updates in the message being filled. */
+	size_t		updates;
+	/*!< Messages waiting for the response. */
+	knsupdate_sent_t *sent;
+	/*!< Number of the messages waiting for the response. */
+	size_t		sent_count;
+	/*!< First failure of the batched messages. */
+	int		error;
+} knsupdate_batch_t;
+
 /*! \brief knsupdate-specific params data. */
 typedef struct {
 	/*!< Stop processing - just print help, version,... */
@@ -51,6 +79,10 @@ typedef struct {
 	uint32_t	retries;
 	/*!< Wait for network response in seconds (-1 means forever). */
 	int32_t		wait;
+	/*!< Maximum number of batched messages in flight (0 disables batching). */
+	uint32_t	batch_size;
+	/*!< Batched submission state. */
+	knsupdate_batch_t batch;
 	/*!< Current zone. */
 	char		*zone;
 	/*!< RR parser. */
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -22,15 +22,27 @@
 
 #include "load_queries.h"
 #include <libknot/libknot.h>
+#include "contrib/macros.h"
+#include "contrib/qp-trie/trie.h"
+#include "contrib/wire_ctx.h"
+#ifdef USE_DNSTAP
+#include "contrib/dnstap/convert.h"
+#include "contrib/dnstap/reader.h"
+#endif
 
 #define ERR_PREFIX "failed loading queries "
 
+/*! Longer captured queries are skipped, they wouldn't fit into an XDP frame. */
+#define CAPTURE_QUERY_MAX 1400
+#define PCAP_SNAP_MAX     65536
+
 enum qflags {
 	QFLAG_EDNS = 1,
 	QFLAG_DO = 2,
 };
 
 struct pkt_payload *global_payloads = NULL;
+uint64_t global_payloads_span = 0;
 
 void free_global_payloads()
 {
@@ -42,13 +54,8 @@ void free_global_payloads()
 	}
 }
 
-bool load_queries(const char *filename, uint16_t edns_size, uint16_t msgid)
+static bool load_text(FILE *f, uint16_t edns_size, uint16_t msgid)
 {
-	FILE *f = fopen(filename, "r");
-	if (f == NULL) {
-		printf(ERR_PREFIX "file '%s' (%s)\n", filename, strerror(errno));
-		return false;
-	}
 	struct pkt_payload *g_payloads_top = NULL;
 
 	struct {
@@ -145,12 +152,329 @@ bool load_queries(const char *filename, uint16_t edns_size, uint16_t msgid)
 	}
 
 	free(bufs);
-	fclose(f);
 	return true;
 
 fail:
 	free_global_payloads();
 	free(bufs);
-	fclose(f);
 	return false;
 }
+
+typedef struct {
+	struct pkt_payload *top;
+	trie_t *sources;    // Original client addresses -> source index.
+	uint32_t n_sources;
+	uint64_t first_us;  // Absolute time of the first query.
+	uint64_t last_us;   // Relative time of the last query.
+	size_t count;
+} capture_t;
+
+/*! \brief Adds a captured DNS message if it's a standard query. */
+static bool capture_add(capture_t *cap, const uint8_t *wire, size_t len,
+                        uint64_t time_us, const uint8_t *src, size_t src_len,
+                        uint16_t msgid)
+{
+	if (len < KNOT_WIRE_HEADER_SIZE || len > CAPTURE_QUERY_MAX ||
+	    knot_wire_get_qr(wire) || knot_wire_get_opcode(wire) != KNOT_OPCODE_QUERY ||
+	    knot_wire_get_qdcount(wire) != 1) {
+		return true; // Skipped.
+	}
+
+	struct pkt_payload *pkt = calloc(1, sizeof(struct pkt_payload) + len);
+	if (pkt == NULL) {
+		printf(ERR_PREFIX "(out of memory)\n");
+		return false;
+	}
+	pkt->len = len;
+	memcpy(pkt->payload, wire, len);
+	memcpy(pkt->payload, &msgid, sizeof(msgid));
+
+	// Keep the relative times non-decreasing, the captures may be slightly unordered.
+	if (cap->count == 0) {
+		cap->first_us = time_us;
+	}
+	uint64_t rel = (time_us > cap->first_us) ? time_us - cap->first_us : 0;
+	cap->last_us = MAX(cap->last_us, rel);
+	pkt->time_us = cap->last_us;
+
+	if (src_len > 0) {
+		trie_val_t *val = trie_get_ins(cap->sources, (const trie_key_t *)src, src_len);
+		if (val == NULL) {
+			free(pkt);
+			printf(ERR_PREFIX "(out of memory)\n");
+			return false;
+		}
+		if (*val == NULL) {
+			*val = (void *)(uintptr_t)++cap->n_sources;
+		}
+		pkt->source = (uintptr_t)*val;
+	}
+
+	if (cap->top == NULL) {
+		global_payloads = pkt;
+	} else {
+		cap->top->next = pkt;
+	}
+	cap->top = pkt;
+	cap->count++;
+
+	return true;
+}
+
+/*! \brief Finds the IP header in a captured frame. */
+static bool pcap_link_skip(uint32_t linktype, wire_ctx_t *w)
+{
+	uint16_t proto;
+	switch (linktype) {
+	case 1: // Ethernet
+		wire_ctx_skip(w, 12);
+		proto = wire_ctx_read_u16(w);
+		while (proto == 0x8100 || proto == 0x88a8) { // VLAN tags
+			wire_ctx_skip(w, 2);
+			proto = wire_ctx_read_u16(w);
+		}
+		break;
+	case 113: // Linux cooked capture
+		wire_ctx_skip(w, 14);
+		proto = wire_ctx_read_u16(w);
+		break;
+	case 276: // Linux cooked capture v2
+		proto = wire_ctx_read_u16(w);
+		wire_ctx_skip(w, 18);
+		break;
+	case 0:   // BSD loopback
+	case 108: // OpenBSD loopback
+		wire_ctx_skip(w, 4);
+		return w->error == KNOT_EOK;
+	case 12:  // Raw IP
+	case 14:
+	case 101:
+		return true;
+	default:
+		return false;
+	}
+
+	return w->error == KNOT_EOK && (proto == 0x0800 || proto == 0x86DD);
+}
+
+/*! \brief Extracts the source address and the UDP payload of an IP packet. */
+static bool pcap_udp(wire_ctx_t *w, const uint8_t **src, size_t *src_len,
+                     const uint8_t **data, size_t *data_len)
+{
+	if (wire_ctx_available(w) < 1) {
+		return false;
+	}
+
+	size_t ip_len;
+	uint8_t version = *w->position >> 4;
+	if (version == 4) {
+		const uint8_t *ip = w->position;
+		size_t hdr_len = (ip[0] & 0x0F) * 4;
+		wire_ctx_skip(w, 2);
+		ip_len = wire_ctx_read_u16(w);
+		wire_ctx_skip(w, 2);
+		uint16_t frag = wire_ctx_read_u16(w);
+		wire_ctx_skip(w, 1);
+		uint8_t proto = wire_ctx_read_u8(w);
+		if (w->error != KNOT_EOK || hdr_len < 20 || ip_len < hdr_len ||
+		    proto != 17 || (frag & 0x3FFF) != 0) { // UDP, not fragmented
+			return false;
+		}
+		*src = ip + 12;
+		*src_len = 4;
+		wire_ctx_skip(w, hdr_len - 10);
+		ip_len -= hdr_len;
+	} else if (version == 6) {
+		const uint8_t *ip = w->position;
+		wire_ctx_skip(w, 4);
+		ip_len = wire_ctx_read_u16(w);
+		uint8_t next = wire_ctx_read_u8(w);
+		if (w->error != KNOT_EOK || next != 17) { // UDP without extension headers
+			return false;
+		}
+		*src = ip + 8;
+		*src_len = 16;
+		wire_ctx_skip(w, 33);
+	} else {
+		return false;
+	}
+
+	wire_ctx_skip(w, 4);
+	uint16_t udp_len = wire_ctx_read_u16(w);
+	wire_ctx_skip(w, 2);
+	if (w->error != KNOT_EOK || udp_len < 8 || udp_len > ip_len ||
+	    wire_ctx_available(w) < udp_len - 8) {
+		return false;
+	}
+	*data = w->position;
+	*data_len = udp_len - 8;
+
+	return true;
+}
+
+static uint32_t pcap_u32(const void *data, bool swap)
+{
+	uint32_t val;
+	memcpy(&val, data, sizeof(val));
+	return swap ? __builtin_bswap32(val) : val;
+}
+
+static bool load_pcap(FILE *f, capture_t *cap, uint16_t msgid)
+{
+	uint8_t hdr[24];
+	if (fread(hdr, sizeof(hdr), 1, f) != 1) {
+		printf(ERR_PREFIX "(truncated pcap header)\n");
+		return false;
+	}
+
+	uint32_t magic;
+	memcpy(&magic, hdr, sizeof(magic));
+	bool swap = (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1);
+	bool nsecs = (magic == 0xa1b23c4d || magic == 0x4d3cb2a1);
+	uint32_t linktype = pcap_u32(hdr + 20, swap);
+
+	uint8_t *buf = malloc(PCAP_SNAP_MAX);
+	if (buf == NULL) {
+		printf(ERR_PREFIX "(out of memory)\n");
+		return false;
+	}
+
+	bool ret = true;
+	uint32_t rec[4];
+	while (ret && fread(rec, sizeof(rec), 1, f) == 1) {
+		uint32_t caplen = pcap_u32(&rec[2], swap);
+		if (caplen > PCAP_SNAP_MAX) {
+			if (fseek(f, caplen, SEEK_CUR) != 0) {
+				break;
+			}
+			continue;
+		}
+		if (fread(buf, caplen, 1, f) != 1) {
+			break;
+		}
+
+		uint64_t time_us = pcap_u32(&rec[0], swap) * 1000000ULL +
+		                   pcap_u32(&rec[1], swap) / (nsecs ? 1000 : 1);
+
+		const uint8_t *src, *data;
+		size_t src_len, data_len;
+		wire_ctx_t w = wire_ctx_init(buf, caplen);
+		if (pcap_link_skip(linktype, &w) &&
+		    pcap_udp(&w, &src, &src_len, &data, &data_len)) {
+			ret = capture_add(cap, data, data_len, time_us, src, src_len, msgid);
+		}
+	}
+
+	free(buf);
+	return ret;
+}
+
+#ifdef USE_DNSTAP
+static bool load_dnstap(const char *filename, capture_t *cap, uint16_t msgid)
+{
+	dt_reader_t *reader = dt_reader_create(filename);
+	if (reader == NULL) {
+		printf(ERR_PREFIX "(can't open dnstap file)\n");
+		return false;
+	}
+
+	bool ret = true;
+	while (ret) {
+		Dnstap__Dnstap *frame = NULL;
+		int read = dt_reader_read(reader, &frame);
+		if (read == KNOT_EOF) {
+			break;
+		} else if (read != KNOT_EOK) {
+			printf(ERR_PREFIX "(can't read dnstap message)\n");
+			ret = false;
+			break;
+		}
+
+		Dnstap__Message *msg = frame->message;
+		if (frame->type == DNSTAP__DNSTAP__TYPE__MESSAGE && msg != NULL &&
+		    msg->has_query_message && dt_message_type_is_query(msg->type)) {
+			uint64_t time_us = 0;
+			if (msg->has_query_time_sec) {
+				time_us = msg->query_time_sec * 1000000ULL;
+				if (msg->has_query_time_nsec) {
+					time_us += msg->query_time_nsec / 1000;
+				}
+			}
+			size_t src_len = msg->has_query_address ? msg->query_address.len : 0;
+			ret = capture_add(cap, msg->query_message.data, msg->query_message.len,
+			                  time_us, msg->query_address.data, src_len, msgid);
+		}
+		dt_reader_free_frame(reader, &frame);
+	}
+
+	dt_reader_free(reader);
+	return ret;
+}
+#endif
+
+static bool load_capture(FILE *f, const char *filename, bool pcap, uint16_t msgid)
+{
+	capture_t cap = { .sources = trie_create(NULL) };
+	if (cap.sources == NULL) {
+		printf(ERR_PREFIX "(out of memory)\n");
+		return false;
+	}
+
+	bool ret;
+	if (pcap) {
+		ret = load_pcap(f, &cap, msgid);
+	} else {
+#ifdef USE_DNSTAP
+		ret = load_dnstap(filename, &cap, msgid);
+#else
+		printf(ERR_PREFIX "(dnstap support not available)\n");
+		ret = false;
+#endif
+	}
+	trie_free(cap.sources);
+
+	if (ret && global_payloads == NULL) {
+		printf(ERR_PREFIX "(no queries in capture)\n");
+		ret = false;
+	}
+	if (!ret) {
+		free_global_payloads();
+		global_payloads = NULL;
+		return false;
+	}
+
+	// The replay continues after the last query with the average spacing.
+	global_payloads_span = cap.last_us + MAX(1, cap.last_us / MAX(1, cap.count - 1));
+	printf("loaded %zu queries from %u clients, captured over %.3f s\n",
+	       cap.count, cap.n_sources, cap.last_us / 1000000.0);
+
+	return true;
+}
+
+bool load_queries(const char *filename, uint16_t edns_size, uint16_t msgid)
+{
+	FILE *f = fopen(filename, "r");
+	if (f == NULL) {
+		printf(ERR_PREFIX "file '%s' (%s)\n", filename, strerror(errno));
+		return false;
+	}
+
+	// Distinguish a pcap file, a dnstap (Frame Streams) file, and a text file.
+	uint32_t magic = 1;
+	size_t magic_len = fread(&magic, 1, sizeof(magic), f);
+	rewind(f);
+
+	bool ret;
+	if (magic_len == sizeof(magic) &&
+	    (magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 ||
+	     magic == 0xa1b23c4d || magic == 0x4d3cb2a1)) {
+		ret = load_capture(f, filename, true, msgid);
+	} else if (magic_len == sizeof(magic) && magic == 0) {
+		ret = load_capture(f, filename, false, msgid);
+	} else {
+		ret = load_text(f, edns_size, msgid);
+	}
+
+	fclose(f);
+	return ret;
+}
@@ -1,4 +1,4 @@
-/*  Copyright (C) 2021 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -22,11 +22,20 @@
 struct pkt_payload {
 	struct pkt_payload *next;
 	size_t len;
+	uint64_t time_us; // Send time relative to the first query (captures only).
+	uint32_t source;  // Index of the original client (captures only, 0 if unknown).
 	uint8_t payload[];
 };
 
 extern struct pkt_payload *global_payloads;
 
+/*! Duration of one pass over the captured queries in usecs (0 if not captured). */
+extern uint64_t global_payloads_span;
+
+/*!
+ * Load the query templates from a text file, or the queries from a pcap
+ * or a dnstap capture (detected automatically).
+ */
 bool load_queries(const char *filename, uint16_t edns_size, uint16_t msgid);
 
 void free_global_payloads(void);
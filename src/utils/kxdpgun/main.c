@@ -19,6 +19,7 @@
 #include <getopt.h>
 #include <ifaddrs.h>
 #include <inttypes.h>
+#include <math.h>
 #include <poll.h>
 #include <pthread.h>
 #include <signal.h>
@@ -72,6 +73,21 @@ unsigned global_cpu_aff_step = 1;
 
 #define RCODE_MAX (0x0F + 1)
 
+/*! Time (usecs) before the next scheduled query to stop sleeping and keep polling. */
+#define SLEEP_SLACK 50
+
+/*! Latency histogram: exact below 2^LAT_SUB_BITS usecs, then 2^LAT_SUB_BITS
+ *  sub-buckets per power of two (relative error up to ~3 %). */
+#define LAT_SUB_BITS 5
+#define LAT_SUB_COUNT (1 << LAT_SUB_BITS)
+#define LAT_MAX_BITS 32
+#define LAT_BUCKETS ((LAT_MAX_BITS - LAT_SUB_BITS + 1) * LAT_SUB_COUNT)
+
+typedef struct {
+	uint64_t count;
+	uint64_t buckets[LAT_BUCKETS];
+} latency_hist_t;
+
 typedef struct {
 	size_t collected;
 	uint64_t duration;
@@ -83,14 +99,32 @@ typedef struct {
 	uint64_t size_recv;
 	uint64_t wire_recv;
 	uint64_t rcodes_recv[RCODE_MAX];
+	latency_hist_t latency;
+	latency_hist_t send_lag;
 	pthread_mutex_t mutex;
 } kxdpgun_stats_t;
 
 static kxdpgun_stats_t global_stats = { 0 };
 
+/*! Latencies of the last second collected from all threads. */
+static struct {
+	uint64_t second;
+	size_t collected;
+	uint64_t qry_sent;
+	uint64_t ans_recv;
+	latency_hist_t latency;
+	pthread_mutex_t mutex;
+} global_period = { 0 };
+
+/*! Intended send times (CLOCK_MONOTONIC nsecs) of the pending queries by the source port.
+ *  Shared by all threads as the responses can be received by any of them. */
+static uint64_t tx_stamps[LOCAL_PORT_MAX + 1];
+
 typedef struct {
 	char		dev[IFNAMSIZ];
 	uint64_t	qps, duration;
+	uint64_t	qps_end; // 0 for a constant rate
+	unsigned	steps;   // 0 for a linear ramp to qps_end
 	unsigned	at_once;
 	uint16_t	msgid;
 	uint16_t	edns_size;
@@ -101,6 +135,8 @@ typedef struct {
 	bool		tcp;
 	uint16_t	target_port;
 	uint32_t	listen_port; // KNOT_XDP_LISTEN_PORT_*
+	bool		latency_period;
+	bool		replay;
 	unsigned	n_threads, thread_id;
 } xdp_gun_ctx_t;
 
@@ -141,9 +177,88 @@ static void clear_stats(kxdpgun_stats_t *st)
 	st->wire_recv   = 0;
 	st->collected   = 0;
 	memset(st->rcodes_recv, 0, sizeof(st->rcodes_recv));
+	memset(&st->latency, 0, sizeof(st->latency));
+	memset(&st->send_lag, 0, sizeof(st->send_lag));
 	pthread_mutex_unlock(&st->mutex);
 }
 
+static unsigned latency_bucket(uint64_t usecs)
+{
+	if (usecs < LAT_SUB_COUNT) {
+		return usecs;
+	}
+	usecs = MIN(usecs, (1ULL << LAT_MAX_BITS) - 1);
+
+	unsigned exp = 63 - __builtin_clzll(usecs);
+	unsigned sub = (usecs >> (exp - LAT_SUB_BITS)) & (LAT_SUB_COUNT - 1);
+	return ((exp - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + sub;
+}
+
+static uint64_t latency_bucket_value(unsigned bucket)
+{
+	if (bucket < LAT_SUB_COUNT) {
+		return bucket;
+	}
+
+	unsigned exp = (bucket >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+	uint64_t sub = bucket & (LAT_SUB_COUNT - 1);
+	return (LAT_SUB_COUNT + sub) << (exp - LAT_SUB_BITS);
+}
+
+inline static void latency_add(latency_hist_t *hist, uint64_t usecs)
+{
+	hist->buckets[latency_bucket(usecs)]++;
+	hist->count++;
+}
+
+static void latency_merge(latency_hist_t *into, const latency_hist_t *what)
+{
+	for (unsigned i = 0; i < LAT_BUCKETS; i++) {
+		into->buckets[i] += what->buckets[i];
+	}
+	into->count += what->count;
+}
+
+/*! \brief Returns the latency in usecs not exceeded by the given permille of replies. */
+static uint64_t latency_quantile(const latency_hist_t *hist, unsigned permille)
+{
+	uint64_t rank = (hist->count * permille + 999) / 1000, sum = 0;
+	for (unsigned i = 0; i < LAT_BUCKETS; i++) {
+		sum += hist->buckets[i];
+		if (sum >= rank && sum > 0) {
+			return latency_bucket_value(i);
+		}
+	}
+	return 0;
+}
+
+static void print_latency(const char *prefix, const latency_hist_t *hist)
+{
+	printf("%sp50 %.3f ms, p99 %.3f ms, p999 %.3f ms\n", prefix,
+	       latency_quantile(hist, 500) / 1000.0,
+	       latency_quantile(hist, 990) / 1000.0,
+	       latency_quantile(hist, 999) / 1000.0);
+}
+
+static void collect_period(const xdp_gun_ctx_t *ctx, uint64_t second, uint64_t qry_sent,
+                           uint64_t ans_recv, const latency_hist_t *latency)
+{
+	pthread_mutex_lock(&global_period.mutex);
+	global_period.qry_sent += qry_sent;
+	global_period.ans_recv += ans_recv;
+	latency_merge(&global_period.latency, latency);
+	if (++global_period.collected == ctx->n_threads) {
+		printf("[%"PRIu64" s] queries %"PRIu64", replies %"PRIu64", latency ",
+		       second, global_period.qry_sent, global_period.ans_recv);
+		print_latency("", &global_period.latency);
+		global_period.collected = 0;
+		global_period.qry_sent = 0;
+		global_period.ans_recv = 0;
+		memset(&global_period.latency, 0, sizeof(global_period.latency));
+	}
+	pthread_mutex_unlock(&global_period.mutex);
+}
+
 static size_t collect_stats(kxdpgun_stats_t *into, const kxdpgun_stats_t *what)
 {
 	pthread_mutex_lock(&into->mutex);
@@ -158,6 +273,8 @@ static size_t collect_stats(kxdpgun_stats_t *into, const kxdpgun_stats_t *what)
 	for (int i = 0; i < RCODE_MAX; i++) {
 		into->rcodes_recv[i] += what->rcodes_recv[i];
 	}
+	latency_merge(&into->latency, &what->latency);
+	latency_merge(&into->send_lag, &what->send_lag);
 	size_t res = ++into->collected;
 	pthread_mutex_unlock(&into->mutex);
 	return res;
@@ -172,6 +289,9 @@ static void print_stats(kxdpgun_stats_t *st, bool tcp, bool recv)
 
 	printf("total %s     %"PRIu64" (%"PRIu64" pps)\n",
 	       tcp ? "SYN:    " : "queries:", st->qry_sent, ps(st->qry_sent));
+	if (st->send_lag.count > 0) {
+		print_latency("send lag behind schedule: ", &st->send_lag);
+	}
 	if (st->qry_sent > 0 && recv) {
 		if (tcp) {
 		printf("total established: %"PRIu64" (%"PRIu64" pps) (%"PRIu64"%%)\n",
@@ -189,6 +309,9 @@ static void print_stats(kxdpgun_stats_t *st, bool tcp, bool recv)
 		       st->ans_recv > 0 ? st->size_recv / st->ans_recv : 0);
 		printf("average Ethernet reply rate: %"PRIu64" bps (%.2f Mbps)\n",
 		       ps(st->wire_recv * 8), ps((float)st->wire_recv * 8 / (1000 * 1000)));
+		if (st->latency.count > 0) {
+			print_latency("response latency: ", &st->latency);
+		}
 
 		for (int i = 0; i < RCODE_MAX; i++) {
 			if (st->rcodes_recv[i] > 0) {
@@ -210,6 +333,13 @@ inline static void timer_start(struct timespec *timesp)
 	clock_gettime(CLOCK_MONOTONIC, timesp);
 }
 
+inline static uint64_t time_nsecs(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * (uint64_t)1000000000 + now.tv_nsec;
+}
+
 inline static uint64_t timer_end(struct timespec *timesp)
 {
 	struct timespec end;
@@ -282,8 +412,85 @@ static void put_dns_payload(struct iovec *put_into, bool zero_copy, xdp_gun_ctx_
 	next_payload(payl, ctx->n_threads);
 }
 
+static uint64_t local_ip_count(xdp_gun_ctx_t *ctx)
+{
+	unsigned bits = addr_bits(ctx->ipv6) - ctx->local_ip_range;
+	return bits < 64 ? (1ULL << bits) : UINT64_MAX;
+}
+
+/*!
+ * \brief Returns the intended send time (nsecs since the start) of the k-th query
+ *        of the thread according to the rate profile.
+ *
+ * The rate changes from qps to qps_end over the duration either linearly
+ * or in equal steps. The time is the inverse of the cumulative query count.
+ */
+static uint64_t profile_time(const xdp_gun_ctx_t *ctx, uint64_t k)
+{
+	double r0 = ctx->qps, r1 = ctx->qps_end, span = ctx->duration / 1e6, t;
+	if (ctx->qps_end == 0) {
+		t = k / r0;
+	} else if (ctx->steps == 0) {
+		// Root of r0 * t + (r1 - r0) * t^2 / (2 * span) = k, stable for r1 ~ r0.
+		double disc = r0 * r0 + 2.0 * (r1 - r0) * k / span;
+		if (disc < 0) {
+			return UINT64_MAX; // Not reached by a decreasing rate.
+		}
+		t = 2.0 * k / (r0 + sqrt(disc));
+	} else {
+		double step_span = span / ctx->steps, left = k;
+		t = 0;
+		for (unsigned i = 0; i < ctx->steps; i++) {
+			double rate = r0 + (r1 - r0) * i / MAX(ctx->steps - 1, 1);
+			if (left < rate * step_span || i + 1 == ctx->steps) {
+				t += left / rate;
+				break;
+			}
+			left -= rate * step_span;
+			t += step_span;
+		}
+	}
+	return MIN(t * 1e9, (double)(UINT64_MAX >> 1));
+}
+
+/*! \brief Counts the queries to be sent by now (at most the batch size). */
+static unsigned profile_due(xdp_gun_ctx_t *ctx, uint64_t sent, uint64_t now)
+{
+	unsigned count = 0;
+	while (count < ctx->at_once && profile_time(ctx, sent + count) <= now) {
+		count++;
+	}
+	return count;
+}
+
+/*! \brief Moves to the next payload of the thread, the replay time continues over the wrap. */
+static void next_replay_payload(struct pkt_payload **payload, int increment,
+                                uint64_t *replay_base)
+{
+	for (int i = 0; i < increment; i++) {
+		if ((*payload)->next == NULL) {
+			*payload = global_payloads;
+			*replay_base += global_payloads_span;
+		} else {
+			*payload = (*payload)->next;
+		}
+	}
+}
+
+/*! \brief Counts the captured queries to be sent by now (at most the batch size). */
+static unsigned replay_due(xdp_gun_ctx_t *ctx, struct pkt_payload *payload,
+                           uint64_t replay_base, uint64_t now)
+{
+	unsigned count = 0;
+	while (count < ctx->at_once && replay_base + payload->time_us <= now) {
+		next_replay_payload(&payload, ctx->n_threads, &replay_base);
+		count++;
+	}
+	return count;
+}
+
 static int alloc_pkts(knot_xdp_msg_t *pkts, struct knot_xdp_socket *xsk,
-                      xdp_gun_ctx_t *ctx, uint64_t tick)
+                      xdp_gun_ctx_t *ctx, uint64_t tick, unsigned count)
 {
 	uint64_t unique = (tick * ctx->n_threads + ctx->thread_id) * ctx->at_once;
 
@@ -292,7 +499,7 @@ static int alloc_pkts(knot_xdp_msg_t *pkts, struct knot_xdp_socket *xsk,
 		flags |= (KNOT_XDP_MSG_TCP | KNOT_XDP_MSG_SYN | KNOT_XDP_MSG_MSS);
 	}
 
-	for (int i = 0; i < ctx->at_once; i++) {
+	for (int i = 0; i < count; i++) {
 		int ret = knot_xdp_send_alloc(xsk, flags, &pkts[i]);
 		if (ret != KNOT_EOK) {
 			return i;
@@ -308,11 +515,17 @@ static int alloc_pkts(knot_xdp_msg_t *pkts, struct knot_xdp_socket *xsk,
 
 		unique++;
 	}
-	return ctx->at_once;
+	return count;
+}
+
+inline static void stamp_query(const struct sockaddr_in6 *local, uint64_t now)
+{
+	__atomic_store_n(&tx_stamps[ntohs(local->sin6_port)], now, __ATOMIC_RELAXED);
 }
 
 inline static bool check_dns_payload(struct iovec *payl, xdp_gun_ctx_t *ctx,
-                                     kxdpgun_stats_t *st)
+                                     kxdpgun_stats_t *st, latency_hist_t *period,
+                                     const struct sockaddr_in6 *local, uint64_t now)
 {
 	if (payl->iov_len < KNOT_WIRE_HEADER_SIZE ||
 	    memcmp(payl->iov_base, &ctx->msgid, sizeof(ctx->msgid)) != 0) {
@@ -321,6 +534,15 @@ inline static bool check_dns_payload(struct iovec *payl, xdp_gun_ctx_t *ctx,
 	st->rcodes_recv[((uint8_t *)payl->iov_base)[3] & 0x0F]++;
 	st->size_recv += payl->iov_len;
 	st->ans_recv++;
+
+	// A reused source port overwrites the stamp, duplicates aren't counted.
+	uint64_t sent = __atomic_exchange_n(&tx_stamps[ntohs(local->sin6_port)], 0,
+	                                    __ATOMIC_RELAXED);
+	if (sent > 0 && sent <= now) {
+		uint64_t usecs = (now - sent) / 1000;
+		latency_add(&st->latency, usecs);
+		latency_add(period, usecs);
+	}
 	return true;
 }
 
@@ -332,11 +554,13 @@ void *xdp_gun_thread(void *_ctx)
 	knot_xdp_msg_t pkts[ctx->at_once];
 	uint64_t errors = 0, lost = 0, duration = 0;
 	kxdpgun_stats_t local_stats = { 0 };
+	latency_hist_t period_latency = { 0 };
+	uint64_t period_second = 1, period_qry_sent = 0, period_ans_recv = 0;
 	unsigned stats_triggered = 0;
 	knot_tcp_table_t *tcp_table = NULL;
 
 	if (ctx->tcp) {
-		tcp_table = knot_tcp_table_new(ctx->qps);
+		tcp_table = knot_tcp_table_new(MAX(ctx->qps, ctx->qps_end));
 		if (tcp_table == NULL) {
 			printf("failed to allocate TCP connection table\n");
 			return NULL;
@@ -345,7 +569,7 @@ void *xdp_gun_thread(void *_ctx)
 
 	knot_xdp_load_bpf_t mode = (ctx->thread_id == 0 ?
 	                            KNOT_XDP_LOAD_BPF_ALWAYS : KNOT_XDP_LOAD_BPF_NEVER);
-	int ret = knot_xdp_init(&xsk, ctx->dev, ctx->thread_id, ctx->listen_port, mode);
+	int ret = knot_xdp_init(&xsk, ctx->dev, ctx->thread_id, ctx->listen_port, mode, NULL);
 	if (ret != KNOT_EOK) {
 		printf("failed to initialize XDP socket#%u: %s\n",
 		       ctx->thread_id, knot_strerror(ret));
@@ -359,34 +583,59 @@ void *xdp_gun_thread(void *_ctx)
 		usleep(1000);
 	}
 
-	uint64_t tick = 0;
+	uint64_t tick = 0, replay_base = 0;
 	struct pkt_payload *payload_ptr = NULL;
 	next_payload(&payload_ptr, ctx->thread_id);
+	uint64_t local_ips = local_ip_count(ctx);
 
 	timer_start(&timer);
+	uint64_t start = time_nsecs();
 
 	while (duration < ctx->duration + 1000000) {
 
-		// sending part
-		if (duration < ctx->duration) {
+		// sending part, the schedule doesn't wait for the replies (open loop)
+		unsigned batch;
+		if (ctx->replay) {
+			batch = replay_due(ctx, payload_ptr, replay_base, duration);
+		} else {
+			batch = profile_due(ctx, local_stats.qry_sent, time_nsecs() - start);
+		}
+		if (duration < ctx->duration && batch > 0) {
 			while (1) {
 				knot_xdp_send_prepare(xsk);
-				int alloced = alloc_pkts(pkts, xsk, ctx, tick);
-				if (alloced < ctx->at_once) {
+				int alloced = alloc_pkts(pkts, xsk, ctx, tick, batch);
+				if (alloced < batch) {
 					lost++;
 					if (alloced == 0) {
 						break;
 					}
 				}
 
-				if (ctx->tcp) {
-					for (int i = 0; i < alloced; i++) {
+				uint64_t now = time_nsecs();
+				for (int i = 0; i < alloced; i++) {
+					// Queries delayed by the sender still count from their intended time.
+					uint64_t due = start + (ctx->replay ?
+					               (replay_base + payload_ptr->time_us) * 1000 :
+					               profile_time(ctx, local_stats.qry_sent + i));
+					latency_add(&local_stats.send_lag, (now - MIN(due, now)) / 1000);
+
+					if (ctx->tcp) {
 						pkts[i].payload.iov_len = 0;
-					}
-				} else {
-					for (int i = 0; i < alloced; i++) {
+					} else {
+						// The queries of one captured client share the source address.
+						uint32_t source = payload_ptr->source;
+						if (source > 0) {
+							shuffle_sockaddr(&pkts[i].ip_from, &ctx->local_ip,
+							                 be16toh(pkts[i].ip_from.sin6_port),
+							                 (source - 1) % local_ips);
+						}
+						if (ctx->replay) {
+							struct pkt_payload *next = payload_ptr;
+							next_replay_payload(&next, ctx->n_threads, &replay_base);
+						}
 						put_dns_payload(&pkts[i].payload, false,
 						                ctx, &payload_ptr);
+						stamp_query(&pkts[i].ip_from, due);
 					}
 				}
 
@@ -418,6 +667,7 @@ void *xdp_gun_thread(void *_ctx)
 				if (recvd == 0) {
 					break;
 				}
+				uint64_t now = time_nsecs();
 				if (ctx->tcp) {
 					uint32_t ack_errors = 0;
 					knot_tcp_relay_dynarray_t relays = { 0 };
@@ -438,6 +688,7 @@ void *xdp_gun_thread(void *_ctx)
 							local_stats.synack_recv++;
 							rl->answer = XDP_TCP_ANSWER | XDP_TCP_DATA;
 							put_dns_payload(&payl, true, ctx, &payload_ptr);
+							stamp_query(&rl->msg->ip_to, now);
 							ret = knot_tcp_relay_answer(&relays, rl, payl.iov_base,
 							                            payl.iov_len);
 							if (ret != KNOT_EOK) {
@@ -445,7 +696,9 @@ void *xdp_gun_thread(void *_ctx)
 							}
 							break;
 						case XDP_TCP_DATA:
-							if (check_dns_payload(&rl->data, ctx, &local_stats)) {
+							if (check_dns_payload(&rl->data, ctx, &local_stats,
+							                      &period_latency, &rl->msg->ip_to,
+							                      now)) {
 								rl->answer = XDP_TCP_ANSWER | XDP_TCP_CLOSE;
 							}
 							break;
@@ -471,7 +724,8 @@ void *xdp_gun_thread(void *_ctx)
 				} else {
 					for (int i = 0; i < recvd; i++) {
 						(void)check_dns_payload(&pkts[i].payload, ctx,
-						                        &local_stats);
+						                        &local_stats, &period_latency,
+						                        &pkts[i].ip_to, now);
 					}
 				}
 				local_stats.wire_recv += wire;
@@ -481,11 +735,23 @@ void *xdp_gun_thread(void *_ctx)
 		}
 
 		// speed and signal part
-		uint64_t dura_exp = (local_stats.qry_sent * 1000000) / ctx->qps;
+		uint64_t dura_exp = profile_time(ctx, local_stats.qry_sent) / 1000;
 		duration = timer_end(&timer);
+		if (ctx->replay) {
+			// Wake up for the responses at least every millisecond.
+			dura_exp = MIN(replay_base + payload_ptr->time_us, duration + 1000);
+		}
 		if (xdp_trigger == KXDPGUN_STOP && ctx->duration > duration) {
 			ctx->duration = duration;
 		}
+		if (ctx->latency_period && duration >= period_second * 1000000) {
+			collect_period(ctx, period_second, local_stats.qry_sent - period_qry_sent,
+			               local_stats.ans_recv - period_ans_recv, &period_latency);
+			memset(&period_latency, 0, sizeof(period_latency));
+			period_qry_sent = local_stats.qry_sent;
+			period_ans_recv = local_stats.ans_recv;
+			period_second++;
+		}
 		if (stats_trigger > stats_triggered) {
 			assert(stats_trigger == stats_triggered + 1);
 			stats_triggered++;
@@ -499,8 +765,9 @@ void *xdp_gun_thread(void *_ctx)
 				clear_stats(&global_stats);
 			}
 		}
-		if (dura_exp > duration) {
-			usleep(dura_exp - duration);
+		// usleep() oversleeps, the rest until the next query is spent polling.
+		if (dura_exp > duration + SLEEP_SLACK) {
+			usleep(dura_exp - duration - SLEEP_SLACK);
 		}
 		if (duration > ctx->duration) {
 			usleep(1000);
@@ -636,14 +903,18 @@ static void print_help(void)
 	       " -T, --tcp                "SPACE"Send queries over TCP.\n"
 	       " -Q, --qps <qps>          "SPACE"Number of queries-per-second (approximately) to be sent.\n"
 	       "                          "SPACE" (default is %"PRIu64" qps)\n"
+	       " -E, --ramp <qps>         "SPACE"Change the rate linearly from --qps to <qps> over the duration.\n"
+	       " -s, --steps <count>      "SPACE"Change the rate of --ramp in equal steps instead.\n"
 	       " -b, --batch <size>       "SPACE"Send queries in a batch of defined size.\n"
 	       "                          "SPACE" (default is %d for UDP, %d for TCP)\n"
 	       " -r, --drop               "SPACE"Drop incoming responses (disables response statistics).\n"
+	       " -L, --latency            "SPACE"Print the response latency percentiles every second.\n"
+	       " -R, --replay             "SPACE"Replay the captured queries with their original timing.\n"
 	       " -p, --port <port>        "SPACE"Remote destination port.\n"
 	       "                          "SPACE" (default is %d)\n"
 	       " -F, --affinity <spec>    "SPACE"CPU affinity in the format [<cpu_start>][s<cpu_step>].\n"
 	       "                          "SPACE" (default is %s)\n"
-	       " -i, --infile <file>      "SPACE"Path to a file with query templates.\n"
+	       " -i, --infile <file>      "SPACE"Path to a file with query templates, or a pcap or dnstap capture.\n"
 	       " -I, --interface <ifname> "SPACE"Override auto-detected interface for outgoing communication.\n"
 	       " -l, --local <ip[/prefix]>"SPACE"Override auto-detected source IP address or subnet.\n"
 	       " -h, --help               "SPACE"Print the program help.\n"
@@ -662,8 +933,12 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 		{ "version",   no_argument,       NULL, 'V' },
 		{ "duration",  required_argument, NULL, 't' },
 		{ "qps",       required_argument, NULL, 'Q' },
+		{ "ramp",      required_argument, NULL, 'E' },
+		{ "steps",     required_argument, NULL, 's' },
 		{ "batch",     required_argument, NULL, 'b' },
 		{ "drop",      no_argument,       NULL, 'r' },
+		{ "latency",   no_argument,       NULL, 'L' },
+		{ "replay",    no_argument,       NULL, 'R' },
 		{ "port",      required_argument, NULL, 'p' },
 		{ "tcp",       no_argument,       NULL, 'T' },
 		{ "affinity",  required_argument, NULL, 'F' },
@@ -677,7 +952,7 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 	bool default_at_once = true;
 	double argf;
 	char *argcp, *local_ip = NULL;
-	while ((opt = getopt_long(argc, argv, "hVt:Q:b:rp:TF:I:l:i:", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "hVt:Q:E:s:b:rLRp:TF:I:l:i:", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'h':
 			print_help();
@@ -704,6 +979,22 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 				return false;
 			}
 			break;
+		case 'E':
+			arg = atoi(optarg);
+			if (arg > 0) {
+				ctx->qps_end = arg;
+			} else {
+				return false;
+			}
+			break;
+		case 's':
+			arg = atoi(optarg);
+			if (arg > 1) {
+				ctx->steps = arg;
+			} else {
+				return false;
+			}
+			break;
 		case 'b':
 			arg = atoi(optarg);
 			if (arg > 0) {
@@ -716,6 +1007,12 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 		case 'r':
 			ctx->listen_port |= KNOT_XDP_LISTEN_PORT_DROP;
 			break;
+		case 'L':
+			ctx->latency_period = true;
+			break;
+		case 'R':
+			ctx->replay = true;
+			break;
 		case 'p':
 			arg = atoi(optarg);
 			if (arg > 0 && arg <= 0xffff) {
@@ -755,16 +1052,35 @@ static bool get_opts(int argc, char *argv[], xdp_gun_ctx_t *ctx)
 			return false;
 		}
 	}
+	if (ctx->listen_port & KNOT_XDP_LISTEN_PORT_DROP) {
+		ctx->latency_period = false; // No responses to measure.
+	}
 	if (global_payloads == NULL || argc - optind != 1 ||
 	    !configure_target(argv[optind], local_ip, ctx)) {
 		return false;
 	}
 
-	if (ctx->qps < ctx->n_threads) {
+	if (ctx->replay && (global_payloads_span == 0 || ctx->tcp)) {
+		printf("replay requires a pcap or dnstap capture and UDP\n");
+		return false;
+	}
+
+	if (ctx->steps > 0 && ctx->qps_end == 0) {
+		printf("steps require a ramp\n");
+		return false;
+	}
+	if (ctx->replay && ctx->qps_end > 0) {
+		printf("replay can't be combined with a ramp\n");
+		return false;
+	}
+
+	if (ctx->qps < ctx->n_threads ||
+	    (ctx->qps_end > 0 && ctx->qps_end < ctx->n_threads)) {
 		printf("QPS must be at least the number of threads (%u)\n", ctx->n_threads);
 		return false;
 	}
 	ctx->qps /= ctx->n_threads;
+	ctx->qps_end /= ctx->n_threads;
 	printf("using interface %s, XDP threads %u\n", ctx->dev, ctx->n_threads);
 
 	return true;
@@ -809,6 +1125,7 @@ int main(int argc, char *argv[])
 	}
 
 	pthread_mutex_init(&global_stats.mutex, NULL);
+	pthread_mutex_init(&global_period.mutex, NULL);
 
 	struct sigaction stop_action = { .sa_handler = sigterm_handler };
 	struct sigaction stats_action = { .sa_handler = sigusr_handler };
@@ -840,6 +1157,7 @@ int main(int argc, char *argv[])
 		print_stats(&global_stats, ctx.tcp, !(ctx.listen_port & KNOT_XDP_LISTEN_PORT_DROP));
 	}
 	pthread_mutex_destroy(&global_stats.mutex);
+	pthread_mutex_destroy(&global_period.mutex);
 
 	free(thread_ctxs);
 	free(threads);
@@ -18,6 +18,7 @@
 #include <libgen.h>
 #include <stdio.h>
 
+#include "contrib/strtonum.h"
 #include "contrib/time.h"
 #include "contrib/tolower.h"
 #include "libknot/libknot.h"
@@ -41,6 +42,9 @@ static void print_help(void)
 	       " -d, --dnssec <on|off>       Also check DNSSEC-related records.\n"
 	       " -t, --time <timestamp>      Current time specification.\n"
 	       "                              (default current UNIX time)\n"
+	       " -j, --jobs <num>            Number of threads for loading and checking.\n"
+	       "                              (default 1)\n"
+	       " -i, --incremental <dir>     Database of already validated signatures.\n"
 	       " -v, --verbose               Enable debug output.\n"
 	       " -h, --help                  Print the program help.\n"
 	       " -V, --version               Print the program version.\n"
@@ -68,15 +72,19 @@ int main(int argc, char *argv[])
 	bool verbose = false;
 	semcheck_optional_t optional = SEMCHECK_AUTO_DNSSEC; // default value for --dnssec
 	knot_time_t check_time = (knot_time_t)time(NULL);
+	uint32_t jobs = 1;
+	const char *cache_dir = NULL;
 
 	/* Long options. */
 	struct option opts[] = {
-		{ "origin",  required_argument, NULL, 'o' },
-		{ "time",    required_argument, NULL, 't' },
-		{ "dnssec",  required_argument, NULL, 'd' },
-		{ "verbose", no_argument,       NULL, 'v' },
-		{ "help",    no_argument,       NULL, 'h' },
-		{ "version", no_argument,       NULL, 'V' },
+		{ "origin",      required_argument, NULL, 'o' },
+		{ "time",        required_argument, NULL, 't' },
+		{ "dnssec",      required_argument, NULL, 'd' },
+		{ "jobs",        required_argument, NULL, 'j' },
+		{ "incremental", required_argument, NULL, 'i' },
+		{ "verbose",     no_argument,       NULL, 'v' },
+		{ "help",        no_argument,       NULL, 'h' },
+		{ "version",     no_argument,       NULL, 'V' },
 		{ NULL }
 	};
 
@@ -85,7 +93,7 @@ int main(int argc, char *argv[])
 
 	/* Parse command line arguments */
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "o:t:d:vVh", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "o:t:d:j:i:vVh", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'o':
 			origin = optarg;
@@ -109,6 +117,15 @@ int main(int argc, char *argv[])
 				return EXIT_FAILURE;
 			}
 			break;
+		case 'j':
+			if (str_to_u32(optarg, &jobs) != KNOT_EOK || jobs == 0) {
+				fprintf(stderr, "Invalid number of jobs\n");
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'i':
+			cache_dir = optarg;
+			break;
 		default:
 			print_help();
 			return EXIT_FAILURE;
@@ -153,7 +170,8 @@ int main(int argc, char *argv[])
 	knot_dname_t *dname = knot_dname_from_str_alloc(zonename);
 	knot_dname_to_lower(dname);
 	free(zonename);
-	int ret = zone_check(filename, dname, stdout, optional, (time_t)check_time);
+	int ret = zone_check(filename, dname, stdout, optional, (time_t)check_time, jobs,
+	                     cache_dir);
 	knot_dname_free(dname, NULL);
 
 	log_close();
@@ -17,10 +17,13 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include "knot/journal/knot_lmdb.h"
 #include "knot/zone/contents.h"
 #include "knot/zone/zonefile.h"
 #include "utils/kzonecheck/zone_check.h"
 
+#define CACHE_DB_SIZE	(500 * 1024 * 1024)
+
 typedef struct {
 	sem_handler_t handler;
 	FILE *outfile;
@@ -63,23 +66,49 @@ static void print_statistics(err_handler_stats_t *stats)
 }
 
 int zone_check(const char *zone_file, const knot_dname_t *zone_name,
-               FILE *outfile, semcheck_optional_t optional, time_t time)
+               FILE *outfile, semcheck_optional_t optional, time_t time,
+               unsigned threads, const char *cache_dir)
 {
 	err_handler_stats_t stats = {
 		.handler = { .cb = err_callback },
 		.outfile = outfile
 	};
 
+	knot_lmdb_db_t cache_db = { 0 };
+	if (cache_dir != NULL) {
+		knot_lmdb_init(&cache_db, cache_dir, CACHE_DB_SIZE, 0, "keys_db");
+		stats.handler.valid_cache = valid_cache_load(&cache_db, zone_name);
+		if (stats.handler.valid_cache == NULL) {
+			knot_lmdb_deinit(&cache_db);
+			return KNOT_EFILE;
+		}
+	}
+
 	zloader_t zl;
 	int ret = zonefile_open(&zl, zone_file, zone_name, optional, time);
 	if (ret != KNOT_EOK) {
+		valid_cache_free(stats.handler.valid_cache);
+		knot_lmdb_deinit(&cache_db);
 		return ret;
 	}
 	zl.err_handler = (sem_handler_t *)&stats;
+	zl.threads = threads;
 	zl.creator->master = true;
 
 	zone_contents_t *contents = zonefile_load(&zl);
 	zonefile_close(&zl);
+
+	if (stats.handler.valid_cache != NULL) {
+		// The unused signatures are known only if all the nodes were checked.
+		ret = valid_cache_save(stats.handler.valid_cache, contents != NULL);
+		valid_cache_free(stats.handler.valid_cache);
+		knot_lmdb_deinit(&cache_db);
+		if (ret != KNOT_EOK) {
+			zone_contents_deep_free(contents);
+			return ret;
+		}
+	}
+
 	if (contents == NULL && !stats.handler.error) {
 		return KNOT_ERROR;
 	}
@@ -19,5 +19,12 @@
 #include "knot/zone/semantic-check.h"
 #include "libknot/libknot.h"
 
+/*!
+ * \brief Loads the zone file and runs the semantic checks.
+ *
+ * \param cache_dir  Optional database of the signatures validated by previous
+ *                   runs, only the new signatures are verified.
+ */
 int zone_check(const char *zone_file, const knot_dname_t *zone_name,
-               FILE *outfile, semcheck_optional_t optional, time_t time);
+               FILE *outfile, semcheck_optional_t optional, time_t time,
+               unsigned threads, const char *cache_dir);
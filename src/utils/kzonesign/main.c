@@ -16,16 +16,20 @@
 
 #include <getopt.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "knot/dnssec/zone-events.h"
 #include "knot/updates/zone-update.h"
 #include "knot/server/server.h"
 #include "knot/zone/adjust.h"
+#include "knot/zone/snapshot.h"
 #include "knot/zone/zone-load.h"
 #include "knot/zone/zonefile.h"
 #include "utils/common/msg.h"
 #include "utils/common/params.h"
 #include "utils/common/util_conf.h"
+#include "utils/kzonesign/stream.h"
+#include "contrib/string.h"
 #include "contrib/strtonum.h"
 
 #define PROGRAM_NAME "kzonesign"
@@ -41,6 +45,8 @@ static void print_help(void)
 	       "                           (default %s)\n"
 	       " -o, --outdir <dir_name>  Output directory.\n"
 	       " -r, --rollover           Allow key rollovers and NSEC3 re-salt.\n"
+	       " -s, --stream             Sign a canonically ordered zone file on the fly.\n"
+	       " -S, --snapshot           Write also a binary snapshot of the signed zone.\n"
 	       " -v, --verify             Only verify if zone is signed correctly.\n"
 	       " -t, --time <timestamp>   Current time specification.\n"
 	       "                           (default current UNIX time)\n"
@@ -57,8 +63,72 @@ typedef struct {
 	zone_sign_roll_flags_t rollover;
 	int64_t timestamp;
 	bool verify;
+	bool stream;
+	bool snapshot;
 } sign_params_t;
 
+static char *output_path(const sign_params_t *params, const char *zonefile)
+{
+	if (params->outdir == NULL) {
+		return strdup(zonefile);
+	}
+
+	const char *basename = strrchr(zonefile, '/');
+	return sprintf_alloc("%s/%s", params->outdir,
+	                     (basename != NULL) ? basename + 1 : zonefile);
+}
+
+static int write_snapshot(zone_contents_t *contents, const char *path)
+{
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		return knot_map_errno();
+	}
+
+	char *snap_path = zone_snapshot_path(path);
+	if (snap_path == NULL) {
+		return KNOT_ENOMEM;
+	}
+	int ret = zone_snapshot_write(contents, snap_path, &st);
+	if (ret != KNOT_EOK) {
+		ERR2("failed to write zone snapshot '%s' (%s)\n", snap_path,
+		     knot_strerror(ret));
+	}
+	free(snap_path);
+
+	return ret;
+}
+
+static int zonesign_stream(sign_params_t *params, zone_t *zone,
+                           zone_sign_reschedule_t *next_sign)
+{
+	char *zonefile = conf_zonefile(conf(), params->zone_name);
+	char *output = output_path(params, zonefile);
+	if (zonefile == NULL || output == NULL) {
+		free(zonefile);
+		free(output);
+		return KNOT_ENOMEM;
+	}
+
+	stream_params_t stream = {
+		.input = zonefile,
+		.output = output,
+		.snapshot = params->snapshot,
+		.rollover = params->rollover,
+		.timestamp = params->timestamp,
+	};
+	int ret = zone_sign_stream(conf(), zone, &stream, next_sign);
+	if (ret != KNOT_EOK) {
+		ERR2("failed to sign zone file '%s' (%s)\n", zonefile, knot_strerror(ret));
+	}
+	params->rollover = stream.rollover;
+
+	free(zonefile);
+	free(output);
+
+	return ret;
+}
+
 static int zonesign(sign_params_t *params)
 {
 	char *zonefile = NULL;
@@ -88,6 +158,17 @@ static int zonesign(sign_params_t *params)
 		goto fail;
 	}
 
+	kasp_db_ensure_init(&fake_server.kaspdb, conf());
+	zone_struct->server = &fake_server;
+
+	if (params->stream) {
+		ret = zonesign_stream(params, zone_struct, &next_sign);
+		if (ret != KNOT_EOK) {
+			goto fail;
+		}
+		goto done;
+	}
+
 	ret = zone_load_contents(conf(), params->zone_name, &unsigned_conts, false);
 	if (ret != KNOT_EOK) {
 		ERR2("failed to load zone contents (%s)\n", knot_strerror(ret));
@@ -126,9 +207,6 @@ static int zonesign(sign_params_t *params)
 		goto fail;
 	}
 
-	kasp_db_ensure_init(&fake_server.kaspdb, conf());
-	zone_struct->server = &fake_server;
-
 	ret = knot_dnssec_zone_sign(&up, conf(), 0, params->rollover,
 	                            params->timestamp, &next_sign);
 	if (ret == KNOT_DNSSEC_ENOKEY) { // exception: allow generating initial keys
@@ -144,13 +222,25 @@ static int zonesign(sign_params_t *params)
 
 	if (params->outdir == NULL) {
 		zonefile = conf_zonefile(conf(), params->zone_name);
-		ret = zonefile_write(zonefile, up.new_cont);
+		conf_val_t val = conf_zone_get(conf(), C_ADJUST_THR, params->zone_name);
+		ret = zonefile_write(zonefile, up.new_cont, conf_int(&val));
 	} else {
 		zone_contents_t *temp = zone_struct->contents;
 		zone_struct->contents = up.new_cont;
 		ret = zone_dump_to_dir(conf(), zone_struct, params->outdir);
 		zone_struct->contents = temp;
 	}
+	if (ret == KNOT_EOK && params->snapshot) {
+		char *zonefile_path = conf_zonefile(conf(), params->zone_name);
+		char *output = output_path(params, zonefile_path);
+		ret = (output != NULL) ? write_snapshot(up.new_cont, output) : KNOT_ENOMEM;
+		free(zonefile_path);
+		free(output);
+		if (ret != KNOT_EOK) {
+			zone_update_clear(&up);
+			goto fail;
+		}
+	}
 	zone_update_clear(&up);
 	if (ret != KNOT_EOK) {
 		if (params->outdir == NULL) {
@@ -164,6 +254,7 @@ static int zonesign(sign_params_t *params)
 		goto fail;
 	}
 
+done:
 	printf("Next signing: %"KNOT_TIME_PRINTF"\n", next_sign.next_sign);
 	if (params->rollover) {
 		printf("Next roll-over: %"KNOT_TIME_PRINTF"\n", next_sign.next_rollover);
@@ -194,6 +285,8 @@ int main(int argc, char *argv[])
 		{ "confdb",    required_argument, NULL, 'C' },
 		{ "outdir",    required_argument, NULL, 'o' },
 		{ "rollover",  no_argument,       NULL, 'r' },
+		{ "stream",    no_argument,       NULL, 's' },
+		{ "snapshot",  no_argument,       NULL, 'S' },
 		{ "verify" ,   no_argument,       NULL, 'v' },
 		{ "time",      required_argument, NULL, 't' },
 		{ "help",      no_argument,       NULL, 'h' },
@@ -204,7 +297,7 @@ int main(int argc, char *argv[])
 	tzset();
 
 	int opt = 0;
-	while ((opt = getopt_long(argc, argv, "c:C:o:rvt:hV", opts, NULL)) != -1) {
+	while ((opt = getopt_long(argc, argv, "c:C:o:rsSvt:hV", opts, NULL)) != -1) {
 		switch (opt) {
 		case 'c':
 			if (util_conf_init_file(optarg) != KNOT_EOK) {
@@ -222,6 +315,12 @@ int main(int argc, char *argv[])
 		case 'r':
 			params.rollover = KEY_ROLL_ALLOW_ALL;
 			break;
+		case 's':
+			params.stream = true;
+			break;
+		case 'S':
+			params.snapshot = true;
+			break;
 		case 'v':
 			params.verify = true;
 			break;
@@ -244,6 +343,11 @@ int main(int argc, char *argv[])
 			goto failure;
 		}
 	}
+	if (params.verify && (params.stream || params.snapshot)) {
+		ERR2("verification can't be combined with signing options\n");
+		print_help();
+		goto failure;
+	}
 	if (argc - optind != 1) {
 		ERR2("missing zone name\n");
 		print_help();
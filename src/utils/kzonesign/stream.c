@@ -0,0 +1,1067 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "contrib/files.h"
+#include "contrib/macros.h"
+#include "contrib/wire_ctx.h"
+#include "knot/dnssec/nsec-chain.h"
+#include "knot/dnssec/policy.h"
+#include "knot/dnssec/rrset-sign.h"
+#include "knot/dnssec/sign-pool.h"
+#include "knot/dnssec/zone-keys.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "knot/dnssec/zone-sign.h"
+#include "knot/journal/serialization.h"
+#include "knot/zone/snapshot.h"
+#include "knot/zone/zonefile.h"
+#include "libdnssec/error.h"
+#include "libknot/libknot.h"
+#include "libzscanner/scanner.h"
+#include "utils/common/msg.h"
+#include "utils/kzonesign/stream.h"
+
+#define WINDOW_NODES	4096	// Nodes queued per signing thread.
+#define CHUNK_NODES	64	// Nodes processed by a thread at once.
+#define HASH_MAX	20	// SHA-1 is the only NSEC3 algorithm.
+#define DUMP_SIZE	4096
+
+typedef struct {
+	uint8_t *data;
+	size_t len;
+	size_t size;
+} out_buf_t;
+
+/*! \brief Node queued for signing. */
+typedef struct {
+	zone_node_t *node;
+	knot_dname_t *next; // Next name in the NSEC chain, NULL if not in the chain.
+	bool nsec3;         // The node gets an NSEC3 record.
+} item_t;
+
+/*! \brief Name covered by the NSEC3 chain. */
+typedef struct {
+	uint8_t hash[HASH_MAX];
+	uint16_t bitmap_len;
+	uint64_t bitmap_off;
+} hash_t;
+
+/*! \brief Output of a chunk of the window. */
+typedef struct {
+	out_buf_t text;
+	out_buf_t snap;
+	out_buf_t hashes;  // hash_t entries, offsets into 'bitmaps'.
+	out_buf_t bitmaps;
+	char *dump;
+	size_t dump_size;
+	uint64_t rrsets;
+	int ret;
+} chunk_t;
+
+typedef struct {
+	conf_t *conf;
+	zone_t *zone;
+	stream_params_t *params;
+	zone_sign_reschedule_t *next_sign;
+	const knot_dname_t *apex;
+
+	// Records of the apex until the first other name.
+	zone_contents_t *apex_cont;
+	bool signing;
+
+	kdnssec_ctx_t ctx;
+	zone_keyset_t keyset;
+	zone_sign_ctx_t **sign_ctxs;
+	unsigned threads;
+	bool nsec;
+	dnssec_nsec3_params_t nsec3; // Algorithm 0 if NSEC3 is not used.
+	uint32_t nsec_ttl;
+
+	zone_node_t *node;           // Node being read.
+	knot_dname_storage_t prev;   // Owner of the last finished node.
+	knot_dname_t *cut;           // Current delegation point.
+	knot_dname_storage_t last_nsec3; // Last name covered by NSEC3.
+
+	item_t *items;
+	size_t count;
+	size_t max;
+	size_t window;
+	ssize_t pending;             // Item waiting for its next NSEC name.
+
+	out_buf_t hashes;
+	out_buf_t bitmaps;
+	hash_t *sorted;
+	size_t hash_count;
+
+	chunk_t *chunks;
+	size_t chunk_count;
+	size_t chunk_max;
+	size_t next_chunk;
+
+	FILE *out;
+	char *tmp_name;
+	zone_snapshot_stream_t *snap;
+	uint64_t records;
+	int ret;
+} stream_ctx_t;
+
+static int buf_reserve(out_buf_t *buf, size_t len)
+{
+	if (buf->len + len <= buf->size) {
+		return KNOT_EOK;
+	}
+
+	size_t size = MAX(2 * buf->size, buf->len + len);
+	size = MAX(size, 4096);
+	uint8_t *data = realloc(buf->data, size);
+	if (data == NULL) {
+		return KNOT_ENOMEM;
+	}
+	buf->data = data;
+	buf->size = size;
+
+	return KNOT_EOK;
+}
+
+static int buf_append(out_buf_t *buf, const void *data, size_t len)
+{
+	int ret = buf_reserve(buf, len);
+	if (ret == KNOT_EOK) {
+		memcpy(buf->data + buf->len, data, len);
+		buf->len += len;
+	}
+
+	return ret;
+}
+
+static void buf_free(out_buf_t *buf)
+{
+	free(buf->data);
+	memset(buf, 0, sizeof(*buf));
+}
+
+static int write_rrset(const stream_ctx_t *sc, chunk_t *chunk, const knot_rrset_t *rrset)
+{
+	if (chunk->dump == NULL) {
+		chunk->dump = malloc(DUMP_SIZE);
+		if (chunk->dump == NULL) {
+			return KNOT_ENOMEM;
+		}
+		chunk->dump_size = DUMP_SIZE;
+	}
+
+	int len = knot_rrset_txt_dump(rrset, &chunk->dump, &chunk->dump_size,
+	                              &KNOT_DUMP_STYLE_DEFAULT);
+	if (len < 0) {
+		return len;
+	}
+	int ret = buf_append(&chunk->text, chunk->dump, len);
+	if (ret != KNOT_EOK || !sc->params->snapshot) {
+		return ret;
+	}
+
+	size_t size = rrset_serialized_size(rrset);
+	ret = buf_reserve(&chunk->snap, size);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	wire_ctx_t wire = wire_ctx_init(chunk->snap.data + chunk->snap.len, size);
+	ret = serialize_rrset(&wire, rrset);
+	if (ret == KNOT_EOK) {
+		chunk->snap.len += size;
+		chunk->rrsets++;
+	}
+
+	return ret;
+}
+
+static int sign_rrset(const stream_ctx_t *sc, zone_sign_ctx_t *sign_ctx, chunk_t *chunk,
+                      const knot_rrset_t *rrset)
+{
+	knot_rrset_t rrsigs;
+	knot_rrset_init(&rrsigs, rrset->owner, KNOT_RRTYPE_RRSIG, rrset->rclass, rrset->ttl);
+
+	int ret = knot_sign_rrset2(&rrsigs, rrset, sign_ctx, NULL);
+	if (ret == KNOT_EOK) {
+		ret = write_rrset(sc, chunk, &rrsigs);
+	}
+	knot_rdataset_clear(&rrsigs.rrs, NULL);
+
+	return ret;
+}
+
+static bool node_signed(const zone_node_t *node)
+{
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		if (rrset.type != KNOT_RRTYPE_RRSIG &&
+		    knot_zone_sign_rr_should_be_signed(node, &rrset)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int write_nsec(const stream_ctx_t *sc, zone_sign_ctx_t *sign_ctx, chunk_t *chunk,
+                      const zone_node_t *node, const knot_dname_t *next)
+{
+	dnssec_nsec_bitmap_t *bitmap = dnssec_nsec_bitmap_new();
+	if (bitmap == NULL) {
+		return KNOT_ENOMEM;
+	}
+	bitmap_add_node_rrsets(bitmap, node, false);
+	dnssec_nsec_bitmap_add(bitmap, KNOT_RRTYPE_NSEC);
+	dnssec_nsec_bitmap_add(bitmap, KNOT_RRTYPE_RRSIG);
+
+	size_t next_size = knot_dname_size(next);
+	size_t size = next_size + dnssec_nsec_bitmap_size(bitmap);
+	uint8_t rdata[size];
+	memcpy(rdata, next, next_size);
+	dnssec_nsec_bitmap_write(bitmap, rdata + next_size);
+	dnssec_nsec_bitmap_free(bitmap);
+
+	knot_rrset_t nsec;
+	knot_rrset_init(&nsec, node->owner, KNOT_RRTYPE_NSEC, KNOT_CLASS_IN, sc->nsec_ttl);
+	int ret = knot_rrset_add_rdata(&nsec, rdata, size, NULL);
+	if (ret == KNOT_EOK) {
+		ret = write_rrset(sc, chunk, &nsec);
+	}
+	if (ret == KNOT_EOK) {
+		ret = sign_rrset(sc, sign_ctx, chunk, &nsec);
+	}
+	knot_rdataset_clear(&nsec.rrs, NULL);
+
+	return ret;
+}
+
+static int nsec3_hash(const stream_ctx_t *sc, const knot_dname_t *name, uint8_t *out)
+{
+	dnssec_binary_t data = { .data = (uint8_t *)name, .size = knot_dname_size(name) };
+	dnssec_binary_t hash = { 0 };
+	int ret = dnssec_nsec3_hash(&data, &sc->nsec3, &hash);
+	if (ret != DNSSEC_EOK) {
+		return knot_error_from_libdnssec(ret);
+	}
+	assert(hash.size <= HASH_MAX);
+	memset(out, 0, HASH_MAX);
+	memcpy(out, hash.data, hash.size);
+	dnssec_binary_free(&hash);
+
+	return KNOT_EOK;
+}
+
+static int add_hash(out_buf_t *hashes, out_buf_t *bitmaps, const stream_ctx_t *sc,
+                    const knot_dname_t *name, const dnssec_nsec_bitmap_t *bitmap)
+{
+	hash_t entry = { .bitmap_off = bitmaps->len };
+	int ret = nsec3_hash(sc, name, entry.hash);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	if (bitmap != NULL) {
+		entry.bitmap_len = dnssec_nsec_bitmap_size(bitmap);
+		ret = buf_reserve(bitmaps, entry.bitmap_len);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		dnssec_nsec_bitmap_write(bitmap, bitmaps->data + bitmaps->len);
+		bitmaps->len += entry.bitmap_len;
+	}
+
+	return buf_append(hashes, &entry, sizeof(entry));
+}
+
+static int node_hash(const stream_ctx_t *sc, chunk_t *chunk, const zone_node_t *node)
+{
+	dnssec_nsec_bitmap_t *bitmap = dnssec_nsec_bitmap_new();
+	if (bitmap == NULL) {
+		return KNOT_ENOMEM;
+	}
+	bitmap_add_node_rrsets(bitmap, node, false);
+	if (node_signed(node)) {
+		dnssec_nsec_bitmap_add(bitmap, KNOT_RRTYPE_RRSIG);
+	}
+
+	int ret = add_hash(&chunk->hashes, &chunk->bitmaps, sc, node->owner, bitmap);
+	dnssec_nsec_bitmap_free(bitmap);
+
+	return ret;
+}
+
+static int process_item(const stream_ctx_t *sc, zone_sign_ctx_t *sign_ctx,
+                        chunk_t *chunk, const item_t *item)
+{
+	const zone_node_t *node = item->node;
+	bool apex = knot_dname_is_equal(node->owner, sc->apex);
+
+	int ret = KNOT_EOK;
+	for (uint16_t i = 0; i < node->rrset_count && ret == KNOT_EOK; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		ret = write_rrset(sc, chunk, &rrset);
+		// The apex signatures are already made.
+		if (ret == KNOT_EOK && !apex && rrset.type != KNOT_RRTYPE_RRSIG &&
+		    knot_zone_sign_rr_should_be_signed(node, &rrset)) {
+			ret = sign_rrset(sc, sign_ctx, chunk, &rrset);
+		}
+	}
+	if (ret == KNOT_EOK && item->next != NULL) {
+		ret = write_nsec(sc, sign_ctx, chunk, node, item->next);
+	}
+	if (ret == KNOT_EOK && item->nsec3) {
+		ret = node_hash(sc, chunk, node);
+	}
+
+	return ret;
+}
+
+static int write_nsec3(const stream_ctx_t *sc, zone_sign_ctx_t *sign_ctx, chunk_t *chunk,
+                       const hash_t *entry, const hash_t *next)
+{
+	uint8_t hash_len = dnssec_nsec3_hash_length(sc->nsec3.algorithm);
+	knot_dname_storage_t owner;
+	int ret = knot_nsec3_hash_to_dname(owner, sizeof(owner), entry->hash, hash_len,
+	                                   sc->apex);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	size_t size = 6 + sc->nsec3.salt.size + hash_len + entry->bitmap_len;
+	uint8_t rdata[size];
+	wire_ctx_t wire = wire_ctx_init(rdata, size);
+	wire_ctx_write_u8(&wire, sc->nsec3.algorithm);
+	wire_ctx_write_u8(&wire, sc->nsec3.flags);
+	wire_ctx_write_u16(&wire, sc->nsec3.iterations);
+	wire_ctx_write_u8(&wire, sc->nsec3.salt.size);
+	wire_ctx_write(&wire, sc->nsec3.salt.data, sc->nsec3.salt.size);
+	wire_ctx_write_u8(&wire, hash_len);
+	wire_ctx_write(&wire, next->hash, hash_len);
+	wire_ctx_write(&wire, sc->bitmaps.data + entry->bitmap_off, entry->bitmap_len);
+	assert(wire.error == KNOT_EOK);
+
+	knot_rrset_t nsec3;
+	knot_rrset_init(&nsec3, owner, KNOT_RRTYPE_NSEC3, KNOT_CLASS_IN, sc->nsec_ttl);
+	ret = knot_rrset_add_rdata(&nsec3, rdata, size, NULL);
+	if (ret == KNOT_EOK) {
+		ret = write_rrset(sc, chunk, &nsec3);
+	}
+	if (ret == KNOT_EOK) {
+		ret = sign_rrset(sc, sign_ctx, chunk, &nsec3);
+	}
+	knot_rdataset_clear(&nsec3.rrs, NULL);
+
+	return ret;
+}
+
+typedef struct {
+	stream_ctx_t *sc;
+	size_t first; // Window start (NSEC3 chain only).
+	size_t count; // Window size.
+	bool nsec3;
+} job_t;
+
+static void sign_job(void *ctx, unsigned index)
+{
+	job_t *job = ctx;
+	stream_ctx_t *sc = job->sc;
+	zone_sign_ctx_t *sign_ctx = sc->sign_ctxs[index];
+
+	size_t i;
+	while ((i = __atomic_fetch_add(&sc->next_chunk, 1, __ATOMIC_RELAXED)) < sc->chunk_count) {
+		chunk_t *chunk = &sc->chunks[i];
+		size_t end = MIN((i + 1) * CHUNK_NODES, job->count);
+		for (size_t j = i * CHUNK_NODES; j < end && chunk->ret == KNOT_EOK; j++) {
+			if (job->nsec3) {
+				size_t k = job->first + j;
+				const hash_t *next = &sc->sorted[(k + 1) % sc->hash_count];
+				chunk->ret = write_nsec3(sc, sign_ctx, chunk, &sc->sorted[k], next);
+			} else {
+				chunk->ret = process_item(sc, sign_ctx, chunk, &sc->items[j]);
+			}
+		}
+	}
+}
+
+static int run_window(stream_ctx_t *sc, job_t *job)
+{
+	size_t chunks = (job->count + CHUNK_NODES - 1) / CHUNK_NODES;
+	if (chunks > sc->chunk_max) {
+		chunk_t *new_chunks = realloc(sc->chunks, chunks * sizeof(*new_chunks));
+		if (new_chunks == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memset(new_chunks + sc->chunk_max, 0,
+		       (chunks - sc->chunk_max) * sizeof(*new_chunks));
+		sc->chunks = new_chunks;
+		sc->chunk_max = chunks;
+	}
+	for (size_t i = 0; i < chunks; i++) {
+		chunk_t *chunk = &sc->chunks[i];
+		chunk->text.len = 0;
+		chunk->snap.len = 0;
+		chunk->hashes.len = 0;
+		chunk->bitmaps.len = 0;
+		chunk->rrsets = 0;
+		chunk->ret = KNOT_EOK;
+	}
+	sc->chunk_count = chunks;
+	sc->next_chunk = 0;
+
+	sign_pool_run(sc->threads, sign_job, job);
+
+	// Output in the order of the input.
+	for (size_t i = 0; i < chunks; i++) {
+		chunk_t *chunk = &sc->chunks[i];
+		if (chunk->ret != KNOT_EOK) {
+			return chunk->ret;
+		}
+		if (chunk->text.len > 0 &&
+		    fwrite(chunk->text.data, chunk->text.len, 1, sc->out) != 1) {
+			return KNOT_EFILE;
+		}
+		if (sc->snap != NULL) {
+			int ret = zone_snapshot_stream_write(sc->snap, chunk->snap.data,
+			                                     chunk->snap.len, chunk->rrsets);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+
+		hash_t *entries = (hash_t *)chunk->hashes.data;
+		size_t entry_count = chunk->hashes.len / sizeof(hash_t);
+		for (size_t j = 0; j < entry_count; j++) {
+			entries[j].bitmap_off += sc->bitmaps.len;
+		}
+		int ret = buf_append(&sc->bitmaps, chunk->bitmaps.data, chunk->bitmaps.len);
+		if (ret == KNOT_EOK) {
+			ret = buf_append(&sc->hashes, chunk->hashes.data, chunk->hashes.len);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int flush_window(stream_ctx_t *sc)
+{
+	assert(sc->pending < 0);
+
+	job_t job = { .sc = sc, .count = sc->count };
+	int ret = run_window(sc, &job);
+
+	for (size_t i = 0; i < sc->count; i++) {
+		node_free_rrsets(sc->items[i].node, NULL);
+		node_free(sc->items[i].node, NULL);
+		knot_dname_free(sc->items[i].next, NULL);
+	}
+	sc->records += sc->count;
+	sc->count = 0;
+
+	return ret;
+}
+
+static int queue_node(stream_ctx_t *sc, zone_node_t *node, bool nsec3)
+{
+	bool in_chain = sc->nsec && !(node->flags & NODE_FLAGS_NONAUTH);
+	if (in_chain && sc->pending >= 0) {
+		sc->items[sc->pending].next = knot_dname_copy(node->owner, NULL);
+		if (sc->items[sc->pending].next == NULL) {
+			return KNOT_ENOMEM;
+		}
+		sc->pending = -1;
+	}
+
+	// The window can't be signed until the last NSEC points somewhere.
+	if (sc->count >= sc->window && sc->pending < 0) {
+		int ret = flush_window(sc);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (sc->count == sc->max) {
+		size_t max = MAX(2 * sc->max, sc->window + 1);
+		item_t *items = realloc(sc->items, max * sizeof(*items));
+		if (items == NULL) {
+			return KNOT_ENOMEM;
+		}
+		sc->items = items;
+		sc->max = max;
+	}
+
+	sc->items[sc->count] = (item_t) { .node = node, .nsec3 = nsec3 };
+	if (in_chain) {
+		sc->pending = sc->count;
+	}
+	sc->count++;
+
+	return KNOT_EOK;
+}
+
+static int add_empty_non_terminals(stream_ctx_t *sc, const knot_dname_t *owner)
+{
+	size_t labels = knot_dname_labels(owner, NULL);
+	size_t skip = MAX(knot_dname_matched_labels(owner, sc->last_nsec3),
+	                  knot_dname_labels(sc->apex, NULL));
+
+	// The names in between are their own parents only if not seen yet.
+	const knot_dname_t *name = owner;
+	for (size_t i = labels; i > skip; i--) {
+		if (name != owner) {
+			int ret = add_hash(&sc->hashes, &sc->bitmaps, sc, name, NULL);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+		name = knot_wire_next_label(name, NULL);
+	}
+
+	return KNOT_EOK;
+}
+
+static int finish_node(stream_ctx_t *sc, zone_node_t *node)
+{
+	bool apex = knot_dname_is_equal(node->owner, sc->apex);
+	if (sc->cut != NULL && knot_dname_in_bailiwick(node->owner, sc->cut) > 0) {
+		node->flags |= NODE_FLAGS_NONAUTH;
+	} else {
+		knot_dname_free(sc->cut, NULL);
+		sc->cut = NULL;
+		if (!apex && node_rrtype_exists(node, KNOT_RRTYPE_NS)) {
+			node->flags |= NODE_FLAGS_DELEG;
+			sc->cut = knot_dname_copy(node->owner, NULL);
+			if (sc->cut == NULL) {
+				return KNOT_ENOMEM;
+			}
+		}
+	}
+	memcpy(sc->prev, node->owner, knot_dname_size(node->owner));
+
+	bool nsec3 = sc->nsec3.algorithm != 0 && !(node->flags & NODE_FLAGS_NONAUTH);
+	if (nsec3 && (node->flags & NODE_FLAGS_DELEG) &&
+	    (sc->nsec3.flags & KNOT_NSEC3_FLAG_OPT_OUT) &&
+	    !node_rrtype_exists(node, KNOT_RRTYPE_DS)) {
+		nsec3 = false;
+	}
+	if (nsec3) {
+		int ret = add_empty_non_terminals(sc, node->owner);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		memcpy(sc->last_nsec3, node->owner, knot_dname_size(node->owner));
+	}
+
+	return queue_node(sc, node, nsec3);
+}
+
+static int copy_apex(stream_ctx_t *sc, const zone_node_t *signed_apex)
+{
+	zone_node_t *node = node_new(sc->apex, false, false, NULL);
+	if (node == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	// Without the chain records made for the apex alone.
+	int ret = KNOT_EOK;
+	for (uint16_t i = 0; i < signed_apex->rrset_count && ret == KNOT_EOK; i++) {
+		knot_rrset_t rrset = node_rrset_at(signed_apex, i);
+		if (rrset.type == KNOT_RRTYPE_NSEC || rrset.type == KNOT_RRTYPE_NSEC3) {
+			continue;
+		}
+		if (rrset.type != KNOT_RRTYPE_RRSIG) {
+			ret = node_add_rrset(node, &rrset, NULL);
+			continue;
+		}
+
+		knot_rdataset_t rrsigs = { 0 };
+		knot_rdata_t *rr = rrset.rrs.rdata;
+		for (uint16_t j = 0; j < rrset.rrs.count && ret == KNOT_EOK; j++) {
+			uint16_t covered = knot_rrsig_type_covered(rr);
+			if (covered != KNOT_RRTYPE_NSEC && covered != KNOT_RRTYPE_NSEC3) {
+				ret = knot_rdataset_add(&rrsigs, rr, NULL);
+			}
+			rr = knot_rdataset_next(rr);
+		}
+		if (ret == KNOT_EOK && rrsigs.count > 0) {
+			rrset.rrs = rrsigs;
+			ret = node_add_rrset(node, &rrset, NULL);
+		}
+		knot_rdataset_clear(&rrsigs, NULL);
+	}
+	if (ret != KNOT_EOK) {
+		node_free_rrsets(node, NULL);
+		node_free(node, NULL);
+		return ret;
+	}
+
+	memcpy(sc->last_nsec3, sc->apex, knot_dname_size(sc->apex));
+
+	ret = finish_node(sc, node);
+	if (ret != KNOT_EOK) {
+		node_free_rrsets(node, NULL);
+		node_free(node, NULL);
+	}
+
+	return ret;
+}
+
+static int init_signing(stream_ctx_t *sc, const zone_contents_t *signed_cont)
+{
+	int ret = kdnssec_ctx_init(sc->conf, &sc->ctx, sc->apex, zone_kaspdb(sc->zone), NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (sc->params->timestamp) {
+		sc->ctx.now = sc->params->timestamp;
+	}
+	update_policy_from_zone(sc->ctx.policy, signed_cont);
+	sc->ctx.rrsig_drop_existing = true;
+
+	ret = load_zone_keys(&sc->ctx, &sc->keyset, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	sc->threads = MAX(sc->ctx.policy->signing_threads, 1);
+	sc->window = WINDOW_NODES * sc->threads;
+	sc->sign_ctxs = calloc(sc->threads, sizeof(*sc->sign_ctxs));
+	if (sc->sign_ctxs == NULL) {
+		return KNOT_ENOMEM;
+	}
+	for (unsigned i = 0; i < sc->threads; i++) {
+		sc->sign_ctxs[i] = zone_sign_ctx(&sc->keyset, &sc->ctx);
+		if (sc->sign_ctxs[i] == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	knot_rrset_t soa = node_rrset(signed_cont->apex, KNOT_RRTYPE_SOA);
+	sc->nsec_ttl = MIN(knot_soa_minimum(soa.rrs.rdata), soa.ttl);
+
+	knot_rrset_t param = node_rrset(signed_cont->apex, KNOT_RRTYPE_NSEC3PARAM);
+	if (sc->ctx.policy->nsec3_enabled && !knot_rrset_empty(&param)) {
+		dnssec_binary_t rdata = {
+			.data = param.rrs.rdata->data,
+			.size = param.rrs.rdata->len
+		};
+		ret = dnssec_nsec3_params_from_rdata(&sc->nsec3, &rdata);
+		if (ret != DNSSEC_EOK) {
+			return knot_error_from_libdnssec(ret);
+		}
+		if (dnssec_nsec3_hash_length(sc->nsec3.algorithm) > HASH_MAX) {
+			return KNOT_ENOTSUP;
+		}
+		sc->nsec3.flags = sc->ctx.policy->nsec3_opt_out ? KNOT_NSEC3_FLAG_OPT_OUT : 0;
+	} else {
+		sc->nsec = true;
+	}
+
+	return KNOT_EOK;
+}
+
+static int open_output(stream_ctx_t *sc, uint32_t serial)
+{
+	int ret = make_path(sc->params->output, S_IRUSR|S_IWUSR|S_IXUSR|S_IRGRP|S_IWGRP|S_IXGRP);
+	if (ret == KNOT_EOK) {
+		ret = open_tmp_file(sc->params->output, &sc->tmp_name, &sc->out,
+		                    S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
+	}
+	if (ret != KNOT_EOK || !sc->params->snapshot) {
+		return ret;
+	}
+
+	char *path = zone_snapshot_path(sc->params->output);
+	if (path == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ret = zone_snapshot_stream_open(path, sc->apex, serial, &sc->snap);
+	free(path);
+
+	return ret;
+}
+
+static int sign_apex(stream_ctx_t *sc)
+{
+	if (!node_rrtype_exists(sc->apex_cont->apex, KNOT_RRTYPE_SOA)) {
+		ERR2("missing SOA record at the zone apex\n");
+		return KNOT_ESEMCHECK;
+	}
+
+	zone_update_t up = { 0 };
+	int ret = zone_update_from_contents(&up, sc->zone, sc->apex_cont, UPDATE_FULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	sc->apex_cont = NULL;
+
+	// All the signatures are made again, so the serial is always incremented.
+	ret = knot_dnssec_zone_sign(&up, sc->conf, ZONE_SIGN_DROP_SIGNATURES,
+	                            sc->params->rollover, sc->params->timestamp,
+	                            sc->next_sign);
+	if (ret == KNOT_DNSSEC_ENOKEY) { // exception: allow generating initial keys
+		sc->params->rollover = KEY_ROLL_ALLOW_ALL;
+		ret = knot_dnssec_zone_sign(&up, sc->conf, ZONE_SIGN_DROP_SIGNATURES,
+		                            sc->params->rollover, sc->params->timestamp,
+		                            sc->next_sign);
+	}
+	if (ret == KNOT_EOK) {
+		ret = init_signing(sc, up.new_cont);
+	}
+	if (ret == KNOT_EOK) {
+		ret = open_output(sc, zone_contents_serial(up.new_cont));
+	}
+	if (ret == KNOT_EOK) {
+		sc->signing = true;
+		ret = copy_apex(sc, up.new_cont->apex);
+	}
+	zone_update_clear(&up);
+
+	return ret;
+}
+
+static int process_rrset(stream_ctx_t *sc, knot_rrset_t *rr)
+{
+	if (knot_dname_in_bailiwick(rr->owner, sc->apex) < 0) {
+		knot_dname_txt_storage_t name;
+		(void)knot_dname_to_str(name, rr->owner, sizeof(name));
+		ERR2("record '%s' out of the zone\n", name);
+		return KNOT_EOUTOFZONE;
+	}
+
+	// The chains and the signatures are made again.
+	if (rr->type == KNOT_RRTYPE_RRSIG || rr->type == KNOT_RRTYPE_NSEC ||
+	    rr->type == KNOT_RRTYPE_NSEC3) {
+		return KNOT_EOK;
+	}
+
+	if (!sc->signing) {
+		if (knot_dname_is_equal(rr->owner, sc->apex)) {
+			zone_node_t *unused = NULL;
+			return zone_contents_add_rr(sc->apex_cont, rr, &unused);
+		}
+		int ret = sign_apex(sc);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (sc->node != NULL && knot_dname_is_equal(sc->node->owner, rr->owner)) {
+		return node_add_rrset(sc->node, rr, NULL);
+	}
+
+	const knot_dname_t *last = (sc->node != NULL) ? sc->node->owner : sc->prev;
+	if (knot_dname_cmp(rr->owner, last) <= 0) {
+		knot_dname_txt_storage_t name;
+		(void)knot_dname_to_str(name, rr->owner, sizeof(name));
+		ERR2("zone file not in canonical order at '%s'\n", name);
+		return KNOT_ESEMCHECK;
+	}
+
+	if (sc->node != NULL) {
+		zone_node_t *node = sc->node;
+		sc->node = NULL;
+		int ret = finish_node(sc, node);
+		if (ret != KNOT_EOK) {
+			node_free_rrsets(node, NULL);
+			node_free(node, NULL);
+			return ret;
+		}
+	}
+
+	sc->node = node_new(rr->owner, false, false, NULL);
+	if (sc->node == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return node_add_rrset(sc->node, rr, NULL);
+}
+
+static void process_data(zs_scanner_t *scanner)
+{
+	stream_ctx_t *sc = scanner->process.data;
+	if (sc->ret != KNOT_EOK) {
+		scanner->state = ZS_STATE_STOP;
+		return;
+	}
+
+	knot_dname_t *owner = knot_dname_copy(scanner->r_owner, NULL);
+	if (owner == NULL) {
+		sc->ret = KNOT_ENOMEM;
+		scanner->state = ZS_STATE_STOP;
+		return;
+	}
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, scanner->r_type, scanner->r_class, scanner->r_ttl);
+	sc->ret = knot_rrset_add_rdata(&rr, scanner->r_data, scanner->r_data_length, NULL);
+	if (sc->ret == KNOT_EOK) {
+		sc->ret = knot_rrset_rr_to_canonical(&rr);
+	}
+	if (sc->ret == KNOT_EOK) {
+		sc->ret = process_rrset(sc, &rr);
+	}
+	knot_rrset_clear(&rr, NULL);
+
+	if (sc->ret != KNOT_EOK) {
+		scanner->state = ZS_STATE_STOP;
+	}
+}
+
+static void process_error(zs_scanner_t *scanner)
+{
+	stream_ctx_t *sc = scanner->process.data;
+
+	ERR2("file '%s', line %"PRIu64" (%s)\n", scanner->file.name,
+	     scanner->line_counter, zs_strerror(scanner->error.code));
+	sc->ret = KNOT_EPARSEFAIL;
+	scanner->state = ZS_STATE_STOP;
+}
+
+static int cmp_hash(const void *a, const void *b)
+{
+	return memcmp(((const hash_t *)a)->hash, ((const hash_t *)b)->hash, HASH_MAX);
+}
+
+static int write_nsec3_chain(stream_ctx_t *sc)
+{
+	sc->sorted = (hash_t *)sc->hashes.data;
+	sc->hash_count = sc->hashes.len / sizeof(hash_t);
+	if (sc->hash_count == 0) {
+		return KNOT_EOK;
+	}
+	qsort(sc->sorted, sc->hash_count, sizeof(hash_t), cmp_hash);
+
+	for (size_t i = 1; i < sc->hash_count; i++) {
+		if (cmp_hash(&sc->sorted[i - 1], &sc->sorted[i]) == 0) {
+			ERR2("NSEC3 hash collision, re-salt needed\n");
+			return KNOT_ENSEC3CHAIN;
+		}
+	}
+
+	for (size_t first = 0; first < sc->hash_count; first += sc->window) {
+		job_t job = {
+			.sc = sc,
+			.first = first,
+			.count = MIN(sc->window, sc->hash_count - first),
+			.nsec3 = true
+		};
+		int ret = run_window(sc, &job);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		sc->records += job.count;
+	}
+
+	return KNOT_EOK;
+}
+
+static int finish_stream(stream_ctx_t *sc)
+{
+	if (!sc->signing) {
+		if (zone_contents_is_empty(sc->apex_cont)) {
+			ERR2("empty zone\n");
+			return KNOT_EEMPTYZONE;
+		}
+		int ret = sign_apex(sc);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (sc->node != NULL) {
+		zone_node_t *node = sc->node;
+		sc->node = NULL;
+		int ret = finish_node(sc, node);
+		if (ret != KNOT_EOK) {
+			node_free_rrsets(node, NULL);
+			node_free(node, NULL);
+			return ret;
+		}
+	}
+
+	// The last NSEC points to the apex.
+	if (sc->pending >= 0) {
+		sc->items[sc->pending].next = knot_dname_copy(sc->apex, NULL);
+		if (sc->items[sc->pending].next == NULL) {
+			return KNOT_ENOMEM;
+		}
+		sc->pending = -1;
+	}
+
+	int ret = flush_window(sc);
+	if (ret == KNOT_EOK && sc->nsec3.algorithm != 0) {
+		ret = write_nsec3_chain(sc);
+	}
+
+	return ret;
+}
+
+static int commit_output(stream_ctx_t *sc)
+{
+	int ret = (fclose(sc->out) == 0) ? KNOT_EOK : KNOT_EFILE;
+	sc->out = NULL;
+	if (ret == KNOT_EOK) {
+		ret = zonefile_write_commit(sc->params->output, sc->tmp_name);
+	} else {
+		unlink(sc->tmp_name);
+		free(sc->tmp_name);
+	}
+	sc->tmp_name = NULL;
+
+	// The snapshot is bound to the final zone file.
+	struct stat st;
+	if (ret == KNOT_EOK && stat(sc->params->output, &st) != 0) {
+		ret = knot_map_errno();
+	}
+	if (sc->snap != NULL) {
+		int snap_ret = zone_snapshot_stream_close(sc->snap, ret == KNOT_EOK ? &st : NULL);
+		sc->snap = NULL;
+		if (ret == KNOT_EOK && snap_ret != KNOT_EOK) {
+			ERR2("failed to write zone snapshot (%s)\n", knot_strerror(snap_ret));
+			ret = snap_ret;
+		}
+	}
+
+	return ret;
+}
+
+static void stream_deinit(stream_ctx_t *sc)
+{
+	if (sc->out != NULL) {
+		fclose(sc->out);
+		unlink(sc->tmp_name);
+		free(sc->tmp_name);
+	}
+	if (sc->snap != NULL) {
+		(void)zone_snapshot_stream_close(sc->snap, NULL);
+	}
+
+	for (size_t i = 0; i < sc->count; i++) {
+		node_free_rrsets(sc->items[i].node, NULL);
+		node_free(sc->items[i].node, NULL);
+		knot_dname_free(sc->items[i].next, NULL);
+	}
+	free(sc->items);
+	if (sc->node != NULL) {
+		node_free_rrsets(sc->node, NULL);
+		node_free(sc->node, NULL);
+	}
+	knot_dname_free(sc->cut, NULL);
+
+	for (size_t i = 0; i < sc->chunk_max; i++) {
+		buf_free(&sc->chunks[i].text);
+		buf_free(&sc->chunks[i].snap);
+		buf_free(&sc->chunks[i].hashes);
+		buf_free(&sc->chunks[i].bitmaps);
+		free(sc->chunks[i].dump);
+	}
+	free(sc->chunks);
+	buf_free(&sc->hashes);
+	buf_free(&sc->bitmaps);
+
+	if (sc->sign_ctxs != NULL) {
+		for (unsigned i = 0; i < sc->threads; i++) {
+			zone_sign_ctx_free(sc->sign_ctxs[i]);
+		}
+		free(sc->sign_ctxs);
+	}
+	dnssec_nsec3_params_free(&sc->nsec3);
+	free_zone_keys(&sc->keyset);
+	kdnssec_ctx_deinit(&sc->ctx);
+
+	zone_contents_deep_free(sc->apex_cont);
+}
+
+int zone_sign_stream(conf_t *conf, zone_t *zone, stream_params_t *params,
+                     zone_sign_reschedule_t *next_sign)
+{
+	if (conf == NULL || zone == NULL || params == NULL || next_sign == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	conf_val_t val = conf_zone_get(conf, C_ZONEMD_GENERATE, zone->name);
+	if (conf_opt(&val) != ZONE_DIGEST_NONE) {
+		ERR2("ZONEMD generation is not supported in the streaming mode\n");
+		return KNOT_ENOTSUP;
+	}
+
+	stream_ctx_t sc = {
+		.conf = conf,
+		.zone = zone,
+		.params = params,
+		.next_sign = next_sign,
+		.apex = zone->name,
+		.pending = -1,
+	};
+
+	sc.apex_cont = zone_contents_new(zone->name, true);
+	if (sc.apex_cont == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	char *origin = knot_dname_to_str_alloc(zone->name);
+	if (origin == NULL) {
+		stream_deinit(&sc);
+		return KNOT_ENOMEM;
+	}
+
+	zs_scanner_t scanner;
+	if (zs_init(&scanner, origin, KNOT_CLASS_IN, 3600) != 0 ||
+	    zs_set_input_file(&scanner, params->input) != 0 ||
+	    zs_set_processing(&scanner, process_data, process_error, &sc) != 0) {
+		ERR2("failed to open zone file '%s' (%s)\n", params->input,
+		     zs_strerror(scanner.error.code));
+		zs_deinit(&scanner);
+		free(origin);
+		stream_deinit(&sc);
+		return KNOT_EFILE;
+	}
+	free(origin);
+
+	int ret = zs_parse_all(&scanner);
+	if (ret != 0 && sc.ret == KNOT_EOK) {
+		ERR2("failed to read zone file '%s' (%s)\n", params->input,
+		     zs_strerror(scanner.error.code));
+		sc.ret = KNOT_EFILE;
+	}
+	zs_deinit(&scanner);
+
+	ret = sc.ret;
+	if (ret == KNOT_EOK) {
+		ret = finish_stream(&sc);
+	}
+	if (ret == KNOT_EOK) {
+		ret = commit_output(&sc);
+	}
+	if (ret == KNOT_EOK) {
+		INFO2("signed zone written to '%s', %"PRIu64" names\n",
+		      params->output, sc.records);
+	}
+
+	stream_deinit(&sc);
+
+	return ret;
+}
@@ -0,0 +1,54 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief Streaming signing of huge zone files.
+ *
+ * The zone file must be in the canonical order. Only the zone apex is kept
+ * in a zone structure and signed by the common signing procedure, which also
+ * handles the keys. The rest of the zone is read node by node, the nodes are
+ * signed in parallel in windows of bounded size and written in the input
+ * order. The NSEC chain is created on the fly, the NSEC3 chain needs only
+ * the hashes and the type bitmaps of the names and is written at the end.
+ */
+
+#pragma once
+
+#include "knot/conf/conf.h"
+#include "knot/dnssec/zone-events.h"
+#include "knot/zone/zone.h"
+
+typedef struct {
+	const char *input;               /*!< Zone file to be signed. */
+	const char *output;              /*!< Signed zone file (may equal the input). */
+	bool snapshot;                   /*!< Write also the binary snapshot of the output. */
+	zone_sign_roll_flags_t rollover; /*!< Key roll-over flags. */
+	knot_time_t timestamp;           /*!< Signing time override. */
+} stream_params_t;
+
+/*!
+ * \brief Signs the zone file in the streaming mode.
+ *
+ * \param conf       Configuration.
+ * \param zone       Zone structure with initialized KASP DB.
+ * \param params     Signing parameters (the roll-over flags may be updated).
+ * \param next_sign  Out: Next signing events.
+ *
+ * \return KNOT_E*
+ */
+int zone_sign_stream(conf_t *conf, zone_t *zone, stream_params_t *params,
+                     zone_sign_reschedule_t *next_sign);
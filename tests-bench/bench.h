@@ -0,0 +1,130 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*!
+ * \brief Minimal benchmark harness.
+ *
+ * Each benchmark case is a function performing the given number of
+ * operations. The case is warmed up and then measured in several rounds,
+ * the median and the minimum time per operation are printed as one JSON
+ * object per line, so the results can be collected by CI for trend tracking.
+ *
+ * The inputs are generated deterministically. The environment variable
+ * BENCH_SCALE multiplies the number of operations (e.g. 0.1 for a quick
+ * run) and BENCH_ROUNDS sets the number of measured rounds.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_ROUNDS_DEFAULT	5
+#define BENCH_ROUNDS_MAX	101
+
+/*! \brief Benchmark case performing 'ops' operations. */
+typedef void (*bench_f)(void *ctx, size_t ops);
+
+typedef struct {
+	const char *suite;
+	double scale;
+	unsigned rounds;
+	bool failed;
+} bench_t;
+
+/*! \brief Sink keeping the benchmarked results from being optimized out. */
+static volatile uintptr_t bench_sink;
+
+#define BENCH_USE(x) (bench_sink += (uintptr_t)(x))
+
+/*! \brief Deterministic pseudo-random sequence (64-bit LCG). */
+static inline uint32_t bench_rand(uint64_t *state)
+{
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *state >> 33;
+}
+
+static inline void bench_init(bench_t *b, const char *suite)
+{
+	b->suite = suite;
+	b->failed = false;
+
+	const char *scale = getenv("BENCH_SCALE");
+	b->scale = (scale != NULL) ? atof(scale) : 1.0;
+	if (b->scale <= 0) {
+		b->scale = 1.0;
+	}
+
+	const char *rounds = getenv("BENCH_ROUNDS");
+	b->rounds = (rounds != NULL) ? atoi(rounds) : BENCH_ROUNDS_DEFAULT;
+	if (b->rounds < 1 || b->rounds > BENCH_ROUNDS_MAX) {
+		b->rounds = BENCH_ROUNDS_DEFAULT;
+	}
+}
+
+/*! \brief Reports a failed benchmark setup, makes the program fail. */
+static inline void bench_fail(bench_t *b, const char *name, const char *error)
+{
+	fprintf(stderr, "%s/%s: %s\n", b->suite, name, error);
+	b->failed = true;
+}
+
+static inline uint64_t bench_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+/*! \brief Measures the case and prints the result line. */
+static inline void bench_run(bench_t *b, const char *name, size_t ops,
+                             bench_f fn, void *ctx)
+{
+	ops *= b->scale;
+	if (ops == 0) {
+		ops = 1;
+	}
+
+	fn(ctx, (ops + 9) / 10);
+
+	double ns[BENCH_ROUNDS_MAX];
+	for (unsigned i = 0; i < b->rounds; i++) {
+		uint64_t begin = bench_ns();
+		fn(ctx, ops);
+		ns[i] = (double)(bench_ns() - begin) / ops;
+	}
+	qsort(ns, b->rounds, sizeof(ns[0]), bench_cmp);
+
+	printf("{\"suite\": \"%s\", \"bench\": \"%s\", \"ops\": %zu, \"rounds\": %u, "
+	       "\"ns_per_op\": %.1f, \"ns_per_op_min\": %.1f}\n",
+	       b->suite, name, ops, b->rounds, ns[b->rounds / 2], ns[0]);
+	fflush(stdout);
+}
+
+/*! \brief Program exit code. */
+static inline int bench_exit(bench_t *b)
+{
+	return b->failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
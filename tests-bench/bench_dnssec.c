@@ -0,0 +1,129 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+
+#include "libdnssec/crypto.h"
+#include "libdnssec/error.h"
+#include "libdnssec/key.h"
+#include "libdnssec/sign.h"
+#include "libdnssec/sample_keys.h"
+#include "bench.h"
+
+typedef struct {
+	dnssec_key_t *key;
+	dnssec_sign_ctx_t *sign;
+	dnssec_binary_t data;
+	dnssec_binary_t signature;
+} ctx_t;
+
+static int ctx_init(ctx_t *ctx, const key_parameters_t *params, uint8_t *data, size_t size)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->data.data = data;
+	ctx->data.size = size;
+
+	int ret = dnssec_key_new(&ctx->key);
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_set_rdata(ctx->key, &params->rdata);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_key_load_pkcs8(ctx->key, &params->pem);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_sign_new(&ctx->sign, ctx->key);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_sign_add(ctx->sign, &ctx->data);
+	}
+	if (ret == DNSSEC_EOK) {
+		ret = dnssec_sign_write(ctx->sign, DNSSEC_SIGN_NORMAL, &ctx->signature);
+	}
+
+	return ret;
+}
+
+static void ctx_deinit(ctx_t *ctx)
+{
+	dnssec_binary_free(&ctx->signature);
+	dnssec_sign_free(ctx->sign);
+	dnssec_key_free(ctx->key);
+}
+
+static void sign(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	for (size_t i = 0; i < ops; i++) {
+		dnssec_binary_t signature = { 0 };
+		(void)dnssec_sign_init(ctx->sign);
+		(void)dnssec_sign_add(ctx->sign, &ctx->data);
+		(void)dnssec_sign_write(ctx->sign, DNSSEC_SIGN_NORMAL, &signature);
+		dnssec_binary_free(&signature);
+	}
+}
+
+static void verify(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	for (size_t i = 0; i < ops; i++) {
+		(void)dnssec_sign_init(ctx->sign);
+		(void)dnssec_sign_add(ctx->sign, &ctx->data);
+		BENCH_USE(dnssec_sign_verify(ctx->sign, false, &ctx->signature));
+	}
+}
+
+static void bench_key(bench_t *b, const char *name, const key_parameters_t *params,
+                      size_t sign_ops, size_t verify_ops)
+{
+	// Roughly the size of a signed RRSet with the RRSIG header.
+	uint8_t data[256];
+	uint64_t seed = 3;
+	for (size_t i = 0; i < sizeof(data); i++) {
+		data[i] = bench_rand(&seed);
+	}
+
+	char bench_name[64];
+	ctx_t ctx;
+	if (ctx_init(&ctx, params, data, sizeof(data)) != DNSSEC_EOK) {
+		bench_fail(b, name, "failed to load the key");
+		ctx_deinit(&ctx);
+		return;
+	}
+
+	(void)snprintf(bench_name, sizeof(bench_name), "sign_%s", name);
+	bench_run(b, bench_name, sign_ops, sign, &ctx);
+	(void)snprintf(bench_name, sizeof(bench_name), "verify_%s", name);
+	bench_run(b, bench_name, verify_ops, verify, &ctx);
+
+	ctx_deinit(&ctx);
+}
+
+int main(int argc, char *argv[])
+{
+	bench_t b;
+	bench_init(&b, "dnssec");
+
+	dnssec_crypto_init();
+
+	bench_key(&b, "ecdsa_p256", &SAMPLE_ECDSA_KEY, 10000, 5000);
+	bench_key(&b, "ed25519", &SAMPLE_ED25519_KEY, 10000, 5000);
+	bench_key(&b, "rsa", &SAMPLE_RSA_KEY, 2000, 50000);
+
+	dnssec_crypto_cleanup();
+
+	return bench_exit(&b);
+}
@@ -0,0 +1,271 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <ftw.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "knot/test_server.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+#include "contrib/sockaddr.h"
+#include "contrib/ucw/mempool.h"
+#include "bench.h"
+
+#define ZONE_NAMES	100000
+
+typedef struct {
+	zone_contents_t *contents;
+	knot_dname_t *names[ZONE_NAMES];
+	knot_dname_t *missing[ZONE_NAMES];
+	char zonefile[4096];
+	server_t server;
+	knot_layer_t layer;
+	knot_mm_t mm;
+	knotd_qdata_params_t params;
+	struct sockaddr_storage remote;
+	uint8_t query[2][KNOT_WIRE_MAX_PKTSIZE];
+	size_t query_size[2];
+} ctx_t;
+
+static int rm_cb(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+	return remove(path);
+}
+
+static void rm_rf(const char *path)
+{
+	(void)nftw(path, rm_cb, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+static int add_rr(zone_contents_t *contents, const knot_dname_t *owner, uint16_t type,
+                  const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, type, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rr, rdata, rdlen, NULL);
+	if (ret == KNOT_EOK) {
+		zone_node_t *unused = NULL;
+		ret = zone_contents_add_rr(contents, &rr, &unused);
+	}
+	knot_rdataset_clear(&rr.rrs, NULL);
+
+	return ret;
+}
+
+/* Synthetic root zone matching the generated zone file. */
+static int prepare_zone(ctx_t *ctx, FILE *zonefile)
+{
+	static const uint8_t SOA_RDATA[] = {
+		0x02, 'n', 's', 0x00, 0x04, 'm', 'a', 'i', 'l', 0x00,
+		0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x51, 0x80, 0x00, 0x00, 0x1c, 0x20,
+		0x00, 0x0a, 0x8c, 0x00, 0x00, 0x00, 0x0e, 0x10
+	};
+
+	ctx->contents = zone_contents_new(ROOT_DNAME, true);
+	if (ctx->contents == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = add_rr(ctx->contents, ROOT_DNAME, KNOT_RRTYPE_SOA, SOA_RDATA, sizeof(SOA_RDATA));
+	if (ret == KNOT_EOK) {
+		ret = add_rr(ctx->contents, ROOT_DNAME, KNOT_RRTYPE_NS, SOA_RDATA, 4);
+	}
+	fprintf(zonefile, ". 3600 SOA ns. mail. 1 86400 7200 691200 3600\n"
+	                  ". 3600 NS ns.\n");
+
+	uint64_t seed = 4;
+	for (unsigned i = 0; i < ZONE_NAMES && ret == KNOT_EOK; i++) {
+		char txt[64];
+		unsigned id = bench_rand(&seed);
+		(void)snprintf(txt, sizeof(txt), "h%u.zone%u.", id, i % 1000);
+		ctx->names[i] = knot_dname_from_str_alloc(txt);
+		(void)snprintf(txt, sizeof(txt), "m%u.zone%u.", id, i % 1000);
+		ctx->missing[i] = knot_dname_from_str_alloc(txt);
+		if (ctx->names[i] == NULL || ctx->missing[i] == NULL) {
+			ret = KNOT_ENOMEM;
+			break;
+		}
+
+		uint8_t a[4] = { 10, i >> 16, i >> 8, i };
+		ret = add_rr(ctx->contents, ctx->names[i], KNOT_RRTYPE_A, a, sizeof(a));
+		fprintf(zonefile, "h%u.zone%u. 3600 A 10.%u.%u.%u\n", id, i % 1000,
+		        (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+	}
+	if (ret == KNOT_EOK) {
+		ret = zone_adjust_full(ctx->contents, 1);
+	}
+
+	return ret;
+}
+
+static void find_existing(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	const zone_node_t *match, *closest, *prev;
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(zone_contents_find_dname(ctx->contents, ctx->names[(i * 7919) % ZONE_NAMES],
+		                                   &match, &closest, &prev));
+	}
+}
+
+static void find_missing(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	const zone_node_t *match, *closest, *prev;
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(zone_contents_find_dname(ctx->contents, ctx->missing[(i * 7919) % ZONE_NAMES],
+		                                   &match, &closest, &prev));
+	}
+}
+
+static void zonefile_parse(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	for (size_t i = 0; i < ops; i++) {
+		sem_handler_t handler = { .cb = err_handler_logger };
+		zloader_t zl;
+		if (zonefile_open(&zl, ctx->zonefile, ROOT_DNAME, SEMCHECK_MANDATORY_ONLY,
+		                  time(NULL)) != KNOT_EOK) {
+			continue;
+		}
+		zl.err_handler = &handler;
+		zone_contents_t *contents = zonefile_load(&zl);
+		zonefile_close(&zl);
+		zone_contents_deep_free(contents);
+	}
+}
+
+static int prepare_server(ctx_t *ctx, const char *storage)
+{
+	int ret = create_fake_server(&ctx->server, &ctx->mm, storage);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Answer from the synthetic zone instead of the bare root. */
+	zone_t *zone = knot_zonedb_find(ctx->server.zone_db, ROOT_DNAME);
+	zone_contents_deep_free(zone->contents);
+	zone->contents = ctx->contents;
+	ctx->contents = NULL;
+
+	knot_layer_init(&ctx->layer, &ctx->mm, process_query_layer());
+	sockaddr_set(&ctx->remote, AF_INET, "127.0.0.1", 53);
+	ctx->params.remote = &ctx->remote;
+	ctx->params.server = &ctx->server;
+
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+	const knot_dname_t *qnames[2] = { ctx->names[ZONE_NAMES / 2], ctx->missing[ZONE_NAMES / 2] };
+	for (unsigned i = 0; i < 2; i++) {
+		knot_pkt_clear(pkt);
+		ret = knot_pkt_put_question(pkt, qnames[i], KNOT_CLASS_IN, KNOT_RRTYPE_A);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		memcpy(ctx->query[i], pkt->wire, pkt->size);
+		ctx->query_size[i] = pkt->size;
+	}
+	knot_pkt_free(pkt);
+
+	return ret;
+}
+
+static void resolve(ctx_t *ctx, unsigned idx, size_t ops)
+{
+	uint8_t wire[KNOT_WIRE_MAX_PKTSIZE];
+	for (size_t i = 0; i < ops; i++) {
+		knot_pkt_t *query = knot_pkt_new(ctx->query[idx], ctx->query_size[idx], &ctx->mm);
+		knot_pkt_t *answer = knot_pkt_new(wire, sizeof(wire), &ctx->mm);
+		(void)knot_pkt_parse(query, 0);
+
+		knot_layer_begin(&ctx->layer, &ctx->params);
+		knot_layer_consume(&ctx->layer, query);
+		while (ctx->layer.state & (KNOT_STATE_PRODUCE | KNOT_STATE_FAIL)) {
+			knot_layer_produce(&ctx->layer, answer);
+		}
+		knot_layer_finish(&ctx->layer);
+		BENCH_USE(answer->size);
+
+		mp_flush(ctx->mm.ctx);
+	}
+}
+
+static void resolve_noerror(void *data, size_t ops)
+{
+	resolve(data, 0, ops);
+}
+
+static void resolve_nxdomain(void *data, size_t ops)
+{
+	resolve(data, 1, ops);
+}
+
+int main(int argc, char *argv[])
+{
+	bench_t b;
+	bench_init(&b, "knot");
+
+	ctx_t *ctx = calloc(1, sizeof(*ctx));
+	char tmpl[] = "/tmp/knot-bench.XXXXXX";
+	char *temp_dir = mkdtemp(tmpl);
+	if (ctx == NULL || temp_dir == NULL) {
+		free(ctx);
+		return EXIT_FAILURE;
+	}
+	mm_ctx_mempool(&ctx->mm, MM_DEFAULT_BLKSIZE);
+
+	(void)snprintf(ctx->zonefile, sizeof(ctx->zonefile), "%s/root.zone", temp_dir);
+	FILE *zonefile = fopen(ctx->zonefile, "w");
+	int ret = (zonefile != NULL) ? prepare_zone(ctx, zonefile) : knot_map_errno();
+	if (zonefile != NULL) {
+		fclose(zonefile);
+	}
+
+	if (ret == KNOT_EOK) {
+		bench_run(&b, "zone_find_existing", 1000000, find_existing, ctx);
+		bench_run(&b, "zone_find_missing", 1000000, find_missing, ctx);
+		bench_run(&b, "zonefile_load_100k", 2, zonefile_parse, ctx);
+
+		ret = prepare_server(ctx, temp_dir);
+		if (ret == KNOT_EOK) {
+			bench_run(&b, "query_noerror", 200000, resolve_noerror, ctx);
+			bench_run(&b, "query_nxdomain", 200000, resolve_nxdomain, ctx);
+		} else {
+			bench_fail(&b, "query", "failed to prepare the server");
+		}
+		server_deinit(&ctx->server);
+		conf_free(conf());
+	} else {
+		bench_fail(&b, "zone", "failed to prepare the zone");
+	}
+
+	zone_contents_deep_free(ctx->contents);
+	for (unsigned i = 0; i < ZONE_NAMES; i++) {
+		knot_dname_free(ctx->names[i], NULL);
+		knot_dname_free(ctx->missing[i], NULL);
+	}
+	mp_delete(ctx->mm.ctx);
+	rm_rf(temp_dir);
+	free(ctx);
+
+	return bench_exit(&b);
+}
@@ -0,0 +1,303 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+
+#include "libknot/libknot.h"
+#include "contrib/mempattern.h"
+#include "contrib/qp-trie/trie.h"
+#include "contrib/ucw/mempool.h"
+#include "bench.h"
+
+#define NAMES		10000
+#define TRIE_KEYS	100000
+
+typedef struct {
+	char txt[NAMES][KNOT_DNAME_TXT_MAXLEN];
+	knot_dname_t *names[NAMES];
+	knot_mm_t mm;
+	knot_pkt_t *pkt;
+	uint8_t query[KNOT_WIRE_MAX_PKTSIZE];
+	size_t query_size;
+	uint8_t resp[KNOT_WIRE_MAX_PKTSIZE];
+	size_t resp_size;
+	knot_rrset_t *rrsets[3];
+	trie_t *trie;
+	knot_dname_storage_t *keys;
+	uint8_t *key_lens;
+} ctx_t;
+
+static void gen_names(ctx_t *ctx)
+{
+	uint64_t seed = 1;
+	for (unsigned i = 0; i < NAMES; i++) {
+		(void)snprintf(ctx->txt[i], sizeof(ctx->txt[i]), "%s%u.zone%u.example.com.",
+		               (i % 3 == 0) ? "www" : "Host-", bench_rand(&seed) % 100000,
+		               i % 100);
+		ctx->names[i] = knot_dname_from_str_alloc(ctx->txt[i]);
+	}
+}
+
+static void dname_from_str(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	knot_dname_storage_t buf;
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(knot_dname_from_str(buf, ctx->txt[i % NAMES], sizeof(buf)));
+	}
+}
+
+static void dname_to_str(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	knot_dname_txt_storage_t buf;
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(knot_dname_to_str(buf, ctx->names[i % NAMES], sizeof(buf)));
+	}
+}
+
+static void dname_to_lower(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	knot_dname_storage_t buf;
+	for (size_t i = 0; i < ops; i++) {
+		knot_dname_copy_lower(buf, ctx->names[i % NAMES]);
+		BENCH_USE(buf[1]);
+	}
+}
+
+static void dname_is_equal(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	knot_dname_storage_t copies[16];
+	for (unsigned i = 0; i < 16; i++) {
+		knot_dname_to_wire(copies[i], ctx->names[i], sizeof(copies[i]));
+	}
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(knot_dname_is_equal(ctx->names[i % 16], copies[(i / 2) % 16]));
+	}
+}
+
+static void dname_lf(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	knot_dname_storage_t buf;
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(knot_dname_lf(ctx->names[i % NAMES], buf));
+	}
+}
+
+static int prepare_packets(ctx_t *ctx)
+{
+	/* Query with EDNS. */
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+	knot_rrset_t opt;
+	int ret = knot_pkt_put_question(pkt, ctx->names[0], KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	ret |= knot_edns_init(&opt, 1232, 0, 0, NULL);
+	ret |= knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+	ret |= knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &opt, 0);
+	ctx->query_size = pkt->size;
+	memcpy(ctx->query, pkt->wire, pkt->size);
+	knot_rrset_clear(&opt, NULL);
+	knot_pkt_free(pkt);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Referral-like response rrsets. */
+	const knot_dname_t *ns_owner = (const knot_dname_t *)"\x07""example""\x03""com";
+	ctx->rrsets[0] = knot_rrset_new(ctx->names[0], KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600, NULL);
+	ctx->rrsets[1] = knot_rrset_new(ns_owner, KNOT_RRTYPE_NS, KNOT_CLASS_IN, 3600, NULL);
+	ctx->rrsets[2] = knot_rrset_new(ctx->names[1], KNOT_RRTYPE_AAAA, KNOT_CLASS_IN, 3600, NULL);
+	for (unsigned i = 0; i < 3; i++) {
+		if (ctx->rrsets[i] == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+	for (uint8_t i = 0; i < 4; i++) {
+		uint8_t a[4] = { 192, 0, 2, i };
+		ret |= knot_rrset_add_rdata(ctx->rrsets[0], a, sizeof(a), NULL);
+		uint8_t ns[] = "\x03""ns0""\x07""example""\x03""com";
+		ns[3] += i;
+		ret |= knot_rrset_add_rdata(ctx->rrsets[1], ns, sizeof(ns), NULL);
+	}
+	uint8_t aaaa[16] = { 0x20, 0x01, 0x0d, 0xb8 };
+	ret |= knot_rrset_add_rdata(ctx->rrsets[2], aaaa, sizeof(aaaa), NULL);
+
+	/* Response to parse. */
+	pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+	ret |= knot_pkt_put_question(pkt, ctx->names[0], KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	ret |= knot_pkt_begin(pkt, KNOT_ANSWER);
+	ret |= knot_pkt_put(pkt, KNOT_COMPR_HINT_QNAME, ctx->rrsets[0], 0);
+	ret |= knot_pkt_begin(pkt, KNOT_AUTHORITY);
+	ret |= knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, ctx->rrsets[1], 0);
+	ret |= knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+	ret |= knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, ctx->rrsets[2], 0);
+	ctx->resp_size = pkt->size;
+	memcpy(ctx->resp, pkt->wire, pkt->size);
+	knot_pkt_free(pkt);
+
+	ctx->pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+
+	return (ret != KNOT_EOK || ctx->pkt == NULL) ? KNOT_ERROR : KNOT_EOK;
+}
+
+static void parse_wire(ctx_t *ctx, uint8_t *wire, size_t size, size_t ops)
+{
+	uint8_t copy[KNOT_WIRE_MAX_PKTSIZE];
+	for (size_t i = 0; i < ops; i++) {
+		/* Parsing strips TSIG from the wire, keep the original intact. */
+		memcpy(copy, wire, size);
+		knot_pkt_t *pkt = knot_pkt_new(copy, size, &ctx->mm);
+		BENCH_USE(knot_pkt_parse(pkt, 0));
+		mp_flush(ctx->mm.ctx);
+	}
+}
+
+static void pkt_parse_query(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	parse_wire(ctx, ctx->query, ctx->query_size, ops);
+}
+
+static void pkt_parse_response(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	parse_wire(ctx, ctx->resp, ctx->resp_size, ops);
+}
+
+static void pkt_put(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	for (size_t i = 0; i < ops; i++) {
+		knot_pkt_clear(ctx->pkt);
+		(void)knot_pkt_put_question(ctx->pkt, ctx->names[0], KNOT_CLASS_IN,
+		                            KNOT_RRTYPE_A);
+		(void)knot_pkt_begin(ctx->pkt, KNOT_ANSWER);
+		(void)knot_pkt_put(ctx->pkt, KNOT_COMPR_HINT_QNAME, ctx->rrsets[0], 0);
+		(void)knot_pkt_begin(ctx->pkt, KNOT_AUTHORITY);
+		(void)knot_pkt_put(ctx->pkt, KNOT_COMPR_HINT_NONE, ctx->rrsets[1], 0);
+		(void)knot_pkt_begin(ctx->pkt, KNOT_ADDITIONAL);
+		(void)knot_pkt_put(ctx->pkt, KNOT_COMPR_HINT_NONE, ctx->rrsets[2], 0);
+		BENCH_USE(ctx->pkt->size);
+	}
+}
+
+static int prepare_trie(ctx_t *ctx)
+{
+	ctx->trie = trie_create(NULL);
+	ctx->keys = calloc(TRIE_KEYS, sizeof(*ctx->keys));
+	ctx->key_lens = calloc(TRIE_KEYS, sizeof(*ctx->key_lens));
+	if (ctx->trie == NULL || ctx->keys == NULL || ctx->key_lens == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	uint64_t seed = 2;
+	for (uintptr_t i = 0; i < TRIE_KEYS; i++) {
+		char txt[64];
+		(void)snprintf(txt, sizeof(txt), "n%u.zone%u.", bench_rand(&seed), (unsigned)i % 1000);
+		knot_dname_storage_t name;
+		if (knot_dname_from_str(name, txt, sizeof(name)) == NULL) {
+			return KNOT_EINVAL;
+		}
+		uint8_t *lf = knot_dname_lf(name, ctx->keys[i]);
+		ctx->key_lens[i] = lf[0];
+		memmove(ctx->keys[i], lf + 1, lf[0]);
+		*trie_get_ins(ctx->trie, ctx->keys[i], ctx->key_lens[i]) = (void *)(i + 1);
+	}
+
+	return KNOT_EOK;
+}
+
+static void trie_get(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	for (size_t i = 0; i < ops; i++) {
+		size_t k = (i * 7919) % TRIE_KEYS;
+		BENCH_USE(trie_get_try(ctx->trie, ctx->keys[k], ctx->key_lens[k]));
+	}
+}
+
+static void trie_leq(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	uint8_t key[KNOT_DNAME_MAXLEN + 1];
+	for (size_t i = 0; i < ops; i++) {
+		/* Missing keys just after the existing ones. */
+		size_t k = (i * 7919) % TRIE_KEYS;
+		memcpy(key, ctx->keys[k], ctx->key_lens[k]);
+		key[ctx->key_lens[k]] = 'x';
+		trie_val_t *val = NULL;
+		BENCH_USE(trie_get_leq(ctx->trie, key, ctx->key_lens[k] + 1, &val));
+		BENCH_USE(val);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	bench_t b;
+	bench_init(&b, "libknot");
+
+	ctx_t *ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return EXIT_FAILURE;
+	}
+	mm_ctx_mempool(&ctx->mm, MM_DEFAULT_BLKSIZE);
+
+	gen_names(ctx);
+	bench_run(&b, "dname_from_str", 1000000, dname_from_str, ctx);
+	bench_run(&b, "dname_to_str", 1000000, dname_to_str, ctx);
+	bench_run(&b, "dname_copy_lower", 1000000, dname_to_lower, ctx);
+	bench_run(&b, "dname_is_equal", 10000000, dname_is_equal, ctx);
+	bench_run(&b, "dname_lf", 1000000, dname_lf, ctx);
+
+	if (prepare_packets(ctx) == KNOT_EOK) {
+		bench_run(&b, "pkt_parse_query", 1000000, pkt_parse_query, ctx);
+		bench_run(&b, "pkt_parse_response", 1000000, pkt_parse_response, ctx);
+		bench_run(&b, "pkt_put", 1000000, pkt_put, ctx);
+	} else {
+		bench_fail(&b, "pkt", "failed to prepare packets");
+	}
+
+	if (prepare_trie(ctx) == KNOT_EOK) {
+		bench_run(&b, "trie_get_try", 1000000, trie_get, ctx);
+		bench_run(&b, "trie_get_leq", 1000000, trie_leq, ctx);
+	} else {
+		bench_fail(&b, "trie", "failed to prepare trie");
+	}
+
+	trie_free(ctx->trie);
+	free(ctx->keys);
+	free(ctx->key_lens);
+	for (unsigned i = 0; i < 3; i++) {
+		knot_rrset_free(ctx->rrsets[i], NULL);
+	}
+	knot_pkt_free(ctx->pkt);
+	for (unsigned i = 0; i < NAMES; i++) {
+		knot_dname_free(ctx->names[i], NULL);
+	}
+	mp_delete(ctx->mm.ctx);
+	free(ctx);
+
+	return bench_exit(&b);
+}
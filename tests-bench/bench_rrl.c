@@ -0,0 +1,109 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "libdnssec/crypto.h"
+#include "libknot/libknot.h"
+#include "contrib/sockaddr.h"
+#include "knot/modules/rrl/functions.c"
+#include "knot/modules/rrl/nxdomain.c"
+#include "bench.h"
+
+#define RRL_SIZE	196613
+#define RRL_ADDRS	4096
+
+typedef struct {
+	rrl_table_t *rrl;
+	rrl_req_t rq;
+	knot_dname_t *zone;
+	struct sockaddr_storage addr;
+	struct sockaddr_storage addr6;
+} ctx_t;
+
+static void query_v4(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	struct sockaddr_in *sin = (struct sockaddr_in *)&ctx->addr;
+	for (size_t i = 0; i < ops; i++) {
+		sin->sin_addr.s_addr = (i * 2654435761U) % RRL_ADDRS;
+		BENCH_USE(rrl_query(ctx->rrl, &ctx->addr, &ctx->rq, ctx->zone, NULL));
+	}
+}
+
+static void query_v6(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ctx->addr6;
+	for (size_t i = 0; i < ops; i++) {
+		uint32_t net = (i * 2654435761U) % RRL_ADDRS;
+		memcpy(sin6->sin6_addr.s6_addr + 4, &net, sizeof(net));
+		BENCH_USE(rrl_query(ctx->rrl, &ctx->addr6, &ctx->rq, ctx->zone, NULL));
+	}
+}
+
+static void query_limited(void *data, size_t ops)
+{
+	ctx_t *ctx = data;
+	// A single source over its rate, most of the queries get limited.
+	sockaddr_set(&ctx->addr, AF_INET, "192.0.2.1", 0);
+	for (size_t i = 0; i < ops; i++) {
+		BENCH_USE(rrl_query(ctx->rrl, &ctx->addr, &ctx->rq, ctx->zone, NULL));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	bench_t b;
+	bench_init(&b, "rrl");
+
+	dnssec_crypto_init();
+
+	ctx_t ctx = { 0 };
+
+	knot_pkt_t *query = knot_pkt_new(NULL, 512, NULL);
+	knot_dname_t *qname = knot_dname_from_str_alloc("www.example.com.");
+	ctx.zone = knot_dname_from_str_alloc("example.com.");
+	ctx.rrl = rrl_create(RRL_SIZE, 100);
+	if (query == NULL || qname == NULL || ctx.zone == NULL || ctx.rrl == NULL ||
+	    knot_pkt_put_question(query, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A) != KNOT_EOK) {
+		bench_fail(&b, "rrl", "failed to prepare the query");
+		goto cleanup;
+	}
+
+	uint8_t rbuf[512];
+	memcpy(rbuf, query->wire, query->size);
+	knot_wire_flags_set_qr(rbuf);
+	ctx.rq.wire = rbuf;
+	ctx.rq.len = query->size;
+	ctx.rq.query = query;
+	ctx.rq.flags = 0;
+
+	sockaddr_set(&ctx.addr, AF_INET, "0.0.0.0", 0);
+	sockaddr_set(&ctx.addr6, AF_INET6, "2001:db8::", 0);
+
+	bench_run(&b, "query_v4", 10000000, query_v4, &ctx);
+	bench_run(&b, "query_v6", 10000000, query_v6, &ctx);
+	bench_run(&b, "query_limited", 10000000, query_limited, &ctx);
+
+cleanup:
+	rrl_destroy(ctx.rrl);
+	knot_dname_free(ctx.zone, NULL);
+	knot_dname_free(qname, NULL);
+	knot_pkt_free(query);
+	dnssec_crypto_cleanup();
+
+	return bench_exit(&b);
+}
@@ -0,0 +1,768 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*!
+ * \brief In-process query throughput of knotd without the network.
+ *
+ * The configuration and zones are loaded through the normal server path,
+ * then the queries from a file are fed directly to the query processing
+ * layer on several threads, the same way the UDP workers do (without the
+ * answer cache).
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <urcu.h>
+
+#include "libdnssec/crypto.h"
+#include "libknot/libknot.h"
+#include "contrib/macros.h"
+#include "contrib/sockaddr.h"
+#include "contrib/strtonum.h"
+#include "contrib/ucw/mempool.h"
+#include "knot/common/log.h"
+#include "knot/conf/conf.h"
+#include "knot/conf/migration.h"
+#include "knot/conf/module.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/query_module.h"
+#include "knot/server/server.h"
+
+#define PROGRAM_NAME	"knotd_qps"
+#define THREADS_MAX	64
+#define QUERIES_MAX	(16 * 1024 * 1024)
+#define CHECK_EVERY	1024
+
+/* Log-linear latency histogram, 8 buckets per power of two. */
+#define HIST_SUB	8
+#define HIST_SIZE	(64 * HIST_SUB)
+
+enum {
+	STAGE_PARSE,
+	STAGE_LOOKUP,
+	STAGE_MODULES,
+	STAGE_ANSWER,
+	STAGE_OTHER,
+	STAGE_TOTAL,
+	STAGES
+};
+
+static const char *stage_names[STAGES] = {
+	"parse", "lookup", "modules", "answer", "other", "total"
+};
+
+typedef struct {
+	uint8_t *wire;
+	uint16_t size;
+	int remote;   // Index of the source address, -1 for the default.
+} query_t;
+
+typedef struct {
+	query_t *queries;
+	size_t count;
+	struct sockaddr_storage *remotes;
+	size_t remotes_count;
+} query_set_t;
+
+typedef struct {
+	pthread_t thread;
+	unsigned id;
+	server_t *server;
+	const query_set_t *set;
+	const struct sockaddr_storage *remote;
+	volatile const bool *stop;
+	bool latency;
+	uint64_t processed;
+	uint64_t rcodes[16];
+	uint64_t stage_sum[STAGES];
+	uint32_t hist[STAGES][HIST_SIZE];
+} worker_t;
+
+static unsigned hist_index(uint64_t ns)
+{
+	if (ns < HIST_SUB) {
+		return ns;
+	}
+	unsigned bits = 63 - __builtin_clzll(ns);
+	return bits * HIST_SUB + ((ns >> (bits - 3)) & (HIST_SUB - 1));
+}
+
+static uint64_t hist_value(unsigned idx)
+{
+	if (idx < HIST_SUB) {
+		return idx;
+	}
+	unsigned bits = idx / HIST_SUB;
+	return (uint64_t)(HIST_SUB + idx % HIST_SUB) << (bits - 3);
+}
+
+static uint64_t hist_percentile(const uint32_t *hist, uint64_t total, double pct)
+{
+	uint64_t limit = total * pct, sum = 0;
+	for (unsigned i = 0; i < HIST_SIZE; i++) {
+		sum += hist[i];
+		if (sum > limit) {
+			return hist_value(i);
+		}
+	}
+	return 0;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int add_query(query_set_t *set, const uint8_t *wire, size_t size, int remote)
+{
+	if (set->count >= QUERIES_MAX || size < KNOT_WIRE_HEADER_SIZE ||
+	    size > KNOT_WIRE_MAX_PKTSIZE || knot_wire_get_qr(wire)) {
+		return KNOT_EOK; // Skipped.
+	}
+
+	if ((set->count & (set->count - 1)) == 0) { // Grow at powers of two.
+		size_t new_size = (set->count == 0) ? 1024 : 2 * set->count;
+		query_t *queries = realloc(set->queries, new_size * sizeof(*queries));
+		if (queries == NULL) {
+			return KNOT_ENOMEM;
+		}
+		set->queries = queries;
+	}
+
+	query_t *q = &set->queries[set->count];
+	q->wire = malloc(size);
+	if (q->wire == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memcpy(q->wire, wire, size);
+	q->size = size;
+	q->remote = remote;
+	set->count++;
+
+	return KNOT_EOK;
+}
+
+/* Text input, one 'name [type]' per line. */
+static int load_text(query_set_t *set, FILE *f, bool edns)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (pkt == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	knot_rrset_t opt;
+	int ret = knot_edns_init(&opt, KNOT_EDNS_MAX_UDP_PAYLOAD, 0, KNOT_EDNS_VERSION, NULL);
+	if (ret != KNOT_EOK) {
+		knot_pkt_free(pkt);
+		return ret;
+	}
+	knot_edns_set_do(&opt);
+
+	char line[1024];
+	unsigned lineno = 0;
+	while (ret == KNOT_EOK && fgets(line, sizeof(line), f) != NULL) {
+		lineno++;
+		char *name = strtok(line, " \t\r\n");
+		char *type = strtok(NULL, " \t\r\n");
+		if (name == NULL || name[0] == '#') {
+			continue;
+		}
+
+		uint16_t qtype = KNOT_RRTYPE_A;
+		if (type != NULL && knot_rrtype_from_string(type, &qtype) != 0) {
+			fprintf(stderr, "line %u: invalid type '%s'\n", lineno, type);
+			ret = KNOT_EINVAL;
+			break;
+		}
+		knot_dname_storage_t qname;
+		if (knot_dname_from_str(qname, name, sizeof(qname)) == NULL) {
+			fprintf(stderr, "line %u: invalid name '%s'\n", lineno, name);
+			ret = KNOT_EINVAL;
+			break;
+		}
+		knot_dname_to_lower(qname);
+
+		knot_pkt_clear(pkt);
+		knot_wire_set_id(pkt->wire, lineno);
+		ret = knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, qtype);
+		if (ret == KNOT_EOK && edns) {
+			ret = knot_pkt_begin(pkt, KNOT_ADDITIONAL);
+			if (ret == KNOT_EOK) {
+				ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, &opt, 0);
+			}
+		}
+		if (ret == KNOT_EOK) {
+			ret = add_query(set, pkt->wire, pkt->size, -1);
+		}
+	}
+
+	knot_rrset_clear(&opt, NULL);
+	knot_pkt_free(pkt);
+
+	return ret;
+}
+
+static uint32_t pcap_u32(const uint8_t *p, bool swap)
+{
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return swap ? __builtin_bswap32(val) : val;
+}
+
+static int pcap_remote(query_set_t *set, const struct sockaddr_storage *ss)
+{
+	// Consecutive queries from one source share the address.
+	if (set->remotes_count > 0 &&
+	    sockaddr_cmp(&set->remotes[set->remotes_count - 1], ss, false) == 0) {
+		return set->remotes_count - 1;
+	}
+
+	if ((set->remotes_count & (set->remotes_count - 1)) == 0) {
+		size_t new_size = (set->remotes_count == 0) ? 1024 : 2 * set->remotes_count;
+		struct sockaddr_storage *remotes = realloc(set->remotes,
+		                                           new_size * sizeof(*remotes));
+		if (remotes == NULL) {
+			return -1;
+		}
+		set->remotes = remotes;
+	}
+	set->remotes[set->remotes_count] = *ss;
+
+	return set->remotes_count++;
+}
+
+/* UDP queries to port 53 from a classic pcap file. */
+static int load_pcap(query_set_t *set, FILE *f, const uint8_t *hdr)
+{
+	uint32_t magic;
+	memcpy(&magic, hdr, sizeof(magic));
+	bool swap = (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1);
+	uint32_t linktype = pcap_u32(hdr + 20, swap);
+
+	size_t link_len;
+	switch (linktype) {
+	case 0:   link_len = 4;  break; // BSD loopback
+	case 1:   link_len = 14; break; // Ethernet
+	case 101: link_len = 0;  break; // Raw IP
+	case 113: link_len = 16; break; // Linux cooked
+	default:
+		fprintf(stderr, "unsupported pcap link type %u\n", linktype);
+		return KNOT_ENOTSUP;
+	}
+
+	static uint8_t frame[65536];
+	uint8_t rec[16];
+	while (fread(rec, sizeof(rec), 1, f) == 1) {
+		uint32_t caplen = pcap_u32(rec + 8, swap);
+		if (caplen > sizeof(frame) || fread(frame, caplen, 1, f) != 1) {
+			break;
+		}
+
+		const uint8_t *ip = frame + link_len;
+		if (caplen < link_len + 20) {
+			continue;
+		}
+		size_t len = caplen - link_len;
+
+		/* Skip a single VLAN tag. */
+		if (linktype == 1 && frame[12] == 0x81 && frame[13] == 0x00) {
+			ip += 4;
+			len -= 4;
+		}
+
+		struct sockaddr_storage ss = { 0 };
+		const uint8_t *udp;
+		if ((ip[0] >> 4) == 4) {
+			size_t ihl = (ip[0] & 0x0f) * 4;
+			if (ip[9] != IPPROTO_UDP || len < ihl + 8) {
+				continue;
+			}
+			struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+			sin->sin_family = AF_INET;
+			memcpy(&sin->sin_addr, ip + 12, 4);
+			memcpy(&sin->sin_port, ip + ihl, 2);
+			udp = ip + ihl;
+			len -= ihl;
+		} else if ((ip[0] >> 4) == 6 && len >= 48) {
+			if (ip[6] != IPPROTO_UDP) {
+				continue; // Extension headers aren't supported.
+			}
+			struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ss;
+			sin6->sin6_family = AF_INET6;
+			memcpy(&sin6->sin6_addr, ip + 8, 16);
+			memcpy(&sin6->sin6_port, ip + 40, 2);
+			udp = ip + 40;
+			len -= 40;
+		} else {
+			continue;
+		}
+
+		uint16_t dport = (udp[2] << 8) | udp[3];
+		uint16_t udp_len = (udp[4] << 8) | udp[5];
+		if (dport != 53 || udp_len < 8 || udp_len > len) {
+			continue;
+		}
+
+		int remote = pcap_remote(set, &ss);
+		if (remote < 0) {
+			return KNOT_ENOMEM;
+		}
+		int ret = add_query(set, udp + 8, udp_len - 8, remote);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static int load_queries(query_set_t *set, const char *path, bool edns)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		return knot_map_errno();
+	}
+
+	int ret;
+	uint8_t hdr[24];
+	uint32_t magic = 0;
+	if (fread(hdr, sizeof(hdr), 1, f) == 1) {
+		memcpy(&magic, hdr, sizeof(magic));
+	}
+	if (magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 ||   // Microseconds.
+	    magic == 0xa1b23c4d || magic == 0x4d3cb2a1) {   // Nanoseconds.
+		ret = load_pcap(set, f, hdr);
+	} else {
+		rewind(f);
+		ret = load_text(set, f, edns);
+	}
+
+	fclose(f);
+
+	return ret;
+}
+
+static void query_set_free(query_set_t *set)
+{
+	for (size_t i = 0; i < set->count; i++) {
+		free(set->queries[i].wire);
+	}
+	free(set->queries);
+	free(set->remotes);
+}
+
+static bool layer_active(int state)
+{
+	return (state == KNOT_STATE_PRODUCE || state == KNOT_STATE_FAIL);
+}
+
+static void latency_add(worker_t *w, unsigned stage, uint64_t ns)
+{
+	w->stage_sum[stage] += ns;
+	w->hist[stage][hist_index(ns)]++;
+}
+
+static void *worker_main(void *arg)
+{
+	worker_t *w = arg;
+
+	rcu_register_thread();
+
+	knot_mm_t mm;
+	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
+
+	knot_layer_t layer;
+	process_query_data_t data;
+	knot_layer_init(&layer, &mm, process_query_layer());
+	process_query_prealloc(&layer, &data);
+
+	knot_pkt_t query, ans;
+	uint8_t rx[KNOT_WIRE_MAX_PKTSIZE];
+	uint8_t tx[KNOT_WIRE_MAX_PKTSIZE];
+
+	const query_set_t *set = w->set;
+	// Start at different positions not to share the same queries.
+	size_t idx = (w->id * set->count) / THREADS_MAX;
+
+	while (!*w->stop) {
+		for (unsigned n = 0; n < CHECK_EVERY; n++) {
+			const query_t *q = &set->queries[idx];
+			if (++idx == set->count) {
+				idx = 0;
+			}
+
+			knotd_qdata_params_t params = {
+				.remote = (q->remote >= 0) ? &set->remotes[q->remote] : w->remote,
+				.flags = KNOTD_QUERY_FLAG_NO_AXFR | KNOTD_QUERY_FLAG_NO_IXFR |
+				         KNOTD_QUERY_FLAG_LIMIT_SIZE,
+				.socket = -1,
+				.server = w->server,
+				.thread_id = w->id
+			};
+
+			uint64_t begin = w->latency ? now_ns() : 0;
+
+			memcpy(rx, q->wire, q->size);
+			knot_layer_begin(&layer, &params);
+			(void)knot_pkt_init(&query, rx, q->size, layer.mm);
+			(void)knot_pkt_init(&ans, tx, sizeof(tx), layer.mm);
+			int ret = knot_pkt_parse(&query, 0);
+			if (ret != KNOT_EOK && query.parsed > 0) {
+				query.parsed--; // Leads to FORMERR as in the UDP handler.
+			}
+
+			uint64_t parsed = w->latency ? now_ns() : 0;
+
+			knot_layer_consume(&layer, &query);
+			while (layer_active(layer.state)) {
+				knot_layer_produce(&layer, &ans);
+			}
+			if (layer.state == KNOT_STATE_DONE) {
+				w->rcodes[knot_wire_get_rcode(ans.wire)]++;
+			}
+
+			if (w->latency) {
+				const knotd_qdata_timing_t *t = &data.qdata.timing;
+				uint64_t lookup = t->zone_lookup, modules = t->modules;
+				uint64_t answer = t->answer;
+				knot_layer_finish(&layer);
+				uint64_t end = now_ns();
+				uint64_t known = (parsed - begin) + lookup + modules + answer;
+				latency_add(w, STAGE_PARSE, parsed - begin);
+				latency_add(w, STAGE_LOOKUP, lookup);
+				latency_add(w, STAGE_MODULES, modules);
+				latency_add(w, STAGE_ANSWER, answer);
+				latency_add(w, STAGE_OTHER, (end - begin > known) ? end - begin - known : 0);
+				latency_add(w, STAGE_TOTAL, end - begin);
+			} else {
+				knot_layer_finish(&layer);
+			}
+
+			mp_flush(mm.ctx);
+		}
+		w->processed += CHECK_EVERY;
+	}
+
+	mp_delete(mm.ctx);
+
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+static int run(server_t *server, const query_set_t *set, unsigned threads,
+               unsigned duration, bool latency, double *base_qps)
+{
+	worker_t *workers = calloc(threads, sizeof(*workers));
+	if (workers == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	struct sockaddr_storage remote;
+	sockaddr_set(&remote, AF_INET, "127.0.0.1", 53);
+
+	volatile bool stop = false;
+	uint64_t begin = now_ns();
+	unsigned started = 0;
+	for (; started < threads; started++) {
+		worker_t *w = &workers[started];
+		w->id = started;
+		w->server = server;
+		w->set = set;
+		w->remote = &remote;
+		w->stop = &stop;
+		w->latency = latency;
+		if (pthread_create(&w->thread, NULL, worker_main, w) != 0) {
+			break;
+		}
+	}
+
+	struct timespec wait = { .tv_sec = duration };
+	nanosleep(&wait, NULL);
+	stop = true;
+
+	uint64_t processed = 0, rcodes[16] = { 0 };
+	for (unsigned i = 0; i < started; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+	double elapsed = (now_ns() - begin) / 1e9;
+
+	for (unsigned i = 0; i < started; i++) {
+		processed += workers[i].processed;
+		for (unsigned r = 0; r < 16; r++) {
+			rcodes[r] += workers[i].rcodes[r];
+		}
+	}
+
+	double qps = processed / elapsed;
+	if (*base_qps == 0) {
+		*base_qps = qps / started;
+	}
+	printf("%7u %12.0f %8.2f %8.1f%% %8.1f%%", started, qps, qps / *base_qps,
+	       100.0 * rcodes[KNOT_RCODE_NOERROR] / MAX(processed, 1),
+	       100.0 * rcodes[KNOT_RCODE_NXDOMAIN] / MAX(processed, 1));
+
+	if (latency) {
+		for (unsigned s = 0; s < STAGES; s++) {
+			uint64_t sum = 0;
+			for (unsigned i = 0; i < started; i++) {
+				sum += workers[i].stage_sum[s];
+			}
+			printf(" %8.0f", (double)sum / MAX(processed, 1));
+		}
+		// Merge the histograms of the total into the first worker.
+		for (unsigned i = 1; i < started; i++) {
+			for (unsigned b = 0; b < HIST_SIZE; b++) {
+				workers[0].hist[STAGE_TOTAL][b] += workers[i].hist[STAGE_TOTAL][b];
+			}
+		}
+		printf(" %8"PRIu64" %8"PRIu64,
+		       hist_percentile(workers[0].hist[STAGE_TOTAL], processed, 0.5),
+		       hist_percentile(workers[0].hist[STAGE_TOTAL], processed, 0.99));
+	}
+	printf("\n");
+
+	free(workers);
+
+	return (started == threads) ? KNOT_EOK : KNOT_ERROR;
+}
+
+static int set_config(const char *confdb, const char *config, size_t max_conf_size)
+{
+	conf_t *new_conf = NULL;
+	int ret = conf_new(&new_conf, conf_schema, confdb, max_conf_size, CONF_FREQMODULES);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to open configuration database '%s' (%s)\n",
+		        (confdb != NULL) ? confdb : "", knot_strerror(ret));
+		return ret;
+	}
+
+	if (config != NULL) {
+		ret = conf_import(new_conf, config, true, true);
+		if (ret != KNOT_EOK) {
+			fprintf(stderr, "failed to load configuration file '%s' (%s)\n",
+			        config, knot_strerror(ret));
+			conf_free(new_conf);
+			return ret;
+		}
+	}
+
+	(void)conf_migrate(new_conf);
+	conf_update(new_conf, CONF_UPD_FNONE);
+
+	return KNOT_EOK;
+}
+
+static int parse_threads(const char *str, unsigned *threads, unsigned *count)
+{
+	*count = 0;
+	while (*str != '\0' && *count < THREADS_MAX) {
+		char *end;
+		unsigned long val = strtoul(str, &end, 10);
+		if (end == str || val == 0 || val > THREADS_MAX || (*end != ',' && *end != '\0')) {
+			return KNOT_EINVAL;
+		}
+		threads[(*count)++] = val;
+		str = (*end == ',') ? end + 1 : end;
+	}
+
+	return (*count > 0) ? KNOT_EOK : KNOT_EINVAL;
+}
+
+static void print_help(void)
+{
+	printf("Usage: %s [parameters] -q <queries>\n"
+	       "\n"
+	       "Parameters:\n"
+	       " -c, --config <file>     Use a textual configuration file.\n"
+	       " -C, --confdb <dir>      Use a binary configuration database directory.\n"
+	       " -q, --queries <file>    Queries, 'name [type]' per line or a pcap file.\n"
+	       " -t, --threads <list>    Comma-separated numbers of threads (default 1).\n"
+	       " -d, --duration <sec>    Duration of each run (default 5).\n"
+	       " -e, --edns              Add EDNS with DO bit to the textual queries.\n"
+	       " -l, --latency           Measure per-stage latency (slows the processing).\n"
+	       " -h, --help              Print the program help.\n"
+	       "\n"
+	       "The number of threads is limited by the number of the configured workers.\n",
+	       PROGRAM_NAME);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *config = NULL;
+	const char *confdb = NULL;
+	const char *queries = NULL;
+	unsigned threads[THREADS_MAX] = { 1 };
+	unsigned threads_count = 1;
+	unsigned duration = 5;
+	bool edns = false;
+	bool latency = false;
+
+	struct option opts[] = {
+		{ "config",   required_argument, NULL, 'c' },
+		{ "confdb",   required_argument, NULL, 'C' },
+		{ "queries",  required_argument, NULL, 'q' },
+		{ "threads",  required_argument, NULL, 't' },
+		{ "duration", required_argument, NULL, 'd' },
+		{ "edns",     no_argument,       NULL, 'e' },
+		{ "latency",  no_argument,       NULL, 'l' },
+		{ "help",     no_argument,       NULL, 'h' },
+		{ NULL }
+	};
+
+	int opt = 0;
+	while ((opt = getopt_long(argc, argv, "c:C:q:t:d:elh", opts, NULL)) != -1) {
+		switch (opt) {
+		case 'c':
+			config = optarg;
+			break;
+		case 'C':
+			confdb = optarg;
+			break;
+		case 'q':
+			queries = optarg;
+			break;
+		case 't':
+			if (parse_threads(optarg, threads, &threads_count) != KNOT_EOK) {
+				print_help();
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'd':
+			if (str_to_u32(optarg, &duration) != KNOT_EOK || duration == 0) {
+				print_help();
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'e':
+			edns = true;
+			break;
+		case 'l':
+			latency = true;
+			break;
+		case 'h':
+			print_help();
+			return EXIT_SUCCESS;
+		default:
+			print_help();
+			return EXIT_FAILURE;
+		}
+	}
+	if (queries == NULL || (config == NULL) == (confdb == NULL) || argc - optind > 0) {
+		print_help();
+		return EXIT_FAILURE;
+	}
+
+	query_set_t set = { 0 };
+	int ret = load_queries(&set, queries, edns);
+	if (ret != KNOT_EOK || set.count == 0) {
+		fprintf(stderr, "failed to load queries from '%s' (%s)\n", queries,
+		        (ret != KNOT_EOK) ? knot_strerror(ret) : "no query");
+		query_set_free(&set);
+		return EXIT_FAILURE;
+	}
+
+	dnssec_crypto_init();
+	log_init();
+
+	ret = set_config(confdb, config, (size_t)CONF_MAPSIZE * 1024 * 1024);
+	if (ret != KNOT_EOK) {
+		goto failed_conf;
+	}
+	log_reconfigure(conf());
+
+	unsigned workers = conf()->cache.srv_udp_threads + conf()->cache.srv_tcp_threads +
+	                   conf()->cache.srv_xdp_threads;
+	for (unsigned i = 0; i < threads_count; i++) {
+		if (threads[i] > workers) {
+			fprintf(stderr, "%u threads exceed %u configured workers\n",
+			        threads[i], workers);
+			ret = KNOT_EINVAL;
+			goto failed_server;
+		}
+	}
+
+	server_t server;
+	ret = server_init(&server, conf()->cache.srv_bg_threads);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to initialize server (%s)\n", knot_strerror(ret));
+		goto failed_server;
+	}
+	server.state |= ServerNoIO;
+
+	ret = server_reconfigure(conf(), &server);
+	if (ret != KNOT_EOK) {
+		fprintf(stderr, "failed to configure server (%s)\n", knot_strerror(ret));
+		server_wait(&server);
+		server_deinit(&server);
+		goto failed_server;
+	}
+
+	conf_activate_modules(conf(), &server, NULL, conf()->query_modules,
+	                      &conf()->query_plan);
+
+	rcu_register_thread();
+
+	/* Load the zones synchronously. */
+	server_update_zones(conf(), &server);
+	ret = server_start(&server, false);
+	if (ret == KNOT_EOK) {
+		printf("%zu queries, %zu zones, %u s per run\n", set.count,
+		       knot_zonedb_size(server.zone_db), duration);
+		printf("%7s %12s %8s %9s %9s", "threads", "qps", "scaling", "noerror", "nxdomain");
+		if (latency) {
+			query_module_timing_request(true);
+			for (unsigned s = 0; s < STAGES; s++) {
+				printf(" %8s", stage_names[s]);
+			}
+			printf(" %8s %8s", "p50", "p99");
+		}
+		printf("\n");
+
+		double base_qps = 0;
+		for (unsigned i = 0; i < threads_count && ret == KNOT_EOK; i++) {
+			ret = run(&server, &set, threads[i], duration, latency, &base_qps);
+		}
+		if (latency) {
+			query_module_timing_request(false);
+		}
+	} else {
+		fprintf(stderr, "failed to start server (%s)\n", knot_strerror(ret));
+	}
+
+	server_stop(&server);
+	server_wait(&server);
+	server_deinit(&server);
+	rcu_unregister_thread();
+failed_server:
+	conf_free(conf());
+failed_conf:
+	log_close();
+	dnssec_crypto_cleanup();
+	query_set_free(&set);
+
+	return (ret == KNOT_EOK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+
+'''Outgoing AXFR duration for various zone sizes.'''
+
+from dnstest.utils import *
+from dnstest.test import Test
+from dnstest.perf import *
+
+ROUNDS = 3
+
+t = Test(tsig=False, stress=False)
+perf = Perf("axfr")
+
+master = t.server("knot", valgrind=False)
+slave = t.server("knot", valgrind=False)
+
+zones = dict()
+for records in perf_sizes():
+    zone = t.zone_rnd(1, dnssec=False, records=records)
+    t.link(zone, master, slave)
+    zones[records] = zone
+
+t.start()
+
+for records, zone in zones.items():
+    serial = master.zone_wait(zone)
+    slave.zone_wait(zone, serial, equal=True, greater=False)
+
+    pattern = "[%s] AXFR, outgoing" % zone[0].name
+    serves = []
+    for _ in range(ROUNDS):
+        done = log_count(master, pattern, "finished")
+        slave.ctl("zone-retransfer %s" % zone[0].name, wait=True)
+        for _ in range(50):
+            if log_count(master, pattern, "finished") > done:
+                break
+            t.sleep(0.1)
+        # Measured by the master from the first to the last message.
+        serves.append(log_seconds(master, pattern))
+    perf.measure("serve_time", records, sorted(serves)[ROUNDS // 2], "s")
+
+perf.check()
+
+t.end()
@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+
+'''DDNS commit rate for various zone sizes.'''
+
+from dnstest.utils import *
+from dnstest.test import Test
+from dnstest.perf import *
+
+UPDATES = 200
+
+t = Test(tsig=False, stress=False)
+perf = Perf("ddns")
+
+master = t.server("knot", valgrind=False)
+
+zones = dict()
+for records in perf_sizes():
+    zone = t.zone_rnd(1, dnssec=False, records=records)
+    t.link(zone, master, ddns=True)
+    zones[records] = zone
+
+t.start()
+
+for records, zone in zones.items():
+    master.zone_wait(zone)
+
+    # Each update is committed separately as the client waits for the answer.
+    with Timer() as timer:
+        for i in range(UPDATES):
+            up = master.update(zone)
+            up.add("perf%i.%s" % (i, zone[0].name), 3600, "A", "192.0.2.%i" % (i % 256))
+            up.send("NOERROR")
+    perf.measure("commit_rate", records, UPDATES / timer.seconds, "updates/s",
+                 higher_better=True)
+
+perf.check()
+
+t.end()
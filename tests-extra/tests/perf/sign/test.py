@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+
+'''Full zone re-sign duration for various zone sizes.'''
+
+from dnstest.utils import *
+from dnstest.test import Test
+from dnstest.perf import *
+
+ROUNDS = 3
+
+t = Test(tsig=False, stress=False)
+perf = Perf("sign")
+
+master = t.server("knot", valgrind=False)
+
+zones = dict()
+for records in perf_sizes():
+    zone = t.zone_rnd(1, dnssec=False, records=records)
+    t.link(zone, master)
+    master.dnssec(zone).enable = True
+    master.dnssec(zone).alg = "ecdsap256sha256"
+    zones[records] = zone
+
+t.start()
+
+for records, zone in zones.items():
+    serial = master.zone_wait(zone)
+
+    signs = []
+    for _ in range(ROUNDS):
+        with Timer() as timer:
+            master.ctl("zone-sign %s" % zone[0].name, wait=True)
+        signs.append(timer.seconds)
+        serial = master.zone_wait(zone, serial)
+    perf.measure("resign_time", records, sorted(signs)[ROUNDS // 2], "s")
+
+perf.check()
+
+t.end()
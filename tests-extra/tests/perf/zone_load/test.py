@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+
+'''Zone load time and memory footprint for various zone sizes.'''
+
+from dnstest.utils import *
+from dnstest.test import Test
+from dnstest.perf import *
+
+ROUNDS = 3
+
+t = Test(tsig=False, stress=False)
+perf = Perf("zone_load")
+
+servers = dict()
+for records in perf_sizes():
+    server = t.server("knot", valgrind=False)
+    zone = t.zone_rnd(1, dnssec=False, records=records)
+    t.link(zone, server)
+    servers[records] = (server, zone)
+
+t.start()
+
+for records, (server, zone) in servers.items():
+    server.zone_wait(zone)
+    perf.measure("rss", records, rss_mib(server), "MiB")
+
+    loads = []
+    for _ in range(ROUNDS):
+        with Timer() as timer:
+            server.ctl("zone-reload %s" % zone[0].name, wait=True)
+        loads.append(timer.seconds)
+    perf.measure("load_time", records, sorted(loads)[ROUNDS // 2], "s")
+
+perf.check()
+
+t.end()
@@ -69,6 +69,17 @@ bind_ctl = get_binary("KNOT_TEST_BINDC", "rndc")
 # KNOT_TEST_OUTS_DIR - working directories location.
 outs_dir = get_param("KNOT_TEST_OUTS_DIR", "/tmp")
 
+# KNOT_TEST_PERF_RECORDS - comma-separated zone sizes for the perf tests.
+perf_records = get_param("KNOT_TEST_PERF_RECORDS", "10000,50000")
+# KNOT_TEST_PERF_TOLERANCE - allowed relative degradation against the baseline.
+perf_tolerance = float(get_param("KNOT_TEST_PERF_TOLERANCE", "0.25") or 0)
+# KNOT_TEST_PERF_BASELINE - file with the stored perf baselines.
+perf_baseline = get_param("KNOT_TEST_PERF_BASELINE",
+                          os.path.join(module_path, "..", "..", "tests", "perf",
+                                       "baselines.json"))
+# KNOT_TEST_PERF_UPDATE - store the measured values as the new baselines.
+perf_update = get_param("KNOT_TEST_PERF_UPDATE", "") not in ["", "0"]
+
 # HOME - tester's home directory for the "knottest-last" symbolic link.
 home_dir = get_param("HOME", "/tmp")
 
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+
+'''Performance measurements compared against stored baselines.'''
+
+import fcntl
+import json
+import os
+import time
+
+import psutil
+
+from dnstest.utils import *
+import dnstest.params as params
+
+def perf_sizes():
+    '''Zone sizes (number of records) the perf tests are run for.'''
+
+    return [int(n) for n in params.perf_records.split(",") if n.strip()]
+
+def rss_mib(server):
+    '''Resident set size of the server process in MiB.'''
+
+    return psutil.Process(server.proc.pid).memory_info().rss / (1024 * 1024)
+
+def log_count(server, *patterns):
+    '''Number of the log lines containing all the patterns.'''
+
+    with open(server.fout) as log:
+        return sum(1 for line in log if all(p in line for p in patterns))
+
+def log_seconds(server, pattern):
+    '''Duration from the last log line with the pattern in form "..., X seconds".'''
+
+    value = None
+    with open(server.fout) as log:
+        for line in log:
+            if pattern in line and " seconds" in line:
+                words = line.split(" seconds")[0].split()
+                try:
+                    value = float(words[-1])
+                except ValueError:
+                    pass
+    if value is None:
+        raise Failed("No duration for '%s' in the log of server='%s'" %
+                     (pattern, server.name))
+    return value
+
+class Timer(object):
+    '''Wall-clock duration of a with-block in seconds.'''
+
+    def __enter__(self):
+        self.begin = time.monotonic()
+        return self
+
+    def __exit__(self, *args):
+        self.seconds = time.monotonic() - self.begin
+
+class Perf(object):
+    '''Collection of the metrics of one test case.
+
+    A metric fails if it's worse than the baseline by more than the tolerance
+    (KNOT_TEST_PERF_TOLERANCE). Metrics without a baseline are just logged.
+    With KNOT_TEST_PERF_UPDATE set, the measured values become the baselines.
+    '''
+
+    def __init__(self, case):
+        self.case = case
+        self.values = dict()
+
+    def _key(self, metric, records):
+        return "%s/%s/%i" % (self.case, metric, records)
+
+    def measure(self, metric, records, value, unit, higher_better=False):
+        '''Records a measured value.'''
+
+        key = self._key(metric, records)
+        self.values[key] = (value, unit, higher_better)
+        check_log("PERF %s = %.3f %s" % (key, value, unit))
+
+    def _load(self, f):
+        f.seek(0)
+        content = f.read()
+        return json.loads(content) if content.strip() else dict()
+
+    def check(self):
+        '''Compares the values with the baselines, updates them if requested.'''
+
+        path = params.perf_baseline
+        mode = "a+" if params.perf_update else "r"
+        if not params.perf_update and not os.path.isfile(path):
+            baselines = dict()
+            f = None
+        else:
+            f = open(path, mode)
+            fcntl.flock(f, fcntl.LOCK_EX) # Parallel jobs share the file.
+            baselines = self._load(f)
+
+        for key, (value, unit, higher_better) in sorted(self.values.items()):
+            base = baselines.get(key)
+            if base is None or params.perf_tolerance <= 0:
+                continue
+            if higher_better:
+                limit = base / (1 + params.perf_tolerance)
+                worse = value < limit
+            else:
+                limit = base * (1 + params.perf_tolerance)
+                worse = value > limit
+            if worse:
+                set_err("PERF %s" % key)
+                check_log("ERROR: PERF %s" % key)
+                detail_log("  %.3f %s, baseline %.3f %s, limit %.3f %s" %
+                           (value, unit, base, unit, limit, unit))
+                detail_log(SEP)
+
+        if f is not None and params.perf_update:
+            for key, (value, unit, higher_better) in self.values.items():
+                baselines[key] = round(value, 3)
+            f.seek(0)
+            f.truncate()
+            json.dump(baselines, f, indent=2, sort_keys=True)
+            f.write("\n")
+        if f is not None:
+            f.close()
@@ -28,7 +28,7 @@
 
 int main(int argc, char *argv[])
 {
-	plan(67);
+	plan(70);
 
 	int32_t  ret;
 	uint8_t  in[BUF_LEN], ref[BUF_LEN], out[BUF_LEN], out2[BUF_LEN], *out3;
@@ -263,5 +263,29 @@ int main(int argc, char *argv[])
 	ret = knot_base32hex_decode((uint8_t *)"$AAAAAAA", 8, out, BUF_LEN);
 	ok(ret == KNOT_BASE32HEX_ECHAR, "Bad data character dollar on position 1");
 
+	// Long data, processed in vectorized blocks if available
+	for (int i = 0; i < 150; i++) {
+		in[i] = i * 37;
+	}
+	bool same = true;
+	ret = knot_base32hex_encode(in, 150, out, BUF_LEN);
+	for (int i = 0; i < 150; i += 5) {
+		same &= (knot_base32hex_encode(in + i, 5, out2, BUF_LEN) == 8 &&
+		         memcmp(out + (i / 5) * 8, out2, 8) == 0);
+	}
+	ok(ret == 240 && same, "Long data - ENC output");
+	ret = knot_base32hex_decode(out, 240, out2, BUF_LEN);
+	ok(ret == 150 && memcmp(out2, in, 150) == 0, "Long data - DEC output");
+	bool bad = true;
+	for (int i = 0; i < 240; i++) {
+		uint8_t c = out[i];
+		out[i] = '$';
+		bad &= (knot_base32hex_decode(out, 240, out2, BUF_LEN) == KNOT_BASE32HEX_ECHAR);
+		out[i] = 0xC3;
+		bad &= (knot_base32hex_decode(out, 240, out2, BUF_LEN) == KNOT_BASE32HEX_ECHAR);
+		out[i] = c;
+	}
+	ok(bad, "Long data - bad character on any position");
+
 	return 0;
 }
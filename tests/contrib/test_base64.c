@@ -28,7 +28,7 @@
 
 int main(int argc, char *argv[])
 {
-	plan(52);
+	plan(55);
 
 	int32_t  ret;
 	uint8_t  in[BUF_LEN], ref[BUF_LEN], out[BUF_LEN], out2[BUF_LEN], *out3;
@@ -233,5 +233,29 @@ int main(int argc, char *argv[])
 	ret = knot_base64_decode((uint8_t *)"AAA ", 4, out, BUF_LEN);
 	ok(ret == KNOT_BASE64_ECHAR, "Bad data character space");
 
+	// Long data, processed in vectorized blocks if available
+	for (int i = 0; i < 180; i++) {
+		in[i] = i * 37;
+	}
+	bool same = true;
+	ret = knot_base64_encode(in, 180, out, BUF_LEN);
+	for (int i = 0; i < 180; i += 3) {
+		same &= (knot_base64_encode(in + i, 3, out2, BUF_LEN) == 4 &&
+		         memcmp(out + (i / 3) * 4, out2, 4) == 0);
+	}
+	ok(ret == 240 && same, "Long data - ENC output");
+	ret = knot_base64_decode(out, 240, out2, BUF_LEN);
+	ok(ret == 180 && memcmp(out2, in, 180) == 0, "Long data - DEC output");
+	bool bad = true;
+	for (int i = 0; i < 240; i++) {
+		uint8_t c = out[i];
+		out[i] = '$';
+		bad &= (knot_base64_decode(out, 240, out2, BUF_LEN) == KNOT_BASE64_ECHAR);
+		out[i] = 0xC3;
+		bad &= (knot_base64_decode(out, 240, out2, BUF_LEN) == KNOT_BASE64_ECHAR);
+		out[i] = c;
+	}
+	ok(bad, "Long data - bad character on any position");
+
 	return 0;
 }
@@ -0,0 +1,77 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <string.h>
+#include <tap/basic.h>
+
+#include "contrib/bufpool.h"
+
+#define BUFS 64
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	ok(buf_pool_size(1) == 512 && buf_pool_size(512) == 512, "bufpool: small class");
+	ok(buf_pool_size(513) == 4096, "bufpool: medium class");
+	ok(buf_pool_size(BP_MAX_SIZE) == BP_MAX_SIZE, "bufpool: max class");
+	ok(buf_pool_size(BP_MAX_SIZE + 1) == 0, "bufpool: too big");
+
+	buf_pool_t pool;
+	buf_pool_init(&pool, BUFS / 2);
+
+	ok(buf_pool_get(&pool, BP_MAX_SIZE + 1) == NULL, "bufpool: get too big");
+
+	void *bufs[BUFS];
+	bool got = true;
+	for (size_t i = 0; i < BUFS; i++) {
+		size_t size = 1 + (i * 1021) % BP_MAX_SIZE;
+		bufs[i] = buf_pool_get(&pool, size);
+		got &= (bufs[i] != NULL);
+		if (bufs[i] != NULL) {
+			memset(bufs[i], 0x5a, buf_pool_size(size));
+		}
+	}
+	ok(got, "bufpool: get buffers");
+
+	for (size_t i = 0; i < BUFS; i++) {
+		buf_pool_put(&pool, bufs[i], 1 + (i * 1021) % BP_MAX_SIZE);
+	}
+	unsigned kept = 0;
+	bool limited = true;
+	for (int i = 0; i < BP_CLASSES; i++) {
+		kept += pool.count[i];
+		limited &= (pool.count[i] <= BUFS / 2);
+	}
+	ok(kept > 0 && limited, "bufpool: returned buffers kept up to limit");
+
+	void *small = pool.free[0];
+	void *reused = buf_pool_get(&pool, 100);
+	ok(small != NULL && reused == small, "bufpool: buffer reused");
+	buf_pool_put(&pool, reused, 100);
+	buf_pool_put(&pool, NULL, 100);
+
+	buf_pool_deinit(&pool);
+	ok(pool.count[0] == 0 && pool.free[0] == NULL, "bufpool: deinit");
+
+	void *plain = buf_pool_get(NULL, 10);
+	ok(plain != NULL, "bufpool: no pool");
+	buf_pool_put(NULL, plain, 10);
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "contrib/hugepool.h"
+#include "libknot/errcode.h"
+#include "contrib/qp-trie/trie.h"
+
+#define BLOCKS 20000
+#define KEYS 50000
+
+static void *blocks[BLOCKS];
+
+static void test_blocks(hp_pool_t *pool)
+{
+	bool aligned = true;
+	for (size_t i = 0; i < BLOCKS; i++) {
+		size_t size = 1 + i % HP_MAX_BLOCK;
+		blocks[i] = hp_alloc(pool, size);
+		if (blocks[i] == NULL) {
+			break;
+		}
+		aligned &= ((uintptr_t)blocks[i] % HP_ALIGN == 0);
+		memset(blocks[i], i & 0xff, size);
+	}
+	ok(blocks[BLOCKS - 1] != NULL, "hugepool: allocate blocks");
+	ok(aligned, "hugepool: blocks aligned");
+
+	bool intact = true;
+	for (size_t i = 0; i < BLOCKS; i++) {
+		size_t size = 1 + i % HP_MAX_BLOCK;
+		uint8_t *b = blocks[i];
+		intact &= (b[0] == (i & 0xff) && b[size - 1] == (i & 0xff));
+	}
+	ok(intact, "hugepool: blocks don't overlap");
+
+	size_t mapped = pool->mapped;
+	for (size_t i = 0; i < BLOCKS; i += 2) {
+		hp_free(blocks[i]);
+	}
+	bool reused = true;
+	for (size_t i = 0; i < BLOCKS; i += 2) {
+		size_t size = 1 + i % HP_MAX_BLOCK;
+		blocks[i] = hp_alloc(pool, size);
+		reused &= (blocks[i] != NULL);
+	}
+	ok(reused && pool->mapped == mapped, "hugepool: freed blocks reused");
+
+	for (size_t i = 0; i < BLOCKS; i++) {
+		hp_free(blocks[i]);
+	}
+	hp_free(NULL);
+}
+
+static void test_large(hp_pool_t *pool)
+{
+	size_t mapped = pool->mapped;
+	uint8_t *big = hp_alloc(pool, 3 * HP_CHUNK_SIZE);
+	ok(big != NULL && pool->mapped >= mapped + 3 * HP_CHUNK_SIZE,
+	   "hugepool: large block");
+	if (big != NULL) {
+		memset(big, 0xaa, 3 * HP_CHUNK_SIZE);
+	}
+	void *small = hp_alloc(pool, 24);
+	ok(small != NULL, "hugepool: small block after large");
+	hp_free(big);
+	ok(pool->mapped == mapped, "hugepool: large block unmapped");
+	hp_free(small);
+}
+
+static void test_trie(hp_pool_t *pool)
+{
+	knot_mm_t mm;
+	mm_ctx_hugepool(&mm, pool);
+
+	trie_t *trie = trie_create(&mm);
+	ok(trie != NULL, "hugepool: trie create");
+	if (trie == NULL) {
+		return;
+	}
+
+	char key[32];
+	for (uintptr_t i = 0; i < KEYS; i++) {
+		int len = snprintf(key, sizeof(key), "key%zu", (size_t)i);
+		*trie_get_ins(trie, (trie_key_t *)key, len) = (void *)i;
+	}
+	for (uintptr_t i = 0; i < KEYS; i += 3) {
+		int len = snprintf(key, sizeof(key), "key%zu", (size_t)i);
+		trie_del(trie, (trie_key_t *)key, len, NULL);
+	}
+	bool found = true;
+	for (uintptr_t i = 0; i < KEYS; i++) {
+		int len = snprintf(key, sizeof(key), "key%zu", (size_t)i);
+		trie_val_t *val = trie_get_try(trie, (trie_key_t *)key, len);
+		found &= (i % 3 == 0) ? (val == NULL) : (val != NULL && *val == (void *)i);
+	}
+	ok(found && trie_weight(trie) == KEYS - (KEYS + 2) / 3, "hugepool: trie contents");
+
+	trie_free(trie);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	hp_pool_t pool;
+	hp_pool_init(&pool, HP_POLICY_LOCAL);
+	test_blocks(&pool);
+	test_large(&pool);
+	test_trie(&pool);
+	hp_pool_deinit(&pool);
+	ok(pool.mapped == 0, "hugepool: deinit");
+
+	hp_pool_init(&pool, HP_POLICY_INTERLEAVE);
+	test_trie(&pool);
+	hp_pool_deinit(&pool);
+
+	ok(hp_pool_init_cold(&pool, NULL) == KNOT_EOK, "hugepool: cold init");
+	test_blocks(&pool);
+	hp_pool_advise_cold(&pool);
+	hp_pool_deinit(&pool);
+
+	char *dir = test_tmpdir();
+	ok(dir != NULL && hp_pool_init_cold(&pool, dir) == KNOT_EOK,
+	   "hugepool: file-backed init");
+	if (dir != NULL) {
+		test_blocks(&pool);
+		test_large(&pool);
+		ok(pool.fd >= 0 && pool.file_size >= pool.mapped, "hugepool: file-backed");
+		hp_pool_deinit(&pool);
+		test_rm_rf(dir);
+		free(dir);
+	}
+	ok(hp_pool_init_cold(&pool, "/nonexistent") != KNOT_EOK,
+	   "hugepool: file-backed init, invalid directory");
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "contrib/ipset.h"
+#include "contrib/sockaddr.h"
+#include "libknot/errcode.h"
+
+static struct sockaddr_storage addr(const char *str)
+{
+	struct sockaddr_storage ss = { 0 };
+	int family = (strchr(str, ':') != NULL) ? AF_INET6 : AF_INET;
+	(void)sockaddr_set(&ss, family, str, 0);
+	return ss;
+}
+
+static void add_prefix(ipset_t *set, const char *str, int prefix)
+{
+	struct sockaddr_storage ss = addr(str);
+	int ret = ipset_add_prefix(set, &ss, prefix);
+	is_int(KNOT_EOK, ret, "add prefix %s/%i", str, prefix);
+}
+
+static void add_range(ipset_t *set, const char *min_str, const char *max_str)
+{
+	struct sockaddr_storage min = addr(min_str), max = addr(max_str);
+	int ret = ipset_add_range(set, &min, &max);
+	is_int(KNOT_EOK, ret, "add range %s-%s", min_str, max_str);
+}
+
+static void check(const ipset_t *set, const char *str, bool expected)
+{
+	struct sockaddr_storage ss = addr(str);
+	ok(ipset_match(set, &ss) == expected, "%s %s", str,
+	   expected ? "matches" : "doesn't match");
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	ipset_t *set = ipset_new();
+	ok(set != NULL, "create set");
+
+	ipset_finalize(set);
+	check(set, "192.0.2.1", false);
+	ipset_free(set);
+
+	set = ipset_new();
+	add_prefix(set, "192.0.2.0", 24);
+	add_prefix(set, "192.0.2.128", 25);     // Nested.
+	add_prefix(set, "198.51.100.7", -1);    // Single address.
+	add_range(set, "10.0.0.100", "10.0.1.5");
+	add_range(set, "10.0.1.0", "10.0.2.0"); // Overlapping.
+	add_range(set, "10.9.0.0", "10.8.0.0"); // Empty.
+	add_prefix(set, "2001:db8:1::", 48);
+	add_prefix(set, "2001:db8:1:2::", 64);
+	ipset_finalize(set);
+
+	check(set, "192.0.2.0", true);
+	check(set, "192.0.2.255", true);
+	check(set, "192.0.3.0", false);
+	check(set, "192.0.1.255", false);
+	check(set, "198.51.100.7", true);
+	check(set, "198.51.100.8", false);
+	check(set, "10.0.0.99", false);
+	check(set, "10.0.0.100", true);
+	check(set, "10.0.1.200", true);
+	check(set, "10.0.2.0", true);
+	check(set, "10.0.2.1", false);
+	check(set, "10.8.5.5", false);
+	check(set, "2001:db8:1:ffff::1", true);
+	check(set, "2001:db8:2::", false);
+	check(set, "::ffff:192.0.2.1", false);
+	check(set, "0.0.0.0", false);
+
+	ipset_free(set);
+
+	set = ipset_new();
+	add_prefix(set, "::", 0);
+	ipset_finalize(set);
+	check(set, "::", true);
+	check(set, "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", true);
+	check(set, "192.0.2.1", false);
+	ipset_free(set);
+
+	return 0;
+}
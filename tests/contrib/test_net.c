@@ -616,6 +616,120 @@ static void test_nonblocking_accept(void)
 	close(server);
 }
 
+static void test_dns_tcp_ready(void)
+{
+	int r;
+
+	struct sockaddr_storage addr_server = addr_local();
+	int server = net_bound_socket(SOCK_STREAM, &addr_server, 0);
+	ok(server >= 0, "server, create socket");
+	r = listen(server, LISTEN_BACKLOG);
+	is_int(0, r, "server, start listening");
+	addr_server = addr_from_socket(server);
+
+	int client = net_connected_socket(SOCK_STREAM, &addr_server, NULL, false);
+	ok(client >= 0, "client, create connected socket");
+	r = poll_read(server);
+	is_int(1, r, "server, pending connection");
+	int accepted = net_accept(server, NULL);
+	ok(accepted >= 0, "server, accept connection");
+
+	ok(!net_dns_tcp_ready(accepted), "no message ready");
+
+	// two pipelined messages, the second one incomplete
+	const uint8_t msgs[] = { 0x00, 0x02, 'a', 'b', 0x00, 0x03, 'c' };
+	r = net_stream_send(client, msgs, sizeof(msgs), TIMEOUT);
+	is_int(sizeof(msgs), r, "client, send messages");
+	r = poll_read(accepted);
+	is_int(1, r, "server, pending data");
+
+	ok(net_dns_tcp_ready(accepted), "first message ready");
+	uint8_t buf[16];
+	r = net_dns_tcp_recv(accepted, buf, sizeof(buf), TIMEOUT);
+	is_int(2, r, "receive first message");
+	ok(!net_dns_tcp_ready(accepted), "incomplete message not ready");
+
+	close(accepted);
+	close(client);
+	close(server);
+}
+
+static void test_stream_sendv(void)
+{
+	int r;
+
+	struct sockaddr_storage addr_server = addr_local();
+	int server = net_bound_socket(SOCK_STREAM, &addr_server, 0);
+	ok(server >= 0, "server, create socket");
+	r = listen(server, LISTEN_BACKLOG);
+	is_int(0, r, "server, start listening");
+	addr_server = addr_from_socket(server);
+
+	int client = net_connected_socket(SOCK_STREAM, &addr_server, NULL, false);
+	ok(client >= 0, "client, create connected socket");
+	r = poll_read(server);
+	is_int(1, r, "server, pending connection");
+	int accepted = net_accept(server, NULL);
+	ok(accepted >= 0, "server, accept connection");
+
+	uint8_t part1[] = { 'a', 'b', 'c' }, part2[] = { 'd', 'e' };
+	struct iovec parts[2] = {
+		{ .iov_base = part1, .iov_len = sizeof(part1) },
+		{ .iov_base = part2, .iov_len = sizeof(part2) },
+	};
+	r = net_stream_sendv(accepted, parts, 2, TIMEOUT);
+	is_int(5, r, "server, gathered send");
+	uint8_t gathered[8] = { 0 };
+	r = poll_read(client);
+	r = net_stream_recv(client, gathered, sizeof(gathered), TIMEOUT);
+	ok(r == 5 && memcmp(gathered, "abcde", 5) == 0, "client, receive gathered data");
+
+	r = net_zerocopy_enable(accepted);
+	if (r == KNOT_ENOTSUP) {
+		skip("zero-copy not supported on this system");
+		goto cleanup;
+	}
+	is_int(KNOT_EOK, r, "server, enable zero-copy");
+
+	static uint8_t data[3][32 * 1024];
+	unsigned sends = 0, done = 0;
+	bool sent = true;
+	for (int i = 0; i < 3; i++) {
+		memset(data[i], 'a' + i, sizeof(data[i]));
+	}
+	struct iovec iov[2] = {
+		{ .iov_base = data[0], .iov_len = sizeof(data[0]) },
+		{ .iov_base = data[1], .iov_len = sizeof(data[1]) },
+	};
+	r = net_zerocopy_sendv(accepted, iov, 2, TIMEOUT, &sends);
+	sent = (r == 2 * sizeof(data[0]));
+	iov[0].iov_base = data[2];
+	iov[0].iov_len = sizeof(data[2]);
+	r = net_zerocopy_sendv(accepted, iov, 1, TIMEOUT, &sends);
+	sent = sent && (r == sizeof(data[2]));
+	ok(sent && sends >= 2, "server, zero-copy send");
+
+	static uint8_t buf[sizeof(data)];
+	size_t received = 0;
+	while (received < sizeof(buf) &&
+	       (r = net_stream_recv(client, buf + received, sizeof(buf) - received, TIMEOUT)) > 0) {
+		received += r;
+	}
+	ok(received == sizeof(buf) && memcmp(buf, data, sizeof(buf)) == 0, "client, receive data");
+
+	r = net_zerocopy_wait(accepted, &done, sends, TIMEOUT);
+	ok(r == KNOT_EOK && done == sends, "server, sends completed");
+	r = net_zerocopy_wait(accepted, &done, sends, 0);
+	ok(r == KNOT_EOK && done == sends, "server, nothing more to complete");
+	r = net_zerocopy_wait(accepted, &done, sends + 1, 0);
+	is_int(KNOT_ETIMEOUT, r, "server, pending send timeout");
+
+cleanup:
+	close(accepted);
+	close(client);
+	close(server);
+}
+
 static void test_socket_types(void)
 {
 	struct sockaddr_storage addr = addr_local();
@@ -708,6 +822,10 @@ int main(int argc, char *argv[])
 
 	diag("DNS messages over TCP");
 	test_dns_tcp();
+	test_dns_tcp_ready();
+
+	diag("gathered and zero-copy output");
+	test_stream_sendv();
 
 	diag("flag NET_BIND_MULTIPLE");
 	test_bind_multiple();
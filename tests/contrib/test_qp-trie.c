@@ -21,6 +21,7 @@
 
 #include "contrib/qp-trie/trie.h"
 #include "contrib/macros.h"
+#include "contrib/mempattern.h"
 #include "contrib/string.h"
 #include "libknot/dname.h"
 #include "libknot/errcode.h"
@@ -178,6 +179,210 @@ static void test_wildcards(void)
 	ok(true, "trie: wildcard searches");
 }
 
+static void test_prefixes(void)
+{
+	/* Keys. */
+	const char *keys[] = { "", "a", "abc", "abcdef", "abd", "b", "bcd" };
+	/* Query-answer pairs for the longest prefix search. */
+	const char *qa_pairs[][2] = {
+		{ "", "" },
+		{ "x", "" },
+		{ "a", "a" },
+		{ "ab", "a" },
+		{ "abc", "abc" },
+		{ "abce", "abc" },
+		{ "abcdeg", "abc" },
+		{ "abcdefgh", "abcdef" },
+		{ "abda", "abd" },
+		{ "bc", "b" },
+		{ "bcde", "bcd" },
+	};
+
+	trie_t *trie = trie_create(NULL);
+	if (!trie) ok(false, "trie: create");
+
+	for (int i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i) {
+		trie_val_t *val = trie_get_ins(trie, (const trie_key_t *)keys[i], strlen(keys[i]));
+		if (!val || *val != NULL) {
+			ok(false, "trie: inserting '%s'", keys[i]);
+			return;
+		}
+		*val = (void *)keys[i];
+	}
+
+	for (int i = 0; i < sizeof(qa_pairs) / sizeof(qa_pairs[0]); ++i) {
+		const char *q = qa_pairs[i][0];
+		const char **ans = (const char **)trie_get_prefix(trie, (const trie_key_t *)q, strlen(q));
+		if (!ans || strcmp(*ans, qa_pairs[i][1]) != 0) {
+			ok(false, "trie: prefix test for '%s' -> '%s'", q, ans ? *ans : "<null>");
+			return;
+		}
+	}
+
+	/* Without the empty key, unrelated keys don't match. */
+	trie_del(trie, (const trie_key_t *)"", 0, NULL);
+	ok(trie_get_prefix(trie, (const trie_key_t *)"x", 1) == NULL &&
+	   trie_get_prefix(trie, (const trie_key_t *)"", 0) == NULL,
+	   "trie: no prefix found");
+
+	trie_free(trie);
+	ok(true, "trie: longest prefix searches");
+}
+
+static int key_cmp(const trie_key_t *k1, size_t l1, const trie_key_t *k2, size_t l2)
+{
+	int ret = memcmp(k1, k2, MIN(l1, l2));
+	return ret != 0 ? ret : (l1 > l2) - (l1 < l2);
+}
+
+static void test_split_shared(void)
+{
+	const unsigned count = 10000, changed = 10;
+	char key[16];
+
+	trie_t *trie = trie_create(NULL);
+	if (!trie) ok(false, "trie: create");
+	for (unsigned i = 0; i < count; ++i) {
+		int len = snprintf(key, sizeof(key), "k%u", i * 10);
+		*trie_get_ins(trie, (trie_key_t *)key, len) = (void *)(uintptr_t)(i + 1);
+	}
+
+	/* Split keys are ascending and the parts aren't empty. */
+	trie_key_t *keys[8];
+	uint32_t lens[8];
+	size_t nkeys = trie_split_keys(trie, 8, keys, lens);
+	bool passed = (nkeys == 7);
+	for (size_t i = 1; i < nkeys; ++i) {
+		passed &= key_cmp(keys[i - 1], lens[i - 1], keys[i], lens[i]) < 0;
+	}
+	ok(passed, "trie: split keys");
+	ok(trie_split_keys(trie, 1, keys, lens) == 0, "trie: no split");
+
+	/* Greater or equal lookup. */
+	trie_it_t *it = trie_it_begin(trie);
+	int ret = trie_it_get_geq(it, (trie_key_t *)"k140", 4);
+	size_t len;
+	const trie_key_t *it_key = trie_it_key(it, &len);
+	ok(ret == KNOT_EOK && len == 4 && memcmp(it_key, "k140", 4) == 0,
+	   "trie: greater or equal, exact");
+	ret = trie_it_get_geq(it, (trie_key_t *)"k15", 3);
+	it_key = trie_it_key(it, &len);
+	ok(ret == KNOT_EOK && len == 4 && memcmp(it_key, "k150", 4) == 0,
+	   "trie: greater or equal, next");
+	ret = trie_it_get_geq(it, (trie_key_t *)"0", 1);
+	it_key = trie_it_key(it, &len);
+	ok(ret == KNOT_EOK && len == 2 && memcmp(it_key, "k0", 2) == 0,
+	   "trie: greater or equal, first");
+	ret = trie_it_get_geq(it, (trie_key_t *)"z", 1);
+	ok(ret == KNOT_ENOENT && trie_it_finished(it), "trie: greater or equal, none");
+	trie_it_free(it);
+
+	/* Modify a copy-on-write trie, only the changes remain unshared. */
+	trie_cow_t *cow = trie_cow(trie, NULL, NULL);
+	trie_t *new = trie_cow_new(cow);
+	for (unsigned i = 0; i < changed; ++i) {
+		int len = snprintf(key, sizeof(key), "k%u", i * 997 * 10);
+		*trie_get_cow(cow, (trie_key_t *)key, len) = NULL;
+	}
+
+	trie_it_t *it1 = trie_it_begin(trie), *it2 = trie_it_begin(new);
+	size_t visited = 0, differ = 0;
+	bool skipped = false;
+	while (!trie_it_finished(it1)) {
+		if (trie_it_skip_shared(it1, it2)) {
+			skipped = true;
+			continue;
+		}
+		size_t len1, len2;
+		const trie_key_t *key1 = trie_it_key(it1, &len1);
+		const trie_key_t *key2 = trie_it_key(it2, &len2);
+		if (key_cmp(key1, len1, key2, len2) != 0) {
+			break;
+		}
+		differ += (*trie_it_val(it1) != *trie_it_val(it2));
+		visited++;
+		trie_it_next(it1);
+		trie_it_next(it2);
+	}
+	ok(trie_it_finished(it1) && trie_it_finished(it2) && skipped &&
+	   differ == changed && visited < count, "trie: skip shared subtrees");
+	trie_it_free(it1);
+	trie_it_free(it2);
+
+	trie = trie_cow_rollback(cow, NULL, NULL);
+	trie_free(trie);
+}
+
+static void test_mem_size(void)
+{
+	mm_account_t account = { 0 };
+	knot_mm_t mm;
+	mm_ctx_accounted(&mm, &account);
+
+	trie_t *trie = trie_create(&mm);
+	char key[32];
+	for (unsigned i = 0; i < 10000; ++i) {
+		int len = snprintf(key, sizeof(key), "key%u", i * 7);
+		*trie_get_ins(trie, (trie_key_t *)key, len) = NULL;
+	}
+	for (unsigned i = 0; i < 10000; i += 3) {
+		int len = snprintf(key, sizeof(key), "key%u", i * 7);
+		trie_del(trie, (trie_key_t *)key, len, NULL);
+	}
+	ok(account.bytes > 0 && trie_mem_size(trie) == account.bytes,
+	   "trie: memory size matches allocations");
+
+	trie_free(trie);
+	ok(account.bytes == 0 && account.blocks == 0, "trie: accounted memory freed");
+}
+
+static bool compact_lookups(trie_t *trie, unsigned count, unsigned changed)
+{
+	char key[32];
+	for (unsigned i = 0; i < count; ++i) {
+		int len = snprintf(key, sizeof(key), "key%u", i * 7);
+		trie_val_t *val = trie_get_try(trie, (trie_key_t *)key, len);
+		if (val == NULL || *val != (i < changed ? NULL : (void *)(uintptr_t)(i + 1))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void test_compact(void)
+{
+	const unsigned count = 10000, changed = 100;
+	mm_account_t account = { 0 };
+	knot_mm_t mm;
+	mm_ctx_accounted(&mm, &account);
+
+	trie_t *trie = trie_create(&mm);
+	char key[32];
+	for (unsigned i = 0; i < count; ++i) {
+		int len = snprintf(key, sizeof(key), "key%u", i * 7);
+		*trie_get_ins(trie, (trie_key_t *)key, len) = (void *)(uintptr_t)(i + 1);
+	}
+	size_t size = trie_mem_size(trie);
+	ok(trie_compact(trie) == KNOT_EOK && compact_lookups(trie, count, 0) &&
+	   trie_weight(trie) == count, "trie: compaction");
+	ok(trie_mem_size(trie) == size && account.bytes == size, "trie: compaction memory size");
+
+	/* Compact a copy-on-write trie, the shared nodes stay in place. */
+	trie_cow_t *cow = trie_cow(trie, NULL, NULL);
+	trie_t *new = trie_cow_new(cow);
+	for (unsigned i = 0; i < changed; ++i) {
+		int len = snprintf(key, sizeof(key), "key%u", i * 7);
+		*trie_get_cow(cow, (trie_key_t *)key, len) = NULL;
+	}
+	ok(trie_compact(new) == KNOT_EOK && compact_lookups(new, count, changed) &&
+	   compact_lookups(trie, count, 0), "trie: compaction of copy-on-write trie");
+	trie = trie_cow_commit(cow, NULL, NULL);
+	ok(compact_lookups(trie, count, changed), "trie: compacted copy-on-write trie committed");
+
+	trie_free(trie);
+	ok(account.bytes == 0 && account.blocks == 0, "trie: compacted memory freed");
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -280,5 +485,17 @@ int main(int argc, char *argv[])
 	/* Test trie_get_try_wildcard(). */
 	test_wildcards();
 
+	/* Test trie_get_prefix(). */
+	test_prefixes();
+
+	/* Test splitting and skipping of shared subtrees. */
+	test_split_shared();
+
+	/* Test memory size. */
+	test_mem_size();
+
+	/* Test compaction. */
+	test_compact();
+
 	return 0;
 }
@@ -0,0 +1,108 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/zone/cold-rdata.h"
+#include "libknot/libknot.h"
+
+static const uint8_t sig[] = "\x00\x01\x0D\x02signature";
+
+static void add_rr(zone_contents_t *contents, const knot_dname_t *owner,
+                   uint16_t type, const uint8_t *rdata, uint16_t len)
+{
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, type, KNOT_CLASS_IN, 3600);
+	(void)knot_rrset_add_rdata(&rr, rdata, len, NULL);
+	zone_node_t *unused = NULL;
+	(void)zone_contents_add_rr(contents, &rr, &unused);
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+static struct rr_data *node_data(zone_node_t *node, uint16_t type)
+{
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		if (node->rrs[i].type == type) {
+			return &node->rrs[i];
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	const uint8_t soa[22] = { 0 };
+	const uint8_t addr[4] = { 192, 0, 2, 1 };
+	cold_rdata_stats_t stats;
+
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+	zone_contents_t *contents = zone_contents_new(apex, true);
+	ok(contents != NULL, "create zone");
+	add_rr(contents, apex, KNOT_RRTYPE_SOA, soa, sizeof(soa));
+	add_rr(contents, apex, KNOT_RRTYPE_A, addr, sizeof(addr));
+	add_rr(contents, apex, KNOT_RRTYPE_RRSIG, sig, sizeof(sig) - 1);
+
+	ok(cold_rdata_move(contents->nodes) == KNOT_EINVAL, "move without pool");
+	ok(cold_rdata_init(NULL) == KNOT_EOK, "init pool");
+	ok(cold_rdata_move(contents->nodes) == KNOT_EOK, "move signatures");
+
+	struct rr_data *rrsig = node_data(contents->apex, KNOT_RRTYPE_RRSIG);
+	struct rr_data *a = node_data(contents->apex, KNOT_RRTYPE_A);
+	ok(rrsig != NULL && (rrsig->flags & RR_DATA_COLD) && a != NULL &&
+	   !(a->flags & RR_DATA_COLD), "only signatures moved");
+	ok(rrsig != NULL && rrsig->rrs.count == 1 &&
+	   memcmp(knot_rdataset_at(&rrsig->rrs, 0)->data, sig, sizeof(sig) - 1) == 0,
+	   "signature intact");
+
+	cold_rdata_stats(&stats);
+	ok(stats.bytes == rrsig->rrs.size && stats.mapped > 0, "statistics");
+
+	ok(cold_rdata_move(contents->nodes) == KNOT_EOK, "repeated move");
+	cold_rdata_stats(&stats);
+	ok(stats.bytes == rrsig->rrs.size, "no repeated accounting");
+
+	// Modification moves the signatures back.
+	const uint8_t sig2[] = "\x00\x01\x0D\x02signature2";
+	add_rr(contents, apex, KNOT_RRTYPE_RRSIG, sig2, sizeof(sig2) - 1);
+	rrsig = node_data(contents->apex, KNOT_RRTYPE_RRSIG);
+	cold_rdata_stats(&stats);
+	ok(rrsig->rrs.count == 2 && !(rrsig->flags & RR_DATA_COLD) && stats.bytes == 0,
+	   "modified signatures in heap");
+
+	ok(cold_rdata_move(contents->nodes) == KNOT_EOK &&
+	   (rrsig->flags & RR_DATA_COLD), "move modified signatures");
+	node_remove_rdataset(contents->apex, KNOT_RRTYPE_RRSIG);
+	cold_rdata_stats(&stats);
+	ok(stats.bytes == 0, "removed signatures freed");
+
+	add_rr(contents, apex, KNOT_RRTYPE_RRSIG, sig, sizeof(sig) - 1);
+	ok(cold_rdata_move(contents->nodes) == KNOT_EOK, "move again");
+	zone_contents_deep_free(contents);
+	cold_rdata_stats(&stats);
+	ok(stats.bytes == 0, "freed with zone");
+
+	cold_rdata_deinit();
+	cold_rdata_stats(&stats);
+	ok(stats.mapped == 0, "deinit");
+
+	knot_dname_free(apex, NULL);
+
+	return 0;
+}
@@ -255,6 +255,25 @@ static void test_mix_ref(void)
 	test_conf_free();
 }
 
+static void test_cpu_list(void)
+{
+	unsigned *cpus = NULL;
+	size_t count = 0;
+
+	ok(conf_cpu_list(NULL, &cpus, &count) == KNOT_EOK && count == 0 && cpus == NULL,
+	   "cpu list: none");
+
+	int ret = conf_cpu_list("6,0-2,1", &cpus, &count);
+	ok(ret == KNOT_EOK && count == 4 && cpus[0] == 0 && cpus[1] == 1 &&
+	   cpus[2] == 2 && cpus[3] == 6, "cpu list: ranges, sorted, unique");
+	free(cpus);
+
+	ok(conf_cpu_list("1,", &cpus, &count) == KNOT_EINVAL, "cpu list: trailing comma");
+	ok(conf_cpu_list("a-2", &cpus, &count) == KNOT_EINVAL, "cpu list: not a number");
+	ok(conf_cpu_list("3-1", &cpus, &count) == KNOT_ERANGE, "cpu list: reversed range");
+	ok(conf_cpu_list("0-100000", &cpus, &count) == KNOT_ERANGE, "cpu list: too high");
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -268,5 +287,8 @@ int main(int argc, char *argv[])
 	diag("mixed references");
 	test_mix_ref();
 
+	diag("cpu list");
+	test_cpu_list();
+
 	return 0;
 }
@@ -16,6 +16,8 @@
 
 #include "knot/zone/digest.h"
 
+#include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <tap/basic.h>
 
@@ -91,11 +93,42 @@ static zone_contents_t *str2contents(const char *zone_str)
 static int check_contents(const char *zone_str)
 {
 	zone_contents_t *cont = str2contents(zone_str);
-	int ret = zone_contents_digest_verify(cont);
+	int ret = zone_contents_digest_verify(cont, 1);
 	zone_contents_deep_free(cont);
 	return ret;
 }
 
+#define PARALLEL_NODES 5000
+
+static void test_parallel(void)
+{
+	size_t size = 100 + PARALLEL_NODES * 64;
+	char *zone_str = malloc(size), *pos = zone_str;
+	assert(zone_str != NULL);
+	pos += sprintf(pos, "example. 86400 IN SOA ns1 admin 1 1800 900 604800 86400\n");
+	for (int i = 0; i < PARALLEL_NODES; i++) {
+		pos += sprintf(pos, "n%d 3600 IN TXT \"node %d\"\nn%d 3600 IN A 192.0.2.1\n", i, i, i);
+	}
+	assert(pos < zone_str + size);
+
+	zone_contents_t *cont = str2contents(zone_str);
+	free(zone_str);
+
+	uint8_t *seq = NULL, *par = NULL;
+	size_t seq_size = 0, par_size = 0;
+	int ret = zone_contents_digest(cont, KNOT_ZONEMD_ALGORITHM_SHA384, 1, &seq, &seq_size);
+	is_int(KNOT_EOK, ret, "sequential digest");
+	for (unsigned threads = 2; threads <= 5; threads += 3) {
+		ret = zone_contents_digest(cont, KNOT_ZONEMD_ALGORITHM_SHA384, threads, &par, &par_size);
+		ok(ret == KNOT_EOK && par_size == seq_size && memcmp(seq, par, seq_size) == 0,
+		   "parallel digest, %u threads", threads);
+		free(par);
+	}
+	free(seq);
+
+	zone_contents_deep_free(cont);
+}
+
 const char *simple_zone = "\
 example.      86400  IN  SOA     ns1 admin 2018031900 (  \n\
                                  1800 900 604800 86400 ) \n\
@@ -470,5 +503,7 @@ int main(int argc, char *argv[])
 	ret = check_contents(wrong_hash);
 	is_int(KNOT_EMALF, ret, "wrong hash");
 
+	test_parallel();
+
 	return 0;
 }
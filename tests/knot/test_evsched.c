@@ -0,0 +1,135 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+
+#include "knot/common/evsched.h"
+#include "contrib/time.h"
+#include "libknot/errcode.h"
+
+#define EVENTS 5
+
+typedef struct {
+	pthread_mutex_t mx;
+	pthread_cond_t cond;
+	unsigned fired[EVENTS];
+	struct timespec when[EVENTS];
+	unsigned total;
+} fire_log_t;
+
+static fire_log_t flog = {
+	.mx = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void event_cb(event_t *ev)
+{
+	unsigned idx = (unsigned)(uintptr_t)ev->data;
+
+	pthread_mutex_lock(&flog.mx);
+	flog.fired[idx]++;
+	flog.when[idx] = time_now();
+	flog.total++;
+	pthread_cond_broadcast(&flog.cond);
+	pthread_mutex_unlock(&flog.mx);
+}
+
+/*! \brief Wait till the total number of fired events reaches the value. */
+static bool wait_total(unsigned total, unsigned timeout_s)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout_s;
+
+	pthread_mutex_lock(&flog.mx);
+	int ret = 0;
+	while (flog.total < total && ret == 0) {
+		ret = pthread_cond_timedwait(&flog.cond, &flog.mx, &ts);
+	}
+	bool reached = (flog.total >= total);
+	pthread_mutex_unlock(&flog.mx);
+
+	return reached;
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	evsched_t sched;
+	ok(evsched_init(&sched, NULL) == KNOT_EOK, "init scheduler");
+
+	event_t *ev[EVENTS];
+	for (int i = 0; i < EVENTS; i++) {
+		ev[i] = evsched_event_create(&sched, event_cb, (void *)(uintptr_t)i);
+	}
+	ok(ev[EVENTS - 1] != NULL, "create events");
+
+	evsched_start(&sched);
+
+	/* Immediate event. */
+	struct timespec begin = time_now();
+	ok(evsched_schedule(ev[0], 0) == KNOT_EOK, "schedule immediate event");
+	ok(wait_total(1, 2) && flog.fired[0] == 1, "immediate event fired");
+	ok(time_diff_ms(&begin, &flog.when[0]) < 500, "immediate event not delayed");
+
+	/* Batch of events due within the same second, one canceled, one moved. */
+	begin = time_now();
+	ok(evsched_schedule(ev[1], 1000) == KNOT_EOK &&
+	   evsched_schedule(ev[2], 1000) == KNOT_EOK &&
+	   evsched_schedule(ev[3], 1000) == KNOT_EOK &&
+	   evsched_schedule(ev[4], 3600 * 1000) == KNOT_EOK, "schedule events");
+	ok(evsched_cancel(ev[3]) == KNOT_EOK, "cancel event");
+	ok(evsched_schedule(ev[4], 1000) == KNOT_EOK, "reschedule event");
+	ok(wait_total(4, 5), "events fired");
+	ok(flog.fired[1] == 1 && flog.fired[2] == 1 && flog.fired[3] == 0 &&
+	   flog.fired[4] == 1, "expected events fired once");
+	ok(time_diff_ms(&begin, &flog.when[1]) >= 1000 &&
+	   time_diff_ms(&begin, &flog.when[1]) < 2500, "event not fired early");
+
+	/* Pause and resume. */
+	evsched_pause(&sched);
+	ok(evsched_schedule(ev[3], 0) == KNOT_EOK, "schedule paused event");
+	ok(!wait_total(5, 1), "paused event not fired");
+	evsched_resume(&sched);
+	ok(wait_total(5, 2) && flog.fired[3] == 1, "resumed event fired");
+
+	evsched_stop(&sched);
+	evsched_join(&sched);
+
+	/* Scheduled events are owned by the scheduler. */
+	ok(evsched_schedule(ev[0], 1000) == KNOT_EOK, "schedule event before deinit");
+	for (int i = 1; i < EVENTS; i++) {
+		evsched_event_free(ev[i]);
+	}
+	evsched_deinit(&sched);
+
+	return 0;
+}
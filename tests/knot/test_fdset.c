@@ -39,6 +39,64 @@ void *thr_action2(void *arg)
 	return NULL;
 }
 
+static fdset_sweep_state_t sweep_cb(fdset_t *set, unsigned idx, void *data)
+{
+	unsigned *swept = data;
+	(*swept)++;
+	return FDSET_SWEEP;
+}
+
+static void test_watchdog(void)
+{
+	fdset_t fdset;
+	int ret = fdset_init(&fdset, 4);
+	ok(ret == KNOT_EOK, "watchdog: fdset_init");
+
+	/* Expired, long, expired, lifted, expired. */
+	const int intervals[] = { 0, 100, 0, -1, 0 };
+	int fds[5][2];
+	for (int i = 0; i < 5; i++) {
+		ret = pipe(fds[i]);
+		ok(ret >= 0, "watchdog: create pipe %i", i);
+		ret = fdset_add(&fdset, fds[i][0], FDSET_POLLIN, &fds[i]);
+		ok(ret == i, "watchdog: add pipe %i", i);
+		if (i == 3) {
+			(void)fdset_set_watchdog(&fdset, ret, 0);
+		}
+		ret = fdset_set_watchdog(&fdset, ret, intervals[i]);
+		ok(ret == KNOT_EOK, "watchdog: set watchdog %i", i);
+	}
+
+	unsigned swept = 0;
+	fdset_sweep(&fdset, sweep_cb, &swept);
+	ok(swept == 3 && fdset_get_length(&fdset) == 2, "watchdog: expired swept");
+	bool kept = true;
+	for (unsigned i = 0; i < fdset_get_length(&fdset); i++) {
+		int (*fd)[2] = fdset_get_ctx(&fdset, i);
+		kept &= (fd == &fds[1] || fd == &fds[3]) && fdset_get_fd(&fdset, i) == (*fd)[0];
+	}
+	ok(kept, "watchdog: unexpired kept");
+
+	swept = 0;
+	fdset_sweep(&fdset, sweep_cb, &swept);
+	ok(swept == 0, "watchdog: nothing more to sweep");
+
+	for (unsigned i = 0; i < fdset_get_length(&fdset); i++) {
+		if (fdset_get_ctx(&fdset, i) == &fds[1]) {
+			(void)fdset_set_watchdog(&fdset, i, 0);
+		}
+	}
+	fdset_sweep(&fdset, sweep_cb, &swept);
+	ok(swept == 1 && fdset_get_length(&fdset) == 1 &&
+	   fdset_get_ctx(&fdset, 0) == &fds[3], "watchdog: rearmed swept");
+
+	(void)fdset_remove(&fdset, 0);
+	for (int i = 0; i < 5; i++) {
+		close(fds[i][1]);
+	}
+	fdset_clear(&fdset);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -141,5 +199,7 @@ int main(int argc, char *argv[])
 	}
 	fdset_clear(&fdset);
 
+	test_watchdog();
+
 	return 0;
 }
@@ -0,0 +1,118 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "knot/server/handoff.h"
+#include "knot/server/server.h"
+#include "libknot/errcode.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+#include "contrib/string.h"
+
+typedef struct {
+	server_t *server;
+	int sock;
+	int send_ret;
+	int ready_ret;
+} predecessor_t;
+
+static void *predecessor_main(void *arg)
+{
+	predecessor_t *pred = arg;
+
+	int conn = accept(pred->sock, NULL, NULL);
+	pred->send_ret = handoff_send(conn, pred->server);
+	while ((pred->ready_ret = handoff_wait_ready(conn, 100)) == KNOT_ETIMEOUT);
+	handoff_released(conn);
+
+	return NULL;
+}
+
+static bool same_socket(int a, int b)
+{
+	struct sockaddr_storage addr_a, addr_b;
+	socklen_t len_a = sizeof(addr_a), len_b = sizeof(addr_b);
+	return getsockname(a, (struct sockaddr *)&addr_a, &len_a) == 0 &&
+	       getsockname(b, (struct sockaddr *)&addr_b, &len_b) == 0 &&
+	       sockaddr_cmp(&addr_a, &addr_b, false) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	char *dir = test_mkdtemp();
+	char *path = sprintf_alloc("%s/%s", dir, HANDOFF_SOCKET);
+
+	handoff_t handoff;
+	ok(handoff_connect(path, &handoff) == KNOT_ECONN, "handoff: no predecessor");
+
+	// Predecessor with a UDP and a TCP socket bound to an ephemeral port.
+	struct sockaddr_storage addr;
+	(void)sockaddr_set(&addr, AF_INET, "127.0.0.1", 0);
+	int udp = net_bound_socket(SOCK_DGRAM, &addr, 0);
+	socklen_t addr_len = sizeof(addr);
+	(void)getsockname(udp, (struct sockaddr *)&addr, &addr_len);
+	int tcp = net_bound_socket(SOCK_STREAM, &addr, 0);
+	ok(udp >= 0 && tcp >= 0 && listen(tcp, 1) == 0, "handoff: bind sockets");
+
+	iface_t iface = {
+		.fd_udp = &udp, .fd_udp_count = 1,
+		.fd_tcp = &tcp, .fd_tcp_count = 1,
+		.addr = addr
+	};
+	server_t server = { .ifaces = &iface, .n_ifaces = 1 };
+	predecessor_t pred = { .server = &server, .sock = handoff_listen(path) };
+	ok(pred.sock >= 0, "handoff: listen");
+
+	pthread_t thread;
+	(void)pthread_create(&thread, NULL, predecessor_main, &pred);
+
+	int ret = handoff_connect(path, &handoff);
+	ok(ret == KNOT_EOK && handoff.count == 2 && handoff.pid == getpid(),
+	   "handoff: receive sockets");
+
+	int taken_udp = handoff_take(&handoff, SOCK_DGRAM, &addr);
+	ok(taken_udp >= 0 && taken_udp != udp && same_socket(taken_udp, udp),
+	   "handoff: take UDP socket");
+	ok(handoff_take(&handoff, SOCK_DGRAM, &addr) == KNOT_ENOENT,
+	   "handoff: UDP socket taken once");
+	int taken_tcp = handoff_take(&handoff, SOCK_STREAM, &addr);
+	ok(taken_tcp >= 0 && same_socket(taken_tcp, tcp), "handoff: take TCP socket");
+
+	ok(handoff_ready(&handoff, 5) == KNOT_EOK, "handoff: released");
+	pthread_join(thread, NULL);
+	ok(pred.send_ret == KNOT_EOK && pred.ready_ret == KNOT_EOK, "handoff: predecessor");
+
+	handoff_deinit(&handoff);
+	close(taken_udp);
+	close(taken_tcp);
+	close(pred.sock);
+	close(udp);
+	close(tcp);
+
+	test_rm_rf(dir);
+	free(dir);
+	free(path);
+
+	return 0;
+}
@@ -19,11 +19,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <tap/basic.h>
 #include <tap/files.h>
 
+#include "knot/journal/journal_group.h"
 #include "knot/journal/journal_read.h"
 #include "knot/journal/journal_write.h"
 
@@ -54,7 +56,8 @@ static unsigned lmdb_page_size(knot_lmdb_db_t *db)
 	return st.ms_psize;
 }
 
-static void set_conf(int zonefile_sync, size_t journal_usage, const knot_dname_t *apex)
+static void set_conf_compress(int zonefile_sync, size_t journal_usage,
+                              const knot_dname_t *apex, bool compress)
 {
 	(void)apex;
 	char conf_str[512];
@@ -63,13 +66,19 @@ static void set_conf(int zonefile_sync, size_t journal_usage, const knot_dname_t
 	         " - id: default\n"
 	         "   zonefile-sync: %d\n"
 	         "   journal-max-usage: %zu\n"
-	         "   journal-max-depth: 1000\n",
-	         zonefile_sync, journal_usage);
+	         "   journal-max-depth: 1000\n"
+	         "   journal-compression: %s\n",
+	         zonefile_sync, journal_usage, compress ? "on" : "off");
 	_unused_ int ret = test_conf(conf_str, NULL);
 	assert(ret == KNOT_EOK);
 	jj.conf = conf();
 }
 
+static void set_conf(int zonefile_sync, size_t journal_usage, const knot_dname_t *apex)
+{
+	set_conf_compress(zonefile_sync, journal_usage, apex, false);
+}
+
 static void unset_conf(void)
 {
 	conf_update(NULL, CONF_UPD_FNONE);
@@ -301,6 +310,34 @@ static int load_j_list(zone_journal_t *zj, bool zij, uint32_t serial,
 	return ret;
 }
 
+/*! \brief Check that RRSet views match the copied RRSets. */
+static bool views_eq(zone_journal_t zj, bool zij, uint32_t serial)
+{
+	journal_read_t *read = NULL, *view = NULL;
+	if (journal_read_begin(zj, zij, serial, &read) != KNOT_EOK ||
+	    journal_read_begin(zj, zij, serial, &view) != KNOT_EOK) {
+		journal_read_end(read);
+		return false;
+	}
+
+	bool eq = true;
+	size_t count = 0;
+	knot_rrset_t rr = { 0 }, rr_view = { 0 };
+	while (eq && journal_read_rrset(read, &rr, true)) {
+		eq = journal_read_rrset_view(view, &rr_view, true) &&
+		     knot_rrset_equal(&rr, &rr_view, true) && rr.ttl == rr_view.ttl;
+		journal_read_clear_rrset(&rr);
+		count++;
+	}
+	eq = eq && count > 0 && !journal_read_rrset_view(view, &rr_view, true) &&
+	     journal_read_get_error(read, KNOT_EOK) == KNOT_EOK &&
+	     journal_read_get_error(view, KNOT_EOK) == KNOT_EOK;
+
+	journal_read_end(read);
+	journal_read_end(view);
+	return eq;
+}
+
 /*! \brief Test behavior with real changesets. */
 static void test_store_load(const knot_dname_t *apex)
 {
@@ -454,6 +491,7 @@ static void test_store_load(const knot_dname_t *apex)
 	ok(changesets_eq(&r_ch, TAIL(l)), "journal: after zone-in-journal not malformed");
 	changesets_free(&l);
 	journal_read_end(read);
+	ok(views_eq(jj, true, 0), "journal: read zone-in-journal as views");
 	changeset_clear(&e_ch);
 	changeset_clear(&r_ch);
 
@@ -787,6 +825,21 @@ static void test_merge(const knot_dname_t *apex)
 	ret = journal_scrape_with_md(jj, false);
 	assert(ret == KNOT_EOK);
 
+	// merge ahead of time before the journal is full
+	for (i = 0; !journal_compact_due(jj) && i < 40000; i++) {
+		ret = journal_insert(jj, tm_chs(apex, i), NULL, NULL);
+		assert(ret == KNOT_EOK);
+	}
+	ok(!merged_present(), "journal: compaction due before merge");
+	ret = journal_compact(jj);
+	is_int(KNOT_EOK, ret, "journal: compact (%s)", knot_strerror(ret));
+	ok(merged_present() && !journal_compact_due(jj), "journal: compacted");
+	ret = journal_sem_check(jj);
+	is_int(KNOT_EOK, ret, "journal: sem check after compact (%s)", knot_strerror(ret));
+
+	ret = journal_scrape_with_md(jj, false);
+	assert(ret == KNOT_EOK);
+
 	// disallow merge
 	unset_conf();
 	set_conf(1000, 512 * 1024, apex);
@@ -798,6 +851,139 @@ static void test_merge(const knot_dname_t *apex)
 	unset_conf();
 }
 
+static void test_compression(const knot_dname_t *apex)
+{
+	list_t l;
+	journal_read_t *read = NULL;
+
+	set_conf_compress(1000, 512 * 1024, apex, true);
+	ok(journal_conf_compress(jj), "journal: compression enabled");
+
+	int ret = journal_scrape_with_md(jj, false);
+	is_int(KNOT_EOK, ret, "journal: scrape before compression test");
+
+	// large zone-in-journal taking more than one chunk
+	zone_contents_t *bigz = tm2_zone(apex);
+	ret = journal_insert_zone(jj, bigz);
+	is_int(KNOT_EOK, ret, "journal: insert compressed zone-in-journal");
+	changeset_t *ch = tm2_chs_unzone(apex);
+	ret = journal_insert(jj, ch, NULL, NULL);
+	is_int(KNOT_EOK, ret, "journal: insert compressed changeset");
+	ret = journal_sem_check(jj);
+	is_int(KNOT_EOK, ret, "journal: check compressed journal (%s)", knot_strerror(ret));
+
+	ret = load_j_list(&jj, true, 0, &read, &l);
+	is_int(KNOT_EOK, ret, "journal: read compressed journal (%s)", knot_strerror(ret));
+	ok(list_size(&l) == 2, "journal: read compressed zone-in-journal and changeset");
+	ok(list_size(&l) == 2 && trie_weight(((changeset_t *)HEAD(l))->add->nodes->trie) ==
+	   trie_weight(bigz->nodes->trie), "journal: compressed zone-in-journal equal");
+	ok(list_size(&l) == 2 && changesets_eq(ch, TAIL(l)), "journal: compressed changeset equal");
+	changesets_free(&l);
+	journal_read_end(read);
+	ok(views_eq(jj, true, 0), "journal: read compressed journal as views");
+
+	uint64_t stored = 0, raw = 0;
+	ret = journal_chunks_size(jj, &stored, &raw);
+	is_int(KNOT_EOK, ret, "journal: chunks size");
+#ifdef HAVE_ZSTD
+	ok(stored > 0 && raw > stored, "journal: chunks compressed");
+#else
+	ok(stored > 0 && raw == stored, "journal: chunks not compressed");
+#endif
+
+	journal_summary_t sum;
+	ret = journal_summary(jj, &sum);
+	is_int(KNOT_EOK, ret, "journal: summary");
+	ok(sum.has_zij && sum.changesets == 1 && sum.chunks > 2 && sum.consistent,
+	   "journal: summary of zone-in-journal and changeset");
+	ok(sum.stored == stored && sum.raw == raw, "journal: summary sizes");
+
+	zone_contents_deep_free(bigz);
+	changeset_free(ch);
+
+	ret = journal_scrape_with_md(jj, false);
+	assert(ret == KNOT_EOK);
+	unset_conf();
+}
+
+#define GROUP_ZONES 8
+
+typedef struct {
+	journal_group_t *group;
+	zone_journal_t j;
+	changeset_t *ch;
+	int ret;
+} group_insert_t;
+
+static void *group_insert(void *arg)
+{
+	group_insert_t *ins = arg;
+	ins->ret = journal_group_insert(ins->group, ins->j, ins->ch, NULL, NULL);
+	return NULL;
+}
+
+static void test_group(void)
+{
+	set_conf(1000, 512 * 1024, NULL);
+
+	journal_group_t group;
+	int ret = journal_group_init(&group, 10);
+	is_int(KNOT_EOK, ret, "journal: group init");
+
+	knot_dname_t *apexes[GROUP_ZONES];
+	group_insert_t ins[GROUP_ZONES];
+	pthread_t threads[GROUP_ZONES];
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		char name[16];
+		snprintf(name, sizeof(name), "group%d.", i);
+		apexes[i] = knot_dname_from_str_alloc(name);
+		ins[i].group = &group;
+		ins[i].j = (zone_journal_t){ &jdb, apexes[i], jj.conf };
+		ins[i].ch = changeset_new(apexes[i]);
+		init_random_changeset(ins[i].ch, 0, 1, 16, apexes[i], false);
+		pthread_create(&threads[i], NULL, group_insert, &ins[i]);
+	}
+
+	bool stored = true, equal = true;
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		pthread_join(threads[i], NULL);
+		stored = stored && ins[i].ret == KNOT_EOK;
+
+		list_t l;
+		journal_read_t *read = NULL;
+		ret = load_j_list(&ins[i].j, false, 0, &read, &l);
+		equal = equal && ret == KNOT_EOK && list_size(&l) == 1 &&
+		        changesets_eq(ins[i].ch, HEAD(l));
+		changesets_free(&l);
+		journal_read_end(read);
+	}
+	ok(stored, "journal: group store changesets");
+	ok(equal, "journal: group changesets equal after read");
+
+	// Invalid request is refused before queuing.
+	changeset_t *bad = changeset_new(apexes[0]);
+	init_random_changeset(bad, 5, 6, 16, apexes[0], false);
+	ret = journal_group_insert(&group, ins[0].j, bad, bad, NULL);
+	is_int(KNOT_EINVAL, ret, "journal: group store invalid extra changeset");
+	changeset_free(bad);
+
+	journal_group_deinit(&group);
+
+	changeset_t *next = changeset_new(apexes[1]);
+	init_random_changeset(next, 1, 2, 16, apexes[1], false);
+	ret = journal_group_insert(NULL, ins[1].j, next, NULL, NULL);
+	is_int(KNOT_EOK, ret, "journal: store changeset without group");
+	changeset_free(next);
+
+	for (int i = 0; i < GROUP_ZONES; i++) {
+		ret = journal_scrape_with_md(ins[i].j, false);
+		assert(ret == KNOT_EOK);
+		changeset_free(ins[i].ch);
+		knot_dname_free(apexes[i], NULL);
+	}
+	unset_conf();
+}
+
 static void test_stress_base(const knot_dname_t *apex,
                              size_t update_size, size_t file_size)
 {
@@ -869,6 +1055,10 @@ int main(int argc, char *argv[])
 
 	test_merge(apex);
 
+	test_compression(apex);
+
+	test_group();
+
 	test_stress(apex);
 
 	knot_lmdb_deinit(&jdb);
@@ -223,6 +223,49 @@ int main(int argc, char *argv[])
 	ret = kasp_db_load_offline_records(db, zone1, 2, &time, &kr);
 	is_int(KNOT_ENOENT, ret, "kasp_db: no more key records");
 
+	key_records_t krs[2];
+	knot_time_t times[2] = { 10, 20 };
+	init_key_records(&krs[0]);
+	init_key_records(&krs[1]);
+	ret = kasp_db_store_offline_records(db, 30, &krs[0]);
+	is_int(KNOT_EOK, ret, "kasp_db: store key records to be replaced");
+	ret = kasp_db_replace_offline_records(db, zone1, 10, times, krs, 2);
+	is_int(KNOT_EOK, ret, "kasp_db: replace key records");
+	ret = kasp_db_load_offline_records(db, zone1, 15, &time, &kr);
+	ok(ret == KNOT_EOK && time == 20, "kasp_db: replaced key records loaded");
+	key_records_clear(&kr);
+	ret = kasp_db_load_offline_records(db, zone1, 30, &time, &kr);
+	ok(ret == KNOT_EOK && time == 0, "kasp_db: replaced key records deleted");
+	key_records_clear(&kr);
+	key_records_clear(&krs[0]);
+	key_records_clear(&krs[1]);
+	ret = kasp_db_delete_offline_records(db, zone1, 0, 0);
+	is_int(KNOT_EOK, ret, "kasp_db: delete replaced key records");
+
+	uint8_t digest1[48] = { 1 }, digest2[48] = { 2 };
+	trie_t *ins = trie_create(NULL), *del = trie_create(NULL), *loaded = trie_create(NULL);
+	*trie_get_ins(ins, digest1, sizeof(digest1)) = (void *)(uintptr_t)1000;
+	*trie_get_ins(ins, digest2, sizeof(digest2)) = (void *)(uintptr_t)2000;
+	ret = kasp_db_update_rrsig_valid(db, zone1, NULL, ins);
+	is_int(KNOT_EOK, ret, "kasp_db: store valid RRSIGs");
+	ret = kasp_db_load_rrsig_valid(db, zone1, loaded);
+	trie_val_t *val = trie_get_try(loaded, digest2, sizeof(digest2));
+	ok(ret == KNOT_EOK && trie_weight(loaded) == 2 && val != NULL &&
+	   (uintptr_t)*val == 2000, "kasp_db: load valid RRSIGs");
+	*trie_get_ins(del, digest1, sizeof(digest1)) = NULL;
+	ret = kasp_db_update_rrsig_valid(db, zone1, del, NULL);
+	is_int(KNOT_EOK, ret, "kasp_db: remove valid RRSIG");
+	trie_clear(loaded);
+	ret = kasp_db_load_rrsig_valid(db, zone1, loaded);
+	ok(ret == KNOT_EOK && trie_weight(loaded) == 1 &&
+	   trie_get_try(loaded, digest1, sizeof(digest1)) == NULL, "kasp_db: valid RRSIG removed");
+	trie_clear(loaded);
+	ret = kasp_db_load_rrsig_valid(db, zone2, loaded);
+	ok(ret == KNOT_EOK && trie_weight(loaded) == 0, "kasp_db: no valid RRSIGs for other zone");
+	trie_free(ins);
+	trie_free(del);
+	trie_free(loaded);
+
 	knot_lmdb_deinit(db);
 
 	test_rm_rf(test_dir_name);
@@ -0,0 +1,101 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <tap/basic.h>
+
+#include "knot/dnssec/key-cache.h"
+#include "libdnssec/crypto.h"
+#include "libdnssec/error.h"
+#include "libdnssec/sample_keys.h"
+#include "libknot/libknot.h"
+
+#define ZONE1 (const knot_dname_t *)"\x07""example""\x03""com"
+#define ZONE2 (const knot_dname_t *)"\x03""net"
+
+static dnssec_key_t *public_key(const key_parameters_t *params)
+{
+	dnssec_key_t *key = NULL;
+	if (dnssec_key_new(&key) != DNSSEC_EOK ||
+	    dnssec_key_set_rdata(key, &params->rdata) != DNSSEC_EOK) {
+		dnssec_key_free(key);
+		return NULL;
+	}
+	return key;
+}
+
+static dnssec_key_t *private_key(const key_parameters_t *params)
+{
+	dnssec_key_t *key = public_key(params);
+	if (key != NULL && dnssec_key_load_pkcs8(key, &params->pem) != DNSSEC_EOK) {
+		dnssec_key_free(key);
+		return NULL;
+	}
+	return key;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	dnssec_crypto_init();
+
+	const key_parameters_t *params = &SAMPLE_ECDSA_KEY;
+	dnssec_key_t *pub = public_key(params);
+	ok(pub != NULL, "key cache: public key");
+
+	// Disabled cache.
+	key_cache_put(ZONE1, "id1", private_key(params));
+	ok(key_cache_take(ZONE1, "id1", pub) == NULL, "key cache: disabled");
+
+	key_cache_init();
+
+	// Only keys with private keys are cached.
+	key_cache_put(ZONE1, "id1", public_key(params));
+	ok(key_cache_take(ZONE1, "id1", pub) == NULL, "key cache: public key not cached");
+
+	dnssec_key_t *priv = private_key(params);
+	key_cache_put(ZONE1, "id1", priv);
+	ok(key_cache_take(ZONE2, "id1", pub) == NULL, "key cache: other zone");
+	ok(key_cache_take(ZONE1, "id2", pub) == NULL, "key cache: other ID");
+	dnssec_key_t *taken = key_cache_take(ZONE1, "id1", pub);
+	ok(taken == priv && dnssec_key_can_sign(taken), "key cache: take");
+	ok(key_cache_take(ZONE1, "id1", pub) == NULL, "key cache: taken only once");
+
+	// Changed DNSKEY.
+	key_cache_put(ZONE1, "id1", taken);
+	dnssec_key_set_flags(pub, dnssec_key_get_flags(pub) ^ 1);
+	ok(key_cache_take(ZONE1, "id1", pub) == NULL, "key cache: DNSKEY mismatch");
+	ok(key_cache_take(ZONE1, "id1", pub) == NULL, "key cache: mismatch dropped");
+	dnssec_key_set_flags(pub, dnssec_key_get_flags(pub) ^ 1);
+
+	// Dropping a key shared by several zones.
+	key_cache_put(ZONE1, "id1", private_key(params));
+	key_cache_put(ZONE2, "id1", private_key(params));
+	key_cache_drop("id1");
+	ok(key_cache_take(ZONE1, "id1", pub) == NULL &&
+	   key_cache_take(ZONE2, "id1", pub) == NULL, "key cache: drop");
+
+	// Freed on deinit.
+	key_cache_put(ZONE2, "id2", private_key(params));
+	key_cache_deinit();
+	ok(key_cache_take(ZONE2, "id2", pub) == NULL, "key cache: deinit");
+
+	dnssec_key_free(pub);
+	dnssec_crypto_cleanup();
+
+	return 0;
+}
@@ -0,0 +1,129 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "contrib/string.h"
+#include "knot/zone/mapped-rdata.h"
+#include "libknot/libknot.h"
+
+static const uint8_t id[] = "snapshot digest";
+static const uint8_t txt[] = "\x0Bhello world";
+
+static void add_rr(zone_contents_t *contents, const knot_dname_t *owner,
+                   uint16_t type, const uint8_t *rdata, uint16_t len)
+{
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, type, KNOT_CLASS_IN, 3600);
+	(void)knot_rrset_add_rdata(&rr, rdata, len, NULL);
+	zone_node_t *unused = NULL;
+	(void)zone_contents_add_rr(contents, &rr, &unused);
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+static struct rr_data *node_data(zone_node_t *node, uint16_t type)
+{
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		if (node->rrs[i].type == type) {
+			return &node->rrs[i];
+		}
+	}
+	return NULL;
+}
+
+static zone_contents_t *create_zone(const knot_dname_t *apex, uint8_t last_octet)
+{
+	const uint8_t soa[22] = { 0 };
+	const uint8_t addr[4] = { 192, 0, 2, last_octet };
+
+	zone_contents_t *contents = zone_contents_new(apex, false);
+	add_rr(contents, apex, KNOT_RRTYPE_SOA, soa, sizeof(soa));
+	add_rr(contents, apex, KNOT_RRTYPE_A, addr, sizeof(addr));
+	add_rr(contents, apex, KNOT_RRTYPE_TXT, txt, sizeof(txt) - 1);
+	return contents;
+}
+
+static ino_t image_inode(const char *path)
+{
+	struct stat st;
+	return (stat(path, &st) == 0) ? st.st_ino : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	mapped_rdata_stats_t stats;
+	char *tmpdir = test_mkdtemp();
+	char *path = sprintf_alloc("%s/example.rdata", tmpdir);
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.");
+
+	zone_contents_t *first = create_zone(apex, 1);
+	ok(mapped_rdata_attach(first, path, id, MAPPED_RDATA_ID_MAXLEN + 1) == KNOT_EINVAL,
+	   "too long identifier");
+	ok(mapped_rdata_attach(first, path, id, sizeof(id)) == KNOT_EOK, "create image");
+
+	struct rr_data *soa = node_data(first->apex, KNOT_RRTYPE_SOA);
+	struct rr_data *a = node_data(first->apex, KNOT_RRTYPE_A);
+	struct rr_data *t = node_data(first->apex, KNOT_RRTYPE_TXT);
+	ok(!(soa->flags & RR_DATA_MAPPED) && (a->flags & RR_DATA_MAPPED) &&
+	   (t->flags & RR_DATA_MAPPED), "rdata except SOA mapped");
+	ok(t->rrs.count == 1 &&
+	   memcmp(knot_rdataset_at(&t->rrs, 0)->data, txt, sizeof(txt) - 1) == 0,
+	   "rdata intact");
+
+	mapped_rdata_stats(&stats);
+	ok(stats.bytes == a->rrs.size + t->rrs.size && stats.mapped > 0, "statistics");
+
+	// Another process (here another contents) attaches the same image.
+	ino_t inode = image_inode(path);
+	zone_contents_t *second = create_zone(apex, 1);
+	ok(mapped_rdata_attach(second, path, id, sizeof(id)) == KNOT_EOK &&
+	   image_inode(path) == inode, "existing image reused");
+	ok(node_data(second->apex, KNOT_RRTYPE_TXT)->flags & RR_DATA_MAPPED,
+	   "second contents mapped");
+
+	// Contents not matching the image get a new one.
+	zone_contents_t *other = create_zone(apex, 2);
+	ok(mapped_rdata_attach(other, path, id, sizeof(id)) == KNOT_EOK &&
+	   image_inode(path) != inode, "mismatching image replaced");
+	a = node_data(other->apex, KNOT_RRTYPE_A);
+	ok(knot_rdataset_at(&a->rrs, 0)->data[3] == 2, "own rdata mapped");
+	zone_contents_deep_free(other);
+
+	// Modification copies the rdata to the heap.
+	add_rr(second, apex, KNOT_RRTYPE_TXT, (const uint8_t *)"\x03new", 4);
+	t = node_data(second->apex, KNOT_RRTYPE_TXT);
+	ok(t->rrs.count == 2 && !(t->flags & RR_DATA_MAPPED), "modified rdata in heap");
+	t = node_data(first->apex, KNOT_RRTYPE_TXT);
+	ok(t->rrs.count == 1 && (t->flags & RR_DATA_MAPPED), "other contents unchanged");
+
+	zone_contents_deep_free(first);
+	zone_contents_deep_free(second);
+	mapped_rdata_stats(&stats);
+	ok(stats.bytes == 0 && stats.mapped == 0, "unmapped with zones");
+
+	knot_dname_free(apex, NULL);
+	free(path);
+	test_rm_rf(tmpdir);
+	free(tmpdir);
+
+	return 0;
+}
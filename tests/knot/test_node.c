@@ -110,6 +110,25 @@ int main(int argc, char *argv[])
 
 	knot_rrset_free(dummy_rrset, NULL);
 
+	// Test wire sizes
+	ok(node_rrset_wire_min(node, KNOT_RRTYPE_TXT, false) == 0,
+	   "Node: wire size unknown before update.");
+	node_update_wire_sizes(node);
+	ok(node_rrset_wire_min(node, KNOT_RRTYPE_TXT, false) == 2 + 10 + 8,
+	   "Node: wire size of RRSet.");
+	ok(node_rrset_wire_min(node, KNOT_RRTYPE_TXT, true) == 2 * (2 + 10) + 8 + 2,
+	   "Node: wire size of RRSet with RRSIGs.");
+	dummy_rrset = create_dummy_rrset(dummy_owner, KNOT_RRTYPE_NS);
+	ret = node_add_rrset(node, dummy_rrset, NULL);
+	assert(ret == KNOT_EOK);
+	knot_rrset_free(dummy_rrset, NULL);
+	ok(node_rrset_wire_min(node, KNOT_RRTYPE_TXT, false) == 0,
+	   "Node: wire size unknown after change.");
+	node_update_wire_sizes(node);
+	ok(node_rrset_wire_min(node, KNOT_RRTYPE_NS, false) == 2 + 10,
+	   "Node: wire size of compressible RRSet.");
+	node_remove_rdataset(node, KNOT_RRTYPE_NS);
+
 	// Test remove RRset
 	node_remove_rdataset(node, KNOT_RRTYPE_AAAA);
 	ok(node->rrset_count == 2, "Node: remove non-existent rdataset.");
@@ -0,0 +1,74 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <tap/basic.h>
+
+#include "knot/zone/contents.h"
+#include "knot/zone/nsec3-cache.h"
+#include "libknot/libknot.h"
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	const zone_node_t *node = NULL, *prev = NULL;
+	int match = -1;
+
+	nsec3_cache_t *cache = nsec3_cache_new();
+	ok(cache != NULL, "nsec3 cache: create");
+
+	knot_dname_t *name = knot_dname_from_str_alloc("nonexistent.example.com.");
+	ok(!nsec3_cache_get(cache, name, &match, &node, &prev), "nsec3 cache: miss");
+
+	zone_node_t nodes[2] = { { 0 } };
+	const zone_node_t *n1 = &nodes[0], *n2 = &nodes[1];
+	nsec3_cache_put(cache, name, ZONE_NAME_NOT_FOUND, n1, n2);
+	ok(nsec3_cache_get(cache, name, &match, &node, &prev) &&
+	   match == ZONE_NAME_NOT_FOUND && node == n1 && prev == n2, "nsec3 cache: hit");
+
+	knot_dname_t *other = knot_dname_from_str_alloc("other.example.com.");
+	ok(!nsec3_cache_get(cache, other, &match, &node, &prev), "nsec3 cache: other name");
+
+	nsec3_cache_put(cache, name, ZONE_NAME_FOUND, n2, n1);
+	ok(nsec3_cache_get(cache, name, &match, &node, &prev) &&
+	   match == ZONE_NAME_FOUND && node == n2 && prev == n1, "nsec3 cache: replace");
+
+	knot_dname_t *longname = knot_dname_from_str_alloc(
+		"a-very-long-label-to-exceed-the-limit.of-the-cached-names.example.com.");
+	nsec3_cache_put(cache, longname, ZONE_NAME_NOT_FOUND, n1, n2);
+	ok(!nsec3_cache_get(cache, longname, &match, &node, &prev), "nsec3 cache: long name");
+
+	bool hits = true;
+	for (int i = 0; i < NSEC3_CACHE_SIZE; i++) {
+		char str[32];
+		(void)snprintf(str, sizeof(str), "n%d.example.com.", i);
+		knot_dname_t *n = knot_dname_from_str_alloc(str);
+		nsec3_cache_put(cache, n, ZONE_NAME_NOT_FOUND, n1, n2);
+		hits &= nsec3_cache_get(cache, n, &match, &node, &prev) && node == n1;
+		knot_dname_free(n, NULL);
+	}
+	ok(hits, "nsec3 cache: many names");
+
+	nsec3_cache_free(cache);
+	nsec3_cache_free(NULL);
+
+	knot_dname_free(name, NULL);
+	knot_dname_free(other, NULL);
+	knot_dname_free(longname, NULL);
+
+	return 0;
+}
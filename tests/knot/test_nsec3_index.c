@@ -0,0 +1,161 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <tap/basic.h>
+
+#include "contrib/base32hex.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "knot/zone/nsec3-index.h"
+#include "libknot/libknot.h"
+
+#define HASH_LEN	20
+#define NODES		1000
+
+static const knot_dname_t *apex = (const knot_dname_t *)"\x07""example""\x03""com";
+
+static void random_hash(uint8_t *hash)
+{
+	for (int i = 0; i < HASH_LEN; i++) {
+		hash[i] = rand();
+	}
+}
+
+static zone_node_t *add_node(zone_tree_t *tree, const uint8_t *hash)
+{
+	knot_dname_storage_t owner;
+	if (knot_nsec3_hash_to_dname(owner, sizeof(owner), hash, HASH_LEN, apex) != KNOT_EOK) {
+		return NULL;
+	}
+	zone_node_t *node = node_new(owner, false, false, NULL);
+	if (node != NULL && zone_tree_insert(tree, &node) != KNOT_EOK) {
+		node_free(node, NULL);
+		return NULL;
+	}
+	return node;
+}
+
+static void link_prevs(zone_tree_t *tree)
+{
+	zone_tree_it_t it = { 0 };
+	(void)zone_tree_it_begin(tree, &it);
+	zone_node_t *first = zone_tree_it_val(&it), *prev = NULL;
+	for (; !zone_tree_it_finished(&it); zone_tree_it_next(&it)) {
+		zone_node_t *node = zone_tree_it_val(&it);
+		node->prev = prev;
+		prev = node;
+	}
+	first->prev = prev;
+	zone_tree_it_free(&it);
+}
+
+static bool check_lookups(nsec3_index_t *index, zone_tree_t *tree,
+                          zone_node_t **nodes, size_t count)
+{
+	for (int i = 0; i < 2 * count; i++) {
+		uint8_t hash[HASH_LEN];
+		knot_dname_storage_t owner;
+		random_hash(hash);
+		if (i < count) {
+			// Half of the lookups hit an existing node.
+			zone_node_t *node = nodes[i];
+			(void)knot_base32hex_decode(node->owner + 1, *node->owner, hash, HASH_LEN);
+		}
+		(void)knot_nsec3_hash_to_dname(owner, sizeof(owner), hash, HASH_LEN, apex);
+
+		zone_node_t *found = NULL, *prev = NULL, *t_found = NULL, *t_prev = NULL;
+		int ret = nsec3_index_find(index, tree, hash, HASH_LEN, &found, &prev);
+		int t_ret = zone_tree_get_less_or_equal(tree, owner, &t_found, &t_prev);
+		if (ret != t_ret || found != t_found || prev != t_prev) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int free_node(zone_node_t *node, void *ctx)
+{
+	node_free(node, NULL);
+	return KNOT_EOK;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	srand(42);
+
+	zone_tree_t *tree = zone_tree_create(false);
+	ok(nsec3_index_build(tree, apex) == NULL, "nsec3 index: empty tree");
+
+	zone_node_t *nodes[NODES];
+	for (int i = 0; i < NODES; i++) {
+		uint8_t hash[HASH_LEN];
+		random_hash(hash);
+		nodes[i] = add_node(tree, hash);
+	}
+	link_prevs(tree);
+
+	nsec3_index_t *index = nsec3_index_build(tree, apex);
+	ok(index != NULL && nsec3_index_size(index) > 0, "nsec3 index: build");
+	ok(check_lookups(index, tree, nodes, NODES), "nsec3 index: lookups match the tree");
+
+	uint8_t short_hash[HASH_LEN / 2] = { 0 };
+	zone_node_t *found = NULL, *prev = NULL;
+	ok(nsec3_index_find(index, tree, short_hash, sizeof(short_hash), &found, &prev) == KNOT_EINVAL,
+	   "nsec3 index: hash length mismatch");
+
+	zone_tree_t *changed = zone_tree_create(false);
+	ok(nsec3_index_update(index, tree, changed, apex) == index, "nsec3 index: no change shared");
+	nsec3_index_free(index);
+
+	// Remove some nodes and add new ones.
+	zone_node_t *removed[NODES / 10];
+	for (int i = 0; i < NODES / 10; i++) {
+		zone_node_t *node = nodes[i * 10];
+		removed[i] = node;
+		zone_tree_remove_node(tree, node->owner);
+		(void)zone_tree_insert(changed, &node);
+		uint8_t hash[HASH_LEN];
+		random_hash(hash);
+		nodes[i * 10] = add_node(tree, hash);
+		(void)zone_tree_insert(changed, &nodes[i * 10]);
+	}
+	link_prevs(tree);
+
+	nsec3_index_t *updated = nsec3_index_update(index, tree, changed, apex);
+	ok(updated != NULL && updated != index, "nsec3 index: update");
+	ok(check_lookups(updated, tree, nodes, NODES), "nsec3 index: updated lookups match the tree");
+	nsec3_index_free(updated);
+	nsec3_index_free(index);
+
+	knot_dname_storage_t other;
+	(void)knot_dname_from_str(other, "x.example.com.", sizeof(other));
+	zone_node_t *node = node_new(other, false, false, NULL);
+	(void)zone_tree_insert(tree, &node);
+	ok(nsec3_index_build(tree, apex) == NULL, "nsec3 index: non-hash owner");
+
+	nsec3_index_free(NULL);
+
+	for (int i = 0; i < NODES / 10; i++) {
+		node_free(removed[i], NULL);
+	}
+	zone_tree_free(&changed);
+	(void)zone_tree_apply(tree, free_node, NULL);
+	zone_tree_free(&tree);
+
+	return 0;
+}
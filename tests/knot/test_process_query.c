@@ -186,6 +186,32 @@ int main(int argc, char *argv[])
 	knot_layer_finish(&proc);
 	ok(proc.state == KNOT_STATE_NOOP, "ns: processing end" );
 
+	/* Query processor with reused query data. */
+	knot_mm_t reuse_mm;
+	mm_ctx_mempool(&reuse_mm, MM_DEFAULT_BLKSIZE);
+	process_query_data_t reuse_data;
+	knot_layer_t reuse;
+	knot_layer_init(&reuse, &reuse_mm, process_query_layer());
+	process_query_prealloc(&reuse, &reuse_data);
+	for (int i = 0; i < 2; i++) {
+		knot_layer_begin(&reuse, &params);
+		knot_pkt_clear(query);
+		knot_pkt_put_question(query, ROOT_DNAME, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+		exec_query(&reuse, "IN/reused-data", query, KNOT_RCODE_NOERROR);
+
+		unsigned allocs = knotd_qdata_alloc_count(&reuse_data.qdata);
+		(void)mm_alloc(reuse_data.qdata.mm, 1);
+		is_int(allocs + 1, knotd_qdata_alloc_count(&reuse_data.qdata),
+		       "ns: allocation counted");
+
+		knot_layer_finish(&reuse);
+		ok(reuse.data == &reuse_data.qdata, "ns: query data kept");
+		mp_flush(reuse_mm.ctx);
+		is_int(0, knotd_qdata_alloc_count(&reuse_data.qdata),
+		       "ns: allocation count reset");
+	}
+	mp_delete(reuse_mm.ctx);
+
 fatal:
 	/* Cleanup. */
 	mp_delete((struct mempool *)mm.ctx);
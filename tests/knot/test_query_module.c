@@ -61,7 +61,7 @@ int main(int argc, char *argv[])
 	int state = 0, next_state = 0;
 	for (unsigned stage = KNOTD_STAGE_BEGIN; stage < KNOTD_STAGES; ++stage) {
 		struct query_step *step = NULL;
-		WALK_LIST(step, plan->stage[stage]) {
+		QUERY_PLAN_WALK(step, plan, stage) {
 			next_state = step->process(state, NULL, NULL, step->ctx);
 			if (next_state != state + 1) {
 				break;
@@ -70,6 +70,7 @@ int main(int argc, char *argv[])
 		}
 	}
 	ok(state == KNOTD_STAGES, "query_plan: executed all steps");
+	ok(plan->mask == (1U << KNOTD_STAGES) - 1, "query_plan: all stages non-empty");
 
 	/* Verify if all steps executed their callback. */
 	for (state = 0; state < KNOTD_STAGES; ++state) {
@@ -0,0 +1,156 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <tap/basic.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libknot/descriptor.h"
+#include "libknot/errcode.h"
+#include "knot/query/mux.h"
+#include "contrib/net.h"
+#include "contrib/sockaddr.h"
+
+#define QUERIES 4
+
+static const int TIMEOUT = 2000;
+
+static struct sockaddr_storage server, client;
+static unsigned accepted;
+
+static void set_blocking_mode(int sock)
+{
+	int flags = fcntl(sock, F_GETFL);
+	flags &= ~O_NONBLOCK;
+	fcntl(sock, F_SETFL, flags);
+}
+
+/*! \brief Answers all the pipelined queries in the reverse order. */
+static void *responder_thread(void *arg)
+{
+	int fd = *(int *)arg;
+
+	set_blocking_mode(fd);
+	static uint8_t bufs[QUERIES][KNOT_WIRE_MAX_PKTSIZE];
+	int lens[QUERIES];
+
+	int conn = accept(fd, NULL, NULL);
+	if (conn < 0) {
+		return NULL;
+	}
+	accepted++;
+
+	for (int i = 0; i < QUERIES; i++) {
+		lens[i] = net_dns_tcp_recv(conn, bufs[i], sizeof(bufs[i]), -1);
+		if (lens[i] < KNOT_WIRE_HEADER_SIZE) {
+			close(conn);
+			return NULL;
+		}
+	}
+	for (int i = QUERIES - 1; i >= 0; i--) {
+		knot_wire_set_qr(bufs[i]);
+		net_dns_tcp_send(conn, bufs[i], lens[i], -1, NULL);
+	}
+
+	// Wait for the client closing the connection.
+	uint8_t byte;
+	(void)recv(conn, &byte, 1, 0);
+	close(conn);
+
+	return NULL;
+}
+
+typedef struct {
+	query_mux_t *mux;
+	uint16_t qtype;
+	bool ok;
+} query_ctx_t;
+
+static void *query_thread(void *arg)
+{
+	query_ctx_t *ctx = arg;
+
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_pkt_t *resp = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	assert(query && resp);
+	knot_wire_set_id(query->wire, 1); // Colliding IDs.
+	knot_pkt_put_question(query, (uint8_t *)"", KNOT_CLASS_IN, ctx->qtype);
+
+	bool reused;
+	query_mux_wait_t *wait = NULL;
+	int ret = query_mux_register(ctx->mux, &client, &server, query, resp, &reused, &wait);
+	if (ret == KNOT_EOK) {
+		ret = query_mux_send(ctx->mux, wait, TIMEOUT);
+	}
+	if (ret == KNOT_EOK) {
+		ret = query_mux_recv(ctx->mux, wait, TIMEOUT);
+	}
+	query_mux_unregister(ctx->mux, wait);
+
+	ctx->ok = ret > 0 && knot_pkt_parse(resp, 0) == KNOT_EOK &&
+	          knot_wire_get_id(resp->wire) == knot_wire_get_id(query->wire) &&
+	          knot_pkt_qtype(resp) == ctx->qtype;
+
+	knot_pkt_free(query);
+	knot_pkt_free(resp);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	sockaddr_set(&client, AF_INET, "127.0.0.1", 0);
+	sockaddr_set(&server, AF_INET, "127.0.0.1", 0);
+
+	int responder_fd = net_bound_socket(SOCK_STREAM, &server, 0);
+	assert(responder_fd >= 0);
+	socklen_t addr_len = sockaddr_len(&server);
+	int ret = getsockname(responder_fd, (struct sockaddr *)&server, &addr_len);
+	ok(ret == 0, "check getsockname return");
+	ret = listen(responder_fd, 10);
+	ok(ret == 0, "check listen return");
+
+	pthread_t responder;
+	pthread_create(&responder, NULL, responder_thread, &responder_fd);
+
+	query_mux_t *mux = query_mux_init(5);
+	ok(mux != NULL, "query mux: init");
+
+	pthread_t threads[QUERIES];
+	query_ctx_t ctxs[QUERIES];
+	for (int i = 0; i < QUERIES; i++) {
+		ctxs[i] = (query_ctx_t){ .mux = mux, .qtype = KNOT_RRTYPE_A + i };
+		pthread_create(&threads[i], NULL, query_thread, &ctxs[i]);
+	}
+	bool all = true;
+	for (int i = 0; i < QUERIES; i++) {
+		pthread_join(threads[i], NULL);
+		all = all && ctxs[i].ok;
+	}
+	ok(all, "query mux: pipelined responses dispatched");
+
+	query_mux_deinit(mux);
+	pthread_join(responder, NULL);
+	is_int(1, accepted, "query mux: single connection");
+	close(responder_fd);
+
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <urcu.h>
+
+#include "knot/common/reclaim.h"
+
+#define OBJECTS 1000
+
+static unsigned freed;
+
+static void free_cb(void *ptr)
+{
+	(*(unsigned *)ptr)++;
+	__atomic_add_fetch(&freed, 1, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	bool locked;
+	bool release;
+} reader_t;
+
+static void *reader(void *_ctx)
+{
+	reader_t *ctx = _ctx;
+
+	rcu_register_thread();
+	rcu_read_lock();
+
+	pthread_mutex_lock(&ctx->lock);
+	ctx->locked = true;
+	pthread_cond_broadcast(&ctx->cond);
+	while (!ctx->release) {
+		pthread_cond_wait(&ctx->cond, &ctx->lock);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+
+	rcu_read_unlock();
+	rcu_unregister_thread();
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	static unsigned objects[OBJECTS];
+
+	reclaim_defer(NULL, free_cb, 1);
+	reclaim_barrier();
+	is_int(0, freed, "NULL ignored");
+
+	/* Objects are kept while a reader may see them. */
+	reader_t ctx = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+	};
+	pthread_t thread;
+	pthread_create(&thread, NULL, reader, &ctx);
+	pthread_mutex_lock(&ctx.lock);
+	while (!ctx.locked) {
+		pthread_cond_wait(&ctx.cond, &ctx.lock);
+	}
+	pthread_mutex_unlock(&ctx.lock);
+
+	for (unsigned i = 0; i < OBJECTS; i++) {
+		reclaim_defer(&objects[i], free_cb, 10);
+	}
+	ok(reclaim_pending() == 10 * OBJECTS, "pending size");
+	is_int(0, __atomic_load_n(&freed, __ATOMIC_RELAXED), "kept during read-side section");
+
+	pthread_mutex_lock(&ctx.lock);
+	ctx.release = true;
+	pthread_cond_broadcast(&ctx.cond);
+	pthread_mutex_unlock(&ctx.lock);
+	pthread_join(thread, NULL);
+
+	reclaim_barrier();
+	is_int(OBJECTS, freed, "freed after grace period");
+	ok(reclaim_pending() == 0, "nothing pending");
+	bool once = true;
+	for (unsigned i = 0; i < OBJECTS; i++) {
+		once = once && objects[i] == 1;
+	}
+	ok(once, "each object freed once");
+
+	/* Deinit frees the queued objects. */
+	for (unsigned i = 0; i < OBJECTS; i++) {
+		reclaim_defer(&objects[i], free_cb, 1);
+	}
+	reclaim_deinit();
+	is_int(2 * OBJECTS, freed, "freed by deinit");
+
+	/* The thread is started again after deinit. */
+	reclaim_defer(&objects[0], free_cb, 1);
+	reclaim_barrier();
+	is_int(2 * OBJECTS + 1, freed, "freed after restart");
+	reclaim_deinit();
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/zone/referral-cache.h"
+#include "libknot/libknot.h"
+
+/* Sections rendered after the question 'example.com.' (at offset 12), i.e. from 29. */
+static const uint8_t rendered[] = {
+	/* example.com. NS ns.example.com. */
+	0xC0, 0x0C, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x0E, 0x10, 0x00, 0x05,
+	0x02, 'n', 's', 0xC0, 0x0C,
+	/* ns.example.com. A 192.0.2.1 */
+	0xC0, 0x29, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x0E, 0x10, 0x00, 0x04,
+	0xC0, 0x00, 0x02, 0x01,
+};
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	zone_node_t nodes[2] = { { 0 } };
+	const zone_node_t *deleg = &nodes[0], *other = &nodes[1];
+	uint8_t wire[128];
+	uint16_t nscount = 0, arcount = 0;
+
+	referral_cache_t *cache = referral_cache_new(16);
+	ok(cache != NULL, "referral cache: create");
+
+	ok(referral_new(deleg, false, rendered, sizeof(rendered) - 1, 1, 1) == NULL,
+	   "referral cache: truncated sections");
+	ok(referral_new(deleg, false, rendered, sizeof(rendered), 1, 2) == NULL,
+	   "referral cache: wrong record count");
+
+	int ret = referral_cache_write(cache, deleg, false, 0, wire, sizeof(wire),
+	                               &nscount, &arcount);
+	ok(ret == KNOT_ENOENT, "referral cache: miss");
+
+	referral_t *ref = referral_new(deleg, false, rendered, sizeof(rendered), 1, 1);
+	ok(ref != NULL, "referral cache: new referral");
+	referral_cache_put(cache, ref);
+
+	ret = referral_cache_write(cache, deleg, false, 0, wire, sizeof(wire),
+	                           &nscount, &arcount);
+	ok(ret == sizeof(rendered) && memcmp(wire, rendered, sizeof(rendered)) == 0 &&
+	   nscount == 1 && arcount == 1, "referral cache: hit");
+
+	/* Query 'www.example.com.' is 4 bytes longer. */
+	ret = referral_cache_write(cache, deleg, false, 4, wire, sizeof(wire),
+	                           &nscount, &arcount);
+	ok(ret == sizeof(rendered) &&
+	   knot_wire_get_pointer(wire) == 12 + 4 &&
+	   knot_wire_get_pointer(wire + 15) == 12 + 4 &&
+	   knot_wire_get_pointer(wire + 17) == 0x29 + 4 &&
+	   memcmp(wire + 19, rendered + 19, sizeof(rendered) - 19) == 0,
+	   "referral cache: shifted pointers");
+
+	ret = referral_cache_write(cache, deleg, true, 0, wire, sizeof(wire),
+	                           &nscount, &arcount);
+	ok(ret == KNOT_ENOENT, "referral cache: other DO bit");
+	ret = referral_cache_write(cache, other, false, 0, wire, sizeof(wire),
+	                           &nscount, &arcount);
+	ok(ret == KNOT_ENOENT, "referral cache: other delegation");
+
+	ret = referral_cache_write(cache, deleg, false, 0, wire, sizeof(rendered) - 1,
+	                           &nscount, &arcount);
+	ok(ret == KNOT_ESPACE, "referral cache: no space");
+	ret = referral_cache_write(cache, deleg, false, KNOT_WIRE_PTR_MAX, wire, sizeof(wire),
+	                           &nscount, &arcount);
+	ok(ret == KNOT_ESPACE, "referral cache: pointer out of range");
+
+	/* Only the NS record. */
+	referral_cache_put(cache, referral_new(deleg, false, rendered, 17, 1, 0));
+	ret = referral_cache_write(cache, deleg, false, 0, wire, sizeof(wire),
+	                           &nscount, &arcount);
+	ok(ret == 17 && nscount == 1 && arcount == 0, "referral cache: replace");
+
+	referral_cache_free(cache);
+	referral_cache_free(NULL);
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "knot/updates/apply.h"
+#include "knot/zone/shared-rdata.h"
+#include "libknot/libknot.h"
+
+static void add_rr(zone_contents_t *contents, const knot_dname_t *owner,
+                   uint16_t type, const uint8_t *rdata, uint16_t len)
+{
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, (knot_dname_t *)owner, type, KNOT_CLASS_IN, 3600);
+	(void)knot_rrset_add_rdata(&rr, rdata, len, NULL);
+	zone_node_t *unused = NULL;
+	(void)zone_contents_add_rr(contents, &rr, &unused);
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+static zone_contents_t *parked_zone(const char *apex_str)
+{
+	const uint8_t soa[22] = { 0 };
+	const uint8_t addr[4] = { 192, 0, 2, 1 };
+	const uint8_t txt[] = "\x0Bparked zone";
+
+	knot_dname_t *apex = knot_dname_from_str_alloc(apex_str);
+	zone_contents_t *contents = zone_contents_new(apex, true);
+	if (contents != NULL) {
+		add_rr(contents, apex, KNOT_RRTYPE_SOA, soa, sizeof(soa));
+		add_rr(contents, apex, KNOT_RRTYPE_A, addr, sizeof(addr));
+		add_rr(contents, apex, KNOT_RRTYPE_TXT, txt, sizeof(txt) - 1);
+	}
+	knot_dname_free(apex, NULL);
+
+	return contents;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	shared_rdata_stats_t stats;
+
+	zone_contents_t *a = parked_zone("a.");
+	zone_contents_t *b = parked_zone("b.");
+	ok(a != NULL && b != NULL, "create zones");
+
+	ok(shared_rdata_share(a) == KNOT_EOK && shared_rdata_share(b) == KNOT_EOK,
+	   "share rdata");
+	// As done after the contents are published.
+	zone_trees_unify_binodes(a->nodes, a->nsec3_nodes, false);
+	zone_trees_unify_binodes(b->nodes, b->nsec3_nodes, false);
+	ok(node_rdataset(a->apex, KNOT_RRTYPE_A)->rdata ==
+	   node_rdataset(b->apex, KNOT_RRTYPE_A)->rdata &&
+	   node_rdataset(a->apex, KNOT_RRTYPE_TXT)->rdata ==
+	   node_rdataset(b->apex, KNOT_RRTYPE_TXT)->rdata, "identical rdata shared");
+	ok(node_rdataset(a->apex, KNOT_RRTYPE_SOA)->rdata !=
+	   node_rdataset(b->apex, KNOT_RRTYPE_SOA)->rdata, "SOA not shared");
+
+	shared_rdata_stats(&stats);
+	ok(stats.sets == 2 && stats.refs == 4 && stats.saved == stats.bytes, "statistics");
+
+	ok(shared_rdata_share(a) == KNOT_EOK, "repeated sharing");
+	shared_rdata_stats(&stats);
+	ok(stats.refs == 4, "no extra references");
+
+	// An incremental change gets its own copy of the rdataset.
+	const knot_rdata_t *shared = node_rdataset(b->apex, KNOT_RRTYPE_A)->rdata;
+	zone_contents_t *b2 = NULL;
+	apply_ctx_t ctx = { 0 };
+	int ret = zone_contents_cow(b, &b2);
+	if (ret == KNOT_EOK) {
+		ret = apply_init_ctx(&ctx, b2, 0);
+	}
+	if (ret == KNOT_EOK) {
+		const uint8_t addr[4] = { 192, 0, 2, 2 };
+		knot_rrset_t rr;
+		knot_rrset_init(&rr, b2->apex->owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600);
+		(void)knot_rrset_add_rdata(&rr, addr, sizeof(addr), NULL);
+		ret = apply_add_rr(&ctx, &rr);
+		knot_rdataset_clear(&rr.rrs, NULL);
+	}
+	ok(ret == KNOT_EOK && node_rdataset(b2->apex, KNOT_RRTYPE_A)->count == 2 &&
+	   node_rdataset(b2->apex, KNOT_RRTYPE_A)->rdata != shared &&
+	   node_rdataset(a->apex, KNOT_RRTYPE_A)->rdata == shared &&
+	   node_rdataset(a->apex, KNOT_RRTYPE_A)->count == 1, "copy on change");
+
+	update_free_zone(b);
+	apply_cleanup(&ctx);
+	shared_rdata_stats(&stats);
+	ok(stats.sets == 2 && stats.refs == 3, "changed rdataset released");
+
+	zone_contents_deep_free(b2);
+	zone_contents_deep_free(a);
+	shared_rdata_stats(&stats);
+	ok(stats.sets == 0 && stats.refs == 0 && stats.bytes == 0 && stats.saved == 0,
+	   "everything released");
+
+	return 0;
+}
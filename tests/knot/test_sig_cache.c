@@ -0,0 +1,113 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "knot/dnssec/sig-cache.h"
+#include "libknot/libknot.h"
+
+static knot_rrset_t *make_rrset(const char *owner, uint16_t type, uint32_t ttl,
+                                const uint8_t *rdata, uint16_t len)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(owner);
+	knot_rrset_t *rrset = knot_rrset_new(name, type, KNOT_CLASS_IN, ttl, NULL);
+	knot_dname_free(name, NULL);
+	if (rrset != NULL && knot_rrset_add_rdata(rrset, rdata, len, NULL) != KNOT_EOK) {
+		knot_rrset_free(rrset, NULL);
+		return NULL;
+	}
+	return rrset;
+}
+
+static knot_rrset_t *make_rrsig(const char *owner, uint32_t expire)
+{
+	uint8_t rdata[32] = { 0 };
+	knot_wire_write_u32(rdata + 8, expire);
+	return make_rrset(owner, KNOT_RRTYPE_RRSIG, 3600, rdata, sizeof(rdata));
+}
+
+static bool cached(sig_cache_t *cache, const knot_rrset_t *covered, uint32_t gen,
+                   knot_time_t valid_till, const knot_rrset_t *expect)
+{
+	knot_rrset_t *out = knot_rrset_new(covered->owner, KNOT_RRTYPE_RRSIG,
+	                                   KNOT_CLASS_IN, covered->ttl, NULL);
+	int ret = sig_cache_get(cache, covered, gen, valid_till, out, NULL);
+	bool found = (ret == KNOT_EOK);
+	if (found && expect != NULL) {
+		found = knot_rdataset_eq(&out->rrs, &expect->rrs);
+	}
+	knot_rrset_free(out, NULL);
+	return found;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	ok(sig_cache_new(0) == NULL, "sig cache: zero size");
+
+	sig_cache_t *cache = sig_cache_new(16);
+	ok(cache != NULL, "sig cache: create");
+	if (cache == NULL) {
+		return 1;
+	}
+
+	const uint8_t addr1[] = { 192, 0, 2, 1 };
+	const uint8_t addr2[] = { 192, 0, 2, 2 };
+	knot_rrset_t *a = make_rrset("www.example.", KNOT_RRTYPE_A, 300, addr1, 4);
+	knot_rrset_t *a_ttl = make_rrset("www.example.", KNOT_RRTYPE_A, 60, addr1, 4);
+	knot_rrset_t *a_data = make_rrset("www.example.", KNOT_RRTYPE_A, 300, addr2, 4);
+	knot_rrset_t *a_owner = make_rrset("ftp.example.", KNOT_RRTYPE_A, 300, addr1, 4);
+	knot_rrset_t *sig = make_rrsig("www.example.", 1000);
+
+	ok(!cached(cache, a, 1, 1, NULL), "sig cache: empty");
+
+	sig_cache_put(cache, a, 1, sig);
+	ok(cached(cache, a, 1, 500, sig), "sig cache: hit");
+	ok(!cached(cache, a, 2, 500, NULL), "sig cache: other key generation");
+	ok(!cached(cache, a_ttl, 1, 500, NULL), "sig cache: other TTL");
+	ok(!cached(cache, a_data, 1, 500, NULL), "sig cache: other RDATA");
+	ok(!cached(cache, a_owner, 1, 500, NULL), "sig cache: other owner");
+	ok(!cached(cache, a, 1, 1000, NULL), "sig cache: expiring signature");
+
+	knot_rrset_t *sig2 = make_rrsig("www.example.", 2000);
+	sig_cache_put(cache, a, 1, sig2);
+	ok(cached(cache, a, 1, 1500, sig2), "sig cache: replaced entry");
+
+	/* Fill the cache over its size, colliding entries get replaced. */
+	char owner[32];
+	for (int i = 0; i < 100; i++) {
+		(void)snprintf(owner, sizeof(owner), "h%d.example.", i);
+		knot_rrset_t *rr = make_rrset(owner, KNOT_RRTYPE_A, 300, addr1, 4);
+		sig_cache_put(cache, rr, 1, sig);
+		knot_rrset_free(rr, NULL);
+	}
+	knot_rrset_t *last = make_rrset(owner, KNOT_RRTYPE_A, 300, addr1, 4);
+	ok(cached(cache, last, 1, 1, sig), "sig cache: bounded, last entry kept");
+	knot_rrset_free(last, NULL);
+
+	knot_rrset_free(a, NULL);
+	knot_rrset_free(a_ttl, NULL);
+	knot_rrset_free(a_data, NULL);
+	knot_rrset_free(a_owner, NULL);
+	knot_rrset_free(sig, NULL);
+	knot_rrset_free(sig2, NULL);
+	sig_cache_free(cache);
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "knot/dnssec/sign-pool.h"
+
+#define THREADS 4
+#define CALLERS 3
+#define ITEMS   10000
+
+typedef struct {
+	unsigned next;               // Next work item.
+	unsigned done[ITEMS];        // Times each item was processed.
+	unsigned used[THREADS];      // Times each index participated.
+	bool bad_index;
+} job_ctx_t;
+
+static void job(void *_ctx, unsigned index)
+{
+	job_ctx_t *ctx = _ctx;
+
+	if (index >= THREADS) {
+		ctx->bad_index = true;
+		return;
+	}
+	__atomic_add_fetch(&ctx->used[index], 1, __ATOMIC_RELAXED);
+
+	unsigned item;
+	while ((item = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)) < ITEMS) {
+		__atomic_add_fetch(&ctx->done[item], 1, __ATOMIC_RELAXED);
+	}
+}
+
+static bool check(job_ctx_t *ctx)
+{
+	for (unsigned i = 0; i < ITEMS; i++) {
+		if (ctx->done[i] != 1) {
+			return false;
+		}
+	}
+	for (unsigned i = 0; i < THREADS; i++) {
+		if (ctx->used[i] > 1) {
+			return false;
+		}
+	}
+	return !ctx->bad_index && ctx->used[0] == 1;
+}
+
+static void *caller(void *_ctx)
+{
+	for (int i = 0; i < 20; i++) {
+		memset(_ctx, 0, sizeof(job_ctx_t));
+		sign_pool_run(THREADS, job, _ctx);
+		if (!check(_ctx)) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	static job_ctx_t ctx;
+
+	sign_pool_run(1, job, &ctx);
+	ok(check(&ctx), "single thread job");
+
+	memset(&ctx, 0, sizeof(ctx));
+	sign_pool_run(THREADS, job, &ctx);
+	ok(check(&ctx), "parallel job");
+
+	/* Concurrent jobs share the helper threads. */
+	static job_ctx_t ctxs[CALLERS];
+	pthread_t threads[CALLERS];
+	for (int i = 0; i < CALLERS; i++) {
+		pthread_create(&threads[i], NULL, caller, &ctxs[i]);
+	}
+	bool all = true;
+	for (int i = 0; i < CALLERS; i++) {
+		pthread_join(threads[i], NULL);
+		all = all && check(&ctxs[i]);
+	}
+	ok(all, "concurrent jobs");
+
+	sign_pool_deinit();
+
+	/* Helpers are started again after deinit. */
+	memset(&ctx, 0, sizeof(ctx));
+	sign_pool_run(THREADS, job, &ctx);
+	ok(check(&ctx), "job after deinit");
+	sign_pool_deinit();
+
+	is_int(0, sign_pool_signatures(), "no signatures");
+	sign_pool_stats_add(1000, 500000);
+	sign_pool_stats_add(500, 1000000);
+	is_int(1500, sign_pool_signatures(), "total signatures");
+	is_int(500, sign_pool_rate(), "last signing rate");
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "contrib/wire_ctx.h"
+#include "knot/journal/serialization.h"
+#include "knot/zone/snapshot.h"
+#include "knot/zone/zone-dump.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+
+static const char *zone_str =
+"$TTL 300\n"
+"@ SOA ns.example. admin.example. 2022010101 3600 600 86400 300\n"
+"@ NS ns\n"
+"@ MX 10 mail\n"
+"ns A 192.0.2.1\n"
+"ns AAAA 2001:db8::1\n"
+"mail A 192.0.2.2\n"
+"mail A 192.0.2.3\n"
+"* TXT \"wildcard\"\n"
+"sub NS ns.sub\n"
+"ns.sub A 192.0.2.4\n";
+
+static zone_contents_t *parse(const char *path, const knot_dname_t *origin)
+{
+	sem_handler_t handler = { .cb = err_handler_logger };
+
+	zloader_t zl;
+	if (zonefile_open(&zl, path, origin, SEMCHECK_MANDATORY_ONLY, 0) != KNOT_EOK) {
+		return NULL;
+	}
+	zl.err_handler = &handler;
+
+	zone_contents_t *contents = zonefile_load(&zl);
+	zonefile_close(&zl);
+
+	return contents;
+}
+
+static char *dump(zone_contents_t *contents, size_t *len)
+{
+	char *buf = NULL;
+	FILE *f = open_memstream(&buf, len);
+	if (f == NULL) {
+		return NULL;
+	}
+	(void)zone_dump_text(contents, f, false, NULL, 1);
+	fclose(f);
+
+	return buf;
+}
+
+static int stream_node(zone_node_t *node, void *data)
+{
+	zone_snapshot_stream_t *stream = data;
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		size_t size = rrset_serialized_size(&rrset);
+		uint8_t buf[size];
+		wire_ctx_t wire = wire_ctx_init(buf, size);
+		int ret = serialize_rrset(&wire, &rrset);
+		if (ret == KNOT_EOK) {
+			ret = zone_snapshot_stream_write(stream, buf, size, 1);
+		}
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static void test_stream(zone_contents_t *parsed, const char *snap_path,
+                        const knot_dname_t *origin, const struct stat *st)
+{
+	zone_snapshot_stream_t *stream = NULL;
+	int ret = zone_snapshot_stream_open(snap_path, origin, zone_contents_serial(parsed),
+	                                    &stream);
+	is_int(KNOT_EOK, ret, "stream: open");
+	if (ret != KNOT_EOK) {
+		return;
+	}
+	is_int(KNOT_EOK, zone_contents_apply(parsed, stream_node, stream), "stream: write");
+	is_int(KNOT_EOK, zone_snapshot_stream_close(stream, st), "stream: close");
+
+	zone_contents_t *loaded = NULL;
+	is_int(KNOT_EOK, zone_snapshot_load(snap_path, origin, st, &loaded), "stream: load");
+	size_t parsed_len = 0, loaded_len = 0;
+	char *parsed_txt = dump(parsed, &parsed_len);
+	char *loaded_txt = loaded != NULL ? dump(loaded, &loaded_len) : NULL;
+	ok(parsed_txt != NULL && loaded_txt != NULL && parsed_len == loaded_len &&
+	   memcmp(parsed_txt, loaded_txt, parsed_len) == 0, "stream: same contents");
+	free(parsed_txt);
+	free(loaded_txt);
+	zone_contents_deep_free(loaded);
+
+	/* Discarded stream keeps the previous snapshot. */
+	ret = zone_snapshot_stream_open(snap_path, origin, 1, &stream);
+	if (ret == KNOT_EOK) {
+		ret = zone_snapshot_stream_close(stream, NULL);
+	}
+	is_int(KNOT_EOK, ret, "stream: discard");
+	loaded = NULL;
+	is_int(KNOT_EOK, zone_snapshot_load(snap_path, origin, st, &loaded),
+	       "stream: previous snapshot kept");
+	zone_contents_deep_free(loaded);
+}
+
+static void corrupt(const char *path, long offset)
+{
+	FILE *f = fopen(path, "r+");
+	if (f == NULL) {
+		return;
+	}
+	(void)fseek(f, offset, offset < 0 ? SEEK_END : SEEK_SET);
+	int c = fgetc(f);
+	(void)fseek(f, -1, SEEK_CUR);
+	(void)fputc(c ^ 0xff, f);
+	fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	char *tmpdir = test_mkdtemp();
+	ok(tmpdir != NULL, "make temporary directory");
+	char path[1024];
+	(void)snprintf(path, sizeof(path), "%s/example.zone", tmpdir);
+
+	FILE *f = fopen(path, "w");
+	ok(f != NULL && fputs(zone_str, f) >= 0, "write zone file");
+	if (f != NULL) {
+		fclose(f);
+	}
+
+	struct stat st;
+	ok(stat(path, &st) == 0, "stat zone file");
+
+	knot_dname_t *origin = knot_dname_from_str_alloc("example.");
+	zone_contents_t *parsed = parse(path, origin);
+	ok(parsed != NULL, "parse zone file");
+
+	char *snap_path = zone_snapshot_path(path);
+	ok(snap_path != NULL, "snapshot path");
+	is_int(KNOT_EOK, zone_snapshot_write(parsed, snap_path, &st), "write snapshot");
+
+	/* Snapshot contents equal to the parsed zone file. */
+	zone_contents_t *loaded = NULL;
+	is_int(KNOT_EOK, zone_snapshot_load(snap_path, origin, &st, &loaded), "load snapshot");
+	size_t parsed_len = 0, loaded_len = 0;
+	char *parsed_txt = dump(parsed, &parsed_len);
+	char *loaded_txt = loaded != NULL ? dump(loaded, &loaded_len) : NULL;
+	ok(parsed_txt != NULL && loaded_txt != NULL && parsed_len == loaded_len &&
+	   memcmp(parsed_txt, loaded_txt, parsed_len) == 0, "same contents");
+	is_int(zone_contents_serial(parsed), zone_contents_serial(loaded), "same serial");
+	free(parsed_txt);
+	free(loaded_txt);
+	zone_contents_deep_free(loaded);
+	loaded = NULL;
+
+	test_stream(parsed, snap_path, origin, &st);
+
+	/* Zone file or zone name mismatch. */
+	struct stat changed = st;
+	changed.st_mtim.tv_nsec ^= 1;
+	is_int(KNOT_ESEMCHECK, zone_snapshot_load(snap_path, origin, &changed, &loaded),
+	       "changed zone file mtime");
+	changed = st;
+	changed.st_size++;
+	is_int(KNOT_ESEMCHECK, zone_snapshot_load(snap_path, origin, &changed, &loaded),
+	       "changed zone file size");
+	knot_dname_t *other = knot_dname_from_str_alloc("example.com.");
+	is_int(KNOT_EMALF, zone_snapshot_load(snap_path, other, &st, &loaded),
+	       "different zone name");
+	knot_dname_free(other, NULL);
+
+	/* Corrupted data. */
+	corrupt(snap_path, -100);
+	is_int(KNOT_EMALF, zone_snapshot_load(snap_path, origin, &st, &loaded),
+	       "corrupted snapshot");
+	corrupt(snap_path, 0);
+	is_int(KNOT_EMALF, zone_snapshot_load(snap_path, origin, &st, &loaded),
+	       "bad magic");
+	ok(loaded == NULL, "no contents if error");
+
+	(void)unlink(snap_path);
+	is_int(KNOT_ENOENT, zone_snapshot_load(snap_path, origin, &st, &loaded),
+	       "missing snapshot");
+
+	free(snap_path);
+	zone_contents_deep_free(parsed);
+	knot_dname_free(origin, NULL);
+	test_rm_rf(tmpdir);
+	free(tmpdir);
+
+	return 0;
+}
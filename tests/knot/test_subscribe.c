@@ -0,0 +1,111 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/common/subscribe.h"
+#include "libknot/libknot.h"
+
+static knot_dname_t **zone_list(const char *name)
+{
+	knot_dname_t **zones = malloc(sizeof(*zones));
+	zones[0] = knot_dname_from_str_alloc(name);
+	return zones;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	const knot_dname_t *zone1 = (const uint8_t *)"\x07""example""\x03""com";
+	const knot_dname_t *zone2 = (const uint8_t *)"\x07""example""\x03""net";
+	const knot_dname_t *upper = (const uint8_t *)"\x07""EXAMPLE""\x03""com";
+
+	// No subscriber, no effect.
+	subscribe_emit(SUBSCRIBE_SERIAL, zone1, "updated", "%u", 1);
+
+	subscriber_t *all, *one;
+	int ret = subscribe_new(SUBSCRIBE_ALL, NULL, 0, &all);
+	is_int(KNOT_EOK, ret, "subscribe all");
+	ret = subscribe_new(SUBSCRIBE_REFRESH, zone_list("example.com."), 1, &one);
+	is_int(KNOT_EOK, ret, "subscribe one zone");
+
+	subscribe_msg_t msg;
+	ret = subscribe_wait(all, 10, &msg);
+	is_int(KNOT_ETIMEOUT, ret, "nothing emitted before subscription");
+
+	subscribe_emit(SUBSCRIBE_SERIAL, zone1, "updated", "%u", 2);
+	subscribe_emit(SUBSCRIBE_REFRESH, zone2, "ok", "%s", "updated");
+	subscribe_emit(SUBSCRIBE_REFRESH, upper, "failed", "%s", "timeout");
+
+	ret = subscribe_wait(all, 10, &msg);
+	ok(ret == KNOT_EOK && msg.kind == SUBSCRIBE_SERIAL &&
+	   knot_dname_is_equal(msg.zone, zone1) &&
+	   strcmp(msg.type, "updated") == 0 && strcmp(msg.value, "2") == 0 &&
+	   msg.lost == 0, "first notification");
+	ret = subscribe_wait(all, 10, &msg);
+	ok(ret == KNOT_EOK && knot_dname_is_equal(msg.zone, zone2), "second notification");
+	ret = subscribe_wait(all, 10, &msg);
+	ok(ret == KNOT_EOK && knot_dname_is_equal(msg.zone, zone1), "lower-cased zone");
+	ret = subscribe_wait(all, 10, &msg);
+	is_int(KNOT_ETIMEOUT, ret, "all read");
+
+	ret = subscribe_wait(one, 10, &msg);
+	ok(ret == KNOT_EOK && msg.kind == SUBSCRIBE_REFRESH &&
+	   strcmp(msg.type, "failed") == 0 && strcmp(msg.value, "timeout") == 0,
+	   "filtered notification");
+	ret = subscribe_wait(one, 10, &msg);
+	is_int(KNOT_ETIMEOUT, ret, "others filtered out");
+
+	// Overflow.
+	for (int i = 0; i < 5000; i++) {
+		subscribe_emit(SUBSCRIBE_EVENT, zone1, "load", "%s", "ok");
+	}
+	int count = 0;
+	while (subscribe_wait(all, 10, &msg) == KNOT_EOK) {
+		count++;
+	}
+	ok(count == 4096 && msg.lost == 0, "queue filled");
+	subscribe_emit(SUBSCRIBE_EVENT, zone1, "unload", "%s", "ok");
+	ret = subscribe_wait(all, 10, &msg);
+	ok(ret == KNOT_EOK && msg.lost == 5000 - 4096 && strcmp(msg.type, "unload") == 0,
+	   "lost notifications counted");
+
+	// Limit.
+	subscriber_t *more[SUBSCRIBE_MAX];
+	for (int i = 0; i < SUBSCRIBE_MAX - 2; i++) {
+		ret = subscribe_new(SUBSCRIBE_ALL, NULL, 0, &more[i]);
+		assert(ret == KNOT_EOK);
+	}
+	ret = subscribe_new(SUBSCRIBE_ALL, zone_list("example.com."), 1, &more[0]);
+	is_int(KNOT_ELIMIT, ret, "too many subscribers");
+	for (int i = 0; i < SUBSCRIBE_MAX - 2; i++) {
+		subscribe_free(more[i]);
+	}
+
+	subscribe_shutdown();
+	ret = subscribe_wait(all, 1000, &msg);
+	is_int(KNOT_EOF, ret, "shutdown");
+
+	subscribe_free(one);
+	subscribe_free(all);
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+#include <string.h>
+
+#include "knot/server/udp-cache.h"
+#include "libknot/libknot.h"
+#include "test_conf.h"
+
+static knot_pkt_t *make_query(const char *qname_str, uint16_t id, bool edns, bool do_bit)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_dname_t *qname = knot_dname_from_str_alloc(qname_str);
+	if (query == NULL || qname == NULL ||
+	    knot_pkt_put_question(query, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A) != KNOT_EOK) {
+		knot_dname_free(qname, NULL);
+		knot_pkt_free(query);
+		return NULL;
+	}
+	knot_dname_free(qname, NULL);
+	knot_wire_set_id(query->wire, id);
+
+	if (edns) {
+		knot_rrset_t opt;
+		(void)knot_edns_init(&opt, 1232, 0, KNOT_EDNS_VERSION, NULL);
+		if (do_bit) {
+			knot_edns_set_do(&opt);
+		}
+		(void)knot_pkt_begin(query, KNOT_ADDITIONAL);
+		(void)knot_pkt_put(query, KNOT_COMPR_HINT_NONE, &opt, KNOT_PF_FREE);
+	}
+
+	return query;
+}
+
+static knot_pkt_t *make_answer(knot_pkt_t *query, uint8_t rcode)
+{
+	knot_pkt_t *ans = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (ans == NULL || knot_pkt_init_response(ans, query) != KNOT_EOK) {
+		knot_pkt_free(ans);
+		return NULL;
+	}
+	knot_wire_set_rcode(ans->wire, rcode);
+
+	return ans;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	ok(test_conf("", NULL) == KNOT_EOK, "prepare configuration");
+
+	struct sockaddr_storage remote = { .ss_family = AF_INET };
+	uint8_t out[KNOT_WIRE_MAX_PKTSIZE];
+	udp_cache_key_t key;
+
+	udp_cache_t *cache = udp_cache_new(16);
+	ok(cache != NULL, "create cache");
+
+	knot_dname_t *zone_name = knot_dname_from_str_alloc("example.com.");
+	zone_t *zone = zone_new(zone_name);
+	knot_dname_free(zone_name, NULL);
+	ok(zone != NULL, "create zone");
+
+	/* Eligibility checks. */
+	knot_pkt_t *query = make_query("www.example.com.", 1, true, false);
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote),
+	   "key: plain EDNS query");
+	ok(!udp_cache_key(cache, &key, query->wire, query->size - 1, &remote),
+	   "key: truncated query");
+	knot_wire_set_qr(query->wire);
+	ok(!udp_cache_key(cache, &key, query->wire, query->size, &remote),
+	   "key: response");
+	knot_wire_clear_qr(query->wire);
+	remote.ss_family = AF_UNIX;
+	ok(!udp_cache_key(cache, &key, query->wire, query->size, &remote),
+	   "key: unsupported address family");
+	remote.ss_family = AF_INET;
+
+	/* Store and lookup. */
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote), "key: query");
+	is_int(0, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: empty cache");
+	knot_pkt_t *ans = make_answer(query, KNOT_RCODE_SERVFAIL);
+	udp_cache_store(cache, &key, ans, zone);
+	is_int(0, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: SERVFAIL not cached");
+	knot_pkt_free(ans);
+	ans = make_answer(query, KNOT_RCODE_NOERROR);
+	udp_cache_store(cache, &key, ans, NULL);
+	is_int(0, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: no zone not cached");
+	udp_cache_store(cache, &key, ans, zone);
+	is_int(ans->size, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: cached");
+	ok(udp_cache_promote(cache, &key), "promote: first hit");
+	ok(!udp_cache_promote(cache, &key), "promote: only once");
+	udp_cache_store(cache, &key, ans, zone);
+	ok(udp_cache_promote(cache, &key), "promote: again after store");
+	knot_pkt_free(ans);
+	knot_pkt_free(query);
+
+	/* Patching of the message ID, RD bit, and QNAME case. */
+	query = make_query("WWW.Example.com.", 2, true, false);
+	knot_wire_set_rd(query->wire);
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote), "key: case changed");
+	size_t len = udp_cache_answer(cache, &key, query->wire, out, sizeof(out));
+	ok(len > 0, "answer: case insensitive");
+	is_int(2, knot_wire_get_id(out), "answer: ID patched");
+	ok(knot_wire_get_rd(out), "answer: RD patched");
+	ok(memcmp(out + KNOT_WIRE_HEADER_SIZE, query->wire + KNOT_WIRE_HEADER_SIZE,
+	          knot_dname_size(knot_pkt_qname(query))) == 0, "answer: QNAME patched");
+	knot_pkt_free(query);
+
+	/* Different key parameters. */
+	query = make_query("www.example.com.", 3, true, true);
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote), "key: DO bit");
+	is_int(0, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: DO bit differs");
+	knot_pkt_free(query);
+	query = make_query("www.example.com.", 4, false, false);
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote), "key: no EDNS");
+	is_int(0, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: EDNS differs");
+	knot_pkt_free(query);
+
+	/* Invalidation. */
+	query = make_query("www.example.com.", 5, true, false);
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote), "key: again");
+	ok(udp_cache_answer(cache, &key, query->wire, out, sizeof(out)) > 0,
+	   "answer: still cached");
+	zone_answers_invalidate();
+	ok(udp_cache_key(cache, &key, query->wire, query->size, &remote), "key: invalidated");
+	is_int(0, udp_cache_answer(cache, &key, query->wire, out, sizeof(out)),
+	       "answer: invalidated");
+	knot_pkt_free(query);
+
+	zone_free(&zone);
+	udp_cache_free(cache);
+	test_conf_free();
+
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+#include <string.h>
+
+#include "knot/server/udp-refuse.h"
+#include "libknot/libknot.h"
+#include "test_conf.h"
+
+static knot_pkt_t *make_query(const char *qname_str, uint16_t qtype, bool edns,
+                              uint16_t opt_code)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_dname_t *qname = knot_dname_from_str_alloc(qname_str);
+	if (query == NULL || qname == NULL ||
+	    knot_pkt_put_question(query, qname, KNOT_CLASS_IN, qtype) != KNOT_EOK) {
+		knot_dname_free(qname, NULL);
+		knot_pkt_free(query);
+		return NULL;
+	}
+	knot_dname_free(qname, NULL);
+	knot_wire_set_id(query->wire, 0x1234);
+	knot_wire_set_rd(query->wire);
+	knot_wire_set_cd(query->wire);
+
+	if (edns) {
+		knot_rrset_t opt;
+		(void)knot_edns_init(&opt, 1232, 0, KNOT_EDNS_VERSION, NULL);
+		knot_edns_set_do(&opt);
+		if (opt_code != 0) {
+			(void)knot_edns_add_option(&opt, opt_code, 0, NULL, NULL);
+		}
+		(void)knot_pkt_begin(query, KNOT_ADDITIONAL);
+		(void)knot_pkt_put(query, KNOT_COMPR_HINT_NONE, &opt, KNOT_PF_FREE);
+	}
+
+	return query;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	ok(test_conf("server:\n  udp-max-payload-ipv4: 1400\n", NULL) == KNOT_EOK,
+	   "prepare configuration");
+
+	struct sockaddr_storage remote = { .ss_family = AF_INET };
+	uint8_t out[KNOT_WIRE_MAX_PKTSIZE];
+
+	knot_dname_t *zone_name = knot_dname_from_str_alloc("example.com.");
+	zone_t *zone = zone_new(zone_name);
+	knot_dname_free(zone_name, NULL);
+	knot_zonedb_t *db = knot_zonedb_new();
+	ok(zone != NULL && db != NULL && knot_zonedb_insert(db, zone) == KNOT_EOK,
+	   "create zone database");
+
+	/* Served zones. */
+	knot_pkt_t *query = make_query("www.example.com.", KNOT_RRTYPE_A, false, 0);
+	is_int(0, udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out)),
+	       "served zone processed");
+	knot_pkt_free(query);
+	query = make_query("example.com.", KNOT_RRTYPE_DS, false, 0);
+	is_int(0, udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out)),
+	       "DS at the apex processed");
+	knot_pkt_free(query);
+
+	/* Refusal without EDNS. */
+	query = make_query("www.Example.net.", KNOT_RRTYPE_A, false, 0);
+	size_t len = udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out));
+	is_int(query->size, len, "not served zone refused");
+	knot_pkt_t *ans = knot_pkt_new(out, len, NULL);
+	ok(knot_pkt_parse(ans, 0) == KNOT_EOK, "answer parsed");
+	ok(knot_wire_get_id(out) == 0x1234 && knot_wire_get_qr(out) &&
+	   knot_wire_get_rd(out) && !knot_wire_get_cd(out) && !knot_wire_get_aa(out) &&
+	   knot_wire_get_rcode(out) == KNOT_RCODE_REFUSED, "answer header");
+	ok(memcmp(out + KNOT_WIRE_HEADER_SIZE, query->wire + KNOT_WIRE_HEADER_SIZE,
+	          knot_pkt_question_size(query)) == 0, "answer question");
+	ok(!knot_pkt_has_edns(ans), "answer without EDNS");
+	knot_pkt_free(ans);
+	is_int(0, udp_refuse(db, query->wire, query->size, &remote, out, len - 1),
+	       "insufficient output");
+	is_int(0, udp_refuse(db, query->wire, query->size - 1, &remote, out, sizeof(out)),
+	       "truncated query");
+	knot_wire_set_qr(query->wire);
+	is_int(0, udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out)),
+	       "response ignored");
+	knot_pkt_free(query);
+
+	/* Refusal with EDNS. */
+	query = make_query("example.net.", KNOT_RRTYPE_A, true, KNOT_EDNS_OPTION_COOKIE);
+	len = udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out));
+	ok(len > 0, "EDNS query refused");
+	ans = knot_pkt_new(out, len, NULL);
+	ok(knot_pkt_parse(ans, 0) == KNOT_EOK && knot_pkt_has_edns(ans), "answer with EDNS");
+	ok(knot_edns_get_payload(ans->opt_rr) == 1400 && knot_pkt_has_dnssec(ans),
+	   "answer payload and DO bit");
+	uint8_t *ede = knot_pkt_edns_option(ans, KNOT_EDNS_OPTION_EDE);
+	ok(ede != NULL && knot_edns_opt_get_length(ede) == sizeof(uint16_t) &&
+	   knot_wire_read_u16(knot_edns_opt_get_data(ede)) == KNOT_EDNS_EDE_NOTAUTH,
+	   "answer extended error");
+	ok(knot_pkt_edns_option(ans, KNOT_EDNS_OPTION_COOKIE) == NULL, "cookie not echoed");
+	knot_pkt_free(ans);
+	knot_pkt_free(query);
+
+	/* Queries requiring the full processing. */
+	query = make_query("example.net.", KNOT_RRTYPE_A, true, KNOT_EDNS_OPTION_NSID);
+	is_int(0, udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out)),
+	       "NSID processed");
+	knot_pkt_free(query);
+	query = make_query("example.net.", KNOT_RRTYPE_AXFR, false, 0);
+	is_int(0, udp_refuse(db, query->wire, query->size, &remote, out, sizeof(out)),
+	       "meta type processed");
+	knot_pkt_free(query);
+
+	knot_zonedb_deep_free(&db, false);
+	test_conf_free();
+
+	return 0;
+}
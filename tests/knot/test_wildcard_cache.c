@@ -0,0 +1,59 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <tap/basic.h>
+
+#include "knot/zone/wildcard-cache.h"
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	zone_node_t nodes[4] = { { 0 } };
+	const zone_node_t *encl = &nodes[0], *wild = &nodes[1];
+	const zone_node_t *other = &nodes[2], *other_wild = &nodes[3];
+
+	wildcard_cache_t *cache = wildcard_cache_new();
+	ok(cache != NULL, "wildcard cache: create");
+
+	ok(wildcard_cache_get(cache, encl) == NULL, "wildcard cache: miss");
+
+	wildcard_cache_put(cache, encl, wild);
+	ok(wildcard_cache_get(cache, encl) == wild, "wildcard cache: hit");
+	ok(wildcard_cache_get(cache, other) == NULL, "wildcard cache: other encloser");
+
+	wildcard_cache_put(cache, encl, other_wild);
+	ok(wildcard_cache_get(cache, encl) == wild, "wildcard cache: entry kept");
+
+	static zone_node_t many[4 * WILDCARD_CACHE_SIZE];
+	for (int i = 0; i < 4 * WILDCARD_CACHE_SIZE; i += 2) {
+		wildcard_cache_put(cache, &many[i], &many[i + 1]);
+	}
+	bool correct = true;
+	for (int i = 0; i < 4 * WILDCARD_CACHE_SIZE; i += 2) {
+		const zone_node_t *w = wildcard_cache_get(cache, &many[i]);
+		correct &= (w == NULL || w == &many[i + 1]);
+	}
+	ok(correct, "wildcard cache: collisions");
+
+	ok(wildcard_cache_get(NULL, encl) == NULL, "wildcard cache: no cache");
+
+	wildcard_cache_free(cache);
+	wildcard_cache_free(NULL);
+
+	return 0;
+}
@@ -61,6 +61,72 @@ static void task_counting(worker_task_t *task)
 	pthread_mutex_unlock(&log->mx);
 }
 
+/*!
+ * Task recording the order of execution.
+ */
+typedef struct {
+	pthread_mutex_t mx;
+	worker_prio_t order[WORKER_PRIO_COUNT];
+	unsigned count;
+} order_log_t;
+
+typedef struct {
+	worker_task_t task;
+	order_log_t *log;
+} order_task_t;
+
+static void task_ordering(worker_task_t *task)
+{
+	order_log_t *log = ((order_task_t *)task)->log;
+
+	pthread_mutex_lock(&log->mx);
+	if (log->count < WORKER_PRIO_COUNT) {
+		log->order[log->count++] = task->prio;
+	}
+	pthread_mutex_unlock(&log->mx);
+}
+
+static void test_priorities(void)
+{
+	worker_pool_t *pool = worker_pool_create(1);
+	ok(pool != NULL, "priorities: create single thread pool");
+	if (!pool) {
+		return;
+	}
+
+	order_log_t log = { .mx = PTHREAD_MUTEX_INITIALIZER };
+	order_task_t tasks[] = {
+		{ .task = { .run = task_ordering, .prio = WORKER_PRIO_LOW }, .log = &log },
+		{ .task = { .run = task_ordering, .prio = WORKER_PRIO_NORMAL }, .log = &log },
+		{ .task = { .run = task_ordering, .prio = WORKER_PRIO_HIGH }, .log = &log },
+	};
+	for (int i = 0; i < WORKER_PRIO_COUNT; i++) {
+		worker_pool_assign(pool, &tasks[i].task);
+	}
+
+	worker_pool_stats_t stats;
+	worker_pool_stats(pool, &stats);
+	ok(stats.queued[WORKER_PRIO_HIGH] == 1 && stats.queued[WORKER_PRIO_NORMAL] == 1 &&
+	   stats.queued[WORKER_PRIO_LOW] == 1, "priorities: queue depth");
+
+	worker_pool_start(pool);
+	worker_pool_wait(pool);
+	ok(log.count == WORKER_PRIO_COUNT && log.order[0] == WORKER_PRIO_HIGH &&
+	   log.order[1] == WORKER_PRIO_NORMAL && log.order[2] == WORKER_PRIO_LOW,
+	   "priorities: execution order");
+
+	worker_pool_stats(pool, &stats);
+	ok(stats.queued[WORKER_PRIO_HIGH] == 0 && stats.executed[WORKER_PRIO_HIGH] == 1 &&
+	   stats.executed[WORKER_PRIO_NORMAL] == 1 && stats.executed[WORKER_PRIO_LOW] == 1 &&
+	   stats.wait_max[WORKER_PRIO_LOW] >= stats.wait_max[WORKER_PRIO_HIGH],
+	   "priorities: metrics");
+
+	worker_pool_stop(pool);
+	worker_pool_join(pool);
+	worker_pool_destroy(pool);
+	pthread_mutex_destroy(&log.mx);
+}
+
 static void interrupt_handle(int s)
 {
 }
@@ -148,5 +214,7 @@ int main(void)
 
 	pthread_mutex_destroy(&log.mx);
 
+	test_priorities();
+
 	return 0;
 }
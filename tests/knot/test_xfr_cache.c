@@ -0,0 +1,102 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include <string.h>
+
+#include "knot/nameserver/xfr_cache.h"
+#include "libknot/errcode.h"
+
+#define QSIZE 21
+#define IXFR_LAST XFR_CACHE_IXFR_ENTRIES
+
+static xfr_cache_entry_t *rendered(xfr_cache_t *cache, bool axfr, uint32_t from, uint32_t to)
+{
+	xfr_cache_entry_t *entry = xfr_cache_entry_new(cache, axfr, from, to, QSIZE);
+	uint8_t msg[128];
+	memset(msg, from, sizeof(msg));
+	(void)xfr_cache_entry_add(entry, msg, sizeof(msg), 3);
+	(void)xfr_cache_entry_add(entry, msg, 64, 1);
+	return entry;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	xfr_cache_t *cache = xfr_cache_new();
+	ok(cache != NULL, "create cache");
+	ok(xfr_cache_get(cache, false, 1, 2) == NULL, "empty cache");
+
+	xfr_cache_entry_t *entry = rendered(cache, false, 1, 2);
+	ok(entry != NULL && entry->count == 2 && entry->total == 192 &&
+	   entry->max_len == 128 && entry->msgs[1].ancount == 1, "render entry");
+	xfr_cache_put(cache, entry);
+
+	entry = xfr_cache_get(cache, false, 1, 2);
+	ok(entry != NULL && entry->qsize == QSIZE && entry->msgs[0].data[0] == 1,
+	   "cached entry found");
+	ok(xfr_cache_get(cache, false, 1, 3) == NULL && xfr_cache_get(cache, false, 0, 2) == NULL,
+	   "other ranges not found");
+
+	/* Referenced entry survives clear. */
+	xfr_cache_clear(cache);
+	ok(xfr_cache_get(cache, false, 1, 2) == NULL, "cache cleared");
+	ok(entry->msgs[1].len == 64, "referenced entry valid after clear");
+	xfr_cache_entry_release(entry);
+
+	/* Rendering started before clear is discarded. */
+	entry = rendered(cache, false, 1, 2);
+	xfr_cache_clear(cache);
+	xfr_cache_put(cache, entry);
+	ok(xfr_cache_get(cache, false, 1, 2) == NULL, "outdated rendering discarded");
+
+	/* The oldest entries are replaced. */
+	for (uint32_t i = 0; i <= XFR_CACHE_IXFR_ENTRIES; i++) {
+		xfr_cache_put(cache, rendered(cache, false, i, 100));
+	}
+	entry = xfr_cache_get(cache, false, 0, 100);
+	ok(entry == NULL, "oldest entry replaced");
+	entry = xfr_cache_get(cache, false, IXFR_LAST, 100);
+	ok(entry != NULL, "newest entry kept");
+	xfr_cache_entry_release(entry);
+
+	/* AXFR is cached separately, for the serial only. */
+	xfr_cache_put(cache, rendered(cache, true, 0, 100));
+	entry = xfr_cache_get(cache, true, 7, 100);
+	ok(entry != NULL && entry->axfr, "AXFR entry found");
+	xfr_cache_entry_release(entry);
+	ok(xfr_cache_get(cache, true, 0, 101) == NULL, "AXFR of other serial not found");
+	entry = xfr_cache_get(cache, false, IXFR_LAST, 100);
+	ok(entry != NULL && !entry->axfr, "IXFR entry kept with AXFR");
+	xfr_cache_entry_release(entry);
+
+	/* Too large transfers aren't cached. */
+	entry = xfr_cache_entry_new(cache, false, 5, 6, QSIZE);
+	static uint8_t big[UINT16_MAX];
+	int ret = KNOT_EOK;
+	while (ret == KNOT_EOK) {
+		ret = xfr_cache_entry_add(entry, big, sizeof(big), 1);
+	}
+	is_int(KNOT_ESPACE, ret, "transfer size limit");
+	ok(entry->total <= XFR_CACHE_IXFR_MAX_SIZE, "size within limit");
+	xfr_cache_entry_release(entry);
+
+	xfr_cache_free(cache);
+
+	return 0;
+}
@@ -0,0 +1,120 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "knot/events/xfr_sched.h"
+#include "knot/zone/zone.h"
+#include "contrib/sockaddr.h"
+#include "libknot/libknot.h"
+
+static zone_t *make_zone(const char *name_str, size_t size)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(name_str);
+	zone_t *zone = zone_new(name);
+	if (zone != NULL && size > 0) {
+		zone->contents = zone_contents_new(name, false);
+		if (zone->contents != NULL) {
+			zone->contents->size = size;
+		}
+	}
+	knot_dname_free(name, NULL);
+
+	return zone;
+}
+
+static void test_limit(const struct sockaddr_storage *primary)
+{
+	zone_t *a = make_zone("a.", 1000);
+	zone_t *big = make_zone("big.", 100000);
+	zone_t *small = make_zone("small.", 10);
+	zone_t *empty = make_zone("empty.", 0);
+
+	ok(xfr_sched_acquire(a, primary, 1, 0) == KNOT_EOK, "xfr_sched: first transfer");
+	ok(xfr_sched_acquire(big, primary, 1, 0) == KNOT_EBUSY &&
+	   xfr_sched_acquire(small, primary, 1, 0) == KNOT_EBUSY &&
+	   xfr_sched_acquire(empty, primary, 1, 0) == KNOT_EBUSY,
+	   "xfr_sched: over the limit");
+	ok(xfr_sched_waiting() == 3, "xfr_sched: waiting zones");
+	ok(xfr_sched_acquire(big, primary, 1, 0) == KNOT_EBUSY && xfr_sched_waiting() == 3,
+	   "xfr_sched: repeated attempt");
+
+	// The zone without contents goes first.
+	xfr_sched_release(primary, 1000);
+	ok(xfr_sched_acquire(small, primary, 1, 0) == KNOT_EBUSY,
+	   "xfr_sched: slot granted to another zone");
+	ok(xfr_sched_acquire(empty, primary, 1, 0) == KNOT_EOK,
+	   "xfr_sched: zone without contents first");
+
+	// Then the smaller zone.
+	xfr_sched_release(primary, 1000);
+	ok(xfr_sched_acquire(big, primary, 1, 0) == KNOT_EBUSY &&
+	   xfr_sched_acquire(small, primary, 1, 0) == KNOT_EOK,
+	   "xfr_sched: smaller zone first");
+
+	xfr_sched_release(primary, 1000);
+	ok(xfr_sched_acquire(big, primary, 1, 0) == KNOT_EOK && xfr_sched_waiting() == 0,
+	   "xfr_sched: last zone");
+
+	// A higher limit lets the new zone start.
+	ok(xfr_sched_acquire(a, primary, 2, 0) == KNOT_EOK, "xfr_sched: higher limit");
+	xfr_sched_release(primary, 1000);
+	xfr_sched_release(primary, 1000);
+
+	zone_free(&a);
+	zone_free(&big);
+	zone_free(&small);
+	zone_free(&empty);
+}
+
+static void test_rate(const struct sockaddr_storage *primary)
+{
+	zone_t *a = make_zone("a.", 1000);
+	zone_t *b = make_zone("b.", 1000);
+
+	ok(xfr_sched_acquire(a, primary, 0, 1000) == KNOT_EOK, "xfr_sched: rate, first transfer");
+	ok(xfr_sched_acquire(b, primary, 0, 1000) == KNOT_EOK, "xfr_sched: rate, concurrent transfer");
+	xfr_sched_release(primary, 100000);
+	ok(xfr_sched_acquire(a, primary, 0, 1000) == KNOT_EBUSY,
+	   "xfr_sched: rate, over the limit");
+	xfr_sched_release(primary, 0);
+
+	xfr_sched_deinit();
+	ok(xfr_sched_waiting() == 0, "xfr_sched: deinit");
+
+	zone_free(&a);
+	zone_free(&b);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	struct sockaddr_storage primary, other;
+	sockaddr_set(&primary, AF_INET, "192.0.2.1", 53);
+	sockaddr_set(&other, AF_INET, "192.0.2.2", 53);
+
+	zone_t *zone = make_zone("unlimited.", 1000);
+	ok(xfr_sched_acquire(zone, &other, 0, 0) == KNOT_EOK && xfr_sched_waiting() == 0,
+	   "xfr_sched: no limits");
+	xfr_sched_release(&other, 1000);
+	zone_free(&zone);
+
+	test_limit(&primary);
+	test_rate(&primary);
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <tap/basic.h>
+
+#include "knot/zone/zone-diff.h"
+#include "libknot/libknot.h"
+
+#define NODES 30000
+
+static const knot_dname_t *APEX = (const knot_dname_t *)"\x07""example";
+
+static void add_rr(zone_contents_t *zone, const char *owner, uint16_t type,
+                   const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_dname_t *name = knot_dname_from_str_alloc(owner);
+	knot_rrset_t *rr = knot_rrset_new(name, type, KNOT_CLASS_IN, 3600, NULL);
+	assert(rr);
+	int ret = knot_rrset_add_rdata(rr, rdata, rdlen, NULL);
+	assert(ret == KNOT_EOK);
+
+	zone_node_t *node = NULL;
+	ret = zone_contents_add_rr(zone, rr, &node);
+	assert(ret == KNOT_EOK);
+
+	knot_rrset_free(rr, NULL);
+	knot_dname_free(name, NULL);
+}
+
+/*!
+ * \brief Creates a zone, the second version differs in some of the nodes.
+ */
+static zone_contents_t *create_zone(uint32_t serial, bool changed)
+{
+	zone_contents_t *zone = zone_contents_new(APEX, false);
+	assert(zone);
+
+	uint8_t soa[22] = "\x00\x00";
+	knot_wire_write_u32(soa + 2, serial);
+	add_rr(zone, "example.", KNOT_RRTYPE_SOA, soa, sizeof(soa));
+
+	char owner[64];
+	for (unsigned i = 0; i < NODES; i++) {
+		uint8_t addr[4] = { 192, 0, i / 256 % 256, i % 256 };
+		if (changed && i % 100 == 0) {
+			continue; // Removed node.
+		}
+		if (changed && i % 100 == 1) {
+			addr[0] = 198; // Changed address.
+		}
+		(void)snprintf(owner, sizeof(owner), "n%u.s%u.example.", i, i % 37);
+		add_rr(zone, owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+	}
+	if (changed) {
+		for (unsigned i = 0; i < NODES / 100; i++) {
+			uint8_t addr[4] = { 203, 0, 113, i % 256 };
+			(void)snprintf(owner, sizeof(owner), "new%u.s%u.example.", i, i % 37);
+			add_rr(zone, owner, KNOT_RRTYPE_A, addr, sizeof(addr));
+		}
+	}
+
+	return zone;
+}
+
+static size_t count_rrsets(changeset_iter_t *it)
+{
+	size_t count = 0;
+	for (knot_rrset_t rr = changeset_iter_next(it); !knot_rrset_empty(&rr);
+	     rr = changeset_iter_next(it)) {
+		count++;
+	}
+	changeset_iter_clear(it);
+
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	zone_contents_t *zone1 = create_zone(1, false);
+	zone_contents_t *zone2 = create_zone(2, true);
+
+	// Removed and changed nodes (old records), changed and added nodes.
+	const size_t removals = 2 * NODES / 100;
+	const size_t additions = 2 * NODES / 100;
+
+	for (unsigned threads = 1; threads <= 8; threads *= 2) {
+		changeset_t ch;
+		int ret = changeset_init(&ch, APEX);
+		assert(ret == KNOT_EOK);
+
+		ret = zone_contents_diff(zone1, zone2, &ch, false, threads);
+		is_int(KNOT_EOK, ret, "zone diff, %u threads", threads);
+		changeset_iter_t it;
+		changeset_iter_rem(&it, &ch);
+		size_t removed = count_rrsets(&it);
+		changeset_iter_add(&it, &ch);
+		size_t added = count_rrsets(&it);
+		ok(removed == removals && added == additions &&
+		   knot_soa_serial(ch.soa_to->rrs.rdata) == 2,
+		   "zone diff, %u threads: changes", threads);
+		changeset_clear(&ch);
+	}
+
+	changeset_t ch;
+	int ret = changeset_init(&ch, APEX);
+	assert(ret == KNOT_EOK);
+	ret = zone_contents_diff(zone2, zone2, &ch, false, 4);
+	ok(ret == KNOT_ENODIFF && changeset_empty(&ch), "zone diff: no difference");
+	changeset_clear(&ch);
+
+	zone_contents_deep_free(zone1);
+	zone_contents_deep_free(zone2);
+
+	return 0;
+}
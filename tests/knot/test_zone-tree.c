@@ -116,6 +116,21 @@ int main(int argc, char *argv[])
 	knot_dname_free(tmp_dn, NULL);
 	ok(prev == NODEE + 1, "ztree: ordered lookup");
 
+	/* 4a. lookups in the lookup format */
+	passed = 1;
+	for (unsigned i = 0; i < NCOUNT; ++i) {
+		knot_dname_storage_t lf_storage;
+		uint8_t *lf = knot_dname_lf(NAME[i], lf_storage);
+		node = prev = NULL;
+		if (zone_tree_get_lf(t, lf) != NODEE + i ||
+		    zone_tree_get_less_or_equal_lf(t, lf, &node, &prev) != 1 ||
+		    node != NODEE + i) {
+			passed = 0;
+			break;
+		}
+	}
+	ok(passed, "ztree: lookup by the lookup format");
+
 	/* 5. ordered traversal */
 	unsigned i = 0;
 	int ret = zone_tree_apply(t, ztree_iter_data, &i);
@@ -34,6 +34,9 @@ static const char *add_str   = "test. 600 IN TXT \"test2\"\n";
 static const char *del_str   = "test. 600 IN TXT \"test\"\n";
 static const char *node_str1 = "node.test. 601 IN TXT \"abc\"\n";
 static const char *node_str2 = "node.test. 601 IN TXT \"def\"\n";
+static const char *new_str   = "new.test. 600 IN A 192.0.2.1\n";
+static const char *dname_str = "dname.test. 600 IN DNAME target.test.\n";
+static const char *below_str = "a.dname.test. 600 IN A 192.0.2.2\n";
 
 knot_rrset_t rrset;
 
@@ -282,6 +285,104 @@ void test_incremental(zone_t *zone, zs_scanner_t *sc)
 	ok(zone_size1 == zone_size2, "zone size measured the same incremental vs full (%zu, %zu)", zone_size1, zone_size2);
 	ok(zone_max_ttl1 == zone_max_ttl2, "zone max TTL measured the same incremental vs full (%u, %u)", zone_max_ttl1, zone_max_ttl2);
 	// TODO test more things after re-adjust, search for non-unified bi-nodes
+
+	/* Semantic checks of the affected nodes */
+	zone_update_init(&update, zone, UPDATE_INCREMENTAL);
+	if (zs_set_input_string(sc, dname_str, strlen(dname_str)) != 0 ||
+	    zs_parse_all(sc) != 0) {
+		assert(0);
+	}
+	ret = zone_update_add(&update, &rrset);
+	assert(ret == KNOT_EOK);
+	knot_rdataset_clear(&rrset.rrs, NULL);
+	ret = zone_update_semcheck(conf(), &update);
+	is_int(KNOT_EOK, ret, "incremental zone update: semantic check");
+
+	if (zs_set_input_string(sc, below_str, strlen(below_str)) != 0 ||
+	    zs_parse_all(sc) != 0) {
+		assert(0);
+	}
+	ret = zone_update_add(&update, &rrset);
+	assert(ret == KNOT_EOK);
+	knot_rdataset_clear(&rrset.rrs, NULL);
+	ret = zone_update_semcheck(conf(), &update);
+	is_int(KNOT_ESEMCHECK, ret, "incremental zone update: semantic check of parent");
+	zone_update_clear(&update);
+}
+
+static void parse_to_changeset(zs_scanner_t *sc, const char *str, changeset_t *ch,
+                               bool addition)
+{
+	if (zs_set_input_string(sc, str, strlen(str)) != 0 ||
+	    zs_parse_all(sc) != 0) {
+		assert(0);
+	}
+	int ret = addition ? changeset_add_addition(ch, &rrset, 0) :
+	                     changeset_add_removal(ch, &rrset, 0);
+	assert(ret == KNOT_EOK);
+	(void)ret;
+	knot_rdataset_clear(&rrset.rrs, NULL);
+}
+
+void test_changeset(zone_t *zone, zs_scanner_t *sc)
+{
+	/* Prepare changeset */
+	changeset_t ch;
+	int ret = changeset_init(&ch, zone->name);
+	assert(ret == KNOT_EOK);
+	parse_to_changeset(sc, node_str1, &ch, false);
+	parse_to_changeset(sc, node_str2, &ch, true);
+	parse_to_changeset(sc, new_str, &ch, true);
+
+	knot_rrset_t *soa = node_create_rrset(zone->contents->apex, KNOT_RRTYPE_SOA);
+	assert(soa);
+	uint32_t serial = knot_soa_serial(soa->rrs.rdata) + 1;
+	ret = changeset_add_removal(&ch, soa, 0);
+	assert(ret == KNOT_EOK);
+	knot_soa_serial_set(soa->rrs.rdata, serial);
+	ret = changeset_add_addition(&ch, soa, 0);
+	assert(ret == KNOT_EOK);
+	knot_rrset_free(soa, NULL);
+
+	/* Apply at once */
+	zone_update_t update;
+	zone_update_init(&update, zone, UPDATE_INCREMENTAL | UPDATE_STRICT | UPDATE_NO_CHSET);
+	ret = zone_update_apply_changeset(&update, &ch);
+	is_int(KNOT_EOK, ret, "changeset zone update: apply");
+
+	knot_dname_t *node_name = knot_dname_from_str_alloc("node.test");
+	knot_dname_t *new_name = knot_dname_from_str_alloc("new.test");
+	const zone_node_t *node = zone_update_get_node(&update, node_name);
+	const knot_rdataset_t *txt = node_rdataset(node, KNOT_RRTYPE_TXT);
+	if (zs_set_input_string(sc, node_str2, strlen(node_str2)) != 0 ||
+	    zs_parse_all(sc) != 0) {
+		assert(0);
+	}
+	ok(txt != NULL && txt->count == 1 && node_contains_rr(node, &rrset),
+	   "changeset zone update: RRs merged");
+	knot_rdataset_clear(&rrset.rrs, NULL);
+	ok(zone_update_get_node(&update, new_name) != NULL,
+	   "changeset zone update: node added");
+	is_int(serial, zone_contents_serial(update.new_cont),
+	       "changeset zone update: SOA replaced");
+
+	/* Commit */
+	ret = zone_update_commit(conf(), &update);
+	is_int(KNOT_EOK, ret, "changeset zone update: commit");
+	test_zone_unified(zone);
+
+	/* Repeated changeset must fail in strict mode */
+	zone_update_init(&update, zone, UPDATE_INCREMENTAL | UPDATE_STRICT | UPDATE_NO_CHSET);
+	ret = zone_update_apply_changeset(&update, &ch);
+	ok(ret != KNOT_EOK, "changeset zone update: strict failure");
+	zone_update_clear(&update);
+	ok(zone_contents_find_node(zone->contents, new_name) != NULL &&
+	   zone_contents_serial(zone->contents) == serial,
+	   "changeset zone update: rollback");
+
+	knot_dname_free(node_name, NULL);
+	knot_dname_free(new_name, NULL);
+	changeset_clear(&ch);
 }
 
 int main(int argc, char *argv[])
@@ -324,6 +425,7 @@ int main(int argc, char *argv[])
 	/* Test FULL update, commit it and use the result to test the INCREMENTAL update */
 	test_full(zone, &sc);
 	test_incremental(zone, &sc);
+	test_changeset(zone, &sc);
 
 	zs_deinit(&sc);
 	zone_free(&zone);
@@ -0,0 +1,98 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "knot/zone/clone.h"
+#include "libknot/libknot.h"
+
+static void add_rr(zone_contents_t *contents, const char *owner_str, uint16_t type,
+                   const uint8_t *rdata, uint16_t len)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, type, KNOT_CLASS_IN, 3600);
+	(void)knot_rrset_add_rdata(&rr, rdata, len, NULL);
+	zone_node_t *unused = NULL;
+	(void)zone_contents_add_rr(contents, &rr, &unused);
+	knot_rrset_clear(&rr, NULL);
+}
+
+static bool has_name(const zone_contents_t *contents, const char *owner_str,
+                     uint16_t type, size_t offset, const char *name_str)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	knot_dname_t *name = knot_dname_from_str_alloc(name_str);
+	const zone_node_t *node = zone_contents_find_node(contents, owner);
+	const knot_rdataset_t *rrs = node_rdataset(node, type);
+	bool found = (rrs != NULL && rrs->count == 1 &&
+	              knot_dname_is_equal(rrs->rdata->data + offset, name));
+	knot_dname_free(owner, NULL);
+	knot_dname_free(name, NULL);
+
+	return found;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	knot_dname_t *src_apex = knot_dname_from_str_alloc("template.");
+	knot_dname_t *apex = knot_dname_from_str_alloc("example.com.");
+	zone_contents_t *source = zone_contents_new(src_apex, true);
+	ok(source != NULL, "create source");
+
+	const uint8_t soa[] = "\x02""ns""\x08""template""\x00"
+	                      "\x05""admin""\x07""example""\x03""net""\x00"
+	                      "\x00\x00\x00\x01\x00\x00\x0e\x10\x00\x00\x0e\x10"
+	                      "\x00\x00\x0e\x10\x00\x00\x0e\x10";
+	const uint8_t ns[] = "\x02""ns""\x08""template""\x00";
+	const uint8_t mx[] = "\x00\x0a""\x04""mail""\x08""template""\x00";
+	const uint8_t cname[] = "\x08""template""\x00";
+	const uint8_t addr[] = { 192, 0, 2, 1 };
+	const uint8_t rrsig[18 + 10] = { 0, KNOT_RRTYPE_A };
+	add_rr(source, "template.", KNOT_RRTYPE_SOA, soa, sizeof(soa) - 1);
+	add_rr(source, "template.", KNOT_RRTYPE_NS, ns, sizeof(ns) - 1);
+	add_rr(source, "template.", KNOT_RRTYPE_MX, mx, sizeof(mx) - 1);
+	add_rr(source, "template.", KNOT_RRTYPE_A, addr, sizeof(addr));
+	add_rr(source, "template.", KNOT_RRTYPE_RRSIG, rrsig, sizeof(rrsig));
+	add_rr(source, "www.template.", KNOT_RRTYPE_CNAME, cname, sizeof(cname) - 1);
+
+	zone_contents_t *clone = NULL;
+	ok(zone_clone_contents(source, apex, &clone) == KNOT_EOK && clone != NULL,
+	   "clone contents");
+	ok(knot_dname_is_equal(clone->apex->owner, apex), "apex substituted");
+	ok(has_name(clone, "example.com.", KNOT_RRTYPE_SOA, 0, "ns.example.com."),
+	   "SOA primary moved");
+	ok(has_name(clone, "example.com.", KNOT_RRTYPE_SOA, 16, "admin.example.net."),
+	   "SOA mailbox out of zone kept");
+	ok(has_name(clone, "example.com.", KNOT_RRTYPE_NS, 0, "ns.example.com."),
+	   "NS moved");
+	ok(has_name(clone, "example.com.", KNOT_RRTYPE_MX, 2, "mail.example.com."),
+	   "MX moved");
+	ok(has_name(clone, "www.example.com.", KNOT_RRTYPE_CNAME, 0, "example.com."),
+	   "owner and CNAME moved");
+	ok(node_rdataset(clone->apex, KNOT_RRTYPE_A) != NULL &&
+	   node_rdataset(clone->apex, KNOT_RRTYPE_RRSIG) == NULL, "DNSSEC records skipped");
+	ok(zone_contents_serial(clone) == 1, "serial kept");
+
+	zone_contents_deep_free(clone);
+	zone_contents_deep_free(source);
+	knot_dname_free(src_apex, NULL);
+	knot_dname_free(apex, NULL);
+
+	return 0;
+}
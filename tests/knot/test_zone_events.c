@@ -67,6 +67,53 @@ static void test_scheduling(zone_t *zone)
 	// zone_events_start
 }
 
+static void test_debounce(zone_t *zone)
+{
+	const time_t now = time(NULL);
+	const time_t window = 1000, max_delay = 1500;
+
+	ok(!zone_events_schedule_debounced(zone, ZONE_EVENT_REFRESH, window, max_delay),
+	   "debounce: first trigger");
+	time_t first = zone_events_get_time(zone, ZONE_EVENT_REFRESH);
+	ok(first >= now + window && first <= time(NULL) + window, "debounce: delayed");
+
+	ok(zone_events_schedule_debounced(zone, ZONE_EVENT_REFRESH, window, max_delay),
+	   "debounce: trigger coalesced");
+	ok(zone_events_get_time(zone, ZONE_EVENT_REFRESH) >= first &&
+	   zone_events_get_time(zone, ZONE_EVENT_REFRESH) <= time(NULL) + max_delay,
+	   "debounce: postponed within the maximum");
+
+	zone_events_schedule_at(zone, ZONE_EVENT_REFRESH, 0);
+
+	// An earlier planned event is kept.
+	zone_events_schedule_at(zone, ZONE_EVENT_REFRESH, now + 10);
+	ok(zone_events_schedule_debounced(zone, ZONE_EVENT_REFRESH, window, max_delay) &&
+	   zone_events_get_time(zone, ZONE_EVENT_REFRESH) == now + 10,
+	   "debounce: merged into earlier event");
+
+
+	zone_events_schedule_at(zone, ZONE_EVENT_REFRESH, 0);
+}
+
+static void test_usage(zone_t *zone)
+{
+	bool empty = true;
+	for (int i = 0; i < ZONE_EVENT_COUNT; i++) {
+		zone_event_usage_t usage, total;
+		zone_events_get_usage(zone, i, &usage);
+		zone_events_total_usage(i, &total);
+		empty &= (usage.count == 0 && usage.wall == 0 && total.count == 0);
+	}
+	ok(empty, "no usage of events not run");
+
+	zone_event_usage_t usage = { .count = 1 };
+	zone_events_get_usage(zone, ZONE_EVENT_INVALID, &usage);
+	ok(usage.count == 0, "no usage of invalid event");
+
+	zone_event_slow_t slowest[ZONE_EVENT_SLOWEST];
+	ok(zone_events_slowest(slowest, ZONE_EVENT_SLOWEST) == 0, "no slowest events");
+}
+
 int main(void)
 {
 	plan_lazy();
@@ -90,6 +137,8 @@ int main(void)
 	ok(r == KNOT_EOK, "zone events setup");
 
 	test_scheduling(&zone);
+	test_debounce(&zone);
+	test_usage(&zone);
 
 	zone_events_deinit(&zone);
 	worker_pool_destroy(pool);
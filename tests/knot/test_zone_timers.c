@@ -21,6 +21,7 @@
 #include <tap/files.h>
 
 #include "knot/zone/timers.h"
+#include "knot/zone/zonedb.h"
 #include "libknot/db/db_lmdb.h"
 #include "libknot/dname.h"
 #include "libknot/error.h"
@@ -89,6 +90,62 @@ int main(int argc, char *argv[])
 	ok(ret == KNOT_EOK, "zone_timers_read()");
 	ok(timers_eq(&timers, &MOCK_TIMERS), "inconsistent timers");
 
+	// Read timers of more zones in one transaction
+	const knot_dname_t *other = (uint8_t *)"\x5""other""\x3""com";
+	knot_lmdb_txn_t txn = { 0 };
+	knot_lmdb_begin(db, &txn, false);
+	memset(&timers, 0, sizeof(timers));
+	ret = zone_timers_read_txn(&txn, other, &timers);
+	is_int(KNOT_ENOENT, ret, "zone_timers_read_txn() nonexistent");
+	ret = zone_timers_read_txn(&txn, zone, &timers);
+	is_int(KNOT_EOK, ret, "zone_timers_read_txn()");
+	ok(timers_eq(&timers, &MOCK_TIMERS), "inconsistent timers from txn");
+	knot_lmdb_abort(&txn);
+
+	// Write just the changed timers
+	knot_zonedb_t *zonedb = knot_zonedb_new();
+	zone_t *z1 = zone_new(zone), *z2 = zone_new(other);
+	assert(zonedb && z1 && z2);
+	knot_zonedb_insert(zonedb, z1);
+	knot_zonedb_insert(zonedb, z2);
+	z1->timers = MOCK_TIMERS;
+	z1->timers.last_flush = 2;
+	z2->timers = MOCK_TIMERS;
+	zone_timers_dirty_t dirty;
+	ret = zone_timers_dirty_init(&dirty);
+	is_int(KNOT_EOK, ret, "zone_timers_dirty_init()");
+	zone_timers_dirty_add(&dirty, other);
+	zone_timers_dirty_add(&dirty, other);
+	ret = zone_timers_dirty_flush(db, &dirty, zonedb);
+	is_int(KNOT_EOK, ret, "zone_timers_dirty_flush()");
+	is_int(0, trie_weight(dirty.zones), "zone_timers_dirty_flush() empty set");
+	memset(&timers, 0, sizeof(timers));
+	ret = zone_timers_read(db, other, &timers);
+	ok(ret == KNOT_EOK && timers_eq(&timers, &MOCK_TIMERS), "zone_timers_dirty_flush() changed");
+	ret = zone_timers_read(db, zone, &timers);
+	ok(ret == KNOT_EOK && timers.last_flush == MOCK_TIMERS.last_flush,
+	   "zone_timers_dirty_flush() unchanged not written");
+	zone_timers_dirty_deinit(&dirty);
+	knot_zonedb_deep_free(&zonedb, false);
+
+	// Write timers of more zones at once
+	trie_t *all = trie_create(NULL);
+	assert(all);
+	zone_timers_t t1 = MOCK_TIMERS, t2 = MOCK_TIMERS;
+	t1.last_flush = 3;
+	t2.last_flush = 4;
+	*trie_get_ins(all, (const trie_key_t *)zone, knot_dname_size(zone)) = &t1;
+	*trie_get_ins(all, (const trie_key_t *)other, knot_dname_size(other)) = &t2;
+	ret = zone_timers_write_all(db, all);
+	is_int(KNOT_EOK, ret, "zone_timers_write_all()");
+	ret = zone_timers_read(db, zone, &timers);
+	ok(ret == KNOT_EOK && timers_eq(&timers, &t1), "zone_timers_write_all() first");
+	ret = zone_timers_read(db, other, &timers);
+	ok(ret == KNOT_EOK && timers_eq(&timers, &t2), "zone_timers_write_all() second");
+	trie_free(all);
+	ret = knot_lmdb_sync(db);
+	is_int(KNOT_EOK, ret, "knot_lmdb_sync()");
+
 	// Sweep none
 	ret = zone_timers_sweep(db, keep_all, NULL);
 	is_int(KNOT_EOK, ret, "zone_timers_sweep() none");
@@ -14,12 +14,15 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
 #include <tap/basic.h>
 
 #include "knot/zone/zone.h"
 #include "knot/zone/zonedb.h"
+#include "contrib/macros.h"
 #include "contrib/openbsd/strlcat.h"
 #include "contrib/openbsd/strlcpy.h"
+#include "contrib/time.h"
 
 #define ZONE_COUNT 10
 static const char *zone_list[ZONE_COUNT] = {
@@ -35,6 +38,82 @@ static const char *zone_list[ZONE_COUNT] = {
         "b.b.b.b.net",
 };
 
+#define BENCH_ZONES   100000
+#define BENCH_TLDS    100
+#define BENCH_QUERIES 1000000
+
+/*! \brief Index of the zone queried by the i-th benchmark query. */
+#define BENCH_ZONE(i) (((i) * 7919) % BENCH_ZONES)
+
+/*! \brief Zone lookup by stripping the labels, as done before the prefix search. */
+static zone_t *find_suffix_by_labels(knot_zonedb_t *db, const knot_dname_t *name)
+{
+	while (true) {
+		zone_t *zone = knot_zonedb_find(db, name);
+		if (zone != NULL || name[0] == 0) {
+			return zone;
+		}
+		name = knot_wire_next_label(name, NULL);
+	}
+}
+
+/* Compare the zone lookup methods, print the lookup rates. */
+static void zonedb_bench(void)
+{
+	knot_zonedb_t *db = knot_zonedb_new();
+	zone_t *zones = calloc(BENCH_TLDS, sizeof(*zones));
+	knot_dname_t **names = calloc(BENCH_QUERIES, sizeof(*names));
+	if (db == NULL || zones == NULL || names == NULL) {
+		ok(false, "zonedb: benchmark init");
+		goto cleanup;
+	}
+
+	/* Zones 'z<i>.t<j>.' share one zone structure per TLD. */
+	char txt[64];
+	for (unsigned i = 0; i < BENCH_ZONES; ++i) {
+		zone_t *zone = &zones[i % BENCH_TLDS];
+		(void)snprintf(txt, sizeof(txt), "z%u.t%u.", i, i % BENCH_TLDS);
+		zone->name = knot_dname_from_str_alloc(txt);
+		(void)knot_zonedb_insert(db, zone);
+		knot_dname_free(zone->name, NULL);
+	}
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		unsigned z = BENCH_ZONE(i);
+		(void)snprintf(txt, sizeof(txt), "%s.z%u.t%u.", (i % 2) ? "a.www" : "www",
+		               z, z % BENCH_TLDS);
+		names[i] = knot_dname_from_str_alloc(txt);
+	}
+
+	bool match = true;
+	struct timespec begin = time_now();
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		zone_t *zone = find_suffix_by_labels(db, names[i]);
+		match &= (zone == &zones[BENCH_ZONE(i) % BENCH_TLDS]);
+	}
+	struct timespec end = time_now();
+	diag("zonedb: %u zones, label stripping %.0f lookups/s", BENCH_ZONES,
+	     BENCH_QUERIES / (MAX(time_diff_ms(&begin, &end), 1) / 1000.0));
+
+	begin = time_now();
+	for (unsigned i = 0; i < BENCH_QUERIES; ++i) {
+		zone_t *zone = knot_zonedb_find_suffix(db, names[i]);
+		match &= (zone == &zones[BENCH_ZONE(i) % BENCH_TLDS]);
+	}
+	end = time_now();
+	diag("zonedb: %u zones, prefix search %.0f lookups/s", BENCH_ZONES,
+	     BENCH_QUERIES / (MAX(time_diff_ms(&begin, &end), 1) / 1000.0));
+
+	ok(match, "zonedb: benchmark lookups match");
+
+cleanup:
+	for (unsigned i = 0; names != NULL && i < BENCH_QUERIES; ++i) {
+		knot_dname_free(names[i], NULL);
+	}
+	free(names);
+	free(zones);
+	knot_zonedb_free(&db);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -95,6 +174,34 @@ int main(int argc, char *argv[])
 	}
 	ok(nr_passed == ZONE_COUNT, "zonedb: find zones for subnames");
 
+	/* Copy-on-write update keeps the old database intact. */
+	knot_zonedb_t *db_cow = knot_zonedb_cow(db);
+	ok(db_cow != NULL, "zonedb: cow begin");
+	if (db_cow == NULL) {
+		goto cleanup;
+	}
+	knot_dname_t *del_name = knot_dname_from_str_alloc(zone_list[1]);
+	knot_dname_t *add_name = knot_dname_from_str_alloc("org");
+	zone_t *added = zone_new(add_name);
+	ok(knot_zonedb_del(db_cow, del_name) == KNOT_EOK &&
+	   knot_zonedb_insert(db_cow, added) == KNOT_EOK, "zonedb: cow update");
+	ok(knot_zonedb_find(db, del_name) == zones[1] &&
+	   knot_zonedb_find(db, add_name) == NULL &&
+	   knot_zonedb_size(db) == ZONE_COUNT, "zonedb: cow old database unchanged");
+	ok(knot_zonedb_find(db_cow, del_name) == NULL &&
+	   knot_zonedb_find(db_cow, add_name) == added &&
+	   knot_zonedb_find_suffix(db_cow, del_name) == zones[0], "zonedb: cow new database");
+	knot_zonedb_cow_commit(db_cow, &db);
+	ok(db == NULL && db_cow->cow == NULL, "zonedb: cow commit");
+	db = db_cow;
+	knot_zonedb_del(db, add_name);
+	knot_zonedb_insert(db, zones[1]);
+	ok(knot_zonedb_find(db, del_name) == zones[1] &&
+	   knot_zonedb_size(db) == ZONE_COUNT, "zonedb: update after cow");
+	zone_free(&added);
+	knot_dname_free(add_name, NULL);
+	knot_dname_free(del_name, NULL);
+
 	/* Remove all zones. */
 	nr_passed = 0;
 	for (unsigned i = 0; i < ZONE_COUNT; ++i) {
@@ -109,6 +216,9 @@ int main(int argc, char *argv[])
 	}
 	ok(nr_passed == ZONE_COUNT, "zonedb: removed all zones");
 
+	/* Compare with the label stripping lookup. */
+	zonedb_bench();
+
 cleanup:
 	knot_zonedb_deep_free(&db, false);
 	return 0;
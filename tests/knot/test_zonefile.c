@@ -0,0 +1,163 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tap/basic.h>
+#include <tap/files.h>
+
+#include "knot/zone/zone-dump.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+
+#define RECORDS 150000
+
+/*! \brief Writes a zone file big enough to be parsed in parallel. */
+static bool write_zone(const char *path, bool error, bool include)
+{
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		return false;
+	}
+
+	fprintf(f, "$TTL 300\n"
+	           "@ SOA ns.example. admin.example. ( 1 ; serial\n"
+	           "      3600 600 86400 300 )\n"
+	           "@ NS ns\n"
+	           "ns A 192.0.2.1\n");
+	if (include) {
+		fprintf(f, "$INCLUDE %s.inc\n", path);
+	}
+	for (int i = 0; i < RECORDS; i++) {
+		if (i % 5000 == 0) {
+			fprintf(f, "$ORIGIN sub%d.example.\n", i / 5000);
+		}
+		if (i % 7000 == 0) {
+			fprintf(f, "$TTL %d\n", 100 + i);
+		}
+		fprintf(f, "h%d A 192.0.2.%d\n", i, i % 250);
+		fprintf(f, "  TXT \"quoted ; not a comment ( %d\" ; comment (\n", i);
+		if (i % 11 == 0) {
+			fprintf(f, "m%d 60 IN MX ( 10\n\tmail%d ) ; (\n", i, i);
+		}
+		if (i % 13 == 0) {
+			fprintf(f, "; comment line\n\n");
+		}
+		if (i % 17 == 0) {
+			fprintf(f, "t%d TXT ( \"multi\"\n\"line ) ;\" )\n", i);
+		}
+		if (error && i == RECORDS - 10) {
+			fprintf(f, "bad A 192.0.2.256\n");
+		}
+	}
+	fclose(f);
+
+	return true;
+}
+
+static zone_contents_t *load(const char *path, unsigned threads)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc("example.");
+	sem_handler_t handler = { .cb = err_handler_logger };
+
+	zloader_t zl;
+	int ret = zonefile_open(&zl, path, origin, SEMCHECK_MANDATORY_ONLY, 0);
+	knot_dname_free(origin, NULL);
+	if (ret != KNOT_EOK) {
+		return NULL;
+	}
+	zl.err_handler = &handler;
+	zl.threads = threads;
+
+	zone_contents_t *contents = zonefile_load(&zl);
+	zonefile_close(&zl);
+
+	return contents;
+}
+
+static char *dump(zone_contents_t *contents, size_t *len, unsigned threads)
+{
+	char *buf = NULL;
+	FILE *f = open_memstream(&buf, len);
+	if (f == NULL) {
+		return NULL;
+	}
+	(void)zone_dump_text(contents, f, false, NULL, threads);
+	fclose(f);
+
+	return buf;
+}
+
+static void test_equal(const char *path, const char *msg)
+{
+	zone_contents_t *seq = load(path, 1);
+	zone_contents_t *par = load(path, 4);
+	ok(seq != NULL && par != NULL, "%s: load", msg);
+	if (seq == NULL || par == NULL) {
+		zone_contents_deep_free(seq);
+		zone_contents_deep_free(par);
+		return;
+	}
+
+	size_t seq_len = 0, par_len = 0, dump_len = 0;
+	char *seq_txt = dump(seq, &seq_len, 1);
+	char *par_txt = dump(par, &par_len, 1);
+	ok(seq_txt != NULL && par_txt != NULL && seq_len == par_len &&
+	   memcmp(seq_txt, par_txt, seq_len) == 0, "%s: same contents", msg);
+
+	char *dump_txt = dump(seq, &dump_len, 4);
+	ok(seq_txt != NULL && dump_txt != NULL && seq_len == dump_len &&
+	   memcmp(seq_txt, dump_txt, seq_len) == 0, "%s: parallel dump", msg);
+
+	free(seq_txt);
+	free(par_txt);
+	free(dump_txt);
+	zone_contents_deep_free(seq);
+	zone_contents_deep_free(par);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	char *tmpdir = test_mkdtemp();
+	ok(tmpdir != NULL, "make temporary directory");
+	char path[1024];
+	(void)snprintf(path, sizeof(path), "%s/example.zone", tmpdir);
+
+	ok(write_zone(path, false, false), "write zone file");
+	test_equal(path, "parallel");
+
+	ok(write_zone(path, true, false), "write zone file with error");
+	ok(load(path, 1) == NULL, "sequential: error");
+	ok(load(path, 4) == NULL, "parallel: error");
+
+	char inc_path[1100];
+	(void)snprintf(inc_path, sizeof(inc_path), "%s.inc", path);
+	FILE *f = fopen(inc_path, "w");
+	ok(f != NULL && fprintf(f, "inc A 192.0.2.2\n") > 0, "write included file");
+	if (f != NULL) {
+		fclose(f);
+	}
+	ok(write_zone(path, false, true), "write zone file with include");
+	test_equal(path, "include fallback");
+
+	test_rm_rf(tmpdir);
+	free(tmpdir);
+
+	return 0;
+}
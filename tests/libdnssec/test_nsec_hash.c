@@ -84,6 +84,54 @@ static void test_hashing(void)
 	dnssec_binary_free(&hash);
 }
 
+static void test_hashing_batch(void)
+{
+	uint8_t salt[255];
+	uint8_t names[37][255];
+	dnssec_binary_t data[37];
+	for (int i = 0; i < 37; i++) {
+		// Lengths spanning one to five SHA-1 blocks with the salt.
+		data[i].size = 1 + i * 7;
+		data[i].data = names[i];
+		for (int j = 0; j < data[i].size; j++) {
+			names[i][j] = i + j;
+		}
+	}
+	for (int i = 0; i < sizeof(salt); i++) {
+		salt[i] = 3 * i;
+	}
+
+	const uint16_t iterations[] = { 0, 1, 7 };
+	const size_t salt_sizes[] = { 0, 14, 255 };
+	bool valid = true;
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			const dnssec_nsec3_params_t params = {
+				.algorithm = DNSSEC_NSEC3_ALGORITHM_SHA1,
+				.iterations = iterations[i],
+				.salt = { .size = salt_sizes[j], .data = salt }
+			};
+
+			uint8_t hashes[37 * 20];
+			int result = dnssec_nsec3_hash_batch(data, 37, &params, hashes);
+			valid &= (result == DNSSEC_EOK);
+
+			for (int k = 0; k < 37; k++) {
+				dnssec_binary_t hash = { 0 };
+				valid &= (dnssec_nsec3_hash(&data[k], &params, &hash) == DNSSEC_EOK &&
+				          memcmp(hash.data, hashes + k * 20, 20) == 0);
+				dnssec_binary_free(&hash);
+			}
+		}
+	}
+	ok(valid, "dnssec_nsec3_hash_batch() matches dnssec_nsec3_hash()");
+
+	const dnssec_nsec3_params_t unknown = { .algorithm = 2 };
+	uint8_t hash[20];
+	ok(dnssec_nsec3_hash_batch(data, 1, &unknown, hash) == DNSSEC_INVALID_NSEC3_ALGORITHM,
+	   "dnssec_nsec3_hash_batch() unknown algorithm");
+}
+
 static void test_clear(void)
 {
 	const dnssec_nsec3_params_t empty = { 0 };
@@ -108,6 +156,7 @@ int main(void)
 	test_length();
 	test_parsing();
 	test_hashing();
+	test_hashing_batch();
 	test_clear();
 
 	return 0;
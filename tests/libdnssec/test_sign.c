@@ -15,6 +15,7 @@
  */
 
 #include <string.h>
+#include <unistd.h>
 #include <tap/basic.h>
 
 #include "sample_keys.h"
@@ -178,6 +179,62 @@ static void check_key(const key_parameters_t *key_data, const dnssec_binary_t *d
 	dnssec_key_free(key);
 }
 
+static void check_precompute(const key_parameters_t *key_data)
+{
+	dnssec_key_t *key = NULL;
+	int r = dnssec_key_new(&key);
+	ok(r == DNSSEC_EOK && key != NULL, "create key");
+	r = dnssec_key_set_rdata(key, &key_data->rdata);
+	ok(r == DNSSEC_EOK, "set RDATA");
+	r = dnssec_key_load_pkcs8(key, &key_data->pem);
+	ok(r == DNSSEC_EOK, "load private key");
+
+	r = dnssec_sign_precompute(key, 32);
+#ifdef HAVE_ECDSA_PRECOMP
+	ok(r == DNSSEC_EOK, "enable precomputation");
+#else
+	ok(r == DNSSEC_NOT_IMPLEMENTED_ERROR, "precomputation not supported");
+#endif
+	// Let the background thread prepare some nonces.
+	usleep(100000);
+
+	dnssec_sign_ctx_t *ctxs[2] = { NULL };
+	r = dnssec_sign_new(&ctxs[0], key);
+	ok(r == DNSSEC_EOK, "create signing context (1)");
+	r = dnssec_sign_new(&ctxs[1], key);
+	ok(r == DNSSEC_EOK, "create signing context (2)");
+
+	// More signatures than precomputed nonces to cover the fallback.
+	bool valid = true;
+	dnssec_binary_t prev = { 0 };
+	for (int i = 0; i < 64; i++) {
+		dnssec_binary_t signatures[2] = { 0 };
+		valid &= (dnssec_sign_init(ctxs[0]) == DNSSEC_EOK &&
+		          dnssec_sign_add(ctxs[0], &input_data) == DNSSEC_EOK &&
+		          dnssec_sign_init(ctxs[1]) == DNSSEC_EOK &&
+		          dnssec_sign_add(ctxs[1], &input_data) == DNSSEC_EOK);
+		r = dnssec_sign_write_batch(ctxs, 2, DNSSEC_SIGN_NORMAL, signatures);
+		valid &= (r == DNSSEC_EOK);
+		for (int j = 0; r == DNSSEC_EOK && j < 2; j++) {
+			valid &= (signatures[j].size == 64);
+			valid &= (dnssec_sign_verify(ctxs[j], false, &signatures[j]) == DNSSEC_EOK);
+			// Each signature uses a fresh nonce.
+			valid &= (dnssec_binary_cmp(&signatures[j], &prev) != 0);
+			dnssec_binary_free(&prev);
+			prev = signatures[j];
+		}
+	}
+	dnssec_binary_free(&prev);
+	ok(valid, "precomputed signatures verified");
+
+	r = dnssec_sign_precompute(key, 0);
+	ok(r == DNSSEC_EOK, "disable precomputation");
+
+	dnssec_sign_free(ctxs[0]);
+	dnssec_sign_free(ctxs[1]);
+	dnssec_key_free(key);
+}
+
 int main(void)
 {
 	plan_lazy();
@@ -188,6 +245,8 @@ int main(void)
 	check_key(&SAMPLE_RSA_KEY, &input_data, &signed_rsa, true);
 	diag("ECDSA signing");
 	check_key(&SAMPLE_ECDSA_KEY, &input_data, &signed_ecdsa, false);
+	diag("ECDSA precomputed signing");
+	check_precompute(&SAMPLE_ECDSA_KEY);
 #ifdef HAVE_ED25519
 	diag("ED25519 signing");
 	check_key(&SAMPLE_ED25519_KEY, &input_data, &signed_ed25519, true);
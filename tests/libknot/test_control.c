@@ -115,12 +115,15 @@ static void ctl_server(const char *socket, size_t argc, knot_ctl_data_t *argv)
 	ret = knot_ctl_accept(ctl);
 	is_int(KNOT_EOK, ret, "Accept a connection");
 
+	knot_ctl_t *conn = knot_ctl_clone(ctl);
+	ok(conn != NULL, "Move the connection to a new control");
+
 	diag("BEGIN: Server <- Client");
 
 	size_t count = 0;
 	knot_ctl_data_t data;
 	knot_ctl_type_t type = KNOT_CTL_TYPE_DATA;
-	while ((ret = knot_ctl_receive(ctl, &type, &data)) == KNOT_EOK) {
+	while ((ret = knot_ctl_receive(conn, &type, &data)) == KNOT_EOK) {
 		if (type == KNOT_CTL_TYPE_END) {
 			break;
 		}
@@ -154,21 +157,21 @@ static void ctl_server(const char *socket, size_t argc, knot_ctl_data_t *argv)
 		for (size_t i = 0; i < argc; i++) {
 			if (argv[i][KNOT_CTL_IDX_CMD] != NULL &&
 			    argv[i][KNOT_CTL_IDX_CMD][0] == '\0') {
-				ret = knot_ctl_send(ctl, KNOT_CTL_TYPE_BLOCK, NULL);
+				ret = knot_ctl_send(conn, KNOT_CTL_TYPE_BLOCK, NULL);
 				is_int(KNOT_EOK, ret, "Client send data block end type");
 			} else {
-				ret = knot_ctl_send(ctl, KNOT_CTL_TYPE_DATA, &argv[i]);
+				ret = knot_ctl_send(conn, KNOT_CTL_TYPE_DATA, &argv[i]);
 				is_int(KNOT_EOK, ret, "Server send data %zu", i);
 			}
 		}
 	}
 
-	ret = knot_ctl_send(ctl, KNOT_CTL_TYPE_END, NULL);
+	ret = knot_ctl_send(conn, KNOT_CTL_TYPE_END, NULL);
 	is_int(KNOT_EOK, ret, "Server send final data");
 
 	diag("END: Server -> Client");
 
-	knot_ctl_close(ctl);
+	knot_ctl_free(conn);
 	knot_ctl_unbind(ctl);
 	knot_ctl_free(ctl);
 }
@@ -210,10 +213,102 @@ static void test_client_server_client(void)
 	free(socket);
 }
 
+static const uint8_t wire[] = { 0x00, 0x01, 0x00, 0xff, 0x00, 0x00, 0x02 };
+
+static void wire_client(const char *socket)
+{
+	knot_ctl_t *ctl = knot_ctl_alloc();
+	fake_ok(ctl != NULL, "Allocate control");
+
+	int ret;
+	for (int i = 0; i < 20; i++) {
+		ret = knot_ctl_connect(ctl, socket);
+		if (ret == KNOT_EOK) {
+			break;
+		}
+		usleep(100000);
+	}
+	fake_ok(ret == KNOT_EOK, "Connect to socket");
+
+	knot_ctl_data_t data = { [KNOT_CTL_IDX_ZONE] = "zone" };
+	ret = knot_ctl_send_wire(ctl, KNOT_CTL_TYPE_DATA, &data, wire, sizeof(wire));
+	fake_ok(ret == KNOT_EOK, "Client send data with wire");
+	ret = knot_ctl_send_wire(ctl, KNOT_CTL_TYPE_DATA, NULL, wire, 0);
+	fake_ok(ret == KNOT_EOK, "Client send empty wire");
+	ret = knot_ctl_send(ctl, KNOT_CTL_TYPE_DATA, &data);
+	fake_ok(ret == KNOT_EOK, "Client send data without wire");
+	ret = knot_ctl_send_wire(ctl, KNOT_CTL_TYPE_BLOCK, NULL, wire, sizeof(wire));
+	fake_ok(ret == KNOT_EINVAL, "Client send wire with non-data type");
+	ret = knot_ctl_send(ctl, KNOT_CTL_TYPE_END, NULL);
+	fake_ok(ret == KNOT_EOK, "Client send final data");
+
+	knot_ctl_close(ctl);
+	knot_ctl_free(ctl);
+}
+
+static void test_wire(void)
+{
+	char *socket = test_mktemp();
+	ok(socket != NULL, "Make a temporary socket file '%s'", socket);
+
+	pid_t child_pid = fork();
+	if (child_pid == -1) {
+		ok(child_pid >= 0, "Process fork");
+		return;
+	}
+	if (child_pid == 0) {
+		wire_client(socket);
+		free(socket);
+		_exit(0);
+	}
+
+	knot_ctl_t *ctl = knot_ctl_alloc();
+	int ret = knot_ctl_bind(ctl, socket);
+	is_int(KNOT_EOK, ret, "Wire: bind control socket");
+	ret = knot_ctl_accept(ctl);
+	is_int(KNOT_EOK, ret, "Wire: accept a connection");
+
+	knot_ctl_data_t data;
+	knot_ctl_type_t type;
+	uint16_t len = 0;
+	ret = knot_ctl_receive(ctl, &type, &data);
+	const uint8_t *recv = knot_ctl_wire(ctl, &len);
+	ok(ret == KNOT_EOK && type == KNOT_CTL_TYPE_DATA &&
+	   data[KNOT_CTL_IDX_ZONE] != NULL && strcmp(data[KNOT_CTL_IDX_ZONE], "zone") == 0,
+	   "Wire: receive data");
+	ok(recv != NULL && len == sizeof(wire) && memcmp(recv, wire, len) == 0,
+	   "Wire: receive wire");
+
+	ret = knot_ctl_receive(ctl, &type, &data);
+	recv = knot_ctl_wire(ctl, &len);
+	ok(ret == KNOT_EOK && type == KNOT_CTL_TYPE_DATA && recv != NULL && len == 0,
+	   "Wire: receive empty wire");
+
+	ret = knot_ctl_receive(ctl, &type, &data);
+	ok(ret == KNOT_EOK && type == KNOT_CTL_TYPE_DATA && knot_ctl_wire(ctl, NULL) == NULL,
+	   "Wire: receive data without wire");
+
+	ret = knot_ctl_receive(ctl, &type, &data);
+	ok(ret == KNOT_EOK && type == KNOT_CTL_TYPE_END, "Wire: receive EOF type");
+
+	knot_ctl_unbind(ctl);
+	knot_ctl_free(ctl);
+
+	int status = 0;
+	wait(&status);
+	ok(WIFEXITED(status) && WEXITSTATUS(status) == 0, "Wire: wait for client");
+
+	test_rm_rf(socket);
+	free(socket);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
 
+	diag("Binary data item");
+	test_wire();
+
 	diag("Client -> Server -> Client");
 	test_client_server_client();
 
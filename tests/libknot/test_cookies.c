@@ -14,6 +14,7 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <tap/basic.h>
@@ -95,6 +96,55 @@ static void server_check(
 	is_int(code, ret, "server_check ret: %s", msg);
 }
 
+static void server_check_batch(
+	struct sockaddr_storage *c4_addr, struct sockaddr_storage *c6_addr,
+	const uint8_t *secret, const knot_edns_cookie_t *cc, uint32_t timestamp)
+{
+	knot_edns_cookie_params_t params = {
+		.version = KNOT_EDNS_COOKIE_VERSION,
+		.timestamp = timestamp,
+		.lifetime_before = 3600,
+		.lifetime_after = 300,
+	};
+	memcpy(params.secret, secret, sizeof(params.secret));
+
+	#define BATCH 11
+	knot_edns_cookie_t scs[BATCH], ccs[BATCH];
+	const struct sockaddr_storage *addrs[BATCH];
+	int expect[BATCH], results[BATCH];
+	for (int i = 0; i < BATCH; i++) {
+		addrs[i] = (i < 4) ? c6_addr : c4_addr;
+		ccs[i] = *cc;
+		ccs[i].data[0] ^= i;
+		params.client_addr = addrs[i];
+		params.timestamp = timestamp - i * 400;
+		(void)knot_edns_cookie_server_generate(&scs[i], &ccs[i], &params);
+	}
+	params.timestamp = timestamp;
+	scs[2].data[KNOT_EDNS_COOKIE_SRVR_MIN_SIZE - 1] ^= 1; // Wrong hash.
+	scs[5].data[0] = 10;                                  // Wrong version.
+	ccs[7].data[7] ^= 1;                                  // Other client.
+
+	for (int i = 0; i < BATCH; i++) {
+		params.client_addr = addrs[i];
+		expect[i] = knot_edns_cookie_server_check(&scs[i], &ccs[i], &params);
+	}
+	params.client_addr = NULL;
+
+	int ret = knot_edns_cookie_server_check_batch(scs, ccs, addrs, &params,
+	                                              BATCH, results);
+	is_int(KNOT_EOK, ret, "server_check_batch ret");
+	bool same = true;
+	for (int i = 0; i < BATCH; i++) {
+		same &= (results[i] == expect[i]);
+	}
+	ok(same, "server_check_batch results");
+	ok(results[0] == KNOT_EOK && results[2] == KNOT_EINVAL && results[5] == KNOT_ENOTSUP &&
+	   results[7] == KNOT_EINVAL && results[BATCH - 1] == KNOT_ERANGE,
+	   "server_check_batch failures");
+	#undef BATCH
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -170,5 +220,9 @@ int main(int argc, char *argv[])
 	server_check(&c6_sa, s_secret7, &sc, &cc, 1559741961 - 300, "last new", KNOT_EOK);
 	server_check(&c6_sa, s_secret7, &sc, &cc, 1559741961 - 301, "too new", KNOT_ERANGE);
 
+	// Batch check
+
+	server_check_batch(&c4_sa1, &c6_sa, s_secret1, &cc, 1559741961);
+
 	return 0;
 }
@@ -64,6 +64,136 @@ static void packet_match(knot_pkt_t *in, knot_pkt_t *out)
 	is_int(NAMECOUNT, rr_matched, "pkt: RR content match");
 }
 
+#define COMPR_COUNT 32
+
+static int compr_write(knot_pkt_t *pkt, knot_rrset_t **rrsets, size_t count)
+{
+	int ret = knot_pkt_put_question(pkt, (const uint8_t *)"\x07""example""\x03""com",
+	                                KNOT_CLASS_IN, KNOT_RRTYPE_AXFR);
+	for (size_t i = 0; i < count && ret == KNOT_EOK; i++) {
+		ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_NONE, rrsets[i], 0);
+	}
+	return ret;
+}
+
+static void test_compr_table(knot_mm_t *mm)
+{
+	knot_rrset_t *rrsets[COMPR_COUNT];
+	for (unsigned i = 0; i < COMPR_COUNT; i++) {
+		// Interleaved names defeat the compression heuristics.
+		char owner[64], target[64];
+		(void)snprintf(owner, sizeof(owner), "h%u.zone%u.example.com.", i, i % 3);
+		(void)snprintf(target, sizeof(target), "ns.zone%u.example.com.", (i + 1) % 3);
+		knot_dname_t *owner_dname = knot_dname_from_str_alloc(owner);
+		knot_dname_t *target_dname = knot_dname_from_str_alloc(target);
+		rrsets[i] = knot_rrset_new(owner_dname, KNOT_RRTYPE_NS, KNOT_CLASS_IN, TTL, NULL);
+		knot_rrset_add_rdata(rrsets[i], target_dname, knot_dname_size(target_dname), NULL);
+		knot_dname_free(owner_dname, NULL);
+		knot_dname_free(target_dname, NULL);
+	}
+
+	knot_pkt_t *hints = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	knot_pkt_t *table = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	assert(hints && table);
+
+	int ret = knot_pkt_compr_table_init(table);
+	is_int(KNOT_EOK, ret, "pkt: compression table init");
+
+	ret = compr_write(hints, rrsets, COMPR_COUNT);
+	is_int(KNOT_EOK, ret, "pkt: write with compression hints");
+	ret = compr_write(table, rrsets, COMPR_COUNT);
+	is_int(KNOT_EOK, ret, "pkt: write with compression table");
+	ok(table->size < hints->size, "pkt: compression table yields smaller message (%zu < %zu)",
+	   table->size, hints->size);
+
+	knot_pkt_t *parsed = knot_pkt_new(table->wire, table->size, mm);
+	ret = knot_pkt_parse(parsed, 0);
+	is_int(KNOT_EOK, ret, "pkt: parse message compressed with table");
+	bool match = (parsed->rrset_count == COMPR_COUNT);
+	for (unsigned i = 0; match && i < COMPR_COUNT; i++) {
+		match = knot_rrset_equal(&parsed->rr[i], rrsets[i], true);
+	}
+	ok(match, "pkt: names compressed with table match");
+	knot_pkt_free(parsed);
+
+	// Suffixes of a dropped RRSet mustn't be used.
+	knot_pkt_clear(table);
+	table->max_size = hints->size / 2;
+	ret = compr_write(table, rrsets, COMPR_COUNT);
+	is_int(KNOT_ESPACE, ret, "pkt: write overflowing message");
+	table->max_size = KNOT_WIRE_MAX_PKTSIZE;
+	size_t written = table->rrset_count;
+	ret = KNOT_EOK;
+	for (unsigned i = COMPR_COUNT; ret == KNOT_EOK && i > written; i--) {
+		// Reverse order to overwrite the dropped names with different ones.
+		ret = knot_pkt_put(table, KNOT_COMPR_HINT_NONE, rrsets[i - 1], 0);
+	}
+	is_int(KNOT_EOK, ret, "pkt: finish message after overflow");
+	parsed = knot_pkt_new(table->wire, table->size, mm);
+	ret = knot_pkt_parse(parsed, 0);
+	match = (ret == KNOT_EOK && parsed->rrset_count == COMPR_COUNT);
+	for (unsigned i = written; match && i < COMPR_COUNT; i++) {
+		match = knot_rrset_equal(&parsed->rr[i], rrsets[COMPR_COUNT - 1 - i + written], true);
+	}
+	ok(match, "pkt: names after overflow match");
+	knot_pkt_free(parsed);
+
+	knot_pkt_free(hints);
+	knot_pkt_free(table);
+	for (unsigned i = 0; i < COMPR_COUNT; i++) {
+		knot_rrset_free(rrsets[i], NULL);
+	}
+}
+
+static void test_plain_query(knot_mm_t *mm, const knot_rrset_t *opt_rr)
+{
+	knot_dname_t *qname = knot_dname_from_str_alloc("example.com");
+	knot_pkt_t *out = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, mm);
+	int ret = knot_pkt_put_question(out, qname, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	knot_dname_free(qname, NULL);
+	ret |= knot_pkt_begin(out, KNOT_ADDITIONAL);
+	ret |= knot_pkt_put(out, KNOT_COMPR_HINT_NONE, opt_rr, 0);
+	is_int(KNOT_EOK, ret, "pkt: write plain query");
+
+	/* Question and OPT only. */
+	knot_pkt_t *in = knot_pkt_new(out->wire, out->size, mm);
+	ret = knot_pkt_parse(in, 0);
+	ok(ret == KNOT_EOK && in->rrset_count == 1 && in->opt_rr == &in->rr[0] &&
+	   knot_pkt_section(in, KNOT_ADDITIONAL)->count == 1 &&
+	   knot_rrset_equal(in->opt_rr, opt_rr, true) &&
+	   knot_pkt_edns_option(in, KNOT_EDNS_OPTION_NSID) != NULL,
+	   "pkt: parse plain query");
+	knot_pkt_free(in);
+
+	/* Trailing data after OPT. */
+	uint8_t wire[KNOT_WIRE_MAX_PKTSIZE];
+	memcpy(wire, out->wire, out->size);
+	wire[out->size] = 0;
+	in = knot_pkt_new(wire, out->size + 1, mm);
+	ret = knot_pkt_parse(in, 0);
+	is_int(KNOT_ETRAIL, ret, "pkt: parse plain query with trailing data");
+	knot_pkt_free(in);
+
+	/* No OPT. */
+	knot_wire_set_arcount(wire, 0);
+	in = knot_pkt_new(wire, KNOT_WIRE_HEADER_SIZE + out->qname_size + 4, mm);
+	ret = knot_pkt_parse(in, 0);
+	ok(ret == KNOT_EOK && in->rrset_count == 0 && in->opt_rr == NULL,
+	   "pkt: parse plain query without OPT");
+	knot_pkt_free(in);
+
+	/* Two OPT records. */
+	uint16_t opt_size = out->size - in->size;
+	memcpy(wire + out->size, out->wire + in->size, opt_size);
+	knot_wire_set_arcount(wire, 2);
+	in = knot_pkt_new(wire, out->size + opt_size, mm);
+	ret = knot_pkt_parse(in, 0);
+	is_int(KNOT_EMALF, ret, "pkt: parse query with duplicate OPT");
+	knot_pkt_free(in);
+
+	knot_pkt_free(out);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -183,6 +313,16 @@ int main(int argc, char *argv[])
 	/* Compare copied packet to original. */
 	packet_match(in, copy);
 
+	/*
+	 * Compression table tests.
+	 */
+	test_compr_table(&mm);
+
+	/*
+	 * Plain query tests.
+	 */
+	test_plain_query(&mm, &opt_rr);
+
 	/* Free packets. */
 	knot_pkt_free(copy);
 	knot_pkt_free(out);
@@ -24,6 +24,8 @@
 #include "libknot/packet/pkt.c"
 #include "libknot/probe/probe.h"
 
+#define BULK_COUNT	512
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -89,6 +91,87 @@ int main(int argc, char *argv[])
 	knot_probe_free(probe_in);
 	knot_probe_free(probe_out);
 
+	// Shared memory ring.
+	probe_out = knot_probe_alloc();
+	probe_in = knot_probe_alloc();
+	ok(probe_out != NULL && probe_in != NULL, "probe ring: initialize probes");
+
+	ret = knot_probe_set_ring_producer(probe_out, workdir, 2);
+	ok(ret == KNOT_ECONN, "probe ring: attach producer");
+
+	ret = knot_probe_set_ring_consumer(probe_in, workdir, 2, 3);
+	ok(ret == KNOT_EOK, "probe ring: create consumer");
+
+	ret = knot_probe_set_ring_producer(probe_out, workdir, 2);
+	ok(ret == KNOT_EOK, "probe ring: reattach producer");
+
+	knot_probe_data_t ring_in[8];
+	ret = knot_probe_consume(probe_in, ring_in, 8, 0);
+	ok(ret == 0, "probe ring: consume empty");
+
+	bool produced = true;
+	for (int i = 0; i < 4; i++) {
+		data_out.query.qtype = i;
+		produced &= (knot_probe_produce(probe_out, &data_out, 1) == KNOT_EOK);
+	}
+	ok(produced, "probe ring: produce until full");
+	ret = knot_probe_produce(probe_out, &data_out, 1);
+	ok(ret == KNOT_ESPACE, "probe ring: produce to full ring");
+
+	ret = knot_probe_consume(probe_in, ring_in, 3, 0);
+	ok(ret == 3, "probe ring: consume partially");
+	ret = knot_probe_consume(probe_in, ring_in + 3, 8, 0);
+	ok(ret == 1, "probe ring: consume the rest");
+	bool ordered = true;
+	for (int i = 0; i < 4; i++) {
+		ordered &= (ring_in[i].query.qtype == i);
+	}
+	ok(ordered, "probe ring: data order");
+	ret = memcmp(&ring_in[3], &data_out, offsetof(knot_probe_data_t, query.qname));
+	ok(ret == 0, "probe ring: data comparison");
+
+	// Wake-up of the waiting consumer.
+	ret = knot_probe_consume(probe_in, ring_in, 8, 1);
+	ok(ret == 0, "probe ring: consume timeout");
+	knot_probe_free(probe_in);
+	probe_in = knot_probe_alloc();
+	ret = knot_probe_set_ring_consumer(probe_in, workdir, 2, 4);
+	ok(ret == KNOT_EOK, "probe ring: recreate consumer");
+	ret = knot_probe_produce(probe_out, &data_out, 1);
+	ok(ret == KNOT_EOK, "probe ring: produce to recreated ring");
+	ret = knot_probe_consume(probe_in, ring_in, 8, 20);
+	ok(ret == 1, "probe ring: consume from recreated ring");
+
+	// Bulk consumption beyond the limit of one call.
+	knot_probe_free(probe_in);
+	probe_in = knot_probe_alloc();
+	ret = knot_probe_set_ring_consumer(probe_in, workdir, 2, BULK_COUNT);
+	ok(ret == KNOT_EOK, "probe ring: create bulk consumer");
+	knot_probe_free(probe_out);
+	probe_out = knot_probe_alloc();
+	ret = knot_probe_set_ring_producer(probe_out, workdir, 2);
+	ok(ret == KNOT_EOK, "probe ring: attach bulk producer");
+	produced = true;
+	for (int i = 0; i < BULK_COUNT; i++) {
+		data_out.query.qtype = i;
+		produced &= (knot_probe_produce(probe_out, &data_out, 1) == KNOT_EOK);
+	}
+	ok(produced, "probe ring: produce bulk");
+	knot_probe_data_t *bulk_in = calloc(BULK_COUNT + 1, sizeof(*bulk_in));
+	ret = knot_probe_consume_bulk(probe_in, bulk_in, BULK_COUNT + 1, 0);
+	ok(ret == BULK_COUNT, "probe ring: consume bulk");
+	ordered = true;
+	for (int i = 0; i < BULK_COUNT; i++) {
+		ordered &= (bulk_in[i].query.qtype == i);
+	}
+	ok(ordered, "probe ring: bulk data order");
+	ret = knot_probe_consume_bulk(probe_in, bulk_in, BULK_COUNT + 1, 0);
+	ok(ret == 0, "probe ring: consume bulk empty");
+	free(bulk_in);
+
+	knot_probe_free(probe_in);
+	knot_probe_free(probe_out);
+
 	test_rm_rf(workdir);
 	free(workdir);
 
@@ -196,6 +196,74 @@ int main(int argc, char *argv[])
 	              rdataset.rdata == NULL;
 	ok(subtract_ok, "rdataset: subtract last.");
 
+	// Test builder
+	knot_rdataset_builder_t builder;
+	knot_rdataset_builder_init(&builder, NULL);
+	ok(knot_rdataset_builder_append(NULL, rdata_lo) == KNOT_EINVAL &&
+	   knot_rdataset_builder_append(&builder, NULL) == KNOT_EINVAL,
+	   "rdataset builder: append NULL.");
+	ret = knot_rdataset_builder_reserve(&builder, 2 * knot_rdata_size(4));
+	ok(ret == KNOT_EOK && builder.capacity == 2 * knot_rdata_size(4),
+	   "rdataset builder: reserve.");
+	ret = knot_rdataset_builder_append(&builder, rdata_lo);
+	ret |= knot_rdataset_builder_append(&builder, rdata_lo);
+	ret |= knot_rdataset_builder_append(&builder, rdata_gt);
+	ok(ret == KNOT_EOK && builder.rrs.count == 2 && !builder.unsorted &&
+	   builder.capacity == 2 * knot_rdata_size(4),
+	   "rdataset builder: append sorted.");
+	ret = knot_rdataset_builder_finalize(&builder);
+	RDATASET_INIT_WITH(rdataset, rdata_lo);
+	ret = knot_rdataset_add(&rdataset, rdata_gt, NULL);
+	ok(ret == KNOT_EOK && knot_rdataset_eq(&builder.rrs, &rdataset),
+	   "rdataset builder: finalize sorted.");
+
+	knot_rdataset_builder_reset(&builder);
+	ok(builder.rrs.count == 0 && builder.rrs.size == 0 && builder.capacity > 0,
+	   "rdataset builder: reset.");
+
+	knot_rdataset_t big;
+	knot_rdataset_init(&big);
+	ret = KNOT_EOK;
+	for (int i = 0; i < 2000 && ret == KNOT_EOK; i++) {
+		uint8_t buf[knot_rdata_size(2)];
+		knot_rdata_t *rdata = (knot_rdata_t *)buf;
+		uint16_t val = (i * 7919) % 1000; // Unsorted with duplicates.
+		knot_rdata_init(rdata, 2, (uint8_t *)&val);
+		ret = knot_rdataset_builder_append(&builder, rdata);
+		if (ret == KNOT_EOK) {
+			ret = knot_rdataset_add(&big, rdata, NULL);
+		}
+	}
+	ok(ret == KNOT_EOK && builder.unsorted, "rdataset builder: append unsorted.");
+	ret = knot_rdataset_builder_finalize(&builder);
+	ok(ret == KNOT_EOK && !builder.unsorted && builder.rrs.count == 1000 &&
+	   knot_rdataset_eq(&builder.rrs, &big) &&
+	   builder.rrs.size == rdataset_size(&builder.rrs),
+	   "rdataset builder: finalize sorts and removes duplicates.");
+
+	// Test one-pass merge of sorted RRS
+	ret = knot_rdataset_copy(&copy, &builder.rrs, NULL);
+	assert(ret == KNOT_EOK);
+	ret = knot_rdataset_merge(&copy, &rdataset, NULL);
+	merge_ok = ret == KNOT_EOK && copy.count == 1002 &&
+	           copy.size == rdataset_size(&copy) &&
+	           knot_rdataset_member(&copy, rdata_lo) &&
+	           knot_rdataset_member(&copy, rdata_gt);
+	knot_rdata_t *prev = copy.rdata;
+	for (uint16_t i = 1; merge_ok && i < copy.count; i++) {
+		knot_rdata_t *next = knot_rdataset_next(prev);
+		merge_ok = knot_rdata_cmp(prev, next) < 0;
+		prev = next;
+	}
+	ok(merge_ok, "rdataset: merge large sorted.");
+	ret = knot_rdataset_merge(&copy, &big, NULL);
+	ok(ret == KNOT_EOK && copy.count == 1002, "rdataset: merge duplicates.");
+
+	knot_rdataset_builder_clear(&builder);
+	ok(builder.rrs.rdata == NULL && builder.capacity == 0,
+	   "rdataset builder: clear.");
+	knot_rdataset_clear(&big, NULL);
+
 	knot_rdataset_clear(&copy, NULL);
 	knot_rdataset_clear(&rdataset, NULL);
 	knot_rdataset_clear(&rdataset_lo, NULL);
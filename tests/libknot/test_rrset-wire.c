@@ -20,6 +20,8 @@
 #include "libknot/packet/rrset-wire.h"
 #include "libknot/descriptor.h"
 #include "libknot/errcode.h"
+#include "libknot/rrset.h"
+#include "contrib/time.h"
 
 // Wire initializers
 
@@ -246,6 +248,108 @@ static void test_canonization(void)
 	check_canon(wire, size, pos, true, low_qname, low_dname);
 }
 
+#define BENCH_ROUNDS 1000000
+
+static const struct {
+	uint16_t type;
+	uint16_t len;
+	const char *rdata;
+} TYPE_CASES[] = {
+	{ KNOT_RRTYPE_A,     4,  "\xc0\x00\x02\x01" },
+	{ KNOT_RRTYPE_AAAA,  16, "\x20\x01\x0d\xb8\x00\x00\x00\x00"
+	                         "\x00\x00\x00\x00\x00\x00\x00\x01" },
+	{ KNOT_RRTYPE_NS,    8,  "\x03""nic""\x02""cz""\x00" },
+	{ KNOT_RRTYPE_CNAME, 8,  "\x03""nic""\x02""cz""\x00" },
+	{ KNOT_RRTYPE_MX,    10, "\x00\x0a""\x03""nic""\x02""cz""\x00" },
+	{ KNOT_RRTYPE_TXT,   6,  "\x05""hello" },
+	{ KNOT_RRTYPE_DS,    8,  "\x12\x34\x08\x02""\xde\xad\xbe\xef" },
+	{ KNOT_RRTYPE_RRSIG, 30, "\x00\x01\x08\x02\x00\x00\x0e\x10"
+	                         "\x00\x00\x00\x02\x00\x00\x00\x01\x12\x34"
+	                         "\x03""nic""\x02""cz""\x00""\xab\xcd\xef\x01" },
+	{ KNOT_RRTYPE_NSEC3, 9,  "\x01\x00\x00\x0a\x00\x02\xab\xcd\x00" },
+};
+
+/* Round-trip of the types with the dedicated writers and readers. */
+static void test_types(void)
+{
+	knot_dname_t owner[] = { QNAME };
+	uint8_t wire[KNOT_WIRE_MAX_PKTSIZE];
+
+	for (size_t i = 0; i < sizeof(TYPE_CASES) / sizeof(TYPE_CASES[0]); i++) {
+		knot_rrset_t rrset;
+		knot_rrset_init(&rrset, owner, TYPE_CASES[i].type, KNOT_CLASS_IN, 3600);
+		char type[16];
+		(void)knot_rrtype_to_string(rrset.type, type, sizeof(type));
+
+		int ret = knot_rrset_add_rdata(&rrset, (const uint8_t *)TYPE_CASES[i].rdata,
+		                               TYPE_CASES[i].len, NULL);
+		assert(ret == KNOT_EOK);
+		ret = knot_rrset_to_wire(&rrset, wire, sizeof(wire), NULL);
+		ok(ret == QNAME_SIZE + RR_HEADER_SIZE + TYPE_CASES[i].len,
+		   "rrset wire: write %s", type);
+
+		knot_rrset_t parsed;
+		knot_rrset_init_empty(&parsed);
+		size_t pos = 0;
+		ret = knot_rrset_rr_from_wire(wire, &pos, ret, &parsed, NULL, false);
+		ok(ret == KNOT_EOK && knot_rrset_equal(&rrset, &parsed, true),
+		   "rrset wire: read %s", type);
+
+		knot_rrset_clear(&parsed, NULL);
+		knot_rdataset_clear(&rrset.rrs, NULL);
+	}
+
+	// Address with trailing data.
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, owner, KNOT_RRTYPE_A, KNOT_CLASS_IN, 3600);
+	int ret = knot_rrset_add_rdata(&rrset, (const uint8_t *)"\x01\x02\x03\x04\x05", 5, NULL);
+	assert(ret == KNOT_EOK);
+	ret = knot_rrset_to_wire(&rrset, wire, sizeof(wire), NULL);
+	is_int(KNOT_EMALF, ret, "rrset wire: write A with trailing data");
+	knot_rdataset_clear(&rrset.rrs, NULL);
+}
+
+/* Print the speed of writing and reading typical answer records. */
+static void bench_types(void)
+{
+	knot_dname_t owner[] = { QNAME };
+	uint8_t wire[KNOT_WIRE_MAX_PKTSIZE];
+
+	for (size_t i = 0; i < sizeof(TYPE_CASES) / sizeof(TYPE_CASES[0]); i++) {
+		knot_rrset_t rrset;
+		knot_rrset_init(&rrset, owner, TYPE_CASES[i].type, KNOT_CLASS_IN, 3600);
+		int ret = knot_rrset_add_rdata(&rrset, (const uint8_t *)TYPE_CASES[i].rdata,
+		                               TYPE_CASES[i].len, NULL);
+		assert(ret == KNOT_EOK);
+
+		struct timespec begin = time_now();
+		for (unsigned r = 0; r < BENCH_ROUNDS; r++) {
+			ret = knot_rrset_to_wire(&rrset, wire, sizeof(wire), NULL);
+		}
+		struct timespec end = time_now();
+		double write_ms = time_diff_ms(&begin, &end);
+		size_t size = ret;
+
+		begin = time_now();
+		for (unsigned r = 0; r < BENCH_ROUNDS; r++) {
+			knot_rrset_t parsed;
+			knot_rrset_init_empty(&parsed);
+			size_t pos = 0;
+			(void)knot_rrset_rr_from_wire(wire, &pos, size, &parsed, NULL, false);
+			knot_rrset_clear(&parsed, NULL);
+		}
+		end = time_now();
+		double read_ms = time_diff_ms(&begin, &end);
+
+		char type[16];
+		(void)knot_rrtype_to_string(rrset.type, type, sizeof(type));
+		diag("%-5s write %6.1f, read %6.1f Mrr/s", type,
+		     BENCH_ROUNDS / write_ms / 1000, BENCH_ROUNDS / read_ms / 1000);
+
+		knot_rdataset_clear(&rrset.rrs, NULL);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -260,5 +364,11 @@ int main(int argc, char *argv[])
 	diag("Test canonization");
 	test_canonization();
 
+	diag("Test common types");
+	test_types();
+
+	diag("Benchmark common types");
+	bench_types();
+
 	return 0;
 }
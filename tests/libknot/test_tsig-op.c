@@ -0,0 +1,185 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <tap/basic.h>
+#include <string.h>
+
+#include "libknot/libknot.h"
+
+#define MSG_COUNT 5
+#define MSG_MAX 512
+
+static const knot_tsig_key_t key = {
+	.algorithm = DNSSEC_TSIG_HMAC_SHA256,
+	.name = (uint8_t *)"\x4""tsig""\x3""key",
+	.secret.size = 9,
+	.secret.data = (uint8_t *)"bananakey"
+};
+
+static uint8_t msgs[MSG_COUNT][MSG_MAX];
+static size_t msg_lens[MSG_COUNT];
+
+static void init_msg(uint8_t *msg, size_t *msg_len, unsigned i)
+{
+	memset(msg, 0, KNOT_WIRE_HEADER_SIZE);
+	knot_wire_set_id(msg, 0x1234);
+	knot_wire_set_qr(msg);
+	knot_wire_set_ancount(msg, 1);
+	*msg_len = KNOT_WIRE_HEADER_SIZE;
+
+	// Root TXT record with contents different in each message.
+	uint8_t *rr = msg + *msg_len;
+	size_t txt_len = 100 + i;
+	rr[0] = '\0';
+	knot_wire_write_u16(rr + 1, KNOT_RRTYPE_TXT);
+	knot_wire_write_u16(rr + 3, KNOT_CLASS_IN);
+	knot_wire_write_u32(rr + 5, 3600);
+	knot_wire_write_u16(rr + 9, txt_len + 1);
+	rr[11] = txt_len;
+	memset(rr + 12, 'a' + i, txt_len);
+	*msg_len += 12 + txt_len;
+}
+
+static uint64_t time_signed(uint8_t *msg, size_t msg_len)
+{
+	uint64_t time = 0;
+	knot_pkt_t *pkt = knot_pkt_new(msg, msg_len, NULL);
+	if (knot_pkt_parse(pkt, 0) == KNOT_EOK && pkt->tsig_rr != NULL) {
+		time = knot_tsig_rdata_time_signed(pkt->tsig_rr);
+	}
+	knot_pkt_free(pkt);
+	return time;
+}
+
+/*!
+ * Signs the messages, every 'interval'-th and the last one, and checks
+ * the signatures like a client does.
+ */
+static void test_sign(unsigned interval)
+{
+	uint8_t query_mac[32] = { 0x42 };
+	uint8_t digest[32];
+	memcpy(digest, query_mac, sizeof(digest));
+
+	knot_sign_context_t ctx = {
+		.tsig_key = key,
+		.tsig_digest = digest,
+		.tsig_digestlen = sizeof(digest),
+	};
+
+	bool signed_ok = true;
+	for (unsigned i = 0; i < MSG_COUNT; i++) {
+		init_msg(msgs[i], &msg_lens[i], i);
+		int ret;
+		if (i == 0) {
+			size_t digest_len = sizeof(digest);
+			ret = knot_tsig_sign(msgs[i], &msg_lens[i], MSG_MAX,
+			                     query_mac, sizeof(query_mac), digest,
+			                     &digest_len, &key, 0, 0);
+		} else if (i + 1 < MSG_COUNT && ctx.unsigned_count + 1 < interval) {
+			ret = knot_tsig_sign_skip(&ctx, msgs[i], msg_lens[i]);
+		} else {
+			ret = knot_tsig_sign_next_ctx(&ctx, msgs[i], &msg_lens[i], MSG_MAX);
+		}
+		signed_ok &= (ret == KNOT_EOK);
+	}
+	ok(signed_ok, "interval %u: sign", interval);
+	knot_tsig_sign_ctx_clear(&ctx);
+	ok(ctx.hmac == NULL, "interval %u: clear context", interval);
+
+	// Verify as a client, the unsigned messages are buffered.
+	uint8_t buffer[MSG_COUNT * MSG_MAX];
+	size_t buffer_len = 0;
+	uint8_t prev_mac[32];
+	memcpy(prev_mac, query_mac, sizeof(prev_mac));
+	unsigned unsigned_count = 0;
+	bool verify_ok = true;
+	for (unsigned i = 0; i < MSG_COUNT; i++) {
+		knot_pkt_t *pkt = knot_pkt_new(msgs[i], msg_lens[i], NULL);
+		int ret = knot_pkt_parse(pkt, 0);
+		if (ret != KNOT_EOK) {
+			verify_ok = false;
+			knot_pkt_free(pkt);
+			break;
+		}
+		memcpy(buffer + buffer_len, pkt->wire, pkt->size);
+		buffer_len += pkt->size;
+
+		if (pkt->tsig_rr == NULL) {
+			unsigned_count++;
+			verify_ok &= (unsigned_count < interval);
+		} else {
+			if (i == 0) {
+				ret = knot_tsig_client_check(pkt->tsig_rr, buffer, buffer_len,
+				                             prev_mac, sizeof(prev_mac), &key, 0);
+			} else {
+				ret = knot_tsig_client_check_next(pkt->tsig_rr, buffer, buffer_len,
+				                                  prev_mac, sizeof(prev_mac), &key,
+				                                  0);
+			}
+			verify_ok &= (ret == KNOT_EOK);
+			memcpy(prev_mac, knot_tsig_rdata_mac(pkt->tsig_rr), sizeof(prev_mac));
+			buffer_len = 0;
+			unsigned_count = 0;
+		}
+		knot_pkt_free(pkt);
+	}
+	ok(verify_ok && buffer_len == 0, "interval %u: verify", interval);
+}
+
+static void test_sign_next(void)
+{
+	uint8_t prev[32] = { 0x42 };
+	uint8_t digest1[32], digest2[32];
+	size_t digest1_len = sizeof(digest1);
+
+	uint8_t msg1[MSG_MAX], msg2[MSG_MAX];
+	size_t msg1_len, msg2_len;
+	init_msg(msg1, &msg1_len, 0);
+	init_msg(msg2, &msg2_len, 0);
+
+	int ret = knot_tsig_sign_next(msg1, &msg1_len, MSG_MAX, prev, sizeof(prev),
+	                              digest1, &digest1_len, &key, msg1, msg1_len);
+	ok(ret == KNOT_EOK, "sign next");
+
+	memcpy(digest2, prev, sizeof(prev));
+	knot_sign_context_t ctx = {
+		.tsig_key = key,
+		.tsig_digest = digest2,
+		.tsig_digestlen = sizeof(digest2),
+	};
+	ret = knot_tsig_sign_next_ctx(&ctx, msg2, &msg2_len, MSG_MAX);
+	knot_tsig_sign_ctx_clear(&ctx);
+
+	// The time signed may differ if the second changed meanwhile.
+	bool same_time = time_signed(msg1, msg1_len) == time_signed(msg2, msg2_len);
+	ok(ret == KNOT_EOK && (!same_time ||
+	   (msg1_len == msg2_len && memcmp(digest1, digest2, sizeof(digest1)) == 0)),
+	   "sign next with context");
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	test_sign_next();
+	for (unsigned interval = 1; interval <= MSG_COUNT + 1; interval++) {
+		test_sign(interval);
+	}
+
+	return 0;
+}
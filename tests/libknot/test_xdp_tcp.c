@@ -19,6 +19,7 @@
 #include "tap/basic.h"
 #include "libknot/error.h"
 #include "libknot/xdp/msg_init.h"
+#include "libknot/xdp/protocols.h"
 #include "libknot/xdp/tcp.c"
 #include "libknot/xdp/tcp_iobuf.c"
 #include "libknot/xdp/bpf-user.h"
@@ -32,6 +33,8 @@ size_t sent_syns = 0;
 size_t sent_fins = 0;
 uint32_t sent_seqno = 0;
 uint32_t sent_ackno = 0;
+size_t sent_segments = 0;
+size_t sent_bytes = 0;
 
 knot_xdp_socket_t *test_sock = NULL;
 
@@ -40,11 +43,11 @@ struct sockaddr_in test_addr = { AF_INET, 0, { 127 + (1 << 24) }, { 0 } };
 knot_tcp_conn_t *test_conn = NULL;
 
 /*!
- * \brief Length of timeout-watching list.
+ * \brief Length of timeout-watching lists.
  */
 static size_t tcp_table_timeout_length(knot_tcp_table_t *table)
 {
-	return list_size(tcp_table_timeout(table));
+	return list_size(tcp_table_timeout(table)) + list_size(tcp_table_closing(table));
 }
 
 /*!
@@ -60,11 +63,14 @@ static void tcp_cleanup(knot_tcp_table_t *tcp_table, uint32_t timeout,
 {
 	uint32_t now = get_timestamp(), i = 0;
 	knot_tcp_conn_t *conn, *next;
-	WALK_LIST_DELSAFE(conn, next, *tcp_table_timeout(tcp_table)) {
-		if (i++ < at_least || now - conn->last_active >= timeout) {
-			tcp_table_del_lookup(conn, tcp_table);
-			if (cleaned != NULL) {
-				(*cleaned)++;
+	list_t *lists[] = { tcp_table_closing(tcp_table), tcp_table_timeout(tcp_table) };
+	for (int l = 0; l < 2; l++) {
+		WALK_LIST_DELSAFE(conn, next, *lists[l]) {
+			if (i++ < at_least || now - conn->last_active >= timeout) {
+				tcp_table_del_lookup(conn, tcp_table);
+				if (cleaned != NULL) {
+					(*cleaned)++;
+				}
 			}
 		}
 	}
@@ -129,6 +135,23 @@ static int mock_send_nocheck(_unused_ knot_xdp_socket_t *sock, const knot_xdp_ms
 	return KNOT_EOK;
 }
 
+static int mock_send_data(_unused_ knot_xdp_socket_t *sock, const knot_xdp_msg_t msgs[],
+                          uint32_t n_msgs, _unused_ uint32_t *sent)
+{
+	ok(n_msgs <= 20, "send: not too many at once");
+	for (uint32_t i = 0; i < n_msgs; i++) {
+		const knot_xdp_msg_t *msg = msgs + i;
+		if (msg->payload.iov_len > 0) {
+			ok(msg->flags & KNOT_XDP_MSG_ACK, "send: data with ACK");
+			sent_segments++;
+			sent_bytes += msg->payload.iov_len;
+		}
+		sent_seqno = msg->seqno;
+		sent_ackno = msg->ackno;
+	}
+	return KNOT_EOK;
+}
+
 static void clean_table(void)
 {
 	(void)tcp_cleanup(test_table, 0, UINT32_MAX, NULL);
@@ -377,6 +400,12 @@ void test_many(void)
 	is_int(0, reset_count, "may/timeout1: reset count");
 	check_sent(0, 0, 0, CONNS - 1);
 
+	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, timeout_time, UINT32_MAX,
+	                     0, 0, &close_count, &reset_count);
+	is_int(KNOT_EOK, ret, "many/timeout1: again OK");
+	is_int(CONNS - 1, close_count, "many/timeout1: no more closed");
+	check_sent(0, 0, 0, 0);
+
 	close_count = 0;
 	ret = knot_tcp_sweep(test_table, test_sock, UINT32_MAX, UINT32_MAX, timeout_time,
 	                     0, 0, &close_count, &reset_count);
@@ -451,6 +480,208 @@ void test_ibufs_size(void)
 	clean_table();
 }
 
+void test_resize(void)
+{
+	int CONNS = 20;
+	knot_xdp_msg_t msgs[CONNS];
+	knot_tcp_relay_dynarray_t relays = { 0 };
+
+	for (int i = 0; i < CONNS; i++) {
+		prepare_msg(&msgs[i], KNOT_XDP_MSG_SYN, i + 3000, 1);
+	}
+	int ret = knot_tcp_relay(test_sock, msgs, CONNS, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "resize: open OK");
+	check_sent(0, 0, CONNS, 0);
+	knot_tcp_relay_free(&relays);
+
+	size_t sizes[] = { 3 * TEST_TABLE_SIZE, 7, TEST_TABLE_SIZE };
+	for (int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		ret = knot_tcp_table_resize(test_table, sizes[s]);
+		is_int(KNOT_EOK, ret, "resize: to %zu OK", sizes[s]);
+		is_int(sizes[s], test_table->size, "resize: new size");
+		is_int(CONNS, test_table->usage, "resize: usage");
+		bool found = true;
+		for (int i = 0; i < CONNS; i++) {
+			found &= (tcp_table_find(test_table, &msgs[i]) != NULL);
+		}
+		ok(found, "resize: all connections found");
+	}
+	is_int(KNOT_EINVAL, knot_tcp_table_resize(test_table, 0), "resize: zero size");
+
+	clean_table();
+	is_int(0, test_table->usage, "resize: cleaned");
+}
+
+static void check_segments(size_t expect_segments, size_t expect_bytes, const char *msg)
+{
+	is_int(expect_segments, sent_segments, "%s: sent segments", msg);
+	is_int(expect_bytes, sent_bytes, "%s: sent bytes", msg);
+	sent_segments = 0;
+	sent_bytes = 0;
+}
+
+static void prepare_ack(knot_xdp_msg_t *msg, knot_tcp_conn_t *conn, uint32_t ackno, uint16_t win)
+{
+	prepare_msg(msg, KNOT_XDP_MSG_ACK, 5000, 6000);
+	msg->seqno = conn->seqno;
+	msg->ackno = ackno;
+	msg->win = win;
+}
+
+void test_send_window(void)
+{
+	const uint16_t MSS = 600;
+	knot_xdp_msg_t msg;
+	knot_tcp_relay_dynarray_t relays = { 0 };
+
+	prepare_msg(&msg, KNOT_XDP_MSG_SYN | KNOT_XDP_MSG_ACK | KNOT_XDP_MSG_MSS, 5000, 6000);
+	msg.mss = MSS;
+	msg.win = 10 * MSS;
+	int ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "window: SYN+ACK relay OK");
+	knot_tcp_conn_t *conn = tcp_table_find(test_table, &msg);
+	ok(conn != NULL && conn->window_size == 10 * MSS, "window: peer window");
+	if (conn == NULL) {
+		knot_tcp_relay_free(&relays);
+		return;
+	}
+	uint32_t base = conn->ackno;
+
+	char data[10 * MSS];
+	memset(data, 0, sizeof(data));
+	knot_tcp_relay_t answer_to = *knot_tcp_relay_dynarray_arr(&relays);
+	ret = knot_tcp_relay_answer(&relays, &answer_to, data, sizeof(data));
+	is_int(KNOT_EOK, ret, "window: answer queued");
+	is_int(2, relays.size, "window: one answer relay");
+
+	// 11 segments including the prefix, the last one doesn't fit the window.
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	is_int(KNOT_EOK, ret, "window: send OK");
+	check_segments(10, 10 * MSS, "window: first flight");
+	is_int(base + 10 * MSS, conn->ackno, "window: snd_max");
+	knot_tcp_relay_free(&relays);
+
+	prepare_ack(&msg, conn, base + 5 * MSS, 10 * MSS);
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "window: ACK relay OK");
+	is_int(1, relays.size, "window: relay to send more");
+	is_int(11 * MSS, conn->cong_window, "window: slow start");
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	check_segments(1, 2, "window: rest sent");
+	is_int(base + 10 * MSS, sent_seqno, "window: rest seqno");
+	knot_tcp_relay_free(&relays);
+
+	uint32_t resent = 0;
+	ret = knot_tcp_resend(test_table, test_sock, 20, 0, &resent);
+	is_int(KNOT_EOK, ret, "window: resend OK");
+	is_int(1, resent, "window: one connection retransmitted");
+	is_int(MSS, conn->cong_window, "window: congestion window collapsed");
+	check_segments(1, MSS, "window: retransmitted one segment");
+	is_int(base + 5 * MSS, sent_seqno, "window: retransmitted seqno");
+
+	prepare_ack(&msg, conn, base + 6 * MSS, 10 * MSS);
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	check_segments(2, 2 * MSS, "window: go back N");
+	is_int(base + 7 * MSS, sent_seqno, "window: go back N seqno");
+	knot_tcp_relay_free(&relays);
+
+	prepare_ack(&msg, conn, base + 10 * MSS + 2, 0);
+	ret = knot_tcp_relay(test_sock, &msg, 1, test_table, NULL, &relays, NULL);
+	is_int(0, relays.size, "window: all acknowledged");
+	ok(conn->outbufs == NULL, "window: buffers freed");
+	knot_tcp_relay_free(&relays);
+
+	// Zero window, still one segment to probe it.
+	knot_tcp_relay_t probe = { .conn = conn };
+	ret = knot_tcp_relay_answer(&relays, &probe, data, 3 * MSS);
+	ret = knot_tcp_send(test_sock, knot_tcp_relay_dynarray_arr(&relays), relays.size);
+	check_segments(1, MSS, "window: zero window probe");
+	knot_tcp_relay_free(&relays);
+
+	resent = 0;
+	ret = knot_tcp_resend(test_table, test_sock, 20, UINT32_MAX, &resent);
+	is_int(0, resent, "window: no retransmit before timeout");
+
+	// Unsent data is dropped with the FIN.
+	knot_tcp_relay_t close = { .answer = XDP_TCP_CLOSE, .conn = conn };
+	ret = knot_tcp_send(test_sock, &close, 1);
+	is_int(KNOT_EOK, ret, "window: close OK");
+	ok(conn->outbufs != NULL && conn->outbufs->next == NULL, "window: only data in flight kept");
+	is_int(base + 11 * MSS + 2 + 1, conn->ackno, "window: FIN after data");
+
+	clean_table();
+	check_segments(0, 0, "window: cleanup");
+}
+
+void test_headers(void)
+{
+	uint8_t frame[256] = { 0 };
+	const char data[] = "\x00\x03abc";
+
+	knot_xdp_msg_t msg;
+	prepare_msg(&msg, KNOT_XDP_MSG_ACK | KNOT_XDP_MSG_VLAN | KNOT_XDP_MSG_QINQ, 7000, 53);
+	msg.vlan_tpid[0] = ETH_P_8021AD;
+	msg.vlan_tci[0] = 100;
+	msg.vlan_tpid[1] = ETH_P_8021Q;
+	msg.vlan_tci[1] = 200;
+	size_t hdr_len = prot_write_hdrs_len(&msg);
+	msg.payload.iov_base = frame + hdr_len;
+	msg.payload.iov_len = sizeof(data) - 1;
+	memcpy(msg.payload.iov_base, data, msg.payload.iov_len);
+	prot_write_eth(frame, &msg, frame + hdr_len + msg.payload.iov_len, 1000);
+	is_int(ETH_P_8021AD, be16toh(((struct ethhdr *)frame)->h_proto), "headers: outer tag");
+
+	knot_xdp_msg_t rcvd = { 0 };
+	void *payl_end, *payl = prot_read_eth(frame, &rcvd, &payl_end);
+	ok((rcvd.flags & KNOT_XDP_MSG_VLAN) && (rcvd.flags & KNOT_XDP_MSG_QINQ), "headers: QinQ");
+	ok(rcvd.vlan_tpid[0] == ETH_P_8021AD && rcvd.vlan_tci[0] == 100 &&
+	   rcvd.vlan_tpid[1] == ETH_P_8021Q && rcvd.vlan_tci[1] == 200, "headers: VLAN tags");
+	ok(payl == frame + hdr_len && payl_end - payl == sizeof(data) - 1, "headers: tagged payload");
+
+	knot_xdp_msg_t reply;
+	msg_init_reply(&reply, &rcvd);
+	is_int(hdr_len, prot_write_hdrs_len(&reply), "headers: reply tagged");
+
+	knot_tcp_relay_dynarray_t relays = { 0 };
+	rcvd.flags |= KNOT_XDP_MSG_SYN;
+	rcvd.flags &= ~KNOT_XDP_MSG_ACK;
+	int ret = knot_tcp_relay(test_sock, &rcvd, 1, test_table, NULL, &relays, NULL);
+	is_int(KNOT_EOK, ret, "headers: SYN relay OK");
+	knot_tcp_conn_t *conn = tcp_table_find(test_table, &rcvd);
+	ok(conn != NULL && conn->vlan_tci[0] == 100 && conn->vlan_tci[1] == 200,
+	   "headers: connection tags");
+	knot_tcp_relay_free(&relays);
+	clean_table();
+	check_sent(0, 0, 1, 0);
+
+	// IPv6 with hop-by-hop and destination options.
+	memset(frame, 0, sizeof(frame));
+	prepare_msg(&msg, KNOT_XDP_MSG_IPV6, 7000, 53);
+	msg.flags &= ~KNOT_XDP_MSG_TCP;
+	msg.ip_from.sin6_family = msg.ip_to.sin6_family = AF_INET6;
+	hdr_len = prot_write_hdrs_len(&msg);
+	msg.payload.iov_base = frame + hdr_len;
+	msg.payload.iov_len = sizeof(data) - 1;
+	memcpy(msg.payload.iov_base, data, msg.payload.iov_len);
+	prot_write_eth(frame, &msg, frame + hdr_len + msg.payload.iov_len, 0);
+
+	uint8_t *l4 = frame + sizeof(struct ethhdr) + sizeof(struct ipv6hdr);
+	size_t l4_len = sizeof(struct udphdr) + msg.payload.iov_len;
+	memmove(l4 + 24, l4, l4_len);
+	uint8_t exts[24] = { IPPROTO_DSTOPTS, 0, [8] = IPPROTO_UDP, 1 };
+	memcpy(l4, exts, sizeof(exts));
+	struct ipv6hdr *ip6 = (struct ipv6hdr *)(frame + sizeof(struct ethhdr));
+	ip6->nexthdr = IPPROTO_HOPOPTS;
+	ip6->payload_len = htobe16(l4_len + sizeof(exts));
+
+	memset(&rcvd, 0, sizeof(rcvd));
+	payl = prot_read_eth(frame, &rcvd, &payl_end);
+	ok(payl == l4 + 24 + sizeof(struct udphdr) && payl_end - payl == sizeof(data) - 1,
+	   "headers: payload after extension headers");
+	is_int(7000, be16toh(rcvd.ip_from.sin6_port), "headers: port after extension headers");
+}
+
 static void init_mock(knot_xdp_socket_t **socket, void *send_mock)
 {
 	*socket = calloc(1, sizeof(**socket));
@@ -476,6 +707,12 @@ int main(int argc, char *argv[])
 	test_close();
 
 	test_ibufs_size();
+	test_resize();
+	test_headers();
+
+	knot_xdp_deinit(test_sock);
+	init_mock(&test_sock, mock_send_data);
+	test_send_window();
 
 	knot_xdp_deinit(test_sock);
 	init_mock(&test_sock, mock_send_nocheck);
@@ -21,6 +21,7 @@
 #include "libknot/libknot.h"
 #include "contrib/sockaddr.h"
 #include "knot/modules/rrl/functions.c"
+#include "knot/modules/rrl/nxdomain.c"
 #include "stdio.h"
 
 /* Enable time-dependent tests. */
@@ -28,6 +29,7 @@
 #define RRL_SIZE 196613
 #define RRL_THREADS 8
 #define RRL_INSERTS (RRL_SIZE/(5*RRL_THREADS)) /* lf = 1/5 */
+#define RRL_BENCH_QUERIES 1000000
 
 /* Disabled as default as it depends on random input.
  * Table may be consistent even if some collision occur (and they may occur).
@@ -54,23 +56,26 @@ static void* rrl_runnable(void *arg)
 	struct runnable_data *d = (struct runnable_data *)arg;
 	struct sockaddr_storage addr;
 	memcpy(&addr, d->addr, sizeof(struct sockaddr_storage));
-	int lock = -1;
+	rrl_shard_t *shard = NULL;
+	uint8_t buf[RRL_CLSBLK_MAXLEN];
 	uint32_t now = time(NULL);
 	struct bucketmap *m = malloc(RRL_INSERTS * sizeof(struct bucketmap));
 	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
 		m[i].i = dnssec_random_uint32_t();
 		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
+		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &shard,
+		                         buf, sizeof(buf));
 		m[i].x = b->netblk;
+		pthread_mutex_unlock(&shard->lock);
 	}
 	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
 		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
+		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &shard,
+		                         buf, sizeof(buf));
 		if (b->netblk != m[i].x) {
 			d->passed = 0;
 		}
+		pthread_mutex_unlock(&shard->lock);
 	}
 	free(m);
 	return NULL;
@@ -87,6 +92,37 @@ static void rrl_hopscotch(struct runnable_data* rd)
 		pthread_join(thr[i], NULL);
 	}
 }
+
+static void *rrl_bench_runnable(void *arg)
+{
+	struct runnable_data *d = (struct runnable_data *)arg;
+	struct sockaddr_storage addr;
+	memcpy(&addr, d->addr, sizeof(struct sockaddr_storage));
+	for (unsigned i = 0; i < RRL_BENCH_QUERIES; ++i) {
+		((struct sockaddr_in *) &addr)->sin_addr.s_addr = dnssec_random_uint32_t() % 4096;
+		(void)rrl_query(d->rrl, &addr, d->rq, d->zone, NULL);
+	}
+	return NULL;
+}
+
+/* Print query throughput of rrl_query() for an increasing number of threads. */
+static void rrl_bench(struct runnable_data* rd)
+{
+	pthread_t thr[RRL_THREADS];
+	for (unsigned n = 1; n <= RRL_THREADS; n *= 2) {
+		struct timespec begin = time_now();
+		for (unsigned i = 0; i < n; ++i) {
+			pthread_create(thr + i, NULL, &rrl_bench_runnable, rd);
+		}
+		for (unsigned i = 0; i < n; ++i) {
+			pthread_join(thr[i], NULL);
+		}
+		struct timespec end = time_now();
+		double elapsed = time_diff_ms(&begin, &end) / 1000.0;
+		diag("rrl: %u threads, %.0f queries/s", n,
+		     n * RRL_BENCH_QUERIES / MAX(elapsed, 0.001));
+	}
+}
 #endif
 
 int main(int argc, char *argv[])
@@ -123,7 +159,7 @@ int main(int argc, char *argv[])
 
 	/* 1. create rrl table */
 	const uint32_t rate = 10;
-	rrl_table_t *rrl = rrl_create(RRL_SIZE, rate);
+	rrl_table_t *rrl = rrl_create(RRL_SIZE, rate, NULL);
 	ok(rrl != NULL, "rrl: create");
 
 	/* 2. N unlimited requests. */
@@ -168,8 +204,39 @@ int main(int argc, char *argv[])
 	};
 	rrl_hopscotch(&rd);
 	ok(rd.passed, "rrl: hashtable is ~ consistent");
+
+	/* 9. scaling with the number of threads */
+	rrl_bench(&rd);
 #endif
 
+	/* 10. NXDOMAIN proof ranges. */
+	knot_dname_t *owner = knot_dname_from_str_alloc("a.x.rrl.");
+	knot_dname_t *next = knot_dname_from_str_alloc("b.y.rrl.");
+	knot_dname_t *in_x = knot_dname_from_str_alloc("c.x.rrl.");
+	knot_dname_t *in_y = knot_dname_from_str_alloc("a.y.rrl.");
+	knot_dname_t *ent = knot_dname_from_str_alloc("y.rrl.");
+	knot_dname_t *after = knot_dname_from_str_alloc("c.y.rrl.");
+	ok(range_covers(owner, next, in_x) && range_covers(owner, next, in_y) &&
+	   !range_covers(owner, next, owner) && !range_covers(owner, next, next) &&
+	   !range_covers(owner, next, after), "rrl: NSEC range covers");
+	ok(range_covers(next, zone, after) && !range_covers(next, zone, owner),
+	   "rrl: last NSEC range covers");
+	const knot_dname_t *ce_x = closest_encloser(owner, next, in_x);
+	const knot_dname_t *ce_y = closest_encloser(owner, next, in_y);
+	ok(ce_x != NULL && knot_dname_is_equal(ce_x, in_x + 2) &&
+	   ce_y != NULL && knot_dname_is_equal(ce_y, in_y + 2) &&
+	   closest_encloser(owner, next, ent) == NULL, "rrl: closest encloser");
+	knot_dname_free(owner, NULL);
+	knot_dname_free(next, NULL);
+	knot_dname_free(in_x, NULL);
+	knot_dname_free(in_y, NULL);
+	knot_dname_free(ent, NULL);
+	knot_dname_free(after, NULL);
+
+	nxd_table_t *nxd = nxd_create(rate);
+	ok(nxd != NULL, "rrl: create NXDOMAIN table");
+	nxd_destroy(nxd);
+
 	knot_dname_free(zone, NULL);
 	knot_pkt_free(query);
 	rrl_destroy(rrl);
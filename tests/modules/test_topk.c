@@ -0,0 +1,95 @@
+/*  Copyright (C) 2022 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <tap/basic.h>
+
+#include "libdnssec/crypto.h"
+#include "knot/modules/stats/topk.c"
+
+#define THREADS	4
+#define K	8
+
+static void add_str(topk_t *tk, unsigned thr_id, const char *str)
+{
+	topk_add(tk, thr_id, (const uint8_t *)str, strlen(str));
+}
+
+static bool item_is(const topk_item_t *item, const char *str)
+{
+	return item->len == strlen(str) && memcmp(item->key, str, item->len) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	dnssec_crypto_init();
+
+	ok(topk_new(THREADS, 0) == NULL && topk_new(THREADS, TOPK_MAX + 1) == NULL,
+	   "invalid size");
+
+	topk_t *tk = topk_new(THREADS, K);
+	ok(tk != NULL, "create");
+
+	topk_item_t items[K];
+	ok(topk_read(tk, items, K) == 0, "empty");
+
+	// Few keys in one thread are counted exactly.
+	for (int i = 0; i < 3; i++) {
+		add_str(tk, 0, "a");
+	}
+	add_str(tk, 0, "b");
+	size_t count = topk_read(tk, items, K);
+	ok(count == 2 && item_is(&items[0], "a") && items[0].count == 3 &&
+	   item_is(&items[1], "b") && items[1].count == 1, "exact counts");
+
+	// The same key in more threads is merged.
+	add_str(tk, 1, "b");
+	add_str(tk, 2, "b");
+	add_str(tk, 3, "b");
+	count = topk_read(tk, items, K);
+	ok(count == 2 && item_is(&items[0], "b") && items[0].count == 4 &&
+	   item_is(&items[1], "a") && items[1].count == 3, "merged threads");
+	ok(topk_read(tk, items, 1) == 1 && item_is(&items[0], "b"), "limited output");
+
+	// Heavy hitters survive a flood of unique keys.
+	char buf[32];
+	for (int i = 0; i < 100000; i++) {
+		for (unsigned thr = 0; thr < THREADS; thr++) {
+			if (i % 10 == 0) {
+				add_str(tk, thr, "heavy");
+			}
+			if (i % 20 == 0) {
+				add_str(tk, thr, "medium");
+			}
+			(void)snprintf(buf, sizeof(buf), "%u-%i", thr, i);
+			add_str(tk, thr, buf);
+		}
+	}
+	count = topk_read(tk, items, K);
+	ok(count == K && item_is(&items[0], "heavy") && item_is(&items[1], "medium"),
+	   "heavy hitters found");
+	ok(items[0].count >= THREADS * 10000 && items[1].count >= THREADS * 5000,
+	   "counts not underestimated");
+
+	topk_free(tk);
+
+	dnssec_crypto_cleanup();
+
+	return 0;
+}